@@ -0,0 +1,268 @@
+/** Micro-benchmarks for core kernels, to compare builds before rolling them out.
+  *
+  * In contrast to dbms/programs/performance-test, which runs whole queries against a server,
+  * this program benchmarks the hot functions in isolation, on representative data distributions:
+  * LZ4 decompression, Volnitsky substring search, hash table probes, ColumnVector::filter,
+  * Arena allocation and PODArray growth.
+  *
+  * Results are printed as JSONEachRow, one object per benchmark, so they are trivial
+  * to load back into ClickHouse or diff between two builds:
+  *
+  *   ./clickhouse_microbenchmarks [name_substring]
+  */
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <lz4.h>
+
+#include <Columns/ColumnVector.h>
+#include <Columns/ColumnsNumber.h>
+#include <Common/Arena.h>
+#include <Common/HashTable/HashMap.h>
+#include <Common/PODArray.h>
+#include <Common/Stopwatch.h>
+#include <Common/Volnitsky.h>
+#include <IO/LZ4_decompress_faster.h>
+
+
+namespace
+{
+
+std::string benchmark_filter;
+
+/// Runs `func` until at least `min_iterations` iterations and 0.5 seconds have passed,
+/// reports the best iteration (the least affected by noise) and the items/sec derived from it.
+template <typename F>
+void bench(const std::string & name, size_t items_per_iteration, F && func)
+{
+    if (!benchmark_filter.empty() && name.find(benchmark_filter) == std::string::npos)
+        return;
+
+    static constexpr size_t min_iterations = 5;
+    static constexpr double min_total_seconds = 0.5;
+
+    /// Warmup: populate caches and branch predictors, trigger lazy initialization.
+    func();
+
+    size_t iterations = 0;
+    double total_seconds = 0;
+    double best_seconds = std::numeric_limits<double>::max();
+
+    while (iterations < min_iterations || total_seconds < min_total_seconds)
+    {
+        Stopwatch watch;
+        func();
+        double seconds = watch.elapsedSeconds();
+
+        best_seconds = std::min(best_seconds, seconds);
+        total_seconds += seconds;
+        ++iterations;
+    }
+
+    std::cout << "{\"name\":\"" << name << "\""
+        << ",\"iterations\":" << iterations
+        << ",\"best_seconds\":" << best_seconds
+        << ",\"avg_seconds\":" << total_seconds / iterations
+        << ",\"items\":" << items_per_iteration
+        << ",\"items_per_second\":" << static_cast<UInt64>(items_per_iteration / best_seconds)
+        << "}" << std::endl;
+}
+
+
+/// Text-like data: small alphabet, repeated words. Compresses well, like typical String columns.
+std::vector<char> generateCompressibleData(size_t size, std::mt19937_64 & rng)
+{
+    static const char * words[] = {"hello", "world", "benchmark", "clickhouse", "column", "filter", "the", "a"};
+
+    std::vector<char> data;
+    data.reserve(size + 16);
+    while (data.size() < size)
+    {
+        const char * word = words[rng() % 8];
+        data.insert(data.end(), word, word + strlen(word));
+        data.push_back(' ');
+    }
+    data.resize(size);
+    return data;
+}
+
+std::vector<char> generateRandomData(size_t size, std::mt19937_64 & rng)
+{
+    std::vector<char> data(size);
+    for (auto & byte : data)
+        byte = rng();
+    return data;
+}
+
+
+void benchLZ4(const std::string & name, const std::vector<char> & source)
+{
+    std::vector<char> compressed(LZ4_compressBound(source.size()));
+    int compressed_size = LZ4_compress_default(source.data(), compressed.data(), source.size(), compressed.size());
+    if (compressed_size <= 0)
+        throw std::runtime_error("Cannot compress data for benchmark");
+
+    /// Both buffers passed to LZ4::decompress must have spare bytes at the end.
+    compressed.resize(compressed_size + LZ4::ADDITIONAL_BYTES_AT_END_OF_BUFFER);
+    std::vector<char> decompressed(source.size() + LZ4::ADDITIONAL_BYTES_AT_END_OF_BUFFER);
+
+    LZ4::PerformanceStatistics statistics;
+
+    bench(name, source.size(), [&]
+    {
+        LZ4::decompress(compressed.data(), decompressed.data(), compressed_size, source.size(), statistics);
+    });
+}
+
+
+void benchVolnitsky(std::mt19937_64 & rng)
+{
+    static constexpr size_t haystack_size = 1 << 26;
+
+    auto haystack = generateCompressibleData(haystack_size, rng);
+
+    /// A needle that is absent from the text: the whole haystack gets scanned.
+    static const std::string needle = "nonexistent_needle";
+
+    DB::Volnitsky searcher(needle.data(), needle.size(), haystack.size());
+
+    bench("volnitsky_search_miss", haystack.size(), [&]
+    {
+        const char * result = searcher.search(haystack.data(), haystack.size());
+        if (result != haystack.data() + haystack.size())
+            throw std::runtime_error("Found a needle that should not be there");
+    });
+}
+
+
+void benchHashTable(std::mt19937_64 & rng)
+{
+    static constexpr size_t num_keys = 1 << 22;
+
+    std::vector<UInt64> keys(num_keys);
+    for (auto & key : keys)
+        key = rng();
+
+    bench("hash_map_insert_random_u64", num_keys, [&]
+    {
+        HashMap<UInt64, UInt64> map;
+        for (size_t i = 0; i < num_keys; ++i)
+            ++map[keys[i]];
+    });
+
+    HashMap<UInt64, UInt64> map;
+    for (size_t i = 0; i < num_keys; ++i)
+        map[keys[i]] = i;
+
+    /// Half of the probed keys are present, half are not.
+    std::vector<UInt64> probes(num_keys);
+    for (size_t i = 0; i < num_keys; ++i)
+        probes[i] = (i % 2) ? keys[rng() % num_keys] : rng();
+
+    bench("hash_map_probe_half_hits", num_keys, [&]
+    {
+        size_t found = 0;
+        for (const auto key : probes)
+            found += map.find(key) != map.end();
+        if (found == 0)
+            throw std::runtime_error("Nothing found in hash map");
+    });
+}
+
+
+void benchColumnFilter(std::mt19937_64 & rng)
+{
+    static constexpr size_t num_rows = 1 << 24;
+
+    auto column = DB::ColumnUInt64::create();
+    auto & column_data = column->getData();
+    column_data.resize(num_rows);
+    for (auto & value : column_data)
+        value = rng();
+
+    auto run = [&](const std::string & name, double selectivity)
+    {
+        DB::IColumn::Filter filter(num_rows);
+        for (auto & value : filter)
+            value = rng() % 1000 < selectivity * 1000;
+
+        bench(name, num_rows, [&]
+        {
+            auto filtered = column->filter(filter, -1);
+            if (filtered->empty() && selectivity > 0)
+                throw std::runtime_error("Filtered column is unexpectedly empty");
+        });
+    };
+
+    run("column_vector_filter_sel_0.01", 0.01);
+    run("column_vector_filter_sel_0.50", 0.50);
+    run("column_vector_filter_sel_0.99", 0.99);
+}
+
+
+void benchArena(std::mt19937_64 & rng)
+{
+    static constexpr size_t num_allocations = 1 << 20;
+
+    /// Mostly small string-like allocations, occasionally larger ones.
+    std::vector<size_t> sizes(num_allocations);
+    for (auto & size : sizes)
+        size = (rng() % 100 < 95) ? 8 + rng() % 56 : 256 + rng() % 3840;
+
+    bench("arena_alloc_mixed_sizes", num_allocations, [&]
+    {
+        DB::Arena arena;
+        char * ptr = nullptr;
+        for (const auto size : sizes)
+            ptr = arena.alloc(size);
+        if (!ptr)
+            throw std::runtime_error("Arena returned nullptr");
+    });
+}
+
+
+void benchPODArray()
+{
+    static constexpr size_t num_elements = 1 << 24;
+
+    /// Growth from empty: measures the reallocation and memcpy policy.
+    bench("pod_array_push_back_growth", num_elements, [&]
+    {
+        DB::PODArray<UInt64> array;
+        for (size_t i = 0; i < num_elements; ++i)
+            array.push_back(i);
+        if (array.size() != num_elements)
+            throw std::runtime_error("Unexpected PODArray size");
+    });
+}
+
+}
+
+
+int main(int argc, char ** argv)
+{
+    if (argc > 1)
+        benchmark_filter = argv[1];
+
+    /// Fixed seed: the data must be the same in the two builds being compared.
+    std::mt19937_64 rng(42);
+
+    auto compressible = generateCompressibleData(1 << 24, rng);
+    auto random = generateRandomData(1 << 24, rng);
+
+    benchLZ4("lz4_decompress_compressible", compressible);
+    benchLZ4("lz4_decompress_random", random);
+    benchVolnitsky(rng);
+    benchHashTable(rng);
+    benchColumnFilter(rng);
+    benchArena(rng);
+    benchPODArray();
+
+    return 0;
+}
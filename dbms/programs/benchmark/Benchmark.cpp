@@ -3,15 +3,19 @@
 #include <fcntl.h>
 #include <signal.h>
 #include <time.h>
+#include <math.h>
 #include <iostream>
 #include <fstream>
 #include <iomanip>
 #include <random>
+#include <array>
+#include <thread>
+#include <chrono>
 #include <pcg_random.hpp>
 #include <Poco/File.h>
 #include <Poco/Util/Application.h>
 #include <Common/Stopwatch.h>
-#include <common/ThreadPool.h>
+#include <Common/ThreadPool.h>
 #include <AggregateFunctions/ReservoirSampler.h>
 #include <AggregateFunctions/registerAggregateFunctions.h>
 #include <boost/program_options.hpp>
@@ -34,7 +38,8 @@
 
 
 /** A tool for evaluating ClickHouse performance.
-  * The tool emulates a case with fixed amount of simultaneously executing queries.
+  * The tool emulates a case with fixed amount of simultaneously executing queries
+  * (or, with --qps, an open loop with a fixed query arrival rate).
   */
 
 namespace DB
@@ -50,15 +55,20 @@ class Benchmark
 {
 public:
     Benchmark(unsigned concurrency_, double delay_,
-            const String & host_, UInt16 port_, const String & default_database_,
+            const Strings & hosts_, const std::vector<UInt16> & ports_, const String & default_database_,
             const String & user_, const String & password_, const String & stage,
             bool randomize_, size_t max_iterations_, double max_time_,
+            double warmup_, double target_qps_, bool weighted_,
             const String & json_path_, const ConnectionTimeouts & timeouts, const Settings & settings_)
         :
-        concurrency(concurrency_), delay(delay_), queue(concurrency),
-        connections(concurrency, host_, port_, default_database_, user_, password_, timeouts),
+        concurrency(concurrency_), delay(delay_),
+        /// In open-loop mode the queue must be deep enough to not throttle the arrival rate
+        /// when the servers fall behind; the wait in the queue is then part of the latency.
+        queue(target_qps_ > 0 ? 65536 : concurrency),
         randomize(randomize_), max_iterations(max_iterations_), max_time(max_time_),
-        json_path(json_path_), settings(settings_), global_context(Context::createGlobal()), pool(concurrency)
+        warmup(warmup_), target_qps(target_qps_), weighted(weighted_),
+        json_path(json_path_), settings(settings_), global_context(Context::createGlobal()),
+        pool(concurrency * hosts_.size())
     {
         std::cerr << std::fixed << std::setprecision(3);
 
@@ -66,6 +76,17 @@ public:
         /// (example: when using stage = 'with_mergeable_state')
         registerAggregateFunctions();
 
+        for (size_t i = 0; i < hosts_.size(); ++i)
+        {
+            connection_pools.emplace_back(std::make_unique<ConnectionPool>(
+                concurrency, hosts_[i], ports_[i], default_database_, user_, password_, timeouts));
+            server_descriptions.emplace_back(hosts_[i] + ":" + toString(ports_[i]));
+            infos_total.emplace_back(std::make_unique<Stats>());
+            infos_per_interval.emplace_back(std::make_unique<Stats>());
+        }
+
+        warmup_finished = (warmup == 0);
+
         if (stage == "complete")
             query_processing_stage = QueryProcessingStage::Complete;
         else if (stage == "fetch_columns")
@@ -92,14 +113,28 @@ private:
 
     using Queries = std::vector<Query>;
     Queries queries;
+    std::vector<UInt64> weights;
+
+    /// A query together with the moment it was scheduled to start (non-zero in open-loop mode),
+    /// so that the time spent waiting in the queue is charged to the latency.
+    struct TimedQuery
+    {
+        Query query;
+        UInt64 scheduled_ns = 0;
+    };
 
-    using Queue = ConcurrentBoundedQueue<Query>;
+    using Queue = ConcurrentBoundedQueue<TimedQuery>;
     Queue queue;
 
-    ConnectionPool connections;
+    std::vector<std::unique_ptr<ConnectionPool>> connection_pools;
+    Strings server_descriptions;
+
     bool randomize;
     size_t max_iterations;
     double max_time;
+    double warmup;
+    double target_qps;
+    bool weighted;
     String json_path;
     Settings settings;
     Context global_context;
@@ -107,17 +142,31 @@ private:
 
     /// Don't execute new queries after timelimit or SIGINT or exception
     std::atomic<bool> shutdown{false};
+    bool warmup_finished = false;
 
     std::atomic<size_t> queries_executed{0};
 
+    static UInt64 nowNanoseconds()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+
     struct Stats
     {
+        /// Power-of-two buckets in microseconds: bucket i counts queries of up to 2^i us.
+        static constexpr size_t HISTOGRAM_BUCKETS = 28;
+
         Stopwatch watch;
         std::atomic<size_t> queries{0};
         size_t read_rows = 0;
         size_t read_bytes = 0;
         size_t result_rows = 0;
         size_t result_bytes = 0;
+        double sum_seconds = 0;
+        double sum_seconds_sq = 0;
+        std::array<size_t, HISTOGRAM_BUCKETS> histogram{{}};
 
         using Sampler = ReservoirSampler<double>;
         Sampler sampler {1 << 16};
@@ -129,7 +178,13 @@ private:
             read_bytes += read_bytes_inc;
             result_rows += result_rows_inc;
             result_bytes += result_bytes_inc;
+            sum_seconds += seconds;
+            sum_seconds_sq += seconds * seconds;
             sampler.insert(seconds);
+
+            size_t us = seconds * 1e6;
+            size_t bucket = us ? std::min<size_t>(64 - __builtin_clzll(us), HISTOGRAM_BUCKETS - 1) : 0;
+            ++histogram[bucket];
         }
 
         void clear()
@@ -140,12 +195,25 @@ private:
             read_bytes = 0;
             result_rows = 0;
             result_bytes = 0;
+            sum_seconds = 0;
+            sum_seconds_sq = 0;
+            histogram.fill(0);
             sampler.clear();
         }
+
+        double mean() const { return queries ? sum_seconds / queries : 0; }
+
+        double variance() const
+        {
+            if (queries < 2)
+                return 0;
+            double m = mean();
+            return std::max(0.0, sum_seconds_sq / queries - m * m);
+        }
     };
 
-    Stats info_per_interval;
-    Stats info_total;
+    std::vector<std::unique_ptr<Stats>> infos_total;
+    std::vector<std::unique_ptr<Stats>> infos_per_interval;
     Stopwatch delay_watch;
 
     std::mutex mutex;
@@ -159,12 +227,24 @@ private:
 
         while (!in.eof())
         {
+            UInt64 weight = 1;
+
+            /// In weighted mode each line is "<weight><TAB><query>".
+            if (weighted)
+            {
+                readIntText(weight, in);
+                assertChar('\t', in);
+            }
+
             std::string query;
             readText(query, in);
             assertChar('\n', in);
 
-            if (!query.empty())
+            if (!query.empty() && weight)
+            {
                 queries.emplace_back(query);
+                weights.emplace_back(weight);
+            }
         }
 
         if (queries.empty())
@@ -183,7 +263,7 @@ private:
     }
 
     /// Try push new query and check cancellation conditions
-    bool tryPushQueryInteractively(const String & query, InterruptListener & interrupt_listener)
+    bool tryPushQueryInteractively(const TimedQuery & query, InterruptListener & interrupt_listener)
     {
         bool inserted = false;
 
@@ -197,7 +277,7 @@ private:
                 return false;
             }
 
-            if (max_time > 0 && info_total.watch.elapsedSeconds() >= max_time)
+            if (max_time > 0 && infos_total[0]->watch.elapsedSeconds() >= max_time)
             {
                 std::cout << "Stopping launch of queries. Requested time limit is exhausted.\n";
                 return false;
@@ -211,8 +291,8 @@ private:
 
             if (delay > 0 && delay_watch.elapsedSeconds() > delay)
             {
-                printNumberOfQueriesExecuted(info_total.queries);
-                report(info_per_interval);
+                printNumberOfQueriesExecuted(queriesExecutedTotal());
+                reportAll(infos_per_interval);
                 delay_watch.restart();
             }
         };
@@ -220,24 +300,52 @@ private:
         return true;
     }
 
+    size_t queriesExecutedTotal()
+    {
+        size_t res = 0;
+        for (const auto & info : infos_total)
+            res += info->queries;
+        return res;
+    }
+
     void run()
     {
         pcg64 generator(randomSeed());
-        std::uniform_int_distribution<size_t> distribution(0, queries.size() - 1);
+        std::uniform_int_distribution<size_t> uniform_distribution(0, queries.size() - 1);
+        std::discrete_distribution<size_t> weighted_distribution(weights.begin(), weights.end());
 
-        for (size_t i = 0; i < concurrency; ++i)
-            pool.schedule(std::bind(&Benchmark::thread, this, connections.get()));
+        for (size_t s = 0; s < connection_pools.size(); ++s)
+            for (size_t i = 0; i < concurrency; ++i)
+                pool.schedule(std::bind(&Benchmark::thread, this, connection_pools[s]->get(), s));
 
         InterruptListener interrupt_listener;
-        info_per_interval.watch.restart();
+        for (auto & info : infos_per_interval)
+            info->watch.restart();
         delay_watch.restart();
 
+        UInt64 start_ns = nowNanoseconds();
+
         /// Push queries into queue
         for (size_t i = 0; !max_iterations || i < max_iterations; ++i)
         {
-            size_t query_index = randomize ? distribution(generator) : i % queries.size();
+            size_t query_index = weighted
+                ? weighted_distribution(generator)
+                : (randomize ? uniform_distribution(generator) : i % queries.size());
+
+            TimedQuery timed_query;
+            timed_query.query = queries[query_index];
+
+            /// Open loop: the queries arrive on a fixed schedule regardless of completions.
+            if (target_qps > 0)
+            {
+                UInt64 scheduled_ns = start_ns + static_cast<UInt64>(i * 1e9 / target_qps);
+                UInt64 now_ns = nowNanoseconds();
+                if (scheduled_ns > now_ns)
+                    std::this_thread::sleep_for(std::chrono::nanoseconds(scheduled_ns - now_ns));
+                timed_query.scheduled_ns = scheduled_ns;
+            }
 
-            if (!tryPushQueryInteractively(queries[query_index], interrupt_listener))
+            if (!tryPushQueryInteractively(timed_query, interrupt_listener))
             {
                 shutdown = true;
                 break;
@@ -245,19 +353,22 @@ private:
         }
 
         pool.wait();
-        info_total.watch.stop();
+        for (auto & info : infos_total)
+            info->watch.stop();
 
         if (!json_path.empty())
-            reportJSON(info_total, json_path);
+            reportJSON(json_path);
 
-        printNumberOfQueriesExecuted(info_total.queries);
-        report(info_total);
+        printNumberOfQueriesExecuted(queriesExecutedTotal());
+        /// The comparison must read the stats before report() clears them.
+        reportComparison();
+        reportAll(infos_total);
     }
 
 
-    void thread(ConnectionPool::Entry connection)
+    void thread(ConnectionPool::Entry connection, size_t server_index)
     {
-        Query query;
+        TimedQuery query;
 
         try
         {
@@ -280,23 +391,23 @@ private:
                         return;
                 }
 
-                execute(connection, query);
+                execute(connection, query, server_index);
                 ++queries_executed;
             }
         }
         catch (...)
         {
             shutdown = true;
-            std::cerr << "An error occurred while processing query:\n" << query << "\n";
+            std::cerr << "An error occurred while processing query:\n" << query.query << "\n";
             throw;
         }
     }
 
 
-    void execute(ConnectionPool::Entry & connection, Query & query)
+    void execute(ConnectionPool::Entry & connection, TimedQuery & query, size_t server_index)
     {
         Stopwatch watch;
-        RemoteBlockInputStream stream(*connection, query, {}, global_context, &settings, nullptr, Tables(), query_processing_stage);
+        RemoteBlockInputStream stream(*connection, query.query, {}, global_context, &settings, nullptr, Tables(), query_processing_stage);
 
         Progress progress;
         stream.setProgressCallback([&progress](const Progress & value) { progress.incrementPiecewiseAtomically(value); });
@@ -308,15 +419,37 @@ private:
 
         const BlockStreamProfileInfo & info = stream.getProfileInfo();
 
-        double seconds = watch.elapsedSeconds();
+        double seconds = query.scheduled_ns
+            ? (nowNanoseconds() - query.scheduled_ns) / 1e9
+            : watch.elapsedSeconds();
 
         std::lock_guard<std::mutex> lock(mutex);
-        info_per_interval.add(seconds, progress.rows, progress.bytes, info.rows, info.bytes);
-        info_total.add(seconds, progress.rows, progress.bytes, info.rows, info.bytes);
+
+        if (!warmup_finished)
+        {
+            if (infos_total[0]->watch.elapsedSeconds() < warmup)
+                return;     /// Discard the sample.
+
+            warmup_finished = true;
+            for (auto & total : infos_total)
+                total->clear();
+            for (auto & interval : infos_per_interval)
+                interval->clear();
+            std::cerr << "Warm-up period of " << warmup << " sec. finished.\n";
+        }
+
+        infos_per_interval[server_index]->add(seconds, progress.rows, progress.bytes, info.rows, info.bytes);
+        infos_total[server_index]->add(seconds, progress.rows, progress.bytes, info.rows, info.bytes);
     }
 
 
-    void report(Stats & info)
+    void reportAll(std::vector<std::unique_ptr<Stats>> & infos)
+    {
+        for (size_t s = 0; s < infos.size(); ++s)
+            report(*infos[s], s);
+    }
+
+    void report(Stats & info, size_t server_index)
     {
         std::lock_guard<std::mutex> lock(mutex);
 
@@ -326,6 +459,9 @@ private:
 
         double seconds = info.watch.elapsedSeconds();
 
+        if (server_descriptions.size() > 1)
+            std::cerr << "\n" << server_descriptions[server_index] << ":";
+
         std::cerr
             << "\n"
             << "QPS: " << (info.queries / seconds) << ", "
@@ -351,7 +487,39 @@ private:
         info.clear();
     }
 
-    void reportJSON(Stats & info, const std::string & filename)
+    /// When benchmarking two servers, report whether the difference of mean query times
+    /// is statistically significant (the z-test on the means; the sample counts are large).
+    void reportComparison()
+    {
+        if (infos_total.size() != 2)
+            return;
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        const Stats & lhs = *infos_total[0];
+        const Stats & rhs = *infos_total[1];
+
+        if (lhs.queries < 2 || rhs.queries < 2)
+            return;
+
+        double standard_error = sqrt(lhs.variance() / lhs.queries + rhs.variance() / rhs.queries);
+        if (standard_error == 0)
+            return;
+
+        double z = (lhs.mean() - rhs.mean()) / standard_error;
+
+        std::cerr
+            << "\n"
+            << "Comparison of mean query times: "
+            << server_descriptions[0] << " " << lhs.mean() << " sec., "
+            << server_descriptions[1] << " " << rhs.mean() << " sec. "
+            << "(" << (100.0 * (rhs.mean() - lhs.mean()) / lhs.mean()) << "% difference);"
+            << " z-score " << z << ": the difference is "
+            << (fabs(z) >= 1.96 ? "" : "NOT ")
+            << "significant at the 5% level.\n";
+    }
+
+    void reportJSON(const std::string & filename)
     {
         WriteBufferFromFile json_out(filename);
 
@@ -362,38 +530,70 @@ private:
             json_out << double_quote << key << ": " << value << (with_comma ? ",\n" : "\n");
         };
 
-        auto print_percentile = [&json_out, &info](auto percent, bool with_comma = true)
+        auto print_server = [&](Stats & info)
         {
-            json_out << "\"" << percent << "\"" << ": " << info.sampler.quantileInterpolated(percent / 100.0) << (with_comma ? ",\n" : "\n");
-        };
+            auto print_percentile = [&json_out, &info](auto percent, bool with_comma = true)
+            {
+                json_out << "\"" << percent << "\"" << ": " << info.sampler.quantileInterpolated(percent / 100.0) << (with_comma ? ",\n" : "\n");
+            };
 
-        json_out << "{\n";
+            json_out << "{\n";
 
-        json_out << double_quote << "statistics" << ": {\n";
+            json_out << double_quote << "statistics" << ": {\n";
 
-        double seconds = info.watch.elapsedSeconds();
-        print_key_value("QPS", info.queries / seconds);
-        print_key_value("RPS", info.read_rows / seconds);
-        print_key_value("MiBPS", info.read_bytes / seconds);
-        print_key_value("RPS_result", info.result_rows / seconds);
-        print_key_value("MiBPS_result", info.result_bytes / seconds);
-        print_key_value("num_queries", info.queries.load(), false);
+            double seconds = info.watch.elapsedSeconds();
+            print_key_value("QPS", info.queries / seconds);
+            print_key_value("RPS", info.read_rows / seconds);
+            print_key_value("MiBPS", info.read_bytes / seconds);
+            print_key_value("RPS_result", info.result_rows / seconds);
+            print_key_value("MiBPS_result", info.result_bytes / seconds);
+            print_key_value("num_queries", info.queries.load(), false);
 
-        json_out << "},\n";
+            json_out << "},\n";
 
-        json_out << double_quote << "query_time_percentiles" << ": {\n";
+            json_out << double_quote << "query_time_percentiles" << ": {\n";
 
-        for (int percent = 0; percent <= 90; percent += 10)
-            print_percentile(percent);
+            for (int percent = 0; percent <= 90; percent += 10)
+                print_percentile(percent);
 
-        print_percentile(95);
-        print_percentile(99);
-        print_percentile(99.9);
-        print_percentile(99.99, false);
+            print_percentile(95);
+            print_percentile(99);
+            print_percentile(99.9);
+            print_percentile(99.99, false);
+
+            json_out << "},\n";
 
-        json_out << "}\n";
+            /// The histogram of query times: upper bucket bound in microseconds -> count.
+            json_out << double_quote << "query_time_histogram_us" << ": {\n";
+
+            size_t last_nonempty = 0;
+            for (size_t i = 0; i < Stats::HISTOGRAM_BUCKETS; ++i)
+                if (info.histogram[i])
+                    last_nonempty = i;
+
+            for (size_t i = 0; i <= last_nonempty; ++i)
+                json_out << "\"" << (1ULL << i) << "\"" << ": " << info.histogram[i] << (i == last_nonempty ? "\n" : ",\n");
+
+            json_out << "}\n";
+
+            json_out << "}";
+        };
 
-        json_out << "}\n";
+        if (infos_total.size() == 1)
+        {
+            print_server(*infos_total[0]);
+            json_out << "\n";
+        }
+        else
+        {
+            json_out << "{\n" << double_quote << "servers" << ": [\n";
+            for (size_t s = 0; s < infos_total.size(); ++s)
+            {
+                print_server(*infos_total[s]);
+                json_out << (s + 1 == infos_total.size() ? "\n" : ",\n");
+            }
+            json_out << "]\n}\n";
+        }
     }
 
 public:
@@ -423,15 +623,18 @@ int mainEntryClickHouseBenchmark(int argc, char ** argv)
         boost::program_options::options_description desc("Allowed options");
         desc.add_options()
             ("help",                                                            "produce help message")
-            ("concurrency,c", value<unsigned>()->default_value(1),              "number of parallel queries")
+            ("concurrency,c", value<unsigned>()->default_value(1),              "number of parallel queries (per server)")
             ("delay,d",       value<double>()->default_value(1),                "delay between intermediate reports in seconds (set 0 to disable reports)")
             ("stage",         value<std::string>()->default_value("complete"),  "request query processing up to specified stage")
             ("iterations,i",  value<size_t>()->default_value(0),                "amount of queries to be executed")
             ("timelimit,t",   value<double>()->default_value(0.),               "stop launch of queries after specified time limit")
+            ("warmup",        value<double>()->default_value(0.),               "warm-up period in seconds, excluded from the statistics")
+            ("qps",           value<double>()->default_value(0.),               "open-loop mode: launch queries at the specified rate instead of keeping a fixed concurrency")
             ("randomize,r",   value<bool>()->default_value(false),              "randomize order of execution")
+            ("weighted,w",    value<bool>()->default_value(false),              "each input line is '<weight><TAB><query>'; queries are picked with probability proportional to weight")
             ("json",          value<std::string>()->default_value(""),          "write final report to specified file in JSON format")
-            ("host,h",        value<std::string>()->default_value("localhost"), "")
-            ("port",          value<UInt16>()->default_value(9000),             "")
+            ("host,h",        value<Strings>()->multitoken(),                   "server host; passing two hosts enables comparison mode")
+            ("port",          value<std::vector<UInt16>>()->multitoken(),       "server port (one per host)")
             ("user",          value<std::string>()->default_value("default"),   "")
             ("password",      value<std::string>()->default_value(""),          "")
             ("database",      value<std::string>()->default_value("default"),   "")
@@ -465,11 +668,21 @@ int mainEntryClickHouseBenchmark(int argc, char ** argv)
 
         UseSSL use_ssl;
 
+        Strings hosts = options.count("host") ? options["host"].as<Strings>() : Strings({"localhost"});
+
+        std::vector<UInt16> ports = options.count("port") ? options["port"].as<std::vector<UInt16>>() : std::vector<UInt16>();
+        if (ports.size() == 1 && hosts.size() > 1)
+            ports.resize(hosts.size(), ports[0]);
+        ports.resize(hosts.size(), 9000);
+
+        if (hosts.size() > 2)
+            throw Exception("At most two servers (comparison mode) are supported.", ErrorCodes::BAD_ARGUMENTS);
+
         Benchmark benchmark(
             options["concurrency"].as<unsigned>(),
             options["delay"].as<double>(),
-            options["host"].as<std::string>(),
-            options["port"].as<UInt16>(),
+            hosts,
+            ports,
             options["database"].as<std::string>(),
             options["user"].as<std::string>(),
             options["password"].as<std::string>(),
@@ -477,6 +690,9 @@ int mainEntryClickHouseBenchmark(int argc, char ** argv)
             options["randomize"].as<bool>(),
             options["iterations"].as<size_t>(),
             options["timelimit"].as<double>(),
+            options["warmup"].as<double>(),
+            options["qps"].as<double>(),
+            options["weighted"].as<bool>(),
             options["json"].as<std::string>(),
             ConnectionTimeouts::getTCPTimeoutsWithoutFailover(settings),
             settings);
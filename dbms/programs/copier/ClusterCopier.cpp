@@ -18,7 +18,7 @@
 #include <pcg_random.hpp>
 
 #include <common/logger_useful.h>
-#include <common/ThreadPool.h>
+#include <Common/ThreadPool.h>
 #include <daemon/OwnPatternFormatter.h>
 
 #include <Common/Exception.h>
@@ -60,6 +60,7 @@
 #include <DataStreams/NullBlockOutputStream.h>
 #include <IO/Operators.h>
 #include <IO/ReadBufferFromString.h>
+#include <IO/ReadHelpers.h>
 #include <Functions/registerFunctions.h>
 #include <TableFunctions/registerTableFunctions.h>
 #include <AggregateFunctions/registerAggregateFunctions.h>
@@ -180,6 +181,7 @@ struct ShardPartition
     String getActiveWorkerPath() const;
     String getPartitionShardsPath() const;
     String getShardStatusPath() const;
+    String getShardSplitsPath() const;
 
     TaskShard & task_shard;
     String name;
@@ -284,6 +286,11 @@ struct TaskTable
     String where_condition_str;
     ASTPtr where_condition_ast;
 
+    /// Each partition of each shard is copied in that many chunks selected by a hash of the sharding
+    /// key, with a per-chunk checkpoint in ZooKeeper, so an interrupted copy resumes from the next
+    /// whole chunk instead of refilling the partition.
+    size_t number_of_splits = 1;
+
     /// Resolved clusters
     ClusterPtr cluster_pull;
     ClusterPtr cluster_push;
@@ -444,6 +451,12 @@ String ShardPartition::getPartitionShardsPath() const
     return getPartitionPath() + "/shards";
 }
 
+String ShardPartition::getShardSplitsPath() const
+{
+    // /root/table_test.hits/201701/shards/1_splits
+    return getPartitionShardsPath() + "/" + toString(task_shard.numberInCluster()) + "_splits";
+}
+
 String ShardPartition::getPartitionActiveWorkersPath() const
 {
     return getPartitionPath() + "/partition_active_workers";
@@ -554,6 +567,10 @@ TaskTable::TaskTable(TaskCluster & parent, const Poco::Util::AbstractConfigurati
         engine_push_partition_key_ast = extractPartitionKey(engine_push_ast);
     }
 
+    number_of_splits = config.getUInt64(table_prefix + "number_of_splits", 1);
+    if (number_of_splits == 0)
+        throw Exception("number_of_splits must be positive", ErrorCodes::BAD_ARGUMENTS);
+
     sharding_key_str = config.getString(table_prefix + "sharding_key");
     {
         ParserExpressionWithOptionalAlias parser_expression(false);
@@ -1494,6 +1511,9 @@ protected:
         String is_dirty_flag_path = task_partition.getCommonPartitionIsDirtyPath();
         String current_task_is_active_path = task_partition.getActiveWorkerPath();
         String current_task_status_path = task_partition.getShardStatusPath();
+        String current_splits_path = task_partition.getShardSplitsPath();
+
+        const size_t number_of_splits = task_table.number_of_splits;
 
         /// Auxiliary functions:
 
@@ -1506,7 +1526,7 @@ protected:
         };
 
         /// Returns SELECT query filtering current partition and applying user filter
-        auto get_select_query = [&] (const DatabaseAndTableName & from_table, const String & fields, String limit = "")
+        auto get_select_query = [&] (const DatabaseAndTableName & from_table, const String & fields, String limit = "", String split_condition = "")
         {
             String query;
             query += "SELECT " + fields + " FROM " + getDatabaseDotTable(from_table);
@@ -1514,6 +1534,8 @@ protected:
             query += " WHERE (" + queryToString(task_table.engine_push_partition_key_ast) + " = (" + task_partition.name + " AS partition_key))";
             if (!task_table.where_condition_str.empty())
                 query += " AND (" + task_table.where_condition_str + ")";
+            if (!split_condition.empty())
+                query += " AND (" + split_condition + ")";
             if (!limit.empty())
                 query += " LIMIT " + limit;
 
@@ -1521,6 +1543,28 @@ protected:
             return parseQuery(p_query, query, 0);
         };
 
+        /// Selects the i-th of number_of_splits hash-slices of a partition.
+        auto get_split_condition = [&] (size_t split_number)
+        {
+            if (number_of_splits <= 1)
+                return String();
+            return "cityHash64(" + task_table.sharding_key_str + ") % " + toString(number_of_splits)
+                   + " = " + toString(split_number);
+        };
+
+        /// Counts rows of the current partition on the source shard (used to detect concurrent
+        /// modifications of the source data between chunks).
+        auto count_source_rows = [&] ()
+        {
+            ASTPtr query_count_ast = get_select_query(task_shard.table_read_shard, "count()");
+
+            Context local_context = context;
+            local_context.getSettingsRef() = task_cluster->settings_pull;
+
+            Block block = getBlockWithAllStreamData(InterpreterFactory::get(query_count_ast, local_context)->execute().in);
+            return (block) ? block.safeGetByPosition(0).column->getUInt(0) : UInt64(0);
+        };
+
         /// Load balancing
         auto worker_node_holder = createTaskWorkerNodeAndWaitIfNeed(zookeeper, current_task_status_path, is_unprioritized_task);
 
@@ -1561,7 +1605,10 @@ protected:
             throw;
         }
 
-        /// Exit if task has been already processed, create blocking node if it is abandoned
+        /// Exit if task has been already processed;
+        /// resume from the next whole chunk if it is abandoned between chunk checkpoints,
+        /// create blocking node otherwise
+        bool resume_from_splits = false;
         {
             String status_data;
             if (zookeeper->tryGet(current_task_status_path, status_data))
@@ -1573,11 +1620,40 @@ protected:
                     return PartitionTaskStatus::Finished;
                 }
 
-                // Task is abandoned, initialize DROP PARTITION
+                // Task is abandoned. If the previous worker died on a chunk boundary (each existing
+                // split checkpoint is Finished), the destination holds only whole chunks and the
+                // remaining ones can be copied without refilling. A dangling Started checkpoint
+                // means a partially inserted chunk, so fall back to DROP PARTITION.
                 LOG_DEBUG(log, "Task " << current_task_status_path << " has not been successfully finished by " << status.owner);
 
-                create_is_dirty_node();
-                return PartitionTaskStatus::Error;
+                Strings split_nodes;
+                if (number_of_splits > 1 && !zookeeper->tryGetChildren(current_splits_path, split_nodes))
+                {
+                    resume_from_splits = !split_nodes.empty();
+                    for (const String & node : split_nodes)
+                    {
+                        if (node == "source_rows")
+                            continue;
+
+                        TaskStateWithOwner split_status = TaskStateWithOwner::fromString(
+                            zookeeper->get(current_splits_path + "/" + node));
+                        if (split_status.state != TaskState::Finished)
+                        {
+                            resume_from_splits = false;
+                            break;
+                        }
+                    }
+                }
+
+                if (!resume_from_splits)
+                {
+                    // Initialize DROP PARTITION
+                    create_is_dirty_node();
+                    return PartitionTaskStatus::Error;
+                }
+
+                LOG_DEBUG(log, "Task " << current_task_status_path << " was interrupted on a chunk boundary,"
+                               << " resuming remaining chunks");
             }
         }
 
@@ -1618,7 +1694,8 @@ protected:
             }
         }
 
-        /// Try start processing, create node about it
+        /// Try start processing, create node about it (if resuming, the node already exists in Started state)
+        if (!resume_from_splits)
         {
             String start_state = TaskStateWithOwner::getData(TaskState::Started, host_id);
             auto op_create = zkutil::makeCreateRequest(current_task_status_path, start_state, zkutil::CreateMode::Persistent);
@@ -1651,7 +1728,7 @@ protected:
                                                  << " shards of " << task_table.cluster_push->getShardCount());
         }
 
-        /// Do the copying
+        /// Do the copying, in number_of_splits chunks with a checkpoint in ZooKeeper after each one
         {
             bool inject_fault = false;
             if (copy_fault_probability > 0)
@@ -1660,12 +1737,6 @@ protected:
                 inject_fault = value < copy_fault_probability;
             }
 
-            // Select all fields
-            ASTPtr query_select_ast = get_select_query(task_shard.table_read_shard, "*", inject_fault ? "1" : "");
-
-            LOG_DEBUG(log, "Executing SELECT query and pull from " << task_shard.getDescription()
-                           << " : " << queryToString(query_select_ast));
-
             ASTPtr query_insert_ast;
             {
                 String query;
@@ -1677,75 +1748,165 @@ protected:
                 LOG_DEBUG(log, "Executing INSERT query: " << query);
             }
 
-            try
+            /// Remember the size of the source partition before the first chunk. All chunks of a
+            /// partition must see the same source data, so the count is re-checked after the last
+            /// chunk and the partition is refilled if the source changed in between.
+            UInt64 source_rows_before = 0;
+            if (number_of_splits > 1)
             {
-                /// Custom INSERT SELECT implementation
-                Context context_select = context;
-                context_select.getSettingsRef() = task_cluster->settings_pull;
+                String source_rows_path = current_splits_path + "/source_rows";
+                String source_rows_data;
+                if (zookeeper->tryGet(source_rows_path, source_rows_data))
+                {
+                    source_rows_before = parse<UInt64>(source_rows_data);
+                }
+                else
+                {
+                    source_rows_before = count_source_rows();
+                    zookeeper->createAncestors(source_rows_path);
+                    auto code = zookeeper->tryCreate(source_rows_path, toString(source_rows_before), zkutil::CreateMode::Persistent);
+                    if (code && code != Coordination::ZNODEEXISTS)
+                        throw Coordination::Exception(code, source_rows_path);
+                    if (code == Coordination::ZNODEEXISTS)
+                        source_rows_before = parse<UInt64>(zookeeper->get(source_rows_path));
+                }
+            }
 
-                Context context_insert = context;
-                context_insert.getSettingsRef() = task_cluster->settings_push;
+            for (size_t split_number = 0; split_number < number_of_splits; ++split_number)
+            {
+                String split_status_path = current_splits_path + "/" + toString(split_number);
 
-                BlockInputStreamPtr input;
-                BlockOutputStreamPtr output;
+                if (number_of_splits > 1)
                 {
-                    BlockIO io_select = InterpreterFactory::get(query_select_ast, context_select)->execute();
-                    BlockIO io_insert = InterpreterFactory::get(query_insert_ast, context_insert)->execute();
+                    /// Skip chunks copied before an interruption
+                    String split_status_data;
+                    if (zookeeper->tryGet(split_status_path, split_status_data)
+                        && TaskStateWithOwner::fromString(split_status_data).state == TaskState::Finished)
+                    {
+                        LOG_DEBUG(log, "Chunk " << split_number << " of " << current_task_status_path
+                                       << " has been copied before, skipping");
+                        continue;
+                    }
 
-                    input = io_select.in;
-                    output = io_insert.out;
+                    /// Mark the chunk as started. If we die in the middle of its INSERT, the next worker
+                    /// sees the dangling Started node and refills the whole partition.
+                    zookeeper->createAncestors(split_status_path);
+                    zookeeper->createOrUpdate(split_status_path, TaskStateWithOwner::getData(TaskState::Started, host_id),
+                                              zkutil::CreateMode::Persistent);
                 }
 
-                std::future<Coordination::ExistsResponse> future_is_dirty_checker;
+                // Select all fields
+                ASTPtr query_select_ast = get_select_query(task_shard.table_read_shard, "*", inject_fault ? "1" : "",
+                                                           get_split_condition(split_number));
+
+                LOG_DEBUG(log, "Executing SELECT query and pull from " << task_shard.getDescription()
+                               << " : " << queryToString(query_select_ast));
 
-                Stopwatch watch(CLOCK_MONOTONIC_COARSE);
-                constexpr size_t check_period_milliseconds = 500;
+                Stopwatch chunk_watch;
 
-                /// Will asynchronously check that ZooKeeper connection and is_dirty flag appearing while copy data
-                auto cancel_check = [&] ()
+                try
                 {
-                    if (zookeeper->expired())
-                        throw Exception("ZooKeeper session is expired, cancel INSERT SELECT", ErrorCodes::UNFINISHED);
+                    /// Custom INSERT SELECT implementation
+                    Context context_select = context;
+                    context_select.getSettingsRef() = task_cluster->settings_pull;
 
-                    if (!future_is_dirty_checker.valid())
-                        future_is_dirty_checker = zookeeper->asyncExists(is_dirty_flag_path);
+                    Context context_insert = context;
+                    context_insert.getSettingsRef() = task_cluster->settings_push;
 
-                    /// check_period_milliseconds should less than average insert time of single block
-                    /// Otherwise, the insertion will slow a little bit
-                    if (watch.elapsedMilliseconds() >= check_period_milliseconds)
+                    BlockInputStreamPtr input;
+                    BlockOutputStreamPtr output;
                     {
-                        Coordination::ExistsResponse status = future_is_dirty_checker.get();
+                        BlockIO io_select = InterpreterFactory::get(query_select_ast, context_select)->execute();
+                        BlockIO io_insert = InterpreterFactory::get(query_insert_ast, context_insert)->execute();
 
-                        if (status.error != Coordination::ZNONODE)
-                            throw Exception("Partition is dirty, cancel INSERT SELECT", ErrorCodes::UNFINISHED);
+                        input = io_select.in;
+                        output = io_insert.out;
                     }
 
-                    return false;
-                };
+                    std::future<Coordination::ExistsResponse> future_is_dirty_checker;
 
-                /// Update statistics
-                /// It is quite rough: bytes_copied don't take into account DROP PARTITION.
-                auto update_stats = [&cluster_partition] (const Block & block)
-                {
-                    cluster_partition.bytes_copied += block.bytes();
-                    cluster_partition.rows_copied += block.rows();
-                    cluster_partition.blocks_copied += 1;
-                };
+                    Stopwatch watch(CLOCK_MONOTONIC_COARSE);
+                    constexpr size_t check_period_milliseconds = 500;
 
-                /// Main work is here
-                copyData(*input, *output, cancel_check, update_stats);
+                    /// Will asynchronously check that ZooKeeper connection and is_dirty flag appearing while copy data
+                    auto cancel_check = [&] ()
+                    {
+                        if (zookeeper->expired())
+                            throw Exception("ZooKeeper session is expired, cancel INSERT SELECT", ErrorCodes::UNFINISHED);
 
-                // Just in case
-                if (future_is_dirty_checker.valid())
-                    future_is_dirty_checker.get();
+                        if (!future_is_dirty_checker.valid())
+                            future_is_dirty_checker = zookeeper->asyncExists(is_dirty_flag_path);
+
+                        /// check_period_milliseconds should less than average insert time of single block
+                        /// Otherwise, the insertion will slow a little bit
+                        if (watch.elapsedMilliseconds() >= check_period_milliseconds)
+                        {
+                            Coordination::ExistsResponse status = future_is_dirty_checker.get();
 
-                if (inject_fault)
-                    throw Exception("Copy fault injection is activated", ErrorCodes::UNFINISHED);
+                            if (status.error != Coordination::ZNONODE)
+                                throw Exception("Partition is dirty, cancel INSERT SELECT", ErrorCodes::UNFINISHED);
+                        }
+
+                        return false;
+                    };
+
+                    /// Update statistics
+                    /// It is quite rough: bytes_copied don't take into account DROP PARTITION.
+                    auto update_stats = [&cluster_partition] (const Block & block)
+                    {
+                        cluster_partition.bytes_copied += block.bytes();
+                        cluster_partition.rows_copied += block.rows();
+                        cluster_partition.blocks_copied += 1;
+                    };
+
+                    /// Main work is here
+                    copyData(*input, *output, cancel_check, update_stats);
+
+                    // Just in case
+                    if (future_is_dirty_checker.valid())
+                        future_is_dirty_checker.get();
+
+                    if (inject_fault)
+                        throw Exception("Copy fault injection is activated", ErrorCodes::UNFINISHED);
+                }
+                catch (...)
+                {
+                    tryLogCurrentException(log, "An error occurred during copying, partition will be marked as dirty");
+                    return PartitionTaskStatus::Error;
+                }
+
+                if (number_of_splits > 1)
+                {
+                    zookeeper->set(split_status_path, TaskStateWithOwner::getData(TaskState::Finished, host_id));
+
+                    /// Adaptive backoff: a chunk taking much longer than the moving average means the
+                    /// source cluster is overloaded, so pause before pulling the next chunk.
+                    double elapsed_ms = chunk_watch.elapsedMilliseconds();
+                    if (chunk_latency_ewma_ms > 0 && elapsed_ms > 2 * chunk_latency_ewma_ms && split_number + 1 < number_of_splits)
+                    {
+                        UInt64 sleep_ms = std::min<UInt64>(static_cast<UInt64>(elapsed_ms - chunk_latency_ewma_ms), 30000);
+                        LOG_DEBUG(log, "Chunk " << split_number << " took " << elapsed_ms << " ms against an average of "
+                                       << chunk_latency_ewma_ms << " ms, sleeping for " << sleep_ms << " ms before the next chunk");
+                        std::this_thread::sleep_for(std::chrono::milliseconds(sleep_ms));
+                    }
+                    chunk_latency_ewma_ms = (chunk_latency_ewma_ms > 0) ? 0.75 * chunk_latency_ewma_ms + 0.25 * elapsed_ms : elapsed_ms;
+                }
             }
-            catch (...)
+
+            /// Chunks are copied at different moments, so re-check that the source partition was not
+            /// modified while we were copying it.
+            if (number_of_splits > 1)
             {
-                tryLogCurrentException(log, "An error occurred during copying, partition will be marked as dirty");
-                return PartitionTaskStatus::Error;
+                UInt64 source_rows_after = count_source_rows();
+                if (source_rows_after != source_rows_before)
+                {
+                    LOG_WARNING(log, "Source partition " << task_partition.name << " changed during copying ("
+                                     << source_rows_before << " rows before, " << source_rows_after << " rows after)"
+                                     << ". Partition will be dropped and refilled.");
+
+                    create_is_dirty_node();
+                    return PartitionTaskStatus::Error;
+                }
             }
         }
 
@@ -2034,6 +2195,10 @@ private:
     bool is_safe_mode = false;
     double copy_fault_probability = 0.0;
 
+    /// Exponential moving average of per-chunk copy latency. Used to back off between chunks
+    /// when the source cluster slows down under our load.
+    double chunk_latency_ewma_ms = 0.0;
+
     Context & context;
     Poco::Logger * log;
 
@@ -79,9 +79,12 @@ void MetricsTransmitter::transmit(std::vector<ProfileEvents::Count> & prev_count
 
     if (config.getBool(config_name + ".events", true))
     {
+        /// A snapshot also includes increments that threads have not propagated to the global counters yet.
+        const auto counters = ProfileEvents::global_counters.getPartiallyAtomicSnapshot();
+
         for (size_t i = 0, end = ProfileEvents::end(); i < end; ++i)
         {
-            const auto counter = ProfileEvents::global_counters[i].load(std::memory_order_relaxed);
+            const auto counter = counters[i].load(std::memory_order_relaxed);
             const auto counter_increment = counter - prev_counters[i];
             prev_counters[i] = counter;
 
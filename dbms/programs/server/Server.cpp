@@ -14,6 +14,8 @@
 #include <Common/ClickHouseRevision.h>
 #include <Common/DNSResolver.h>
 #include <Common/CurrentMetrics.h>
+#include <Common/IOScheduler.h>
+#include <Common/NUMA.h>
 #include <Common/Macros.h>
 #include <Common/StringUtils/StringUtils.h>
 #include <Common/ZooKeeper/ZooKeeper.h>
@@ -28,12 +30,14 @@
 #include <Interpreters/AsynchronousMetrics.h>
 #include <Interpreters/DDLWorker.h>
 #include <Interpreters/ProcessList.h>
+#include <Interpreters/ShuffleExchange.h>
 #include <Interpreters/loadMetadata.h>
 #include <Interpreters/DNSCacheUpdater.h>
 #include <Storages/StorageReplicatedMergeTree.h>
 #include <Storages/System/attachSystemTables.h>
 #include <AggregateFunctions/registerAggregateFunctions.h>
 #include <Functions/registerFunctions.h>
+#include <Functions/FunctionsUDF.h>
 #include <TableFunctions/registerTableFunctions.h>
 #include <Storages/registerStorages.h>
 #include <Common/Config/ConfigReloader.h>
@@ -109,6 +113,7 @@ int Server::main(const std::vector<std::string> & /*args*/)
     registerAggregateFunctions();
     registerTableFunctions();
     registerStorages();
+    registerUDFLibraries(config());
 
     CurrentMetrics::set(CurrentMetrics::Revision, ClickHouseRevision::get());
     CurrentMetrics::set(CurrentMetrics::VersionInteger, ClickHouseRevision::getVersionInteger());
@@ -336,6 +341,15 @@ int Server::main(const std::vector<std::string> & /*args*/)
     /// Limit on total number of concurrently executed queries.
     global_context->getProcessList().setMaxSize(config().getInt("max_concurrent_queries", 0));
 
+    /// Soft limit on total number of query processing threads. Queries are granted fewer threads under load.
+    global_context->getProcessList().setMaxThreadsSoftLimit(config().getUInt64("concurrent_threads_soft_limit", 0));
+
+    /// Limit on total disk I/O bandwidth of the server, shared between queries, merges, fetches and flushes.
+    IOScheduler::instance().setTotalBandwidth(config().getUInt64("max_disk_io_bandwidth_for_server", 0));
+
+    /// Pin query processing threads to NUMA nodes on multi-socket machines. No-op on single-node machines.
+    setNUMAThreadPlacement(config().getBool("numa_aware_thread_placement", true));
+
     /// Setup protection to avoid accidental DROP for big tables (that are greater than 50 GB by default)
     if (config().has("max_table_size_to_drop"))
         global_context->setMaxTableSizeToDrop(config().getUInt64("max_table_size_to_drop"));
@@ -344,9 +358,33 @@ int Server::main(const std::vector<std::string> & /*args*/)
         global_context->setMaxPartitionSizeToDrop(config().getUInt64("max_partition_size_to_drop"));
 
     /// Size of cache for uncompressed blocks. Zero means disabled.
+    /// The caches are sharded to avoid lock contention under many concurrent short queries.
     size_t uncompressed_cache_size = config().getUInt64("uncompressed_cache_size", 0);
     if (uncompressed_cache_size)
-        global_context->setUncompressedCache(uncompressed_cache_size);
+        global_context->setUncompressedCache(uncompressed_cache_size, config().getUInt64("uncompressed_cache_shards", 8));
+
+    /// Size of cache for compressed blocks, a tier below the cache of uncompressed blocks:
+    ///  it keeps a hot set in memory at the density of the on-disk format. Zero means disabled.
+    size_t compressed_block_cache_size = config().getUInt64("compressed_block_cache_size", 0);
+    if (compressed_block_cache_size)
+        global_context->setCompressedBlockCache(compressed_block_cache_size, config().getUInt64("compressed_block_cache_shards", 8));
+
+    /// Size of cache for complete query results. Zero means disabled.
+    /// It is used only for queries with the use_query_result_cache setting turned on.
+    size_t query_result_cache_size = config().getUInt64("query_result_cache_size", 0);
+    if (query_result_cache_size)
+        global_context->setQueryResultCache(query_result_cache_size);
+
+    /// Size of cache for materialized subqueries (IN sets and scalars). Zero means disabled.
+    /// It is used only for queries with the use_subquery_result_cache setting turned on.
+    size_t subquery_result_cache_size = config().getUInt64("subquery_result_cache_size", 0);
+    if (subquery_result_cache_size)
+        global_context->setSubqueryResultCache(subquery_result_cache_size);
+
+    /// Number of entries in the cache of parsed queries. Zero means disabled.
+    size_t query_parse_cache_size = config().getUInt64("query_parse_cache_size", 10000);
+    if (query_parse_cache_size)
+        global_context->setQueryParseCache(query_parse_cache_size);
 
     /// Load global settings from default_profile and system_profile.
     global_context->setDefaultProfiles(config());
@@ -355,7 +393,7 @@ int Server::main(const std::vector<std::string> & /*args*/)
     /// Size of cache for marks (index of MergeTree family of tables). It is necessary.
     size_t mark_cache_size = config().getUInt64("mark_cache_size");
     if (mark_cache_size)
-        global_context->setMarkCache(mark_cache_size);
+        global_context->setMarkCache(mark_cache_size, config().getUInt64("mark_cache_shards", 8));
 
 #if USE_EMBEDDED_COMPILER
     size_t compiled_expression_cache_size = config().getUInt64("compiled_expression_cache_size", std::numeric_limits<UInt64>::max());
@@ -374,6 +412,11 @@ int Server::main(const std::vector<std::string> & /*args*/)
     global_context->initializeSystemLogs();
     /// After the system database is created, attach virtual system tables (in addition to query_log and part_log)
     attachSystemTablesServer(*global_context->getDatabase("system"), has_zookeeper);
+
+    /// Start collecting query profiler samples into system.trace_log, if enabled by the trace_log config section.
+    global_context->initializeTraceCollector();
+    /// Start periodic collection of all metrics into system.metric_log, if enabled by the metric_log config section.
+    global_context->initializeMetricLog();
     /// Then, load remaining databases
     loadMetadata(*global_context);
     LOG_DEBUG(log, "Loaded metadata.");
@@ -433,6 +476,17 @@ int Server::main(const std::vector<std::string> & /*args*/)
 
         std::vector<std::unique_ptr<Poco::Net::TCPServer>> servers;
 
+        /// Peer servers push shuffle blocks (interserver exchange of temporary query data)
+        /// through the interserver HTTP port; the endpoint is global to the server.
+        InterserverIOEndpointHolderPtr shuffle_exchange_endpoint_holder;
+        if (config().has("interserver_http_port") || config().has("interserver_https_port"))
+        {
+            InterserverIOEndpointPtr shuffle_exchange_endpoint
+                = std::make_shared<ShuffleExchangeService>(global_context->getShuffleExchangeRegistry());
+            shuffle_exchange_endpoint_holder = std::make_shared<InterserverIOEndpointHolder>(
+                shuffle_exchange_endpoint->getId(""), shuffle_exchange_endpoint, global_context->getInterserverIOHandler());
+        }
+
         std::vector<std::string> listen_hosts = DB::getMultipleValuesFromConfig(config(), "", "listen_host");
 
         bool listen_try = config().getBool("listen_try", false);
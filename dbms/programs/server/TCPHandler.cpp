@@ -758,7 +758,7 @@ void TCPHandler::initBlockOutput(const Block & block)
         {
             if (state.compression == Protocol::Compression::Enable)
                 state.maybe_compressed_out = std::make_shared<CompressedWriteBuffer>(
-                    *out, CompressionSettings(query_context.getSettingsRef()));
+                    *out, CompressionSettings::forNetworkResponse(query_context.getSettingsRef()));
             else
                 state.maybe_compressed_out = out;
         }
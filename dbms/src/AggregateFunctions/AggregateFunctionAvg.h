@@ -5,6 +5,7 @@
 
 #include <DataTypes/DataTypesNumber.h>
 #include <DataTypes/DataTypesDecimal.h>
+#include <DataTypes/Native.h>
 #include <Columns/ColumnsNumber.h>
 
 #include <AggregateFunctions/IAggregateFunction.h>
@@ -21,6 +22,8 @@ namespace ErrorCodes
 template <typename T>
 struct AggregateFunctionAvgData
 {
+    using SumType = T;
+
     T sum = 0;
     UInt64 count = 0;
 
@@ -75,6 +78,20 @@ public:
         ++this->data(place).count;
     }
 
+    void addBatchSinglePlace(size_t batch_size, AggregateDataPtr place, const IColumn ** columns, Arena *) const override
+    {
+        const auto & column = static_cast<const ColVecType &>(*columns[0]);
+        const auto * ptr = column.getData().data();
+
+        /// Vectorizable: the values are reduced into a local accumulator and the state is touched once.
+        typename Data::SumType local_sum{};
+        for (size_t i = 0; i < batch_size; ++i)
+            local_sum += ptr[i];
+
+        this->data(place).sum += local_sum;
+        this->data(place).count += batch_size;
+    }
+
     void merge(AggregateDataPtr place, ConstAggregateDataPtr rhs, Arena *) const override
     {
         this->data(place).sum += this->data(rhs).sum;
@@ -101,6 +118,32 @@ public:
 
     const char * getHeaderFilePath() const override { return __FILE__; }
 
+#if USE_EMBEDDED_COMPILER
+    bool isCompilable() const override { return !IsDecimalNumber<T>; }
+
+    void compileAdd(llvm::IRBuilderBase & builder, llvm::Value * aggregate_data_ptr, const std::vector<llvm::Value *> & arguments_values) const override
+    {
+        if constexpr (!IsDecimalNumber<T>)
+        {
+            auto & b = static_cast<llvm::IRBuilder<> &>(builder);
+
+            auto sum_type = std::make_shared<DataTypeNumber<typename Data::SumType>>();
+            auto * native_sum_type = toNativeType(b, *sum_type);
+            auto * count_type = b.getInt64Ty();
+            auto * state_type = llvm::StructType::get(native_sum_type, count_type);
+            auto * state_ptr = b.CreatePointerCast(aggregate_data_ptr, state_type->getPointerTo());
+
+            auto * sum_ptr = b.CreateConstInBoundsGEP2_32(state_type, state_ptr, 0, 0);
+            auto * value = nativeCast(b, std::make_shared<DataTypeNumber<T>>(), arguments_values[0], sum_type);
+            auto * sum_value = b.CreateLoad(native_sum_type, sum_ptr);
+            b.CreateStore(native_sum_type->isFloatingPointTy() ? b.CreateFAdd(sum_value, value) : b.CreateAdd(sum_value, value), sum_ptr);
+
+            auto * count_ptr = b.CreateConstInBoundsGEP2_32(state_type, state_ptr, 0, 1);
+            b.CreateStore(b.CreateAdd(b.CreateLoad(count_type, count_ptr), b.getInt64(1)), count_ptr);
+        }
+    }
+#endif
+
 private:
     UInt32 scale;
 };
@@ -4,7 +4,9 @@
 
 #include <array>
 #include <DataTypes/DataTypesNumber.h>
+#include <DataTypes/Native.h>
 #include <Columns/ColumnNullable.h>
+#include <Columns/ColumnsCommon.h>
 #include <AggregateFunctions/IAggregateFunction.h>
 #include <IO/WriteHelpers.h>
 
@@ -40,6 +42,11 @@ public:
         ++data(place).count;
     }
 
+    void addBatchSinglePlace(size_t batch_size, AggregateDataPtr place, const IColumn **, Arena *) const override
+    {
+        data(place).count += batch_size;
+    }
+
     void merge(AggregateDataPtr place, ConstAggregateDataPtr rhs, Arena *) const override
     {
         data(place).count += data(rhs).count;
@@ -66,6 +73,19 @@ public:
         data(place).count += x;
     }
 
+#if USE_EMBEDDED_COMPILER
+    bool isCompilable() const override { return true; }
+
+    void compileAdd(llvm::IRBuilderBase & builder, llvm::Value * aggregate_data_ptr, const std::vector<llvm::Value *> &) const override
+    {
+        auto & b = static_cast<llvm::IRBuilder<> &>(builder);
+
+        auto * count_type = b.getInt64Ty();
+        auto * count_ptr = b.CreatePointerCast(aggregate_data_ptr, count_type->getPointerTo());
+        b.CreateStore(b.CreateAdd(b.CreateLoad(count_type, count_ptr), b.getInt64(1)), count_ptr);
+    }
+#endif
+
     const char * getHeaderFilePath() const override { return __FILE__; }
 };
 
@@ -92,6 +112,12 @@ public:
         data(place).count += !static_cast<const ColumnNullable &>(*columns[0]).isNullAt(row_num);
     }
 
+    void addBatchSinglePlace(size_t batch_size, AggregateDataPtr place, const IColumn ** columns, Arena *) const override
+    {
+        data(place).count += batch_size
+            - countBytesInFilter(static_cast<const ColumnNullable &>(*columns[0]).getNullMapColumn().getData());
+    }
+
     void merge(AggregateDataPtr place, ConstAggregateDataPtr rhs, Arena *) const override
     {
         data(place).count += data(rhs).count;
@@ -6,6 +6,7 @@
 #include <Columns/ColumnVector.h>
 #include <Columns/ColumnString.h>
 #include <DataTypes/IDataType.h>
+#include <DataTypes/Native.h>
 #include <common/StringRef.h>
 
 #include <AggregateFunctions/IAggregateFunction.h>
@@ -163,6 +164,41 @@ public:
     {
         return has() && static_cast<const ColumnVector<T> &>(column).getData()[row_num] == value;
     }
+
+#if USE_EMBEDDED_COMPILER
+    static constexpr bool is_compilable = !IsDecimalNumber<T>;
+
+    /// Generates code equivalent to changeIfLess/changeIfGreater over the {has_value, value} layout of this struct.
+    static void compileChangeIfBetter(llvm::IRBuilderBase & builder, llvm::Value * aggregate_data_ptr, llvm::Value * value_to_check, bool if_less)
+    {
+        if constexpr (is_compilable)
+        {
+            auto & b = static_cast<llvm::IRBuilder<> &>(builder);
+
+            auto * value_type = toNativeType(b, DataTypeNumber<T>());
+            auto * state_type = llvm::StructType::get(b.getInt8Ty(), value_type);
+            auto * state_ptr = b.CreatePointerCast(aggregate_data_ptr, state_type->getPointerTo());
+
+            auto * has_value_ptr = b.CreateConstInBoundsGEP2_32(state_type, state_ptr, 0, 0);
+            auto * value_ptr = b.CreateConstInBoundsGEP2_32(state_type, state_ptr, 0, 1);
+
+            auto * has_value = b.CreateICmpNE(b.CreateLoad(b.getInt8Ty(), has_value_ptr), b.getInt8(0));
+            auto * old_value = b.CreateLoad(value_type, value_ptr);
+
+            llvm::Value * is_better;
+            if constexpr (std::is_floating_point_v<T>)
+                is_better = if_less ? b.CreateFCmpOLT(value_to_check, old_value) : b.CreateFCmpOGT(value_to_check, old_value);
+            else if constexpr (std::is_signed_v<T>)
+                is_better = if_less ? b.CreateICmpSLT(value_to_check, old_value) : b.CreateICmpSGT(value_to_check, old_value);
+            else
+                is_better = if_less ? b.CreateICmpULT(value_to_check, old_value) : b.CreateICmpUGT(value_to_check, old_value);
+
+            auto * should_change = b.CreateOr(b.CreateNot(has_value), is_better);
+            b.CreateStore(b.CreateSelect(should_change, value_to_check, old_value), value_ptr);
+            b.CreateStore(b.getInt8(1), has_value_ptr);
+        }
+    }
+#endif
 };
 
 
@@ -381,6 +417,10 @@ public:
     {
         return has() && static_cast<const ColumnString &>(column).getDataAtWithTerminatingZero(row_num) == getStringRef();
     }
+
+#if USE_EMBEDDED_COMPILER
+    static constexpr bool is_compilable = false;
+#endif
 };
 
 static_assert(
@@ -552,6 +592,10 @@ public:
     {
         return has() && to.value == value;
     }
+
+#if USE_EMBEDDED_COMPILER
+    static constexpr bool is_compilable = false;
+#endif
 };
 
 
@@ -569,6 +613,13 @@ struct AggregateFunctionMinData : Data
     bool changeIfBetter(const Self & to, Arena * arena)                        { return this->changeIfLess(to, arena); }
 
     static const char * name() { return "min"; }
+
+#if USE_EMBEDDED_COMPILER
+    static void compileChangeIfBetter(llvm::IRBuilderBase & builder, llvm::Value * aggregate_data_ptr, llvm::Value * value_to_check)
+    {
+        Data::compileChangeIfBetter(builder, aggregate_data_ptr, value_to_check, /* if_less = */ true);
+    }
+#endif
 };
 
 template <typename Data>
@@ -580,6 +631,13 @@ struct AggregateFunctionMaxData : Data
     bool changeIfBetter(const Self & to, Arena * arena)                        { return this->changeIfGreater(to, arena); }
 
     static const char * name() { return "max"; }
+
+#if USE_EMBEDDED_COMPILER
+    static void compileChangeIfBetter(llvm::IRBuilderBase & builder, llvm::Value * aggregate_data_ptr, llvm::Value * value_to_check)
+    {
+        Data::compileChangeIfBetter(builder, aggregate_data_ptr, value_to_check, /* if_less = */ false);
+    }
+#endif
 };
 
 template <typename Data>
@@ -591,6 +649,10 @@ struct AggregateFunctionAnyData : Data
     bool changeIfBetter(const Self & to, Arena * arena)                        { return this->changeFirstTime(to, arena); }
 
     static const char * name() { return "any"; }
+
+#if USE_EMBEDDED_COMPILER
+    static constexpr bool is_compilable = false;
+#endif
 };
 
 template <typename Data>
@@ -602,6 +664,10 @@ struct AggregateFunctionAnyLastData : Data
     bool changeIfBetter(const Self & to, Arena * arena)                        { return this->changeEveryTime(to, arena); }
 
     static const char * name() { return "anyLast"; }
+
+#if USE_EMBEDDED_COMPILER
+    static constexpr bool is_compilable = false;
+#endif
 };
 
 
@@ -669,6 +735,10 @@ struct AggregateFunctionAnyHeavyData : Data
     }
 
     static const char * name() { return "anyHeavy"; }
+
+#if USE_EMBEDDED_COMPILER
+    static constexpr bool is_compilable = false;
+#endif
 };
 
 
@@ -722,6 +792,18 @@ public:
         this->data(place).insertResultInto(to);
     }
 
+#if USE_EMBEDDED_COMPILER
+    bool isCompilable() const override { return Data::is_compilable; }
+
+    void compileAdd(llvm::IRBuilderBase & builder, llvm::Value * aggregate_data_ptr, const std::vector<llvm::Value *> & arguments_values) const override
+    {
+        if constexpr (Data::is_compilable)
+            Data::compileChangeIfBetter(builder, aggregate_data_ptr, arguments_values[0]);
+        else
+            throw Exception("compileAdd is not implemented for " + getName(), ErrorCodes::NOT_IMPLEMENTED);
+    }
+#endif
+
     const char * getHeaderFilePath() const override { return __FILE__; }
 };
 
@@ -39,6 +39,12 @@ template <typename T> using FuncQuantilesTDigest = AggregateFunctionQuantile<T,
 template <typename T> using FuncQuantileTDigestWeighted = AggregateFunctionQuantile<T, QuantileTDigest<T>, NameQuantileTDigestWeighted, true, Float32, false>;
 template <typename T> using FuncQuantilesTDigestWeighted = AggregateFunctionQuantile<T, QuantileTDigest<T>, NameQuantilesTDigestWeighted, true, Float32, true>;
 
+template <typename T> using FuncQuantileDDSketch = AggregateFunctionQuantile<T, QuantileDDSketch<T>, NameQuantileDDSketch, false, Float64, false>;
+template <typename T> using FuncQuantilesDDSketch = AggregateFunctionQuantile<T, QuantileDDSketch<T>, NameQuantilesDDSketch, false, Float64, true>;
+
+template <typename T> using FuncQuantileDDSketchWeighted = AggregateFunctionQuantile<T, QuantileDDSketch<T>, NameQuantileDDSketchWeighted, true, Float64, false>;
+template <typename T> using FuncQuantilesDDSketchWeighted = AggregateFunctionQuantile<T, QuantileDDSketch<T>, NameQuantilesDDSketchWeighted, true, Float64, true>;
+
 
 template <template <typename> class Function>
 static constexpr bool SupportDecimal()
@@ -104,6 +110,12 @@ void registerAggregateFunctionsQuantile(AggregateFunctionFactory & factory)
     factory.registerFunction(NameQuantileTDigestWeighted::name, createAggregateFunctionQuantile<FuncQuantileTDigestWeighted>);
     factory.registerFunction(NameQuantilesTDigestWeighted::name, createAggregateFunctionQuantile<FuncQuantilesTDigestWeighted>);
 
+    factory.registerFunction(NameQuantileDDSketch::name, createAggregateFunctionQuantile<FuncQuantileDDSketch>);
+    factory.registerFunction(NameQuantilesDDSketch::name, createAggregateFunctionQuantile<FuncQuantilesDDSketch>);
+
+    factory.registerFunction(NameQuantileDDSketchWeighted::name, createAggregateFunctionQuantile<FuncQuantileDDSketchWeighted>);
+    factory.registerFunction(NameQuantilesDDSketchWeighted::name, createAggregateFunctionQuantile<FuncQuantilesDDSketchWeighted>);
+
     /// 'median' is an alias for 'quantile'
     factory.registerAlias("median", NameQuantile::name);
     factory.registerAlias("medianDeterministic", NameQuantileDeterministic::name);
@@ -113,6 +125,8 @@ void registerAggregateFunctionsQuantile(AggregateFunctionFactory & factory)
     factory.registerAlias("medianTimingWeighted", NameQuantileTimingWeighted::name);
     factory.registerAlias("medianTDigest", NameQuantileTDigest::name);
     factory.registerAlias("medianTDigestWeighted", NameQuantileTDigestWeighted::name);
+    factory.registerAlias("medianDDSketch", NameQuantileDDSketch::name);
+    factory.registerAlias("medianDDSketchWeighted", NameQuantileDDSketchWeighted::name);
 }
 
 }
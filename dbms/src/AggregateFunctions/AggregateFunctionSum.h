@@ -7,6 +7,7 @@
 
 #include <DataTypes/DataTypesNumber.h>
 #include <DataTypes/DataTypesDecimal.h>
+#include <DataTypes/Native.h>
 #include <Columns/ColumnVector.h>
 
 #include <AggregateFunctions/IAggregateFunction.h>
@@ -25,6 +26,16 @@ struct AggregateFunctionSumData
         sum += value;
     }
 
+    /// Vectorizable: the values are reduced into a local accumulator and the state is touched once.
+    template <typename Value>
+    void addMany(const Value * __restrict ptr, size_t count)
+    {
+        T local_sum{};
+        for (size_t i = 0; i < count; ++i)
+            local_sum += ptr[i];
+        sum += local_sum;
+    }
+
     void merge(const AggregateFunctionSumData & rhs)
     {
         sum += rhs.sum;
@@ -63,6 +74,14 @@ struct AggregateFunctionSumKahanData
         sum = new_sum;
     }
 
+    /// Kahan summation is inherently sequential, so the batch version is just a loop.
+    template <typename Value>
+    void addMany(const Value * __restrict ptr, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+            add(ptr[i]);
+    }
+
     void merge(const AggregateFunctionSumKahanData & rhs)
     {
         auto raw_sum = sum + rhs.sum;
@@ -124,6 +143,12 @@ public:
         this->data(place).add(column.getData()[row_num]);
     }
 
+    void addBatchSinglePlace(size_t batch_size, AggregateDataPtr place, const IColumn ** columns, Arena *) const override
+    {
+        const auto & column = static_cast<const ColVecType &>(*columns[0]);
+        this->data(place).addMany(column.getData().data(), batch_size);
+    }
+
     void merge(AggregateDataPtr place, ConstAggregateDataPtr rhs, Arena *) const override
     {
         this->data(place).merge(this->data(rhs));
@@ -147,6 +172,30 @@ public:
 
     const char * getHeaderFilePath() const override { return __FILE__; }
 
+#if USE_EMBEDDED_COMPILER
+    bool isCompilable() const override
+    {
+        /// Kahan summation carries a compensation term and is deliberately left interpreted.
+        return !IsDecimalNumber<T> && std::is_same_v<Data, AggregateFunctionSumData<TResult>>;
+    }
+
+    void compileAdd(llvm::IRBuilderBase & builder, llvm::Value * aggregate_data_ptr, const std::vector<llvm::Value *> & arguments_values) const override
+    {
+        if constexpr (!IsDecimalNumber<T> && std::is_same_v<Data, AggregateFunctionSumData<TResult>>)
+        {
+            auto & b = static_cast<llvm::IRBuilder<> &>(builder);
+
+            auto sum_type = std::make_shared<ResultDataType>();
+            auto * native_sum_type = toNativeType(b, *sum_type);
+            auto * sum_ptr = b.CreatePointerCast(aggregate_data_ptr, native_sum_type->getPointerTo());
+            auto * sum_value = b.CreateLoad(native_sum_type, sum_ptr);
+            auto * value = nativeCast(b, std::make_shared<DataTypeNumber<T>>(), arguments_values[0], sum_type);
+            auto * result = native_sum_type->isFloatingPointTy() ? b.CreateFAdd(sum_value, value) : b.CreateAdd(sum_value, value);
+            b.CreateStore(result, sum_ptr);
+        }
+    }
+#endif
+
 private:
     UInt32 scale;
 };
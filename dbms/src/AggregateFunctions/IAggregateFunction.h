@@ -8,11 +8,26 @@
 #include <Core/Types.h>
 #include <Core/Field.h>
 #include <Common/Exception.h>
+#include <Common/ThreadPool.h>
+#include <Common/config.h>
+
+
+namespace llvm
+{
+    class LLVMContext;
+    class Value;
+    class IRBuilderBase;
+}
 
 
 namespace DB
 {
 
+namespace ErrorCodes
+{
+    extern const int NOT_IMPLEMENTED;
+}
+
 class Arena;
 class ReadBuffer;
 class WriteBuffer;
@@ -71,9 +86,30 @@ public:
      */
     virtual void add(AggregateDataPtr place, const IColumn ** columns, size_t row_num, Arena * arena) const = 0;
 
+    /** Adds the values of all rows in [0, batch_size) into one aggregation state.
+      * This is used when the whole block maps to a single bucket (e.g. aggregation without keys):
+      *  implementations can reduce the column with a vectorizable loop before touching the state once,
+      *  instead of one `add` call per row.
+      */
+    virtual void addBatchSinglePlace(size_t batch_size, AggregateDataPtr place, const IColumn ** columns, Arena * arena) const = 0;
+
     /// Merges state (on which place points to) with other state of current aggregation function.
     virtual void merge(AggregateDataPtr place, ConstAggregateDataPtr rhs, Arena * arena) const = 0;
 
+    /** Whether the states of this function can be merged bucket-parallel in several threads
+      * (see the overload of merge with a thread pool). Used for uniqExact, whose two-level
+      * hash sets dominate the final merge of exact-dedup queries.
+      */
+    virtual bool isAbleToParallelizeMerge() const { return false; }
+
+    /// Same as merge, but may use `thread_pool` to merge parts of the states in parallel.
+    /// The state `rhs` points to is left in an unspecified mergeable state and
+    ///  must not be used afterwards other than to be destroyed.
+    virtual void merge(AggregateDataPtr place, ConstAggregateDataPtr rhs, ThreadPool & /*thread_pool*/, Arena * arena) const
+    {
+        merge(place, rhs, arena);
+    }
+
     /// Serializes state (to transmit it over the network, for example).
     virtual void serialize(ConstAggregateDataPtr place, WriteBuffer & buf) const = 0;
 
@@ -103,6 +139,22 @@ public:
     using AddFunc = void (*)(const IAggregateFunction *, AggregateDataPtr, const IColumn **, size_t, Arena *);
     virtual AddFunc getAddressOfAddFunction() const = 0;
 
+#if USE_EMBEDDED_COMPILER
+
+    /** Whether the `add` method can be compiled to native code by `compileAdd`.
+      * The compiled code updates the same memory layout that the interpreted
+      *  create/merge/serialize/insertResultInto methods work with.
+      */
+    virtual bool isCompilable() const { return false; }
+
+    /// Insert into the builder the code that adds the argument values into the state that aggregate_data_ptr (char *) points to.
+    virtual void compileAdd(llvm::IRBuilderBase & /*builder*/, llvm::Value * /*aggregate_data_ptr*/, const std::vector<llvm::Value *> & /*arguments_values*/) const
+    {
+        throw Exception("compileAdd is not implemented for " + getName(), ErrorCodes::NOT_IMPLEMENTED);
+    }
+
+#endif
+
     /** This is used for runtime code generation to determine, which header files to include in generated source.
       * Always implement it as
       * const char * getHeaderFilePath() const override { return __FILE__; }
@@ -123,6 +175,13 @@ private:
 
 public:
     AddFunc getAddressOfAddFunction() const override { return &addFree; }
+
+    /// A loop over the non-virtual `add` of the concrete function; overridden where the reduction can be vectorized.
+    void addBatchSinglePlace(size_t batch_size, AggregateDataPtr place, const IColumn ** columns, Arena * arena) const override
+    {
+        for (size_t i = 0; i < batch_size; ++i)
+            static_cast<const Derived &>(*this).add(place, columns, i, arena);
+    }
 };
 
 
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <cmath>
+#include <cstring>
+#include <Common/PODArray.h>
+#include <IO/WriteBuffer.h>
+#include <IO/ReadBuffer.h>
+#include <IO/ReadHelpers.h>
+#include <IO/WriteHelpers.h>
+#include <IO/VarInt.h>
+
+
+namespace DB
+{
+
+namespace ErrorCodes
+{
+    extern const int TOO_LARGE_ARRAY_SIZE;
+}
+
+/** Implementation of the DDSketch algorithm (https://arxiv.org/abs/1908.10693).
+  *
+  * Values are mapped to exponentially sized buckets: value x > 0 goes to bucket ceil(log(x) / log(gamma)),
+  * where gamma = (1 + alpha) / (1 - alpha). Reporting the midpoint of a bucket then guarantees
+  * a relative error of at most alpha for any quantile. Zero and negative values are tracked
+  * in a separate counter and a mirrored store, so arbitrary numeric input is accepted.
+  *
+  * Unlike t-digest, the guarantee is on the relative error of the returned value, not on the rank,
+  * which is the natural guarantee for latency SLOs ("p99 is correct to within 1%").
+  *
+  * The state is bounded: each store keeps at most max_buckets buckets, and when the spread of values
+  * exceeds that, the lowest buckets are collapsed into one. Collapsing can only degrade accuracy
+  * of the low quantiles; the high ones keep the alpha guarantee. With alpha = 0.01 a bucket covers
+  * a factor of ~1.02, so 2048 buckets span more than 17 decimal orders of magnitude before
+  * any collapsing happens. Merging is bucket-wise addition and is lossless.
+  */
+template <typename T>
+class QuantileDDSketch
+{
+    static constexpr Float64 relative_accuracy = 0.01;
+    static constexpr size_t max_buckets = 2048;
+
+    /// Counts for a contiguous range of bucket indexes [offset, offset + counts.size()).
+    struct Store
+    {
+        PODArray<UInt64, 16> counts;
+        Int64 offset = 0;
+        UInt64 total = 0;
+
+        void add(Int64 index, UInt64 cnt)
+        {
+            if (counts.empty())
+            {
+                offset = index;
+                counts.push_back(cnt);
+            }
+            else if (index < offset)
+            {
+                size_t new_size = counts.size() + (offset - index);
+                if (new_size > max_buckets)
+                {
+                    /// The new bucket is below the collapsed floor: count it in the lowest kept bucket.
+                    counts[0] += cnt;
+                }
+                else
+                {
+                    size_t old_size = counts.size();
+                    counts.resize_fill(new_size, 0);
+                    memmove(counts.data() + (new_size - old_size), counts.data(), old_size * sizeof(counts[0]));
+                    memset(counts.data(), 0, (new_size - old_size) * sizeof(counts[0]));
+                    offset = index;
+                    counts[0] += cnt;
+                }
+            }
+            else if (index >= offset + static_cast<Int64>(counts.size()))
+            {
+                size_t new_size = index - offset + 1;
+                if (new_size > max_buckets)
+                {
+                    /// Collapse the lowest buckets to make room at the top.
+                    size_t shift = new_size - max_buckets;
+                    if (shift >= counts.size())
+                    {
+                        UInt64 collapsed = 0;
+                        for (const auto & c : counts)
+                            collapsed += c;
+                        counts.assign(1, collapsed);
+                    }
+                    else
+                    {
+                        for (size_t i = 0; i < shift; ++i)
+                            counts[shift] += counts[i];
+                        memmove(counts.data(), counts.data() + shift, (counts.size() - shift) * sizeof(counts[0]));
+                        counts.resize(counts.size() - shift);
+                    }
+                    offset += shift;
+                    new_size = index - offset + 1;
+                }
+                counts.resize_fill(new_size, 0);
+                counts[index - offset] += cnt;
+            }
+            else
+                counts[index - offset] += cnt;
+
+            total += cnt;
+        }
+
+        void merge(const Store & other)
+        {
+            for (size_t i = 0; i < other.counts.size(); ++i)
+                if (other.counts[i])
+                    add(other.offset + i, other.counts[i]);
+        }
+
+        void serialize(WriteBuffer & buf) const
+        {
+            writeVarUInt(counts.size(), buf);
+            if (counts.empty())
+                return;
+            writeVarInt(offset, buf);
+            for (const auto & c : counts)
+                writeVarUInt(c, buf);
+        }
+
+        void deserialize(ReadBuffer & buf)
+        {
+            size_t size = 0;
+            readVarUInt(size, buf);
+
+            if (size > max_buckets)
+                throw Exception("Too large DDSketch store size", ErrorCodes::TOO_LARGE_ARRAY_SIZE);
+
+            counts.resize(size);
+            total = 0;
+
+            if (!size)
+                return;
+
+            readVarInt(offset, buf);
+            for (auto & c : counts)
+            {
+                readVarUInt(c, buf);
+                total += c;
+            }
+        }
+    };
+
+    Store positive;
+    Store negative;    /// Indexed by the magnitude of the value.
+    UInt64 zero_count = 0;
+
+    static Float64 gamma() { return (1 + relative_accuracy) / (1 - relative_accuracy); }
+
+    static Int64 indexForValue(Float64 x)
+    {
+        return static_cast<Int64>(std::ceil(std::log(x) / std::log(gamma())));
+    }
+
+    /// The midpoint of the bucket: within relative_accuracy of every value mapped to it.
+    static Float64 valueForIndex(Int64 index)
+    {
+        return 2 * std::pow(gamma(), index) / (1 + gamma());
+    }
+
+    template <typename ResultType>
+    ResultType getImpl(Float64 level) const
+    {
+        UInt64 total = negative.total + zero_count + positive.total;
+
+        if (!total)
+            return std::is_floating_point_v<ResultType> ? NAN : 0;
+
+        /// 0-based rank of the requested quantile; values are ordered
+        /// most negative -> zeros -> most positive.
+        UInt64 rank = static_cast<UInt64>(level * (total - 1));
+        UInt64 sum = 0;
+
+        for (size_t i = negative.counts.size(); i > 0; --i)
+        {
+            sum += negative.counts[i - 1];
+            if (sum > rank)
+                return -valueForIndex(negative.offset + i - 1);
+        }
+
+        sum += zero_count;
+        if (sum > rank)
+            return 0;
+
+        for (size_t i = 0; i < positive.counts.size(); ++i)
+        {
+            sum += positive.counts[i];
+            if (sum > rank)
+                return valueForIndex(positive.offset + i);
+        }
+
+        return valueForIndex(positive.offset + positive.counts.size() - 1);
+    }
+
+public:
+    void add(T x, UInt64 cnt = 1)
+    {
+        Float64 value = static_cast<Float64>(x);
+
+        if (value > 0)
+            positive.add(indexForValue(value), cnt);
+        else if (value < 0)
+            negative.add(indexForValue(-value), cnt);
+        else
+            zero_count += cnt;
+    }
+
+    void merge(const QuantileDDSketch & other)
+    {
+        positive.merge(other.positive);
+        negative.merge(other.negative);
+        zero_count += other.zero_count;
+    }
+
+    void serialize(WriteBuffer & buf) const
+    {
+        writeVarUInt(zero_count, buf);
+        positive.serialize(buf);
+        negative.serialize(buf);
+    }
+
+    void deserialize(ReadBuffer & buf)
+    {
+        readVarUInt(zero_count, buf);
+        positive.deserialize(buf);
+        negative.deserialize(buf);
+    }
+
+    T get(Float64 level) const
+    {
+        return getImpl<T>(level);
+    }
+
+    Float64 getFloat(Float64 level) const
+    {
+        return getImpl<Float64>(level);
+    }
+
+    void getMany(const Float64 * levels, const size_t *, size_t size, T * result) const
+    {
+        for (size_t i = 0; i < size; ++i)
+            result[i] = getImpl<T>(levels[i]);
+    }
+
+    void getManyFloat(const Float64 * levels, const size_t *, size_t size, Float64 * result) const
+    {
+        for (size_t i = 0; i < size; ++i)
+            result[i] = getImpl<Float64>(levels[i]);
+    }
+};
+
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <Common/ThreadPool.h>
+#include <IO/ReadBuffer.h>
+#include <IO/WriteBuffer.h>
+#include <IO/VarInt.h>
+
+
+namespace DB
+{
+
+/** The hash set of uniqExact. Single-level while it is the only reasonable choice,
+  *  convertible to a two-level table (256 buckets of the first level) so that large
+  *  states can be merged bucket-parallel in several threads (see the thread pool
+  *  overload of IAggregateFunction::merge).
+  *
+  * Serialization always uses the single-level format, so states are compatible with
+  *  any server version regardless of the representation they had in memory.
+  */
+template <typename SingleLevelSet, typename TwoLevelSet>
+class UniqExactSet
+{
+public:
+    using value_type = typename SingleLevelSet::value_type;
+
+    /// Below this size scheduling the bucket-parallel merge costs more than it saves.
+    static constexpr size_t min_size_for_parallel_merge = 100000;
+
+    template <typename Arg>
+    void ALWAYS_INLINE insert(const Arg & arg)
+    {
+        if (two_level)
+            two_level->insert(arg);
+        else
+            single_level.insert(arg);
+    }
+
+    size_t size() const { return two_level ? two_level->size() : single_level.size(); }
+
+    /// Sequential merge.
+    void merge(const UniqExactSet & rhs)
+    {
+        if (!two_level && !rhs.two_level)
+        {
+            single_level.merge(rhs.single_level);
+            return;
+        }
+
+        if (rhs.two_level)
+            insertAll(*rhs.two_level);
+        else
+            insertAll(rhs.single_level);
+    }
+
+    /** Merge with a thread pool: large sets are converted to the two-level representation
+      * and merged bucket-parallel. `rhs` is modified by the conversion; the caller destroys
+      * the merged-from state right afterwards, so this is harmless.
+      */
+    void merge(UniqExactSet & rhs, ThreadPool & thread_pool)
+    {
+        if (!two_level && !rhs.two_level
+            && size() < min_size_for_parallel_merge && rhs.size() < min_size_for_parallel_merge)
+        {
+            single_level.merge(rhs.single_level);
+            return;
+        }
+
+        convertToTwoLevel();
+        rhs.convertToTwoLevel();
+
+        auto & lhs_impls = two_level->impls;
+        auto & rhs_impls = rhs.two_level->impls;
+
+        for (size_t bucket = 0; bucket < TwoLevelSet::NUM_BUCKETS; ++bucket)
+            thread_pool.schedule([bucket, &lhs_impls, &rhs_impls]
+            {
+                lhs_impls[bucket].merge(rhs_impls[bucket]);
+            });
+
+        thread_pool.wait();
+    }
+
+    void write(WriteBuffer & wb) const
+    {
+        if (!two_level)
+        {
+            single_level.write(wb);
+            return;
+        }
+
+        /// The single-level format: element count, then the elements in any order.
+        writeVarUInt(two_level->size(), wb);
+        for (auto it = two_level->begin(); it != two_level->end(); ++it)
+            it.getPtr()->write(wb);
+    }
+
+    void read(ReadBuffer & rb)
+    {
+        /// Deserialization is called only for empty (just created) states, i.e. single-level ones.
+        single_level.read(rb);
+    }
+
+private:
+    SingleLevelSet single_level;
+    std::unique_ptr<TwoLevelSet> two_level;
+
+    void convertToTwoLevel()
+    {
+        if (two_level)
+            return;
+
+        two_level = std::make_unique<TwoLevelSet>(single_level);
+
+        /// The single-level table keeps its (now unused) memory until the state is destroyed.
+        /// The conversion happens only for large states during their final merge, so the
+        ///  transient overhead is acceptable.
+    }
+
+    template <typename Set>
+    void insertAll(const Set & rhs)
+    {
+        for (auto it = rhs.begin(); it != rhs.end(); ++it)
+            insert(it.getPtr()->getValue());
+    }
+};
+
+}
@@ -272,8 +272,11 @@ void Connection::forceConnected()
     {
         connect();
     }
-    else if (!ping())
+    else if (poll(0) && !ping())
     {
+        /// An idle connection must be silent. If the socket is readable, it is either EOF
+        ///  or a late packet from a previous exchange: ping drains the latter and detects the former.
+        /// A quiet socket is reused as is, saving a synchronous round trip on every checkout from the pool.
         LOG_TRACE(log_wrapper.get(), "Connection was closed, will reconnect.");
         connect();
     }
@@ -355,6 +358,8 @@ void Connection::sendQuery(
         connect();
 
     compression_settings = settings ? CompressionSettings(*settings) : CompressionSettings(CompressionMethod::LZ4);
+    skip_compression_for_loopback = settings && settings->network_compression_skip_loopback
+        && socket->peerAddress().host().isLoopback();
 
     query_id = query_id_;
 
@@ -392,7 +397,7 @@ void Connection::sendQuery(
         writeStringBinary("", *out);
 
     writeVarUInt(stage, *out);
-    writeVarUInt(static_cast<bool>(compression), *out);
+    writeVarUInt(compressionEnabled(), *out);
 
     writeStringBinary(query, *out);
 
@@ -426,7 +431,7 @@ void Connection::sendData(const Block & block, const String & name)
 
     if (!block_out)
     {
-        if (compression == Protocol::Compression::Enable)
+        if (compressionEnabled())
             maybe_compressed_out = std::make_shared<CompressedWriteBuffer>(*out, compression_settings);
         else
             maybe_compressed_out = out;
@@ -463,6 +468,23 @@ void Connection::sendPreparedData(ReadBuffer & input, size_t size, const String
 }
 
 
+void Connection::serializeBlock(const Block & block, WriteBuffer & ostr)
+{
+    std::unique_ptr<CompressedWriteBuffer> compressed_out;
+    WriteBuffer * maybe_compressed = &ostr;
+
+    if (compressionEnabled())
+    {
+        compressed_out = std::make_unique<CompressedWriteBuffer>(ostr, compression_settings);
+        maybe_compressed = compressed_out.get();
+    }
+
+    NativeBlockOutputStream block_stream(*maybe_compressed, server_revision, block.cloneEmpty());
+    block_stream.write(block);
+    maybe_compressed->next();
+}
+
+
 void Connection::sendExternalTablesData(ExternalTablesData & data)
 {
     if (data.empty())
@@ -671,7 +693,7 @@ void Connection::initBlockInput()
     {
         if (!maybe_compressed_in)
         {
-            if (compression == Protocol::Compression::Enable)
+            if (compressionEnabled())
                 maybe_compressed_in = std::make_shared<CompressedReadBuffer>(*in);
             else
                 maybe_compressed_in = in;
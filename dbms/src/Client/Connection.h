@@ -136,6 +136,14 @@ public:
     /// You could pass size of serialized/compressed block.
     void sendPreparedData(ReadBuffer & input, size_t size, const String & name = "");
 
+    /// Serialize a block exactly as sendData would put it on the wire after the packet header.
+    /// The bytes may then be sent with sendPreparedData, including over other connections
+    ///  with the same data format key (see getDataFormatKey).
+    void serializeBlock(const Block & block, WriteBuffer & ostr);
+
+    /// Connections with equal keys accept byte-identical data payloads.
+    std::pair<UInt64, bool> getDataFormatKey() const { return {server_revision, compressionEnabled()}; }
+
     /// Check, if has data to read.
     bool poll(size_t timeout_microseconds = 0);
 
@@ -206,6 +214,13 @@ private:
     Protocol::Compression compression;        /// Enable data compression for communication.
     Protocol::Secure secure;             /// Enable data encryption for communication.
 
+    /// Set per query from the network_compression_skip_loopback setting: over loopback,
+    /// copying the data through a codec costs more than the bytes it saves.
+    /// The server follows the flag sent with the query, so this disables both directions.
+    bool skip_compression_for_loopback = false;
+
+    bool compressionEnabled() const { return compression == Protocol::Compression::Enable && !skip_compression_for_loopback; }
+
     /// What compression settings to use while sending data for INSERT queries and external tables.
     CompressionSettings compression_settings;
 
@@ -31,6 +31,15 @@ public:
     /// Selects the connection to work.
     /// If force_connected is false, the client must manually ensure that returned connection is good.
     virtual Entry get(const Settings * settings = nullptr, bool force_connected = true) = 0;
+
+    /// Returns true if the entry was allocated from this pool.
+    /// Used to find the pool of a particular replica when reporting errors for it.
+    virtual bool contains(const Entry & /*entry*/) const { return false; }
+
+    /// Number of connections currently checked out from the pool.
+    /// Serves as a crude load estimate for the replica: a replica that answers slowly
+    ///  (e.g. because of background merges) holds its connections longer.
+    virtual size_t getInUseCount() const { return 0; }
 };
 
 using ConnectionPoolPtr = std::shared_ptr<IConnectionPool>;
@@ -82,6 +91,16 @@ public:
         return entry;
     }
 
+    bool contains(const Entry & entry) const override
+    {
+        return !entry.isNull() && entry.getPool() == static_cast<const Base *>(this);
+    }
+
+    size_t getInUseCount() const override
+    {
+        return Base::getInUseCount();
+    }
+
     const std::string & getHost() const
     {
         return host;
@@ -53,6 +53,10 @@ public:
     using Base = PoolWithFailoverBase<IConnectionPool>;
     using TryResult = Base::TryResult;
 
+    /// Register an error for the replica the entry was taken from,
+    /// so that the other replicas are preferred for subsequent queries.
+    using Base::reportError;
+
     /// The same as getMany(), but check that replication delay for table_to_check is acceptable.
     /// Delay threshold is taken from settings.
     std::vector<TryResult> getManyChecked(
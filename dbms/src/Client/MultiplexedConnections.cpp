@@ -1,4 +1,6 @@
 #include <Client/MultiplexedConnections.h>
+#include <IO/ReadBufferFromString.h>
+#include <IO/WriteBufferFromString.h>
 
 namespace DB
 {
@@ -63,6 +65,32 @@ void MultiplexedConnections::sendExternalTablesData(std::vector<ExternalTablesDa
     if (data.size() != active_connection_count)
         throw Exception("Mismatch between replicas and data sources", ErrorCodes::MISMATCH_REPLICAS_DATA_SOURCES);
 
+    /// With several connections, serialize and compress the payload once and send the same
+    ///  bytes to each of them, instead of re-doing that work per connection.
+    if (active_connection_count > 1 && !data.front().empty())
+    {
+        bool same_format = true;
+        Connection * first = nullptr;
+
+        for (ReplicaState & state : replica_states)
+        {
+            if (!state.connection)
+                continue;
+            if (!first)
+                first = state.connection;
+            else if (state.connection->getDataFormatKey() != first->getDataFormatKey())
+                same_format = false;
+        }
+
+        /// Connections may differ in revision or compression during rolling upgrades; then each
+        ///  of them serializes its own copy below, as before.
+        if (first && same_format)
+        {
+            sendExternalTablesDataPrepared(data.front());
+            return;
+        }
+    }
+
     auto it = data.begin();
     for (ReplicaState & state : replica_states)
     {
@@ -75,6 +103,49 @@ void MultiplexedConnections::sendExternalTablesData(std::vector<ExternalTablesDa
     }
 }
 
+void MultiplexedConnections::sendExternalTablesDataPrepared(ExternalTablesData & data)
+{
+    /// (serialized block, table name). The same bytes are valid for every connection:
+    ///  the caller has checked that they share one data format key.
+    std::vector<std::pair<std::string, std::string>> prepared_blocks;
+
+    Connection * format_connection = nullptr;
+    for (ReplicaState & state : replica_states)
+        if (state.connection)
+        {
+            format_connection = state.connection;
+            break;
+        }
+
+    for (auto & elem : data)
+    {
+        elem.first->readPrefix();
+        while (Block block = elem.first->read())
+        {
+            WriteBufferFromOwnString serialized;
+            format_connection->serializeBlock(block, serialized);
+            prepared_blocks.emplace_back(serialized.str(), elem.second);
+        }
+        elem.first->readSuffix();
+    }
+
+    for (ReplicaState & state : replica_states)
+    {
+        Connection * connection = state.connection;
+        if (!connection)
+            continue;
+
+        for (const auto & prepared : prepared_blocks)
+        {
+            ReadBufferFromString buf(prepared.first);
+            connection->sendPreparedData(buf, prepared.first.size(), prepared.second);
+        }
+
+        /// Send empty block, which means end of data transfer.
+        connection->sendData(Block());
+    }
+}
+
 void MultiplexedConnections::sendQuery(
     const String & query,
     const String & query_id,
@@ -136,6 +207,45 @@ Connection::Packet MultiplexedConnections::receivePacket()
     return packet;
 }
 
+bool MultiplexedConnections::waitForReadEvent(const Poco::Timespan & timeout)
+{
+    std::lock_guard<std::mutex> lock(cancel_mutex);
+
+    if (!sent_query || !hasActiveConnections())
+        return false;
+
+    Poco::Net::Socket::SocketList read_list;
+    read_list.reserve(active_connection_count);
+
+    for (const ReplicaState & state : replica_states)
+    {
+        Connection * connection = state.connection;
+        if (connection != nullptr)
+        {
+            /// Data already in the buffer of the connection can be read without blocking.
+            if (connection->hasReadPendingData())
+                return true;
+            read_list.push_back(*connection->socket);
+        }
+    }
+
+    Poco::Net::Socket::SocketList write_list;
+    Poco::Net::Socket::SocketList except_list;
+    return Poco::Net::Socket::select(read_list, write_list, except_list, timeout) > 0;
+}
+
+std::vector<IConnectionPool::Entry> MultiplexedConnections::getPoolEntries() const
+{
+    std::lock_guard<std::mutex> lock(cancel_mutex);
+
+    std::vector<IConnectionPool::Entry> entries;
+    entries.reserve(replica_states.size());
+    for (const ReplicaState & state : replica_states)
+        if (!state.pool_entry.isNull())
+            entries.push_back(state.pool_entry);
+    return entries;
+}
+
 BlockExtraInfo MultiplexedConnections::getBlockExtraInfo() const
 {
     if (!block_extra_info)
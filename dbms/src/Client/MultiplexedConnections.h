@@ -42,6 +42,14 @@ public:
     /// Get packet from any replica.
     Connection::Packet receivePacket();
 
+    /** Wait until any replica has data to read, but no longer than the specified timeout.
+      * Returns true if a call to receivePacket() will not block.
+      */
+    bool waitForReadEvent(const Poco::Timespan & timeout);
+
+    /// Pool entries the connections were taken from. Empty if the object was created from a ready connection.
+    std::vector<IConnectionPool::Entry> getPoolEntries() const;
+
     /// Get information about the last received packet.
     BlockExtraInfo getBlockExtraInfo() const;
 
@@ -83,6 +91,11 @@ private:
     };
 
     /// Get a replica where you can read the data.
+    /** Serialize the external tables once and send the same bytes over every connection.
+      * May be used only when all connections have the same data format key.
+      */
+    void sendExternalTablesDataPrepared(ExternalTablesData & data);
+
     ReplicaState & getReplicaForReading();
 
     /// Mark the replica as invalid.
@@ -0,0 +1,297 @@
+#include <Common/Arena.h>
+#include <Common/SipHash.h>
+#include <Columns/ColumnString.h>
+#include <Columns/ColumnStringSlice.h>
+#include <Columns/ColumnsCommon.h>
+#include <Common/typeid_cast.h>
+
+
+namespace DB
+{
+
+namespace ErrorCodes
+{
+    extern const int LOGICAL_ERROR;
+    extern const int NOT_IMPLEMENTED;
+    extern const int SIZES_OF_COLUMNS_DOESNT_MATCH;
+}
+
+
+ColumnStringSlice::ColumnStringSlice(const ColumnPtr & source_)
+    : source(source_)
+{
+    const ColumnString * source_string = typeid_cast<const ColumnString *>(source.get());
+    if (!source_string)
+        throw Exception("ColumnStringSlice can be created only from ColumnString, got " + source->getName(),
+            ErrorCodes::LOGICAL_ERROR);
+
+    size_t rows = source_string->size();
+    slices.resize(rows);
+
+    for (size_t i = 0; i < rows; ++i)
+    {
+        slices[i] = source_string->getDataAt(i);
+        total_bytes += slices[i].size;
+    }
+}
+
+
+void ColumnStringSlice::throwMustBeMaterialized(const char * method) const
+{
+    throw Exception(String("Method ") + method + " is not supported for ColumnStringSlice"
+        " (the column is read-only, materialize it into a ColumnString first)", ErrorCodes::NOT_IMPLEMENTED);
+}
+
+void ColumnStringSlice::insert(const Field &) { throwMustBeMaterialized("insert"); }
+void ColumnStringSlice::insertRangeFrom(const IColumn &, size_t, size_t) { throwMustBeMaterialized("insertRangeFrom"); }
+void ColumnStringSlice::insertData(const char *, size_t) { throwMustBeMaterialized("insertData"); }
+void ColumnStringSlice::insertDefault() { throwMustBeMaterialized("insertDefault"); }
+void ColumnStringSlice::popBack(size_t) { throwMustBeMaterialized("popBack"); }
+const char * ColumnStringSlice::deserializeAndInsertFromArena(const char *) { throwMustBeMaterialized("deserializeAndInsertFromArena"); }
+void ColumnStringSlice::gather(ColumnGathererStream &) { throwMustBeMaterialized("gather"); }
+MutableColumns ColumnStringSlice::scatter(ColumnIndex, const Selector &) const { throwMustBeMaterialized("scatter"); }
+
+
+StringRef ColumnStringSlice::serializeValueIntoArena(size_t n, Arena & arena, char const *& begin) const
+{
+    /// The same format as ColumnString: size including the terminating zero, then the bytes.
+    size_t string_size = slices[n].size + 1;
+
+    StringRef res;
+    res.size = sizeof(string_size) + string_size;
+    char * pos = arena.allocContinue(res.size, begin);
+    memcpy(pos, &string_size, sizeof(string_size));
+    memcpy(pos + sizeof(string_size), slices[n].data, string_size);
+    res.data = pos;
+
+    return res;
+}
+
+
+void ColumnStringSlice::updateHashWithValue(size_t n, SipHash & hash) const
+{
+    /// Hashes the same bytes as ColumnString, so that the columns are interchangeable in hashing.
+    size_t string_size = slices[n].size + 1;
+
+    hash.update(reinterpret_cast<const char *>(&string_size), sizeof(string_size));
+    hash.update(slices[n].data, string_size);
+}
+
+
+MutableColumnPtr ColumnStringSlice::cloneResized(size_t to_size) const
+{
+    if (to_size > size())
+        throw Exception("Cannot grow ColumnStringSlice in cloneResized (the column is read-only)",
+            ErrorCodes::NOT_IMPLEMENTED);
+
+    auto res = ColumnStringSlice::create(source, true);
+    res->slices.assign(slices.begin(), slices.begin() + to_size);
+    for (size_t i = 0; i < to_size; ++i)
+        res->total_bytes += res->slices[i].size;
+
+    return res;
+}
+
+
+IColumn::Ptr ColumnStringSlice::cut(size_t start, size_t length) const
+{
+    /// The default implementation is insertRangeFrom into an empty column, which is not supported here.
+    auto res = ColumnStringSlice::create(source, true);
+
+    res->slices.assign(slices.begin() + start, slices.begin() + start + length);
+    for (size_t i = 0; i < length; ++i)
+        res->total_bytes += res->slices[i].size;
+
+    return res;
+}
+
+
+ColumnPtr ColumnStringSlice::filter(const Filter & filt, ssize_t result_size_hint) const
+{
+    size_t rows = slices.size();
+    if (rows != filt.size())
+        throw Exception("Size of filter doesn't match size of column.", ErrorCodes::SIZES_OF_COLUMNS_DOESNT_MATCH);
+
+    auto res = ColumnStringSlice::create(source, true);
+
+    if (result_size_hint)
+        res->slices.reserve(result_size_hint > 0 ? result_size_hint : rows);
+
+    for (size_t i = 0; i < rows; ++i)
+    {
+        if (filt[i])
+        {
+            res->slices.push_back(slices[i]);
+            res->total_bytes += slices[i].size;
+        }
+    }
+
+    return res;
+}
+
+
+ColumnPtr ColumnStringSlice::permute(const Permutation & perm, size_t limit) const
+{
+    size_t rows = slices.size();
+
+    if (limit == 0)
+        limit = rows;
+    else
+        limit = std::min(rows, limit);
+
+    if (perm.size() < limit)
+        throw Exception("Size of permutation is less than required.", ErrorCodes::SIZES_OF_COLUMNS_DOESNT_MATCH);
+
+    auto res = ColumnStringSlice::create(source, true);
+    res->slices.resize(limit);
+
+    for (size_t i = 0; i < limit; ++i)
+    {
+        res->slices[i] = slices[perm[i]];
+        res->total_bytes += res->slices[i].size;
+    }
+
+    return res;
+}
+
+
+ColumnPtr ColumnStringSlice::index(const IColumn & indexes, size_t limit) const
+{
+    return selectIndexImpl(*this, indexes, limit);
+}
+
+
+template <typename Type>
+ColumnPtr ColumnStringSlice::indexImpl(const PaddedPODArray<Type> & indexes, size_t limit) const
+{
+    if (limit == 0)
+        limit = indexes.size();
+
+    auto res = ColumnStringSlice::create(source, true);
+    res->slices.resize(limit);
+
+    for (size_t i = 0; i < limit; ++i)
+    {
+        res->slices[i] = slices[indexes[i]];
+        res->total_bytes += res->slices[i].size;
+    }
+
+    return res;
+}
+
+
+template <bool positive>
+struct ColumnStringSlice::less
+{
+    const ColumnStringSlice & parent;
+    explicit less(const ColumnStringSlice & parent_) : parent(parent_) {}
+    bool operator()(size_t lhs, size_t rhs) const
+    {
+        int res = parent.compareAt(lhs, rhs, parent, 0);
+        return positive ? (res < 0) : (res > 0);
+    }
+};
+
+
+void ColumnStringSlice::getPermutation(bool reverse, size_t limit, int /*nan_direction_hint*/, Permutation & res) const
+{
+    size_t rows = slices.size();
+    res.resize(rows);
+    for (size_t i = 0; i < rows; ++i)
+        res[i] = i;
+
+    if (limit >= rows)
+        limit = 0;
+
+    if (limit)
+    {
+        if (reverse)
+            std::partial_sort(res.begin(), res.begin() + limit, res.end(), less<false>(*this));
+        else
+            std::partial_sort(res.begin(), res.begin() + limit, res.end(), less<true>(*this));
+    }
+    else
+    {
+        if (reverse)
+            std::sort(res.begin(), res.end(), less<false>(*this));
+        else
+            std::sort(res.begin(), res.end(), less<true>(*this));
+    }
+}
+
+
+ColumnPtr ColumnStringSlice::replicate(const Offsets & replicate_offsets) const
+{
+    size_t rows = slices.size();
+    if (rows != replicate_offsets.size())
+        throw Exception("Size of offsets doesn't match size of column.", ErrorCodes::SIZES_OF_COLUMNS_DOESNT_MATCH);
+
+    auto res = ColumnStringSlice::create(source, true);
+
+    if (0 == rows)
+        return res;
+
+    res->slices.reserve(replicate_offsets.back());
+
+    Offset prev_offset = 0;
+    for (size_t i = 0; i < rows; ++i)
+    {
+        size_t size_to_replicate = replicate_offsets[i] - prev_offset;
+        prev_offset = replicate_offsets[i];
+
+        for (size_t j = 0; j < size_to_replicate; ++j)
+        {
+            res->slices.push_back(slices[i]);
+            res->total_bytes += slices[i].size;
+        }
+    }
+
+    return res;
+}
+
+
+void ColumnStringSlice::getExtremes(Field & min, Field & max) const
+{
+    min = String();
+    max = String();
+
+    size_t col_size = size();
+
+    if (col_size == 0)
+        return;
+
+    size_t min_idx = 0;
+    size_t max_idx = 0;
+
+    less<true> less_op(*this);
+
+    for (size_t i = 1; i < col_size; ++i)
+    {
+        if (less_op(i, min_idx))
+            min_idx = i;
+        else if (less_op(max_idx, i))
+            max_idx = i;
+    }
+
+    get(min_idx, min);
+    get(max_idx, max);
+}
+
+
+MutableColumnPtr ColumnStringSlice::materialize() const
+{
+    auto res = ColumnString::create();
+
+    res->getChars().reserve(total_bytes + slices.size());
+    res->getOffsets().reserve(slices.size());
+
+    for (const auto & slice : slices)
+        res->insertDataWithTerminatingZero(slice.data, slice.size + 1);
+
+    return res;
+}
+
+
+INSTANTIATE_INDEX_IMPL(ColumnStringSlice)
+
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <string.h>
+
+#include <Columns/IColumn.h>
+#include <Common/PODArray.h>
+#include <common/StringRef.h>
+
+
+namespace DB
+{
+
+/** A read-only column of String values that does not own the string bytes.
+  * It stores StringRef slices pointing into the chars of a source ColumnString,
+  *  which is kept alive by a shared pointer.
+  *
+  * The point is that filter/permute/replicate only move 16-byte references around
+  *  instead of copying the string bytes, which matters when the strings are long and
+  *  a column goes through several filtering steps before it is output.
+  * The string bytes are copied once, at the end, by materialize().
+  *
+  * The column cannot be appended to: all mutating methods throw.
+  */
+class ColumnStringSlice final : public COWPtrHelper<IColumn, ColumnStringSlice>
+{
+public:
+    using Slices = PaddedPODArray<StringRef>;
+
+private:
+    friend class COWPtrHelper<IColumn, ColumnStringSlice>;
+
+    /// References into the chars of the source column.
+    /// Sizes do not include the terminating zero byte, but it is always there,
+    ///  because the source is a ColumnString.
+    Slices slices;
+
+    /// Keeps the referenced bytes alive.
+    ColumnPtr source;
+
+    /// Sum of the sizes of the slices - for byteSize.
+    size_t total_bytes = 0;
+
+    /// The source must be a ColumnString.
+    explicit ColumnStringSlice(const ColumnPtr & source_);
+
+    /// An empty column over the bytes of the same (already checked) source. For filter/permute/etc.
+    ColumnStringSlice(const ColumnPtr & source_, bool /*empty*/) : source(source_) {}
+
+    ColumnStringSlice(const ColumnStringSlice & src)
+        : slices(src.slices.begin(), src.slices.end()), source(src.source), total_bytes(src.total_bytes) {}
+
+    template <bool positive>
+    struct less;
+
+    [[noreturn]] void throwMustBeMaterialized(const char * method) const;
+
+public:
+    const char * getFamilyName() const override { return "StringSlice"; }
+
+    size_t size() const override { return slices.size(); }
+
+    size_t byteSize() const override
+    {
+        return total_bytes + slices.size() * sizeof(slices[0]);
+    }
+
+    size_t allocatedBytes() const override
+    {
+        /// The string bytes are shared with the source column and are not accounted here.
+        return slices.allocated_bytes();
+    }
+
+    Field operator[](size_t n) const override
+    {
+        return Field(slices[n].data, slices[n].size);
+    }
+
+    void get(size_t n, Field & res) const override
+    {
+        res.assignString(slices[n].data, slices[n].size);
+    }
+
+    StringRef getDataAt(size_t n) const override
+    {
+        return slices[n];
+    }
+
+    StringRef getDataAtWithTerminatingZero(size_t n) const override
+    {
+        return StringRef(slices[n].data, slices[n].size + 1);
+    }
+
+    void insert(const Field &) override;
+    void insertRangeFrom(const IColumn &, size_t, size_t) override;
+    void insertData(const char *, size_t) override;
+    void insertDefault() override;
+    void popBack(size_t) override;
+    const char * deserializeAndInsertFromArena(const char *) override;
+    void gather(ColumnGathererStream &) override;
+    MutableColumns scatter(ColumnIndex, const Selector &) const override;
+
+    StringRef serializeValueIntoArena(size_t n, Arena & arena, char const *& begin) const override;
+
+    void updateHashWithValue(size_t n, SipHash & hash) const override;
+
+    MutableColumnPtr cloneResized(size_t to_size) const override;
+
+    Ptr cut(size_t start, size_t length) const override;
+
+    ColumnPtr filter(const Filter & filt, ssize_t result_size_hint) const override;
+
+    ColumnPtr permute(const Permutation & perm, size_t limit) const override;
+
+    ColumnPtr index(const IColumn & indexes, size_t limit) const override;
+
+    template <typename Type>
+    ColumnPtr indexImpl(const PaddedPODArray<Type> & indexes, size_t limit) const;
+
+    int compareAt(size_t n, size_t m, const IColumn & rhs_, int /*nan_direction_hint*/) const override
+    {
+        const ColumnStringSlice & rhs = static_cast<const ColumnStringSlice &>(rhs_);
+
+        const StringRef lhs_slice = slices[n];
+        const StringRef rhs_slice = rhs.slices[m];
+
+        int cmp = memcmp(lhs_slice.data, rhs_slice.data, std::min(lhs_slice.size, rhs_slice.size));
+
+        if (cmp != 0)
+            return cmp;
+        else
+            return lhs_slice.size > rhs_slice.size ? 1 : (lhs_slice.size < rhs_slice.size ? -1 : 0);
+    }
+
+    void getPermutation(bool reverse, size_t limit, int nan_direction_hint, Permutation & res) const override;
+
+    ColumnPtr replicate(const Offsets & replicate_offsets) const override;
+
+    void getExtremes(Field & min, Field & max) const override;
+
+    void reserve(size_t n) override { slices.reserve(n); }
+
+    /// Copies the referenced bytes into a regular ColumnString.
+    MutableColumnPtr materialize() const;
+};
+
+}
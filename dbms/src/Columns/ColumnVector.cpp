@@ -2,11 +2,14 @@
 
 #include <cstring>
 #include <cmath>
+#include <limits>
 #include <common/unaligned.h>
 #include <Common/Exception.h>
 #include <Common/Arena.h>
 #include <Common/SipHash.h>
 #include <Common/NaNUtils.h>
+#include <Common/CpuFeatures.h>
+#include <Common/RadixSort.h>
 #include <IO/WriteBuffer.h>
 #include <IO/WriteHelpers.h>
 #include <Columns/ColumnsCommon.h>
@@ -19,6 +22,10 @@
 
 #endif
 
+#if defined(__GNUC__) && defined(__x86_64__)
+    #include <immintrin.h>
+#endif
+
 
 namespace DB
 {
@@ -69,6 +76,32 @@ struct ColumnVector<T>::greater
     bool operator()(size_t lhs, size_t rhs) const { return CompareHelper<T>::greater(parent.data[lhs], parent.data[rhs], nan_direction_hint); }
 };
 
+/// An element with the payload for sorting a permutation by radix sort.
+template <typename T>
+struct ValueWithIndex
+{
+    T value;
+    UInt32 index;
+};
+
+template <typename T>
+struct PermutationRadixSortTraits
+{
+    using Element = ValueWithIndex<T>;
+    using Key = T;
+    using CountType = UInt32;
+    using KeyBits = std::make_unsigned_t<T>;
+
+    static constexpr size_t PART_SIZE_BITS = 8;
+
+    using Transform = std::conditional_t<std::is_signed_v<T>,
+        RadixSortSignedTransform<KeyBits>,
+        RadixSortIdentityTransform<KeyBits>>;
+    using Allocator = RadixSortMallocAllocator;
+
+    static Key & extractKey(Element & elem) { return elem.value; }
+};
+
 template <typename T>
 void ColumnVector<T>::getPermutation(bool reverse, size_t limit, int nan_direction_hint, IColumn::Permutation & res) const
 {
@@ -89,6 +122,31 @@ void ColumnVector<T>::getPermutation(bool reverse, size_t limit, int nan_directi
     }
     else
     {
+        /// For full sorts of integer keys, a comparison-free LSD radix sort over (value, index)
+        ///  pairs is substantially faster than comparison sorting of the permutation.
+        /// Floats are left out: radix order of NaNs does not respect nan_direction_hint.
+        if constexpr (std::is_integral_v<T>)
+        {
+            if (s >= 256 && s <= std::numeric_limits<UInt32>::max())
+            {
+                PaddedPODArray<ValueWithIndex<T>> pairs(s);
+                for (UInt32 i = 0; i < UInt32(s); ++i)
+                    pairs[i] = {data[i], i};
+
+                RadixSort<PermutationRadixSortTraits<T>>::execute(pairs.data(), s);
+
+                for (size_t i = 0; i < s; ++i)
+                    res[i] = pairs[i].index;
+
+                /// Radix sort is ascending; for descending order, reverse the permutation.
+                /// (getPermutation gives no stability guarantee, so the order of equal elements may change.)
+                if (reverse)
+                    std::reverse(res.begin(), res.end());
+
+                return;
+            }
+        }
+
         if (reverse)
             std::sort(res.begin(), res.end(), greater(*this, nan_direction_hint));
         else
@@ -145,6 +203,48 @@ void ColumnVector<T>::insertRangeFrom(const IColumn & src, size_t start, size_t
     memcpy(&data[old_size], &src_vec.data[start], length * sizeof(data[0]));
 }
 
+#if defined(__GNUC__) && defined(__x86_64__)
+
+/** The same loop as the SSE2 one below, over 32-byte chunks of the filter, and with jumping
+  *  between the set bits of the mask instead of checking every byte for partial chunks.
+  * Compiled with the AVX2 target attribute and called only when the CPU supports AVX2,
+  *  because the binary itself targets only SSE. Consumes the longest prefix of the filter
+  *  that is a multiple of 32 bytes and advances the positions accordingly.
+  */
+template <typename T, typename Container>
+__attribute__((target("avx2"))) static void filterImplAVX2(
+    const UInt8 *& filt_pos, const T *& data_pos, Container & res_data, size_t size)
+{
+    static constexpr size_t SIMD_BYTES = 32;
+    const __m256i zero32 = _mm256_setzero_si256();
+    const UInt8 * filt_end_avx = filt_pos + size / SIMD_BYTES * SIMD_BYTES;
+
+    while (filt_pos < filt_end_avx)
+    {
+        UInt32 mask = static_cast<UInt32>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(filt_pos)), zero32)));
+
+        if (0 == mask)
+        {
+            /// Nothing is inserted.
+        }
+        else if (0xFFFFFFFF == mask)
+        {
+            res_data.insert(data_pos, data_pos + SIMD_BYTES);
+        }
+        else
+        {
+            for (; mask != 0; mask &= mask - 1)
+                res_data.push_back(data_pos[__builtin_ctz(mask)]);
+        }
+
+        filt_pos += SIMD_BYTES;
+        data_pos += SIMD_BYTES;
+    }
+}
+
+#endif
+
 template <typename T>
 ColumnPtr ColumnVector<T>::filter(const IColumn::Filter & filt, ssize_t result_size_hint) const
 {
@@ -162,6 +262,12 @@ ColumnPtr ColumnVector<T>::filter(const IColumn::Filter & filt, ssize_t result_s
     const UInt8 * filt_end = filt_pos + size;
     const T * data_pos = data.data();
 
+#if defined(__GNUC__) && defined(__x86_64__)
+    /// The kernel is dispatched at run time, because the binary itself targets only SSE.
+    if (haveAVX2())
+        filterImplAVX2(filt_pos, data_pos, res_data, size);
+#endif
+
 #if __SSE2__
     /** A slightly more optimized version.
         * Based on the assumption that often pieces of consecutive values
@@ -171,11 +277,11 @@ ColumnPtr ColumnVector<T>::filter(const IColumn::Filter & filt, ssize_t result_s
 
     static constexpr size_t SIMD_BYTES = 16;
     const __m128i zero16 = _mm_setzero_si128();
-    const UInt8 * filt_end_sse = filt_pos + size / SIMD_BYTES * SIMD_BYTES;
+    const UInt8 * filt_end_sse = filt_pos + (filt_end - filt_pos) / SIMD_BYTES * SIMD_BYTES;
 
     while (filt_pos < filt_end_sse)
     {
-        int mask = _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(filt_pos)), zero16));
+        UInt16 mask = static_cast<UInt16>(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(filt_pos)), zero16)));
 
         if (0 == mask)
         {
@@ -187,9 +293,9 @@ ColumnPtr ColumnVector<T>::filter(const IColumn::Filter & filt, ssize_t result_s
         }
         else
         {
-            for (size_t i = 0; i < SIMD_BYTES; ++i)
-                if (filt_pos[i])
-                    res_data.push_back(data_pos[i]);
+            /// Instead of checking every byte, jump between the set bits of the mask.
+            for (; mask != 0; mask &= mask - 1)
+                res_data.push_back(data_pos[__builtin_ctz(mask)]);
         }
 
         filt_pos += SIMD_BYTES;
@@ -2,8 +2,13 @@
     #include <emmintrin.h>
 #endif
 
+#if defined(__GNUC__) && defined(__x86_64__)
+    #include <immintrin.h>
+#endif
+
 #include <Columns/IColumn.h>
 #include <Common/typeid_cast.h>
+#include <Common/CpuFeatures.h>
 #include <Columns/ColumnVector.h>
 #include <Common/HashTable/HashSet.h>
 #include <Common/HashTable/HashMap.h>
@@ -12,7 +17,7 @@
 namespace DB
 {
 
-size_t countBytesInFilter(const IColumn::Filter & filt)
+size_t countBytesInFilter(const UInt8 * filt, size_t size)
 {
     size_t count = 0;
 
@@ -21,12 +26,12 @@ size_t countBytesInFilter(const IColumn::Filter & filt)
       * It would be better to use != 0, then this does not allow SSE2.
       */
 
-    const Int8 * pos = reinterpret_cast<const Int8 *>(filt.data());
-    const Int8 * end = pos + filt.size();
+    const Int8 * pos = reinterpret_cast<const Int8 *>(filt);
+    const Int8 * end = pos + size;
 
 #if __SSE2__ && __POPCNT__
     const __m128i zero16 = _mm_setzero_si128();
-    const Int8 * end64 = pos + filt.size() / 64 * 64;
+    const Int8 * end64 = pos + size / 64 * 64;
 
     for (; pos < end64; pos += 64)
         count += __builtin_popcountll(
@@ -52,6 +57,11 @@ size_t countBytesInFilter(const IColumn::Filter & filt)
     return count;
 }
 
+size_t countBytesInFilter(const IColumn::Filter & filt)
+{
+    return countBytesInFilter(filt.data(), filt.size());
+}
+
 std::vector<size_t> countColumnsSizeInSelector(IColumn::ColumnIndex num_columns, const IColumn::Selector & selector)
 {
     std::vector<size_t> counts(num_columns);
@@ -174,6 +184,60 @@ namespace
     };
 
 
+#if defined(__GNUC__) && defined(__x86_64__)
+    /** The same loop as the SSE2 one in filterArraysImplGeneric, over 32-byte chunks of the filter.
+      * Compiled with the AVX2 target attribute and called only when the CPU supports AVX2,
+      *  because the binary itself targets only SSE. Consumes the longest prefix of the filter
+      *  that is a multiple of 32 bytes and advances the positions accordingly.
+      */
+    template <typename T, typename ResultOffsetsBuilder, typename CopyArray>
+    __attribute__((target("avx2"))) void filterArraysImplAVX2(
+        const PaddedPODArray<T> & src_elems, PaddedPODArray<T> & res_elems,
+        ResultOffsetsBuilder & result_offsets_builder,
+        const UInt8 *& filt_pos, const IColumn::Offset *& offsets_pos,
+        const IColumn::Offset * offsets_begin, size_t size, CopyArray && copy_array)
+    {
+        static constexpr size_t SIMD_BYTES = 32;
+        const __m256i zero_vec = _mm256_setzero_si256();
+        const UInt8 * filt_end_aligned = filt_pos + size / SIMD_BYTES * SIMD_BYTES;
+
+        while (filt_pos < filt_end_aligned)
+        {
+            UInt32 mask = static_cast<UInt32>(_mm256_movemask_epi8(_mm256_cmpgt_epi8(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i *>(filt_pos)), zero_vec)));
+
+            if (mask == 0)
+            {
+                /// SIMD_BYTES consecutive rows do not pass the filter
+            }
+            else if (mask == 0xFFFFFFFF)
+            {
+                /// SIMD_BYTES consecutive rows pass the filter
+                const auto first = offsets_pos == offsets_begin;
+
+                const auto chunk_offset = first ? 0 : offsets_pos[-1];
+                const auto chunk_size = offsets_pos[SIMD_BYTES - 1] - chunk_offset;
+
+                result_offsets_builder.template insertChunk<SIMD_BYTES>(offsets_pos, first, chunk_offset, chunk_size);
+
+                /// copy elements for SIMD_BYTES arrays at once
+                const auto elems_size_old = res_elems.size();
+                res_elems.resize(elems_size_old + chunk_size);
+                memcpy(&res_elems[elems_size_old], &src_elems[chunk_offset], chunk_size * sizeof(T));
+            }
+            else
+            {
+                /// Instead of checking every byte, jump between the set bits of the mask.
+                for (; mask != 0; mask &= mask - 1)
+                    copy_array(offsets_pos + __builtin_ctz(mask));
+            }
+
+            filt_pos += SIMD_BYTES;
+            offsets_pos += SIMD_BYTES;
+        }
+    }
+#endif
+
     template <typename T, typename ResultOffsetsBuilder>
     void filterArraysImplGeneric(
         const PaddedPODArray<T> & src_elems, const IColumn::Offsets & src_offsets,
@@ -215,10 +279,16 @@ namespace
             memcpy(&res_elems[elems_size_old], &src_elems[offset], size * sizeof(T));
         };
 
+    #if defined(__GNUC__) && defined(__x86_64__)
+        /// The kernel is dispatched at run time, because the binary itself targets only SSE.
+        if (haveAVX2())
+            filterArraysImplAVX2(src_elems, res_elems, result_offsets_builder, filt_pos, offsets_pos, offsets_begin, size, copy_array);
+    #endif
+
     #if __SSE2__
         const __m128i zero_vec = _mm_setzero_si128();
         static constexpr size_t SIMD_BYTES = 16;
-        const auto filt_end_aligned = filt_pos + size / SIMD_BYTES * SIMD_BYTES;
+        const auto filt_end_aligned = filt_pos + (filt_end - filt_pos) / SIMD_BYTES * SIMD_BYTES;
 
         while (filt_pos < filt_end_aligned)
         {
@@ -247,9 +317,9 @@ namespace
             }
             else
             {
-                for (size_t i = 0; i < SIMD_BYTES; ++i)
-                    if (filt_pos[i])
-                        copy_array(offsets_pos + i);
+                /// Instead of checking every byte, jump between the set bits of the mask.
+                for (UInt16 bits = mask; bits != 0; bits &= bits - 1)
+                    copy_array(offsets_pos + __builtin_ctz(bits));
             }
 
             filt_pos += SIMD_BYTES;
@@ -14,6 +14,7 @@ namespace ErrorCodes
 }
 
 /// Counts how many bytes of `filt` are greater than zero.
+size_t countBytesInFilter(const UInt8 * filt, size_t size);
 size_t countBytesInFilter(const IColumn::Filter & filt);
 
 /// Returns vector with num_columns elements. vector[i] is the count of i values in selector.
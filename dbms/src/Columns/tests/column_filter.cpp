@@ -0,0 +1,94 @@
+#include <iostream>
+#include <iomanip>
+#include <random>
+
+#include <Common/Stopwatch.h>
+#include <Common/typeid_cast.h>
+#include <Common/CpuFeatures.h>
+#include <Columns/ColumnsNumber.h>
+#include <Columns/ColumnArray.h>
+#include <Columns/ColumnsCommon.h>
+
+
+/** Microbenchmark of the filter implementations (ColumnVector::filter and filterArraysImpl),
+  *  to track regressions in the SIMD kernels: the time to filter a numeric column
+  *  and an array column with masks of different selectivity.
+  * The first argument is the number of rows, the second is the number of iterations.
+  */
+
+int main(int argc, char ** argv)
+{
+    using namespace DB;
+
+    size_t n = argc >= 2 ? std::stoull(argv[1]) : 10000000;
+    size_t iterations = argc >= 3 ? std::stoull(argv[2]) : 10;
+
+    std::cerr << (haveAVX2() ? "Using AVX2 kernels.\n" : "Using SSE2 kernels.\n");
+
+    auto vec_column = ColumnUInt64::create();
+    {
+        auto & data = vec_column->getData();
+        data.resize(n);
+        for (size_t i = 0; i < n; ++i)
+            data[i] = i;
+    }
+
+    /// Arrays of 0 to 4 elements.
+    auto array_column = ColumnArray::create(ColumnUInt64::create());
+    {
+        auto & data = typeid_cast<ColumnUInt64 &>(array_column->getData()).getData();
+        auto & offsets = array_column->getOffsets();
+        offsets.resize(n);
+        IColumn::Offset current_offset = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            size_t array_size = i % 5;
+            for (size_t j = 0; j < array_size; ++j)
+                data.push_back(i + j);
+            current_offset += array_size;
+            offsets[i] = current_offset;
+        }
+    }
+
+    std::mt19937 rng(0);
+
+    for (double selectivity : {0.01, 0.1, 0.5, 0.9, 0.99})
+    {
+        IColumn::Filter filt(n);
+        std::bernoulli_distribution dist(selectivity);
+        for (size_t i = 0; i < n; ++i)
+            filt[i] = dist(rng);
+
+        {
+            Stopwatch watch;
+            size_t res_rows = 0;
+
+            for (size_t i = 0; i < iterations; ++i)
+                res_rows += vec_column->filter(filt, -1)->size();
+
+            watch.stop();
+            std::cerr << std::fixed << std::setprecision(3)
+                << "ColumnVector,  selectivity " << selectivity
+                << ": " << watch.elapsedSeconds() << " sec., "
+                << n * iterations / watch.elapsedSeconds() / 1000000 << " million rows/sec., "
+                << res_rows << " rows passed\n";
+        }
+
+        {
+            Stopwatch watch;
+            size_t res_rows = 0;
+
+            for (size_t i = 0; i < iterations; ++i)
+                res_rows += array_column->filter(filt, -1)->size();
+
+            watch.stop();
+            std::cerr << std::fixed << std::setprecision(3)
+                << "ColumnArray,   selectivity " << selectivity
+                << ": " << watch.elapsedSeconds() << " sec., "
+                << n * iterations / watch.elapsedSeconds() / 1000000 << " million rows/sec., "
+                << res_rows << " rows passed\n";
+        }
+    }
+
+    return 0;
+}
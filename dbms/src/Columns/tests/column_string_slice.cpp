@@ -0,0 +1,93 @@
+#include <iostream>
+#include <iomanip>
+#include <random>
+
+#include <Common/Stopwatch.h>
+#include <Common/typeid_cast.h>
+#include <Columns/ColumnString.h>
+#include <Columns/ColumnStringSlice.h>
+
+
+/** Microbenchmark of ColumnStringSlice against ColumnString.
+  * Two filters are applied one after another (as in a chain of filtering steps):
+  *  ColumnString copies the surviving bytes at each step, ColumnStringSlice copies
+  *  only 16-byte references and the bytes once at the end, in materialize().
+  * The first argument is the number of rows, the second is the string size in bytes.
+  */
+
+int main(int argc, char ** argv)
+{
+    using namespace DB;
+
+    size_t n = argc >= 2 ? std::stoull(argv[1]) : 100000;
+    size_t string_size = argc >= 3 ? std::stoull(argv[2]) : 1000;
+
+    auto source = ColumnString::create();
+    {
+        std::string value(string_size, 'x');
+        for (size_t i = 0; i < n; ++i)
+        {
+            value[i % string_size] = 'a' + i % 26;
+            source->insertData(value.data(), value.size());
+        }
+    }
+
+    std::mt19937 rng(0);
+
+    for (double selectivity : {0.1, 0.5, 0.9})
+    {
+        IColumn::Filter first_filt(n);
+        std::bernoulli_distribution dist(selectivity);
+        for (size_t i = 0; i < n; ++i)
+            first_filt[i] = dist(rng);
+
+        ColumnPtr first_string = source->filter(first_filt, -1);
+
+        IColumn::Filter second_filt(first_string->size());
+        for (size_t i = 0; i < second_filt.size(); ++i)
+            second_filt[i] = dist(rng);
+
+        ColumnPtr direct_result;
+        double direct_seconds;
+        {
+            Stopwatch watch;
+            direct_result = source->filter(first_filt, -1)->filter(second_filt, -1);
+            watch.stop();
+            direct_seconds = watch.elapsedSeconds();
+        }
+
+        ColumnPtr slice_result;
+        double slice_seconds;
+        {
+            Stopwatch watch;
+            ColumnPtr filtered = ColumnStringSlice::create(source->getPtr())
+                ->filter(first_filt, -1)->filter(second_filt, -1);
+            slice_result = typeid_cast<const ColumnStringSlice &>(*filtered).materialize();
+            watch.stop();
+            slice_seconds = watch.elapsedSeconds();
+        }
+
+        if (direct_result->size() != slice_result->size())
+        {
+            std::cerr << "Sizes of the results differ!\n";
+            return 1;
+        }
+
+        for (size_t i = 0; i < direct_result->size(); ++i)
+        {
+            if (direct_result->getDataAt(i) != slice_result->getDataAt(i))
+            {
+                std::cerr << "Results differ at row " << i << "!\n";
+                return 1;
+            }
+        }
+
+        std::cerr << std::fixed << std::setprecision(3)
+            << "Selectivity " << selectivity
+            << ": ColumnString " << direct_seconds << " sec.,"
+            << " ColumnStringSlice " << slice_seconds << " sec.,"
+            << " " << direct_result->size() << " rows passed\n";
+    }
+
+    return 0;
+}
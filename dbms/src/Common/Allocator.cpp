@@ -7,13 +7,27 @@
 #include <cstdlib>
 #include <sys/mman.h>
 
+#include <map>
+#include <mutex>
+#include <vector>
+
 #include <common/mremap.h>
 #include <Common/MemoryTracker.h>
+#include <Common/ProfileEvents.h>
 #include <Common/Exception.h>
 #include <Common/formatReadable.h>
 #include <IO/WriteHelpers.h>
 
 
+namespace ProfileEvents
+{
+    extern const Event MMapRegionCacheHits;
+    extern const Event MMapRegionCacheMisses;
+    extern const Event ThreadAllocationCacheHits;
+    extern const Event ThreadAllocationCacheMisses;
+}
+
+
 /// Required for older Darwin builds, that lack definition of MAP_ANONYMOUS
 #ifndef MAP_ANONYMOUS
 #define MAP_ANONYMOUS MAP_ANON
@@ -47,6 +61,159 @@ static constexpr size_t MMAP_MIN_ALIGNMENT = 4096;
 static constexpr size_t MALLOC_MIN_ALIGNMENT = 8;
 
 
+namespace
+{
+
+/** Large (mmap-ed) regions are recycled through a global pool instead of being unmapped.
+  * Aggregation-heavy queries allocate and free such regions at a high rate (arena chunks,
+  *  two-level hash table buckets), and both mmap/munmap and the page faults that follow
+  *  a fresh mapping are expensive, especially with many threads.
+  *
+  * A region put into the pool is madvise(MADV_DONTNEED)-ed: it keeps address space, but holds
+  *  no physical memory, and the kernel hands out zeroed pages when it is reused - which also
+  *  keeps the Allocator<true> (clear_memory) variant correct. Only address space is capped.
+  *
+  * Note that this preserves the first-touch NUMA policy: the reusing thread faults the pages
+  *  in anew, so they are placed on its local node regardless of where the region was used before.
+  */
+class MMapRegionCache
+{
+public:
+    static MMapRegionCache & instance()
+    {
+        static MMapRegionCache cache;
+        return cache;
+    }
+
+    /// Returns a cached region of exactly 'size' bytes or nullptr.
+    void * get(size_t size)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto it = regions.find(size);
+        if (regions.end() == it)
+            return nullptr;
+
+        void * buf = it->second.back();
+        it->second.pop_back();
+        if (it->second.empty())
+            regions.erase(it);
+        total_bytes -= size;
+        return buf;
+    }
+
+    /// Takes ownership of the region and returns true; the caller must munmap it otherwise.
+    bool put(void * buf, size_t size)
+    {
+        /// Release physical memory right away: cached regions must not count towards RSS.
+        if (0 != madvise(buf, size, MADV_DONTNEED))
+            return false;
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (total_bytes + size > max_cached_bytes)
+            return false;
+
+        regions[size].push_back(buf);
+        total_bytes += size;
+        return true;
+    }
+
+private:
+    /// Address space, not physical memory. Large enough to never matter on 64 bit platforms.
+    static constexpr size_t max_cached_bytes = 4ULL << 30;
+
+    std::mutex mutex;
+    std::map<size_t, std::vector<void *>> regions;
+    size_t total_bytes = 0;
+};
+
+
+/** Below the mmap threshold the dominant churn is column buffers: every pipeline stage allocates
+  *  PODArray buffers of the same few sizes (a column of the block size) and frees them one stage
+  *  later, producing gigabytes per second of malloc traffic on scan-heavy queries.
+  *
+  * These are recycled through thread-local exact-size free lists - no locks, and the pages of a
+  *  reused chunk are hot in the local caches and TLB. Only chunks of at least 256 KiB are cached
+  *  (smaller ones are cheap for malloc anyway), and the total is capped per thread, since cached
+  *  chunks keep their physical memory.
+  */
+class ThreadAllocationCache
+{
+public:
+    static ThreadAllocationCache & instance()
+    {
+        static thread_local ThreadAllocationCache cache;
+        return cache;
+    }
+
+    /// Returns a cached chunk of exactly 'size' bytes suitably aligned, or nullptr.
+    void * get(size_t size, size_t alignment)
+    {
+        auto it = chunks.find(size);
+        if (chunks.end() == it)
+            return nullptr;
+
+        /// Chunks from plain malloc may not satisfy a stronger alignment requirement.
+        for (auto jt = it->second.begin(); jt != it->second.end(); ++jt)
+        {
+            if (0 == reinterpret_cast<uintptr_t>(*jt) % alignment)
+            {
+                void * buf = *jt;
+                it->second.erase(jt);
+                if (it->second.empty())
+                    chunks.erase(it);
+                total_bytes -= size;
+                return buf;
+            }
+        }
+
+        return nullptr;
+    }
+
+    /// Takes ownership of the chunk and returns true; the caller must free it otherwise.
+    bool put(void * buf, size_t size)
+    {
+        if (total_bytes + size > max_cached_bytes)
+            return false;
+
+        chunks[size].push_back(buf);
+        total_bytes += size;
+        return true;
+    }
+
+    ~ThreadAllocationCache()
+    {
+        for (const auto & size_chunks : chunks)
+            for (void * buf : size_chunks.second)
+                ::free(buf);
+    }
+
+private:
+    static constexpr size_t max_cached_bytes = 64ULL << 20;
+
+    std::map<size_t, std::vector<void *>> chunks;
+    size_t total_bytes = 0;
+};
+
+static constexpr size_t THREAD_CACHE_MIN_SIZE = 256 * 1024;
+
+
+/// Ask the kernel to back the region with transparent huge pages: large hash tables and arenas
+///  are dominated by TLB misses on 4K pages. Best effort - THP may be disabled system-wide.
+void adviseHugePages(void * buf, size_t size)
+{
+#if defined(MADV_HUGEPAGE)
+    madvise(buf, size, MADV_HUGEPAGE);
+#else
+    (void)buf;
+    (void)size;
+#endif
+}
+
+}
+
+
 template <bool clear_memory_>
 void * Allocator<clear_memory_>::alloc(size_t size, size_t alignment)
 {
@@ -60,34 +227,63 @@ void * Allocator<clear_memory_>::alloc(size_t size, size_t alignment)
             throw DB::Exception("Too large alignment " + formatReadableSizeWithBinarySuffix(alignment) + ": more than page size when allocating "
                 + formatReadableSizeWithBinarySuffix(size) + ".", DB::ErrorCodes::BAD_ARGUMENTS);
 
-        buf = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-        if (MAP_FAILED == buf)
-            DB::throwFromErrno("Allocator: Cannot mmap " + formatReadableSizeWithBinarySuffix(size) + ".", DB::ErrorCodes::CANNOT_ALLOCATE_MEMORY);
+        buf = MMapRegionCache::instance().get(size);
+        if (buf)
+        {
+            ProfileEvents::increment(ProfileEvents::MMapRegionCacheHits);
+        }
+        else
+        {
+            ProfileEvents::increment(ProfileEvents::MMapRegionCacheMisses);
 
-        /// No need for zero-fill, because mmap guarantees it.
+            buf = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (MAP_FAILED == buf)
+                DB::throwFromErrno("Allocator: Cannot mmap " + formatReadableSizeWithBinarySuffix(size) + ".", DB::ErrorCodes::CANNOT_ALLOCATE_MEMORY);
+        }
+
+        adviseHugePages(buf, size);
+
+        /// No need for zero-fill, because mmap (and MADV_DONTNEED for recycled regions) guarantees it.
     }
     else
     {
-        if (alignment <= MALLOC_MIN_ALIGNMENT)
+        buf = nullptr;
+
+        if (size >= THREAD_CACHE_MIN_SIZE)
         {
-            if (clear_memory)
-                buf = ::calloc(size, 1);
+            buf = ThreadAllocationCache::instance().get(size, alignment);
+            if (buf)
+            {
+                ProfileEvents::increment(ProfileEvents::ThreadAllocationCacheHits);
+                if (clear_memory)
+                    memset(buf, 0, size);
+            }
             else
-                buf = ::malloc(size);
-
-            if (nullptr == buf)
-                DB::throwFromErrno("Allocator: Cannot malloc " + formatReadableSizeWithBinarySuffix(size) + ".", DB::ErrorCodes::CANNOT_ALLOCATE_MEMORY);
+                ProfileEvents::increment(ProfileEvents::ThreadAllocationCacheMisses);
         }
-        else
+
+        if (nullptr == buf)
         {
-            buf = nullptr;
-            int res = posix_memalign(&buf, alignment, size);
+            if (alignment <= MALLOC_MIN_ALIGNMENT)
+            {
+                if (clear_memory)
+                    buf = ::calloc(size, 1);
+                else
+                    buf = ::malloc(size);
+
+                if (nullptr == buf)
+                    DB::throwFromErrno("Allocator: Cannot malloc " + formatReadableSizeWithBinarySuffix(size) + ".", DB::ErrorCodes::CANNOT_ALLOCATE_MEMORY);
+            }
+            else
+            {
+                int res = posix_memalign(&buf, alignment, size);
 
-            if (0 != res)
-                DB::throwFromErrno("Cannot allocate memory (posix_memalign) " + formatReadableSizeWithBinarySuffix(size) + ".", DB::ErrorCodes::CANNOT_ALLOCATE_MEMORY, res);
+                if (0 != res)
+                    DB::throwFromErrno("Cannot allocate memory (posix_memalign) " + formatReadableSizeWithBinarySuffix(size) + ".", DB::ErrorCodes::CANNOT_ALLOCATE_MEMORY, res);
 
-            if (clear_memory)
-                memset(buf, 0, size);
+                if (clear_memory)
+                    memset(buf, 0, size);
+            }
         }
     }
 
@@ -100,12 +296,14 @@ void Allocator<clear_memory_>::free(void * buf, size_t size)
 {
     if (size >= MMAP_THRESHOLD)
     {
-        if (0 != munmap(buf, size))
+        if (!MMapRegionCache::instance().put(buf, size)
+            && 0 != munmap(buf, size))
             DB::throwFromErrno("Allocator: Cannot munmap " + formatReadableSizeWithBinarySuffix(size) + ".", DB::ErrorCodes::CANNOT_MUNMAP);
     }
     else
     {
-        ::free(buf);
+        if (size < THREAD_CACHE_MIN_SIZE || !ThreadAllocationCache::instance().put(buf, size))
+            ::free(buf);
     }
 
     CurrentMemoryTracker::free(size);
@@ -140,13 +338,16 @@ void * Allocator<clear_memory_>::realloc(void * buf, size_t old_size, size_t new
         if (MAP_FAILED == buf)
             DB::throwFromErrno("Allocator: Cannot mremap memory chunk from " + formatReadableSizeWithBinarySuffix(old_size) + " to " + formatReadableSizeWithBinarySuffix(new_size) + ".", DB::ErrorCodes::CANNOT_MREMAP);
 
+        adviseHugePages(buf, new_size);
+
         /// No need for zero-fill, because mmap guarantees it.
     }
     else if (old_size >= MMAP_THRESHOLD && new_size < MMAP_THRESHOLD)
     {
         void * new_buf = alloc(new_size, alignment);
         memcpy(new_buf, buf, new_size);
-        if (0 != munmap(buf, old_size))
+        if (!MMapRegionCache::instance().put(buf, old_size)
+            && 0 != munmap(buf, old_size))
         {
             ::free(new_buf);
             DB::throwFromErrno("Allocator: Cannot munmap " + formatReadableSizeWithBinarySuffix(old_size) + ".", DB::ErrorCodes::CANNOT_MUNMAP);
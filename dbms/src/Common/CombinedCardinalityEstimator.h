@@ -13,7 +13,9 @@ namespace DB
 namespace details
 {
 
-enum class ContainerType : UInt8 { SMALL = 1, MEDIUM = 2, LARGE = 3 };
+/// LARGE_SPARSE is a serialization format, not an in-memory container: a LARGE state whose
+/// occupied HLL registers are written out individually because that is smaller than the dense dump.
+enum class ContainerType : UInt8 { SMALL = 1, MEDIUM = 2, LARGE = 3, LARGE_SPARSE = 4 };
 
 static inline ContainerType max(const ContainerType & lhs, const ContainerType & rhs)
 {
@@ -167,6 +169,11 @@ public:
             toLarge();
             getContainer<Large>().read(in);
         }
+        else if (container_type == details::ContainerType::LARGE_SPARSE)
+        {
+            toLarge();
+            getContainer<Large>().readSparse(in);
+        }
     }
 
     void readAndMerge(DB::ReadBuffer & in)
@@ -185,6 +192,10 @@ public:
         readBinary(v, in);
         auto rhs_container_type = static_cast<details::ContainerType>(v);
 
+        bool rhs_is_sparse_large = (rhs_container_type == details::ContainerType::LARGE_SPARSE);
+        if (rhs_is_sparse_large)
+            rhs_container_type = details::ContainerType::LARGE;
+
         auto max_container_type = details::max(container_type, rhs_container_type);
 
         if (container_type != max_container_type)
@@ -208,12 +219,25 @@ public:
                 insert(reader.get());
         }
         else if (rhs_container_type == details::ContainerType::LARGE)
-            getContainer<Large>().readAndMerge(in);
+        {
+            if (rhs_is_sparse_large)
+                getContainer<Large>().readAndMergeSparse(in);
+            else
+                getContainer<Large>().readAndMerge(in);
+        }
     }
 
     void write(DB::WriteBuffer & out) const
     {
         auto container_type = getContainerType();
+
+        if (container_type == details::ContainerType::LARGE && getContainer<Large>().worthWritingSparse())
+        {
+            writeBinary(static_cast<UInt8>(details::ContainerType::LARGE_SPARSE), out);
+            getContainer<Large>().writeSparse(out);
+            return;
+        }
+
         writeBinary(static_cast<UInt8>(container_type), out);
 
         if (container_type == details::ContainerType::SMALL)
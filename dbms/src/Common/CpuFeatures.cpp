@@ -0,0 +1,29 @@
+#include <Common/CpuFeatures.h>
+
+
+namespace DB
+{
+
+bool haveAVX2()
+{
+#if defined(__GNUC__) && defined(__x86_64__)
+    static const bool res = __builtin_cpu_supports("avx2");
+    return res;
+#else
+    return false;
+#endif
+}
+
+bool haveAVX512()
+{
+#if defined(__GNUC__) && defined(__x86_64__)
+    static const bool res = __builtin_cpu_supports("avx512f")
+        && __builtin_cpu_supports("avx512bw")
+        && __builtin_cpu_supports("avx512vl");
+    return res;
+#else
+    return false;
+#endif
+}
+
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+namespace DB
+{
+
+/// Whether the CPU we are running on supports AVX2.
+/// The binary itself targets only SSE, so wider kernels are compiled with a 'target' attribute
+///  and chosen at run time with this check.
+bool haveAVX2();
+
+/// Same for AVX-512 (the F, BW and VL subsets - enough for 512-bit integer and floating point loops).
+bool haveAVX512();
+
+}
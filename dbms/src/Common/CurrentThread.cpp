@@ -89,6 +89,11 @@ void CurrentThread::updateProgressOut(const Progress & value)
     current_thread->progress_out.incrementPiecewiseAtomically(value);
 }
 
+void CurrentThread::setQueryStage(const std::string & stage)
+{
+    current_thread->stage_name = stage;
+}
+
 void CurrentThread::attachInternalTextLogsQueue(const std::shared_ptr<InternalTextLogsQueue> & logs_queue)
 {
     get()->attachInternalTextLogsQueue(logs_queue);
@@ -51,6 +51,9 @@ public:
     static void updateProgressIn(const Progress & value);
     static void updateProgressOut(const Progress & value);
 
+    /// Name the pipeline stage the calling thread serves (used in system.query_thread_log)
+    static void setQueryStage(const std::string & stage);
+
     /// Query management:
 
     /// Call from master thread as soon as possible (e.g. when thread accepted connection)
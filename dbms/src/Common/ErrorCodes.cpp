@@ -401,6 +401,13 @@ namespace ErrorCodes
     extern const int CANNOT_LINK = 424;
     extern const int SYSTEM_ERROR = 425;
     extern const int NULL_POINTER_DEREFERENCE = 426;
+    extern const int CANNOT_PARSE_PROTOBUF_SCHEMA = 427;
+    extern const int CANNOT_CREATE_TIMER = 428;
+    extern const int CANNOT_FCNTL = 429;
+    extern const int UNKNOWN_PREPARED_STATEMENT = 430;
+    extern const int TOO_MANY_PREPARED_STATEMENTS = 431;
+    extern const int WRONG_NUMBER_OF_PARAMETERS = 432;
+    extern const int INVALID_WITH_FILL_EXPRESSION = 433;
 
     extern const int KEEPER_EXCEPTION = 999;
     extern const int POCO_EXCEPTION = 1000;
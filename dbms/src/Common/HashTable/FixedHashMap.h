@@ -0,0 +1,91 @@
+#pragma once
+
+#include <Common/HashTable/FixedHashTable.h>
+#include <Common/HashTable/HashMap.h>
+#include <Common/HashTable/HashTableAllocator.h>
+
+
+/** A cell of FixedHashMap. The key is stored explicitly (although it equals the cell index)
+  *  so that iteration and merging can use the same value_type pair as HashMapCell.
+  * Emptiness is tracked by the `full` flag instead of a reserved zero key.
+  */
+template <typename Key, typename TMapped, typename TState = HashTableNoState>
+struct FixedHashMapCell
+{
+    using Mapped = TMapped;
+    using State = TState;
+
+    using value_type = PairNoInit<Key, Mapped>;
+    value_type value;
+    bool full = false;
+
+    FixedHashMapCell() {}
+    FixedHashMapCell(const Key & key_, const State &) : value(key_, NoInitTag()) {}
+    FixedHashMapCell(const value_type & value_, const State &) : value(value_) {}
+
+    value_type & getValue() { return value; }
+    const value_type & getValue() const { return value; }
+
+    static Key & getKey(value_type & value) { return value.first; }
+    static const Key & getKey(const value_type & value) { return value.first; }
+
+    bool isZero(const State &) const { return !full; }
+    void setFull() { full = true; }
+
+    void setMapped(const value_type & value_) { value.second = value_.second; }
+
+    /// Serialization, in binary and text form.
+    void write(DB::WriteBuffer & wb) const
+    {
+        DB::writeBinary(value.first, wb);
+        DB::writeBinary(value.second, wb);
+    }
+
+    void writeText(DB::WriteBuffer & wb) const
+    {
+        DB::writeDoubleQuoted(value.first, wb);
+        DB::writeChar(',', wb);
+        DB::writeDoubleQuoted(value.second, wb);
+    }
+
+    /// Deserialization, in binary and text form.
+    void read(DB::ReadBuffer & rb)
+    {
+        DB::readBinary(value.first, rb);
+        DB::readBinary(value.second, rb);
+    }
+
+    void readText(DB::ReadBuffer & rb)
+    {
+        DB::readDoubleQuoted(value.first, rb);
+        DB::assertChar(',', rb);
+        DB::readDoubleQuoted(value.second, rb);
+    }
+};
+
+
+template
+<
+    typename Key,
+    typename Mapped,
+    typename Allocator = HashTableAllocator
+>
+class FixedHashMap : public FixedHashTable<Key, FixedHashMapCell<Key, Mapped>, Allocator>
+{
+public:
+    using key_type = Key;
+    using mapped_type = Mapped;
+    using value_type = typename FixedHashMapCell<Key, Mapped>::value_type;
+
+    mapped_type & ALWAYS_INLINE operator[](Key x)
+    {
+        typename FixedHashMap::iterator it;
+        bool inserted;
+        this->emplace(x, it, inserted);
+
+        if (inserted)
+            new(&it->second) mapped_type();
+
+        return it->second;
+    }
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Common/HashTable/FixedHashTable.h>
+#include <Common/HashTable/HashTableAllocator.h>
+
+
+/** A cell of FixedHashSet: just the key and the `full` flag
+  *  (the key equals the cell index, but is stored for uniform iteration).
+  */
+template <typename Key, typename TState = HashTableNoState>
+struct FixedHashSetCell
+{
+    using State = TState;
+
+    using value_type = Key;
+    Key key;
+    bool full = false;
+
+    FixedHashSetCell() {}
+    FixedHashSetCell(const Key & key_, const State &) : key(key_) {}
+
+    value_type & getValue() { return key; }
+    const value_type & getValue() const { return key; }
+
+    static Key & getKey(value_type & value) { return value; }
+    static const Key & getKey(const value_type & value) { return value; }
+
+    bool isZero(const State &) const { return !full; }
+    void setFull() { full = true; }
+
+    void setMapped(const value_type & /*value*/) {}
+
+    /// Serialization, in binary and text form.
+    void write(DB::WriteBuffer & wb) const         { DB::writeBinary(key, wb); }
+    void writeText(DB::WriteBuffer & wb) const     { DB::writeDoubleQuoted(key, wb); }
+
+    /// Deserialization, in binary and text form.
+    void read(DB::ReadBuffer & rb)        { DB::readBinary(key, rb); }
+    void readText(DB::ReadBuffer & rb)    { DB::readDoubleQuoted(key, rb); }
+};
+
+
+template
+<
+    typename Key,
+    typename Allocator = HashTableAllocator
+>
+class FixedHashSet : public FixedHashTable<Key, FixedHashSetCell<Key>, Allocator>
+{
+public:
+    using Base = FixedHashTable<Key, FixedHashSetCell<Key>, Allocator>;
+
+    void merge(const FixedHashSet & rhs)
+    {
+        for (size_t i = 0; i < Base::NUM_CELLS; ++i)
+            if (!rhs.buf[i].isZero(rhs) && this->buf[i].isZero(*this))
+            {
+                new(&this->buf[i]) FixedHashSetCell<Key>(rhs.buf[i]);
+                ++this->m_size;
+            }
+    }
+};
@@ -0,0 +1,413 @@
+#pragma once
+
+#include <Common/HashTable/HashTable.h>
+
+
+/** A "hash" table for keys of 1-2 bytes, that is in fact a direct-addressed array of 2^N cells.
+  * The key is not hashed at all: it is used as the index of its cell, so there are no collisions,
+  *  no probing chains and no resizes, and a lookup is a single indexed load.
+  *
+  * Unlike HashTable, a zero key is an ordinary index here and cannot serve as the "empty" marker,
+  *  so cells carry an explicit `full` flag (set by setFull, checked by isZero - the name is kept
+  *  for uniformity with HashTable cells). The buffer is allocated zero-filled by the allocator,
+  *  which makes all cells empty initially.
+  *
+  * The buffer is always fully allocated: 256 cells for 1-byte keys, 65536 cells for 2-byte keys.
+  */
+template
+<
+    typename Key,
+    typename Cell,
+    typename Allocator
+>
+class FixedHashTable :
+    private boost::noncopyable,
+    protected Allocator,
+    protected Cell::State
+{
+protected:
+    static constexpr size_t NUM_CELLS = 1ULL << (sizeof(Key) * 8);
+
+    friend class const_iterator;
+    friend class iterator;
+    friend class Reader;
+
+    using Self = FixedHashTable;
+    using cell_type = Cell;
+
+    size_t m_size = 0;        /// Amount of elements
+    Cell * buf;               /// An array of NUM_CELLS cells, indexed directly by key.
+
+    void alloc()
+    {
+        buf = reinterpret_cast<Cell *>(Allocator::alloc(NUM_CELLS * sizeof(Cell)));
+    }
+
+    void free()
+    {
+        if (buf)
+        {
+            Allocator::free(buf, getBufferSizeInBytes());
+            buf = nullptr;
+        }
+    }
+
+    void destroyElements()
+    {
+        if (!std::is_trivially_destructible_v<Cell>)
+            for (iterator it = begin(), it_end = end(); it != it_end; ++it)
+                it.ptr->~Cell();
+    }
+
+
+    template <typename Derived, bool is_const>
+    class iterator_base
+    {
+        using Container = std::conditional_t<is_const, const Self, Self>;
+        using cell_type = std::conditional_t<is_const, const Cell, Cell>;
+
+        Container * container;
+        cell_type * ptr;
+
+        friend class FixedHashTable;
+
+    public:
+        iterator_base() {}
+        iterator_base(Container * container_, cell_type * ptr_) : container(container_), ptr(ptr_) {}
+
+        bool operator== (const iterator_base & rhs) const { return ptr == rhs.ptr; }
+        bool operator!= (const iterator_base & rhs) const { return ptr != rhs.ptr; }
+
+        Derived & operator++()
+        {
+            ++ptr;
+
+            /// Skip empty cells.
+            auto buf_end = container->buf + NUM_CELLS;
+            while (ptr < buf_end && ptr->isZero(*container))
+                ++ptr;
+
+            return static_cast<Derived &>(*this);
+        }
+
+        auto & operator* () const { return ptr->getValue(); }
+        auto * operator->() const { return &ptr->getValue(); }
+
+        auto getPtr() const { return ptr; }
+    };
+
+
+public:
+    using key_type = Key;
+    using value_type = typename Cell::value_type;
+
+    /// The whole table is small and there is no hash; prefetching makes no sense.
+    static constexpr bool supports_prefetch = false;
+
+    FixedHashTable()
+    {
+        alloc();
+    }
+
+    /// For uniformity with HashTable: the size of the buffer does not depend on the expected number of elements.
+    FixedHashTable(size_t /*reserve_for_num_elements*/)
+    {
+        alloc();
+    }
+
+    FixedHashTable(FixedHashTable && rhs)
+        : buf(nullptr)
+    {
+        *this = std::move(rhs);
+    }
+
+    ~FixedHashTable()
+    {
+        destroyElements();
+        free();
+    }
+
+    FixedHashTable & operator= (FixedHashTable && rhs)
+    {
+        destroyElements();
+        free();
+
+        std::swap(buf, rhs.buf);
+        std::swap(m_size, rhs.m_size);
+
+        Allocator::operator=(std::move(rhs));
+        Cell::State::operator=(std::move(rhs));
+
+        return *this;
+    }
+
+    class Reader final : private Cell::State
+    {
+    public:
+        Reader(DB::ReadBuffer & in_)
+        : in(in_)
+        {
+        }
+
+        Reader(const Reader &) = delete;
+        Reader & operator=(const Reader &) = delete;
+
+        bool next()
+        {
+            if (!is_initialized)
+            {
+                Cell::State::read(in);
+                DB::readVarUInt(size, in);
+                is_initialized = true;
+            }
+
+            if (read_count == size)
+            {
+                is_eof = true;
+                return false;
+            }
+
+            cell.read(in);
+            ++read_count;
+
+            return true;
+        }
+
+        inline const value_type & get() const
+        {
+            if (!is_initialized || is_eof)
+                throw DB::Exception("No available data", DB::ErrorCodes::NO_AVAILABLE_DATA);
+
+            return cell.getValue();
+        }
+
+    private:
+        DB::ReadBuffer & in;
+        Cell cell;
+        size_t read_count = 0;
+        size_t size;
+        bool is_eof = false;
+        bool is_initialized = false;
+    };
+
+
+    class iterator : public iterator_base<iterator, false>
+    {
+    public:
+        using iterator_base<iterator, false>::iterator_base;
+    };
+
+    class const_iterator : public iterator_base<const_iterator, true>
+    {
+    public:
+        using iterator_base<const_iterator, true>::iterator_base;
+    };
+
+
+    const_iterator begin() const
+    {
+        if (!buf)
+            return end();
+
+        const Cell * ptr = buf;
+        auto buf_end = buf + NUM_CELLS;
+        while (ptr < buf_end && ptr->isZero(*this))
+            ++ptr;
+
+        return const_iterator(this, ptr);
+    }
+
+    iterator begin()
+    {
+        if (!buf)
+            return end();
+
+        Cell * ptr = buf;
+        auto buf_end = buf + NUM_CELLS;
+        while (ptr < buf_end && ptr->isZero(*this))
+            ++ptr;
+
+        return iterator(this, ptr);
+    }
+
+    const_iterator end() const         { return const_iterator(this, buf + NUM_CELLS); }
+    iterator end()                     { return iterator(this, buf + NUM_CELLS); }
+
+
+    std::pair<iterator, bool> ALWAYS_INLINE insert(const value_type & x)
+    {
+        std::pair<iterator, bool> res;
+        emplace(Cell::getKey(x), res.first, res.second);
+
+        if (res.second)
+            res.first.ptr->setMapped(x);
+
+        return res;
+    }
+
+
+    /** Insert the key.
+      * Return values:
+      * 'it' -- an iterator to the corresponding cell (always valid: the table never overflows);
+      * 'inserted' -- whether a new key was inserted.
+      *
+      * You have to make `placement new` of value if you inserted a new key,
+      * since when destroying a hash table, the destructor will be invoked for it!
+      */
+    void ALWAYS_INLINE emplace(Key x, iterator & it, bool & inserted)
+    {
+        it = iterator(this, &buf[x]);
+
+        if (!buf[x].isZero(*this))
+        {
+            inserted = false;
+            return;
+        }
+
+        new(&buf[x]) Cell(x, *this);
+        buf[x].setFull();
+        inserted = true;
+        ++m_size;
+    }
+
+    /// Same, but with a precalculated hash value (it is ignored: the key itself is the "hash").
+    void ALWAYS_INLINE emplace(Key x, iterator & it, bool & inserted, size_t /*hash_value*/)
+    {
+        emplace(x, it, inserted);
+    }
+
+    iterator ALWAYS_INLINE find(Key x)
+    {
+        return !buf[x].isZero(*this) ? iterator(this, &buf[x]) : end();
+    }
+
+    const_iterator ALWAYS_INLINE find(Key x) const
+    {
+        return !buf[x].isZero(*this) ? const_iterator(this, &buf[x]) : end();
+    }
+
+    iterator ALWAYS_INLINE find(Key x, size_t /*hash_value*/)
+    {
+        return find(x);
+    }
+
+    const_iterator ALWAYS_INLINE find(Key x, size_t /*hash_value*/) const
+    {
+        return find(x);
+    }
+
+    bool ALWAYS_INLINE has(Key x) const
+    {
+        return !buf[x].isZero(*this);
+    }
+
+    void write(DB::WriteBuffer & wb) const
+    {
+        Cell::State::write(wb);
+        DB::writeVarUInt(m_size, wb);
+
+        for (auto ptr = buf, buf_end = buf + NUM_CELLS; ptr < buf_end; ++ptr)
+            if (!ptr->isZero(*this))
+                ptr->write(wb);
+    }
+
+    void writeText(DB::WriteBuffer & wb) const
+    {
+        Cell::State::writeText(wb);
+        DB::writeText(m_size, wb);
+
+        for (auto ptr = buf, buf_end = buf + NUM_CELLS; ptr < buf_end; ++ptr)
+        {
+            if (!ptr->isZero(*this))
+            {
+                DB::writeChar(',', wb);
+                ptr->writeText(wb);
+            }
+        }
+    }
+
+    void read(DB::ReadBuffer & rb)
+    {
+        Cell::State::read(rb);
+        destroyElements();
+        DB::readVarUInt(m_size, rb);
+
+        free();
+        alloc();
+
+        for (size_t i = 0; i < m_size; ++i)
+        {
+            Cell x;
+            x.read(rb);
+            Key place = Cell::getKey(x.getValue());
+            new(&buf[place]) Cell(x.getValue(), *this);
+            buf[place].setFull();
+        }
+    }
+
+    void readText(DB::ReadBuffer & rb)
+    {
+        Cell::State::readText(rb);
+        destroyElements();
+        size_t new_size = 0;
+        DB::readText(new_size, rb);
+        m_size = new_size;
+
+        free();
+        alloc();
+
+        for (size_t i = 0; i < m_size; ++i)
+        {
+            Cell x;
+            DB::assertChar(',', rb);
+            x.readText(rb);
+            Key place = Cell::getKey(x.getValue());
+            new(&buf[place]) Cell(x.getValue(), *this);
+            buf[place].setFull();
+        }
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return 0 == m_size;
+    }
+
+    void clear()
+    {
+        destroyElements();
+        m_size = 0;
+
+        memset(static_cast<void*>(buf), 0, NUM_CELLS * sizeof(*buf));
+    }
+
+    /// After executing this function, the table can only be destroyed,
+    ///  and also you can use the methods `size`, `empty`, `begin`, `end`.
+    void clearAndShrink()
+    {
+        destroyElements();
+        m_size = 0;
+        free();
+    }
+
+    size_t getBufferSizeInBytes() const
+    {
+        return NUM_CELLS * sizeof(Cell);
+    }
+
+    size_t getBufferSizeInCells() const
+    {
+        return NUM_CELLS;
+    }
+
+#ifdef DBMS_HASH_MAP_COUNT_COLLISIONS
+    size_t getCollisions() const
+    {
+        return 0;
+    }
+#endif
+};
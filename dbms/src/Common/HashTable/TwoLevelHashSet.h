@@ -0,0 +1,33 @@
+#pragma once
+
+#include <Common/HashTable/TwoLevelHashTable.h>
+#include <Common/HashTable/HashSet.h>
+
+
+template
+<
+    typename Key,
+    typename Hash = DefaultHash<Key>,
+    typename Grower = TwoLevelHashTableGrower<>,
+    typename Allocator = HashTableAllocator
+>
+class TwoLevelHashSetTable
+    : public TwoLevelHashTable<Key, HashTableCell<Key, Hash>, Hash, Grower, Allocator,
+        HashSetTable<Key, HashTableCell<Key, Hash>, Hash, Grower, Allocator>>
+{
+public:
+    using Base = TwoLevelHashTable<Key, HashTableCell<Key, Hash>, Hash, Grower, Allocator,
+        HashSetTable<Key, HashTableCell<Key, Hash>, Hash, Grower, Allocator>>;
+
+    using Base::Base;
+};
+
+
+template
+<
+    typename Key,
+    typename Hash = DefaultHash<Key>,
+    typename Grower = TwoLevelHashTableGrower<>,
+    typename Allocator = HashTableAllocator
+>
+using TwoLevelHashSet = TwoLevelHashSetTable<Key, Hash, Grower, Allocator>;
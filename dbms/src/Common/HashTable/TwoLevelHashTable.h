@@ -55,6 +55,13 @@ public:
     /// NOTE Bad for hash tables with more than 2^32 cells.
     static size_t getBucketFromHash(size_t hash_value) { return (hash_value >> (32 - BITS_FOR_BUCKET)) & MAX_BUCKET; }
 
+    static constexpr bool supports_prefetch = true;
+
+    void ALWAYS_INLINE prefetchByHash(size_t hash_value) const
+    {
+        impls[getBucketFromHash(hash_value)].prefetchByHash(hash_value);
+    }
+
 protected:
     typename Impl::iterator beginOfNextNonEmptyBucket(size_t & bucket)
     {
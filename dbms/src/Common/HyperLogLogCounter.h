@@ -361,6 +361,65 @@ public:
         out.write(reinterpret_cast<const char *>(this), sizeof(*this));
     }
 
+    /// Number of buckets with non-zero rank.
+    size_t getNonZeroBucketCount() const
+    {
+        return bucket_count - zeros;
+    }
+
+    /// Whether the sparse representation (see writeSparse) is smaller than the dense dump.
+    bool worthWritingSparse() const
+    {
+        /// Upper bound of the sparse size: varint bucket number (at most 3 bytes for reasonable precisions)
+        /// plus one byte of rank per occupied bucket, plus the leading count.
+        return getNonZeroBucketCount() * 4 + 9 < sizeof(*this);
+    }
+
+    /// Sparse representation: only occupied buckets, as (bucket, rank) pairs.
+    /// Pays off for counters that have seen much fewer values than they have buckets.
+    void writeSparse(DB::WriteBuffer & out) const
+    {
+        DB::writeVarUInt(getNonZeroBucketCount(), out);
+
+        for (size_t bucket = 0; bucket < bucket_count; ++bucket)
+        {
+            UInt8 rank = rank_store[bucket];
+            if (rank != 0)
+            {
+                DB::writeVarUInt(bucket, out);
+                DB::writeBinary(rank, out);
+            }
+        }
+    }
+
+    void readAndMergeSparse(DB::ReadBuffer & in)
+    {
+        size_t count = 0;
+        DB::readVarUInt(count, in);
+
+        if (count > bucket_count)
+            throw Poco::Exception("Internal error", DB::ErrorCodes::LOGICAL_ERROR);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            UInt64 bucket = 0;
+            UInt8 rank = 0;
+            DB::readVarUInt(bucket, in);
+            DB::readBinary(rank, in);
+
+            if (bucket >= bucket_count)
+                throw Poco::Exception("Internal error", DB::ErrorCodes::LOGICAL_ERROR);
+
+            update(bucket, rank);
+        }
+    }
+
+    /// You can only call for an empty object: update() then maintains zeros and denominator correctly.
+    void readSparse(DB::ReadBuffer & in)
+    {
+        readAndMergeSparse(in);
+    }
+
     /// Read and write in text mode is suboptimal (but compatible with OLAPServer and Metrage).
     void readText(DB::ReadBuffer & in)
     {
@@ -103,16 +103,28 @@ public:
         }
     }
 
+    /// Values of the leading byte of the serialized state.
+    /// Historically it was a bool, so 0 and 1 keep their meaning and old states stay readable.
+    enum SerializationTag : UInt8
+    {
+        SmallSet = 0,
+        DenseHLL = 1,
+        SparseHLL = 2,  /// Only occupied registers; written when it is smaller than the dense dump.
+    };
+
     /// You can only call for an empty object.
     void read(DB::ReadBuffer & in)
     {
-        bool is_large;
-        readBinary(is_large, in);
+        UInt8 tag = SmallSet;
+        readBinary(tag, in);
 
-        if (is_large)
+        if (tag != SmallSet)
         {
             toLarge();
-            large->read(in);
+            if (tag == SparseHLL)
+                large->readSparse(in);
+            else
+                large->read(in);
         }
         else
             small.read(in);
@@ -120,30 +132,44 @@ public:
 
     void readAndMerge(DB::ReadBuffer & in)
     {
-        bool is_rhs_large;
-        readBinary(is_rhs_large, in);
+        UInt8 tag = SmallSet;
+        readBinary(tag, in);
 
-        if (!isLarge() && is_rhs_large)
+        if (!isLarge() && tag != SmallSet)
             toLarge();
 
-        if (!is_rhs_large)
+        if (tag == SmallSet)
         {
             typename Small::Reader reader(in);
             while (reader.next())
                 insert(reader.get());
         }
+        else if (tag == SparseHLL)
+            large->readAndMergeSparse(in);
         else
             large->readAndMerge(in);
     }
 
     void write(DB::WriteBuffer & out) const
     {
-        writeBinary(isLarge(), out);
-
         if (isLarge())
-            large->write(out);
+        {
+            if (large->worthWritingSparse())
+            {
+                writeBinary(static_cast<UInt8>(SparseHLL), out);
+                large->writeSparse(out);
+            }
+            else
+            {
+                writeBinary(static_cast<UInt8>(DenseHLL), out);
+                large->write(out);
+            }
+        }
         else
+        {
+            writeBinary(static_cast<UInt8>(SmallSet), out);
             small.write(out);
+        }
     }
 };
 
@@ -0,0 +1,102 @@
+#include <Common/IOScheduler.h>
+#include <Common/ProfileEvents.h>
+
+#include <algorithm>
+#include <time.h>   /// nanosleep
+
+
+namespace ProfileEvents
+{
+    extern const Event IOSchedulerSleepMicroseconds;
+}
+
+
+namespace DB
+{
+
+thread_local IOScheduler::Class IOScheduler::current_class = IOScheduler::Class::Query;
+
+
+/// Guaranteed shares of the total bandwidth for Query, Merge, Fetch, Flush. Add up to 1.
+static constexpr double class_shares[IOScheduler::NUM_CLASSES] = {0.5, 0.25, 0.15, 0.1};
+
+/// A bucket can save up this many seconds worth of its share - both for its own bursts
+///  and as the surplus that other classes borrow.
+static constexpr double burst_seconds = 0.2;
+
+/// Don't sleep longer than this per request, to keep query cancellation and progress responsive.
+static constexpr UInt64 max_sleep_ns = 1000000000;
+
+
+IOScheduler & IOScheduler::instance()
+{
+    static IOScheduler scheduler;
+    return scheduler;
+}
+
+
+void IOScheduler::setTotalBandwidth(size_t bytes_per_second)
+{
+    std::lock_guard lock(mutex);
+
+    total_bandwidth.store(bytes_per_second, std::memory_order_relaxed);
+
+    for (size_t i = 0; i < NUM_CLASSES; ++i)
+        tokens[i] = class_shares[i] * bytes_per_second * burst_seconds;
+    prev_refill_ns = watch.elapsed();
+}
+
+
+void IOScheduler::request(Class io_class, size_t bytes)
+{
+    const size_t idx = static_cast<size_t>(io_class);
+    UInt64 sleep_ns = 0;
+
+    {
+        std::lock_guard lock(mutex);
+
+        const double total = total_bandwidth.load(std::memory_order_relaxed);
+        if (!total)
+            return;
+
+        /// Refill all buckets with their share of the bandwidth for the elapsed time.
+        UInt64 now_ns = watch.elapsed();
+        double elapsed_seconds = (now_ns - prev_refill_ns) / 1e9;
+        prev_refill_ns = now_ns;
+
+        for (size_t i = 0; i < NUM_CLASSES; ++i)
+            tokens[i] = std::min(tokens[i] + class_shares[i] * total * elapsed_seconds,
+                class_shares[i] * total * burst_seconds);
+
+        tokens[idx] -= bytes;
+
+        /// Borrow the surplus of the classes that are not using their share.
+        for (size_t i = 0; i < NUM_CLASSES && tokens[idx] < 0; ++i)
+        {
+            if (i == idx || tokens[i] <= 0)
+                continue;
+
+            double borrowed = std::min(tokens[i], -tokens[idx]);
+            tokens[i] -= borrowed;
+            tokens[idx] += borrowed;
+        }
+
+        /// Nothing to borrow: wait until the class's own refill pays the debt off.
+        if (tokens[idx] < 0)
+            sleep_ns = std::min(max_sleep_ns, static_cast<UInt64>(-tokens[idx] / (class_shares[idx] * total) * 1e9));
+    }
+
+    if (sleep_ns)
+    {
+        ::timespec sleep_ts;
+        sleep_ts.tv_sec = sleep_ns / 1000000000;
+        sleep_ts.tv_nsec = sleep_ns % 1000000000;
+
+        /// NOTE: Returns early in case of a signal. This is considered normal.
+        ::nanosleep(&sleep_ts, nullptr);
+
+        ProfileEvents::increment(ProfileEvents::IOSchedulerSleepMicroseconds, sleep_ns / 1000UL);
+    }
+}
+
+}
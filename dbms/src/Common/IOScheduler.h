@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <Common/Stopwatch.h>
+#include <common/Types.h>
+
+
+namespace DB
+{
+
+/** Server-wide disk I/O scheduler with bandwidth classes.
+  *
+  * All file reads and writes are accounted (see ReadBufferFromFileDescriptor and friends)
+  *  under a class taken from a thread-local scope: foreground query I/O by default,
+  *  while merges, fetches and background flushes set their class for the duration of a task.
+  *
+  * Each class owns a token bucket refilled with its guaranteed share of the total bandwidth.
+  * A class that exhausts its own bucket borrows the accumulated surplus of idle classes,
+  *  so any class can use the full bandwidth while the others are idle. An active class has
+  *  no surplus to take, which pushes the borrowers back to their guaranteed shares - in
+  *  particular, background I/O automatically yields to query I/O as soon as queries arrive.
+  *
+  * Disabled (the cost is one relaxed atomic load per buffer flush) until the total
+  *  bandwidth is set from the max_disk_io_bandwidth_for_server server config key.
+  */
+class IOScheduler
+{
+public:
+    enum class Class : UInt8
+    {
+        Query = 0,  /// Reads and writes on behalf of queries. The default.
+        Merge,      /// Merges and mutations.
+        Fetch,      /// Sending parts to and fetching parts from replicas.
+        Flush,      /// Background flushes and utility tasks.
+    };
+
+    static constexpr size_t NUM_CLASSES = 4;
+
+    static IOScheduler & instance();
+
+    /// Zero disables scheduling.
+    void setTotalBandwidth(size_t bytes_per_second);
+
+    /// Account a completed read or write under the current thread's class;
+    ///  sleeps if the class is over its current allowance.
+    static void account(size_t bytes)
+    {
+        IOScheduler & scheduler = instance();
+        if (scheduler.total_bandwidth.load(std::memory_order_relaxed))
+            scheduler.request(current_class, bytes);
+    }
+
+    /// Sets the I/O class of the current thread for the lifetime of the object.
+    struct Scope
+    {
+        explicit Scope(Class io_class) : previous(current_class) { current_class = io_class; }
+        ~Scope() { current_class = previous; }
+
+        Class previous;
+    };
+
+private:
+    void request(Class io_class, size_t bytes);
+
+    static thread_local Class current_class;
+
+    std::atomic<size_t> total_bandwidth {0};
+
+    std::mutex mutex;
+    /// Bytes a class may spend without waiting. Negative - the class owes bandwidth and its threads sleep.
+    double tokens[NUM_CLASSES] {};
+    UInt64 prev_refill_ns = 0;
+    Stopwatch watch {CLOCK_MONOTONIC_COARSE};
+};
+
+}
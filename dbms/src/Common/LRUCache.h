@@ -2,6 +2,7 @@
 
 #include <unordered_map>
 #include <list>
+#include <vector>
 #include <memory>
 #include <chrono>
 #include <mutex>
@@ -29,6 +30,11 @@ struct TrivialWeightFunction
 /// Cache starts to evict entries when their total weight exceeds max_size and when expiration time of these
 /// entries is due.
 /// Value weight should not change after insertion.
+///
+/// The cache can be divided into several shards, selected by key hash, each with its own mutex,
+/// so that threads working with different keys do not contend on a single lock.
+/// The memory budget is divided evenly between the shards; eviction is per-shard,
+/// which approximates global LRU well because the key hash spreads keys uniformly.
 template <typename TKey, typename TMapped, typename HashFunction = std::hash<TKey>, typename WeightFunction = TrivialWeightFunction<TMapped>>
 class LRUCache
 {
@@ -43,14 +49,17 @@ private:
     using Timestamp = Clock::time_point;
 
 public:
-    LRUCache(size_t max_size_, const Delay & expiration_delay_ = Delay::zero())
-        : max_size(std::max(static_cast<size_t>(1), max_size_)), expiration_delay(expiration_delay_) {}
+    LRUCache(size_t max_size_, const Delay & expiration_delay_ = Delay::zero(), size_t num_shards_ = 1)
+        : shards(createShards(std::max(static_cast<size_t>(1), num_shards_)))
+        , max_shard_size(std::max(static_cast<size_t>(1), max_size_ / shards.size()))
+        , expiration_delay(expiration_delay_) {}
 
     MappedPtr get(const Key & key)
     {
-        std::lock_guard<std::mutex> lock(mutex);
+        Shard & shard = shardForKey(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
 
-        auto res = getImpl(key, lock);
+        auto res = getImpl(shard, key, lock);
         if (res)
             ++hits;
         else
@@ -61,9 +70,10 @@ public:
 
     void set(const Key & key, const MappedPtr & mapped)
     {
-        std::lock_guard<std::mutex> lock(mutex);
+        Shard & shard = shardForKey(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
 
-        setImpl(key, mapped, lock);
+        setImpl(shard, key, mapped, lock);
     }
 
     /// If the value for the key is in the cache, returns it. If it is not, calls load_func() to
@@ -77,20 +87,22 @@ public:
     template <typename LoadFunc>
     std::pair<MappedPtr, bool> getOrSet(const Key & key, LoadFunc && load_func)
     {
+        Shard & shard = shardForKey(key);
+
         InsertTokenHolder token_holder;
         {
-            std::lock_guard<std::mutex> cache_lock(mutex);
+            std::lock_guard<std::mutex> cache_lock(shard.mutex);
 
-            auto val = getImpl(key, cache_lock);
+            auto val = getImpl(shard, key, cache_lock);
             if (val)
             {
                 ++hits;
                 return std::make_pair(val, false);
             }
 
-            auto & token = insert_tokens[key];
+            auto & token = shard.insert_tokens[key];
             if (!token)
-                token = std::make_shared<InsertToken>(*this);
+                token = std::make_shared<InsertToken>(shard);
 
             token_holder.acquire(&key, token, cache_lock);
         }
@@ -111,15 +123,15 @@ public:
         ++misses;
         token->value = load_func();
 
-        std::lock_guard<std::mutex> cache_lock(mutex);
+        std::lock_guard<std::mutex> cache_lock(shard.mutex);
 
         /// Insert the new value only if the token is still in present in insert_tokens.
         /// (The token may be absent because of a concurrent reset() call).
         bool result = false;
-        auto token_it = insert_tokens.find(key);
-        if (token_it != insert_tokens.end() && token_it->second.get() == token)
+        auto token_it = shard.insert_tokens.find(key);
+        if (token_it != shard.insert_tokens.end() && token_it->second.get() == token)
         {
-            setImpl(key, token->value, cache_lock);
+            setImpl(shard, key, token->value, cache_lock);
             result = true;
         }
 
@@ -131,30 +143,42 @@ public:
 
     void getStats(size_t & out_hits, size_t & out_misses) const
     {
-        std::lock_guard<std::mutex> lock(mutex);
         out_hits = hits;
         out_misses = misses;
     }
 
     size_t weight() const
     {
-        std::lock_guard<std::mutex> lock(mutex);
-        return current_size;
+        size_t res = 0;
+        for (const auto & shard : shards)
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            res += shard->current_size;
+        }
+        return res;
     }
 
     size_t count() const
     {
-        std::lock_guard<std::mutex> lock(mutex);
-        return cells.size();
+        size_t res = 0;
+        for (const auto & shard : shards)
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            res += shard->cells.size();
+        }
+        return res;
     }
 
     void reset()
     {
-        std::lock_guard<std::mutex> lock(mutex);
-        queue.clear();
-        cells.clear();
-        insert_tokens.clear();
-        current_size = 0;
+        for (const auto & shard : shards)
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            shard->queue.clear();
+            shard->cells.clear();
+            shard->insert_tokens.clear();
+            shard->current_size = 0;
+        }
         hits = 0;
         misses = 0;
     }
@@ -181,26 +205,44 @@ protected:
 
     using Cells = std::unordered_map<Key, Cell, HashFunction>;
 
-    Cells cells;
+    struct InsertToken;
+    using InsertTokenById = std::unordered_map<Key, std::shared_ptr<InsertToken>, HashFunction>;
+
+    /// An independently locked part of the cache. Keys are distributed between shards by hash.
+    struct Shard
+    {
+        mutable std::mutex mutex;
+
+        Cells cells;
+        LRUQueue queue;
+        InsertTokenById insert_tokens;
+
+        /// Total weight of values in this shard.
+        size_t current_size = 0;
+    };
+
+    const std::vector<std::unique_ptr<Shard>> shards;
+
+    Shard & shardForKey(const Key & key) const
+    {
+        return *shards[HashFunction()(key) % shards.size()];
+    }
 
-    mutable std::mutex mutex;
 private:
 
     /// Represents pending insertion attempt.
     struct InsertToken
     {
-        explicit InsertToken(LRUCache & cache_) : cache(cache_) {}
+        explicit InsertToken(Shard & shard_) : shard(shard_) {}
 
         std::mutex mutex;
         bool cleaned_up = false; /// Protected by the token mutex
         MappedPtr value; /// Protected by the token mutex
 
-        LRUCache & cache;
-        size_t refcount = 0; /// Protected by the cache mutex
+        Shard & shard;
+        size_t refcount = 0; /// Protected by the shard mutex
     };
 
-    using InsertTokenById = std::unordered_map<Key, std::shared_ptr<InsertToken>, HashFunction>;
-
     /// This class is responsible for removing used insert tokens from the insert_tokens map.
     /// Among several concurrent threads the first successful one is responsible for removal. But if they all
     /// fail, then the last one is responsible.
@@ -221,7 +263,7 @@ private:
 
         void cleanup([[maybe_unused]] std::lock_guard<std::mutex> & token_lock, [[maybe_unused]] std::lock_guard<std::mutex> & cache_lock)
         {
-            token->cache.insert_tokens.erase(*key);
+            token->shard.insert_tokens.erase(*key);
             token->cleaned_up = true;
             cleaned_up = true;
         }
@@ -239,7 +281,7 @@ private:
             if (token->cleaned_up)
                 return;
 
-            std::lock_guard<std::mutex> cache_lock(token->cache.mutex);
+            std::lock_guard<std::mutex> cache_lock(token->shard.mutex);
 
             --token->refcount;
             if (token->refcount == 0)
@@ -250,13 +292,8 @@ private:
     friend struct InsertTokenHolder;
 
 
-    InsertTokenById insert_tokens;
-
-    LRUQueue queue;
-
-    /// Total weight of values.
-    size_t current_size = 0;
-    const size_t max_size;
+    /// Per-shard part of the total memory budget.
+    const size_t max_shard_size;
     const Delay expiration_delay;
 
     std::atomic<size_t> hits {0};
@@ -264,10 +301,19 @@ private:
 
     WeightFunction weight_function;
 
-    MappedPtr getImpl(const Key & key, [[maybe_unused]] std::lock_guard<std::mutex> & cache_lock)
+    static std::vector<std::unique_ptr<Shard>> createShards(size_t num_shards)
+    {
+        std::vector<std::unique_ptr<Shard>> res;
+        res.reserve(num_shards);
+        for (size_t i = 0; i < num_shards; ++i)
+            res.emplace_back(std::make_unique<Shard>());
+        return res;
+    }
+
+    MappedPtr getImpl(Shard & shard, const Key & key, [[maybe_unused]] std::lock_guard<std::mutex> & cache_lock)
     {
-        auto it = cells.find(key);
-        if (it == cells.end())
+        auto it = shard.cells.find(key);
+        if (it == shard.cells.end())
         {
             return MappedPtr();
         }
@@ -276,14 +322,14 @@ private:
         updateCellTimestamp(cell);
 
         /// Move the key to the end of the queue. The iterator remains valid.
-        queue.splice(queue.end(), queue, cell.queue_iterator);
+        shard.queue.splice(shard.queue.end(), shard.queue, cell.queue_iterator);
 
         return cell.value;
     }
 
-    void setImpl(const Key & key, const MappedPtr & mapped, [[maybe_unused]] std::lock_guard<std::mutex> & cache_lock)
+    void setImpl(Shard & shard, const Key & key, const MappedPtr & mapped, [[maybe_unused]] std::lock_guard<std::mutex> & cache_lock)
     {
-        auto res = cells.emplace(std::piecewise_construct,
+        auto res = shard.cells.emplace(std::piecewise_construct,
             std::forward_as_tuple(key),
             std::forward_as_tuple());
 
@@ -292,20 +338,20 @@ private:
 
         if (inserted)
         {
-            cell.queue_iterator = queue.insert(queue.end(), key);
+            cell.queue_iterator = shard.queue.insert(shard.queue.end(), key);
         }
         else
         {
-            current_size -= cell.size;
-            queue.splice(queue.end(), queue, cell.queue_iterator);
+            shard.current_size -= cell.size;
+            shard.queue.splice(shard.queue.end(), shard.queue, cell.queue_iterator);
         }
 
         cell.value = mapped;
         cell.size = cell.value ? weight_function(*cell.value) : 0;
-        current_size += cell.size;
+        shard.current_size += cell.size;
         updateCellTimestamp(cell);
 
-        removeOverflow(cell.timestamp);
+        removeOverflow(shard, cell.timestamp);
     }
 
     void updateCellTimestamp(Cell & cell)
@@ -314,16 +360,16 @@ private:
             cell.timestamp = Clock::now();
     }
 
-    void removeOverflow(const Timestamp & last_timestamp)
+    void removeOverflow(Shard & shard, const Timestamp & last_timestamp)
     {
         size_t current_weight_lost = 0;
-        size_t queue_size = cells.size();
-        while ((current_size > max_size) && (queue_size > 1))
+        size_t queue_size = shard.cells.size();
+        while ((shard.current_size > max_shard_size) && (queue_size > 1))
         {
-            const Key & key = queue.front();
+            const Key & key = shard.queue.front();
 
-            auto it = cells.find(key);
-            if (it == cells.end())
+            auto it = shard.cells.find(key);
+            if (it == shard.cells.end())
             {
                 LOG_ERROR(&Logger::get("LRUCache"), "LRUCache became inconsistent. There must be a bug in it.");
                 abort();
@@ -333,17 +379,17 @@ private:
             if (!cell.expired(last_timestamp, expiration_delay))
                 break;
 
-            current_size -= cell.size;
+            shard.current_size -= cell.size;
             current_weight_lost += cell.size;
 
-            cells.erase(it);
-            queue.pop_front();
+            shard.cells.erase(it);
+            shard.queue.pop_front();
             --queue_size;
         }
 
         onRemoveOverflowWeightLoss(current_weight_lost);
 
-        if (current_size > (1ull << 63))
+        if (shard.current_size > (1ull << 63))
         {
             LOG_ERROR(&Logger::get("LRUCache"), "LRUCache became inconsistent. There must be a bug in it.");
             abort();
@@ -111,6 +111,14 @@ void MemoryTracker::alloc(Int64 size)
         throw DB::Exception(message.str(), DB::ErrorCodes::MEMORY_LIMIT_EXCEEDED);
     }
 
+    Int64 current_soft_limit = soft_limit.load(std::memory_order_relaxed);
+    if (unlikely(current_soft_limit && will_be > current_soft_limit))
+    {
+        /// Allocations are not failed: consumers polling isMemoryPressure are expected to start releasing memory.
+        if (soft_limit_callback && !soft_limit_crossed.exchange(true, std::memory_order_relaxed))
+            soft_limit_callback();
+    }
+
     auto peak_old = peak.load(std::memory_order_relaxed);
     if (will_be > peak_old)        /// Races doesn't matter. Could rewrite with CAS, but not worth.
     {
@@ -150,6 +158,11 @@ void MemoryTracker::free(Int64 size)
             amount.fetch_sub(new_amount);
             size += new_amount;
         }
+
+        /// Rearm the soft limit callback when consumption goes back under the limit.
+        if (unlikely(soft_limit_crossed.load(std::memory_order_relaxed))
+            && new_amount <= soft_limit.load(std::memory_order_relaxed))
+            soft_limit_crossed.store(false, std::memory_order_relaxed);
     }
 
     if (auto loaded_next = parent.load(std::memory_order_relaxed))
@@ -165,6 +178,9 @@ void MemoryTracker::resetCounters()
     amount.store(0, std::memory_order_relaxed);
     peak.store(0, std::memory_order_relaxed);
     limit.store(0, std::memory_order_relaxed);
+    soft_limit.store(0, std::memory_order_relaxed);
+    pressure_requested.store(false, std::memory_order_relaxed);
+    soft_limit_crossed.store(false, std::memory_order_relaxed);
 }
 
 
@@ -186,6 +202,14 @@ void MemoryTracker::setOrRaiseLimit(Int64 value)
 }
 
 
+void MemoryTracker::setOrRaiseSoftLimit(Int64 value)
+{
+    Int64 old_value = soft_limit.load(std::memory_order_relaxed);
+    while (old_value < value && !soft_limit.compare_exchange_weak(old_value, value))
+        ;
+}
+
+
 namespace CurrentMemoryTracker
 {
     void alloc(Int64 size)
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <atomic>
+#include <functional>
 #include <common/Types.h>
 #include <Common/CurrentMetrics.h>
 #include <Common/SimpleActionBlocker.h>
@@ -10,12 +11,27 @@
 /** Tracks memory consumption.
   * It throws an exception if amount of consumed memory become greater than certain limit.
   * The same memory tracker could be simultaneously used in different threads.
+  *
+  * Besides the hard limit, a soft limit can be set. Crossing it does not fail allocations:
+  *  it invokes a callback (once per crossing) and raises a "memory pressure" flag that
+  *  consumers able to release memory (spill to disk, shrink caches) are expected to poll,
+  *  so they can start freeing memory before the hard limit kills the query.
   */
 class MemoryTracker
 {
     std::atomic<Int64> amount {0};
     std::atomic<Int64> peak {0};
     std::atomic<Int64> limit {0};
+    std::atomic<Int64> soft_limit {0};
+
+    /// Set when the soft limit is crossed or by an external arbiter (see ProcessList); polled by consumers.
+    std::atomic<bool> pressure_requested {false};
+    /// Latch so that soft_limit_callback is called once per crossing; rearmed in `free` when usage goes back under the soft limit.
+    std::atomic<bool> soft_limit_crossed {false};
+
+    /// Called from the allocating thread when consumption crosses the soft limit.
+    /// Must be set before the tracker is shared between threads and must not allocate under this tracker.
+    std::function<void()> soft_limit_callback;
 
     /// To test exception safety of calling code, memory tracker throws an exception on each memory allocation with specified probability.
     double fault_probability = 0;
@@ -62,6 +78,11 @@ public:
         return peak.load(std::memory_order_relaxed);
     }
 
+    Int64 getLimit() const
+    {
+        return limit.load(std::memory_order_relaxed);
+    }
+
     void setLimit(Int64 limit_)
     {
         limit.store(limit_, std::memory_order_relaxed);
@@ -72,6 +93,34 @@ public:
       */
     void setOrRaiseLimit(Int64 value);
 
+    Int64 getSoftLimit() const
+    {
+        return soft_limit.load(std::memory_order_relaxed);
+    }
+
+    /// Like setOrRaiseLimit, but for the soft limit.
+    void setOrRaiseSoftLimit(Int64 value);
+
+    void setSoftLimitCallback(std::function<void()> callback)
+    {
+        soft_limit_callback = std::move(callback);
+    }
+
+    /// Ask the consumers accounted by this tracker to release memory.
+    void requestPressure()
+    {
+        pressure_requested.store(true, std::memory_order_relaxed);
+    }
+
+    /// Should consumers start to release memory (spill to disk, shrink)?
+    /// True while consumption is over the soft limit or after requestPressure was called.
+    bool isMemoryPressure() const
+    {
+        Int64 current_soft_limit = soft_limit.load(std::memory_order_relaxed);
+        return (current_soft_limit && amount.load(std::memory_order_relaxed) > current_soft_limit)
+            || pressure_requested.load(std::memory_order_relaxed);
+    }
+
     void setFaultProbability(double value)
     {
         fault_probability = value;
@@ -0,0 +1,132 @@
+#include <Common/NUMA.h>
+
+#include <atomic>
+
+#if defined(__linux__)
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+#endif
+
+
+namespace DB
+{
+
+static std::atomic<bool> numa_thread_placement_enabled {false};
+
+void setNUMAThreadPlacement(bool enable)
+{
+    numa_thread_placement_enabled.store(enable, std::memory_order_relaxed);
+}
+
+
+#if defined(__linux__)
+
+namespace
+{
+
+struct NUMATopology
+{
+    /// One affinity mask per NUMA node that has CPUs. Empty if the topology could not be read.
+    std::vector<cpu_set_t> node_masks;
+
+    NUMATopology()
+    {
+        for (size_t node = 0;; ++node)
+        {
+            std::ifstream cpulist_file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            if (!cpulist_file.is_open())
+                break;
+
+            std::string cpulist;
+            cpulist_file >> cpulist;
+
+            /// Comma-separated list of CPU ranges, e.g. "0-31,64-95".
+            cpu_set_t mask;
+            CPU_ZERO(&mask);
+            const char * pos = cpulist.c_str();
+            while (*pos)
+            {
+                char * end = nullptr;
+                unsigned long first = std::strtoul(pos, &end, 10);
+                unsigned long last = first;
+                if (*end == '-')
+                {
+                    pos = end + 1;
+                    last = std::strtoul(pos, &end, 10);
+                }
+
+                for (unsigned long cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu)
+                    CPU_SET(cpu, &mask);
+
+                if (*end != ',')
+                    break;
+                pos = end + 1;
+            }
+
+            if (CPU_COUNT(&mask))
+                node_masks.push_back(mask);
+        }
+    }
+};
+
+const NUMATopology & getNUMATopology()
+{
+    static NUMATopology topology;
+    return topology;
+}
+
+}
+
+
+size_t getNumberOfNUMANodes()
+{
+    size_t num_nodes = getNUMATopology().node_masks.size();
+    return num_nodes ? num_nodes : 1;
+}
+
+
+NUMANodeBinding::NUMANodeBinding(size_t index)
+{
+    if (!numa_thread_placement_enabled.load(std::memory_order_relaxed))
+        return;
+
+    const auto & node_masks = getNUMATopology().node_masks;
+    if (node_masks.size() < 2)
+        return;
+
+    if (0 != sched_getaffinity(0, sizeof(previous_mask), &previous_mask))
+        return;
+
+    const cpu_set_t & node_mask = node_masks[index % node_masks.size()];
+    if (0 != sched_setaffinity(0, sizeof(node_mask), &node_mask))
+        return;
+
+    bound = true;
+}
+
+NUMANodeBinding::~NUMANodeBinding()
+{
+    if (bound)
+        sched_setaffinity(0, sizeof(previous_mask), &previous_mask);
+}
+
+#else
+
+size_t getNumberOfNUMANodes()
+{
+    return 1;
+}
+
+NUMANodeBinding::NUMANodeBinding(size_t)
+{
+}
+
+NUMANodeBinding::~NUMANodeBinding()
+{
+}
+
+#endif
+
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+
+namespace DB
+{
+
+/** Minimal view of the NUMA topology of the machine, read from /sys on Linux.
+  * On other systems (or when NUMA is disabled in the kernel) there is a single node
+  *  and thread binding is a no-op.
+  */
+
+/// Number of NUMA nodes with CPUs. Always at least 1.
+size_t getNumberOfNUMANodes();
+
+/// Enables or disables thread placement (set from the numa_aware_thread_placement server config key).
+void setNUMAThreadPlacement(bool enable);
+
+/** Binds the current thread to the CPUs of one NUMA node for the lifetime of the object
+  *  and restores the previous affinity mask on destruction
+  *  (important: the threads are reused through the global thread pool).
+  * The node is chosen round-robin by the passed index.
+  * Does nothing on single-node machines, when placement is disabled,
+  *  or when the kernel rejects the mask (e.g. the affinity is restricted by cgroups) - best effort.
+  */
+class NUMANodeBinding
+{
+public:
+    explicit NUMANodeBinding(size_t index);
+    ~NUMANodeBinding();
+
+    NUMANodeBinding(const NUMANodeBinding &) = delete;
+    NUMANodeBinding & operator=(const NUMANodeBinding &) = delete;
+
+private:
+#if defined(__linux__)
+    bool bound = false;
+    cpu_set_t previous_mask;
+#endif
+};
+
+}
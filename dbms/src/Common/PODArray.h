@@ -57,6 +57,10 @@ protected:
     char * c_end            = nullptr;
     char * c_end_of_storage = nullptr;    /// Does not include pad_right.
 
+    /// The memory is a view over an external buffer (see assignBorrowedMemory):
+    ///  it is not freed on destruction, and the first growth copies the data out into an own allocation.
+    bool borrowed = false;
+
     T * t_start()                      { return reinterpret_cast<T *>(c_start); }
     T * t_end()                        { return reinterpret_cast<T *>(c_end); }
     T * t_end_of_storage()             { return reinterpret_cast<T *>(c_end_of_storage); }
@@ -85,7 +89,7 @@ protected:
 
     void dealloc()
     {
-        if (c_start == nullptr)
+        if (c_start == nullptr || borrowed)
             return;
 
         TAllocator::free(c_start, allocated_bytes());
@@ -100,6 +104,19 @@ protected:
             return;
         }
 
+        if (borrowed)
+        {
+            /// Detach from the external buffer: copy the data out into an own allocation.
+            ptrdiff_t borrowed_end_diff = c_end - c_start;
+            char * borrowed_start = c_start;
+
+            alloc(bytes, std::forward<TAllocatorParams>(allocator_params)...);
+            memcpy(c_start, borrowed_start, borrowed_end_diff);
+            c_end = c_start + borrowed_end_diff;
+            borrowed = false;
+            return;
+        }
+
         ptrdiff_t end_diff = c_end - c_start;
 
         c_start = reinterpret_cast<char *>(TAllocator::realloc(c_start, allocated_bytes(), bytes, std::forward<TAllocatorParams>(allocator_params)...));
@@ -231,6 +248,21 @@ public:
         c_end = c_start + byte_size(n);
     }
 
+    /** Use a range of external memory as the contents of the array, without copying.
+      * The memory is not freed on destruction and must stay valid for the lifetime of the array.
+      * It must be possible to read pad_right bytes after `end`.
+      * The first operation that needs to grow the array (the capacity is set equal to the size)
+      *  copies the data out into an own allocation and forgets the external memory.
+      */
+    void assignBorrowedMemory(const char * begin, const char * end)
+    {
+        dealloc();
+        c_start = const_cast<char *>(begin);
+        c_end = const_cast<char *>(end);
+        c_end_of_storage = c_end;
+        borrowed = true;
+    }
+
     /// Same as resize, but zeroes new elements.
     void resize_fill(size_t n)
     {
@@ -340,6 +372,8 @@ public:
 
     void swap(PODArray & rhs)
     {
+        std::swap(borrowed, rhs.borrowed);
+
         /// Swap two PODArray objects, arr1 and arr2, that satisfy the following conditions:
         /// - The elements of arr1 are stored on stack.
         /// - The elements of arr2 are stored on heap.
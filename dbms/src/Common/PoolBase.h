@@ -139,6 +139,18 @@ public:
             items.emplace_back(std::make_shared<PooledObject>(allocObject(), *this));
     }
 
+    /** Number of objects currently handed out to clients. */
+    size_t getInUseCount() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        size_t res = 0;
+        for (const auto & item : items)
+            if (item->in_use)
+                ++res;
+        return res;
+    }
+
 private:
     /** The maximum size of the pool. */
     unsigned max_items;
@@ -147,7 +159,7 @@ private:
     Objects items;
 
     /** Lock to access the pool. */
-    std::mutex mutex;
+    mutable std::mutex mutex;
     std::condition_variable available;
 
 protected:
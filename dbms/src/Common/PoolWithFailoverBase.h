@@ -34,7 +34,10 @@ namespace ProfileEvents
 /// This class provides a pool with fault tolerance. It is used for pooling of connections to replicated DB.
 /// Initialized by several PoolBase objects.
 /// When a connection is requested, tries to create or choose an alive connection from one of the nested pools.
-/// Pools are tried in the order consistent with lexicographical order of (error count, priority, random number) tuples.
+/// Pools are tried in the order consistent with lexicographical order of
+///  (error count, priority, in-flight connection count, random number) tuples.
+/// The in-flight count is a crude load estimate of the replica as seen by this initiator
+///  and is bucketed so that a difference of a single query does not flap the choice.
 /// Number of tries for a single pool is limited by max_tries parameter.
 /// The client can set nested pool priority by passing a GetPriority functor.
 ///
@@ -165,6 +168,13 @@ PoolWithFailoverBase<TNestedPool>::getMany(
             pool_states[i].priority = get_priority(i);
     }
 
+    /// Take the current load of each replica into account: among equally ranked pools, prefer the one
+    ///  with fewer connections checked out by this initiator. A replica slowed down by background merges
+    ///  holds its connections longer and thus automatically receives less new traffic.
+    /// Coarse bucketing adds hysteresis: a difference of a single in-flight query does not reorder pools.
+    for (size_t i = 0; i < pool_states.size(); ++i)
+        pool_states[i].in_flight_bucket = nested_pools[i]->getInUseCount() / 2;
+
     struct ShuffledPool
     {
         NestedPool * pool;
@@ -313,6 +323,9 @@ struct PoolWithFailoverBase<TNestedPool>::PoolState
 {
     UInt64 error_count = 0;
     Int64 priority = 0;
+    /// Bucketed number of connections currently checked out from the pool. Not a part of the
+    ///  shared state: recalculated from the nested pools on every getMany() call.
+    UInt64 in_flight_bucket = 0;
     UInt32 random = 0;
 
     void randomize()
@@ -322,8 +335,8 @@ struct PoolWithFailoverBase<TNestedPool>::PoolState
 
     static bool compare(const PoolState & lhs, const PoolState & rhs)
     {
-        return std::forward_as_tuple(lhs.error_count, lhs.priority, lhs.random)
-            < std::forward_as_tuple(rhs.error_count, rhs.priority, rhs.random);
+        return std::forward_as_tuple(lhs.error_count, lhs.priority, lhs.in_flight_bucket, lhs.random)
+            < std::forward_as_tuple(rhs.error_count, rhs.priority, rhs.in_flight_bucket, rhs.random);
     }
 
 private:
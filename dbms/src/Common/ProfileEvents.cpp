@@ -3,6 +3,8 @@
 #include <Common/typeid_cast.h>
 #include <Columns/ColumnArray.h>
 
+#include <mutex>
+
 /// Available events. Add something here as you wish.
 #define APPLY_FOR_EVENTS(M) \
     M(Query, "Number of queries started to be interpreted and maybe executed. Does not include queries that are failed to parse, that are rejected due to AST size limits; rejected due to quota limits or limits on number of simultaneously running queries. May include internal queries initiated by ClickHouse itself. Does not count subqueries.") \
@@ -18,24 +20,49 @@
     M(WriteBufferFromFileDescriptorWriteBytes, "Number of bytes written to file descriptors. If the file is compressed, this will show compressed data size.") \
     M(ReadBufferAIORead, "") \
     M(ReadBufferAIOReadBytes, "") \
+    M(ReadBufferIOUringRead, "") \
+    M(ReadBufferIOUringReadBytes, "") \
     M(WriteBufferAIOWrite, "") \
     M(WriteBufferAIOWriteBytes, "") \
     M(ReadCompressedBytes, "") \
     M(CompressedReadBufferBlocks, "") \
     M(CompressedReadBufferBytes, "") \
+    M(CompressedChecksumVerifiedBytes, "Number of bytes of compressed blocks whose checksum was actually computed and verified (on any thread).") \
+    M(CompressedChecksumDeferredBytes, "Number of bytes of compressed blocks whose checksum verification was taken off the reading thread and deferred to a background thread.") \
     M(UncompressedCacheHits, "") \
     M(UncompressedCacheMisses, "") \
     M(UncompressedCacheWeightLost, "") \
+    M(CompressedBlockCacheHits, "") \
+    M(CompressedBlockCacheMisses, "") \
+    M(CompressedBlockCacheWeightLost, "") \
+    M(CompressedBlockCacheRejectedInserts, "Number of compressed blocks not inserted into the cache of compressed blocks because the admission filter had not seen them accessed before.") \
+    M(MMappedFileCacheHits, "") \
+    M(MMappedFileCacheMisses, "") \
     M(IOBufferAllocs, "") \
     M(IOBufferAllocBytes, "") \
     M(ArenaAllocChunks, "") \
     M(ArenaAllocBytes, "") \
+    M(MMapRegionCacheHits, "Number of times a large (mmap-ed) allocation was served from the global pool of recycled regions.") \
+    M(MMapRegionCacheMisses, "Number of times a large allocation had to mmap a fresh region.") \
+    M(ThreadAllocationCacheHits, "Number of times a medium-sized allocation (e.g. a column buffer) was served from the thread-local free lists.") \
+    M(ThreadAllocationCacheMisses, "Number of times a medium-sized allocation went to malloc because no suitable chunk was cached.") \
+    M(AsyncInsertQuery, "Number of INSERT queries whose data went into the asynchronous insert staging buffers.") \
+    M(AsyncInsertFlush, "Number of flushes of asynchronous insert staging buffers into tables.") \
     M(FunctionExecute, "") \
     M(TableFunctionExecute, "") \
     M(MarkCacheHits, "") \
     M(MarkCacheMisses, "") \
+    M(QueryResultCacheHits, "") \
+    M(QueryResultCacheMisses, "") \
+    M(SubqueryResultCacheHits, "") \
+    M(SubqueryResultCacheMisses, "") \
+    M(QueryParseCacheHits, "") \
+    M(QueryParseCacheMisses, "") \
     M(CreatedReadBufferOrdinary, "") \
     M(CreatedReadBufferAIO, "") \
+    M(CreatedReadBufferIOUring, "") \
+    M(CreatedReadBufferMMap, "") \
+    M(CreatedReadBufferMMapFailed, "") \
     M(CreatedWriteBufferOrdinary, "") \
     M(CreatedWriteBufferAIO, "") \
     M(DiskReadElapsedMicroseconds, "Total time spent waiting for read syscall. This include reads from page cache.") \
@@ -43,6 +70,7 @@
     M(NetworkReceiveElapsedMicroseconds, "") \
     M(NetworkSendElapsedMicroseconds, "") \
     M(ThrottlerSleepMicroseconds, "Total time a query was sleeping to conform the 'max_network_bandwidth' setting.") \
+    M(IOSchedulerSleepMicroseconds, "Total time threads were sleeping in the disk I/O scheduler because their I/O class was over its bandwidth allowance.") \
     \
     M(ReplicatedPartFetches, "Number of times a data part was downloaded from replica of a ReplicatedMergeTree table.") \
     M(ReplicatedPartFailedFetches, "") \
@@ -84,24 +112,35 @@
     M(DistributedConnectionMissingTable, "") \
     M(DistributedConnectionStaleReplica, "") \
     M(DistributedConnectionFailAtAll, "") \
+    M(HedgedRequests, "Number of times a duplicate query was sent to an additional replica because the first replica was slow to send data.") \
+    M(HedgedRequestsWon, "Number of times the additional replica of a hedged request was the first to send data and became the source of the result.") \
     \
     M(CompileAttempt, "Number of times a compilation of generated C++ code was initiated.") \
     M(CompileSuccess, "Number of times a compilation of generated C++ code was successful.") \
     \
     M(CompileFunction, "Number of times a compilation of generated LLVM code (to create fused function for complex expressions) was initiated.") \
     M(CompiledFunctionExecute, "Number of times a compiled function was executed.") \
+    M(CompileAggregateFunctions, "Number of times a compilation of the fused LLVM add loop over aggregate functions was initiated.") \
     M(CompileExpressionsMicroseconds, "Total time spent for compilation of expressions to LLVM code.") \
     M(CompileExpressionsBytes, "Number of bytes used for expressions compilation.") \
     \
+    M(TargetSpecificKernelDefault, "Number of times a multi-versioned function kernel ran the default (baseline target) implementation.") \
+    M(TargetSpecificKernelAVX2, "Number of times a multi-versioned function kernel ran its AVX2 implementation.") \
+    M(TargetSpecificKernelAVX512, "Number of times a multi-versioned function kernel ran its AVX-512 implementation.") \
+    \
     M(ExternalSortWritePart, "") \
     M(ExternalSortMerge, "") \
     M(ExternalAggregationWritePart, "") \
     M(ExternalAggregationMerge, "") \
     M(ExternalAggregationCompressedBytes, "") \
     M(ExternalAggregationUncompressedBytes, "") \
+    M(ExternalDistinctWritePart, "") \
+    M(ExternalDistinctMerge, "") \
     \
     M(SlowRead, "Number of reads from a file that were slow. This indicate system overload. Thresholds are controlled by read_backoff_* settings.") \
     M(ReadBackoff, "Number of times the number of query processing threads was lowered due to slow reads.") \
+    M(ReadTasksStolen, "Number of read tasks a scan thread took over from another thread's queue after exhausting its own. High values relative to the number of read tasks indicate skewed mark-range assignment.") \
+    M(ReadTasksShrunk, "Number of read tasks handed out smaller than min_marks_for_concurrent_read towards the end of a scan, to even out the tail.") \
     \
     M(ReplicaYieldLeadership, "Number of times Replicated table was yielded its leadership due to large replication lag relative to other replicas.") \
     M(ReplicaPartialShutdown, "") \
@@ -109,11 +148,24 @@
     M(SelectedParts, "Number of data parts selected to read from a MergeTree table.") \
     M(SelectedRanges, "Number of (non-adjacent) ranges in all data parts selected to read from a MergeTree table.") \
     M(SelectedMarks, "Number of marks (index granules) selected to read from a MergeTree table.") \
+    M(PartsPrunedByPartitionIndex, "Number of data parts of a MergeTree table skipped entirely by the min-max index of the partition columns.") \
+    M(MarksSkippedByPrimaryKey, "Number of marks (index granules) of a MergeTree table skipped by the primary key condition.") \
+    M(MarksSkippedByGranuleMinMaxIndex, "Number of marks (index granules) of a MergeTree table skipped by per-granule min-max skip indices after primary key selection.") \
+    M(MarksSkippedByGranuleNgramIndex, "Number of marks (index granules) of a MergeTree table skipped by per-granule n-gram bloom filter indices on String columns.") \
+    M(MarksSkippedByProjection, "Number of marks (index granules) of a MergeTree table skipped by the primary index of the projection layout.") \
+    M(SamplingRequestedRows, "Estimated number of rows requested by the SAMPLE clause: the rows of the data parts considered for reading multiplied by the sample fraction.") \
+    M(SamplingSelectedRows, "Estimated number of rows selected for reading by the SAMPLE clause, counted in whole granules. The ratio to SamplingRequestedRows shows the achieved sample fraction.") \
+    M(SamplingRowLevelFilterSkipped, "Number of queries where the row-level sampling filter was dropped because the primary index proved that all selected granules lie entirely within the sample.") \
     \
     M(MergedRows, "Rows read for background merges. This is the number of rows before merge.") \
     M(MergedUncompressedBytes, "Uncompressed bytes (for columns as they stored in memory) that was read for background merges. This is the number before merge.") \
     M(MergesTimeMilliseconds, "Total time spent for background merges.")\
     \
+    M(BackgroundPoolMergeMutateTask, "Number of background pool task executions doing merges and mutations (for replicated tables - the whole replication queue).") \
+    M(BackgroundPoolFetchTask, "Number of background pool task executions fetching parts from other replicas.") \
+    M(BackgroundPoolUtilityTask, "Number of background pool task executions doing auxiliary periodic work.") \
+    M(BackgroundPoolTemporaryThread, "Number of temporary threads taken from the global pool to drain a backlog of ready background tasks.") \
+    \
     M(MergeTreeDataWriterRows, "Number of rows INSERTed to MergeTree tables.") \
     M(MergeTreeDataWriterUncompressedBytes, "Uncompressed bytes (for columns as they stored in memory) INSERTed to MergeTree tables.") \
     M(MergeTreeDataWriterCompressedBytes, "Bytes written to filesystem for data INSERTed to MergeTree tables.") \
@@ -124,6 +176,10 @@
     M(LeaderElectionAcquiredLeadership, "Number of times a ReplicatedMergeTree table became a leader. Leader replica is responsible for assigning merges, cleaning old blocks for deduplications and a few more bookkeeping tasks.") \
     \
     M(RegexpCreated, "Compiled regular expressions. Identical regular expressions compiled just once and cached forever.") \
+    \
+    M(UDFExecuteCalls, "Number of times a user-defined function from a shared library (the udf_libraries config section) was executed on a block.") \
+    M(UDFExecuteRows, "Number of rows processed by user-defined functions from shared libraries.") \
+    M(UDFExecuteMicroseconds, "Total time spent inside user-defined functions from shared libraries.") \
     M(ContextLock, "Number of times the lock of Context was acquired or tried to acquire. This is global lock.") \
     \
     M(StorageBufferFlush, "") \
@@ -188,26 +244,146 @@ Counters global_counters(global_counters_array);
 const Event Counters::num_counters = END;
 
 
+/** Guards the parent-child links of all Counters. Links only change on thread
+  *  attach/detach and on construction/destruction, so a single mutex is enough.
+  */
+static std::mutex counters_hierarchy_mutex;
+
+
 Counters::Counters(VariableContext level, Counters * parent)
     : counters_holder(new Counter[num_counters] {}),
       parent(parent),
       level(level)
 {
     counters = counters_holder.get();
+
+    if (level == VariableContext::Thread)
+    {
+        flushed_holder.reset(new Counter[num_counters] {});
+        flushed = flushed_holder.get();
+    }
+
+    if (parent)
+    {
+        std::lock_guard<std::mutex> lock(counters_hierarchy_mutex);
+        parent->children.push_back(this);
+    }
+}
+
+Counters::~Counters()
+{
+    /// Snapshots (the common case for destruction) are not linked to anything.
+    if (!parent && children.empty())
+        return;
+
+    std::lock_guard<std::mutex> lock(counters_hierarchy_mutex);
+
+    /// Normally there are no children left at this point. Hand the remaining ones
+    ///  over to our parent, saving their not-yet-propagated increments.
+    for (auto * child : children)
+    {
+        child->flushDeltasToParent();
+        child->parent = parent;
+        if (parent)
+            parent->children.push_back(child);
+    }
+    children.clear();
+
+    if (parent)
+    {
+        flushDeltasToParent();
+        parent->unregisterChild(this);
+    }
+}
+
+void Counters::flushDeltasToParent()
+{
+    if (level != VariableContext::Thread || !parent)
+        return;
+
+    for (Event i = 0; i < num_counters; ++i)
+    {
+        Count total = counters[i].load(std::memory_order_relaxed);
+        Count delta = total - flushed[i].load(std::memory_order_relaxed);
+        if (delta)
+        {
+            /// The parent is not a thread-level block, so this walks the whole chain.
+            parent->increment(i, delta);
+            flushed[i].store(total, std::memory_order_relaxed);
+        }
+    }
+}
+
+void Counters::addDeltasOfChildren(Counter * dest) const
+{
+    for (const auto * child : children)
+    {
+        if (child->level == VariableContext::Thread)
+        {
+            for (Event i = 0; i < num_counters; ++i)
+            {
+                Count delta = child->counters[i].load(std::memory_order_relaxed) - child->flushed[i].load(std::memory_order_relaxed);
+                if (delta)
+                    dest[i].store(dest[i].load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+            }
+        }
+
+        child->addDeltasOfChildren(dest);
+    }
+}
+
+void Counters::unregisterChild(Counters * child)
+{
+    for (auto it = children.begin(); it != children.end(); ++it)
+    {
+        if (*it == child)
+        {
+            children.erase(it);
+            return;
+        }
+    }
+}
+
+void Counters::setParent(Counters * parent_)
+{
+    if (parent == parent_)
+        return;
+
+    std::lock_guard<std::mutex> lock(counters_hierarchy_mutex);
+
+    flushDeltasToParent();
+
+    if (parent)
+        parent->unregisterChild(this);
+
+    parent = parent_;
+
+    if (parent)
+        parent->children.push_back(this);
 }
 
 void Counters::resetCounters()
 {
-    if (counters)
+    if (!counters)
+        return;
+
+    if (level == VariableContext::Thread && parent)
+    {
+        std::lock_guard<std::mutex> lock(counters_hierarchy_mutex);
+        flushDeltasToParent();
+    }
+
+    for (Event i = 0; i < num_counters; ++i)
     {
-        for (Event i = 0; i < num_counters; ++i)
-            counters[i].store(0, std::memory_order_relaxed);
+        counters[i].store(0, std::memory_order_relaxed);
+        if (flushed)
+            flushed[i].store(0, std::memory_order_relaxed);
     }
 }
 
 void Counters::reset()
 {
-    parent = nullptr;
+    setParent(nullptr);
     resetCounters();
 }
 
@@ -216,6 +392,13 @@ Counters Counters::getPartiallyAtomicSnapshot() const
     Counters res(VariableContext::Snapshot, nullptr);
     for (Event i = 0; i < num_counters; ++i)
         res.counters[i].store(counters[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+    /// Pick up increments that thread blocks below this one have not propagated yet.
+    {
+        std::lock_guard<std::mutex> lock(counters_hierarchy_mutex);
+        addDeltasOfChildren(res.counters);
+    }
+
     return res;
 }
 
@@ -3,6 +3,7 @@
 #include <Common/VariableContext.h>
 #include <atomic>
 #include <memory>
+#include <vector>
 #include <stddef.h>
 
 /** Implements global counters for various events happening in the application
@@ -25,9 +26,24 @@ namespace ProfileEvents
     {
         Counter * counters = nullptr;
         std::unique_ptr<Counter[]> counters_holder;
+
+        /** For thread-level blocks: how much of each counter has already been propagated
+          *  to the parent chain. The difference counters[i] - flushed[i] is what snapshots
+          *  of the parents add lazily; it is pushed up the chain when the thread re-parents
+          *  (query attach/detach), resets its counters or dies.
+          */
+        Counter * flushed = nullptr;
+        std::unique_ptr<Counter[]> flushed_holder;
+
         /// Used to propagate increments
         Counters * parent = nullptr;
 
+        /** Blocks that have this one as a parent: snapshots walk them to pick up increments
+          *  that thread blocks have not propagated yet. Guarded by a global mutex (see .cpp) -
+          *  (de)registration only happens on thread attach/detach and (de)struction.
+          */
+        std::vector<Counters *> children;
+
     public:
 
         VariableContext level = VariableContext::Thread;
@@ -39,6 +55,12 @@ namespace ProfileEvents
         Counters(Counter * allocated_counters)
             : counters(allocated_counters), parent(nullptr), level(VariableContext::Global) {}
 
+        /// Only valid for blocks that are not registered with a parent (i.e. snapshots):
+        ///  a registered block is pointed to by its parent and cannot change address.
+        Counters(Counters &&) = default;
+
+        ~Counters();
+
         Counter & operator[] (Event event)
         {
             return counters[event];
@@ -51,6 +73,17 @@ namespace ProfileEvents
 
         inline void increment(Event event, Count amount = 1)
         {
+            if (level == VariableContext::Thread)
+            {
+                /** A thread-level block has a single writer - its own thread. A plain
+                  *  read-modify-write avoids both the atomic RMW and the cache line ping-pong
+                  *  on the shared parent counters, which dominate tight loops on many cores.
+                  * Parents pick the increments up lazily, on snapshots or when the thread re-parents.
+                  */
+                counters[event].store(counters[event].load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+                return;
+            }
+
             Counters * current = this;
             do
             {
@@ -60,6 +93,7 @@ namespace ProfileEvents
         }
 
         /// Every single value is fetched atomically, but not all values as a whole.
+        /// Includes increments that thread blocks below this one have not propagated yet.
         Counters getPartiallyAtomicSnapshot() const;
 
         /// Reset all counters to zero and reset parent.
@@ -71,16 +105,21 @@ namespace ProfileEvents
             return parent;
         }
 
-        /// Set parent (thread unsafe)
-        void setParent(Counters * parent_)
-        {
-            parent = parent_;
-        }
+        /// Re-parent the block. Increments that were not propagated yet are pushed
+        ///  into the old parent chain first, so nothing is lost there.
+        void setParent(Counters * parent_);
 
-        /// Set all counters to zero
+        /// Set all counters to zero. For thread-level blocks, increments that were not
+        ///  propagated yet are pushed to the parent chain first.
         void resetCounters();
 
         static const Event num_counters;
+
+    private:
+        /// These require the global hierarchy mutex to be held.
+        void flushDeltasToParent();
+        void addDeltasOfChildren(Counter * dest) const;
+        void unregisterChild(Counters * child);
     };
 
     /// Increment a counter for event. Thread-safe.
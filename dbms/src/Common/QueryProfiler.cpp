@@ -0,0 +1,101 @@
+#include <Common/QueryProfiler.h>
+#include <Common/Exception.h>
+
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <execinfo.h>
+
+
+namespace DB
+{
+
+namespace ErrorCodes
+{
+    extern const int CANNOT_SET_SIGNAL_HANDLER;
+    extern const int CANNOT_CREATE_TIMER;
+}
+
+std::atomic<int> trace_pipe_write_fd{-1};
+
+namespace
+{
+    /// Filled by the QueryProfiler constructor and sent by the signal handler.
+    /// Preallocated per thread, because the handler cannot allocate.
+    thread_local QueryProfilerTrace trace_record;
+
+    constexpr int profiler_signal = SIGPROF;
+
+    void profilerSignalHandler(int, siginfo_t *, void *)
+    {
+        int fd = trace_pipe_write_fd.load(std::memory_order_relaxed);
+        if (fd < 0)
+            return;
+
+        /// The profiled thread could be interrupted in the middle of a syscall.
+        int saved_errno = errno;
+
+        trace_record.size = backtrace(trace_record.frames, STACK_TRACE_MAX_DEPTH);
+
+        /// The pipe is non-blocking: under pressure a sample is dropped rather than the query thread delayed.
+        ssize_t res = ::write(fd, &trace_record, sizeof(trace_record));
+        (void) res;
+
+        errno = saved_errno;
+    }
+}
+
+
+QueryProfiler::QueryProfiler(const String & query_id, UInt32 thread_number, UInt64 period_ns)
+{
+    memset(&trace_record, 0, sizeof(trace_record));
+    memcpy(trace_record.query_id, query_id.data(), std::min(query_id.size(), QueryProfilerTrace::QUERY_ID_MAX_LEN));
+    trace_record.thread_number = thread_number;
+
+    /// The first call to backtrace in a process may allocate memory,
+    ///  therefore it must not happen inside the signal handler.
+    void * warmup_frames[2];
+    backtrace(warmup_frames, 2);
+
+    static bool signal_handler_installed = []
+    {
+        struct sigaction sa{};
+        sa.sa_sigaction = profilerSignalHandler;
+        sa.sa_flags = SA_SIGINFO | SA_RESTART;
+
+        if (sigemptyset(&sa.sa_mask) || sigaddset(&sa.sa_mask, profiler_signal) || sigaction(profiler_signal, &sa, nullptr))
+            throwFromErrno("Cannot set signal handler for query profiler", ErrorCodes::CANNOT_SET_SIGNAL_HANDLER);
+
+        return true;
+    }();
+    (void) signal_handler_installed;
+
+    struct sigevent sev {};
+    sev.sigev_notify = SIGEV_THREAD_ID;
+    sev.sigev_signo = profiler_signal;
+    sev._sigev_un._tid = static_cast<pid_t>(syscall(SYS_gettid));
+
+    if (timer_create(CLOCK_MONOTONIC, &sev, &timer_id))
+        throwFromErrno("Cannot create timer for query profiler", ErrorCodes::CANNOT_CREATE_TIMER);
+    timer_created = true;
+
+    struct timespec period{static_cast<time_t>(period_ns / 1000000000), static_cast<long>(period_ns % 1000000000)};
+    struct itimerspec timer_spec = {.it_interval = period, .it_value = period};
+
+    if (timer_settime(timer_id, 0, &timer_spec, nullptr))
+    {
+        timer_delete(timer_id);
+        timer_created = false;
+        throwFromErrno("Cannot arm timer for query profiler", ErrorCodes::CANNOT_CREATE_TIMER);
+    }
+}
+
+QueryProfiler::~QueryProfiler()
+{
+    if (timer_created)
+        timer_delete(timer_id);
+}
+
+}
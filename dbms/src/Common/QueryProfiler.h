@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Core/Types.h>
+#include <Common/StackTrace.h>
+
+#include <atomic>
+#include <csignal>
+#include <ctime>
+
+
+namespace DB
+{
+
+/** A record sent by the profiler signal handler through the trace pipe.
+  * Its size is below PIPE_BUF, so a single write() is atomic and records
+  *  from different threads do not interleave.
+  */
+struct QueryProfilerTrace
+{
+    static constexpr size_t QUERY_ID_MAX_LEN = 64;
+
+    char query_id[QUERY_ID_MAX_LEN];    /// Zero-padded, truncated if longer.
+    UInt32 thread_number = 0;
+    UInt64 size = 0;                    /// Number of captured frames.
+    void * frames[STACK_TRACE_MAX_DEPTH];
+};
+
+/// Write end of the trace pipe. Set by TraceCollector; -1 while the collector is not running.
+extern std::atomic<int> trace_pipe_write_fd;
+
+/** Installs a timer that delivers a signal to the current thread every period_ns nanoseconds of real time.
+  * The signal handler captures the stack trace of the thread and sends it, together with the query id,
+  *  through the trace pipe to TraceCollector, which stores it in the system.trace_log table.
+  *
+  * Enabled by the query_profiler_real_time_period_ns setting;
+  *  also requires the trace_log section in the server config (see Context::initializeTraceCollector).
+  */
+class QueryProfiler
+{
+public:
+    QueryProfiler(const String & query_id, UInt32 thread_number, UInt64 period_ns);
+    ~QueryProfiler();
+
+    QueryProfiler(const QueryProfiler &) = delete;
+    QueryProfiler & operator=(const QueryProfiler &) = delete;
+
+private:
+    timer_t timer_id = nullptr;
+    bool timer_created = false;
+};
+
+}
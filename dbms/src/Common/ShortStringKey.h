@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstring>
+
+#include <Core/Types.h>
+#include <common/StringRef.h>
+
+#if __SSE4_2__
+#include <nmmintrin.h>
+#endif
+
+
+namespace DB
+{
+
+/** Hash table key for aggregation by a single string of arbitrary length.
+  *
+  * Strings of up to 23 bytes are stored directly in the key, so that in the dominant case
+  *  of short keys (identifiers, URLs' domains, enum-like values) they are hashed and compared
+  *  as three machine words, without dereferencing a pointer and without copying into an arena.
+  * Longer strings are referenced through a pointer, same as StringRef.
+  *
+  * The last byte holds the size of an inline string (0..23), or 0xFF for a referenced one.
+  * The bytes of an inline string after its end are zeroed, so that equal strings always have
+  *  a bit-identical representation, and the empty string is all zero bytes
+  *  (it is used as the "zero" key of the hash table).
+  */
+struct ShortStringKey
+{
+    static constexpr size_t max_inline_size = 23;
+    static constexpr UInt8 long_marker = 0xFF;
+
+/// Suppress gcc7 warnings: 'prev_key.DB::ShortStringKey::words' may be used uninitialized in this function
+#if !__clang__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+    /// For a referenced string, words[0] is the pointer to the data, words[1] is the size
+    ///  and the highest byte of words[2] is long_marker. This naming assumes little endian.
+    union
+    {
+        char bytes[24];
+        UInt64 words[3];
+    };
+
+    ShortStringKey() = default;
+
+    ShortStringKey(const char * data_, size_t size_)
+    {
+        if (size_ <= max_inline_size)
+        {
+            words[0] = 0;
+            words[1] = 0;
+            words[2] = 0;
+            memcpy(bytes, data_, size_);
+            bytes[23] = static_cast<char>(size_);
+        }
+        else
+        {
+            words[0] = reinterpret_cast<UInt64>(data_);
+            words[1] = size_;
+            words[2] = static_cast<UInt64>(long_marker) << 56;
+        }
+    }
+
+    bool isInline() const { return static_cast<UInt8>(bytes[23]) != long_marker; }
+
+    const char * data() const { return isInline() ? bytes : reinterpret_cast<const char *>(words[0]); }
+    size_t size() const { return isInline() ? static_cast<UInt8>(bytes[23]) : words[1]; }
+
+    StringRef toStringRef() const { return {data(), size()}; }
+
+    /// Repoint a referenced string to a copy of its data (e.g. made in an arena).
+    void setData(const char * data_) { words[0] = reinterpret_cast<UInt64>(data_); }
+
+    bool operator== (const ShortStringKey & rhs) const
+    {
+        /// words[2] also contains the size of an inline string or the marker of a referenced one,
+        ///  so strings of different kinds and inline strings of different sizes never compare equal.
+        if (words[2] != rhs.words[2] || words[1] != rhs.words[1])
+            return false;
+
+        if (isInline())
+            return words[0] == rhs.words[0];
+
+        return 0 == memcmp(data(), rhs.data(), size());
+    }
+
+    bool operator!= (const ShortStringKey & rhs) const { return !operator==(rhs); }
+
+#if !__clang__
+#pragma GCC diagnostic pop
+#endif
+};
+
+#if __SSE4_2__
+
+struct ShortStringKeyHash
+{
+    size_t operator()(const ShortStringKey & key) const
+    {
+        if (!key.isInline())
+            return StringRefHash()(key.toStringRef());
+
+        UInt64 crc = -1ULL;
+        crc = _mm_crc32_u64(crc, key.words[0]);
+        crc = _mm_crc32_u64(crc, key.words[1]);
+        crc = _mm_crc32_u64(crc, key.words[2]);
+        return crc;
+    }
+};
+
+#else
+
+struct ShortStringKeyHash
+{
+    size_t operator()(const ShortStringKey & key) const
+    {
+        return StringRefHash()(key.toStringRef());
+    }
+};
+
+#endif
+
+}
+
+
+namespace ZeroTraits
+{
+    /// Only the empty string is represented by all zero bytes.
+    inline bool check(const DB::ShortStringKey & x) { return 0 == x.words[2]; }
+    inline void set(DB::ShortStringKey & x) { x.words[0] = 0; x.words[1] = 0; x.words[2] = 0; }
+}
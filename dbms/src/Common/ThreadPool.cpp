@@ -0,0 +1,171 @@
+#include <Common/ThreadPool.h>
+
+
+template <typename Thread>
+ThreadPoolImpl<Thread>::ThreadPoolImpl(size_t max_threads)
+    : ThreadPoolImpl(max_threads, max_threads, max_threads)
+{
+}
+
+template <typename Thread>
+ThreadPoolImpl<Thread>::ThreadPoolImpl(size_t max_threads, size_t max_free_threads, size_t queue_size)
+    : max_threads(max_threads), max_free_threads(max_free_threads), queue_size(queue_size)
+{
+}
+
+template <typename Thread>
+void ThreadPoolImpl<Thread>::schedule(Job job, int priority)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        job_finished.wait(lock, [this] { return !queue_size || scheduled_jobs < queue_size || shutdown; });
+        if (shutdown)
+            return;
+
+        jobs.emplace(std::move(job), priority, next_sequence_num++);
+        ++scheduled_jobs;
+
+        if (threads.size() < std::min(max_threads, scheduled_jobs))
+        {
+            threads.emplace_front();
+            try
+            {
+                threads.front() = Thread([this, it = threads.begin()] { worker(it); });
+            }
+            catch (...)
+            {
+                threads.pop_front();
+
+                /// Remove the job and return error to caller.
+                /// Note that if we have allocated at least one thread, we may continue
+                ///  (one of our threads will pick up this job after some time).
+                if (threads.empty())
+                {
+                    jobs.pop();
+                    --scheduled_jobs;
+                    throw;
+                }
+            }
+        }
+    }
+    new_job_or_shutdown.notify_one();
+}
+
+template <typename Thread>
+void ThreadPoolImpl<Thread>::wait()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        job_finished.wait(lock, [this] { return scheduled_jobs == 0; });
+
+        if (first_exception)
+        {
+            std::exception_ptr exception;
+            std::swap(exception, first_exception);
+            std::rethrow_exception(exception);
+        }
+    }
+}
+
+template <typename Thread>
+ThreadPoolImpl<Thread>::~ThreadPoolImpl()
+{
+    finalize();
+}
+
+template <typename Thread>
+void ThreadPoolImpl<Thread>::finalize()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        shutdown = true;
+    }
+
+    new_job_or_shutdown.notify_all();
+
+    for (auto & thread : threads)
+        thread.join();
+
+    threads.clear();
+}
+
+template <typename Thread>
+size_t ThreadPoolImpl<Thread>::active() const
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return scheduled_jobs;
+}
+
+template <typename Thread>
+void ThreadPoolImpl<Thread>::worker(typename std::list<Thread>::iterator thread_it)
+{
+    while (true)
+    {
+        Job job;
+        bool need_shutdown = false;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            new_job_or_shutdown.wait(lock, [this] { return shutdown || !jobs.empty(); });
+            need_shutdown = shutdown;
+
+            if (!jobs.empty())
+            {
+                job = jobs.top().job;
+                jobs.pop();
+            }
+            else
+            {
+                /// shutdown is true, simply finish the thread.
+                return;
+            }
+        }
+
+        if (!need_shutdown)
+        {
+            try
+            {
+                job();
+            }
+            catch (...)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    if (!first_exception)
+                        first_exception = std::current_exception();
+                    shutdown = true;
+                    --scheduled_jobs;
+                }
+                job_finished.notify_all();
+                new_job_or_shutdown.notify_all();
+                return;
+            }
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            --scheduled_jobs;
+
+            if (threads.size() > scheduled_jobs + max_free_threads)
+            {
+                thread_it->detach();
+                threads.erase(thread_it);
+                job_finished.notify_all();
+                return;
+            }
+        }
+
+        job_finished.notify_all();
+    }
+}
+
+
+template class ThreadPoolImpl<std::thread>;
+template class ThreadPoolImpl<ThreadFromGlobalPool>;
+
+
+GlobalThreadPool & GlobalThreadPool::instance()
+{
+    static GlobalThreadPool ret;
+    return ret;
+}
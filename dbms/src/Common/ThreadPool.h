@@ -0,0 +1,190 @@
+#pragma once
+
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <queue>
+#include <list>
+
+#include <Poco/Event.h>
+#include <common/Types.h>
+#include <ext/scope_guard.h>
+
+
+/** Very simple thread pool similar to boost::threadpool.
+  * Advantages:
+  * - catches exceptions and rethrows on wait.
+  *
+  * This thread pool can be used as a task queue.
+  * For example, you can create a thread pool with 10 threads (and queue of size 10) and schedule 1000 tasks
+  * - in this case you will be blocked to keep 10 tasks in fly.
+  *
+  * Thread: std::thread or something with identical interface.
+  */
+template <typename Thread>
+class ThreadPoolImpl
+{
+public:
+    using Job = std::function<void()>;
+
+    /// Size is constant. Up to num_threads are created on demand and then run until shutdown.
+    explicit ThreadPoolImpl(size_t max_threads);
+
+    /// queue_size - maximum number of running plus scheduled jobs. It can be greater than max_threads. Zero means unlimited.
+    ThreadPoolImpl(size_t max_threads, size_t max_free_threads, size_t queue_size);
+
+    /// Add new job. Locks until number of scheduled jobs is less than maximum or exception in one of threads was thrown.
+    /// If an exception in some thread was thrown, method silently returns, and exception will be rethrown only on call to 'wait' function.
+    /// Priority: greater is higher.
+    void schedule(Job job, int priority = 0);
+
+    /// Wait for all currently active jobs to be done.
+    /// You may call schedule and wait many times in arbitrary order.
+    /// If any thread was throw an exception, first exception will be rethrown from this method,
+    ///  and exception will be cleared.
+    void wait();
+
+    /// Waits for all threads. Doesn't rethrow exceptions (use 'wait' method to rethrow exceptions).
+    /// You should not destroy object while calling schedule or wait methods from another threads.
+    ~ThreadPoolImpl();
+
+    /// Returns number of running and scheduled jobs.
+    size_t active() const;
+
+    size_t size() const { return max_threads; }
+
+private:
+    mutable std::mutex mutex;
+    std::condition_variable job_finished;
+    std::condition_variable new_job_or_shutdown;
+
+    const size_t max_threads;
+    const size_t max_free_threads;
+    const size_t queue_size;
+
+    size_t scheduled_jobs = 0;
+    bool shutdown = false;
+
+    struct JobWithPriority
+    {
+        Job job;
+        int priority;
+        UInt64 sequence_num;    /// To make jobs with equal priority FIFO ordered.
+
+        JobWithPriority(Job job, int priority, UInt64 sequence_num)
+            : job(job), priority(priority), sequence_num(sequence_num) {}
+
+        bool operator< (const JobWithPriority & rhs) const
+        {
+            return priority < rhs.priority
+                || (priority == rhs.priority && sequence_num > rhs.sequence_num);
+        }
+    };
+
+    std::priority_queue<JobWithPriority> jobs;
+    UInt64 next_sequence_num = 0;
+    std::list<Thread> threads;
+    std::exception_ptr first_exception;
+
+    void worker(typename std::list<Thread>::iterator thread_it);
+
+    void finalize();
+};
+
+
+/// ThreadPool with std::thread for threads.
+using FreeThreadPool = ThreadPoolImpl<std::thread>;
+
+
+/** Global ThreadPool that is used in all places where threads are created on demand.
+  * Its threads are cached: after a job is done, a thread stays in the pool waiting for the next job
+  *  instead of exiting, so short-lived tasks do not pay for thread creation.
+  */
+class GlobalThreadPool : public FreeThreadPool
+{
+public:
+    GlobalThreadPool() : FreeThreadPool(10000, 1000, 10000) {}
+
+    static GlobalThreadPool & instance();
+};
+
+
+/** Looks like std::thread but allocates threads in GlobalThreadPool.
+  * Also holds ThreadStatus for ClickHouse.
+  */
+class ThreadFromGlobalPool
+{
+public:
+    ThreadFromGlobalPool() {}
+
+    template <typename Function, typename... Args>
+    explicit ThreadFromGlobalPool(Function && func, Args &&... args)
+        : state(std::make_shared<Poco::Event>())
+    {
+        /// NOTE: If this will throw an exception, the destructor won't be called.
+        GlobalThreadPool::instance().schedule([
+            state = state,
+            func = std::forward<Function>(func),
+            args = std::make_tuple(std::forward<Args>(args)...)]() mutable
+        {
+            SCOPE_EXIT(state->set());
+
+            /// This moves are needed to destroy function and arguments before exit.
+            /// It will guarantee that after ThreadFromGlobalPool::join all captured params are destroyed.
+            auto function = std::move(func);
+            auto arguments = std::move(args);
+
+            std::apply(function, arguments);
+        });
+    }
+
+    ThreadFromGlobalPool(ThreadFromGlobalPool && rhs)
+    {
+        *this = std::move(rhs);
+    }
+
+    ThreadFromGlobalPool & operator=(ThreadFromGlobalPool && rhs)
+    {
+        if (joinable())
+            std::terminate();
+        state = std::move(rhs.state);
+        return *this;
+    }
+
+    ~ThreadFromGlobalPool()
+    {
+        if (joinable())
+            std::terminate();
+    }
+
+    void join()
+    {
+        if (!joinable())
+            std::terminate();
+
+        state->wait();
+        state.reset();
+    }
+
+    void detach()
+    {
+        if (!joinable())
+            std::terminate();
+        state.reset();
+    }
+
+    bool joinable() const
+    {
+        return state != nullptr;
+    }
+
+private:
+    /// The state used in this object and inside the thread job.
+    std::shared_ptr<Poco::Event> state;
+};
+
+
+/// Recommended thread pool for the case when multiple thread pools are created and destroyed.
+using ThreadPool = ThreadPoolImpl<ThreadFromGlobalPool>;
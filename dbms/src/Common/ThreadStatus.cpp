@@ -5,6 +5,7 @@
 #include <Common/ThreadProfileEvents.h>
 #include <Common/TaskStatsInfoGetter.h>
 #include <Common/ThreadStatus.h>
+#include <Common/QueryProfiler.h>
 
 #include <Poco/Logger.h>
 #include <Poco/Ext/ThreadNumber.h>
@@ -26,6 +26,7 @@ class QueryStatus;
 class ThreadStatus;
 using ThreadStatusPtr = std::shared_ptr<ThreadStatus>;
 class QueryThreadLog;
+class QueryProfiler;
 struct TasksStatsCounters;
 struct RUsageCounters;
 class TaskStatsInfoGetter;
@@ -89,6 +90,10 @@ public:
     Progress progress_in;
     Progress progress_out;
 
+    /// Name of the pipeline stage the thread serves; shown in system.query_thread_log.
+    /// Set by the thread itself via CurrentThread::setQueryStage, cleared on detach.
+    String stage_name;
+
 public:
     static ThreadStatusPtr create();
 
@@ -144,6 +149,11 @@ protected:
 
     void initPerformanceCounters();
 
+    /// Starts the sampling profiler for current thread if it is enabled by settings
+    ///  and the trace collector is running (see Common/QueryProfiler.h).
+    void initQueryProfiler();
+    void finalizeQueryProfiler();
+
     void logToQueryThreadLog(QueryThreadLog & thread_log);
 
     void assertState(const std::initializer_list<int> & permitted_states, const char * description = nullptr);
@@ -174,6 +184,9 @@ protected:
     std::unique_ptr<RUsageCounters> last_rusage;
     std::unique_ptr<TasksStatsCounters> last_taskstats;
 
+    /// Set while the thread executes a query with the sampling profiler enabled.
+    std::unique_ptr<QueryProfiler> query_profiler;
+
     /// Set to non-nullptr only if we have enough capabilities.
     /// We use pool because creation and destruction of TaskStatsInfoGetter objects are expensive.
     SimpleObjectPool<TaskStatsInfoGetter>::Pointer taskstats_getter;
@@ -3,9 +3,12 @@
 #include <Common/StringSearcher.h>
 #include <Common/StringUtils/StringUtils.h>
 #include <Core/Types.h>
+#include <common/StringRef.h>
 #include <Poco/UTF8Encoding.h>
 #include <Poco/Unicode.h>
 #include <ext/range.h>
+#include <memory>
+#include <vector>
 #include <stdint.h>
 #include <string.h>
 
@@ -455,4 +458,190 @@ using VolnitskyCaseInsensitive = VolnitskyImpl<false, true>;    /// ignores non-
 using VolnitskyCaseInsensitiveUTF8 = VolnitskyImpl<false, false>;
 
 
+/** Search for several substrings at once in one pass over the haystack (case-sensitive).
+  *
+  * One shared hash table holds every bigram of every needle; a cell stores the needle number
+  *  together with the offset of the bigram inside it. The haystack is sampled with a step of
+  *  (the shortest needle length - 1): any occurrence of any needle spans at least that many
+  *  bigram positions, so one of the samples is guaranteed to land inside it. A hit is then
+  *  verified bytewise.
+  *
+  * The table is built once per set of needles and reused for all rows of a block, so the cost
+  *  of searching N needles approaches the cost of searching one.
+  *
+  * If a needle does not suit the main algorithm (shorter than a bigram, longer than 255 bytes),
+  *  or there are more than 255 needles, everything goes through the per-needle fallback searchers.
+  */
+class MultiVolnitsky
+{
+private:
+    using Offset = UInt8;    /// Offset of a bigram in the needle + 1 (0 means an empty cell).
+    using Id = UInt8;        /// Index of the needle.
+    using Ngram = UInt16;    /// n-gram (2 bytes).
+
+    struct OffsetId
+    {
+        Offset offset;
+        Id id;
+    };
+
+    static const size_t hash_size = 64 * 1024;    /// Twice the size of the single-needle table: cells are two bytes.
+    std::unique_ptr<OffsetId[]> hash;
+
+    const std::vector<StringRef> & needles;
+    size_t step = 0;               /// The shortest needle length - 1.
+    size_t max_needle_size = 0;
+    const bool fallback;
+    std::vector<ASCIICaseSensitiveStringSearcher> fallback_searchers;
+
+    static bool needsFallback(const std::vector<StringRef> & needles)
+    {
+        if (needles.size() > std::numeric_limits<Id>::max())
+            return true;
+        for (const auto & needle : needles)
+            if (needle.size < 2 * sizeof(Ngram) || needle.size >= std::numeric_limits<Offset>::max())
+                return true;
+        return false;
+    }
+
+    static const Ngram & toNGram(const UInt8 * const pos)
+    {
+        return *reinterpret_cast<const Ngram *>(pos);
+    }
+
+public:
+    /// The needles must outlive the searcher.
+    MultiVolnitsky(const std::vector<StringRef> & needles_)
+        : needles(needles_), fallback(needsFallback(needles_))
+    {
+        if (fallback)
+        {
+            fallback_searchers.reserve(needles.size());
+            for (const auto & needle : needles)
+                fallback_searchers.emplace_back(needle.data, needle.size);
+            return;
+        }
+
+        step = std::numeric_limits<size_t>::max();
+        for (const auto & needle : needles)
+        {
+            step = std::min(step, needle.size - 1);
+            max_needle_size = std::max(max_needle_size, needle.size);
+        }
+
+        hash.reset(new OffsetId[hash_size]);
+        memset(hash.get(), 0, hash_size * sizeof(OffsetId));
+
+        for (size_t id = 0; id < needles.size(); ++id)
+        {
+            const auto * needle = reinterpret_cast<const UInt8 *>(needles[id].data);
+
+            /// Every bigram of the needle goes into the table: whichever sample lands inside
+            ///  an occurrence, its bigram will be found with the proper offset.
+            for (size_t i = 0; i + sizeof(Ngram) <= needles[id].size; ++i)
+            {
+                size_t cell_num = toNGram(needle + i) % hash_size;
+                while (hash[cell_num].offset)
+                    cell_num = (cell_num + 1) % hash_size;
+
+                hash[cell_num].offset = i + 1;
+                hash[cell_num].id = id;
+            }
+        }
+    }
+
+    /// Whether any of the needles occur in the haystack.
+    bool searchAny(const UInt8 * haystack, size_t haystack_size) const
+    {
+        const UInt8 * haystack_end = haystack + haystack_size;
+
+        if (fallback)
+        {
+            for (const auto & searcher : fallback_searchers)
+                if (searcher.search(haystack, haystack_end) != haystack_end)
+                    return true;
+            return false;
+        }
+
+        for (const UInt8 * pos = haystack; pos + sizeof(Ngram) <= haystack_end; pos += step)
+        {
+            for (size_t cell_num = toNGram(pos) % hash_size; hash[cell_num].offset; cell_num = (cell_num + 1) % hash_size)
+            {
+                const auto & cell = hash[cell_num];
+                const UInt8 * candidate = pos - (cell.offset - 1);
+                const StringRef & needle = needles[cell.id];
+
+                if (candidate >= haystack && candidate + needle.size <= haystack_end
+                    && 0 == memcmp(candidate, needle.data, needle.size))
+                    return true;
+            }
+        }
+
+        return false;
+    }
+
+    /// Position (in bytes, starting with 1) of the leftmost match of any needle, or 0.
+    UInt64 searchFirstPosition(const UInt8 * haystack, size_t haystack_size) const
+    {
+        size_t unused;
+        const UInt8 * best = searchFirstImpl(haystack, haystack_size, unused);
+        return best ? best - haystack + 1 : 0;
+    }
+
+    /// Index (starting with 1) of the needle matched at the leftmost position, or 0.
+    /// Ties at equal positions go to the needle with the smaller index.
+    UInt64 searchFirstIndex(const UInt8 * haystack, size_t haystack_size) const
+    {
+        size_t best_id = 0;
+        const UInt8 * best = searchFirstImpl(haystack, haystack_size, best_id);
+        return best ? best_id + 1 : 0;
+    }
+
+private:
+    const UInt8 * searchFirstImpl(const UInt8 * haystack, size_t haystack_size, size_t & best_id) const
+    {
+        const UInt8 * haystack_end = haystack + haystack_size;
+        const UInt8 * best = nullptr;
+
+        if (fallback)
+        {
+            for (size_t i = 0; i < needles.size(); ++i)
+            {
+                const UInt8 * found = fallback_searchers[i].search(haystack, haystack_end);
+                if (found != haystack_end && (!best || found < best))
+                {
+                    best = found;
+                    best_id = i;
+                }
+            }
+            return best;
+        }
+
+        for (const UInt8 * pos = haystack; pos + sizeof(Ngram) <= haystack_end; pos += step)
+        {
+            /// Any match starting to the left of 'best' contains a bigram at a sample before this one.
+            if (best && pos >= best + max_needle_size)
+                break;
+
+            for (size_t cell_num = toNGram(pos) % hash_size; hash[cell_num].offset; cell_num = (cell_num + 1) % hash_size)
+            {
+                const auto & cell = hash[cell_num];
+                const UInt8 * candidate = pos - (cell.offset - 1);
+                const StringRef & needle = needles[cell.id];
+
+                if (candidate >= haystack && candidate + needle.size <= haystack_end
+                    && (!best || candidate < best || (candidate == best && cell.id < best_id))
+                    && 0 == memcmp(candidate, needle.data, needle.size))
+                {
+                    best = candidate;
+                    best_id = cell.id;
+                }
+            }
+        }
+
+        return best;
+    }
+};
+
+
 }
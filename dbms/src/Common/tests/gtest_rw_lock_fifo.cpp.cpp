@@ -7,7 +7,7 @@
 #include <Common/RWLockFIFO.h>
 #include <Common/Stopwatch.h>
 #include <common/Types.h>
-#include <common/ThreadPool.h>
+#include <Common/ThreadPool.h>
 #include <random>
 #include <pcg_random.hpp>
 #include <thread>
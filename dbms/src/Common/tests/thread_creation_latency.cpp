@@ -5,7 +5,7 @@
 
 #include <Common/Stopwatch.h>
 #include <Common/Exception.h>
-#include <common/ThreadPool.h>
+#include <Common/ThreadPool.h>
 
 
 int x = 0;
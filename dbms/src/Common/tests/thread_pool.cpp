@@ -1,4 +1,4 @@
-#include <common/ThreadPool.h>
+#include <Common/ThreadPool.h>
 
 /** Reproduces bug in ThreadPool.
   * It get stuck if we call 'wait' many times from many other threads simultaneously.
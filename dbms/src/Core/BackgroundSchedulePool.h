@@ -13,6 +13,7 @@
 #include <boost/noncopyable.hpp>
 #include <Common/ZooKeeper/Types.h>
 #include <Common/CurrentThread.h>
+#include <Common/ThreadPool.h>
 
 namespace DB
 {
@@ -119,7 +120,7 @@ public:
     ~BackgroundSchedulePool();
 
 private:
-    using Threads = std::vector<std::thread>;
+    using Threads = std::vector<ThreadFromGlobalPool>;
 
     void threadFunction();
     void delayExecutionThreadFunction();
@@ -141,7 +142,7 @@ private:
     std::condition_variable wakeup_cond;
     std::mutex delayed_tasks_mutex;
     /// Thread waiting for next delayed task.
-    std::thread delayed_thread;
+    ThreadFromGlobalPool delayed_thread;
     /// Tasks ordered by scheduled time.
     DelayedTasks delayed_tasks;
 
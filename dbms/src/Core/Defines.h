@@ -15,6 +15,9 @@
 /// The size of the I/O buffer by default.
 #define DBMS_DEFAULT_BUFFER_SIZE 1048576ULL
 
+/// Bound on the recursion depth of the query parser by default.
+#define DBMS_DEFAULT_MAX_PARSER_DEPTH 1000
+
 /** Which blocks by default read the data (by number of rows).
   * Smaller values give better cache locality, less consumption of RAM, but more overhead to process the query.
   */
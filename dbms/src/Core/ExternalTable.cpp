@@ -160,7 +160,8 @@ void ExternalTablesHandler::handlePart(const Poco::Net::MessageHeader & header,
 
     /// Create table
     NamesAndTypesList columns = sample_block.getNamesAndTypesList();
-    StoragePtr storage = StorageMemory::create(data.second, ColumnsDescription{columns});
+    StoragePtr storage = StorageMemory::create(data.second, ColumnsDescription{columns},
+        false, settings.temporary_table_max_bytes_in_memory, context.getTemporaryPath());
     storage->startup();
     context.addExternalTable(data.second, storage);
     BlockOutputStreamPtr output = storage->write(ASTPtr(), settings);
@@ -64,7 +64,9 @@ Block AggregatingBlockInputStream::readImpl()
                 << (files.sum_size_compressed / 1048576.0) << " MiB compressed, "
                 << (files.sum_size_uncompressed / 1048576.0) << " MiB uncompressed.");
 
-            impl = std::make_unique<MergingAggregatedMemoryEfficientBlockInputStream>(input_streams, params, final, 1, 1);
+            /// The buckets of flushed data can be merged in parallel: they contain disjoint sets of keys.
+            impl = std::make_unique<MergingAggregatedMemoryEfficientBlockInputStream>(
+                input_streams, params, final, temporary_data_merge_threads, temporary_data_merge_threads);
         }
     }
 
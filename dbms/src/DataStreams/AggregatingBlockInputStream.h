@@ -21,9 +21,12 @@ public:
     /** keys are taken from the GROUP BY part of the query
       * Aggregate functions are searched everywhere in the expression.
       * Columns corresponding to keys and arguments of aggregate functions must already be computed.
+      * temporary_data_merge_threads - how many threads are used to merge the buckets of data
+      *  flushed to the disk during external aggregation.
       */
-    AggregatingBlockInputStream(const BlockInputStreamPtr & input, const Aggregator::Params & params_, bool final_)
-        : params(params_), aggregator(params), final(final_)
+    AggregatingBlockInputStream(const BlockInputStreamPtr & input, const Aggregator::Params & params_, bool final_,
+                                size_t temporary_data_merge_threads_ = 1)
+        : params(params_), aggregator(params), final(final_), temporary_data_merge_threads(temporary_data_merge_threads_)
     {
         children.push_back(input);
     }
@@ -38,6 +41,7 @@ protected:
     Aggregator::Params params;
     Aggregator aggregator;
     bool final;
+    size_t temporary_data_merge_threads;
 
     bool executed = false;
 
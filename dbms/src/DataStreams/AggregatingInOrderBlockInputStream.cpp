@@ -0,0 +1,203 @@
+#include <DataStreams/AggregatingInOrderBlockInputStream.h>
+
+
+namespace DB
+{
+
+namespace
+{
+    /// When the arena of the current group grows beyond this, it is thrown away after the group,
+    ///  so that states allocating from it do not accumulate garbage over the whole stream.
+    constexpr size_t max_arena_size_to_reuse = 1024 * 1024;
+}
+
+
+AggregatingInOrderBlockInputStream::AggregatingInOrderBlockInputStream(
+    const BlockInputStreamPtr & input,
+    const Names & key_names_, const AggregateDescriptions & aggregates_,
+    size_t max_block_size_)
+    : key_names(key_names_), aggregates(aggregates_), max_block_size(max_block_size_)
+    , places(aggregates.size())
+    , states_arena(std::make_shared<Arena>())
+    , arena(std::make_shared<Arena>())
+    , current_key(key_names.size())
+{
+    children.push_back(input);
+
+    const Block & source_header = children.back()->getHeader();
+
+    for (const auto & name : key_names)
+    {
+        key_positions.push_back(source_header.getPositionByName(name));
+        header.insert(source_header.getByName(name).cloneEmpty());
+    }
+
+    argument_positions.resize(aggregates.size());
+    for (size_t i = 0; i < aggregates.size(); ++i)
+    {
+        for (const auto & name : aggregates[i].argument_names)
+            argument_positions[i].push_back(source_header.getPositionByName(name));
+
+        places[i] = states_arena->alignedAlloc(aggregates[i].function->sizeOfData(), aggregates[i].function->alignOfData());
+
+        header.insert({aggregates[i].function->getReturnType(), aggregates[i].column_name});
+    }
+}
+
+
+AggregatingInOrderBlockInputStream::~AggregatingInOrderBlockInputStream()
+{
+    destroyStates();
+}
+
+
+void AggregatingInOrderBlockInputStream::createStates()
+{
+    size_t i = 0;
+
+    try
+    {
+        for (; i < aggregates.size(); ++i)
+            aggregates[i].function->create(places[i]);
+    }
+    catch (...)
+    {
+        for (size_t j = 0; j < i; ++j)
+            aggregates[j].function->destroy(places[j]);
+        throw;
+    }
+
+    states_created = true;
+}
+
+
+void AggregatingInOrderBlockInputStream::destroyStates()
+{
+    if (!states_created)
+        return;
+
+    for (size_t i = 0; i < aggregates.size(); ++i)
+        aggregates[i].function->destroy(places[i]);
+
+    states_created = false;
+}
+
+
+void AggregatingInOrderBlockInputStream::startGroup(const ColumnRawPtrs & key_columns, size_t row)
+{
+    for (size_t i = 0; i < key_columns.size(); ++i)
+    {
+        current_key[i] = key_columns[i]->cloneEmpty();
+        current_key[i]->insertFrom(*key_columns[i], row);
+    }
+
+    createStates();
+    has_current_group = true;
+}
+
+
+void AggregatingInOrderBlockInputStream::finishGroup(MutableColumns & result_columns)
+{
+    for (size_t i = 0; i < current_key.size(); ++i)
+        result_columns[i]->insertFrom(*current_key[i], 0);
+
+    for (size_t i = 0; i < aggregates.size(); ++i)
+        aggregates[i].function->insertResultInto(places[i], *result_columns[current_key.size() + i]);
+
+    destroyStates();
+    has_current_group = false;
+
+    if (arena->size() > max_arena_size_to_reuse)
+        arena = std::make_shared<Arena>();
+}
+
+
+Block AggregatingInOrderBlockInputStream::readImpl()
+{
+    if (input_exhausted && !has_current_group)
+        return {};
+
+    MutableColumns result_columns = header.cloneEmptyColumns();
+    size_t result_rows = 0;
+
+    while (result_rows < max_block_size)
+    {
+        if (!current_input)
+        {
+            if (input_exhausted)
+                break;
+
+            current_input = children.back()->read();
+            current_row = 0;
+
+            if (!current_input)
+            {
+                input_exhausted = true;
+
+                if (has_current_group)
+                {
+                    finishGroup(result_columns);
+                    ++result_rows;
+                }
+                break;
+            }
+
+            if (!current_input.rows())
+            {
+                current_input = Block();
+                continue;
+            }
+        }
+
+        ColumnRawPtrs key_columns(key_positions.size());
+        for (size_t i = 0; i < key_positions.size(); ++i)
+            key_columns[i] = current_input.getByPosition(key_positions[i]).column.get();
+
+        std::vector<ColumnRawPtrs> argument_columns(aggregates.size());
+        for (size_t i = 0; i < aggregates.size(); ++i)
+            for (size_t position : argument_positions[i])
+                argument_columns[i].push_back(current_input.getByPosition(position).column.get());
+
+        size_t rows = current_input.rows();
+        while (current_row < rows)
+        {
+            bool key_changed = !has_current_group;
+            for (size_t i = 0; !key_changed && i < key_columns.size(); ++i)
+                if (0 != key_columns[i]->compareAt(current_row, 0, *current_key[i], 1))
+                    key_changed = true;
+
+            if (key_changed)
+            {
+                if (has_current_group)
+                {
+                    finishGroup(result_columns);
+                    ++result_rows;
+
+                    /// The row that opens the next group stays unconsumed until the next call.
+                    if (result_rows == max_block_size)
+                        break;
+                }
+
+                startGroup(key_columns, current_row);
+            }
+
+            for (size_t i = 0; i < aggregates.size(); ++i)
+                aggregates[i].function->add(places[i], argument_columns[i].data(), current_row, arena.get());
+
+            ++current_row;
+        }
+
+        if (current_row == rows)
+            current_input = Block();
+
+        if (result_rows == max_block_size)
+            break;
+    }
+
+    if (!result_rows)
+        return {};
+
+    return header.cloneWithColumns(std::move(result_columns));
+}
+
+}
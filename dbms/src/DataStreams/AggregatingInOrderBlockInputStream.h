@@ -0,0 +1,75 @@
+#pragma once
+
+#include <Common/Arena.h>
+#include <Core/ColumnNumbers.h>
+#include <DataStreams/IProfilingBlockInputStream.h>
+#include <Interpreters/AggregateDescription.h>
+
+
+namespace DB
+{
+
+/** Aggregates a stream that is sorted by the GROUP BY keys (see optimize_aggregation_in_order).
+  *
+  * Because equal keys arrive contiguously, there is no hash table: only the states of the
+  *  current group are kept, a change of the key finalizes them and emits the row immediately.
+  * Memory is bounded by the size of one set of states regardless of the number of groups,
+  *  and the first rows of the result are produced as soon as the first groups are complete.
+  *
+  * Only produces finalized values, so it is used only when the query is executed till the end
+  *  on one server (no two-level, overflow rows or intermediate states).
+  */
+class AggregatingInOrderBlockInputStream : public IProfilingBlockInputStream
+{
+public:
+    AggregatingInOrderBlockInputStream(
+        const BlockInputStreamPtr & input,
+        const Names & key_names_, const AggregateDescriptions & aggregates_,
+        size_t max_block_size_);
+
+    ~AggregatingInOrderBlockInputStream() override;
+
+    String getName() const override { return "AggregatingInOrder"; }
+    Block getHeader() const override { return header; }
+
+protected:
+    Block readImpl() override;
+
+private:
+    Names key_names;
+    AggregateDescriptions aggregates;
+    size_t max_block_size;
+
+    Block header;
+
+    /// Positions of the key columns and of the argument columns of every aggregate function
+    ///  in the header of the source stream.
+    ColumnNumbers key_positions;
+    std::vector<ColumnNumbers> argument_positions;
+
+    /// The states of the aggregate functions of the current group. There is one live group
+    ///  at any moment, so the states are allocated once and reused with create() / destroy().
+    std::vector<AggregateDataPtr> places;
+    ArenaPtr states_arena;
+    bool states_created = false;
+
+    /// For states that allocate additional memory (e.g. uniq). Recreated between groups
+    ///  once it has grown, so that the memory of the stream stays bounded.
+    ArenaPtr arena;
+
+    /// The key of the current group: one row in each column.
+    MutableColumns current_key;
+    bool has_current_group = false;
+
+    /// The source block being consumed and the position in it.
+    Block current_input;
+    size_t current_row = 0;
+    bool input_exhausted = false;
+
+    void createStates();
+    void destroyStates();
+    void startGroup(const ColumnRawPtrs & key_columns, size_t row);
+    void finishGroup(MutableColumns & result_columns);
+};
+
+}
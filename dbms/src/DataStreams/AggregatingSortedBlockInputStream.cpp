@@ -13,8 +13,9 @@ namespace ErrorCodes
 
 
 AggregatingSortedBlockInputStream::AggregatingSortedBlockInputStream(
-    const BlockInputStreams & inputs_, const SortDescription & description_, size_t max_block_size_)
-    : MergingSortedBlockInputStream(inputs_, description_, max_block_size_)
+    const BlockInputStreams & inputs_, const SortDescription & description_, size_t max_block_size_,
+    WriteBuffer * out_row_sources_buf_)
+    : MergingSortedBlockInputStream(inputs_, description_, max_block_size_, 0, out_row_sources_buf_)
 {
     /// Fill in the column numbers that need to be aggregated.
     for (size_t i = 0; i < num_columns; ++i)
@@ -115,6 +116,13 @@ void AggregatingSortedBlockInputStream::merge(MutableColumns & merged_columns, s
 
         addRow(current);
 
+        /// The group is represented by its first row: non-aggregated columns are gathered from it.
+        if (out_row_sources_buf)
+        {
+            RowSourcePart row_source(current.impl->order, !key_differs);
+            out_row_sources_buf->write(reinterpret_cast<const char *>(&row_source), sizeof(row_source));
+        }
+
         if (!current->isLast())
         {
             current->next();
@@ -22,7 +22,8 @@ class AggregatingSortedBlockInputStream : public MergingSortedBlockInputStream
 {
 public:
     AggregatingSortedBlockInputStream(
-        const BlockInputStreams & inputs_, const SortDescription & description_, size_t max_block_size_);
+        const BlockInputStreams & inputs_, const SortDescription & description_, size_t max_block_size_,
+        WriteBuffer * out_row_sources_buf_ = nullptr);
 
     String getName() const override { return "AggregatingSorted"; }
 
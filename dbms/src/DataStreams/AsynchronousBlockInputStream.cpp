@@ -46,7 +46,10 @@ void AsynchronousBlockInputStream::next()
 
             /// AsynchronousBlockInputStream is used in Client which does not create queries and thread groups
             if (thread_group)
+            {
                 CurrentThread::attachToIfDetached(thread_group);
+                CurrentThread::setQueryStage(children.back()->getName());
+            }
         }
         catch (...)
         {
@@ -5,7 +5,8 @@
 #include <DataStreams/IProfilingBlockInputStream.h>
 #include <Common/setThreadName.h>
 #include <Common/CurrentMetrics.h>
-#include <common/ThreadPool.h>
+#include <Common/CurrentThread.h>
+#include <Common/ThreadPool.h>
 #include <Common/MemoryTracker.h>
 #include <Poco/Ext/ThreadNumber.h>
 
@@ -54,6 +55,7 @@ public:
             if (exception)
                 std::rethrow_exception(exception);
             children.back()->readSuffix();
+            detachWorker();
             started = false;
         }
     }
@@ -80,7 +82,17 @@ public:
     ~AsynchronousBlockInputStream() override
     {
         if (started)
-            pool.wait();
+        {
+            try
+            {
+                pool.wait();
+                detachWorker();
+            }
+            catch (...)
+            {
+                tryLogCurrentException(__PRETTY_FUNCTION__);
+            }
+        }
     }
 
 protected:
@@ -98,6 +110,14 @@ protected:
 
     /// Calculations that can be performed in a separate thread
     void calculate();
+
+    /// The thread serving the pool is cached in the global pool and will be reused for other queries:
+    ///  it must not stay attached to the thread group of this one.
+    void detachWorker()
+    {
+        pool.schedule([] { CurrentThread::detachQueryIfNotDetached(); });
+        pool.wait();
+    }
 };
 
 }
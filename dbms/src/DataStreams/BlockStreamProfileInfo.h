@@ -25,6 +25,12 @@ struct BlockStreamProfileInfo
     size_t blocks = 0;
     size_t bytes = 0;
 
+    /// Wall clock time spent inside read() of this stream, including reading from children.
+    UInt64 execution_time_ns = 0;
+    /// Thread CPU time spent inside read() of this stream, including reading from children.
+    /// The difference with execution_time_ns is the time spent waiting (for I/O, locks, other threads).
+    UInt64 cpu_time_ns = 0;
+
     using BlockStreamProfileInfos = std::vector<const BlockStreamProfileInfo *>;
 
     /// Collect BlockStreamProfileInfo for the nearest sources in the tree named `name`. Example; collect all info for PartialSorting streams.
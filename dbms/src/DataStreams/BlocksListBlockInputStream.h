@@ -22,6 +22,8 @@ public:
 
     String getName() const override { return "BlocksList"; }
 
+    Block getHeader() const override { return list.empty() ? Block() : list.front().cloneEmpty(); }
+
 protected:
     Block readImpl() override
     {
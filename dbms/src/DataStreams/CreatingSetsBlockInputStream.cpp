@@ -1,10 +1,15 @@
 #include <Interpreters/Set.h>
+#include <Interpreters/SubqueryResultCache.h>
 #include <Interpreters/Join.h>
 #include <DataStreams/materializeBlock.h>
 #include <DataStreams/IBlockOutputStream.h>
 #include <DataStreams/CreatingSetsBlockInputStream.h>
 #include <Storages/IStorage.h>
+#include <Common/CurrentThread.h>
+#include <Common/setThreadName.h>
+#include <Common/ThreadPool.h>
 #include <iomanip>
+#include <mutex>
 
 
 namespace DB
@@ -88,6 +93,26 @@ void CreatingSetsBlockInputStream::createAll()
 }
 
 
+/// Apply renames of columns and additional actions to a block of the right side of JOIN.
+static void prepareBlockForJoin(const SubqueryForSet & subquery, Block & block)
+{
+    for (const auto & name_with_alias : subquery.joined_block_aliases)
+    {
+        if (block.has(name_with_alias.first))
+        {
+            auto pos = block.getPositionByName(name_with_alias.first);
+            auto column = block.getByPosition(pos);
+            block.erase(pos);
+            column.name = name_with_alias.second;
+            block.insert(std::move(column));
+        }
+    }
+
+    if (subquery.joined_block_actions)
+        subquery.joined_block_actions->execute(block);
+}
+
+
 void CreatingSetsBlockInputStream::createOne(SubqueryForSet & subquery)
 {
     LOG_TRACE(log, (subquery.set ? "Creating set. " : "")
@@ -103,12 +128,70 @@ void CreatingSetsBlockInputStream::createOne(SubqueryForSet & subquery)
     bool done_with_join = !subquery.join;
     bool done_with_table = !subquery.table;
 
+    /// Whether the join build was aborted by a size limit (then it must not be cached).
+    bool join_limit_hit = false;
+
     if (done_with_set && done_with_join && done_with_table)
         throw Exception("Logical error: nothing to do with subquery", ErrorCodes::LOGICAL_ERROR);
 
     if (table_out)
         table_out->writePrefix();
 
+    /// If this source only builds a partitioned JOIN, fill its hash table partitions from several threads.
+    /// Reading from the source stays under a mutex; inserts into different partitions go in parallel.
+    if (done_with_set && done_with_table && !done_with_join && subquery.join->buildsInParallel())
+    {
+        size_t threads = subquery.join->getBuildConcurrency();
+        ThreadPool pool(threads);
+        std::mutex mutex;    /// Guards the source and the 'done_with_join' flag.
+        ThreadGroupStatusPtr thread_group = CurrentThread::getGroup();
+
+        for (size_t i = 0; i < threads; ++i)
+        {
+            pool.schedule([&]
+            {
+                setThreadName("CreatingJoin");
+                if (thread_group)
+                    CurrentThread::attachToIfDetached(thread_group);
+
+                while (true)
+                {
+                    Block block;
+                    {
+                        std::lock_guard lock(mutex);
+                        if (done_with_join || isCancelled())
+                            return;
+
+                        block = subquery.source->read();
+                        if (!block)
+                        {
+                            done_with_join = true;
+                            return;
+                        }
+                    }
+
+                    prepareBlockForJoin(subquery, block);
+
+                    if (!subquery.join->insertFromBlock(block))
+                    {
+                        std::lock_guard lock(mutex);
+                        done_with_join = true;
+                        join_limit_hit = true;
+                        return;
+                    }
+                }
+            });
+        }
+
+        pool.wait();    /// Rethrows the first exception, if any.
+
+        if (isCancelled())
+        {
+            LOG_DEBUG(log, "Query was cancelled during set / join or temporary table creation.");
+            return;
+        }
+    }
+    else
     while (Block block = subquery.source->read())
     {
         if (isCancelled())
@@ -125,23 +208,13 @@ void CreatingSetsBlockInputStream::createOne(SubqueryForSet & subquery)
 
         if (!done_with_join)
         {
-            for (const auto & name_with_alias : subquery.joined_block_aliases)
-            {
-                if (block.has(name_with_alias.first))
-                {
-                    auto pos = block.getPositionByName(name_with_alias.first);
-                    auto column = block.getByPosition(pos);
-                    block.erase(pos);
-                    column.name = name_with_alias.second;
-                    block.insert(std::move(column));
-                }
-            }
-
-            if (subquery.joined_block_actions)
-                subquery.joined_block_actions->execute(block);
+            prepareBlockForJoin(subquery, block);
 
             if (!subquery.join->insertFromBlock(block))
+            {
                 done_with_join = true;
+                join_limit_hit = true;
+            }
         }
 
         if (!done_with_table)
@@ -168,6 +241,16 @@ void CreatingSetsBlockInputStream::createOne(SubqueryForSet & subquery)
     if (table_out)
         table_out->writeSuffix();
 
+    /// From now on the set will only be probed, never modified: allow reading it without locking.
+    if (subquery.set)
+        subquery.set->finishInsert();
+
+    /// If the set was built completely (the source was read to the end and no size limit
+    /// was hit), it can be reused by the following queries.
+    if (subquery.subquery_result_cache && subquery.set && !done_with_set)
+        subquery.subquery_result_cache->saveSet(
+            subquery.subquery_result_cache_key, subquery.set, std::move(subquery.subquery_result_cache_table_versions));
+
     watch.stop();
 
     size_t head_rows = 0;
@@ -181,6 +264,12 @@ void CreatingSetsBlockInputStream::createOne(SubqueryForSet & subquery)
             subquery.join->setTotals(profiling_in->getTotals());
     }
 
+    /// Likewise a completely built join can be reused by the following queries
+    /// (only LEFT and INNER joins get here, see ExpressionAnalyzer::appendJoin).
+    if (subquery.subquery_result_cache && subquery.join && !join_limit_hit)
+        subquery.subquery_result_cache->saveJoin(
+            subquery.subquery_result_cache_key, subquery.join, std::move(subquery.subquery_result_cache_table_versions));
+
     if (head_rows != 0)
     {
         std::stringstream msg;
@@ -39,23 +39,39 @@ Block CubeBlockInputStream::readImpl()
     /** After reading a block from input stream,
       * we will calculate all subsets of columns on next iterations of readImpl
       * by zeroing columns at positions, where bits are zero in current bitmask.
+      *
+      * Each subset is calculated not from the source block, but by merging the aggregation
+      * states of an already calculated level that differs from it by a single zeroed key
+      * (the one at the lowest zero bit of the mask). Coarser levels thus become cheaper,
+      * as the data to merge shrinks with every zeroed key.
       */
     if (mask)
     {
         --mask;
-        Block cube_block = source_block;
-        for (size_t i = 0; i < keys.size(); ++i)
-        {
-            if (!((mask >> i) & 1))
-            {
-                size_t pos = keys.size() - i - 1;
-                auto & current = cube_block.getByPosition(keys[pos]);
-                current.column = zero_block.getByPosition(keys[pos]).column;
-            }
-        }
+
+        size_t bit = __builtin_ctz(~mask);
+        auto parent_it = calculated_levels.find(mask | (1u << bit));
+
+        Block cube_block = parent_it->second.block;
+        size_t pos = keys.size() - bit - 1;
+        auto & current = cube_block.getByPosition(keys[pos]);
+        current.column = current.column->cloneEmpty()->cloneResized(cube_block.rows());
 
         BlocksList cube_blocks = { cube_block };
-        Block finalized = aggregator.mergeBlocks(cube_blocks, true);
+        cube_block = aggregator.mergeBlocks(cube_blocks, false);
+
+        if (0 == --parent_it->second.remaining_children)
+            calculated_levels.erase(parent_it);
+
+        /// Only levels with a run of ones in the low bits have children: masks are enumerated
+        ///  in descending order, so only zeroing a key below all already zeroed ones
+        ///  visits every subset exactly once.
+        size_t num_children = __builtin_ctz(~mask);
+        if (num_children)
+            calculated_levels[mask] = { cube_block, num_children };
+
+        Block finalized = cube_block;
+        finalizeBlock(finalized);
         return finalized;
     }
 
@@ -63,15 +79,12 @@ Block CubeBlockInputStream::readImpl()
     if (!source_block)
         return source_block;
 
-    zero_block = source_block.cloneEmpty();
-    for (auto key : keys)
-    {
-        auto & current = zero_block.getByPosition(key);
-        current.column = current.column->cloneResized(source_block.rows());
-    }
+    mask = (1 << keys.size()) - 1;
+    calculated_levels.clear();
+    calculated_levels[mask] = { source_block, keys.size() };
+
     Block finalized = source_block;
     finalizeBlock(finalized);
-    mask = (1 << keys.size()) - 1;
 
     return finalized;
 }
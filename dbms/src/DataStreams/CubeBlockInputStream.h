@@ -1,5 +1,7 @@
 #pragma once
 
+#include <map>
+
 #include <DataStreams/IProfilingBlockInputStream.h>
 #include <Common/Arena.h>
 #include <Interpreters/Aggregator.h>
@@ -36,7 +38,19 @@ private:
     ColumnNumbers keys;
     UInt32 mask = 0;
     Block source_block;
-    Block zero_block;
+
+    /** Already calculated levels (non-finalized) that will be used as the source
+      *  for coarser levels with one more key zeroed. A level is dropped as soon as
+      *  the last level derived from it is calculated, so no more than (number of keys + 1)
+      *  levels are alive at the same time.
+      */
+    struct CalculatedLevel
+    {
+        Block block;
+        size_t remaining_children = 0;
+    };
+
+    std::map<UInt32, CalculatedLevel> calculated_levels;
 };
 
 }
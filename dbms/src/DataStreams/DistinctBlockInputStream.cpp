@@ -1,4 +1,16 @@
 #include <DataStreams/DistinctBlockInputStream.h>
+#include <Common/CurrentThread.h>
+#include <DataStreams/NativeBlockOutputStream.h>
+#include <DataStreams/materializeBlock.h>
+#include <IO/WriteBufferFromFile.h>
+#include <IO/CompressedWriteBuffer.h>
+#include <Poco/File.h>
+
+namespace ProfileEvents
+{
+    extern const Event ExternalDistinctWritePart;
+    extern const Event ExternalDistinctMerge;
+}
 
 namespace DB
 {
@@ -8,10 +20,13 @@ namespace ErrorCodes
     extern const int SET_SIZE_LIMIT_EXCEEDED;
 }
 
-DistinctBlockInputStream::DistinctBlockInputStream(const BlockInputStreamPtr & input, const SizeLimits & set_size_limits, size_t limit_hint_, const Names & columns)
+DistinctBlockInputStream::DistinctBlockInputStream(const BlockInputStreamPtr & input, const SizeLimits & set_size_limits, size_t limit_hint_, const Names & columns,
+    size_t max_bytes_before_external_distinct_, const std::string & tmp_path_)
     : columns_names(columns)
     , limit_hint(limit_hint_)
     , set_size_limits(set_size_limits)
+    , max_bytes_before_external_distinct(max_bytes_before_external_distinct_)
+    , tmp_path(tmp_path_)
 {
     children.push_back(input);
 }
@@ -26,12 +41,34 @@ Block DistinctBlockInputStream::readImpl()
             return Block();
 
         /// Stop reading if we already reach the limit.
-        if (limit_hint && data.getTotalRowCount() >= limit_hint)
+        if (limit_hint && total_distinct_rows >= limit_hint)
             return Block();
 
+        if (input_exhausted)
+            return readFromPartitions();
+
         Block block = children[0]->read();
         if (!block)
-            return Block();
+        {
+            if (!spilling)
+                return Block();
+
+            /// Finish the partition files and proceed to deduplicating them.
+            input_exhausted = true;
+            for (auto & partition : partitions)
+            {
+                if (partition.block_out)
+                {
+                    partition.block_out->writeSuffix();
+                    partition.compressed_out->next();
+                    partition.file_out->next();
+                }
+            }
+
+            LOG_DEBUG(log, "Input is exhausted, merging spilled DISTINCT partitions.");
+            ProfileEvents::increment(ProfileEvents::ExternalDistinctMerge);
+            continue;
+        }
 
         const ColumnRawPtrs column_ptrs(getKeyColumns(block));
         if (column_ptrs.empty())
@@ -44,12 +81,45 @@ Block DistinctBlockInputStream::readImpl()
         }
 
         if (data.empty())
+        {
             data.init(SetVariants::chooseMethod(column_ptrs, key_sizes));
 
-        const size_t old_set_size = data.getTotalRowCount();
+            /// Remember the names of the key columns for the merge phase of the external mode.
+            size_t num_columns = columns_names.empty() ? block.columns() : columns_names.size();
+            for (size_t i = 0; i < num_columns; ++i)
+            {
+                const auto & elem = columns_names.empty() ? block.safeGetByPosition(i) : block.getByName(columns_names[i]);
+                if (!elem.column->isColumnConst())
+                    spill_key_names.push_back(elem.name);
+            }
+        }
+
         const size_t rows = block.rows();
         IColumn::Filter filter(rows);
 
+        if (spilling)
+        {
+            /// Rows duplicating an already emitted key are dropped, the rest go to the partition files.
+            PaddedPODArray<UInt64> hashes(rows);
+
+            switch (data.type)
+            {
+                case SetVariants::Type::EMPTY:
+                    break;
+            #define M(NAME) \
+                case SetVariants::Type::NAME: \
+                    buildFilterExcludingSeen(*data.NAME, column_ptrs, filter, rows, hashes); \
+                    break;
+                APPLY_FOR_SET_VARIANTS(M)
+            #undef M
+            }
+
+            spillBlock(block, filter, hashes);
+            continue;
+        }
+
+        const size_t old_set_size = data.getTotalRowCount();
+
         switch (data.type)
         {
             case SetVariants::Type::EMPTY:
@@ -66,7 +136,108 @@ Block DistinctBlockInputStream::readImpl()
         if (data.getTotalRowCount() == old_set_size)
             continue;
 
-        if (!set_size_limits.check(data.getTotalRowCount(), data.getTotalByteCount(), "DISTINCT", ErrorCodes::SET_SIZE_LIMIT_EXCEEDED))
+        total_distinct_rows = data.getTotalRowCount();
+
+        if (!set_size_limits.check(total_distinct_rows, data.getTotalByteCount(), "DISTINCT", ErrorCodes::SET_SIZE_LIMIT_EXCEEDED))
+            return {};
+
+        /// The query crossed its memory soft limit or was asked to release memory (see MemoryTracker).
+        /// Freeze only if the set is a substantial part of the query's memory, so that it actually helps.
+        bool memory_pressure = false;
+        if (!tmp_path.empty())
+            if (auto * memory_tracker = CurrentThread::getMemoryTracker().getParent())
+                memory_pressure = memory_tracker->isMemoryPressure()
+                    && static_cast<Int64>(data.getTotalByteCount()) * 20 > memory_tracker->get();
+
+        /// If the set has grown too large, freeze it and spill all subsequent new keys.
+        if ((max_bytes_before_external_distinct && data.getTotalByteCount() > max_bytes_before_external_distinct)
+            || memory_pressure)
+        {
+            spilling = true;
+            spill_header = materializeBlock(getHeader());
+            partitions.resize(NUM_PARTITIONS);
+
+            LOG_DEBUG(log, "DISTINCT set (" << data.getTotalRowCount() << " keys) is frozen,"
+                " new keys will be spilled into " << NUM_PARTITIONS << " temporary files.");
+        }
+
+        for (auto & elem : block)
+            elem.column = elem.column->filter(filter, -1);
+
+        return block;
+    }
+}
+
+
+Block DistinctBlockInputStream::readFromPartitions()
+{
+    while (1)
+    {
+        if (!partition_input)
+        {
+            while (current_partition < partitions.size() && !partitions[current_partition].file)
+                ++current_partition;
+
+            if (current_partition >= partitions.size())
+            {
+                no_more_rows = true;
+                return Block();
+            }
+
+            auto & partition = partitions[current_partition];
+            partition.block_out = nullptr;
+            partition.compressed_out = nullptr;
+            partition.file_out = nullptr;
+
+            partition_file_in = std::make_unique<ReadBufferFromFile>(partition.file->path());
+            partition_compressed_in = std::make_unique<CompressedReadBuffer>(*partition_file_in);
+            partition_input = std::make_shared<NativeBlockInputStream>(*partition_compressed_in, spill_header, 0);
+
+            /// A fresh set of the same kind: the partition holds the same key columns, materialized.
+            partition_data = std::make_unique<SetVariants>();
+            partition_data->init(data.type);
+        }
+
+        Block block = partition_input->read();
+        if (!block)
+        {
+            partition_input = nullptr;
+            partition_compressed_in = nullptr;
+            partition_file_in = nullptr;
+            partition_data = nullptr;
+            partitions[current_partition].file = nullptr;    /// Removes the temporary file.
+            ++current_partition;
+            continue;
+        }
+
+        ColumnRawPtrs column_ptrs;
+        column_ptrs.reserve(spill_key_names.size());
+        for (const auto & name : spill_key_names)
+            column_ptrs.push_back(block.getByName(name).column.get());
+
+        const size_t old_set_size = partition_data->getTotalRowCount();
+        const size_t rows = block.rows();
+        IColumn::Filter filter(rows);
+
+        switch (partition_data->type)
+        {
+            case SetVariants::Type::EMPTY:
+                break;
+        #define M(NAME) \
+            case SetVariants::Type::NAME: \
+                buildFilter(*partition_data->NAME, column_ptrs, filter, rows, *partition_data); \
+                break;
+            APPLY_FOR_SET_VARIANTS(M)
+        #undef M
+        }
+
+        if (partition_data->getTotalRowCount() == old_set_size)
+            continue;
+
+        total_distinct_rows += partition_data->getTotalRowCount() - old_set_size;
+
+        if (!set_size_limits.check(total_distinct_rows, data.getTotalByteCount() + partition_data->getTotalByteCount(),
+                "DISTINCT", ErrorCodes::SET_SIZE_LIMIT_EXCEEDED))
             return {};
 
         for (auto & elem : block)
@@ -77,6 +248,46 @@ Block DistinctBlockInputStream::readImpl()
 }
 
 
+void DistinctBlockInputStream::spillBlock(const Block & block, const IColumn::Filter & filter, const PaddedPODArray<UInt64> & hashes)
+{
+    Block materialized = materializeBlock(block);
+    const size_t rows = materialized.rows();
+
+    IColumn::Filter partition_filter(rows);
+    for (size_t partition_num = 0; partition_num < NUM_PARTITIONS; ++partition_num)
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < rows; ++i)
+        {
+            partition_filter[i] = filter[i] && (hashes[i] & (NUM_PARTITIONS - 1)) == partition_num;
+            count += partition_filter[i];
+        }
+
+        if (!count)
+            continue;
+
+        auto & partition = partitions[partition_num];
+        if (!partition.block_out)
+        {
+            Poco::File(tmp_path).createDirectories();
+            partition.file = std::make_unique<Poco::TemporaryFile>(tmp_path);
+            partition.file_out = std::make_unique<WriteBufferFromFile>(partition.file->path());
+            partition.compressed_out = std::make_unique<CompressedWriteBuffer>(*partition.file_out);
+            partition.block_out = std::make_shared<NativeBlockOutputStream>(*partition.compressed_out, 0, spill_header);
+
+            ProfileEvents::increment(ProfileEvents::ExternalDistinctWritePart);
+            LOG_DEBUG(log, "Spilling DISTINCT partition " << partition_num << " to " << partition.file->path());
+        }
+
+        Block chunk = materialized.cloneEmpty();
+        for (size_t i = 0; i < materialized.columns(); ++i)
+            chunk.getByPosition(i).column = materialized.getByPosition(i).column->filter(partition_filter, count);
+
+        partition.block_out->write(chunk);
+    }
+}
+
+
 template <typename Method>
 void DistinctBlockInputStream::buildFilter(
     Method & method,
@@ -107,6 +318,28 @@ void DistinctBlockInputStream::buildFilter(
 }
 
 
+template <typename Method>
+void DistinctBlockInputStream::buildFilterExcludingSeen(
+    Method & method,
+    const ColumnRawPtrs & columns,
+    IColumn::Filter & filter,
+    size_t rows,
+    PaddedPODArray<UInt64> & hashes) const
+{
+    typename Method::State state;
+    state.init(columns);
+
+    for (size_t i = 0; i < rows; ++i)
+    {
+        typename Method::Key key = state.getKey(columns, columns.size(), i, key_sizes);
+
+        /// The set is frozen: check the membership, do not insert anything.
+        filter[i] = method.data.end() == method.data.find(key);
+        hashes[i] = method.data.hash(key);
+    }
+}
+
+
 ColumnRawPtrs DistinctBlockInputStream::getKeyColumns(const Block & block) const
 {
     size_t columns = columns_names.empty() ? block.columns() : columns_names.size();
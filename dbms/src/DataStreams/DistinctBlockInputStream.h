@@ -1,23 +1,41 @@
 #pragma once
 
+#include <Poco/TemporaryFile.h>
+
+#include <common/logger_useful.h>
+
 #include <DataStreams/IProfilingBlockInputStream.h>
+#include <DataStreams/NativeBlockInputStream.h>
 #include <Interpreters/SetVariants.h>
 
+#include <IO/ReadBufferFromFile.h>
+#include <IO/CompressedReadBuffer.h>
+
 namespace DB
 {
 
+class WriteBufferFromFile;
+class CompressedWriteBuffer;
+
 /** This class is intended for implementation of SELECT DISTINCT clause and
   * leaves only unique rows in the stream.
   *
   * To optimize the SELECT DISTINCT ... LIMIT clause we can
   * set limit_hint to non zero value. So we stop emitting new rows after
   * count of already emitted rows will reach the limit_hint.
+  *
+  * If max_bytes_before_external_distinct is set and the in-memory set outgrows it, the set is
+  * frozen and subsequent rows that are not duplicates of already emitted ones are partitioned
+  * by key hash into temporary files. After the input is exhausted, every partition is
+  * deduplicated independently with a fresh set, so the memory usage is bounded by the frozen
+  * set plus the distinct keys of one partition. The spilled tail is not streamed.
   */
 class DistinctBlockInputStream : public IProfilingBlockInputStream
 {
 public:
     /// Empty columns_ means all collumns.
-    DistinctBlockInputStream(const BlockInputStreamPtr & input, const SizeLimits & set_size_limits, size_t limit_hint_, const Names & columns);
+    DistinctBlockInputStream(const BlockInputStreamPtr & input, const SizeLimits & set_size_limits, size_t limit_hint_, const Names & columns,
+        size_t max_bytes_before_external_distinct_ = 0, const std::string & tmp_path_ = "");
 
     String getName() const override { return "Distinct"; }
 
@@ -37,6 +55,23 @@ private:
         size_t rows,
         SetVariants & variants) const;
 
+    /// Mark rows that are not in the (frozen) set, without inserting them, and calculate key hashes.
+    template <typename Method>
+    void buildFilterExcludingSeen(
+        Method & method,
+        const ColumnRawPtrs & key_columns,
+        IColumn::Filter & filter,
+        size_t rows,
+        PaddedPODArray<UInt64> & hashes) const;
+
+    /// Distribute the marked rows of the block over the partition files by key hash.
+    void spillBlock(const Block & block, const IColumn::Filter & filter, const PaddedPODArray<UInt64> & hashes);
+
+    /// Deduplicate and return the spilled blocks, partition by partition.
+    Block readFromPartitions();
+
+    /// Must be a power of two.
+    static constexpr size_t NUM_PARTITIONS = 16;
 
     Names columns_names;
     SetVariants data;
@@ -47,6 +82,44 @@ private:
 
     /// Restrictions on the maximum size of the output data.
     SizeLimits set_size_limits;
+
+    size_t max_bytes_before_external_distinct;
+    std::string tmp_path;
+
+    Logger * log = &Logger::get("DistinctBlockInputStream");
+
+    /// Everything below is for the external (spilling) mode.
+
+    /// The in-memory set is frozen; new candidate rows go to the partition files.
+    bool spilling = false;
+    bool input_exhausted = false;
+
+    /// Distinct keys emitted so far over all phases.
+    size_t total_distinct_rows = 0;
+
+    /// Header of the spilled blocks: as the input, but with constant columns materialized,
+    ///  because constants cannot be serialized in Native format.
+    Block spill_header;
+    /// Names of the key columns fixed at the first block, so that the merge phase uses the same
+    ///  keys even though the materialized columns are not constant anymore.
+    Names spill_key_names;
+
+    struct TemporaryPartition
+    {
+        std::unique_ptr<Poco::TemporaryFile> file;
+        std::unique_ptr<WriteBufferFromFile> file_out;
+        std::unique_ptr<CompressedWriteBuffer> compressed_out;
+        BlockOutputStreamPtr block_out;
+    };
+
+    std::vector<TemporaryPartition> partitions;
+
+    /// Reading state of the merge phase.
+    size_t current_partition = 0;
+    std::unique_ptr<ReadBufferFromFile> partition_file_in;
+    std::unique_ptr<CompressedReadBuffer> partition_compressed_in;
+    BlockInputStreamPtr partition_input;
+    std::unique_ptr<SetVariants> partition_data;
 };
 
 }
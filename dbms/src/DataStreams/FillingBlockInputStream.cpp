@@ -0,0 +1,284 @@
+#include <DataStreams/FillingBlockInputStream.h>
+#include <Common/FieldVisitors.h>
+
+
+namespace DB
+{
+
+namespace ErrorCodes
+{
+    extern const int INVALID_WITH_FILL_EXPRESSION;
+}
+
+namespace
+{
+    bool less(const Field & lhs, const Field & rhs, int direction)
+    {
+        if (direction > 0)
+            return applyVisitor(FieldVisitorAccurateLess(), lhs, rhs);
+        return applyVisitor(FieldVisitorAccurateLess(), rhs, lhs);
+    }
+
+    bool equals(const Field & lhs, const Field & rhs)
+    {
+        return applyVisitor(FieldVisitorAccurateEquals(), lhs, rhs);
+    }
+}
+
+
+FillingRow::FillingRow(const FillColumnDescriptions & descriptions_)
+    : row(descriptions_.size()), descriptions(descriptions_)
+{
+}
+
+
+void FillingRow::initFromDefaults(size_t from_pos)
+{
+    for (size_t i = from_pos; i < size(); ++i)
+        row[i] = descriptions[i].fill_from;
+}
+
+
+bool FillingRow::operator<(const FillingRow & other) const
+{
+    for (size_t i = 0; i < size(); ++i)
+    {
+        if (row[i].isNull() || other.row[i].isNull() || equals(row[i], other.row[i]))
+            continue;
+        return less(row[i], other.row[i], getDirection(i));
+    }
+    return false;
+}
+
+
+bool FillingRow::next(const FillingRow & to_row)
+{
+    /// Find the first position where this row lags behind 'to_row'.
+    size_t pos = 0;
+    for (; pos < size(); ++pos)
+        if (!row[pos].isNull() && !to_row.row[pos].isNull() && !equals(row[pos], to_row.row[pos]))
+            break;
+
+    if (pos == size() || less(to_row.row[pos], row[pos], getDirection(pos)))
+        return false;
+
+    /// If a column after 'pos' still has room up to its own fill_to boundary,
+    ///  it is the one to advance (the odometer turns its lowest wheel first).
+    for (size_t i = size() - 1; i > pos; --i)
+    {
+        if (getFillDescription(i).fill_to.isNull() || row[i].isNull())
+            continue;
+
+        auto next_value = row[i];
+        applyVisitor(FieldVisitorSum(getFillDescription(i).fill_step), next_value);
+        if (less(next_value, getFillDescription(i).fill_to, getDirection(i)))
+        {
+            row[i] = next_value;
+            initFromDefaults(i + 1);
+            return true;
+        }
+    }
+
+    auto next_value = row[pos];
+    applyVisitor(FieldVisitorSum(getFillDescription(pos).fill_step), next_value);
+
+    if (less(to_row.row[pos], next_value, getDirection(pos)))
+        return false;
+
+    row[pos] = next_value;
+
+    if (equals(row[pos], to_row.row[pos]))
+    {
+        /// We have caught up at 'pos'; the following columns restart and the generated row
+        ///  is needed only if it is still before 'to_row'.
+        bool is_less = false;
+        for (size_t i = pos + 1; i < size(); ++i)
+        {
+            const auto & fill_from = getFillDescription(i).fill_from;
+            if (!fill_from.isNull())
+                row[i] = fill_from;
+            else
+                row[i] = to_row.row[i];
+            is_less |= less(row[i], to_row.row[i], getDirection(i));
+        }
+        return is_less;
+    }
+
+    initFromDefaults(pos + 1);
+    return true;
+}
+
+
+FillingBlockInputStream::FillingBlockInputStream(
+    const BlockInputStreamPtr & input, const FillColumnDescriptions & fill_description_)
+    : fill_description(fill_description_), filling_row(fill_description), next_row(fill_description)
+{
+    children.push_back(input);
+
+    const Block & header = children.back()->getHeader();
+
+    std::vector<bool> is_fill_column(header.columns());
+    for (const auto & desc : fill_description)
+    {
+        size_t position = header.getPositionByName(desc.column_name);
+        fill_column_positions.push_back(position);
+        is_fill_column[position] = true;
+
+        const auto & type = header.getByPosition(position).type;
+        if (!type->isValueRepresentedByNumber())
+            throw Exception("WITH FILL can be used only with numeric, Date or DateTime columns, but column "
+                + desc.column_name + " has type " + type->getName(), ErrorCodes::INVALID_WITH_FILL_EXPRESSION);
+
+        Float64 step = applyVisitor(FieldVisitorConvertToNumber<Float64>(), desc.fill_step);
+        if (step == 0 || (step > 0) != (desc.direction > 0))
+            throw Exception("WITH FILL STEP value for column " + desc.column_name
+                + " must be non-zero and have the sign of the sorting direction", ErrorCodes::INVALID_WITH_FILL_EXPRESSION);
+    }
+
+    for (size_t i = 0; i < header.columns(); ++i)
+        if (!is_fill_column[i])
+            other_column_positions.push_back(i);
+}
+
+
+void FillingBlockInputStream::insertFromFillingRow(MutableColumns & res_fill_columns, MutableColumns & res_other_columns)
+{
+    for (size_t i = 0; i < res_fill_columns.size(); ++i)
+    {
+        if (filling_row[i].isNull())
+            res_fill_columns[i]->insertDefault();
+        else
+            res_fill_columns[i]->insert(filling_row[i]);
+    }
+
+    for (auto & column : res_other_columns)
+        column->insertDefault();
+}
+
+
+Block FillingBlockInputStream::createResultBlock(MutableColumns && res_fill_columns, MutableColumns && res_other_columns) const
+{
+    Block res = getHeader().cloneEmpty();
+
+    for (size_t i = 0; i < fill_column_positions.size(); ++i)
+        res.getByPosition(fill_column_positions[i]).column = std::move(res_fill_columns[i]);
+    for (size_t i = 0; i < other_column_positions.size(); ++i)
+        res.getByPosition(other_column_positions[i]).column = std::move(res_other_columns[i]);
+
+    return res;
+}
+
+
+Block FillingBlockInputStream::readImpl()
+{
+    Block block = children.back()->read();
+
+    if (block)
+        return fillBlock(block);
+
+    /// The input is over; generate the tail up to the fill_to boundaries.
+    if (first || generated_suffix)
+        return {};
+
+    generated_suffix = true;
+
+    const Block & header = getHeader();
+    MutableColumns res_fill_columns(fill_column_positions.size());
+    MutableColumns res_other_columns(other_column_positions.size());
+    for (size_t i = 0; i < fill_column_positions.size(); ++i)
+        res_fill_columns[i] = header.getByPosition(fill_column_positions[i]).column->cloneEmpty();
+    for (size_t i = 0; i < other_column_positions.size(); ++i)
+        res_other_columns[i] = header.getByPosition(other_column_positions[i]).column->cloneEmpty();
+
+    bool should_insert_first = next_row < filling_row;
+
+    for (size_t i = 0; i < filling_row.size(); ++i)
+        next_row[i] = filling_row.getFillDescription(i).fill_to;
+
+    if (should_insert_first && filling_row < next_row)
+        insertFromFillingRow(res_fill_columns, res_other_columns);
+
+    while (filling_row.next(next_row))
+        insertFromFillingRow(res_fill_columns, res_other_columns);
+
+    if (res_fill_columns.empty() || res_fill_columns[0]->empty())
+        return {};
+
+    return createResultBlock(std::move(res_fill_columns), std::move(res_other_columns));
+}
+
+
+Block FillingBlockInputStream::fillBlock(const Block & block)
+{
+    size_t rows = block.rows();
+
+    Columns old_fill_columns;
+    Columns old_other_columns;
+    MutableColumns res_fill_columns;
+    MutableColumns res_other_columns;
+
+    for (size_t position : fill_column_positions)
+    {
+        old_fill_columns.push_back(block.getByPosition(position).column);
+        res_fill_columns.push_back(old_fill_columns.back()->cloneEmpty());
+    }
+    for (size_t position : other_column_positions)
+    {
+        old_other_columns.push_back(block.getByPosition(position).column);
+        res_other_columns.push_back(old_other_columns.back()->cloneEmpty());
+    }
+
+    if (first)
+    {
+        /// Start the generated sequence from fill_from if it precedes the first value of the data.
+        for (size_t i = 0; i < filling_row.size(); ++i)
+        {
+            Field current_value = (*old_fill_columns[i])[0];
+            const auto & fill_from = filling_row.getFillDescription(i).fill_from;
+
+            if (!fill_from.isNull() && !equals(current_value, fill_from))
+            {
+                filling_row.initFromDefaults(i);
+                if (less(fill_from, current_value, filling_row.getDirection(i)))
+                    insertFromFillingRow(res_fill_columns, res_other_columns);
+                break;
+            }
+            filling_row[i] = current_value;
+        }
+        first = false;
+    }
+
+    for (size_t row_ind = 0; row_ind < rows; ++row_ind)
+    {
+        bool should_insert_first = next_row < filling_row;
+
+        for (size_t i = 0; i < filling_row.size(); ++i)
+        {
+            Field current_value = (*old_fill_columns[i])[row_ind];
+            const auto & fill_to = filling_row.getFillDescription(i).fill_to;
+
+            if (fill_to.isNull() || less(current_value, fill_to, filling_row.getDirection(i)))
+                next_row[i] = current_value;
+            else
+                next_row[i] = fill_to;
+        }
+
+        /// The previous iteration could have left a row initialized from fill_from defaults
+        ///  that was not emitted yet.
+        if (should_insert_first && filling_row < next_row)
+            insertFromFillingRow(res_fill_columns, res_other_columns);
+
+        /// Synthesize the rows missing before the current row of the data.
+        while (filling_row.next(next_row))
+            insertFromFillingRow(res_fill_columns, res_other_columns);
+
+        for (size_t i = 0; i < old_fill_columns.size(); ++i)
+            res_fill_columns[i]->insertFrom(*old_fill_columns[i], row_ind);
+        for (size_t i = 0; i < old_other_columns.size(); ++i)
+            res_other_columns[i]->insertFrom(*old_other_columns[i], row_ind);
+    }
+
+    return createResultBlock(std::move(res_fill_columns), std::move(res_other_columns));
+}
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <Core/ColumnNumbers.h>
+#include <Core/Field.h>
+#include <DataStreams/IProfilingBlockInputStream.h>
+
+
+namespace DB
+{
+
+/// How to fill gaps in one ORDER BY ... WITH FILL column.
+struct FillColumnDescription
+{
+    String column_name;
+    int direction;      /// Direction of the ORDER BY element: 1 for ASC, -1 for DESC.
+    Field fill_from;    /// First generated value; Null - start from the first value of the data.
+    Field fill_to;      /// Boundary of generated values (not included); Null - stop at the last value of the data.
+    Field fill_step;    /// Step between generated values; the interpreter defaults it to +1 or -1 by direction.
+};
+
+using FillColumnDescriptions = std::vector<FillColumnDescription>;
+
+
+/** The values of the WITH FILL columns of one (real or synthesized) row,
+  *  with the logic of stepping from one synthesized row to the next.
+  */
+class FillingRow
+{
+public:
+    explicit FillingRow(const FillColumnDescriptions & descriptions_);
+
+    /// Advances this row one step towards 'to_row' (like an odometer: the last column
+    ///  that differs is incremented, the following ones restart from their defaults).
+    /// Returns false if no row strictly before 'to_row' can be generated any more.
+    bool next(const FillingRow & to_row);
+
+    /// Restart the columns starting from 'from_pos' from their fill_from values.
+    void initFromDefaults(size_t from_pos = 0);
+
+    Field & operator[](size_t ind) { return row[ind]; }
+    const Field & operator[](size_t ind) const { return row[ind]; }
+    size_t size() const { return row.size(); }
+
+    /// Lexicographic comparison respecting the sorting directions. Null values do not participate.
+    bool operator<(const FillingRow & other) const;
+
+    int getDirection(size_t ind) const { return descriptions[ind].direction; }
+    const FillColumnDescription & getFillDescription(size_t ind) const { return descriptions[ind]; }
+
+private:
+    std::vector<Field> row;
+    const FillColumnDescriptions & descriptions;
+};
+
+
+/** Implements the WITH FILL modifier of ORDER BY (see executeFilling): reads a stream sorted
+  *  by the ORDER BY expression and inserts synthesized rows for the key values missing between
+  *  adjacent rows, stepping by fill_step within the [fill_from, fill_to) boundaries.
+  * The other columns of synthesized rows are filled with default values.
+  * Replaces the usual pattern of a LEFT JOIN with a generated "spine" of keys, without
+  *  materializing the join inputs.
+  */
+class FillingBlockInputStream : public IProfilingBlockInputStream
+{
+public:
+    FillingBlockInputStream(const BlockInputStreamPtr & input, const FillColumnDescriptions & fill_description_);
+
+    String getName() const override { return "Filling"; }
+    Block getHeader() const override { return children.back()->getHeader(); }
+
+protected:
+    Block readImpl() override;
+
+private:
+    Block fillBlock(const Block & block);
+
+    void insertFromFillingRow(MutableColumns & res_fill_columns, MutableColumns & res_other_columns);
+    Block createResultBlock(MutableColumns && res_fill_columns, MutableColumns && res_other_columns) const;
+
+    FillColumnDescriptions fill_description;
+
+    /// Positions of the WITH FILL columns and of all the other columns in the header.
+    ColumnNumbers fill_column_positions;
+    ColumnNumbers other_column_positions;
+
+    FillingRow filling_row;     /// The last row that was emitted (real or synthesized).
+    FillingRow next_row;        /// The row up to which the gap is being filled.
+
+    bool first = true;
+    bool generated_suffix = false;
+};
+
+}
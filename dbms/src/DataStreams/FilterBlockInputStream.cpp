@@ -18,8 +18,9 @@ namespace ErrorCodes
 
 
 FilterBlockInputStream::FilterBlockInputStream(const BlockInputStreamPtr & input, const ExpressionActionsPtr & expression_,
-                                               const String & filter_column_name, bool remove_filter)
-    : remove_filter(remove_filter), expression(expression_)
+                                               const String & filter_column_name, bool remove_filter,
+                                               const ExpressionActionsPtr & post_expression_)
+    : remove_filter(remove_filter), expression(expression_), post_expression(post_expression_)
 {
     children.push_back(input);
 
@@ -44,10 +45,13 @@ FilterBlockInputStream::FilterBlockInputStream(const BlockInputStreamPtr & input
 
     if (remove_filter)
         header.erase(filter_column_name);
+
+    if (post_expression)
+        post_expression->execute(header);
 }
 
 
-String FilterBlockInputStream::getName() const { return "Filter"; }
+String FilterBlockInputStream::getName() const { return post_expression ? "FilterAndExpression" : "Filter"; }
 
 
 Block FilterBlockInputStream::getTotals()
@@ -56,6 +60,8 @@ Block FilterBlockInputStream::getTotals()
     {
         totals = child->getTotals();
         expression->executeOnTotals(totals);
+        if (post_expression)
+            post_expression->executeOnTotals(totals);
     }
 
     return totals;
@@ -184,6 +190,10 @@ Block FilterBlockInputStream::removeFilterIfNeed(Block && block)
     if (block && remove_filter)
         block.erase(static_cast<size_t>(filter_column));
 
+    /// The fused expression is evaluated only for the rows that passed the filter.
+    if (block && post_expression)
+        post_expression->execute(block);
+
     return std::move(block);
 }
 
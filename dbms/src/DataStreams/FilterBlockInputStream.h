@@ -13,6 +13,10 @@ class ExpressionActions;
 /** Implements WHERE, HAVING operations.
   * A stream of blocks and an expression, which adds to the block one ColumnUInt8 column containing the filtering conditions, are passed as input.
   * The expression is evaluated and a stream of blocks is returned, which contains only the filtered rows.
+  *
+  * Optionally a second expression can be fused into the same pass (see fuse_filter_and_expression):
+  * it is evaluated after filtering, so only for the rows that passed the filter,
+  * and replaces a separate ExpressionBlockInputStream stage.
   */
 class FilterBlockInputStream : public IProfilingBlockInputStream
 {
@@ -21,7 +25,8 @@ private:
 
 public:
     FilterBlockInputStream(const BlockInputStreamPtr & input, const ExpressionActionsPtr & expression_,
-                           const String & filter_column_name_, bool remove_filter = false);
+                           const String & filter_column_name_, bool remove_filter = false,
+                           const ExpressionActionsPtr & post_expression_ = nullptr);
 
     String getName() const override;
     Block getTotals() override;
@@ -34,6 +39,7 @@ protected:
 
 private:
     ExpressionActionsPtr expression;
+    ExpressionActionsPtr post_expression;
     Block header;
     ssize_t filter_column;
 
@@ -1,9 +1,11 @@
 #include <math.h>
+#include <iomanip>
 
 #include <DataStreams/IProfilingBlockInputStream.h>
 #include <DataStreams/IBlockInputStream.h>
 
 #include <IO/WriteHelpers.h>
+#include <Common/formatReadable.h>
 
 
 namespace DB
@@ -93,5 +95,49 @@ void IBlockInputStream::dumpTree(std::ostream & ostr, size_t indent, size_t mult
     }
 }
 
+
+void IBlockInputStream::dumpTreeWithProfile(std::ostream & ostr, size_t indent) const
+{
+    ostr << String(indent, ' ') << getName();
+
+    if (const auto * profiling = dynamic_cast<const IProfilingBlockInputStream *>(this))
+    {
+        const BlockStreamProfileInfo & profile_info = profiling->getProfileInfo();
+        if (profile_info.started)
+        {
+            /// read() of this stream includes reading from children; subtract it to get own time.
+            /// For streams that read children from separate threads (e.g. Union) own time
+            /// has no meaning, so it is clamped at zero.
+            UInt64 children_execution_time_ns = 0;
+            for (const auto & child : children)
+                if (const auto * profiling_child = dynamic_cast<const IProfilingBlockInputStream *>(child.get()))
+                    children_execution_time_ns += profiling_child->getProfileInfo().execution_time_ns;
+
+            UInt64 self_time_ns = profile_info.execution_time_ns > children_execution_time_ns
+                ? profile_info.execution_time_ns - children_execution_time_ns
+                : 0;
+
+            /// The clocks have different granularity, clamp at zero just in case.
+            UInt64 wait_time_ns = profile_info.execution_time_ns > profile_info.cpu_time_ns
+                ? profile_info.execution_time_ns - profile_info.cpu_time_ns
+                : 0;
+
+            ostr << ": " << profile_info.rows << " rows, " << formatReadableSizeWithBinarySuffix(profile_info.bytes)
+                << " in " << profile_info.blocks << " blocks"
+                << std::fixed << std::setprecision(3)
+                << ", total " << profile_info.execution_time_ns / 1000000.0 << " ms"
+                << ", self " << self_time_ns / 1000000.0 << " ms"
+                << ", CPU " << profile_info.cpu_time_ns / 1000000.0 << " ms"
+                << ", wait " << wait_time_ns / 1000000.0 << " ms";
+        }
+    }
+
+    ostr << '\n';
+
+    /// Unlike dumpTree, repeated subtrees are not folded, because their timings differ.
+    for (const auto & child : children)
+        child->dumpTreeWithProfile(ostr, indent + 1);
+}
+
 }
 
@@ -93,6 +93,11 @@ public:
       */
     void dumpTree(std::ostream & ostr, size_t indent = 0, size_t multiplier = 1) const;
 
+    /** Prints the tree of streams annotated with rows/bytes and timings from BlockStreamProfileInfo.
+      * In contrast to dumpTree, must be called after the query has been executed.
+      */
+    void dumpTreeWithProfile(std::ostream & ostr, size_t indent = 0) const;
+
     /** Check the depth of the pipeline.
       * If max_depth is specified and the `depth` is greater - throw an exception.
       * Must be called before read, readPrefix.
@@ -44,6 +44,11 @@ Block IProfilingBlockInputStream::read()
         info.started = true;
     }
 
+    /// Time of this read() call, including reading from children (they are called from readImpl).
+    /// The difference of the two clocks is the time spent waiting.
+    Stopwatch watch;
+    Stopwatch cpu_watch(CLOCK_THREAD_CPUTIME_ID);
+
     Block res;
 
     if (isCancelledOrThrowIfKilled())
@@ -81,6 +86,9 @@ Block IProfilingBlockInputStream::read()
 
     progress(Progress(res.rows(), res.bytes()));
 
+    info.execution_time_ns += watch.elapsed();
+    info.cpu_time_ns += cpu_watch.elapsed();
+
 #ifndef NDEBUG
     if (res)
     {
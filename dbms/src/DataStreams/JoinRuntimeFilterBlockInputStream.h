@@ -0,0 +1,43 @@
+#pragma once
+
+#include <DataStreams/IProfilingBlockInputStream.h>
+#include <Interpreters/Join.h>
+
+
+namespace DB
+{
+
+/** Filters blocks of the left table of a JOIN by the runtime Bloom filter,
+  *  built from the keys of the right table (see the join_runtime_filter setting).
+  * Rows whose keys surely do not match any build-side key are dropped before
+  *  the rest of the pipeline processes them.
+  * Must be used only when dropping non-joined left rows does not change the result
+  *  (INNER and RIGHT joins). Does not change the structure of blocks.
+  */
+class JoinRuntimeFilterBlockInputStream : public IProfilingBlockInputStream
+{
+public:
+    JoinRuntimeFilterBlockInputStream(const BlockInputStreamPtr & input, const std::shared_ptr<const Join> & join_)
+        : join(join_)
+    {
+        children.push_back(input);
+    }
+
+    String getName() const override { return "JoinRuntimeFilter"; }
+
+    Block getHeader() const override { return children.back()->getHeader(); }
+
+protected:
+    Block readImpl() override
+    {
+        Block res = children.back()->read();
+        if (res)
+            join->filterBlockByRuntimeFilter(res);
+        return res;
+    }
+
+private:
+    std::shared_ptr<const Join> join;
+};
+
+}
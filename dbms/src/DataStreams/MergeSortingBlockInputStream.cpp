@@ -4,6 +4,7 @@
 #include <DataStreams/copyData.h>
 #include <DataStreams/processConstants.h>
 #include <Common/formatReadable.h>
+#include <Common/CurrentThread.h>
 #include <IO/WriteBufferFromFile.h>
 #include <IO/CompressedWriteBuffer.h>
 #include <Interpreters/sortBlock.h>
@@ -21,16 +22,27 @@ namespace DB
 MergeSortingBlockInputStream::MergeSortingBlockInputStream(
     const BlockInputStreamPtr & input, SortDescription & description_,
     size_t max_merged_block_size_, size_t limit_, size_t max_bytes_before_remerge_,
-    size_t max_bytes_before_external_sort_, const std::string & tmp_path_)
+    size_t max_bytes_before_external_sort_, const std::string & tmp_path_,
+    SortingCutoffPtr cutoff_)
     : description(description_), max_merged_block_size(max_merged_block_size_), limit(limit_),
     max_bytes_before_remerge(max_bytes_before_remerge_),
-    max_bytes_before_external_sort(max_bytes_before_external_sort_), tmp_path(tmp_path_)
+    max_bytes_before_external_sort(max_bytes_before_external_sort_), tmp_path(tmp_path_),
+    cutoff(std::move(cutoff_))
 {
     children.push_back(input);
     header = children.at(0)->getHeader();
     header_without_constants = header;
     removeConstantsFromBlock(header_without_constants);
+
+    size_t description_size_before = description.size();
     removeConstantsFromSortDescription(header, description);
+
+    bool has_collation = false;
+    for (const auto & elem : description)
+        if (elem.collator)
+            has_collation = true;
+
+    can_share_cutoff = cutoff && limit && !has_collation && description.size() == description_size_before;
 }
 
 
@@ -60,22 +72,35 @@ Block MergeSortingBlockInputStream::readImpl()
             sum_bytes_in_blocks += block.allocatedBytes();
 
             /** If significant amount of data was accumulated, perform preliminary merging step.
+              * For a limit that fits into one block, do it regardless of the accumulated bytes:
+              *  the merge keeps at most `limit` rows, so the memory stays bounded by a couple of
+              *  blocks (a top-K instead of a full sort), and the blocks coming from the partial
+              *  sorts are already cut to `limit` rows, making the merge itself cheap.
               */
             if (blocks.size() > 1
                 && limit
                 && limit * 2 < sum_rows_in_blocks   /// 2 is just a guess.
                 && remerge_is_useful
-                && max_bytes_before_remerge
-                && sum_bytes_in_blocks > max_bytes_before_remerge)
+                && ((max_bytes_before_remerge && sum_bytes_in_blocks > max_bytes_before_remerge)
+                    || limit <= max_merged_block_size))
             {
                 remerge();
             }
 
+            /** The query crossed its memory soft limit or was asked to release memory (see MemoryTracker).
+              * Flush only if the accumulated blocks are a substantial part of the query's memory, so that it actually helps.
+              */
+            bool memory_pressure = false;
+            if (auto * memory_tracker = CurrentThread::getMemoryTracker().getParent())
+                memory_pressure = memory_tracker->isMemoryPressure()
+                    && static_cast<Int64>(sum_bytes_in_blocks) * 20 > memory_tracker->get();
+
             /** If too many of them and if external sorting is enabled,
               *  will merge blocks that we have in memory at this moment and write merged stream to temporary (compressed) file.
               * NOTE. It's possible to check free space in filesystem.
               */
-            if (max_bytes_before_external_sort && sum_bytes_in_blocks > max_bytes_before_external_sort)
+            if ((max_bytes_before_external_sort && sum_bytes_in_blocks > max_bytes_before_external_sort)
+                || memory_pressure)
             {
                 Poco::File(tmp_path).createDirectories();
                 temporary_files.emplace_back(new Poco::TemporaryFile(tmp_path));
@@ -249,12 +274,27 @@ void MergeSortingBlockInputStream::remerge()
         << formatReadableSizeWithBinarySuffix(sum_bytes_in_blocks) << " to "
         << formatReadableSizeWithBinarySuffix(new_sum_bytes_in_blocks));
 
-    /// If the memory consumption was not lowered enough - we will not perform remerge anymore. 2 is a guess.
-    if (new_sum_bytes_in_blocks * 2 > sum_bytes_in_blocks)
+    /// If neither the memory consumption nor the number of rows was lowered enough - we will not
+    ///  perform remerge anymore. 2 is a guess. (For a small limit the rows are always cut down to
+    ///  `limit`, so the top-K mode is not disabled by the per-block allocation overhead.)
+    if (new_sum_bytes_in_blocks * 2 > sum_bytes_in_blocks && new_sum_rows_in_blocks * 2 > sum_rows_in_blocks)
         remerge_is_useful = false;
 
     blocks = std::move(new_blocks);
     sum_rows_in_blocks = new_sum_rows_in_blocks;
     sum_bytes_in_blocks = new_sum_bytes_in_blocks;
+
+    /// Everything accumulated now fits into `limit` rows: its last row is the limit-th best row
+    ///  over all data read so far, let the upstream partial sorts discard everything beyond it.
+    if (can_share_cutoff && sum_rows_in_blocks == limit && !blocks.empty())
+    {
+        const Block & last = blocks.back();
+        Columns candidate;
+        candidate.reserve(description.size());
+        for (const auto & column_with_description : getColumnsWithSortDescription(last, description))
+            candidate.push_back(column_with_description.first->cut(last.rows() - 1, 1));
+
+        cutoff->update(std::move(candidate), description);
+    }
 }
 }
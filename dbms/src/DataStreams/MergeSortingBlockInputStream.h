@@ -10,6 +10,7 @@
 
 #include <DataStreams/IProfilingBlockInputStream.h>
 #include <DataStreams/NativeBlockInputStream.h>
+#include <DataStreams/PartialSortingBlockInputStream.h>
 
 #include <IO/ReadBufferFromFile.h>
 #include <IO/CompressedReadBuffer.h>
@@ -70,10 +71,13 @@ class MergeSortingBlockInputStream : public IProfilingBlockInputStream
 {
 public:
     /// limit - if not 0, allowed to return just first 'limit' rows in sorted order.
+    /// cutoff - if given, is tightened with the limit-th best row over everything accumulated so far,
+    ///  so that the upstream PartialSortingBlockInputStream instances can discard rows early.
     MergeSortingBlockInputStream(const BlockInputStreamPtr & input, SortDescription & description_,
         size_t max_merged_block_size_, size_t limit_,
         size_t max_bytes_before_remerge_,
-        size_t max_bytes_before_external_sort_, const std::string & tmp_path_);
+        size_t max_bytes_before_external_sort_, const std::string & tmp_path_,
+        SortingCutoffPtr cutoff_ = nullptr);
 
     String getName() const override { return "MergeSorting"; }
 
@@ -94,6 +98,12 @@ private:
     size_t max_bytes_before_external_sort;
     const std::string tmp_path;
 
+    /// Whether the shared cutoff may be tightened from the accumulated blocks: only when the sort
+    ///  description was not reduced (the cutoff columns must match what the partial sorts compare)
+    ///  and there are no collations (compareAt does not collate).
+    SortingCutoffPtr cutoff;
+    bool can_share_cutoff = false;
+
     Logger * log = &Logger::get("MergeSortingBlockInputStream");
 
     Blocks blocks;
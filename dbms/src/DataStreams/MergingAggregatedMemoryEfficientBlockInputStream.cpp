@@ -301,7 +301,10 @@ void MergingAggregatedMemoryEfficientBlockInputStream::mergeThread(ThreadGroupSt
     try
     {
         if (thread_group)
+        {
             CurrentThread::attachToIfDetached(thread_group);
+            CurrentThread::setQueryStage("MergingAggregatedMemoryEfficient");
+        }
         setThreadName("MergeAggMergThr");
 
         while (!parallel_merge_data->finish)
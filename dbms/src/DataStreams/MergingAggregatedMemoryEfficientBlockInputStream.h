@@ -4,7 +4,7 @@
 #include <DataStreams/IProfilingBlockInputStream.h>
 #include <Common/ConcurrentBoundedQueue.h>
 #include <Common/CurrentThread.h>
-#include <common/ThreadPool.h>
+#include <Common/ThreadPool.h>
 #include <condition_variable>
 
 
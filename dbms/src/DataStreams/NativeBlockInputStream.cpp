@@ -5,6 +5,8 @@
 #include <IO/CompressedReadBufferFromFile.h>
 
 #include <DataTypes/DataTypeFactory.h>
+#include <Columns/ColumnsNumber.h>
+#include <Columns/ColumnFixedString.h>
 #include <Common/typeid_cast.h>
 #include <ext/range.h>
 
@@ -23,13 +25,13 @@ namespace ErrorCodes
 }
 
 
-NativeBlockInputStream::NativeBlockInputStream(ReadBuffer & istr_, UInt64 server_revision_)
-    : istr(istr_), server_revision(server_revision_)
+NativeBlockInputStream::NativeBlockInputStream(ReadBuffer & istr_, UInt64 server_revision_, bool zero_copy_views_)
+    : istr(istr_), server_revision(server_revision_), zero_copy_views(zero_copy_views_)
 {
 }
 
-NativeBlockInputStream::NativeBlockInputStream(ReadBuffer & istr_, const Block & header_, UInt64 server_revision_)
-    : istr(istr_), header(header_), server_revision(server_revision_)
+NativeBlockInputStream::NativeBlockInputStream(ReadBuffer & istr_, const Block & header_, UInt64 server_revision_, bool zero_copy_views_)
+    : istr(istr_), header(header_), server_revision(server_revision_), zero_copy_views(zero_copy_views_)
 {
 }
 
@@ -80,6 +82,70 @@ Block NativeBlockInputStream::getHeader() const
 }
 
 
+namespace
+{
+
+template <typename T>
+bool tryAdoptVectorView(IColumn & column, const char * data, size_t bytes)
+{
+    if (auto * concrete = typeid_cast<ColumnVector<T> *>(&column))
+    {
+        concrete->getData().assignBorrowedMemory(data, data + bytes);
+        return true;
+    }
+    return false;
+}
+
+}
+
+
+MutableColumnPtr NativeBlockInputStream::tryReadColumnZeroCopy(const IDataType & type, size_t rows)
+{
+    if (type.haveSubtypes())
+        return nullptr;
+
+    MutableColumnPtr column = type.createColumn();
+    if (!column->isFixedAndContiguous())
+        return nullptr;
+
+    size_t bytes = rows * column->sizeOfValueIfFixed();
+
+    /// The whole column must already be in the buffer (the buffer of a mapped file or of a memory
+    ///  region covers everything), and the PODArray padding after the data must be readable too.
+    if (static_cast<size_t>(istr.buffer().end() - istr.position()) < bytes + 15)
+        return nullptr;
+
+    const char * data = istr.position();
+
+    bool adopted = tryAdoptVectorView<UInt8>(*column, data, bytes)
+        || tryAdoptVectorView<UInt16>(*column, data, bytes)
+        || tryAdoptVectorView<UInt32>(*column, data, bytes)
+        || tryAdoptVectorView<UInt64>(*column, data, bytes)
+        || tryAdoptVectorView<UInt128>(*column, data, bytes)
+        || tryAdoptVectorView<Int8>(*column, data, bytes)
+        || tryAdoptVectorView<Int16>(*column, data, bytes)
+        || tryAdoptVectorView<Int32>(*column, data, bytes)
+        || tryAdoptVectorView<Int64>(*column, data, bytes)
+        || tryAdoptVectorView<Float32>(*column, data, bytes)
+        || tryAdoptVectorView<Float64>(*column, data, bytes);
+
+    if (!adopted)
+    {
+        if (auto * fixed_string = typeid_cast<ColumnFixedString *>(column.get()))
+        {
+            fixed_string->getChars().assignBorrowedMemory(data, data + bytes);
+            adopted = true;
+        }
+    }
+
+    if (!adopted)
+        return nullptr;
+
+    istr.position() += bytes;
+    return column;
+}
+
+
 Block NativeBlockInputStream::readImpl()
 {
     Block res;
@@ -144,14 +210,29 @@ Block NativeBlockInputStream::readImpl()
         }
 
         /// Data
-        MutableColumnPtr read_column = column.type->createColumn();
+        MutableColumnPtr read_column;
 
-        double avg_value_size_hint = avg_value_size_hints.empty() ? 0 : avg_value_size_hints[i];
-        if (rows)    /// If no rows, nothing to read.
-            readData(*column.type, *read_column, istr, rows, avg_value_size_hint);
+        if (zero_copy_views && rows && !use_index)
+            read_column = tryReadColumnZeroCopy(*column.type, rows);
+
+        bool is_view = read_column != nullptr;
+
+        if (!read_column)
+        {
+            read_column = column.type->createColumn();
+
+            double avg_value_size_hint = avg_value_size_hints.empty() ? 0 : avg_value_size_hints[i];
+            if (rows)    /// If no rows, nothing to read.
+                readData(*column.type, *read_column, istr, rows, avg_value_size_hint);
+        }
 
         column.column = std::move(read_column);
 
+        /// The extra reference makes any downstream mutation clone the column
+        ///  instead of writing into the mapped memory.
+        if (is_view)
+            pinned_views.push_back(column.column);
+
         res.insert(std::move(column));
 
         if (use_index)
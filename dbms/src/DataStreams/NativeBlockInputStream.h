@@ -61,11 +61,18 @@ class NativeBlockInputStream : public IProfilingBlockInputStream
 {
 public:
     /// If a non-zero server_revision is specified, additional block information may be expected and read.
-    NativeBlockInputStream(ReadBuffer & istr_, UInt64 server_revision_);
+    ///
+    /// If `zero_copy_views_` is set, columns of fixed-width types are constructed as views over
+    ///  the memory of `istr` instead of copies, when enough of the data is in the buffer.
+    /// The caller must guarantee that the buffer memory is stable and outlives the returned blocks
+    ///  (e.g. MMapReadBufferFromFile or ReadBufferFromMemory over a mapped region).
+    /// The stream keeps a reference to every view column it hands out, so a downstream mutation
+    ///  goes through a copy-on-write clone and never touches the mapped memory.
+    NativeBlockInputStream(ReadBuffer & istr_, UInt64 server_revision_, bool zero_copy_views_ = false);
 
     /// For cases when data structure (header) is known in advance.
     /// NOTE We may use header for data validation and/or type conversions. It is not implemented.
-    NativeBlockInputStream(ReadBuffer & istr_, const Block & header_, UInt64 server_revision_);
+    NativeBlockInputStream(ReadBuffer & istr_, const Block & header_, UInt64 server_revision_, bool zero_copy_views_ = false);
 
     /// For cases when we have an index. It allows to skip columns. Only columns specified in the index will be read.
     NativeBlockInputStream(ReadBuffer & istr_, UInt64 server_revision_,
@@ -96,6 +103,15 @@ private:
 
     PODArray<double> avg_value_size_hints;
 
+    bool zero_copy_views = false;
+
+    /// References to the view columns handed out, to force copy-on-write on mutation
+    ///  (the views themselves are small, the data stays in the buffer).
+    std::vector<ColumnPtr> pinned_views;
+
+    /// Returns nullptr if a view cannot be made for this type or buffer position.
+    MutableColumnPtr tryReadColumnZeroCopy(const IDataType & type, size_t rows);
+
     void updateAvgValueSizeHints(const Block & block);
 };
 
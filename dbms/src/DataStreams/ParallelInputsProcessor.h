@@ -5,14 +5,17 @@
 #include <atomic>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 
 #include <common/logger_useful.h>
 
 #include <DataStreams/IProfilingBlockInputStream.h>
 #include <Common/setThreadName.h>
+#include <Common/NUMA.h>
 #include <Common/CurrentMetrics.h>
 #include <Common/MemoryTracker.h>
 #include <Common/CurrentThread.h>
+#include <Common/ThreadPool.h>
 
 
 /** Allows to process multiple block input streams (sources) in parallel, using specified number of threads.
@@ -28,7 +31,10 @@
   * - there are multiple threads, that could simultaneously read blocks from different sources;
   * - "available" sources (that are not read in any thread right now) are put in queue of sources;
   * - when thread take a source to read from, it removes source from queue of sources,
-  *    then read block from source and then put source back to queue of available sources.
+  *    then read block from source and then put source back to queue of available sources;
+  * - when the queue is temporarily empty but some sources are still being read by other threads,
+  *    the thread waits for one of them to be put back instead of retiring,
+  *    so all threads stay busy as long as at least one source is unfinished.
   */
 
 namespace CurrentMetrics
@@ -83,7 +89,8 @@ public:
       *   and only after the completion of this work, create blocks of keys that are not found.
       */
     ParallelInputsProcessor(const BlockInputStreams & inputs_, const BlockInputStreamPtr & additional_input_at_end_, size_t max_threads_, Handler & handler_)
-        : inputs(inputs_), additional_input_at_end(additional_input_at_end_), max_threads(std::min(inputs_.size(), max_threads_)), handler(handler_)
+        : inputs(inputs_), additional_input_at_end(additional_input_at_end_), max_threads(std::min(inputs_.size(), max_threads_)),
+        handler(handler_), remaining_sources(inputs_.size())
     {
         for (size_t i = 0; i < inputs_.size(); ++i)
             unprepared_inputs.emplace(inputs_[i], i);
@@ -134,6 +141,12 @@ public:
     {
         finish = true;
 
+        /// Wake up the threads waiting for a source to become available.
+        {
+            std::lock_guard<std::mutex> lock(available_inputs_mutex);
+            available_inputs_cond.notify_all();
+        }
+
         for (auto & input : inputs)
         {
             if (IProfilingBlockInputStream * child = dynamic_cast<IProfilingBlockInputStream *>(&*input))
@@ -199,11 +212,24 @@ private:
         std::exception_ptr exception;
         CurrentMetrics::Increment metric_increment{CurrentMetrics::QueryThread};
 
+        /// The thread is taken from the global pool and will be reused for other queries:
+        ///  it must not stay attached to the thread group of this one.
+        SCOPE_EXIT({ CurrentThread::detachQueryIfNotDetached(); });
+
         try
         {
             setThreadName("ParalInputsProc");
             CurrentThread::attachTo(thread_group);
 
+            /// For per-thread attribution in system.query_thread_log.
+            if (!inputs.empty())
+                CurrentThread::setQueryStage(inputs[0]->getName());
+
+            /// On multi-socket machines, spread the threads round-robin across NUMA nodes and keep
+            ///  each thread on its node: the buffers a thread allocates are local to it (first-touch),
+            ///  so processing the blocks it reads does not go through the interconnect.
+            NUMANodeBinding numa_binding(thread_num);
+
             while (!finish)
             {
                 InputData unprepared_input;
@@ -222,6 +248,7 @@ private:
                 {
                     std::lock_guard<std::mutex> lock(available_inputs_mutex);
                     available_inputs.push(unprepared_input);
+                    available_inputs_cond.notify_one();
                 }
             }
 
@@ -274,10 +301,16 @@ private:
 
             /// Select the next source.
             {
-                std::lock_guard<std::mutex> lock(available_inputs_mutex);
+                std::unique_lock<std::mutex> lock(available_inputs_mutex);
+
+                /** If there are no free sources, but other threads are still reading from the remaining ones,
+                  *  do not retire: one of those sources will be put back into the queue shortly
+                  *  and this thread will take over reading from it. This way the threads share all the sources
+                  *  dynamically, even when the sources progress at very different speed.
+                  */
+                available_inputs_cond.wait(lock, [this] { return !available_inputs.empty() || remaining_sources == 0 || finish; });
 
-                /// If there are no free sources, then this thread is no longer needed. (But other threads can work with their sources.)
-                if (available_inputs.empty())
+                if (finish || available_inputs.empty())
                     break;
 
                 input = available_inputs.front();
@@ -300,11 +333,13 @@ private:
                     if (block)
                     {
                         available_inputs.push(input);
+                        available_inputs_cond.notify_one();
                     }
                     else
                     {
-                        if (available_inputs.empty())
-                            break;
+                        /// The source is exhausted. If it was the last one, wake up the waiting threads so they could exit.
+                        if (0 == --remaining_sources)
+                            available_inputs_cond.notify_all();
                     }
                 }
 
@@ -324,7 +359,7 @@ private:
     Handler & handler;
 
     /// Streams.
-    using ThreadsData = std::vector<std::thread>;
+    using ThreadsData = std::vector<ThreadFromGlobalPool>;
     ThreadsData threads;
 
     /** A set of available sources that are not currently processed by any thread.
@@ -347,6 +382,13 @@ private:
     using AvailableInputs = std::queue<InputData>;
     AvailableInputs available_inputs;
 
+    /// Number of sources that are not exhausted yet (including the ones being read by other threads right now).
+    /// Guarded by available_inputs_mutex. When it reaches zero, the threads have nothing more to wait for.
+    size_t remaining_sources = 0;
+
+    /// Signalled when a source is put into available_inputs, when the last source is exhausted and on cancel.
+    std::condition_variable available_inputs_cond;
+
     /** For parallel preparing (readPrefix) child streams.
       * First, streams are located here.
       * After a stream was prepared, it is moved to "available_inputs" for reading.
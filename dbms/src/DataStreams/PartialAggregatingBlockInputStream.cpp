@@ -0,0 +1,82 @@
+#include <DataStreams/PartialAggregatingBlockInputStream.h>
+
+
+namespace DB
+{
+
+Block PartialAggregatingBlockInputStream::getHeader() const
+{
+    return aggregator.getHeader(false);
+}
+
+
+Block PartialAggregatingBlockInputStream::readImpl()
+{
+    while (ready_blocks.empty() && !input_exhausted)
+    {
+        if (isCancelledOrThrowIfKilled())
+            return {};
+
+        Block block = children.back()->read();
+
+        if (!block)
+        {
+            input_exhausted = true;
+
+            /// If there was no data, and we aggregate without keys, we must return single row with the result of empty aggregation.
+            /// To do this, we pass a block with zero rows to aggregate.
+            if (data_variants->empty() && params.keys_size == 0 && !params.empty_result_for_aggregation_by_empty_set)
+                aggregator.executeOnBlock(children.back()->getHeader(), *data_variants,
+                    key_columns, aggregate_columns, key, no_more_keys);
+
+            flush(true);
+            break;
+        }
+
+        /// Returns false when max_rows_to_group_by with group_by_overflow_mode = 'break' has been reached.
+        if (!aggregator.executeOnBlock(block, *data_variants, key_columns, aggregate_columns, key, no_more_keys))
+        {
+            input_exhausted = true;
+            flush(true);
+            break;
+        }
+
+        if (max_bytes_before_flush)
+        {
+            /// The states and the keys are allocated in the arenas; the buffer of the hash table itself is not counted,
+            ///  so the budget is approximate.
+            size_t bytes_in_arenas = 0;
+            for (const auto & pool : data_variants->aggregates_pools)
+                bytes_in_arenas += pool->size();
+
+            if (bytes_in_arenas >= max_bytes_before_flush)
+                flush(false);
+        }
+    }
+
+    if (ready_blocks.empty())
+        return {};
+
+    Block res = std::move(ready_blocks.front());
+    ready_blocks.pop_front();
+    return res;
+}
+
+
+void PartialAggregatingBlockInputStream::flush(bool is_final_flush)
+{
+    /// An intermediate flush of an empty hash table produces nothing.
+    if (!is_final_flush && !data_variants->size())
+        return;
+
+    LOG_TRACE(log, "Flushing " << data_variants->size() << " partially aggregated rows");
+
+    ready_blocks.splice(ready_blocks.end(), aggregator.convertToBlocks(*data_variants, false, 1));
+    data_variants = std::make_shared<AggregatedDataVariants>();
+
+    /// no_more_keys could only be set by 'any' overflow mode; after the flush the limit applies to the fresh table again
+    ///  (as in distributed aggregation, where every server applies max_rows_to_group_by to its own part of the data).
+    no_more_keys = false;
+}
+
+}
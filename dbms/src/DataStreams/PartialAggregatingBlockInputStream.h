@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Interpreters/Aggregator.h>
+#include <DataStreams/IProfilingBlockInputStream.h>
+
+
+namespace DB
+{
+
+/** Aggregates the stream of blocks using the specified key columns and aggregate functions,
+  *  but emits partially aggregated blocks (final = false) as soon as the accumulated states
+  *  exceed the specified memory budget, instead of holding everything until the end of input.
+  * The same key may therefore occur in several output blocks,
+  *  and the consumer must merge them (see MergingAggregatedMemoryEfficientBlockInputStream).
+  *
+  * This allows to run a pre-aggregation stage inside each source stream, below the union of streams:
+  *  blocks are collapsed close to the source, only partially aggregated data travels between threads,
+  *  and the peak memory of a single stream is bounded by the flush budget.
+  */
+class PartialAggregatingBlockInputStream : public IProfilingBlockInputStream
+{
+public:
+    /// max_bytes_before_flush - the amount of memory occupied by aggregation states,
+    ///  above which the accumulated states are flushed downstream. 0 - do not flush until the end of input.
+    PartialAggregatingBlockInputStream(
+        const BlockInputStreamPtr & input, const Aggregator::Params & params_, size_t max_bytes_before_flush_)
+        : params(params_), aggregator(params), max_bytes_before_flush(max_bytes_before_flush_)
+    {
+        children.push_back(input);
+
+        key.resize(params.keys_size);
+        key_columns.resize(params.keys_size);
+        aggregate_columns.resize(params.aggregates_size);
+    }
+
+    String getName() const override { return "PartialAggregating"; }
+
+    Block getHeader() const override;
+
+protected:
+    Block readImpl() override;
+
+private:
+    /// Convert the accumulated states to blocks and start with a fresh hash table.
+    void flush(bool is_final_flush);
+
+    Aggregator::Params params;
+    Aggregator aggregator;
+    size_t max_bytes_before_flush;
+
+    StringRefs key;
+    ColumnRawPtrs key_columns;
+    Aggregator::AggregateColumns aggregate_columns;
+    bool no_more_keys = false;
+
+    AggregatedDataVariantsPtr data_variants = std::make_shared<AggregatedDataVariants>();
+    BlocksList ready_blocks;
+    bool input_exhausted = false;
+
+    Logger * log = &Logger::get("PartialAggregatingBlockInputStream");
+};
+
+}
@@ -6,11 +6,94 @@
 namespace DB
 {
 
+/// Compare single-row columns in the order of the sort description. < 0 means `lhs` sorts earlier.
+static int compareCutoffRows(const Columns & lhs, const Columns & rhs, const SortDescription & description)
+{
+    for (size_t i = 0; i < description.size(); ++i)
+    {
+        int res = description[i].direction * lhs[i]->compareAt(0, 0, *rhs[i], description[i].nulls_direction);
+        if (res)
+            return res;
+    }
+    return 0;
+}
+
+
+void SortingCutoff::update(Columns candidate, const SortDescription & description)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (columns.empty() || compareCutoffRows(candidate, columns, description) < 0)
+        columns = std::move(candidate);
+}
+
+
+void PartialSortingBlockInputStream::filterWorseRows(Block & block, const Columns & cutoff_columns) const
+{
+    size_t rows = block.rows();
+    ColumnsWithSortDescriptions block_columns = getColumnsWithSortDescription(block, description);
+
+    IColumn::Filter filter(rows);
+    size_t result_rows = 0;
+    for (size_t i = 0; i < rows; ++i)
+    {
+        int res = 0;
+        for (size_t j = 0; j < block_columns.size() && !res; ++j)
+            res = block_columns[j].second.direction
+                * block_columns[j].first->compareAt(i, 0, *cutoff_columns[j], block_columns[j].second.nulls_direction);
+
+        /// A row equal to the cutoff cannot displace any of the `limit` rows that defined it.
+        filter[i] = res < 0;
+        result_rows += filter[i];
+    }
+
+    if (result_rows == rows)
+        return;
+
+    for (size_t i = 0; i < block.columns(); ++i)
+    {
+        auto & column = block.getByPosition(i).column;
+        column = column->filter(filter, result_rows);
+    }
+}
+
 
 Block PartialSortingBlockInputStream::readImpl()
 {
     Block res = children.back()->read();
+    if (!res || !limit)
+    {
+        sortBlock(res, description, limit);
+        return res;
+    }
+
+    /// compareAt does not know about collations, so the cutoff is not maintained for them.
+    bool has_collation = false;
+    for (const auto & elem : description)
+        if (elem.collator)
+            has_collation = true;
+
+    Columns cutoff_columns;
+    if (!has_collation)
+        cutoff_columns = cutoff->get();
+
+    if (!cutoff_columns.empty() && res.rows())
+        filterWorseRows(res, cutoff_columns);
+
+    /// sortBlock cuts the block to the first `limit` rows itself (see the `permute` calls there).
     sortBlock(res, description, limit);
+
+    if (!has_collation && res.rows() == limit)
+    {
+        /// The last row of the cut block is an upper bound for the final result:
+        ///  the whole result would fit into the first `limit` rows of this block alone.
+        Columns candidate;
+        candidate.reserve(description.size());
+        for (const auto & column_with_description : getColumnsWithSortDescription(res, description))
+            candidate.push_back(column_with_description.first->cut(limit - 1, 1));
+
+        cutoff->update(std::move(candidate), description);
+    }
+
     return res;
 }
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <mutex>
+
 #include <Core/SortDescription.h>
 
 #include <DataStreams/IProfilingBlockInputStream.h>
@@ -8,15 +10,48 @@
 namespace DB
 {
 
+/** The best limit-th row seen so far by the cooperating sorting streams of one query:
+  *  single-row columns in the order of the sort description, empty until known.
+  * PartialSortingBlockInputStream instances share it to discard rows that cannot enter
+  *  the first `limit` rows of the result, and MergeSortingBlockInputStream tightens it
+  *  from the globally accumulated data.
+  */
+class SortingCutoff
+{
+public:
+    Columns get() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return columns;
+    }
+
+    /// Replace the cutoff if `candidate` sorts earlier than the current one.
+    void update(Columns candidate, const SortDescription & description);
+
+private:
+    mutable std::mutex mutex;
+    Columns columns;
+};
+
+using SortingCutoffPtr = std::shared_ptr<SortingCutoff>;
+
+
 /** Sorts each block individually by the values of the specified columns.
   * At the moment, not very optimal algorithm is used.
+  *
+  * If limit != 0, rows that compare worse than the cutoff row are filtered out before
+  *  sorting: together with the cut to `limit` rows done in sortBlock, only candidate
+  *  rows for the final result are carried through the merge.
   */
 class PartialSortingBlockInputStream : public IProfilingBlockInputStream
 {
 public:
     /// limit - if not 0, then you can sort each block not completely, but only `limit` first rows by order.
-    PartialSortingBlockInputStream(const BlockInputStreamPtr & input_, SortDescription & description_, size_t limit_ = 0)
+    /// cutoff - may be shared with other sorting streams of the same query; if not given, a private one is used.
+    PartialSortingBlockInputStream(
+        const BlockInputStreamPtr & input_, SortDescription & description_, size_t limit_ = 0, SortingCutoffPtr cutoff_ = nullptr)
         : description(description_), limit(limit_)
+        , cutoff(cutoff_ ? std::move(cutoff_) : std::make_shared<SortingCutoff>())
     {
         children.push_back(input_);
     }
@@ -30,6 +65,10 @@ protected:
 private:
     SortDescription description;
     size_t limit;
+    SortingCutoffPtr cutoff;
+
+    /// Remove rows of `block` that compare strictly worse than the cutoff row.
+    void filterWorseRows(Block & block, const Columns & cutoff_columns) const;
 };
 
 }
@@ -5,7 +5,7 @@
 #include <Common/CurrentThread.h>
 #include <Common/setThreadName.h>
 #include <Common/getNumberOfPhysicalCPUCores.h>
-#include <common/ThreadPool.h>
+#include <Common/ThreadPool.h>
 #include <Storages/MergeTree/ReplicatedMergeTreeBlockOutputStream.h>
 
 namespace DB
@@ -30,12 +30,16 @@ PushingToViewsBlockOutputStream::PushingToViewsBlockOutputStream(
     {
         Dependencies dependencies = context.getDependencies(database, table);
 
+        const String & insert_dedup_token = context.getSettingsRef().insert_deduplication_token.value;
+
         /// We need special context for materialized views insertions
         if (!dependencies.empty())
         {
             views_context = std::make_unique<Context>(context);
-            // Do not deduplicate insertions into MV if the main insertion is Ok
-            if (disable_deduplication_for_children)
+            // Do not deduplicate insertions into MV if the main insertion is Ok.
+            // An explicit deduplication token makes deduplication in the views reliable
+            //  (it does not depend on the hash of the transformed data), so keep it enabled then.
+            if (disable_deduplication_for_children && insert_dedup_token.empty())
                 views_context->getSettingsRef().insert_deduplicate = false;
         }
 
@@ -47,9 +51,19 @@ PushingToViewsBlockOutputStream::PushingToViewsBlockOutputStream(
             if (StoragePtr inner_table = materialized_view.tryGetTargetTable())
                 addTableLock(inner_table->lockStructure(true, __PRETTY_FUNCTION__));
 
+            Context * insert_context = views_context.get();
+            if (!insert_dedup_token.empty())
+            {
+                /// Each view deduplicates independently, so derive a distinct token per view.
+                per_view_contexts.emplace_back(std::make_unique<Context>(*views_context));
+                insert_context = per_view_contexts.back().get();
+                insert_context->getSettingsRef().insert_deduplication_token.value
+                    = insert_dedup_token + "_" + database_table.first + "_" + database_table.second;
+            }
+
             auto query = materialized_view.getInnerQuery();
             BlockOutputStreamPtr out = std::make_shared<PushingToViewsBlockOutputStream>(
-                database_table.first, database_table.second, dependent_table, *views_context, ASTPtr());
+                database_table.first, database_table.second, dependent_table, *insert_context, ASTPtr());
             views.emplace_back(ViewInfo{std::move(query), database_table.first, database_table.second, std::move(out)});
         }
     }
@@ -75,12 +89,17 @@ void PushingToViewsBlockOutputStream::write(const Block & block)
     if (output)
         output->write(block);
 
-    /// Don't process materialized views if this block is duplicate
-    if (replicated_output && replicated_output->lastBlockIsDuplicate())
+    const Settings & settings = context.getSettingsRef();
+
+    /// Don't process materialized views if this block is duplicate.
+    /// With an explicit deduplication token the views are still pushed: a retry must be able
+    ///  to fill in views the previous attempt did not reach, and their own deduplication
+    ///  (by the derived per-view token) turns repeated pushes into no-ops.
+    if (settings.insert_deduplication_token.value.empty()
+        && replicated_output && replicated_output->lastBlockIsDuplicate())
         return;
 
     // Insert data into materialized views only after successful insert into main table
-    const Settings & settings = context.getSettingsRef();
     if (settings.parallel_view_processing && views.size() > 1)
     {
         // Push to views concurrently if enabled, and more than one view is attached
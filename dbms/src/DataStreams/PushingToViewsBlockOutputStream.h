@@ -47,6 +47,8 @@ private:
 
     std::vector<ViewInfo> views;
     std::unique_ptr<Context> views_context;
+    /// Per-view contexts carrying a derived insert_deduplication_token; only created when a token is set.
+    std::vector<std::unique_ptr<Context>> per_view_contexts;
 
     void process(const Block & block, size_t view_num);
 };
@@ -2,12 +2,19 @@
 #include <DataStreams/OneBlockInputStream.h>
 #include <Common/NetException.h>
 #include <Common/CurrentThread.h>
+#include <Common/ProfileEvents.h>
 #include <Interpreters/Context.h>
 #include <Interpreters/castColumn.h>
 #include <Interpreters/InternalTextLogsQueue.h>
 #include <Storages/IStorage.h>
 
 
+namespace ProfileEvents
+{
+    extern const Event HedgedRequests;
+    extern const Event HedgedRequestsWon;
+}
+
 namespace DB
 {
 
@@ -76,6 +83,8 @@ RemoteBlockInputStream::RemoteBlockInputStream(
         return std::make_unique<MultiplexedConnections>(
                 std::move(connections), current_settings, throttler, append_extra_info);
     };
+
+    this->pool = pool;
 }
 
 RemoteBlockInputStream::~RemoteBlockInputStream()
@@ -86,6 +95,9 @@ RemoteBlockInputStream::~RemoteBlockInputStream()
       */
     if (established || isQueryPending())
         multiplexed_connections->disconnect();
+
+    if (hedged_connections)
+        hedged_connections->disconnect();
 }
 
 void RemoteBlockInputStream::appendExtraInfo()
@@ -188,7 +200,7 @@ Block RemoteBlockInputStream::readImpl()
         if (isCancelledOrThrowIfKilled())
             return Block();
 
-        Connection::Packet packet = multiplexed_connections->receivePacket();
+        Connection::Packet packet = receivePacket();
 
         switch (packet.type)
         {
@@ -247,6 +259,150 @@ Block RemoteBlockInputStream::readImpl()
     }
 }
 
+Connection::Packet RemoteBlockInputStream::receivePacket()
+{
+    /// Until the first data block arrives, we may decide to send the same query to one more replica.
+    if (!received_first_data_packet && !hedged_connections)
+        maybeStartHedgedRequest();
+
+    Connection::Packet packet = hedged_connections
+        ? receiveHedgedPacket()
+        : multiplexed_connections->receivePacket();
+
+    if (packet.type == Protocol::Server::Data)
+        received_first_data_packet = true;
+
+    return packet;
+}
+
+void RemoteBlockInputStream::maybeStartHedgedRequest()
+{
+    const Settings & settings = context.getSettingsRef();
+
+    if (!pool || settings.hedged_request_delay_ms.totalMilliseconds() == 0)
+        return;
+
+    /// Resending the data of external tables to one more set of replicas is not implemented.
+    if (!external_tables.empty())
+        return;
+
+    if (!multiplexed_connections->hasActiveConnections())
+        return;
+
+    /// The delay is re-armed on every packet until the first data block arrives.
+    if (multiplexed_connections->waitForReadEvent(settings.hedged_request_delay_ms.value))
+        return;
+
+    try
+    {
+        /// Report the slow replicas to the pool: both the hedged request below and subsequent
+        /// queries will prefer the other replicas, and a persistently slow replica stays demoted.
+        for (const auto & entry : multiplexed_connections->getPoolEntries())
+            pool->reportError(entry);
+
+        LOG_DEBUG(log, "Received no data from (" << multiplexed_connections->dumpAddresses() << ") in "
+            << settings.hedged_request_delay_ms.totalMilliseconds() << " ms, sending the query to one more replica");
+
+        hedged_connections = create_multiplexed_connections();
+        if (0 == hedged_connections->size())
+        {
+            hedged_connections.reset();
+            return;
+        }
+
+        hedged_connections->sendQuery(query, "", stage, &context.getClientInfo(), true);
+
+        /// There are no external tables (see above), but the server waits for the marker of their end.
+        std::vector<ExternalTablesData> empty_external_tables_data(hedged_connections->size());
+        hedged_connections->sendExternalTablesData(empty_external_tables_data);
+
+        ProfileEvents::increment(ProfileEvents::HedgedRequests);
+    }
+    catch (...)
+    {
+        /// A failure to hedge must not fail the query: continue with the original replicas.
+        if (hedged_connections)
+            hedged_connections->disconnect();
+        hedged_connections.reset();
+        tryLogCurrentException(log);
+    }
+}
+
+Connection::Packet RemoteBlockInputStream::receiveHedgedPacket()
+{
+    /// Poll the original and the hedged replicas in turn until one of them wins the race.
+    static constexpr Poco::Timespan::TimeDiff race_poll_interval_us = 10000;
+
+    while (true)
+    {
+        if (multiplexed_connections->waitForReadEvent(Poco::Timespan(race_poll_interval_us)))
+        {
+            Connection::Packet packet = multiplexed_connections->receivePacket();
+
+            switch (packet.type)
+            {
+                case Protocol::Server::Data:
+                case Protocol::Server::Exception:
+                case Protocol::Server::EndOfStream:
+                    /// The original replicas responded (or finished) first: stop the hedged request.
+                    abandonConnections(*hedged_connections);
+                    hedged_connections.reset();
+                    break;
+
+                default:
+                    break;
+            }
+
+            return packet;
+        }
+
+        if (hedged_connections->waitForReadEvent(Poco::Timespan(race_poll_interval_us)))
+        {
+            Connection::Packet packet = hedged_connections->receivePacket();
+
+            switch (packet.type)
+            {
+                case Protocol::Server::Data:
+                    /// The hedged replica was the first to send data: it becomes the source of the result.
+                    ProfileEvents::increment(ProfileEvents::HedgedRequestsWon);
+                    abandonConnections(*multiplexed_connections);
+                    multiplexed_connections = std::move(hedged_connections);
+                    return packet;
+
+                case Protocol::Server::Exception:
+                case Protocol::Server::EndOfStream:
+                    /// The hedged replica failed or finished without sending data:
+                    /// continue with the original replicas as if nothing happened.
+                    if (packet.exception)
+                        LOG_DEBUG(log, "Hedged request returned an exception: " << packet.exception->displayText());
+                    hedged_connections->disconnect();
+                    hedged_connections.reset();
+                    return multiplexed_connections->receivePacket();
+
+                default:
+                    /// Progress and similar packets of a replica that has not won the race
+                    /// are discarded to avoid double accounting.
+                    break;
+            }
+        }
+    }
+}
+
+void RemoteBlockInputStream::abandonConnections(MultiplexedConnections & connections)
+{
+    /// Best effort: let the servers know the result is not needed, then close the sockets
+    /// without waiting for the remaining packets (waiting could take as long as the race saved).
+    try
+    {
+        connections.sendCancel();
+    }
+    catch (...)
+    {
+    }
+
+    connections.disconnect();
+}
+
 void RemoteBlockInputStream::readSuffixImpl()
 {
     /** If one of:
@@ -310,6 +466,9 @@ void RemoteBlockInputStream::tryCancel(const char * reason)
 
     LOG_TRACE(log, "(" << multiplexed_connections->dumpAddresses() << ") " << reason);
     multiplexed_connections->sendCancel();
+
+    if (hedged_connections)
+        hedged_connections->sendCancel();
 }
 
 bool RemoteBlockInputStream::isQueryPending() const
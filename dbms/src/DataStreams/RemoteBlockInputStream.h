@@ -92,6 +92,22 @@ private:
 
     Block receiveBlock();
 
+    /** Get the next packet, possibly racing two sets of replicas (see maybeStartHedgedRequest).
+      */
+    Connection::Packet receivePacket();
+
+    /** If no replica has sent any data within hedged_request_delay_ms after the query was sent,
+      * send the same query to one more replica and race the two (hedged request).
+      * The slow replicas get an error reported to the pool, so they are avoided for a while.
+      */
+    void maybeStartHedgedRequest();
+
+    /// Get the next packet while a hedged request is in flight. The race ends with the first data block.
+    Connection::Packet receiveHedgedPacket();
+
+    /// Ask the servers to stop and close the sockets without waiting for the remaining packets.
+    void abandonConnections(MultiplexedConnections & connections);
+
     /// If wasn't sent yet, send request to cancell all connections to replicas
     void tryCancel(const char * reason);
 
@@ -102,6 +118,16 @@ private:
 
     std::unique_ptr<MultiplexedConnections> multiplexed_connections;
 
+    /// The pool the connections were taken from. Set only when created from a pool;
+    /// hedged requests are possible only in this case.
+    ConnectionPoolWithFailoverPtr pool;
+
+    /// Connections of a hedged request, while the race with the original replicas is undecided.
+    std::unique_ptr<MultiplexedConnections> hedged_connections;
+
+    /// A data packet has been received, hedging is not needed anymore.
+    bool received_first_data_packet = false;
+
     const String query;
     Context context;
     /// Temporary tables needed to be sent to remote servers
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <DataStreams/IProfilingBlockInputStream.h>
+
+namespace DB
+{
+
+/// Reverses the order of rows in every block. Used together with a source that returns blocks
+/// back to front to read data in reverse key order.
+class ReverseBlockInputStream : public IProfilingBlockInputStream
+{
+public:
+    ReverseBlockInputStream(const BlockInputStreamPtr & input);
+
+    String getName() const override { return "Reverse"; }
+    Block getHeader() const override;
+
+protected:
+    Block readImpl() override;
+};
+
+}
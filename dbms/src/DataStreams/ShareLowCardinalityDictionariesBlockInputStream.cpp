@@ -0,0 +1,90 @@
+#include <DataStreams/ShareLowCardinalityDictionariesBlockInputStream.h>
+#include <Columns/ColumnLowCardinality.h>
+#include <Columns/IColumnUnique.h>
+#include <Common/typeid_cast.h>
+
+
+namespace DB
+{
+
+namespace
+{
+
+/// An immutable copy of the working dictionary with its own memory.
+/// Inserting the nested column into an empty dictionary of the same type reproduces the positions exactly.
+ColumnPtr makeSnapshot(const IColumnUnique & working)
+{
+    auto snapshot = working.cloneEmpty();
+    const ColumnPtr & nested = working.getNestedColumn();
+    static_cast<IColumnUnique &>(*snapshot).uniqueInsertRangeFrom(*nested, 0, nested->size());
+    return snapshot;
+}
+
+}
+
+
+ShareLowCardinalityDictionariesBlockInputStream::ShareLowCardinalityDictionariesBlockInputStream(
+    const BlockInputStreamPtr & input, size_t max_dictionary_size_)
+    : max_dictionary_size(max_dictionary_size_)
+{
+    children.push_back(input);
+}
+
+
+Block ShareLowCardinalityDictionariesBlockInputStream::readImpl()
+{
+    Block block = children.back()->read();
+    if (!block)
+        return block;
+
+    for (size_t i = 0, columns = block.columns(); i < columns; ++i)
+    {
+        auto & element = block.getByPosition(i);
+        const auto * column = typeid_cast<const ColumnLowCardinality *>(element.column.get());
+        if (!column)
+            continue;
+
+        const ColumnPtr & keys = column->getDictionary().getNestedColumn();
+
+        /// Sharing an oversized dictionary would rebuild it for every block - leave the column as is.
+        if (keys->size() > max_dictionary_size)
+        {
+            dictionaries.erase(i);
+            continue;
+        }
+
+        SharedDictionary & shared = dictionaries[i];
+
+        /// The block already carries the shared dictionary - only make sure it is marked as shared.
+        if (shared.published && column->getDictionaryPtr() == shared.published)
+        {
+            element.column = ColumnLowCardinality::create(shared.published, column->getIndexesPtr(), true);
+            continue;
+        }
+
+        /// Start (over) from the dictionary of the current block when there is nothing accumulated yet
+        ///  or the accumulated dictionary has grown too large.
+        if (!shared.working || shared.working->size() > max_dictionary_size)
+        {
+            shared.published = column->getDictionaryPtr();
+            shared.working = makeSnapshot(column->getDictionary())->assumeMutable();
+
+            element.column = ColumnLowCardinality::create(shared.published, column->getIndexesPtr(), true);
+            continue;
+        }
+
+        /// Append the keys of the block to the working dictionary (a lookup for the keys it already has)
+        ///  and remap the indexes of the block to the positions in it.
+        auto & working_unique = static_cast<IColumnUnique &>(*shared.working);
+        ColumnPtr positions = working_unique.uniqueInsertRangeFrom(*keys, 0, keys->size());
+
+        if (shared.working->size() != shared.published->size())
+            shared.published = makeSnapshot(working_unique);
+
+        element.column = ColumnLowCardinality::create(shared.published, positions->index(column->getIndexes(), 0), true);
+    }
+
+    return block;
+}
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <unordered_map>
+
+#include <DataStreams/IProfilingBlockInputStream.h>
+
+
+namespace DB
+{
+
+/** Re-encodes the LowCardinality columns of consecutive blocks against one
+  *  stream-scoped dictionary per column, so that the blocks carry the same
+  *  immutable dictionary object instead of each block having its own.
+  * Downstream stages that cache per-dictionary state (in particular, the
+  *  dictionary hash cache in the aggregator, which only works for shared
+  *  dictionaries) then hit their cache on every block.
+  *
+  * New keys are appended to a private working dictionary that is never handed
+  *  out; the blocks get an immutable snapshot that is rebuilt when the working
+  *  dictionary grows. A published snapshot is never mutated, so pointers into
+  *  it cached downstream stay valid.
+  * When the dictionary exceeds max_dictionary_size, it is started over from
+  *  the dictionary of the current block.
+  */
+class ShareLowCardinalityDictionariesBlockInputStream : public IProfilingBlockInputStream
+{
+public:
+    ShareLowCardinalityDictionariesBlockInputStream(const BlockInputStreamPtr & input, size_t max_dictionary_size_);
+
+    String getName() const override { return "ShareLowCardinalityDictionaries"; }
+
+    Block getHeader() const override { return children.at(0)->getHeader(); }
+
+protected:
+    Block readImpl() override;
+
+private:
+    /// State of the shared dictionary of one column, keyed by the position of the column in the block.
+    struct SharedDictionary
+    {
+        /// Private working dictionary; new keys are appended here. Never handed out.
+        MutableColumnPtr working;
+        /// Immutable snapshot of `working` that the blocks get; replaced (not mutated) when `working` grows.
+        ColumnPtr published;
+    };
+
+    std::unordered_map<size_t, SharedDictionary> dictionaries;
+    size_t max_dictionary_size;
+};
+
+}
@@ -0,0 +1,54 @@
+#include <DataStreams/SplittingBlockInputStream.h>
+
+
+namespace DB
+{
+
+SplittingBlockInputStream::SplittingBlockInputStream(const BlockInputStreamPtr & input, size_t preferred_block_size_bytes_)
+    : preferred_block_size_bytes(preferred_block_size_bytes_)
+{
+    children.push_back(input);
+}
+
+
+Block SplittingBlockInputStream::readImpl()
+{
+    if (pending)
+    {
+        size_t rows = pending.rows();
+        size_t length = std::min(pending_rows_per_chunk, rows - pending_offset);
+
+        Block res = pending.cloneEmpty();
+        for (size_t i = 0; i < pending.columns(); ++i)
+            res.getByPosition(i).column = pending.getByPosition(i).column->cut(pending_offset, length);
+
+        pending_offset += length;
+        if (pending_offset >= rows)
+            pending.clear();
+
+        return res;
+    }
+
+    Block block = children.back()->read();
+    if (!block)
+        return block;
+
+    size_t rows = block.rows();
+    size_t bytes = block.bytes();
+
+    if (!rows || bytes <= preferred_block_size_bytes)
+        return block;
+
+    /// Target the byte budget using the actual average row width of this block.
+    size_t rows_per_chunk = std::max<size_t>(1, rows / (bytes / preferred_block_size_bytes + 1));
+    if (rows_per_chunk >= rows)
+        return block;
+
+    pending = std::move(block);
+    pending_offset = 0;
+    pending_rows_per_chunk = rows_per_chunk;
+
+    return readImpl();
+}
+
+}
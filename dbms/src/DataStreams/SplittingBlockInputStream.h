@@ -0,0 +1,34 @@
+#pragma once
+
+#include <DataStreams/IProfilingBlockInputStream.h>
+
+
+namespace DB
+{
+
+/** Splits blocks that are bigger than a byte budget into several blocks of roughly the budget size.
+  * The number of rows per output block is computed from the actual average row width of each
+  * incoming block, so wide rows produce short blocks and narrow rows pass through unchanged.
+  */
+class SplittingBlockInputStream : public IProfilingBlockInputStream
+{
+public:
+    SplittingBlockInputStream(const BlockInputStreamPtr & input, size_t preferred_block_size_bytes_);
+
+    String getName() const override { return "Splitting"; }
+
+    Block getHeader() const override { return children.back()->getHeader(); }
+
+protected:
+    Block readImpl() override;
+
+private:
+    size_t preferred_block_size_bytes;
+
+    /// An oversized block that is being returned piecewise.
+    Block pending;
+    size_t pending_offset = 0;
+    size_t pending_rows_per_chunk = 0;
+};
+
+}
@@ -44,8 +44,9 @@ SummingSortedBlockInputStream::SummingSortedBlockInputStream(
     const SortDescription & description_,
     /// List of columns to be summed. If empty, all numeric columns that are not in the description are taken.
     const Names & column_names_to_sum,
-    size_t max_block_size_)
-    : MergingSortedBlockInputStream(inputs_, description_, max_block_size_)
+    size_t max_block_size_,
+    WriteBuffer * out_row_sources_buf_)
+    : MergingSortedBlockInputStream(inputs_, description_, max_block_size_, 0, out_row_sources_buf_)
 {
     current_row.resize(num_columns);
 
@@ -244,6 +245,7 @@ void SummingSortedBlockInputStream::insertCurrentRowIfNeeded(MutableColumns & me
         for (auto & desc : columns_to_aggregate)
             desc.merged_column->popBack(1);
 
+        flushCurrentRowSources(false);
         return;
     }
 
@@ -252,6 +254,25 @@ void SummingSortedBlockInputStream::insertCurrentRowIfNeeded(MutableColumns & me
 
     /// Update per-block and per-group flags
     ++merged_rows;
+
+    flushCurrentRowSources(true);
+}
+
+
+void SummingSortedBlockInputStream::flushCurrentRowSources(bool group_is_inserted)
+{
+    if (!out_row_sources_buf || current_row_sources.empty())
+        return;
+
+    /// The inserted row carries the values of the first source row of the group
+    ///  (with summed columns replaced by the sums).
+    if (group_is_inserted)
+        current_row_sources.front().setSkipFlag(false);
+
+    out_row_sources_buf->write(
+        reinterpret_cast<const char *>(current_row_sources.data()),
+        current_row_sources.size() * sizeof(RowSourcePart));
+    current_row_sources.resize(0);
 }
 
 
@@ -376,6 +397,9 @@ void SummingSortedBlockInputStream::merge(MutableColumns & merged_columns, std::
                     current_row_is_zero = false;
         }
 
+        if (out_row_sources_buf)
+            current_row_sources.emplace_back(current.impl->order, true);
+
         queue.pop();
 
         if (!current->isLast())
@@ -30,7 +30,8 @@ public:
         const SortDescription & description_,
         /// List of columns to be summed. If empty, all numeric columns that are not in the description are taken.
         const Names & column_names_to_sum_,
-        size_t max_block_size_);
+        size_t max_block_size_,
+        WriteBuffer * out_row_sources_buf_ = nullptr);
 
     String getName() const override { return "SummingSorted"; }
 
@@ -137,6 +138,11 @@ private:
 
     size_t merged_rows = 0;             /// Number of rows merged into current result block
 
+    /// Sources of the rows with the current primary key. Only the first row of a group survives
+    /// the merge (with summed columns replaced), so it is the one marked as not skipped - unless
+    /// the whole group sums to zero and is deleted.
+    PODArray<RowSourcePart> current_row_sources;
+
     /** We support two different cursors - with Collation and without.
      *  Templates are used instead of polymorphic SortCursor and calls to virtual functions.
      */
@@ -145,6 +151,9 @@ private:
     /// Insert the summed row for the current group into the result and updates some of per-block flags if the row is not "zero".
     void insertCurrentRowIfNeeded(MutableColumns & merged_columns);
 
+    /// Write the accumulated sources of the current group's rows to out_row_sources_buf (for vertical merge).
+    void flushCurrentRowSources(bool group_is_inserted);
+
     /// Returns true if merge result is not empty
     bool mergeMap(const MapDescription & map, Row & row, SortCursor & cursor);
 
@@ -0,0 +1,67 @@
+#include <DataStreams/TTLBlockInputStream.h>
+#include <Columns/ColumnsNumber.h>
+#include <Common/typeid_cast.h>
+#include <common/DateLUT.h>
+
+
+namespace DB
+{
+
+namespace ErrorCodes
+{
+    extern const int LOGICAL_ERROR;
+}
+
+
+TTLBlockInputStream::TTLBlockInputStream(
+    const BlockInputStreamPtr & input_,
+    const ExpressionActionsPtr & ttl_expression_,
+    const String & result_column_,
+    time_t current_time_)
+    : ttl_expression(ttl_expression_), result_column(result_column_), current_time(current_time_)
+{
+    children.push_back(input_);
+}
+
+
+Block TTLBlockInputStream::readImpl()
+{
+    while (Block block = children.back()->read())
+    {
+        Block block_with_ttl = block;
+        ttl_expression->execute(block_with_ttl);
+
+        const IColumn * column = block_with_ttl.getByName(result_column).column.get();
+
+        size_t rows = block.rows();
+        IColumn::Filter filter(rows);
+        size_t rows_kept = 0;
+
+        if (const ColumnUInt16 * column_date = typeid_cast<const ColumnUInt16 *>(column))
+        {
+            const auto & date_lut = DateLUT::instance();
+            for (size_t i = 0; i < rows; ++i)
+                rows_kept += filter[i] = date_lut.fromDayNum(DayNum(column_date->getData()[i])) > current_time;
+        }
+        else if (const ColumnUInt32 * column_date_time = typeid_cast<const ColumnUInt32 *>(column))
+        {
+            for (size_t i = 0; i < rows; ++i)
+                rows_kept += filter[i] = static_cast<time_t>(column_date_time->getData()[i]) > current_time;
+        }
+        else
+            throw Exception("Unexpected type of result of TTL expression", ErrorCodes::LOGICAL_ERROR);
+
+        if (!rows_kept)
+            continue;
+
+        if (rows_kept < rows)
+            for (auto & elem : block)
+                elem.column = elem.column->filter(filter, rows_kept);
+
+        return block;
+    }
+
+    return {};
+}
+
+}
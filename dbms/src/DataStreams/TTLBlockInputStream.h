@@ -0,0 +1,34 @@
+#pragma once
+
+#include <DataStreams/IProfilingBlockInputStream.h>
+#include <Interpreters/ExpressionActions.h>
+
+
+namespace DB
+{
+
+/** Removes rows for which the table TTL expression has passed (the TTL clause of MergeTree tables).
+  * Applied to the merged stream during merges, so that expired rows do not get into the new part.
+  */
+class TTLBlockInputStream : public IProfilingBlockInputStream
+{
+public:
+    TTLBlockInputStream(
+        const BlockInputStreamPtr & input_,
+        const ExpressionActionsPtr & ttl_expression_,
+        const String & result_column_,
+        time_t current_time_);
+
+    String getName() const override { return "TTL"; }
+    Block getHeader() const override { return children.back()->getHeader(); }
+
+protected:
+    Block readImpl() override;
+
+private:
+    ExpressionActionsPtr ttl_expression;
+    String result_column;
+    time_t current_time;
+};
+
+}
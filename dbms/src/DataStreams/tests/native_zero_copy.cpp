@@ -0,0 +1,86 @@
+#include <iostream>
+
+#include <Columns/ColumnsNumber.h>
+#include <Core/Block.h>
+#include <DataStreams/NativeBlockInputStream.h>
+#include <DataStreams/NativeBlockOutputStream.h>
+#include <DataTypes/DataTypesNumber.h>
+#include <IO/ReadBufferFromMemory.h>
+#include <IO/WriteBufferFromVector.h>
+
+
+/** Checks the zero-copy mode of NativeBlockInputStream: columns of fixed-width types
+  *  must come out as views over the source memory, and a mutation of such a column
+  *  must leave the source memory intact.
+  */
+int main(int, char **)
+try
+{
+    using namespace DB;
+
+    constexpr size_t rows = 1000;
+
+    Block block;
+    {
+        auto column = ColumnUInt64::create();
+        for (size_t i = 0; i < rows; ++i)
+            column->getData().push_back(i);
+        block.insert({std::move(column), std::make_shared<DataTypeUInt64>(), "x"});
+    }
+
+    std::vector<char> data;
+    size_t data_size = 0;
+    {
+        WriteBufferFromVector<std::vector<char>> out(data);
+        NativeBlockOutputStream stream(out, 0, block.cloneEmpty());
+        /// Two blocks: the very last column of a buffer cannot be a view
+        ///  (the padding after it would point outside), so check the first one.
+        stream.write(block);
+        stream.write(block);
+        data_size = out.count();
+    }
+
+    ReadBufferFromMemory in(data.data(), data_size);
+    NativeBlockInputStream stream(in, 0, /* zero_copy_views */ true);
+    Block read_block = stream.read();
+
+    const auto & read_column = typeid_cast<const ColumnUInt64 &>(*read_block.getByPosition(0).column);
+
+    const char * begin = data.data();
+    const char * end = begin + data_size;
+    const char * column_data = reinterpret_cast<const char *>(read_column.getData().data());
+
+    if (column_data < begin || column_data >= end)
+    {
+        std::cerr << "FAILED: the column is not a view over the source buffer\n";
+        return 1;
+    }
+
+    for (size_t i = 0; i < rows; ++i)
+        if (read_column.getData()[i] != i)
+        {
+            std::cerr << "FAILED: wrong data in the view column\n";
+            return 1;
+        }
+
+    /// A mutation must clone the column (the stream also holds a reference) and not touch the buffer.
+    {
+        ColumnPtr column_ptr = read_block.getByPosition(0).column;
+        MutableColumnPtr mutated = (*std::move(column_ptr)).mutate();
+        typeid_cast<ColumnUInt64 &>(*mutated).getData()[0] = 12345;
+
+        if (read_column.getData()[0] != 0)
+        {
+            std::cerr << "FAILED: mutation of the view column changed the source buffer\n";
+            return 1;
+        }
+    }
+
+    std::cout << "OK\n";
+    return 0;
+}
+catch (const DB::Exception & e)
+{
+    std::cerr << e.what() << ", " << e.displayText() << std::endl;
+    return 1;
+}
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <common/ThreadPool.h>
+#include <Common/ThreadPool.h>
 #include <Databases/IDatabase.h>
 
 
@@ -1,8 +1,10 @@
+#include <cstring>
 #include <iomanip>
 
 #include <Poco/Event.h>
 #include <Poco/DirectoryIterator.h>
 #include <common/logger_useful.h>
+#include <Common/setThreadName.h>
 
 #include <Databases/DatabaseOrdinary.h>
 #include <Databases/DatabaseMemory.h>
@@ -10,7 +12,7 @@
 #include <Common/escapeForFileName.h>
 #include <Common/StringUtils/StringUtils.h>
 #include <Common/Stopwatch.h>
-#include <common/ThreadPool.h>
+#include <Common/ThreadPool.h>
 #include <Parsers/ASTCreateQuery.h>
 #include <Parsers/parseQuery.h>
 #include <Parsers/ParserCreateQuery.h>
@@ -113,6 +115,18 @@ DatabaseOrdinary::DatabaseOrdinary(String name_, const String & metadata_path_,
     Poco::File(data_path).createDirectories();
 }
 
+DatabaseOrdinary::~DatabaseOrdinary()
+{
+    try
+    {
+        stopWarmer();
+    }
+    catch (...)
+    {
+        tryLogCurrentException(__PRETTY_FUNCTION__);
+    }
+}
+
 
 void DatabaseOrdinary::loadTables(
     Context & context,
@@ -161,6 +175,28 @@ void DatabaseOrdinary::loadTables(
     size_t total_tables = file_names.size();
     LOG_INFO(log, "Total " << total_tables << " tables.");
 
+    /// With lazy loading, only register the tables by their metadata file names: each table
+    /// will be instantiated at first access or by the background warmer, and the server can
+    /// accept queries right away. The `system` database is always loaded eagerly.
+    if (name != "system" && context.getConfigRef().getBool("lazy_load_databases", false))
+    {
+        std::lock_guard<std::recursive_mutex> lock(lazy_load_mutex);
+
+        /// The passed context may belong to an ATTACH DATABASE query and will not outlive it.
+        lazy_load_context = &context.getGlobalContext();
+        lazy_load_force_restore_data = has_force_restore_data_flag;
+
+        for (const auto & file_name : file_names)
+            tables_to_load.emplace(unescapeForFileName(file_name.substr(0, file_name.size() - strlen(".sql"))), file_name);
+
+        readAccessOrderFile();
+
+        warmer_thread = ThreadFromGlobalPool([this] { warmTables(); });
+
+        LOG_INFO(log, "Deferred loading of " << total_tables << " tables.");
+        return;
+    }
+
     AtomicStopwatch watch;
     std::atomic<size_t> tables_processed {0};
     Poco::Event all_tables_processed;
@@ -241,6 +277,228 @@ void DatabaseOrdinary::startupTables(ThreadPool * thread_pool)
 }
 
 
+StoragePtr DatabaseOrdinary::loadTableLazily(const String & table_name, bool record_access) const
+{
+    std::lock_guard<std::recursive_mutex> lock(lazy_load_mutex);
+
+    auto it = tables_to_load.find(table_name);
+    if (it == tables_to_load.end())
+        return {};
+
+    const String file_name = it->second;
+    tables_to_load.erase(it);
+
+    /// loadTable attaches the table, so a non-const reference to the database is needed.
+    auto & mutable_this = const_cast<DatabaseOrdinary &>(*this);
+
+    try
+    {
+        loadTable(*lazy_load_context, metadata_path, mutable_this, name, data_path, file_name, lazy_load_force_restore_data);
+    }
+    catch (...)
+    {
+        tables_to_load.emplace(table_name, file_name);
+        throw;
+    }
+
+    /// The metadata file could turn out to be empty (see loadTable), then there is no table.
+    StoragePtr table = DatabaseWithOwnTablesBase::tryGetTable(*lazy_load_context, table_name);
+    if (table)
+        table->startup();
+
+    if (record_access)
+        recordTableAccess(table_name);
+
+    return table;
+}
+
+
+void DatabaseOrdinary::loadPendingTables() const
+{
+    while (true)
+    {
+        String table_name;
+        {
+            std::lock_guard<std::recursive_mutex> lock(lazy_load_mutex);
+            if (tables_to_load.empty())
+                return;
+            table_name = tables_to_load.begin()->first;
+        }
+        loadTableLazily(table_name, /* record_access = */ false);
+    }
+}
+
+
+void DatabaseOrdinary::warmTables()
+{
+    setThreadName("TablesWarmer");
+
+    /// Load the most recently used tables (according to the persisted access order) first,
+    /// the rest in the order of their names.
+    Strings order;
+    {
+        std::lock_guard<std::recursive_mutex> lock(lazy_load_mutex);
+
+        NameSet seen;
+        for (const String & table_name : warm_order)
+            if (tables_to_load.count(table_name) && seen.emplace(table_name).second)
+                order.push_back(table_name);
+        for (const auto & elem : tables_to_load)
+            if (!seen.count(elem.first))
+                order.push_back(elem.first);
+    }
+
+    size_t warmed = 0;
+
+    for (const String & table_name : order)
+    {
+        if (warmer_should_stop)
+            return;
+
+        try
+        {
+            if (loadTableLazily(table_name, /* record_access = */ false))
+                ++warmed;
+        }
+        catch (...)
+        {
+            /// The error will be rethrown at first access to the table.
+            tryLogCurrentException(log, "while warming up table " + backQuoteIfNeed(name) + "." + backQuoteIfNeed(table_name));
+        }
+    }
+
+    LOG_INFO(log, "Warmed up " << warmed << " tables.");
+}
+
+
+void DatabaseOrdinary::stopWarmer()
+{
+    warmer_should_stop = true;
+    if (warmer_thread.joinable())
+        warmer_thread.join();
+}
+
+
+String DatabaseOrdinary::getAccessOrderFilePath() const
+{
+    /// Next to the database metadata directory: e.g. metadata/default.access for metadata/default/.
+    return (endsWith(metadata_path, "/") ? metadata_path.substr(0, metadata_path.size() - 1) : metadata_path) + ".access";
+}
+
+
+void DatabaseOrdinary::readAccessOrderFile()
+{
+    warm_order.clear();
+
+    if (!Poco::File(getAccessOrderFilePath()).exists())
+        return;
+
+    String contents;
+    {
+        ReadBufferFromFile in(getAccessOrderFilePath(), 4096);
+        readStringUntilEOF(contents, in);
+    }
+
+    /// One escaped table name per line, appended at each first access: later lines are more
+    /// recent. Keep the last occurrence of every name and order from most to least recent.
+    Strings lines;
+    String line;
+    for (char c : contents)
+    {
+        if (c == '\n')
+        {
+            if (!line.empty())
+                lines.push_back(line);
+            line.clear();
+        }
+        else
+            line += c;
+    }
+    if (!line.empty())
+        lines.push_back(line);
+
+    NameSet seen;
+    for (auto it = lines.rbegin(); it != lines.rend(); ++it)
+        if (seen.emplace(*it).second)
+            warm_order.push_back(unescapeForFileName(*it));
+
+    /// Compact the file, so that it doesn't grow indefinitely with appends.
+    try
+    {
+        WriteBufferFromFile out(getAccessOrderFilePath(), DBMS_DEFAULT_BUFFER_SIZE, O_WRONLY | O_CREAT | O_TRUNC);
+        for (auto it = warm_order.rbegin(); it != warm_order.rend(); ++it)
+            writeString(escapeForFileName(*it) + "\n", out);
+        out.next();
+    }
+    catch (...)
+    {
+        tryLogCurrentException(log);
+    }
+}
+
+
+void DatabaseOrdinary::recordTableAccess(const String & table_name) const
+{
+    /// Best effort: the file only affects the order of background warming after a restart.
+    try
+    {
+        WriteBufferFromFile out(getAccessOrderFilePath(), DBMS_DEFAULT_BUFFER_SIZE, O_WRONLY | O_CREAT | O_APPEND);
+        writeString(escapeForFileName(table_name) + "\n", out);
+        out.next();
+    }
+    catch (...)
+    {
+        tryLogCurrentException(log);
+    }
+}
+
+
+bool DatabaseOrdinary::isTableExist(
+    const Context & context,
+    const String & table_name) const
+{
+    if (DatabaseWithOwnTablesBase::isTableExist(context, table_name))
+        return true;
+
+    std::lock_guard<std::recursive_mutex> lock(lazy_load_mutex);
+    return tables_to_load.count(table_name);
+}
+
+
+StoragePtr DatabaseOrdinary::tryGetTable(
+    const Context & context,
+    const String & table_name) const
+{
+    if (auto table = DatabaseWithOwnTablesBase::tryGetTable(context, table_name))
+        return table;
+
+    return loadTableLazily(table_name, /* record_access = */ true);
+}
+
+
+bool DatabaseOrdinary::empty(const Context & context) const
+{
+    std::lock_guard<std::recursive_mutex> lock(lazy_load_mutex);
+    return tables_to_load.empty() && DatabaseWithOwnTablesBase::empty(context);
+}
+
+
+DatabaseIteratorPtr DatabaseOrdinary::getIterator(const Context & context)
+{
+    /// Iteration returns storage objects, so all not yet loaded tables have to be instantiated.
+    loadPendingTables();
+    return DatabaseWithOwnTablesBase::getIterator(context);
+}
+
+
+StoragePtr DatabaseOrdinary::detachTable(const String & table_name)
+{
+    /// The table may be registered but not instantiated yet.
+    loadTableLazily(table_name, /* record_access = */ false);
+    return DatabaseWithOwnTablesBase::detachTable(table_name);
+}
+
+
 void DatabaseOrdinary::createTable(
     const Context & context,
     const String & table_name,
@@ -267,6 +525,12 @@ void DatabaseOrdinary::createTable(
             throw Exception("Table " + name + "." + table_name + " already exists.", ErrorCodes::TABLE_ALREADY_EXISTS);
     }
 
+    {
+        std::lock_guard<std::recursive_mutex> lock(lazy_load_mutex);
+        if (tables_to_load.count(table_name))
+            throw Exception("Table " + name + "." + table_name + " already exists.", ErrorCodes::TABLE_ALREADY_EXISTS);
+    }
+
     String table_metadata_path = getTableMetadataPath(table_name);
     String table_metadata_tmp_path = table_metadata_path + ".tmp";
     String statement;
@@ -476,6 +740,13 @@ ASTPtr DatabaseOrdinary::getCreateDatabaseQuery(const Context & /*context*/) con
 
 void DatabaseOrdinary::shutdown()
 {
+    stopWarmer();
+
+    {
+        std::lock_guard<std::recursive_mutex> lock(lazy_load_mutex);
+        tables_to_load.clear();
+    }
+
     /// You can not hold a lock during shutdown.
     /// Because inside `shutdown` function the tables can work with database, and mutex is not recursive.
 
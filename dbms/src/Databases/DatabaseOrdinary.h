@@ -1,6 +1,10 @@
 #pragma once
 
+#include <map>
+#include <atomic>
+
 #include <Databases/DatabasesCommon.h>
+#include <Common/ThreadPool.h>
 
 
 namespace DB
@@ -9,11 +13,17 @@ namespace DB
 /** Default engine of databases.
   * It stores tables list in filesystem using list of .sql files,
   *  that contain declaration of table represented by SQL ATTACH TABLE query.
+  *
+  * If `lazy_load_databases` is enabled in the server config, tables are registered from
+  *  the metadata file names at startup, but are instantiated (and their parts loaded)
+  *  only at first access. A background thread warms the remaining tables up, most recently
+  *  used first (the access order is persisted next to the database metadata directory).
   */
 class DatabaseOrdinary : public DatabaseWithOwnTablesBase
 {
 public:
     DatabaseOrdinary(String name_, const String & metadata_path_, const Context & context);
+    ~DatabaseOrdinary() override;
 
     String getEngineName() const override { return "Ordinary"; }
 
@@ -22,6 +32,21 @@ public:
         ThreadPool * thread_pool,
         bool has_force_restore_data_flag) override;
 
+    bool isTableExist(
+        const Context & context,
+        const String & table_name) const override;
+
+    StoragePtr tryGetTable(
+        const Context & context,
+        const String & table_name) const override;
+
+    bool empty(const Context & context) const override;
+
+    /// NOTE Instantiates all not yet loaded tables, because iteration returns storage objects.
+    DatabaseIteratorPtr getIterator(const Context & context) override;
+
+    StoragePtr detachTable(const String & table_name) override;
+
     void createTable(
         const Context & context,
         const String & table_name,
@@ -72,8 +97,37 @@ private:
     const String data_path;
     Poco::Logger * log;
 
+    /// State for lazy table loading. The mutex is recursive because instantiating one table
+    /// may look up another table of the same database (e.g. a materialized view looks up its
+    /// .inner table).
+    mutable std::recursive_mutex lazy_load_mutex;
+    /// Table name -> metadata file name, for tables that are registered but not instantiated yet.
+    mutable std::map<String, String> tables_to_load;
+    /// Context for deferred instantiation (the global context, set in loadTables).
+    Context * lazy_load_context = nullptr;
+    bool lazy_load_force_restore_data = false;
+    /// Table names in order of last access, most recently used first. Used by the warmer.
+    Strings warm_order;
+    std::atomic<bool> warmer_should_stop {false};
+    ThreadFromGlobalPool warmer_thread;
+
     void startupTables(ThreadPool * thread_pool);
 
+    /// Instantiates and starts up a table registered for lazy loading.
+    /// Returns nullptr if the table is not registered (or its metadata file turned out to be empty).
+    StoragePtr loadTableLazily(const String & table_name, bool record_access) const;
+
+    /// Instantiates all tables that are not loaded yet.
+    void loadPendingTables() const;
+
+    /// Loads not yet instantiated tables in background, in `warm_order`.
+    void warmTables();
+    void stopWarmer();
+
+    String getAccessOrderFilePath() const;
+    void readAccessOrderFile();
+    void recordTableAccess(const String & table_name) const;
+
     ASTPtr getCreateTableQueryImpl(const Context & context, const String & table_name, bool throw_on_error) const;
 };
 
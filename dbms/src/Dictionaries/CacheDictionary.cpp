@@ -745,17 +745,33 @@ void CacheDictionary::update(
         dict_lifetime.max_sec
     };
 
-    const ProfilingScopedWriteRWLock write_lock{rw_lock, ProfileEvents::DictCacheLockWriteNs};
+    std::vector<Block> fetched_blocks;
 
     {
         CurrentMetrics::Increment metric_increment{CurrentMetrics::DictCacheRequests};
         Stopwatch watch;
+
+        /** The source is queried before the write lock is taken: a round trip to the source can take
+          *  arbitrarily long, and readers of already cached keys must not block on it.
+          * Concurrent updates can fetch intersecting sets of keys; whichever is applied last wins,
+          *  which is no worse than the same cells expiring in a different order.
+          */
         auto stream = source_ptr->loadIds(requested_ids);
         stream->readPrefix();
+        while (auto block = stream->read())
+            fetched_blocks.emplace_back(std::move(block));
+        stream->readSuffix();
+
+        ProfileEvents::increment(ProfileEvents::DictCacheKeysRequested, requested_ids.size());
+        ProfileEvents::increment(ProfileEvents::DictCacheRequestTimeNs, watch.elapsed());
+    }
 
+    const ProfilingScopedWriteRWLock write_lock{rw_lock, ProfileEvents::DictCacheLockWriteNs};
+
+    {
         const auto now = std::chrono::system_clock::now();
 
-        while (const auto block = stream->read())
+        for (const auto & block : fetched_blocks)
         {
             const auto id_column = typeid_cast<const ColumnUInt64 *>(block.safeGetByPosition(0).column.get());
             if (!id_column)
@@ -802,11 +818,6 @@ void CacheDictionary::update(
                 remaining_ids[id] = 1;
             }
         }
-
-        stream->readSuffix();
-
-        ProfileEvents::increment(ProfileEvents::DictCacheKeysRequested, requested_ids.size());
-        ProfileEvents::increment(ProfileEvents::DictCacheRequestTimeNs, watch.elapsed());
     }
 
     size_t not_found_num = 0, found_num = 0;
@@ -0,0 +1,597 @@
+#include <ext/size.h>
+#include <Dictionaries/HashedArrayDictionary.h>
+#include <Dictionaries/DictionaryBlockInputStream.h>
+
+namespace DB
+{
+
+namespace ErrorCodes
+{
+    extern const int TYPE_MISMATCH;
+    extern const int ARGUMENT_OUT_OF_BOUND;
+    extern const int BAD_ARGUMENTS;
+    extern const int DICTIONARY_IS_EMPTY;
+}
+
+
+HashedArrayDictionary::HashedArrayDictionary(const std::string & name, const DictionaryStructure & dict_struct,
+    DictionarySourcePtr source_ptr, const DictionaryLifetime dict_lifetime, bool require_nonempty,
+    BlockPtr saved_block, size_t size_hint)
+    : name{name}, dict_struct(dict_struct), source_ptr{std::move(source_ptr)}, dict_lifetime(dict_lifetime),
+        require_nonempty(require_nonempty), size_hint(size_hint), saved_block{std::move(saved_block)}
+{
+    index_by_id = size_hint
+        ? std::make_unique<IndexMap>(size_hint)
+        : std::make_unique<IndexMap>();
+
+    createAttributes();
+
+    try
+    {
+        loadData();
+        calculateBytesAllocated();
+    }
+    catch (...)
+    {
+        creation_exception = std::current_exception();
+    }
+
+    creation_time = std::chrono::system_clock::now();
+}
+
+HashedArrayDictionary::HashedArrayDictionary(const HashedArrayDictionary & other)
+    : HashedArrayDictionary{other.name, other.dict_struct, other.source_ptr->clone(), other.dict_lifetime, other.require_nonempty,
+        other.saved_block, other.element_count}
+{
+}
+
+
+void HashedArrayDictionary::toParent(const PaddedPODArray<Key> & ids, PaddedPODArray<Key> & out) const
+{
+    const auto null_value = std::get<UInt64>(hierarchical_attribute->null_values);
+
+    getItemsNumber<UInt64>(*hierarchical_attribute, ids,
+        [&] (const size_t row, const UInt64 value) { out[row] = value; },
+        [&] (const size_t) { return null_value; });
+}
+
+
+/// Allow to use single value in same way as array.
+static inline HashedArrayDictionary::Key getAt(const PaddedPODArray<HashedArrayDictionary::Key> & arr, const size_t idx) { return arr[idx]; }
+static inline HashedArrayDictionary::Key getAt(const HashedArrayDictionary::Key & value, const size_t) { return value; }
+
+template <typename ChildType, typename AncestorType>
+void HashedArrayDictionary::isInImpl(
+    const ChildType & child_ids,
+    const AncestorType & ancestor_ids,
+    PaddedPODArray<UInt8> & out) const
+{
+    const auto null_value = std::get<UInt64>(hierarchical_attribute->null_values);
+    const auto & parents = std::get<ContainerType<UInt64>>(hierarchical_attribute->arrays);
+    const auto rows = out.size();
+
+    for (const auto row : ext::range(0, rows))
+    {
+        auto id = getAt(child_ids, row);
+        const auto ancestor_id = getAt(ancestor_ids, row);
+
+        while (id != null_value && id != ancestor_id)
+        {
+            const auto it = index_by_id->find(id);
+            if (it != std::end(*index_by_id))
+                id = parents[it->second];
+            else
+                break;
+        }
+
+        out[row] = id != null_value && id == ancestor_id;
+    }
+
+    query_count.fetch_add(rows, std::memory_order_relaxed);
+}
+
+void HashedArrayDictionary::isInVectorVector(
+    const PaddedPODArray<Key> & child_ids,
+    const PaddedPODArray<Key> & ancestor_ids,
+    PaddedPODArray<UInt8> & out) const
+{
+    isInImpl(child_ids, ancestor_ids, out);
+}
+
+void HashedArrayDictionary::isInVectorConstant(
+    const PaddedPODArray<Key> & child_ids,
+    const Key ancestor_id,
+    PaddedPODArray<UInt8> & out) const
+{
+    isInImpl(child_ids, ancestor_id, out);
+}
+
+void HashedArrayDictionary::isInConstantVector(
+    const Key child_id,
+    const PaddedPODArray<Key> & ancestor_ids,
+    PaddedPODArray<UInt8> & out) const
+{
+    isInImpl(child_id, ancestor_ids, out);
+}
+
+
+#define DECLARE(TYPE)\
+void HashedArrayDictionary::get##TYPE(const std::string & attribute_name, const PaddedPODArray<Key> & ids, ResultArrayType<TYPE> & out) const\
+{\
+    const auto & attribute = getAttribute(attribute_name);\
+    if (!isAttributeTypeConvertibleTo(attribute.type, AttributeUnderlyingType::TYPE))\
+        throw Exception{name + ": type mismatch: attribute " + attribute_name + " has type " + toString(attribute.type), ErrorCodes::TYPE_MISMATCH};\
+    \
+    const auto null_value = std::get<TYPE>(attribute.null_values);\
+    \
+    getItemsNumber<TYPE>(attribute, ids,\
+        [&] (const size_t row, const auto value) { out[row] = value; },\
+        [&] (const size_t) { return null_value; });\
+}
+DECLARE(UInt8)
+DECLARE(UInt16)
+DECLARE(UInt32)
+DECLARE(UInt64)
+DECLARE(UInt128)
+DECLARE(Int8)
+DECLARE(Int16)
+DECLARE(Int32)
+DECLARE(Int64)
+DECLARE(Float32)
+DECLARE(Float64)
+DECLARE(Decimal32)
+DECLARE(Decimal64)
+DECLARE(Decimal128)
+#undef DECLARE
+
+void HashedArrayDictionary::getString(const std::string & attribute_name, const PaddedPODArray<Key> & ids, ColumnString * out) const
+{
+    const auto & attribute = getAttribute(attribute_name);
+    if (!isAttributeTypeConvertibleTo(attribute.type, AttributeUnderlyingType::String))
+        throw Exception{name + ": type mismatch: attribute " + attribute_name + " has type " + toString(attribute.type), ErrorCodes::TYPE_MISMATCH};
+
+    const auto & null_value = StringRef{std::get<String>(attribute.null_values)};
+
+    getItemsImpl<StringRef, StringRef>(attribute, ids,
+        [&] (const size_t, const StringRef value) { out->insertData(value.data, value.size); },
+        [&] (const size_t) { return null_value; });
+}
+
+#define DECLARE(TYPE)\
+void HashedArrayDictionary::get##TYPE(\
+    const std::string & attribute_name, const PaddedPODArray<Key> & ids, const PaddedPODArray<TYPE> & def,\
+    ResultArrayType<TYPE> & out) const\
+{\
+    const auto & attribute = getAttribute(attribute_name);\
+    if (!isAttributeTypeConvertibleTo(attribute.type, AttributeUnderlyingType::TYPE))\
+        throw Exception{name + ": type mismatch: attribute " + attribute_name + " has type " + toString(attribute.type), ErrorCodes::TYPE_MISMATCH};\
+    \
+    getItemsNumber<TYPE>(attribute, ids,\
+        [&] (const size_t row, const auto value) { out[row] = value; },\
+        [&] (const size_t row) { return def[row]; });\
+}
+DECLARE(UInt8)
+DECLARE(UInt16)
+DECLARE(UInt32)
+DECLARE(UInt64)
+DECLARE(UInt128)
+DECLARE(Int8)
+DECLARE(Int16)
+DECLARE(Int32)
+DECLARE(Int64)
+DECLARE(Float32)
+DECLARE(Float64)
+DECLARE(Decimal32)
+DECLARE(Decimal64)
+DECLARE(Decimal128)
+#undef DECLARE
+
+void HashedArrayDictionary::getString(
+    const std::string & attribute_name, const PaddedPODArray<Key> & ids, const ColumnString * const def,
+    ColumnString * const out) const
+{
+    const auto & attribute = getAttribute(attribute_name);
+    if (!isAttributeTypeConvertibleTo(attribute.type, AttributeUnderlyingType::String))
+        throw Exception{name + ": type mismatch: attribute " + attribute_name + " has type " + toString(attribute.type), ErrorCodes::TYPE_MISMATCH};
+
+    getItemsImpl<StringRef, StringRef>(attribute, ids,
+        [&] (const size_t, const StringRef value) { out->insertData(value.data, value.size); },
+        [&] (const size_t row) { return def->getDataAt(row); });
+}
+
+#define DECLARE(TYPE)\
+void HashedArrayDictionary::get##TYPE(\
+    const std::string & attribute_name, const PaddedPODArray<Key> & ids, const TYPE & def, ResultArrayType<TYPE> & out) const\
+{\
+    const auto & attribute = getAttribute(attribute_name);\
+    if (!isAttributeTypeConvertibleTo(attribute.type, AttributeUnderlyingType::TYPE))\
+        throw Exception{name + ": type mismatch: attribute " + attribute_name + " has type " + toString(attribute.type), ErrorCodes::TYPE_MISMATCH};\
+    \
+    getItemsNumber<TYPE>(attribute, ids,\
+        [&] (const size_t row, const auto value) { out[row] = value; },\
+        [&] (const size_t) { return def; });\
+}
+DECLARE(UInt8)
+DECLARE(UInt16)
+DECLARE(UInt32)
+DECLARE(UInt64)
+DECLARE(UInt128)
+DECLARE(Int8)
+DECLARE(Int16)
+DECLARE(Int32)
+DECLARE(Int64)
+DECLARE(Float32)
+DECLARE(Float64)
+DECLARE(Decimal32)
+DECLARE(Decimal64)
+DECLARE(Decimal128)
+#undef DECLARE
+
+void HashedArrayDictionary::getString(
+    const std::string & attribute_name, const PaddedPODArray<Key> & ids, const String & def,
+    ColumnString * const out) const
+{
+    const auto & attribute = getAttribute(attribute_name);
+    if (!isAttributeTypeConvertibleTo(attribute.type, AttributeUnderlyingType::String))
+        throw Exception{name + ": type mismatch: attribute " + attribute_name + " has type " + toString(attribute.type), ErrorCodes::TYPE_MISMATCH};
+
+    getItemsImpl<StringRef, StringRef>(attribute, ids,
+        [&] (const size_t, const StringRef value) { out->insertData(value.data, value.size); },
+        [&] (const size_t) { return StringRef{def}; });
+}
+
+void HashedArrayDictionary::has(const PaddedPODArray<Key> & ids, PaddedPODArray<UInt8> & out) const
+{
+    /// Only the key table is probed; the attribute arrays are not touched at all.
+    const auto rows = ext::size(ids);
+
+    for (const auto i : ext::range(0, rows))
+        out[i] = index_by_id->find(ids[i]) != std::end(*index_by_id);
+
+    query_count.fetch_add(rows, std::memory_order_relaxed);
+}
+
+void HashedArrayDictionary::createAttributes()
+{
+    const auto size = dict_struct.attributes.size();
+    attributes.reserve(size);
+
+    for (const auto & attribute : dict_struct.attributes)
+    {
+        attribute_index_by_name.emplace(attribute.name, attributes.size());
+        attributes.push_back(createAttributeWithType(attribute.underlying_type, attribute.null_value));
+
+        if (attribute.hierarchical)
+        {
+            hierarchical_attribute = & attributes.back();
+
+            if (hierarchical_attribute->type != AttributeUnderlyingType::UInt64)
+                throw Exception{name + ": hierarchical attribute must be UInt64.", ErrorCodes::TYPE_MISMATCH};
+        }
+    }
+}
+
+void HashedArrayDictionary::blockToAttributes(const Block & block)
+{
+    const auto & id_column = *block.safeGetByPosition(0).column;
+    const auto rows = id_column.size();
+
+    /// Resolve every id to its dense index once; all attributes share this indexing.
+    PaddedPODArray<size_t> indices(rows);
+    for (const auto row : ext::range(0, rows))
+    {
+        IndexMap::iterator it;
+        bool inserted;
+        index_by_id->emplace(id_column[row].get<UInt64>(), it, inserted);
+        if (inserted)
+            it->second = index_by_id->size() - 1;
+        indices[row] = it->second;
+    }
+    element_count = index_by_id->size();
+
+    for (const size_t attribute_idx : ext::range(0, attributes.size()))
+    {
+        const IColumn & attribute_column = *block.safeGetByPosition(attribute_idx + 1).column;
+        auto & attribute = attributes[attribute_idx];
+
+        for (const auto row : ext::range(0, rows))
+            setAttributeValue(attribute, indices[row], attribute_column[row]);
+    }
+}
+
+void HashedArrayDictionary::updateData()
+{
+    if (!saved_block || saved_block->rows() == 0)
+    {
+        auto stream = source_ptr->loadUpdatedAll();
+        stream->readPrefix();
+
+        while (const auto block = stream->read())
+        {
+            /// We are using this to keep saved data if input stream consists of multiple blocks
+            if (!saved_block)
+                saved_block = std::make_shared<DB::Block>(block.cloneEmpty());
+            for (const auto attribute_idx : ext::range(0, attributes.size() + 1))
+            {
+                const IColumn & update_column = *block.getByPosition(attribute_idx).column.get();
+                MutableColumnPtr saved_column = saved_block->getByPosition(attribute_idx).column->assumeMutable();
+                saved_column->insertRangeFrom(update_column, 0, update_column.size());
+            }
+        }
+        stream->readSuffix();
+    }
+    else
+    {
+        auto stream = source_ptr->loadUpdatedAll();
+        stream->readPrefix();
+
+        while (Block block = stream->read())
+        {
+            const auto &saved_id_column = *saved_block->safeGetByPosition(0).column;
+            const auto &update_id_column = *block.safeGetByPosition(0).column;
+
+            std::unordered_map<Key, std::vector<size_t>> update_ids;
+            for (size_t row = 0; row < update_id_column.size(); ++row)
+            {
+                const auto id = update_id_column.get64(row);
+                update_ids[id].push_back(row);
+            }
+
+            const size_t saved_rows = saved_id_column.size();
+            IColumn::Filter filter(saved_rows);
+            std::unordered_map<Key, std::vector<size_t>>::iterator it;
+
+            for (size_t row = 0; row < saved_id_column.size(); ++row)
+            {
+                auto id = saved_id_column.get64(row);
+                it = update_ids.find(id);
+
+                if (it != update_ids.end())
+                    filter[row] = 0;
+                else
+                    filter[row] = 1;
+            }
+
+            auto block_columns = block.mutateColumns();
+            for (const auto attribute_idx : ext::range(0, attributes.size() + 1))
+            {
+                auto & column = saved_block->safeGetByPosition(attribute_idx).column;
+                const auto & filtered_column = column->filter(filter, -1);
+
+                block_columns[attribute_idx]->insertRangeFrom(*filtered_column.get(), 0, filtered_column->size());
+            }
+
+            saved_block->setColumns(std::move(block_columns));
+        }
+        stream->readSuffix();
+    }
+
+    if (saved_block)
+        blockToAttributes(*saved_block.get());
+}
+
+void HashedArrayDictionary::loadData()
+{
+    if (!source_ptr->hasUpdateField())
+    {
+        auto stream = source_ptr->loadAll();
+        stream->readPrefix();
+
+        while (const auto block = stream->read())
+            blockToAttributes(block);
+
+        stream->readSuffix();
+    }
+    else
+        updateData();
+
+    if (require_nonempty && 0 == element_count)
+        throw Exception{name + ": dictionary source is empty and 'require_nonempty' property is set.", ErrorCodes::DICTIONARY_IS_EMPTY};
+}
+
+template <typename T>
+void HashedArrayDictionary::addAttributeSize(const Attribute & attribute)
+{
+    const auto & array_ref = std::get<ContainerType<T>>(attribute.arrays);
+    bytes_allocated += sizeof(ContainerType<T>) + array_ref.allocated_bytes();
+}
+
+void HashedArrayDictionary::calculateBytesAllocated()
+{
+    bytes_allocated += sizeof(IndexMap) + index_by_id->getBufferSizeInBytes();
+    bucket_count = index_by_id->getBufferSizeInCells();
+
+    bytes_allocated += attributes.size() * sizeof(attributes.front());
+
+    for (const auto & attribute : attributes)
+    {
+        switch (attribute.type)
+        {
+            case AttributeUnderlyingType::UInt8: addAttributeSize<UInt8>(attribute); break;
+            case AttributeUnderlyingType::UInt16: addAttributeSize<UInt16>(attribute); break;
+            case AttributeUnderlyingType::UInt32: addAttributeSize<UInt32>(attribute); break;
+            case AttributeUnderlyingType::UInt64: addAttributeSize<UInt64>(attribute); break;
+            case AttributeUnderlyingType::UInt128: addAttributeSize<UInt128>(attribute); break;
+            case AttributeUnderlyingType::Int8: addAttributeSize<Int8>(attribute); break;
+            case AttributeUnderlyingType::Int16: addAttributeSize<Int16>(attribute); break;
+            case AttributeUnderlyingType::Int32: addAttributeSize<Int32>(attribute); break;
+            case AttributeUnderlyingType::Int64: addAttributeSize<Int64>(attribute); break;
+            case AttributeUnderlyingType::Float32: addAttributeSize<Float32>(attribute); break;
+            case AttributeUnderlyingType::Float64: addAttributeSize<Float64>(attribute); break;
+
+            case AttributeUnderlyingType::Decimal32: addAttributeSize<Decimal32>(attribute); break;
+            case AttributeUnderlyingType::Decimal64: addAttributeSize<Decimal64>(attribute); break;
+            case AttributeUnderlyingType::Decimal128: addAttributeSize<Decimal128>(attribute); break;
+
+            case AttributeUnderlyingType::String:
+            {
+                addAttributeSize<StringRef>(attribute);
+                bytes_allocated += sizeof(Arena) + attribute.string_arena->size();
+
+                break;
+            }
+        }
+    }
+}
+
+template <typename T>
+void HashedArrayDictionary::createAttributeImpl(Attribute & attribute, const Field & null_value)
+{
+    attribute.null_values = T(null_value.get<NearestFieldType<T>>());
+    attribute.arrays = ContainerType<T>();
+    if (size_hint)
+        std::get<ContainerType<T>>(attribute.arrays).reserve(size_hint);
+}
+
+HashedArrayDictionary::Attribute HashedArrayDictionary::createAttributeWithType(const AttributeUnderlyingType type, const Field & null_value)
+{
+    Attribute attr{type, {}, {}, {}};
+
+    switch (type)
+    {
+        case AttributeUnderlyingType::UInt8: createAttributeImpl<UInt8>(attr, null_value); break;
+        case AttributeUnderlyingType::UInt16: createAttributeImpl<UInt16>(attr, null_value); break;
+        case AttributeUnderlyingType::UInt32: createAttributeImpl<UInt32>(attr, null_value); break;
+        case AttributeUnderlyingType::UInt64: createAttributeImpl<UInt64>(attr, null_value); break;
+        case AttributeUnderlyingType::UInt128: createAttributeImpl<UInt128>(attr, null_value); break;
+        case AttributeUnderlyingType::Int8: createAttributeImpl<Int8>(attr, null_value); break;
+        case AttributeUnderlyingType::Int16: createAttributeImpl<Int16>(attr, null_value); break;
+        case AttributeUnderlyingType::Int32: createAttributeImpl<Int32>(attr, null_value); break;
+        case AttributeUnderlyingType::Int64: createAttributeImpl<Int64>(attr, null_value); break;
+        case AttributeUnderlyingType::Float32: createAttributeImpl<Float32>(attr, null_value); break;
+        case AttributeUnderlyingType::Float64: createAttributeImpl<Float64>(attr, null_value); break;
+
+        case AttributeUnderlyingType::Decimal32: createAttributeImpl<Decimal32>(attr, null_value); break;
+        case AttributeUnderlyingType::Decimal64: createAttributeImpl<Decimal64>(attr, null_value); break;
+        case AttributeUnderlyingType::Decimal128: createAttributeImpl<Decimal128>(attr, null_value); break;
+
+        case AttributeUnderlyingType::String:
+        {
+            attr.null_values = null_value.get<String>();
+            attr.arrays = ContainerType<StringRef>();
+            if (size_hint)
+                std::get<ContainerType<StringRef>>(attr.arrays).reserve(size_hint);
+            attr.string_arena = std::make_unique<Arena>();
+            break;
+        }
+    }
+
+    return attr;
+}
+
+
+template <typename OutputType, typename ValueSetter, typename DefaultGetter>
+void HashedArrayDictionary::getItemsNumber(
+    const Attribute & attribute,
+    const PaddedPODArray<Key> & ids,
+    ValueSetter && set_value,
+    DefaultGetter && get_default) const
+{
+    if (false) {}
+#define DISPATCH(TYPE) \
+    else if (attribute.type == AttributeUnderlyingType::TYPE) \
+        getItemsImpl<TYPE, OutputType>(attribute, ids, std::forward<ValueSetter>(set_value), std::forward<DefaultGetter>(get_default));
+    DISPATCH(UInt8)
+    DISPATCH(UInt16)
+    DISPATCH(UInt32)
+    DISPATCH(UInt64)
+    DISPATCH(UInt128)
+    DISPATCH(Int8)
+    DISPATCH(Int16)
+    DISPATCH(Int32)
+    DISPATCH(Int64)
+    DISPATCH(Float32)
+    DISPATCH(Float64)
+    DISPATCH(Decimal32)
+    DISPATCH(Decimal64)
+    DISPATCH(Decimal128)
+#undef DISPATCH
+    else
+        throw Exception("Unexpected type of attribute: " + toString(attribute.type), ErrorCodes::LOGICAL_ERROR);
+}
+
+template <typename AttributeType, typename OutputType, typename ValueSetter, typename DefaultGetter>
+void HashedArrayDictionary::getItemsImpl(
+    const Attribute & attribute,
+    const PaddedPODArray<Key> & ids,
+    ValueSetter && set_value,
+    DefaultGetter && get_default) const
+{
+    const auto & array = std::get<ContainerType<AttributeType>>(attribute.arrays);
+    const auto rows = ext::size(ids);
+
+    for (const auto i : ext::range(0, rows))
+    {
+        const auto it = index_by_id->find(ids[i]);
+        set_value(i, it != std::end(*index_by_id) ? static_cast<OutputType>(array[it->second]) : get_default(i));
+    }
+
+    query_count.fetch_add(rows, std::memory_order_relaxed);
+}
+
+
+template <typename T>
+void HashedArrayDictionary::setAttributeValueImpl(Attribute & attribute, const size_t index, const T value)
+{
+    auto & array = std::get<ContainerType<T>>(attribute.arrays);
+    if (index >= array.size())
+        array.resize(index + 1);
+    array[index] = value;
+}
+
+void HashedArrayDictionary::setAttributeValue(Attribute & attribute, const size_t index, const Field & value)
+{
+    switch (attribute.type)
+    {
+        case AttributeUnderlyingType::UInt8: setAttributeValueImpl<UInt8>(attribute, index, value.get<UInt64>()); break;
+        case AttributeUnderlyingType::UInt16: setAttributeValueImpl<UInt16>(attribute, index, value.get<UInt64>()); break;
+        case AttributeUnderlyingType::UInt32: setAttributeValueImpl<UInt32>(attribute, index, value.get<UInt64>()); break;
+        case AttributeUnderlyingType::UInt64: setAttributeValueImpl<UInt64>(attribute, index, value.get<UInt64>()); break;
+        case AttributeUnderlyingType::UInt128: setAttributeValueImpl<UInt128>(attribute, index, value.get<UInt128>()); break;
+        case AttributeUnderlyingType::Int8: setAttributeValueImpl<Int8>(attribute, index, value.get<Int64>()); break;
+        case AttributeUnderlyingType::Int16: setAttributeValueImpl<Int16>(attribute, index, value.get<Int64>()); break;
+        case AttributeUnderlyingType::Int32: setAttributeValueImpl<Int32>(attribute, index, value.get<Int64>()); break;
+        case AttributeUnderlyingType::Int64: setAttributeValueImpl<Int64>(attribute, index, value.get<Int64>()); break;
+        case AttributeUnderlyingType::Float32: setAttributeValueImpl<Float32>(attribute, index, value.get<Float64>()); break;
+        case AttributeUnderlyingType::Float64: setAttributeValueImpl<Float64>(attribute, index, value.get<Float64>()); break;
+
+        case AttributeUnderlyingType::Decimal32: setAttributeValueImpl<Decimal32>(attribute, index, value.get<Decimal32>()); break;
+        case AttributeUnderlyingType::Decimal64: setAttributeValueImpl<Decimal64>(attribute, index, value.get<Decimal64>()); break;
+        case AttributeUnderlyingType::Decimal128: setAttributeValueImpl<Decimal128>(attribute, index, value.get<Decimal128>()); break;
+
+        case AttributeUnderlyingType::String:
+        {
+            const auto & string = value.get<String>();
+            const auto string_in_arena = attribute.string_arena->insert(string.data(), string.size());
+            setAttributeValueImpl<StringRef>(attribute, index, StringRef{string_in_arena, string.size()});
+            break;
+        }
+    }
+}
+
+const HashedArrayDictionary::Attribute & HashedArrayDictionary::getAttribute(const std::string & attribute_name) const
+{
+    const auto it = attribute_index_by_name.find(attribute_name);
+    if (it == std::end(attribute_index_by_name))
+        throw Exception{name + ": no such attribute '" + attribute_name + "'", ErrorCodes::BAD_ARGUMENTS};
+
+    return attributes[it->second];
+}
+
+PaddedPODArray<HashedArrayDictionary::Key> HashedArrayDictionary::getIds() const
+{
+    PaddedPODArray<Key> ids;
+    ids.reserve(index_by_id->size());
+    for (const auto & value : *index_by_id)
+        ids.push_back(value.first);
+
+    return ids;
+}
+
+BlockInputStreamPtr HashedArrayDictionary::getBlockInputStream(const Names & column_names, size_t max_block_size) const
+{
+    using BlockInputStreamType = DictionaryBlockInputStream<HashedArrayDictionary, Key>;
+    return std::make_shared<BlockInputStreamType>(shared_from_this(), max_block_size, getIds(), column_names);
+}
+
+}
@@ -0,0 +1,252 @@
+#pragma once
+
+#include <Dictionaries/IDictionary.h>
+#include <Dictionaries/IDictionarySource.h>
+#include <Dictionaries/DictionaryStructure.h>
+#include <Common/HashTable/HashMap.h>
+#include <Columns/ColumnDecimal.h>
+#include <Columns/ColumnString.h>
+#include <ext/range.h>
+#include <atomic>
+#include <memory>
+#include <variant>
+
+
+namespace DB
+{
+
+using BlockPtr = std::shared_ptr<Block>;
+
+/** Unlike HashedDictionary, which keeps a separate id -> value hash table per attribute,
+  *  this layout has a single hash table mapping id -> dense index
+  *  and stores every attribute as a flat array addressed by that index.
+  * A lookup of N attributes for the same id costs one hash probe instead of N,
+  *  and the per-attribute storage is contiguous, which is both smaller and friendlier to the cache.
+  */
+class HashedArrayDictionary final : public IDictionary
+{
+public:
+    HashedArrayDictionary(const std::string & name, const DictionaryStructure & dict_struct,
+        DictionarySourcePtr source_ptr, const DictionaryLifetime dict_lifetime, bool require_nonempty,
+        BlockPtr saved_block = nullptr, size_t size_hint = 0);
+
+    HashedArrayDictionary(const HashedArrayDictionary & other);
+
+    std::exception_ptr getCreationException() const override { return creation_exception; }
+
+    std::string getName() const override { return name; }
+
+    std::string getTypeName() const override { return "HashedArray"; }
+
+    size_t getBytesAllocated() const override { return bytes_allocated; }
+
+    size_t getQueryCount() const override { return query_count.load(std::memory_order_relaxed); }
+
+    double getHitRate() const override { return 1.0; }
+
+    size_t getElementCount() const override { return element_count; }
+
+    double getLoadFactor() const override { return static_cast<double>(element_count) / bucket_count; }
+
+    bool isCached() const override { return false; }
+
+    std::unique_ptr<IExternalLoadable> clone() const override { return std::make_unique<HashedArrayDictionary>(*this); }
+
+    const IDictionarySource * getSource() const override { return source_ptr.get(); }
+
+    const DictionaryLifetime & getLifetime() const override { return dict_lifetime; }
+
+    const DictionaryStructure & getStructure() const override { return dict_struct; }
+
+    std::chrono::time_point<std::chrono::system_clock> getCreationTime() const override
+    {
+        return creation_time;
+    }
+
+    bool isInjective(const std::string & attribute_name) const override
+    {
+        return dict_struct.attributes[&getAttribute(attribute_name) - attributes.data()].injective;
+    }
+
+    bool hasHierarchy() const override { return hierarchical_attribute; }
+
+    void toParent(const PaddedPODArray<Key> & ids, PaddedPODArray<Key> & out) const override;
+
+    template <typename T>
+    using ResultArrayType = std::conditional_t<IsDecimalNumber<T>, DecimalPaddedPODArray<T>, PaddedPODArray<T>>;
+
+#define DECLARE(TYPE)\
+    void get##TYPE(const std::string & attribute_name, const PaddedPODArray<Key> & ids, ResultArrayType<TYPE> & out) const;
+    DECLARE(UInt8)
+    DECLARE(UInt16)
+    DECLARE(UInt32)
+    DECLARE(UInt64)
+    DECLARE(UInt128)
+    DECLARE(Int8)
+    DECLARE(Int16)
+    DECLARE(Int32)
+    DECLARE(Int64)
+    DECLARE(Float32)
+    DECLARE(Float64)
+    DECLARE(Decimal32)
+    DECLARE(Decimal64)
+    DECLARE(Decimal128)
+#undef DECLARE
+
+    void getString(const std::string & attribute_name, const PaddedPODArray<Key> & ids, ColumnString * out) const;
+
+#define DECLARE(TYPE)\
+    void get##TYPE(\
+        const std::string & attribute_name, const PaddedPODArray<Key> & ids, const PaddedPODArray<TYPE> & def,\
+        ResultArrayType<TYPE> & out) const;
+    DECLARE(UInt8)
+    DECLARE(UInt16)
+    DECLARE(UInt32)
+    DECLARE(UInt64)
+    DECLARE(UInt128)
+    DECLARE(Int8)
+    DECLARE(Int16)
+    DECLARE(Int32)
+    DECLARE(Int64)
+    DECLARE(Float32)
+    DECLARE(Float64)
+    DECLARE(Decimal32)
+    DECLARE(Decimal64)
+    DECLARE(Decimal128)
+#undef DECLARE
+
+    void getString(
+        const std::string & attribute_name, const PaddedPODArray<Key> & ids, const ColumnString * const def,
+        ColumnString * const out) const;
+
+#define DECLARE(TYPE)\
+    void get##TYPE(\
+        const std::string & attribute_name, const PaddedPODArray<Key> & ids, const TYPE & def, ResultArrayType<TYPE> & out) const;
+    DECLARE(UInt8)
+    DECLARE(UInt16)
+    DECLARE(UInt32)
+    DECLARE(UInt64)
+    DECLARE(UInt128)
+    DECLARE(Int8)
+    DECLARE(Int16)
+    DECLARE(Int32)
+    DECLARE(Int64)
+    DECLARE(Float32)
+    DECLARE(Float64)
+    DECLARE(Decimal32)
+    DECLARE(Decimal64)
+    DECLARE(Decimal128)
+#undef DECLARE
+
+    void getString(
+        const std::string & attribute_name, const PaddedPODArray<Key> & ids, const String & def,
+        ColumnString * const out) const;
+
+    void has(const PaddedPODArray<Key> & ids, PaddedPODArray<UInt8> & out) const override;
+
+    void isInVectorVector(const PaddedPODArray<Key> & child_ids, const PaddedPODArray<Key> & ancestor_ids, PaddedPODArray<UInt8> & out) const override;
+    void isInVectorConstant(const PaddedPODArray<Key> & child_ids, const Key ancestor_id, PaddedPODArray<UInt8> & out) const override;
+    void isInConstantVector(const Key child_id, const PaddedPODArray<Key> & ancestor_ids, PaddedPODArray<UInt8> & out) const override;
+
+    BlockInputStreamPtr getBlockInputStream(const Names & column_names, size_t max_block_size) const override;
+
+private:
+    /// id -> index in the attribute arrays. Shared by all attributes.
+    using IndexMap = HashMap<UInt64, size_t>;
+    using IndexMapPtr = std::unique_ptr<IndexMap>;
+
+    template <typename Value> using ContainerType = PaddedPODArray<Value>;
+
+    struct Attribute final
+    {
+        AttributeUnderlyingType type;
+        std::variant<
+            UInt8, UInt16, UInt32, UInt64,
+            UInt128,
+            Int8, Int16, Int32, Int64,
+            Decimal32, Decimal64, Decimal128,
+            Float32, Float64,
+            String> null_values;
+        std::variant<
+            ContainerType<UInt8>, ContainerType<UInt16>, ContainerType<UInt32>, ContainerType<UInt64>,
+            ContainerType<UInt128>,
+            ContainerType<Int8>, ContainerType<Int16>, ContainerType<Int32>, ContainerType<Int64>,
+            ContainerType<Decimal32>, ContainerType<Decimal64>, ContainerType<Decimal128>,
+            ContainerType<Float32>, ContainerType<Float64>,
+            ContainerType<StringRef>> arrays;
+        std::unique_ptr<Arena> string_arena;
+    };
+
+    void createAttributes();
+
+    void blockToAttributes(const Block & block);
+
+    void updateData();
+
+    void loadData();
+
+    template <typename T>
+    void addAttributeSize(const Attribute & attribute);
+
+    void calculateBytesAllocated();
+
+    template <typename T>
+    void createAttributeImpl(Attribute & attribute, const Field & null_value);
+
+    Attribute createAttributeWithType(const AttributeUnderlyingType type, const Field & null_value);
+
+    template <typename OutputType, typename ValueSetter, typename DefaultGetter>
+    void getItemsNumber(
+        const Attribute & attribute,
+        const PaddedPODArray<Key> & ids,
+        ValueSetter && set_value,
+        DefaultGetter && get_default) const;
+
+    template <typename AttributeType, typename OutputType, typename ValueSetter, typename DefaultGetter>
+    void getItemsImpl(
+        const Attribute & attribute,
+        const PaddedPODArray<Key> & ids,
+        ValueSetter && set_value,
+        DefaultGetter && get_default) const;
+
+    template <typename T>
+    void setAttributeValueImpl(Attribute & attribute, const size_t index, const T value);
+
+    void setAttributeValue(Attribute & attribute, const size_t index, const Field & value);
+
+    const Attribute & getAttribute(const std::string & attribute_name) const;
+
+    PaddedPODArray<Key> getIds() const;
+
+    template <typename ChildType, typename AncestorType>
+    void isInImpl(
+        const ChildType & child_ids,
+        const AncestorType & ancestor_ids,
+        PaddedPODArray<UInt8> & out) const;
+
+    const std::string name;
+    const DictionaryStructure dict_struct;
+    const DictionarySourcePtr source_ptr;
+    const DictionaryLifetime dict_lifetime;
+    const bool require_nonempty;
+    const size_t size_hint;
+
+    std::map<std::string, size_t> attribute_index_by_name;
+    std::vector<Attribute> attributes;
+    const Attribute * hierarchical_attribute = nullptr;
+
+    IndexMapPtr index_by_id;
+
+    size_t bytes_allocated = 0;
+    size_t element_count = 0;
+    size_t bucket_count = 0;
+    mutable std::atomic<size_t> query_count{0};
+
+    std::chrono::time_point<std::chrono::system_clock> creation_time;
+
+    std::exception_ptr creation_exception;
+
+    BlockPtr saved_block;
+};
+
+}
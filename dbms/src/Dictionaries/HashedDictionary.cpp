@@ -15,9 +15,10 @@ namespace ErrorCodes
 
 
 HashedDictionary::HashedDictionary(const std::string & name, const DictionaryStructure & dict_struct,
-    DictionarySourcePtr source_ptr, const DictionaryLifetime dict_lifetime, bool require_nonempty, BlockPtr saved_block)
+    DictionarySourcePtr source_ptr, const DictionaryLifetime dict_lifetime, bool require_nonempty,
+    BlockPtr saved_block, size_t size_hint)
     : name{name}, dict_struct(dict_struct), source_ptr{std::move(source_ptr)}, dict_lifetime(dict_lifetime),
-        require_nonempty(require_nonempty), saved_block{std::move(saved_block)}
+        require_nonempty(require_nonempty), size_hint(size_hint), saved_block{std::move(saved_block)}
 {
     createAttributes();
 
@@ -35,7 +36,8 @@ HashedDictionary::HashedDictionary(const std::string & name, const DictionaryStr
 }
 
 HashedDictionary::HashedDictionary(const HashedDictionary & other)
-    : HashedDictionary{other.name, other.dict_struct, other.source_ptr->clone(), other.dict_lifetime, other.require_nonempty, other.saved_block}
+    : HashedDictionary{other.name, other.dict_struct, other.source_ptr->clone(), other.dict_lifetime, other.require_nonempty,
+        other.saved_block, other.element_count}
 {
 }
 
@@ -431,7 +433,9 @@ template <typename T>
 void HashedDictionary::createAttributeImpl(Attribute & attribute, const Field & null_value)
 {
     attribute.null_values = T(null_value.get<NearestFieldType<T>>());
-    attribute.maps = std::make_unique<CollectionType<T>>();
+    attribute.maps = size_hint
+        ? std::make_unique<CollectionType<T>>(size_hint)
+        : std::make_unique<CollectionType<T>>();
 }
 
 HashedDictionary::Attribute HashedDictionary::createAttributeWithType(const AttributeUnderlyingType type, const Field & null_value)
@@ -459,7 +463,9 @@ HashedDictionary::Attribute HashedDictionary::createAttributeWithType(const Attr
         case AttributeUnderlyingType::String:
         {
             attr.null_values = null_value.get<String>();
-            attr.maps = std::make_unique<CollectionType<StringRef>>();
+            attr.maps = size_hint
+                ? std::make_unique<CollectionType<StringRef>>(size_hint)
+                : std::make_unique<CollectionType<StringRef>>();
             attr.string_arena = std::make_unique<Arena>();
             break;
         }
@@ -20,8 +20,11 @@ using BlockPtr = std::shared_ptr<Block>;
 class HashedDictionary final : public IDictionary
 {
 public:
+    /// size_hint is the expected number of keys; it is used to pre-size the hash tables
+    ///  so that a reload of a dictionary of known cardinality does not go through a cascade of rehashes.
     HashedDictionary(const std::string & name, const DictionaryStructure & dict_struct,
-        DictionarySourcePtr source_ptr, const DictionaryLifetime dict_lifetime, bool require_nonempty, BlockPtr saved_block = nullptr);
+        DictionarySourcePtr source_ptr, const DictionaryLifetime dict_lifetime, bool require_nonempty,
+        BlockPtr saved_block = nullptr, size_t size_hint = 0);
 
     HashedDictionary(const HashedDictionary & other);
 
@@ -225,6 +228,7 @@ private:
     const DictionarySourcePtr source_ptr;
     const DictionaryLifetime dict_lifetime;
     const bool require_nonempty;
+    const size_t size_hint;
 
     std::map<std::string, size_t> attribute_index_by_name;
     std::vector<Attribute> attributes;
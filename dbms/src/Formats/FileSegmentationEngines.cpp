@@ -0,0 +1,217 @@
+#include <cstring>
+#include <common/find_symbols.h>
+#include <Formats/FormatFactory.h>
+#include <IO/BufferWithOwnMemory.h>
+#include <IO/ReadBuffer.h>
+
+
+namespace DB
+{
+
+/** Functions that cut an input stream into chunks at row boundaries, for parallel parsing.
+  * Each function reads at least min_chunk_size bytes into 'memory' (if that much data is available),
+  *  continues to the end of the current row and returns whether the buffer is not yet exhausted.
+  *
+  * Only formats where a row boundary can be found without real parsing have an engine here.
+  * The WithNames/WithNamesAndTypes variants are left out: their header would be parsed again in every chunk.
+  */
+
+namespace
+{
+
+void appendToMemory(Memory & memory, size_t & used, const char * begin, const char * end)
+{
+    size_t bytes = end - begin;
+    if (!bytes)
+        return;
+    if (used + bytes > memory.size())
+        memory.resize(used + bytes);
+    memcpy(memory.data() + used, begin, bytes);
+    used += bytes;
+}
+
+/// For formats with backslash escaping and a newline as the row delimiter (TabSeparated, TSKV).
+bool fileSegmentationEngineTabSeparatedImpl(ReadBuffer & in, Memory & memory, size_t min_chunk_size)
+{
+    size_t used = 0;
+    bool in_escape = false; /// The previous character was an unconsumed backslash (may span buffers).
+
+    while (!in.eof())
+    {
+        char * begin = in.position();
+        char * end = in.buffer().end();
+        char * pos = begin;
+
+        while (pos < end)
+        {
+            if (in_escape)
+            {
+                in_escape = false;
+                ++pos;
+                continue;
+            }
+
+            pos = find_first_symbols<'\\', '\n'>(pos, end);
+            if (pos == end)
+                break;
+
+            if (*pos == '\\')
+            {
+                in_escape = true;
+                ++pos;
+                continue;
+            }
+
+            ++pos; /// Include the newline into the chunk.
+            if (used + static_cast<size_t>(pos - begin) >= min_chunk_size)
+            {
+                appendToMemory(memory, used, begin, pos);
+                in.position() = pos;
+                memory.resize(used);
+                return true;
+            }
+        }
+
+        appendToMemory(memory, used, begin, end);
+        in.position() = end;
+    }
+
+    memory.resize(used);
+    return false;
+}
+
+/// For CSV: a newline inside a double-quoted field is not a row boundary.
+/// A doubled quote inside a quoted field toggles the state twice, so a plain toggle is enough.
+bool fileSegmentationEngineCSVImpl(ReadBuffer & in, Memory & memory, size_t min_chunk_size)
+{
+    size_t used = 0;
+    bool in_quotes = false;
+
+    while (!in.eof())
+    {
+        char * begin = in.position();
+        char * end = in.buffer().end();
+        char * pos = begin;
+
+        while (pos < end)
+        {
+            pos = find_first_symbols<'"', '\n'>(pos, end);
+            if (pos == end)
+                break;
+
+            if (*pos == '"')
+            {
+                in_quotes = !in_quotes;
+                ++pos;
+                continue;
+            }
+
+            ++pos;
+            if (!in_quotes && used + static_cast<size_t>(pos - begin) >= min_chunk_size)
+            {
+                appendToMemory(memory, used, begin, pos);
+                in.position() = pos;
+                memory.resize(used);
+                return true;
+            }
+        }
+
+        appendToMemory(memory, used, begin, end);
+        in.position() = end;
+    }
+
+    memory.resize(used);
+    return false;
+}
+
+/// For JSONEachRow: a row ends where the balance of curly braces outside of string literals returns to zero.
+/// This also permits objects formatted over several lines.
+bool fileSegmentationEngineJSONEachRowImpl(ReadBuffer & in, Memory & memory, size_t min_chunk_size)
+{
+    size_t used = 0;
+    int64_t balance = 0;    /// Can dip below zero on malformed input, the parser will report the error.
+    bool in_string = false;
+    bool in_escape = false;
+
+    while (!in.eof())
+    {
+        char * begin = in.position();
+        char * end = in.buffer().end();
+        char * pos = begin;
+
+        while (pos < end)
+        {
+            if (in_escape)
+            {
+                in_escape = false;
+                ++pos;
+                continue;
+            }
+
+            if (in_string)
+            {
+                pos = find_first_symbols<'"', '\\'>(pos, end);
+                if (pos == end)
+                    break;
+                if (*pos == '\\')
+                    in_escape = true;
+                else
+                    in_string = false;
+                ++pos;
+                continue;
+            }
+
+            pos = find_first_symbols<'{', '}', '"'>(pos, end);
+            if (pos == end)
+                break;
+
+            if (*pos == '{')
+                ++balance;
+            else if (*pos == '}')
+                --balance;
+            else
+                in_string = true;
+
+            ++pos;
+            if (balance == 0 && used + static_cast<size_t>(pos - begin) >= min_chunk_size)
+            {
+                appendToMemory(memory, used, begin, pos);
+                in.position() = pos;
+                memory.resize(used);
+                return true;
+            }
+        }
+
+        appendToMemory(memory, used, begin, end);
+        in.position() = end;
+    }
+
+    memory.resize(used);
+    return false;
+}
+
+}
+
+
+void registerFileSegmentationEngineTabSeparated(FormatFactory & factory)
+{
+    for (auto name : {"TabSeparated", "TSV"})
+        factory.registerFileSegmentationEngine(name, &fileSegmentationEngineTabSeparatedImpl);
+}
+
+void registerFileSegmentationEngineTSKV(FormatFactory & factory)
+{
+    factory.registerFileSegmentationEngine("TSKV", &fileSegmentationEngineTabSeparatedImpl);
+}
+
+void registerFileSegmentationEngineCSV(FormatFactory & factory)
+{
+    factory.registerFileSegmentationEngine("CSV", &fileSegmentationEngineCSVImpl);
+}
+
+void registerFileSegmentationEngineJSONEachRow(FormatFactory & factory)
+{
+    factory.registerFileSegmentationEngine("JSONEachRow", &fileSegmentationEngineJSONEachRowImpl);
+}
+
+}
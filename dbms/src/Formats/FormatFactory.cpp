@@ -4,6 +4,7 @@
 #include <DataStreams/MaterializingBlockOutputStream.h>
 #include <Formats/FormatSettings.h>
 #include <Formats/FormatFactory.h>
+#include <Formats/ParallelParsingBlockInputStream.h>
 
 
 namespace DB
@@ -29,7 +30,8 @@ const FormatFactory::Creators & FormatFactory::getCreators(const String & name)
 
 BlockInputStreamPtr FormatFactory::getInput(const String & name, ReadBuffer & buf, const Block & sample, const Context & context, size_t max_block_size) const
 {
-    const auto & input_getter = getCreators(name).first;
+    const auto & creators = getCreators(name);
+    const auto & input_getter = creators.input_creator;
     if (!input_getter)
         throw Exception("Format " + name + " is not suitable for input", ErrorCodes::FORMAT_IS_NOT_SUITABLE_FOR_INPUT);
 
@@ -46,13 +48,31 @@ BlockInputStreamPtr FormatFactory::getInput(const String & name, ReadBuffer & bu
     format_settings.input_allow_errors_num = settings.input_format_allow_errors_num;
     format_settings.input_allow_errors_ratio = settings.input_format_allow_errors_ratio;
 
+    if (settings.input_format_parallel_parsing
+        && size_t(settings.max_threads) > 1
+        && creators.file_segmentation_engine)
+    {
+        ParallelParsingBlockInputStream::Params params
+        {
+            buf, sample,
+            [input_getter, sample, &context, max_block_size, format_settings](ReadBuffer & chunk_buf)
+            {
+                return input_getter(chunk_buf, sample, context, max_block_size, format_settings);
+            },
+            creators.file_segmentation_engine,
+            settings.max_threads,
+            settings.min_chunk_bytes_for_parallel_parsing
+        };
+        return std::make_shared<ParallelParsingBlockInputStream>(params);
+    }
+
     return input_getter(buf, sample, context, max_block_size, format_settings);
 }
 
 
 BlockOutputStreamPtr FormatFactory::getOutput(const String & name, WriteBuffer & buf, const Block & sample, const Context & context) const
 {
-    const auto & output_getter = getCreators(name).second;
+    const auto & output_getter = getCreators(name).output_creator;
     if (!output_getter)
         throw Exception("Format " + name + " is not suitable for output", ErrorCodes::FORMAT_IS_NOT_SUITABLE_FOR_OUTPUT);
 
@@ -80,7 +100,7 @@ BlockOutputStreamPtr FormatFactory::getOutput(const String & name, WriteBuffer &
 
 void FormatFactory::registerInputFormat(const String & name, InputCreator input_creator)
 {
-    auto & target = dict[name].first;
+    auto & target = dict[name].input_creator;
     if (target)
         throw Exception("FormatFactory: Input format " + name + " is already registered", ErrorCodes::LOGICAL_ERROR);
     target = input_creator;
@@ -88,12 +108,20 @@ void FormatFactory::registerInputFormat(const String & name, InputCreator input_
 
 void FormatFactory::registerOutputFormat(const String & name, OutputCreator output_creator)
 {
-    auto & target = dict[name].second;
+    auto & target = dict[name].output_creator;
     if (target)
         throw Exception("FormatFactory: Output format " + name + " is already registered", ErrorCodes::LOGICAL_ERROR);
     target = output_creator;
 }
 
+void FormatFactory::registerFileSegmentationEngine(const String & name, FileSegmentationEngine file_segmentation_engine)
+{
+    auto & target = dict[name].file_segmentation_engine;
+    if (target)
+        throw Exception("FormatFactory: File segmentation engine for format " + name + " is already registered", ErrorCodes::LOGICAL_ERROR);
+    target = file_segmentation_engine;
+}
+
 
 /// Formats for both input/output.
 
@@ -111,6 +139,8 @@ void registerInputFormatTSKV(FormatFactory & factory);
 void registerOutputFormatTSKV(FormatFactory & factory);
 void registerInputFormatJSONEachRow(FormatFactory & factory);
 void registerOutputFormatJSONEachRow(FormatFactory & factory);
+void registerInputFormatProtobuf(FormatFactory & factory);
+void registerOutputFormatProtobuf(FormatFactory & factory);
 
 /// Output only (presentational) formats.
 
@@ -129,6 +159,13 @@ void registerOutputFormatNull(FormatFactory & factory);
 
 void registerInputFormatCapnProto(FormatFactory & factory);
 
+/// File segmentation engines for parallel parsing.
+
+void registerFileSegmentationEngineTabSeparated(FormatFactory & factory);
+void registerFileSegmentationEngineTSKV(FormatFactory & factory);
+void registerFileSegmentationEngineCSV(FormatFactory & factory);
+void registerFileSegmentationEngineJSONEachRow(FormatFactory & factory);
+
 
 FormatFactory::FormatFactory()
 {
@@ -146,8 +183,15 @@ FormatFactory::FormatFactory()
     registerOutputFormatTSKV(*this);
     registerInputFormatJSONEachRow(*this);
     registerOutputFormatJSONEachRow(*this);
+    registerInputFormatProtobuf(*this);
+    registerOutputFormatProtobuf(*this);
     registerInputFormatCapnProto(*this);
 
+    registerFileSegmentationEngineTabSeparated(*this);
+    registerFileSegmentationEngineTSKV(*this);
+    registerFileSegmentationEngineCSV(*this);
+    registerFileSegmentationEngineJSONEachRow(*this);
+
     registerOutputFormatPretty(*this);
     registerOutputFormatPrettyCompact(*this);
     registerOutputFormatPrettySpace(*this);
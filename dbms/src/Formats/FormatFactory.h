@@ -13,6 +13,7 @@ namespace DB
 class Block;
 class Context;
 struct FormatSettings;
+struct Memory;
 
 class ReadBuffer;
 class WriteBuffer;
@@ -29,6 +30,17 @@ using BlockOutputStreamPtr = std::shared_ptr<IBlockOutputStream>;
   */
 class FormatFactory final : public ext::singleton<FormatFactory>
 {
+public:
+    /** Reads a chunk of data from a buffer into 'memory', ending at a row boundary and at least
+      *  'min_chunk_size' bytes long if that much data is available. Returns false if the buffer is exhausted.
+      * Used to parse an input format in several threads; optional - formats where finding a row boundary
+      *  requires real parsing do not have one.
+      */
+    using FileSegmentationEngine = std::function<bool(
+        ReadBuffer & buf,
+        Memory & memory,
+        size_t min_chunk_size)>;
+
 private:
     using InputCreator = std::function<BlockInputStreamPtr(
         ReadBuffer & buf,
@@ -43,7 +55,12 @@ private:
         const Context & context,
         const FormatSettings & settings)>;
 
-    using Creators = std::pair<InputCreator, OutputCreator>;
+    struct Creators
+    {
+        InputCreator input_creator;
+        OutputCreator output_creator;
+        FileSegmentationEngine file_segmentation_engine;
+    };
 
     using FormatsDictionary = std::unordered_map<String, Creators>;
 
@@ -57,6 +74,7 @@ public:
     /// Register format by its name.
     void registerInputFormat(const String & name, InputCreator input_creator);
     void registerOutputFormat(const String & name, OutputCreator output_creator);
+    void registerFileSegmentationEngine(const String & name, FileSegmentationEngine file_segmentation_engine);
 
     const FormatsDictionary & getAllFormats() const
     {
@@ -0,0 +1,189 @@
+#include <Formats/ParallelParsingBlockInputStream.h>
+#include <IO/ReadBufferFromMemory.h>
+#include <Common/Exception.h>
+#include <Common/setThreadName.h>
+
+
+namespace DB
+{
+
+ParallelParsingBlockInputStream::ParallelParsingBlockInputStream(const Params & params)
+    : header(params.header)
+    , input_creator(params.input_creator)
+    , file_segmentation_engine(params.file_segmentation_engine)
+    , original_buffer(params.in)
+    , min_chunk_size(params.min_chunk_size)
+    /// Additional units allow the segmentator and the reader to work while all parsers are busy.
+    , processing_units(params.max_threads + 2)
+    , pool(params.max_threads)
+{
+    segmentator_thread = std::thread(&ParallelParsingBlockInputStream::segmentatorThreadFunction, this);
+}
+
+
+ParallelParsingBlockInputStream::~ParallelParsingBlockInputStream()
+{
+    finishAndWait();
+}
+
+
+void ParallelParsingBlockInputStream::cancel(bool kill)
+{
+    IProfilingBlockInputStream::cancel(kill);
+    finishAndWait();
+}
+
+
+void ParallelParsingBlockInputStream::finishAndWait()
+{
+    finished = true;
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        segmentator_condvar.notify_all();
+        reader_condvar.notify_all();
+    }
+
+    if (segmentator_thread.joinable())
+        segmentator_thread.join();
+
+    try
+    {
+        pool.wait();
+    }
+    catch (...)
+    {
+        tryLogCurrentException(__PRETTY_FUNCTION__);
+    }
+}
+
+
+void ParallelParsingBlockInputStream::segmentatorThreadFunction()
+{
+    setThreadName("Segmentator");
+
+    try
+    {
+        for (size_t segmentator_ticket_number = 0; !finished; ++segmentator_ticket_number)
+        {
+            const size_t current_unit_number = segmentator_ticket_number % processing_units.size();
+            auto & unit = processing_units[current_unit_number];
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                segmentator_condvar.wait(lock, [&] { return unit.status == READY_TO_INSERT || finished; });
+            }
+
+            if (finished)
+                break;
+
+            bool have_more_data = file_segmentation_engine(original_buffer, unit.segment, min_chunk_size);
+            unit.is_last = !have_more_data;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                unit.status = READY_TO_PARSE;
+            }
+
+            pool.schedule([this, current_unit_number] { parserThreadFunction(current_unit_number); });
+
+            if (!have_more_data)
+                break;
+        }
+    }
+    catch (...)
+    {
+        onBackgroundException();
+    }
+}
+
+
+void ParallelParsingBlockInputStream::parserThreadFunction(size_t unit_number)
+{
+    setThreadName("ChunkParser");
+
+    try
+    {
+        auto & unit = processing_units[unit_number];
+
+        /// A chunk is always a complete number of rows, so the parser sees it as a whole small file.
+        ReadBufferFromMemory read_buffer(unit.segment.data(), unit.segment.size());
+        BlockInputStreamPtr parser = input_creator(read_buffer);
+
+        unit.blocks.clear();
+        parser->readPrefix();
+        while (Block block = parser->read())
+            unit.blocks.emplace_back(std::move(block));
+        parser->readSuffix();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        unit.status = READY_TO_READ;
+        reader_condvar.notify_all();
+    }
+    catch (...)
+    {
+        onBackgroundException();
+    }
+}
+
+
+void ParallelParsingBlockInputStream::onBackgroundException()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!background_exception)
+        background_exception = std::current_exception();
+    finished = true;
+    reader_condvar.notify_all();
+    segmentator_condvar.notify_all();
+}
+
+
+Block ParallelParsingBlockInputStream::readImpl()
+{
+    if (isCancelledOrThrowIfKilled() || finished)
+    {
+        /** After the first exception or cancellation the units are in an inconsistent state,
+          *  so the stream cannot continue even if more data was parsed successfully.
+          */
+        std::unique_lock<std::mutex> lock(mutex);
+        if (background_exception)
+            std::rethrow_exception(background_exception);
+        return {};
+    }
+
+    while (true)
+    {
+        const size_t current_unit_number = reader_ticket_number % processing_units.size();
+        auto & unit = processing_units[current_unit_number];
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            reader_condvar.wait(lock, [&] { return unit.status == READY_TO_READ || background_exception; });
+
+            if (background_exception)
+            {
+                finished = true;
+                std::rethrow_exception(background_exception);
+            }
+        }
+
+        if (next_block_in_current_unit < unit.blocks.size())
+            return std::move(unit.blocks[next_block_in_current_unit++]);
+
+        if (unit.is_last)
+        {
+            finished = true;
+            return {};
+        }
+
+        /// The unit is consumed - pass it back to the segmentator and move to the next one.
+        next_block_in_current_unit = 0;
+        ++reader_ticket_number;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        unit.status = READY_TO_INSERT;
+        segmentator_condvar.notify_all();
+    }
+}
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <Common/ThreadPool.h>
+#include <Core/Block.h>
+#include <DataStreams/IProfilingBlockInputStream.h>
+#include <IO/BufferWithOwnMemory.h>
+#include <IO/ReadBuffer.h>
+
+
+namespace DB
+{
+
+/** Parses a row-based input format in several threads.
+  *
+  * A segmentating thread cuts the original ReadBuffer into chunks at row boundaries
+  *  (using a format-specific "file segmentation engine" registered in FormatFactory),
+  *  a pool of worker threads parses each chunk into blocks with an ordinary single-threaded
+  *  parser of the format, and readImpl returns the blocks in the original order.
+  *
+  * The number of chunks processed simultaneously is limited: the segmentator reuses
+  *  a fixed ring of processing units and waits until the reader has consumed a unit
+  *  before filling it again.
+  *
+  * An exception thrown in a background thread is rethrown from readImpl.
+  */
+class ParallelParsingBlockInputStream : public IProfilingBlockInputStream
+{
+public:
+    /// Reads a chunk of data from 'in' into 'memory', ending at a row boundary and at least
+    ///  'min_chunk_size' bytes long if that much data is available. Returns false if 'in' is exhausted.
+    using FileSegmentationEngine = std::function<bool(ReadBuffer & in, Memory & memory, size_t min_chunk_size)>;
+
+    /// Creates the ordinary parser of the format over the buffer with one chunk.
+    using InputCreator = std::function<BlockInputStreamPtr(ReadBuffer & in)>;
+
+    struct Params
+    {
+        ReadBuffer & in;
+        Block header;
+        InputCreator input_creator;
+        FileSegmentationEngine file_segmentation_engine;
+        size_t max_threads;
+        size_t min_chunk_size;
+    };
+
+    explicit ParallelParsingBlockInputStream(const Params & params);
+    ~ParallelParsingBlockInputStream() override;
+
+    String getName() const override { return "ParallelParsing"; }
+    Block getHeader() const override { return header; }
+
+    void cancel(bool kill) override;
+
+protected:
+    Block readImpl() override;
+
+private:
+    /// Each unit goes through the statuses in this order.
+    enum ProcessingUnitStatus
+    {
+        READY_TO_INSERT,    /// Can be filled by the segmentating thread.
+        READY_TO_PARSE,     /// Filled, is being parsed by a worker thread.
+        READY_TO_READ,      /// Parsed, the blocks can be returned from readImpl.
+    };
+
+    struct ProcessingUnit
+    {
+        Memory segment;
+        std::vector<Block> blocks;
+        ProcessingUnitStatus status = READY_TO_INSERT;
+        bool is_last = false;
+    };
+
+    Block header;
+    InputCreator input_creator;
+    FileSegmentationEngine file_segmentation_engine;
+    ReadBuffer & original_buffer;
+    const size_t min_chunk_size;
+
+    /// Guards the statuses of the units and 'background_exception'.
+    std::mutex mutex;
+    std::condition_variable reader_condvar;
+    std::condition_variable segmentator_condvar;
+
+    std::atomic<bool> finished{false};
+    std::exception_ptr background_exception;
+
+    std::vector<ProcessingUnit> processing_units;
+    size_t reader_ticket_number = 0;
+    size_t next_block_in_current_unit = 0;
+
+    ThreadPool pool;
+    std::thread segmentator_thread;
+
+    void segmentatorThreadFunction();
+    void parserThreadFunction(size_t unit_number);
+
+    /// Saves the first exception thrown in a background thread and wakes everyone up.
+    void onBackgroundException();
+
+    void finishAndWait();
+};
+
+}
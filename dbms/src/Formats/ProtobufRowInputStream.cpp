@@ -0,0 +1,345 @@
+#include <boost/algorithm/string.hpp>
+
+#include <Columns/ColumnString.h>
+#include <Columns/ColumnsNumber.h>
+#include <Common/escapeForFileName.h>
+#include <DataTypes/DataTypeString.h>
+#include <DataTypes/DataTypesNumber.h>
+#include <Formats/BlockInputStreamFromRowInputStream.h>
+#include <Formats/FormatFactory.h>
+#include <Formats/ProtobufRowInputStream.h>
+#include <IO/ReadBuffer.h>
+#include <IO/WriteHelpers.h>
+#include <Interpreters/Context.h>
+#include <common/unaligned.h>
+
+
+namespace DB
+{
+
+namespace ErrorCodes
+{
+    extern const int INCORRECT_DATA;
+    extern const int BAD_ARGUMENTS;
+    extern const int THERE_IS_NO_COLUMN;
+    extern const int TYPE_MISMATCH;
+}
+
+namespace
+{
+
+/// Unlike readVarUInt from IO/VarInt.h, protobuf varints can take up to 10 bytes for a 64-bit value.
+UInt64 readVarint(const char *& pos, const char * end)
+{
+    UInt64 res = 0;
+    for (size_t shift = 0; shift < 70; shift += 7)
+    {
+        if (pos == end)
+            throw Exception("Unexpected end of protobuf message while reading varint", ErrorCodes::INCORRECT_DATA);
+        UInt8 byte = *pos++;
+        res |= UInt64(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return res;
+    }
+    throw Exception("Malformed varint in protobuf message", ErrorCodes::INCORRECT_DATA);
+}
+
+Int64 zigZagDecode(UInt64 x)
+{
+    return static_cast<Int64>(x >> 1) ^ -static_cast<Int64>(x & 1);
+}
+
+UInt8 wireTypeOf(ProtobufFieldDescriptor::Type type)
+{
+    using Type = ProtobufFieldDescriptor::Type;
+    switch (type)
+    {
+        case Type::Double:
+        case Type::Fixed64:
+        case Type::SFixed64:
+            return 1;
+        case Type::Float:
+        case Type::Fixed32:
+        case Type::SFixed32:
+            return 5;
+        case Type::String:
+        case Type::Bytes:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+DataTypePtr dataTypeOf(ProtobufFieldDescriptor::Type type)
+{
+    using Type = ProtobufFieldDescriptor::Type;
+    switch (type)
+    {
+        case Type::Double:      return std::make_shared<DataTypeFloat64>();
+        case Type::Float:       return std::make_shared<DataTypeFloat32>();
+        case Type::Int32:
+        case Type::SInt32:
+        case Type::SFixed32:    return std::make_shared<DataTypeInt32>();
+        case Type::Int64:
+        case Type::SInt64:
+        case Type::SFixed64:    return std::make_shared<DataTypeInt64>();
+        case Type::UInt32:
+        case Type::Fixed32:     return std::make_shared<DataTypeUInt32>();
+        case Type::UInt64:
+        case Type::Fixed64:     return std::make_shared<DataTypeUInt64>();
+        case Type::Bool:        return std::make_shared<DataTypeUInt8>();
+        case Type::String:
+        case Type::Bytes:       return std::make_shared<DataTypeString>();
+    }
+    __builtin_unreachable();
+}
+
+void skipFieldValue(UInt8 wire_type, const char *& pos, const char * end)
+{
+    size_t fixed_size = 0;
+
+    switch (wire_type)
+    {
+        case 0:
+            readVarint(pos, end);
+            return;
+        case 1:
+            fixed_size = 8;
+            break;
+        case 5:
+            fixed_size = 4;
+            break;
+        case 2:
+            fixed_size = readVarint(pos, end);
+            break;
+        default:
+            throw Exception("Unsupported wire type " + toString(wire_type) + " in protobuf message (groups are not supported)",
+                ErrorCodes::INCORRECT_DATA);
+    }
+
+    if (static_cast<size_t>(end - pos) < fixed_size)
+        throw Exception("Unexpected end of protobuf message", ErrorCodes::INCORRECT_DATA);
+    pos += fixed_size;
+}
+
+}
+
+
+ProtobufRowInputStream::ProtobufRowInputStream(ReadBuffer & istr_, const Block & header_,
+    const String & schema_dir, const String & schema_file, const String & message_name)
+    : istr(istr_), header(header_)
+{
+    ProtobufMessageDescriptor schema = parseProtobufSchema(
+        schema_dir + escapeForFileName(schema_file) + ".proto", message_name);
+
+    size_t num_columns = header.columns();
+    column_is_read.resize(num_columns);
+
+    std::vector<bool> column_has_field(num_columns, false);
+
+    for (const auto & field : schema.fields)
+    {
+        if (!header.has(field.name))
+            continue;   /// The field will be skipped on reading.
+
+        size_t column_index = header.getPositionByName(field.name);
+        const ColumnWithTypeAndName & column = header.getByPosition(column_index);
+
+        DataTypePtr expected_type = dataTypeOf(field.type);
+        if (!column.type->equals(*expected_type))
+            throw Exception("Column " + column.name + " has type " + column.type->getName()
+                + ", but the protobuf field requires " + expected_type->getName(), ErrorCodes::TYPE_MISMATCH);
+
+        if (fields_by_tag.size() <= field.tag)
+            fields_by_tag.resize(field.tag + 1);
+        fields_by_tag[field.tag] = ColumnField{column_index, field.type};
+        column_has_field[column_index] = true;
+    }
+
+    for (size_t i = 0; i < num_columns; ++i)
+        if (!column_has_field[i])
+            throw Exception("Column " + header.getByPosition(i).name + " is not present in protobuf message "
+                + message_name, ErrorCodes::THERE_IS_NO_COLUMN);
+}
+
+
+void ProtobufRowInputStream::readValue(const ColumnField & field, IColumn & column, const char *& pos, const char * end)
+{
+    using Type = ProtobufFieldDescriptor::Type;
+
+    /// The column types are checked against the schema in the constructor, so static_cast is enough here.
+    switch (field.type)
+    {
+        case Type::Double:
+        {
+            if (end - pos < 8)
+                throw Exception("Unexpected end of protobuf message", ErrorCodes::INCORRECT_DATA);
+            static_cast<ColumnFloat64 &>(column).getData().push_back(unalignedLoad<Float64>(pos));
+            pos += 8;
+            break;
+        }
+        case Type::Float:
+        {
+            if (end - pos < 4)
+                throw Exception("Unexpected end of protobuf message", ErrorCodes::INCORRECT_DATA);
+            static_cast<ColumnFloat32 &>(column).getData().push_back(unalignedLoad<Float32>(pos));
+            pos += 4;
+            break;
+        }
+        case Type::Int32:
+            static_cast<ColumnInt32 &>(column).getData().push_back(static_cast<Int32>(readVarint(pos, end)));
+            break;
+        case Type::Int64:
+            static_cast<ColumnInt64 &>(column).getData().push_back(static_cast<Int64>(readVarint(pos, end)));
+            break;
+        case Type::UInt32:
+            static_cast<ColumnUInt32 &>(column).getData().push_back(static_cast<UInt32>(readVarint(pos, end)));
+            break;
+        case Type::UInt64:
+            static_cast<ColumnUInt64 &>(column).getData().push_back(readVarint(pos, end));
+            break;
+        case Type::SInt32:
+            static_cast<ColumnInt32 &>(column).getData().push_back(static_cast<Int32>(zigZagDecode(readVarint(pos, end))));
+            break;
+        case Type::SInt64:
+            static_cast<ColumnInt64 &>(column).getData().push_back(zigZagDecode(readVarint(pos, end)));
+            break;
+        case Type::Bool:
+            static_cast<ColumnUInt8 &>(column).getData().push_back(readVarint(pos, end) != 0);
+            break;
+        case Type::Fixed32:
+        {
+            if (end - pos < 4)
+                throw Exception("Unexpected end of protobuf message", ErrorCodes::INCORRECT_DATA);
+            static_cast<ColumnUInt32 &>(column).getData().push_back(unalignedLoad<UInt32>(pos));
+            pos += 4;
+            break;
+        }
+        case Type::Fixed64:
+        {
+            if (end - pos < 8)
+                throw Exception("Unexpected end of protobuf message", ErrorCodes::INCORRECT_DATA);
+            static_cast<ColumnUInt64 &>(column).getData().push_back(unalignedLoad<UInt64>(pos));
+            pos += 8;
+            break;
+        }
+        case Type::SFixed32:
+        {
+            if (end - pos < 4)
+                throw Exception("Unexpected end of protobuf message", ErrorCodes::INCORRECT_DATA);
+            static_cast<ColumnInt32 &>(column).getData().push_back(unalignedLoad<Int32>(pos));
+            pos += 4;
+            break;
+        }
+        case Type::SFixed64:
+        {
+            if (end - pos < 8)
+                throw Exception("Unexpected end of protobuf message", ErrorCodes::INCORRECT_DATA);
+            static_cast<ColumnInt64 &>(column).getData().push_back(unalignedLoad<Int64>(pos));
+            pos += 8;
+            break;
+        }
+        case Type::String:
+        case Type::Bytes:
+        {
+            size_t size = readVarint(pos, end);
+            if (static_cast<size_t>(end - pos) < size)
+                throw Exception("Unexpected end of protobuf message", ErrorCodes::INCORRECT_DATA);
+            static_cast<ColumnString &>(column).insertData(pos, size);
+            pos += size;
+            break;
+        }
+    }
+}
+
+
+bool ProtobufRowInputStream::read(MutableColumns & columns)
+{
+    if (istr.eof())
+        return false;
+
+    /// The length prefix, possibly crossing the buffer boundary.
+    UInt64 message_size = 0;
+    {
+        size_t shift = 0;
+        while (true)
+        {
+            if (istr.eof())
+                throw Exception("Unexpected end of stream while reading a protobuf message size", ErrorCodes::INCORRECT_DATA);
+            UInt8 byte = *istr.position();
+            ++istr.position();
+            message_size |= UInt64(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                break;
+            shift += 7;
+            if (shift >= 70)
+                throw Exception("Malformed protobuf message size", ErrorCodes::INCORRECT_DATA);
+        }
+    }
+
+    message.resize(message_size);
+    istr.readStrict(message.data(), message_size);
+
+    const char * pos = message.data();
+    const char * end = pos + message_size;
+
+    std::fill(column_is_read.begin(), column_is_read.end(), 0);
+
+    while (pos < end)
+    {
+        UInt64 key = readVarint(pos, end);
+        UInt64 tag = key >> 3;
+        UInt8 wire_type = key & 7;
+
+        const std::optional<ColumnField> * field = tag < fields_by_tag.size() ? &fields_by_tag[tag] : nullptr;
+        if (!field || !*field)
+        {
+            skipFieldValue(wire_type, pos, end);
+            continue;
+        }
+
+        if (wire_type != wireTypeOf((*field)->type))
+            throw Exception("Wire type of protobuf field with tag " + toString(tag) + " does not match the schema",
+                ErrorCodes::INCORRECT_DATA);
+
+        size_t column_index = (*field)->column_index;
+
+        /// For a singular field repeated in one message the last value wins.
+        if (column_is_read[column_index])
+            columns[column_index]->popBack(1);
+
+        readValue(**field, *columns[column_index], pos, end);
+        column_is_read[column_index] = 1;
+    }
+
+    for (size_t i = 0; i < columns.size(); ++i)
+        if (!column_is_read[i])
+            columns[i]->insertDefault();
+
+    return true;
+}
+
+
+void registerInputFormatProtobuf(FormatFactory & factory)
+{
+    factory.registerInputFormat("Protobuf", [](
+        ReadBuffer & buf,
+        const Block & sample,
+        const Context & context,
+        size_t max_block_size,
+        const FormatSettings & settings)
+    {
+        std::vector<String> tokens;
+        auto schema_and_message = context.getSettingsRef().format_schema.toString();
+        boost::split(tokens, schema_and_message, boost::is_any_of(":"));
+        if (tokens.size() != 2)
+            throw Exception("Format Protobuf requires 'format_schema' setting to have a schema_file:message_name format, e.g. 'schema.proto:Message'",
+                ErrorCodes::BAD_ARGUMENTS);
+
+        return std::make_shared<BlockInputStreamFromRowInputStream>(
+            std::make_shared<ProtobufRowInputStream>(buf, sample, context.getFormatSchemaPath(), tokens[0], tokens[1]),
+            sample, max_block_size, settings);
+    });
+}
+
+}
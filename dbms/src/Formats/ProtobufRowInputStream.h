@@ -0,0 +1,56 @@
+#pragma once
+
+#include <optional>
+#include <Core/Block.h>
+#include <Common/PODArray.h>
+#include <Formats/IRowInputStream.h>
+#include <Formats/ProtobufSchema.h>
+
+
+namespace DB
+{
+
+class ReadBuffer;
+
+/** A stream for reading a length-delimited sequence of protobuf messages:
+  *  each message is prefixed with its size as a varint, the framing produced by
+  *  writeDelimitedTo in the protobuf libraries and by the Protobuf output format.
+  *
+  * The schema comes from a .proto file; the 'format_schema' setting selects it
+  *  as 'schema_file:MessageName', like for CapnProto. Only singular scalar fields
+  *  are supported, see ProtobufSchema.h.
+  *
+  * The field tag to column dispatch table is built once per stream and the decoded
+  *  values are written directly into the columns. Fields of the message without a
+  *  corresponding column are skipped; columns whose field is absent from a message
+  *  get default values (which also covers proto3 writers that omit zero values).
+  */
+class ProtobufRowInputStream : public IRowInputStream
+{
+public:
+    ProtobufRowInputStream(ReadBuffer & istr_, const Block & header_,
+        const String & schema_dir, const String & schema_file, const String & message_name);
+
+    bool read(MutableColumns & columns) override;
+
+private:
+    struct ColumnField
+    {
+        size_t column_index;
+        ProtobufFieldDescriptor::Type type;
+    };
+
+    ReadBuffer & istr;
+    Block header;
+
+    /// Indexed by the field tag.
+    std::vector<std::optional<ColumnField>> fields_by_tag;
+
+    /// Reused between rows.
+    PODArray<char> message;
+    std::vector<UInt8> column_is_read;
+
+    void readValue(const ColumnField & field, IColumn & column, const char *& pos, const char * end);
+};
+
+}
@@ -0,0 +1,245 @@
+#include <boost/algorithm/string.hpp>
+
+#include <Columns/ColumnString.h>
+#include <Columns/ColumnsNumber.h>
+#include <Common/escapeForFileName.h>
+#include <DataTypes/DataTypeString.h>
+#include <DataTypes/DataTypesNumber.h>
+#include <Formats/BlockOutputStreamFromRowOutputStream.h>
+#include <Formats/FormatFactory.h>
+#include <Formats/ProtobufRowOutputStream.h>
+#include <IO/WriteBuffer.h>
+#include <Interpreters/Context.h>
+
+
+namespace DB
+{
+
+namespace ErrorCodes
+{
+    extern const int BAD_ARGUMENTS;
+    extern const int THERE_IS_NO_COLUMN;
+    extern const int TYPE_MISMATCH;
+}
+
+namespace
+{
+
+UInt64 zigZagEncode(Int64 x)
+{
+    return (static_cast<UInt64>(x) << 1) ^ static_cast<UInt64>(x >> 63);
+}
+
+void appendFixed(String & message, const void * data, size_t size)
+{
+    message.append(reinterpret_cast<const char *>(data), size);
+}
+
+}
+
+
+ProtobufRowOutputStream::ProtobufRowOutputStream(WriteBuffer & ostr_, const Block & header,
+    const String & schema_dir, const String & schema_file, const String & message_name)
+    : ostr(ostr_)
+{
+    ProtobufMessageDescriptor schema = parseProtobufSchema(
+        schema_dir + escapeForFileName(schema_file) + ".proto", message_name);
+
+    for (size_t i = 0, num_columns = header.columns(); i < num_columns; ++i)
+    {
+        const ColumnWithTypeAndName & column = header.getByPosition(i);
+
+        const ProtobufFieldDescriptor * found = nullptr;
+        for (const auto & field : schema.fields)
+            if (field.name == column.name)
+            {
+                found = &field;
+                break;
+            }
+
+        if (!found)
+            throw Exception("Column " + column.name + " is not present in protobuf message " + message_name,
+                ErrorCodes::THERE_IS_NO_COLUMN);
+
+        /// The same correspondence of types as on reading.
+        String expected_type;
+        using Type = ProtobufFieldDescriptor::Type;
+        switch (found->type)
+        {
+            case Type::Double:      expected_type = "Float64"; break;
+            case Type::Float:       expected_type = "Float32"; break;
+            case Type::Int32:
+            case Type::SInt32:
+            case Type::SFixed32:    expected_type = "Int32"; break;
+            case Type::Int64:
+            case Type::SInt64:
+            case Type::SFixed64:    expected_type = "Int64"; break;
+            case Type::UInt32:
+            case Type::Fixed32:     expected_type = "UInt32"; break;
+            case Type::UInt64:
+            case Type::Fixed64:     expected_type = "UInt64"; break;
+            case Type::Bool:        expected_type = "UInt8"; break;
+            case Type::String:
+            case Type::Bytes:       expected_type = "String"; break;
+        }
+
+        if (column.type->getName() != expected_type)
+            throw Exception("Column " + column.name + " has type " + column.type->getName()
+                + ", but the protobuf field requires " + expected_type, ErrorCodes::TYPE_MISMATCH);
+
+        column_fields.emplace_back(*found);
+    }
+}
+
+
+void ProtobufRowOutputStream::appendVarint(UInt64 x)
+{
+    while (x >= 0x80)
+    {
+        message.push_back(static_cast<char>(x | 0x80));
+        x >>= 7;
+    }
+    message.push_back(static_cast<char>(x));
+}
+
+
+void ProtobufRowOutputStream::writeRowStartDelimiter()
+{
+    message.clear();
+    field_index = 0;
+}
+
+
+void ProtobufRowOutputStream::writeField(const IColumn & column, const IDataType &, size_t row_num)
+{
+    using Type = ProtobufFieldDescriptor::Type;
+
+    const ProtobufFieldDescriptor & field = column_fields[field_index];
+    ++field_index;
+
+    UInt8 wire_type = 0;
+    switch (field.type)
+    {
+        case Type::Double: case Type::Fixed64: case Type::SFixed64: wire_type = 1; break;
+        case Type::Float: case Type::Fixed32: case Type::SFixed32: wire_type = 5; break;
+        case Type::String: case Type::Bytes: wire_type = 2; break;
+        default: wire_type = 0;
+    }
+
+    appendVarint((UInt64(field.tag) << 3) | wire_type);
+
+    /// The column types are checked against the schema in the constructor.
+    switch (field.type)
+    {
+        case Type::Double:
+        {
+            Float64 x = static_cast<const ColumnFloat64 &>(column).getData()[row_num];
+            appendFixed(message, &x, sizeof(x));
+            break;
+        }
+        case Type::Float:
+        {
+            Float32 x = static_cast<const ColumnFloat32 &>(column).getData()[row_num];
+            appendFixed(message, &x, sizeof(x));
+            break;
+        }
+        case Type::Int32:
+            appendVarint(static_cast<UInt64>(static_cast<Int64>(static_cast<const ColumnInt32 &>(column).getData()[row_num])));
+            break;
+        case Type::Int64:
+            appendVarint(static_cast<UInt64>(static_cast<const ColumnInt64 &>(column).getData()[row_num]));
+            break;
+        case Type::UInt32:
+            appendVarint(static_cast<const ColumnUInt32 &>(column).getData()[row_num]);
+            break;
+        case Type::UInt64:
+            appendVarint(static_cast<const ColumnUInt64 &>(column).getData()[row_num]);
+            break;
+        case Type::SInt32:
+            appendVarint(zigZagEncode(static_cast<const ColumnInt32 &>(column).getData()[row_num]));
+            break;
+        case Type::SInt64:
+            appendVarint(zigZagEncode(static_cast<const ColumnInt64 &>(column).getData()[row_num]));
+            break;
+        case Type::Bool:
+            appendVarint(static_cast<const ColumnUInt8 &>(column).getData()[row_num] ? 1 : 0);
+            break;
+        case Type::Fixed32:
+        {
+            UInt32 x = static_cast<const ColumnUInt32 &>(column).getData()[row_num];
+            appendFixed(message, &x, sizeof(x));
+            break;
+        }
+        case Type::Fixed64:
+        {
+            UInt64 x = static_cast<const ColumnUInt64 &>(column).getData()[row_num];
+            appendFixed(message, &x, sizeof(x));
+            break;
+        }
+        case Type::SFixed32:
+        {
+            Int32 x = static_cast<const ColumnInt32 &>(column).getData()[row_num];
+            appendFixed(message, &x, sizeof(x));
+            break;
+        }
+        case Type::SFixed64:
+        {
+            Int64 x = static_cast<const ColumnInt64 &>(column).getData()[row_num];
+            appendFixed(message, &x, sizeof(x));
+            break;
+        }
+        case Type::String:
+        case Type::Bytes:
+        {
+            StringRef value = static_cast<const ColumnString &>(column).getDataAt(row_num);
+            appendVarint(value.size);
+            message.append(value.data, value.size);
+            break;
+        }
+    }
+}
+
+
+void ProtobufRowOutputStream::writeRowEndDelimiter()
+{
+    /// The varint length prefix before the message, as written by writeDelimitedTo.
+    UInt64 x = message.size();
+    while (x >= 0x80)
+    {
+        ostr.write(static_cast<char>(x | 0x80));
+        x >>= 7;
+    }
+    ostr.write(static_cast<char>(x));
+
+    ostr.write(message.data(), message.size());
+}
+
+
+void ProtobufRowOutputStream::flush()
+{
+    ostr.next();
+}
+
+
+void registerOutputFormatProtobuf(FormatFactory & factory)
+{
+    factory.registerOutputFormat("Protobuf", [](
+        WriteBuffer & buf,
+        const Block & sample,
+        const Context & context,
+        const FormatSettings &)
+    {
+        std::vector<String> tokens;
+        auto schema_and_message = context.getSettingsRef().format_schema.toString();
+        boost::split(tokens, schema_and_message, boost::is_any_of(":"));
+        if (tokens.size() != 2)
+            throw Exception("Format Protobuf requires 'format_schema' setting to have a schema_file:message_name format, e.g. 'schema.proto:Message'",
+                ErrorCodes::BAD_ARGUMENTS);
+
+        return std::make_shared<BlockOutputStreamFromRowOutputStream>(
+            std::make_shared<ProtobufRowOutputStream>(buf, sample, context.getFormatSchemaPath(), tokens[0], tokens[1]),
+            sample);
+    });
+}
+
+}
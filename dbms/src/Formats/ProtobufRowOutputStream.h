@@ -0,0 +1,43 @@
+#pragma once
+
+#include <Core/Block.h>
+#include <Formats/IRowOutputStream.h>
+#include <Formats/ProtobufSchema.h>
+
+
+namespace DB
+{
+
+class WriteBuffer;
+
+/** A stream for writing blocks as a length-delimited sequence of protobuf messages,
+  *  the counterpart of ProtobufRowInputStream (see the restrictions there).
+  * Every column must have a field in the message; fields without a column are left out,
+  *  which a reader sees as default values. All present fields are written explicitly,
+  *  including zeros.
+  */
+class ProtobufRowOutputStream : public IRowOutputStream
+{
+public:
+    ProtobufRowOutputStream(WriteBuffer & ostr_, const Block & header,
+        const String & schema_dir, const String & schema_file, const String & message_name);
+
+    void writeField(const IColumn & column, const IDataType & type, size_t row_num) override;
+    void writeRowStartDelimiter() override;
+    void writeRowEndDelimiter() override;
+    void flush() override;
+
+private:
+    WriteBuffer & ostr;
+
+    /// The field for each column of the header, in header order.
+    std::vector<ProtobufFieldDescriptor> column_fields;
+    size_t field_index = 0;
+
+    /// A row is accumulated here to learn its size for the length prefix.
+    String message;
+
+    void appendVarint(UInt64 x);
+};
+
+}
@@ -0,0 +1,261 @@
+#include <Formats/ProtobufSchema.h>
+#include <IO/ReadBufferFromFile.h>
+#include <IO/ReadHelpers.h>
+#include <Common/Exception.h>
+#include <Common/StringUtils/StringUtils.h>
+
+#include <unordered_set>
+
+
+namespace DB
+{
+
+namespace ErrorCodes
+{
+    extern const int CANNOT_PARSE_PROTOBUF_SCHEMA;
+}
+
+namespace
+{
+
+/// Identifiers (including dotted ones), numbers and string literals are single tokens,
+///  any other non-space character is a token by itself. Comments are skipped.
+std::vector<String> tokenizeProtoFile(const String & s, const String & schema_path)
+{
+    std::vector<String> tokens;
+    size_t i = 0;
+    size_t size = s.size();
+
+    while (i < size)
+    {
+        char c = s[i];
+
+        if (isWhitespaceASCII(c))
+        {
+            ++i;
+        }
+        else if (c == '/' && i + 1 < size && s[i + 1] == '/')
+        {
+            while (i < size && s[i] != '\n')
+                ++i;
+        }
+        else if (c == '/' && i + 1 < size && s[i + 1] == '*')
+        {
+            size_t closing = s.find("*/", i + 2);
+            if (closing == String::npos)
+                throw Exception("Unterminated comment in protobuf schema " + schema_path, ErrorCodes::CANNOT_PARSE_PROTOBUF_SCHEMA);
+            i = closing + 2;
+        }
+        else if (isAlphaNumericASCII(c) || c == '_' || c == '.')
+        {
+            size_t begin = i;
+            while (i < size && (isAlphaNumericASCII(s[i]) || s[i] == '_' || s[i] == '.'))
+                ++i;
+            tokens.emplace_back(s.substr(begin, i - begin));
+        }
+        else if (c == '"' || c == '\'')
+        {
+            size_t closing = s.find(c, i + 1);
+            if (closing == String::npos)
+                throw Exception("Unterminated string literal in protobuf schema " + schema_path, ErrorCodes::CANNOT_PARSE_PROTOBUF_SCHEMA);
+            tokens.emplace_back(s.substr(i, closing + 1 - i));
+            i = closing + 1;
+        }
+        else
+        {
+            tokens.emplace_back(1, c);
+            ++i;
+        }
+    }
+
+    return tokens;
+}
+
+
+class TokenStream
+{
+public:
+    TokenStream(std::vector<String> tokens_, const String & schema_path_)
+        : tokens(std::move(tokens_)), schema_path(schema_path_) {}
+
+    bool eof() const { return pos >= tokens.size(); }
+
+    const String & next()
+    {
+        if (eof())
+            throw Exception("Unexpected end of protobuf schema " + schema_path, ErrorCodes::CANNOT_PARSE_PROTOBUF_SCHEMA);
+        return tokens[pos++];
+    }
+
+    void expect(const String & token)
+    {
+        const String & got = next();
+        if (got != token)
+            throw Exception("Expected '" + token + "', got '" + got + "' in protobuf schema " + schema_path,
+                ErrorCodes::CANNOT_PARSE_PROTOBUF_SCHEMA);
+    }
+
+    void skipUntil(const String & token)
+    {
+        while (next() != token)
+            ;
+    }
+
+    void skipBalanced()
+    {
+        expect("{");
+        size_t depth = 1;
+        while (depth)
+        {
+            const String & token = next();
+            if (token == "{")
+                ++depth;
+            else if (token == "}")
+                --depth;
+        }
+    }
+
+private:
+    std::vector<String> tokens;
+    String schema_path;
+    size_t pos = 0;
+};
+
+
+bool scalarTypeFromString(const String & s, ProtobufFieldDescriptor::Type & type)
+{
+    if (s == "double")          type = ProtobufFieldDescriptor::Type::Double;
+    else if (s == "float")      type = ProtobufFieldDescriptor::Type::Float;
+    else if (s == "int32")      type = ProtobufFieldDescriptor::Type::Int32;
+    else if (s == "int64")      type = ProtobufFieldDescriptor::Type::Int64;
+    else if (s == "uint32")     type = ProtobufFieldDescriptor::Type::UInt32;
+    else if (s == "uint64")     type = ProtobufFieldDescriptor::Type::UInt64;
+    else if (s == "sint32")     type = ProtobufFieldDescriptor::Type::SInt32;
+    else if (s == "sint64")     type = ProtobufFieldDescriptor::Type::SInt64;
+    else if (s == "fixed32")    type = ProtobufFieldDescriptor::Type::Fixed32;
+    else if (s == "fixed64")    type = ProtobufFieldDescriptor::Type::Fixed64;
+    else if (s == "sfixed32")   type = ProtobufFieldDescriptor::Type::SFixed32;
+    else if (s == "sfixed64")   type = ProtobufFieldDescriptor::Type::SFixed64;
+    else if (s == "bool")       type = ProtobufFieldDescriptor::Type::Bool;
+    else if (s == "string")     type = ProtobufFieldDescriptor::Type::String;
+    else if (s == "bytes")      type = ProtobufFieldDescriptor::Type::Bytes;
+    else
+        return false;
+    return true;
+}
+
+
+ProtobufMessageDescriptor parseMessageBody(TokenStream & stream, const String & message_name, const String & schema_path)
+{
+    ProtobufMessageDescriptor message;
+    message.name = message_name;
+
+    std::unordered_set<UInt32> seen_tags;
+
+    while (true)
+    {
+        String token = stream.next();
+
+        if (token == "}")
+            break;
+
+        if (token == "option" || token == "reserved")
+        {
+            stream.skipUntil(";");
+            continue;
+        }
+
+        if (token == ";")
+            continue;
+
+        if (token == "repeated" || token == "oneof" || token == "map"
+            || token == "message" || token == "enum" || token == "extensions" || token == "group")
+            throw Exception("Protobuf schema " + schema_path + ": '" + token + "' in message " + message_name
+                + " is not supported (only singular scalar fields are)", ErrorCodes::CANNOT_PARSE_PROTOBUF_SCHEMA);
+
+        /// proto2 labels before the type.
+        if (token == "optional" || token == "required")
+            token = stream.next();
+
+        ProtobufFieldDescriptor field;
+        if (!scalarTypeFromString(token, field.type))
+            throw Exception("Protobuf schema " + schema_path + ": field type '" + token + "' in message " + message_name
+                + " is not supported (only scalar types are)", ErrorCodes::CANNOT_PARSE_PROTOBUF_SCHEMA);
+
+        field.name = stream.next();
+        stream.expect("=");
+
+        const String & tag_str = stream.next();
+        UInt64 tag = 0;
+        for (char c : tag_str)
+        {
+            if (!isNumericASCII(c))
+                throw Exception("Protobuf schema " + schema_path + ": invalid tag '" + tag_str + "' of field "
+                    + field.name, ErrorCodes::CANNOT_PARSE_PROTOBUF_SCHEMA);
+            tag = tag * 10 + (c - '0');
+        }
+        if (tag == 0 || tag > 536870911)    /// 2^29 - 1, the protobuf limit.
+            throw Exception("Protobuf schema " + schema_path + ": tag of field " + field.name + " is out of range",
+                ErrorCodes::CANNOT_PARSE_PROTOBUF_SCHEMA);
+        if (!seen_tags.insert(tag).second)
+            throw Exception("Protobuf schema " + schema_path + ": duplicate tag " + tag_str + " in message " + message_name,
+                ErrorCodes::CANNOT_PARSE_PROTOBUF_SCHEMA);
+        field.tag = tag;
+
+        /// The rest of the statement: field options like [default = 1, deprecated = true].
+        stream.skipUntil(";");
+
+        message.fields.emplace_back(std::move(field));
+    }
+
+    return message;
+}
+
+}
+
+
+ProtobufMessageDescriptor parseProtobufSchema(const String & schema_path, const String & message_name)
+{
+    String content;
+    {
+        ReadBufferFromFile in(schema_path);
+        readStringUntilEOF(content, in);
+    }
+
+    TokenStream stream(tokenizeProtoFile(content, schema_path), schema_path);
+
+    while (!stream.eof())
+    {
+        const String & token = stream.next();
+
+        if (token == "message")
+        {
+            const String & name = stream.next();
+            if (name == message_name)
+            {
+                stream.expect("{");
+                return parseMessageBody(stream, message_name, schema_path);
+            }
+            stream.skipBalanced();
+        }
+        else if (token == "syntax" || token == "package" || token == "option" || token == "import")
+        {
+            stream.skipUntil(";");
+        }
+        else if (token == "enum")
+        {
+            stream.next();
+            stream.skipBalanced();
+        }
+        else if (token != ";")
+        {
+            throw Exception("Unexpected '" + token + "' at the top level of protobuf schema " + schema_path,
+                ErrorCodes::CANNOT_PARSE_PROTOBUF_SCHEMA);
+        }
+    }
+
+    throw Exception("There is no message " + message_name + " in protobuf schema " + schema_path,
+        ErrorCodes::CANNOT_PARSE_PROTOBUF_SCHEMA);
+}
+
+}
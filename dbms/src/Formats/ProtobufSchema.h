@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include <Core/Types.h>
+
+
+namespace DB
+{
+
+/** A minimal description of a protobuf message, parsed from a .proto file.
+  * Only messages consisting of singular scalar fields are representable:
+  *  that is enough to map a message to a block row, and it keeps the format
+  *  independent of the protobuf library, which is not vendored here.
+  */
+struct ProtobufFieldDescriptor
+{
+    enum class Type
+    {
+        Double,
+        Float,
+        Int32,      /// also sfixed32 after reading
+        Int64,
+        UInt32,
+        UInt64,
+        SInt32,
+        SInt64,
+        Fixed32,
+        Fixed64,
+        SFixed32,
+        SFixed64,
+        Bool,
+        String,
+        Bytes,
+    };
+
+    String name;
+    UInt32 tag;
+    Type type;
+};
+
+struct ProtobufMessageDescriptor
+{
+    String name;
+    std::vector<ProtobufFieldDescriptor> fields;
+};
+
+/** Extracts the descriptor of 'message_name' from the .proto file at 'schema_path'.
+  * Understands proto2 and proto3 syntax; 'repeated', 'oneof', 'map' and fields of message
+  *  or enum types are rejected with an exception. Other messages in the file are ignored.
+  */
+ProtobufMessageDescriptor parseProtobufSchema(const String & schema_path, const String & message_name);
+
+}
@@ -18,6 +18,7 @@
 #include <Common/Arena.h>
 #include <Functions/intDiv.h>
 #include <Functions/castTypeToEither.h>
+#include <Functions/TargetSpecific.h>
 #include <Common/config.h>
 
 #if USE_EMBEDDED_COMPILER
@@ -48,6 +49,32 @@ namespace ErrorCodes
   * Etc.
   */
 
+DECLARE_MULTITARGET_CODE(
+
+template <typename A, typename B, typename Op, typename ResultType>
+struct BinaryOperationLoops
+{
+    static void vectorVector(const A * __restrict a, const B * __restrict b, ResultType * __restrict c, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+            c[i] = Op::template apply<ResultType>(a[i], b[i]);
+    }
+
+    static void vectorConstant(const A * __restrict a, B b, ResultType * __restrict c, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+            c[i] = Op::template apply<ResultType>(a[i], b);
+    }
+
+    static void constantVector(A a, const B * __restrict b, ResultType * __restrict c, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+            c[i] = Op::template apply<ResultType>(a, b[i]);
+    }
+};
+
+)
+
 template <typename A, typename B, typename Op, typename ResultType_ = typename Op::ResultType>
 struct BinaryOperationImplBase
 {
@@ -56,22 +83,40 @@ struct BinaryOperationImplBase
     static void NO_INLINE vector_vector(const PaddedPODArray<A> & a, const PaddedPODArray<B> & b, PaddedPODArray<ResultType> & c)
     {
         size_t size = a.size();
-        for (size_t i = 0; i < size; ++i)
-            c[i] = Op::template apply<ResultType>(a[i], b[i]);
+#if USE_MULTITARGET_CODE
+        if (selectedAVX512())
+            return TargetSpecific::AVX512::BinaryOperationLoops<A, B, Op, ResultType>::vectorVector(a.data(), b.data(), c.data(), size);
+        if (selectedAVX2())
+            return TargetSpecific::AVX2::BinaryOperationLoops<A, B, Op, ResultType>::vectorVector(a.data(), b.data(), c.data(), size);
+#endif
+        selectedDefault();
+        TargetSpecific::Default::BinaryOperationLoops<A, B, Op, ResultType>::vectorVector(a.data(), b.data(), c.data(), size);
     }
 
     static void NO_INLINE vector_constant(const PaddedPODArray<A> & a, B b, PaddedPODArray<ResultType> & c)
     {
         size_t size = a.size();
-        for (size_t i = 0; i < size; ++i)
-            c[i] = Op::template apply<ResultType>(a[i], b);
+#if USE_MULTITARGET_CODE
+        if (selectedAVX512())
+            return TargetSpecific::AVX512::BinaryOperationLoops<A, B, Op, ResultType>::vectorConstant(a.data(), b, c.data(), size);
+        if (selectedAVX2())
+            return TargetSpecific::AVX2::BinaryOperationLoops<A, B, Op, ResultType>::vectorConstant(a.data(), b, c.data(), size);
+#endif
+        selectedDefault();
+        TargetSpecific::Default::BinaryOperationLoops<A, B, Op, ResultType>::vectorConstant(a.data(), b, c.data(), size);
     }
 
     static void NO_INLINE constant_vector(A a, const PaddedPODArray<B> & b, PaddedPODArray<ResultType> & c)
     {
         size_t size = b.size();
-        for (size_t i = 0; i < size; ++i)
-            c[i] = Op::template apply<ResultType>(a, b[i]);
+#if USE_MULTITARGET_CODE
+        if (selectedAVX512())
+            return TargetSpecific::AVX512::BinaryOperationLoops<A, B, Op, ResultType>::constantVector(a, b.data(), c.data(), size);
+        if (selectedAVX2())
+            return TargetSpecific::AVX2::BinaryOperationLoops<A, B, Op, ResultType>::constantVector(a, b.data(), c.data(), size);
+#endif
+        selectedDefault();
+        TargetSpecific::Default::BinaryOperationLoops<A, B, Op, ResultType>::constantVector(a, b.data(), c.data(), size);
     }
 
     static ResultType constant_constant(A a, B b)
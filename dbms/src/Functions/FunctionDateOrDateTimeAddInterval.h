@@ -11,6 +11,10 @@
 
 #include <IO/WriteHelpers.h>
 
+#if USE_EMBEDDED_COMPILER
+#include <DataTypes/Native.h>
+#endif
+
 
 namespace DB
 {
@@ -25,6 +29,11 @@ namespace ErrorCodes
 
 struct AddSecondsImpl
 {
+    /// Shift size in seconds for a DateTime source and in days for a Date source;
+    ///  zero means the shift goes through the time zone LUT and cannot be compiled.
+    static constexpr Int64 fixed_step_date_time = 1;
+    static constexpr Int64 fixed_step_date = 0;
+
     static constexpr auto name = "addSeconds";
 
     static inline UInt32 execute(UInt32 t, Int64 delta, const DateLUTImpl &)
@@ -40,6 +49,9 @@ struct AddSecondsImpl
 
 struct AddMinutesImpl
 {
+    static constexpr Int64 fixed_step_date_time = 60;
+    static constexpr Int64 fixed_step_date = 0;
+
     static constexpr auto name = "addMinutes";
 
     static inline UInt32 execute(UInt32 t, Int64 delta, const DateLUTImpl &)
@@ -55,6 +67,9 @@ struct AddMinutesImpl
 
 struct AddHoursImpl
 {
+    static constexpr Int64 fixed_step_date_time = 3600;
+    static constexpr Int64 fixed_step_date = 0;
+
     static constexpr auto name = "addHours";
 
     static inline UInt32 execute(UInt32 t, Int64 delta, const DateLUTImpl &)
@@ -70,6 +85,9 @@ struct AddHoursImpl
 
 struct AddDaysImpl
 {
+    static constexpr Int64 fixed_step_date_time = 0;
+    static constexpr Int64 fixed_step_date = 1;
+
     static constexpr auto name = "addDays";
 
     static inline UInt32 execute(UInt32 t, Int64 delta, const DateLUTImpl & time_zone)
@@ -85,6 +103,9 @@ struct AddDaysImpl
 
 struct AddWeeksImpl
 {
+    static constexpr Int64 fixed_step_date_time = 0;
+    static constexpr Int64 fixed_step_date = 7;
+
     static constexpr auto name = "addWeeks";
 
     static inline UInt32 execute(UInt32 t, Int64 delta, const DateLUTImpl & time_zone)
@@ -100,6 +121,9 @@ struct AddWeeksImpl
 
 struct AddMonthsImpl
 {
+    static constexpr Int64 fixed_step_date_time = 0;
+    static constexpr Int64 fixed_step_date = 0;
+
     static constexpr auto name = "addMonths";
 
     static inline UInt32 execute(UInt32 t, Int64 delta, const DateLUTImpl & time_zone)
@@ -115,6 +139,9 @@ struct AddMonthsImpl
 
 struct AddYearsImpl
 {
+    static constexpr Int64 fixed_step_date_time = 0;
+    static constexpr Int64 fixed_step_date = 0;
+
     static constexpr auto name = "addYears";
 
     static inline UInt32 execute(UInt32 t, Int64 delta, const DateLUTImpl & time_zone)
@@ -132,6 +159,9 @@ struct AddYearsImpl
 template <typename Transform>
 struct SubtractIntervalImpl
 {
+    static constexpr Int64 fixed_step_date_time = -Transform::fixed_step_date_time;
+    static constexpr Int64 fixed_step_date = -Transform::fixed_step_date;
+
     static inline UInt32 execute(UInt32 t, Int64 delta, const DateLUTImpl & time_zone)
     {
         return Transform::execute(t, -delta, time_zone);
@@ -302,6 +332,32 @@ public:
             throw Exception("Illegal type " + block.getByPosition(arguments[0]).type->getName() + " of argument of function " + getName(),
                 ErrorCodes::ILLEGAL_TYPE_OF_ARGUMENT);
     }
+
+#if USE_EMBEDDED_COMPILER
+    bool isCompilableImpl(const DataTypes & arguments) const override
+    {
+        /// Only shifts that are a fixed number of result-type units: calls into the time zone LUT
+        ///  cannot be inlined into generated code, and a float delta needs rounding through the LUT path.
+        if (arguments.size() != 2 || !isInteger(arguments[1]) || !isCompilableType(arguments[1]))
+            return false;
+        if (WhichDataType(arguments[0]).isDate())
+            return Transform::fixed_step_date != 0;
+        if (WhichDataType(arguments[0]).isDateTime())
+            return Transform::fixed_step_date_time != 0;
+        return false;
+    }
+
+    llvm::Value * compileImpl(llvm::IRBuilderBase & builder, const DataTypes & types, ValuePlaceholders values) const override
+    {
+        auto & b = static_cast<llvm::IRBuilder<> &>(builder);
+        bool is_date = WhichDataType(types[0]).isDate();
+        Int64 step = is_date ? Transform::fixed_step_date : Transform::fixed_step_date_time;
+        auto * source = nativeCast(b, types[0], values[0](), b.getInt64Ty());
+        auto * delta = nativeCast(b, types[1], values[1](), b.getInt64Ty());
+        auto * shifted = b.CreateAdd(source, b.CreateMul(delta, b.getInt64(step)));
+        return b.CreateTrunc(shifted, is_date ? b.getInt16Ty() : static_cast<llvm::Type *>(b.getInt32Ty()));
+    }
+#endif
 };
 
 }
@@ -24,6 +24,7 @@
 #include <Functions/FunctionsLogical.h>
 #include <Functions/IFunction.h>
 #include <Functions/FunctionHelpers.h>
+#include <Functions/TargetSpecific.h>
 
 #include <Core/AccurateComparison.h>
 #include <Core/DecimalComparison.h>
@@ -63,21 +64,18 @@ namespace ErrorCodes
   */
 
 
+DECLARE_MULTITARGET_CODE(
+
 template <typename A, typename B, typename Op>
-struct NumComparisonImpl
+struct NumComparisonLoops
 {
-    /// If you don't specify NO_INLINE, the compiler will inline this function, but we don't need this as this function contains tight loop inside.
-    static void NO_INLINE vector_vector(const PaddedPODArray<A> & a, const PaddedPODArray<B> & b, PaddedPODArray<UInt8> & c)
+    static void vectorVector(const A * __restrict a_pos, const B * __restrict b_pos, UInt8 * __restrict c_pos, size_t size)
     {
         /** GCC 4.8.2 vectorizes a loop only if it is written in this form.
           * In this case, if you loop through the array index (the code will look simpler),
           *  the loop will not be vectorized.
           */
 
-        size_t size = a.size();
-        const A * a_pos = a.data();
-        const B * b_pos = b.data();
-        UInt8 * c_pos = c.data();
         const A * a_end = a_pos + size;
 
         while (a_pos < a_end)
@@ -89,11 +87,8 @@ struct NumComparisonImpl
         }
     }
 
-    static void NO_INLINE vector_constant(const PaddedPODArray<A> & a, B b, PaddedPODArray<UInt8> & c)
+    static void vectorConstant(const A * __restrict a_pos, B b, UInt8 * __restrict c_pos, size_t size)
     {
-        size_t size = a.size();
-        const A * a_pos = a.data();
-        UInt8 * c_pos = c.data();
         const A * a_end = a_pos + size;
 
         while (a_pos < a_end)
@@ -103,6 +98,39 @@ struct NumComparisonImpl
             ++c_pos;
         }
     }
+};
+
+)
+
+template <typename A, typename B, typename Op>
+struct NumComparisonImpl
+{
+    /// If you don't specify NO_INLINE, the compiler will inline this function, but we don't need this as this function contains tight loop inside.
+    static void NO_INLINE vector_vector(const PaddedPODArray<A> & a, const PaddedPODArray<B> & b, PaddedPODArray<UInt8> & c)
+    {
+        size_t size = a.size();
+#if USE_MULTITARGET_CODE
+        if (selectedAVX512())
+            return TargetSpecific::AVX512::NumComparisonLoops<A, B, Op>::vectorVector(a.data(), b.data(), c.data(), size);
+        if (selectedAVX2())
+            return TargetSpecific::AVX2::NumComparisonLoops<A, B, Op>::vectorVector(a.data(), b.data(), c.data(), size);
+#endif
+        selectedDefault();
+        TargetSpecific::Default::NumComparisonLoops<A, B, Op>::vectorVector(a.data(), b.data(), c.data(), size);
+    }
+
+    static void NO_INLINE vector_constant(const PaddedPODArray<A> & a, B b, PaddedPODArray<UInt8> & c)
+    {
+        size_t size = a.size();
+#if USE_MULTITARGET_CODE
+        if (selectedAVX512())
+            return TargetSpecific::AVX512::NumComparisonLoops<A, B, Op>::vectorConstant(a.data(), b, c.data(), size);
+        if (selectedAVX2())
+            return TargetSpecific::AVX2::NumComparisonLoops<A, B, Op>::vectorConstant(a.data(), b, c.data(), size);
+#endif
+        selectedDefault();
+        TargetSpecific::Default::NumComparisonLoops<A, B, Op>::vectorConstant(a.data(), b, c.data(), size);
+    }
 
     static void constant_vector(A a, const PaddedPODArray<B> & b, PaddedPODArray<UInt8> & c)
     {
@@ -24,6 +24,7 @@
 
 #include <Dictionaries/FlatDictionary.h>
 #include <Dictionaries/HashedDictionary.h>
+#include <Dictionaries/HashedArrayDictionary.h>
 #include <Dictionaries/CacheDictionary.h>
 #include <Dictionaries/ComplexKeyHashedDictionary.h>
 #include <Dictionaries/ComplexKeyCacheDictionary.h>
@@ -288,6 +289,7 @@ private:
 
         if (!executeDispatch<FlatDictionary>(block, arguments, result, dict_ptr) &&
             !executeDispatch<HashedDictionary>(block, arguments, result, dict_ptr) &&
+            !executeDispatch<HashedArrayDictionary>(block, arguments, result, dict_ptr) &&
             !executeDispatch<CacheDictionary>(block, arguments, result, dict_ptr) &&
             !executeDispatchComplex<ComplexKeyHashedDictionary>(block, arguments, result, dict_ptr) &&
             !executeDispatchComplex<ComplexKeyCacheDictionary>(block, arguments, result, dict_ptr) &&
@@ -318,6 +320,7 @@ private:
         if (const auto id_col = checkAndGetColumn<ColumnUInt64>(id_col_untyped))
         {
             auto out = ColumnString::create();
+            out->reserve(id_col->size());
             dict->getString(attr_name, id_col->getData(), out.get());
             block.getByPosition(result).column = std::move(out);
         }
@@ -358,6 +361,7 @@ private:
             const auto & key_types = static_cast<const DataTypeTuple &>(*key_col_with_type.type).getElements();
 
             auto out = ColumnString::create();
+            out->reserve(key_col->size());
             dict->getString(attr_name, key_columns, key_types, out.get());
             block.getByPosition(result).column = std::move(out);
         }
@@ -394,6 +398,7 @@ private:
         const auto & range_col_values = getColumnDataAsPaddedPODArray(*range_col_untyped, range_col_values_storage);
 
         auto out = ColumnString::create();
+        out->reserve(id_col_values.size());
         dict->getString(attr_name, id_col_values, range_col_values, out.get());
         block.getByPosition(result).column = std::move(out);
 
@@ -468,6 +473,7 @@ private:
 
         if (!executeDispatch<FlatDictionary>(block, arguments, result, dict_ptr) &&
             !executeDispatch<HashedDictionary>(block, arguments, result, dict_ptr) &&
+            !executeDispatch<HashedArrayDictionary>(block, arguments, result, dict_ptr) &&
             !executeDispatch<CacheDictionary>(block, arguments, result, dict_ptr) &&
             !executeDispatchComplex<ComplexKeyHashedDictionary>(block, arguments, result, dict_ptr) &&
             !executeDispatchComplex<ComplexKeyCacheDictionary>(block, arguments, result, dict_ptr) &&
@@ -511,6 +517,7 @@ private:
         {
             /// vector ids, vector defaults
             auto out = ColumnString::create();
+            out->reserve(id_col->size());
             const auto & ids = id_col->getData();
             dictionary->getString(attr_name, ids, default_col, out.get());
             block.getByPosition(result).column = std::move(out);
@@ -519,6 +526,7 @@ private:
         {
             /// vector ids, const defaults
             auto out = ColumnString::create();
+            out->reserve(id_col->size());
             const auto & ids = id_col->getData();
             String def = default_col->getValue<String>();
             dictionary->getString(attr_name, ids, def, out.get());
@@ -588,6 +596,7 @@ private:
         const auto & key_types = static_cast<const DataTypeTuple &>(*key_col_with_type.type).getElements();
 
         auto out = ColumnString::create();
+        out->reserve(key_col->size());
 
         const auto default_col_untyped = block.getByPosition(arguments[3]).column.get();
         if (const auto default_col = checkAndGetColumn<ColumnString>(default_col_untyped))
@@ -746,6 +755,7 @@ private:
 
         if (!executeDispatch<FlatDictionary>(block, arguments, result, dict_ptr) &&
             !executeDispatch<HashedDictionary>(block, arguments, result, dict_ptr) &&
+            !executeDispatch<HashedArrayDictionary>(block, arguments, result, dict_ptr) &&
             !executeDispatch<CacheDictionary>(block, arguments, result, dict_ptr) &&
             !executeDispatchComplex<ComplexKeyHashedDictionary>(block, arguments, result, dict_ptr) &&
             !executeDispatchComplex<ComplexKeyCacheDictionary>(block, arguments, result, dict_ptr) &&
@@ -966,6 +976,7 @@ private:
 
         if (!executeDispatch<FlatDictionary>(block, arguments, result, dict_ptr) &&
             !executeDispatch<HashedDictionary>(block, arguments, result, dict_ptr) &&
+            !executeDispatch<HashedArrayDictionary>(block, arguments, result, dict_ptr) &&
             !executeDispatch<CacheDictionary>(block, arguments, result, dict_ptr) &&
             !executeDispatchComplex<ComplexKeyHashedDictionary>(block, arguments, result, dict_ptr) &&
             !executeDispatchComplex<ComplexKeyCacheDictionary>(block, arguments, result, dict_ptr) &&
@@ -1415,6 +1426,7 @@ private:
 
         if (!executeDispatch<FlatDictionary>(block, arguments, result, dict_ptr) &&
             !executeDispatch<HashedDictionary>(block, arguments, result, dict_ptr) &&
+            !executeDispatch<HashedArrayDictionary>(block, arguments, result, dict_ptr) &&
             !executeDispatch<CacheDictionary>(block, arguments, result, dict_ptr))
             throw Exception{"Unsupported dictionary type " + dict_ptr->getTypeName(), ErrorCodes::UNKNOWN_TYPE};
     }
@@ -1575,6 +1587,7 @@ private:
 
         if (!executeDispatch<FlatDictionary>(block, arguments, result, dict_ptr)
             && !executeDispatch<HashedDictionary>(block, arguments, result, dict_ptr)
+            && !executeDispatch<HashedArrayDictionary>(block, arguments, result, dict_ptr)
             && !executeDispatch<CacheDictionary>(block, arguments, result, dict_ptr))
             throw Exception{"Unsupported dictionary type " + dict_ptr->getTypeName(), ErrorCodes::UNKNOWN_TYPE};
     }
@@ -29,6 +29,7 @@
 #include <Common/HashTable/Hash.h>
 #include <Functions/IFunction.h>
 #include <Functions/FunctionHelpers.h>
+#include <Functions/TargetSpecific.h>
 
 #include <ext/range.h>
 #include <ext/bit_cast.h>
@@ -414,6 +415,20 @@ public:
 };
 
 
+DECLARE_MULTITARGET_CODE(
+
+template <typename Impl, typename FromType, typename ToType>
+struct IntHashLoop
+{
+    static void apply(const FromType * __restrict from, ToType * __restrict to, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+            to[i] = Impl::apply(from[i]);
+    }
+};
+
+)
+
 template <typename Impl, typename Name>
 class FunctionIntHash : public IFunction
 {
@@ -436,8 +451,17 @@ private:
 
             size_t size = vec_from.size();
             vec_to.resize(size);
-            for (size_t i = 0; i < size; ++i)
-                vec_to[i] = Impl::apply(vec_from[i]);
+#if USE_MULTITARGET_CODE
+            if (selectedAVX512())
+                TargetSpecific::AVX512::IntHashLoop<Impl, FromType, ToType>::apply(vec_from.data(), vec_to.data(), size);
+            else if (selectedAVX2())
+                TargetSpecific::AVX2::IntHashLoop<Impl, FromType, ToType>::apply(vec_from.data(), vec_to.data(), size);
+            else
+#endif
+            {
+                selectedDefault();
+                TargetSpecific::Default::IntHashLoop<Impl, FromType, ToType>::apply(vec_from.data(), vec_to.data(), size);
+            }
 
             block.getByPosition(result).column = std::move(col_to);
         }
@@ -62,6 +62,13 @@ struct AndImpl
     }
 
     static inline constexpr bool specialImplementationForNulls() { return false; }
+
+#if USE_EMBEDDED_COMPILER
+    static inline llvm::Value * apply(llvm::IRBuilder<> & builder, llvm::Value * a, llvm::Value * b)
+    {
+        return builder.CreateAnd(a, b);
+    }
+#endif
 };
 
 struct OrImpl
@@ -82,6 +89,13 @@ struct OrImpl
     }
 
     static inline constexpr bool specialImplementationForNulls() { return true; }
+
+#if USE_EMBEDDED_COMPILER
+    static inline llvm::Value * apply(llvm::IRBuilder<> & builder, llvm::Value * a, llvm::Value * b)
+    {
+        return builder.CreateOr(a, b);
+    }
+#endif
 };
 
 struct XorImpl
@@ -396,36 +410,15 @@ public:
 
     llvm::Value * compileImpl(llvm::IRBuilderBase & builder, const DataTypes & types, ValuePlaceholders values) const override
     {
+        /// Branchless evaluation, even for the saturable AND and OR. In a fused loop the arguments are
+        ///  already computed register values, so short-circuiting with a chain of conditional branches
+        ///  saves nothing and costs a hard-to-predict branch per argument; a straight and/or lets the
+        ///  backend keep the whole filter expression vectorizable.
         auto & b = static_cast<llvm::IRBuilder<> &>(builder);
-        if constexpr (!Impl::isSaturable())
-        {
-            auto * result = nativeBoolCast(b, types[0], values[0]());
-            for (size_t i = 1; i < types.size(); i++)
-                result = Impl::apply(b, result, nativeBoolCast(b, types[i], values[i]()));
-            return b.CreateSelect(result, b.getInt8(1), b.getInt8(0));
-        }
-        constexpr bool breakOnTrue = Impl::isSaturatedValue(true);
-        auto * next = b.GetInsertBlock();
-        auto * stop = llvm::BasicBlock::Create(next->getContext(), "", next->getParent());
-        b.SetInsertPoint(stop);
-        auto * phi = b.CreatePHI(b.getInt8Ty(), values.size());
-        for (size_t i = 0; i < types.size(); i++)
-        {
-            b.SetInsertPoint(next);
-            auto * value = values[i]();
-            auto * truth = nativeBoolCast(b, types[i], value);
-            if (!types[i]->equals(DataTypeUInt8{}))
-                value = b.CreateSelect(truth, b.getInt8(1), b.getInt8(0));
-            phi->addIncoming(value, b.GetInsertBlock());
-            if (i + 1 < types.size())
-            {
-                next = llvm::BasicBlock::Create(next->getContext(), "", next->getParent());
-                b.CreateCondBr(truth, breakOnTrue ? stop : next, breakOnTrue ? next : stop);
-            }
-        }
-        b.CreateBr(stop);
-        b.SetInsertPoint(stop);
-        return phi;
+        auto * result = nativeBoolCast(b, types[0], values[0]());
+        for (size_t i = 1; i < types.size(); i++)
+            result = Impl::apply(b, result, nativeBoolCast(b, types[i], values[i]()));
+        return b.CreateSelect(result, b.getInt8(1), b.getInt8(0));
     }
 #endif
 };
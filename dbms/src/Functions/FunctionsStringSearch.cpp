@@ -1009,6 +1009,114 @@ public:
 };
 
 
+/** Search for several constant needles in each row in one pass (see MultiVolnitsky).
+  * The hash table over the needles is built once per block and reused for all rows.
+  */
+struct MultiSearchAnyImpl
+{
+    using ResultType = UInt8;
+
+    static void vector_constant(const ColumnString::Chars & data,
+        const ColumnString::Offsets & offsets,
+        const std::vector<StringRef> & needles,
+        PaddedPODArray<UInt8> & res)
+    {
+        MultiVolnitsky searcher(needles);
+
+        ColumnString::Offset prev_offset = 0;
+        for (size_t i = 0; i < offsets.size(); ++i)
+        {
+            res[i] = searcher.searchAny(&data[prev_offset], offsets[i] - prev_offset - 1);
+            prev_offset = offsets[i];
+        }
+    }
+};
+
+struct MultiSearchFirstPositionImpl
+{
+    using ResultType = UInt64;
+
+    static void vector_constant(const ColumnString::Chars & data,
+        const ColumnString::Offsets & offsets,
+        const std::vector<StringRef> & needles,
+        PaddedPODArray<UInt64> & res)
+    {
+        MultiVolnitsky searcher(needles);
+
+        ColumnString::Offset prev_offset = 0;
+        for (size_t i = 0; i < offsets.size(); ++i)
+        {
+            res[i] = searcher.searchFirstPosition(&data[prev_offset], offsets[i] - prev_offset - 1);
+            prev_offset = offsets[i];
+        }
+    }
+};
+
+struct MultiSearchFirstIndexImpl
+{
+    using ResultType = UInt64;
+
+    static void vector_constant(const ColumnString::Chars & data,
+        const ColumnString::Offsets & offsets,
+        const std::vector<StringRef> & needles,
+        PaddedPODArray<UInt64> & res)
+    {
+        MultiVolnitsky searcher(needles);
+
+        ColumnString::Offset prev_offset = 0;
+        for (size_t i = 0; i < offsets.size(); ++i)
+        {
+            res[i] = searcher.searchFirstIndex(&data[prev_offset], offsets[i] - prev_offset - 1);
+            prev_offset = offsets[i];
+        }
+    }
+};
+
+
+/** Match several constant regexps per row with one compiled automaton (see MultiRegexps).
+  * The compiled set is cached by the pattern set, so repeated blocks and queries reuse it.
+  */
+struct MultiMatchAnyImpl
+{
+    using ResultType = UInt8;
+
+    static void vector_constant(const ColumnString::Chars & data,
+        const ColumnString::Offsets & offsets,
+        const std::vector<StringRef> & needles,
+        PaddedPODArray<UInt8> & res)
+    {
+        auto set = MultiRegexps::get(needles);
+
+        ColumnString::Offset prev_offset = 0;
+        for (size_t i = 0; i < offsets.size(); ++i)
+        {
+            res[i] = set->matchAny(reinterpret_cast<const char *>(&data[prev_offset]), offsets[i] - prev_offset - 1);
+            prev_offset = offsets[i];
+        }
+    }
+};
+
+struct MultiMatchAnyIndexImpl
+{
+    using ResultType = UInt64;
+
+    static void vector_constant(const ColumnString::Chars & data,
+        const ColumnString::Offsets & offsets,
+        const std::vector<StringRef> & needles,
+        PaddedPODArray<UInt64> & res)
+    {
+        auto set = MultiRegexps::get(needles);
+
+        ColumnString::Offset prev_offset = 0;
+        for (size_t i = 0; i < offsets.size(); ++i)
+        {
+            res[i] = set->matchAnyIndex(reinterpret_cast<const char *>(&data[prev_offset]), offsets[i] - prev_offset - 1);
+            prev_offset = offsets[i];
+        }
+    }
+};
+
+
 struct NamePosition
 {
     static constexpr auto name = "position";
@@ -1057,6 +1165,26 @@ struct NameReplaceRegexpAll
 {
     static constexpr auto name = "replaceRegexpAll";
 };
+struct NameMultiSearchAny
+{
+    static constexpr auto name = "multiSearchAny";
+};
+struct NameMultiSearchFirstPosition
+{
+    static constexpr auto name = "multiSearchFirstPosition";
+};
+struct NameMultiSearchFirstIndex
+{
+    static constexpr auto name = "multiSearchFirstIndex";
+};
+struct NameMultiMatchAny
+{
+    static constexpr auto name = "multiMatchAny";
+};
+struct NameMultiMatchAnyIndex
+{
+    static constexpr auto name = "multiMatchAnyIndex";
+};
 
 using FunctionPosition = FunctionsStringSearch<PositionImpl<PositionCaseSensitiveASCII>, NamePosition>;
 using FunctionPositionUTF8 = FunctionsStringSearch<PositionImpl<PositionCaseSensitiveUTF8>, NamePositionUTF8>;
@@ -1072,6 +1200,11 @@ using FunctionReplaceOne = FunctionStringReplace<ReplaceStringImpl<true>, NameRe
 using FunctionReplaceAll = FunctionStringReplace<ReplaceStringImpl<false>, NameReplaceAll>;
 using FunctionReplaceRegexpOne = FunctionStringReplace<ReplaceRegexpImpl<true>, NameReplaceRegexpOne>;
 using FunctionReplaceRegexpAll = FunctionStringReplace<ReplaceRegexpImpl<false>, NameReplaceRegexpAll>;
+using FunctionMultiSearchAny = FunctionsMultiStringSearch<MultiSearchAnyImpl, NameMultiSearchAny>;
+using FunctionMultiSearchFirstPosition = FunctionsMultiStringSearch<MultiSearchFirstPositionImpl, NameMultiSearchFirstPosition>;
+using FunctionMultiSearchFirstIndex = FunctionsMultiStringSearch<MultiSearchFirstIndexImpl, NameMultiSearchFirstIndex>;
+using FunctionMultiMatchAny = FunctionsMultiStringSearch<MultiMatchAnyImpl, NameMultiMatchAny>;
+using FunctionMultiMatchAnyIndex = FunctionsMultiStringSearch<MultiMatchAnyIndexImpl, NameMultiMatchAnyIndex>;
 
 
 void registerFunctionsStringSearch(FunctionFactory & factory)
@@ -1088,5 +1221,10 @@ void registerFunctionsStringSearch(FunctionFactory & factory)
     factory.registerFunction<FunctionLike>();
     factory.registerFunction<FunctionNotLike>();
     factory.registerFunction<FunctionExtract>();
+    factory.registerFunction<FunctionMultiSearchAny>();
+    factory.registerFunction<FunctionMultiSearchFirstPosition>();
+    factory.registerFunction<FunctionMultiSearchFirstIndex>();
+    factory.registerFunction<FunctionMultiMatchAny>();
+    factory.registerFunction<FunctionMultiMatchAnyIndex>();
 }
 }
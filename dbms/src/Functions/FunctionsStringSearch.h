@@ -1,12 +1,15 @@
 #pragma once
 
+#include <Columns/ColumnArray.h>
 #include <Columns/ColumnConst.h>
 #include <Columns/ColumnString.h>
 #include <Columns/ColumnVector.h>
+#include <DataTypes/DataTypeArray.h>
 #include <DataTypes/DataTypeString.h>
 #include <DataTypes/DataTypesNumber.h>
 #include <Functions/IFunction.h>
 #include <Functions/FunctionHelpers.h>
+#include <common/StringRef.h>
 
 
 namespace DB
@@ -35,6 +38,15 @@ namespace DB
   *
   * replaceRegexpOne(haystack, pattern, replacement) - replaces the pattern with the specified regexp, only the first occurrence.
   * replaceRegexpAll(haystack, pattern, replacement) - replaces the pattern with the specified type, all occurrences.
+  *
+  * multiSearchAny(haystack, [needle1, needle2, ...])           - 1 if any of the needles is a substring of haystack, 0 otherwise.
+  * multiSearchFirstPosition(haystack, [needle1, needle2, ...]) - the position (in bytes) of the leftmost match of any needle, or 0.
+  * multiSearchFirstIndex(haystack, [needle1, needle2, ...])    - the 1-based index of the needle matched at the leftmost position, or 0.
+  * All needles are searched in a single pass over the haystack (see MultiVolnitsky); the array of needles must be constant.
+  *
+  * multiMatchAny(haystack, [pattern1, pattern2, ...])      - 1 if any of the re2 regexps matches haystack, 0 otherwise.
+  * multiMatchAnyIndex(haystack, [pattern1, pattern2, ...]) - the 1-based index of the smallest matching pattern, or 0.
+  * All patterns are compiled into one automaton (see MultiRegexps); the array of patterns must be constant.
   */
 
 namespace ErrorCodes
@@ -124,6 +136,80 @@ public:
 };
 
 
+template <typename Impl, typename Name>
+class FunctionsMultiStringSearch : public IFunction
+{
+public:
+    static constexpr auto name = Name::name;
+    static FunctionPtr create(const Context &)
+    {
+        return std::make_shared<FunctionsMultiStringSearch>();
+    }
+
+    String getName() const override
+    {
+        return name;
+    }
+
+    size_t getNumberOfArguments() const override
+    {
+        return 2;
+    }
+
+    bool useDefaultImplementationForConstants() const override { return true; }
+    ColumnNumbers getArgumentsThatAreAlwaysConstant() const override { return {1}; }
+
+    DataTypePtr getReturnTypeImpl(const DataTypes & arguments) const override
+    {
+        if (!isString(arguments[0]))
+            throw Exception(
+                "Illegal type " + arguments[0]->getName() + " of argument of function " + getName(), ErrorCodes::ILLEGAL_TYPE_OF_ARGUMENT);
+
+        const DataTypeArray * array_type = checkAndGetDataType<DataTypeArray>(arguments[1].get());
+        if (!array_type || !isString(array_type->getNestedType()))
+            throw Exception(
+                "Illegal type " + arguments[1]->getName() + " of second argument of function " + getName() + ", must be Array(String)",
+                ErrorCodes::ILLEGAL_TYPE_OF_ARGUMENT);
+
+        return std::make_shared<DataTypeNumber<typename Impl::ResultType>>();
+    }
+
+    void executeImpl(Block & block, const ColumnNumbers & arguments, size_t result, size_t input_rows_count) override
+    {
+        using ResultType = typename Impl::ResultType;
+
+        const ColumnPtr & column_haystack = block.getByPosition(arguments[0]).column;
+        const ColumnPtr & column_needles = block.getByPosition(arguments[1]).column;
+
+        const ColumnConst * col_needles_const = checkAndGetColumnConst<ColumnArray>(column_needles.get());
+        if (!col_needles_const)
+            throw Exception(
+                "Second argument of function " + getName() + " must be a constant array of strings.", ErrorCodes::ILLEGAL_COLUMN);
+
+        Array needles_arr = col_needles_const->getValue<Array>();
+
+        std::vector<StringRef> needles;
+        needles.reserve(needles_arr.size());
+        for (const auto & needle : needles_arr)
+            needles.emplace_back(needle.safeGet<const String &>());
+
+        const ColumnString * col_haystack_vector = checkAndGetColumn<ColumnString>(&*column_haystack);
+        if (!col_haystack_vector)
+            throw Exception(
+                "Illegal column " + column_haystack->getName() + " of first argument of function " + getName(), ErrorCodes::ILLEGAL_COLUMN);
+
+        auto col_res = ColumnVector<ResultType>::create();
+
+        typename ColumnVector<ResultType>::Container & vec_res = col_res->getData();
+        vec_res.resize(input_rows_count);
+
+        Impl::vector_constant(col_haystack_vector->getChars(), col_haystack_vector->getOffsets(), needles, vec_res);
+
+        block.getByPosition(result).column = std::move(col_res);
+    }
+};
+
+
 template <typename Impl, typename Name>
 class FunctionsStringSearchToString : public IFunction
 {
@@ -0,0 +1,220 @@
+#include <Functions/FunctionsUDF.h>
+#include <Functions/FunctionFactory.h>
+
+#include <Columns/ColumnString.h>
+#include <Columns/ColumnVector.h>
+#include <DataTypes/DataTypeString.h>
+#include <DataTypes/DataTypesNumber.h>
+#include <IO/WriteHelpers.h>
+#include <Common/ProfileEvents.h>
+#include <Common/Stopwatch.h>
+#include <Common/StringUtils/StringUtils.h>
+#include <Common/typeid_cast.h>
+
+#include <Poco/Util/AbstractConfiguration.h>
+
+
+namespace ProfileEvents
+{
+    extern const Event UDFExecuteCalls;
+    extern const Event UDFExecuteRows;
+    extern const Event UDFExecuteMicroseconds;
+}
+
+namespace DB
+{
+
+namespace ErrorCodes
+{
+    extern const int ILLEGAL_TYPE_OF_ARGUMENT;
+    extern const int ILLEGAL_COLUMN;
+    extern const int EXTERNAL_LIBRARY_ERROR;
+    extern const int UNKNOWN_ELEMENT_IN_CONFIG;
+}
+
+namespace
+{
+
+#define FOR_UDF_NUMERIC_TYPES(M) \
+    M(UInt8) \
+    M(UInt16) \
+    M(UInt32) \
+    M(UInt64) \
+    M(Int8) \
+    M(Int16) \
+    M(Int32) \
+    M(Int64) \
+    M(Float32) \
+    M(Float64)
+
+DataTypePtr toDataType(ClickHouseUDF::ColumnType type)
+{
+    switch (type)
+    {
+#define M(TYPE) \
+        case ClickHouseUDF::ColumnType::TYPE: return std::make_shared<DataType##TYPE>();
+        FOR_UDF_NUMERIC_TYPES(M)
+#undef M
+        case ClickHouseUDF::ColumnType::String: return std::make_shared<DataTypeString>();
+    }
+
+    throw Exception("UDF library uses unknown column type " + toString(static_cast<UInt32>(type)),
+        ErrorCodes::EXTERNAL_LIBRARY_ERROR);
+}
+
+/// Exposes the raw buffers of a (full, non-nullable) column through the ABI struct.
+void fillArgument(const IColumn & column, ClickHouseUDF::ColumnType type, ClickHouseUDF::Column & res, const String & function_name)
+{
+    res.type = type;
+    res.size = column.size();
+
+    switch (type)
+    {
+#define M(TYPE) \
+        case ClickHouseUDF::ColumnType::TYPE: \
+            if (const auto * concrete = typeid_cast<const ColumnVector<TYPE> *>(&column)) \
+            { \
+                res.data = concrete->getData().data(); \
+                return; \
+            } \
+            break;
+        FOR_UDF_NUMERIC_TYPES(M)
+#undef M
+        case ClickHouseUDF::ColumnType::String:
+            if (const auto * concrete = typeid_cast<const ColumnString *>(&column))
+            {
+                res.data = concrete->getChars().data();
+                res.offsets = reinterpret_cast<const uint64_t *>(concrete->getOffsets().data());
+                return;
+            }
+            break;
+    }
+
+    throw Exception("Illegal column " + column.getName() + " of argument of function " + function_name,
+        ErrorCodes::ILLEGAL_COLUMN);
+}
+
+/// Creates a result column of `rows` rows and returns its data buffer through `out_data`.
+MutableColumnPtr createResultColumn(ClickHouseUDF::ColumnType type, size_t rows, void ** out_data)
+{
+    switch (type)
+    {
+#define M(TYPE) \
+        case ClickHouseUDF::ColumnType::TYPE: \
+        { \
+            auto column = ColumnVector<TYPE>::create(rows); \
+            *out_data = column->getData().data(); \
+            return column; \
+        }
+        FOR_UDF_NUMERIC_TYPES(M)
+#undef M
+        default:
+            /// Ruled out when the library is registered.
+            throw Exception("UDF result type must be fixed-width", ErrorCodes::EXTERNAL_LIBRARY_ERROR);
+    }
+}
+
+#undef FOR_UDF_NUMERIC_TYPES
+
+}
+
+
+DataTypePtr FunctionUDF::getReturnTypeImpl(const DataTypes & arguments) const
+{
+    for (size_t i = 0; i < arguments.size(); ++i)
+    {
+        auto expected = toDataType(descriptor.argument_types[i]);
+        if (!arguments[i]->equals(*expected))
+            throw Exception("Illegal type " + arguments[i]->getName() + " of argument " + toString(i + 1)
+                + " of function " + getName() + ", expected " + expected->getName(),
+                ErrorCodes::ILLEGAL_TYPE_OF_ARGUMENT);
+    }
+
+    return toDataType(descriptor.result_type);
+}
+
+void FunctionUDF::executeImpl(Block & block, const ColumnNumbers & arguments, size_t result, size_t input_rows_count)
+{
+    std::vector<ClickHouseUDF::Column> abi_arguments(arguments.size());
+    for (size_t i = 0; i < arguments.size(); ++i)
+        fillArgument(*block.getByPosition(arguments[i]).column, descriptor.argument_types[i], abi_arguments[i], getName());
+
+    void * result_data = nullptr;
+    auto col_res = createResultColumn(descriptor.result_type, input_rows_count, &result_data);
+
+    ClickHouseUDF::MutableColumn abi_result;
+    abi_result.type = descriptor.result_type;
+    abi_result.data = result_data;
+    abi_result.size = input_rows_count;
+
+    Stopwatch watch;
+    const char * error = execute(descriptor.name.c_str(), abi_arguments.data(), abi_arguments.size(), &abi_result);
+    watch.stop();
+
+    ProfileEvents::increment(ProfileEvents::UDFExecuteCalls);
+    ProfileEvents::increment(ProfileEvents::UDFExecuteRows, input_rows_count);
+    ProfileEvents::increment(ProfileEvents::UDFExecuteMicroseconds, watch.elapsedMicroseconds());
+
+    if (error)
+        throw Exception("Function " + getName() + " failed: " + error, ErrorCodes::EXTERNAL_LIBRARY_ERROR);
+
+    block.getByPosition(result).column = std::move(col_res);
+}
+
+
+void registerUDFLibraries(const Poco::Util::AbstractConfiguration & config)
+{
+    if (!config.has("udf_libraries"))
+        return;
+
+    Poco::Util::AbstractConfiguration::Keys keys;
+    config.keys("udf_libraries", keys);
+
+    for (const auto & key : keys)
+    {
+        if (key != "library" && !startsWith(key, "library["))
+            throw Exception("Unknown element in config: udf_libraries." + key + ", must be 'library'",
+                ErrorCodes::UNKNOWN_ELEMENT_IN_CONFIG);
+
+        const String path = config.getString("udf_libraries." + key + ".path");
+        auto library = std::make_shared<SharedLibrary>(path);
+
+        UInt32 api_version = library->get<uint32_t (*)()>("ClickHouseUDF_v1_apiVersion")();
+        if (api_version != CLICKHOUSE_UDF_API)
+            throw Exception("UDF library " + path + " was built against API version " + toString(api_version)
+                + ", expected " + toString(CLICKHOUSE_UDF_API), ErrorCodes::EXTERNAL_LIBRARY_ERROR);
+
+        uint64_t function_count = 0;
+        const auto * descriptors = library->get<const ClickHouseUDF::FunctionDescriptor * (*)(uint64_t *)>(
+            "ClickHouseUDF_v1_functions")(&function_count);
+        auto execute = library->get<FunctionUDF::ExecuteFunc>("ClickHouseUDF_v1_execute");
+
+        for (uint64_t i = 0; i < function_count; ++i)
+        {
+            FunctionUDF::Descriptor descriptor;
+            descriptor.name = descriptors[i].name;
+            descriptor.argument_types.assign(
+                descriptors[i].argument_types, descriptors[i].argument_types + descriptors[i].argument_count);
+            descriptor.result_type = descriptors[i].result_type;
+
+            /// Validate the descriptor while we can still attribute errors to the library,
+            /// not to a query. toDataType throws on unknown type values.
+            for (auto type : descriptor.argument_types)
+                toDataType(type);
+            if (descriptor.result_type == ClickHouseUDF::ColumnType::String)
+                throw Exception("UDF " + descriptor.name + " in library " + path
+                    + " returns String, but API v1 supports only fixed-width result types"
+                    " (the result buffer is preallocated)", ErrorCodes::EXTERNAL_LIBRARY_ERROR);
+            toDataType(descriptor.result_type);
+
+            FunctionFactory::instance().registerFunction(descriptor.name,
+                [library, descriptor, execute](const Context &) -> FunctionBuilderPtr
+                {
+                    return std::make_shared<DefaultFunctionBuilder>(
+                        std::make_shared<FunctionUDF>(library, descriptor, execute));
+                });
+        }
+    }
+}
+
+}
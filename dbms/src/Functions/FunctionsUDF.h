@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Functions/IFunction.h>
+#include <Functions/UDFAPI.h>
+#include <Common/SharedLibrary.h>
+
+
+namespace Poco { namespace Util { class AbstractConfiguration; } }
+
+namespace DB
+{
+
+/** A user-defined function loaded from a shared library (see UDFAPI.h).
+  * Works on whole blocks: passes the raw column buffers of the arguments to the library
+  * and lets it fill a preallocated result column, so a well-written library function
+  * runs at the same speed as a built-in one.
+  */
+class FunctionUDF final : public IFunction
+{
+public:
+    /// An owned copy of ClickHouseUDF::FunctionDescriptor (which points into library memory).
+    struct Descriptor
+    {
+        String name;
+        std::vector<ClickHouseUDF::ColumnType> argument_types;
+        ClickHouseUDF::ColumnType result_type;
+    };
+
+    using ExecuteFunc = const char * (*)(
+        const char * function_name,
+        const ClickHouseUDF::Column * arguments, uint64_t argument_count,
+        ClickHouseUDF::MutableColumn * result);
+
+    FunctionUDF(SharedLibraryPtr library_, Descriptor descriptor_, ExecuteFunc execute_)
+        : library(std::move(library_)), descriptor(std::move(descriptor_)), execute(execute_) {}
+
+    String getName() const override { return descriptor.name; }
+    size_t getNumberOfArguments() const override { return descriptor.argument_types.size(); }
+    bool useDefaultImplementationForConstants() const override { return true; }
+
+    DataTypePtr getReturnTypeImpl(const DataTypes & arguments) const override;
+    void executeImpl(Block & block, const ColumnNumbers & arguments, size_t result, size_t input_rows_count) override;
+
+private:
+    /// Keeps the library loaded as long as any query uses the function.
+    SharedLibraryPtr library;
+    Descriptor descriptor;
+    ExecuteFunc execute;
+};
+
+/// Loads the libraries listed in the `udf_libraries` config section, checks their API version
+/// and registers their functions in the FunctionFactory. Called once at server startup.
+void registerUDFLibraries(const Poco::Util::AbstractConfiguration & config);
+
+}
@@ -279,6 +279,38 @@ bool PreparedFunctionImpl::defaultImplementationForConstantArguments(Block & blo
     if (args.empty() || !useDefaultImplementationForConstants() || !allArgumentsAreConstants(block, args))
         return false;
 
+    /// For a deterministic function, remember the result of the previous execution and reuse it
+    /// when the next block carries the same constant arguments. This makes expensive functions
+    /// on repeated scalar arguments (e.g. dictionary lookups) run once per query, not once per block.
+    bool use_memo = canBeMemoizedOnConstantArguments();
+    std::vector<Field> argument_values;
+
+    if (use_memo)
+    {
+        argument_values.reserve(args.size());
+        for (auto arg : args)
+        {
+            const ColumnPtr & column = block.getByPosition(arg).column;
+            if (column->empty())
+            {
+                /// A constant of yet unknown value (sample block); nothing to remember.
+                use_memo = false;
+                break;
+            }
+            argument_values.push_back((*column)[0]);
+        }
+    }
+
+    if (use_memo)
+    {
+        std::lock_guard<std::mutex> lock(constant_result_mutex);
+        if (memoized_constant_result && memoized_constant_arguments == argument_values)
+        {
+            block.getByPosition(result).column = ColumnConst::create(memoized_constant_result, input_rows_count);
+            return true;
+        }
+    }
+
     Block temporary_block;
     bool have_converted_columns = false;
 
@@ -322,6 +354,13 @@ bool PreparedFunctionImpl::defaultImplementationForConstantArguments(Block & blo
     else
         result_column = temporary_block.getByPosition(arguments_size).column;
 
+    if (use_memo)
+    {
+        std::lock_guard<std::mutex> lock(constant_result_mutex);
+        memoized_constant_arguments = std::move(argument_values);
+        memoized_constant_result = result_column;
+    }
+
     block.getByPosition(result).column = ColumnConst::create(result_column, input_rows_count);
     return true;
 }
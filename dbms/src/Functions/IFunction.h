@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
 
 #include <Common/config.h>
 #include <Core/Names.h>
@@ -92,6 +93,14 @@ protected:
       */
     virtual bool canBeExecutedOnDefaultArguments() const { return true; }
 
+    /** If true, the default implementation for constants remembers the result of the previous execution,
+      * and reuses it for subsequent blocks with the same constant arguments (a per-query memo:
+      * prepared functions live for the duration of one query). Must be false for functions that are not
+      * deterministic in scope of query. Enabled only for executables with fixed argument types
+      * (DefaultExecutable): the memo key is the argument values, not their types.
+      */
+    virtual bool canBeMemoizedOnConstantArguments() const { return false; }
+
 private:
     bool defaultImplementationForNulls(Block & block, const ColumnNumbers & args, size_t result,
                                        size_t input_rows_count);
@@ -102,6 +111,13 @@ private:
 
     /// Cache is created by function createLowCardinalityResultCache()
     PreparedFunctionLowCardinalityResultCachePtr low_cardinality_result_cache;
+
+    /// Memo for canBeMemoizedOnConstantArguments(): the constant arguments of the previous execution
+    /// and the single-row result they produced. Guarded by a mutex: one ExpressionActions instance
+    /// (and so one prepared function) may be executed by several streams of the same query.
+    std::mutex constant_result_mutex;
+    std::vector<Field> memoized_constant_arguments;
+    ColumnPtr memoized_constant_result;
 };
 
 using ValuePlaceholders = std::vector<std::function<llvm::Value * ()>>;
@@ -409,6 +425,7 @@ protected:
     bool useDefaultImplementationForLowCardinalityColumns() const final { return function->useDefaultImplementationForLowCardinalityColumns(); }
     ColumnNumbers getArgumentsThatAreAlwaysConstant() const final { return function->getArgumentsThatAreAlwaysConstant(); }
     bool canBeExecutedOnDefaultArguments() const override { return function->canBeExecutedOnDefaultArguments(); }
+    bool canBeMemoizedOnConstantArguments() const override { return function->isDeterministicInScopeOfQuery() && function->isSuitableForConstantFolding(); }
 
 private:
     std::shared_ptr<IFunction> function;
@@ -1,9 +1,18 @@
 #pragma once
 
+#include <Common/Exception.h>
 #include <Common/OptimizedRegularExpression.h>
 #include <Common/ObjectPool.h>
 #include <Common/ProfileEvents.h>
+#include <Core/Types.h>
 #include <Functions/likePatternToRegexp.h>
+#include <common/StringRef.h>
+#include <re2/set.h>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
 
 
 namespace ProfileEvents
@@ -44,4 +53,82 @@ namespace Regexps
     }
 }
 
+namespace ErrorCodes
+{
+    extern const int BAD_ARGUMENTS;
+}
+
+namespace MultiRegexps
+{
+    /** All patterns compiled into one automaton (re2's RE2::Set): a row is scanned once,
+      *  regardless of the number of patterns. Match is thread-safe after compilation.
+      */
+    class Set
+    {
+    public:
+        explicit Set(const std::vector<StringRef> & patterns)
+            : set(makeOptions(), re2::RE2::UNANCHORED)
+        {
+            std::string error;
+            for (const auto & pattern : patterns)
+                if (set.Add(re2::StringPiece(pattern.data, pattern.size), &error) < 0)
+                    throw Exception("Cannot add regexp '" + pattern.toString() + "' to the set: " + error, ErrorCodes::BAD_ARGUMENTS);
+
+            if (!set.Compile())
+                throw Exception("Cannot compile the set of regexps: too big or out of memory", ErrorCodes::BAD_ARGUMENTS);
+        }
+
+        bool matchAny(const char * data, size_t size) const
+        {
+            return set.Match(re2::StringPiece(data, size), nullptr);
+        }
+
+        /// 1-based index of the matching pattern with the smallest index, or 0.
+        UInt64 matchAnyIndex(const char * data, size_t size) const
+        {
+            std::vector<int> matches;
+            if (!set.Match(re2::StringPiece(data, size), &matches))
+                return 0;
+            return *std::min_element(matches.begin(), matches.end()) + 1;
+        }
+
+    private:
+        static re2::RE2::Options makeOptions()
+        {
+            re2::RE2::Options options;
+            options.set_dot_nl(true);
+            options.set_log_errors(false);
+            return options;
+        }
+
+        re2::RE2::Set set;
+    };
+
+    using SetPtr = std::shared_ptr<Set>;
+
+    /// Compiled sets are cached by the pattern set: typically the very same set of regexps
+    ///  is applied to every block of the query (and to every query of the same shape).
+    inline SetPtr get(const std::vector<StringRef> & patterns)
+    {
+        /// The patterns are glued into one key with length prefixes, so that no separator can be ambiguous.
+        String key;
+        for (const auto & pattern : patterns)
+        {
+            key += std::to_string(pattern.size);
+            key += ':';
+            key += pattern.toString();
+        }
+
+        static std::map<String, SetPtr> known_sets;
+        static std::mutex mutex;
+
+        std::lock_guard<std::mutex> lock(mutex);
+
+        SetPtr & entry = known_sets[key];
+        if (!entry)
+            entry = std::make_shared<Set>(patterns);
+        return entry;
+    }
+}
+
 }
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <Common/CpuFeatures.h>
+#include <Common/ProfileEvents.h>
+
+
+namespace ProfileEvents
+{
+    extern const Event TargetSpecificKernelDefault;
+    extern const Event TargetSpecificKernelAVX2;
+    extern const Event TargetSpecificKernelAVX512;
+}
+
+namespace DB
+{
+
+/** Multi-versioning of hot function kernels.
+  *
+  * The binary targets only SSE 4.2, so the compiler cannot use the wider vector units
+  *  of the CPUs the server actually runs on. A kernel wrapped in the macros below is
+  *  compiled several times for different instruction sets, and the caller picks an
+  *  implementation at run time by cpuid (see Common/CpuFeatures.h).
+  *
+  * Usage:
+  *
+  * DECLARE_MULTITARGET_CODE(
+  * template <typename T>
+  * void sumKernel(const T * data, size_t size, T & res) { ... }
+  * )
+  *
+  * expands the code into the namespaces TargetSpecific::Default, TargetSpecific::AVX2
+  *  and TargetSpecific::AVX512, the latter two compiled with the corresponding target
+  *  options. The caller dispatches:
+  *
+  * if (selectedAVX512())
+  *     TargetSpecific::AVX512::sumKernel(data, size, res);
+  * else if (selectedAVX2())
+  *     TargetSpecific::AVX2::sumKernel(data, size, res);
+  * else
+  * {
+  *     selectedDefault();
+  *     TargetSpecific::Default::sumKernel(data, size, res);
+  * }
+  *
+  * The selected* helpers also bump a ProfileEvents counter, so the ISA level that served
+  *  the queries is visible in system.events.
+  *
+  * Only code defined inside the macros is compiled for the wider instruction set.
+  * Out-of-line functions it calls are compiled for the baseline target and are safe;
+  *  inline helpers used from a kernel must be small enough to actually be inlined into it,
+  *  otherwise the linker may keep a single copy compiled for the wrong target.
+  */
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define USE_MULTITARGET_CODE 1
+#else
+#define USE_MULTITARGET_CODE 0
+#endif
+
+#if USE_MULTITARGET_CODE
+
+#if defined(__clang__)
+
+#define BEGIN_AVX2_SPECIFIC_CODE \
+    _Pragma("clang attribute push(__attribute__((target(\"sse,sse2,sse3,ssse3,sse4,popcnt,avx,avx2\"))),apply_to=function)")
+#define BEGIN_AVX512_SPECIFIC_CODE \
+    _Pragma("clang attribute push(__attribute__((target(\"sse,sse2,sse3,ssse3,sse4,popcnt,avx,avx2,avx512f,avx512bw,avx512vl\"))),apply_to=function)")
+#define END_TARGET_SPECIFIC_CODE \
+    _Pragma("clang attribute pop")
+
+#else
+
+#define BEGIN_AVX2_SPECIFIC_CODE \
+    _Pragma("GCC push_options") \
+    _Pragma("GCC target(\"avx,avx2\")")
+#define BEGIN_AVX512_SPECIFIC_CODE \
+    _Pragma("GCC push_options") \
+    _Pragma("GCC target(\"avx,avx2,avx512f,avx512bw,avx512vl\")")
+#define END_TARGET_SPECIFIC_CODE \
+    _Pragma("GCC pop_options")
+
+#endif
+
+#define DECLARE_DEFAULT_CODE(...) \
+namespace TargetSpecific::Default { \
+    __VA_ARGS__ \
+}
+
+#define DECLARE_AVX2_SPECIFIC_CODE(...) \
+BEGIN_AVX2_SPECIFIC_CODE \
+namespace TargetSpecific::AVX2 { \
+    __VA_ARGS__ \
+} \
+END_TARGET_SPECIFIC_CODE
+
+#define DECLARE_AVX512_SPECIFIC_CODE(...) \
+BEGIN_AVX512_SPECIFIC_CODE \
+namespace TargetSpecific::AVX512 { \
+    __VA_ARGS__ \
+} \
+END_TARGET_SPECIFIC_CODE
+
+#else
+
+#define DECLARE_DEFAULT_CODE(...) \
+namespace TargetSpecific::Default { \
+    __VA_ARGS__ \
+}
+
+#define DECLARE_AVX2_SPECIFIC_CODE(...)
+#define DECLARE_AVX512_SPECIFIC_CODE(...)
+
+#endif
+
+#define DECLARE_MULTITARGET_CODE(...) \
+DECLARE_DEFAULT_CODE(__VA_ARGS__) \
+DECLARE_AVX2_SPECIFIC_CODE(__VA_ARGS__) \
+DECLARE_AVX512_SPECIFIC_CODE(__VA_ARGS__)
+
+
+/// Dispatch helpers: check support by the CPU and account the chosen ISA level in system.events.
+
+inline bool selectedAVX512()
+{
+#if USE_MULTITARGET_CODE
+    if (!haveAVX512())
+        return false;
+    ProfileEvents::increment(ProfileEvents::TargetSpecificKernelAVX512);
+    return true;
+#else
+    return false;
+#endif
+}
+
+inline bool selectedAVX2()
+{
+#if USE_MULTITARGET_CODE
+    if (!haveAVX2())
+        return false;
+    ProfileEvents::increment(ProfileEvents::TargetSpecificKernelAVX2);
+    return true;
+#else
+    return false;
+#endif
+}
+
+inline void selectedDefault()
+{
+    ProfileEvents::increment(ProfileEvents::TargetSpecificKernelDefault);
+}
+
+}
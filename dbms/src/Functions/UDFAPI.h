@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+
+#define CLICKHOUSE_UDF_API 1
+
+/** The ABI for user-defined function libraries (see the `udf_libraries` server config section
+  * and registerUDFLibraries in FunctionsUDF.h). This header is self-contained so that a library
+  * can be built against it without any other ClickHouse headers.
+  *
+  * A library must export the following functions:
+  *
+  *   uint32_t ClickHouseUDF_v1_apiVersion();
+  *       Must return CLICKHOUSE_UDF_API of the header the library was built against.
+  *       Checked when the library is loaded; on a mismatch nothing else is called.
+  *
+  *   const ClickHouseUDF::FunctionDescriptor * ClickHouseUDF_v1_functions(uint64_t * count);
+  *       Returns the table of functions the library provides. The returned memory is owned
+  *       by the library and must stay valid while it is loaded.
+  *
+  *   const char * ClickHouseUDF_v1_execute(
+  *       const char * function_name,
+  *       const ClickHouseUDF::Column * arguments, uint64_t argument_count,
+  *       ClickHouseUDF::MutableColumn * result);
+  *       Executes the function on a whole block of rows at once: reads the raw argument
+  *       buffers and writes one value per row into result->data, which the server has
+  *       preallocated for result->size rows. Returns nullptr on success, or a message that
+  *       must stay valid until the next call (a string literal is fine) on error.
+  *       Called concurrently from query threads, so it must be thread-safe.
+  *
+  * NULL handling is done by the server: a function is never called with NULL values and its
+  * result for a row where any argument is NULL is NULL (the null_mask field is reserved for
+  * a future version of the API that lets functions see NULLs).
+  */
+namespace ClickHouseUDF
+{
+
+enum ColumnType : uint32_t
+{
+    UInt8 = 1,
+    UInt16 = 2,
+    UInt32 = 3,
+    UInt64 = 4,
+    Int8 = 5,
+    Int16 = 6,
+    Int32 = 7,
+    Int64 = 8,
+    Float32 = 9,
+    Float64 = 10,
+    /// Arguments only: the result buffer is preallocated, so results must be fixed-width.
+    String = 11,
+};
+
+/// A read-only argument column for a whole block.
+struct Column
+{
+    ColumnType type;
+    /// For numbers: an array of `size` values. For String: the concatenated values,
+    /// each followed by a terminating zero byte.
+    const void * data = nullptr;
+    /// For String only: `size` positions, the i-th is the offset just past the
+    /// terminating zero of the i-th value (so value i occupies [offsets[i - 1], offsets[i])).
+    const uint64_t * offsets = nullptr;
+    /// Reserved, always nullptr in API v1 (see the comment about NULLs above).
+    const uint8_t * null_mask = nullptr;
+    /// Number of rows.
+    uint64_t size = 0;
+};
+
+/// The preallocated result column: an array of `size` values of a fixed-width type.
+struct MutableColumn
+{
+    ColumnType type;
+    void * data = nullptr;
+    uint64_t size = 0;
+};
+
+struct FunctionDescriptor
+{
+    const char * name = nullptr;
+    const ColumnType * argument_types = nullptr;
+    uint64_t argument_count = 0;
+    ColumnType result_type;
+};
+
+}
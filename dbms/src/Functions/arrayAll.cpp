@@ -1,5 +1,6 @@
 #include <DataTypes/DataTypesNumber.h>
 #include <Columns/ColumnsNumber.h>
+#include <Columns/ColumnsCommon.h>
 #include <Functions/FunctionArrayMapped.h>
 #include <Functions/FunctionFactory.h>
 
@@ -59,17 +60,9 @@ struct ArrayAllImpl
         size_t pos = 0;
         for (size_t i = 0; i < offsets.size(); ++i)
         {
-            UInt8 all = 1;
-            for (; pos < offsets[i]; ++pos)
-            {
-                if (!filter[pos])
-                {
-                    all = 0;
-                    pos = offsets[i];
-                    break;
-                }
-            }
-            out_all[i] = all;
+            /// All elements pass iff every filter byte of the array is set: use a vectorized whole-range count.
+            out_all[i] = countBytesInFilter(&filter[pos], offsets[i] - pos) == offsets[i] - pos;
+            pos = offsets[i];
         }
 
         return out_column;
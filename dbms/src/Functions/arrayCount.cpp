@@ -1,5 +1,6 @@
 #include <DataTypes/DataTypesNumber.h>
 #include <Columns/ColumnsNumber.h>
+#include <Columns/ColumnsCommon.h>
 #include <Functions/FunctionArrayMapped.h>
 #include <Functions/FunctionFactory.h>
 
@@ -59,13 +60,9 @@ struct ArrayCountImpl
         size_t pos = 0;
         for (size_t i = 0; i < offsets.size(); ++i)
         {
-            size_t count = 0;
-            for (; pos < offsets[i]; ++pos)
-            {
-                if (filter[pos])
-                    ++count;
-            }
-            out_counts[i] = count;
+            /// Count the set filter bytes of the array with a vectorized whole-range count.
+            out_counts[i] = countBytesInFilter(&filter[pos], offsets[i] - pos);
+            pos = offsets[i];
         }
 
         return out_column;
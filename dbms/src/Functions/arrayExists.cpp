@@ -1,5 +1,6 @@
 #include <DataTypes/DataTypesNumber.h>
 #include <Columns/ColumnsNumber.h>
+#include <Columns/ColumnsCommon.h>
 #include <Functions/FunctionArrayMapped.h>
 #include <Functions/FunctionFactory.h>
 
@@ -59,17 +60,9 @@ struct ArrayExistsImpl
         size_t pos = 0;
         for (size_t i = 0; i < offsets.size(); ++i)
         {
-            UInt8 exists = 0;
-            for (; pos < offsets[i]; ++pos)
-            {
-                if (filter[pos])
-                {
-                    exists = 1;
-                    pos = offsets[i];
-                    break;
-                }
-            }
-            out_exists[i] = exists;
+            /// Scan the filter bytes of the array with a vectorized whole-range check.
+            out_exists[i] = !memoryIsZero(&filter[pos], offsets[i] - pos);
+            pos = offsets[i];
         }
 
         return out_column;
@@ -5,6 +5,10 @@
 #include <Core/ColumnNumbers.h>
 #include <Columns/ColumnNullable.h>
 
+#if USE_EMBEDDED_COMPILER
+#include <DataTypes/Native.h>
+#endif
+
 
 namespace DB
 {
@@ -50,6 +54,22 @@ public:
             block.getByPosition(result).column = DataTypeUInt8().createColumnConst(elem.column->size(), 0u);
         }
     }
+
+#if USE_EMBEDDED_COMPILER
+    bool isCompilableImpl(const DataTypes & arguments) const override
+    {
+        return canBeNativeType(*arguments[0]);
+    }
+
+    llvm::Value * compileImpl(llvm::IRBuilderBase & builder, const DataTypes & arguments, ValuePlaceholders values) const override
+    {
+        auto & b = static_cast<llvm::IRBuilder<> &>(builder);
+        if (!arguments[0]->isNullable())
+            return b.getInt8(0);
+        /// Nullable values are passed as a (value, is null) pair; the second member is the answer.
+        return b.CreateSelect(b.CreateExtractValue(values[0](), {1}), b.getInt8(1), b.getInt8(0));
+    }
+#endif
 };
 
 
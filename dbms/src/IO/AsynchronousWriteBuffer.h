@@ -4,7 +4,7 @@
 
 #include <vector>
 
-#include <common/ThreadPool.h>
+#include <Common/ThreadPool.h>
 #include <IO/WriteBuffer.h>
 
 
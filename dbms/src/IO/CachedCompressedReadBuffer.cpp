@@ -18,7 +18,7 @@ void CachedCompressedReadBuffer::initInput()
 {
     if (!file_in)
     {
-        file_in = createReadBufferFromFileBase(path, estimated_size, aio_threshold, buf_size);
+        file_in = createReadBufferFromFileBase(path, estimated_size, aio_threshold, mmap_threshold, mmap_cache, buf_size);
         compressed_in = &*file_in;
 
         if (profile_callback)
@@ -31,29 +31,62 @@ bool CachedCompressedReadBuffer::nextImpl()
 {
     /// Let's check for the presence of a decompressed block in the cache, grab the ownership of this block, if it exists.
 
-    UInt128 key = cache->hash(path, file_pos);
-    owned_cell = cache->get(key);
+    UInt128 key = UncompressedCache::hash(path, file_pos);
+
+    if (cache)
+        owned_cell = cache->get(key);
 
     if (!owned_cell)
     {
-        /// If not, read it from the file.
-        initInput();
-        file_in->seek(file_pos);
-
         owned_cell = std::make_shared<UncompressedCacheCell>();
 
         size_t size_decompressed;
         size_t size_compressed_without_checksum;
-        owned_cell->compressed_size = readCompressedData(size_decompressed, size_compressed_without_checksum);
 
-        if (owned_cell->compressed_size)
+        /// The second tier: the same block in compressed form, pinned in memory.
+        CompressedBlockCache::MappedPtr compressed_cell;
+        if (compressed_block_cache)
+            compressed_cell = compressed_block_cache->get(key);
+
+        if (compressed_cell)
         {
+            size_decompressed = compressed_cell->size_decompressed;
+            size_compressed_without_checksum = compressed_cell->size_compressed_without_checksum;
+
+            /// The checksum was verified when the block was read from the file.
+            owned_cell->compressed_size = size_compressed_without_checksum + COMPRESSED_BLOCK_CHECKSUM_SIZE;
             owned_cell->data.resize(size_decompressed + LZ4::ADDITIONAL_BYTES_AT_END_OF_BUFFER);
-            decompress(owned_cell->data.data(), size_decompressed, size_compressed_without_checksum);
+            decompressBlock(compressed_cell->data.data(), owned_cell->data.data(),
+                size_decompressed, size_compressed_without_checksum, scratch);
+        }
+        else
+        {
+            /// If not, read it from the file.
+            initInput();
+            file_in->seek(file_pos);
+
+            owned_cell->compressed_size = readCompressedData(size_decompressed, size_compressed_without_checksum);
+
+            if (owned_cell->compressed_size)
+            {
+                owned_cell->data.resize(size_decompressed + LZ4::ADDITIONAL_BYTES_AT_END_OF_BUFFER);
+                decompress(owned_cell->data.data(), size_decompressed, size_compressed_without_checksum);
+
+                if (compressed_block_cache && compressed_block_cache->admits(key))
+                {
+                    auto cell = std::make_shared<CompressedBlockCacheCell>();
+                    cell->data.resize(size_compressed_without_checksum + LZ4::ADDITIONAL_BYTES_AT_END_OF_BUFFER);
+                    memcpy(cell->data.data(), compressed_buffer, size_compressed_without_checksum);
+                    cell->size_decompressed = size_decompressed;
+                    cell->size_compressed_without_checksum = size_compressed_without_checksum;
+                    compressed_block_cache->set(key, cell);
+                }
+            }
+        }
 
-            /// Put data into cache.
+        /// Put data into cache.
+        if (cache && owned_cell->compressed_size)
             cache->set(key, owned_cell);
-        }
     }
 
     if (owned_cell->data.size() == 0)
@@ -72,9 +105,11 @@ bool CachedCompressedReadBuffer::nextImpl()
 
 CachedCompressedReadBuffer::CachedCompressedReadBuffer(
     const std::string & path_, UncompressedCache * cache_, size_t estimated_size_, size_t aio_threshold_,
-    size_t buf_size_)
-    : ReadBuffer(nullptr, 0), path(path_), cache(cache_), buf_size(buf_size_), estimated_size(estimated_size_),
-        aio_threshold(aio_threshold_), file_pos(0)
+    size_t buf_size_, size_t mmap_threshold_, MMappedFileCache * mmap_cache_,
+    CompressedBlockCache * compressed_block_cache_)
+    : ReadBuffer(nullptr, 0), path(path_), cache(cache_), compressed_block_cache(compressed_block_cache_),
+        buf_size(buf_size_), estimated_size(estimated_size_),
+        aio_threshold(aio_threshold_), mmap_threshold(mmap_threshold_), mmap_cache(mmap_cache_), file_pos(0)
 {
 }
 
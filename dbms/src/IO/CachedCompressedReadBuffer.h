@@ -5,6 +5,8 @@
 #include <IO/ReadBufferFromFileBase.h>
 #include <IO/CompressedReadBufferBase.h>
 #include <IO/UncompressedCache.h>
+#include <IO/CompressedBlockCache.h>
+#include <IO/MMappedFileCache.h>
 #include <port/clock.h>
 
 
@@ -17,15 +19,22 @@ namespace DB
   * Allows you to increase performance in cases where the same blocks are often read.
   * Disadvantages:
   * - in case you need to read a lot of data in a row, but of them only a part is cached, you have to do seek-and.
+  *
+  * Optionally backed by a second tier - the cache of compressed blocks (see CompressedBlockCache):
+  *  a block that misses the cache of decompressed blocks is looked up there by the same key and,
+  *  if found, only decompressed instead of read from disk. Either of the two caches may be absent.
   */
 class CachedCompressedReadBuffer : public CompressedReadBufferBase, public ReadBuffer
 {
 private:
     const std::string path;
     UncompressedCache * cache;
+    CompressedBlockCache * compressed_block_cache;
     size_t buf_size;
     size_t estimated_size;
     size_t aio_threshold;
+    size_t mmap_threshold;
+    MMappedFileCache * mmap_cache;
 
     std::unique_ptr<ReadBufferFromFileBase> file_in;
     size_t file_pos;
@@ -43,7 +52,9 @@ private:
 public:
     CachedCompressedReadBuffer(
         const std::string & path_, UncompressedCache * cache_, size_t estimated_size_, size_t aio_threshold_,
-        size_t buf_size_ = DBMS_DEFAULT_BUFFER_SIZE);
+        size_t buf_size_ = DBMS_DEFAULT_BUFFER_SIZE,
+        size_t mmap_threshold_ = 0, MMappedFileCache * mmap_cache_ = nullptr,
+        CompressedBlockCache * compressed_block_cache_ = nullptr);
 
 
     void seek(size_t offset_in_compressed_file, size_t offset_in_decompressed_block);
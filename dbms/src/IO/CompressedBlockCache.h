@@ -0,0 +1,187 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include <Common/LRUCache.h>
+#include <Common/SipHash.h>
+#include <Common/UInt128.h>
+#include <Common/ProfileEvents.h>
+#include <IO/BufferWithOwnMemory.h>
+
+
+namespace ProfileEvents
+{
+    extern const Event CompressedBlockCacheHits;
+    extern const Event CompressedBlockCacheMisses;
+    extern const Event CompressedBlockCacheWeightLost;
+    extern const Event CompressedBlockCacheRejectedInserts;
+}
+
+namespace DB
+{
+
+
+struct CompressedBlockCacheCell
+{
+    /// The compressed block as stored on disk, without the checksum: header, then payload.
+    /// Has LZ4::ADDITIONAL_BYTES_AT_END_OF_BUFFER of slack at the end, so that the block
+    ///  can be decompressed directly from the cell.
+    Memory data;
+    size_t size_decompressed;
+    size_t size_compressed_without_checksum;
+};
+
+struct CompressedBlockCacheWeightFunction
+{
+    size_t operator()(const CompressedBlockCacheCell & x) const
+    {
+        return x.data.size();
+    }
+};
+
+
+/** Cache of compressed blocks, pinned in memory. Thread-safe.
+  *
+  * A middle tier between the cache of decompressed blocks (UncompressedCache) and the OS page cache:
+  *  a hot set that does not fit into the uncompressed cache can still be served from memory
+  *  as compressed data, at the density of the on-disk format, and only pays for decompression.
+  * Unlike the page cache, the data cannot be evicted by unrelated activity on the machine.
+  *
+  * Keyed the same way as the uncompressed cache: by the path of the file and the offset
+  *  of the compressed block in it (see CachedCompressedReadBuffer).
+  *
+  * Admission is by access frequency, in the spirit of TinyLFU: every lookup is counted in a
+  *  small sketch of saturating counters, and a block is inserted only if it has already been
+  *  looked up before in the current window. One-pass reads - merges, mutations, large cold
+  *  scans - touch each block once and therefore never displace the hot set.
+  */
+class CompressedBlockCache : public LRUCache<UInt128, CompressedBlockCacheCell, UInt128TrivialHash, CompressedBlockCacheWeightFunction>
+{
+private:
+    using Base = LRUCache<UInt128, CompressedBlockCacheCell, UInt128TrivialHash, CompressedBlockCacheWeightFunction>;
+
+public:
+    CompressedBlockCache(size_t max_size_in_bytes, size_t num_shards = 1)
+        : Base(max_size_in_bytes, Delay::zero(), num_shards)
+        , counters(countersSize(max_size_in_bytes))
+    {
+    }
+
+    /// Calculate key from path to file and offset.
+    static UInt128 hash(const String & path_to_file, size_t offset)
+    {
+        UInt128 key;
+
+        SipHash hash;
+        hash.update(path_to_file.data(), path_to_file.size() + 1);
+        hash.update(offset);
+        hash.get128(key.low, key.high);
+
+        return key;
+    }
+
+    MappedPtr get(const Key & key)
+    {
+        recordAccess(key);
+
+        MappedPtr res = Base::get(key);
+
+        if (res)
+            ProfileEvents::increment(ProfileEvents::CompressedBlockCacheHits);
+        else
+            ProfileEvents::increment(ProfileEvents::CompressedBlockCacheMisses);
+
+        return res;
+    }
+
+    /// Whether a block that missed the cache should be inserted. The caller checks this before
+    ///  copying the block out of the read buffer, so that rejected blocks are not even copied.
+    bool admits(const Key & key) const
+    {
+        if (frequency(key) >= 2)
+            return true;
+
+        ProfileEvents::increment(ProfileEvents::CompressedBlockCacheRejectedInserts);
+        return false;
+    }
+
+private:
+    /// Counters of the frequency sketch saturate here; 4 bits of range are enough
+    ///  for an admission decision that only compares small frequencies.
+    static constexpr UInt8 max_counter = 15;
+    /// How many probes of the sketch one key makes (the estimate is their minimum).
+    static constexpr size_t num_probes = 4;
+    /// The window is this many accesses per counter; when it is over, all counters are halved,
+    ///  so the sketch tracks recent popularity rather than all history.
+    static constexpr size_t window_accesses_per_counter = 4;
+
+    /// The frequency sketch. Increments and reads are racy on purpose: the sketch is
+    ///  approximate anyway, and a lost increment only delays admission by one access.
+    mutable std::vector<std::atomic<UInt8>> counters;
+    mutable std::atomic<size_t> accesses {0};
+    mutable std::mutex age_mutex;
+
+    /// One counter per expected cache entry, with room to spare: compressed blocks are
+    ///  tens of kilobytes, so divide by a deliberately low estimate of the block size.
+    /// Power of two, so that probe positions can be taken by mask.
+    static size_t countersSize(size_t max_size_in_bytes)
+    {
+        size_t size = 1 << 16;
+        while (size < (1 << 24) && size < max_size_in_bytes / 4096)
+            size <<= 1;
+        return size;
+    }
+
+    /// The key is already a hash; derive the probe positions from its halves by double hashing.
+    size_t probe(const Key & key, size_t i) const
+    {
+        return (key.low + i * (key.high | 1)) & (counters.size() - 1);
+    }
+
+    void recordAccess(const Key & key) const
+    {
+        if (accesses.fetch_add(1, std::memory_order_relaxed) + 1 >= counters.size() * window_accesses_per_counter)
+            age();
+
+        for (size_t i = 0; i < num_probes; ++i)
+        {
+            std::atomic<UInt8> & counter = counters[probe(key, i)];
+            UInt8 value = counter.load(std::memory_order_relaxed);
+            if (value < max_counter)
+                counter.store(value + 1, std::memory_order_relaxed);
+        }
+    }
+
+    size_t frequency(const Key & key) const
+    {
+        UInt8 res = max_counter;
+        for (size_t i = 0; i < num_probes; ++i)
+            res = std::min(res, counters[probe(key, i)].load(std::memory_order_relaxed));
+        return res;
+    }
+
+    void age() const
+    {
+        std::lock_guard<std::mutex> lock(age_mutex);
+
+        /// Another thread has already aged the sketch for this window.
+        if (accesses.load(std::memory_order_relaxed) < counters.size() * window_accesses_per_counter)
+            return;
+
+        for (auto & counter : counters)
+            counter.store(counter.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+
+        accesses.store(0, std::memory_order_relaxed);
+    }
+
+    void onRemoveOverflowWeightLoss(size_t weight_loss) override
+    {
+        ProfileEvents::increment(ProfileEvents::CompressedBlockCacheWeightLost, weight_loss);
+    }
+};
+
+using CompressedBlockCachePtr = std::shared_ptr<CompressedBlockCache>;
+
+}
@@ -1,5 +1,11 @@
 #include <IO/CompressedReadBufferBase.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include <string.h>
@@ -22,6 +28,8 @@ namespace ProfileEvents
     extern const Event ReadCompressedBytes;
     extern const Event CompressedReadBufferBlocks;
     extern const Event CompressedReadBufferBytes;
+    extern const Event CompressedChecksumVerifiedBytes;
+    extern const Event CompressedChecksumDeferredBytes;
 }
 
 namespace DB
@@ -35,36 +43,292 @@ namespace ErrorCodes
     extern const int CANNOT_DECOMPRESS;
 }
 
+namespace
+{
 
-/// Read compressed data into compressed_buffer. Get size of decompressed data from block header. Checksum if need.
-/// Returns number of compressed bytes read.
-size_t CompressedReadBufferBase::readCompressedData(size_t & size_decompressed, size_t & size_compressed_without_checksum)
+template <typename T>
+void deltaDecodeImpl(const char * source, size_t size, char * dest)
 {
-    if (compressed_in->eof())
-        return 0;
+    const char * end = source + size - size % sizeof(T);
+    T accumulated{};
+    while (source < end)
+    {
+        accumulated += unalignedLoad<T>(source);
+        unalignedStore(dest, accumulated);
+        source += sizeof(T);
+        dest += sizeof(T);
+    }
 
-    CityHash_v1_0_2::uint128 checksum;
-    compressed_in->readStrict(reinterpret_cast<char *>(&checksum), sizeof(checksum));
+    /// A tail that is not a multiple of the value width is stored as is.
+    memcpy(dest, source, size % sizeof(T));
+}
 
-    own_compressed_buffer.resize(COMPRESSED_BLOCK_HEADER_SIZE);
-    compressed_in->readStrict(own_compressed_buffer.data(), COMPRESSED_BLOCK_HEADER_SIZE);
+void deltaDecode(const char * source, size_t size, UInt8 width, char * dest)
+{
+    switch (width)
+    {
+        case 1: deltaDecodeImpl<UInt8>(source, size, dest); break;
+        case 2: deltaDecodeImpl<UInt16>(source, size, dest); break;
+        case 4: deltaDecodeImpl<UInt32>(source, size, dest); break;
+        case 8: deltaDecodeImpl<UInt64>(source, size, dest); break;
+        default:
+            throw Exception("Unsupported delta width: " + toString(UInt32(width)) + ". Most likely corrupted data.",
+                ErrorCodes::CANNOT_DECOMPRESS);
+    }
+}
 
-    UInt8 method = own_compressed_buffer[0];    /// See CompressedWriteBuffer.h
+/// Payload layout - see CompressedStream.h.
+template <typename T>
+void sparseDecodeImpl(const char * source, size_t payload_size, char * dest, size_t size)
+{
+    size_t rows = size / sizeof(T);
+    size_t tail_size = size % sizeof(T);
 
-    size_t & size_compressed = size_compressed_without_checksum;
+    UInt32 count = unalignedLoad<UInt32>(source);
+    if (payload_size != sizeof(UInt32) + count * (sizeof(UInt32) + sizeof(T)) + tail_size)
+        throw Exception("Malformed sparse compressed block. Most likely corrupted data.", ErrorCodes::CANNOT_DECOMPRESS);
+
+    const char * indexes = source + sizeof(UInt32);
+    const char * values = indexes + count * sizeof(UInt32);
+
+    memset(dest, 0, size - tail_size);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        UInt32 index = unalignedLoad<UInt32>(indexes + i * sizeof(UInt32));
+        if (index >= rows)
+            throw Exception("Malformed sparse compressed block. Most likely corrupted data.", ErrorCodes::CANNOT_DECOMPRESS);
+
+        unalignedStore(dest + index * sizeof(T), unalignedLoad<T>(values + i * sizeof(T)));
+    }
+
+    /// A tail that is not a multiple of the value width is stored as is.
+    memcpy(dest + size - tail_size, values + count * sizeof(T), tail_size);
+}
+
+void sparseDecode(const char * source, size_t payload_size, UInt8 width, char * dest, size_t size)
+{
+    switch (width)
+    {
+        case 1: sparseDecodeImpl<UInt8>(source, payload_size, dest, size); break;
+        case 2: sparseDecodeImpl<UInt16>(source, payload_size, dest, size); break;
+        case 4: sparseDecodeImpl<UInt32>(source, payload_size, dest, size); break;
+        case 8: sparseDecodeImpl<UInt64>(source, payload_size, dest, size); break;
+        default:
+            throw Exception("Unsupported sparse width: " + toString(UInt32(width)) + ". Most likely corrupted data.",
+                ErrorCodes::CANNOT_DECOMPRESS);
+    }
+}
+
+}
+
+
+/** Verifies checksums of compressed blocks on a background thread.
+  * The blocks are copied into the queue, because the buffers they came from are reused.
+  * A mismatch is remembered and rethrown by 'rethrowIfFailed' on one of the subsequent reads;
+  *  if nobody asks before destruction, it is logged.
+  */
+class CompressedReadBufferBase::DeferredChecksumVerifier
+{
+public:
+    DeferredChecksumVerifier()
+        : thread([this] { threadFunction(); })
+    {
+    }
+
+    ~DeferredChecksumVerifier()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            shutdown = true;
+        }
+        condvar.notify_all();
+        thread.join();
+
+        if (exception && !exception_rethrown)
+        {
+            try
+            {
+                std::rethrow_exception(exception);
+            }
+            catch (...)
+            {
+                tryLogCurrentException("DeferredChecksumVerifier");
+            }
+        }
+    }
+
+    /// Queue a block for verification. Returns false if the queue is full
+    ///  (the thread cannot keep up); the caller then has to verify inline.
+    bool trySubmit(const char * data, size_t size, const char * expected_checksum)
+    {
+        PendingBlock block;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+
+            if (queue.size() >= max_pending_blocks)
+                return false;
+
+            if (!spare_buffers.empty())
+            {
+                block.data.swap(spare_buffers.back());
+                spare_buffers.pop_back();
+            }
+        }
+
+        block.data.resize(size);
+        memcpy(block.data.data(), data, size);
+        memcpy(block.expected_checksum, expected_checksum, sizeof(block.expected_checksum));
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.emplace_back(std::move(block));
+        }
+        condvar.notify_all();
+
+        ProfileEvents::increment(ProfileEvents::CompressedChecksumDeferredBytes, size);
+        return true;
+    }
+
+    /// Rethrow a checksum mismatch found by the background thread, if any.
+    void rethrowIfFailed()
+    {
+        if (failed.load(std::memory_order_relaxed))
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            exception_rethrown = true;
+            std::rethrow_exception(exception);
+        }
+    }
+
+private:
+    struct PendingBlock
+    {
+        PODArray<char> data;
+        char expected_checksum[16];
+    };
+
+    /// Bounds the memory held by copies of not yet verified blocks.
+    static constexpr size_t max_pending_blocks = 16;
+
+    std::mutex mutex;
+    std::condition_variable condvar;
+    std::deque<PendingBlock> queue;
+    std::vector<PODArray<char>> spare_buffers;
+    bool shutdown = false;
+
+    std::atomic<bool> failed{false};
+    std::exception_ptr exception;
+    bool exception_rethrown = false;
+
+    std::thread thread;
+
+    void threadFunction()
+    {
+        while (true)
+        {
+            PendingBlock block;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condvar.wait(lock, [this] { return shutdown || !queue.empty(); });
+
+                /// On shutdown, the remaining blocks are still verified, to report (at least log)
+                ///  a corruption that was read just before the end of the stream.
+                if (queue.empty())
+                    return;
+
+                block = std::move(queue.front());
+                queue.pop_front();
+            }
+
+            try
+            {
+                checkChecksum(block.data.data(), block.data.size(), block.expected_checksum);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!exception)
+                    exception = std::current_exception();
+                failed.store(true, std::memory_order_relaxed);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                spare_buffers.emplace_back(std::move(block.data));
+            }
+        }
+    }
+};
+
+
+void CompressedReadBufferBase::deferChecksumming()
+{
+    if (!deferred_verifier)
+        deferred_verifier = std::make_unique<DeferredChecksumVerifier>();
+}
+
+
+/// Parse the header of a compressed block: check the method byte and extract the sizes.
+void CompressedReadBufferBase::parseCompressedBlockHeader(const char * header, size_t & size_compressed, size_t & size_decompressed)
+{
+    UInt8 method = header[0];    /// See CompressedWriteBuffer.h
 
     if (method == static_cast<UInt8>(CompressionMethodByte::LZ4) ||
         method == static_cast<UInt8>(CompressionMethodByte::ZSTD) ||
-        method == static_cast<UInt8>(CompressionMethodByte::NONE))
+        method == static_cast<UInt8>(CompressionMethodByte::NONE) ||
+        method == static_cast<UInt8>(CompressionMethodByte::Delta) ||
+        method == static_cast<UInt8>(CompressionMethodByte::Sparse))
     {
-        size_compressed = unalignedLoad<UInt32>(&own_compressed_buffer[1]);
-        size_decompressed = unalignedLoad<UInt32>(&own_compressed_buffer[5]);
+        size_compressed = unalignedLoad<UInt32>(header + 1);
+        size_decompressed = unalignedLoad<UInt32>(header + 5);
     }
     else
         throw Exception("Unknown compression method: " + toString(method), ErrorCodes::UNKNOWN_COMPRESSION_METHOD);
 
     if (size_compressed > DBMS_MAX_COMPRESSED_SIZE)
         throw Exception("Too large size_compressed: " + toString(size_compressed) + ". Most likely corrupted data.", ErrorCodes::TOO_LARGE_SIZE_COMPRESSED);
+}
+
+
+/// Verify the checksum of a compressed block. 'expected_checksum' points to the 16 bytes stored in the file.
+void CompressedReadBufferBase::checkChecksum(const char * data, size_t size, const char * expected_checksum)
+{
+    CityHash_v1_0_2::uint128 checksum;
+    memcpy(&checksum, expected_checksum, sizeof(checksum));
+
+    ProfileEvents::increment(ProfileEvents::CompressedChecksumVerifiedBytes, size);
+
+    auto checksum_calculated = CityHash_v1_0_2::CityHash128(data, size);
+    if (checksum != checksum_calculated)
+        throw Exception("Checksum doesn't match: corrupted data."
+            " Reference: " + getHexUIntLowercase(checksum.first) + getHexUIntLowercase(checksum.second)
+            + ". Actual: " + getHexUIntLowercase(checksum_calculated.first) + getHexUIntLowercase(checksum_calculated.second)
+            + ". Size of compressed block: " + toString(size) + ".",
+            ErrorCodes::CHECKSUM_DOESNT_MATCH);
+}
+
+
+/// Read compressed data into compressed_buffer. Get size of decompressed data from block header. Checksum if need.
+/// Returns number of compressed bytes read.
+size_t CompressedReadBufferBase::readCompressedData(size_t & size_decompressed, size_t & size_compressed_without_checksum)
+{
+    if (deferred_verifier)
+        deferred_verifier->rethrowIfFailed();
+
+    if (compressed_in->eof())
+        return 0;
+
+    CityHash_v1_0_2::uint128 checksum;
+    compressed_in->readStrict(reinterpret_cast<char *>(&checksum), sizeof(checksum));
+
+    own_compressed_buffer.resize(COMPRESSED_BLOCK_HEADER_SIZE);
+    compressed_in->readStrict(own_compressed_buffer.data(), COMPRESSED_BLOCK_HEADER_SIZE);
+
+    size_t & size_compressed = size_compressed_without_checksum;
+    parseCompressedBlockHeader(own_compressed_buffer.data(), size_compressed, size_decompressed);
 
     ProfileEvents::increment(ProfileEvents::ReadCompressedBytes, size_compressed + sizeof(checksum));
 
@@ -85,20 +349,17 @@ size_t CompressedReadBufferBase::readCompressedData(size_t & size_decompressed,
 
     if (!disable_checksum)
     {
-        auto checksum_calculated = CityHash_v1_0_2::CityHash128(compressed_buffer, size_compressed);
-        if (checksum != checksum_calculated)
-            throw Exception("Checksum doesn't match: corrupted data."
-                " Reference: " + getHexUIntLowercase(checksum.first) + getHexUIntLowercase(checksum.second)
-                + ". Actual: " + getHexUIntLowercase(checksum_calculated.first) + getHexUIntLowercase(checksum_calculated.second)
-                + ". Size of compressed block: " + toString(size_compressed) + ".",
-                ErrorCodes::CHECKSUM_DOESNT_MATCH);
+        if (!deferred_verifier
+            || !deferred_verifier->trySubmit(compressed_buffer, size_compressed, reinterpret_cast<const char *>(&checksum)))
+            checkChecksum(compressed_buffer, size_compressed, reinterpret_cast<const char *>(&checksum));
     }
 
     return size_compressed + sizeof(checksum);
 }
 
 
-void CompressedReadBufferBase::decompress(char * to, size_t size_decompressed, size_t size_compressed_without_checksum)
+void CompressedReadBufferBase::decompressBlock(const char * compressed_buffer, char * to, size_t size_decompressed,
+    size_t size_compressed_without_checksum, DecompressScratch & scratch)
 {
     ProfileEvents::increment(ProfileEvents::CompressedReadBufferBlocks);
     ProfileEvents::increment(ProfileEvents::CompressedReadBufferBytes, size_decompressed);
@@ -107,7 +368,7 @@ void CompressedReadBufferBase::decompress(char * to, size_t size_decompressed, s
 
     if (method == static_cast<UInt8>(CompressionMethodByte::LZ4))
     {
-        LZ4::decompress(compressed_buffer + COMPRESSED_BLOCK_HEADER_SIZE, to, size_compressed_without_checksum, size_decompressed, lz4_stat);
+        LZ4::decompress(compressed_buffer + COMPRESSED_BLOCK_HEADER_SIZE, to, size_compressed_without_checksum, size_decompressed, scratch.lz4_stat);
     }
     else if (method == static_cast<UInt8>(CompressionMethodByte::ZSTD))
     {
@@ -122,11 +383,38 @@ void CompressedReadBufferBase::decompress(char * to, size_t size_decompressed, s
     {
         memcpy(to, &compressed_buffer[COMPRESSED_BLOCK_HEADER_SIZE], size_decompressed);
     }
+    else if (method == static_cast<UInt8>(CompressionMethodByte::Delta))
+    {
+        UInt8 delta_width = compressed_buffer[COMPRESSED_BLOCK_HEADER_SIZE];
+
+        scratch.delta_decode_buffer.resize(size_decompressed + LZ4::ADDITIONAL_BYTES_AT_END_OF_BUFFER);
+        LZ4::decompress(compressed_buffer + COMPRESSED_BLOCK_HEADER_SIZE + 1, scratch.delta_decode_buffer.data(),
+            size_compressed_without_checksum - COMPRESSED_BLOCK_HEADER_SIZE - 1, size_decompressed, scratch.lz4_stat);
+
+        deltaDecode(scratch.delta_decode_buffer.data(), size_decompressed, delta_width, to);
+    }
+    else if (method == static_cast<UInt8>(CompressionMethodByte::Sparse))
+    {
+        UInt8 sparse_width = compressed_buffer[COMPRESSED_BLOCK_HEADER_SIZE];
+        UInt32 payload_size = unalignedLoad<UInt32>(&compressed_buffer[COMPRESSED_BLOCK_HEADER_SIZE + 1]);
+
+        scratch.sparse_decode_buffer.resize(payload_size + LZ4::ADDITIONAL_BYTES_AT_END_OF_BUFFER);
+        LZ4::decompress(compressed_buffer + COMPRESSED_BLOCK_HEADER_SIZE + 1 + sizeof(UInt32), scratch.sparse_decode_buffer.data(),
+            size_compressed_without_checksum - COMPRESSED_BLOCK_HEADER_SIZE - 1 - sizeof(UInt32), payload_size, scratch.lz4_stat);
+
+        sparseDecode(scratch.sparse_decode_buffer.data(), payload_size, sparse_width, to, size_decompressed);
+    }
     else
         throw Exception("Unknown compression method: " + toString(method), ErrorCodes::UNKNOWN_COMPRESSION_METHOD);
 }
 
 
+void CompressedReadBufferBase::decompress(char * to, size_t size_decompressed, size_t size_compressed_without_checksum)
+{
+    decompressBlock(compressed_buffer, to, size_decompressed, size_compressed_without_checksum, scratch);
+}
+
+
 /// 'compressed_in' could be initialized lazily, but before first call of 'readCompressedData'.
 CompressedReadBufferBase::CompressedReadBufferBase(ReadBuffer * in)
     : compressed_in(in), own_compressed_buffer(COMPRESSED_BLOCK_HEADER_SIZE)
@@ -2,6 +2,7 @@
 
 #include <Common/PODArray.h>
 #include <IO/LZ4_decompress_faster.h>
+#include <memory>
 
 
 namespace DB
@@ -15,6 +16,19 @@ class ReadBuffer;
 class CompressedReadBufferBase
 {
 protected:
+    /// Scratch state needed to decompress one block. Separated from the buffer itself,
+    ///  so that blocks can also be decompressed on helper threads, each with its own scratch.
+    struct DecompressScratch
+    {
+        /// Scratch buffer for the Delta method: holds LZ4-decompressed deltas before they are accumulated into values.
+        PODArray<char> delta_decode_buffer;
+
+        /// Scratch buffer for the Sparse method: holds the LZ4-decompressed sparse payload before it is densified.
+        PODArray<char> sparse_decode_buffer;
+
+        LZ4::PerformanceStatistics lz4_stat;
+    };
+
     ReadBuffer * compressed_in;
 
     /// If 'compressed_in' buffer has whole compressed block - then use it. Otherwise copy parts of data to 'own_compressed_buffer'.
@@ -25,9 +39,24 @@ protected:
     /// Don't checksum on decompressing.
     bool disable_checksum = false;
 
-    LZ4::PerformanceStatistics lz4_stat;
+    /// If set, checksums are not verified on the reading thread: the compressed blocks are queued
+    ///  to a background thread, and a mismatch is reported on one of the subsequent reads.
+    class DeferredChecksumVerifier;
+    std::unique_ptr<DeferredChecksumVerifier> deferred_verifier;
+
+    DecompressScratch scratch;
 
 
+    /// Parse the header of a compressed block: check the method byte and extract the sizes.
+    static void parseCompressedBlockHeader(const char * header, size_t & size_compressed, size_t & size_decompressed);
+
+    /// Verify the checksum of a compressed block. 'expected_checksum' points to the 16 bytes stored in the file.
+    static void checkChecksum(const char * data, size_t size, const char * expected_checksum);
+
+    /// Decompress one block. Can be called from any thread, as long as each thread has its own scratch.
+    static void decompressBlock(const char * compressed_buffer, char * to, size_t size_decompressed,
+        size_t size_compressed_without_checksum, DecompressScratch & scratch);
+
     /// Read compressed data into compressed_buffer. Get size of decompressed data from block header. Checksum if need.
     /// Returns number of compressed bytes read.
     size_t readCompressedData(size_t & size_decompressed, size_t & size_compressed_without_checksum);
@@ -47,6 +76,13 @@ public:
     {
         disable_checksum = true;
     }
+
+    /** Defer checksum verification to a background thread, so the reading thread does not stall
+      *  on hashing every block. A mismatch is thrown from one of the subsequent reads; if the
+      *  stream is destroyed before the mismatch is consumed, it is only logged.
+      * Do not combine with caches of decompressed blocks: a broken block must not be cached.
+      */
+    void deferChecksumming();
 };
 
 }
@@ -3,19 +3,65 @@
 #include <IO/WriteHelpers.h>
 #include <IO/CompressedStream.h>
 #include <IO/LZ4_decompress_faster.h>
+#include <Common/ProfileEvents.h>
+#include <Common/Exception.h>
 
 
+namespace ProfileEvents
+{
+    extern const Event ReadCompressedBytes;
+}
+
 namespace DB
 {
 
 namespace ErrorCodes
 {
     extern const int SEEK_POSITION_OUT_OF_BOUND;
+    extern const int LOGICAL_ERROR;
+}
+
+namespace
+{
+    /// CityHash128 of the compressed block, stored before its header.
+    constexpr size_t CHECKSUM_SIZE = 16;
 }
 
 
 bool CompressedReadBufferFromFile::nextImpl()
 {
+    if (!decode_ring.empty())
+    {
+        /// Return the slot of the block that has just been drained to the ring.
+        if (current_decode_block)
+        {
+            std::lock_guard<std::mutex> lock(decode_mutex);
+            current_decode_block->status = DecodeAheadBlock::READY_TO_FILL;
+            current_decode_block = nullptr;
+        }
+
+        fillDecodeRing();
+
+        /// Nothing was filled: the file is exhausted.
+        if (decode_consume_index == decode_fill_index)
+            return false;
+
+        DecodeAheadBlock & block = *decode_ring[decode_consume_index % decode_ring.size()];
+        {
+            std::unique_lock<std::mutex> lock(decode_mutex);
+            decode_cv.wait(lock, [&] { return block.status == DecodeAheadBlock::READY; });
+        }
+
+        if (block.exception)
+            std::rethrow_exception(block.exception);
+
+        ++decode_consume_index;
+        current_decode_block = &block;
+        working_buffer = Buffer(block.decompressed.data(), block.decompressed.data() + block.size_decompressed);
+        size_compressed = 0;    /// file_in does not point to the end of the block in working_buffer.
+        return true;
+    }
+
     size_t size_decompressed;
     size_t size_compressed_without_checksum;
     size_compressed = readCompressedData(size_decompressed, size_compressed_without_checksum);
@@ -32,17 +78,206 @@ bool CompressedReadBufferFromFile::nextImpl()
 
 
 CompressedReadBufferFromFile::CompressedReadBufferFromFile(
-    const std::string & path, size_t estimated_size, size_t aio_threshold, size_t buf_size)
+    const std::string & path, size_t estimated_size, size_t aio_threshold, size_t buf_size,
+    size_t mmap_threshold, MMappedFileCache * mmap_cache)
     : BufferWithOwnMemory<ReadBuffer>(0),
-        p_file_in(createReadBufferFromFileBase(path, estimated_size, aio_threshold, buf_size)),
+        p_file_in(createReadBufferFromFileBase(path, estimated_size, aio_threshold, mmap_threshold, mmap_cache, buf_size)),
         file_in(*p_file_in)
 {
     compressed_in = &file_in;
 }
 
 
+CompressedReadBufferFromFile::~CompressedReadBufferFromFile()
+{
+    if (decode_pool)
+    {
+        try
+        {
+            decode_pool->wait();
+        }
+        catch (...)
+        {
+            tryLogCurrentException(__PRETTY_FUNCTION__);
+        }
+    }
+}
+
+
+void CompressedReadBufferFromFile::setDecompressAhead(size_t num_blocks)
+{
+    if (num_blocks == 0 || !decode_ring.empty())
+        return;
+
+    if (count())
+        throw Exception("Decode-ahead can only be enabled before reading starts", ErrorCodes::LOGICAL_ERROR);
+
+    decode_ring.reserve(num_blocks);
+    for (size_t i = 0; i < num_blocks; ++i)
+        decode_ring.emplace_back(std::make_unique<DecodeAheadBlock>());
+
+    decode_pool = std::make_unique<ThreadPool>(num_blocks);
+}
+
+
+bool CompressedReadBufferFromFile::fillDecodeSlot(DecodeAheadBlock & block)
+{
+    if (file_in.eof())
+        return false;
+
+    block.offset_in_compressed_file = file_in.getPositionInFile();
+
+    block.compressed.resize(CHECKSUM_SIZE + COMPRESSED_BLOCK_HEADER_SIZE);
+    file_in.readStrict(block.compressed.data(), CHECKSUM_SIZE + COMPRESSED_BLOCK_HEADER_SIZE);
+
+    parseCompressedBlockHeader(block.compressed.data() + CHECKSUM_SIZE,
+        block.size_compressed_without_checksum, block.size_decompressed);
+
+    ProfileEvents::increment(ProfileEvents::ReadCompressedBytes, block.size_compressed_without_checksum + CHECKSUM_SIZE);
+
+    block.compressed.resize(CHECKSUM_SIZE + block.size_compressed_without_checksum + LZ4::ADDITIONAL_BYTES_AT_END_OF_BUFFER);
+    file_in.readStrict(block.compressed.data() + CHECKSUM_SIZE + COMPRESSED_BLOCK_HEADER_SIZE,
+        block.size_compressed_without_checksum - COMPRESSED_BLOCK_HEADER_SIZE);
+
+    return true;
+}
+
+
+void CompressedReadBufferFromFile::fillDecodeRing()
+{
+    while (!decode_eof)
+    {
+        DecodeAheadBlock & block = *decode_ring[decode_fill_index % decode_ring.size()];
+
+        {
+            std::lock_guard<std::mutex> lock(decode_mutex);
+            if (block.status != DecodeAheadBlock::READY_TO_FILL)
+                break;    /// The ring is full.
+        }
+
+        if (!fillDecodeSlot(block))
+        {
+            decode_eof = true;
+            break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(decode_mutex);
+            block.status = DecodeAheadBlock::DECODING;
+        }
+        ++decode_fill_index;
+
+        decode_pool->schedule([this, &block] { decodeSlot(block); });
+    }
+}
+
+
+void CompressedReadBufferFromFile::decodeSlot(DecodeAheadBlock & block)
+{
+    try
+    {
+        if (!disable_checksum)
+            checkChecksum(block.compressed.data() + CHECKSUM_SIZE, block.size_compressed_without_checksum, block.compressed.data());
+
+        block.decompressed.resize(block.size_decompressed + LZ4::ADDITIONAL_BYTES_AT_END_OF_BUFFER);
+        decompressBlock(block.compressed.data() + CHECKSUM_SIZE, block.decompressed.data(),
+            block.size_decompressed, block.size_compressed_without_checksum, block.scratch);
+    }
+    catch (...)
+    {
+        block.exception = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(decode_mutex);
+        block.status = DecodeAheadBlock::READY;
+    }
+    decode_cv.notify_all();
+}
+
+
+void CompressedReadBufferFromFile::resetDecodeRing()
+{
+    std::unique_lock<std::mutex> lock(decode_mutex);
+
+    for (auto & block_ptr : decode_ring)
+    {
+        DecodeAheadBlock & block = *block_ptr;
+        decode_cv.wait(lock, [&] { return block.status != DecodeAheadBlock::DECODING; });
+        block.status = DecodeAheadBlock::READY_TO_FILL;
+        block.exception = nullptr;
+    }
+
+    decode_consume_index = 0;
+    decode_fill_index = 0;
+    decode_eof = false;
+    current_decode_block = nullptr;
+}
+
+
 void CompressedReadBufferFromFile::seek(size_t offset_in_compressed_file, size_t offset_in_decompressed_block)
 {
+    if (!decode_ring.empty())
+    {
+        /// Within the current block.
+        if (current_decode_block
+            && offset_in_compressed_file == current_decode_block->offset_in_compressed_file
+            && offset_in_decompressed_block <= working_buffer.size())
+        {
+            bytes += offset();
+            pos = working_buffer.begin() + offset_in_decompressed_block;
+            bytes -= offset();
+            return;
+        }
+
+        bytes += offset();
+
+        /// Discard the decoded blocks before the target. If the target block is not in the ring,
+        ///  throw everything away and continue from the target position.
+        bool target_is_in_ring = false;
+        {
+            std::unique_lock<std::mutex> lock(decode_mutex);
+            while (decode_consume_index != decode_fill_index)
+            {
+                DecodeAheadBlock & block = *decode_ring[decode_consume_index % decode_ring.size()];
+                if (block.offset_in_compressed_file == offset_in_compressed_file)
+                {
+                    target_is_in_ring = true;
+                    break;
+                }
+
+                decode_cv.wait(lock, [&] { return block.status == DecodeAheadBlock::READY; });
+                block.status = DecodeAheadBlock::READY_TO_FILL;
+                block.exception = nullptr;
+                ++decode_consume_index;
+            }
+        }
+
+        if (!target_is_in_ring)
+        {
+            resetDecodeRing();
+            file_in.seek(offset_in_compressed_file);
+        }
+
+        if (current_decode_block)
+        {
+            std::lock_guard<std::mutex> lock(decode_mutex);
+            current_decode_block->status = DecodeAheadBlock::READY_TO_FILL;
+            current_decode_block = nullptr;
+        }
+
+        nextImpl();
+
+        if (offset_in_decompressed_block > working_buffer.size())
+            throw Exception("Seek position is beyond the decompressed block"
+            " (pos: " + toString(offset_in_decompressed_block) + ", block size: " + toString(working_buffer.size()) + ")",
+            ErrorCodes::SEEK_POSITION_OUT_OF_BOUND);
+
+        pos = working_buffer.begin() + offset_in_decompressed_block;
+        bytes -= offset();
+        return;
+    }
+
     if (size_compressed &&
         offset_in_compressed_file == file_in.getPositionInFile() - size_compressed &&
         offset_in_decompressed_block <= working_buffer.size())
@@ -72,6 +307,11 @@ void CompressedReadBufferFromFile::seek(size_t offset_in_compressed_file, size_t
 
 size_t CompressedReadBufferFromFile::readBig(char * to, size_t n)
 {
+    /// In decode-ahead mode, the blocks are already decompressed into the ring buffers,
+    ///  so there is no block to decompress directly into `to`; plain copying is the best we can do.
+    if (!decode_ring.empty())
+        return read(to, n);
+
     size_t bytes_read = 0;
 
     /// If there are unread bytes in the buffer, then we copy needed to `to`.
@@ -2,14 +2,21 @@
 
 #include <IO/CompressedReadBufferBase.h>
 #include <IO/ReadBufferFromFileBase.h>
+#include <Common/PODArray.h>
+#include <Common/ThreadPool.h>
+#include <condition_variable>
+#include <mutex>
 #include <time.h>
 #include <memory>
+#include <vector>
 #include <port/clock.h>
 
 
 namespace DB
 {
 
+class MMappedFileCache;
+
 
 /// Unlike CompressedReadBuffer, it can do seek.
 class CompressedReadBufferFromFile : public CompressedReadBufferBase, public BufferWithOwnMemory<ReadBuffer>
@@ -26,11 +33,71 @@ private:
     ReadBufferFromFileBase & file_in;
     size_t size_compressed = 0;
 
+    /** Decode-ahead mode: the next blocks are read, checksummed and decompressed by a pool
+      *  of helper threads into a ring of buffers, while the consumer drains the current one.
+      * Blocks are consumed from the ring in file order.
+      */
+    struct DecodeAheadBlock
+    {
+        enum Status
+        {
+            READY_TO_FILL,    /// The slot is free; the consumer thread may read the next compressed block into it.
+            DECODING,         /// A helper thread is checksumming and decompressing the block.
+            READY,            /// The decompressed block (or an exception) is ready to be consumed.
+        };
+
+        Status status = READY_TO_FILL;
+
+        /// Checksum and compressed block as stored in the file.
+        PODArray<char> compressed;
+        PODArray<char> decompressed;
+        DecompressScratch scratch;
+
+        size_t size_decompressed = 0;
+        size_t size_compressed_without_checksum = 0;
+        /// Position of the block (its checksum) in the file.
+        size_t offset_in_compressed_file = 0;
+
+        std::exception_ptr exception;
+    };
+
+    std::vector<std::unique_ptr<DecodeAheadBlock>> decode_ring;
+    std::unique_ptr<ThreadPool> decode_pool;
+
+    std::mutex decode_mutex;
+    std::condition_variable decode_cv;
+
+    /// Index (monotonic, modulo ring size) of the next slot to consume and the next slot to fill.
+    size_t decode_consume_index = 0;
+    size_t decode_fill_index = 0;
+    /// The end of the file was reached while filling the ring.
+    bool decode_eof = false;
+    /// The slot whose decompressed buffer is the current working_buffer.
+    DecodeAheadBlock * current_decode_block = nullptr;
+
     bool nextImpl() override;
 
+    /// Read the next compressed block from the file into the slot. Returns false at the end of the file.
+    bool fillDecodeSlot(DecodeAheadBlock & block);
+    /// Fill free ring slots and schedule their decompression, until the ring is full or the file ends.
+    void fillDecodeRing();
+    /// Checksum and decompress one slot. Called from helper threads.
+    void decodeSlot(DecodeAheadBlock & block);
+    /// Wait for all scheduled decompressions and mark all slots free (e.g. before a seek to another position).
+    void resetDecodeRing();
+
 public:
     CompressedReadBufferFromFile(
-        const std::string & path, size_t estimated_size, size_t aio_threshold, size_t buf_size = DBMS_DEFAULT_BUFFER_SIZE);
+        const std::string & path, size_t estimated_size, size_t aio_threshold, size_t buf_size = DBMS_DEFAULT_BUFFER_SIZE,
+        size_t mmap_threshold = 0, MMappedFileCache * mmap_cache = nullptr);
+
+    ~CompressedReadBufferFromFile() override;
+
+    /** Enable decode-ahead with a ring of `num_blocks` buffers and as many helper threads.
+      * Worthwhile for sequential reads (merges, full scans); a seek to a position outside
+      *  the ring throws the decoded blocks away. Must be called before reading starts.
+      */
+    void setDecompressAhead(size_t num_blocks);
 
     void seek(size_t offset_in_compressed_file, size_t offset_in_decompressed_block);
 
@@ -8,6 +8,9 @@
 
 #define COMPRESSED_BLOCK_HEADER_SIZE 9
 
+/// The CityHash128 of the block, stored in the file before the header.
+#define COMPRESSED_BLOCK_CHECKSUM_SIZE 16
+
 
 namespace DB
 {
@@ -19,6 +22,8 @@ enum class CompressionMethod
     LZ4HC = 2,        /// The format is the same as for LZ4. The difference is only in compression.
     ZSTD = 3,         /// Experimental algorithm: https://github.com/Cyan4973/zstd
     NONE = 4,         /// No compression
+    Delta = 5,        /// Delta encoding of fixed-width values followed by LZ4. For timestamps and slowly changing gauges.
+    Sparse = 6,       /// Stores only the non-default (non-zero) values with their row numbers, followed by LZ4. For columns dominated by zeros.
 };
 
 /** The compressed block format is as follows:
@@ -39,6 +44,15 @@ enum class CompressionMethod
   *
   * 0x90 - ZSTD
   *
+  * 0x92 - Delta. After the sizes, one byte is the width of the value in bytes (1, 2, 4 or 8),
+  *        then the differences of consecutive values, compressed with LZ4.
+  *        The first value of a block is stored as is; a tail that is not a multiple of the width is not encoded.
+  *
+  * 0x93 - Sparse. After the sizes, one byte is the width of the value in bytes (1, 2, 4 or 8)
+  *        and 4 bytes is the size of the payload before compression. The payload, compressed with LZ4, is:
+  *        the number of non-default (non-zero) values (4 bytes), their row numbers (4 bytes each), their values,
+  *        and a tail of the block that is not a multiple of the width, as is.
+  *
   * All sizes are little endian.
   */
 
@@ -47,6 +61,8 @@ enum class CompressionMethodByte : uint8_t
     NONE     = 0x02,
     LZ4      = 0x82,
     ZSTD     = 0x90,
+    Delta    = 0x92,
+    Sparse   = 0x93,
 };
 
 }
@@ -6,7 +6,9 @@
 #include <string.h>
 
 #include <common/unaligned.h>
+#include <common/logger_useful.h>
 #include <Core/Types.h>
+#include <Common/Stopwatch.h>
 
 #include <IO/CompressedWriteBuffer.h>
 
@@ -20,6 +22,109 @@ namespace ErrorCodes
     extern const int UNKNOWN_COMPRESSION_METHOD;
 }
 
+namespace
+{
+
+template <typename T>
+void deltaEncodeImpl(const char * source, size_t size, char * dest)
+{
+    const char * end = source + size - size % sizeof(T);
+    T prev = 0;
+    while (source < end)
+    {
+        T curr = unalignedLoad<T>(source);
+        unalignedStore(dest, static_cast<T>(curr - prev));
+        prev = curr;
+        source += sizeof(T);
+        dest += sizeof(T);
+    }
+
+    /// A tail that is not a multiple of the value width is stored as is.
+    memcpy(dest, source, size % sizeof(T));
+}
+
+void deltaEncode(const char * source, size_t size, UInt8 width, char * dest)
+{
+    switch (width)
+    {
+        case 1: deltaEncodeImpl<UInt8>(source, size, dest); break;
+        case 2: deltaEncodeImpl<UInt16>(source, size, dest); break;
+        case 4: deltaEncodeImpl<UInt32>(source, size, dest); break;
+        case 8: deltaEncodeImpl<UInt64>(source, size, dest); break;
+        default:
+            throw Exception("Unsupported delta width: " + std::to_string(width), ErrorCodes::CANNOT_COMPRESS);
+    }
+}
+
+template <typename T>
+size_t sparseCountNonDefaultImpl(const char * source, size_t size)
+{
+    const char * end = source + size - size % sizeof(T);
+    size_t res = 0;
+    for (; source < end; source += sizeof(T))
+        if (unalignedLoad<T>(source) != T(0))
+            ++res;
+    return res;
+}
+
+size_t sparseCountNonDefault(const char * source, size_t size, UInt8 width)
+{
+    switch (width)
+    {
+        case 1: return sparseCountNonDefaultImpl<UInt8>(source, size);
+        case 2: return sparseCountNonDefaultImpl<UInt16>(source, size);
+        case 4: return sparseCountNonDefaultImpl<UInt32>(source, size);
+        case 8: return sparseCountNonDefaultImpl<UInt64>(source, size);
+        default:
+            throw Exception("Unsupported sparse width: " + std::to_string(width), ErrorCodes::CANNOT_COMPRESS);
+    }
+}
+
+/// Payload layout - see CompressedStream.h. Returns the payload size.
+template <typename T>
+size_t sparseEncodeImpl(const char * source, size_t size, size_t non_default_count, char * dest)
+{
+    size_t rows = size / sizeof(T);
+
+    unalignedStore(dest, static_cast<UInt32>(non_default_count));
+
+    char * indexes = dest + sizeof(UInt32);
+    char * values = indexes + non_default_count * sizeof(UInt32);
+
+    for (size_t i = 0; i < rows; ++i)
+    {
+        T curr = unalignedLoad<T>(source + i * sizeof(T));
+        if (curr != T(0))
+        {
+            unalignedStore(indexes, static_cast<UInt32>(i));
+            indexes += sizeof(UInt32);
+            unalignedStore(values, curr);
+            values += sizeof(T);
+        }
+    }
+
+    /// A tail that is not a multiple of the value width is stored as is.
+    size_t tail_size = size % sizeof(T);
+    memcpy(values, source + size - tail_size, tail_size);
+
+    return values + tail_size - dest;
+}
+
+size_t sparseEncode(const char * source, size_t size, UInt8 width, size_t non_default_count, char * dest)
+{
+    switch (width)
+    {
+        case 1: return sparseEncodeImpl<UInt8>(source, size, non_default_count, dest);
+        case 2: return sparseEncodeImpl<UInt16>(source, size, non_default_count, dest);
+        case 4: return sparseEncodeImpl<UInt32>(source, size, non_default_count, dest);
+        case 8: return sparseEncodeImpl<UInt64>(source, size, non_default_count, dest);
+        default:
+            throw Exception("Unsupported sparse width: " + std::to_string(width), ErrorCodes::CANNOT_COMPRESS);
+    }
+}
+
+}
+
 
 void CompressedWriteBuffer::nextImpl()
 {
@@ -33,7 +138,26 @@ void CompressedWriteBuffer::nextImpl()
     /** The format of compressed block - see CompressedStream.h
       */
 
-    switch (compression_settings.method)
+    CompressionMethod method = compression_settings.method;
+    size_t sparse_non_default_count = 0;
+
+    bool adaptive = compression_settings.adaptive_level
+        && (method == CompressionMethod::LZ4 || method == CompressionMethod::ZSTD);
+
+    Stopwatch watch;
+
+    if (method == CompressionMethod::Sparse)
+    {
+        size_t rows = uncompressed_size / compression_settings.sparse_width;
+        sparse_non_default_count = sparseCountNonDefault(working_buffer.begin(), uncompressed_size, compression_settings.sparse_width);
+
+        /// The sparse format pays off only when default values dominate; otherwise fall back to LZ4 for this block.
+        /// Blocks of different methods can be mixed in one stream: the reader dispatches on the method byte.
+        if (rows == 0 || rows - sparse_non_default_count < rows * compression_settings.sparse_min_default_ratio)
+            method = CompressionMethod::LZ4;
+    }
+
+    switch (method)
     {
         case CompressionMethod::LZ4:
         case CompressionMethod::LZ4HC:
@@ -47,12 +171,14 @@ void CompressedWriteBuffer::nextImpl()
 
             compressed_buffer[0] = static_cast<char>(CompressionMethodByte::LZ4);
 
-            if (compression_settings.method == CompressionMethod::LZ4)
-                compressed_size = header_size + LZ4_compress_default(
+            if (method == CompressionMethod::LZ4)
+                /// lz4_acceleration stays at 1 (= LZ4_compress_default) unless adaptive_level is set.
+                compressed_size = header_size + LZ4_compress_fast(
                     working_buffer.begin(),
                     &compressed_buffer[header_size],
                     uncompressed_size,
-                    LZ4_COMPRESSBOUND(uncompressed_size));
+                    LZ4_COMPRESSBOUND(uncompressed_size),
+                    lz4_acceleration);
             else
                 compressed_size = header_size + LZ4_compress_HC(
                     working_buffer.begin(),
@@ -83,7 +209,7 @@ void CompressedWriteBuffer::nextImpl()
                 compressed_buffer.size() - header_size,
                 working_buffer.begin(),
                 uncompressed_size,
-                compression_settings.level);
+                adaptive ? zstd_level : compression_settings.level);
 
             if (ZSTD_isError(res))
                 throw Exception("Cannot compress block with ZSTD: " + std::string(ZSTD_getErrorName(res)), ErrorCodes::CANNOT_COMPRESS);
@@ -99,6 +225,71 @@ void CompressedWriteBuffer::nextImpl()
             compressed_buffer_ptr = compressed_buffer.data();
             break;
         }
+        case CompressionMethod::Delta:
+        {
+            static constexpr size_t header_size = 1 + sizeof(UInt32) + sizeof(UInt32);
+
+            delta_buffer.resize(uncompressed_size);
+            deltaEncode(working_buffer.begin(), uncompressed_size, compression_settings.delta_width, delta_buffer.data());
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+            compressed_buffer.resize(header_size + 1 + LZ4_COMPRESSBOUND(uncompressed_size));
+#pragma GCC diagnostic pop
+
+            compressed_buffer[0] = static_cast<char>(CompressionMethodByte::Delta);
+            compressed_buffer[header_size] = static_cast<char>(compression_settings.delta_width);
+
+            compressed_size = header_size + 1 + LZ4_compress_default(
+                delta_buffer.data(),
+                &compressed_buffer[header_size + 1],
+                uncompressed_size,
+                compressed_buffer.size() - header_size - 1);
+
+            UInt32 compressed_size_32 = compressed_size;
+            UInt32 uncompressed_size_32 = uncompressed_size;
+
+            unalignedStore(&compressed_buffer[1], compressed_size_32);
+            unalignedStore(&compressed_buffer[5], uncompressed_size_32);
+
+            compressed_buffer_ptr = compressed_buffer.data();
+            break;
+        }
+        case CompressionMethod::Sparse:
+        {
+            static constexpr size_t header_size = 1 + sizeof(UInt32) + sizeof(UInt32);
+            UInt8 width = compression_settings.sparse_width;
+
+            size_t payload_size = sizeof(UInt32) + sparse_non_default_count * (sizeof(UInt32) + width) + uncompressed_size % width;
+            sparse_buffer.resize(payload_size);
+            sparseEncode(working_buffer.begin(), uncompressed_size, width, sparse_non_default_count, sparse_buffer.data());
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+            compressed_buffer.resize(header_size + 1 + sizeof(UInt32) + LZ4_COMPRESSBOUND(payload_size));
+#pragma GCC diagnostic pop
+
+            compressed_buffer[0] = static_cast<char>(CompressionMethodByte::Sparse);
+            compressed_buffer[header_size] = static_cast<char>(width);
+
+            UInt32 payload_size_32 = payload_size;
+            unalignedStore(&compressed_buffer[header_size + 1], payload_size_32);
+
+            compressed_size = header_size + 1 + sizeof(UInt32) + LZ4_compress_default(
+                sparse_buffer.data(),
+                &compressed_buffer[header_size + 1 + sizeof(UInt32)],
+                payload_size,
+                compressed_buffer.size() - header_size - 1 - sizeof(UInt32));
+
+            UInt32 compressed_size_32 = compressed_size;
+            UInt32 uncompressed_size_32 = uncompressed_size;
+
+            unalignedStore(&compressed_buffer[1], compressed_size_32);
+            unalignedStore(&compressed_buffer[5], uncompressed_size_32);
+
+            compressed_buffer_ptr = compressed_buffer.data();
+            break;
+        }
         case CompressionMethod::NONE:
         {
             static constexpr size_t header_size = 1 + sizeof (UInt32) + sizeof (UInt32);
@@ -122,10 +313,63 @@ void CompressedWriteBuffer::nextImpl()
             throw Exception("Unknown compression method", ErrorCodes::UNKNOWN_COMPRESSION_METHOD);
     }
 
+    double compress_seconds = adaptive ? watch.elapsedSeconds() : 0;
+
     CityHash_v1_0_2::uint128 checksum = CityHash_v1_0_2::CityHash128(compressed_buffer_ptr, compressed_size);
-    out.write(reinterpret_cast<const char *>(&checksum), sizeof(checksum));
 
+    if (adaptive)
+        watch.restart();
+
+    out.write(reinterpret_cast<const char *>(&checksum), sizeof(checksum));
     out.write(compressed_buffer_ptr, compressed_size);
+
+    if (adaptive)
+    {
+        /// The downstream buffer absorbs short bursts, but over many blocks its accept rate
+        /// converges to the device write throughput, which is what we balance against.
+        double write_seconds = watch.elapsedSeconds();
+
+        if (compress_seconds > 0 && write_seconds > 0)
+        {
+            double current_compress_speed = uncompressed_size / compress_seconds;
+            double current_write_speed = compressed_size / write_seconds;
+
+            compress_speed = compress_speed ? 0.75 * compress_speed + 0.25 * current_compress_speed : current_compress_speed;
+            write_speed = write_speed ? 0.75 * write_speed + 0.25 * current_write_speed : current_write_speed;
+        }
+
+        static constexpr size_t adjust_period_blocks = 16;
+        if (++blocks_since_level_adjust >= adjust_period_blocks)
+        {
+            blocks_since_level_adjust = 0;
+            adjustLevel();
+        }
+    }
+}
+
+
+void CompressedWriteBuffer::adjustLevel()
+{
+    if (!compress_speed || !write_speed)
+        return;
+
+    if (compress_speed < write_speed)
+    {
+        /// The CPU can't keep up with the device: compress cheaper.
+        if (compression_settings.method == CompressionMethod::LZ4)
+            lz4_acceleration = std::min(lz4_acceleration * 2, 64);
+        else
+            zstd_level = std::max(zstd_level - 1, 1);
+    }
+    else if (compress_speed > 2 * write_speed)
+    {
+        /// The device can't keep up with the CPU: spend the spare cycles on a better ratio.
+        /// ZSTD is capped at 12: higher levels burn much more CPU and memory for little gain here.
+        if (compression_settings.method == CompressionMethod::LZ4)
+            lz4_acceleration = std::max(lz4_acceleration / 2, 1);
+        else
+            zstd_level = std::min(zstd_level + 1, 12);
+    }
 }
 
 
@@ -135,6 +379,7 @@ CompressedWriteBuffer::CompressedWriteBuffer(
     size_t buf_size)
     : BufferWithOwnMemory<WriteBuffer>(buf_size), out(out_), compression_settings(compression_settings_)
 {
+    zstd_level = compression_settings.level;
 }
 
 
@@ -143,6 +388,16 @@ CompressedWriteBuffer::~CompressedWriteBuffer()
     try
     {
         next();
+
+        if (compression_settings.adaptive_level
+            && (lz4_acceleration != 1 || zstd_level != compression_settings.level))
+        {
+            LOG_TRACE(&Logger::get("CompressedWriteBuffer"),
+                "Adaptive compression finished the stream with "
+                << (compression_settings.method == CompressionMethod::LZ4
+                    ? "LZ4 acceleration " + std::to_string(lz4_acceleration)
+                    : "ZSTD level " + std::to_string(zstd_level)));
+        }
     }
     catch (...)
     {
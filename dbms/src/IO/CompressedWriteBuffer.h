@@ -20,8 +20,26 @@ private:
 
     PODArray<char> compressed_buffer;
 
+    /// Scratch buffer for the Delta method: holds delta-encoded data before it is compressed with LZ4.
+    PODArray<char> delta_buffer;
+
+    /// Scratch buffer for the Sparse method: holds the sparse payload before it is compressed with LZ4.
+    PODArray<char> sparse_buffer;
+
+    /// State of runtime level tuning for LZ4 and ZSTD (see adjustLevel()).
+    /// Speeds are exponential moving averages in bytes per second.
+    int lz4_acceleration = 1;
+    int zstd_level = 1;
+    double compress_speed = 0;
+    double write_speed = 0;
+    size_t blocks_since_level_adjust = 0;
+
     void nextImpl() override;
 
+    /// Rebalance the level when compression and the underlying buffer get out of step:
+    /// cheaper compression when the CPU is the bottleneck, better ratio when the device is.
+    void adjustLevel();
+
 public:
     CompressedWriteBuffer(
         WriteBuffer & out_,
@@ -19,6 +19,23 @@ CompressionSettings::CompressionSettings(const Settings & settings)
     }
 }
 
+CompressionSettings CompressionSettings::forNetworkResponse(const Settings & settings)
+{
+    CompressionSettings res(settings);
+
+    if (settings.network_response_compression_method.changed)
+        res.method = settings.network_response_compression_method;
+
+    if (res.method == CompressionMethod::ZSTD)
+        res.level = settings.network_response_zstd_compression_level.changed
+            ? settings.network_response_zstd_compression_level
+            : settings.network_zstd_compression_level;
+    else
+        res.level = getDefaultLevel(res.method);
+
+    return res;
+}
+
 int CompressionSettings::getDefaultLevel(CompressionMethod method)
 {
     switch (method)
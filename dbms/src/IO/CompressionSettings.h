@@ -1,5 +1,6 @@
 #pragma once
 
+#include <Core/Types.h>
 #include <IO/CompressedStream.h>
 
 
@@ -13,6 +14,20 @@ struct CompressionSettings
     CompressionMethod method;
     int level;
 
+    /// For the Delta method: the width of a value in bytes, taken from the column data type.
+    UInt8 delta_width = 1;
+
+    /// For the Sparse method: the width of a value in bytes, taken from the column data type.
+    UInt8 sparse_width = 1;
+
+    /// For the Sparse method: the minimum fraction of default (zero) values in a block
+    ///  for the sparse format to be used; blocks below the threshold fall back to LZ4.
+    Float64 sparse_min_default_ratio = 0.9;
+
+    /// For LZ4 and ZSTD: adjust the LZ4 acceleration / ZSTD level at runtime so that compression
+    ///  speed stays balanced with the throughput of the underlying buffer (see CompressedWriteBuffer).
+    bool adaptive_level = false;
+
     CompressionSettings()
         : CompressionSettings(CompressionMethod::LZ4)
     {
@@ -30,8 +45,20 @@ struct CompressionSettings
     {
     }
 
+    CompressionSettings(CompressionMethod method_, int level_, UInt8 delta_width_)
+        : method(method_)
+        , level(level_)
+        , delta_width(delta_width_)
+    {
+    }
+
     CompressionSettings(const Settings & settings);
 
+    /// Settings for the server -> client direction of the native protocol.
+    /// Falls back to the common network_compression_method/level for the settings
+    /// the client did not set explicitly, so the directions can be tuned independently.
+    static CompressionSettings forNetworkResponse(const Settings & settings);
+
     static int getDefaultLevel(CompressionMethod method);
 };
 
@@ -0,0 +1,192 @@
+#if defined(__linux__)
+
+#include <IO/IOUring.h>
+#include <Common/Exception.h>
+
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+
+/// The syscall numbers are the same on all architectures that got io_uring
+///  (it was added after the syscall tables were unified).
+#if !defined(__NR_io_uring_setup)
+    #define __NR_io_uring_setup 425
+#endif
+#if !defined(__NR_io_uring_enter)
+    #define __NR_io_uring_enter 426
+#endif
+#if !defined(__NR_io_uring_register)
+    #define __NR_io_uring_register 427
+#endif
+
+
+namespace DB
+{
+    namespace ErrorCodes
+    {
+        extern const int CANNOT_IOSETUP;
+        extern const int AIO_READ_ERROR;
+        extern const int LOGICAL_ERROR;
+    }
+}
+
+
+int io_uring_setup(unsigned entries, IOUringParams * params)
+{
+    return syscall(__NR_io_uring_setup, entries, params);
+}
+
+int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+int io_uring_register(int ring_fd, unsigned opcode, const void * arg, unsigned nr_args)
+{
+    return syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args);
+}
+
+
+IOUring::IOUring(unsigned entries)
+{
+    IOUringParams params{};
+
+    ring_fd = io_uring_setup(entries, &params);
+    if (ring_fd < 0)
+        DB::throwFromErrno("io_uring_setup failed", DB::ErrorCodes::CANNOT_IOSETUP);
+
+    try
+    {
+        sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(IOUringCQE);
+        sqes_size = params.sq_entries * sizeof(IOUringSQE);
+
+        auto map = [this](size_t size, off_t offset)
+        {
+            void * ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, offset);
+            if (MAP_FAILED == ptr)
+                DB::throwFromErrno("Cannot mmap io_uring ring", DB::ErrorCodes::CANNOT_IOSETUP);
+            return ptr;
+        };
+
+        sq_ring_mmap = map(sq_ring_size, IORING_OFF_SQ_RING);
+        cq_ring_mmap = map(cq_ring_size, IORING_OFF_CQ_RING);
+        sqes = static_cast<IOUringSQE *>(map(sqes_size, IORING_OFF_SQES));
+
+        char * sq_ptr = static_cast<char *>(sq_ring_mmap);
+        sq_head = reinterpret_cast<uint32_t *>(sq_ptr + params.sq_off.head);
+        sq_tail = reinterpret_cast<uint32_t *>(sq_ptr + params.sq_off.tail);
+        sq_ring_mask = reinterpret_cast<uint32_t *>(sq_ptr + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<uint32_t *>(sq_ptr + params.sq_off.array);
+
+        char * cq_ptr = static_cast<char *>(cq_ring_mmap);
+        cq_head = reinterpret_cast<uint32_t *>(cq_ptr + params.cq_off.head);
+        cq_tail = reinterpret_cast<uint32_t *>(cq_ptr + params.cq_off.tail);
+        cq_ring_mask = reinterpret_cast<uint32_t *>(cq_ptr + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<IOUringCQE *>(cq_ptr + params.cq_off.cqes);
+    }
+    catch (...)
+    {
+        if (sq_ring_mmap)
+            munmap(sq_ring_mmap, sq_ring_size);
+        if (cq_ring_mmap)
+            munmap(cq_ring_mmap, cq_ring_size);
+        close(ring_fd);
+        throw;
+    }
+}
+
+IOUring::~IOUring()
+{
+    if (sq_ring_mmap)
+        munmap(sq_ring_mmap, sq_ring_size);
+    if (cq_ring_mmap)
+        munmap(cq_ring_mmap, cq_ring_size);
+    if (sqes)
+        munmap(sqes, sqes_size);
+
+    sq_ring_mmap = nullptr;
+    cq_ring_mmap = nullptr;
+    sqes = nullptr;
+
+    if (ring_fd >= 0)
+        close(ring_fd);
+}
+
+bool IOUring::isSupported()
+{
+    static const bool res = []
+    {
+        IOUringParams params{};
+        int fd = io_uring_setup(1, &params);
+        if (fd < 0)
+            return false;
+        close(fd);
+        return true;
+    }();
+    return res;
+}
+
+bool IOUring::tryRegisterBuffers(const iovec * iovecs, unsigned count)
+{
+    return 0 == io_uring_register(ring_fd, IORING_REGISTER_BUFFERS, iovecs, count);
+}
+
+void IOUring::submitRead(int fd, void * buf, size_t nbytes, off_t offset, int buf_index)
+{
+    unsigned tail = *sq_tail;    /// Only we advance the tail.
+    unsigned index = tail & *sq_ring_mask;
+
+    IOUringSQE & sqe = sqes[index];
+    memset(&sqe, 0, sizeof(sqe));
+
+    sqe.fd = fd;
+    sqe.off = offset;
+    sqe.user_data = tail;
+
+    if (buf_index >= 0)
+    {
+        sqe.opcode = IORING_OP_READ_FIXED;
+        sqe.addr = reinterpret_cast<uint64_t>(buf);
+        sqe.len = nbytes;
+        sqe.buf_index = buf_index;
+    }
+    else
+    {
+        sqe.opcode = IORING_OP_READV;
+        pending_iov.iov_base = buf;
+        pending_iov.iov_len = nbytes;
+        sqe.addr = reinterpret_cast<uint64_t>(&pending_iov);
+        sqe.len = 1;
+    }
+
+    sq_array[index] = index;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    int res = io_uring_enter(ring_fd, 1, 0, 0);
+    if (res < 0)
+        DB::throwFromErrno("io_uring_enter failed to submit a read request", DB::ErrorCodes::AIO_READ_ERROR);
+    if (res != 1)
+        throw DB::Exception("io_uring_enter submitted an unexpected number of requests", DB::ErrorCodes::LOGICAL_ERROR);
+}
+
+ssize_t IOUring::waitCompletion()
+{
+    while (true)
+    {
+        unsigned head = *cq_head;    /// Only we advance the head.
+        if (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE))
+        {
+            ssize_t res = cqes[head & *cq_ring_mask].res;
+            __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+            return res;
+        }
+
+        if (io_uring_enter(ring_fd, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+            DB::throwFromErrno("io_uring_enter failed to wait for a completion", DB::ErrorCodes::AIO_READ_ERROR);
+    }
+}
+
+#endif
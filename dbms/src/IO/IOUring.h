@@ -0,0 +1,154 @@
+#pragma once
+
+#if defined(__linux__)
+
+#include <boost/noncopyable.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+
+/** A small self-contained wrapper around the io_uring kernel interface.
+  *
+  * The ABI structures and syscall numbers are defined here instead of including
+  *  <linux/io_uring.h>, because the header is not present in older kernel headers
+  *  while the running kernel may still support the syscalls (similar to how AIO.h
+  *  wraps the raw AIO syscalls instead of depending on libaio).
+  *
+  * Only the small part of the interface that we use is wrapped: a ring with a
+  *  single in-flight read request and optionally registered (fixed) buffers.
+  */
+
+struct IOUringSQE
+{
+    uint8_t opcode;
+    uint8_t flags;
+    uint16_t ioprio;
+    int32_t fd;
+    uint64_t off;
+    uint64_t addr;
+    uint32_t len;
+    uint32_t rw_flags;
+    uint64_t user_data;
+    uint16_t buf_index;
+    uint16_t pad0;
+    uint32_t pad1;
+    uint64_t pad2[2];
+};
+
+struct IOUringCQE
+{
+    uint64_t user_data;
+    int32_t res;
+    uint32_t flags;
+};
+
+struct IOUringSQRingOffsets
+{
+    uint32_t head;
+    uint32_t tail;
+    uint32_t ring_mask;
+    uint32_t ring_entries;
+    uint32_t flags;
+    uint32_t dropped;
+    uint32_t array;
+    uint32_t resv1;
+    uint64_t resv2;
+};
+
+struct IOUringCQRingOffsets
+{
+    uint32_t head;
+    uint32_t tail;
+    uint32_t ring_mask;
+    uint32_t ring_entries;
+    uint32_t overflow;
+    uint32_t cqes;
+    uint64_t resv[2];
+};
+
+struct IOUringParams
+{
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    uint32_t flags;
+    uint32_t sq_thread_cpu;
+    uint32_t sq_thread_idle;
+    uint32_t features;
+    uint32_t resv[4];
+    IOUringSQRingOffsets sq_off;
+    IOUringCQRingOffsets cq_off;
+};
+
+/// Guarded in case <linux/io_uring.h> is also included somewhere.
+#if !defined(IORING_OP_READV)
+    #define IORING_OP_READV 1
+    #define IORING_OP_READ_FIXED 4
+
+    #define IORING_ENTER_GETEVENTS 1U
+
+    #define IORING_REGISTER_BUFFERS 0
+
+    #define IORING_OFF_SQ_RING 0ULL
+    #define IORING_OFF_CQ_RING 0x8000000ULL
+    #define IORING_OFF_SQES 0x10000000ULL
+#endif
+
+
+int io_uring_setup(unsigned entries, IOUringParams * params);
+
+int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags);
+
+int io_uring_register(int ring_fd, unsigned opcode, const void * arg, unsigned nr_args);
+
+
+/** A ring with a single in-flight request. Not thread safe.
+  */
+class IOUring : private boost::noncopyable
+{
+public:
+    IOUring(unsigned entries = 4);
+    ~IOUring();
+
+    /// Whether the running kernel supports io_uring. The probe is done once.
+    static bool isSupported();
+
+    /// Register buffers for IORING_OP_READ_FIXED. Returns false if the kernel refused
+    ///  (e.g. due to the locked memory limit); the caller then has to use plain reads.
+    bool tryRegisterBuffers(const iovec * iovecs, unsigned count);
+
+    /// Submit an asynchronous positional read. If buf_index >= 0, the buffer must have been
+    ///  registered with tryRegisterBuffers and the read is performed as IORING_OP_READ_FIXED.
+    void submitRead(int fd, void * buf, size_t nbytes, off_t offset, int buf_index = -1);
+
+    /// Wait for the completion of the request submitted by submitRead and return its result
+    ///  (the number of bytes read, or a negated errno).
+    ssize_t waitCompletion();
+
+private:
+    int ring_fd = -1;
+
+    /// Mapped rings.
+    void * sq_ring_mmap = nullptr;
+    size_t sq_ring_size = 0;
+    void * cq_ring_mmap = nullptr;
+    size_t cq_ring_size = 0;
+    IOUringSQE * sqes = nullptr;
+    size_t sqes_size = 0;
+
+    /// Pointers into the mapped rings.
+    uint32_t * sq_head = nullptr;
+    uint32_t * sq_tail = nullptr;
+    uint32_t * sq_ring_mask = nullptr;
+    uint32_t * sq_array = nullptr;
+    uint32_t * cq_head = nullptr;
+    uint32_t * cq_tail = nullptr;
+    uint32_t * cq_ring_mask = nullptr;
+    IOUringCQE * cqes = nullptr;
+
+    /// The iovec of the in-flight IORING_OP_READV request must stay alive until completion.
+    iovec pending_iov{};
+};
+
+#endif
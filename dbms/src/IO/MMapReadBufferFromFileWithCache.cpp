@@ -0,0 +1,67 @@
+#include <IO/MMapReadBufferFromFileWithCache.h>
+#include <IO/WriteHelpers.h>
+
+
+namespace DB
+{
+
+namespace ErrorCodes
+{
+    extern const int ARGUMENT_OUT_OF_BOUND;
+    extern const int SEEK_POSITION_OUT_OF_BOUND;
+}
+
+
+MMapReadBufferFromFileWithCache::MMapReadBufferFromFileWithCache(
+    MMappedFileCache & cache, const std::string & file_name)
+    : ReadBufferFromFileBase(0, nullptr, 0)
+{
+    mapped = cache.getOrSet(MMappedFileCache::hash(file_name), [&]
+    {
+        return std::make_shared<MMappedFile>(file_name);
+    }).first;
+
+    internal_buffer = Buffer(mapped->getData(), mapped->getData() + mapped->getLength());
+    working_buffer = internal_buffer;
+    pos = working_buffer.begin();
+}
+
+
+off_t MMapReadBufferFromFileWithCache::getPositionInFile()
+{
+    return pos - internal_buffer.begin();
+}
+
+
+std::string MMapReadBufferFromFileWithCache::getFileName() const
+{
+    return mapped->getFileName();
+}
+
+
+int MMapReadBufferFromFileWithCache::getFD() const
+{
+    return mapped->getFD();
+}
+
+
+off_t MMapReadBufferFromFileWithCache::doSeek(off_t offset, int whence)
+{
+    off_t new_pos;
+    if (whence == SEEK_SET)
+        new_pos = offset;
+    else if (whence == SEEK_CUR)
+        new_pos = getPositionInFile() + offset;
+    else
+        throw Exception("MMapReadBufferFromFileWithCache::seek expects SEEK_SET or SEEK_CUR as whence", ErrorCodes::ARGUMENT_OUT_OF_BOUND);
+
+    if (new_pos < 0 || new_pos > static_cast<off_t>(working_buffer.size()))
+        throw Exception("Cannot seek through file " + getFileName()
+            + " because seek position (" + toString(new_pos) + ") is out of bounds [0, " + toString(working_buffer.size()) + "]",
+            ErrorCodes::SEEK_POSITION_OUT_OF_BOUND);
+
+    pos = working_buffer.begin() + new_pos;
+    return new_pos;
+}
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <IO/ReadBufferFromFileBase.h>
+#include <IO/MMappedFileCache.h>
+
+
+namespace DB
+{
+
+/** A ReadBufferFromFileBase over a memory mapped file taken from MMappedFileCache.
+  * The whole file is the buffer, so reading and seeking never copy or do IO system calls;
+  *  the kernel pages the data in on access.
+  */
+class MMapReadBufferFromFileWithCache : public ReadBufferFromFileBase
+{
+public:
+    MMapReadBufferFromFileWithCache(MMappedFileCache & cache, const std::string & file_name);
+
+    off_t getPositionInFile() override;
+    std::string getFileName() const override;
+    int getFD() const override;
+
+private:
+    /// Shared with all other readers of the same file; holds the mapping alive.
+    MMappedFileCache::MappedPtr mapped;
+
+    off_t doSeek(off_t off, int whence) override;
+};
+
+}
@@ -0,0 +1,73 @@
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <Common/ProfileEvents.h>
+#include <Common/formatReadable.h>
+#include <Common/Exception.h>
+#include <IO/MMappedFile.h>
+
+
+namespace ProfileEvents
+{
+    extern const Event FileOpen;
+}
+
+namespace DB
+{
+
+namespace ErrorCodes
+{
+    extern const int FILE_DOESNT_EXIST;
+    extern const int CANNOT_OPEN_FILE;
+    extern const int CANNOT_STAT;
+    extern const int CANNOT_ALLOCATE_MEMORY;
+}
+
+
+MMappedFile::MMappedFile(const std::string & file_name_)
+    : file_name(file_name_)
+{
+    ProfileEvents::increment(ProfileEvents::FileOpen);
+
+    fd = ::open(file_name.c_str(), O_RDONLY);
+    if (-1 == fd)
+        throwFromErrno("Cannot open file " + file_name, errno == ENOENT ? ErrorCodes::FILE_DOESNT_EXIST : ErrorCodes::CANNOT_OPEN_FILE);
+
+    try
+    {
+        struct stat stat_res {};
+        if (0 != fstat(fd, &stat_res))
+            throwFromErrno("MMappedFile: Cannot fstat " + file_name, ErrorCodes::CANNOT_STAT);
+
+        length = stat_res.st_size;
+
+        if (length)
+        {
+            void * buf = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+            if (MAP_FAILED == buf)
+                throwFromErrno("MMappedFile: Cannot mmap " + formatReadableSizeWithBinarySuffix(length) + ".",
+                    ErrorCodes::CANNOT_ALLOCATE_MEMORY);
+
+            data = static_cast<char *>(buf);
+        }
+    }
+    catch (...)
+    {
+        ::close(fd);
+        throw;
+    }
+}
+
+
+MMappedFile::~MMappedFile()
+{
+    if (data)
+        munmap(data, length);    /// Exceptions on munmap failure would not be useful here.
+
+    ::close(fd);
+}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <boost/noncopyable.hpp>
+#include <Common/CurrentMetrics.h>
+
+
+namespace CurrentMetrics
+{
+    extern const Metric OpenFileForRead;
+}
+
+
+namespace DB
+{
+
+/** A file opened for reading and mapped into memory as a whole.
+  * Intended to be shared between readers through MMappedFileCache.
+  * The mapping stays valid even if the file is unlinked (e.g. the part is removed),
+  *  as long as at least one reference to this object is held.
+  */
+class MMappedFile : private boost::noncopyable
+{
+public:
+    MMappedFile(const std::string & file_name_);
+    ~MMappedFile();
+
+    char * getData() { return data; }
+    const char * getData() const { return data; }
+
+    size_t getLength() const { return length; }
+
+    const std::string & getFileName() const { return file_name; }
+    int getFD() const { return fd; }
+
+private:
+    std::string file_name;
+    int fd = -1;
+    char * data = nullptr;
+    size_t length = 0;
+
+    CurrentMetrics::Increment metric_increment{CurrentMetrics::OpenFileForRead};
+};
+
+}
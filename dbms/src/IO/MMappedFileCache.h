@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Common/LRUCache.h>
+#include <Common/SipHash.h>
+#include <Common/UInt128.h>
+#include <Common/ProfileEvents.h>
+#include <IO/MMappedFile.h>
+
+
+namespace ProfileEvents
+{
+    extern const Event MMappedFileCacheHits;
+    extern const Event MMappedFileCacheMisses;
+}
+
+namespace DB
+{
+
+/** Cache of memory mapped files, so that frequently read files (e.g. columns of hot MergeTree parts)
+  *  are not mapped and unmapped over and over again. Thread-safe.
+  * The cache holds references to the mappings: a mapping is released only when it is evicted
+  *  and no reader uses it anymore, so removal of a part does not invalidate readers.
+  * The weight of an entry is 1, i.e. the cache is limited by the number of mapped files,
+  *  not by their total size (the mappings consume address space, not memory).
+  */
+class MMappedFileCache : public LRUCache<UInt128, MMappedFile, UInt128TrivialHash>
+{
+private:
+    using Base = LRUCache<UInt128, MMappedFile, UInt128TrivialHash>;
+
+public:
+    MMappedFileCache(size_t max_count)
+        : Base(max_count) {}
+
+    /// Calculate key from path to file.
+    static UInt128 hash(const String & path_to_file)
+    {
+        UInt128 key;
+
+        SipHash hash;
+        hash.update(path_to_file.data(), path_to_file.size() + 1);
+        hash.get128(key.low, key.high);
+
+        return key;
+    }
+
+    MappedPtr get(const Key & key)
+    {
+        MappedPtr res = Base::get(key);
+
+        if (res)
+            ProfileEvents::increment(ProfileEvents::MMappedFileCacheHits);
+        else
+            ProfileEvents::increment(ProfileEvents::MMappedFileCacheMisses);
+
+        return res;
+    }
+};
+
+using MMappedFileCachePtr = std::shared_ptr<MMappedFileCache>;
+
+}
@@ -0,0 +1,213 @@
+#include <IO/ParallelRangedReadBufferFromHTTP.h>
+#include <IO/HTTPCommon.h>
+#include <IO/WriteHelpers.h>
+#include <Common/Exception.h>
+
+#include <Poco/Net/HTTPRequest.h>
+#include <Poco/Net/HTTPResponse.h>
+
+
+namespace DB
+{
+
+namespace ErrorCodes
+{
+    extern const int RECEIVED_ERROR_FROM_REMOTE_IO_SERVER;
+    extern const int CANNOT_READ_ALL_DATA;
+}
+
+
+std::unique_ptr<ParallelRangedReadBufferFromHTTP> ParallelRangedReadBufferFromHTTP::tryCreate(
+    const Poco::URI & uri, const ConnectionTimeouts & timeouts, size_t num_threads, size_t range_bytes)
+{
+    if (num_threads <= 1 || range_bytes == 0)
+        return nullptr;
+
+    try
+    {
+        auto session = makeHTTPSession(uri, timeouts);
+
+        Poco::URI request_uri = uri;
+        if (request_uri.getPath().empty())
+            request_uri.setPath("/");
+
+        Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_HEAD, request_uri.getPathAndQuery(), Poco::Net::HTTPRequest::HTTP_1_1);
+        request.setHost(request_uri.getHost());
+
+        session->sendRequest(request);
+        Poco::Net::HTTPResponse response;
+        session->receiveResponse(response);
+
+        if (response.getStatus() != Poco::Net::HTTPResponse::HTTP_OK
+            || !response.hasContentLength()
+            || response.get("Accept-Ranges", "") != "bytes")
+            return nullptr;
+
+        size_t content_length = response.getContentLength64();
+
+        /// A body shorter than two ranges doesn't benefit from concurrent connections.
+        if (content_length < 2 * range_bytes)
+            return nullptr;
+
+        return std::make_unique<ParallelRangedReadBufferFromHTTP>(uri, timeouts, content_length, num_threads, range_bytes);
+    }
+    catch (...)
+    {
+        /// E.g. the server doesn't allow HEAD. Fall back to a sequential download.
+        tryLogCurrentException("ParallelRangedReadBufferFromHTTP");
+        return nullptr;
+    }
+}
+
+
+ParallelRangedReadBufferFromHTTP::ParallelRangedReadBufferFromHTTP(
+    const Poco::URI & uri_, const ConnectionTimeouts & timeouts_,
+    size_t content_length_, size_t num_threads, size_t range_bytes_)
+    : ReadBuffer(nullptr, 0)
+    , uri(uri_), timeouts(timeouts_)
+    , content_length(content_length_), range_bytes(range_bytes_)
+{
+    num_ranges = (content_length + range_bytes - 1) / range_bytes;
+    reorder_window = num_threads * 2;
+
+    LOG_TRACE(log, "Downloading " << content_length << " bytes from " << uri.toString()
+                   << " in " << num_ranges << " ranges with " << num_threads << " threads");
+
+    size_t threads = std::min(num_threads, num_ranges);
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i)
+        workers.emplace_back([this] { workerFunction(); });
+}
+
+
+ParallelRangedReadBufferFromHTTP::~ParallelRangedReadBufferFromHTTP()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled = true;
+    }
+    window_freed.notify_all();
+
+    for (auto & worker : workers)
+        worker.join();
+}
+
+
+void ParallelRangedReadBufferFromHTTP::workerFunction()
+{
+    while (true)
+    {
+        size_t range_num;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            window_freed.wait(lock, [this]
+            {
+                return cancelled || background_exception || next_range_to_fetch >= num_ranges
+                    || next_range_to_fetch < next_range_to_deliver + reorder_window;
+            });
+
+            if (cancelled || background_exception || next_range_to_fetch >= num_ranges)
+                return;
+
+            range_num = next_range_to_fetch++;
+        }
+
+        try
+        {
+            std::vector<char> data = fetchRange(range_num);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            ready_ranges.emplace(range_num, std::move(data));
+            range_ready.notify_one();
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!background_exception)
+                background_exception = std::current_exception();
+            range_ready.notify_all();
+            window_freed.notify_all();
+            return;
+        }
+    }
+}
+
+
+std::vector<char> ParallelRangedReadBufferFromHTTP::fetchRange(size_t range_num)
+{
+    static constexpr size_t max_attempts = 3;
+
+    size_t range_begin = range_num * range_bytes;
+    size_t range_end = std::min(range_begin + range_bytes, content_length);
+
+    for (size_t attempt = 1;; ++attempt)
+    {
+        try
+        {
+            auto session = makeHTTPSession(uri, timeouts);
+
+            Poco::URI request_uri = uri;
+            if (request_uri.getPath().empty())
+                request_uri.setPath("/");
+
+            Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_GET, request_uri.getPathAndQuery(), Poco::Net::HTTPRequest::HTTP_1_1);
+            request.setHost(request_uri.getHost());
+            request.set("Range", "bytes=" + toString(range_begin) + "-" + toString(range_end - 1));
+
+            session->sendRequest(request);
+            Poco::Net::HTTPResponse response;
+            std::istream & istr = session->receiveResponse(response);
+
+            /// The server announced Accept-Ranges but served the whole body: bail out rather than
+            /// deliver each range num_threads times.
+            if (response.getStatus() != Poco::Net::HTTPResponse::HTTP_PARTIAL_CONTENT)
+                throw Exception("Remote server " + uri.toString() + " did not honor a range request. HTTP status code: "
+                    + toString(response.getStatus()), ErrorCodes::RECEIVED_ERROR_FROM_REMOTE_IO_SERVER);
+
+            std::vector<char> data(range_end - range_begin);
+            istr.read(data.data(), data.size());
+
+            if (static_cast<size_t>(istr.gcount()) != data.size())
+                throw Exception("Incomplete range [" + toString(range_begin) + ", " + toString(range_end) + ") from "
+                    + uri.toString() + ": received " + toString(istr.gcount()) + " bytes", ErrorCodes::CANNOT_READ_ALL_DATA);
+
+            return data;
+        }
+        catch (...)
+        {
+            if (attempt >= max_attempts)
+                throw;
+
+            tryLogCurrentException(log, "Retrying range [" + toString(range_begin) + ", " + toString(range_end) + ")");
+        }
+    }
+}
+
+
+bool ParallelRangedReadBufferFromHTTP::nextImpl()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (next_range_to_deliver >= num_ranges)
+        return false;
+
+    range_ready.wait(lock, [this]
+    {
+        return background_exception || ready_ranges.count(next_range_to_deliver);
+    });
+
+    if (background_exception)
+        std::rethrow_exception(background_exception);
+
+    auto it = ready_ranges.find(next_range_to_deliver);
+    current_range = std::move(it->second);
+    ready_ranges.erase(it);
+    ++next_range_to_deliver;
+    window_freed.notify_all();
+
+    internal_buffer = Buffer(current_range.data(), current_range.data() + current_range.size());
+    working_buffer = internal_buffer;
+    return true;
+}
+
+}
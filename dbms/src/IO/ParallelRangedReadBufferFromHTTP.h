@@ -0,0 +1,74 @@
+#pragma once
+
+#include <IO/ReadBuffer.h>
+#include <IO/ConnectionTimeouts.h>
+
+#include <Poco/URI.h>
+
+#include <common/logger_useful.h>
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace DB
+{
+
+/** Downloads an HTTP body with several concurrent ranged GET requests.
+  *
+  * The server must announce a Content-Length and support byte ranges (Accept-Ranges: bytes).
+  * Use tryCreate(), which probes the server with a HEAD request and returns nullptr when a
+  * ranged download is not possible, so the caller can fall back to a single sequential stream.
+  *
+  * Worker threads fetch fixed-size ranges, each retried independently on failure, into a
+  * bounded reorder window; the consumer reads the ranges strictly in body order.
+  */
+class ParallelRangedReadBufferFromHTTP : public ReadBuffer
+{
+public:
+    static std::unique_ptr<ParallelRangedReadBufferFromHTTP> tryCreate(
+        const Poco::URI & uri, const ConnectionTimeouts & timeouts, size_t num_threads, size_t range_bytes);
+
+    ParallelRangedReadBufferFromHTTP(
+        const Poco::URI & uri_, const ConnectionTimeouts & timeouts_,
+        size_t content_length_, size_t num_threads, size_t range_bytes_);
+
+    ~ParallelRangedReadBufferFromHTTP() override;
+
+private:
+    bool nextImpl() override;
+
+    void workerFunction();
+
+    /// Downloads one range, retrying failed attempts. Returns exactly the requested bytes.
+    std::vector<char> fetchRange(size_t range_num);
+
+    Poco::URI uri;
+    ConnectionTimeouts timeouts;
+
+    size_t content_length = 0;
+    size_t range_bytes = 0;
+    size_t num_ranges = 0;
+    size_t reorder_window = 0;  /// How many ranges ahead of the consumer may be fetched and kept in memory.
+
+    std::mutex mutex;
+    std::condition_variable range_ready;   /// A range was fetched (or a worker failed).
+    std::condition_variable window_freed;  /// The consumer advanced (or the buffer is shutting down).
+
+    std::map<size_t, std::vector<char>> ready_ranges;
+    size_t next_range_to_fetch = 0;
+    size_t next_range_to_deliver = 0;
+    bool cancelled = false;
+    std::exception_ptr background_exception;
+
+    std::vector<char> current_range;  /// The range the consumer is currently reading.
+    std::vector<std::thread> workers;
+
+    Logger * log = &Logger::get("ParallelRangedReadBufferFromHTTP");
+};
+
+}
@@ -3,6 +3,7 @@
 #include <IO/ReadBufferAIO.h>
 #include <IO/AIOContextPool.h>
 #include <Common/ProfileEvents.h>
+#include <Common/IOScheduler.h>
 #include <Common/Stopwatch.h>
 #include <Core/Defines.h>
 
@@ -196,6 +197,8 @@ void ReadBufferAIO::synchronousRead()
 
     ProfileEvents::increment(ProfileEvents::ReadBufferAIORead);
     ProfileEvents::increment(ProfileEvents::ReadBufferAIOReadBytes, bytes_read);
+    if (bytes_read > 0)
+        IOScheduler::account(bytes_read);
 
     finalize();
 }
@@ -232,6 +235,8 @@ bool ReadBufferAIO::waitForAIOCompletion()
 
     ProfileEvents::increment(ProfileEvents::ReadBufferAIORead);
     ProfileEvents::increment(ProfileEvents::ReadBufferAIOReadBytes, bytes_read);
+    if (bytes_read > 0)
+        IOScheduler::account(bytes_read);
 
     return true;
 }
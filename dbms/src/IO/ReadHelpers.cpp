@@ -7,14 +7,11 @@
 #include <IO/WriteBufferFromString.h>
 #include <IO/readFloatText.h>
 #include <IO/Operators.h>
+#include <IO/scanToAnyOf.h>
 #include <common/find_symbols.h>
 #include <stdlib.h>
 #include <Common/memcpySmall.h>
 
-#if __SSE2__
-    #include <emmintrin.h>
-#endif
-
 namespace DB
 {
 
@@ -554,31 +551,7 @@ void readCSVStringInto(Vector & s, ReadBuffer & buf, const FormatSettings::CSV &
         /// Unquoted case. Look for delimiter or \r or \n.
         while (!buf.eof())
         {
-            char * next_pos = buf.position();
-
-            [&]()
-            {
-#if __SSE2__
-                auto rc = _mm_set1_epi8('\r');
-                auto nc = _mm_set1_epi8('\n');
-                auto dc = _mm_set1_epi8(delimiter);
-                for (; next_pos + 15 < buf.buffer().end(); next_pos += 16)
-                {
-                    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(next_pos));
-                    auto eq = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, rc), _mm_cmpeq_epi8(bytes, nc)), _mm_cmpeq_epi8(bytes, dc));
-                    uint16_t bit_mask = _mm_movemask_epi8(eq);
-                    if (bit_mask)
-                    {
-                        next_pos += __builtin_ctz(bit_mask);
-                        return;
-                    }
-                }
-#endif
-                while (next_pos < buf.buffer().end()
-                    && *next_pos != delimiter && *next_pos != '\r' && *next_pos != '\n')
-                    ++next_pos;
-            }();
-
+            char * next_pos = const_cast<char *>(scanToAnyOf(buf.position(), buf.buffer().end(), delimiter, '\r', '\n'));
 
             appendToStringOrVector(s, buf, next_pos);
             buf.position() = next_pos;
@@ -628,7 +601,7 @@ ReturnType readJSONStringInto(Vector & s, ReadBuffer & buf)
 
     while (!buf.eof())
     {
-        char * next_pos = find_first_symbols<'\\', '"'>(buf.position(), buf.buffer().end());
+        char * next_pos = const_cast<char *>(scanToAnyOf(buf.position(), buf.buffer().end(), '\\', '"'));
 
         appendToStringOrVector(s, buf, next_pos);
         buf.position() = next_pos;
@@ -41,8 +41,8 @@ private:
     using Base = LRUCache<UInt128, UncompressedCacheCell, UInt128TrivialHash, UncompressedSizeWeightFunction>;
 
 public:
-    UncompressedCache(size_t max_size_in_bytes)
-        : Base(max_size_in_bytes) {}
+    UncompressedCache(size_t max_size_in_bytes, size_t num_shards = 1)
+        : Base(max_size_in_bytes, Delay::zero(), num_shards) {}
 
     /// Calculate key from path to file and offset.
     static UInt128 hash(const String & path_to_file, size_t offset)
@@ -2,10 +2,12 @@
 
 #include <IO/WriteBufferAIO.h>
 #include <Common/ProfileEvents.h>
+#include <Common/IOScheduler.h>
 
 #include <limits>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <linux/falloc.h>
 #include <errno.h>
 
 
@@ -73,6 +75,11 @@ WriteBufferAIO::~WriteBufferAIO()
         try
         {
             flush();
+
+            /// Release the preallocated space past the end of the data.
+            /// Best effort: leftover preallocation only wastes disk space, it is not visible in the file.
+            if (preallocated)
+                ::ftruncate(fd, max_pos_in_file);
         }
         catch (...)
         {
@@ -99,6 +106,21 @@ void WriteBufferAIO::sync()
         throwFromErrno("Cannot fsync " + getFileName(), ErrorCodes::CANNOT_FSYNC);
 }
 
+void WriteBufferAIO::preallocate(size_t length)
+{
+#if defined(FALLOC_FL_KEEP_SIZE)
+    if (length == 0)
+        return;
+
+    /// KEEP_SIZE: allocate the blocks, but do not change the visible file size,
+    /// so a partially written file does not look longer than the data in it.
+    if (0 == ::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, length))
+        preallocated = true;
+#else
+    (void) length;
+#endif
+}
+
 void WriteBufferAIO::nextImpl()
 {
     if (!offset())
@@ -197,6 +219,8 @@ bool WriteBufferAIO::waitForAIOCompletion()
 
     ProfileEvents::increment(ProfileEvents::WriteBufferAIOWrite);
     ProfileEvents::increment(ProfileEvents::WriteBufferAIOWriteBytes, bytes_written);
+    if (bytes_written > 0)
+        IOScheduler::account(bytes_written);
 
     return true;
 }
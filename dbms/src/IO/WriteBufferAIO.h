@@ -36,6 +36,13 @@ public:
 
     off_t getPositionInFile() override;
     void sync() override;
+
+    /// Preallocate disk space for the given number of bytes that are going to be written,
+    /// to reduce fragmentation and metadata updates during writing. Only a hint:
+    /// if the filesystem does not support it, writes proceed as usual.
+    /// Space past the end of the actually written data is released on destruction.
+    void preallocate(size_t length);
+
     std::string getFileName() const override { return filename; }
     int getFD() const override { return fd; }
 
@@ -89,6 +96,9 @@ private:
     /// The data buffer that we want to write to the disk.
     Position buffer_begin = nullptr;
 
+    /// Was disk space preallocated with fallocate?
+    bool preallocated = false;
+
     /// Is the asynchronous write operation still in progress?
     bool is_pending_write = false;
     /// Did the asynchronous operation fail?
@@ -1,7 +1,9 @@
 #include <IO/createReadBufferFromFileBase.h>
 #include <IO/ReadBufferFromFile.h>
+#include <IO/MMapReadBufferFromFileWithCache.h>
 #if defined(__linux__)
 #include <IO/ReadBufferAIO.h>
+#include <IO/ReadBufferIOUring.h>
 #endif
 #include <Common/ProfileEvents.h>
 
@@ -10,6 +12,9 @@ namespace ProfileEvents
 {
     extern const Event CreatedReadBufferOrdinary;
     extern const Event CreatedReadBufferAIO;
+    extern const Event CreatedReadBufferIOUring;
+    extern const Event CreatedReadBufferMMap;
+    extern const Event CreatedReadBufferMMapFailed;
 }
 
 namespace DB
@@ -22,8 +27,24 @@ namespace ErrorCodes
 #endif
 
 std::unique_ptr<ReadBufferFromFileBase> createReadBufferFromFileBase(const std::string & filename_, size_t estimated_size,
-        size_t aio_threshold, size_t buffer_size_, int flags_, char * existing_memory_, size_t alignment)
+        size_t aio_threshold, size_t mmap_threshold, MMappedFileCache * mmap_cache,
+        size_t buffer_size_, int flags_, char * existing_memory_, size_t alignment)
 {
+    if (mmap_cache && mmap_threshold && estimated_size >= mmap_threshold
+        && !existing_memory_ && (flags_ == -1 || flags_ == O_RDONLY))
+    {
+        try
+        {
+            ProfileEvents::increment(ProfileEvents::CreatedReadBufferMMap);
+            return std::make_unique<MMapReadBufferFromFileWithCache>(*mmap_cache, filename_);
+        }
+        catch (const ErrnoException &)
+        {
+            /// Fallback if mmap is not supported (example: pipe).
+            ProfileEvents::increment(ProfileEvents::CreatedReadBufferMMapFailed);
+        }
+    }
+
     if ((aio_threshold == 0) || (estimated_size < aio_threshold))
     {
         ProfileEvents::increment(ProfileEvents::CreatedReadBufferOrdinary);
@@ -32,6 +53,14 @@ std::unique_ptr<ReadBufferFromFileBase> createReadBufferFromFileBase(const std::
     else
     {
 #if defined(__linux__)
+        /// Prefer io_uring when the kernel supports it: it does not go through the shared
+        ///  completion thread of AIOContextPool. The semantics (O_DIRECT reads) are the same.
+        if (IOUring::isSupported())
+        {
+            ProfileEvents::increment(ProfileEvents::CreatedReadBufferIOUring);
+            return std::make_unique<ReadBufferIOUring>(filename_, buffer_size_, flags_, existing_memory_);
+        }
+
         ProfileEvents::increment(ProfileEvents::CreatedReadBufferAIO);
         return std::make_unique<ReadBufferAIO>(filename_, buffer_size_, flags_, existing_memory_);
 #else
@@ -8,17 +8,24 @@
 namespace DB
 {
 
+class MMappedFileCache;
+
 /** Create an object to read data from a file.
   * estimated_size - the number of bytes to read
   * aio_threshold - the minimum number of bytes for asynchronous reads
+  * mmap_threshold - the minimum number of bytes for reading through a shared memory mapping
   *
-  * If aio_threshold = 0 or estimated_size < aio_threshold, read operations are executed synchronously.
+  * If mmap_threshold != 0, mmap_cache is set and estimated_size >= mmap_threshold,
+  *  the file is read through a memory mapping shared via the cache (no copying into private buffers).
+  * Otherwise, if aio_threshold = 0 or estimated_size < aio_threshold, read operations are executed synchronously.
   * Otherwise, the read operations are performed asynchronously.
   */
 std::unique_ptr<ReadBufferFromFileBase> createReadBufferFromFileBase(
     const std::string & filename_,
     size_t estimated_size,
     size_t aio_threshold,
+    size_t mmap_threshold = 0,
+    MMappedFileCache * mmap_cache = nullptr,
     size_t buffer_size_ = DBMS_DEFAULT_BUFFER_SIZE,
     int flags_ = -1,
     char * existing_memory_ = nullptr,
@@ -35,7 +35,11 @@ std::unique_ptr<WriteBufferFromFileBase> createWriteBufferFromFileBase(const std
     {
 #if defined(__linux__)
         ProfileEvents::increment(ProfileEvents::CreatedWriteBufferAIO);
-        return std::make_unique<WriteBufferAIO>(filename_, buffer_size_, flags_, mode, existing_memory_);
+        auto res = std::make_unique<WriteBufferAIO>(filename_, buffer_size_, flags_, mode, existing_memory_);
+        /// The file is going to be large (at least aio_threshold): preallocating the estimated size
+        /// reduces fragmentation and metadata updates while it is written with O_DIRECT.
+        res->preallocate(estimated_size);
+        return res;
 #else
         throw Exception("AIO is not implemented yet on non-Linux OS", ErrorCodes::NOT_IMPLEMENTED);
 #endif
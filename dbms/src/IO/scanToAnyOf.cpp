@@ -0,0 +1,97 @@
+#include <cstdint>
+#include <IO/scanToAnyOf.h>
+#include <Common/CpuFeatures.h>
+
+#if __SSE2__
+    #include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && defined(__x86_64__)
+    #include <immintrin.h>
+#endif
+
+
+namespace DB
+{
+
+namespace
+{
+
+/** The kernels classify a full vector of bytes at each step and take the position
+  *  of the lowest set bit of the movemask. Unused characters repeat 'c0', which only
+  *  costs one redundant compare and keeps a single kernel for all arities.
+  * They stop before the tail that does not fill a whole vector; the caller finishes it.
+  */
+
+#if defined(__GNUC__) && defined(__x86_64__)
+
+__attribute__((target("avx2")))
+const char * scanToAnyOfAVX2(const char * begin, const char * end, char c0, char c1, char c2)
+{
+    const __m256i v0 = _mm256_set1_epi8(c0);
+    const __m256i v1 = _mm256_set1_epi8(c1);
+    const __m256i v2 = _mm256_set1_epi8(c2);
+
+    for (; begin + 31 < end; begin += 32)
+    {
+        __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(begin));
+        __m256i eq = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(bytes, v0), _mm256_cmpeq_epi8(bytes, v1)),
+            _mm256_cmpeq_epi8(bytes, v2));
+
+        uint32_t bit_mask = _mm256_movemask_epi8(eq);
+        if (bit_mask)
+            return begin + __builtin_ctz(bit_mask);
+    }
+
+    return begin;
+}
+
+#endif
+
+}
+
+
+const char * scanToAnyOf(const char * begin, const char * end, char c0, char c1, char c2)
+{
+#if defined(__GNUC__) && defined(__x86_64__)
+    if (haveAVX2())
+        begin = scanToAnyOfAVX2(begin, end, c0, c1, c2);
+#endif
+
+#if __SSE2__
+    const __m128i v0 = _mm_set1_epi8(c0);
+    const __m128i v1 = _mm_set1_epi8(c1);
+    const __m128i v2 = _mm_set1_epi8(c2);
+
+    for (; begin + 15 < end; begin += 16)
+    {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(begin));
+        __m128i eq = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(bytes, v0), _mm_cmpeq_epi8(bytes, v1)),
+            _mm_cmpeq_epi8(bytes, v2));
+
+        uint16_t bit_mask = _mm_movemask_epi8(eq);
+        if (bit_mask)
+            return begin + __builtin_ctz(bit_mask);
+    }
+#endif
+
+    for (; begin < end; ++begin)
+        if (*begin == c0 || *begin == c1 || *begin == c2)
+            return begin;
+
+    return end;
+}
+
+const char * scanToAnyOf(const char * begin, const char * end, char c0, char c1)
+{
+    return scanToAnyOf(begin, end, c0, c1, c1);
+}
+
+const char * scanToAnyOf(const char * begin, const char * end, char c0)
+{
+    return scanToAnyOf(begin, end, c0, c0, c0);
+}
+
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+
+namespace DB
+{
+
+/** Finds the first occurrence of any of up to three characters in a memory range.
+  * Returns 'end' if none of them occur.
+  *
+  * Like find_first_symbols, but the characters are run-time values (a format delimiter,
+  *  a quote chosen by settings) and the kernel is chosen at run time:
+  *  32 bytes per step with AVX2, 16 bytes with SSE2, otherwise a plain loop.
+  * The main users are the text format parsers (CSV, JSONEachRow), where locating
+  *  the next delimiter, quote or escape is the hottest part of the scan.
+  */
+const char * scanToAnyOf(const char * begin, const char * end, char c0);
+const char * scanToAnyOf(const char * begin, const char * end, char c0, char c1);
+const char * scanToAnyOf(const char * begin, const char * end, char c0, char c1, char c2);
+
+}
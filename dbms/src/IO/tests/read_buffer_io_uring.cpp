@@ -0,0 +1,123 @@
+#include <IO/ReadBufferIOUring.h>
+#include <Core/Defines.h>
+#include <boost/filesystem.hpp>
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <port/unistd.h>
+
+
+namespace
+{
+
+std::string createTmpFile()
+{
+    char pattern[] = "/tmp/fileXXXXXX";
+    char * dir = ::mkdtemp(pattern);
+    if (dir == nullptr)
+    {
+        std::cerr << "Could not create directory\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    return std::string(dir) + "/foo";
+}
+
+void prepare(std::string & filename, std::string & buf)
+{
+    static const std::string symbols = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+
+    filename = createTmpFile();
+
+    size_t n = 10 * DEFAULT_AIO_FILE_BLOCK_SIZE;
+    buf.reserve(n);
+
+    for (size_t i = 0; i < n; ++i)
+        buf += symbols[i % symbols.length()];
+
+    std::ofstream out(filename.c_str());
+    if (!out.is_open())
+    {
+        std::cerr << "Could not open file\n";
+        std::exit(EXIT_FAILURE);
+    }
+
+    out << buf;
+}
+
+bool testSequentialRead(const std::string & filename, const std::string & buf)
+{
+    std::string newbuf;
+    newbuf.resize(buf.length());
+
+    DB::ReadBufferIOUring in(filename, 3 * DEFAULT_AIO_FILE_BLOCK_SIZE);
+    size_t count = in.read(newbuf.data(), newbuf.length());
+
+    return (count == newbuf.length()) && (newbuf == buf) && in.eof();
+}
+
+bool testSeek(const std::string & filename, const std::string & buf)
+{
+    DB::ReadBufferIOUring in(filename, DEFAULT_AIO_FILE_BLOCK_SIZE);
+
+    /// Forward, past the buffer.
+    off_t pos = 3 * DEFAULT_AIO_FILE_BLOCK_SIZE + 10;
+    if (in.seek(pos, SEEK_SET) != pos)
+        return false;
+
+    std::string newbuf;
+    newbuf.resize(100);
+    if (in.read(newbuf.data(), newbuf.length()) != newbuf.length())
+        return false;
+    if (newbuf != buf.substr(pos, newbuf.length()))
+        return false;
+
+    /// Backward, within the buffer.
+    if (in.seek(-50, SEEK_CUR) != (pos + static_cast<off_t>(newbuf.length()) - 50))
+        return false;
+    if (in.read(newbuf.data(), newbuf.length()) != newbuf.length())
+        return false;
+    return newbuf == buf.substr(pos + newbuf.length() - 50, newbuf.length());
+}
+
+bool testMaxBytes(const std::string & filename, const std::string & buf)
+{
+    DB::ReadBufferIOUring in(filename, DEFAULT_AIO_FILE_BLOCK_SIZE);
+    size_t max_bytes = DEFAULT_AIO_FILE_BLOCK_SIZE + 10;
+    in.setMaxBytes(max_bytes);
+
+    std::string newbuf;
+    newbuf.resize(buf.length());
+
+    size_t count = in.read(newbuf.data(), newbuf.length());
+    return (count == max_bytes) && (newbuf.substr(0, count) == buf.substr(0, count));
+}
+
+}
+
+
+int main()
+{
+    namespace fs = boost::filesystem;
+
+    if (!IOUring::isSupported())
+    {
+        std::cout << "io_uring is not supported by the kernel, skipping the test\n";
+        return EXIT_SUCCESS;
+    }
+
+    std::string filename;
+    std::string buf;
+    prepare(filename, buf);
+
+    bool ok = true;
+
+    ok &= testSequentialRead(filename, buf);
+    ok &= testSeek(filename, buf);
+    ok &= testMaxBytes(filename, buf);
+
+    fs::remove_all(fs::path(filename).parent_path().string());
+
+    std::cout << (ok ? "All tests passed" : "Some tests failed") << "\n";
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
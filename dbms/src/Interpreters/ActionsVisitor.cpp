@@ -32,6 +32,7 @@
 #include <Interpreters/ActionsVisitor.h>
 #include <Interpreters/InterpreterSelectWithUnionQuery.h>
 #include <Interpreters/Set.h>
+#include <Interpreters/SubqueryResultCache.h>
 #include <Interpreters/evaluateConstantExpression.h>
 #include <Interpreters/convertFieldToType.h>
 #include <Interpreters/interpretSubquery.h>
@@ -581,6 +582,31 @@ void ActionsVisitor::makeSet(const ASTFunction * node, const Block & sample_bloc
           */
         if (!subquery_for_set.source && no_storage_or_local)
         {
+            /// Maybe an identical set built by a previous query can be reused (see use_subquery_result_cache).
+            /// Not applicable to GLOBAL IN: there the temporary table must be populated in any case.
+            if (context.getSettingsRef().use_subquery_result_cache)
+            {
+                if (auto subquery_result_cache = context.getSubqueryResultCache())
+                {
+                    QueryResultCacheTableVersions table_versions;
+                    if (QueryResultCache::collectTableVersions(*arg, context, table_versions))
+                    {
+                        UInt128 cache_key = QueryResultCache::hash(*arg, context);
+
+                        if (SetPtr cached_set = subquery_result_cache->tryGetSet(cache_key, table_versions))
+                        {
+                            subquery_for_set.set = cached_set;
+                            prepared_sets[arg->range] = cached_set;
+                            return;
+                        }
+
+                        subquery_for_set.subquery_result_cache = subquery_result_cache;
+                        subquery_for_set.subquery_result_cache_key = cache_key;
+                        subquery_for_set.subquery_result_cache_table_versions = std::move(table_versions);
+                    }
+                }
+            }
+
             auto interpreter = interpretSubquery(arg, context, subquery_depth, {});
             subquery_for_set.source = std::make_shared<LazyBlockInputStream>(
                 interpreter->getSampleBlock(), [interpreter]() mutable { return interpreter->execute().in; });
@@ -2,6 +2,7 @@
 
 #include <Parsers/StringRange.h>
 #include <Interpreters/ExpressionActions.h>
+#include <Interpreters/SubqueryResultCache.h>
 
 
 namespace DB
@@ -37,6 +38,12 @@ struct SubqueryForSet
     /// If set, put the result into the table.
     /// This is a temporary table for transferring to remote servers for distributed query processing.
     StoragePtr table;
+
+    /// If set, save the set (or the join) in the subquery result cache under this key after it
+    /// has been built completely (see CreatingSetsBlockInputStream).
+    SubqueryResultCachePtr subquery_result_cache;
+    UInt128 subquery_result_cache_key {};
+    QueryResultCacheTableVersions subquery_result_cache_table_versions;
 };
 
 /// ID of subquery -> what to do with it.
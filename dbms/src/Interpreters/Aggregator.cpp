@@ -17,6 +17,10 @@
 #include <IO/WriteBufferFromFile.h>
 #include <IO/CompressedWriteBuffer.h>
 #include <Interpreters/Aggregator.h>
+#if USE_EMBEDDED_COMPILER
+#include <DataTypes/Native.h>
+#include <Interpreters/ExpressionJIT.h>
+#endif
 #include <Common/ClickHouseRevision.h>
 #include <Common/MemoryTracker.h>
 #include <Common/CurrentThread.h>
@@ -191,9 +195,56 @@ Aggregator::Aggregator(const Params & params_)
     AggregationStateCache::Settings cache_settings;
     cache_settings.max_threads = params.max_threads;
     aggregation_state_cache = AggregatedDataVariants::createCache(method_chosen, cache_settings);
+
+#if USE_EMBEDDED_COMPILER
+    compileAggregateFunctionsIfPossible();
+#endif
 }
 
 
+#if USE_EMBEDDED_COMPILER
+
+void Aggregator::compileAggregateFunctionsIfPossible()
+{
+    if (!params.compile_aggregate_functions || !params.src_header)
+        return;
+
+    std::vector<AggregateFunctionToCompile> functions_to_compile;
+    is_aggregate_function_compiled.assign(params.aggregates_size, false);
+
+    for (size_t i = 0; i < params.aggregates_size; ++i)
+    {
+        const IAggregateFunction * function = aggregate_functions[i];
+        if (!function->isCompilable())
+            continue;
+
+        /// The generated loop loads the arguments directly from the raw column data,
+        ///  so they must be columns of fixed-size native values without a null map.
+        DataTypes argument_types;
+        bool arguments_are_native = true;
+        for (size_t j = 0; j < params.aggregates[i].arguments.size(); ++j)
+        {
+            const DataTypePtr & type = params.src_header.safeGetByPosition(params.aggregates[i].arguments[j]).type;
+            if (type->isNullable() || !canBeNativeType(*type))
+                arguments_are_native = false;
+            argument_types.push_back(type);
+        }
+        if (!arguments_are_native)
+            continue;
+
+        functions_to_compile.push_back({function, offsets_of_aggregate_states[i], std::move(argument_types)});
+        is_aggregate_function_compiled[i] = true;
+    }
+
+    if (functions_to_compile.empty())
+        return;
+
+    compiled_aggregate_functions = std::make_shared<CompiledAggregateFunctions>(compileAggregateFunctions(functions_to_compile));
+}
+
+#endif
+
+
 void Aggregator::compileIfPossible(AggregatedDataVariants::Type type)
 {
     std::lock_guard<std::mutex> lock(mutex);
@@ -506,13 +557,14 @@ AggregatedDataVariants::Type Aggregator::chooseAggregationMethod()
             return AggregatedDataVariants::Type::keys256;
     }
 
-    /// If single string key - will use hash table with references to it. Strings itself are stored separately in Arena.
+    /// If single string key - will use hash table that stores short strings inline.
+    /// Strings longer than 23 bytes are stored separately in Arena and referenced by pointer.
     if (params.keys_size == 1 && isString(types_removed_nullable[0]))
     {
         if (has_low_cardinality)
             return AggregatedDataVariants::Type::low_cardinality_key_string;
         else
-            return AggregatedDataVariants::Type::key_string;
+            return AggregatedDataVariants::Type::key_short_string;
     }
 
     if (params.keys_size == 1 && isFixedString(types_removed_nullable[0]))
@@ -571,10 +623,27 @@ void NO_INLINE Aggregator::executeImpl(
     else
         state.init(key_columns);
 
+#if USE_EMBEDDED_COMPILER
+    if (compiled_aggregate_functions && rows)
+    {
+        /// First pass over the block: only find or create the aggregation place of every row.
+        /// Then the compiled loop adds the values of all compilable functions into the gathered places in one pass.
+        PODArray<AggregateDataPtr> places(rows);
+
+        if (!no_more_keys)
+            executeImplCase<false>(method, state, aggregates_pool, rows, key_columns, aggregate_instructions, keys, overflow_row, places.data());
+        else
+            executeImplCase<true>(method, state, aggregates_pool, rows, key_columns, aggregate_instructions, keys, overflow_row, places.data());
+
+        executeCompiledAddLoop(rows, aggregate_instructions, places.data(), nullptr, aggregates_pool);
+        return;
+    }
+#endif
+
     if (!no_more_keys)
-        executeImplCase<false>(method, state, aggregates_pool, rows, key_columns, aggregate_instructions, keys, overflow_row);
+        executeImplCase<false>(method, state, aggregates_pool, rows, key_columns, aggregate_instructions, keys, overflow_row, nullptr);
     else
-        executeImplCase<true>(method, state, aggregates_pool, rows, key_columns, aggregate_instructions, keys, overflow_row);
+        executeImplCase<true>(method, state, aggregates_pool, rows, key_columns, aggregate_instructions, keys, overflow_row, nullptr);
 }
 
 #ifndef __clang__
@@ -591,11 +660,16 @@ void NO_INLINE Aggregator::executeImplCase(
     ColumnRawPtrs & key_columns,
     AggregateFunctionInstruction * aggregate_instructions,
     StringRefs & keys,
-    AggregateDataPtr overflow_row) const
+    AggregateDataPtr overflow_row,
+    AggregateDataPtr * places) const
 {
     /// NOTE When editing this code, also pay attention to SpecializedAggregator.h.
     /// TODO for low cardinality optimization.
 
+    /// How far ahead of the current row the hash table cell is prefetched.
+    /// Enough to cover the latency of a cache miss, small enough for the line to still be cached when we get there.
+    [[maybe_unused]] static constexpr size_t prefetch_look_ahead = 16;
+
     /// For all rows.
     typename Method::Key prev_key;
     AggregateDataPtr value = nullptr;
@@ -608,6 +682,14 @@ void NO_INLINE Aggregator::executeImplCase(
         if constexpr (!Method::low_cardinality_optimization)
             key = state.getKey(key_columns, params.keys_size, i, key_sizes, keys, *aggregates_pool);
 
+        /// Prefetch the cell for a row a few iterations ahead, to overlap the cache miss with the work on the current rows.
+        if constexpr (!Method::low_cardinality_optimization && Method::prefetch_optimization && Method::Data::supports_prefetch)
+        {
+            if (i + prefetch_look_ahead < rows)
+                method.data.prefetchByHash(method.data.hash(
+                    state.getKey(key_columns, params.keys_size, i + prefetch_look_ahead, key_sizes, keys, *aggregates_pool)));
+        }
+
         AggregateDataPtr * aggregate_data = nullptr;
         typename Method::iterator it; /// Is not used if Method::low_cardinality_optimization
 
@@ -618,9 +700,14 @@ void NO_INLINE Aggregator::executeImplCase(
             {
                 if (i != 0 && key == prev_key)
                 {
-                    /// Add values to the aggregate functions.
-                    for (AggregateFunctionInstruction * inst = aggregate_instructions; inst->that; ++inst)
-                        (*inst->func)(inst->that, value + inst->state_offset, inst->arguments, i, aggregates_pool);
+                    if (places)
+                        places[i] = value;
+                    else
+                    {
+                        /// Add values to the aggregate functions.
+                        for (AggregateFunctionInstruction * inst = aggregate_instructions; inst->that; ++inst)
+                            (*inst->func)(inst->that, value + inst->state_offset, inst->arguments, i, aggregates_pool);
+                    }
 
                     method.onExistingKey(key, keys, *aggregates_pool);
                     continue;
@@ -656,6 +743,8 @@ void NO_INLINE Aggregator::executeImplCase(
         /// If the key does not fit, and the data does not need to be aggregated in a separate row, then there's nothing to do.
         if (!aggregate_data && !overflow_row)
         {
+            if (places)
+                places[i] = nullptr;
             method.onExistingKey(key, keys, *aggregates_pool);
             continue;
         }
@@ -681,6 +770,12 @@ void NO_INLINE Aggregator::executeImplCase(
 
         value = aggregate_data ? *aggregate_data : overflow_row;
 
+        if (places)
+        {
+            places[i] = value;
+            continue;
+        }
+
         /// Add values to the aggregate functions.
         for (AggregateFunctionInstruction * inst = aggregate_instructions; inst->that; ++inst)
             (*inst->func)(inst->that, value + inst->state_offset, inst->arguments, i, aggregates_pool);
@@ -691,6 +786,49 @@ void NO_INLINE Aggregator::executeImplCase(
 #pragma GCC diagnostic pop
 #endif
 
+#if USE_EMBEDDED_COMPILER
+
+void NO_INLINE Aggregator::executeCompiledAddLoop(
+    size_t rows,
+    AggregateFunctionInstruction * aggregate_instructions,
+    AggregateDataPtr * places,
+    AggregateDataPtr single_place,
+    Arena * aggregates_pool) const
+{
+    /// Pointers to the raw data of the argument columns of the compiled functions,
+    ///  flattened in the same order as in compileAggregateFunctionsIfPossible.
+    std::vector<const char *> columns_data;
+    for (size_t i = 0; i < params.aggregates_size; ++i)
+        if (is_aggregate_function_compiled[i])
+            for (size_t j = 0; j < params.aggregates[i].arguments.size(); ++j)
+                columns_data.push_back(aggregate_instructions[i].arguments[j]->getRawData().data);
+
+    if (places)
+        compiled_aggregate_functions->add_into_places(0, rows, columns_data.data(), places);
+    else
+        compiled_aggregate_functions->add_into_single_place(0, rows, columns_data.data(), single_place);
+
+    /// The functions that could not be compiled are added row by row, as before.
+    size_t function_idx = 0;
+    for (AggregateFunctionInstruction * inst = aggregate_instructions; inst->that; ++inst, ++function_idx)
+    {
+        if (is_aggregate_function_compiled[function_idx])
+            continue;
+
+        if (!places)
+        {
+            inst->that->addBatchSinglePlace(rows, single_place + inst->state_offset, inst->arguments, aggregates_pool);
+            continue;
+        }
+
+        for (size_t i = 0; i < rows; ++i)
+            if (places[i])
+                (*inst->func)(inst->that, places[i] + inst->state_offset, inst->arguments, i, aggregates_pool);
+    }
+}
+
+#endif
+
 void NO_INLINE Aggregator::executeWithoutKeyImpl(
     AggregatedDataWithoutKey & res,
     size_t rows,
@@ -704,14 +842,15 @@ void NO_INLINE Aggregator::executeWithoutKeyImpl(
 
     if (agg_count)
         agg_count->addDelta(res, rows);
+#if USE_EMBEDDED_COMPILER
+    else if (compiled_aggregate_functions && rows)
+        executeCompiledAddLoop(rows, aggregate_instructions, nullptr, res, arena);
+#endif
     else
     {
-        for (size_t i = 0; i < rows; ++i)
-        {
-            /// Adding values
-            for (AggregateFunctionInstruction * inst = aggregate_instructions; inst->that; ++inst)
-                (*inst->func)(inst->that, res + inst->state_offset, inst->arguments, i, arena);
-        }
+        /// Adding values. All rows go into one state, so every function gets the whole batch at once.
+        for (AggregateFunctionInstruction * inst = aggregate_instructions; inst->that; ++inst)
+            inst->that->addBatchSinglePlace(rows, res + inst->state_offset, inst->arguments, arena);
     }
 }
 
@@ -762,7 +901,11 @@ bool Aggregator::executeOnBlock(const Block & block, AggregatedDataVariants & re
 
         if (const auto * low_cardinality_column = typeid_cast<const ColumnLowCardinality *>(key_columns[i]))
         {
-            if (!result.isLowCardinality())
+            /// The serialized method gathers key values through the dictionary by position indices,
+            ///  so it does not need the full column. Other non-LowCardinality methods do.
+            if (!result.isLowCardinality()
+                && result.type != AggregatedDataVariants::Type::serialized
+                && result.type != AggregatedDataVariants::Type::serialized_two_level)
             {
                 materialized_columns.push_back(low_cardinality_column->convertToFullColumn());
                 key_columns[i] = materialized_columns.back().get();
@@ -880,8 +1023,12 @@ bool Aggregator::executeOnBlock(const Block & block, AggregatedDataVariants & re
 
     size_t result_size = result.sizeWithoutOverflowRow();
     Int64 current_memory_usage = 0;
+    Int64 current_memory_limit = 0;
     if (auto memory_tracker = CurrentThread::getMemoryTracker().getParent())
+    {
         current_memory_usage = memory_tracker->get();
+        current_memory_limit = memory_tracker->getLimit();
+    }
 
     auto result_size_bytes = current_memory_usage - memory_usage_before_aggregation;    /// Here all the results in the sum are taken into account, from different threads.
 
@@ -901,10 +1048,24 @@ bool Aggregator::executeOnBlock(const Block & block, AggregatedDataVariants & re
 
     /** Flush data to disk if too much RAM is consumed.
       * Data can only be flushed to disk if a two-level aggregation structure is used.
+      * Besides the absolute threshold, spilling can be triggered adaptively when memory usage
+      * approaches the memory limit of the query, so it starts before the limit is exhausted.
       */
-    if (params.max_bytes_before_external_group_by
+    bool exceeded_absolute_threshold = params.max_bytes_before_external_group_by
+        && current_memory_usage > static_cast<Int64>(params.max_bytes_before_external_group_by);
+
+    bool exceeded_share_of_memory_limit = params.max_bytes_ratio_before_external_group_by > 0
+        && current_memory_limit
+        && current_memory_usage > static_cast<Int64>(current_memory_limit * params.max_bytes_ratio_before_external_group_by);
+
+    /// The query crossed its memory soft limit or was asked to release memory (see MemoryTracker).
+    /// Flush only if the aggregation state is a substantial part of the query's memory, so that it actually helps.
+    bool memory_pressure = false;
+    if (auto memory_tracker = CurrentThread::getMemoryTracker().getParent())
+        memory_pressure = memory_tracker->isMemoryPressure() && result_size_bytes * 20 > current_memory_usage;
+
+    if ((exceeded_absolute_threshold || exceeded_share_of_memory_limit || memory_pressure)
         && result.isTwoLevel()
-        && current_memory_usage > static_cast<Int64>(params.max_bytes_before_external_group_by)
         && worth_convert_to_two_level)
     {
         writeToTemporaryFile(result);
@@ -1570,10 +1731,21 @@ void NO_INLINE Aggregator::mergeDataOnlyExistingKeysImpl(
 
 
 void NO_INLINE Aggregator::mergeWithoutKeyDataImpl(
-    ManyAggregatedDataVariants & non_empty_data) const
+    ManyAggregatedDataVariants & non_empty_data, size_t max_threads) const
 {
     AggregatedDataVariantsPtr & res = non_empty_data[0];
 
+    /// With a single group there is no parallelism across keys, but uniqExact and similar
+    ///  functions can still merge their two-level states bucket-parallel.
+    std::unique_ptr<ThreadPool> thread_pool;
+    if (max_threads > 1 && non_empty_data.size() > 1)
+        for (size_t i = 0; i < params.aggregates_size; ++i)
+            if (aggregate_functions[i]->isAbleToParallelizeMerge())
+            {
+                thread_pool = std::make_unique<ThreadPool>(max_threads);
+                break;
+            }
+
     /// We merge all aggregation results to the first.
     for (size_t result_num = 1, size = non_empty_data.size(); result_num < size; ++result_num)
     {
@@ -1581,7 +1753,12 @@ void NO_INLINE Aggregator::mergeWithoutKeyDataImpl(
         AggregatedDataWithoutKey & current_data = non_empty_data[result_num]->without_key;
 
         for (size_t i = 0; i < params.aggregates_size; ++i)
-            aggregate_functions[i]->merge(res_data + offsets_of_aggregate_states[i], current_data + offsets_of_aggregate_states[i], res->aggregates_pool);
+        {
+            if (thread_pool && aggregate_functions[i]->isAbleToParallelizeMerge())
+                aggregate_functions[i]->merge(res_data + offsets_of_aggregate_states[i], current_data + offsets_of_aggregate_states[i], *thread_pool, res->aggregates_pool);
+            else
+                aggregate_functions[i]->merge(res_data + offsets_of_aggregate_states[i], current_data + offsets_of_aggregate_states[i], res->aggregates_pool);
+        }
 
         for (size_t i = 0; i < params.aggregates_size; ++i)
             aggregate_functions[i]->destroy(current_data + offsets_of_aggregate_states[i]);
@@ -1661,13 +1838,6 @@ public:
     MergingAndConvertingBlockInputStream(const Aggregator & aggregator_, ManyAggregatedDataVariants & data_, bool final_, size_t threads_)
         : aggregator(aggregator_), data(data_), final(final_), threads(threads_)
     {
-        /// At least we need one arena in first data item per thread
-        if (!data.empty() && threads > data[0]->aggregates_pools.size())
-        {
-            Arenas & first_pool = data[0]->aggregates_pools;
-            for (size_t j = first_pool.size(); j < threads; j++)
-                first_pool.emplace_back(std::make_shared<Arena>());
-        }
     }
 
     String getName() const override { return "MergingAndConverting"; }
@@ -1681,7 +1851,14 @@ public:
         /// We need to wait for threads to finish before destructor of 'parallel_merge_data',
         ///  because the threads access 'parallel_merge_data'.
         if (parallel_merge_data)
+        {
+            {
+                std::lock_guard<std::mutex> lock(parallel_merge_data->mutex);
+                parallel_merge_data->finish = true;
+            }
+            parallel_merge_data->condvar.notify_all();
             parallel_merge_data->pool.wait();
+        }
     }
 
 protected:
@@ -1701,7 +1878,7 @@ protected:
 
             if (first->type == AggregatedDataVariants::Type::without_key || aggregator.params.overflow_row)
             {
-                aggregator.mergeWithoutKeyDataImpl(data);
+                aggregator.mergeWithoutKeyDataImpl(data, threads);
                 return aggregator.prepareBlockAndFillWithoutKey(
                     *first, final, first->type != AggregatedDataVariants::Type::without_key);
             }
@@ -1734,7 +1911,8 @@ protected:
             {
                 parallel_merge_data = std::make_unique<ParallelMergeData>(threads);
                 for (size_t i = 0; i < threads; ++i)
-                    scheduleThreadForNextBucket();
+                    parallel_merge_data->pool.schedule(std::bind(&MergingAndConvertingBlockInputStream::thread, this,
+                        CurrentThread::getGroup()));
             }
 
             Block res;
@@ -1750,7 +1928,9 @@ protected:
                 if (it != parallel_merge_data->ready_blocks.end())
                 {
                     ++current_bucket_num;
-                    scheduleThreadForNextBucket();
+
+                    /// The window for the merging threads has moved - wake them up.
+                    parallel_merge_data->condvar.notify_all();
 
                     if (it->second)
                     {
@@ -1775,7 +1955,6 @@ private:
     size_t threads;
 
     Int32 current_bucket_num = -1;
-    Int32 max_scheduled_bucket_num = -1;
     static constexpr Int32 NUM_BUCKETS = 256;
 
     struct ParallelMergeData
@@ -1786,22 +1965,22 @@ private:
         std::condition_variable condvar;
         ThreadPool pool;
 
+        /// The first bucket that no thread has started to merge yet.
+        Int32 next_bucket_to_merge = 0;
+        bool finish = false;
+
         explicit ParallelMergeData(size_t threads) : pool(threads) {}
     };
 
     std::unique_ptr<ParallelMergeData> parallel_merge_data;
 
-    void scheduleThreadForNextBucket()
-    {
-        ++max_scheduled_bucket_num;
-        if (max_scheduled_bucket_num >= NUM_BUCKETS)
-            return;
-
-        parallel_merge_data->pool.schedule(std::bind(&MergingAndConvertingBlockInputStream::thread, this,
-            max_scheduled_bucket_num, CurrentThread::getGroup()));
-    }
-
-    void thread(Int32 bucket_num, ThreadGroupStatusPtr thread_group)
+    /** Every thread merges and converts buckets in a loop, taking the next bucket as soon as it is free,
+      *  instead of being scheduled one bucket at a time when the consumer takes a block.
+      * This way a slow bucket does not stall the merge of the following ones,
+      *  and only the emission of the blocks stays in bucket order.
+      * The threads do not run too far ahead of the consumer, to bound the number of ready blocks held in memory.
+      */
+    void thread(ThreadGroupStatusPtr thread_group)
     {
         try
         {
@@ -1812,36 +1991,79 @@ private:
 
             /// TODO: add no_more_keys support maybe
 
-            auto & merged_data = *data[0];
-            auto method = merged_data.type;
-            Block block;
+            const Int32 merge_ahead_window = 2 * threads;
 
-            /// Select Arena to avoid race conditions
-            size_t thread_number = static_cast<size_t>(bucket_num) % threads;
-            Arena * arena = merged_data.aggregates_pools.at(thread_number).get();
+            while (true)
+            {
+                Int32 bucket_num;
 
-            if (false) {}
-        #define M(NAME) \
-            else if (method == AggregatedDataVariants::Type::NAME) \
-            { \
-                aggregator.mergeBucketImpl<decltype(merged_data.NAME)::element_type>(data, bucket_num, arena); \
-                block = aggregator.convertOneBucketToBlock(merged_data, *merged_data.NAME, final, bucket_num); \
-            }
+                {
+                    std::unique_lock<std::mutex> lock(parallel_merge_data->mutex);
 
-            APPLY_FOR_VARIANTS_TWO_LEVEL(M)
-        #undef M
+                    parallel_merge_data->condvar.wait(lock, [&]
+                    {
+                        return parallel_merge_data->finish
+                            || parallel_merge_data->exception
+                            || parallel_merge_data->next_bucket_to_merge >= NUM_BUCKETS
+                            || parallel_merge_data->next_bucket_to_merge < current_bucket_num + merge_ahead_window;
+                    });
+
+                    if (parallel_merge_data->finish
+                        || parallel_merge_data->exception
+                        || parallel_merge_data->next_bucket_to_merge >= NUM_BUCKETS)
+                        return;
+
+                    bucket_num = parallel_merge_data->next_bucket_to_merge++;
+                }
+
+                auto & merged_data = *data[0];
+                auto method = merged_data.type;
+                Block block;
+
+                /** Every bucket gets its own arena for the allocations made while merging its states.
+                  * The arena is owned only by the block emitted for this bucket (see below), so this part
+                  * of the memory is freed as soon as the consumer destroys the block (for a distributed query -
+                  * right after the bucket has been sent to the initiator), not at the end of the query.
+                  * The hash table cells of the bucket are freed eagerly as well, by `clearAndShrink`
+                  * inside the merge and the conversion. Only the states moved from the source data
+                  * stay in the shared arenas of `data`, which live as long as this stream.
+                  */
+                auto bucket_arena = std::make_shared<Arena>();
 
-            std::lock_guard<std::mutex> lock(parallel_merge_data->mutex);
-            parallel_merge_data->ready_blocks[bucket_num] = std::move(block);
+                if (false) {}
+            #define M(NAME) \
+                else if (method == AggregatedDataVariants::Type::NAME) \
+                { \
+                    aggregator.mergeBucketImpl<decltype(merged_data.NAME)::element_type>(data, bucket_num, bucket_arena.get()); \
+                    block = aggregator.convertOneBucketToBlock(merged_data, *merged_data.NAME, final, bucket_num); \
+                }
+
+                APPLY_FOR_VARIANTS_TWO_LEVEL(M)
+            #undef M
+
+                /// Pass the ownership of the bucket arena to the columns with the states of aggregate functions.
+                for (size_t i = 0; i < block.columns(); ++i)
+                    if (auto * column = typeid_cast<ColumnAggregateFunction *>(block.getByPosition(i).column->assumeMutable().get()))
+                        column->addArena(bucket_arena);
+
+                {
+                    std::lock_guard<std::mutex> lock(parallel_merge_data->mutex);
+                    parallel_merge_data->ready_blocks[bucket_num] = std::move(block);
+                }
+
+                parallel_merge_data->condvar.notify_all();
+            }
         }
         catch (...)
         {
-            std::lock_guard<std::mutex> lock(parallel_merge_data->mutex);
-            if (!parallel_merge_data->exception)
-                parallel_merge_data->exception = std::current_exception();
-        }
+            {
+                std::lock_guard<std::mutex> lock(parallel_merge_data->mutex);
+                if (!parallel_merge_data->exception)
+                    parallel_merge_data->exception = std::current_exception();
+            }
 
-        parallel_merge_data->condvar.notify_all();
+            parallel_merge_data->condvar.notify_all();
+        }
     }
 };
 
@@ -2253,6 +2475,10 @@ Block Aggregator::mergeBlocks(BlocksList & blocks, bool final)
 
 #undef APPLY_FOR_VARIANTS_THAT_MAY_USE_BETTER_HASH_FUNCTION
 
+    /// key_short_string has no _hash64 twin: fall back to the generic string method with a 64-bit hash.
+    if (merge_method == AggregatedDataVariants::Type::key_short_string)
+        merge_method = AggregatedDataVariants::Type::key_string_hash64;
+
     /// Temporary data for aggregation.
     AggregatedDataVariants result;
 
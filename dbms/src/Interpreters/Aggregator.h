@@ -9,11 +9,14 @@
 #include <common/logger_useful.h>
 
 #include <common/StringRef.h>
+#include <Common/config.h>
 #include <Common/Arena.h>
 #include <Common/HashTable/HashMap.h>
+#include <Common/HashTable/FixedHashMap.h>
 #include <Common/HashTable/TwoLevelHashMap.h>
-#include <common/ThreadPool.h>
+#include <Common/ThreadPool.h>
 #include <Common/UInt128.h>
+#include <Common/ShortStringKey.h>
 #include <Common/LRUCache.h>
 
 #include <DataStreams/IBlockInputStream.h>
@@ -40,6 +43,7 @@ namespace ErrorCodes
 }
 
 class IBlockOutputStream;
+struct CompiledAggregateFunctions;
 
 
 /** Different data structures that can be used for aggregation
@@ -63,16 +67,19 @@ class IBlockOutputStream;
 
 using AggregatedDataWithoutKey = AggregateDataPtr;
 
-using AggregatedDataWithUInt8Key = HashMap<UInt64, AggregateDataPtr, TrivialHash, HashTableFixedGrower<8>>;
-using AggregatedDataWithUInt16Key = HashMap<UInt64, AggregateDataPtr, TrivialHash, HashTableFixedGrower<16>>;
+/// For 1-2 byte keys a direct-addressed array is used instead of a hash table: no hashing, no probing.
+using AggregatedDataWithUInt8Key = FixedHashMap<UInt8, AggregateDataPtr>;
+using AggregatedDataWithUInt16Key = FixedHashMap<UInt16, AggregateDataPtr>;
 
 using AggregatedDataWithUInt64Key = HashMap<UInt64, AggregateDataPtr, HashCRC32<UInt64>>;
 using AggregatedDataWithStringKey = HashMapWithSavedHash<StringRef, AggregateDataPtr>;
+using AggregatedDataWithShortStringKey = HashMapWithSavedHash<ShortStringKey, AggregateDataPtr, ShortStringKeyHash>;
 using AggregatedDataWithKeys128 = HashMap<UInt128, AggregateDataPtr, UInt128HashCRC32>;
 using AggregatedDataWithKeys256 = HashMap<UInt256, AggregateDataPtr, UInt256HashCRC32>;
 
 using AggregatedDataWithUInt64KeyTwoLevel = TwoLevelHashMap<UInt64, AggregateDataPtr, HashCRC32<UInt64>>;
 using AggregatedDataWithStringKeyTwoLevel = TwoLevelHashMapWithSavedHash<StringRef, AggregateDataPtr>;
+using AggregatedDataWithShortStringKeyTwoLevel = TwoLevelHashMapWithSavedHash<ShortStringKey, AggregateDataPtr, ShortStringKeyHash>;
 using AggregatedDataWithKeys128TwoLevel = TwoLevelHashMap<UInt128, AggregateDataPtr, UInt128HashCRC32>;
 using AggregatedDataWithKeys256TwoLevel = TwoLevelHashMap<UInt256, AggregateDataPtr, UInt256HashCRC32>;
 
@@ -161,6 +168,8 @@ struct AggregationMethodOneNumber
     /** Do not use optimization for consecutive keys.
       */
     static const bool no_consecutive_keys_optimization = false;
+    /// The key is cheap to compute twice and getKey has no side effects: allow prefetching the cell for a row ahead.
+    static const bool prefetch_optimization = true;
     /// Use optimization for low cardinality.
     static const bool low_cardinality_optimization = false;
 
@@ -236,6 +245,8 @@ struct AggregationMethodString
     static ALWAYS_INLINE void onExistingKey(const Key & /*key*/, StringRefs & /*keys*/, Arena & /*pool*/) {}
 
     static const bool no_consecutive_keys_optimization = false;
+    /// getKey either hashes the whole key or has side effects on the arena: do not compute it twice for prefetching.
+    static const bool prefetch_optimization = false;
     static const bool low_cardinality_optimization = false;
 
     static StringRef getValueRef(const typename Data::value_type & value)
@@ -252,6 +263,85 @@ struct AggregationMethodString
 };
 
 
+/** For the case where there is one string key, with short strings stored in the hash table itself.
+  * Strings of up to 23 bytes are kept inline in the key (see ShortStringKey), so that for them
+  *  aggregation does not touch the arena and compares keys without an indirection.
+  * Longer strings are stored in the arena and referenced through a pointer, as in AggregationMethodString.
+  */
+template <typename TData>
+struct AggregationMethodShortString
+{
+    using Data = TData;
+    using Key = typename Data::key_type;
+    using Mapped = typename Data::mapped_type;
+    using iterator = typename Data::iterator;
+    using const_iterator = typename Data::const_iterator;
+
+    Data data;
+
+    AggregationMethodShortString() {}
+
+    template <typename Other>
+    AggregationMethodShortString(const Other & other) : data(other.data) {}
+
+    struct State
+    {
+        const ColumnString::Offsets * offsets;
+        const ColumnString::Chars * chars;
+
+        void init(ColumnRawPtrs & key_columns)
+        {
+            const IColumn & column = *key_columns[0];
+            const ColumnString & column_string = static_cast<const ColumnString &>(column);
+            offsets = &column_string.getOffsets();
+            chars = &column_string.getChars();
+        }
+
+        ALWAYS_INLINE Key getKey(
+            const ColumnRawPtrs & /*key_columns*/,
+            size_t /*keys_size*/,
+            size_t i,
+            const Sizes & /*key_sizes*/,
+            StringRefs & /*keys*/,
+            Arena & /*pool*/) const
+        {
+            return ShortStringKey(
+                reinterpret_cast<const char *>(&(*chars)[i == 0 ? 0 : (*offsets)[i - 1]]),
+                (i == 0 ? (*offsets)[i] : ((*offsets)[i] - (*offsets)[i - 1])) - 1);
+        }
+    };
+
+    static AggregateDataPtr & getAggregateData(Mapped & value)                { return value; }
+    static const AggregateDataPtr & getAggregateData(const Mapped & value)    { return value; }
+
+    static ALWAYS_INLINE void onNewKey(typename Data::value_type & value, size_t /*keys_size*/, StringRefs & /*keys*/, Arena & pool)
+    {
+        /// An inline string is fully contained in the key; only a referenced one must be persisted.
+        if (!value.first.isInline())
+            value.first.setData(pool.insert(value.first.data(), value.first.size()));
+    }
+
+    static ALWAYS_INLINE void onExistingKey(const Key & /*key*/, StringRefs & /*keys*/, Arena & /*pool*/) {}
+
+    static const bool no_consecutive_keys_optimization = false;
+    /// getKey either hashes the whole key or has side effects on the arena: do not compute it twice for prefetching.
+    static const bool prefetch_optimization = false;
+    static const bool low_cardinality_optimization = false;
+
+    static StringRef getValueRef(const typename Data::value_type & value)
+    {
+        return value.first.toStringRef();
+    }
+
+    static void insertKeyIntoColumns(const typename Data::value_type & value, MutableColumns & key_columns, const Sizes &)
+    {
+        key_columns[0]->insertData(value.first.data(), value.first.size());
+    }
+
+    static AggregationStateCachePtr createCache(const AggregationStateCache::Settings & /*settings*/) { return nullptr; }
+};
+
+
 /// For the case where there is one fixed-length string key.
 template <typename TData>
 struct AggregationMethodFixedString
@@ -305,6 +395,8 @@ struct AggregationMethodFixedString
     static ALWAYS_INLINE void onExistingKey(const Key &, StringRefs &, Arena &) {}
 
     static const bool no_consecutive_keys_optimization = false;
+    /// getKey either hashes the whole key or has side effects on the arena: do not compute it twice for prefetching.
+    static const bool prefetch_optimization = false;
     static const bool low_cardinality_optimization = false;
 
     static StringRef getValueRef(const typename Data::value_type & value)
@@ -578,6 +670,8 @@ struct AggregationMethodSingleLowCardinalityColumn : public SingleColumnMethod
     }
 
     static const bool no_consecutive_keys_optimization = true;
+    /// Keys are obtained through the dictionary, not through getKey.
+    static const bool prefetch_optimization = false;
     static const bool low_cardinality_optimization = true;
 
     static void insertKeyIntoColumns(const typename Data::value_type & value, MutableColumns & key_columns, const Sizes & /*key_sizes*/)
@@ -781,6 +875,8 @@ struct AggregationMethodKeysFixed
     static ALWAYS_INLINE void onExistingKey(const Key &, StringRefs &, Arena &) {}
 
     static const bool no_consecutive_keys_optimization = false;
+    /// The key is cheap to compute twice and getKey has no side effects: allow prefetching the cell for a row ahead.
+    static const bool prefetch_optimization = true;
     static const bool low_cardinality_optimization = false;
 
     static void insertKeyIntoColumns(const typename Data::value_type & value, MutableColumns & key_columns, const Sizes & key_sizes)
@@ -891,6 +987,8 @@ struct AggregationMethodSerialized
 
     /// If the key already was, it is removed from the pool (overwritten), and the next key can not be compared with it.
     static const bool no_consecutive_keys_optimization = true;
+    /// getKey either hashes the whole key or has side effects on the arena: do not compute it twice for prefetching.
+    static const bool prefetch_optimization = false;
     static const bool low_cardinality_optimization = false;
 
     static void insertKeyIntoColumns(const typename Data::value_type & value, MutableColumns & key_columns, const Sizes &)
@@ -944,6 +1042,7 @@ struct AggregatedDataVariants : private boost::noncopyable
     std::unique_ptr<AggregationMethodOneNumber<UInt32, AggregatedDataWithUInt64Key>>         key32;
     std::unique_ptr<AggregationMethodOneNumber<UInt64, AggregatedDataWithUInt64Key>>         key64;
     std::unique_ptr<AggregationMethodString<AggregatedDataWithStringKey>>                    key_string;
+    std::unique_ptr<AggregationMethodShortString<AggregatedDataWithShortStringKey>>          key_short_string;
     std::unique_ptr<AggregationMethodFixedString<AggregatedDataWithStringKey>>               key_fixed_string;
     std::unique_ptr<AggregationMethodKeysFixed<AggregatedDataWithKeys128>>                   keys128;
     std::unique_ptr<AggregationMethodKeysFixed<AggregatedDataWithKeys256>>                   keys256;
@@ -952,6 +1051,7 @@ struct AggregatedDataVariants : private boost::noncopyable
     std::unique_ptr<AggregationMethodOneNumber<UInt32, AggregatedDataWithUInt64KeyTwoLevel>> key32_two_level;
     std::unique_ptr<AggregationMethodOneNumber<UInt64, AggregatedDataWithUInt64KeyTwoLevel>> key64_two_level;
     std::unique_ptr<AggregationMethodString<AggregatedDataWithStringKeyTwoLevel>>            key_string_two_level;
+    std::unique_ptr<AggregationMethodShortString<AggregatedDataWithShortStringKeyTwoLevel>>  key_short_string_two_level;
     std::unique_ptr<AggregationMethodFixedString<AggregatedDataWithStringKeyTwoLevel>>       key_fixed_string_two_level;
     std::unique_ptr<AggregationMethodKeysFixed<AggregatedDataWithKeys128TwoLevel>>           keys128_two_level;
     std::unique_ptr<AggregationMethodKeysFixed<AggregatedDataWithKeys256TwoLevel>>           keys256_two_level;
@@ -995,6 +1095,7 @@ struct AggregatedDataVariants : private boost::noncopyable
         M(key32,                      false) \
         M(key64,                      false) \
         M(key_string,                 false) \
+        M(key_short_string,           false) \
         M(key_fixed_string,           false) \
         M(keys128,                    false) \
         M(keys256,                    false) \
@@ -1002,6 +1103,7 @@ struct AggregatedDataVariants : private boost::noncopyable
         M(key32_two_level,            true) \
         M(key64_two_level,            true) \
         M(key_string_two_level,       true) \
+        M(key_short_string_two_level, true) \
         M(key_fixed_string_two_level, true) \
         M(keys128_two_level,          true) \
         M(keys256_two_level,          true) \
@@ -1141,6 +1243,7 @@ struct AggregatedDataVariants : private boost::noncopyable
         M(key32)            \
         M(key64)            \
         M(key_string)       \
+        M(key_short_string) \
         M(key_fixed_string) \
         M(keys128)          \
         M(keys256)          \
@@ -1191,6 +1294,7 @@ struct AggregatedDataVariants : private boost::noncopyable
         M(key32_two_level)            \
         M(key64_two_level)            \
         M(key_string_two_level)       \
+        M(key_short_string_two_level) \
         M(key_fixed_string_two_level) \
         M(keys128_two_level)          \
         M(keys256_two_level)          \
@@ -1300,6 +1404,9 @@ public:
         Compiler * compiler;
         const UInt32 min_count_to_compile;
 
+        /// Compile a fused native loop over the `add` methods of the aggregate functions (requires LLVM).
+        const bool compile_aggregate_functions;
+
         /// Two-level aggregation settings (used for a large number of keys).
         /** With how many keys or the size of the aggregation state in bytes,
           *  two-level aggregation begins to be used. Enough to reach of at least one of the thresholds.
@@ -1311,6 +1418,11 @@ public:
         /// Settings to flush temporary data to the filesystem (external aggregation).
         const size_t max_bytes_before_external_group_by;        /// 0 - do not use external aggregation.
 
+        /// Start external aggregation when memory usage of the query exceeds this share of its
+        /// memory limit. Spilling then begins before the limit is fully exhausted, so large
+        /// GROUP BYs degrade into external aggregation instead of failing at the limit. 0 - not used.
+        const double max_bytes_ratio_before_external_group_by;
+
         /// Return empty result when aggregating without keys on empty set.
         bool empty_result_for_aggregation_by_empty_set;
 
@@ -1323,17 +1435,19 @@ public:
             const Block & src_header_,
             const ColumnNumbers & keys_, const AggregateDescriptions & aggregates_,
             bool overflow_row_, size_t max_rows_to_group_by_, OverflowMode group_by_overflow_mode_,
-            Compiler * compiler_, UInt32 min_count_to_compile_,
+            Compiler * compiler_, UInt32 min_count_to_compile_, bool compile_aggregate_functions_,
             size_t group_by_two_level_threshold_, size_t group_by_two_level_threshold_bytes_,
             size_t max_bytes_before_external_group_by_,
+            double max_bytes_ratio_before_external_group_by_,
             bool empty_result_for_aggregation_by_empty_set_,
             const std::string & tmp_path_, size_t max_threads_)
             : src_header(src_header_),
             keys(keys_), aggregates(aggregates_), keys_size(keys.size()), aggregates_size(aggregates.size()),
             overflow_row(overflow_row_), max_rows_to_group_by(max_rows_to_group_by_), group_by_overflow_mode(group_by_overflow_mode_),
-            compiler(compiler_), min_count_to_compile(min_count_to_compile_),
+            compiler(compiler_), min_count_to_compile(min_count_to_compile_), compile_aggregate_functions(compile_aggregate_functions_),
             group_by_two_level_threshold(group_by_two_level_threshold_), group_by_two_level_threshold_bytes(group_by_two_level_threshold_bytes_),
             max_bytes_before_external_group_by(max_bytes_before_external_group_by_),
+            max_bytes_ratio_before_external_group_by(max_bytes_ratio_before_external_group_by_),
             empty_result_for_aggregation_by_empty_set(empty_result_for_aggregation_by_empty_set_),
             tmp_path(tmp_path_), max_threads(max_threads_)
         {
@@ -1342,7 +1456,7 @@ public:
         /// Only parameters that matter during merge.
         Params(const Block & intermediate_header_,
             const ColumnNumbers & keys_, const AggregateDescriptions & aggregates_, bool overflow_row_, size_t max_threads_)
-            : Params(Block(), keys_, aggregates_, overflow_row_, 0, OverflowMode::THROW, nullptr, 0, 0, 0, 0, false, "", max_threads_)
+            : Params(Block(), keys_, aggregates_, overflow_row_, 0, OverflowMode::THROW, nullptr, 0, false, 0, 0, 0, 0., false, "", max_threads_)
         {
             intermediate_header = intermediate_header_;
         }
@@ -1491,6 +1605,17 @@ protected:
     bool compiled_if_possible = false;
     void compileIfPossible(AggregatedDataVariants::Type type);
 
+#if USE_EMBEDDED_COMPILER
+    /** Native code for the fused inner loop over the `add` methods of the compilable aggregate functions, if any.
+      * Unlike `compiled_data` above, this does not specialize the hash table code -
+      *  it replaces the per-row virtual calls in executeImplCase / executeWithoutKeyImpl.
+      */
+    std::shared_ptr<CompiledAggregateFunctions> compiled_aggregate_functions;
+    std::vector<bool> is_aggregate_function_compiled;
+
+    void compileAggregateFunctionsIfPossible();
+#endif
+
     /// Returns true if you can abort the current task.
     CancellationHook isCancelled;
 
@@ -1523,6 +1648,8 @@ protected:
         AggregateDataPtr overflow_row) const;
 
     /// Specialization for a particular value no_more_keys.
+    /// If `places` is not nullptr, the values are not added to the aggregate functions here;
+    ///  instead, the place of every row is written into `places` for the compiled fused loop.
     template <bool no_more_keys, typename Method>
     void executeImplCase(
         Method & method,
@@ -1532,7 +1659,19 @@ protected:
         ColumnRawPtrs & key_columns,
         AggregateFunctionInstruction * aggregate_instructions,
         StringRefs & keys,
-        AggregateDataPtr overflow_row) const;
+        AggregateDataPtr overflow_row,
+        AggregateDataPtr * places) const;
+
+#if USE_EMBEDDED_COMPILER
+    /// Run the compiled fused `add` loop over the gathered places (or over `single_place` if `places` is nullptr)
+    ///  and add the values of the functions that were not compiled row by row, as before.
+    void executeCompiledAddLoop(
+        size_t rows,
+        AggregateFunctionInstruction * aggregate_instructions,
+        AggregateDataPtr * places,
+        AggregateDataPtr single_place,
+        Arena * aggregates_pool) const;
+#endif
 
     /// For case when there are no keys (all aggregate into one row).
     void executeWithoutKeyImpl(
@@ -1603,7 +1742,7 @@ protected:
         Arena * arena) const;
 
     void mergeWithoutKeyDataImpl(
-        ManyAggregatedDataVariants & non_empty_data) const;
+        ManyAggregatedDataVariants & non_empty_data, size_t max_threads) const;
 
     template <typename Method>
     void mergeSingleLevelDataImpl(
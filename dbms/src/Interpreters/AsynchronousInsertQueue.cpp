@@ -0,0 +1,223 @@
+#include <Interpreters/AsynchronousInsertQueue.h>
+#include <Interpreters/Context.h>
+#include <Interpreters/InterpreterInsertQuery.h>
+#include <Interpreters/Settings.h>
+#include <Parsers/ASTExpressionList.h>
+#include <Parsers/ASTIdentifier.h>
+#include <Parsers/ASTInsertQuery.h>
+#include <Common/Exception.h>
+#include <Common/ProfileEvents.h>
+#include <Common/setThreadName.h>
+
+
+namespace ProfileEvents
+{
+    extern const Event AsyncInsertQuery;
+    extern const Event AsyncInsertFlush;
+}
+
+namespace DB
+{
+
+namespace ErrorCodes
+{
+    extern const int TIMEOUT_EXCEEDED;
+}
+
+
+AsynchronousInsertQueue::AsynchronousInsertQueue(Context & context_)
+    : context(context_), flush_thread([this] { flushThreadFunction(); })
+{
+}
+
+
+AsynchronousInsertQueue::~AsynchronousInsertQueue()
+{
+    is_shutdown = true;
+    flush_event.notify_all();
+
+    if (flush_thread.joinable())
+        flush_thread.join();
+
+    /// Flush the data that is still staged. Tables must not have been shut down yet.
+    std::vector<EntryPtr> rest;
+    {
+        std::lock_guard lock(mutex);
+        rest.swap(ready);
+        for (auto & key_entry : staging)
+            rest.push_back(key_entry.second);
+        staging.clear();
+    }
+
+    for (const auto & entry : rest)
+        flush(entry);
+}
+
+
+std::shared_future<void> AsynchronousInsertQueue::push(const String & database, const String & table,
+    const Block & block, UInt64 busy_timeout_ms, size_t max_data_size)
+{
+    ProfileEvents::increment(ProfileEvents::AsyncInsertQuery);
+
+    /// Blocks of different structure (e.g. INSERTs with different column lists) are staged separately,
+    ///  so rows can be appended without conversions. Only the names and types of the columns go into
+    ///  the key: dumpStructure() would also embed the sizes of the columns, and inserts would only
+    ///  coalesce when they happen to carry the same number of rows.
+    String key = database + "." + table;
+    for (const auto & column : block)
+        key += '\n' + column.name + ' ' + column.type->getName();
+
+    std::lock_guard lock(mutex);
+
+    EntryPtr & entry = staging[key];
+    if (!entry)
+    {
+        entry = std::make_shared<Entry>();
+        entry->database = database;
+        entry->table = table;
+        entry->data = block;
+        entry->deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(busy_timeout_ms);
+        entry->future = entry->promise.get_future().share();
+
+        /// The flush thread must recalculate the time of its next wakeup.
+        flush_event.notify_all();
+    }
+    else
+    {
+        MutableColumns columns = entry->data.mutateColumns();
+        for (size_t i = 0; i < columns.size(); ++i)
+            columns[i]->insertRangeFrom(*block.getByPosition(i).column, 0, block.rows());
+        entry->data.setColumns(std::move(columns));
+    }
+
+    std::shared_future<void> res = entry->future;
+
+    if (entry->data.bytes() >= max_data_size)
+    {
+        ready.push_back(entry);
+        staging.erase(key);
+        flush_event.notify_all();
+    }
+
+    return res;
+}
+
+
+void AsynchronousInsertQueue::flushThreadFunction()
+{
+    setThreadName("AsyncInsertQ");
+
+    while (!is_shutdown)
+    {
+        std::vector<EntryPtr> to_flush;
+
+        {
+            std::unique_lock lock(mutex);
+
+            to_flush.swap(ready);
+
+            auto now = std::chrono::steady_clock::now();
+            auto wake_time = now + std::chrono::seconds(1);
+
+            for (auto it = staging.begin(); it != staging.end();)
+            {
+                if (it->second->deadline <= now)
+                {
+                    to_flush.push_back(it->second);
+                    it = staging.erase(it);
+                }
+                else
+                {
+                    wake_time = std::min(wake_time, it->second->deadline);
+                    ++it;
+                }
+            }
+
+            if (to_flush.empty())
+            {
+                flush_event.wait_until(lock, wake_time);
+                continue;
+            }
+        }
+
+        for (const auto & entry : to_flush)
+            flush(entry);
+    }
+}
+
+
+void AsynchronousInsertQueue::flush(const EntryPtr & entry)
+{
+    ProfileEvents::increment(ProfileEvents::AsyncInsertFlush);
+
+    try
+    {
+        /// We write to the table indirectly, using InterpreterInsertQuery,
+        ///  so that default columns and materialized views work as for a regular INSERT.
+        auto insert = std::make_shared<ASTInsertQuery>();
+        insert->database = entry->database;
+        insert->table = entry->table;
+
+        auto columns = std::make_shared<ASTExpressionList>();
+        for (const auto & column : entry->data)
+            columns->children.push_back(std::make_shared<ASTIdentifier>(column.name));
+        insert->columns = columns;
+
+        Context insert_context = context;
+        /// The flush itself must be a regular INSERT regardless of the profile of the default user.
+        insert_context.setSetting("async_insert", UInt64(0));
+
+        InterpreterInsertQuery interpreter(insert, insert_context);
+        BlockIO io = interpreter.execute();
+
+        io.out->writePrefix();
+        io.out->write(entry->data);
+        io.out->writeSuffix();
+
+        entry->promise.set_value();
+    }
+    catch (...)
+    {
+        tryLogCurrentException(__PRETTY_FUNCTION__);
+        entry->promise.set_exception(std::current_exception());
+    }
+}
+
+
+AsynchronousInsertBlockOutputStream::AsynchronousInsertBlockOutputStream(AsynchronousInsertQueue & queue_,
+    const String & database_, const String & table_, const Block & header_, const Settings & settings)
+    : queue(queue_), database(database_), table(table_), header(header_),
+    busy_timeout_ms(settings.async_insert_busy_timeout_ms.totalMilliseconds()),
+    max_data_size(settings.async_insert_max_data_size),
+    wait_for_flush(settings.wait_for_async_insert),
+    wait_timeout_seconds(settings.wait_for_async_insert_timeout.totalSeconds())
+{
+}
+
+
+void AsynchronousInsertBlockOutputStream::write(const Block & block)
+{
+    if (!block || !block.rows())
+        return;
+
+    futures.push_back(queue.push(database, table, block, busy_timeout_ms, max_data_size));
+}
+
+
+void AsynchronousInsertBlockOutputStream::writeSuffix()
+{
+    if (!wait_for_flush)
+        return;
+
+    for (auto & future : futures)
+    {
+        if (future.wait_for(std::chrono::seconds(wait_timeout_seconds)) != std::future_status::ready)
+            throw Exception("Timeout exceeded while waiting for asynchronous insert into " + database + "." + table
+                + " to be flushed", ErrorCodes::TIMEOUT_EXCEEDED);
+
+        /// Rethrows the exception of the flush, if it has failed.
+        future.get();
+    }
+}
+
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <Core/Block.h>
+#include <DataStreams/IBlockOutputStream.h>
+#include <Common/ThreadPool.h>
+
+
+namespace DB
+{
+
+class Context;
+struct Settings;
+
+
+/** Server-side coalescing of small INSERTs (the async_insert setting).
+  *
+  * Many clients inserting a few rows each create a part per INSERT, and merges cannot keep up.
+  * Instead, the data of such INSERTs is accumulated in an in-memory staging buffer,
+  *  keyed by the destination table and the structure of the inserted block,
+  *  and written to the table as a single block when the buffer grows large enough
+  *  (async_insert_max_data_size) or old enough (async_insert_busy_timeout_ms).
+  *
+  * The client either gets the acknowledgment right away, or (wait_for_async_insert, the default)
+  *  waits until its data has actually been flushed, so errors of the flush are delivered to it.
+  *
+  * The flush goes through InterpreterInsertQuery, so default columns and materialized views work as usual.
+  */
+class AsynchronousInsertQueue
+{
+public:
+    AsynchronousInsertQueue(Context & context_);
+    ~AsynchronousInsertQueue();
+
+    /// Appends the block to the staging buffer of the table.
+    /// Returns a future that becomes ready when the buffer has been flushed into the table
+    ///  (with an exception inside, if the flush has failed).
+    std::shared_future<void> push(const String & database, const String & table,
+        const Block & block, UInt64 busy_timeout_ms, size_t max_data_size);
+
+private:
+    struct Entry
+    {
+        String database;
+        String table;
+        Block data;
+        std::chrono::steady_clock::time_point deadline;
+
+        std::promise<void> promise;
+        std::shared_future<void> future;
+    };
+
+    using EntryPtr = std::shared_ptr<Entry>;
+
+    void flushThreadFunction();
+    void flush(const EntryPtr & entry);
+
+    Context & context;    /// Global context.
+
+    std::mutex mutex;
+    /// Buffers that are still accumulating data, by (table, block structure).
+    std::map<String, EntryPtr> staging;
+    /// Buffers that exceeded the size threshold and await the flush thread.
+    std::vector<EntryPtr> ready;
+    /// Signalled on a new or oversized buffer and on shutdown.
+    std::condition_variable flush_event;
+    std::atomic<bool> is_shutdown {false};
+
+    ThreadFromGlobalPool flush_thread;
+};
+
+
+/// The stream that INSERT queries write into when async_insert is enabled.
+/// Data goes to the staging buffers; writeSuffix optionally waits for the flush.
+class AsynchronousInsertBlockOutputStream : public IBlockOutputStream
+{
+public:
+    AsynchronousInsertBlockOutputStream(AsynchronousInsertQueue & queue_,
+        const String & database_, const String & table_, const Block & header_, const Settings & settings);
+
+    Block getHeader() const override { return header; }
+    void write(const Block & block) override;
+    void writeSuffix() override;
+
+private:
+    AsynchronousInsertQueue & queue;
+    String database;
+    String table;
+    Block header;
+
+    UInt64 busy_timeout_ms;
+    size_t max_data_size;
+    bool wait_for_flush;
+    UInt64 wait_timeout_seconds;
+
+    std::vector<std::shared_future<void>> futures;
+};
+
+}
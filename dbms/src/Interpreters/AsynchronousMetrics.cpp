@@ -9,6 +9,7 @@
 #include <Storages/StorageMergeTree.h>
 #include <Storages/StorageReplicatedMergeTree.h>
 #include <IO/UncompressedCache.h>
+#include <IO/CompressedBlockCache.h>
 #include <Databases/IDatabase.h>
 #include <chrono>
 
@@ -134,6 +135,14 @@ void AsynchronousMetrics::update()
         }
     }
 
+    {
+        if (auto compressed_block_cache = context.getCompressedBlockCache())
+        {
+            set("CompressedBlockCacheBytes", compressed_block_cache->weight());
+            set("CompressedBlockCacheCells", compressed_block_cache->count());
+        }
+    }
+
 #if USE_EMBEDDED_COMPILER
     {
         if (auto compiled_expression_cache = context.getCompiledExpressionCache())
@@ -92,7 +92,12 @@ void SelectStreamFactory::createForShard(
 
     const auto & settings = context.getSettingsRef();
 
-    if (settings.prefer_localhost_replica && shard_info.isLocal())
+    /// If several replicas of the shard are to process the query in parallel (see max_parallel_replicas),
+    /// the query must go through the pool even if one of the replicas is local:
+    /// the local replica alone would process only its share of the data.
+    bool use_parallel_replicas = settings.max_parallel_replicas > 1 && shard_info.hasRemoteConnections();
+
+    if (settings.prefer_localhost_replica && shard_info.isLocal() && !use_parallel_replicas)
     {
         StoragePtr main_table_storage;
 
@@ -11,6 +11,7 @@
 #include <Common/escapeForFileName.h>
 #include <Common/setThreadName.h>
 #include <Common/Stopwatch.h>
+#include <Common/Throttler.h>
 #include <Common/formatReadable.h>
 #include <Core/BackgroundSchedulePool.h>
 #include <Formats/FormatFactory.h>
@@ -35,15 +36,25 @@
 #include <Interpreters/ProcessList.h>
 #include <Interpreters/Cluster.h>
 #include <Interpreters/InterserverIOHandler.h>
+#include <Interpreters/ShuffleExchange.h>
 #include <Interpreters/Compiler.h>
 #include <Interpreters/SystemLog.h>
 #include <Interpreters/QueryLog.h>
 #include <Interpreters/QueryThreadLog.h>
 #include <Interpreters/PartLog.h>
+#include <Interpreters/TraceLog.h>
+#include <Interpreters/MetricLog.h>
+#include <Interpreters/AsynchronousInsertQueue.h>
+#include <Interpreters/TraceCollector.h>
 #include <Interpreters/Context.h>
 #include <Common/DNSResolver.h>
 #include <IO/ReadBufferFromFile.h>
 #include <IO/UncompressedCache.h>
+#include <IO/MMappedFileCache.h>
+#include <IO/CompressedBlockCache.h>
+#include <Interpreters/QueryResultCache.h>
+#include <Interpreters/QueryParseCache.h>
+#include <Interpreters/SubqueryResultCache.h>
 #include <Parsers/ASTCreateQuery.h>
 #include <Parsers/ParserCreateQuery.h>
 #include <Parsers/parseQuery.h>
@@ -87,6 +98,8 @@ namespace ErrorCodes
     extern const int SESSION_NOT_FOUND;
     extern const int SESSION_IS_LOCKED;
     extern const int CANNOT_GET_CREATE_TABLE_QUERY;
+    extern const int UNKNOWN_PREPARED_STATEMENT;
+    extern const int TOO_MANY_PREPARED_STATEMENTS;
 }
 
 
@@ -131,16 +144,25 @@ struct ContextShared
     std::shared_ptr<ISecurityManager> security_manager;     /// Known users.
     Quotas quotas;                                          /// Known quotas for resource use.
     mutable UncompressedCachePtr uncompressed_cache;        /// The cache of decompressed blocks.
+    mutable MMappedFileCachePtr mmapped_file_cache;         /// Cache of memory mapped data files (see min_bytes_to_use_mmap_io).
+    mutable CompressedBlockCachePtr compressed_block_cache; /// The cache of compressed blocks (a tier below the cache of decompressed blocks).
     mutable MarkCachePtr mark_cache;                        /// Cache of marks in compressed files.
+    mutable QueryResultCachePtr query_result_cache;         /// Cache of complete query results.
+    mutable SubqueryResultCachePtr subquery_result_cache;   /// Cache of materialized subqueries (IN sets and scalars).
+    mutable QueryParseCachePtr query_parse_cache;           /// Cache of parsed queries.
     ProcessList process_list;                               /// Executing queries at the moment.
     MergeList merge_list;                                   /// The list of executable merge (for (Replicated)?MergeTree)
     ViewDependencies view_dependencies;                     /// Current dependencies
     ConfigurationPtr users_config;                          /// Config with the users, profiles and quotas sections.
     InterserverIOHandler interserver_io_handler;            /// Handler for interserver communication.
+    ShuffleExchangeRegistry shuffle_exchange_registry;      /// Rendezvous points for interserver exchange of temporary query data.
     BackgroundProcessingPoolPtr background_pool;            /// The thread pool for the background work performed by the tables.
     BackgroundSchedulePoolPtr schedule_pool;                /// A thread pool that can run different jobs in background (used in replicated tables)
+    mutable ThrottlerPtr replicated_fetches_throttler;      /// Server-wide bandwidth limit for fetches of parts from replicas.
+    mutable std::shared_ptr<AsynchronousInsertQueue> asynchronous_insert_queue;    /// Staging buffers of asynchronous INSERTs.
     MultiVersion<Macros> macros;                            /// Substitutions extracted from config.
     std::unique_ptr<Compiler> compiler;                     /// Used for dynamic compilation of queries' parts if it necessary.
+    std::unique_ptr<TraceCollector> trace_collector;        /// Reads query profiler samples from the trace pipe into system.trace_log.
     std::shared_ptr<DDLWorker> ddl_worker;                  /// Process ddl commands from zk.
     /// Rules for selecting the compression settings, depending on the size of the part.
     mutable std::unique_ptr<CompressionSettingsSelector> compression_settings_selector;
@@ -242,6 +264,12 @@ struct ContextShared
             return;
         shutdown_called = true;
 
+        /// Stop the trace collector while the trace log it writes to is still alive.
+        trace_collector.reset();
+
+        /// Flush the remaining asynchronously inserted data while the tables are still alive.
+        asynchronous_insert_queue.reset();
+
         /** At this point, some tables may have threads that block our mutex.
           * To complete them correctly, we will copy the current list of tables,
           *  and ask them all to finish their work.
@@ -305,6 +333,8 @@ Context::~Context()
 
 InterserverIOHandler & Context::getInterserverIOHandler() { return shared->interserver_io_handler; }
 
+ShuffleExchangeRegistry & Context::getShuffleExchangeRegistry() { return shared->shuffle_exchange_registry; }
+
 std::unique_lock<std::recursive_mutex> Context::getLock() const
 {
     ProfileEvents::increment(ProfileEvents::ContextLock);
@@ -578,15 +608,15 @@ void Context::calculateUserSettings()
     /// 1) Set default settings (hardcoded values)
     /// NOTE: we ignore global_context settings (from which it is usually copied)
     /// NOTE: global_context settings are immutable and not auto updated
-    settings = Settings();
+    settings = std::make_shared<Settings>();
 
     /// 2) Apply settings from default profile
     auto default_profile_name = getDefaultProfileName();
     if (profile != default_profile_name)
-        settings.setProfile(default_profile_name, *shared->users_config);
+        settings->setProfile(default_profile_name, *shared->users_config);
 
     /// 3) Apply settings from current user
-    settings.setProfile(profile, *shared->users_config);
+    settings->setProfile(profile, *shared->users_config);
 }
 
 
@@ -880,6 +910,35 @@ StoragePtr Context::tryRemoveExternalTable(const String & table_name)
 }
 
 
+void Context::setPreparedStatement(const String & name, ASTPtr ast, size_t max_count)
+{
+    /// Re-preparing an existing name replaces the statement.
+    if (max_count && prepared_statements.size() >= max_count && !prepared_statements.count(name))
+        throw Exception("Too many prepared statements in the session (max_prepared_statements = "
+            + toString(max_count) + ")", ErrorCodes::TOO_MANY_PREPARED_STATEMENTS);
+
+    prepared_statements[name] = std::move(ast);
+}
+
+
+ASTPtr Context::getPreparedStatement(const String & name) const
+{
+    auto it = prepared_statements.find(name);
+
+    if (prepared_statements.end() == it)
+        throw Exception("Unknown prepared statement " + backQuoteIfNeed(name), ErrorCodes::UNKNOWN_PREPARED_STATEMENT);
+
+    return it->second;
+}
+
+
+void Context::removePreparedStatement(const String & name)
+{
+    if (!prepared_statements.erase(name))
+        throw Exception("Unknown prepared statement " + backQuoteIfNeed(name), ErrorCodes::UNKNOWN_PREPARED_STATEMENT);
+}
+
+
 StoragePtr Context::executeTableFunction(const ASTPtr & table_expression)
 {
     /// Slightly suboptimal.
@@ -978,37 +1037,41 @@ ASTPtr Context::getCreateDatabaseQuery(const String & database_name) const
 
 Settings Context::getSettings() const
 {
-    return settings;
+    return *settings;
 }
 
 
 void Context::setSettings(const Settings & settings_)
 {
-    settings = settings_;
+    settings = std::make_shared<Settings>(settings_);
 }
 
 
 void Context::setSetting(const String & name, const Field & value)
 {
+    unshareSettings();
+
     if (name == "profile")
     {
         auto lock = getLock();
-        settings.setProfile(value.safeGet<String>(), *shared->users_config);
+        settings->setProfile(value.safeGet<String>(), *shared->users_config);
     }
     else
-        settings.set(name, value);
+        settings->set(name, value);
 }
 
 
 void Context::setSetting(const String & name, const std::string & value)
 {
+    unshareSettings();
+
     if (name == "profile")
     {
         auto lock = getLock();
-        settings.setProfile(value, *shared->users_config);
+        settings->setProfile(value, *shared->users_config);
     }
     else
-        settings.set(name, value);
+        settings->set(name, value);
 }
 
 
@@ -1274,14 +1337,14 @@ ProcessList::Element * Context::getProcessListElement() const
 }
 
 
-void Context::setUncompressedCache(size_t max_size_in_bytes)
+void Context::setUncompressedCache(size_t max_size_in_bytes, size_t num_shards)
 {
     auto lock = getLock();
 
     if (shared->uncompressed_cache)
         throw Exception("Uncompressed cache has been already created.", ErrorCodes::LOGICAL_ERROR);
 
-    shared->uncompressed_cache = std::make_shared<UncompressedCache>(max_size_in_bytes);
+    shared->uncompressed_cache = std::make_shared<UncompressedCache>(max_size_in_bytes, num_shards);
 }
 
 
@@ -1300,14 +1363,53 @@ void Context::dropUncompressedCache() const
 }
 
 
-void Context::setMarkCache(size_t cache_size_in_bytes)
+MMappedFileCachePtr Context::getMMappedFileCache() const
+{
+    auto lock = getLock();
+
+    /// Created lazily with a fixed number of entries: the mappings consume address space,
+    ///  not memory, so there is no sizeable resource to make configurable.
+    if (!shared->mmapped_file_cache)
+        shared->mmapped_file_cache = std::make_shared<MMappedFileCache>(1000);
+
+    return shared->mmapped_file_cache;
+}
+
+
+void Context::setCompressedBlockCache(size_t max_size_in_bytes, size_t num_shards)
+{
+    auto lock = getLock();
+
+    if (shared->compressed_block_cache)
+        throw Exception("Compressed block cache has been already created.", ErrorCodes::LOGICAL_ERROR);
+
+    shared->compressed_block_cache = std::make_shared<CompressedBlockCache>(max_size_in_bytes, num_shards);
+}
+
+
+CompressedBlockCachePtr Context::getCompressedBlockCache() const
+{
+    auto lock = getLock();
+    return shared->compressed_block_cache;
+}
+
+
+void Context::dropCompressedBlockCache() const
+{
+    auto lock = getLock();
+    if (shared->compressed_block_cache)
+        shared->compressed_block_cache->reset();
+}
+
+
+void Context::setMarkCache(size_t cache_size_in_bytes, size_t num_shards)
 {
     auto lock = getLock();
 
     if (shared->mark_cache)
         throw Exception("Mark cache has been already created.", ErrorCodes::LOGICAL_ERROR);
 
-    shared->mark_cache = std::make_shared<MarkCache>(cache_size_in_bytes, std::chrono::seconds(settings.mark_cache_min_lifetime));
+    shared->mark_cache = std::make_shared<MarkCache>(cache_size_in_bytes, std::chrono::seconds(settings->mark_cache_min_lifetime), num_shards);
 }
 
 
@@ -1326,6 +1428,84 @@ void Context::dropMarkCache() const
 }
 
 
+void Context::setQueryResultCache(size_t max_size_in_bytes)
+{
+    auto lock = getLock();
+
+    if (shared->query_result_cache)
+        throw Exception("Query result cache has been already created.", ErrorCodes::LOGICAL_ERROR);
+
+    shared->query_result_cache = std::make_shared<QueryResultCache>(max_size_in_bytes);
+}
+
+
+QueryResultCachePtr Context::getQueryResultCache() const
+{
+    auto lock = getLock();
+    return shared->query_result_cache;
+}
+
+
+void Context::dropQueryResultCache() const
+{
+    auto lock = getLock();
+    if (shared->query_result_cache)
+        shared->query_result_cache->reset();
+}
+
+
+void Context::setQueryParseCache(size_t max_count)
+{
+    auto lock = getLock();
+
+    if (shared->query_parse_cache)
+        throw Exception("Query parse cache has been already created.", ErrorCodes::LOGICAL_ERROR);
+
+    shared->query_parse_cache = std::make_shared<QueryParseCache>(max_count);
+}
+
+
+QueryParseCachePtr Context::getQueryParseCache() const
+{
+    auto lock = getLock();
+    return shared->query_parse_cache;
+}
+
+
+void Context::dropQueryParseCache() const
+{
+    auto lock = getLock();
+    if (shared->query_parse_cache)
+        shared->query_parse_cache->reset();
+}
+
+
+void Context::setSubqueryResultCache(size_t max_size_in_bytes)
+{
+    auto lock = getLock();
+
+    if (shared->subquery_result_cache)
+        throw Exception("Subquery result cache has been already created.", ErrorCodes::LOGICAL_ERROR);
+
+    shared->subquery_result_cache = std::make_shared<SubqueryResultCache>(max_size_in_bytes);
+}
+
+
+SubqueryResultCachePtr Context::getSubqueryResultCache() const
+{
+    auto lock = getLock();
+    return shared->subquery_result_cache;
+}
+
+
+void Context::dropSubqueryResultCache() const
+{
+    auto lock = getLock();
+    if (shared->subquery_result_cache)
+        shared->subquery_result_cache->reset();
+}
+
+
 void Context::dropCaches() const
 {
     auto lock = getLock();
@@ -1333,6 +1513,9 @@ void Context::dropCaches() const
     if (shared->uncompressed_cache)
         shared->uncompressed_cache->reset();
 
+    if (shared->mmapped_file_cache)
+        shared->mmapped_file_cache->reset();
+
     if (shared->mark_cache)
         shared->mark_cache->reset();
 }
@@ -1341,7 +1524,7 @@ BackgroundProcessingPool & Context::getBackgroundPool()
 {
     auto lock = getLock();
     if (!shared->background_pool)
-        shared->background_pool = std::make_shared<BackgroundProcessingPool>(settings.background_pool_size);
+        shared->background_pool = std::make_shared<BackgroundProcessingPool>(settings->background_pool_size);
     return *shared->background_pool;
 }
 
@@ -1349,10 +1532,30 @@ BackgroundSchedulePool & Context::getSchedulePool()
 {
     auto lock = getLock();
     if (!shared->schedule_pool)
-        shared->schedule_pool = std::make_shared<BackgroundSchedulePool>(settings.background_schedule_pool_size);
+        shared->schedule_pool = std::make_shared<BackgroundSchedulePool>(settings->background_schedule_pool_size);
     return *shared->schedule_pool;
 }
 
+AsynchronousInsertQueue & Context::getAsynchronousInsertQueue() const
+{
+    auto lock = getLock();
+    if (!shared->asynchronous_insert_queue)
+        shared->asynchronous_insert_queue = std::make_shared<AsynchronousInsertQueue>(*global_context);
+    return *shared->asynchronous_insert_queue;
+}
+
+ThrottlerPtr Context::getReplicatedFetchesThrottler() const
+{
+    auto lock = getLock();
+    if (!shared->replicated_fetches_throttler)
+    {
+        size_t max_speed = getConfigRef().getUInt64("max_replicated_fetches_network_bandwidth_for_server", 0);
+        if (max_speed)
+            shared->replicated_fetches_throttler = std::make_shared<Throttler>(max_speed);
+    }
+    return shared->replicated_fetches_throttler;
+}
+
 void Context::setDDLWorker(std::shared_ptr<DDLWorker> ddl_worker)
 {
     auto lock = getLock();
@@ -1469,7 +1672,7 @@ void Context::reloadClusterConfig()
         }
 
         auto & config = cluster_config ? *cluster_config : getConfigRef();
-        auto new_clusters = std::make_unique<Clusters>(config, settings);
+        auto new_clusters = std::make_unique<Clusters>(config, *settings);
 
         {
             std::lock_guard<std::mutex> lock(shared->clusters_mutex);
@@ -1491,7 +1694,7 @@ Clusters & Context::getClusters() const
     if (!shared->clusters)
     {
         auto & config = shared->clusters_config ? *shared->clusters_config : getConfigRef();
-        shared->clusters = std::make_unique<Clusters>(config, settings);
+        shared->clusters = std::make_unique<Clusters>(config, *settings);
     }
 
     return *shared->clusters;
@@ -1506,9 +1709,9 @@ void Context::setClustersConfig(const ConfigurationPtr & config, const String &
     shared->clusters_config = config;
 
     if (!shared->clusters)
-        shared->clusters = std::make_unique<Clusters>(*shared->clusters_config, settings, config_name);
+        shared->clusters = std::make_unique<Clusters>(*shared->clusters_config, *settings, config_name);
     else
-        shared->clusters->updateClusters(*shared->clusters_config, settings, config_name);
+        shared->clusters->updateClusters(*shared->clusters_config, *settings, config_name);
 }
 
 
@@ -1592,6 +1795,89 @@ QueryThreadLog * Context::getQueryThreadLog(bool create_if_not_exists)
 }
 
 
+TraceLog * Context::getTraceLog(bool create_if_not_exists)
+{
+    auto lock = getLock();
+
+    if (!system_logs)
+        return nullptr;
+
+    /// Collecting profiler samples makes no sense without a table to store them in.
+    if (!getConfigRef().has("trace_log"))
+        return nullptr;
+
+    if (!system_logs->trace_log)
+    {
+        if (!create_if_not_exists)
+            return nullptr;
+
+        if (shared->shutdown_called)
+            throw Exception("Logical error: trace log should be destroyed before tables shutdown", ErrorCodes::LOGICAL_ERROR);
+
+        if (!global_context)
+            throw Exception("Logical error: no global context for trace log", ErrorCodes::LOGICAL_ERROR);
+
+        system_logs->trace_log = createDefaultSystemLog<TraceLog>(*global_context, "system", "trace_log", getConfigRef(), "trace_log");
+    }
+
+    return system_logs->trace_log.get();
+}
+
+
+MetricLog * Context::getMetricLog(bool create_if_not_exists)
+{
+    auto lock = getLock();
+
+    if (!system_logs)
+        return nullptr;
+
+    /// Collecting the metric history makes no sense without a table to store it in.
+    if (!getConfigRef().has("metric_log"))
+        return nullptr;
+
+    if (!system_logs->metric_log)
+    {
+        if (!create_if_not_exists)
+            return nullptr;
+
+        if (shared->shutdown_called)
+            throw Exception("Logical error: metric log should be destroyed before tables shutdown", ErrorCodes::LOGICAL_ERROR);
+
+        if (!global_context)
+            throw Exception("Logical error: no global context for metric log", ErrorCodes::LOGICAL_ERROR);
+
+        system_logs->metric_log = createDefaultSystemLog<MetricLog>(*global_context, "system", "metric_log", getConfigRef(), "metric_log");
+    }
+
+    return system_logs->metric_log.get();
+}
+
+
+void Context::initializeMetricLog()
+{
+    if (auto * metric_log = getMetricLog())
+        metric_log->startCollectMetric(getConfigRef().getUInt64("metric_log.collect_interval_milliseconds", 1000));
+}
+
+
+void Context::initializeTraceCollector()
+{
+    auto lock = getLock();
+
+    if (shared->trace_collector)
+        return;
+
+    if (auto * trace_log = getTraceLog())
+        shared->trace_collector = std::make_unique<TraceCollector>(trace_log);
+}
+
+
+bool Context::hasTraceCollector() const
+{
+    return shared->trace_collector != nullptr;
+}
+
+
 PartLog * Context::getPartLog(const String & part_database, bool create_if_not_exists)
 {
     auto lock = getLock();
@@ -1630,7 +1916,7 @@ PartLog * Context::getPartLog(const String & part_database, bool create_if_not_e
 }
 
 
-CompressionSettings Context::chooseCompressionSettings(size_t part_size, double part_size_ratio) const
+CompressionSettings Context::chooseCompressionSettings(size_t part_size, double part_size_ratio, time_t part_age) const
 {
     auto lock = getLock();
 
@@ -1645,7 +1931,7 @@ CompressionSettings Context::chooseCompressionSettings(size_t part_size, double
             shared->compression_settings_selector = std::make_unique<CompressionSettingsSelector>();
     }
 
-    return shared->compression_settings_selector->choose(part_size, part_size_ratio);
+    return shared->compression_settings_selector->choose(part_size, part_size_ratio, part_age);
 }
 
 
@@ -45,13 +45,22 @@ class EmbeddedDictionaries;
 class ExternalDictionaries;
 class ExternalModels;
 class InterserverIOHandler;
+class ShuffleExchangeRegistry;
 class BackgroundProcessingPool;
 class BackgroundSchedulePool;
+class Throttler;
+using ThrottlerPtr = std::shared_ptr<Throttler>;
+class AsynchronousInsertQueue;
 class MergeList;
 class Cluster;
 class Compiler;
 class MarkCache;
 class UncompressedCache;
+class MMappedFileCache;
+class CompressedBlockCache;
+class QueryResultCache;
+class QueryParseCache;
+class SubqueryResultCache;
 class ProcessList;
 class QueryStatus;
 class Macros;
@@ -60,6 +69,9 @@ class Clusters;
 class QueryLog;
 class QueryThreadLog;
 class PartLog;
+class TraceLog;
+class MetricLog;
+class TraceCollector;
 struct MergeTreeSettings;
 class IDatabase;
 class DDLGuard;
@@ -119,7 +131,9 @@ private:
 
     std::shared_ptr<QuotaForIntervals> quota;           /// Current quota. By default - empty quota, that have no limits.
     String current_database;
-    Settings settings;                                  /// Setting for query execution.
+    /// Settings for query execution. Shared between copies of a context and detached only on the
+    ///  first modification, so that queries that override nothing never copy the whole (large) struct.
+    std::shared_ptr<Settings> settings = std::make_shared<Settings>();
     using ProgressCallback = std::function<void(const Progress & progress)>;
     ProgressCallback progress_callback;                 /// Callback for tracking progress of query execution.
     QueryStatus * process_list_elem = nullptr;   /// For tracking total resource usage for query.
@@ -127,6 +141,7 @@ private:
     String default_format;  /// Format, used when server formats data by itself and if query does not have FORMAT specification.
                             /// Thus, used in HTTP interface. If not specified - then some globally default format is used.
     TableAndCreateASTs external_tables;     /// Temporary tables.
+    std::map<String, ASTPtr> prepared_statements;   /// Statements of the session stored by PREPARE (see InterpreterPrepareQuery).
     Tables table_function_results;          /// Temporary tables obtained by execution of table functions. Keyed by AST tree id.
     Context * query_context = nullptr;
     Context * session_context = nullptr;    /// Session context or nullptr. Could be equal to this.
@@ -220,6 +235,11 @@ public:
     void addExternalTable(const String & table_name, const StoragePtr & storage, const ASTPtr & ast = {});
     StoragePtr tryRemoveExternalTable(const String & table_name);
 
+    /// Prepared statements of the session (PREPARE / EXECUTE / DEALLOCATE queries).
+    void setPreparedStatement(const String & name, ASTPtr ast, size_t max_count);
+    ASTPtr getPreparedStatement(const String & name) const;
+    void removePreparedStatement(const String & name);
+
     StoragePtr executeTableFunction(const ASTPtr & table_expression);
 
     void addDatabase(const String & database_name, const DatabasePtr & database);
@@ -263,6 +283,7 @@ public:
     BlockOutputStreamPtr getOutputFormat(const String & name, WriteBuffer & buf, const Block & sample) const;
 
     InterserverIOHandler & getInterserverIOHandler();
+    ShuffleExchangeRegistry & getShuffleExchangeRegistry();
 
     /// How other servers can access this for downloading replicated data.
     void setInterserverIOAddress(const String & host, UInt16 port);
@@ -319,8 +340,8 @@ public:
     void setSessionContext(Context & context_) { session_context = &context_; }
     void setGlobalContext(Context & context_) { global_context = &context_; }
 
-    const Settings & getSettingsRef() const { return settings; }
-    Settings & getSettingsRef() { return settings; }
+    const Settings & getSettingsRef() const { return *settings; }
+    Settings & getSettingsRef() { unshareSettings(); return *settings; }
 
 
     void setProgressCallback(ProgressCallback callback);
@@ -348,15 +369,42 @@ public:
     bool hasZooKeeper() const;
 
     /// Create a cache of uncompressed blocks of specified size. This can be done only once.
-    void setUncompressedCache(size_t max_size_in_bytes);
+    void setUncompressedCache(size_t max_size_in_bytes, size_t num_shards = 1);
     std::shared_ptr<UncompressedCache> getUncompressedCache() const;
     void dropUncompressedCache() const;
 
+    /// Cache of memory mapped data files, created lazily (see min_bytes_to_use_mmap_io).
+    std::shared_ptr<MMappedFileCache> getMMappedFileCache() const;
+
+    /// Create a cache of compressed blocks of specified size. This can be done only once.
+    /// If it is not created, the cache is disabled.
+    void setCompressedBlockCache(size_t max_size_in_bytes, size_t num_shards = 1);
+    std::shared_ptr<CompressedBlockCache> getCompressedBlockCache() const;
+    void dropCompressedBlockCache() const;
+
     /// Create a cache of marks of specified size. This can be done only once.
-    void setMarkCache(size_t cache_size_in_bytes);
+    void setMarkCache(size_t cache_size_in_bytes, size_t num_shards = 1);
     std::shared_ptr<MarkCache> getMarkCache() const;
     void dropMarkCache() const;
 
+    /// Create a cache of complete query results of specified size (see use_query_result_cache).
+    /// This can be done only once. If it is not created, the cache is disabled.
+    void setQueryResultCache(size_t max_size_in_bytes);
+    std::shared_ptr<QueryResultCache> getQueryResultCache() const;
+    void dropQueryResultCache() const;
+
+    /// Create a cache of parsed queries of specified size (a number of entries).
+    /// This can be done only once. If it is not created, the cache is disabled.
+    void setQueryParseCache(size_t max_count);
+    std::shared_ptr<QueryParseCache> getQueryParseCache() const;
+    void dropQueryParseCache() const;
+
+    /// Create a cache of materialized subqueries of specified size (see use_subquery_result_cache).
+    /// This can be done only once. If it is not created, the cache is disabled.
+    void setSubqueryResultCache(size_t max_size_in_bytes);
+    std::shared_ptr<SubqueryResultCache> getSubqueryResultCache() const;
+    void dropSubqueryResultCache() const;
+
     /** Clear the caches of the uncompressed blocks and marks.
       * This is usually done when renaming tables, changing the type of columns, deleting a table.
       *  - since caches are linked to file names, and become incorrect.
@@ -368,6 +416,13 @@ public:
     BackgroundProcessingPool & getBackgroundPool();
     BackgroundSchedulePool & getSchedulePool();
 
+    /// Server-wide bandwidth limit for fetches of parts from replicas
+    /// (the max_replicated_fetches_network_bandwidth_for_server config key). nullptr if not limited.
+    ThrottlerPtr getReplicatedFetchesThrottler() const;
+
+    /// Staging buffers of asynchronous INSERTs (the async_insert setting). Created on first use.
+    AsynchronousInsertQueue & getAsynchronousInsertQueue() const;
+
     void setDDLWorker(std::shared_ptr<DDLWorker> ddl_worker);
     DDLWorker & getDDLWorker() const;
 
@@ -392,6 +447,21 @@ public:
     /// Provide table name to make required cheks.
     PartLog * getPartLog(const String & part_database, bool create_if_not_exists = true);
 
+    /// Nullptr if the trace_log section is missing in the config.
+    TraceLog * getTraceLog(bool create_if_not_exists = true);
+
+    /// Nullptr if the metric_log section is missing in the config.
+    MetricLog * getMetricLog(bool create_if_not_exists = true);
+
+    /// Starts periodic collection of all metrics into system.metric_log. Call for global context.
+    /// Does nothing if the metric_log section is missing in the config.
+    void initializeMetricLog();
+
+    /// Starts collecting query profiler samples into system.trace_log. Call for global context.
+    /// Does nothing if the trace_log section is missing in the config.
+    void initializeTraceCollector();
+    bool hasTraceCollector() const;
+
     const MergeTreeSettings & getMergeTreeSettings() const;
 
     /// Prevents DROP TABLE if its size is greater than max_size (50GB by default, max_size=0 turn off this check)
@@ -403,7 +473,7 @@ public:
     void checkPartitionCanBeDropped(const String & database, const String & table, const size_t & partition_size);
 
     /// Lets you select the compression settings according to the conditions described in the configuration file.
-    CompressionSettings chooseCompressionSettings(size_t part_size, double part_size_ratio) const;
+    CompressionSettings chooseCompressionSettings(size_t part_size, double part_size_ratio, time_t part_age = 0) const;
 
     /// Get the server uptime in seconds.
     time_t getUptimeSeconds() const;
@@ -456,6 +526,13 @@ private:
       */
     void checkDatabaseAccessRightsImpl(const std::string & database_name) const;
 
+    /// Copy-on-write: detach the settings from the other contexts sharing them before a modification.
+    void unshareSettings()
+    {
+        if (!settings.unique())
+            settings = std::make_shared<Settings>(*settings);
+    }
+
     EmbeddedDictionaries & getEmbeddedDictionariesImpl(bool throw_on_error) const;
     ExternalDictionaries & getExternalDictionariesImpl(bool throw_on_error) const;
     ExternalModels & getExternalModelsImpl(bool throw_on_error) const;
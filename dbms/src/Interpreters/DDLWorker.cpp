@@ -1,6 +1,7 @@
 #include <Interpreters/DDLWorker.h>
 #include <Parsers/ASTAlterQuery.h>
 #include <Parsers/ASTQueryWithOnCluster.h>
+#include <Parsers/ASTQueryWithTableAndOutput.h>
 #include <Parsers/ParserQuery.h>
 #include <Parsers/parseQuery.h>
 #include <Parsers/queryToString.h>
@@ -29,7 +30,10 @@
 #include <Common/ZooKeeper/KeeperException.h>
 #include <Common/ZooKeeper/Lock.h>
 #include <Common/isLocalAddress.h>
+#include <Common/ThreadPool.h>
 #include <Poco/Timestamp.h>
+#include <ext/scope_guard.h>
+#include <map>
 #include <random>
 #include <pcg_random.hpp>
 #include <Poco/Net/NetException.h>
@@ -186,11 +190,19 @@ struct DDLTask
     bool was_executed = false;
 
     /// Stage 4: commit results to ZooKeeper
+    bool was_processed = false;
+
+    /// Tasks on different tables are executed concurrently; this key serializes tasks of one table.
+    /// Empty if the affected table could not be determined - such a task is a barrier and runs alone.
+    String execution_ordering_key;
+
+    /// The error of this processing iteration (e.g. a ZooKeeper error while committing the result).
+    std::exception_ptr exception;
 };
 
 
 static std::unique_ptr<zkutil::Lock> createSimpleZooKeeperLock(
-    std::shared_ptr<zkutil::ZooKeeper> & zookeeper, const String & lock_prefix, const String & lock_name, const String & lock_message)
+    const std::shared_ptr<zkutil::ZooKeeper> & zookeeper, const String & lock_prefix, const String & lock_name, const String & lock_message)
 {
     auto zookeeper_holder = std::make_shared<zkutil::ZooKeeperHolder>();
     zookeeper_holder->initFromInstance(zookeeper);
@@ -226,6 +238,7 @@ DDLWorker::DDLWorker(const std::string & zk_root_dir, Context & context_, const
         task_max_lifetime = config->getUInt64(prefix + ".task_max_lifetime", static_cast<UInt64>(task_max_lifetime));
         cleanup_delay_period = config->getUInt64(prefix + ".cleanup_delay_period", static_cast<UInt64>(cleanup_delay_period));
         max_tasks_in_queue = std::max(static_cast<UInt64>(1), config->getUInt64(prefix + ".max_tasks_in_queue", max_tasks_in_queue));
+        pool_size = std::max(static_cast<UInt64>(1), config->getUInt64(prefix + ".pool_size", pool_size));
 
         if (config->has(prefix + ".profile"))
             context.setSetting("profile", config->getString(prefix + ".profile"));
@@ -241,8 +254,10 @@ DDLWorker::DDLWorker(const std::string & zk_root_dir, Context & context_, const
     host_fqdn_id = Cluster::Address::toString(host_fqdn, context.getTCPPort());
 
     event_queue_updated = std::make_shared<Poco::Event>();
+    cleanup_event = std::make_shared<Poco::Event>();
 
     thread = std::thread(&DDLWorker::run, this);
+    cleanup_thread = std::thread(&DDLWorker::runCleanup, this);
 }
 
 
@@ -250,22 +265,16 @@ DDLWorker::~DDLWorker()
 {
     stop_flag = true;
     event_queue_updated->set();
+    cleanup_event->set();
     thread.join();
+    cleanup_thread.join();
 }
 
 
-bool DDLWorker::initAndCheckTask(const String & entry_name, String & out_reason)
+DDLWorker::DDLTaskPtr DDLWorker::initAndCheckTask(const String & entry_name, const String & node_data, String & out_reason)
 {
-    String node_data;
     String entry_path = queue_dir + "/" + entry_name;
 
-    if (!zookeeper->tryGet(entry_path, node_data))
-    {
-        /// It is Ok that node could be deleted just now. It means that there are no current host in node's host list.
-        out_reason = "The task was deleted";
-        return false;
-    }
-
     auto task = std::make_unique<DDLTask>();
     task->entry_name = entry_name;
     task->entry_path = entry_path;
@@ -294,7 +303,7 @@ bool DDLWorker::initAndCheckTask(const String & entry_name, String & out_reason)
         }
 
         out_reason = "Incorrect task format";
-        return false;
+        return nullptr;
     }
 
     bool host_in_hostlist = false;
@@ -323,12 +332,38 @@ bool DDLWorker::initAndCheckTask(const String & entry_name, String & out_reason)
         }
     }
 
-    if (host_in_hostlist)
-        current_task = std::move(task);
-    else
+    if (!host_in_hostlist)
+    {
         out_reason = "There is no a local address in host list";
+        return nullptr;
+    }
+
+    /// Determine the table the query affects. Tasks on different tables are executed concurrently,
+    ///  tasks of one table keep the queue order. A query without a single table (CREATE DATABASE,
+    ///  RENAME, unparsable query) gets an empty key and is executed as a barrier.
+    try
+    {
+        const char * begin = task->entry.query.data();
+        const char * end = begin + task->entry.query.size();
+
+        ParserQuery parser_query(end);
+        String description;
+        ASTPtr query_ast = parseQuery(parser_query, begin, end, description, 0);
+
+        if (const auto * query_with_table = dynamic_cast<const ASTQueryWithTableAndOutput *>(query_ast.get()))
+        {
+            if (!query_with_table->table.empty())
+                task->execution_ordering_key
+                    = (query_with_table->database.empty() ? context.getCurrentDatabase() : query_with_table->database)
+                        + "." + query_with_table->table;
+        }
+    }
+    catch (...)
+    {
+        /// The error will be reported when the task itself is executed.
+    }
 
-    return host_in_hostlist;
+    return task;
 }
 
 
@@ -354,67 +389,180 @@ void DDLWorker::processTasks()
         ? queue_nodes.begin()
         : std::upper_bound(queue_nodes.begin(), queue_nodes.end(), last_processed_task_name);
 
+    /// Forget the retained tasks whose nodes were deleted from ZooKeeper before this host committed them.
+    for (auto it = unfinished_tasks.begin(); it != unfinished_tasks.end();)
+    {
+        if (!std::binary_search(queue_nodes.begin(), queue_nodes.end(), it->first))
+        {
+            LOG_INFO(log, "Task " << it->first << " was deleted from ZooKeeper before current host committed it");
+            it = unfinished_tasks.erase(it);
+        }
+        else
+            ++it;
+    }
+
+    /// Fetch all new entries in one pipelined batch instead of a round trip per task.
+    std::vector<std::pair<String, zkutil::ZooKeeper::FutureGet>> entry_futures;
     for (auto it = begin_node; it != queue_nodes.end(); ++it)
+        entry_futures.emplace_back(*it, zookeeper->asyncTryGet(queue_dir + "/" + *it));
+
+    /// Tasks of this iteration in queue order; nullptr is an entry that is skipped (not for this host).
+    std::vector<std::pair<String, DDLTask *>> items;
+
+    for (auto & entry_name_future : entry_futures)
     {
-        String entry_name = *it;
+        const String & entry_name = entry_name_future.first;
 
-        if (current_task)
+        auto task_it = unfinished_tasks.find(entry_name);
+        if (task_it == unfinished_tasks.end())
         {
-            if (current_task->entry_name == entry_name)
-            {
-                LOG_INFO(log, "Trying to process task " << entry_name << " again");
-            }
-            else
+            Coordination::GetResponse response = entry_name_future.second.get();
+
+            String reason = "The task was deleted";
+            DDLTaskPtr task = (response.error == Coordination::ZNONODE)
+                ? nullptr
+                : initAndCheckTask(entry_name, response.data, reason);
+
+            if (!task)
             {
-                LOG_INFO(log, "Task " << current_task->entry_name << " was deleted from ZooKeeper before current host committed it");
-                current_task = nullptr;
+                /// It is Ok that the node could be deleted just now: there is no current host in its host list.
+                LOG_DEBUG(log, "Will not execute task " << entry_name << ": " << reason);
+                items.emplace_back(entry_name, nullptr);
+                continue;
             }
+
+            task_it = unfinished_tasks.emplace(entry_name, std::move(task)).first;
+        }
+        else
+            LOG_INFO(log, "Trying to process task " << entry_name << " again");
+
+        items.emplace_back(entry_name, task_it->second.get());
+    }
+
+    /// Execute the tasks: tasks on different tables concurrently (up to pool_size at once),
+    ///  tasks of one table sequentially in queue order, tasks without a table key alone.
+    size_t i = 0;
+    while (i < items.size() && !stop_flag)
+    {
+        /// A segment of consecutive tasks with table keys, grouped by table.
+        std::map<String, std::vector<DDLTask *>> by_table;
+        for (; i < items.size(); ++i)
+        {
+            DDLTask * task = items[i].second;
+            if (!task)
+                continue;
+            if (task->execution_ordering_key.empty())
+                break;
+            by_table[task->execution_ordering_key].push_back(task);
         }
 
-        if (!current_task)
+        if (by_table.size() == 1)
+        {
+            processTaskList(by_table.begin()->second, server_startup);
+        }
+        else if (!by_table.empty())
         {
-            String reason;
-            if (!initAndCheckTask(entry_name, reason))
+            std::vector<std::vector<DDLTask *> *> work;
+            for (auto & key_tasks : by_table)
+                work.push_back(&key_tasks.second);
+
+            std::atomic<size_t> next_work_item {0};
+            std::vector<ThreadFromGlobalPool> threads;
+            size_t num_threads = std::min(pool_size, work.size());
+
+            for (size_t thread_num = 0; thread_num < num_threads; ++thread_num)
             {
-                LOG_DEBUG(log, "Will not execute task " << entry_name << ": " << reason);
-                last_processed_task_name = entry_name;
-                continue;
+                threads.emplace_back([&]
+                {
+                    setThreadName("DDLWorkerExec");
+                    CurrentThread::attachToIfDetached(thread_group);
+                    SCOPE_EXIT({ CurrentThread::detachQueryIfNotDetached(); });
+
+                    size_t work_item;
+                    while ((work_item = next_work_item++) < work.size())
+                        processTaskList(*work[work_item], server_startup);
+                });
             }
+
+            for (auto & thread : threads)
+                thread.join();
         }
 
-        DDLTask & task = *current_task;
+        /// The barrier task: everything before it has finished, and it is executed alone.
+        if (i < items.size() && items[i].second)
+        {
+            processTaskList({items[i].second}, server_startup);
+            ++i;
+        }
+    }
 
-        bool already_processed = zookeeper->exists(task.entry_path + "/finished/" + task.host_id_str);
-        if (!server_startup && !task.was_executed && already_processed)
+    /// Advance the processed-tasks marker over the contiguous prefix of finished tasks
+    ///  and rethrow the first error (most likely a ZooKeeper error while committing a result).
+    std::exception_ptr first_exception;
+    for (const auto & item : items)
+    {
+        if (item.second && !item.second->was_processed)
         {
-            throw Exception(
-                "Server expects that DDL task " + task.entry_name + " should be processed, but it was already processed according to ZK",
-                ErrorCodes::LOGICAL_ERROR);
+            first_exception = item.second->exception;
+            break;
         }
 
-        if (!already_processed)
+        last_processed_task_name = item.first;
+        if (item.second)
+            unfinished_tasks.erase(item.first);
+    }
+
+    if (first_exception)
+        std::rethrow_exception(first_exception);
+}
+
+
+void DDLWorker::processTaskList(const std::vector<DDLTask *> & task_list, bool server_startup)
+{
+    for (DDLTask * task_ptr : task_list)
+    {
+        DDLTask & task = *task_ptr;
+
+        if (task.was_processed || stop_flag)
+            continue;
+
+        try
         {
-            try
+            bool already_processed = zookeeper->exists(task.entry_path + "/finished/" + task.host_id_str);
+            if (!server_startup && !task.was_executed && already_processed)
             {
-                processTask(task);
+                throw Exception(
+                    "Server expects that DDL task " + task.entry_name + " should be processed, but it was already processed according to ZK",
+                    ErrorCodes::LOGICAL_ERROR);
+            }
+
+            if (!already_processed)
+            {
+                try
+                {
+                    processTask(task);
+                }
+                catch (...)
+                {
+                    LOG_WARNING(log, "An error occurred while processing task " << task.entry_name << " (" << task.entry.query << ") : "
+                        << getCurrentExceptionMessage(true));
+                    throw;
+                }
             }
-            catch (...)
+            else
             {
-                LOG_WARNING(log, "An error occurred while processing task " << task.entry_name << " (" << task.entry.query << ") : "
-                    << getCurrentExceptionMessage(true));
-                throw;
+                LOG_DEBUG(log, "Task " << task.entry_name << " (" << task.entry.query << ") has been already processed");
             }
+
+            task.was_processed = true;
         }
-        else
+        catch (...)
         {
-            LOG_DEBUG(log, "Task " << task.entry_name << " (" << task.entry.query << ") has been already processed");
-        }
-
-        last_processed_task_name = task.entry_name;
-        current_task.reset();
-
-        if (stop_flag)
+            task.exception = std::current_exception();
+            /// The tasks of this table after the failed one are not executed in this iteration,
+            ///  to keep the per-table ordering.
             break;
+        }
     }
 }
 
@@ -527,9 +675,10 @@ bool DDLWorker::tryExecuteQuery(const String & query, const DDLTask & task, Exec
 
     try
     {
-        current_context = std::make_unique<Context>(context);
-        current_context->setCurrentQueryId(""); // generate random query_id
-        executeQuery(istr, ostr, false, *current_context, nullptr);
+        /// The context is local: tryExecuteQuery is called concurrently for tasks on different tables.
+        auto query_context = std::make_unique<Context>(context);
+        query_context->setCurrentQueryId(""); // generate random query_id
+        executeQuery(istr, ostr, false, *query_context, nullptr);
     }
     catch (...)
     {
@@ -733,21 +882,15 @@ void DDLWorker::processTaskAlter(
 }
 
 
-void DDLWorker::cleanupQueue()
+void DDLWorker::cleanupQueue(const std::shared_ptr<zkutil::ZooKeeper> & cleanup_zookeeper)
 {
     /// Both ZK and Poco use Unix epoch
     Int64 current_time_seconds = Poco::Timestamp().epochTime();
     constexpr UInt64 zookeeper_time_resolution = 1000;
 
-    /// Too early to check
-    if (last_cleanup_time_seconds && current_time_seconds < last_cleanup_time_seconds + cleanup_delay_period)
-        return;
-
-    last_cleanup_time_seconds = current_time_seconds;
-
     LOG_DEBUG(log, "Cleaning queue");
 
-    Strings queue_nodes = zookeeper->getChildren(queue_dir);
+    Strings queue_nodes = cleanup_zookeeper->getChildren(queue_dir);
     filterAndSortQueueNodes(queue_nodes);
 
     size_t num_outdated_nodes = (queue_nodes.size() > max_tasks_in_queue) ? queue_nodes.size() - max_tasks_in_queue : 0;
@@ -765,7 +908,7 @@ void DDLWorker::cleanupQueue()
         try
         {
             /// Already deleted
-            if (!zookeeper->exists(node_path, &stat))
+            if (!cleanup_zookeeper->exists(node_path, &stat))
                 continue;
 
             /// Delete node if its lifetmie is expired (according to task_max_lifetime parameter)
@@ -779,7 +922,7 @@ void DDLWorker::cleanupQueue()
                 continue;
 
             /// Skip if there are active nodes (it is weak guard)
-            if (zookeeper->exists(node_path + "/active", &stat) && stat.numChildren > 0)
+            if (cleanup_zookeeper->exists(node_path + "/active", &stat) && stat.numChildren > 0)
             {
                 LOG_INFO(log, "Task " << node_name << " should be deleted, but there are active workers. Skipping it.");
                 continue;
@@ -787,7 +930,7 @@ void DDLWorker::cleanupQueue()
 
             /// Usage of the lock is not necessary now (tryRemoveRecursive correctly removes node in a presence of concurrent cleaners)
             /// But the lock will be required to implement system.distributed_ddl_queue table
-            auto lock = createSimpleZooKeeperLock(zookeeper, node_path, "lock", host_fqdn_id);
+            auto lock = createSimpleZooKeeperLock(cleanup_zookeeper, node_path, "lock", host_fqdn_id);
             if (!lock->tryLock())
             {
                 LOG_INFO(log, "Task " << node_name << " should be deleted, but it is locked. Skipping it.");
@@ -801,18 +944,18 @@ void DDLWorker::cleanupQueue()
 
             /// Deleting
             {
-                Strings childs = zookeeper->getChildren(node_path);
+                Strings childs = cleanup_zookeeper->getChildren(node_path);
                 for (const String & child : childs)
                 {
                     if (child != "lock")
-                        zookeeper->tryRemoveRecursive(node_path + "/" + child);
+                        cleanup_zookeeper->tryRemoveRecursive(node_path + "/" + child);
                 }
 
                 /// Remove the lock node and its parent atomically
                 Coordination::Requests ops;
                 ops.emplace_back(zkutil::makeRemoveRequest(lock_path, -1));
                 ops.emplace_back(zkutil::makeRemoveRequest(node_path, -1));
-                zookeeper->multi(ops);
+                cleanup_zookeeper->multi(ops);
 
                 lock->unlockAssumeLockNodeRemovedManually();
             }
@@ -915,12 +1058,6 @@ void DDLWorker::run()
 
             LOG_DEBUG(log, "Waiting a watch");
             event_queue_updated->wait();
-
-            if (stop_flag)
-                break;
-
-            /// TODO: it might delay the execution, move it to separate thread.
-            cleanupQueue();
         }
         catch (const Coordination::Exception & e)
         {
@@ -962,6 +1099,30 @@ void DDLWorker::run()
 }
 
 
+void DDLWorker::runCleanup()
+{
+    setThreadName("DDLWorkerClnr");
+    LOG_DEBUG(log, "Started DDLWorker cleanup thread");
+
+    while (!stop_flag)
+    {
+        /// The cleanup of finished and outdated task nodes does not block the execution of new tasks.
+        cleanup_event->tryWait(cleanup_delay_period * 1000);
+        if (stop_flag)
+            break;
+
+        try
+        {
+            cleanupQueue(context.getZooKeeper());
+        }
+        catch (...)
+        {
+            tryLogCurrentException(log, __PRETTY_FUNCTION__);
+        }
+    }
+}
+
+
 class DDLQueryStatusInputSream : public IProfilingBlockInputStream
 {
 public:
@@ -10,6 +10,7 @@
 #include <condition_variable>
 #include <mutex>
 #include <thread>
+#include <unordered_map>
 
 namespace DB
 {
@@ -40,12 +41,16 @@ public:
     }
 
 private:
+    using DDLTaskPtr = std::unique_ptr<DDLTask>;
+
     void processTasks();
 
-    /// Reads entry and check that the host belongs to host list of the task
-    /// Returns true and sets current_task if entry parsed and the check is passed
-    bool initAndCheckTask(const String & entry_name, String & out_reason);
+    /// Parses the entry and checks that the host belongs to host list of the task.
+    /// Returns the task, or nullptr with out_reason set if the task should be skipped.
+    DDLTaskPtr initAndCheckTask(const String & entry_name, const String & node_data, String & out_reason);
 
+    /// Executes the tasks of one table one after another. Called concurrently for different tables.
+    void processTaskList(const std::vector<DDLTask *> & task_list, bool server_startup);
 
     void processTask(DDLTask & task);
 
@@ -60,20 +65,20 @@ private:
     bool tryExecuteQuery(const String & query, const DDLTask & task, ExecutionStatus & status);
 
     /// Checks and cleanups queue's nodes
-    void cleanupQueue();
+    void cleanupQueue(const std::shared_ptr<zkutil::ZooKeeper> & cleanup_zookeeper);
 
     /// Init task node
     void createStatusDirs(const std::string & node_name);
 
 
     void run();
+    void runCleanup();
 
     void attachToThreadGroup();
 
 private:
     Context & context;
     Logger * log;
-    std::unique_ptr<Context> current_context;
 
     std::string host_fqdn;      /// current host domain name
     std::string host_fqdn_id;   /// host_name:port
@@ -84,22 +89,24 @@ private:
 
     std::shared_ptr<zkutil::ZooKeeper> zookeeper;
 
-    /// Save state of executed task to avoid duplicate execution on ZK error
-    using DDLTaskPtr = std::unique_ptr<DDLTask>;
-    DDLTaskPtr current_task;
+    /// State of tasks that were started but not yet committed to ZooKeeper,
+    /// to avoid duplicate execution after a retry (e.g. after a session expiration).
+    std::unordered_map<String, DDLTaskPtr> unfinished_tasks;
 
     std::shared_ptr<Poco::Event> event_queue_updated;
+    std::shared_ptr<Poco::Event> cleanup_event;
     std::atomic<bool> stop_flag{false};
     std::thread thread;
+    std::thread cleanup_thread;
 
-    Int64 last_cleanup_time_seconds = 0;
-
-    /// Cleaning starts after new node event is received if the last cleaning wasn't made sooner than N seconds ago
+    /// Period of cleaning the queue of finished and outdated task nodes (in seconds)
     Int64 cleanup_delay_period = 60; // minute (in seconds)
     /// Delete node if its age is greater than that
     Int64 task_max_lifetime = 7 * 24 * 60 * 60; // week (in seconds)
     /// How many tasks could be in the queue
     size_t max_tasks_in_queue = 1000;
+    /// How many tasks on different tables may be executed concurrently
+    size_t pool_size = 4;
 
     ThreadGroupStatusPtr thread_group;
 
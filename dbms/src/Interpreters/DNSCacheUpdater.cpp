@@ -58,13 +58,13 @@ static bool isNetworkError()
 DNSCacheUpdater::DNSCacheUpdater(Context & context_)
     : context(context_), pool(context_.getBackgroundPool())
 {
-    task_handle = pool.addTask([this] () { return run(); });
+    task_handle = pool.addTask([this] () { return run(); }, BackgroundProcessingPool::TaskClass::Utility);
 }
 
 bool DNSCacheUpdater::run()
 {
-    /// TODO: Ensusre that we get global counter (not thread local)
-    auto num_current_network_exceptions = ProfileEvents::global_counters[ProfileEvents::NetworkErrors].load(std::memory_order_relaxed);
+    /// A snapshot also includes errors that threads have not propagated to the global counters yet.
+    auto num_current_network_exceptions = ProfileEvents::global_counters.getPartiallyAtomicSnapshot()[ProfileEvents::NetworkErrors].load(std::memory_order_relaxed);
 
     if (num_current_network_exceptions >= last_num_network_erros + min_errors_to_update_cache
         && time(nullptr) > last_update_time + min_update_period_seconds)
@@ -2,6 +2,7 @@
 #include <Dictionaries/DictionarySourceFactory.h>
 #include <Dictionaries/FlatDictionary.h>
 #include <Dictionaries/HashedDictionary.h>
+#include <Dictionaries/HashedArrayDictionary.h>
 #include <Dictionaries/CacheDictionary.h>
 #include <Dictionaries/RangeHashedDictionary.h>
 #include <Dictionaries/ComplexKeyHashedDictionary.h>
@@ -110,6 +111,10 @@ DictionaryPtr DictionaryFactory::create(const std::string & name, const Poco::Ut
         {
             return std::make_unique<HashedDictionary>(name, dict_struct, std::move(source_ptr), dict_lifetime, require_nonempty);
         }
+        else if ("hashed_array" == layout_type)
+        {
+            return std::make_unique<HashedArrayDictionary>(name, dict_struct, std::move(source_ptr), dict_lifetime, require_nonempty);
+        }
         else if ("cache" == layout_type)
         {
             const auto size = config.getInt(layout_prefix + ".cache.size_in_cells");
@@ -6,6 +6,7 @@
 
 #include <Interpreters/Context.h>
 #include <Interpreters/QueryNormalizer.h>
+#include <Interpreters/SubqueryResultCache.h>
 #include <Interpreters/InterpreterSelectWithUnionQuery.h>
 #include <Interpreters/ExecuteScalarSubqueriesVisitor.h>
 
@@ -37,39 +38,67 @@ static ASTPtr addTypeConversion(std::unique_ptr<ASTLiteral> && ast, const String
 
 void ExecuteScalarSubqueriesVisitor::visit(const ASTSubquery & subquery, ASTPtr & ast) const
 {
-    Context subquery_context = context;
-    Settings subquery_settings = context.getSettings();
-    subquery_settings.max_result_rows = 1;
-    subquery_settings.extremes = 0;
-    subquery_context.setSettings(subquery_settings);
-
     ASTPtr subquery_select = subquery.children.at(0);
-    BlockIO res = InterpreterSelectWithUnionQuery(
-        subquery_select, subquery_context, {}, QueryProcessingStage::Complete, subquery_depth + 1).execute();
+
+    /// Maybe the result of an identical scalar subquery computed by a previous query
+    /// can be reused (see use_subquery_result_cache).
+    SubqueryResultCachePtr subquery_result_cache;
+    UInt128 cache_key {};
+    QueryResultCacheTableVersions table_versions;
+    bool save_in_cache = false;
 
     Block block;
-    try
+    bool have_cached_block = false;
+
+    if (context.getSettingsRef().use_subquery_result_cache)
+    {
+        subquery_result_cache = context.getSubqueryResultCache();
+        if (subquery_result_cache && QueryResultCache::collectTableVersions(*subquery_select, context, table_versions))
+        {
+            cache_key = QueryResultCache::hash(*subquery_select, context);
+            have_cached_block = subquery_result_cache->tryGetScalarResult(cache_key, table_versions, block);
+            save_in_cache = !have_cached_block;
+        }
+    }
+
+    if (!have_cached_block)
     {
-        block = res.in->read();
+        Context subquery_context = context;
+        Settings subquery_settings = context.getSettings();
+        subquery_settings.max_result_rows = 1;
+        subquery_settings.extremes = 0;
+        subquery_context.setSettings(subquery_settings);
+
+        BlockIO res = InterpreterSelectWithUnionQuery(
+            subquery_select, subquery_context, {}, QueryProcessingStage::Complete, subquery_depth + 1).execute();
 
-        if (!block)
+        try
         {
-            /// Interpret subquery with empty result as Null literal
-            auto ast_new = std::make_unique<ASTLiteral>(Null());
-            ast_new->setAlias(ast->tryGetAlias());
-            ast = std::move(ast_new);
-            return;
+            block = res.in->read();
+
+            if (block && (block.rows() != 1 || res.in->read()))
+                throw Exception("Scalar subquery returned more than one row", ErrorCodes::INCORRECT_RESULT_OF_SCALAR_SUBQUERY);
+        }
+        catch (const Exception & e)
+        {
+            if (e.code() == ErrorCodes::TOO_MANY_ROWS)
+                throw Exception("Scalar subquery returned more than one row", ErrorCodes::INCORRECT_RESULT_OF_SCALAR_SUBQUERY);
+            else
+                throw;
         }
 
-        if (block.rows() != 1 || res.in->read())
-            throw Exception("Scalar subquery returned more than one row", ErrorCodes::INCORRECT_RESULT_OF_SCALAR_SUBQUERY);
+        /// An empty block is saved too: it means that the subquery returned no rows.
+        if (save_in_cache)
+            subquery_result_cache->saveScalarResult(cache_key, block, std::move(table_versions));
     }
-    catch (const Exception & e)
+
+    if (!block)
     {
-        if (e.code() == ErrorCodes::TOO_MANY_ROWS)
-            throw Exception("Scalar subquery returned more than one row", ErrorCodes::INCORRECT_RESULT_OF_SCALAR_SUBQUERY);
-        else
-            throw;
+        /// Interpret subquery with empty result as Null literal
+        auto ast_new = std::make_unique<ASTLiteral>(Null());
+        ast_new->setAlias(ast->tryGetAlias());
+        ast = std::move(ast_new);
+        return;
     }
 
     size_t columns = block.columns();
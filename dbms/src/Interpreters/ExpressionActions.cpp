@@ -644,8 +644,36 @@ void ExpressionActions::addImpl(ExpressionAction action, Names & new_names)
 
         action.function_base = action.function_builder->build(arguments);
         action.result_type = action.function_base->getReturnType();
+
+        /// Common subexpression elimination. The analyzer already reuses columns with equal names,
+        ///  but the same function over the same arguments can arrive under a different result name
+        ///  (for example, from an action with an explicit result name). Calculate it once and copy;
+        ///  the copy is what dumpActions() will show in place of the repeated function.
+        if (action.function_base->isDeterministicInScopeOfQuery())
+        {
+            String expression_key = action.function_base->getName() + "(";
+            for (size_t i = 0; i < action.argument_names.size(); ++i)
+            {
+                if (i)
+                    expression_key += ", ";
+                expression_key += action.argument_names[i];
+            }
+            expression_key += ")";
+
+            auto it = known_function_results.find(expression_key);
+            if (it != known_function_results.end() && it->second != action.result_name && sample_block.has(it->second))
+                action = ExpressionAction::copyColumn(it->second, action.result_name);
+            else
+                known_function_results[expression_key] = action.result_name;
+        }
     }
 
+    /// These actions replace or rearrange columns in place, so the cached results may point to columns
+    ///  with different contents after them. Forget everything calculated so far.
+    if (action.type == ExpressionAction::PROJECT || action.type == ExpressionAction::ARRAY_JOIN
+        || action.type == ExpressionAction::JOIN || (action.type == ExpressionAction::COPY_COLUMN && action.can_replace))
+        known_function_results.clear();
+
     if (action.type == ExpressionAction::ADD_ALIASES)
         for (const auto & name_with_alias : action.projection)
             new_names.emplace_back(name_with_alias.second);
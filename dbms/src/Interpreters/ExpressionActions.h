@@ -258,6 +258,10 @@ private:
     std::shared_ptr<CompiledExpressionCache> compilation_cache;
 #endif
 
+    /// Result column of every deterministic APPLY_FUNCTION added so far, keyed by the function name
+    ///  and argument names. Used in addImpl to turn repeated subexpressions into COPY_COLUMN.
+    std::unordered_map<std::string, std::string> known_function_results;
+
     void checkLimits(Block & block) const;
 
     void addImpl(ExpressionAction action, Names & new_names);
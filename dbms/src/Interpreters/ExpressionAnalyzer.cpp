@@ -21,6 +21,7 @@
 #include <DataTypes/DataTypesNumber.h>
 
 #include <Columns/IColumn.h>
+#include <Columns/ColumnsNumber.h>
 
 #include <Interpreters/InterpreterSelectWithUnionQuery.h>
 #include <Interpreters/ExpressionAnalyzer.h>
@@ -29,6 +30,8 @@
 #include <Interpreters/LogicalExpressionsOptimizer.h>
 #include <Interpreters/PredicateExpressionsOptimizer.h>
 #include <Interpreters/ExternalDictionaries.h>
+#include <Interpreters/QueryResultCache.h>
+#include <Interpreters/SubqueryResultCache.h>
 #include <Interpreters/Set.h>
 #include <Interpreters/Join.h>
 #include <Interpreters/TranslateQualifiedNamesVisitor.h>
@@ -40,6 +43,9 @@
 #include <Storages/StorageDistributed.h>
 #include <Storages/StorageMemory.h>
 #include <Storages/StorageJoin.h>
+#include <Storages/StorageDictionary.h>
+
+#include <Dictionaries/DictionaryStructure.h>
 
 #include <DataStreams/LazyBlockInputStream.h>
 #include <DataStreams/copyData.h>
@@ -47,6 +53,7 @@
 #include <Dictionaries/IDictionary.h>
 
 #include <Common/typeid_cast.h>
+#include <Common/SipHash.h>
 #include <Common/StringUtils/StringUtils.h>
 
 #include <Parsers/formatAST.h>
@@ -80,6 +87,8 @@ namespace ErrorCodes
     extern const int UNKNOWN_IDENTIFIER;
     extern const int ILLEGAL_AGGREGATION;
     extern const int EXPECTED_ALL_OR_ANY;
+    extern const int BAD_ARGUMENTS;
+    extern const int NOT_IMPLEMENTED;
 }
 
 /// From SyntaxAnalyzer.cpp
@@ -283,6 +292,7 @@ void ExpressionAnalyzer::tryMakeSetForIndexFromSubquery(const ASTPtr & subquery_
         if (!set->insertFromBlock(block))
             return;
     }
+    set->finishInsert();
 
     prepared_sets[subquery_or_table_name->range] = std::move(set);
 }
@@ -564,6 +574,69 @@ void ExpressionAnalyzer::addJoinAction(ExpressionActionsPtr & actions, bool only
                                                             columns_added_by_join_list));
 }
 
+JoinPtr ExpressionAnalyzer::tryGetDirectDictionaryJoin(const StorageDictionary & storage_dictionary, const ASTTableJoin & join_params) const
+{
+    /// Lookups by id cannot reproduce every kind of JOIN: only INNER and LEFT with a single key.
+    /// LEFT with join_use_nulls is excluded, because the dictionary getters cannot produce Nullable columns.
+    /// (For a dictionary the ids are unique, so ALL is equivalent to ANY and both are allowed.)
+    bool kind_is_supported = join_params.kind == ASTTableJoin::Kind::Inner
+        || (join_params.kind == ASTTableJoin::Kind::Left && !settings.join_use_nulls);
+
+    if (!kind_is_supported || analyzedJoin().key_names_left.size() != 1)
+        return {};
+
+    auto dict = context.getExternalDictionaries().getDictionary(storage_dictionary.getDictionaryName());
+    if (dict->getTypeName() != "Hashed")
+        return {};
+
+    const DictionaryStructure & dict_struct = dict->getStructure();
+    if (!dict_struct.id)
+        return {};
+
+    /// Columns of the joined table could be visible in the query under qualified names - map them back.
+    auto original_name = [this](const String & name) -> const String &
+    {
+        for (const auto & column : analyzedJoin().columns_from_joined_table)
+            if (column.name_and_type.name == name)
+                return column.original_name;
+        return name;
+    };
+
+    if (original_name(analyzedJoin().key_names_right[0]) != dict_struct.id->name)
+        return {};
+
+    /// Map every column the JOIN adds back to a dictionary attribute and build the sample of the right table.
+    Block sample_block;
+    sample_block.insert({ColumnUInt64::create(), std::make_shared<DataTypeUInt64>(), analyzedJoin().key_names_right[0]});
+
+    NameToNameMap attribute_by_name;
+    for (const auto & joined_column : columns_added_by_join)
+    {
+        const String & name = joined_column.name_and_type.name;
+        if (name == analyzedJoin().key_names_right[0])
+            continue;    /// The key column is filled from the left key, not read from an attribute.
+
+        const String & attribute_name = original_name(name);
+        const DictionaryAttribute * attribute = nullptr;
+        for (const auto & candidate : dict_struct.attributes)
+            if (candidate.name == attribute_name)
+                attribute = &candidate;
+
+        if (!attribute || !attribute->type->equals(*joined_column.name_and_type.type))
+            return {};
+
+        attribute_by_name[name] = attribute_name;
+        sample_block.insert({attribute->type->createColumn(), attribute->type, name});
+    }
+
+    JoinPtr join = std::make_shared<Join>(
+        analyzedJoin().key_names_left, analyzedJoin().key_names_right, columns_added_by_join_from_right_keys,
+        settings.join_use_nulls, settings.size_limits_for_join, join_params.kind, join_params.strictness);
+    join->setDictionary(dict, attribute_by_name);
+    join->setSampleBlock(sample_block);
+    return join;
+}
+
 bool ExpressionAnalyzer::appendJoin(ExpressionActionsChain & chain, bool only_types)
 {
     assertSelect();
@@ -616,15 +689,103 @@ bool ExpressionAnalyzer::appendJoin(ExpressionActionsChain & chain, bool only_ty
                 JoinPtr & join = storage_join->getJoin();
                 subquery_for_set.join = join;
             }
+
+            /// Similarly, if the table only represents an external dictionary, the dictionary already is
+            ///  a persistent hash table from id to attributes - probe it directly instead of copying
+            ///  its contents into yet another hash table, if the dictionary and the JOIN allow it.
+            if (StorageDictionary * storage_dictionary = dynamic_cast<StorageDictionary *>(table.get()))
+                subquery_for_set.join = tryGetDirectDictionaryJoin(*storage_dictionary, join_params);
+        }
+    }
+
+    /// Maybe an identical join built by a previous query can be reused (see use_subquery_result_cache).
+    /// Only LEFT and INNER JOINs can be shared: RIGHT and FULL joins mark the joined rows during probing.
+    /// Grace hash joins are not shared, because they keep per-query temporary files on disk.
+    /// Not applicable to GLOBAL JOIN: there the temporary table must be populated in any case.
+    if (!subquery_for_set.join && !subquery_for_set.source
+        && settings.use_subquery_result_cache
+        && settings.join_algorithm.value != "grace_hash"
+        && (join_params.kind == ASTTableJoin::Kind::Left || join_params.kind == ASTTableJoin::Kind::Inner))
+    {
+        if (auto subquery_result_cache = context.getSubqueryResultCache())
+        {
+            QueryResultCacheTableVersions table_versions;
+            if (QueryResultCache::collectTableVersions(join_element, context, table_versions))
+            {
+                /// Unlike a set, the structure of a join also depends on which columns the query
+                ///  reads from the joined table, so they become part of the key.
+                UInt128 element_hash = QueryResultCache::hash(join_element, context);
+                SipHash hash;
+                hash.update(element_hash.low);
+                hash.update(element_hash.high);
+                for (const auto & column : analyzedJoin().columns_from_joined_table)
+                    if (required_columns_from_joined_table.count(column.name_and_type.name))
+                    {
+                        hash.update(column.original_name.data(), column.original_name.size() + 1);
+                        hash.update(column.name_and_type.name.data(), column.name_and_type.name.size() + 1);
+                    }
+
+                UInt128 cache_key;
+                hash.get128(cache_key.low, cache_key.high);
+
+                if (JoinPtr cached_join = subquery_result_cache->tryGetJoin(cache_key, table_versions))
+                    subquery_for_set.join = cached_join;
+                else
+                {
+                    subquery_for_set.subquery_result_cache = subquery_result_cache;
+                    subquery_for_set.subquery_result_cache_key = cache_key;
+                    subquery_for_set.subquery_result_cache_table_versions = std::move(table_versions);
+                }
+            }
         }
     }
 
     if (!subquery_for_set.join)
     {
+        size_t join_shards = 1;
+        Join::Algorithm join_algorithm = Join::Algorithm::HASH;
+
+        if (settings.join_algorithm.value == "partitioned_hash")
+            join_shards = settings.max_threads;
+        else if (settings.join_algorithm.value == "merge" || settings.join_algorithm.value == "auto"
+            || settings.join_algorithm.value == "grace_hash")
+        {
+            bool kind_is_supported = join_params.kind == ASTTableJoin::Kind::Left || join_params.kind == ASTTableJoin::Kind::Inner;
+
+            if (settings.join_algorithm.value == "merge")
+            {
+                if (!kind_is_supported)
+                    throw Exception("Sort-merge JOIN is only implemented for LEFT and INNER joins", ErrorCodes::NOT_IMPLEMENTED);
+                join_algorithm = Join::Algorithm::SORT_MERGE;
+            }
+            else if (settings.join_algorithm.value == "grace_hash")
+            {
+                if (!kind_is_supported)
+                    throw Exception("Grace hash JOIN is only implemented for LEFT and INNER joins", ErrorCodes::NOT_IMPLEMENTED);
+                join_algorithm = Join::Algorithm::GRACE_HASH;
+            }
+            else if (kind_is_supported)
+                join_algorithm = Join::Algorithm::AUTO;
+        }
+        else if (settings.join_algorithm.value != "hash")
+            throw Exception("Unknown join_algorithm '" + settings.join_algorithm.value + "', must be one of: 'hash', 'partitioned_hash', 'merge', 'auto', 'grace_hash'",
+                ErrorCodes::BAD_ARGUMENTS);
+
+        /// The runtime filter drops non-joined rows of the left table, so it is allowed only for the kinds
+        ///  of JOIN that do not keep them.
+        /// Not for ASOF: the filter would hash the ASOF column, whose values differ between the two sides.
+        size_t runtime_filter_bytes = 0;
+        if (settings.join_runtime_filter
+            && join_params.strictness != ASTTableJoin::Strictness::Asof
+            && (join_params.kind == ASTTableJoin::Kind::Inner || join_params.kind == ASTTableJoin::Kind::Right))
+            runtime_filter_bytes = settings.join_runtime_filter_size_bytes;
+
         JoinPtr join = std::make_shared<Join>(
             analyzedJoin().key_names_left, analyzedJoin().key_names_right, columns_added_by_join_from_right_keys,
             settings.join_use_nulls, settings.size_limits_for_join,
-            join_params.kind, join_params.strictness);
+            join_params.kind, join_params.strictness, join_shards, join_algorithm,
+            settings.max_bytes_before_external_sort, context.getTemporaryPath(),
+            settings.grace_hash_join_buckets, runtime_filter_bytes);
 
         /** For GLOBAL JOINs (in the case, for example, of the push method for executing GLOBAL subqueries), the following occurs
           * - in the addExternalStorage function, the JOIN (SELECT ...) subquery is replaced with JOIN _data1,
@@ -1074,6 +1235,16 @@ void ExpressionAnalyzer::collectUsedColumns()
     RequiredSourceColumnsVisitor columns_visitor(available_columns, required, ignored, available_joined_columns, required_joined_columns);
     columns_visitor.visit(query);
 
+    /// The ASOF column of the right table is always added by the JOIN, whether the query reads it or not:
+    ///  its values come from the matched rows, so it cannot be restored from the left keys later.
+    if (select_query && select_query->join())
+    {
+        const auto & join_params = static_cast<const ASTTableJoin &>(
+            *static_cast<const ASTTablesInSelectQueryElement &>(*select_query->join()).table_join);
+        if (join_params.strictness == ASTTableJoin::Strictness::Asof && !analyzedJoin().key_names_right.empty())
+            required_joined_columns.insert(analyzedJoin().key_names_right.back());
+    }
+
     columns_added_by_join = analyzedJoin().available_joined_columns;
     for (auto it = columns_added_by_join.begin(); it != columns_added_by_join.end();)
     {
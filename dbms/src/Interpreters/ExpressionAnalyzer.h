@@ -27,6 +27,8 @@ class IStorage;
 using StoragePtr = std::shared_ptr<IStorage>;
 using Tables = std::map<String, StoragePtr>;
 
+class StorageDictionary;
+
 class ASTFunction;
 class ASTExpressionList;
 class ASTSelectQuery;
@@ -249,6 +251,12 @@ private:
 
     void addJoinAction(ExpressionActionsPtr & actions, bool only_types) const;
 
+    /** JOIN against a table that only represents an external dictionary: return a Join that probes
+      *  the dictionary directly instead of building a hash table from its contents on every query.
+      * Returns nullptr if the dictionary or the JOIN does not allow it (then the usual path is taken).
+      */
+    JoinPtr tryGetDirectDictionaryJoin(const StorageDictionary & storage_dictionary, const ASTTableJoin & join_params) const;
+
     bool isThereArrayJoin(const ASTPtr & ast);
 
     /// If ast is ASTSelectQuery with JOIN, add actions for JOIN key columns.
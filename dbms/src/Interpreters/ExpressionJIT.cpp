@@ -59,6 +59,7 @@
 namespace ProfileEvents
 {
     extern const Event CompileFunction;
+    extern const Event CompileAggregateFunctions;
     extern const Event CompileExpressionsMicroseconds;
     extern const Event CompileExpressionsBytes;
 }
@@ -626,16 +627,19 @@ size_t CompiledExpressionCache::weight() const
 {
 
 #if LLVM_VERSION_MAJOR >= 6
-    std::lock_guard<std::mutex> lock(mutex);
     size_t result{0};
     std::unordered_set<size_t> seen;
-    for (const auto & cell : cells)
+    for (const auto & shard : shards)
     {
-        auto function_context = cell.second.value->getContext();
-        if (!seen.count(function_context->id))
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        for (const auto & cell : shard->cells)
         {
-            result += function_context->memory_mapper->memory_tracker.get();
-            seen.insert(function_context->id);
+            auto function_context = cell.second.value->getContext();
+            if (!seen.count(function_context->id))
+            {
+                result += function_context->memory_mapper->memory_tracker.get();
+                seen.insert(function_context->id);
+            }
         }
     }
     return result;
@@ -704,11 +708,8 @@ std::vector<std::unordered_set<std::optional<size_t>>> getActionsDependents(cons
     return dependents;
 }
 
-void compileFunctions(ExpressionActions::Actions & actions, const Names & output_columns, const Block & sample_block, std::shared_ptr<CompiledExpressionCache> compilation_cache, size_t min_count_to_compile)
+static void initializeLLVMTarget()
 {
-    static std::unordered_map<UInt128, UInt32, UInt128Hash> counter;
-    static std::mutex mutex;
-
     struct LLVMTargetInitializer
     {
         LLVMTargetInitializer()
@@ -720,6 +721,14 @@ void compileFunctions(ExpressionActions::Actions & actions, const Names & output
     };
 
     static LLVMTargetInitializer initializer;
+}
+
+void compileFunctions(ExpressionActions::Actions & actions, const Names & output_columns, const Block & sample_block, std::shared_ptr<CompiledExpressionCache> compilation_cache, size_t min_count_to_compile)
+{
+    static std::unordered_map<UInt128, UInt32, UInt128Hash> counter;
+    static std::mutex mutex;
+
+    initializeLLVMTarget();
 
     auto dependents = getActionsDependents(actions, output_columns);
     std::vector<ExpressionActions::Actions> fused(actions.size());
@@ -785,6 +794,115 @@ void compileFunctions(ExpressionActions::Actions & actions, const Names & output
     }
 }
 
+
+/** Generates the fused `add` loop: for every row in [row_begin, row_end), the argument values are loaded
+  * from the raw column data and added into the states of all compiled functions.
+  * If `places_are_per_row`, the last parameter is an array with one place per row (null places are skipped),
+  * otherwise it is a single place shared by all rows (aggregation without keys).
+  */
+static void compileAddLoopToLLVMByteCode(std::shared_ptr<LLVMContext> & context,
+    const std::vector<AggregateFunctionToCompile> & functions, const std::string & name, bool places_are_per_row)
+{
+    auto & b = context->builder;
+    auto * size_type = b.getIntNTy(sizeof(size_t) * 8);
+    auto * place_type = b.getInt8PtrTy();
+    auto * places_type = places_are_per_row ? place_type->getPointerTo() : place_type;
+    auto * func_type = llvm::FunctionType::get(b.getVoidTy(),
+        { size_type, size_type, b.getInt8PtrTy()->getPointerTo(), places_type }, /*isVarArg=*/false);
+    auto * func = llvm::Function::Create(func_type, llvm::Function::ExternalLinkage, name, context->module.get());
+    auto args = func->args().begin();
+    llvm::Value * row_begin_arg = &*args++;
+    llvm::Value * row_end_arg = &*args++;
+    llvm::Value * columns_arg = &*args++;
+    llvm::Value * places_arg = &*args++;
+
+    /// Cast the raw column pointers to pointers to the native value types once, outside of the loop.
+    auto * entry = llvm::BasicBlock::Create(b.getContext(), "entry", func);
+    b.SetInsertPoint(entry);
+    std::vector<llvm::Value *> column_ptrs;
+    for (const auto & f : functions)
+    {
+        for (const auto & type : f.argument_types)
+        {
+            auto * data = b.CreateLoad(b.CreateConstInBoundsGEP1_32(b.getInt8PtrTy(), columns_arg, column_ptrs.size()));
+            column_ptrs.push_back(b.CreatePointerCast(data, toNativeType(b, type)->getPointerTo()));
+        }
+    }
+
+    /// assume row_begin < row_end
+    auto * loop = llvm::BasicBlock::Create(b.getContext(), "loop", func);
+    auto * end = llvm::BasicBlock::Create(b.getContext(), "end", func);
+    b.CreateBr(loop);
+    b.SetInsertPoint(loop);
+    auto * row = b.CreatePHI(size_type, 2);
+    row->addIncoming(row_begin_arg, entry);
+
+    auto emit_adds = [&](llvm::Value * place)
+    {
+        size_t column_idx = 0;
+        for (const auto & f : functions)
+        {
+            std::vector<llvm::Value *> arguments_values;
+            for (size_t i = 0; i < f.argument_types.size(); ++i)
+                arguments_values.push_back(b.CreateLoad(b.CreateInBoundsGEP(column_ptrs[column_idx++], row)));
+            f.function->compileAdd(b, f.state_offset ? b.CreateConstInBoundsGEP1_64(place, f.state_offset) : place, arguments_values);
+        }
+    };
+
+    if (places_are_per_row)
+    {
+        auto * add_block = llvm::BasicBlock::Create(b.getContext(), "add", func);
+        auto * loop_tail = llvm::BasicBlock::Create(b.getContext(), "tail", func);
+        auto * place = b.CreateLoad(b.CreateInBoundsGEP(places_arg, row));
+        b.CreateCondBr(b.CreateIsNull(place), loop_tail, add_block);
+        b.SetInsertPoint(add_block);
+        emit_adds(place);
+        b.CreateBr(loop_tail);
+        b.SetInsertPoint(loop_tail);
+    }
+    else
+    {
+        emit_adds(places_arg);
+    }
+
+    auto * next_row = b.CreateAdd(row, llvm::ConstantInt::get(size_type, 1));
+    row->addIncoming(next_row, b.GetInsertBlock());
+    b.CreateCondBr(b.CreateICmpEQ(next_row, row_end_arg), end, loop);
+    b.SetInsertPoint(end);
+    b.CreateRetVoid();
+}
+
+static void * findCompiledSymbol(const std::shared_ptr<LLVMContext> & context, const std::string & name)
+{
+    auto it = context->symbols.find(name);
+    if (context->symbols.end() == it)
+        throw Exception("Cannot find symbol " + name + " in LLVMContext", ErrorCodes::LOGICAL_ERROR);
+    return it->second;
+}
+
+CompiledAggregateFunctions compileAggregateFunctions(const std::vector<AggregateFunctionToCompile> & functions)
+{
+    initializeLLVMTarget();
+
+    ProfileEvents::increment(ProfileEvents::CompileAggregateFunctions);
+    Stopwatch watch;
+
+    CompiledAggregateFunctions result;
+    result.context = std::make_shared<LLVMContext>();
+    compileAddLoopToLLVMByteCode(result.context, functions, "aggregate_add_into_places", /*places_are_per_row=*/true);
+    compileAddLoopToLLVMByteCode(result.context, functions, "aggregate_add_into_single_place", /*places_are_per_row=*/false);
+
+    size_t used_memory = result.context->compileAllFunctionsToNativeCode();
+    ProfileEvents::increment(ProfileEvents::CompileExpressionsBytes, used_memory);
+    ProfileEvents::increment(ProfileEvents::CompileExpressionsMicroseconds, watch.elapsedMicroseconds());
+
+    result.add_into_places = reinterpret_cast<CompiledAggregateFunctions::AddIntoPlacesFunc>(
+        findCompiledSymbol(result.context, "aggregate_add_into_places"));
+    result.add_into_single_place = reinterpret_cast<CompiledAggregateFunctions::AddIntoSinglePlaceFunc>(
+        findCompiledSymbol(result.context, "aggregate_add_into_single_place"));
+    return result;
+}
+
 }
 
 #endif
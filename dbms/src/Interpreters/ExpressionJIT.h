@@ -4,6 +4,7 @@
 
 #if USE_EMBEDDED_COMPILER
 
+#include <AggregateFunctions/IAggregateFunction.h>
 #include <Functions/IFunction.h>
 #include <Interpreters/Context.h>
 #include <Interpreters/ExpressionActions.h>
@@ -76,6 +77,42 @@ public:
 /// function's result are as arguments to other compilable functions, inline it and leave the now-redundant action as-is.
 void compileFunctions(ExpressionActions::Actions & actions, const Names & output_columns, const Block & sample_block, std::shared_ptr<CompiledExpressionCache> compilation_cache, size_t min_count_to_compile);
 
+
+/// A unit of compilation for the fused aggregation loop: an aggregate function together with
+/// the offset of its state inside the shared per-key aggregate data and its argument types.
+struct AggregateFunctionToCompile
+{
+    const IAggregateFunction * function;
+    size_t state_offset;
+    DataTypes argument_types;
+};
+
+/** Native code for the inner loop of the Aggregator: for every row, the values of all compiled
+  * aggregate functions are added into the states their places point to, in a single pass over the block.
+  * Only the `add` path is compiled - creation, merging and serialization of states stay interpreted,
+  * which is correct because the generated code updates the same memory layout that `add` would.
+  */
+struct CompiledAggregateFunctions
+{
+    /** Arguments:
+      * - half-open row range [row_begin, row_end) to process;
+      * - column_data: pointers to the raw data of the argument columns of all compiled functions, flattened
+      *   in the order they were passed to compileAggregateFunctions (the columns must have fixed-size values);
+      * - places (one per row) or a single place the aggregate states live at. Rows with place == nullptr are skipped.
+      */
+    using AddIntoPlacesFunc = void (*)(size_t row_begin, size_t row_end, const char * const * column_data, AggregateDataPtr * places);
+    using AddIntoSinglePlaceFunc = void (*)(size_t row_begin, size_t row_end, const char * const * column_data, AggregateDataPtr place);
+
+    AddIntoPlacesFunc add_into_places = nullptr;
+    AddIntoSinglePlaceFunc add_into_single_place = nullptr;
+
+    /// Keeps the generated code alive.
+    std::shared_ptr<LLVMContext> context;
+};
+
+/// Compile the fused `add` loop over the given functions. All of them must return true from isCompilable().
+CompiledAggregateFunctions compileAggregateFunctions(const std::vector<AggregateFunctionToCompile> & functions);
+
 }
 
 #endif
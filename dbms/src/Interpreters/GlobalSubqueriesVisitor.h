@@ -152,7 +152,8 @@ private:
         Block sample = interpreter->getSampleBlock();
         NamesAndTypesList columns = sample.getNamesAndTypesList();
 
-        StoragePtr external_storage = StorageMemory::create(external_table_name, ColumnsDescription{columns});
+        StoragePtr external_storage = StorageMemory::create(external_table_name, ColumnsDescription{columns},
+            false, context.getSettingsRef().temporary_table_max_bytes_in_memory, context.getTemporaryPath());
         external_storage->startup();
 
         /** We replace the subquery with the name of the temporary table.
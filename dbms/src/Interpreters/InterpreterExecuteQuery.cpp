@@ -0,0 +1,122 @@
+#include <Interpreters/InterpreterExecuteQuery.h>
+
+#include <Common/typeid_cast.h>
+#include <IO/WriteHelpers.h>
+#include <Interpreters/Context.h>
+#include <Interpreters/InterpreterFactory.h>
+#include <Parsers/ASTExecuteQuery.h>
+#include <Parsers/ASTFunction.h>
+#include <Parsers/ASTLiteral.h>
+#include <Parsers/ASTSelectQuery.h>
+
+
+namespace DB
+{
+
+namespace ErrorCodes
+{
+    extern const int BAD_ARGUMENTS;
+    extern const int WRONG_NUMBER_OF_PARAMETERS;
+}
+
+namespace
+{
+
+ASTPtr getBoundValue(const ASTFunction & func, const ASTs & values)
+{
+    const ASTLiteral * index_literal = nullptr;
+    if (func.arguments && func.arguments->children.size() == 1)
+        index_literal = typeid_cast<const ASTLiteral *>(func.arguments->children[0].get());
+
+    if (!index_literal || index_literal->value.getType() != Field::Types::UInt64)
+        throw Exception("Parameter slot must look like param(N) with a positive integer N",
+            ErrorCodes::BAD_ARGUMENTS);
+
+    UInt64 index = index_literal->value.safeGet<UInt64>();
+    if (index == 0 || index > values.size())
+        throw Exception("Prepared statement uses parameter " + toString(index)
+            + ", but " + toString(values.size()) + " values are bound",
+            ErrorCodes::WRONG_NUMBER_OF_PARAMETERS);
+
+    return values[index - 1]->clone();
+}
+
+void substituteParameters(ASTPtr & ast, const ASTs & values);
+
+/// A select query keeps its parts both as named members and in children; keep them in sync
+/// when the member itself is a parameter slot (e.g. WHERE param(1)).
+void substituteMember(IAST & parent, ASTPtr & member, const ASTs & values)
+{
+    if (!member)
+        return;
+
+    ASTPtr old = member;
+    substituteParameters(member, values);
+
+    if (member != old)
+        for (auto & child : parent.children)
+            if (child == old)
+                child = member;
+}
+
+void substituteParameters(ASTPtr & ast, const ASTs & values)
+{
+    if (const auto * func = typeid_cast<const ASTFunction *>(ast.get()))
+    {
+        if (func->name == "param")
+        {
+            ASTPtr value = getBoundValue(*func, values);
+
+            /// The slot may carry an alias (SELECT param(1) AS x ... ORDER BY x); it must survive
+            ///  the substitution, or the result column name and references to it change at EXECUTE.
+            if (!func->alias.empty())
+                value->setAlias(func->alias);
+
+            ast = std::move(value);
+            return;
+        }
+    }
+
+    if (auto * select = typeid_cast<ASTSelectQuery *>(ast.get()))
+    {
+        substituteMember(*select, select->with_expression_list, values);
+        substituteMember(*select, select->select_expression_list, values);
+        substituteMember(*select, select->tables, values);
+        substituteMember(*select, select->prewhere_expression, values);
+        substituteMember(*select, select->where_expression, values);
+        substituteMember(*select, select->group_expression_list, values);
+        substituteMember(*select, select->having_expression, values);
+        substituteMember(*select, select->order_expression_list, values);
+        substituteMember(*select, select->limit_by_value, values);
+        substituteMember(*select, select->limit_by_expression_list, values);
+        substituteMember(*select, select->limit_offset, values);
+        substituteMember(*select, select->limit_length, values);
+        substituteMember(*select, select->settings, values);
+        return;
+    }
+
+    for (auto & child : ast->children)
+        substituteParameters(child, values);
+}
+
+}
+
+
+BlockIO InterpreterExecuteQuery::execute()
+{
+    const auto & query = typeid_cast<const ASTExecuteQuery &>(*query_ptr);
+
+    /// The pristine AST stays in the session; the analysis works on a private copy,
+    /// so schema changes between EXECUTEs are picked up naturally.
+    ASTPtr prepared = context.getSessionContext().getPreparedStatement(query.name)->clone();
+
+    ASTs values;
+    if (query.arguments)
+        values = query.arguments->children;
+
+    substituteParameters(prepared, values);
+
+    return InterpreterFactory::get(prepared, context, QueryProcessingStage::Complete)->execute();
+}
+
+}
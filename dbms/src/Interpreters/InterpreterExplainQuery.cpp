@@ -5,9 +5,13 @@
 #include <DataTypes/DataTypeString.h>
 #include <Parsers/queryToString.h>
 #include <Common/typeid_cast.h>
+#include <Interpreters/Context.h>
 #include <Interpreters/InterpreterExplainQuery.h>
+#include <Interpreters/InterpreterFactory.h>
+#include <Interpreters/QueryPlanOptimizer.h>
 #include <Parsers/ASTExplainQuery.h>
 #include <Parsers/DumpASTNode.h>
+#include <Parsers/formatAST.h>
 
 
 namespace DB
@@ -40,7 +44,49 @@ BlockInputStreamPtr InterpreterExplainQuery::executeImpl()
     const ASTExplainQuery & ast = typeid_cast<const ASTExplainQuery &>(*query);
 
     std::stringstream ss;
-    dumpAST(ast, ss);
+
+    if (ast.getKind() == ASTExplainQuery::Plan)
+    {
+        /// Show the query as it will actually be executed, after the rule-based rewrites,
+        ///  together with the names of the rules that changed it.
+        ASTPtr rewritten = query->children.at(0)->clone();
+
+        Strings rules;
+        if (context.getSettingsRef().optimize_query_plan)
+            rules = QueryPlanOptimizer(context).optimize(rewritten);
+
+        ss << "Rewrite rules applied: ";
+        if (rules.empty())
+            ss << "none";
+        for (size_t i = 0; i < rules.size(); ++i)
+            ss << (i ? ", " : "") << rules[i];
+        ss << "\n";
+
+        formatAST(*rewritten, ss, false, true);
+        ss << "\n";
+    }
+    else if (ast.getKind() == ASTExplainQuery::Pipeline)
+    {
+        /// The rewrites are applied here as well, so the pipeline matches a real execution.
+        if (context.getSettingsRef().optimize_query_plan)
+            QueryPlanOptimizer(context).optimize(query->children.at(0));
+
+        /// Execute the query to the end: timings are collected while the data flows through the streams
+        /// (see BlockStreamProfileInfo), the result itself is discarded.
+        BlockIO inner = InterpreterFactory::get(query->children.at(0), context)->execute();
+
+        if (inner.in)
+        {
+            inner.in->readPrefix();
+            while (inner.in->read())
+                ;
+            inner.in->readSuffix();
+
+            inner.in->dumpTreeWithProfile(ss);
+        }
+    }
+    else
+        dumpAST(ast, ss);
 
     Block sample_block = getSampleBlock();
     MutableColumns res_columns = sample_block.cloneEmptyColumns();
@@ -6,6 +6,7 @@
 namespace DB
 {
 
+class Context;
 class IAST;
 using ASTPtr = std::shared_ptr<IAST>;
 
@@ -14,8 +15,8 @@ using ASTPtr = std::shared_ptr<IAST>;
 class InterpreterExplainQuery : public IInterpreter
 {
 public:
-    InterpreterExplainQuery(const ASTPtr & query_, const Context &)
-        : query(query_)
+    InterpreterExplainQuery(const ASTPtr & query_, Context & context_)
+        : query(query_), context(context_)
     {}
 
     BlockIO execute() override;
@@ -24,6 +25,7 @@ public:
 
 private:
     ASTPtr query;
+    Context & context;
 
     BlockInputStreamPtr executeImpl();
 };
@@ -7,15 +7,23 @@
 #include <DataStreams/ConvertingBlockInputStream.h>
 #include <DataStreams/NullAndDoCopyBlockInputStream.h>
 #include <DataStreams/PushingToViewsBlockOutputStream.h>
+#include <DataStreams/RemoteBlockInputStream.h>
 #include <DataStreams/SquashingBlockOutputStream.h>
+#include <DataStreams/UnionBlockInputStream.h>
 #include <DataStreams/copyData.h>
 
 #include <Parsers/ASTInsertQuery.h>
+#include <Parsers/ASTSelectQuery.h>
 #include <Parsers/ASTSelectWithUnionQuery.h>
+#include <Parsers/queryToString.h>
 
+#include <Interpreters/AsynchronousInsertQueue.h>
+#include <Interpreters/DatabaseAndTableWithAlias.h>
 #include <Interpreters/InterpreterInsertQuery.h>
 #include <Interpreters/InterpreterSelectWithUnionQuery.h>
 
+#include <Storages/StorageDistributed.h>
+
 #include <TableFunctions/TableFunctionFactory.h>
 #include <Parsers/ASTFunction.h>
 
@@ -92,6 +100,23 @@ BlockIO InterpreterInsertQuery::execute()
     checkAccess(query);
     StoragePtr table = getTable(query);
 
+    /// Data of small INSERTs is accumulated in a server-side staging buffer and written
+    ///  to the table in background together with data of other INSERTs (see AsynchronousInsertQueue).
+    /// The table is resolved again at flush time, so table functions are written to directly.
+    if (context.getSettingsRef().async_insert && !query.select && !query.table_function && !query.no_destination)
+    {
+        BlockIO res;
+        res.out = std::make_shared<AsynchronousInsertBlockOutputStream>(
+            context.getAsynchronousInsertQueue(),
+            query.database.empty() ? context.getCurrentDatabase() : query.database, query.table,
+            getSampleBlock(query, table), context.getSettingsRef());
+        return res;
+    }
+
+    if (query.select)
+        if (auto res = tryExecuteShardLocalInsertSelect(query, table))
+            return std::move(*res);
+
     auto table_lock = table->lockStructure(true, __PRETTY_FUNCTION__);
 
     /// We create a pipeline of several streams, into which we will write data.
@@ -146,6 +171,96 @@ BlockIO InterpreterInsertQuery::execute()
 }
 
 
+std::optional<BlockIO> InterpreterInsertQuery::tryExecuteShardLocalInsertSelect(const ASTInsertQuery & query, const StoragePtr & table)
+{
+    const Settings & settings = context.getSettingsRef();
+
+    if (!settings.distributed_insert_select_shard_local || query.table_function)
+        return {};
+
+    auto * target = typeid_cast<StorageDistributed *>(table.get());
+    if (!target || target->getClusterName().empty() || target->getRemoteTableName().empty())
+        return {};
+
+    const auto & select_with_union = typeid_cast<const ASTSelectWithUnionQuery &>(*query.select);
+    if (select_with_union.list_of_selects->children.size() != 1)
+        return {};
+
+    const auto * select = typeid_cast<const ASTSelectQuery *>(select_with_union.list_of_selects->children[0].get());
+    if (!select || select->join())
+        return {};
+
+    auto database_and_table = getDatabaseAndTable(*select, 0);
+    if (!database_and_table)
+        return {};
+
+    StoragePtr source_table = context.tryGetTable(database_and_table->database, database_and_table->table);
+    if (!source_table)
+        return {};
+
+    auto * source = typeid_cast<StorageDistributed *>(source_table.get());
+    if (!source || source->getRemoteTableName().empty())
+        return {};
+
+    /// The same cluster from the config means the same set of shards in the same order.
+    if (source->getClusterName() != target->getClusterName())
+        return {};
+
+    auto cluster = target->getCluster();
+    const auto & shards_info = cluster->getShardsInfo();
+
+    /// With more than one shard every row must stay on its shard, which holds only if both
+    /// tables distribute rows by the same sharding expression.
+    if (shards_info.size() > 1
+        && (target->getShardingKeyColumnName().empty()
+            || target->getShardingKeyColumnName() != source->getShardingKeyColumnName()))
+        return {};
+
+    /// Writing around the Distributed table is only correct when a single replica per shard has
+    /// to be written: either there is one replica, or the underlying table replicates by itself.
+    for (const auto & shard_info : shards_info)
+        if (!shard_info.hasInternalReplication() && shard_info.per_replica_pools.size() > 1)
+            return {};
+
+    /// Rewrite both sides of the query over the underlying tables and run it on every shard.
+    ASTPtr modified_query_ast = query_ptr->clone();
+    auto & modified_insert = typeid_cast<ASTInsertQuery &>(*modified_query_ast);
+    modified_insert.database = target->getRemoteDatabaseName();
+    modified_insert.table = target->getRemoteTableName();
+
+    auto & modified_select = typeid_cast<ASTSelectQuery &>(
+        *typeid_cast<ASTSelectWithUnionQuery &>(*modified_insert.select).list_of_selects->children[0]);
+    modified_select.replaceDatabaseAndTable(source->getRemoteDatabaseName(), source->getRemoteTableName());
+
+    const String modified_query_str = queryToString(modified_query_ast);
+    LOG_DEBUG(&Logger::get("InterpreterInsertQuery"),
+        "Executing INSERT SELECT between co-sharded Distributed tables on each shard locally: " << modified_query_str);
+
+    BlockInputStreams streams;
+    for (const auto & shard_info : shards_info)
+    {
+        if (shard_info.isLocal())
+        {
+            InterpreterInsertQuery interpreter(modified_query_ast, context, allow_materialized);
+            streams.emplace_back(interpreter.execute().in);
+        }
+        else
+        {
+            auto stream = std::make_shared<RemoteBlockInputStream>(shard_info.pool, modified_query_str, Block{}, context);
+            stream->setPoolMode(PoolMode::GET_ONE);
+            streams.emplace_back(std::move(stream));
+        }
+    }
+
+    BlockIO res;
+    if (streams.size() == 1)
+        res.in = streams[0];
+    else
+        res.in = std::make_shared<UnionBlockInputStream<>>(streams, nullptr, settings.max_distributed_connections);
+    return res;
+}
+
+
 void InterpreterInsertQuery::checkAccess(const ASTInsertQuery & query)
 {
     const Settings & settings = context.getSettingsRef();
@@ -6,6 +6,8 @@
 #include <Interpreters/IInterpreter.h>
 #include <Parsers/ASTInsertQuery.h>
 
+#include <optional>
+
 namespace DB
 {
 
@@ -29,6 +31,12 @@ private:
     Block getSampleBlock(const ASTInsertQuery & query, const StoragePtr & table);
     void checkAccess(const ASTInsertQuery & query);
 
+    /// INSERT into a Distributed table selecting from a co-sharded Distributed table can be run
+    /// on every shard over the underlying tables, with no data passing through the initiator
+    /// (see the distributed_insert_select_shard_local setting). Returns nothing if the query
+    /// does not qualify.
+    std::optional<BlockIO> tryExecuteShardLocalInsertSelect(const ASTInsertQuery & query, const StoragePtr & table);
+
     ASTPtr query_ptr;
     const Context & context;
     bool allow_materialized;
@@ -0,0 +1,24 @@
+#include <Interpreters/InterpreterPrepareQuery.h>
+
+#include <Common/typeid_cast.h>
+#include <Interpreters/Context.h>
+#include <Parsers/ASTPrepareQuery.h>
+
+
+namespace DB
+{
+
+BlockIO InterpreterPrepareQuery::execute()
+{
+    const auto & query = typeid_cast<const ASTPrepareQuery &>(*query_ptr);
+    Context & session = context.getSessionContext();
+
+    if (query.deallocate)
+        session.removePreparedStatement(query.name);
+    else
+        session.setPreparedStatement(query.name, query.query->clone(), context.getSettingsRef().max_prepared_statements);
+
+    return {};
+}
+
+}
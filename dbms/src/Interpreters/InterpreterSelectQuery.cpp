@@ -1,18 +1,25 @@
 #include <DataStreams/ExpressionBlockInputStream.h>
+#include <DataStreams/JoinRuntimeFilterBlockInputStream.h>
 #include <DataStreams/FilterBlockInputStream.h>
 #include <DataStreams/LimitBlockInputStream.h>
 #include <DataStreams/LimitByBlockInputStream.h>
 #include <DataStreams/PartialSortingBlockInputStream.h>
 #include <DataStreams/MergeSortingBlockInputStream.h>
 #include <DataStreams/MergingSortedBlockInputStream.h>
+#include <DataStreams/FinishSortingBlockInputStream.h>
 #include <DataStreams/AggregatingBlockInputStream.h>
 #include <DataStreams/MergingAggregatedBlockInputStream.h>
 #include <DataStreams/MergingAggregatedMemoryEfficientBlockInputStream.h>
 #include <DataStreams/AsynchronousBlockInputStream.h>
 #include <DataStreams/UnionBlockInputStream.h>
 #include <DataStreams/ParallelAggregatingBlockInputStream.h>
+#include <DataStreams/PartialAggregatingBlockInputStream.h>
+#include <DataStreams/ShareLowCardinalityDictionariesBlockInputStream.h>
+#include <DataStreams/SplittingBlockInputStream.h>
+#include <DataStreams/AggregatingInOrderBlockInputStream.h>
 #include <DataStreams/DistinctBlockInputStream.h>
 #include <DataStreams/NullBlockInputStream.h>
+#include <DataStreams/OneBlockInputStream.h>
 #include <DataStreams/TotalsHavingBlockInputStream.h>
 #include <DataStreams/copyData.h>
 #include <DataStreams/CreatingSetsBlockInputStream.h>
@@ -21,6 +28,7 @@
 #include <DataStreams/RollupBlockInputStream.h>
 #include <DataStreams/CubeBlockInputStream.h>
 #include <DataStreams/ConvertColumnLowCardinalityToFullBlockInputStream.h>
+#include <DataStreams/FillingBlockInputStream.h>
 
 #include <Parsers/ASTSelectQuery.h>
 #include <Parsers/ASTSelectWithUnionQuery.h>
@@ -29,23 +37,29 @@
 #include <Parsers/ASTLiteral.h>
 #include <Parsers/ASTOrderByElement.h>
 #include <Parsers/ASTTablesInSelectQuery.h>
+#include <Parsers/ASTSubquery.h>
 
 #include <Interpreters/InterpreterSelectQuery.h>
 #include <Interpreters/InterpreterSelectWithUnionQuery.h>
 #include <Interpreters/InterpreterSetQuery.h>
 #include <Interpreters/ExpressionAnalyzer.h>
+#include <Interpreters/SyntaxAnalyzer.h>
 #include <Interpreters/DatabaseAndTableWithAlias.h>
+#include <Interpreters/JoinOrderOptimizer.h>
+#include <Interpreters/evaluateConstantExpression.h>
 #include <Storages/MergeTree/MergeTreeWhereOptimizer.h>
 
 #include <Storages/IStorage.h>
 #include <Storages/StorageMergeTree.h>
 #include <Storages/StorageReplicatedMergeTree.h>
+#include <Storages/StorageMaterializedView.h>
 
 #include <TableFunctions/ITableFunction.h>
 #include <TableFunctions/TableFunctionFactory.h>
 
 #include <Core/Field.h>
 #include <Columns/Collator.h>
+#include <Common/FieldVisitors.h>
 #include <Common/typeid_cast.h>
 #include <Parsers/queryToString.h>
 #include <ext/map.h>
@@ -147,6 +161,17 @@ InterpreterSelectQuery::InterpreterSelectQuery(
 
     max_streams = settings.max_threads;
 
+    /// Under high concurrency the server may grant the query fewer threads than max_threads
+    ///  to avoid oversubscribing the CPU (see ProcessList::allotThreads).
+    if (max_streams > 1)
+        if (auto * process_list_elem = context.getProcessListElement())
+            max_streams = context.getProcessList().allotThreads(*process_list_elem, max_streams);
+
+    /// Choose the build side of a JOIN by the table statistics. Must happen before the
+    /// left table is resolved below, because the rewrite may change what the left table is.
+    if (!input_ && !storage_ && settings.optimize_join_build_side)
+        JoinOrderOptimizer(&query, context).perform();
+
     ASTPtr table_expression = getTableFunctionOrSubquery(query, 0);
 
     if (input)
@@ -450,6 +475,9 @@ void InterpreterSelectQuery::executeImpl(Pipeline & pipeline, const BlockInputSt
 
     QueryProcessingStage::Enum from_stage = QueryProcessingStage::FetchColumns;
 
+    /// Whether the aggregation result was obtained from MergeTree part metadata, without reading data.
+    bool aggregated_from_metadata = false;
+
     /// PREWHERE optimization
     if (storage)
     {
@@ -458,6 +486,10 @@ void InterpreterSelectQuery::executeImpl(Pipeline & pipeline, const BlockInputSt
 
         query_analyzer->makeSetsForIndex();
 
+        if (!dry_run && !prepared_input && to_stage == QueryProcessingStage::Complete
+            && settings.optimize_aggregation_from_metadata)
+            aggregated_from_metadata = tryAggregateFromMetadata(pipeline);
+
         auto optimize_prewhere = [&](auto & merge_tree)
         {
             SelectQueryInfo query_info;
@@ -466,7 +498,8 @@ void InterpreterSelectQuery::executeImpl(Pipeline & pipeline, const BlockInputSt
             query_info.sets = query_analyzer->getPreparedSets();
 
             /// Try transferring some condition from WHERE to PREWHERE if enabled and viable
-            if (settings.optimize_move_to_prewhere && query.where_expression && !query.prewhere_expression && !query.final())
+            if (settings.optimize_move_to_prewhere && query.where_expression && !query.prewhere_expression && !query.final()
+                && !aggregated_from_metadata)
                 MergeTreeWhereOptimizer{query_info, context, merge_tree.getData(), query_analyzer->getRequiredSourceColumns(), log};
         };
 
@@ -499,8 +532,156 @@ void InterpreterSelectQuery::executeImpl(Pipeline & pipeline, const BlockInputSt
             to_stage == QueryProcessingStage::WithMergeableState)
             throw Exception("Distributed on Distributed is not supported", ErrorCodes::NOT_IMPLEMENTED);
 
+        /** If ORDER BY is a prefix of the MergeTree sorting key (all in the same direction) and
+          * nothing between reading and sorting can reorder the rows, read each part in (reverse)
+          * key order and merge the streams in executeOrder instead of sorting them.
+          */
+        if (settings.optimize_read_in_order && storage && !prepared_input
+            && expressions.first_stage && expressions.has_order_by
+            && !expressions.need_aggregate && !expressions.has_join
+            && !query.final() && !query.array_join_expression_list())
+        {
+            Names sort_columns;
+            if (const StorageMergeTree * merge_tree = dynamic_cast<const StorageMergeTree *>(storage.get()))
+                sort_columns = merge_tree->getData().getSortColumns();
+            else if (const StorageReplicatedMergeTree * replicated_merge_tree = dynamic_cast<const StorageReplicatedMergeTree *>(storage.get()))
+                sort_columns = replicated_merge_tree->getData().getSortColumns();
+
+            int direction = 0;
+            SortDescription prefix_descr;
+            for (const auto & elem : query.order_expression_list->children)
+            {
+                if (prefix_descr.size() == sort_columns.size())
+                    break;
+
+                const ASTOrderByElement & order_by_elem = typeid_cast<const ASTOrderByElement &>(*elem);
+                String name = elem->children.front()->getColumnName();
+
+                if (order_by_elem.collation || name != sort_columns[prefix_descr.size()]
+                    || (direction != 0 && order_by_elem.direction != direction))
+                    break;
+
+                direction = order_by_elem.direction;
+                prefix_descr.emplace_back(name, order_by_elem.direction, order_by_elem.nulls_direction);
+            }
+
+            if (!prefix_descr.empty())
+            {
+                read_in_order_direction = direction;
+                read_in_order_prefix = std::move(prefix_descr);
+            }
+        }
+
+        /** Similarly, if the GROUP BY keys are a prefix of the sorting key, equal keys arrive
+          * contiguously when reading in key order, and the data can be aggregated in a streaming
+          * fashion, keeping the states of a single group in memory (see AggregatingInOrderBlockInputStream).
+          * Only when the aggregation is finalized right here: the streaming form produces no
+          * intermediate states, overflow rows or totals.
+          */
+        if (storage && !prepared_input && !aggregated_from_metadata
+            && expressions.first_stage && expressions.need_aggregate
+            && to_stage > QueryProcessingStage::WithMergeableState
+            && !expressions.has_join && !query.final() && !query.array_join_expression_list()
+            && !query.group_by_with_totals && !query.group_by_with_rollup && !query.group_by_with_cube
+            && !settings.max_rows_to_group_by)
+        {
+            /// A materialized view reads from its inner table; the layout of that table decides.
+            StoragePtr storage_for_reading = storage;
+            if (const StorageMaterializedView * materialized_view = dynamic_cast<const StorageMaterializedView *>(storage.get()))
+                storage_for_reading = materialized_view->getTargetTable();
+
+            const MergeTreeData * merge_tree_data = nullptr;
+            if (const StorageMergeTree * merge_tree = dynamic_cast<const StorageMergeTree *>(storage_for_reading.get()))
+                merge_tree_data = &merge_tree->getData();
+            else if (const StorageReplicatedMergeTree * replicated_merge_tree = dynamic_cast<const StorageReplicatedMergeTree *>(storage_for_reading.get()))
+                merge_tree_data = &replicated_merge_tree->getData();
+
+            /// A maintained summary (see the maintain_aggregating_summary setting) is always read in
+            ///  streaming fashion: background merges keep its parts nearly collapsed by the sorting
+            ///  key, so the streaming read only folds the few remaining duplicate keys and finalizes,
+            ///  instead of re-hashing the whole summary on every query.
+            bool maintained_summary = merge_tree_data
+                && merge_tree_data->merging_params.mode == MergeTreeData::MergingParams::Aggregating
+                && merge_tree_data->settings.maintain_aggregating_summary;
+
+            Names sort_columns;
+            if (merge_tree_data && (settings.optimize_aggregation_in_order || maintained_summary))
+                sort_columns = merge_tree_data->getSortColumns();
+
+            Names key_names;
+            AggregateDescriptions aggregates;
+            query_analyzer->getAggregateInfo(key_names, aggregates);
+
+            if (!key_names.empty() && key_names.size() <= sort_columns.size())
+            {
+                /// The keys must cover a prefix of the sorting key; their order in GROUP BY does not matter,
+                /// because data sorted by a prefix keeps any combination of its columns contiguous.
+                NameSet key_set(key_names.begin(), key_names.end());
+
+                bool is_prefix = key_set.size() == key_names.size();
+                for (size_t i = 0; is_prefix && i < key_names.size(); ++i)
+                    if (!key_set.count(sort_columns[i]))
+                        is_prefix = false;
+
+                if (is_prefix)
+                {
+                    aggregate_in_order = true;
+                    for (size_t i = 0; i < key_names.size(); ++i)
+                        aggregate_in_order_descr.emplace_back(sort_columns[i], 1, 1);
+                }
+            }
+        }
+
+        /** If the GROUP BY keys determine the partition (they include the values of the partition
+          * key or all of its source columns), the groups of different partitions are disjoint:
+          * every partition gets its own stream and its own aggregator, the results are simply
+          * concatenated, with no cross-stream merge phase, and each partition is emitted as soon
+          * as it is complete.
+          */
+        if (settings.optimize_partition_wise_aggregation && storage && !prepared_input && !aggregated_from_metadata
+            && !aggregate_in_order
+            && expressions.first_stage && expressions.need_aggregate
+            && to_stage > QueryProcessingStage::WithMergeableState
+            && !expressions.has_join && !query.final() && !query.array_join_expression_list()
+            && !query.group_by_with_totals && !query.group_by_with_rollup && !query.group_by_with_cube)
+        {
+            const MergeTreeData * merge_tree_data = nullptr;
+            if (const StorageMergeTree * merge_tree = dynamic_cast<const StorageMergeTree *>(storage.get()))
+                merge_tree_data = &merge_tree->getData();
+            else if (const StorageReplicatedMergeTree * replicated_merge_tree = dynamic_cast<const StorageReplicatedMergeTree *>(storage.get()))
+                merge_tree_data = &replicated_merge_tree->getData();
+
+            if (merge_tree_data && merge_tree_data->partition_key_sample.columns())
+            {
+                Names key_names;
+                AggregateDescriptions aggregates;
+                query_analyzer->getAggregateInfo(key_names, aggregates);
+
+                NameSet key_set(key_names.begin(), key_names.end());
+
+                /// Either the values of the partition key itself or all of its source columns
+                ///  must be among the keys - both determine the partition of a group.
+                bool covers_partition_key = true;
+                for (const auto & column : merge_tree_data->partition_key_sample)
+                    if (!key_set.count(column.name))
+                        covers_partition_key = false;
+
+                if (!covers_partition_key && !merge_tree_data->minmax_idx_columns.empty())
+                {
+                    covers_partition_key = true;
+                    for (const auto & name : merge_tree_data->minmax_idx_columns)
+                        if (!key_set.count(name))
+                            covers_partition_key = false;
+                }
+
+                if (covers_partition_key && !key_names.empty())
+                    aggregate_partition_wise = true;
+            }
+        }
+
         /** Read the data from Storage. from_stage - to what stage the request was completed in Storage. */
-        executeFetchColumns(from_stage, pipeline, expressions.prewhere_info, expressions.columns_to_remove_after_prewhere);
+        if (!aggregated_from_metadata)
+            executeFetchColumns(from_stage, pipeline, expressions.prewhere_info, expressions.columns_to_remove_after_prewhere);
 
         LOG_TRACE(log, QueryProcessingStage::toString(from_stage) << " -> " << QueryProcessingStage::toString(to_stage));
     }
@@ -532,19 +713,56 @@ void InterpreterSelectQuery::executeImpl(Pipeline & pipeline, const BlockInputSt
                     pipeline.stream_with_non_joined_data = expressions.before_join->createStreamWithNonJoinedDataIfFullOrRightJoin(
                         pipeline.firstStream()->getHeader(), settings.max_block_size);
 
+                /// If the join has a runtime filter over the build-side keys, filter the left table by it
+                ///  right after the source, before the rest of the pipeline processes the rows.
+                std::shared_ptr<const Join> join_with_runtime_filter;
+                for (const auto & action : expressions.before_join->getActions())
+                    if (action.type == ExpressionAction::JOIN && action.join && action.join->hasRuntimeFilter())
+                        join_with_runtime_filter = action.join;
+
+                if (join_with_runtime_filter)
+                {
+                    /// Filtering is possible only when the key columns are already read from the table
+                    ///  (i.e. the keys are not expressions calculated by before_join itself).
+                    const Block & header = pipeline.firstStream()->getHeader();
+                    bool has_all_keys = true;
+                    for (const auto & name : join_with_runtime_filter->getKeyNamesLeft())
+                        if (!header.has(name))
+                            has_all_keys = false;
+
+                    if (has_all_keys)
+                        for (auto & stream : pipeline.streams)
+                            stream = std::make_shared<JoinRuntimeFilterBlockInputStream>(stream, join_with_runtime_filter);
+                }
+
                 for (auto & stream : pipeline.streams)   /// Applies to all sources except stream_with_non_joined_data.
                     stream = std::make_shared<ExpressionBlockInputStream>(stream, expressions.before_join);
             }
 
-            if (expressions.has_where)
-                executeWhere(pipeline, expressions.before_where, expressions.remove_where_filter);
-
-            if (expressions.need_aggregate)
-                executeAggregation(pipeline, expressions.before_aggregation, aggregate_overflow_row, aggregate_final);
-            else
+            /// If the result was obtained from part metadata, the pipeline already holds
+            ///  the finalized aggregation result, see tryAggregateFromMetadata.
+            if (!aggregated_from_metadata)
             {
-                executeExpression(pipeline, expressions.before_order_and_select);
-                executeDistinct(pipeline, true, expressions.selected_columns);
+                /// The expression stage that follows WHERE can be fused into the filter stream,
+                ///  so it is evaluated in the same pass and only for the rows that passed the filter.
+                ExpressionActionsPtr after_where_expression;
+                if (expressions.has_where && settings.fuse_filter_and_expression)
+                    after_where_expression = expressions.need_aggregate
+                        ? expressions.before_aggregation
+                        : expressions.before_order_and_select;
+
+                if (expressions.has_where)
+                    executeWhere(pipeline, expressions.before_where, expressions.remove_where_filter, after_where_expression);
+
+                if (expressions.need_aggregate)
+                    executeAggregation(pipeline, after_where_expression ? nullptr : expressions.before_aggregation,
+                        aggregate_overflow_row, aggregate_final);
+                else
+                {
+                    if (!after_where_expression)
+                        executeExpression(pipeline, expressions.before_order_and_select);
+                    executeDistinct(pipeline, true, expressions.selected_columns);
+                }
             }
 
             /** For distributed query processing,
@@ -627,6 +845,9 @@ void InterpreterSelectQuery::executeImpl(Pipeline & pipeline, const BlockInputSt
                     executeMergeSorted(pipeline);
                 else    /// Otherwise, just sort.
                     executeOrder(pipeline);
+
+                /// Synthesize rows for the gaps in the sorted result (ORDER BY ... WITH FILL).
+                executeFilling(pipeline);
             }
 
             /** Optimization - if there are several sources and there is LIMIT, then first apply the preliminary LIMIT,
@@ -690,6 +911,253 @@ static void getLimitLengthAndOffset(ASTSelectQuery & query, size_t & length, siz
 }
 
 
+bool InterpreterSelectQuery::tryAggregateFromMetadata(Pipeline & pipeline)
+{
+    const Settings & settings = context.getSettingsRef();
+
+    /// Reading quotas and limits cannot be accounted for data that is never read.
+    if (settings.max_rows_to_read || settings.max_bytes_to_read || settings.parallel_replicas_count > 1)
+        return false;
+
+    if (!query_analyzer->hasAggregation() || query_analyzer->hasGlobalSubqueries())
+        return false;
+
+    if (query.group_by_with_totals || query.group_by_with_rollup || query.group_by_with_cube
+        || query.final() || query.sample_size() || query.prewhere_expression
+        || query.array_join_expression_list() || query.join())
+        return false;
+
+    Names key_names;
+    AggregateDescriptions aggregates;
+    query_analyzer->getAggregateInfo(key_names, aggregates);
+
+    if (!key_names.empty() || aggregates.empty())
+        return false;
+
+    MergeTreeData * data = nullptr;
+    if (auto * merge_tree = dynamic_cast<StorageMergeTree *>(storage.get()))
+        data = &merge_tree->getData();
+    else if (auto * replicated_merge_tree = dynamic_cast<StorageReplicatedMergeTree *>(storage.get()))
+    {
+        /// Sequential consistency restricts a read of a replicated table to quorum-confirmed
+        ///  blocks and throws when the replica lags behind (see StorageReplicatedMergeTree::read).
+        ///  The metadata would be summed over all committed parts with no quorum check at all.
+        if (settings.select_sequential_consistency)
+            return false;
+
+        data = &replicated_merge_tree->getData();
+    }
+
+    if (!data)
+        return false;
+
+    /// Which part statistic answers each aggregate.
+    enum class Source
+    {
+        RowsCount,          /// count()
+        FirstIndexValue,    /// min of the first primary key column: parts are sorted, it is the first index entry.
+        MinMaxIdxLeft,      /// min of a column the partition minmax index tracks.
+        MinMaxIdxRight,     /// max of such a column.
+    };
+
+    Names primary_sort_columns = data->getPrimarySortColumns();
+
+    std::vector<Source> sources(aggregates.size());
+    std::vector<size_t> minmax_positions(aggregates.size(), 0);
+
+    for (size_t i = 0; i < aggregates.size(); ++i)
+    {
+        const AggregateDescription & aggregate = aggregates[i];
+        String name = aggregate.function->getName();
+
+        if (!aggregate.parameters.empty())
+            return false;
+
+        if (name == "count" && aggregate.argument_names.empty())
+        {
+            sources[i] = Source::RowsCount;
+            continue;
+        }
+
+        if ((name == "min" || name == "max") && aggregate.argument_names.size() == 1)
+        {
+            const String & argument = aggregate.argument_names[0];
+
+            const auto minmax_it = std::find(data->minmax_idx_columns.begin(), data->minmax_idx_columns.end(), argument);
+            if (minmax_it != data->minmax_idx_columns.end())
+            {
+                sources[i] = name == "min" ? Source::MinMaxIdxLeft : Source::MinMaxIdxRight;
+                minmax_positions[i] = minmax_it - data->minmax_idx_columns.begin();
+                continue;
+            }
+
+            if (name == "min" && !primary_sort_columns.empty() && argument == primary_sort_columns[0])
+            {
+                sources[i] = Source::FirstIndexValue;
+                continue;
+            }
+        }
+
+        return false;
+    }
+
+    /// A WHERE can still be applied: if it depends only on columns the partition minmax index tracks
+    ///  and those columns turn out constant inside every part, it keeps or drops parts as a whole.
+    ExpressionActionsPtr condition_actions;
+    String condition_column_name;
+    NamesAndTypesList condition_columns;
+
+    if (query.where_expression)
+    {
+        Names identifiers;
+        std::function<bool(const IAST &)> collect_identifiers = [&](const IAST & node)
+        {
+            if (typeid_cast<const ASTSubquery *>(&node) || typeid_cast<const ASTSelectQuery *>(&node))
+                return false;
+
+            if (const auto * identifier = typeid_cast<const ASTIdentifier *>(&node))
+            {
+                identifiers.push_back(identifier->name);
+                return true;
+            }
+
+            for (const auto & child : node.children)
+                if (!collect_identifiers(*child))
+                    return false;
+
+            return true;
+        };
+
+        if (!collect_identifiers(*query.where_expression) || identifiers.empty())
+            return false;
+
+        NameSet seen;
+        for (const String & identifier : identifiers)
+        {
+            const auto it = std::find(data->minmax_idx_columns.begin(), data->minmax_idx_columns.end(), identifier);
+            if (it == data->minmax_idx_columns.end())
+                return false;
+
+            if (seen.insert(identifier).second)
+                condition_columns.emplace_back(identifier, data->minmax_idx_column_types[it - data->minmax_idx_columns.begin()]);
+        }
+
+        ASTPtr condition = query.where_expression->clone();
+        auto syntax_result = SyntaxAnalyzer(context, {}).analyze(condition, condition_columns);
+        condition_actions = ExpressionAnalyzer(condition, syntax_result, context).getActions(false);
+        condition_column_name = condition->getColumnName();
+    }
+
+    MergeTreeData::DataPartsVector parts = data->getDataPartsVector();
+
+    UInt64 total_rows = 0;
+    std::vector<Field> values(aggregates.size());
+
+    for (const auto & part : parts)
+    {
+        /// The mask of deleted rows is applied while reading, so metadata row counts overstate.
+        if (part->hasDeletedMask())
+            return false;
+
+        if (condition_actions)
+        {
+            if (!part->minmax_idx.initialized)
+                return false;
+
+            Block block;
+            for (const auto & column : condition_columns)
+            {
+                size_t pos = std::find(data->minmax_idx_columns.begin(), data->minmax_idx_columns.end(), column.name)
+                    - data->minmax_idx_columns.begin();
+                const Range & range = part->minmax_idx.parallelogram[pos];
+
+                /// The condition decides for the whole part only if the column is constant inside it.
+                if (!range.left_included || !range.right_included || !(range.left == range.right))
+                    return false;
+
+                auto filled = column.type->createColumn();
+                filled->insert(range.left);
+                block.insert({std::move(filled), column.type, column.name});
+            }
+
+            condition_actions->execute(block);
+
+            Field pass = (*block.getByName(condition_column_name).column)[0];
+            if (pass.isNull() || !applyVisitor(FieldVisitorConvertToNumber<UInt64>(), pass))
+                continue;
+        }
+
+        if (part->rows_count == 0)
+            continue;
+
+        total_rows += part->rows_count;
+
+        for (size_t i = 0; i < aggregates.size(); ++i)
+        {
+            Field value;
+
+            switch (sources[i])
+            {
+                case Source::RowsCount:
+                    continue;
+
+                case Source::FirstIndexValue:
+                    if (part->index.empty() || part->index[0]->empty())
+                        return false;
+                    value = (*part->index[0])[0];
+                    break;
+
+                case Source::MinMaxIdxLeft:
+                case Source::MinMaxIdxRight:
+                {
+                    if (!part->minmax_idx.initialized)
+                        return false;
+
+                    const Range & range = part->minmax_idx.parallelogram[minmax_positions[i]];
+                    if (!range.left_included || !range.right_included)
+                        return false;
+
+                    value = sources[i] == Source::MinMaxIdxLeft ? range.left : range.right;
+                    break;
+                }
+            }
+
+            bool is_min = sources[i] != Source::MinMaxIdxRight;
+            if (values[i].isNull()
+                || (is_min
+                    ? applyVisitor(FieldVisitorAccurateLess(), value, values[i])
+                    : applyVisitor(FieldVisitorAccurateLess(), values[i], value)))
+                values[i] = value;
+        }
+    }
+
+    /// The result for zero rows depends on settings (empty_result_for_aggregation_by_empty_set),
+    ///  let the ordinary pipeline handle that case.
+    if (total_rows == 0)
+        return false;
+
+    /// The same block that would leave the aggregation stage with finalized states.
+    Block block;
+    for (size_t i = 0; i < aggregates.size(); ++i)
+    {
+        DataTypePtr type = aggregates[i].function->getReturnType();
+        auto column = type->createColumn();
+
+        if (sources[i] == Source::RowsCount)
+            column->insert(total_rows);
+        else
+            column->insert(values[i]);
+
+        block.insert({std::move(column), type, aggregates[i].column_name});
+    }
+
+    LOG_DEBUG(log, "Aggregation result obtained from part metadata, " << parts.size() << " parts, " << total_rows << " rows");
+
+    pipeline.streams.emplace_back(std::make_shared<OneBlockInputStream>(block));
+    return true;
+}
+
+
 void InterpreterSelectQuery::executeFetchColumns(
         QueryProcessingStage::Enum processing_stage, Pipeline & pipeline,
         const PrewhereInfoPtr & prewhere_info, const Names & columns_to_remove_after_prewhere)
@@ -919,6 +1387,8 @@ void InterpreterSelectQuery::executeFetchColumns(
         query_info.syntax_analyzer_result = syntax_analyzer_result;
         query_info.sets = query_analyzer->getPreparedSets();
         query_info.prewhere_info = prewhere_info;
+        query_info.read_in_order_direction = aggregate_in_order ? 1 : read_in_order_direction;
+        query_info.aggregate_by_partitions = aggregate_partition_wise;
 
         pipeline.streams = storage->read(required_columns, query_info, context, processing_stage, max_block_size, max_streams);
 
@@ -987,21 +1457,44 @@ void InterpreterSelectQuery::executeFetchColumns(
 }
 
 
-void InterpreterSelectQuery::executeWhere(Pipeline & pipeline, const ExpressionActionsPtr & expression, bool remove_fiter)
+void InterpreterSelectQuery::executeWhere(Pipeline & pipeline, const ExpressionActionsPtr & expression, bool remove_fiter,
+    const ExpressionActionsPtr & post_expression)
 {
     pipeline.transform([&](auto & stream)
     {
-        stream = std::make_shared<FilterBlockInputStream>(stream, expression, query.where_expression->getColumnName(), remove_fiter);
+        stream = std::make_shared<FilterBlockInputStream>(stream, expression, query.where_expression->getColumnName(), remove_fiter, post_expression);
     });
 }
 
 
 void InterpreterSelectQuery::executeAggregation(Pipeline & pipeline, const ExpressionActionsPtr & expression, bool overflow_row, bool final)
 {
-    pipeline.transform([&](auto & stream)
+    /// The expression may have been fused into the preceding filter stream.
+    if (expression)
     {
-        stream = std::make_shared<ExpressionBlockInputStream>(stream, expression);
-    });
+        pipeline.transform([&](auto & stream)
+        {
+            stream = std::make_shared<ExpressionBlockInputStream>(stream, expression);
+        });
+    }
+
+    /// Re-encode LowCardinality columns so that consecutive blocks share one dictionary object:
+    ///  the aggregator caches per-dictionary state, but only for shared dictionaries.
+    if (context.getSettingsRef().low_cardinality_share_dictionaries)
+    {
+        bool has_low_cardinality = false;
+        for (const auto & elem : pipeline.firstStream()->getHeader())
+            has_low_cardinality |= elem.type->lowCardinality();
+
+        if (has_low_cardinality)
+        {
+            pipeline.transform([&](auto & stream)
+            {
+                stream = std::make_shared<ShareLowCardinalityDictionariesBlockInputStream>(
+                    stream, context.getSettingsRef().low_cardinality_max_dictionary_size);
+            });
+        }
+    }
 
     Names key_names;
     AggregateDescriptions aggregates;
@@ -1018,23 +1511,108 @@ void InterpreterSelectQuery::executeAggregation(Pipeline & pipeline, const Expre
 
     const Settings & settings = context.getSettingsRef();
 
+    if (aggregate_in_order)
+    {
+        /// The streams are per-part reads in sorting key order; merge them, so that equal keys
+        ///  are contiguous, and aggregate without a hash table, one group at a time.
+        if (pipeline.streams.size() > 1)
+        {
+            pipeline.firstStream() = std::make_shared<MergingSortedBlockInputStream>(
+                pipeline.streams, aggregate_in_order_descr, settings.max_block_size);
+            pipeline.streams.resize(1);
+        }
+
+        pipeline.firstStream() = std::make_shared<AggregatingInOrderBlockInputStream>(
+            pipeline.firstStream(), key_names, aggregates, settings.max_block_size);
+        return;
+    }
+
     /** Two-level aggregation is useful in two cases:
       * 1. Parallel aggregation is done, and the results should be merged in parallel.
       * 2. An aggregation is done with store of temporary data on the disk, and they need to be merged in a memory efficient way.
       */
-    bool allow_to_use_two_level_group_by = pipeline.streams.size() > 1 || settings.max_bytes_before_external_group_by != 0;
+    bool allow_to_use_two_level_group_by = pipeline.streams.size() > 1
+        || settings.max_bytes_before_external_group_by != 0
+        || settings.max_bytes_ratio_before_external_group_by != 0;
 
     Aggregator::Params params(header, keys, aggregates,
         overflow_row, settings.max_rows_to_group_by, settings.group_by_overflow_mode,
         settings.compile ? &context.getCompiler() : nullptr, settings.min_count_to_compile,
+        settings.compile_aggregate_functions,
         allow_to_use_two_level_group_by ? settings.group_by_two_level_threshold : SettingUInt64(0),
         allow_to_use_two_level_group_by ? settings.group_by_two_level_threshold_bytes : SettingUInt64(0),
-        settings.max_bytes_before_external_group_by, settings.empty_result_for_aggregation_by_empty_set,
+        settings.max_bytes_before_external_group_by, settings.max_bytes_ratio_before_external_group_by,
+        settings.empty_result_for_aggregation_by_empty_set,
         context.getTemporaryPath(), settings.max_threads);
 
+    /// Each stream carries whole partitions whose groups are disjoint from those of the other
+    ///  streams (see aggregate_by_partitions): aggregate every stream independently and just
+    ///  concatenate the results, skipping the merge phase entirely.
+    if (aggregate_partition_wise)
+    {
+        pipeline.transform([&](auto & stream)
+        {
+            stream = std::make_shared<AggregatingBlockInputStream>(stream, params, final);
+        });
+        return;
+    }
+
     /// If there are several sources, then we perform parallel aggregation
     if (pipeline.streams.size() > 1)
     {
+        if (settings.partial_aggregation_in_source_streams)
+        {
+            /** Every source stream gets its own partial aggregator that flushes intermediate states downstream
+              *  when they exceed the budget, and the partial results are merged as in distributed aggregation.
+              * Blocks are collapsed inside the reading threads, before passing between threads,
+              *  and the peak memory of the aggregation stage is bounded by the flush budget per stream.
+              */
+            /// Unlike `params`, never spills to disk: the memory of a stream is bounded by flushing downstream.
+            /// Two-level aggregation is always allowed, so that the merge can be parallelized by buckets.
+            Aggregator::Params partial_params(header, keys, aggregates,
+                overflow_row, settings.max_rows_to_group_by, settings.group_by_overflow_mode,
+                settings.compile ? &context.getCompiler() : nullptr, settings.min_count_to_compile,
+                settings.compile_aggregate_functions,
+                settings.group_by_two_level_threshold, settings.group_by_two_level_threshold_bytes,
+                0, 0.0,
+                settings.empty_result_for_aggregation_by_empty_set,
+                context.getTemporaryPath(), settings.max_threads);
+
+            pipeline.transform([&](auto & stream)
+            {
+                stream = std::make_shared<PartialAggregatingBlockInputStream>(
+                    stream, partial_params, settings.partial_aggregation_flush_threshold_bytes);
+            });
+
+            if (pipeline.stream_with_non_joined_data)
+            {
+                pipeline.streams.push_back(pipeline.stream_with_non_joined_data);
+                pipeline.stream_with_non_joined_data = nullptr;
+            }
+
+            Block intermediate_header = pipeline.firstStream()->getHeader();
+            ColumnNumbers merge_keys;
+            for (const auto & name : key_names)
+                merge_keys.push_back(intermediate_header.getPositionByName(name));
+
+            Aggregator::Params merge_params(intermediate_header, merge_keys, aggregates, overflow_row, settings.max_threads);
+
+            pipeline.firstStream() = std::make_shared<MergingAggregatedMemoryEfficientBlockInputStream>(
+                pipeline.streams, merge_params, final,
+                max_streams,
+                settings.aggregation_memory_efficient_merge_threads
+                    ? static_cast<size_t>(settings.aggregation_memory_efficient_merge_threads)
+                    : static_cast<size_t>(settings.max_threads));
+
+            pipeline.streams.resize(1);
+
+            if (settings.aggregation_preferred_block_size_bytes)
+                pipeline.firstStream() = std::make_shared<SplittingBlockInputStream>(
+                    pipeline.firstStream(), settings.aggregation_preferred_block_size_bytes);
+
+            return;
+        }
+
         pipeline.firstStream() = std::make_shared<ParallelAggregatingBlockInputStream>(
             pipeline.streams, pipeline.stream_with_non_joined_data, params, final,
             max_streams,
@@ -1056,10 +1634,20 @@ void InterpreterSelectQuery::executeAggregation(Pipeline & pipeline, const Expre
         if (pipeline.stream_with_non_joined_data)
             inputs.push_back(pipeline.stream_with_non_joined_data);
 
-        pipeline.firstStream() = std::make_shared<AggregatingBlockInputStream>(std::make_shared<ConcatBlockInputStream>(inputs), params, final);
+        pipeline.firstStream() = std::make_shared<AggregatingBlockInputStream>(
+            std::make_shared<ConcatBlockInputStream>(inputs), params, final,
+            settings.aggregation_memory_efficient_merge_threads
+                ? static_cast<size_t>(settings.aggregation_memory_efficient_merge_threads)
+                : static_cast<size_t>(settings.max_threads));
 
         pipeline.stream_with_non_joined_data = nullptr;
     }
+
+    /// The aggregator forms blocks by hash table layout (one block per bucket for two-level
+    ///  aggregation), so for wide rows they can be arbitrarily large; re-chunk to the byte budget.
+    if (settings.aggregation_preferred_block_size_bytes)
+        pipeline.firstStream() = std::make_shared<SplittingBlockInputStream>(
+            pipeline.firstStream(), settings.aggregation_preferred_block_size_bytes);
 }
 
 
@@ -1112,6 +1700,10 @@ void InterpreterSelectQuery::executeMergeAggregated(Pipeline & pipeline, bool ov
 
         pipeline.streams.resize(1);
     }
+
+    if (settings.aggregation_preferred_block_size_bytes)
+        pipeline.firstStream() = std::make_shared<SplittingBlockInputStream>(
+            pipeline.firstStream(), settings.aggregation_preferred_block_size_bytes);
 }
 
 
@@ -1155,8 +1747,10 @@ void InterpreterSelectQuery::executeRollupOrCube(Pipeline & pipeline, Modificato
     Aggregator::Params params(header, keys, aggregates,
         false, settings.max_rows_to_group_by, settings.group_by_overflow_mode,
         settings.compile ? &context.getCompiler() : nullptr, settings.min_count_to_compile,
+        settings.compile_aggregate_functions,
         SettingUInt64(0), SettingUInt64(0),
-        settings.max_bytes_before_external_group_by, settings.empty_result_for_aggregation_by_empty_set,
+        settings.max_bytes_before_external_group_by, settings.max_bytes_ratio_before_external_group_by,
+        settings.empty_result_for_aggregation_by_empty_set,
         context.getTemporaryPath(), settings.max_threads);
 
     if (modificator == Modificator::ROLLUP)
@@ -1217,9 +1811,43 @@ void InterpreterSelectQuery::executeOrder(Pipeline & pipeline)
 
     const Settings & settings = context.getSettingsRef();
 
+    if (read_in_order_direction)
+    {
+        /// The streams are already sorted by the key prefix of ORDER BY (see executeFetchColumns),
+        /// it only remains to merge them, and, if ORDER BY has a tail beyond the prefix, to sort
+        /// the rows within the ranges of equal prefix values.
+        bool need_finish_sorting = read_in_order_prefix.size() < order_descr.size();
+
+        if (pipeline.hasMoreThanOneStream())
+        {
+            unifyStreams(pipeline);
+
+            /// MergingSortedBlockInputStream reads the sources sequentially, so let the per-part
+            /// streams prefetch in parallel.
+            pipeline.transform([&](auto & stream)
+            {
+                stream = std::make_shared<AsynchronousBlockInputStream>(stream);
+            });
+
+            pipeline.firstStream() = std::make_shared<MergingSortedBlockInputStream>(
+                pipeline.streams, read_in_order_prefix, settings.max_block_size, need_finish_sorting ? 0 : limit);
+            pipeline.streams.resize(1);
+        }
+
+        if (need_finish_sorting)
+            pipeline.firstStream() = std::make_shared<FinishSortingBlockInputStream>(
+                pipeline.firstStream(), read_in_order_prefix, order_descr, settings.max_block_size, limit);
+
+        return;
+    }
+
+    /// All sorting streams of the query share one top-K cutoff, so that rows beyond the current
+    ///  limit-th best key are discarded as early as possible in any of them.
+    SortingCutoffPtr cutoff = limit ? std::make_shared<SortingCutoff>() : nullptr;
+
     pipeline.transform([&](auto & stream)
     {
-        auto sorting_stream = std::make_shared<PartialSortingBlockInputStream>(stream, order_descr, limit);
+        auto sorting_stream = std::make_shared<PartialSortingBlockInputStream>(stream, order_descr, limit, cutoff);
 
         /// Limits on sorting
         IProfilingBlockInputStream::LocalLimits limits;
@@ -1237,7 +1865,43 @@ void InterpreterSelectQuery::executeOrder(Pipeline & pipeline)
     pipeline.firstStream() = std::make_shared<MergeSortingBlockInputStream>(
         pipeline.firstStream(), order_descr, settings.max_block_size, limit,
         settings.max_bytes_before_remerge_sort,
-        settings.max_bytes_before_external_sort, context.getTemporaryPath());
+        settings.max_bytes_before_external_sort, context.getTemporaryPath(), cutoff);
+}
+
+
+void InterpreterSelectQuery::executeFilling(Pipeline & pipeline)
+{
+    FillColumnDescriptions fill_description;
+
+    for (const auto & elem : query.order_expression_list->children)
+    {
+        const ASTOrderByElement & order_by_elem = typeid_cast<const ASTOrderByElement &>(*elem);
+        if (!order_by_elem.with_fill)
+            continue;
+
+        FillColumnDescription desc;
+        desc.column_name = elem->children.front()->getColumnName();
+        desc.direction = order_by_elem.direction;
+
+        if (order_by_elem.fill_from)
+            desc.fill_from = evaluateConstantExpression(order_by_elem.fill_from, context).first;
+        if (order_by_elem.fill_to)
+            desc.fill_to = evaluateConstantExpression(order_by_elem.fill_to, context).first;
+        if (order_by_elem.fill_step)
+            desc.fill_step = evaluateConstantExpression(order_by_elem.fill_step, context).first;
+        else
+            desc.fill_step = Int64(order_by_elem.direction);
+
+        fill_description.push_back(std::move(desc));
+    }
+
+    if (fill_description.empty())
+        return;
+
+    /// Filling needs the whole sorted result as one stream.
+    executeUnion(pipeline);
+
+    pipeline.firstStream() = std::make_shared<FillingBlockInputStream>(pipeline.firstStream(), fill_description);
 }
 
 
@@ -1296,7 +1960,8 @@ void InterpreterSelectQuery::executeDistinct(Pipeline & pipeline, bool before_or
         pipeline.transform([&](auto & stream)
         {
             SizeLimits limits(settings.max_rows_in_distinct, settings.max_bytes_in_distinct, settings.distinct_overflow_mode);
-            stream = std::make_shared<DistinctBlockInputStream>(stream, limits, limit_for_distinct, columns);
+            stream = std::make_shared<DistinctBlockInputStream>(stream, limits, limit_for_distinct, columns,
+                settings.max_bytes_before_external_distinct, context.getTemporaryPath());
         });
     }
 }
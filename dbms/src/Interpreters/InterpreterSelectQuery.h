@@ -7,6 +7,7 @@
 #include <Interpreters/IInterpreter.h>
 #include <Interpreters/ExpressionAnalyzer.h>
 #include <Interpreters/ExpressionActions.h>
+#include <Core/SortDescription.h>
 #include <DataStreams/IBlockInputStream.h>
 #include <Storages/SelectQueryInfo.h>
 
@@ -179,7 +180,14 @@ private:
     void executeFetchColumns(QueryProcessingStage::Enum processing_stage, Pipeline & pipeline,
                              const PrewhereInfoPtr & prewhere_info, const Names & columns_to_remove_after_prewhere);
 
-    void executeWhere(Pipeline & pipeline, const ExpressionActionsPtr & expression, bool remove_filter);
+    /** Try to answer an aggregation query like SELECT count() FROM table from MergeTree part metadata,
+      *  without reading any data. On success puts a stream with the finalized aggregation result
+      *  into the pipeline and returns true; reading and the aggregation stages must then be skipped.
+      */
+    bool tryAggregateFromMetadata(Pipeline & pipeline);
+
+    void executeWhere(Pipeline & pipeline, const ExpressionActionsPtr & expression, bool remove_filter,
+        const ExpressionActionsPtr & post_expression = nullptr);
     void executeAggregation(Pipeline & pipeline, const ExpressionActionsPtr & expression, bool overflow_row, bool final);
     void executeMergeAggregated(Pipeline & pipeline, bool overflow_row, bool final);
     void executeTotalsAndHaving(Pipeline & pipeline, bool has_having, const ExpressionActionsPtr & expression, bool overflow_row, bool final);
@@ -187,6 +195,7 @@ private:
     void executeExpression(Pipeline & pipeline, const ExpressionActionsPtr & expression);
     void executeOrder(Pipeline & pipeline);
     void executeMergeSorted(Pipeline & pipeline);
+    void executeFilling(Pipeline & pipeline);
     void executePreLimit(Pipeline & pipeline);
     void executeUnion(Pipeline & pipeline);
     void executeLimitBy(Pipeline & pipeline);
@@ -244,6 +253,23 @@ private:
     StoragePtr storage;
     TableStructureReadLockPtr table_lock;
 
+    /// If not 0, ORDER BY is a prefix of the table sorting key: the storage returns per-part
+    /// streams in (reverse) key order and executeOrder merges them instead of sorting.
+    /// read_in_order_prefix is the part of the ORDER BY description by which the streams are sorted.
+    int read_in_order_direction = 0;
+    SortDescription read_in_order_prefix;
+
+    /// The GROUP BY keys cover a prefix of the table sorting key: the storage returns per-part
+    /// streams in key order, and executeAggregation merges them by aggregate_in_order_descr and
+    /// aggregates one group at a time instead of hashing (see optimize_aggregation_in_order).
+    bool aggregate_in_order = false;
+    SortDescription aggregate_in_order_descr;
+
+    /// The GROUP BY keys determine the partition: the storage returns one stream per partition
+    /// and executeAggregation aggregates every stream independently, with no merge phase
+    /// (see optimize_partition_wise_aggregation).
+    bool aggregate_partition_wise = false;
+
     /// Used when we read from prepared input, not table or subquery.
     BlockInputStreamPtr input;
 
@@ -4,7 +4,7 @@
 #include <Common/config.h>
 #include <Common/typeid_cast.h>
 #include <Common/getNumberOfPhysicalCPUCores.h>
-#include <common/ThreadPool.h>
+#include <Common/ThreadPool.h>
 #include <Interpreters/Context.h>
 #include <Interpreters/ExternalDictionaries.h>
 #include <Interpreters/EmbeddedDictionaries.h>
@@ -14,6 +14,7 @@
 #include <Interpreters/QueryLog.h>
 #include <Interpreters/PartLog.h>
 #include <Interpreters/QueryThreadLog.h>
+#include <Interpreters/TraceLog.h>
 #include <Databases/IDatabase.h>
 #include <Storages/StorageReplicatedMergeTree.h>
 #include <Storages/StorageFactory.h>
@@ -149,6 +150,9 @@ BlockIO InterpreterSystemQuery::execute()
         case Type::DROP_UNCOMPRESSED_CACHE:
             system_context.dropUncompressedCache();
             break;
+        case Type::DROP_COMPRESSED_BLOCK_CACHE:
+            system_context.dropCompressedBlockCache();
+            break;
 #if USE_EMBEDDED_COMPILER
         case Type::DROP_COMPILED_EXPRESSION_CACHE:
             system_context.dropCompiledExpressionCache();
@@ -208,7 +212,8 @@ BlockIO InterpreterSystemQuery::execute()
             executeCommandsAndThrowIfError(
                     [&] () { if (auto query_log = context.getQueryLog(false)) query_log->flush(); },
                     [&] () { if (auto part_log = context.getPartLog("", false)) part_log->flush(); },
-                    [&] () { if (auto query_thread_log = context.getQueryThreadLog(false)) query_thread_log->flush(); }
+                    [&] () { if (auto query_thread_log = context.getQueryThreadLog(false)) query_thread_log->flush(); },
+                    [&] () { if (auto trace_log = context.getTraceLog(false)) trace_log->flush(); }
             );
             break;
         case Type::STOP_LISTEN_QUERIES:
@@ -4,18 +4,42 @@
 #include <Columns/ColumnString.h>
 #include <Columns/ColumnFixedString.h>
 #include <Columns/ColumnNullable.h>
+#include <Columns/ColumnsCommon.h>
+
+#include <Dictionaries/HashedDictionary.h>
 
 #include <DataTypes/DataTypeNullable.h>
 
 #include <Interpreters/Join.h>
 #include <Interpreters/NullableUtils.h>
 
+#include <Interpreters/sortBlock.h>
+
 #include <DataStreams/IProfilingBlockInputStream.h>
 #include <DataStreams/materializeBlock.h>
+#include <DataStreams/BlocksListBlockInputStream.h>
+#include <DataStreams/MergeSortingBlockInputStream.h>
+#include <DataStreams/NativeBlockInputStream.h>
+#include <DataStreams/NativeBlockOutputStream.h>
+
+#include <IO/WriteBufferFromFile.h>
+#include <IO/CompressedWriteBuffer.h>
+#include <IO/ReadBufferFromFile.h>
+#include <IO/CompressedReadBuffer.h>
+
+#include <Poco/File.h>
+#include <Poco/TemporaryFile.h>
+
+#include <algorithm>
+#include <list>
+#include <map>
 
 #include <Core/ColumnNumbers.h>
+#include <Core/Defines.h>
 #include <Common/typeid_cast.h>
 
+#include <ext/bit_cast.h>
+
 
 namespace DB
 {
@@ -27,22 +51,146 @@ namespace ErrorCodes
     extern const int SET_SIZE_LIMIT_EXCEEDED;
     extern const int TYPE_MISMATCH;
     extern const int ILLEGAL_COLUMN;
+    extern const int NOT_IMPLEMENTED;
+    extern const int BAD_ARGUMENTS;
 }
 
 
+/// A Bloom filter over 64-bit hashes of the keys of the right table.
+/// Bits are set with relaxed atomics, because in the partitioned mode several threads build the join in parallel.
+struct Join::RuntimeFilter
+{
+    std::unique_ptr<std::atomic<UInt64>[]> words;
+    size_t bit_mask = 0;
+
+    explicit RuntimeFilter(size_t size_bytes)
+    {
+        size_t num_words = 1;
+        while (num_words * sizeof(UInt64) < std::max(size_bytes, 2 * sizeof(UInt64)))
+            num_words *= 2;
+
+        words.reset(new std::atomic<UInt64>[num_words]);
+        for (size_t i = 0; i < num_words; ++i)
+            words[i].store(0, std::memory_order_relaxed);
+
+        bit_mask = num_words * 64 - 1;
+    }
+
+    /// Two probes, derived from the halves of the hash.
+    void add(UInt64 hash)
+    {
+        size_t bit1 = hash & bit_mask;
+        size_t bit2 = (hash >> 32 | hash << 32) & bit_mask;
+        words[bit1 / 64].fetch_or(1ULL << (bit1 % 64), std::memory_order_relaxed);
+        words[bit2 / 64].fetch_or(1ULL << (bit2 % 64), std::memory_order_relaxed);
+    }
+
+    bool mightContain(UInt64 hash) const
+    {
+        size_t bit1 = hash & bit_mask;
+        size_t bit2 = (hash >> 32 | hash << 32) & bit_mask;
+        return (words[bit1 / 64].load(std::memory_order_relaxed) & (1ULL << (bit1 % 64)))
+            && (words[bit2 / 64].load(std::memory_order_relaxed) & (1ULL << (bit2 % 64)));
+    }
+};
+
+
+/// Partitions of the right table on disk and the cache of in-memory joins built from them.
+struct Join::GraceState
+{
+    struct Bucket
+    {
+        std::unique_ptr<Poco::TemporaryFile> file;
+        std::unique_ptr<WriteBufferFromFile> file_buf;
+        std::unique_ptr<CompressedWriteBuffer> compressed_buf;
+        std::unique_ptr<NativeBlockOutputStream> block_out;
+        size_t rows = 0;
+    };
+
+    std::vector<Bucket> buckets;
+    size_t bucket_mask = 0;
+
+    /// The sample of the right table, to initialize the per-bucket joins.
+    Block sample_block;
+    /// Structure of the spilled blocks.
+    Block spilled_header;
+
+    /// Cache of in-memory joins for the buckets. Protected by the mutex, because probing may go in parallel.
+    mutable std::mutex mutex;
+    std::map<size_t, JoinPtr> loaded;
+    std::list<size_t> lru;    /// Bucket numbers, most recently used first.
+    size_t loaded_bytes = 0;
+};
+
+
 Join::Join(const Names & key_names_left_, const Names & key_names_right_, const NameSet & needed_key_names_right_,
-    bool use_nulls_, const SizeLimits & limits, ASTTableJoin::Kind kind_, ASTTableJoin::Strictness strictness_)
+    bool use_nulls_, const SizeLimits & limits, ASTTableJoin::Kind kind_, ASTTableJoin::Strictness strictness_,
+    size_t shards_, Algorithm algorithm_, size_t max_bytes_before_external_sort_, const String & tmp_path_,
+    size_t grace_buckets_, size_t runtime_filter_bytes_)
     : kind(kind_), strictness(strictness_),
     key_names_left(key_names_left_),
     key_names_right(key_names_right_),
     needed_key_names_right(needed_key_names_right_),
     use_nulls(use_nulls_),
+    algorithm(algorithm_),
+    sort_merge(algorithm_ == Algorithm::SORT_MERGE),
+    max_bytes_before_external_sort(max_bytes_before_external_sort_),
+    tmp_path(tmp_path_),
     log(&Logger::get("Join")),
     limits(limits)
 {
+    build_concurrency = std::max<size_t>(1, shards_);
+
+    /// Round the number of shards up to a power of two, so that the shard of a key is selected by a bit mask of the hash.
+    /// Twice as many shards as build threads, to reduce collisions of threads on the shard mutexes.
+    shards = 1;
+    while (shards < 2 * build_concurrency && build_concurrency > 1)
+        shards *= 2;
+    shard_mask = shards - 1;
+
+    if (strictness == ASTTableJoin::Strictness::Asof)
+    {
+        if (kind != ASTTableJoin::Kind::Left && kind != ASTTableJoin::Kind::Inner)
+            throw Exception("ASOF JOIN is only implemented for LEFT and INNER joins", ErrorCodes::NOT_IMPLEMENTED);
+        if (algorithm != Algorithm::HASH)
+            throw Exception("ASOF JOIN is only implemented for the hash algorithm", ErrorCodes::NOT_IMPLEMENTED);
+        if (key_names_right.size() < 2)
+            throw Exception("ASOF JOIN requires at least one equality column besides the ASOF column", ErrorCodes::BAD_ARGUMENTS);
+    }
+
+    maps_any.resize(shards);
+    maps_all.resize(shards);
+    maps_any_full.resize(shards);
+    maps_all_full.resize(shards);
+    maps_asof.resize(shards);
+
+    pools.reserve(shards);
+    for (size_t i = 0; i < shards; ++i)
+        pools.emplace_back(std::make_unique<Arena>());
+
+    shard_mutexes = std::make_unique<std::mutex[]>(shards);
+
+    if (algorithm == Algorithm::GRACE_HASH)
+    {
+        grace = std::make_unique<GraceState>();
+
+        /// Round the number of buckets up to a power of two, so that the bucket of a key is selected by a bit mask of the hash.
+        size_t num_buckets = 1;
+        while (num_buckets < std::max<size_t>(1, grace_buckets_))
+            num_buckets *= 2;
+
+        grace->buckets.resize(num_buckets);
+        grace->bucket_mask = num_buckets - 1;
+    }
+
+    if (runtime_filter_bytes_)
+        runtime_filter = std::make_unique<RuntimeFilter>(runtime_filter_bytes_);
 }
 
 
+Join::~Join() = default;
+
+
 Join::Type Join::chooseMethod(const ColumnRawPtrs & key_columns, Sizes & key_sizes)
 {
     size_t keys_size = key_columns.size();
@@ -184,19 +332,24 @@ void Join::init(Type type_)
     if (kind == ASTTableJoin::Kind::Cross)
         return;
 
-    if (!getFullness(kind))
+    for (size_t i = 0; i < shards; ++i)
     {
-        if (strictness == ASTTableJoin::Strictness::Any)
-            initImpl(maps_any, type);
-        else
-            initImpl(maps_all, type);
-    }
-    else
-    {
-        if (strictness == ASTTableJoin::Strictness::Any)
-            initImpl(maps_any_full, type);
+        if (!getFullness(kind))
+        {
+            if (strictness == ASTTableJoin::Strictness::Any)
+                initImpl(maps_any[i], type);
+            else if (strictness == ASTTableJoin::Strictness::Asof)
+                initImpl(maps_asof[i], type);
+            else
+                initImpl(maps_all[i], type);
+        }
         else
-            initImpl(maps_all_full, type);
+        {
+            if (strictness == ASTTableJoin::Strictness::Any)
+                initImpl(maps_any_full[i], type);
+            else
+                initImpl(maps_all_full[i], type);
+        }
     }
 }
 
@@ -204,17 +357,28 @@ size_t Join::getTotalRowCount() const
 {
     size_t res = 0;
 
-    if (type == Type::CROSS)
+    if (grace)
+    {
+        for (const auto & bucket : grace->buckets)
+            res += bucket.rows;
+        return res;
+    }
+
+    if (type == Type::CROSS || sort_merge)
     {
         for (const auto & block : blocks)
             res += block.rows();
     }
     else
     {
-        res += getTotalRowCountImpl(maps_any, type);
-        res += getTotalRowCountImpl(maps_all, type);
-        res += getTotalRowCountImpl(maps_any_full, type);
-        res += getTotalRowCountImpl(maps_all_full, type);
+        for (size_t i = 0; i < shards; ++i)
+        {
+            res += getTotalRowCountImpl(maps_any[i], type);
+            res += getTotalRowCountImpl(maps_all[i], type);
+            res += getTotalRowCountImpl(maps_any_full[i], type);
+            res += getTotalRowCountImpl(maps_all_full[i], type);
+            res += getTotalRowCountImpl(maps_asof[i], type);
+        }
     }
 
     return res;
@@ -222,26 +386,89 @@ size_t Join::getTotalRowCount() const
 
 size_t Join::getTotalByteCount() const
 {
+    /// The data lives on disk; only the cache of per-bucket joins takes memory.
+    if (grace)
+    {
+        std::lock_guard lock(grace->mutex);
+        return grace->loaded_bytes;
+    }
+
     size_t res = 0;
 
-    if (type == Type::CROSS)
+    if (type == Type::CROSS || sort_merge)
     {
         for (const auto & block : blocks)
             res += block.bytes();
     }
     else
     {
-        res += getTotalByteCountImpl(maps_any, type);
-        res += getTotalByteCountImpl(maps_all, type);
-        res += getTotalByteCountImpl(maps_any_full, type);
-        res += getTotalByteCountImpl(maps_all_full, type);
-        res += pool.size();
+        for (size_t i = 0; i < shards; ++i)
+        {
+            res += getTotalByteCountImpl(maps_any[i], type);
+            res += getTotalByteCountImpl(maps_all[i], type);
+            res += getTotalByteCountImpl(maps_any_full[i], type);
+            res += getTotalByteCountImpl(maps_all_full[i], type);
+            res += getTotalByteCountImpl(maps_asof[i], type);
+            res += pools[i]->size();
+        }
     }
 
     return res;
 }
 
 
+/// Map a value of the ASOF column to UInt64, preserving the order of the values of the original type.
+template <typename T>
+static UInt64 asofValueToUInt64(T value)
+{
+    if constexpr (std::is_floating_point_v<T>)
+    {
+        /// The standard trick for IEEE floats: flip all bits of negative numbers and the sign bit of the others.
+        UInt64 bits = ext::bit_cast<UInt64>(Float64(value));
+        return (bits & (1ULL << 63)) ? ~bits : bits | (1ULL << 63);
+    }
+    else if constexpr (std::is_signed_v<T>)
+        return UInt64(Int64(value)) ^ (1ULL << 63);
+    else
+        return UInt64(value);
+}
+
+template <typename T>
+static bool tryFillAsofValues(const IColumn & column, std::vector<UInt64> & values)
+{
+    const auto * concrete = typeid_cast<const ColumnVector<T> *>(&column);
+    if (!concrete)
+        return false;
+
+    const auto & data = concrete->getData();
+    size_t rows = data.size();
+    values.resize(rows);
+    for (size_t i = 0; i < rows; ++i)
+        values[i] = asofValueToUInt64(data[i]);
+
+    return true;
+}
+
+/// Extract the values of the ASOF column as order-preserving UInt64. Throws for unsupported column types.
+static void fillAsofValues(const IColumn & column, const String & column_name, std::vector<UInt64> & values)
+{
+    if (tryFillAsofValues<UInt8>(column, values)
+        || tryFillAsofValues<UInt16>(column, values)
+        || tryFillAsofValues<UInt32>(column, values)
+        || tryFillAsofValues<UInt64>(column, values)
+        || tryFillAsofValues<Int8>(column, values)
+        || tryFillAsofValues<Int16>(column, values)
+        || tryFillAsofValues<Int32>(column, values)
+        || tryFillAsofValues<Int64>(column, values)
+        || tryFillAsofValues<Float32>(column, values)
+        || tryFillAsofValues<Float64>(column, values))
+        return;
+
+    throw Exception("ASOF JOIN is not implemented for column " + column_name
+        + ": only numbers, Date and DateTime are supported as the ASOF column", ErrorCodes::NOT_IMPLEMENTED);
+}
+
+
 static void convertColumnToNullable(ColumnWithTypeAndName & column)
 {
     column.type = makeNullable(column.type);
@@ -257,6 +484,10 @@ void Join::setSampleBlock(const Block & block)
     if (!empty())
         return;
 
+    /// The per-bucket joins of the grace hash mode will be initialized with the same sample.
+    if (grace)
+        grace->sample_block = block;
+
     size_t keys_size = key_names_right.size();
     ColumnRawPtrs key_columns(keys_size);
 
@@ -269,6 +500,15 @@ void Join::setSampleBlock(const Block & block)
             key_columns[i] = &static_cast<const ColumnNullable &>(*key_columns[i]).getNestedColumn();
     }
 
+    /// For ASOF JOIN the last key is the ASOF column: rows are hashed by the equality keys only,
+    ///  and the matching row within a bucket is found by the value of the ASOF column.
+    if (strictness == ASTTableJoin::Strictness::Asof)
+    {
+        std::vector<UInt64> values;
+        fillAsofValues(*key_columns.back(), key_names_right.back(), values);    /// Check that the type is supported.
+        key_columns.pop_back();
+    }
+
     /// Choose data structure to use for JOIN.
     init(chooseMethod(key_columns, key_sizes));
 
@@ -282,7 +522,14 @@ void Join::setSampleBlock(const Block & block)
         if (key_names_right.end() != std::find(key_names_right.begin(), key_names_right.end(), name))
         {
             sample_block_with_keys.insert(sample_block_with_columns_to_add.getByPosition(pos));
-            sample_block_with_columns_to_add.erase(pos);
+
+            /// The ASOF column is returned with the joined rows like any other column of the right table
+            ///  (its values come from the matched rows, not from the left keys), so it also stays
+            ///  among the columns to add; only the copy above participates in the type check of the keys.
+            if (strictness == ASTTableJoin::Strictness::Asof && name == key_names_right.back())
+                ++pos;
+            else
+                sample_block_with_columns_to_add.erase(pos);
         }
         else
             ++pos;
@@ -304,6 +551,20 @@ void Join::setSampleBlock(const Block & block)
 }
 
 
+void Join::setDictionary(const std::shared_ptr<const IDictionaryBase> & dictionary_, const NameToNameMap & attribute_by_name_)
+{
+    if (key_names_left.size() != 1)
+        throw Exception("Logical error: direct dictionary JOIN with more than one key", ErrorCodes::LOGICAL_ERROR);
+
+    hashed_dictionary = typeid_cast<const HashedDictionary *>(dictionary_.get());
+    if (!hashed_dictionary)
+        throw Exception("Direct JOIN is implemented only for external dictionaries of the Hashed layout", ErrorCodes::NOT_IMPLEMENTED);
+
+    dictionary = dictionary_;
+    dict_attribute_by_name = attribute_by_name_;
+}
+
+
 namespace
 {
     /// Inserting an element into a hash table of the form `key -> reference to a string`, which will then be used by JOIN.
@@ -361,40 +622,119 @@ namespace
     };
 
 
-    template <ASTTableJoin::Strictness STRICTNESS, typename KeyGetter, typename Map, bool has_null_map>
+    template <typename Map, typename KeyGetter>
+    struct Inserter<ASTTableJoin::Strictness::Asof, Map, KeyGetter>
+    {
+        static void insert(Map & map, const typename Map::key_type & key, Block * stored_block, size_t i, Arena & pool,
+            UInt64 asof_value)
+        {
+            typename Map::iterator it;
+            bool inserted;
+            map.emplace(key, it, inserted);
+
+            if (inserted)
+            {
+                KeyGetter::onNewKey(it->first, pool);
+                new (&it->second) typename Map::mapped_type();
+            }
+
+            /// The order of the list does not matter: it is sorted by the ASOF value before the first probe.
+            auto elem = reinterpret_cast<typename Map::mapped_type::ListEntry *>(
+                pool.alloc(sizeof(typename Map::mapped_type::ListEntry)));
+
+            elem->entry.value = asof_value;
+            elem->entry.row = Join::RowRef(stored_block, i);
+            elem->next = it->second.list;
+            it->second.list = elem;
+            ++it->second.count;
+        }
+    };
+
+
+    template <ASTTableJoin::Strictness STRICTNESS, typename KeyGetter, typename Maps, typename Map, bool has_null_map>
     void NO_INLINE insertFromBlockImplTypeCase(
-        Map & map, size_t rows, const ColumnRawPtrs & key_columns,
-        size_t keys_size, const Sizes & key_sizes, Block * stored_block, ConstNullMapPtr null_map, Arena & pool)
+        std::unique_ptr<Map> Maps::* map_member, std::vector<Maps> & maps, size_t shard_mask, std::mutex * shard_mutexes,
+        size_t rows, const ColumnRawPtrs & key_columns,
+        size_t keys_size, const Sizes & key_sizes, Block * stored_block, ConstNullMapPtr null_map,
+        std::vector<std::unique_ptr<Arena>> & pools, const UInt64 * asof_values)
     {
         KeyGetter key_getter(key_columns);
 
+        if (!shard_mask)
+        {
+            Map & map = *(maps[0].*map_member);
+            std::lock_guard lock(shard_mutexes[0]);
+
+            for (size_t i = 0; i < rows; ++i)
+            {
+                if (has_null_map && (*null_map)[i])
+                    continue;
+
+                auto key = key_getter.getKey(key_columns, keys_size, i, key_sizes);
+                if constexpr (STRICTNESS == ASTTableJoin::Strictness::Asof)
+                    Inserter<STRICTNESS, Map, KeyGetter>::insert(map, key, stored_block, i, *pools[0], asof_values[i]);
+                else
+                    Inserter<STRICTNESS, Map, KeyGetter>::insert(map, key, stored_block, i, *pools[0]);
+            }
+            return;
+        }
+
+        /// Partitioned mode: scatter the rows by the hash of the key, then fill every shard under its own mutex.
+        std::vector<std::vector<size_t>> rows_of_shard(shard_mask + 1);
+        const Map & hasher = *(maps[0].*map_member);    /// All shards use the same hash function.
+
         for (size_t i = 0; i < rows; ++i)
         {
             if (has_null_map && (*null_map)[i])
                 continue;
 
             auto key = key_getter.getKey(key_columns, keys_size, i, key_sizes);
-            Inserter<STRICTNESS, Map, KeyGetter>::insert(map, key, stored_block, i, pool);
+            rows_of_shard[hasher.hash(key) & shard_mask].push_back(i);
+        }
+
+        for (size_t shard = 0; shard <= shard_mask; ++shard)
+        {
+            if (rows_of_shard[shard].empty())
+                continue;
+
+            Map & map = *(maps[shard].*map_member);
+            Arena & pool = *pools[shard];
+            std::lock_guard lock(shard_mutexes[shard]);
+
+            for (size_t i : rows_of_shard[shard])
+            {
+                auto key = key_getter.getKey(key_columns, keys_size, i, key_sizes);
+                if constexpr (STRICTNESS == ASTTableJoin::Strictness::Asof)
+                    Inserter<STRICTNESS, Map, KeyGetter>::insert(map, key, stored_block, i, pool, asof_values[i]);
+                else
+                    Inserter<STRICTNESS, Map, KeyGetter>::insert(map, key, stored_block, i, pool);
+            }
         }
     }
 
 
-    template <ASTTableJoin::Strictness STRICTNESS, typename KeyGetter, typename Map>
+    template <ASTTableJoin::Strictness STRICTNESS, typename KeyGetter, typename Maps, typename Map>
     void insertFromBlockImplType(
-        Map & map, size_t rows, const ColumnRawPtrs & key_columns,
-        size_t keys_size, const Sizes & key_sizes, Block * stored_block, ConstNullMapPtr null_map, Arena & pool)
+        std::unique_ptr<Map> Maps::* map_member, std::vector<Maps> & maps, size_t shard_mask, std::mutex * shard_mutexes,
+        size_t rows, const ColumnRawPtrs & key_columns,
+        size_t keys_size, const Sizes & key_sizes, Block * stored_block, ConstNullMapPtr null_map,
+        std::vector<std::unique_ptr<Arena>> & pools, const UInt64 * asof_values)
     {
         if (null_map)
-            insertFromBlockImplTypeCase<STRICTNESS, KeyGetter, Map, true>(map, rows, key_columns, keys_size, key_sizes, stored_block, null_map, pool);
+            insertFromBlockImplTypeCase<STRICTNESS, KeyGetter, Maps, Map, true>(
+                map_member, maps, shard_mask, shard_mutexes, rows, key_columns, keys_size, key_sizes, stored_block, null_map, pools, asof_values);
         else
-            insertFromBlockImplTypeCase<STRICTNESS, KeyGetter, Map, false>(map, rows, key_columns, keys_size, key_sizes, stored_block, null_map, pool);
+            insertFromBlockImplTypeCase<STRICTNESS, KeyGetter, Maps, Map, false>(
+                map_member, maps, shard_mask, shard_mutexes, rows, key_columns, keys_size, key_sizes, stored_block, null_map, pools, asof_values);
     }
 
 
     template <ASTTableJoin::Strictness STRICTNESS, typename Maps>
     void insertFromBlockImpl(
-        Join::Type type, Maps & maps, size_t rows, const ColumnRawPtrs & key_columns,
-        size_t keys_size, const Sizes & key_sizes, Block * stored_block, ConstNullMapPtr null_map, Arena & pool)
+        Join::Type type, std::vector<Maps> & maps, size_t shard_mask, std::mutex * shard_mutexes,
+        size_t rows, const ColumnRawPtrs & key_columns,
+        size_t keys_size, const Sizes & key_sizes, Block * stored_block, ConstNullMapPtr null_map,
+        std::vector<std::unique_ptr<Arena>> & pools, const UInt64 * asof_values = nullptr)
     {
         switch (type)
         {
@@ -404,7 +744,7 @@ namespace
         #define M(TYPE) \
             case Join::Type::TYPE: \
                 insertFromBlockImplType<STRICTNESS, typename KeyGetterForType<Join::Type::TYPE>::Type>(\
-                    *maps.TYPE, rows, key_columns, keys_size, key_sizes, stored_block, null_map, pool); \
+                    &Maps::TYPE, maps, shard_mask, shard_mutexes, rows, key_columns, keys_size, key_sizes, stored_block, null_map, pools, asof_values); \
                     break;
             APPLY_FOR_JOIN_VARIANTS(M)
         #undef M
@@ -418,7 +758,21 @@ namespace
 
 bool Join::insertFromBlock(const Block & block)
 {
-    std::unique_lock lock(rwlock);
+    if (hashed_dictionary)
+        throw Exception("Logical error: insertFromBlock is called for a direct dictionary JOIN", ErrorCodes::LOGICAL_ERROR);
+
+    /** In the partitioned mode several threads insert in parallel: the blocks list is protected by storage_mutex,
+      *  the shards of the hash tables by their own mutexes, and rwlock is taken shared.
+      * (joinBlock also takes rwlock shared, but probing only starts after the build is complete.)
+      * In the classic mode keep the exclusive lock, because StorageJoin inserts and joins simultaneously.
+      */
+    std::shared_lock shared_lock(rwlock, std::defer_lock);
+    std::unique_lock unique_lock(rwlock, std::defer_lock);
+
+    if (buildsInParallel())
+        shared_lock.lock();
+    else
+        unique_lock.lock();
 
     if (empty())
         throw Exception("Logical error: Join was not initialized", ErrorCodes::LOGICAL_ERROR);
@@ -446,15 +800,39 @@ bool Join::insertFromBlock(const Block & block)
     ConstNullMapPtr null_map{};
     extractNestedColumnsAndNullMap(key_columns, null_map_holder, null_map);
 
+    /// For ASOF JOIN the last key is the ASOF column: it is not hashed, its values are kept with the rows.
+    std::vector<UInt64> asof_values;
+    if (strictness == ASTTableJoin::Strictness::Asof)
+    {
+        fillAsofValues(*key_columns.back(), key_names_right.back(), asof_values);
+        key_columns.pop_back();
+        --keys_size;
+    }
+
     size_t rows = block.rows();
 
-    blocks.push_back(block);
-    Block * stored_block = &blocks.back();
+    if (runtime_filter)
+        addBlockToRuntimeFilter(key_columns, null_map, rows);
 
-    if (getFullness(kind))
+    if (grace)
+    {
+        /// The blocks go to the partitions on disk instead of the in-memory storage;
+        ///  the size of the hash table is not limited by memory in this mode.
+        insertFromBlockGrace(block, key_columns, rows);
+        return true;
+    }
+
+    Block * stored_block = nullptr;
+    {
+        std::lock_guard lock(storage_mutex);
+        blocks.push_back(block);
+        stored_block = &blocks.back();
+    }
+
+    if (getFullness(kind) || storesKeysInBlocks())
     {
         /** Move the key columns to the beginning of the block.
-          * This is where NonJoinedBlockInputStream will expect.
+          * This is where NonJoinedBlockInputStream and the sort-merge algorithm will expect.
           */
         size_t key_num = 0;
         for (const auto & name : key_names_right)
@@ -469,8 +847,10 @@ bool Join::insertFromBlock(const Block & block)
     else
     {
         /// Remove the key columns from stored_block, as they are not needed.
+        /// The ASOF column is kept: it is returned with the joined rows like any other column.
         for (const auto & name : key_names_right)
-            stored_block->erase(stored_block->getPositionByName(name));
+            if (strictness != ASTTableJoin::Strictness::Asof || name != key_names_right.back())
+                stored_block->erase(stored_block->getPositionByName(name));
     }
 
     size_t size = stored_block->columns();
@@ -483,35 +863,438 @@ bool Join::insertFromBlock(const Block & block)
             stored_block->safeGetByPosition(i).column = converted;
     }
 
+    if (storesKeysInBlocks())
+    {
+        /** Rows with NULL in any key component never join to anything, and the merge must not see NULLs:
+          *  drop such rows right away and keep only the non-nullable nested key columns.
+          */
+        if (null_map)
+        {
+            IColumn::Filter keep(rows);
+            for (size_t i = 0; i < rows; ++i)
+                keep[i] = !(*null_map)[i];
+
+            for (size_t i = 0; i < size; ++i)
+                stored_block->safeGetByPosition(i).column = stored_block->safeGetByPosition(i).column->filter(keep, -1);
+
+            null_map_holder = nullptr;
+            null_map = nullptr;
+        }
+
+        for (size_t i = 0; i < keys_size; ++i)
+        {
+            auto & col = stored_block->getByPosition(i);
+            if (auto * nullable = typeid_cast<const ColumnNullable *>(col.column.get()))
+            {
+                col.column = nullable->getNestedColumnPtr();
+                col.type = removeNullable(col.type);
+            }
+        }
+
+        /// The hash table (while we are still building one - the AUTO algorithm) must reference the filtered rows.
+        rows = stored_block->rows();
+        for (size_t i = 0; i < keys_size; ++i)
+            key_columns[i] = stored_block->safeGetByPosition(i).column.get();
+    }
+
     /// In case of LEFT and FULL joins, if use_nulls, convert joined columns to Nullable.
     if (use_nulls && (kind == ASTTableJoin::Kind::Left || kind == ASTTableJoin::Kind::Full))
     {
-        for (size_t i = getFullness(kind) ? keys_size : 0; i < size; ++i)
+        for (size_t i = (getFullness(kind) || storesKeysInBlocks()) ? keys_size : 0; i < size; ++i)
         {
             convertColumnToNullable(stored_block->getByPosition(i));
         }
     }
 
-    if (kind != ASTTableJoin::Kind::Cross)
+    if (kind != ASTTableJoin::Kind::Cross && !sort_merge)
     {
         /// Fill the hash table.
         if (!getFullness(kind))
         {
             if (strictness == ASTTableJoin::Strictness::Any)
-                insertFromBlockImpl<ASTTableJoin::Strictness::Any>(type, maps_any, rows, key_columns, keys_size, key_sizes, stored_block, null_map, pool);
+                insertFromBlockImpl<ASTTableJoin::Strictness::Any>(type, maps_any, shard_mask, shard_mutexes.get(), rows, key_columns, keys_size, key_sizes, stored_block, null_map, pools);
+            else if (strictness == ASTTableJoin::Strictness::Asof)
+                insertFromBlockImpl<ASTTableJoin::Strictness::Asof>(type, maps_asof, shard_mask, shard_mutexes.get(), rows, key_columns, keys_size, key_sizes, stored_block, null_map, pools, asof_values.data());
             else
-                insertFromBlockImpl<ASTTableJoin::Strictness::All>(type, maps_all, rows, key_columns, keys_size, key_sizes, stored_block, null_map, pool);
+                insertFromBlockImpl<ASTTableJoin::Strictness::All>(type, maps_all, shard_mask, shard_mutexes.get(), rows, key_columns, keys_size, key_sizes, stored_block, null_map, pools);
         }
         else
         {
             if (strictness == ASTTableJoin::Strictness::Any)
-                insertFromBlockImpl<ASTTableJoin::Strictness::Any>(type, maps_any_full, rows, key_columns, keys_size, key_sizes, stored_block, null_map, pool);
+                insertFromBlockImpl<ASTTableJoin::Strictness::Any>(type, maps_any_full, shard_mask, shard_mutexes.get(), rows, key_columns, keys_size, key_sizes, stored_block, null_map, pools);
             else
-                insertFromBlockImpl<ASTTableJoin::Strictness::All>(type, maps_all_full, rows, key_columns, keys_size, key_sizes, stored_block, null_map, pool);
+                insertFromBlockImpl<ASTTableJoin::Strictness::All>(type, maps_all_full, shard_mask, shard_mutexes.get(), rows, key_columns, keys_size, key_sizes, stored_block, null_map, pools);
         }
     }
 
-    return limits.check(getTotalRowCount(), getTotalByteCount(), "JOIN", ErrorCodes::SET_SIZE_LIMIT_EXCEEDED);
+    /// The whole point of the sort-merge algorithm is to handle data exceeding the limits for the hash table.
+    if (sort_merge)
+        return true;
+
+    size_t total_rows = getTotalRowCount();
+    size_t total_bytes = getTotalByteCount();
+
+    if (algorithm == Algorithm::AUTO
+        && ((limits.max_rows && total_rows > limits.max_rows)
+            || (limits.max_bytes && total_bytes > limits.max_bytes)))
+    {
+        convertToSortMerge();
+        return true;
+    }
+
+    /// NOTE: In the partitioned mode the sizes are read while other threads insert, so the check is approximate.
+    return limits.check(total_rows, total_bytes, "JOIN", ErrorCodes::SET_SIZE_LIMIT_EXCEEDED);
+}
+
+
+void Join::convertToSortMerge()
+{
+    LOG_DEBUG(log, "JOIN exceeded the limits for the hash table, converting to the sort-merge algorithm");
+
+    /// The stored blocks already keep the key columns, so just drop the hash tables and continue accumulating blocks.
+    for (size_t i = 0; i < shards; ++i)
+    {
+        maps_any[i] = MapsAny();
+        maps_all[i] = MapsAll();
+        maps_any_full[i] = MapsAnyFull();
+        maps_all_full[i] = MapsAllFull();
+        pools[i] = std::make_unique<Arena>();
+    }
+
+    sort_merge = true;
+}
+
+
+const Join::RowRef * Join::AsofRowRefs::findAsof(UInt64 value) const
+{
+    /// The first entry with a greater value; the one just before it is the match.
+    const Entry * first_greater = std::upper_bound(sorted, sorted + count, value,
+        [](UInt64 lhs, const Entry & rhs) { return lhs < rhs.value; });
+
+    if (first_greater == sorted)
+        return nullptr;
+
+    return &(first_greater - 1)->row;
+}
+
+
+template <typename Map>
+static void sortAsofDataImpl(Map & map, Arena & pool)
+{
+    for (auto it = map.begin(); it != map.end(); ++it)
+    {
+        Join::AsofRowRefs & refs = it->second;
+
+        auto * sorted = reinterpret_cast<Join::AsofRowRefs::Entry *>(
+            pool.alloc(sizeof(Join::AsofRowRefs::Entry) * refs.count));
+
+        size_t num = 0;
+        for (const auto * elem = refs.list; elem; elem = elem->next)
+            sorted[num++] = elem->entry;
+
+        std::sort(sorted, sorted + refs.count,
+            [](const Join::AsofRowRefs::Entry & lhs, const Join::AsofRowRefs::Entry & rhs) { return lhs.value < rhs.value; });
+
+        refs.sorted = sorted;
+    }
+}
+
+void Join::sortAsofData() const
+{
+    for (size_t i = 0; i < shards; ++i)
+    {
+        switch (type)
+        {
+            case Type::EMPTY:            break;
+            case Type::CROSS:            break;
+
+        #define M(NAME) \
+            case Type::NAME: sortAsofDataImpl(*maps_asof[i].NAME, *pools[i]); break;
+            APPLY_FOR_JOIN_VARIANTS(M)
+        #undef M
+
+            default:
+                throw Exception("Unknown JOIN keys variant.", ErrorCodes::UNKNOWN_SET_DATA_VARIANT);
+        }
+    }
+}
+
+
+void Join::sortRightBlocks() const
+{
+    if (blocks.empty())
+        return;
+
+    SortDescription description;
+    description.reserve(key_names_right.size());
+    for (const auto & name : key_names_right)
+        description.emplace_back(name, 1, 1);
+
+    /// Sort the accumulated blocks of the right table as a whole, spilling to disk if they are too large.
+    BlockInputStreamPtr stream = std::make_shared<BlocksListBlockInputStream>(BlocksList(blocks.begin(), blocks.end()));
+    stream = std::make_shared<MergeSortingBlockInputStream>(
+        stream, description, DEFAULT_BLOCK_SIZE, 0, 0, max_bytes_before_external_sort, tmp_path);
+
+    stream->readPrefix();
+    while (Block block = stream->read())
+        sorted_blocks.emplace_back(std::move(block));
+    stream->readSuffix();
+}
+
+
+/// Scatter the rows of a block to 'num_buckets' blocks, by a hash of the key columns.
+/// The same function is used for both sides of the join, so matching keys end up in the same bucket.
+static Blocks scatterBlockByKeyHash(const ColumnRawPtrs & key_columns, const Block & block, size_t num_buckets, size_t bucket_mask)
+{
+    size_t rows = block.rows();
+    size_t keys_size = key_columns.size();
+
+    IColumn::Selector selector(rows);
+    for (size_t i = 0; i < rows; ++i)
+        selector[i] = hash128(i, keys_size, key_columns).low & bucket_mask;
+
+    Blocks parts;
+    parts.reserve(num_buckets);
+    for (size_t bucket = 0; bucket < num_buckets; ++bucket)
+        parts.emplace_back(block.cloneEmpty());
+
+    size_t num_columns = block.columns();
+    for (size_t i = 0; i < num_columns; ++i)
+    {
+        auto scattered = block.getByPosition(i).column->scatter(num_buckets, selector);
+        for (size_t bucket = 0; bucket < num_buckets; ++bucket)
+            parts[bucket].getByPosition(i).column = std::move(scattered[bucket]);
+    }
+
+    return parts;
+}
+
+
+void Join::insertFromBlockGrace(const Block & block, const ColumnRawPtrs & key_columns, size_t rows)
+{
+    if (!rows)
+        return;
+
+    if (!grace->spilled_header)
+        grace->spilled_header = block.cloneEmpty();
+
+    size_t num_buckets = grace->buckets.size();
+    Blocks parts = scatterBlockByKeyHash(key_columns, block, num_buckets, grace->bucket_mask);
+
+    /// Rows with NULL keys are spilled like the others: the per-bucket joins will skip them themselves.
+    for (size_t bucket_num = 0; bucket_num < num_buckets; ++bucket_num)
+    {
+        if (!parts[bucket_num].rows())
+            continue;
+
+        auto & bucket = grace->buckets[bucket_num];
+
+        if (!bucket.block_out)
+        {
+            Poco::File(tmp_path).createDirectories();
+            bucket.file = std::make_unique<Poco::TemporaryFile>(tmp_path);
+            bucket.file_buf = std::make_unique<WriteBufferFromFile>(bucket.file->path());
+            bucket.compressed_buf = std::make_unique<CompressedWriteBuffer>(*bucket.file_buf);
+            bucket.block_out = std::make_unique<NativeBlockOutputStream>(*bucket.compressed_buf, 0, grace->spilled_header);
+            bucket.block_out->writePrefix();
+        }
+
+        bucket.block_out->write(parts[bucket_num]);
+        bucket.rows += parts[bucket_num].rows();
+    }
+}
+
+
+std::shared_ptr<Join> Join::getGraceBucketJoin(size_t bucket_num) const
+{
+    std::lock_guard lock(grace->mutex);
+
+    auto it = grace->loaded.find(bucket_num);
+    if (it != grace->loaded.end())
+    {
+        grace->lru.remove(bucket_num);
+        grace->lru.push_front(bucket_num);
+        return it->second;
+    }
+
+    auto & bucket = grace->buckets[bucket_num];
+
+    /// Finish writing the partition, if it was not read before.
+    if (bucket.block_out)
+    {
+        bucket.block_out->writeSuffix();
+        bucket.compressed_buf->next();
+        bucket.file_buf->next();
+        bucket.block_out.reset();
+        bucket.compressed_buf.reset();
+        bucket.file_buf.reset();
+    }
+
+    /// An ordinary in-memory hash join over the rows of one partition.
+    JoinPtr bucket_join = std::make_shared<Join>(
+        key_names_left, key_names_right, needed_key_names_right, use_nulls, SizeLimits(), kind, strictness);
+    bucket_join->setSampleBlock(grace->sample_block);
+
+    if (bucket.file)
+    {
+        ReadBufferFromFile file_in(bucket.file->path());
+        CompressedReadBuffer compressed_in(file_in);
+        NativeBlockInputStream block_in(compressed_in, grace->spilled_header, 0);
+
+        block_in.readPrefix();
+        while (Block spilled_block = block_in.read())
+            bucket_join->insertFromBlock(spilled_block);
+        block_in.readSuffix();
+    }
+
+    grace->loaded.emplace(bucket_num, bucket_join);
+    grace->lru.push_front(bucket_num);
+    grace->loaded_bytes += bucket_join->getTotalByteCount();
+
+    /// Keep the cache of per-bucket joins within the memory limit for JOIN; with a skewed probe side
+    ///  the hot buckets stay cached and are built only once.
+    while (limits.max_bytes && grace->loaded_bytes > limits.max_bytes && grace->lru.size() > 1)
+    {
+        size_t victim = grace->lru.back();
+        grace->lru.pop_back();
+        grace->loaded_bytes -= grace->loaded[victim]->getTotalByteCount();
+        grace->loaded.erase(victim);
+    }
+
+    return bucket_join;
+}
+
+
+void Join::joinBlockGrace(Block & block) const
+{
+    size_t keys_size = key_names_left.size();
+    ColumnRawPtrs key_columns(keys_size);
+
+    /// Rare case, when keys are constant. To avoid code bloat, simply materialize them.
+    Columns materialized_columns;
+
+    for (size_t i = 0; i < keys_size; ++i)
+    {
+        key_columns[i] = block.getByName(key_names_left[i]).column.get();
+
+        if (ColumnPtr converted = key_columns[i]->convertToFullColumnIfConst())
+        {
+            materialized_columns.emplace_back(converted);
+            key_columns[i] = materialized_columns.back().get();
+        }
+    }
+
+    /// The buckets are selected by the hash of the nested (non-nullable) key columns.
+    /// Rows with NULL keys are routed like the others: the per-bucket join treats them as non-joined itself.
+    ColumnPtr null_map_holder;
+    ConstNullMapPtr null_map{};
+    extractNestedColumnsAndNullMap(key_columns, null_map_holder, null_map);
+
+    if (!block.rows())
+    {
+        /// An empty block may be passed just to learn the structure of the result (e.g. for a header).
+        /// Join it through a transient empty bucket join, without touching the cache.
+        JoinPtr header_join = std::make_shared<Join>(
+            key_names_left, key_names_right, needed_key_names_right, use_nulls, SizeLimits(), kind, strictness);
+        header_join->setSampleBlock(grace->sample_block);
+        header_join->joinBlock(block);
+        return;
+    }
+
+    size_t num_buckets = grace->buckets.size();
+    Blocks parts = scatterBlockByKeyHash(key_columns, block, num_buckets, grace->bucket_mask);
+
+    /// Join every non-empty part with the in-memory join of its bucket and concatenate the results.
+    Block result;
+    MutableColumns result_columns;
+
+    for (size_t bucket_num = 0; bucket_num < num_buckets; ++bucket_num)
+    {
+        Block & part = parts[bucket_num];
+        if (!part.rows())
+            continue;
+
+        JoinPtr bucket_join = getGraceBucketJoin(bucket_num);
+        bucket_join->joinBlock(part);
+
+        if (!result)
+        {
+            result = part.cloneEmpty();
+            result_columns = result.cloneEmptyColumns();
+        }
+
+        for (size_t i = 0; i < result_columns.size(); ++i)
+            result_columns[i]->insertRangeFrom(*part.getByPosition(i).column, 0, part.rows());
+    }
+
+    block = result.cloneWithColumns(std::move(result_columns));
+}
+
+
+void Join::addBlockToRuntimeFilter(const ColumnRawPtrs & key_columns, ConstNullMapPtr null_map, size_t rows)
+{
+    size_t keys_size = key_columns.size();
+
+    for (size_t i = 0; i < rows; ++i)
+    {
+        if (null_map && (*null_map)[i])
+            continue;
+
+        runtime_filter->add(hash128(i, keys_size, key_columns).low);
+    }
+}
+
+
+void Join::filterBlockByRuntimeFilter(Block & block) const
+{
+    size_t rows = block.rows();
+    if (!runtime_filter || !rows)
+        return;
+
+    size_t keys_size = key_names_left.size();
+    ColumnRawPtrs key_columns(keys_size);
+
+    /// Rare case, when keys are constant. To avoid code bloat, simply materialize them.
+    Columns materialized_columns;
+
+    for (size_t i = 0; i < keys_size; ++i)
+    {
+        /// The keys may be expressions that are calculated later in the pipeline; then nothing can be filtered here.
+        if (!block.has(key_names_left[i]))
+            return;
+
+        key_columns[i] = block.getByName(key_names_left[i]).column.get();
+
+        if (ColumnPtr converted = key_columns[i]->convertToFullColumnIfConst())
+        {
+            materialized_columns.emplace_back(converted);
+            key_columns[i] = materialized_columns.back().get();
+        }
+    }
+
+    ColumnPtr null_map_holder;
+    ConstNullMapPtr null_map{};
+    extractNestedColumnsAndNullMap(key_columns, null_map_holder, null_map);
+
+    IColumn::Filter filter(rows);
+    size_t kept = 0;
+
+    for (size_t i = 0; i < rows; ++i)
+    {
+        /// Rows with NULL keys never join; the filter is applied only for INNER and RIGHT joins, which drop them anyway.
+        if (null_map && (*null_map)[i])
+            filter[i] = 0;
+        else
+            filter[i] = runtime_filter->mightContain(hash128(i, keys_size, key_columns).low);
+
+        kept += filter[i];
+    }
+
+    if (kept == rows)
+        return;
+
+    for (size_t i = 0; i < block.columns(); ++i)
+        block.safeGetByPosition(i).column = block.safeGetByPosition(i).column->filter(filter, kept);
 }
 
 
@@ -599,23 +1382,67 @@ namespace
                 ++current_offset;
                 (*offsets)[i] = current_offset;
 
-                for (size_t j = 0; j < num_columns_to_add; ++j)
-                    added_columns[j]->insertDefault();
-            }
+                for (size_t j = 0; j < num_columns_to_add; ++j)
+                    added_columns[j]->insertDefault();
+            }
+        }
+    };
+
+    /// ASOF JOIN. addFound receives the row selected by findAsof; "found key, no suitable row" is addNotFound.
+    template <typename Map>
+    struct Adder<ASTTableJoin::Kind::Left, ASTTableJoin::Strictness::Asof, Map>
+    {
+        static void addFound(const Join::RowRef & row, size_t num_columns_to_add, MutableColumns & added_columns,
+            size_t i, IColumn::Filter * filter, const std::vector<size_t> & right_indexes)
+        {
+            (*filter)[i] = 1;
+
+            for (size_t j = 0; j < num_columns_to_add; ++j)
+                added_columns[j]->insertFrom(*row.block->getByPosition(right_indexes[j]).column.get(), row.row_num);
+        }
+
+        static void addNotFound(size_t num_columns_to_add, MutableColumns & added_columns,
+            size_t i, IColumn::Filter * filter, IColumn::Offset & /*current_offset*/, IColumn::Offsets * /*offsets*/)
+        {
+            (*filter)[i] = 0;
+
+            for (size_t j = 0; j < num_columns_to_add; ++j)
+                added_columns[j]->insertDefault();
+        }
+    };
+
+    template <typename Map>
+    struct Adder<ASTTableJoin::Kind::Inner, ASTTableJoin::Strictness::Asof, Map>
+    {
+        static void addFound(const Join::RowRef & row, size_t num_columns_to_add, MutableColumns & added_columns,
+            size_t i, IColumn::Filter * filter, const std::vector<size_t> & right_indexes)
+        {
+            (*filter)[i] = 1;
+
+            for (size_t j = 0; j < num_columns_to_add; ++j)
+                added_columns[j]->insertFrom(*row.block->getByPosition(right_indexes[j]).column.get(), row.row_num);
+        }
+
+        static void addNotFound(size_t /*num_columns_to_add*/, MutableColumns & /*added_columns*/,
+            size_t i, IColumn::Filter * filter, IColumn::Offset & /*current_offset*/, IColumn::Offsets * /*offsets*/)
+        {
+            (*filter)[i] = 0;
         }
     };
 
-    template <ASTTableJoin::Kind KIND, ASTTableJoin::Strictness STRICTNESS, typename KeyGetter, typename Map, bool has_null_map>
+    template <ASTTableJoin::Kind KIND, ASTTableJoin::Strictness STRICTNESS, typename KeyGetter, typename Maps, typename Map, bool has_null_map>
     void NO_INLINE joinBlockImplTypeCase(
-        const Map & map, size_t rows, const ColumnRawPtrs & key_columns, const Sizes & key_sizes,
+        std::unique_ptr<Map> Maps::* map_member, const std::vector<Maps> & maps, size_t shard_mask,
+        size_t rows, const ColumnRawPtrs & key_columns, const Sizes & key_sizes,
         MutableColumns & added_columns, ConstNullMapPtr null_map, std::unique_ptr<IColumn::Filter> & filter,
         IColumn::Offset & current_offset, std::unique_ptr<IColumn::Offsets> & offsets_to_replicate,
-        const std::vector<size_t> & right_indexes)
+        const std::vector<size_t> & right_indexes, const UInt64 * asof_values)
     {
         size_t keys_size = key_columns.size();
         size_t num_columns_to_add = right_indexes.size();
 
         KeyGetter key_getter(key_columns);
+        const Map & hasher = *(maps[0].*map_member);    /// All shards use the same hash function.
 
         for (size_t i = 0; i < rows; ++i)
         {
@@ -627,9 +1454,37 @@ namespace
             else
             {
                 auto key = key_getter.getKey(key_columns, keys_size, i, key_sizes);
+                const Map & map = *(maps[shard_mask ? hasher.hash(key) & shard_mask : 0].*map_member);
+
+                /// Prefetch the cell for a row a few iterations ahead, to overlap the cache miss with the work on the current rows.
+                if constexpr (KeyGetter::prefetch_optimization)
+                {
+                    static constexpr size_t prefetch_look_ahead = 16;
+                    size_t prefetch_row = i + prefetch_look_ahead;
+                    if (prefetch_row < rows && !(has_null_map && (*null_map)[prefetch_row]))
+                    {
+                        size_t hash_ahead = hasher.hash(key_getter.getKey(key_columns, keys_size, prefetch_row, key_sizes));
+                        (*(maps[shard_mask ? hash_ahead & shard_mask : 0].*map_member)).prefetchByHash(hash_ahead);
+                    }
+                }
+
                 typename Map::const_iterator it = map.find(key);
 
-                if (it != map.end())
+                if constexpr (STRICTNESS == ASTTableJoin::Strictness::Asof)
+                {
+                    const Join::RowRef * row = it != map.end() ? it->second.findAsof(asof_values[i]) : nullptr;
+
+                    if (row)
+                    {
+                        it->second.setUsed();
+                        Adder<KIND, STRICTNESS, Map>::addFound(
+                            *row, num_columns_to_add, added_columns, i, filter.get(), right_indexes);
+                    }
+                    else
+                        Adder<KIND, STRICTNESS, Map>::addNotFound(
+                            num_columns_to_add, added_columns, i, filter.get(), current_offset, offsets_to_replicate.get());
+                }
+                else if (it != map.end())
                 {
                     it->second.setUsed();
                     Adder<KIND, STRICTNESS, Map>::addFound(
@@ -642,27 +1497,28 @@ namespace
         }
     }
 
-    template <ASTTableJoin::Kind KIND, ASTTableJoin::Strictness STRICTNESS, typename KeyGetter, typename Map>
+    template <ASTTableJoin::Kind KIND, ASTTableJoin::Strictness STRICTNESS, typename KeyGetter, typename Maps, typename Map>
     void joinBlockImplType(
-        const Map & map, size_t rows, const ColumnRawPtrs & key_columns, const Sizes & key_sizes,
+        std::unique_ptr<Map> Maps::* map_member, const std::vector<Maps> & maps, size_t shard_mask,
+        size_t rows, const ColumnRawPtrs & key_columns, const Sizes & key_sizes,
         MutableColumns & added_columns, ConstNullMapPtr null_map, std::unique_ptr<IColumn::Filter> & filter,
         IColumn::Offset & current_offset, std::unique_ptr<IColumn::Offsets> & offsets_to_replicate,
-        const std::vector<size_t> & right_indexes)
+        const std::vector<size_t> & right_indexes, const UInt64 * asof_values)
     {
         if (null_map)
-            joinBlockImplTypeCase<KIND, STRICTNESS, KeyGetter, Map, true>(
-                map, rows, key_columns, key_sizes, added_columns, null_map, filter,
-                current_offset, offsets_to_replicate, right_indexes);
+            joinBlockImplTypeCase<KIND, STRICTNESS, KeyGetter, Maps, Map, true>(
+                map_member, maps, shard_mask, rows, key_columns, key_sizes, added_columns, null_map, filter,
+                current_offset, offsets_to_replicate, right_indexes, asof_values);
         else
-            joinBlockImplTypeCase<KIND, STRICTNESS, KeyGetter, Map, false>(
-                map, rows, key_columns, key_sizes, added_columns, null_map, filter,
-                current_offset, offsets_to_replicate, right_indexes);
+            joinBlockImplTypeCase<KIND, STRICTNESS, KeyGetter, Maps, Map, false>(
+                map_member, maps, shard_mask, rows, key_columns, key_sizes, added_columns, null_map, filter,
+                current_offset, offsets_to_replicate, right_indexes, asof_values);
     }
 }
 
 
 template <ASTTableJoin::Kind KIND, ASTTableJoin::Strictness STRICTNESS, typename Maps>
-void Join::joinBlockImpl(Block & block, const Maps & maps) const
+void Join::joinBlockImpl(Block & block, const std::vector<Maps> & maps) const
 {
     size_t keys_size = key_names_left.size();
     ColumnRawPtrs key_columns(keys_size);
@@ -687,6 +1543,14 @@ void Join::joinBlockImpl(Block & block, const Maps & maps) const
     ConstNullMapPtr null_map{};
     extractNestedColumnsAndNullMap(key_columns, null_map_holder, null_map);
 
+    /// For ASOF JOIN the last key is the ASOF column: it is searched within the bucket, not hashed.
+    std::vector<UInt64> asof_values;
+    if (strictness == ASTTableJoin::Strictness::Asof)
+    {
+        fillAsofValues(*key_columns.back(), key_names_left.back(), asof_values);
+        key_columns.pop_back();
+    }
+
     size_t existing_columns = block.columns();
 
     /** If you use FULL or RIGHT JOIN, then the columns from the "left" table must be materialized.
@@ -714,9 +1578,10 @@ void Join::joinBlockImpl(Block & block, const Maps & maps) const
     /** For LEFT/INNER JOIN, the saved blocks do not contain keys.
       * For FULL/RIGHT JOIN, the saved blocks contain keys;
       *  but they will not be used at this stage of joining (and will be in `AdderNonJoined`), and they need to be skipped.
+      * The AUTO algorithm also keeps the keys in the saved blocks (for a possible conversion to sort-merge).
       */
     size_t num_columns_to_skip = 0;
-    if (getFullness(kind))
+    if (getFullness(kind) || storesKeysInBlocks())
         num_columns_to_skip = keys_size;
 
     /// Add new columns to the block.
@@ -749,7 +1614,8 @@ void Join::joinBlockImpl(Block & block, const Maps & maps) const
     /// Used with ANY INNER JOIN
     std::unique_ptr<IColumn::Filter> filter;
 
-    bool filter_left_keys = (kind == ASTTableJoin::Kind::Inner || kind == ASTTableJoin::Kind::Right) && strictness == ASTTableJoin::Strictness::Any;
+    bool filter_left_keys = (kind == ASTTableJoin::Kind::Inner || kind == ASTTableJoin::Kind::Right)
+        && (strictness == ASTTableJoin::Strictness::Any || strictness == ASTTableJoin::Strictness::Asof);
     filter = std::make_unique<IColumn::Filter>(rows);
 
     /// Used with ALL ... JOIN
@@ -764,8 +1630,8 @@ void Join::joinBlockImpl(Block & block, const Maps & maps) const
     #define M(TYPE) \
         case Join::Type::TYPE: \
             joinBlockImplType<KIND, STRICTNESS, typename KeyGetterForType<Join::Type::TYPE>::Type>(\
-                *maps.TYPE, rows, key_columns, key_sizes, added_columns, null_map, \
-                filter, current_offset, offsets_to_replicate, right_indexes); \
+                &Maps::TYPE, maps, shard_mask, rows, key_columns, key_sizes, added_columns, null_map, \
+                filter, current_offset, offsets_to_replicate, right_indexes, asof_values.data()); \
             break;
         APPLY_FOR_JOIN_VARIANTS(M)
     #undef M
@@ -875,6 +1741,248 @@ void Join::joinBlockImplCross(Block & block) const
 }
 
 
+void Join::joinBlockMerge(Block & block) const
+{
+    /// The right table is sorted lazily, at the moment of the first probe (the build is complete by then).
+    std::call_once(sorted_blocks_flag, [this] { sortRightBlocks(); });
+
+    size_t keys_size = key_names_left.size();
+
+    /// Sort the block of the left table by the key columns: then it can be merged with the sorted
+    ///  right table in one forward pass. The order of rows in the result of JOIN is not specified,
+    ///  so it is fine that it changes.
+    {
+        SortDescription description;
+        description.reserve(keys_size);
+        for (const auto & name : key_names_left)
+            description.emplace_back(name, 1, 1);
+        sortBlock(block, description);
+    }
+
+    ColumnRawPtrs key_columns(keys_size);
+
+    /// Rare case, when keys are constant. To avoid code bloat, simply materialize them.
+    Columns materialized_columns;
+
+    for (size_t i = 0; i < keys_size; ++i)
+    {
+        key_columns[i] = block.getByName(key_names_left[i]).column.get();
+
+        if (ColumnPtr converted = key_columns[i]->convertToFullColumnIfConst())
+        {
+            materialized_columns.emplace_back(converted);
+            key_columns[i] = materialized_columns.back().get();
+        }
+    }
+
+    /// Keys with NULL value in any column won't join to anything.
+    ColumnPtr null_map_holder;
+    ConstNullMapPtr null_map{};
+    extractNestedColumnsAndNullMap(key_columns, null_map_holder, null_map);
+
+    /// For ASOF JOIN the last key is the ASOF column: it is searched within the bucket, not hashed.
+    std::vector<UInt64> asof_values;
+    if (strictness == ASTTableJoin::Strictness::Asof)
+    {
+        fillAsofValues(*key_columns.back(), key_names_left.back(), asof_values);
+        key_columns.pop_back();
+    }
+
+    size_t existing_columns = block.columns();
+
+    /// Add new columns to the block.
+    size_t num_columns_to_add = sample_block_with_columns_to_add.columns();
+    MutableColumns added_columns;
+    added_columns.reserve(num_columns_to_add);
+
+    std::vector<std::pair<decltype(ColumnWithTypeAndName::type), decltype(ColumnWithTypeAndName::name)>> added_type_name;
+    added_type_name.reserve(num_columns_to_add);
+
+    std::vector<size_t> right_indexes;
+    right_indexes.reserve(num_columns_to_add);
+
+    for (size_t i = 0; i < num_columns_to_add; ++i)
+    {
+        const ColumnWithTypeAndName & src_column = sample_block_with_columns_to_add.safeGetByPosition(i);
+
+        /// Don't insert column if it's in left block.
+        if (!block.has(src_column.name))
+        {
+            added_columns.push_back(src_column.column->cloneEmpty());
+            added_columns.back()->reserve(src_column.column->size());
+            added_type_name.emplace_back(src_column.type, src_column.name);
+            right_indexes.push_back(keys_size + i);    /// Skip the key columns at the beginning of the stored blocks.
+        }
+    }
+
+    size_t rows = block.rows();
+    size_t columns_added = added_columns.size();
+
+    bool filter_left_keys = kind == ASTTableJoin::Kind::Inner && strictness == ASTTableJoin::Strictness::Any;
+    bool is_all = strictness == ASTTableJoin::Strictness::All;
+
+    IColumn::Filter filter(rows);
+
+    IColumn::Offset current_offset = 0;
+    std::unique_ptr<IColumn::Offsets> offsets_to_replicate;
+    if (is_all)
+        offsets_to_replicate = std::make_unique<IColumn::Offsets>(rows);
+
+    /// Raw pointers to the key columns of the sorted blocks of the right table.
+    size_t num_right_blocks = sorted_blocks.size();
+    std::vector<ColumnRawPtrs> right_key_columns(num_right_blocks);
+    for (size_t i = 0; i < num_right_blocks; ++i)
+    {
+        right_key_columns[i].resize(keys_size);
+        for (size_t j = 0; j < keys_size; ++j)
+            right_key_columns[i][j] = sorted_blocks[i].getByPosition(j).column.get();
+    }
+
+    /// Compare a row of the left block with a row of one of the sorted right blocks, by the key columns.
+    auto compare_at = [&](size_t left_row, size_t r_block, size_t r_row)
+    {
+        for (size_t j = 0; j < keys_size; ++j)
+            if (int res = key_columns[j]->compareAt(left_row, r_row, *right_key_columns[r_block][j], 1))
+                return res;
+        return 0;
+    };
+
+    auto add_not_found = [&](size_t i)
+    {
+        filter[i] = 0;
+
+        if (kind == ASTTableJoin::Kind::Left)
+        {
+            if (is_all)
+                ++current_offset;
+
+            for (size_t j = 0; j < columns_added; ++j)
+                added_columns[j]->insertDefault();
+        }
+
+        if (is_all)
+            (*offsets_to_replicate)[i] = current_offset;
+    };
+
+    /// The merge cursor only moves forward, because the left block is sorted too.
+    size_t right_block = 0;
+    size_t right_row = 0;
+
+    for (size_t i = 0; i < rows; ++i)
+    {
+        if (null_map && (*null_map)[i])
+        {
+            add_not_found(i);
+            continue;
+        }
+
+        /// Skip the rows of the right table with keys less than the current one.
+        while (right_block < num_right_blocks
+            && (right_row == sorted_blocks[right_block].rows() || compare_at(i, right_block, right_row) > 0))
+        {
+            if (right_row == sorted_blocks[right_block].rows())
+            {
+                ++right_block;
+                right_row = 0;
+            }
+            else
+                ++right_row;
+        }
+
+        if (right_block == num_right_blocks || compare_at(i, right_block, right_row) != 0)
+        {
+            add_not_found(i);
+            continue;
+        }
+
+        filter[i] = 1;
+
+        if (!is_all)
+        {
+            /// ANY: only the first matching row. The cursor stays at the beginning of the run,
+            ///  because the next row of the left block may have the same key.
+            for (size_t j = 0; j < columns_added; ++j)
+                added_columns[j]->insertFrom(*sorted_blocks[right_block].getByPosition(right_indexes[j]).column, right_row);
+        }
+        else
+        {
+            /// ALL: the whole run of matching rows, scanned with a temporary cursor for the same reason.
+            size_t match_block = right_block;
+            size_t match_row = right_row;
+
+            while (match_block < num_right_blocks)
+            {
+                if (match_row == sorted_blocks[match_block].rows())
+                {
+                    ++match_block;
+                    match_row = 0;
+                    continue;
+                }
+
+                if (compare_at(i, match_block, match_row) != 0)
+                    break;
+
+                for (size_t j = 0; j < columns_added; ++j)
+                    added_columns[j]->insertFrom(*sorted_blocks[match_block].getByPosition(right_indexes[j]).column, match_row);
+
+                ++current_offset;
+                ++match_row;
+            }
+
+            (*offsets_to_replicate)[i] = current_offset;
+        }
+    }
+
+    for (size_t i = 0; i < columns_added; ++i)
+        block.insert(ColumnWithTypeAndName(std::move(added_columns[i]), added_type_name[i].first, added_type_name[i].second));
+
+    /// If ANY INNER JOIN - filter all the columns except the new ones.
+    if (filter_left_keys)
+        for (size_t i = 0; i < existing_columns; ++i)
+            block.safeGetByPosition(i).column = block.safeGetByPosition(i).column->filter(filter, -1);
+
+    ColumnUInt64::Ptr mapping;
+
+    /// Add join key columns from right block if they has different name.
+    for (size_t i = 0; i < key_names_right.size(); ++i)
+    {
+        auto & right_name = key_names_right[i];
+        auto & left_name = key_names_left[i];
+
+        if (needed_key_names_right.count(right_name) && !block.has(right_name))
+        {
+            const auto & col = block.getByName(left_name);
+            auto column = col.column;
+            if (!filter_left_keys)
+            {
+                if (!mapping)
+                {
+                    auto mut_mapping = ColumnUInt64::create(column->size());
+                    auto & data = mut_mapping->getData();
+                    size_t size = column->size();
+                    for (size_t j = 0; j < size; ++j)
+                        data[j] = filter[j] ? j : size;
+
+                    mapping = std::move(mut_mapping);
+                }
+
+                auto mut_column = (*std::move(column)).mutate();
+                mut_column->insertDefault();
+                column = mut_column->index(*mapping, 0);
+            }
+            block.insert({column, col.type, right_name});
+        }
+    }
+
+    /// If ALL ... JOIN - we replicate all the columns except the new ones.
+    if (offsets_to_replicate)
+    {
+        for (size_t i = 0; i < existing_columns; ++i)
+            block.safeGetByPosition(i).column = block.safeGetByPosition(i).column->replicate(*offsets_to_replicate);
+    }
+}
+
+
 void Join::checkTypesOfKeys(const Block & block_left, const Block & block_right) const
 {
     size_t keys_size = key_names_left.size();
@@ -895,6 +2003,155 @@ void Join::checkTypesOfKeys(const Block & block_left, const Block & block_right)
 }
 
 
+/// Read the values of a dictionary attribute for the given ids into a column of the corresponding type.
+static MutableColumnPtr readDictionaryColumn(
+    const HashedDictionary & dictionary, const String & attribute_name, const DataTypePtr & type,
+    const PaddedPODArray<UInt64> & ids)
+{
+    MutableColumnPtr column = type->createColumn();
+
+    if (auto * column_string = typeid_cast<ColumnString *>(column.get()))
+    {
+        dictionary.getString(attribute_name, ids, column_string);
+        return column;
+    }
+
+#define DISPATCH(TYPE) \
+    if (auto * column_concrete = typeid_cast<ColumnVector<TYPE> *>(column.get())) \
+    { \
+        column_concrete->getData().resize(ids.size()); \
+        dictionary.get##TYPE(attribute_name, ids, column_concrete->getData()); \
+        return column; \
+    }
+    DISPATCH(UInt8)
+    DISPATCH(UInt16)
+    DISPATCH(UInt32)
+    DISPATCH(UInt64)
+    DISPATCH(UInt128)
+    DISPATCH(Int8)
+    DISPATCH(Int16)
+    DISPATCH(Int32)
+    DISPATCH(Int64)
+    DISPATCH(Float32)
+    DISPATCH(Float64)
+#undef DISPATCH
+#define DISPATCH(TYPE) \
+    if (auto * column_concrete = typeid_cast<ColumnDecimal<TYPE> *>(column.get())) \
+    { \
+        column_concrete->getData().resize(ids.size()); \
+        dictionary.get##TYPE(attribute_name, ids, column_concrete->getData()); \
+        return column; \
+    }
+    DISPATCH(Decimal32)
+    DISPATCH(Decimal64)
+    DISPATCH(Decimal128)
+#undef DISPATCH
+
+    throw Exception("Unsupported type " + type->getName() + " of the dictionary attribute " + attribute_name
+        + " for direct JOIN", ErrorCodes::TYPE_MISMATCH);
+}
+
+
+void Join::joinBlockDictionary(Block & block) const
+{
+    /// The key is a single dictionary id of type UInt64 (possibly Nullable);
+    ///  this is checked in setDictionary and by checkTypesOfKeys.
+    ColumnPtr key_column_holder = block.getByName(key_names_left[0]).column->convertToFullColumnIfConst();
+    ColumnRawPtrs key_columns{key_column_holder.get()};
+
+    ConstNullMapPtr null_map{};
+    ColumnPtr null_map_holder = extractNestedColumnsAndNullMap(key_columns, null_map);
+
+    const ColumnUInt64 * key_column = typeid_cast<const ColumnUInt64 *>(key_columns[0]);
+    if (!key_column)
+        throw Exception("Logical error: the key of a direct dictionary JOIN must have type UInt64", ErrorCodes::LOGICAL_ERROR);
+
+    const auto & ids = key_column->getData();
+    size_t rows = ids.size();
+
+    PaddedPODArray<UInt8> found(rows);
+    hashed_dictionary->has(ids, found);
+
+    /// NULLs never join to anything.
+    if (null_map)
+        for (size_t i = 0; i < rows; ++i)
+            if ((*null_map)[i])
+                found[i] = 0;
+
+    size_t existing_columns = block.columns();
+    size_t num_columns_to_add = sample_block_with_columns_to_add.columns();
+
+    /// The ids are unique in the dictionary, so ALL does not replicate rows and is handled as ANY.
+    bool filter_left_keys = kind == ASTTableJoin::Kind::Inner;
+
+    if (filter_left_keys)
+    {
+        size_t num_kept = countBytesInFilter(found);
+
+        for (size_t i = 0; i < existing_columns; ++i)
+            block.safeGetByPosition(i).column = block.safeGetByPosition(i).column->filter(found, num_kept);
+
+        PaddedPODArray<UInt64> kept_ids;
+        kept_ids.reserve(num_kept);
+        for (size_t i = 0; i < rows; ++i)
+            if (found[i])
+                kept_ids.push_back(ids[i]);
+
+        /// All the kept ids are present in the dictionary, so the getters return the stored values.
+        for (size_t j = 0; j < num_columns_to_add; ++j)
+        {
+            const auto & sample = sample_block_with_columns_to_add.getByPosition(j);
+            block.insert(ColumnWithTypeAndName(
+                readDictionaryColumn(*hashed_dictionary, dict_attribute_by_name.at(sample.name), sample.type, kept_ids),
+                sample.type, sample.name));
+        }
+    }
+    else
+    {
+        /// For the ids that are absent the getters substitute the <null_value> of the attribute,
+        ///  but a LEFT JOIN must substitute the default value of the type - overwrite such rows.
+        for (size_t j = 0; j < num_columns_to_add; ++j)
+        {
+            const auto & sample = sample_block_with_columns_to_add.getByPosition(j);
+            MutableColumnPtr values = readDictionaryColumn(
+                *hashed_dictionary, dict_attribute_by_name.at(sample.name), sample.type, ids);
+
+            MutableColumnPtr added = sample.column->cloneEmpty();
+            added->reserve(rows);
+            for (size_t i = 0; i < rows; ++i)
+            {
+                if (found[i])
+                    added->insertFrom(*values, i);
+                else
+                    added->insertDefault();
+            }
+
+            block.insert(ColumnWithTypeAndName(std::move(added), sample.type, sample.name));
+        }
+    }
+
+    /// Add the join key column from the right table, if it has different name and is required (cf. joinBlockImpl).
+    const auto & right_name = key_names_right[0];
+    if (needed_key_names_right.count(right_name) && !block.has(right_name))
+    {
+        const auto & col = block.getByName(key_names_left[0]);
+        auto column = col.column;
+        if (!filter_left_keys)
+        {
+            auto mut_mapping = ColumnUInt64::create(rows);
+            auto & mapping = mut_mapping->getData();
+            for (size_t i = 0; i < rows; ++i)
+                mapping[i] = found[i] ? i : rows;
+
+            auto mut_column = (*std::move(column)).mutate();
+            mut_column->insertDefault();
+            column = mut_column->index(*mut_mapping, 0);
+        }
+        block.insert({column, col.type, right_name});
+    }
+}
+
+
 void Join::joinBlock(Block & block) const
 {
 //    std::cerr << "joinBlock: " << block.dumpStructure() << "\n";
@@ -903,6 +2160,40 @@ void Join::joinBlock(Block & block) const
 
     checkTypesOfKeys(block, sample_block_with_keys);
 
+    /// The build is complete when the probing starts, so the first probe sorts the per-key lists.
+    if (strictness == ASTTableJoin::Strictness::Asof)
+        std::call_once(asof_sorted_flag, [this] { sortAsofData(); });
+
+    if (hashed_dictionary)
+    {
+        if ((kind == ASTTableJoin::Kind::Left || kind == ASTTableJoin::Kind::Inner)
+            && (strictness == ASTTableJoin::Strictness::Any || strictness == ASTTableJoin::Strictness::All))
+            joinBlockDictionary(block);
+        else
+            throw Exception("Logical error: direct dictionary JOIN is only implemented for ANY/ALL LEFT/INNER JOINs", ErrorCodes::LOGICAL_ERROR);
+        return;
+    }
+
+    if (grace)
+    {
+        if ((kind == ASTTableJoin::Kind::Left || kind == ASTTableJoin::Kind::Inner)
+            && (strictness == ASTTableJoin::Strictness::Any || strictness == ASTTableJoin::Strictness::All))
+            joinBlockGrace(block);
+        else
+            throw Exception("Logical error: grace hash JOIN is only implemented for ANY/ALL LEFT/INNER JOINs", ErrorCodes::LOGICAL_ERROR);
+        return;
+    }
+
+    if (sort_merge)
+    {
+        if ((kind == ASTTableJoin::Kind::Left || kind == ASTTableJoin::Kind::Inner)
+            && (strictness == ASTTableJoin::Strictness::Any || strictness == ASTTableJoin::Strictness::All))
+            joinBlockMerge(block);
+        else
+            throw Exception("Logical error: sort-merge JOIN is only implemented for ANY/ALL LEFT/INNER JOINs", ErrorCodes::LOGICAL_ERROR);
+        return;
+    }
+
     if (kind == ASTTableJoin::Kind::Left && strictness == ASTTableJoin::Strictness::Any)
         joinBlockImpl<ASTTableJoin::Kind::Left, ASTTableJoin::Strictness::Any>(block, maps_any);
     else if (kind == ASTTableJoin::Kind::Inner && strictness == ASTTableJoin::Strictness::Any)
@@ -911,6 +2202,10 @@ void Join::joinBlock(Block & block) const
         joinBlockImpl<ASTTableJoin::Kind::Left, ASTTableJoin::Strictness::All>(block, maps_all);
     else if (kind == ASTTableJoin::Kind::Inner && strictness == ASTTableJoin::Strictness::All)
         joinBlockImpl<ASTTableJoin::Kind::Inner, ASTTableJoin::Strictness::All>(block, maps_all);
+    else if (kind == ASTTableJoin::Kind::Left && strictness == ASTTableJoin::Strictness::Asof)
+        joinBlockImpl<ASTTableJoin::Kind::Left, ASTTableJoin::Strictness::Asof>(block, maps_asof);
+    else if (kind == ASTTableJoin::Kind::Inner && strictness == ASTTableJoin::Strictness::Asof)
+        joinBlockImpl<ASTTableJoin::Kind::Inner, ASTTableJoin::Strictness::Asof>(block, maps_asof);
     else if (kind == ASTTableJoin::Kind::Full && strictness == ASTTableJoin::Strictness::Any)
         joinBlockImpl<ASTTableJoin::Kind::Left, ASTTableJoin::Strictness::Any>(block, maps_any_full);
     else if (kind == ASTTableJoin::Kind::Right && strictness == ASTTableJoin::Strictness::Any)
@@ -932,8 +2227,10 @@ void Join::joinTotals(Block & block) const
 
     if (totals_without_keys)
     {
+        /// The ASOF column stays: it is part of the joined block, like the other non-key columns.
         for (const auto & name : key_names_right)
-            totals_without_keys.erase(totals_without_keys.getPositionByName(name));
+            if (strictness != ASTTableJoin::Strictness::Asof || name != key_names_right.back())
+                totals_without_keys.erase(totals_without_keys.getPositionByName(name));
 
         for (size_t i = 0; i < totals_without_keys.columns(); ++i)
             block.insert(totals_without_keys.safeGetByPosition(i));
@@ -1087,10 +2384,11 @@ private:
     MutableColumns columns_keys_and_right;
 
     std::unique_ptr<void, std::function<void(void *)>> position;    /// type erasure
+    size_t current_shard = 0;    /// Shards of the hash table are traversed one after another.
 
 
     template <ASTTableJoin::Strictness STRICTNESS, typename Maps>
-    Block createBlock(const Maps & maps)
+    Block createBlock(const std::vector<Maps> & maps)
     {
         size_t num_columns_left = column_indices_left.size();
         size_t num_columns_right = column_indices_keys_and_right.size();
@@ -1113,7 +2411,7 @@ private:
         {
         #define M(TYPE) \
             case Join::Type::TYPE: \
-                rows_added = fillColumns<STRICTNESS>(*maps.TYPE, num_columns_left, columns_left, num_columns_right, columns_keys_and_right); \
+                rows_added = fillColumns<STRICTNESS>(&Maps::TYPE, maps, num_columns_left, columns_left, num_columns_right, columns_keys_and_right); \
                 break;
             APPLY_FOR_JOIN_VARIANTS(M)
         #undef M
@@ -1135,33 +2433,40 @@ private:
     }
 
 
-    template <ASTTableJoin::Strictness STRICTNESS, typename Map>
-    size_t fillColumns(const Map & map,
+    template <ASTTableJoin::Strictness STRICTNESS, typename Maps, typename Map>
+    size_t fillColumns(std::unique_ptr<Map> Maps::* map_member, const std::vector<Maps> & maps,
         size_t num_columns_left, MutableColumns & columns_left,
         size_t num_columns_right, MutableColumns & columns_right)
     {
         size_t rows_added = 0;
 
-        if (!position)
-            position = decltype(position)(
-                static_cast<void *>(new typename Map::const_iterator(map.begin())), //-V572
-                [](void * ptr) { delete reinterpret_cast<typename Map::const_iterator *>(ptr); });
+        while (current_shard < maps.size() && rows_added < max_block_size)
+        {
+            const Map & map = *(maps[current_shard].*map_member);
 
-        auto & it = *reinterpret_cast<typename Map::const_iterator *>(position.get());
-        auto end = map.end();
+            if (!position)
+                position = decltype(position)(
+                    static_cast<void *>(new typename Map::const_iterator(map.begin())), //-V572
+                    [](void * ptr) { delete reinterpret_cast<typename Map::const_iterator *>(ptr); });
 
-        for (; it != end; ++it)
-        {
-            if (it->second.getUsed())
-                continue;
+            auto & it = *reinterpret_cast<typename Map::const_iterator *>(position.get());
+            auto end = map.end();
+
+            for (; it != end && rows_added < max_block_size; ++it)
+            {
+                if (it->second.getUsed())
+                    continue;
+
+                AdderNonJoined<STRICTNESS, typename Map::mapped_type>::add(it->second, num_columns_left, columns_left, num_columns_right, columns_right);
 
-            AdderNonJoined<STRICTNESS, typename Map::mapped_type>::add(it->second, num_columns_left, columns_left, num_columns_right, columns_right);
+                ++rows_added;
+            }
 
-            ++rows_added;
-            if (rows_added == max_block_size)
+            if (it == end)
             {
-                ++it;
-                break;
+                /// This shard is done, proceed with the next one.
+                position.reset();
+                ++current_shard;
             }
         }
 
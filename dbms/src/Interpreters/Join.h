@@ -1,6 +1,8 @@
 #pragma once
 
+#include <mutex>
 #include <shared_mutex>
+#include <vector>
 
 #include <Parsers/ASTTablesInSelectQuery.h>
 
@@ -12,6 +14,7 @@
 
 #include <Columns/ColumnString.h>
 #include <Columns/ColumnFixedString.h>
+#include <Columns/ColumnNullable.h>
 
 #include <DataStreams/SizeLimits.h>
 #include <DataStreams/IBlockInputStream.h>
@@ -20,6 +23,9 @@
 namespace DB
 {
 
+struct IDictionaryBase;
+class HashedDictionary;
+
 /// Helpers to obtain keys (to use in a hash table or similar data structure) for various equi-JOINs.
 
 /// UInt8/16/32/64 or another types with same number of bits.
@@ -49,6 +55,10 @@ struct JoinKeyGetterOneNumber
 
     /// Place additional data into memory pool, if needed, when new key was inserted into hash table.
     static void onNewKey(Key & /*key*/, Arena & /*pool*/) {}
+
+    /// The key is cheap to compute twice: allow prefetching the cell for a row ahead while probing.
+    /// (Not for 1-2 byte keys: their tables are small and never miss the cache.)
+    static constexpr bool prefetch_optimization = sizeof(FieldType) > 2;
 };
 
 /// For single String key.
@@ -82,6 +92,9 @@ struct JoinKeyGetterString
     {
         key.data = pool.insert(key.data, key.size);
     }
+
+    /// Hashing a string key twice would cost about as much as the miss it hides.
+    static constexpr bool prefetch_optimization = false;
 };
 
 /// For single FixedString key.
@@ -113,6 +126,8 @@ struct JoinKeyGetterFixedString
     {
         key.data = pool.insert(key.data, key.size);
     }
+
+    static constexpr bool prefetch_optimization = false;
 };
 
 /// For keys of fixed size, that could be packed in sizeof TKey width.
@@ -135,6 +150,8 @@ struct JoinKeyGetterFixed
     }
 
     static void onNewKey(Key &, Arena &) {}
+
+    static constexpr bool prefetch_optimization = true;
 };
 
 /// Generic method, use crypto hash function.
@@ -156,6 +173,9 @@ struct JoinKeyGetterHashed
     }
 
     static void onNewKey(Key &, Arena &) {}
+
+    /// The key itself is a cryptographic hash: computing it twice is too expensive.
+    static constexpr bool prefetch_optimization = false;
 };
 
 
@@ -180,7 +200,13 @@ struct JoinKeyGetterHashed
   * Thus, LEFT and RIGHT JOINs are not symmetric in terms of implementation.
   *
   * All JOINs (except CROSS) are done by equality condition on keys (equijoin).
-  * Non-equality and other conditions are not supported.
+  * Non-equality and other conditions are not supported, with one exception:
+  *
+  * ASOF JOIN matches every row of the left table with the last row of the right table having
+  *  the same equality keys and not greater value of the ASOF column (the last key; typically a timestamp).
+  * The rows of every equality key are kept in an array sorted by the ASOF column value,
+  *  and the row to join is found by binary search at probe time.
+  * Only LEFT and INNER ASOF JOINs with the hash algorithm are supported.
   *
   * Implementation:
   *
@@ -215,12 +241,66 @@ struct JoinKeyGetterHashed
   *  (zero, empty string, etc. and NULL for Nullable data types).
   * If it is true, we always generate Nullable column and substitute NULLs for non-joined rows,
   *  as in standard SQL.
+  *
+  * Partitioned (shuffle) mode:
+  *
+  * The hash table can be split by key hash into several independent shards (see the join_algorithm setting).
+  * Rows of the right table are scattered to the shards, so insertFromBlock can be called from several threads:
+  *  every shard is filled under its own mutex, and threads only contend when they hit the same shard.
+  * Probing selects the shard by the same hash and needs no synchronization at all,
+  *  because it starts only after the build is complete.
+  *
+  * Sort-merge mode:
+  *
+  * Instead of a hash table, the right table can be sorted by the key columns and the join done by merging
+  *  (see the 'merge' and 'auto' values of the join_algorithm setting).
+  * The sort goes through MergeSortingBlockInputStream and can spill to disk, so the build phase
+  *  is not limited by the size of the hash table. Every block of the left table is then sorted
+  *  by the keys and merged with the sorted right table in one forward pass.
+  * Only ANY/ALL LEFT/INNER JOINs are supported in this mode.
+  *
+  * Grace hash mode:
+  *
+  * The right table is scattered by a hash of the key into partitions on disk (compressed temporary files
+  *  under tmp_path), so the build phase uses almost no memory. Every block of the left table is scattered
+  *  by the same hash, and each part is joined against an ordinary in-memory hash join built from the
+  *  corresponding partition. The per-partition joins are cached with LRU eviction within max_bytes_in_join,
+  *  so with a skewed probe side the hot partitions are built only once.
+  * Only ANY/ALL LEFT/INNER JOINs are supported in this mode.
+  *
+  * Direct dictionary mode:
+  *
+  * When the right table only represents an external dictionary of the Hashed layout
+  *  and the JOIN is an equality by the dictionary id, there is no need to build anything:
+  *  the dictionary already is a hash table from id to attributes that lives across queries.
+  * In this mode (see setDictionary) insertFromBlock is never called, and joinBlock probes
+  *  the dictionary with 'has' and the attribute getters, as the dictGet functions do.
+  * Supported for ANY/ALL LEFT/INNER JOINs; for a dictionary the ids are unique,
+  *  so ALL is equivalent to ANY.
   */
 class Join
 {
 public:
+    /// Which algorithm the join uses. See the join_algorithm setting.
+    enum class Algorithm
+    {
+        HASH,          /// Hash table from the right table (possibly partitioned, see shards_).
+        SORT_MERGE,    /// Sort both sides by the key columns and merge.
+        AUTO,          /// Start as HASH; convert to SORT_MERGE when the size limits for the hash table are exceeded.
+        GRACE_HASH,    /// Scatter both sides by key hash into partitions on disk, join partition pairs in memory.
+    };
+
+    /// shards_ - into how many partitions to split the hash table (rounded up to a power of two).
+    /// More than one is only allowed when insertFromBlock and joinBlock are not used simultaneously (i.e. not for StorageJoin).
+    /// max_bytes_before_external_sort_ and tmp_path_ are for the external sort of the right table in sort-merge mode;
+    ///  tmp_path_ also holds the partitions of the grace hash mode, and grace_buckets_ is their number (rounded up to a power of two).
     Join(const Names & key_names_left_, const Names & key_names_right_, const NameSet & needed_key_names_right_,
-         bool use_nulls_, const SizeLimits & limits, ASTTableJoin::Kind kind_, ASTTableJoin::Strictness strictness_);
+         bool use_nulls_, const SizeLimits & limits, ASTTableJoin::Kind kind_, ASTTableJoin::Strictness strictness_,
+         size_t shards_ = 1, Algorithm algorithm_ = Algorithm::HASH,
+         size_t max_bytes_before_external_sort_ = 0, const String & tmp_path_ = "",
+         size_t grace_buckets_ = 0, size_t runtime_filter_bytes_ = 0);
+
+    ~Join();
 
     bool empty() { return type == Type::EMPTY; }
 
@@ -229,11 +309,23 @@ public:
       */
     void setSampleBlock(const Block & block);
 
+    /** Switch the join into direct dictionary lookup mode (see the class comment).
+      * 'attribute_by_name' maps every column this join adds to the name of a dictionary attribute.
+      * The dictionary must have the Hashed layout; insertFromBlock must not be called after that.
+      */
+    void setDictionary(const std::shared_ptr<const IDictionaryBase> & dictionary_, const NameToNameMap & attribute_by_name_);
+
     /** Add block of data from right hand of JOIN to the map.
       * Returns false, if some limit was exceeded and you should not insert more data.
+      * If the join is partitioned (shards > 1), could be called from different threads in parallel.
       */
     bool insertFromBlock(const Block & block);
 
+    /// Whether insertFromBlock can be called from several threads in parallel.
+    bool buildsInParallel() const { return shards > 1; }
+    /// How many threads it makes sense to use for the build.
+    size_t getBuildConcurrency() const { return build_concurrency; }
+
     /** Join data from the map (that was previously built by calls to insertFromBlock) to the block with data from "left" table.
       * Could be called from different threads in parallel.
       */
@@ -260,6 +352,20 @@ public:
 
     ASTTableJoin::Kind getKind() const { return kind; }
 
+    const Names & getKeyNamesLeft() const { return key_names_left; }
+
+    /** Runtime filter: a Bloom filter over hashes of the keys of the right table, built during insertFromBlock
+      *  (see the join_runtime_filter setting). It allows to drop rows of the left table that surely will not
+      *  be joined, before they reach the probe - and, if applied near the source, before further processing.
+      * It must be applied only when dropping non-joined left rows does not change the result
+      *  (INNER and RIGHT joins).
+      */
+    bool hasRuntimeFilter() const { return runtime_filter != nullptr; }
+
+    /// Remove the rows whose keys surely do not match any key of the right table. Keeps the block structure.
+    /// Does nothing if some of the key columns are not yet in the block.
+    void filterBlockByRuntimeFilter(Block & block) const;
+
 
     /// Reference to the row in block.
     struct RowRef
@@ -280,6 +386,33 @@ public:
         RowRefList(const Block * block_, size_t row_num_) : RowRef(block_, row_num_) {}
     };
 
+    /** All rows with the same equality key, ordered by the value of the ASOF column. Used for ASOF JOIN.
+      * During the build the rows are accumulated in a single linked list;
+      *  before the first probe the list is converted into an array sorted by value (see sortAsofData),
+      *  and the row to join is found by binary search.
+      */
+    struct AsofRowRefs
+    {
+        struct Entry
+        {
+            UInt64 value;    /// The ASOF column value, mapped to UInt64 preserving the order of the original type.
+            RowRef row;
+        };
+
+        struct ListEntry
+        {
+            Entry entry;
+            ListEntry * next;
+        };
+
+        ListEntry * list = nullptr;    /// Filled during the build. Allocated in the arena of the shard.
+        Entry * sorted = nullptr;      /// Built from 'list', ordered by ascending value.
+        size_t count = 0;
+
+        /// The row with the greatest value of the ASOF column not greater than the given one, or nullptr.
+        const RowRef * findAsof(UInt64 value) const;
+    };
+
 
     /** Depending on template parameter, adds or doesn't add a flag, that element was used (row was joined).
       * For implementation of RIGHT and FULL JOINs.
@@ -350,6 +483,7 @@ public:
     using MapsAll = MapsTemplate<WithUsedFlag<false, RowRefList>>;
     using MapsAnyFull = MapsTemplate<WithUsedFlag<true, RowRef>>;
     using MapsAllFull = MapsTemplate<WithUsedFlag<true, RowRefList>>;
+    using MapsAsof = MapsTemplate<WithUsedFlag<false, AsofRowRefs>>;
 
 private:
     friend class NonJoinedBlockInputStream;
@@ -367,17 +501,62 @@ private:
     /// Substitute NULLs for non-JOINed rows.
     bool use_nulls;
 
+    /// See the Algorithm enum. 'sort_merge' becomes true either right away (SORT_MERGE) or after conversion (AUTO).
+    Algorithm algorithm = Algorithm::HASH;
+    bool sort_merge = false;
+
+    /// For the external sort of the right table in sort-merge mode.
+    size_t max_bytes_before_external_sort = 0;
+    String tmp_path;
+
+    /// Blocks of the right table, sorted by the key columns. Filled lazily, at the moment of the first probe.
+    mutable Blocks sorted_blocks;
+    mutable std::once_flag sorted_blocks_flag;
+
+    /// The whole state of the grace hash mode: partitions of the right table on disk
+    ///  and the cache of in-memory joins built from them. Defined in the .cpp file.
+    struct GraceState;
+    std::unique_ptr<GraceState> grace;
+
+    /// See hasRuntimeFilter. Defined in the .cpp file.
+    struct RuntimeFilter;
+    std::unique_ptr<RuntimeFilter> runtime_filter;
+
+    /// For the direct dictionary mode. The shared_ptr pins one version of the dictionary
+    ///  for the lifetime of the join, so reloads do not affect a running query.
+    std::shared_ptr<const IDictionaryBase> dictionary;
+    const HashedDictionary * hashed_dictionary = nullptr;
+    /// Dictionary attribute name for every column of sample_block_with_columns_to_add.
+    NameToNameMap dict_attribute_by_name;
+
     /** Blocks of "right" table.
       */
     BlocksList blocks;
 
-    MapsAny maps_any;            /// For ANY LEFT|INNER JOIN
-    MapsAll maps_all;            /// For ALL LEFT|INNER JOIN
-    MapsAnyFull maps_any_full;    /// For ANY RIGHT|FULL JOIN
-    MapsAllFull maps_all_full;    /// For ALL RIGHT|FULL JOIN
+    /// Into how many independent partitions the hash table is split (a power of two; 1 for the classic hash join).
+    size_t shards = 1;
+    /// shards - 1; the shard of a key is (hash of the key) & shard_mask.
+    size_t shard_mask = 0;
+    /// How many threads to use for a parallel build (the number of shards requested, before rounding up).
+    size_t build_concurrency = 1;
+
+    /// One element per shard.
+    std::vector<MapsAny> maps_any;            /// For ANY LEFT|INNER JOIN
+    std::vector<MapsAll> maps_all;            /// For ALL LEFT|INNER JOIN
+    std::vector<MapsAnyFull> maps_any_full;    /// For ANY RIGHT|FULL JOIN
+    std::vector<MapsAllFull> maps_all_full;    /// For ALL RIGHT|FULL JOIN
+    std::vector<MapsAsof> maps_asof;        /// For ASOF LEFT|INNER JOIN
 
-    /// Additional data - strings for string keys and continuation elements of single-linked lists of references to rows.
-    Arena pool;
+    /// ASOF JOIN: the per-key lists are converted into sorted arrays once, before the first probe.
+    mutable std::once_flag asof_sorted_flag;
+
+    /// Additional data - strings for string keys and continuation elements of single-linked lists of references to rows. One per shard.
+    std::vector<std::unique_ptr<Arena>> pools;
+
+    /// Protects 'blocks' when several threads insert in parallel.
+    mutable std::mutex storage_mutex;
+    /// Every shard of the hash tables (and its arena) is protected by its own mutex during the build.
+    std::unique_ptr<std::mutex[]> shard_mutexes;
 
 private:
     Type type = Type::EMPTY;
@@ -407,11 +586,41 @@ private:
 
     void init(Type type_);
 
+    /// Whether the key columns are kept (at the beginning) in the stored blocks of the right table.
+    bool storesKeysInBlocks() const { return algorithm != Algorithm::HASH; }
+
+    /// For the AUTO algorithm: drop the hash tables and continue as sort-merge.
+    void convertToSortMerge();
+
+    /// Sort the accumulated blocks of the right table by the key columns (with external sort, if needed).
+    void sortRightBlocks() const;
+
+    /// ASOF JOIN: convert the per-key lists of rows into arrays sorted by the ASOF column value.
+    void sortAsofData() const;
+
+    /// Join a block of the left table by merging it with the sorted right table.
+    void joinBlockMerge(Block & block) const;
+
+    /// Scatter a block of the right table to the partitions on disk.
+    void insertFromBlockGrace(const Block & block, const ColumnRawPtrs & key_columns, size_t rows);
+
+    /// Join a block of the left table by scattering it and probing the per-partition joins.
+    void joinBlockGrace(Block & block) const;
+
+    /// Get the in-memory join for a partition, building it from the spilled blocks if it is not cached.
+    std::shared_ptr<Join> getGraceBucketJoin(size_t bucket_num) const;
+
+    /// Add the key hashes of a block of the right table to the runtime filter.
+    void addBlockToRuntimeFilter(const ColumnRawPtrs & key_columns, ConstNullMapPtr null_map, size_t rows);
+
+    /// Join a block of the left table by direct lookups into the dictionary.
+    void joinBlockDictionary(Block & block) const;
+
     /// Throw an exception if blocks have different types of key columns.
     void checkTypesOfKeys(const Block & block_left, const Block & block_right) const;
 
     template <ASTTableJoin::Kind KIND, ASTTableJoin::Strictness STRICTNESS, typename Maps>
-    void joinBlockImpl(Block & block, const Maps & maps) const;
+    void joinBlockImpl(Block & block, const std::vector<Maps> & maps) const;
 
     void joinBlockImplCross(Block & block) const;
 };
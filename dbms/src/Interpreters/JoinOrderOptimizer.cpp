@@ -0,0 +1,149 @@
+#include <Interpreters/JoinOrderOptimizer.h>
+
+#include <Common/typeid_cast.h>
+#include <Interpreters/Context.h>
+#include <Interpreters/DatabaseAndTableWithAlias.h>
+#include <Parsers/ASTExpressionList.h>
+#include <Parsers/ASTIdentifier.h>
+#include <Parsers/ASTSelectQuery.h>
+#include <Parsers/ASTTablesInSelectQuery.h>
+#include <Storages/MergeTree/MergeTreeColumnStatistics.h>
+#include <Storages/StorageMergeTree.h>
+#include <Storages/StorageReplicatedMergeTree.h>
+
+
+namespace DB
+{
+
+namespace
+{
+
+/// Do not swap when the sides differ less than this much: the estimates are not exact
+/// and the swap changes the order of columns of SELECT *.
+constexpr size_t swap_ratio = 2;
+
+
+const MergeTreeData * getMergeTreeData(const IStorage * storage)
+{
+    if (const auto * merge_tree = dynamic_cast<const StorageMergeTree *>(storage))
+        return &merge_tree->getData();
+    if (const auto * replicated = dynamic_cast<const StorageReplicatedMergeTree *>(storage))
+        return &replicated->getData();
+    return nullptr;
+}
+
+/// Sum of the key NDVs of the per-part statistics, or 0 if any key has no statistics.
+size_t getJoinKeysNDV(const MergeTreeData & data, const Names & key_names)
+{
+    MergeTreePartColumnStatistics statistics = data.getAggregatedColumnStatistics();
+
+    size_t res = 0;
+    for (const auto & name : key_names)
+    {
+        auto it = statistics.columns.find(name);
+        if (it == statistics.columns.end())
+            return 0;
+        res += it->second.getNDV();
+    }
+    return res;
+}
+
+}
+
+
+JoinOrderOptimizer::JoinOrderOptimizer(ASTSelectQuery * select_query_, const Context & context_)
+    : select_query(select_query_), context(context_)
+{
+}
+
+
+void JoinOrderOptimizer::perform()
+{
+    if (!select_query || !select_query->tables)
+        return;
+
+    auto & tables = select_query->tables->children;
+    if (tables.size() != 2)
+        return;
+
+    auto * left_element = typeid_cast<ASTTablesInSelectQueryElement *>(tables[0].get());
+    auto * right_element = typeid_cast<ASTTablesInSelectQueryElement *>(tables[1].get());
+    if (!left_element || !right_element
+        || !left_element->table_expression || left_element->array_join
+        || !right_element->table_expression || !right_element->table_join)
+        return;
+
+    const auto & join = typeid_cast<const ASTTableJoin &>(*right_element->table_join);
+
+    /// The swap is an equivalence only for ALL INNER joins: for ANY joins the choice of
+    /// the matched row depends on the side, for outer joins the filling of non-joined
+    /// rows does, and a GLOBAL join sends its right side over the network.
+    if (join.kind != ASTTableJoin::Kind::Inner || join.locality == ASTTableJoin::Locality::Global)
+        return;
+
+    auto strictness = join.strictness;
+    if (strictness == ASTTableJoin::Strictness::Unspecified
+        && context.getSettingsRef().join_default_strictness.value == JoinStrictness::ALL)
+        strictness = ASTTableJoin::Strictness::All;
+    if (strictness != ASTTableJoin::Strictness::All)
+        return;
+
+    /// Both sides must be plain tables of the MergeTree family: for subqueries and
+    /// table functions there is nothing to take the estimates from.
+    auto left_table = getDatabaseAndTable(*select_query, 0);
+    auto right_table = getDatabaseAndTable(*select_query, 1);
+    if (!left_table || !right_table)
+        return;
+
+    StoragePtr left_storage = context.tryGetTable(left_table->database, left_table->table);
+    StoragePtr right_storage = context.tryGetTable(right_table->database, right_table->table);
+
+    const MergeTreeData * left_data = getMergeTreeData(left_storage.get());
+    const MergeTreeData * right_data = getMergeTreeData(right_storage.get());
+    if (!left_data || !right_data)
+        return;
+
+    size_t left_rows = left_data->getTotalActiveRows();
+    size_t right_rows = right_data->getTotalActiveRows();
+
+    bool should_swap = false;
+    if (right_rows > left_rows * swap_ratio)
+    {
+        should_swap = true;
+    }
+    else if (right_rows > left_rows && join.using_expression_list)
+    {
+        /// The row counts are close - refine the estimate with the NDV of the join keys
+        /// from the column statistics: the hash table also spends memory on buckets,
+        /// one per distinct key. Reading the statistics costs one small file per part,
+        /// so it is done only in this inconclusive case.
+        Names key_names;
+        for (const auto & key : join.using_expression_list->children)
+        {
+            const auto * identifier = typeid_cast<const ASTIdentifier *>(key.get());
+            if (!identifier)
+                return;
+            key_names.push_back(identifier->name);
+        }
+
+        size_t left_ndv = getJoinKeysNDV(*left_data, key_names);
+        size_t right_ndv = getJoinKeysNDV(*right_data, key_names);
+
+        if (left_ndv && right_ndv)
+            should_swap = right_rows + right_ndv > (left_rows + left_ndv) * swap_ratio;
+    }
+
+    if (!should_swap)
+        return;
+
+    std::swap(left_element->table_expression, right_element->table_expression);
+
+    /// The children lists must stay consistent with the members.
+    left_element->children.clear();
+    left_element->children.push_back(left_element->table_expression);
+    right_element->children.clear();
+    right_element->children.push_back(right_element->table_join);
+    right_element->children.push_back(right_element->table_expression);
+}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <Parsers/IAST.h>
+
+
+namespace DB
+{
+
+class Context;
+class ASTSelectQuery;
+
+
+/** Chooses the build side of a JOIN by estimated cost.
+  *
+  * The hash table of a JOIN is always built from the right-hand table, and a query with
+  * the big table on the right wastes memory for no reason. When both sides of an INNER
+  * join are plain MergeTree tables, this rewriter compares their sizes (exact row counts
+  * from the parts; the NDV of the join keys from the per-part statistics when the row
+  * counts alone are inconclusive - see MergeTreeColumnStatistics.h) and swaps the sides
+  * of the AST so that the smaller table is hashed.
+  *
+  * Only ALL INNER joins are rewritten: for ANY joins the choice of the matched row
+  * depends on the side, and for outer joins the filling of non-joined rows does.
+  * A query with chained joins is a chain of subqueries in this version, and each
+  * subquery gets rewritten on its own, so the whole chain is reordered pairwise.
+  *
+  * Enabled by the optimize_join_build_side setting; leave it off to pin the written order.
+  */
+class JoinOrderOptimizer
+{
+public:
+    JoinOrderOptimizer(ASTSelectQuery * select_query_, const Context & context_);
+
+    /// Swaps the sides of the JOIN in the AST if the estimated cost favors it.
+    void perform();
+
+    JoinOrderOptimizer(const JoinOrderOptimizer &) = delete;
+    JoinOrderOptimizer & operator=(const JoinOrderOptimizer &) = delete;
+
+private:
+    ASTSelectQuery * select_query;
+    const Context & context;
+};
+
+}
@@ -0,0 +1,136 @@
+#include <Interpreters/MetricLog.h>
+#include <Common/Exception.h>
+#include <Columns/ColumnsNumber.h>
+#include <DataTypes/DataTypesNumber.h>
+#include <DataTypes/DataTypeDateTime.h>
+#include <DataTypes/DataTypeDate.h>
+#include <common/DateLUT.h>
+
+#include <thread>
+
+
+namespace DB
+{
+
+Block MetricLogElement::createBlock()
+{
+    ColumnsWithTypeAndName columns_with_type_and_name;
+
+    columns_with_type_and_name.emplace_back(std::make_shared<DataTypeDate>(),      "event_date");
+    columns_with_type_and_name.emplace_back(std::make_shared<DataTypeDateTime>(),  "event_time");
+    columns_with_type_and_name.emplace_back(std::make_shared<DataTypeUInt64>(),    "milliseconds");
+
+    for (size_t i = 0, end = ProfileEvents::end(); i < end; ++i)
+    {
+        std::string name;
+        name += "ProfileEvent_";
+        name += ProfileEvents::getName(ProfileEvents::Event(i));
+        columns_with_type_and_name.emplace_back(std::make_shared<DataTypeUInt64>(), std::move(name));
+    }
+
+    for (size_t i = 0, end = CurrentMetrics::end(); i < end; ++i)
+    {
+        std::string name;
+        name += "CurrentMetric_";
+        name += CurrentMetrics::getName(CurrentMetrics::Metric(i));
+        columns_with_type_and_name.emplace_back(std::make_shared<DataTypeInt64>(), std::move(name));
+    }
+
+    return Block(columns_with_type_and_name);
+}
+
+
+void MetricLogElement::appendToBlock(Block & block) const
+{
+    MutableColumns columns = block.mutateColumns();
+
+    size_t column_idx = 0;
+
+    columns[column_idx++]->insert(DateLUT::instance().toDayNum(event_time));
+    columns[column_idx++]->insert(event_time);
+    columns[column_idx++]->insert(milliseconds);
+
+    for (size_t i = 0, end = ProfileEvents::end(); i < end; ++i)
+        columns[column_idx++]->insert(profile_events[i]);
+
+    for (size_t i = 0, end = CurrentMetrics::end(); i < end; ++i)
+        columns[column_idx++]->insert(current_metrics[i]);
+}
+
+
+MetricLog::~MetricLog()
+{
+    stopCollectMetric();
+}
+
+
+void MetricLog::startCollectMetric(size_t collect_interval_milliseconds_)
+{
+    collect_interval_milliseconds = collect_interval_milliseconds_;
+    is_shutdown_metric_thread = false;
+    metric_flush_thread = ThreadFromGlobalPool([this] { metricThreadFunction(); });
+}
+
+
+void MetricLog::stopCollectMetric()
+{
+    bool old_val = false;
+    if (!is_shutdown_metric_thread.compare_exchange_strong(old_val, true))
+        return;
+    if (metric_flush_thread.joinable())
+        metric_flush_thread.join();
+}
+
+
+void MetricLog::metricThreadFunction()
+{
+    setThreadName("MetricLog");
+
+    auto desired_timepoint = std::chrono::system_clock::now();
+
+    /// Values of the previous iteration, to log deltas of the profile events.
+    std::vector<ProfileEvents::Count> prev_profile_events(ProfileEvents::end());
+
+    while (!is_shutdown_metric_thread)
+    {
+        try
+        {
+            const auto current_time = std::chrono::system_clock::now();
+
+            MetricLogElement elem;
+            elem.event_time = std::chrono::system_clock::to_time_t(current_time);
+            elem.milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(current_time.time_since_epoch()).count() % 1000;
+
+            /// One snapshot per interval is all the overhead: it also picks up increments
+            ///  that threads have not propagated to the global counters yet.
+            const auto counters = ProfileEvents::global_counters.getPartiallyAtomicSnapshot();
+
+            elem.profile_events.resize(ProfileEvents::end());
+            for (size_t i = 0, end = ProfileEvents::end(); i < end; ++i)
+            {
+                const ProfileEvents::Count new_value = counters[i].load(std::memory_order_relaxed);
+                elem.profile_events[i] = new_value - prev_profile_events[i];
+                prev_profile_events[i] = new_value;
+            }
+
+            elem.current_metrics.resize(CurrentMetrics::end());
+            for (size_t i = 0, end = CurrentMetrics::end(); i < end; ++i)
+                elem.current_metrics[i] = CurrentMetrics::values[i].load(std::memory_order_relaxed);
+
+            add(elem);
+
+            /// Record current time into the table, but align the collection to regular intervals.
+            desired_timepoint += std::chrono::milliseconds(collect_interval_milliseconds);
+            while (desired_timepoint <= std::chrono::system_clock::now())
+                desired_timepoint += std::chrono::milliseconds(collect_interval_milliseconds);
+
+            std::this_thread::sleep_until(desired_timepoint);
+        }
+        catch (...)
+        {
+            tryLogCurrentException(__PRETTY_FUNCTION__);
+        }
+    }
+}
+
+}
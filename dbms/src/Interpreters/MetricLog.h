@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Interpreters/SystemLog.h>
+#include <Common/ProfileEvents.h>
+#include <Common/CurrentMetrics.h>
+#include <Common/ThreadPool.h>
+
+#include <vector>
+#include <atomic>
+#include <ctime>
+
+
+namespace DB
+{
+
+/** One row per collection interval: deltas of all profile events over the interval
+  *  and current values of all metrics. Makes server-wide activity history queryable
+  *  with plain SQL for post-incident analysis and capacity planning.
+  */
+struct MetricLogElement
+{
+    time_t event_time{};
+    UInt64 milliseconds{};
+
+    std::vector<ProfileEvents::Count> profile_events;
+    std::vector<Int64> current_metrics;
+
+    static std::string name() { return "MetricLog"; }
+    static Block createBlock();
+    void appendToBlock(Block & block) const;
+};
+
+
+class MetricLog : public SystemLog<MetricLogElement>
+{
+    using SystemLog<MetricLogElement>::SystemLog;
+
+public:
+    ~MetricLog();
+
+    /// Launches a background thread that adds one record with current metric values every interval.
+    void startCollectMetric(size_t collect_interval_milliseconds_);
+
+    /// Stop background thread. Call before destructor.
+    void stopCollectMetric();
+
+private:
+    void metricThreadFunction();
+
+    ThreadFromGlobalPool metric_flush_thread;
+    size_t collect_interval_milliseconds;
+    std::atomic<bool> is_shutdown_metric_thread{false};
+};
+
+}
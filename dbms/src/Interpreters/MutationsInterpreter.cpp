@@ -38,19 +38,19 @@ bool MutationsInterpreter::isStorageTouchedByMutations() const
             return true;
     }
 
-    /// Execute `SELECT count() FROM storage WHERE predicate1 OR predicate2 OR ...` query.
-    /// The result can differ from tne number of affected rows (e.g. if there is an UPDATE command that
-    /// changes how many rows satisfy the predicates of the subsequent commands).
-    /// But we can be sure that if count = 0, then no rows will be touched.
+    /// Execute `SELECT 1 FROM storage WHERE predicate1 OR predicate2 OR ... LIMIT 1` query.
+    /// The predicates can select rows that won't actually be changed (e.g. if there is an UPDATE command
+    /// that changes how many rows satisfy the predicates of the subsequent commands).
+    /// But we can be sure that if the query returns nothing, then no rows will be touched.
+    /// Thanks to LIMIT 1 the query stops reading as soon as a single matching row is found, and a part
+    /// whose primary key or minmax index ranges prove the absence of matching rows is skipped without
+    /// reading any data at all.
 
     auto select = std::make_shared<ASTSelectQuery>();
 
     select->select_expression_list = std::make_shared<ASTExpressionList>();
     select->children.push_back(select->select_expression_list);
-    auto count_func = std::make_shared<ASTFunction>();
-    count_func->name = "count";
-    count_func->arguments = std::make_shared<ASTExpressionList>();
-    select->select_expression_list->children.push_back(count_func);
+    select->select_expression_list->children.push_back(std::make_shared<ASTLiteral>(Field(1u)));
 
     if (commands.size() == 1)
         select->where_expression = commands[0].predicate;
@@ -68,6 +68,9 @@ bool MutationsInterpreter::isStorageTouchedByMutations() const
     }
     select->children.push_back(select->where_expression);
 
+    select->limit_length = std::make_shared<ASTLiteral>(Field(1u));
+    select->children.push_back(select->limit_length);
+
     auto context_copy = context;
     context_copy.getSettingsRef().merge_tree_uniform_read_distribution = 0;
     context_copy.getSettingsRef().max_threads = 1;
@@ -75,15 +78,11 @@ bool MutationsInterpreter::isStorageTouchedByMutations() const
     InterpreterSelectQuery interpreter_select(select, context_copy, storage, QueryProcessingStage::Complete);
     BlockInputStreamPtr in = interpreter_select.execute().in;
 
-    Block block = in->read();
-    if (!block.rows())
-        return false;
-    else if (block.rows() != 1)
-        throw Exception("count() expression returned " + toString(block.rows()) + " rows, not 1",
-            ErrorCodes::LOGICAL_ERROR);
+    while (Block block = in->read())
+        if (block.rows())
+            return true;
 
-    auto count = (*block.getByName("count()").column)[0].get<UInt64>();
-    return count != 0;
+    return false;
 }
 
 
@@ -69,6 +69,50 @@ ProcessList::ProcessList(size_t max_size_)
     : max_size(max_size_)
 {
     total_memory_tracker.setMetric(CurrentMetrics::MemoryTracking);
+    total_memory_tracker.setSoftLimitCallback([this] { requestMemoryPressure(); });
+}
+
+
+void ProcessList::requestMemoryPressure()
+{
+    /// Called from an allocating thread. Don't ever block the allocation on the process list:
+    ///  if it is busy, just skip - the callback is rearmed when total consumption goes under the soft limit.
+    std::unique_lock lock(mutex, std::try_to_lock);
+    if (!lock.owns_lock())
+        return;
+
+    MemoryTracker * largest = nullptr;
+    size_t largest_priority = 0;
+    Int64 largest_amount = 0;
+    bool largest_is_over_soft_limit = false;
+
+    for (auto & process : processes)
+    {
+        if (!process.thread_group)
+            continue;
+
+        MemoryTracker & tracker = process.thread_group->memory_tracker;
+        Int64 tracker_amount = tracker.get();
+        Int64 tracker_soft_limit = tracker.getSoftLimit();
+        bool over_soft_limit = tracker_soft_limit && tracker_amount > tracker_soft_limit;
+
+        /// Prefer, in this order: queries of the lowest priority class,
+        ///  queries over their own soft limit, the largest query.
+        if (!largest
+            || process.priority > largest_priority
+            || (process.priority == largest_priority
+                && ((over_soft_limit && !largest_is_over_soft_limit)
+                    || (over_soft_limit == largest_is_over_soft_limit && tracker_amount > largest_amount))))
+        {
+            largest = &tracker;
+            largest_priority = process.priority;
+            largest_amount = tracker_amount;
+            largest_is_over_soft_limit = over_soft_limit;
+        }
+    }
+
+    if (largest)
+        largest->requestPressure();
 }
 
 
@@ -95,6 +139,19 @@ ProcessList::EntryPtr ProcessList::insert(const String & query_, const IAST * as
                 throw Exception("Too many simultaneous queries. Maximum: " + toString(max_size), ErrorCodes::TOO_MANY_SIMULTANEOUS_QUERIES);
         }
 
+        /// Admission control for the low priority class: queries with nonzero priority must not
+        ///  occupy all slots, so that queries of the high priority class are always admitted promptly.
+        if (!is_unlimited_query && settings.priority && settings.max_concurrent_queries_for_low_priority
+            && low_priority_queries >= settings.max_concurrent_queries_for_low_priority)
+        {
+            auto max_wait_ms = settings.queue_max_wait_ms.totalMilliseconds();
+
+            if (!max_wait_ms || !have_space.wait_for(lock, std::chrono::milliseconds(max_wait_ms),
+                    [&]{ return low_priority_queries < settings.max_concurrent_queries_for_low_priority; }))
+                throw Exception("Too many simultaneous low priority queries. Maximum: "
+                    + settings.max_concurrent_queries_for_low_priority.toString(), ErrorCodes::TOO_MANY_SIMULTANEOUS_QUERIES);
+        }
+
         /** Why we use current user?
           * Because initial one is passed by client and credentials for it is not verified,
           *  and using initial_user for limits will be insecure.
@@ -132,7 +189,11 @@ ProcessList::EntryPtr ProcessList::insert(const String & query_, const IAST * as
         }
 
         auto process_it = processes.emplace(processes.end(),
-            query_, client_info, settings.max_memory_usage, settings.memory_tracker_fault_probability, priorities.insert(settings.priority));
+            query_, client_info, settings.max_memory_usage, settings.memory_tracker_fault_probability,
+            settings.priority, priorities.insert(settings.priority));
+
+        if (process_it->priority)
+            ++low_priority_queries;
 
         res = std::make_shared<Entry>(*this, process_it);
 
@@ -156,6 +217,9 @@ ProcessList::EntryPtr ProcessList::insert(const String & query_, const IAST * as
             total_memory_tracker.setOrRaiseLimit(settings.max_memory_usage_for_all_queries);
             total_memory_tracker.setDescription("(total)");
 
+            if (settings.memory_usage_soft_limit_ratio > 0)
+                total_memory_tracker.setOrRaiseSoftLimit(settings.max_memory_usage_for_all_queries * settings.memory_usage_soft_limit_ratio);
+
             /// Track memory usage for all simultaneously running queries from single user.
             user_process_list.user_memory_tracker.setParent(&total_memory_tracker);
             user_process_list.user_memory_tracker.setOrRaiseLimit(settings.max_memory_usage_for_user);
@@ -172,6 +236,9 @@ ProcessList::EntryPtr ProcessList::insert(const String & query_, const IAST * as
                 /// Set query-level memory trackers
                 thread_group->memory_tracker.setOrRaiseLimit(process_it->max_memory_usage);
                 thread_group->memory_tracker.setDescription("(for query)");
+
+                if (settings.memory_usage_soft_limit_ratio > 0)
+                    thread_group->memory_tracker.setOrRaiseSoftLimit(process_it->max_memory_usage * settings.memory_usage_soft_limit_ratio);
                 if (process_it->memory_tracker_fault_probability)
                     thread_group->memory_tracker.setFaultProbability(process_it->memory_tracker_fault_probability);
 
@@ -212,6 +279,9 @@ ProcessListEntry::~ProcessListEntry()
 
     const QueryStatus * process_list_element_ptr = &*it;
 
+    if (it->priority)
+        --parent.low_priority_queries;
+
     /// This removes the memory_tracker of one request.
     parent.processes.erase(it);
 
@@ -246,7 +316,8 @@ ProcessListEntry::~ProcessListEntry()
         std::terminate();
     }
 
-    parent.have_space.notify_one();
+    /// There are waiters with different predicates (total and per-class limits), so wake all of them.
+    parent.have_space.notify_all();
 
     /// If there are no more queries for the user, then we will reset memory tracker and network throttler.
     if (user_process_list.queries.empty())
@@ -268,6 +339,7 @@ QueryStatus::QueryStatus(
     const ClientInfo & client_info_,
     size_t max_memory_usage_,
     double memory_tracker_fault_probability_,
+    size_t priority_,
     QueryPriorities::Handle && priority_handle_)
     :
     query(query_),
@@ -275,7 +347,8 @@ QueryStatus::QueryStatus(
     priority_handle(std::move(priority_handle_)),
     num_queries_increment{CurrentMetrics::Query},
     max_memory_usage(max_memory_usage_),
-    memory_tracker_fault_probability(memory_tracker_fault_probability_)
+    memory_tracker_fault_probability(memory_tracker_fault_probability_),
+    priority(priority_)
 {
 }
 
@@ -388,6 +461,44 @@ ProcessList::CancellationCode ProcessList::sendCancelToQuery(const String & curr
 }
 
 
+size_t ProcessList::allotThreads(QueryStatus & elem, size_t desired_threads)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (!max_threads_soft_limit || desired_threads <= 1)
+    {
+        elem.allotted_threads = desired_threads;
+        return desired_threads;
+    }
+
+    size_t threads_in_use = 0;
+    for (const auto & process : processes)
+    {
+        if (&process == &elem)
+            continue;
+
+        /// Queries of a strictly lower priority class are preempted (see QueryPriorities)
+        ///  while this one is running, so their threads must not push it below its desired parallelism.
+        if (elem.priority && process.priority > elem.priority)
+            continue;
+
+        threads_in_use += process.allotted_threads;
+    }
+
+    size_t available = max_threads_soft_limit > threads_in_use ? max_threads_soft_limit - threads_in_use : 0;
+
+    /// Downgrade gracefully instead of rejecting: even on a fully loaded server the query runs single-threaded.
+    size_t granted = std::max<size_t>(1, std::min(desired_threads, available));
+
+    if (granted < desired_threads)
+        LOG_DEBUG(&Logger::get("ProcessList"), "Query will be executed with " << granted << " threads instead of " << desired_threads
+            << ": " << threads_in_use << " of " << max_threads_soft_limit << " thread slots are taken by other running queries");
+
+    elem.allotted_threads = granted;
+    return granted;
+}
+
+
 QueryStatusInfo QueryStatus::getInfo(bool get_thread_list, bool get_profile_events, bool get_settings) const
 {
     QueryStatusInfo res;
@@ -396,6 +507,7 @@ QueryStatusInfo QueryStatus::getInfo(bool get_thread_list, bool get_profile_even
     res.client_info       = client_info;
     res.elapsed_seconds   = watch.elapsedSeconds();
     res.is_cancelled      = is_killed.load(std::memory_order_relaxed);
+    res.allotted_threads  = allotted_threads;
     res.read_rows         = progress_in.rows;
     res.read_bytes        = progress_in.bytes;
     res.total_rows        = progress_in.total_rows;
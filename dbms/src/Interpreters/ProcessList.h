@@ -63,6 +63,7 @@ struct QueryStatusInfo
     Int64 peak_memory_usage;
     ClientInfo client_info;
     bool is_cancelled;
+    size_t allotted_threads;
 
     /// Optional fields, filled by request
     std::vector<UInt32> thread_numbers;
@@ -103,6 +104,12 @@ protected:
     size_t max_memory_usage = 0;
     double memory_tracker_fault_probability = 0.0;
 
+    /// Value of the 'priority' setting: 0 - do not use priorities, bigger value - lower priority class.
+    size_t priority = 0;
+
+    /// Number of processing threads granted to the query by ProcessList::allotThreads. 0 - no limit was applied.
+    size_t allotted_threads = 0;
+
     std::atomic<bool> is_killed { false };
 
     void setUserProcessList(ProcessListForUser * user_process_list_);
@@ -135,6 +142,7 @@ public:
         const ClientInfo & client_info_,
         size_t max_memory_usage,
         double memory_tracker_fault_probability,
+        size_t priority_,
         QueryPriorities::Handle && priority_handle_);
 
     ~QueryStatus();
@@ -273,6 +281,13 @@ protected:
     Container processes;
     size_t max_size;        /// 0 means no limit. Otherwise, when limit exceeded, an exception is thrown.
 
+    /// Number of currently running queries with priority greater than zero (see max_concurrent_queries_for_low_priority).
+    size_t low_priority_queries = 0;
+
+    /// Soft limit on the total number of processing threads granted to running queries. 0 means no limit.
+    /// Unlike max_size, exceeding it does not reject queries: they are granted fewer threads instead.
+    size_t max_threads_soft_limit = 0;
+
     /// Stores per-user info: queries, statistics and limits
     UserToQueries user_to_queries;
 
@@ -288,6 +303,10 @@ protected:
     /// Call under lock. Finds process with specified current_user and current_query_id.
     QueryStatus * tryGetProcessListElement(const String & current_query_id, const String & current_user);
 
+    /// Called when the server-wide memory soft limit is crossed (see memory_usage_soft_limit_ratio):
+    ///  asks the largest query to release memory, preferring queries that are over their own soft limit.
+    void requestMemoryPressure();
+
 public:
     ProcessList(size_t max_size_ = 0);
 
@@ -312,6 +331,19 @@ public:
         max_size = max_size_;
     }
 
+    void setMaxThreadsSoftLimit(size_t limit)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        max_threads_soft_limit = limit;
+    }
+
+    /** Grant the query a number of processing threads, at most desired_threads.
+      * When the soft limit is set and running queries have already been granted all thread slots,
+      *  the query is downgraded gracefully, down to a single thread, instead of oversubscribing the CPU.
+      * The granted number is recorded in the element and shown in system.processes.
+      */
+    size_t allotThreads(QueryStatus & elem, size_t desired_threads);
+
     enum class CancellationCode
     {
         NotFound = 0,                     /// already cancelled
@@ -68,7 +68,9 @@ Block QueryLogElement::createBlock()
         {std::make_shared<DataTypeArray>(std::make_shared<DataTypeString>()), "ProfileEvents.Names"},
         {std::make_shared<DataTypeArray>(std::make_shared<DataTypeUInt64>()), "ProfileEvents.Values"},
         {std::make_shared<DataTypeArray>(std::make_shared<DataTypeString>()), "Settings.Names"},
-        {std::make_shared<DataTypeArray>(std::make_shared<DataTypeString>()), "Settings.Values"}
+        {std::make_shared<DataTypeArray>(std::make_shared<DataTypeString>()), "Settings.Values"},
+
+        {std::make_shared<DataTypeString>(),                                  "pipeline_profile"}
     };
 }
 
@@ -157,6 +159,8 @@ void QueryLogElement::appendToBlock(Block & block) const
         columns[i++]->insertDefault();
     }
 
+    columns[i++]->insertData(pipeline_profile.data(), pipeline_profile.size());
+
     block.setColumns(std::move(columns));
 }
 
@@ -54,6 +54,9 @@ struct QueryLogElement
 
     String query;
 
+    /// Tree of block input streams annotated with per-stream timings (see IBlockInputStream::dumpTreeWithProfile).
+    String pipeline_profile;
+
     String exception;
     String stack_trace;
 
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <Common/LRUCache.h>
+#include <Common/ProfileEvents.h>
+#include <Common/SipHash.h>
+#include <Interpreters/AggregationCommon.h>
+#include <Parsers/IAST.h>
+
+
+namespace ProfileEvents
+{
+    extern const Event QueryParseCacheHits;
+    extern const Event QueryParseCacheMisses;
+}
+
+namespace DB
+{
+
+/** Cache of parsed queries, keyed by the hash of the query text. Thread-safe.
+  * Saves re-parsing for workloads of many repeated short queries (key-value style point lookups),
+  * where the parse is a noticeable part of the total latency.
+  *
+  * The cached AST must stay pristine - the interpreters modify the AST in place - so the cache
+  * stores a private copy and hands out clones. Only complete SELECT queries are cached: the AST
+  * of an INSERT points into the query buffer for the data to insert and cannot be reused.
+  *
+  * The size is a number of entries (query texts and their ASTs are small).
+  */
+class QueryParseCache : public LRUCache<UInt128, IAST, UInt128TrivialHash>
+{
+private:
+    using Base = LRUCache<UInt128, IAST, UInt128TrivialHash>;
+
+public:
+    QueryParseCache(size_t max_count)
+        : Base(max_count) {}
+
+    /// Calculate key from the query text.
+    static UInt128 hash(const char * begin, const char * end)
+    {
+        UInt128 key;
+
+        SipHash hash;
+        hash.update(begin, end - begin);
+        hash.get128(key.low, key.high);
+
+        return key;
+    }
+
+    /// Returns a clone of the cached AST, or nullptr if there is none.
+    ASTPtr getClone(const Key & key)
+    {
+        if (MappedPtr ast = get(key))
+        {
+            ProfileEvents::increment(ProfileEvents::QueryParseCacheHits);
+            return ast->clone();
+        }
+
+        ProfileEvents::increment(ProfileEvents::QueryParseCacheMisses);
+        return nullptr;
+    }
+};
+
+using QueryParseCachePtr = std::shared_ptr<QueryParseCache>;
+
+}
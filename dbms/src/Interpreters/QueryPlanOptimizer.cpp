@@ -0,0 +1,199 @@
+#include <Interpreters/QueryPlanOptimizer.h>
+
+#include <Parsers/ASTSelectQuery.h>
+#include <Parsers/ASTSelectWithUnionQuery.h>
+#include <Parsers/ASTTablesInSelectQuery.h>
+#include <Parsers/ASTSubquery.h>
+#include <Parsers/ASTExpressionList.h>
+#include <Parsers/ASTIdentifier.h>
+#include <Parsers/ASTAsterisk.h>
+#include <Parsers/ASTLiteral.h>
+#include <Common/typeid_cast.h>
+
+#include <algorithm>
+
+
+namespace DB
+{
+
+namespace
+{
+
+/// The query parts are stored both as named members of ASTSelectQuery and in its children,
+///  so both have to be kept in sync when a part is changed.
+void removeMember(IAST & parent, ASTPtr & member)
+{
+    if (!member)
+        return;
+
+    parent.children.erase(std::remove(parent.children.begin(), parent.children.end(), member), parent.children.end());
+    member = nullptr;
+}
+
+void setMember(IAST & parent, ASTPtr & member, ASTPtr value)
+{
+    if (member)
+        removeMember(parent, member);
+
+    parent.children.push_back(value);
+    member = std::move(value);
+}
+
+/// Subqueries the SELECT reads from (both sides of a JOIN count).
+std::vector<ASTSelectWithUnionQuery *> fromSubqueries(const ASTSelectQuery & select)
+{
+    std::vector<ASTSelectWithUnionQuery *> res;
+
+    if (!select.tables)
+        return res;
+
+    for (const auto & child : select.tables->children)
+    {
+        const auto * element = typeid_cast<const ASTTablesInSelectQueryElement *>(child.get());
+        if (!element || !element->table_expression)
+            continue;
+
+        const auto & table_expression = typeid_cast<const ASTTableExpression &>(*element->table_expression);
+        if (!table_expression.subquery)
+            continue;
+
+        if (auto * union_query = typeid_cast<ASTSelectWithUnionQuery *>(table_expression.subquery->children.at(0).get()))
+            res.push_back(union_query);
+    }
+
+    return res;
+}
+
+}
+
+
+Strings QueryPlanOptimizer::optimize(ASTPtr & query)
+{
+    Strings applied;
+
+    auto * union_query = typeid_cast<ASTSelectWithUnionQuery *>(query.get());
+    if (!union_query)
+        return applied;
+
+    /// Order matters: a LIMIT pushed into a branch makes the ORDER BY of that branch
+    ///  meaningful (top-N), so redundant ORDER BYs are removed first.
+    if (removeRedundantOrderBy(*union_query))
+        applied.push_back("RemoveRedundantOrderBy");
+
+    if (pushLimitIntoUnion(*union_query))
+        applied.push_back("PushLimitIntoUnion");
+
+    return applied;
+}
+
+
+bool QueryPlanOptimizer::removeRedundantOrderBy(ASTSelectWithUnionQuery & union_query)
+{
+    bool changed = false;
+
+    for (auto & child : union_query.list_of_selects->children)
+    {
+        auto & select = typeid_cast<ASTSelectQuery &>(*child);
+
+        for (auto * subquery : fromSubqueries(select))
+            changed |= removeRedundantOrderBy(*subquery);
+
+        /// The ORDER BY of a subquery is unobservable when the outer query reorders (ORDER BY)
+        ///  or regroups (GROUP BY) the rows anyway. It still matters if the subquery limits
+        ///  the rows it returns: then the ordering selects which rows survive.
+        if (!select.order_expression_list && !select.group_expression_list)
+            continue;
+
+        for (auto * subquery : fromSubqueries(select))
+        {
+            for (auto & inner_child : subquery->list_of_selects->children)
+            {
+                auto & inner = typeid_cast<ASTSelectQuery &>(*inner_child);
+
+                if (inner.order_expression_list && !inner.limit_length && !inner.limit_by_expression_list)
+                {
+                    removeMember(inner, inner.order_expression_list);
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    return changed;
+}
+
+
+bool QueryPlanOptimizer::pushLimitIntoUnion(ASTSelectWithUnionQuery & union_query)
+{
+    bool changed = false;
+
+    for (auto & child : union_query.list_of_selects->children)
+    {
+        auto & select = typeid_cast<ASTSelectQuery &>(*child);
+
+        for (auto * subquery : fromSubqueries(select))
+            changed |= pushLimitIntoUnion(*subquery);
+
+        if (!select.limit_length)
+            continue;
+
+        /// The outer query must not filter, reorder or transform the rows: then it takes
+        ///  the first limit + offset rows of the concatenation in whatever order they come,
+        ///  and no branch ever needs to produce more than that.
+        if (select.distinct || select.where_expression || select.prewhere_expression
+            || select.group_expression_list || select.having_expression
+            || select.order_expression_list || select.limit_by_expression_list
+            || select.array_join_expression_list() || select.join())
+            continue;
+
+        /// Expressions in the select list could contain aggregate functions.
+        bool plain_select_list = true;
+        for (const auto & expression : select.select_expression_list->children)
+            if (!typeid_cast<const ASTIdentifier *>(expression.get()) && !typeid_cast<const ASTAsterisk *>(expression.get()))
+                plain_select_list = false;
+
+        if (!plain_select_list)
+            continue;
+
+        const auto * length_literal = typeid_cast<const ASTLiteral *>(select.limit_length.get());
+        const auto * offset_literal = typeid_cast<const ASTLiteral *>(select.limit_offset.get());
+
+        if (!length_literal || length_literal->value.getType() != Field::Types::UInt64)
+            continue;
+        if (select.limit_offset && (!offset_literal || offset_literal->value.getType() != Field::Types::UInt64))
+            continue;
+
+        UInt64 needed_rows = length_literal->value.get<UInt64>()
+            + (offset_literal ? offset_literal->value.get<UInt64>() : 0);
+
+        auto subqueries = fromSubqueries(select);
+        if (subqueries.size() != 1 || select.tables->children.size() != 1)
+            continue;
+
+        for (auto & branch_child : subqueries.front()->list_of_selects->children)
+        {
+            auto & branch = typeid_cast<ASTSelectQuery &>(*branch_child);
+
+            if (branch.limit_length)
+            {
+                /// An existing larger LIMIT can be tightened; anything else is left alone.
+                auto * branch_length = typeid_cast<ASTLiteral *>(branch.limit_length.get());
+                if (branch_length && branch_length->value.getType() == Field::Types::UInt64
+                    && branch_length->value.get<UInt64>() > needed_rows)
+                {
+                    branch_length->value = needed_rows;
+                    changed = true;
+                }
+            }
+            else
+            {
+                setMember(branch, branch.limit_length, std::make_shared<ASTLiteral>(needed_rows));
+                changed = true;
+            }
+        }
+    }
+
+    return changed;
+}
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <Core/Types.h>
+#include <Parsers/IAST.h>
+
+
+namespace DB
+{
+
+class Context;
+class ASTSelectWithUnionQuery;
+
+/** A single home for rule-based query rewrites that run after parsing and before
+  * InterpreterSelectQuery constructs the block streams. Each rule transforms the AST
+  * in place and reports whether it changed anything, so PLAN (see ASTExplainQuery)
+  * can show which rules fired for a query.
+  *
+  * Current rules:
+  *  - RemoveRedundantOrderBy: drop ORDER BY of a subquery without LIMIT when the outer
+  *    query reorders (ORDER BY) or regroups (GROUP BY) the rows anyway.
+  *  - PushLimitIntoUnion: when a plain SELECT with LIMIT reads from a subquery,
+  *    cap every UNION ALL branch of the subquery at limit + offset rows, so branches
+  *    with ORDER BY can sort partially and unlimited branches stop early.
+  *
+  * Controlled by the optimize_query_plan setting.
+  */
+class QueryPlanOptimizer
+{
+public:
+    QueryPlanOptimizer(const Context & context_) : context(context_) {}
+
+    /// Applies the rules to the query in place. Returns the names of the rules that changed it.
+    /// Queries that are not SELECTs are left untouched.
+    Strings optimize(ASTPtr & query);
+
+private:
+    const Context & context;
+
+    static bool removeRedundantOrderBy(ASTSelectWithUnionQuery & union_query);
+    static bool pushLimitIntoUnion(ASTSelectWithUnionQuery & union_query);
+};
+
+}
@@ -0,0 +1,214 @@
+#include <Interpreters/QueryResultCache.h>
+#include <Interpreters/Context.h>
+#include <Interpreters/DatabaseAndTableWithAlias.h>
+#include <Parsers/IAST.h>
+#include <Parsers/ASTIdentifier.h>
+#include <Parsers/ASTTablesInSelectQuery.h>
+#include <Storages/StorageMergeTree.h>
+#include <Storages/StorageReplicatedMergeTree.h>
+#include <DataStreams/IProfilingBlockInputStream.h>
+#include <IO/WriteBufferFromString.h>
+#include <Common/SipHash.h>
+#include <Common/ProfileEvents.h>
+#include <Common/typeid_cast.h>
+
+
+namespace ProfileEvents
+{
+    extern const Event QueryResultCacheHits;
+    extern const Event QueryResultCacheMisses;
+}
+
+namespace DB
+{
+
+QueryResultCache::Key QueryResultCache::hash(const IAST & ast, const Context & context)
+{
+    IAST::Hash tree_hash = ast.getTreeHash();
+
+    SipHash hash;
+    hash.update(tree_hash.first);
+    hash.update(tree_hash.second);
+
+    /// The same query text means different things for different users and default databases.
+    const String & user = context.getClientInfo().current_user;
+    hash.update(user.data(), user.size() + 1);
+    String current_database = context.getCurrentDatabase();
+    hash.update(current_database.data(), current_database.size() + 1);
+
+    /// Settings can affect both the result (e.g. count_distinct_implementation) and its shape
+    /// (e.g. max_block_size), so all changed settings are part of the key.
+    WriteBufferFromOwnString settings_buf;
+    context.getSettingsRef().serialize(settings_buf);
+    String serialized_settings = settings_buf.str();
+    hash.update(serialized_settings.data(), serialized_settings.size());
+
+    Key key;
+    hash.get128(key.low, key.high);
+    return key;
+}
+
+
+static bool collectTableVersionsImpl(const IAST & ast, const Context & context, QueryResultCacheTableVersions & out_versions)
+{
+    if (const auto * table_expression = typeid_cast<const ASTTableExpression *>(&ast))
+    {
+        if (table_expression->database_and_table_name)
+        {
+            const auto * identifier = typeid_cast<const ASTIdentifier *>(table_expression->database_and_table_name.get());
+            if (!identifier)
+                return false;
+
+            DatabaseAndTableWithAlias db_and_table(*identifier, context.getCurrentDatabase());
+            StoragePtr storage = context.tryGetTable(db_and_table.database, db_and_table.table);
+
+            MergeTreeData * data = nullptr;
+            if (auto * merge_tree = dynamic_cast<StorageMergeTree *>(storage.get()))
+                data = &merge_tree->getData();
+            else if (auto * replicated_merge_tree = dynamic_cast<StorageReplicatedMergeTree *>(storage.get()))
+                data = &replicated_merge_tree->getData();
+
+            if (!data)
+                return false;
+
+            out_versions.push_back({db_and_table.database, db_and_table.table, data->getPartsSetVersion()});
+            return true;
+        }
+
+        if (table_expression->table_function)
+            return false;
+
+        /// Subqueries in the FROM section are traversed through the children below.
+    }
+
+    for (const auto & child : ast.children)
+        if (!collectTableVersionsImpl(*child, context, out_versions))
+            return false;
+
+    return true;
+}
+
+bool QueryResultCache::collectTableVersions(const IAST & ast, const Context & context, QueryResultCacheTableVersions & out_versions)
+{
+    out_versions.clear();
+
+    if (!collectTableVersionsImpl(ast, context, out_versions))
+        return false;
+
+    /// Don't cache table-less queries like SELECT now(): there is nothing to invalidate them by.
+    return !out_versions.empty();
+}
+
+
+namespace
+{
+
+/// Serves a result stored in the cache. The blocks are shared with the cache entry.
+class QueryResultCacheBlockInputStream : public IProfilingBlockInputStream
+{
+public:
+    explicit QueryResultCacheBlockInputStream(const std::shared_ptr<QueryResultCacheEntry> & entry_)
+        : entry(entry_), it(entry->blocks.begin()) {}
+
+    String getName() const override { return "QueryResultCache"; }
+    Block getHeader() const override { return entry->header; }
+
+protected:
+    Block readImpl() override
+    {
+        if (it == entry->blocks.end())
+            return {};
+        return *it++;
+    }
+
+private:
+    std::shared_ptr<QueryResultCacheEntry> entry;
+    BlocksList::const_iterator it;
+};
+
+/// Passes the blocks of the wrapped stream through and accumulates them; if the stream is read
+/// to the end (so the result is complete), saves the accumulated result in the cache.
+class SaveInQueryResultCacheBlockInputStream : public IProfilingBlockInputStream
+{
+public:
+    SaveInQueryResultCacheBlockInputStream(
+        const QueryResultCachePtr & cache_,
+        const QueryResultCache::Key & key_,
+        QueryResultCacheTableVersions table_versions_,
+        const BlockInputStreamPtr & stream_,
+        size_t max_entry_bytes_)
+        : cache(cache_), key(key_), max_entry_bytes(max_entry_bytes_)
+        , entry(std::make_shared<QueryResultCacheEntry>())
+    {
+        entry->header = stream_->getHeader();
+        entry->table_versions = std::move(table_versions_);
+        children.push_back(stream_);
+    }
+
+    String getName() const override { return "SaveInQueryResultCache"; }
+    Block getHeader() const override { return children.back()->getHeader(); }
+
+protected:
+    Block readImpl() override
+    {
+        Block block = children.back()->read();
+
+        if (!block)
+        {
+            /// If the query was cancelled, the result is incomplete even though the read returned no block.
+            if (entry && !isCancelled())
+            {
+                cache->set(key, entry);
+                entry.reset();
+            }
+        }
+        else if (entry)
+        {
+            entry->bytes += block.bytes();
+            if (entry->bytes > max_entry_bytes)
+                entry.reset();  /// The result is too big, give up caching it.
+            else
+                entry->blocks.push_back(block);
+        }
+
+        return block;
+    }
+
+private:
+    QueryResultCachePtr cache;
+    QueryResultCache::Key key;
+    size_t max_entry_bytes;
+    std::shared_ptr<QueryResultCacheEntry> entry;
+};
+
+}
+
+
+BlockInputStreamPtr QueryResultCache::tryGetResult(const Key & key, const QueryResultCacheTableVersions & current_versions)
+{
+    MappedPtr entry = get(key);
+
+    if (entry && entry->table_versions == current_versions)
+    {
+        ProfileEvents::increment(ProfileEvents::QueryResultCacheHits);
+        return std::make_shared<QueryResultCacheBlockInputStream>(entry);
+    }
+
+    /// An entry computed from older table versions is outdated. It is not removed here:
+    /// it will be replaced under the same key when the fresh result is saved.
+    ProfileEvents::increment(ProfileEvents::QueryResultCacheMisses);
+    return nullptr;
+}
+
+
+BlockInputStreamPtr wrapWithQueryResultCacheSavingStream(
+    const QueryResultCachePtr & cache,
+    const QueryResultCache::Key & key,
+    QueryResultCacheTableVersions table_versions,
+    const BlockInputStreamPtr & stream,
+    size_t max_entry_bytes)
+{
+    return std::make_shared<SaveInQueryResultCacheBlockInputStream>(cache, key, std::move(table_versions), stream, max_entry_bytes);
+}
+
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <Common/LRUCache.h>
+#include <Common/UInt128.h>
+#include <Core/Block.h>
+#include <DataStreams/IBlockInputStream.h>
+
+
+namespace DB
+{
+
+class Context;
+class IAST;
+
+/// Identifies the state of one MergeTree table a cached query result was read from.
+struct QueryResultCacheTableVersion
+{
+    String database;
+    String table;
+    /// Value of MergeTreeData::getPartsSetVersion() at the start of the query.
+    UInt64 version;
+
+    bool operator==(const QueryResultCacheTableVersion & rhs) const
+    {
+        return database == rhs.database && table == rhs.table && version == rhs.version;
+    }
+};
+
+using QueryResultCacheTableVersions = std::vector<QueryResultCacheTableVersion>;
+
+
+struct QueryResultCacheEntry
+{
+    /// Structure of the result. Needed to serve empty results.
+    Block header;
+    /// The complete result of the query. Columns are immutable and shared with the streams the result is served to.
+    BlocksList blocks;
+    /// Versions of the tables the result was computed from. The entry is served only while they are current.
+    QueryResultCacheTableVersions table_versions;
+    /// Total size of the blocks in bytes.
+    size_t bytes = 0;
+};
+
+struct QueryResultCacheEntryWeightFunction
+{
+    size_t operator()(const QueryResultCacheEntry & entry) const
+    {
+        return entry.bytes;
+    }
+};
+
+
+/** Cache of complete query results, keyed by the hash of the query AST, the user, the current database
+  * and the settings of the query (see the use_query_result_cache setting). Thread-safe.
+  *
+  * An entry remembers the versions of the MergeTree tables the query has read and is served only while
+  * these versions are current, so a served result is never stale: any insert, merge, mutation or ALTER
+  * makes the affected entries unusable, and they are replaced when the query runs next time (or are
+  * gradually evicted). The total size is limited by LRU eviction by entry weight; results bigger than
+  * the query_result_cache_max_entry_size setting are not stored at all.
+  */
+class QueryResultCache : public LRUCache<UInt128, QueryResultCacheEntry, UInt128TrivialHash, QueryResultCacheEntryWeightFunction>
+{
+private:
+    using Base = LRUCache<UInt128, QueryResultCacheEntry, UInt128TrivialHash, QueryResultCacheEntryWeightFunction>;
+
+public:
+    QueryResultCache(size_t max_size_in_bytes) : Base(max_size_in_bytes) {}
+
+    /// Calculate the key from the query AST and everything else that can affect the result.
+    static Key hash(const IAST & ast, const Context & context);
+
+    /// Collect the current versions of all tables the query reads. Returns false if the result cannot
+    /// be cached: the query reads no tables at all or reads something other than MergeTree tables
+    /// (for those there is no way to invalidate the entry reliably).
+    static bool collectTableVersions(const IAST & ast, const Context & context, QueryResultCacheTableVersions & out_versions);
+
+    /// Returns a stream with the cached result, or nullptr if there is no entry or the entry
+    /// was computed from table versions different from the current ones.
+    BlockInputStreamPtr tryGetResult(const Key & key, const QueryResultCacheTableVersions & current_versions);
+};
+
+using QueryResultCachePtr = std::shared_ptr<QueryResultCache>;
+
+
+/// Wraps a stream so that, if it is read to the end, its complete result is saved in the cache.
+/// Results bigger than max_entry_bytes are not saved.
+BlockInputStreamPtr wrapWithQueryResultCacheSavingStream(
+    const QueryResultCachePtr & cache,
+    const QueryResultCache::Key & key,
+    QueryResultCacheTableVersions table_versions,
+    const BlockInputStreamPtr & stream,
+    size_t max_entry_bytes);
+
+}
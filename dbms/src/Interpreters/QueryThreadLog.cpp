@@ -35,6 +35,7 @@ Block QueryThreadLogElement::createBlock()
         {std::make_shared<DataTypeInt64>(),         "peak_memory_usage"},
 
         {std::make_shared<DataTypeString>(),        "thread_name"},
+        {std::make_shared<DataTypeString>(),        "stage"},
         {std::make_shared<DataTypeUInt32>(),        "thread_number"},
         {std::make_shared<DataTypeInt32>(),         "os_thread_id"},
         {std::make_shared<DataTypeUInt32>(),        "master_thread_number"},
@@ -89,6 +90,7 @@ void QueryThreadLogElement::appendToBlock(Block & block) const
     columns[i++]->insert(peak_memory_usage);
 
     columns[i++]->insertData(thread_name.data(), thread_name.size());
+    columns[i++]->insertData(stage.data(), stage.size());
     columns[i++]->insert(thread_number);
     columns[i++]->insert(os_thread_id);
     columns[i++]->insert(master_thread_number);
@@ -32,6 +32,8 @@ struct QueryThreadLogElement
     Int64 peak_memory_usage{};
 
     String thread_name;
+    /// Name of the pipeline stage the thread served (see CurrentThread::setQueryStage). May be empty.
+    String stage;
     UInt32 thread_number{};
     Int32 os_thread_id{};
     UInt32 master_thread_number{};
@@ -13,6 +13,7 @@
 
 #include <DataTypes/DataTypeTuple.h>
 #include <DataTypes/DataTypeNullable.h>
+#include <DataTypes/DataTypesNumber.h>
 
 #include <Parsers/ASTExpressionList.h>
 #include <Parsers/ASTFunction.h>
@@ -166,6 +167,9 @@ bool Set::insertFromBlock(const Block & block)
     if (empty())
         throw Exception("Method Set::setHeader must be called before Set::insertFromBlock", ErrorCodes::LOGICAL_ERROR);
 
+    if (isCreated())
+        throw Exception("Method Set::insertFromBlock is called after the set was marked as created", ErrorCodes::LOGICAL_ERROR);
+
     ColumnRawPtrs key_columns;
     key_columns.reserve(keys_size);
 
@@ -319,6 +323,81 @@ void Set::createFromAST(const DataTypes & types, ASTPtr node, const Context & co
 
     Block block = header.cloneWithColumns(std::move(columns));
     insertFromBlock(block);
+    finishInsert();
+}
+
+
+void Set::finishInsert()
+{
+    buildFlatCheck();
+    is_created = true;
+}
+
+
+void Set::buildFlatCheck()
+{
+    /// For 1-2 byte keys the hash table is already a direct-addressed array (FixedHashSet),
+    ///  and multi-column or string sets have no usable value range.
+    if (data.type != SetVariants::Type::key32 && data.type != SetVariants::Type::key64)
+        return;
+
+    size_t count = getTotalRowCount();
+    if (!count)
+        return;
+
+    const DataTypePtr & type = removeNullable(data_types[0]);
+    if (!type->isValueRepresentedByInteger())
+        return;
+
+    /// Values of signed types are stored as their bit patterns; flip the sign bit
+    ///  so that the [min, max] range is order-preserving.
+    UInt64 sign_mask = 0;
+    if (typeid_cast<const DataTypeInt32 *>(type.get()))
+        sign_mask = 1ULL << 31;
+    else if (typeid_cast<const DataTypeInt64 *>(type.get()))
+        sign_mask = 1ULL << 63;
+
+    UInt64 min = std::numeric_limits<UInt64>::max();
+    UInt64 max = 0;
+
+    auto process = [&](UInt64 value)
+    {
+        value ^= sign_mask;
+        min = std::min(min, value);
+        max = std::max(max, value);
+    };
+
+    if (data.type == SetVariants::Type::key32)
+        for (auto it = data.key32->data.begin(); it != data.key32->data.end(); ++it)
+            process(it->getValue());
+    else
+        for (auto it = data.key64->data.begin(); it != data.key64->data.end(); ++it)
+            process(it->getValue());
+
+    UInt64 range = max - min + 1;
+    if (!range)     /// Overflow: the values span the whole domain.
+        return;
+
+    /// A bitmap only pays off while it stays small and reasonably dense.
+    if (range != count && range > std::max<UInt64>(65536, 32 * count))
+        return;
+
+    if (range != count)
+    {
+        flat_bitmap.resize_fill(range, 0);
+
+        if (data.type == SetVariants::Type::key32)
+            for (auto it = data.key32->data.begin(); it != data.key32->data.end(); ++it)
+                flat_bitmap[(it->getValue() ^ sign_mask) - min] = 1;
+        else
+            for (auto it = data.key64->data.begin(); it != data.key64->data.end(); ++it)
+                flat_bitmap[(it->getValue() ^ sign_mask) - min] = 1;
+    }
+
+    flat_min = min;
+    flat_range = range;
+    flat_sign_mask = sign_mask;
+    has_flat_check = true;
 }
 
 
@@ -336,7 +415,10 @@ ColumnPtr Set::execute(const Block & block, bool negative) const
     if (vec_res.empty())
         return res;
 
-    std::shared_lock lock(rwlock);
+    /// The lock is needed only while the set can still be modified (see finishInsert).
+    std::shared_lock<std::shared_mutex> lock(rwlock, std::defer_lock);
+    if (!isCreated())
+        lock.lock();
 
     /// If the set is empty.
     if (data_types.empty())
@@ -435,6 +517,34 @@ void NO_INLINE Set::executeImplCase(
 }
 
 
+template <typename FieldType, bool has_null_map>
+void NO_INLINE Set::executeFlatCheck(
+    const IColumn * key_column,
+    ColumnUInt8::Container & vec_res,
+    bool negative,
+    size_t rows,
+    ConstNullMapPtr null_map) const
+{
+    /// As in SetMethodOneNumber: any column of the corresponding bit width is read as a vector of FieldType.
+    const FieldType * vec = static_cast<const ColumnVector<FieldType> *>(key_column)->getData().data();
+
+    const UInt8 * bitmap = flat_bitmap.empty() ? nullptr : flat_bitmap.data();
+
+    for (size_t i = 0; i < rows; ++i)
+    {
+        if (has_null_map && (*null_map)[i])
+        {
+            vec_res[i] = negative;
+            continue;
+        }
+
+        UInt64 adjusted = (UInt64(vec[i]) ^ flat_sign_mask) - flat_min;
+        UInt8 found = adjusted < flat_range && (!bitmap || bitmap[adjusted]);
+        vec_res[i] = negative ^ found;
+    }
+}
+
+
 void Set::executeOrdinary(
     const ColumnRawPtrs & key_columns,
     ColumnUInt8::Container & vec_res,
@@ -443,6 +553,25 @@ void Set::executeOrdinary(
 {
     size_t rows = key_columns[0]->size();
 
+    if (has_flat_check)
+    {
+        if (data.type == SetVariants::Type::key32)
+        {
+            if (null_map)
+                executeFlatCheck<UInt32, true>(key_columns[0], vec_res, negative, rows, null_map);
+            else
+                executeFlatCheck<UInt32, false>(key_columns[0], vec_res, negative, rows, null_map);
+        }
+        else
+        {
+            if (null_map)
+                executeFlatCheck<UInt64, true>(key_columns[0], vec_res, negative, rows, null_map);
+            else
+                executeFlatCheck<UInt64, false>(key_columns[0], vec_res, negative, rows, null_map);
+        }
+        return;
+    }
+
     switch (data.type)
     {
         case SetVariants::Type::EMPTY:
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <shared_mutex>
 #include <Core/Block.h>
 #include <DataStreams/SizeLimits.h>
@@ -57,6 +58,16 @@ public:
     /// Returns false, if some limit was exceeded and no need to insert more data.
     bool insertFromBlock(const Block & block);
 
+    /** Declare that no more data will be inserted into the set.
+      * After this call 'execute' probes the hash table without taking the lock,
+      *  so many scan threads can share one set with no lock traffic.
+      * Also builds the flat check for narrow integer sets (see buildFlatCheck).
+      * Must not be called for sets that are still being modified (StorageSet).
+      */
+    void finishInsert();
+
+    bool isCreated() const { return is_created; }
+
     /** For columns of 'block', check belonging of corresponding rows to the set.
       * Return UInt8 column with the result.
       */
@@ -104,6 +115,9 @@ private:
     /// Do we need to additionally store all elements of the set in explicit form for subsequent use for index.
     bool fill_set_elements;
 
+    /// The set is completely built and will no longer be modified (see finishInsert).
+    std::atomic<bool> is_created {false};
+
     /// If in the left part columns contains the same types as the elements of the set.
     void executeOrdinary(
         const ColumnRawPtrs & key_columns,
@@ -111,6 +125,28 @@ private:
         bool negative,
         const PaddedPODArray<UInt8> * null_map) const;
 
+    /** Fast check for single-column integer sets, typical for generated IN lists.
+      * If the values of a finalized set fit in a narrow range, membership is checked with
+      *  a range comparison plus, for non-contiguous sets, a byte-per-value bitmap lookup,
+      *  instead of a hash table probe per row.
+      */
+    bool has_flat_check = false;
+    UInt64 flat_min = 0;                /// Minimum of the adjusted values.
+    UInt64 flat_range = 0;              /// max - min + 1 over the adjusted values.
+    UInt64 flat_sign_mask = 0;          /// Sign bit, flipped on values of signed types to make the range order-preserving.
+    PaddedPODArray<UInt8> flat_bitmap;  /// Empty if the set is contiguous: the range check alone suffices.
+
+    /// Called from finishInsert. Does nothing if the set is not a narrow single-column integer set.
+    void buildFlatCheck();
+
+    template <typename FieldType, bool has_null_map>
+    void executeFlatCheck(
+        const IColumn * key_column,
+        ColumnUInt8::Container & vec_res,
+        bool negative,
+        size_t rows,
+        const PaddedPODArray<UInt8> * null_map) const;
+
     /// Collected elements of `Set`.
     /// It is necessary for the index to work on the primary key in the IN statement.
     Columns set_elements;
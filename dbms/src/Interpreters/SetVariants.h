@@ -6,6 +6,7 @@
 
 #include <Common/Arena.h>
 #include <Common/HashTable/HashSet.h>
+#include <Common/HashTable/FixedHashSet.h>
 #include <Common/HashTable/ClearableHashSet.h>
 #include <Common/UInt128.h>
 
@@ -304,9 +305,9 @@ struct SetMethodHashed
   */
 struct NonClearableSet
 {
-    /// TODO Use either bit- or byte-set for these two options.
-    std::unique_ptr<SetMethodOneNumber<UInt8, HashSet<UInt8, TrivialHash, HashTableFixedGrower<8>>>>            key8;
-    std::unique_ptr<SetMethodOneNumber<UInt16, HashSet<UInt16, TrivialHash, HashTableFixedGrower<16>>>>         key16;
+    /// For 1-2 byte keys a direct-addressed set is used: the key indexes its cell, nothing is hashed.
+    std::unique_ptr<SetMethodOneNumber<UInt8, FixedHashSet<UInt8>>>                                             key8;
+    std::unique_ptr<SetMethodOneNumber<UInt16, FixedHashSet<UInt16>>>                                           key16;
 
     /** Also for the experiment was tested the ability to use SmallSet,
       *  as long as the number of elements in the set is small (and, if necessary, converted to a full-fledged HashSet).
@@ -44,6 +44,8 @@ struct Settings
     M(SettingUInt64, max_read_buffer_size, DBMS_DEFAULT_BUFFER_SIZE, "The maximum size of the buffer to read from the filesystem.") \
     M(SettingUInt64, max_distributed_connections, 1024, "The maximum number of connections for distributed processing of one query (should be greater than max_threads).") \
     M(SettingUInt64, max_query_size, 262144, "Which part of the query can be read into RAM for parsing (the remaining data for INSERT, if any, is read later)") \
+    M(SettingUInt64, max_parser_depth, DBMS_DEFAULT_MAX_PARSER_DEPTH, "Maximum recursion depth of the query parser. Protects against deeply nested queries exhausting the stack. Zero means unlimited.") \
+    M(SettingUInt64, max_prepared_statements, 256, "Maximum number of statements a session can store with PREPARE. Zero means unlimited.") \
     M(SettingUInt64, interactive_delay, 100000, "The interval in microseconds to check if the request is cancelled, and to send progress info.") \
     M(SettingSeconds, connect_timeout, DBMS_DEFAULT_CONNECT_TIMEOUT_SEC, "Connection timeout if there are no replicas.") \
     M(SettingMilliseconds, connect_timeout_with_failover_ms, DBMS_DEFAULT_CONNECT_TIMEOUT_WITH_FAILOVER_MS, "Connection timeout for selecting first healthy replica.") \
@@ -54,8 +56,12 @@ struct Settings
     M(SettingUInt64, poll_interval, DBMS_DEFAULT_POLL_INTERVAL, "Block at the query wait loop on the server for the specified number of seconds.") \
     M(SettingUInt64, distributed_connections_pool_size, DBMS_DEFAULT_DISTRIBUTED_CONNECTIONS_POOL_SIZE, "Maximum number of connections with one remote server in the pool.") \
     M(SettingUInt64, connections_with_failover_max_tries, DBMS_CONNECTION_POOL_WITH_FAILOVER_DEFAULT_MAX_TRIES, "The maximum number of attempts to connect to replicas.") \
+    M(SettingMilliseconds, hedged_request_delay_ms, 0, "If a remote replica has not sent any data within the specified time after the query was sent, send the same query to one more replica and use the result of whichever replica responds first. The slow replica is penalized in the connection pool. 0 - disabled.") \
     M(SettingBool, extremes, false, "Calculate minimums and maximums of the result columns. They can be output in JSON-formats.") \
     M(SettingBool, use_uncompressed_cache, true, "Whether to use the cache of uncompressed blocks.") \
+    M(SettingBool, use_query_result_cache, false, "Whether to use the cache of complete query results, if the server has one (see query_result_cache_size). Only SELECT queries reading MergeTree tables are cached; results are invalidated when the data of these tables changes. Not suitable for queries with non-deterministic functions.") \
+    M(SettingUInt64, query_result_cache_max_entry_size, 16777216, "Do not save results bigger than this number of bytes in the query result cache.") \
+    M(SettingBool, use_subquery_result_cache, false, "Whether to reuse sets built for IN (SELECT ...), hash tables built for LEFT and INNER JOINs and results of scalar subqueries from the cache, if the server has one (see subquery_result_cache_size). Entries are invalidated when the data of the tables read by the subquery changes. Not suitable for subqueries with non-deterministic functions.") \
     M(SettingBool, replace_running_query, false, "Whether the running request should be canceled with the same id as the new one.") \
     M(SettingUInt64, background_pool_size, 16, "Number of threads performing background work for tables (for example, merging in merge tree). Only has meaning at server startup.") \
     M(SettingUInt64, background_schedule_pool_size, 16, "Number of threads performing background tasks for replicated tables. Only has meaning at server startup.") \
@@ -63,9 +69,20 @@ struct Settings
     M(SettingMilliseconds, distributed_directory_monitor_sleep_time_ms, 100, "Sleep time for StorageDistributed DirectoryMonitors in case there is no work or exception has been thrown.") \
     \
     M(SettingBool, distributed_directory_monitor_batch_inserts, false, "Should StorageDistributed DirectoryMonitors try to batch individual inserts into bigger ones.") \
+    M(SettingUInt64, distributed_directory_monitor_max_files_to_batch, 100, "Maximum number of queued files sent as one batched INSERT when distributed_directory_monitor_batch_inserts is enabled. 0 - no limit by the number of files.") \
     \
     M(SettingBool, optimize_move_to_prewhere, true, "Allows disabling WHERE to PREWHERE optimization in SELECT queries from MergeTree.") \
     \
+    M(SettingBool, optimize_read_in_order, true, "Read from MergeTree tables in sorting key order if ORDER BY is a prefix of the key, merging the streams instead of sorting.") \
+    \
+    M(SettingBool, optimize_aggregation_in_order, false, "Aggregate in a streaming fashion, without a hash table, when the GROUP BY keys cover a prefix of the MergeTree sorting key: memory is bounded by one group and first rows of the result arrive early, but the aggregation runs in a single stream.") \
+    \
+    M(SettingBool, optimize_partition_wise_aggregation, false, "When the GROUP BY keys determine the MergeTree partition, aggregate every partition in its own stream and concatenate the results instead of merging: no cross-stream merge phase, and each partition is emitted as soon as it is complete.") \
+    \
+    M(SettingBool, optimize_join_build_side, false, "Swap the sides of an ALL INNER JOIN of two MergeTree tables when the table statistics say that the right-hand (hashed) one is larger. Changes the column order of SELECT *.") \
+    \
+    M(SettingBool, optimize_use_projections, true, "Read from the projection layout of MergeTree parts (see the projection_sort_columns table setting) when the query condition can prune by the projection sort key but not by the primary key.") \
+    \
     M(SettingUInt64, replication_alter_partitions_sync, 1, "Wait for actions to manipulate the partitions. 0 - do not wait, 1 - wait for execution only of itself, 2 - wait for everyone.") \
     M(SettingUInt64, replication_alter_columns_timeout, 60, "Wait for actions to change the table structure within the specified number of seconds. 0 - wait unlimited time.") \
     \
@@ -76,9 +93,12 @@ struct Settings
     \
     M(SettingBool, compile, false, "Whether query compilation is enabled.") \
     M(SettingBool, compile_expressions, true, "Compile some scalar functions and operators to native code.") \
+    M(SettingBool, compile_aggregate_functions, false, "Compile a fused native loop over the aggregate functions of a GROUP BY, instead of adding values to them one by one.") \
     M(SettingUInt64, min_count_to_compile, 3, "The number of structurally identical queries before they are compiled.") \
     M(SettingUInt64, group_by_two_level_threshold, 100000, "From what number of keys, a two-level aggregation starts. 0 - the threshold is not set.") \
     M(SettingUInt64, group_by_two_level_threshold_bytes, 100000000, "From what size of the aggregation state in bytes, a two-level aggregation begins to be used. 0 - the threshold is not set. Two-level aggregation is used when at least one of the thresholds is triggered.") \
+    M(SettingBool, partial_aggregation_in_source_streams, false, "Run a partial GROUP BY stage in every source stream (inside the reading threads), flushing intermediate aggregation states downstream when they occupy more than partial_aggregation_flush_threshold_bytes; the partial results are then merged as in distributed aggregation.") \
+    M(SettingUInt64, partial_aggregation_flush_threshold_bytes, 100000000, "For partial_aggregation_in_source_streams: the amount of memory occupied by aggregation states of a single source stream, above which the accumulated states are flushed downstream. 0 - do not flush until the end of input.") \
     M(SettingBool, distributed_aggregation_memory_efficient, false, "Is the memory-saving mode of distributed aggregation enabled.") \
     M(SettingUInt64, aggregation_memory_efficient_merge_threads, 0, "Number of threads to use for merge intermediate aggregation results in memory efficient mode. When bigger, then more memory is consumed. 0 means - same as 'max_threads'.") \
     \
@@ -97,11 +117,23 @@ struct Settings
     \
     M(SettingBool, merge_tree_uniform_read_distribution, true, "Distribute read from MergeTree over threads evenly, ensuring stable average execution time of each thread within one read operation.") \
     \
+    M(SettingBool, enable_multiple_prewhere_read_steps, true, "If PREWHERE condition has a form of `cond1 AND cond2 AND ...`, execute it in several steps: read the columns needed for the first condition, filter, then read the columns for the next condition at already filtered positions, and so on.") \
+    M(SettingBool, adaptive_prewhere_reorder, true, "Reorder the steps of a multi-step PREWHERE while the query runs: steps that drop more rows per unit of calculation time, as observed on recent blocks, are executed first. Has effect only together with enable_multiple_prewhere_read_steps.") \
+    M(SettingUInt64, adaptive_prewhere_reorder_granules, 64, "How many granules a stream reads within one part between re-evaluations of the PREWHERE step order. 0 means the order is re-evaluated only between parts.") \
+    \
+    M(SettingBool, do_not_merge_across_partitions_select_final, false, "Run an independent final merge for each partition in SELECT FINAL, in parallel. Rows of one sorting key must not span several partitions, otherwise duplicates of different partitions will not be collapsed.") \
+    \
+    M(SettingBool, apply_deleted_mask, true, "Hide rows removed by lightweight ALTER DELETE (see the lightweight_deletes MergeTree setting) when reading. Disabling allows to inspect rows that are marked as deleted but not yet physically removed; it is also disabled internally for reads that must see physical rows, e.g. when a mutation rewrites some columns of a part in place.") \
+    \
     M(SettingUInt64, mysql_max_rows_to_insert, 65536, "The maximum number of rows in MySQL batch insertion of the MySQL storage engine") \
     \
     M(SettingUInt64, optimize_min_equality_disjunction_chain_length, 3, "The minimum length of the expression `expr = x1 OR ... expr = xN` for optimization ") \
     \
     M(SettingUInt64, min_bytes_to_use_direct_io, 0, "The minimum number of bytes for input/output operations is bypassing the page cache. 0 - disabled.") \
+    M(SettingUInt64, min_bytes_to_use_mmap_io, 0, "The minimum number of bytes for reading data files through a shared memory mapping instead of read syscalls into private buffers. Saves copying for data resident in the page cache. 0 - disabled.") \
+    \
+    M(SettingUInt64, decompress_ahead_blocks, 0, "If non-zero, for sequential reads of compressed files, the next specified number of blocks are checksummed and decompressed by helper threads while the current block is consumed. 0 - disabled.") \
+    M(SettingBool, deferred_checksum_verification, 0, "Verify checksums of compressed blocks on a background thread instead of the reading thread. A mismatch still fails the query, but may be reported a few blocks later. Not used when reading through the cache of decompressed blocks.") \
     \
     M(SettingBool, force_index_by_date, 0, "Throw an exception if there is a partition key in a table, and it is not used.") \
     M(SettingBool, force_primary_key, 0, "Throw an exception if there is primary key in a table, and it is not used.") \
@@ -114,6 +146,12 @@ struct Settings
     \
     M(SettingInt64, network_zstd_compression_level, 1, "Allows you to select the level of ZSTD compression.") \
     \
+    M(SettingCompressionMethod, network_response_compression_method, CompressionMethod::LZ4, "Method of compression for the blocks the server sends back. If not set explicitly, network_compression_method is used for both directions.") \
+    \
+    M(SettingInt64, network_response_zstd_compression_level, 1, "Level of ZSTD compression for the blocks the server sends back. If not set explicitly, network_zstd_compression_level is used.") \
+    \
+    M(SettingBool, network_compression_skip_loopback, true, "Do not compress native protocol traffic over loopback connections, where copying the data costs more than the bytes saved.") \
+    \
     M(SettingUInt64, priority, 0, "Priority of the query. 1 - the highest, higher value - lower priority; 0 - do not use priorities.") \
     \
     M(SettingBool, log_queries, 0, "Log requests and write the log to the system table.") \
@@ -123,11 +161,15 @@ struct Settings
     M(SettingDistributedProductMode, distributed_product_mode, DistributedProductMode::DENY, "How are distributed subqueries performed inside IN or JOIN sections?") \
     \
     M(SettingUInt64, max_concurrent_queries_for_user, 0, "The maximum number of concurrent requests per user.") \
+    M(SettingUInt64, max_concurrent_queries_for_low_priority, 0, "The maximum number of concurrently running queries with priority greater than zero. Such queries wait up to queue_max_wait_ms for a slot instead of being rejected immediately. Queries with priority 0 are not limited. Zero means unlimited.") \
     \
     M(SettingBool, insert_deduplicate, true, "For INSERT queries in the replicated table, specifies that deduplication of insertings blocks should be preformed") \
+    M(SettingString, insert_deduplication_token, "", "If not empty, used as the deduplication ID of the inserted data instead of the hash of the data itself. Allows idempotent retries of inserts whose data is not byte-identical, and is propagated to materialized views with a per-view suffix.") \
     \
     M(SettingUInt64, insert_quorum, 0, "For INSERT queries in the replicated table, wait writing for the specified number of replicas and linearize the addition of the data. 0 - disabled.") \
     M(SettingMilliseconds, insert_quorum_timeout, 600000, "") \
+    M(SettingUInt64, parts_to_delay_insert, 0, "For INSERT queries in a MergeTree table, overrides the parts_to_delay_insert setting of the table. 0 - use the table setting.") \
+    M(SettingUInt64, parts_to_throw_insert, 0, "For INSERT queries in a MergeTree table, overrides the parts_to_throw_insert setting of the table. 0 - use the table setting.") \
     M(SettingUInt64, select_sequential_consistency, 0, "For SELECT queries from the replicated table, throw an exception if the replica does not have a chunk written with the quorum; do not read the parts that have not yet been written with the quorum.") \
     M(SettingUInt64, table_function_remote_max_addresses, 1000, "The maximum number of different shards and the maximum number of replicas of one shard in the `remote` function.") \
     M(SettingMilliseconds, read_backoff_min_latency_ms, 1000, "Setting to reduce the number of threads in case of slow reads. Pay attention only to reads that took at least that much time.") \
@@ -153,6 +195,9 @@ struct Settings
     \
     M(SettingBool, input_format_values_interpret_expressions, true, "For Values format: if field could not be parsed by streaming parser, run SQL parser and try to interpret it as SQL expression.") \
     \
+    M(SettingBool, input_format_parallel_parsing, true, "Parse row-based input formats in several threads: a separate thread cuts the data into chunks at row boundaries and the chunks are parsed in parallel. Works for formats with a registered file segmentation engine (TSV, TSKV, CSV, JSONEachRow).") \
+    M(SettingUInt64, min_chunk_bytes_for_parallel_parsing, (1024 * 1024), "The minimum size of a chunk (in bytes) that one thread parses at once, for parallel parsing of input formats.") \
+    \
     M(SettingBool, output_format_json_quote_64bit_integers, true, "Controls quoting of 64-bit integers in JSON output format.") \
     \
     M(SettingBool, output_format_json_quote_denormals, false, "Enables '+nan', '-nan', '+inf', '-inf' outputs in JSON output format.") \
@@ -168,6 +213,7 @@ struct Settings
     M(SettingBool, send_progress_in_http_headers, false, "Send progress notifications using X-ClickHouse-Progress headers. Some clients do not support high amount of HTTP headers (Python requests in particular), so it is disabled by default.") \
     \
     M(SettingUInt64, http_headers_progress_interval_ms, 100, "Do not send HTTP headers X-ClickHouse-Progress more frequently than at each specified interval.") \
+    M(SettingBool, flush_result_after_each_block, false, "Flush the result to the client after each block instead of when the output buffer fills up. With the chunked HTTP interface this gives progressive results in constant server memory: a slow client stalls the query pipeline instead of making the server buffer the result.") \
     \
     M(SettingBool, fsync_metadata, 1, "Do fsync after changing metadata for tables and databases (.sql files). Could be disabled in case of poor latency on server with high load of DDL queries and high load of disk subsystem.") \
     \
@@ -175,6 +221,10 @@ struct Settings
     M(SettingFloat, input_format_allow_errors_ratio, 0, "Maximum relative amount of errors while reading text formats (like CSV, TSV). In case of error, if both absolute and relative values are non-zero, and at least absolute or relative amount of errors is lower than corresponding value, will skip until next line and continue.") \
     \
     M(SettingBool, join_use_nulls, 0, "Use NULLs for non-joined rows of outer JOINs. If false, use default value of corresponding columns data type.") \
+    M(SettingString, join_algorithm, "hash", "Which JOIN algorithm to use: 'hash' - a single hash table, built in one thread; 'partitioned_hash' - the right-hand table is split by key hash into independent partitions, which are built in parallel by max_threads threads and probed without synchronization; 'merge' - sort both sides by the keys (with external sort, if needed) and merge, only for LEFT and INNER joins; 'auto' - use a hash table while it fits into the limits for JOIN, then convert to merge; 'grace_hash' - scatter both sides by key hash into partitions on disk and join partition pairs in memory, only for LEFT and INNER joins.") \
+    M(SettingUInt64, grace_hash_join_buckets, 64, "Number of disk partitions of both sides for join_algorithm = 'grace_hash' (rounded up to a power of two).") \
+    M(SettingBool, join_runtime_filter, false, "Build a Bloom filter of the right-hand JOIN keys during the build phase and drop non-matching rows of the left table before they reach the join. Applied only to INNER and RIGHT joins, where it cannot change the result.") \
+    M(SettingUInt64, join_runtime_filter_size_bytes, 1048576, "Size of the Bloom filter for join_runtime_filter, in bytes (rounded up to a power of two).") \
     \
     M(SettingJoinStrictness, join_default_strictness, JoinStrictness::ALL, "Set default strictness in JOIN query. Possible values: empty string, 'ANY', 'ALL'. If empty, query without strictness will throw exception.") \
     \
@@ -186,6 +236,7 @@ struct Settings
     \
     M(SettingBool, insert_distributed_sync, false, "If setting is enabled, insert query into distributed waits until data will be sent to all nodes in cluster.") \
     M(SettingUInt64, insert_distributed_timeout, 0, "Timeout for insert query into distributed. Setting is used only with insert_distributed_sync enabled. Zero value means no timeout.") \
+    M(SettingBool, distributed_insert_select_shard_local, false, "If the target and the source of an INSERT SELECT are Distributed tables on the same cluster with the same sharding key, run the query on every shard over the underlying tables instead of funneling all data through the initiator.") \
     M(SettingInt64, distributed_ddl_task_timeout, 180, "Timeout for DDL query responses from all hosts in cluster. Negative value means infinite.") \
     M(SettingMilliseconds, stream_flush_interval_ms, DEFAULT_QUERY_LOG_FLUSH_INTERVAL_MILLISECONDS, "Timeout for flushing data from streaming storages.") \
     M(SettingString, format_schema, "", "Schema identifier (used by schema-based formats)") \
@@ -198,6 +249,8 @@ struct Settings
     M(SettingBool, empty_result_for_aggregation_by_empty_set, false, "Return empty result when aggregating without keys on empty set.") \
     M(SettingBool, allow_distributed_ddl, true, "If it is set to true, then a user is allowed to executed distributed DDL queries.") \
     M(SettingUInt64, odbc_max_field_size, 1024, "Max size of filed can be read from ODBC dictionary. Long strings are truncated.") \
+    M(SettingUInt64, max_download_threads, 1, "The maximum number of threads to download an HTTP source (URL engine and url table function) with ranged requests. Servers without byte range support are downloaded sequentially.") \
+    M(SettingUInt64, max_download_buffer_size, 10485760, "The size in bytes of one ranged HTTP request when downloading with multiple threads.") \
     \
     \
     /** Limits during query execution are part of the settings. \
@@ -214,6 +267,7 @@ struct Settings
     M(SettingUInt64, max_rows_to_group_by, 0, "") \
     M(SettingOverflowMode<true>, group_by_overflow_mode, OverflowMode::THROW, "What to do when the limit is exceeded.") \
     M(SettingUInt64, max_bytes_before_external_group_by, 0, "") \
+    M(SettingFloat, max_bytes_ratio_before_external_group_by, 0., "Start flushing aggregation data to temporary files when memory usage of the query exceeds this share of its memory limit (max_memory_usage). Spilling then begins before the limit is exhausted. 0 - disabled.") \
     \
     M(SettingUInt64, max_rows_to_sort, 0, "") \
     M(SettingUInt64, max_bytes_to_sort, 0, "") \
@@ -221,6 +275,8 @@ struct Settings
     M(SettingUInt64, max_bytes_before_external_sort, 0, "") \
     M(SettingUInt64, max_bytes_before_remerge_sort, 1000000000, "In case of ORDER BY with LIMIT, when memory usage is higher than specified threshold, perform additional steps of merging blocks before final merge to keep just top LIMIT rows.") \
     \
+    M(SettingUInt64, temporary_table_max_bytes_in_memory, 0, "Maximum amount of RAM a temporary (session or external) table keeps. When exceeded, its blocks are merged into dense ones and written to a compressed file in the temporary directory. 0 - unlimited.") \
+    \
     M(SettingUInt64, max_result_rows, 0, "Limit on result size in rows. Also checked for intermediate data sent from remote servers.") \
     M(SettingUInt64, max_result_bytes, 0, "Limit on result size in bytes (uncompressed). Also checked for intermediate data sent from remote servers.") \
     M(SettingOverflowMode<false>, result_overflow_mode, OverflowMode::THROW, "What to do when the limit is exceeded.") \
@@ -259,10 +315,12 @@ struct Settings
     M(SettingUInt64, max_rows_in_distinct, 0, "Maximum number of elements during execution of DISTINCT.") \
     M(SettingUInt64, max_bytes_in_distinct, 0, "Maximum total size of state (in uncompressed bytes) in memory for the execution of DISTINCT.") \
     M(SettingOverflowMode<false>, distinct_overflow_mode, OverflowMode::THROW, "What to do when the limit is exceeded.") \
+    M(SettingUInt64, max_bytes_before_external_distinct, 0, "Start partitioning new DISTINCT keys into temporary files when the in-memory set exceeds this size (in uncompressed bytes). 0 - disabled.") \
     \
     M(SettingUInt64, max_memory_usage, 0, "Maximum memory usage for processing of single query. Zero means unlimited.") \
     M(SettingUInt64, max_memory_usage_for_user, 0, "Maximum memory usage for processing all concurrently running queries for the user. Zero means unlimited.") \
     M(SettingUInt64, max_memory_usage_for_all_queries, 0, "Maximum memory usage for processing all concurrently running queries on the server. Zero means unlimited.") \
+    M(SettingFloat, memory_usage_soft_limit_ratio, 0., "Share of the memory limits at which memory pressure is signalled: operators that can spill to disk (aggregation, sorting, DISTINCT) start doing so instead of waiting for the hard limit to kill the query. Also applied to max_memory_usage_for_all_queries: when the server-wide soft limit is crossed, the largest query is asked to release memory first. Zero means disabled.") \
     \
     M(SettingUInt64, max_network_bandwidth, 0, "The maximum speed of data exchange over the network in bytes per second for a query. Zero means unlimited.") \
     M(SettingUInt64, max_network_bytes, 0, "The maximum number of bytes (compressed) to receive or transmit over the network for execution of the query.") \
@@ -276,12 +334,19 @@ struct Settings
     M(SettingBool, log_profile_events, true, "Log query performance statistics into the query_log and query_thread_log.") \
     M(SettingBool, log_query_settings, true, "Log query settings into the query_log.") \
     M(SettingBool, log_query_threads, true, "Log query threads into system.query_thread_log table. This setting have effect only when 'log_queries' is true.") \
+    M(SettingUInt64, query_profiler_real_time_period_ns, 0, "Period for the real clock timer of the sampling query profiler, in nanoseconds. Stack traces of query threads are collected at this frequency and stored in the system.trace_log table (requires the trace_log section in the server config). Recommended value: 10000000 (100 times a second) or higher. 0 - disabled.") \
     M(SettingString, send_logs_level, "none", "Send server text logs with specified minumum level to client. Valid values: 'trace', 'debug', 'information', 'warning', 'error', 'none'") \
     M(SettingBool, enable_optimize_predicate_expression, 0, "If it is set to true, optimize predicates to subqueries.") \
+    M(SettingBool, fuse_filter_and_expression, true, "Evaluate the expression stage that follows WHERE inside the filter stream itself, in the same pass over the block and only for the rows that passed the filter.") \
+    M(SettingBool, optimize_aggregation_from_metadata, true, "Answer queries like SELECT count() FROM table (also min/max over partition or leading primary key columns) from MergeTree part metadata, without reading any data.") \
+    M(SettingBool, optimize_query_plan, true, "Apply rule-based query rewrites (redundant ORDER BY removal, LIMIT pushdown into UNION ALL branches) before execution. PLAN <query> shows the rules that fired.") \
+    M(SettingBool, adapt_block_size_to_concurrency, true, "Divide preferred_block_size_bytes by the number of concurrently running queries, so that the combined working set of all readers stays cache-friendly under load.") \
+    M(SettingUInt64, aggregation_preferred_block_size_bytes, 16777216, "Split blocks produced by the aggregation stage into blocks of approximately the specified size in bytes, computed from the actual average row width of each block. Zero means do not split.") \
     \
     M(SettingUInt64, low_cardinality_max_dictionary_size, 8192, "Maximum size (in rows) of shared global dictionary for LowCardinality type.") \
     M(SettingBool, low_cardinality_use_single_dictionary_for_part, false, "LowCardinality type serialization setting. If is true, than will use additional keys when global dictionary overflows. Otherwise, will create several shared dictionaries.") \
     M(SettingBool, allow_experimental_low_cardinality_type, false, "Allows to create table with LowCardinality types.") \
+    M(SettingBool, low_cardinality_share_dictionaries, true, "Re-encode LowCardinality columns before aggregation so that consecutive blocks share one dictionary object. Lets the aggregator reuse its per-dictionary caches across blocks.") \
     M(SettingBool, decimal_check_overflow, true, "Check overflow of decimal arithmetic/comparison operations") \
     \
     M(SettingBool, prefer_localhost_replica, 1, "1 - always send query to local replica, if it exists. 0 - choose replica to send query between local and remote ones according to load_balancing") \
@@ -292,6 +357,11 @@ struct Settings
     M(SettingBool, allow_ddl, true, "If it is set to true, then a user is allowed to executed DDL queries.") \
     M(SettingBool, parallel_view_processing, false, "Enables pushing to attached views concurrently instead of sequentially.") \
     M(SettingBool, enable_debug_queries, false, "Enables debug queries such as AST.") \
+    M(SettingBool, async_insert, false, "If true, data of INSERT queries is accumulated in a server-side staging buffer and flushed to the table in background as one block together with data of other INSERTs. Collapses many small INSERTs into few parts without client-side batching.") \
+    M(SettingUInt64, async_insert_max_data_size, 1048576, "Maximum size in bytes of a staging buffer of asynchronous INSERTs before it is flushed.") \
+    M(SettingMilliseconds, async_insert_busy_timeout_ms, 200, "Maximum time to accumulate data of asynchronous INSERTs in a staging buffer before it is flushed.") \
+    M(SettingBool, wait_for_async_insert, true, "If true, an asynchronous INSERT returns only after its data has been flushed to the table, and a failed flush is reported to the client as an error.") \
+    M(SettingSeconds, wait_for_async_insert_timeout, 120, "Timeout for waiting for the flush of asynchronously inserted data.") \
 
 
 #define DECLARE(TYPE, NAME, DEFAULT, DESCRIPTION) \
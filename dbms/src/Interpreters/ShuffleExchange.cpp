@@ -0,0 +1,288 @@
+#include <Interpreters/ShuffleExchange.h>
+#include <Interpreters/createBlockSelector.h>
+
+#include <DataStreams/NativeBlockInputStream.h>
+#include <DataStreams/NativeBlockOutputStream.h>
+#include <DataTypes/DataTypesNumber.h>
+
+#include <IO/ReadWriteBufferFromHTTP.h>
+#include <IO/WriteBufferFromOStream.h>
+#include <IO/ReadHelpers.h>
+#include <IO/WriteHelpers.h>
+
+#include <Common/ClickHouseRevision.h>
+#include <Common/typeid_cast.h>
+
+#include <Poco/Net/HTTPRequest.h>
+#include <Poco/Net/HTTPServerResponse.h>
+
+
+namespace DB
+{
+
+namespace ErrorCodes
+{
+    extern const int ABORTED;
+    extern const int TYPE_MISMATCH;
+}
+
+namespace
+{
+
+std::string getEndpointId()
+{
+    return "ShuffleExchange";
+}
+
+}
+
+
+void ShuffleExchange::push(Block block)
+{
+    size_t bytes = block.bytes();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    can_push.wait(lock, [this] { return queued_bytes < max_bytes || is_cancelled; });
+
+    if (is_cancelled)
+        throw Exception("Shuffle exchange is cancelled", ErrorCodes::ABORTED);
+
+    queue.push(std::move(block));
+    queued_bytes += bytes;
+    can_pop.notify_one();
+}
+
+void ShuffleExchange::finishSender()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    ++finished_senders;
+    if (finished_senders >= num_senders)
+        can_pop.notify_all();
+}
+
+Block ShuffleExchange::pop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    can_pop.wait(lock, [this] { return !queue.empty() || finished_senders >= num_senders || is_cancelled; });
+
+    if (is_cancelled)
+        throw Exception("Shuffle exchange is cancelled", ErrorCodes::ABORTED);
+
+    if (queue.empty())
+        return {};
+
+    Block block = std::move(queue.front());
+    queue.pop();
+    queued_bytes -= block.bytes();
+    can_push.notify_one();
+    return block;
+}
+
+void ShuffleExchange::cancel()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    is_cancelled = true;
+    can_push.notify_all();
+    can_pop.notify_all();
+}
+
+
+ShuffleExchangePtr ShuffleExchangeRegistry::getOrCreate(const String & exchange_id, size_t num_senders, size_t max_bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = exchanges.find(exchange_id);
+    if (it != exchanges.end())
+        return it->second;
+
+    return exchanges.emplace(exchange_id, std::make_shared<ShuffleExchange>(num_senders, max_bytes)).first->second;
+}
+
+void ShuffleExchangeRegistry::erase(const String & exchange_id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    exchanges.erase(exchange_id);
+}
+
+
+std::string ShuffleExchangeService::getId(const std::string & /*node_id*/) const
+{
+    return getEndpointId();
+}
+
+void ShuffleExchangeService::processQuery(const Poco::Net::HTMLForm & params, ReadBuffer & body, WriteBuffer & out, Poco::Net::HTTPServerResponse & /*response*/)
+{
+    if (blocker.isCancelled())
+        throw Exception("Receiving of shuffle blocks was cancelled", ErrorCodes::ABORTED);
+
+    String exchange_id = params.get("exchange_id");
+    size_t num_senders = parse<size_t>(params.get("num_senders"));
+    bool last = params.get("last", "0") == "1";
+
+    auto exchange = registry.getOrCreate(exchange_id, num_senders, ShuffleExchangeRegistry::DEFAULT_MAX_QUEUED_BYTES);
+
+    if (last)
+    {
+        LOG_TRACE(log, "Sender of exchange " << exchange_id << " has finished");
+        exchange->finishSender();
+    }
+    else
+    {
+        NativeBlockInputStream stream(body, ClickHouseRevision::get());
+        while (Block block = stream.read())
+            exchange->push(std::move(block));
+    }
+
+    writeString("OK", out);
+}
+
+
+ShuffleBlockInputStream::ShuffleBlockInputStream(ShuffleExchangeRegistry & registry_, const String & exchange_id_,
+                                                 const Block & header_, size_t num_senders, size_t max_bytes)
+    : registry(registry_), exchange_id(exchange_id_), header(header_)
+    , exchange(registry.getOrCreate(exchange_id, num_senders, max_bytes))
+{
+}
+
+ShuffleBlockInputStream::~ShuffleBlockInputStream()
+{
+    exchange->cancel();
+    registry.erase(exchange_id);
+}
+
+void ShuffleBlockInputStream::cancel(bool kill)
+{
+    IProfilingBlockInputStream::cancel(kill);
+    exchange->cancel();
+}
+
+Block ShuffleBlockInputStream::readImpl()
+{
+    return exchange->pop();
+}
+
+
+ShuffleBlockOutputStream::ShuffleBlockOutputStream(
+    ShuffleExchangeRegistry & registry_, const Block & header_,
+    const String & exchange_id_prefix_, size_t num_senders_,
+    const ExpressionActionsPtr & key_expr_, const String & key_column_name_,
+    const Destinations & destinations_, const ConnectionTimeouts & timeouts_)
+    : registry(registry_), header(header_)
+    , exchange_id_prefix(exchange_id_prefix_), num_senders(num_senders_)
+    , key_expr(key_expr_), key_column_name(key_column_name_)
+    , destinations(destinations_), timeouts(timeouts_)
+{
+}
+
+IColumn::Selector ShuffleBlockOutputStream::createSelector(const Block & block) const
+{
+    Block block_with_key = block;
+    key_expr->execute(block_with_key);
+
+    const auto & key_column = block_with_key.getByName(key_column_name);
+
+    /// One slot per destination: rows are assigned by key % destinations.size().
+    std::vector<UInt64> slots(destinations.size());
+    for (size_t i = 0; i < slots.size(); ++i)
+        slots[i] = i;
+
+#define CREATE_FOR_TYPE(TYPE) \
+    if (typeid_cast<const DataType ## TYPE *>(key_column.type.get())) \
+        return createBlockSelector<TYPE>(*key_column.column, slots);
+
+    CREATE_FOR_TYPE(UInt8)
+    CREATE_FOR_TYPE(UInt16)
+    CREATE_FOR_TYPE(UInt32)
+    CREATE_FOR_TYPE(UInt64)
+    CREATE_FOR_TYPE(Int8)
+    CREATE_FOR_TYPE(Int16)
+    CREATE_FOR_TYPE(Int32)
+    CREATE_FOR_TYPE(Int64)
+
+#undef CREATE_FOR_TYPE
+
+    throw Exception{"Shuffle key expression does not evaluate to an integer type", ErrorCodes::TYPE_MISMATCH};
+}
+
+void ShuffleBlockOutputStream::write(const Block & block)
+{
+    auto selector = createSelector(block);
+
+    const size_t num_destinations = destinations.size();
+    Blocks partitioned_blocks(num_destinations);
+
+    for (size_t i = 0; i < num_destinations; ++i)
+        partitioned_blocks[i] = block.cloneEmpty();
+
+    size_t columns_in_block = block.columns();
+    for (size_t col = 0; col < columns_in_block; ++col)
+    {
+        MutableColumns partitioned_columns = block.getByPosition(col).column->scatter(num_destinations, selector);
+        for (size_t i = 0; i < num_destinations; ++i)
+            partitioned_blocks[i].getByPosition(col).column = std::move(partitioned_columns[i]);
+    }
+
+    for (size_t i = 0; i < num_destinations; ++i)
+        if (partitioned_blocks[i].rows())
+            sendToDestination(i, partitioned_blocks[i], false);
+}
+
+void ShuffleBlockOutputStream::writeSuffix()
+{
+    for (size_t i = 0; i < destinations.size(); ++i)
+        sendToDestination(i, {}, true);
+}
+
+void ShuffleBlockOutputStream::sendToDestination(size_t destination_num, const Block & block, bool last)
+{
+    String exchange_id = exchange_id_prefix + "_" + toString(destination_num);
+    const Destination & destination = destinations[destination_num];
+
+    /// The partition owned by this server doesn't take the trip through HTTP.
+    if (destination.host.empty())
+    {
+        auto exchange = registry.getOrCreate(exchange_id, num_senders, ShuffleExchangeRegistry::DEFAULT_MAX_QUEUED_BYTES);
+        if (last)
+            exchange->finishSender();
+        else
+            exchange->push(block);
+        return;
+    }
+
+    Poco::URI uri;
+    uri.setScheme(destination.scheme);
+    uri.setHost(destination.host);
+    uri.setPort(destination.port);
+    uri.setQueryParameters(
+    {
+        {"endpoint", getEndpointId()},
+        {"exchange_id", exchange_id},
+        {"num_senders", toString(num_senders)},
+        {"last", last ? "1" : "0"},
+        {"compress", "false"}
+    });
+
+    Poco::Net::HTTPBasicCredentials creds{};
+    if (!destination.user.empty())
+    {
+        creds.setUsername(destination.user);
+        creds.setPassword(destination.password);
+    }
+
+    ReadWriteBufferFromHTTP::OutStreamCallback out_stream_callback;
+    if (!last)
+    {
+        out_stream_callback = [this, &block] (std::ostream & ostr)
+        {
+            WriteBufferFromOStream out(ostr);
+            NativeBlockOutputStream block_out(out, ClickHouseRevision::get(), header);
+            block_out.write(block);
+            out.next();
+        };
+    }
+
+    ReadWriteBufferFromHTTP in{uri, Poco::Net::HTTPRequest::HTTP_POST, out_stream_callback, timeouts, creds};
+    assertString("OK", in);
+}
+
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <Core/Block.h>
+#include <DataStreams/IProfilingBlockInputStream.h>
+#include <DataStreams/IBlockOutputStream.h>
+#include <Interpreters/InterserverIOHandler.h>
+#include <Interpreters/ExpressionActions.h>
+#include <IO/ConnectionTimeouts.h>
+
+#include <common/logger_useful.h>
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <queue>
+
+
+namespace DB
+{
+
+/** Interserver exchange of temporary query data ("shuffle").
+  *
+  * A query stage on every participating server repartitions its blocks by a hash of key columns
+  * and pushes partition i to the server that owns it, over the interserver HTTP port (the same
+  * channel DataPartsExchange uses for parts). Each server then consumes the blocks of its own
+  * partition from all senders. This is a transport for distributed sort-merge JOIN and
+  * distributed ORDER BY; it does not plan queries by itself.
+  */
+
+/// In-memory rendezvous point for the blocks of one partition on the receiving server.
+/// Senders push blocks (blocking when max_bytes of blocks are already queued), the single
+/// consumer pops them until every sender has reported completion.
+class ShuffleExchange
+{
+public:
+    ShuffleExchange(size_t num_senders_, size_t max_bytes_)
+        : num_senders(num_senders_), max_bytes(max_bytes_) {}
+
+    /// Push a block from a sender. Blocks the caller while the queue holds max_bytes or more.
+    void push(Block block);
+
+    /// Each sender calls this exactly once after its last block.
+    void finishSender();
+
+    /// Next block for the consumer. An empty block means all senders have finished.
+    Block pop();
+
+    /// Wake up everyone with an ABORTED error, e.g. when the consuming query dies.
+    void cancel();
+
+private:
+    std::mutex mutex;
+    std::condition_variable can_push;
+    std::condition_variable can_pop;
+
+    std::queue<Block> queue;
+    size_t queued_bytes = 0;
+    size_t finished_senders = 0;
+    bool is_cancelled = false;
+
+    const size_t num_senders;
+    const size_t max_bytes;
+};
+
+using ShuffleExchangePtr = std::shared_ptr<ShuffleExchange>;
+
+
+/// Active exchanges of this server, keyed by an id unique across the cluster
+/// (usually query id + stage + partition number). Owned by the global Context.
+class ShuffleExchangeRegistry
+{
+public:
+    static constexpr size_t DEFAULT_MAX_QUEUED_BYTES = 1ULL << 30;
+
+    /// Both the consumer and the service use this: whoever comes first creates the exchange.
+    ShuffleExchangePtr getOrCreate(const String & exchange_id, size_t num_senders, size_t max_bytes);
+
+    void erase(const String & exchange_id);
+
+private:
+    std::mutex mutex;
+    std::map<String, ShuffleExchangePtr> exchanges;
+};
+
+
+/// Receives blocks pushed by peer servers and routes them into the registry.
+class ShuffleExchangeService final : public InterserverIOEndpoint
+{
+public:
+    ShuffleExchangeService(ShuffleExchangeRegistry & registry_)
+        : registry(registry_), log(&Logger::get("ShuffleExchangeService")) {}
+
+    ShuffleExchangeService(const ShuffleExchangeService &) = delete;
+    ShuffleExchangeService & operator=(const ShuffleExchangeService &) = delete;
+
+    std::string getId(const std::string & node_id) const override;
+    void processQuery(const Poco::Net::HTMLForm & params, ReadBuffer & body, WriteBuffer & out, Poco::Net::HTTPServerResponse & response) override;
+
+private:
+    ShuffleExchangeRegistry & registry;
+    Logger * log;
+};
+
+
+/// Reads the blocks of the partition assigned to this server until all senders have finished.
+class ShuffleBlockInputStream : public IProfilingBlockInputStream
+{
+public:
+    ShuffleBlockInputStream(ShuffleExchangeRegistry & registry_, const String & exchange_id_,
+                            const Block & header_, size_t num_senders, size_t max_bytes);
+    ~ShuffleBlockInputStream() override;
+
+    String getName() const override { return "Shuffle"; }
+    Block getHeader() const override { return header; }
+
+    void cancel(bool kill) override;
+
+protected:
+    Block readImpl() override;
+
+private:
+    ShuffleExchangeRegistry & registry;
+    String exchange_id;
+    Block header;
+    ShuffleExchangePtr exchange;
+};
+
+
+/// Scatters blocks over the cluster: partition i of every block goes to destination i.
+/// The key expression must evaluate to an integer column, like a Distributed sharding key;
+/// rows are assigned to partitions by key % number of destinations.
+class ShuffleBlockOutputStream : public IBlockOutputStream
+{
+public:
+    struct Destination
+    {
+        /// An empty host means this server: blocks are pushed directly into the local registry.
+        String host;
+        UInt16 port = 0;
+        String scheme = "http";
+        String user;
+        String password;
+    };
+    using Destinations = std::vector<Destination>;
+
+    ShuffleBlockOutputStream(
+        ShuffleExchangeRegistry & registry_, const Block & header_,
+        const String & exchange_id_prefix_, size_t num_senders_,
+        const ExpressionActionsPtr & key_expr_, const String & key_column_name_,
+        const Destinations & destinations_, const ConnectionTimeouts & timeouts_);
+
+    Block getHeader() const override { return header; }
+    void write(const Block & block) override;
+
+    /// Tells every destination that this sender has no more blocks.
+    void writeSuffix() override;
+
+private:
+    IColumn::Selector createSelector(const Block & block) const;
+    void sendToDestination(size_t destination_num, const Block & block, bool last);
+
+    ShuffleExchangeRegistry & registry;
+    Block header;
+    String exchange_id_prefix;
+    size_t num_senders;
+    ExpressionActionsPtr key_expr;
+    String key_column_name;
+    Destinations destinations;
+    ConnectionTimeouts timeouts;
+};
+
+}
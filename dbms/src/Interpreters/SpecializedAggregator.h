@@ -143,6 +143,15 @@ void NO_INLINE Aggregator::executeSpecializedCase(
         /// Get the key to insert into the hash table.
         typename Method::Key key = state.getKey(key_columns, params.keys_size, i, key_sizes, keys, *aggregates_pool);
 
+        /// Prefetch the cell for a row a few iterations ahead, to overlap the cache miss with the work on the current rows.
+        if constexpr (Method::prefetch_optimization && Method::Data::supports_prefetch)
+        {
+            static constexpr size_t prefetch_look_ahead = 16;
+            if (i + prefetch_look_ahead < rows)
+                method.data.prefetchByHash(method.data.hash(
+                    state.getKey(key_columns, params.keys_size, i + prefetch_look_ahead, key_sizes, keys, *aggregates_pool)));
+        }
+
         if (!no_more_keys)    /// Insert.
         {
             /// Optimization for frequently repeating keys.
@@ -0,0 +1,98 @@
+#include <Interpreters/SubqueryResultCache.h>
+#include <Interpreters/Set.h>
+#include <Interpreters/Join.h>
+#include <Common/ProfileEvents.h>
+
+
+namespace ProfileEvents
+{
+    extern const Event SubqueryResultCacheHits;
+    extern const Event SubqueryResultCacheMisses;
+}
+
+namespace DB
+{
+
+size_t SubqueryResultCacheEntryWeightFunction::operator()(const SubqueryResultCacheEntry & entry) const
+{
+    if (entry.set)
+        return entry.set->getTotalByteCount();
+    if (entry.join)
+        return entry.join->getTotalByteCount();
+    if (entry.scalar_result)
+        return entry.scalar_result->bytes();
+    return 0;
+}
+
+
+SubqueryResultCache::MappedPtr SubqueryResultCache::tryGetEntry(const Key & key, const QueryResultCacheTableVersions & current_versions)
+{
+    MappedPtr entry = get(key);
+
+    if (entry && entry->table_versions == current_versions)
+    {
+        ProfileEvents::increment(ProfileEvents::SubqueryResultCacheHits);
+        return entry;
+    }
+
+    /// An outdated entry is not removed here: it will be replaced under the same key
+    /// when the subquery is materialized again.
+    ProfileEvents::increment(ProfileEvents::SubqueryResultCacheMisses);
+    return nullptr;
+}
+
+
+SetPtr SubqueryResultCache::tryGetSet(const Key & key, const QueryResultCacheTableVersions & current_versions)
+{
+    if (MappedPtr entry = tryGetEntry(key, current_versions))
+        return entry->set;
+    return nullptr;
+}
+
+void SubqueryResultCache::saveSet(const Key & key, const SetPtr & set, QueryResultCacheTableVersions table_versions)
+{
+    auto entry = std::make_shared<SubqueryResultCacheEntry>();
+    entry->set = set;
+    entry->table_versions = std::move(table_versions);
+    this->set(key, entry);
+}
+
+
+JoinPtr SubqueryResultCache::tryGetJoin(const Key & key, const QueryResultCacheTableVersions & current_versions)
+{
+    if (MappedPtr entry = tryGetEntry(key, current_versions))
+        return entry->join;
+    return nullptr;
+}
+
+void SubqueryResultCache::saveJoin(const Key & key, const JoinPtr & join, QueryResultCacheTableVersions table_versions)
+{
+    auto entry = std::make_shared<SubqueryResultCacheEntry>();
+    entry->join = join;
+    entry->table_versions = std::move(table_versions);
+    set(key, entry);
+}
+
+
+bool SubqueryResultCache::tryGetScalarResult(const Key & key, const QueryResultCacheTableVersions & current_versions, Block & out_result)
+{
+    if (MappedPtr entry = tryGetEntry(key, current_versions))
+    {
+        if (entry->scalar_result)
+        {
+            out_result = *entry->scalar_result;
+            return true;
+        }
+    }
+    return false;
+}
+
+void SubqueryResultCache::saveScalarResult(const Key & key, const Block & result, QueryResultCacheTableVersions table_versions)
+{
+    auto entry = std::make_shared<SubqueryResultCacheEntry>();
+    entry->scalar_result = result;
+    entry->table_versions = std::move(table_versions);
+    set(key, entry);
+}
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <optional>
+
+#include <Common/LRUCache.h>
+#include <Common/UInt128.h>
+#include <Core/Block.h>
+#include <Interpreters/QueryResultCache.h>
+
+
+namespace DB
+{
+
+class Set;
+using SetPtr = std::shared_ptr<Set>;
+class Join;
+using JoinPtr = std::shared_ptr<Join>;
+
+struct SubqueryResultCacheEntry
+{
+    /// Exactly one of the three is filled: a set built from the right side of IN (SELECT ...) ...
+    SetPtr set;
+    /// ... or a join built from the right side of a JOIN ...
+    JoinPtr join;
+    /// ... or the result of a scalar subquery (an empty block if the subquery returned no rows).
+    std::optional<Block> scalar_result;
+
+    /// Versions of the tables the subquery has read. The entry is served only while they are current.
+    QueryResultCacheTableVersions table_versions;
+};
+
+struct SubqueryResultCacheEntryWeightFunction
+{
+    size_t operator()(const SubqueryResultCacheEntry & entry) const;
+};
+
+
+/** Cache of materialized subqueries: sets built for IN (SELECT ...), joins built from the right side
+  * of a JOIN and results of scalar subqueries (see the use_subquery_result_cache setting). It allows
+  * repeated queries to reuse an expensive set or hash table instead of re-reading the source table
+  * on every execution. Thread-safe; Set and Join objects are safe to share between queries once built
+  * (StorageSet and StorageJoin do the same). Only LEFT and INNER joins are cached: RIGHT and FULL
+  * joins mark the joined rows during probing, so they cannot be shared.
+  *
+  * Keys are produced with QueryResultCache::hash() from the subquery AST; entries are validated
+  * against the current versions of the tables the subquery has read, exactly as in the query result
+  * cache, so a served set or scalar is never stale.
+  */
+class SubqueryResultCache : public LRUCache<UInt128, SubqueryResultCacheEntry, UInt128TrivialHash, SubqueryResultCacheEntryWeightFunction>
+{
+private:
+    using Base = LRUCache<UInt128, SubqueryResultCacheEntry, UInt128TrivialHash, SubqueryResultCacheEntryWeightFunction>;
+
+public:
+    SubqueryResultCache(size_t max_size_in_bytes) : Base(max_size_in_bytes) {}
+
+    /// Returns the cached set, or nullptr if there is no matching entry or it is outdated.
+    SetPtr tryGetSet(const Key & key, const QueryResultCacheTableVersions & current_versions);
+    void saveSet(const Key & key, const SetPtr & set, QueryResultCacheTableVersions table_versions);
+
+    /// The same for joins.
+    JoinPtr tryGetJoin(const Key & key, const QueryResultCacheTableVersions & current_versions);
+    void saveJoin(const Key & key, const JoinPtr & join, QueryResultCacheTableVersions table_versions);
+
+    /// Returns true and fills out_result (with an empty block if the subquery returned no rows)
+    /// if there is a matching entry.
+    bool tryGetScalarResult(const Key & key, const QueryResultCacheTableVersions & current_versions, Block & out_result);
+    void saveScalarResult(const Key & key, const Block & result, QueryResultCacheTableVersions table_versions);
+
+private:
+    MappedPtr tryGetEntry(const Key & key, const QueryResultCacheTableVersions & current_versions);
+};
+
+using SubqueryResultCachePtr = std::shared_ptr<SubqueryResultCache>;
+
+}
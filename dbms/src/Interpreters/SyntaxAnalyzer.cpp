@@ -825,7 +825,9 @@ void collectJoinedColumnsFromJoinOnExpr(AnalyzedJoin & analyzed_join, const ASTS
     };
 
     const auto supported_syntax = " Supported syntax: JOIN ON Expr([table.]column, ...) = Expr([table.]column, ...) "
-                                  "[AND Expr([table.]column, ...) = Expr([table.]column, ...) ...]";
+                                  "[AND Expr([table.]column, ...) = Expr([table.]column, ...) ...]"
+                                  " ASOF JOIN additionally expects exactly one inequality of the form"
+                                  " Expr(left table columns) >= right_table_column.";
     auto throwSyntaxException = [&](const String & msg)
     {
         throw Exception("Invalid expression for JOIN ON. " + msg + supported_syntax, ErrorCodes::INVALID_JOIN_ON_EXPRESSION);
@@ -884,14 +886,79 @@ void collectJoinedColumnsFromJoinOnExpr(AnalyzedJoin & analyzed_join, const ASTS
         }
     };
 
+    /// Whether the conjunct is the inequality of an ASOF JOIN.
+    auto is_asof_inequality = [&](const ASTPtr & expr)
+    {
+        auto * function = typeid_cast<const ASTFunction *>(expr.get());
+        return table_join.strictness == ASTTableJoin::Strictness::Asof && function
+            && (function->name == "greaterOrEquals" || function->name == "lessOrEquals");
+    };
+
+    /** The inequality of an ASOF JOIN: left_expr >= right_column (or right_column <= left_expr).
+      * The pair is added after all equality pairs: the Join class treats the last key as the ASOF column.
+      * The right side must be a plain column, because its actual values are returned with the joined rows
+      *  (unlike the equality keys, which are filled from the left table).
+      */
+    auto add_columns_from_asof_expr = [&](const ASTPtr & expr)
+    {
+        auto * function = typeid_cast<const ASTFunction *>(expr.get());
+
+        bool left_is_greater = function->name == "greaterOrEquals";
+        ASTPtr left_ast = function->arguments->children.at(left_is_greater ? 0 : 1)->clone();
+        ASTPtr right_ast = function->arguments->children.at(left_is_greater ? 1 : 0)->clone();
+
+        auto left_table_belonging = get_table_belonging(left_ast);
+        auto right_table_belonging = get_table_belonging(right_ast);
+
+        if (left_table_belonging.example_only_from_right || right_table_belonging.example_only_from_left)
+            throwSyntaxException("ASOF JOIN matches each row of the left table with the last row of the right table"
+                                 " having not greater value of the ASOF column, so in " + queryToString(expr)
+                                 + " the expression over the left table must be on the greater side of the inequality.");
+
+        if (!typeid_cast<const ASTIdentifier *>(right_ast.get()))
+            throwSyntaxException("ASOF column " + queryToString(right_ast) + " must be a column of the joined table.");
+
+        translate_qualified_names(left_ast, left_source_names, false);
+        translate_qualified_names(right_ast, right_source_names, true);
+
+        analyzed_join.key_asts_left.push_back(left_ast);
+        analyzed_join.key_names_left.push_back(left_ast->getColumnName());
+        analyzed_join.key_asts_right.push_back(right_ast);
+        analyzed_join.key_names_right.push_back(right_ast->getAliasOrColumnName());
+    };
+
+    ASTPtr asof_expression;
+
     auto * func = typeid_cast<const ASTFunction *>(table_join.on_expression.get());
     if (func && func->name == "and")
     {
         for (const auto & expr : func->arguments->children)
-            add_columns_from_equals_expr(expr);
+        {
+            if (is_asof_inequality(expr))
+            {
+                if (asof_expression)
+                    throwSyntaxException("ASOF JOIN expects exactly one inequality in ON section, got "
+                                         + queryToString(asof_expression) + " and " + queryToString(expr) + ".");
+                asof_expression = expr;
+            }
+            else
+                add_columns_from_equals_expr(expr);
+        }
     }
+    else if (is_asof_inequality(table_join.on_expression))
+        asof_expression = table_join.on_expression;
     else
         add_columns_from_equals_expr(table_join.on_expression);
+
+    if (table_join.strictness == ASTTableJoin::Strictness::Asof)
+    {
+        if (!asof_expression)
+            throwSyntaxException("ASOF JOIN expects an inequality in ON section.");
+        if (analyzed_join.key_names_left.empty())
+            throwSyntaxException("ASOF JOIN expects at least one equality condition besides the inequality.");
+
+        add_columns_from_asof_expr(asof_expression);
+    }
 }
 
 void collectJoinedColumns(AnalyzedJoin & analyzed_join, const ASTSelectQuery * select_query,
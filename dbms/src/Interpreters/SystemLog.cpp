@@ -2,6 +2,8 @@
 #include <Interpreters/QueryLog.h>
 #include <Interpreters/QueryThreadLog.h>
 #include <Interpreters/PartLog.h>
+#include <Interpreters/TraceLog.h>
+#include <Interpreters/MetricLog.h>
 
 
 namespace DB
@@ -57,6 +57,8 @@ class Context;
 class QueryLog;
 class QueryThreadLog;
 class PartLog;
+class TraceLog;
+class MetricLog;
 
 
 /// System logs should be destroyed in destructor of the last Context and before tables,
@@ -68,6 +70,8 @@ struct SystemLogs
     std::unique_ptr<QueryLog> query_log;                /// Used to log queries.
     std::unique_ptr<QueryThreadLog> query_thread_log;   /// Used to log query threads.
     std::unique_ptr<PartLog> part_log;                  /// Used to log operations with parts
+    std::unique_ptr<TraceLog> trace_log;                /// Used to log stack traces collected by the query profiler
+    std::unique_ptr<MetricLog> metric_log;              /// Used to log all metrics periodically
 };
 
 
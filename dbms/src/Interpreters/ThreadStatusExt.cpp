@@ -1,6 +1,7 @@
 #include <Common/ThreadStatus.h>
 #include <Common/CurrentThread.h>
 #include <Common/ThreadProfileEvents.h>
+#include <Common/QueryProfiler.h>
 #include <Common/Exception.h>
 #include <Interpreters/Context.h>
 #include <Interpreters/QueryThreadLog.h>
@@ -20,10 +21,15 @@ void ThreadStatus::attachQueryContext(Context & query_context_)
     if (!thread_group)
         return;
 
-    std::unique_lock lock(thread_group->mutex);
-    thread_group->query_context = query_context;
-    if (!thread_group->global_context)
-        thread_group->global_context = global_context;
+    {
+        std::unique_lock lock(thread_group->mutex);
+        thread_group->query_context = query_context;
+        if (!thread_group->global_context)
+            thread_group->global_context = global_context;
+    }
+
+    /// The query context carries the settings, so the profiler for the master thread can only be started here.
+    initQueryProfiler();
 }
 
 String ThreadStatus::getQueryID()
@@ -92,6 +98,7 @@ void ThreadStatus::attachQuery(const ThreadGroupStatusPtr & thread_group_, bool
     }
 
     initPerformanceCounters();
+    initQueryProfiler();
     thread_state = ThreadState::AttachedToQuery;
 }
 
@@ -119,6 +126,35 @@ void ThreadStatus::finalizePerformanceCounters()
     }
 }
 
+void ThreadStatus::initQueryProfiler()
+{
+    if (query_profiler || !query_context || !global_context)
+        return;
+
+    /// Samples would go nowhere if the collector is not running (no trace_log section in the server config).
+    if (!global_context->hasTraceCollector())
+        return;
+
+    const auto & settings = query_context->getSettingsRef();
+    if (!settings.query_profiler_real_time_period_ns)
+        return;
+
+    try
+    {
+        query_profiler = std::make_unique<QueryProfiler>(getQueryID(), thread_number, settings.query_profiler_real_time_period_ns);
+    }
+    catch (...)
+    {
+        /// The query should not fail just because profiling is unavailable (e.g. the limit on the number of timers).
+        tryLogCurrentException(log);
+    }
+}
+
+void ThreadStatus::finalizeQueryProfiler()
+{
+    query_profiler.reset();
+}
+
 void ThreadStatus::detachQuery(bool exit_if_already_detached, bool thread_exits)
 {
     if (exit_if_already_detached && thread_state == ThreadState::DetachedFromQuery)
@@ -128,6 +164,7 @@ void ThreadStatus::detachQuery(bool exit_if_already_detached, bool thread_exits)
     }
 
     assertState({ThreadState::AttachedToQuery}, __PRETTY_FUNCTION__);
+    finalizeQueryProfiler();
     finalizePerformanceCounters();
 
     /// Detach from thread group
@@ -139,6 +176,7 @@ void ThreadStatus::detachQuery(bool exit_if_already_detached, bool thread_exits)
 
     query_context = nullptr;
     thread_group.reset();
+    stage_name.clear();
 
     thread_state = thread_exits ? ThreadState::Died : ThreadState::DetachedFromQuery;
 }
@@ -159,6 +197,7 @@ void ThreadStatus::logToQueryThreadLog(QueryThreadLog & thread_log)
     elem.peak_memory_usage = memory_tracker.getPeak();
 
     elem.thread_name = getThreadName();
+    elem.stage = stage_name;
     elem.thread_number = thread_number;
     elem.os_thread_id = os_thread_id;
 
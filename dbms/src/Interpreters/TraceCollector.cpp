@@ -0,0 +1,98 @@
+#include <Interpreters/TraceCollector.h>
+#include <Interpreters/TraceLog.h>
+#include <Common/QueryProfiler.h>
+#include <Common/Exception.h>
+#include <Common/setThreadName.h>
+#include <common/logger_useful.h>
+
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+namespace DB
+{
+
+namespace ErrorCodes
+{
+    extern const int CANNOT_PIPE;
+    extern const int CANNOT_FCNTL;
+}
+
+
+TraceCollector::TraceCollector(TraceLog * trace_log_)
+    : log(&Logger::get("TraceCollector")), trace_log(trace_log_)
+{
+    if (0 != pipe2(pipe_fds, O_CLOEXEC))
+        throwFromErrno("Cannot create pipe for trace collector", ErrorCodes::CANNOT_PIPE);
+
+    /// The signal handler must never block on a full pipe: a sample is dropped instead.
+    if (-1 == fcntl(pipe_fds[1], F_SETFL, O_NONBLOCK))
+        throwFromErrno("Cannot set non-blocking mode for trace pipe", ErrorCodes::CANNOT_FCNTL);
+
+    thread = std::thread(&TraceCollector::run, this);
+
+    trace_pipe_write_fd.store(pipe_fds[1], std::memory_order_relaxed);
+}
+
+TraceCollector::~TraceCollector()
+{
+    /// Stop accepting new samples, then signal EOF to the reading thread by closing the write end.
+    trace_pipe_write_fd.store(-1, std::memory_order_relaxed);
+    ::close(pipe_fds[1]);
+
+    if (thread.joinable())
+        thread.join();
+
+    ::close(pipe_fds[0]);
+}
+
+void TraceCollector::run()
+{
+    setThreadName("TraceCollector");
+
+    QueryProfilerTrace record;
+    while (true)
+    {
+        /// Records are written atomically (their size is below PIPE_BUF), but reads can still be short.
+        size_t bytes_read = 0;
+        while (bytes_read < sizeof(record))
+        {
+            ssize_t res = ::read(pipe_fds[0], reinterpret_cast<char *>(&record) + bytes_read, sizeof(record) - bytes_read);
+
+            if (res < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                LOG_ERROR(log, "Cannot read from trace pipe: " << strerror(errno));
+                return;
+            }
+
+            if (res == 0)
+                return;     /// The write end is closed, the server is shutting down.
+
+            bytes_read += res;
+        }
+
+        try
+        {
+            TraceLogElement element;
+            element.event_time = time(nullptr);
+            element.thread_number = record.thread_number;
+            element.query_id.assign(record.query_id, strnlen(record.query_id, QueryProfilerTrace::QUERY_ID_MAX_LEN));
+
+            element.trace.reserve(record.size);
+            for (size_t i = 0; i < record.size; ++i)
+                element.trace.emplace_back(UInt64(reinterpret_cast<uintptr_t>(record.frames[i])));
+
+            trace_log->add(element);
+        }
+        catch (...)
+        {
+            tryLogCurrentException(log);
+        }
+    }
+}
+
+}
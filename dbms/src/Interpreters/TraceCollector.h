@@ -0,0 +1,37 @@
+#pragma once
+
+#include <thread>
+
+
+namespace Poco
+{
+    class Logger;
+}
+
+
+namespace DB
+{
+
+class TraceLog;
+
+/** Reads stack trace records sent by the query profiler signal handlers through the trace pipe
+  *  and stores them in the system.trace_log table.
+  * Created once at server startup if the trace_log section is present in the config
+  *  (see Context::initializeTraceCollector).
+  */
+class TraceCollector
+{
+public:
+    TraceCollector(TraceLog * trace_log_);
+    ~TraceCollector();
+
+private:
+    void run();
+
+    Poco::Logger * log;
+    TraceLog * trace_log;
+    int pipe_fds[2] = {-1, -1};
+    std::thread thread;
+};
+
+}
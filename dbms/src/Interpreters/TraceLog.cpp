@@ -0,0 +1,44 @@
+#include <Interpreters/TraceLog.h>
+#include <Columns/ColumnsNumber.h>
+#include <Columns/ColumnString.h>
+#include <Columns/ColumnArray.h>
+#include <DataTypes/DataTypesNumber.h>
+#include <DataTypes/DataTypeDateTime.h>
+#include <DataTypes/DataTypeDate.h>
+#include <DataTypes/DataTypeString.h>
+#include <DataTypes/DataTypeArray.h>
+#include <Common/ClickHouseRevision.h>
+#include <common/DateLUT.h>
+
+
+namespace DB
+{
+
+Block TraceLogElement::createBlock()
+{
+    return
+    {
+        {std::make_shared<DataTypeDate>(),      "event_date"},
+        {std::make_shared<DataTypeDateTime>(),  "event_time"},
+        {std::make_shared<DataTypeUInt32>(),    "revision"},
+        {std::make_shared<DataTypeUInt32>(),    "thread_number"},
+        {std::make_shared<DataTypeString>(),    "query_id"},
+        {std::make_shared<DataTypeArray>(std::make_shared<DataTypeUInt64>()), "trace"}
+    };
+}
+
+void TraceLogElement::appendToBlock(Block & block) const
+{
+    MutableColumns columns = block.mutateColumns();
+
+    size_t i = 0;
+
+    columns[i++]->insert(DateLUT::instance().toDayNum(event_time));
+    columns[i++]->insert(event_time);
+    columns[i++]->insert(ClickHouseRevision::get());
+    columns[i++]->insert(thread_number);
+    columns[i++]->insertData(query_id.data(), query_id.size());
+    columns[i++]->insert(trace);
+}
+
+}
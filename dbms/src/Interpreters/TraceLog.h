@@ -0,0 +1,32 @@
+#pragma once
+
+#include <Interpreters/SystemLog.h>
+#include <Core/Field.h>
+
+
+namespace DB
+{
+
+/** One row per stack trace sample collected by the query profiler (see Common/QueryProfiler.h).
+  * Frame addresses are stored raw and can be symbolized lazily, offline,
+  *  with addr2line against the clickhouse binary of the logged revision.
+  */
+struct TraceLogElement
+{
+    time_t event_time{};
+    UInt32 thread_number{};
+    String query_id;
+    Array trace;    /// Addresses of the frames, innermost first.
+
+    static std::string name() { return "TraceLog"; }
+    static Block createBlock();
+    void appendToBlock(Block & block) const;
+};
+
+
+class TraceLog : public SystemLog<TraceLogElement>
+{
+    using SystemLog<TraceLogElement>::SystemLog;
+};
+
+}
@@ -1,3 +1,5 @@
+#include <sstream>
+
 #include <Common/formatReadable.h>
 #include <Common/typeid_cast.h>
 
@@ -11,6 +13,8 @@
 #include <DataStreams/CountingBlockOutputStream.h>
 
 #include <Parsers/ASTInsertQuery.h>
+#include <Parsers/ASTSelectQuery.h>
+#include <Parsers/ASTSelectWithUnionQuery.h>
 #include <Parsers/ASTShowProcesslistQuery.h>
 #include <Parsers/ASTIdentifier.h>
 #include <Parsers/ASTLiteral.h>
@@ -19,8 +23,12 @@
 
 #include <Interpreters/Quota.h>
 #include <Interpreters/InterpreterFactory.h>
+#include <Interpreters/InterpreterSetQuery.h>
 #include <Interpreters/ProcessList.h>
 #include <Interpreters/QueryLog.h>
+#include <Interpreters/QueryResultCache.h>
+#include <Interpreters/QueryParseCache.h>
+#include <Interpreters/QueryPlanOptimizer.h>
 #include <Interpreters/executeQuery.h>
 #include "DNSCacheUpdater.h"
 
@@ -46,6 +54,19 @@ static void checkASTSizeLimits(const IAST & ast, const Settings & settings)
 }
 
 
+/// Totals and extremes are delivered apart from the main block stream and are not saved
+/// in the query result cache, so such queries must not use it.
+static bool hasWithTotals(const ASTSelectWithUnionQuery & select_with_union)
+{
+    for (const auto & child : select_with_union.list_of_selects->children)
+        if (const auto * select = typeid_cast<const ASTSelectQuery *>(child.get()))
+            if (select->group_by_with_totals)
+                return true;
+
+    return false;
+}
+
+
 /// NOTE This is wrong in case of single-line comments and in case of multiline string literals.
 static String joinLines(const String & query)
 {
@@ -152,15 +173,44 @@ static std::tuple<ASTPtr, BlockIO> executeQueryImpl(
     if (!internal)
         max_query_size = settings.max_query_size;
 
+    /// The debug queries (AST SELECT ...) parse differently, do not mix them into the cache.
+    QueryParseCachePtr parse_cache = (internal || settings.enable_debug_queries)
+        ? nullptr : context.getQueryParseCache();
+    UInt128 parse_cache_key {};
+    bool found_in_parse_cache = false;
+
     try
     {
-        /// TODO Parser should fail early when max_query_size limit is reached.
-        ast = parseQuery(parser, begin, end, "", max_query_size);
+        if (parse_cache)
+        {
+            parse_cache_key = QueryParseCache::hash(begin, end);
+            if ((ast = parse_cache->getClone(parse_cache_key)))
+                found_in_parse_cache = true;
+        }
 
-        /// Copy query into string. It will be written to log and presented in processlist. If an INSERT query, string will not include data to insertion.
-        if (!(begin <= ast->range.first && ast->range.second <= end))
-            throw Exception("Unexpected behavior: AST chars range is not inside source range", ErrorCodes::LOGICAL_ERROR);
-        query_size = ast->range.second - begin;
+        if (!ast)
+        {
+            /// TODO Parser should fail early when max_query_size limit is reached.
+            ast = parseQuery(parser, begin, end, "", max_query_size, settings.max_parser_depth);
+        }
+
+        if (found_in_parse_cache)
+        {
+            /// The range of a cached AST points into the buffer of the query that was parsed first.
+            query_size = end - begin;
+        }
+        else
+        {
+            /// Copy query into string. It will be written to log and presented in processlist. If an INSERT query, string will not include data to insertion.
+            if (!(begin <= ast->range.first && ast->range.second <= end))
+                throw Exception("Unexpected behavior: AST chars range is not inside source range", ErrorCodes::LOGICAL_ERROR);
+            query_size = ast->range.second - begin;
+
+            /// Only complete SELECT queries are cached: the AST of an INSERT query points into
+            /// the query buffer for the data to insert, and caching the rarer query kinds does not pay.
+            if (parse_cache && typeid_cast<const ASTSelectWithUnionQuery *>(ast.get()))
+                parse_cache->set(parse_cache_key, ast->clone());
+        }
     }
     catch (...)
     {
@@ -183,6 +233,24 @@ static std::tuple<ASTPtr, BlockIO> executeQueryImpl(
         if (!internal)
             logQuery(query.substr(0, settings.log_queries_cut_to_length), context);
 
+        /// Rule-based rewrites of SELECT queries (see QueryPlanOptimizer).
+        if (!internal && settings.optimize_query_plan)
+        {
+            if (typeid_cast<ASTSelectWithUnionQuery *>(ast.get()))
+                QueryPlanOptimizer(context).optimize(ast);
+            else if (auto * insert_query = typeid_cast<ASTInsertQuery *>(ast.get()))
+                if (insert_query->select)
+                    QueryPlanOptimizer(context).optimize(insert_query->select);
+        }
+
+        /// Apply the SETTINGS clause of an INSERT query to the query context. For SELECT queries
+        ///  this is done by the interpreter, but the INSERT output streams are built against the
+        ///  context passed here, so the overrides must be in place before the interpreter runs.
+        if (!internal)
+            if (const auto * insert_query = typeid_cast<const ASTInsertQuery *>(ast.get()))
+                if (insert_query->settings_ast)
+                    InterpreterSetQuery(insert_query->settings_ast, context).executeForCurrentContext();
+
         /// Check the limits.
         checkASTSizeLimits(*ast, settings);
 
@@ -202,8 +270,38 @@ static std::tuple<ASTPtr, BlockIO> executeQueryImpl(
         /// Load external tables if they were provided
         context.initializeExternalTablesIfSet();
 
-        auto interpreter = InterpreterFactory::get(ast, context, stage);
-        res = interpreter->execute();
+        /// Check if the complete result of this SELECT can be taken from the query result cache.
+        QueryResultCachePtr query_result_cache;
+        QueryResultCache::Key query_result_cache_key {};
+        QueryResultCacheTableVersions query_result_cache_table_versions;
+        bool save_in_query_result_cache = false;
+
+        const auto * select_with_union = typeid_cast<const ASTSelectWithUnionQuery *>(ast.get());
+        if (!internal && settings.use_query_result_cache && stage == QueryProcessingStage::Complete
+            && select_with_union && !hasWithTotals(*select_with_union) && !settings.extremes)
+        {
+            query_result_cache = context.getQueryResultCache();
+
+            /// The versions of the tables the query reads are remembered before the execution.
+            /// A cached entry is served only if they match, so a served result is never stale.
+            if (query_result_cache && QueryResultCache::collectTableVersions(*ast, context, query_result_cache_table_versions))
+            {
+                query_result_cache_key = QueryResultCache::hash(*ast, context);
+                res.in = query_result_cache->tryGetResult(query_result_cache_key, query_result_cache_table_versions);
+                save_in_query_result_cache = !res.in;
+            }
+        }
+
+        if (!res.in)
+        {
+            auto interpreter = InterpreterFactory::get(ast, context, stage);
+            res = interpreter->execute();
+
+            if (save_in_query_result_cache && res.in)
+                res.in = wrapWithQueryResultCacheSavingStream(
+                    query_result_cache, query_result_cache_key, std::move(query_result_cache_table_versions),
+                    res.in, settings.query_result_cache_max_entry_size);
+        }
 
         if (process_list_entry)
         {
@@ -310,6 +408,14 @@ static std::tuple<ASTPtr, BlockIO> executeQueryImpl(
                         elem.result_rows = stream_in_info.rows;
                         elem.result_bytes = stream_in_info.bytes;
                     }
+
+                    if (log_queries)
+                    {
+                        /// Tree of streams with per-stream timings, for retroactive analysis of where the time went.
+                        std::stringstream pipeline_str;
+                        stream_in->dumpTreeWithProfile(pipeline_str);
+                        elem.pipeline_profile = pipeline_str.str();
+                    }
                 }
                 else if (stream_out) /// will be used only for ordinary INSERT queries
                 {
@@ -503,7 +609,12 @@ void executeQuery(
             if (set_content_type)
                 set_content_type(out->getContentType());
 
-            copyData(*streams.in, *out);
+            if (context.getSettingsRef().flush_result_after_each_block)
+                copyData(*streams.in, *out,
+                    [] { return false; },
+                    [&out] (const Block &) { out->flush(); });
+            else
+                copyData(*streams.in, *out);
         }
     }
     catch (...)
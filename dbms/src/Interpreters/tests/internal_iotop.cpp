@@ -1,4 +1,4 @@
-#include <common/ThreadPool.h>
+#include <Common/ThreadPool.h>
 #include <IO/ReadBufferFromFile.h>
 #include <IO/WriteBufferFromFile.h>
 #include <IO/copyData.h>
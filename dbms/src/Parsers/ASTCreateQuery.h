@@ -18,6 +18,7 @@ public:
     IAST * partition_by = nullptr;
     IAST * order_by = nullptr;
     IAST * sample_by = nullptr;
+    IAST * ttl_table = nullptr;
     ASTSetQuery * settings = nullptr;
 
     String getID() const override { return "Storage definition"; }
@@ -35,6 +36,8 @@ public:
             res->set(res->order_by, order_by->clone());
         if (sample_by)
             res->set(res->sample_by, sample_by->clone());
+        if (ttl_table)
+            res->set(res->ttl_table, ttl_table->clone());
         if (settings)
             res->set(res->settings, settings->clone());
 
@@ -63,6 +66,11 @@ public:
             s.ostr << (s.hilite ? hilite_keyword : "") << s.nl_or_ws << "SAMPLE BY " << (s.hilite ? hilite_none : "");
             sample_by->formatImpl(s, state, frame);
         }
+        if (ttl_table)
+        {
+            s.ostr << (s.hilite ? hilite_keyword : "") << s.nl_or_ws << "TTL " << (s.hilite ? hilite_none : "");
+            ttl_table->formatImpl(s, state, frame);
+        }
         if (settings)
         {
             s.ostr << (s.hilite ? hilite_keyword : "") << s.nl_or_ws << "SETTINGS " << (s.hilite ? hilite_none : "");
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <Parsers/ASTQueryWithOutput.h>
+
+
+namespace DB
+{
+
+/** EXECUTE name [(value, ...)] query - run a statement prepared by PREPARE,
+  * binding its param(N) slots to the listed values.
+  */
+class ASTExecuteQuery : public ASTQueryWithOutput
+{
+public:
+    String name;
+
+    /// Values for the parameter slots: an ASTExpressionList, or nullptr if there are none.
+    ASTPtr arguments;
+
+    /** Get the text that identifies this element. */
+    String getID() const override { return "ExecuteQuery_" + name; }
+
+    ASTPtr clone() const override
+    {
+        auto res = std::make_shared<ASTExecuteQuery>(*this);
+        res->children.clear();
+
+        if (arguments)
+        {
+            res->arguments = arguments->clone();
+            res->children.push_back(res->arguments);
+        }
+
+        cloneOutputOptions(*res);
+        return res;
+    }
+
+protected:
+    void formatQueryImpl(const FormatSettings & settings, FormatState & state, FormatStateStacked frame) const override
+    {
+        settings.ostr << (settings.hilite ? hilite_keyword : "") << "EXECUTE " << (settings.hilite ? hilite_none : "")
+            << backQuoteIfNeed(name);
+
+        if (arguments)
+        {
+            settings.ostr << '(';
+            arguments->formatImpl(settings, state, frame);
+            settings.ostr << ')';
+        }
+    }
+};
+
+}
@@ -14,6 +14,8 @@ public:
     enum ExplainKind
     {
         ParsedAST,
+        Plan,       /// Print the query after the rule-based rewrites together with the rules that fired.
+        Pipeline,   /// Execute the query and print the tree of block streams annotated with timings.
     };
 
     ASTExplainQuery(ExplainKind kind_ = ParsedAST)
@@ -23,6 +25,8 @@ public:
     String getID() const override { return "Explain_" + toString(kind); }
     ASTPtr clone() const override { return std::make_shared<ASTExplainQuery>(*this); }
 
+    ExplainKind getKind() const { return kind; }
+
 protected:
     void formatImpl(const FormatSettings & settings, FormatState &, FormatStateStacked) const override
     {
@@ -37,6 +41,8 @@ private:
         switch (kind)
         {
             case ParsedAST: return "ParsedAST";
+            case Plan: return "PLAN";
+            case Pipeline: return "PIPELINE";
         }
         __builtin_unreachable();
     }
@@ -18,6 +18,7 @@ public:
     String format;
     ASTPtr select;
     ASTPtr table_function;
+    ASTPtr settings_ast;
 
     // Set to true if the data should only be inserted into attached views
     bool no_destination = false;
@@ -36,6 +37,7 @@ public:
 
         if (columns) { res->columns = columns->clone(); res->children.push_back(res->columns); }
         if (select) { res->select = select->clone(); res->children.push_back(res->select); }
+        if (settings_ast) { res->settings_ast = settings_ast->clone(); res->children.push_back(res->settings_ast); }
         if (table_function)
         {
             res->table_function = table_function->clone(); res->children.push_back(res->table_function);
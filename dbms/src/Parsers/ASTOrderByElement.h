@@ -6,7 +6,7 @@
 namespace DB
 {
 /** Element of expression with ASC or DESC,
-  *  and possibly with COLLATE.
+  *  and possibly with COLLATE, and possibly with WITH FILL.
   */
 class ASTOrderByElement : public IAST
 {
@@ -18,6 +18,13 @@ public:
     /** Collation for locale-specific string comparison. If empty, then sorting done by bytes. */
     ASTPtr collation;
 
+    /** WITH FILL: synthesize rows for the key values missing between adjacent rows of the result
+      *  (see FillingBlockInputStream). FROM, TO and STEP are optional constant expressions. */
+    bool with_fill = false;
+    ASTPtr fill_from;
+    ASTPtr fill_to;
+    ASTPtr fill_step;
+
     ASTOrderByElement(
         const int direction_, const int nulls_direction_, const bool nulls_direction_was_explicitly_specified_, ASTPtr & collation_)
         : direction(direction_)
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Parsers/IAST.h>
+
+
+namespace DB
+{
+
+/** PREPARE name AS SELECT ... query, and DEALLOCATE [PREPARE] name.
+  * The prepared statement is stored in the session; parameter slots are written
+  * as param(N) with 1-based N and are bound by the EXECUTE query.
+  */
+class ASTPrepareQuery : public IAST
+{
+public:
+    String name;
+
+    /// The query to prepare. nullptr for DEALLOCATE.
+    ASTPtr query;
+
+    bool deallocate = false;
+
+    /** Get the text that identifies this element. */
+    String getID() const override { return "PrepareQuery_" + name; }
+
+    ASTPtr clone() const override
+    {
+        auto res = std::make_shared<ASTPrepareQuery>(*this);
+        res->children.clear();
+
+        if (query)
+        {
+            res->query = query->clone();
+            res->children.push_back(res->query);
+        }
+
+        return res;
+    }
+
+protected:
+    void formatImpl(const FormatSettings & settings, FormatState & state, FormatStateStacked frame) const override
+    {
+        if (deallocate)
+        {
+            settings.ostr << (settings.hilite ? hilite_keyword : "") << "DEALLOCATE PREPARE " << (settings.hilite ? hilite_none : "")
+                << backQuoteIfNeed(name);
+            return;
+        }
+
+        settings.ostr << (settings.hilite ? hilite_keyword : "") << "PREPARE " << (settings.hilite ? hilite_none : "")
+            << backQuoteIfNeed(name)
+            << (settings.hilite ? hilite_keyword : "") << " AS " << (settings.hilite ? hilite_none : "");
+        query->formatImpl(settings, state, frame);
+    }
+};
+
+}
@@ -75,7 +75,8 @@ struct ASTTableJoin : public IAST
     {
         Unspecified,
         Any,    /// If there are many suitable rows to join, use any from them (also known as unique JOIN).
-        All        /// If there are many suitable rows to join, use all of them and replicate rows of "left" table (usual semantic of JOIN).
+        All,    /// If there are many suitable rows to join, use all of them and replicate rows of "left" table (usual semantic of JOIN).
+        Asof    /// Besides the equality conditions, match the last row with not greater value of the ASOF column (nearest-timestamp JOIN).
     };
 
     /// Join method.
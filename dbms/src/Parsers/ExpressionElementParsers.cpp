@@ -796,10 +796,48 @@ bool ParserOrderByElement::parseImpl(Pos & pos, ASTPtr & node, Expected & expect
             return false;
     }
 
-    node = std::make_shared<ASTOrderByElement>(direction, nulls_direction, nulls_direction_was_explicitly_specified, locale_node);
+    /// WITH FILL [FROM expr] [TO expr] [STEP expr]
+    ParserKeyword with_fill("WITH FILL");
+    ParserKeyword from("FROM");
+    ParserKeyword to("TO");
+    ParserKeyword step("STEP");
+    ParserExpressionWithOptionalAlias fill_expr_p(false);
+
+    bool has_with_fill = false;
+    ASTPtr fill_from;
+    ASTPtr fill_to;
+    ASTPtr fill_step;
+
+    if (with_fill.ignore(pos))
+    {
+        has_with_fill = true;
+
+        if (from.ignore(pos) && !fill_expr_p.parse(pos, fill_from, expected))
+            return false;
+
+        if (to.ignore(pos) && !fill_expr_p.parse(pos, fill_to, expected))
+            return false;
+
+        if (step.ignore(pos) && !fill_expr_p.parse(pos, fill_step, expected))
+            return false;
+    }
+
+    auto elem = std::make_shared<ASTOrderByElement>(direction, nulls_direction, nulls_direction_was_explicitly_specified, locale_node);
+    elem->with_fill = has_with_fill;
+    elem->fill_from = fill_from;
+    elem->fill_to = fill_to;
+    elem->fill_step = fill_step;
+
+    node = elem;
     node->children.push_back(expr_elem);
     if (locale_node)
         node->children.push_back(locale_node);
+    if (fill_from)
+        node->children.push_back(fill_from);
+    if (fill_to)
+        node->children.push_back(fill_to);
+    if (fill_step)
+        node->children.push_back(fill_step);
 
     return true;
 }
@@ -39,12 +39,42 @@ struct Expected
 };
 
 
+namespace ErrorCodes
+{
+    extern const int TOO_DEEP_RECURSION;
+    extern const int LOGICAL_ERROR;
+}
+
+
 /** Interface for parser classes
   */
 class IParser
 {
 public:
-    using Pos = TokenIterator;
+    /// Token iterator augmented with the current recursion depth, to bound the depth of the recursive descent.
+    struct Pos : TokenIterator
+    {
+        uint32_t depth = 0;
+        uint32_t max_depth = 0;
+
+        /// max_depth = 0 means unlimited.
+        Pos(Tokens & tokens_, uint32_t max_depth_ = 0) : TokenIterator(tokens_), max_depth(max_depth_) {}
+
+        ALWAYS_INLINE void increaseDepth()
+        {
+            ++depth;
+            if (max_depth > 0 && depth > max_depth)
+                throw Exception("Maximum parse depth (" + std::to_string(max_depth) + ") exceeded."
+                    " Consider rising max_parser_depth setting.", ErrorCodes::TOO_DEEP_RECURSION);
+        }
+
+        ALWAYS_INLINE void decreaseDepth()
+        {
+            if (depth == 0)
+                throw Exception("Logical error in parser: incorrect calculation of parse depth", ErrorCodes::LOGICAL_ERROR);
+            --depth;
+        }
+    };
 
     /** Get the text of this parser parses. */
     virtual const char * getName() const = 0;
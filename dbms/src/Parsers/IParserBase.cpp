@@ -15,7 +15,9 @@ bool IParserBase::parse(Pos & pos, ASTPtr & node, Expected & expected)
     Pos begin = pos;
     expected.add(pos, getName());
 
+    pos.increaseDepth();
     bool res = parseImpl(pos, node, expected);
+    pos.decreaseDepth();
 
     if (!res)
     {
@@ -0,0 +1,49 @@
+#include <Parsers/ParserExecuteQuery.h>
+
+#include <Common/typeid_cast.h>
+#include <Parsers/ASTExecuteQuery.h>
+#include <Parsers/ASTIdentifier.h>
+#include <Parsers/CommonParsers.h>
+#include <Parsers/ExpressionElementParsers.h>
+#include <Parsers/ExpressionListParsers.h>
+
+
+namespace DB
+{
+
+bool ParserExecuteQuery::parseImpl(Pos & pos, ASTPtr & node, Expected & expected)
+{
+    ParserKeyword s_execute("EXECUTE");
+    ParserIdentifier name_p;
+    ParserToken s_lparen(TokenType::OpeningRoundBracket);
+    ParserToken s_rparen(TokenType::ClosingRoundBracket);
+    ParserExpressionList values_p(false);
+
+    ASTPtr name;
+
+    if (!s_execute.ignore(pos, expected))
+        return false;
+
+    if (!name_p.parse(pos, name, expected))
+        return false;
+
+    auto query = std::make_shared<ASTExecuteQuery>();
+    query->name = typeid_cast<ASTIdentifier &>(*name).name;
+
+    if (s_lparen.ignore(pos, expected))
+    {
+        if (!values_p.parse(pos, query->arguments, expected))
+            return false;
+
+        if (!s_rparen.ignore(pos, expected))
+            return false;
+
+        query->children.push_back(query->arguments);
+    }
+
+    node = query;
+
+    return true;
+}
+
+}
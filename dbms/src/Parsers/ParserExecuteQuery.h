@@ -0,0 +1,18 @@
+#pragma once
+
+#include <Parsers/IParserBase.h>
+
+
+namespace DB
+{
+
+/** Query EXECUTE name [(value, ...)]
+  */
+class ParserExecuteQuery : public IParserBase
+{
+protected:
+    const char * getName() const { return "EXECUTE query"; }
+    bool parseImpl(Pos & pos, ASTPtr & node, Expected & expected);
+};
+
+}
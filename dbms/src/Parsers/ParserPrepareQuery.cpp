@@ -0,0 +1,58 @@
+#include <Parsers/ParserPrepareQuery.h>
+
+#include <Common/typeid_cast.h>
+#include <Parsers/ASTIdentifier.h>
+#include <Parsers/ASTPrepareQuery.h>
+#include <Parsers/CommonParsers.h>
+#include <Parsers/ExpressionElementParsers.h>
+#include <Parsers/ParserSelectWithUnionQuery.h>
+
+
+namespace DB
+{
+
+bool ParserPrepareQuery::parseImpl(Pos & pos, ASTPtr & node, Expected & expected)
+{
+    ParserKeyword s_prepare("PREPARE");
+    ParserKeyword s_deallocate("DEALLOCATE");
+    ParserKeyword s_as("AS");
+    ParserIdentifier name_p;
+    ParserSelectWithUnionQuery select_p;
+
+    auto query = std::make_shared<ASTPrepareQuery>();
+
+    ASTPtr name;
+
+    if (s_deallocate.ignore(pos, expected))
+    {
+        s_prepare.ignore(pos, expected);
+
+        if (!name_p.parse(pos, name, expected))
+            return false;
+
+        query->deallocate = true;
+    }
+    else
+    {
+        if (!s_prepare.ignore(pos, expected))
+            return false;
+
+        if (!name_p.parse(pos, name, expected))
+            return false;
+
+        if (!s_as.ignore(pos, expected))
+            return false;
+
+        if (!select_p.parse(pos, query->query, expected))
+            return false;
+
+        query->children.push_back(query->query);
+    }
+
+    query->name = typeid_cast<ASTIdentifier &>(*name).name;
+    node = query;
+
+    return true;
+}
+
+}
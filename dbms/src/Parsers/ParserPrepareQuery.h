@@ -0,0 +1,18 @@
+#pragma once
+
+#include <Parsers/IParserBase.h>
+
+
+namespace DB
+{
+
+/** Query PREPARE name AS SELECT ..., and DEALLOCATE [PREPARE] name
+  */
+class ParserPrepareQuery : public IParserBase
+{
+protected:
+    const char * getName() const { return "PREPARE query"; }
+    bool parseImpl(Pos & pos, ASTPtr & node, Expected & expected);
+};
+
+}
@@ -9,6 +9,7 @@
 #include <Parsers/ParserSetQuery.h>
 #include <Parsers/ParserAlterQuery.h>
 #include <Parsers/ParserSystemQuery.h>
+#include <Parsers/ParserPrepareQuery.h>
 
 
 namespace DB
@@ -22,12 +23,14 @@ bool ParserQuery::parseImpl(Pos & pos, ASTPtr & node, Expected & expected)
     ParserUseQuery use_p;
     ParserSetQuery set_p;
     ParserSystemQuery system_p;
+    ParserPrepareQuery prepare_p;
 
     bool res = query_with_output_p.parse(pos, node, expected)
         || insert_p.parse(pos, node, expected)
         || use_p.parse(pos, node, expected)
         || set_p.parse(pos, node, expected)
-        || system_p.parse(pos, node, expected);
+        || system_p.parse(pos, node, expected)
+        || prepare_p.parse(pos, node, expected);
 
     return res;
 }
@@ -11,6 +11,7 @@
 #include <Parsers/ParserDropQuery.h>
 #include <Parsers/ParserKillQueryQuery.h>
 #include <Parsers/ParserOptimizeQuery.h>
+#include <Parsers/ParserExecuteQuery.h>
 #include <Parsers/ASTExplainQuery.h>
 
 
@@ -31,14 +32,23 @@ bool ParserQueryWithOutput::parseImpl(Pos & pos, ASTPtr & node, Expected & expec
     ParserCheckQuery check_p;
     ParserOptimizeQuery optimize_p;
     ParserKillQueryQuery kill_query_p;
+    ParserExecuteQuery execute_p;
 
     ASTPtr query;
 
     ParserKeyword s_ast("AST");
+    ParserKeyword s_plan("PLAN");
+    ParserKeyword s_pipeline("PIPELINE");
     bool explain_ast = false;
+    bool explain_plan = false;
+    bool explain_pipeline = false;
 
     if (enable_explain && s_ast.ignore(pos, expected))
         explain_ast = true;
+    else if (enable_explain && s_plan.ignore(pos, expected))
+        explain_plan = true;
+    else if (enable_explain && s_pipeline.ignore(pos, expected))
+        explain_pipeline = true;
 
     bool parsed = select_p.parse(pos, query, expected)
         || show_tables_p.parse(pos, query, expected)
@@ -51,7 +61,8 @@ bool ParserQueryWithOutput::parseImpl(Pos & pos, ASTPtr & node, Expected & expec
         || drop_p.parse(pos, query, expected)
         || check_p.parse(pos, query, expected)
         || kill_query_p.parse(pos, query, expected)
-        || optimize_p.parse(pos, query, expected);
+        || optimize_p.parse(pos, query, expected)
+        || execute_p.parse(pos, query, expected);
 
     if (!parsed)
         return false;
@@ -86,6 +97,16 @@ bool ParserQueryWithOutput::parseImpl(Pos & pos, ASTPtr & node, Expected & expec
         node = std::make_shared<ASTExplainQuery>();
         node->children.push_back(query);
     }
+    else if (explain_plan)
+    {
+        node = std::make_shared<ASTExplainQuery>(ASTExplainQuery::Plan);
+        node->children.push_back(query);
+    }
+    else if (explain_pipeline)
+    {
+        node = std::make_shared<ASTExplainQuery>(ASTExplainQuery::Pipeline);
+        node->children.push_back(query);
+    }
     else
         node = query;
 
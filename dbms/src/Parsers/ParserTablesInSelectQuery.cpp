@@ -135,6 +135,8 @@ bool ParserTablesInSelectQueryElement::parseImpl(Pos & pos, ASTPtr & node, Expec
                 table_join->strictness = ASTTableJoin::Strictness::Any;
             else if (ParserKeyword("ALL").ignore(pos))
                 table_join->strictness = ASTTableJoin::Strictness::All;
+            else if (ParserKeyword("ASOF").ignore(pos))
+                table_join->strictness = ASTTableJoin::Strictness::Asof;
             else
                 table_join->strictness = ASTTableJoin::Strictness::Unspecified;
 
@@ -158,6 +160,11 @@ bool ParserTablesInSelectQueryElement::parseImpl(Pos & pos, ASTPtr & node, Expec
                 && table_join->kind == ASTTableJoin::Kind::Cross)
                 throw Exception("You must not specify ANY or ALL for CROSS JOIN.", ErrorCodes::SYNTAX_ERROR);
 
+            if (table_join->strictness == ASTTableJoin::Strictness::Asof
+                && table_join->kind != ASTTableJoin::Kind::Inner
+                && table_join->kind != ASTTableJoin::Kind::Left)
+                throw Exception("ASOF JOIN is allowed only with INNER or LEFT.", ErrorCodes::SYNTAX_ERROR);
+
             /// Optional OUTER keyword for outer joins.
             if (table_join->kind == ASTTableJoin::Kind::Left
                 || table_join->kind == ASTTableJoin::Kind::Right
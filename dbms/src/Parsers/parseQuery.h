@@ -15,8 +15,9 @@ ASTPtr tryParseQuery(
     bool hilite,
     const std::string & description,
     bool allow_multi_statements,    /// If false, check for non-space characters after semicolon and set error message if any.
-    size_t max_query_size);         /// If (end - pos) > max_query_size and query is longer than max_query_size then throws "Max query size exceeded".
+    size_t max_query_size,          /// If (end - pos) > max_query_size and query is longer than max_query_size then throws "Max query size exceeded".
                                     /// Disabled if zero. Is used in order to check query size if buffer can contains data for INSERT query.
+    size_t max_parser_depth = DBMS_DEFAULT_MAX_PARSER_DEPTH);   /// Bound on the recursion depth of the parser. Disabled if zero.
 
 
 /// Parse query or throw an exception with error message.
@@ -26,7 +27,8 @@ ASTPtr parseQueryAndMovePosition(
     const char * end,
     const std::string & description,
     bool allow_multi_statements,
-    size_t max_query_size);
+    size_t max_query_size,
+    size_t max_parser_depth = DBMS_DEFAULT_MAX_PARSER_DEPTH);
 
 
 ASTPtr parseQuery(
@@ -34,18 +36,21 @@ ASTPtr parseQuery(
     const char * begin,
     const char * end,
     const std::string & description,
-    size_t max_query_size);
+    size_t max_query_size,
+    size_t max_parser_depth = DBMS_DEFAULT_MAX_PARSER_DEPTH);
 
 ASTPtr parseQuery(
     IParser & parser,
     const std::string & query,
     const std::string & query_description,
-    size_t max_query_size);
+    size_t max_query_size,
+    size_t max_parser_depth = DBMS_DEFAULT_MAX_PARSER_DEPTH);
 
 ASTPtr parseQuery(
     IParser & parser,
     const std::string & query,
-    size_t max_query_size);
+    size_t max_query_size,
+    size_t max_parser_depth = DBMS_DEFAULT_MAX_PARSER_DEPTH);
 
 
 /** Split queries separated by ; on to list of single queries
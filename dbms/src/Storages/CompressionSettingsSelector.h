@@ -26,10 +26,17 @@ namespace ErrorCodes
             <!-- Conditions. All must be satisfied simultaneously. Some conditions may not be specified. -->
             <min_part_size>10000000000</min_part_size>         <!-- The minimum size of a part in bytes. -->
             <min_part_size_ratio>0.01</min_part_size_ratio>    <!-- The minimum size of the part relative to all the data in the table. -->
+            <min_part_age>2592000</min_part_age>               <!-- The minimum age of the part in seconds. Old data is read rarely
+                                                                    and may be compressed heavier; see also the MergeTree setting
+                                                                    recompress_parts_after_age_seconds. -->
 
             <! - Which compression method to choose. ->
             <method>zstd</method>
             <level>2</level>
+
+            <!-- Adapt the LZ4 acceleration / ZSTD level at runtime, balancing compression speed
+                 against the write throughput of the device. The configured level is the starting point. -->
+            <adaptive>1</adaptive>
         </case>
 
         <case>
@@ -44,6 +51,7 @@ private:
     {
         size_t min_part_size = 0;
         double min_part_size_ratio = 0;
+        time_t min_part_age = 0;
         CompressionSettings settings = CompressionSettings(CompressionMethod::LZ4);
 
         static CompressionMethod compressionMethodFromString(const std::string & name)
@@ -62,16 +70,19 @@ private:
         {
             min_part_size = config.getUInt64(config_prefix + ".min_part_size", 0);
             min_part_size_ratio = config.getDouble(config_prefix + ".min_part_size_ratio", 0);
+            min_part_age = config.getUInt64(config_prefix + ".min_part_age", 0);
 
             CompressionMethod method = compressionMethodFromString(config.getString(config_prefix + ".method"));
             int level = config.getInt64(config_prefix + ".level", CompressionSettings::getDefaultLevel(method));
             settings = CompressionSettings(method, level);
+            settings.adaptive_level = config.getBool(config_prefix + ".adaptive", false);
         }
 
-        bool check(size_t part_size, double part_size_ratio) const
+        bool check(size_t part_size, double part_size_ratio, time_t part_age) const
         {
             return part_size >= min_part_size
-                && part_size_ratio >= min_part_size_ratio;
+                && part_size_ratio >= min_part_size_ratio
+                && part_age >= min_part_age;
         }
     };
 
@@ -94,12 +105,12 @@ public:
         }
     }
 
-    CompressionSettings choose(size_t part_size, double part_size_ratio) const
+    CompressionSettings choose(size_t part_size, double part_size_ratio, time_t part_age = 0) const
     {
         CompressionSettings res = CompressionSettings(CompressionMethod::LZ4);
 
         for (const auto & element : elements)
-            if (element.check(part_size, part_size_ratio))
+            if (element.check(part_size, part_size_ratio, part_age))
                 res = element.settings;
 
         return res;
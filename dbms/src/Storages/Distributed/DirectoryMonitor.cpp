@@ -100,6 +100,7 @@ StorageDistributedDirectoryMonitor::StorageDistributedDirectoryMonitor(StorageDi
     should_batch_inserts = settings.distributed_directory_monitor_batch_inserts;
     min_batched_block_size_rows = settings.min_insert_block_size_rows;
     min_batched_block_size_bytes = settings.min_insert_block_size_bytes;
+    max_batched_files = settings.distributed_directory_monitor_max_files_to_batch;
 }
 
 
@@ -313,9 +314,10 @@ struct StorageDistributedDirectoryMonitor::Batch
 
     bool isEnoughSize() const
     {
-        return (!parent.min_batched_block_size_rows && !parent.min_batched_block_size_bytes)
+        return (parent.max_batched_files && file_indices.size() >= parent.max_batched_files)
             || (parent.min_batched_block_size_rows && total_rows >= parent.min_batched_block_size_rows)
-            || (parent.min_batched_block_size_bytes && total_bytes >= parent.min_batched_block_size_bytes);
+            || (parent.min_batched_block_size_bytes && total_bytes >= parent.min_batched_block_size_bytes)
+            || (!parent.max_batched_files && !parent.min_batched_block_size_rows && !parent.min_batched_block_size_bytes);
     }
 
     void send()
@@ -333,6 +335,11 @@ struct StorageDistributedDirectoryMonitor::Batch
             /// and truncate it afterwards if all went well.
             WriteBufferFromFile out{parent.current_batch_file_path};
             writeText(out);
+
+            /// The batch is sent only after the marker has reached the disk: otherwise after
+            /// a crash the same data could be sent again outside of the recorded batch,
+            /// breaking the deduplication. One fsync per batch, not per queued file.
+            out.sync();
         }
 
         auto connection = parent.pool->get();
@@ -367,7 +374,8 @@ struct StorageDistributedDirectoryMonitor::Batch
                 remote->writePrepared(in);
             }
 
-            remote->writeSuffix();
+            if (remote)
+                remote->writeSuffix();
         }
         catch (const Exception & e)
         {
@@ -42,6 +42,7 @@ private:
     bool should_batch_inserts = false;
     size_t min_batched_block_size_rows = 0;
     size_t min_batched_block_size_bytes = 0;
+    size_t max_batched_files = 0;
     String current_batch_file_path;
 
     struct BatchHeader;
@@ -11,6 +11,7 @@
 #include <Common/setThreadName.h>
 #include <Common/typeid_cast.h>
 #include <Formats/FormatFactory.h>
+#include <DataStreams/AsynchronousBlockInputStream.h>
 #include <DataStreams/IProfilingBlockInputStream.h>
 #include <DataStreams/LimitBlockInputStream.h>
 #include <DataStreams/UnionBlockInputStream.h>
@@ -68,6 +69,10 @@ class ReadBufferFromKafkaConsumer : public ReadBuffer
     Poco::Logger * log;
     size_t read_messages;
     char row_delimiter;
+    /// The exact positions (next offset per topic/partition) of the messages consumed for the
+    /// current batch. Committing this list instead of the consumer position guarantees that
+    /// only what was actually handed to the parser is ever marked as processed.
+    rd_kafka_topic_partition_list_t * batch_offsets;
 
     bool nextImpl() override
     {
@@ -99,6 +104,12 @@ class ReadBufferFromKafkaConsumer : public ReadBuffer
         }
         ++read_messages;
 
+        // Remember the position right after this message as the one to commit for its partition
+        auto * position = rd_kafka_topic_partition_list_find(batch_offsets, rd_kafka_topic_name(msg->rkt), msg->partition);
+        if (position == nullptr)
+            position = rd_kafka_topic_partition_list_add(batch_offsets, rd_kafka_topic_name(msg->rkt), msg->partition);
+        position->offset = msg->offset + 1;
+
         // Now we've received a new message. Check if we need to produce a delimiter
         if (row_delimiter != '\0' && current != nullptr)
         {
@@ -130,13 +141,18 @@ class ReadBufferFromKafkaConsumer : public ReadBuffer
 public:
     ReadBufferFromKafkaConsumer(rd_kafka_t * consumer_, Poco::Logger * log_, char row_delimiter_)
         : ReadBuffer(nullptr, 0), consumer(consumer_), current(nullptr),
-        current_pending(false), log(log_), read_messages(0), row_delimiter(row_delimiter_)
+        current_pending(false), log(log_), read_messages(0), row_delimiter(row_delimiter_),
+        batch_offsets(rd_kafka_topic_partition_list_new(1))
     {
         if (row_delimiter != '\0')
             LOG_TRACE(log, "Row delimiter is: " << row_delimiter);
     }
 
-    ~ReadBufferFromKafkaConsumer() override { reset(); }
+    ~ReadBufferFromKafkaConsumer() override
+    {
+        reset();
+        rd_kafka_topic_partition_list_destroy(batch_offsets);
+    }
 
     /// Commit messages read with this consumer
     void commit()
@@ -145,10 +161,15 @@ public:
         if (read_messages == 0)
             return;
 
-        auto err = rd_kafka_commit(consumer, nullptr, 1 /* async */);
+        /// Commit the offsets of exactly the messages of this batch, and synchronously:
+        /// an asynchronous commit of the consumer position could be lost on shutdown (replaying
+        /// the whole batch into the views) or could cover messages of a later, unfinished batch.
+        auto err = rd_kafka_commit(consumer, batch_offsets, 0 /* sync */);
         if (err)
             throw Exception("Failed to commit offsets: " + String(rd_kafka_err2str(err)), ErrorCodes::UNKNOWN_EXCEPTION);
 
+        rd_kafka_topic_partition_list_destroy(batch_offsets);
+        batch_offsets = rd_kafka_topic_partition_list_new(1);
         read_messages = 0;
     }
 };
@@ -157,8 +178,9 @@ class KafkaBlockInputStream : public IProfilingBlockInputStream
 {
 public:
 
-    KafkaBlockInputStream(StorageKafka & storage_, const Context & context_, const String & schema, size_t max_block_size_)
-        : storage(storage_), consumer(nullptr), context(context_), max_block_size(max_block_size_)
+    KafkaBlockInputStream(StorageKafka & storage_, const Context & context_, const String & schema, size_t max_block_size_,
+                          bool commit_in_suffix_ = true)
+        : storage(storage_), consumer(nullptr), context(context_), max_block_size(max_block_size_), commit_in_suffix(commit_in_suffix_)
     {
         // Always skip unknown fields regardless of the context (JSON or TSKV)
         context.setSetting("input_format_skip_unknown_fields", 1u);
@@ -224,14 +246,24 @@ public:
         if (hasClaimed())
         {
             reader->readSuffix();
-            // Store offsets read in this stream
-            read_buf->commit();
+            // Store offsets read in this stream (unless the caller wants to do that itself,
+            //  after the written data became durable - see streamToViews())
+            if (commit_in_suffix)
+                read_buf->commit();
         }
 
         // Mark as successfully finished
         finalized = true;
     }
 
+    /// Commit the offsets of the messages consumed so far. Used by streamToViews(), which calls
+    /// this only after writeSuffix() of the insert pipeline, when the data is in the target tables.
+    void commitMessages()
+    {
+        if (hasClaimed())
+            read_buf->commit();
+    }
+
 private:
     StorageKafka & storage;
     StorageKafka::ConsumerPtr consumer;
@@ -241,6 +273,7 @@ private:
     std::unique_ptr<ReadBufferFromKafkaConsumer> read_buf;
     BlockInputStreamPtr reader = nullptr;
     bool finalized = false;
+    bool commit_in_suffix;
 
     // Return true if consumer has been claimed by the stream
     bool hasClaimed() { return consumer != nullptr; }
@@ -269,7 +302,7 @@ StorageKafka::StorageKafka(
     const ColumnsDescription & columns_,
     const String & brokers_, const String & group_, const Names & topics_,
     const String & format_name_, char row_delimiter_, const String & schema_name_,
-    size_t num_consumers_, size_t max_block_size_)
+    size_t num_consumers_, size_t max_block_size_, size_t flush_interval_ms_)
     : IStorage{columns_},
     table_name(table_name_), database_name(database_name_), context(context_),
     topics(context.getMacros()->expand(topics_)),
@@ -278,7 +311,8 @@ StorageKafka::StorageKafka(
     format_name(context.getMacros()->expand(format_name_)),
     row_delimiter(row_delimiter_),
     schema_name(context.getMacros()->expand(schema_name_)),
-    num_consumers(num_consumers_), max_block_size(max_block_size_), log(&Logger::get("StorageKafka (" + table_name_ + ")")),
+    num_consumers(num_consumers_), max_block_size(max_block_size_), flush_interval_ms(flush_interval_ms_),
+    log(&Logger::get("StorageKafka (" + table_name_ + ")")),
     semaphore(0, num_consumers_), mutex(), consumers()
 {
     task = context.getSchedulePool().createTask(log->name(), [this]{ streamThread(); });
@@ -516,29 +550,46 @@ bool StorageKafka::streamToViews()
     streams.reserve(num_created_consumers);
     for (size_t i = 0; i < num_created_consumers; ++i)
     {
-        auto stream = std::make_shared<KafkaBlockInputStream>(*this, context, schema_name, block_size);
+        auto stream = std::make_shared<KafkaBlockInputStream>(*this, context, schema_name, block_size, false);
         streams.emplace_back(stream);
 
         // Limit read batch to maximum block size to allow DDL
         IProfilingBlockInputStream::LocalLimits limits;
-        limits.max_execution_time = settings.stream_flush_interval_ms;
+        if (flush_interval_ms)
+            limits.max_execution_time = Poco::Timespan(flush_interval_ms * 1000);
+        else
+            limits.max_execution_time = settings.stream_flush_interval_ms;
         limits.timeout_overflow_mode = OverflowMode::BREAK;
         if (IProfilingBlockInputStream * p_stream = dynamic_cast<IProfilingBlockInputStream *>(stream.get()))
             p_stream->setLimits(limits);
     }
 
-    // Join multiple streams if necessary
+    // Join multiple streams if necessary.
+    // The union runs one worker thread per consumer: polling and parsing happen there,
+    //  and ready blocks queue up while the current one is being written to the views.
     BlockInputStreamPtr in;
     if (streams.size() > 1)
         in = std::make_shared<UnionBlockInputStream<>>(streams, nullptr, streams.size());
     else
-        in = streams[0];
+    {
+        // A single consumer has no union; overlap fetching and parsing of the next block
+        //  with the write of the current one explicitly.
+        in = std::make_shared<AsynchronousBlockInputStream>(streams[0]);
+    }
 
     // Execute the query
     InterpreterInsertQuery interpreter{insert, context};
     auto block_io = interpreter.execute();
     copyData(*in, *block_io.out, &stream_cancelled);
 
+    // Commit offsets only now: copyData() calls readSuffix() of the source before writeSuffix()
+    //  of the insert pipeline, so committing there could mark messages as processed while the
+    //  last partial block is still sitting in a squashing buffer. Committing after the pipeline
+    //  has flushed means a crash in between replays messages instead of losing them.
+    if (!stream_cancelled)
+        for (auto & stream : streams)
+            static_cast<KafkaBlockInputStream &>(*stream).commitMessages();
+
     // Check whether the limits were applied during query execution
     bool limits_applied = false;
     if (IProfilingBlockInputStream * p_stream = dynamic_cast<IProfilingBlockInputStream *>(in.get()))
@@ -831,9 +882,16 @@ void registerStorageKafka(StorageFactory & factory)
             max_block_size = static_cast<size_t>(kafka_settings.kafka_max_block_size.value);
         }
 
+        // Parse flush interval (optional, can only be set in SETTINGS)
+        size_t flush_interval_ms = 0;
+        if (kafka_settings.kafka_flush_interval_ms.changed)
+        {
+            flush_interval_ms = static_cast<size_t>(kafka_settings.kafka_flush_interval_ms.value.totalMilliseconds());
+        }
+
         return StorageKafka::create(
             args.table_name, args.database_name, args.context, args.columns,
-            brokers, group, topics, format, row_delimiter, schema, num_consumers, max_block_size);
+            brokers, group, topics, format, row_delimiter, schema, num_consumers, max_block_size, flush_interval_ms);
     });
 }
 
@@ -85,6 +85,8 @@ private:
     size_t num_consumers;
     /// Maximum block size for insertion into this table
     size_t max_block_size;
+    /// How often collected blocks are flushed to the attached views (0 - use stream_flush_interval_ms)
+    size_t flush_interval_ms;
     /// Number of actually created consumers.
     /// Can differ from num_consumers in case of exception in startup() (or if startup() hasn't been called).
     /// In this case we still need to be able to shutdown() properly.
@@ -117,7 +119,7 @@ protected:
         const ColumnsDescription & columns_,
         const String & brokers_, const String & group_, const Names & topics_,
         const String & format_name_, char row_delimiter_, const String & schema_name_,
-        size_t num_consumers_, size_t max_block_size_);
+        size_t num_consumers_, size_t max_block_size_, size_t flush_interval_ms_);
 };
 
 }
@@ -38,8 +38,8 @@ private:
     using Base = LRUCache<UInt128, MarksInCompressedFile, UInt128TrivialHash, MarksWeightFunction>;
 
 public:
-    MarkCache(size_t max_size_in_bytes, const Delay & expiration_delay)
-        : Base(max_size_in_bytes, expiration_delay) {}
+    MarkCache(size_t max_size_in_bytes, const Delay & expiration_delay, size_t num_shards = 1)
+        : Base(max_size_in_bytes, expiration_delay, num_shards) {}
 
     /// Calculate key from path to file and offset.
     static UInt128 hash(const String & path_to_file)
@@ -7,6 +7,7 @@
 #include <common/logger_useful.h>
 #include <Storages/MergeTree/BackgroundProcessingPool.h>
 #include <Common/CurrentThread.h>
+#include <Common/IOScheduler.h>
 #include <Interpreters/DNSCacheUpdater.h>
 
 #include <ext/scope_guard.h>
@@ -20,6 +21,14 @@ namespace CurrentMetrics
     extern const Metric MemoryTrackingInBackgroundProcessingPool;
 }
 
+namespace ProfileEvents
+{
+    extern const Event BackgroundPoolMergeMutateTask;
+    extern const Event BackgroundPoolFetchTask;
+    extern const Event BackgroundPoolUtilityTask;
+    extern const Event BackgroundPoolTemporaryThread;
+}
+
 namespace DB
 {
 
@@ -27,6 +36,21 @@ namespace DB
 constexpr double BackgroundProcessingPool::sleep_seconds;
 constexpr double BackgroundProcessingPool::sleep_seconds_random_part;
 
+static const ProfileEvents::Event task_class_profile_events[BackgroundProcessingPool::NUM_TASK_CLASSES] =
+{
+    ProfileEvents::BackgroundPoolMergeMutateTask,
+    ProfileEvents::BackgroundPoolFetchTask,
+    ProfileEvents::BackgroundPoolUtilityTask,
+};
+
+/// Disk I/O made by a task is accounted to the corresponding scheduler class.
+static const IOScheduler::Class task_io_classes[BackgroundProcessingPool::NUM_TASK_CLASSES] =
+{
+    IOScheduler::Class::Merge,
+    IOScheduler::Class::Fetch,
+    IOScheduler::Class::Flush,
+};
+
 
 void BackgroundProcessingPoolTaskInfo::wake()
 {
@@ -60,13 +84,30 @@ BackgroundProcessingPool::BackgroundProcessingPool(int size_) : size(size_)
 
     threads.resize(size);
     for (auto & thread : threads)
-        thread = std::thread([this] { threadFunction(); });
+        thread = ThreadFromGlobalPool([this] { threadFunction(false); });
 }
 
 
-BackgroundProcessingPool::TaskHandle BackgroundProcessingPool::addTask(const Task & task)
+size_t BackgroundProcessingPool::concurrencyLimit(TaskClass task_class) const
 {
-    TaskHandle res = std::make_shared<TaskInfo>(*this, task);
+    /// No class may occupy the whole pool (unless the pool is degenerate),
+    ///  so that a backlog of one kind of work cannot completely starve the others.
+    switch (task_class)
+    {
+        case TaskClass::MergeMutate:
+            return std::max(size - size / 4, static_cast<size_t>(1));
+        case TaskClass::Fetch:
+        case TaskClass::Utility:
+            return std::max(size / 4, static_cast<size_t>(1));
+    }
+
+    __builtin_unreachable();
+}
+
+
+BackgroundProcessingPool::TaskHandle BackgroundProcessingPool::addTask(const Task & task, TaskClass task_class)
+{
+    TaskHandle res = std::make_shared<TaskInfo>(*this, task, task_class);
 
     Poco::Timestamp current_time;
 
@@ -102,8 +143,11 @@ BackgroundProcessingPool::~BackgroundProcessingPool()
     {
         shutdown = true;
         wake_event.notify_all();
-        for (std::thread & thread : threads)
+        for (auto & thread : threads)
             thread.join();
+
+        std::unique_lock lock(tasks_mutex);
+        temporary_thread_finished.wait(lock, [this] { return num_temporary_threads == 0; });
     }
     catch (...)
     {
@@ -112,7 +156,7 @@ BackgroundProcessingPool::~BackgroundProcessingPool()
 }
 
 
-void BackgroundProcessingPool::threadFunction()
+void BackgroundProcessingPool::threadFunction(bool temporary)
 {
     setThreadName("BackgrProcPool");
 
@@ -135,12 +179,15 @@ void BackgroundProcessingPool::threadFunction()
     CurrentThread::getMemoryTracker().setMetric(CurrentMetrics::MemoryTrackingInBackgroundProcessingPool);
 
     pcg64 rng(randomSeed());
-    std::this_thread::sleep_for(std::chrono::duration<double>(std::uniform_real_distribution<double>(0, sleep_seconds_random_part)(rng)));
+
+    if (!temporary)
+        std::this_thread::sleep_for(std::chrono::duration<double>(std::uniform_real_distribution<double>(0, sleep_seconds_random_part)(rng)));
 
     while (!shutdown)
     {
         bool done_work = false;
         TaskHandle task;
+        bool have_backlog = false;
 
         try
         {
@@ -149,18 +196,32 @@ void BackgroundProcessingPool::threadFunction()
             {
                 std::unique_lock lock(tasks_mutex);
 
-                if (!tasks.empty())
+                Poco::Timestamp current_time;
+                for (const auto & time_handle : tasks)
                 {
-                    for (const auto & time_handle : tasks)
+                    const TaskHandle & candidate = time_handle.second;
+                    if (candidate->removed)
+                        continue;
+
+                    /// Skip tasks whose class has exhausted its share of the threads.
+                    if (executing_tasks[static_cast<size_t>(candidate->task_class)] >= concurrencyLimit(candidate->task_class))
+                        continue;
+
+                    if (!task)
                     {
-                        if (!time_handle.second->removed)
-                        {
-                            min_time = time_handle.first;
-                            task = time_handle.second;
-                            break;
-                        }
+                        min_time = time_handle.first;
+                        task = candidate;
+                        continue;
                     }
+
+                    /// At least one more task is ready to run right now - the pool has a backlog.
+                    if (time_handle.first <= current_time)
+                        have_backlog = true;
+                    break;
                 }
+
+                if (task)
+                    ++executing_tasks[static_cast<size_t>(task->task_class)];
             }
 
             if (shutdown)
@@ -168,6 +229,9 @@ void BackgroundProcessingPool::threadFunction()
 
             if (!task)
             {
+                if (temporary)
+                    break;
+
                 std::unique_lock lock(tasks_mutex);
                 wake_event.wait_for(lock,
                     std::chrono::duration<double>(sleep_seconds
@@ -175,10 +239,39 @@ void BackgroundProcessingPool::threadFunction()
                 continue;
             }
 
+            SCOPE_EXIT(
+            {
+                std::lock_guard lock(tasks_mutex);
+                --executing_tasks[static_cast<size_t>(task->task_class)];
+            });
+
+            /// Under backlog, take a temporary thread from the global pool to drain it faster.
+            if (have_backlog && !temporary)
+            {
+                std::unique_lock lock(tasks_mutex);
+                if (num_temporary_threads < size)
+                {
+                    ++num_temporary_threads;
+                    try
+                    {
+                        ThreadFromGlobalPool([this] { threadFunction(true); }).detach();
+                        ProfileEvents::increment(ProfileEvents::BackgroundPoolTemporaryThread);
+                    }
+                    catch (...)
+                    {
+                        --num_temporary_threads;
+                        tryLogCurrentException(__PRETTY_FUNCTION__);
+                    }
+                }
+            }
+
             /// No tasks ready for execution.
             Poco::Timestamp current_time;
             if (min_time > current_time)
             {
+                if (temporary)
+                    break;
+
                 std::unique_lock lock(tasks_mutex);
                 wake_event.wait_for(lock, std::chrono::microseconds(
                     min_time - current_time + std::uniform_int_distribution<uint64_t>(0, sleep_seconds_random_part * 1000000)(rng)));
@@ -191,6 +284,8 @@ void BackgroundProcessingPool::threadFunction()
 
             {
                 CurrentMetrics::Increment metric_increment{CurrentMetrics::BackgroundPoolTask};
+                ProfileEvents::increment(task_class_profile_events[static_cast<size_t>(task->task_class)]);
+                IOScheduler::Scope io_scope(task_io_classes[static_cast<size_t>(task->task_class)]);
                 done_work = task->function();
             }
         }
@@ -203,6 +298,9 @@ void BackgroundProcessingPool::threadFunction()
         if (shutdown)
             break;
 
+        if (!task)
+            continue;
+
         /// If task has done work, it could be executed again immediately.
         /// If not, add delay before next run.
         Poco::Timestamp next_time_to_execute = Poco::Timestamp() + (done_work ? 0 : sleep_seconds * 1000000);
@@ -217,6 +315,15 @@ void BackgroundProcessingPool::threadFunction()
             task->iterator = tasks.emplace(next_time_to_execute, task);
         }
     }
+
+    if (temporary)
+    {
+        {
+            std::lock_guard lock(tasks_mutex);
+            --num_temporary_threads;
+        }
+        temporary_thread_finished.notify_all();
+    }
 }
 
 }
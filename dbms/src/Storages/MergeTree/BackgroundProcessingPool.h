@@ -13,6 +13,7 @@
 #include <Poco/Timestamp.h>
 #include <Core/Types.h>
 #include <Common/CurrentThread.h>
+#include <Common/ThreadPool.h>
 
 
 namespace DB
@@ -26,6 +27,11 @@ class BackgroundProcessingPoolTaskInfo;
   * Designed for tasks that perform continuous background work (for example, merge).
   * `Task` is a function that returns a bool - did it do any work.
   * If not, then the next time will be done later.
+  *
+  * Tasks are registered with a class of work they perform. Tasks of one class cannot occupy
+  *  more than a fixed share of the threads, so a backlog of cheap tasks of one class cannot
+  *  starve the others. When there are more ready tasks than threads, temporary threads are
+  *  taken from the global pool (up to the base pool size) until the backlog is drained.
   */
 class BackgroundProcessingPool
 {
@@ -35,6 +41,14 @@ public:
     using TaskInfo = BackgroundProcessingPoolTaskInfo;
     using TaskHandle = std::shared_ptr<TaskInfo>;
 
+    /// The class of work the task performs, for scheduling purposes.
+    enum class TaskClass : size_t
+    {
+        MergeMutate = 0,    /// Merges and mutations. For replicated tables this covers the whole replication queue.
+        Fetch = 1,          /// Fetching parts from other replicas.
+        Utility = 2,        /// Auxiliary periodic work, e.g. DNS cache updates.
+    };
+    static constexpr size_t NUM_TASK_CLASSES = 3;
 
     BackgroundProcessingPool(int size_);
 
@@ -43,7 +57,7 @@ public:
         return size;
     }
 
-    TaskHandle addTask(const Task & task);
+    TaskHandle addTask(const Task & task, TaskClass task_class = TaskClass::MergeMutate);
     void removeTask(const TaskHandle & task);
 
     ~BackgroundProcessingPool();
@@ -52,24 +66,34 @@ protected:
     friend class BackgroundProcessingPoolTaskInfo;
 
     using Tasks = std::multimap<Poco::Timestamp, TaskHandle>;    /// key is desired next time to execute (priority).
-    using Threads = std::vector<std::thread>;
+    using Threads = std::vector<ThreadFromGlobalPool>;
 
     const size_t size;
     static constexpr double sleep_seconds = 10;
     static constexpr double sleep_seconds_random_part = 1.0;
 
+    /// How many tasks of the given class may execute simultaneously.
+    size_t concurrencyLimit(TaskClass task_class) const;
+
     Tasks tasks;         /// Ordered in priority.
     std::mutex tasks_mutex;
 
     Threads threads;
 
+    /// Number of temporary threads spawned under backlog. Guarded by tasks_mutex.
+    size_t num_temporary_threads = 0;
+    std::condition_variable temporary_thread_finished;
+
+    /// Number of currently executing tasks of each class. Guarded by tasks_mutex.
+    size_t executing_tasks[NUM_TASK_CLASSES] {};
+
     std::atomic<bool> shutdown {false};
     std::condition_variable wake_event;
 
     /// Thread group used for profiling purposes
     ThreadGroupStatusPtr thread_group;
 
-    void threadFunction();
+    void threadFunction(bool temporary);
 };
 
 using BackgroundProcessingPoolPtr = std::shared_ptr<BackgroundProcessingPool>;
@@ -81,14 +105,17 @@ public:
     /// Wake up any thread.
     void wake();
 
-    BackgroundProcessingPoolTaskInfo(BackgroundProcessingPool & pool_, const BackgroundProcessingPool::Task & function_)
-        : pool(pool_), function(function_) {}
+    BackgroundProcessingPoolTaskInfo(
+            BackgroundProcessingPool & pool_, const BackgroundProcessingPool::Task & function_,
+            BackgroundProcessingPool::TaskClass task_class_)
+        : pool(pool_), function(function_), task_class(task_class_) {}
 
 protected:
     friend class BackgroundProcessingPool;
 
     BackgroundProcessingPool & pool;
     BackgroundProcessingPool::Task function;
+    BackgroundProcessingPool::TaskClass task_class;
 
     /// Read lock is hold when task is executed.
     std::shared_mutex rwlock;
@@ -1,10 +1,14 @@
 #include <Storages/MergeTree/DataPartsExchange.h>
 #include <Storages/IStorage.h>
 #include <Common/CurrentMetrics.h>
+#include <Common/IOScheduler.h>
 #include <Common/NetException.h>
 #include <Common/typeid_cast.h>
+#include <Interpreters/Context.h>
 #include <IO/HTTPCommon.h>
 #include <IO/ReadWriteBufferFromHTTP.h>
+#include <IO/copyData.h>
+#include <IO/createWriteBufferFromFileBase.h>
 #include <Poco/File.h>
 #include <ext/scope_guard.h>
 #include <Poco/Net/HTTPServerResponse.h>
@@ -87,6 +91,9 @@ void Service::processQuery(const Poco::Net::HTMLForm & params, ReadBuffer & /*bo
 
         CurrentMetrics::Increment metric_increment{CurrentMetrics::ReplicatedSend};
 
+        /// Reading of the sent part competes with queries for the disk under the Fetch I/O class.
+        IOScheduler::Scope io_scope(IOScheduler::Class::Fetch);
+
         /// We'll take a list of files from the list of checksums.
         MergeTreeData::DataPart::Checksums checksums = part->checksums;
         /// Add files that are not in the checksum list.
@@ -108,20 +115,45 @@ void Service::processQuery(const Poco::Net::HTMLForm & params, ReadBuffer & /*bo
             writeBinary(size, out);
 
             ReadBufferFromFile file_in(path);
-            HashingWriteBuffer hashing_out(out);
-            copyData(file_in, hashing_out, blocker.getCounter());
 
-            if (blocker.isCancelled())
-                throw Exception("Transferring part to replica was cancelled", ErrorCodes::ABORTED);
+            auto cached_checksum = part->checksums.files.find(file_name);
+            if (data.settings.replicated_sends_use_cached_checksums && cached_checksum != part->checksums.files.end())
+            {
+                /// The hash of this file is already known, so don't burn CPU re-hashing every sent
+                /// byte: send the file body as is with the stored hash. The fetching replica
+                /// verifies the hash against the received data anyway.
+                if (cached_checksum->second.file_size != size)
+                    throw Exception("Unexpected size of file " + path, ErrorCodes::BAD_SIZE_OF_FILE_IN_DATA_PART);
+
+                copyData(file_in, out, blocker.getCounter());
+
+                if (blocker.isCancelled())
+                    throw Exception("Transferring part to replica was cancelled", ErrorCodes::ABORTED);
+
+                if (file_in.count() != size)
+                    throw Exception("Unexpected size of file " + path, ErrorCodes::BAD_SIZE_OF_FILE_IN_DATA_PART);
+
+                writePODBinary(cached_checksum->second.file_hash, out);
 
-            if (hashing_out.count() != size)
-                throw Exception("Unexpected size of file " + path, ErrorCodes::BAD_SIZE_OF_FILE_IN_DATA_PART);
+                data_checksums.addFile(file_name, size, cached_checksum->second.file_hash);
+            }
+            else
+            {
+                HashingWriteBuffer hashing_out(out);
+                copyData(file_in, hashing_out, blocker.getCounter());
 
-            writePODBinary(hashing_out.getHash(), out);
+                if (blocker.isCancelled())
+                    throw Exception("Transferring part to replica was cancelled", ErrorCodes::ABORTED);
 
-            if (file_name != "checksums.txt" &&
-                file_name != "columns.txt")
-                data_checksums.addFile(file_name, hashing_out.count(), hashing_out.getHash());
+                if (hashing_out.count() != size)
+                    throw Exception("Unexpected size of file " + path, ErrorCodes::BAD_SIZE_OF_FILE_IN_DATA_PART);
+
+                writePODBinary(hashing_out.getHash(), out);
+
+                if (file_name != "checksums.txt" &&
+                    file_name != "columns.txt")
+                    data_checksums.addFile(file_name, hashing_out.count(), hashing_out.getHash());
+            }
         }
 
         part->checksums.checkEqual(data_checksums, false);
@@ -208,12 +240,19 @@ MergeTreeData::MutableDataPartPtr Fetcher::fetchPart(
 
     CurrentMetrics::Increment metric_increment{CurrentMetrics::ReplicatedFetch};
 
+    /// Writing of the downloaded part competes with queries for the disk under the Fetch I/O class.
+    IOScheduler::Scope io_scope(IOScheduler::Class::Fetch);
+
     part_file.createDirectory();
 
     MergeTreeData::MutableDataPartPtr new_data_part = std::make_shared<MergeTreeData::DataPart>(data, part_name);
     new_data_part->relative_path = relative_part_path;
     new_data_part->is_temp = true;
 
+    /// All fetches of the server share one bandwidth budget, so that catch-up of a replica
+    /// does not saturate the network at the expense of queries and merges.
+    ThrottlerPtr throttler = data.context.getReplicatedFetchesThrottler();
+
     size_t files;
     readBinary(files, in);
     MergeTreeData::DataPart::Checksums checksums;
@@ -225,9 +264,12 @@ MergeTreeData::MutableDataPartPtr Fetcher::fetchPart(
         readStringBinary(file_name, in);
         readBinary(file_size, in);
 
-        WriteBufferFromFile file_out(absolute_part_path + file_name);
-        HashingWriteBuffer hashing_out(file_out);
-        copyData(in, hashing_out, file_size, blocker.getCounter());
+        /// Large files of fetched parts are written with O_DIRECT, so that a big fetch does not
+        /// wash useful data out of the page cache (see min_fetch_bytes_to_use_direct_io).
+        auto file_out = createWriteBufferFromFileBase(
+            absolute_part_path + file_name, file_size, data.settings.min_fetch_bytes_to_use_direct_io);
+        HashingWriteBuffer hashing_out(*file_out);
+        copyDataWithThrottler(in, hashing_out, file_size, blocker.getCounter(), throttler);
 
         if (blocker.isCancelled())
         {
@@ -0,0 +1,120 @@
+#include <Storages/MergeTree/DebtAwareMergeSelector.h>
+#include <Common/formatReadable.h>
+
+#include <sstream>
+
+
+namespace DB
+{
+
+namespace
+{
+
+/** Of all ranges that fit the budget, remembers the one with the lowest rewrite cost
+  *  per part removed, divided by the debt of the partition the range belongs to.
+  */
+struct Estimator
+{
+    using Iterator = DebtAwareMergeSelector::PartsInPartition::const_iterator;
+
+    void consider(Iterator begin, Iterator end, size_t sum_size, size_t partition_debt, const DebtAwareMergeSelector::Settings & settings)
+    {
+        double count = end - begin;
+
+        /// Merging a range of `count` parts rewrites its bytes once and removes `count - 1` parts.
+        double cost_per_part_removed = (sum_size + settings.size_fixed_cost_to_add * count) / (count - 1);
+        double current_score = cost_per_part_removed / partition_debt;
+
+        if (best_begin == best_end || current_score < min_score)
+        {
+            min_score = current_score;
+            best_begin = begin;
+            best_end = end;
+            best_sum_size = sum_size;
+            best_partition_debt = partition_debt;
+        }
+    }
+
+    double min_score = 0;
+    Iterator best_begin {};
+    Iterator best_end {};
+    size_t best_sum_size = 0;
+    size_t best_partition_debt = 0;
+};
+
+
+void selectWithinPartition(
+    const DebtAwareMergeSelector::PartsInPartition & parts,
+    const size_t max_total_size_to_merge,
+    Estimator & estimator,
+    const DebtAwareMergeSelector::Settings & settings)
+{
+    size_t parts_count = parts.size();
+    if (parts_count <= settings.parts_to_keep)
+        return;
+
+    size_t debt = parts_count - settings.parts_to_keep;
+
+    for (size_t begin = 0; begin < parts_count; ++begin)
+    {
+        /// If too many parts, select only from first, to avoid complexity.
+        if (begin > 1000)
+            break;
+
+        size_t sum_size = parts[begin].size;
+
+        for (size_t end = begin + 2; end <= parts_count; ++end)
+        {
+            if (settings.max_parts_to_merge_at_once && end - begin > settings.max_parts_to_merge_at_once)
+                break;
+
+            /// A longer range would rewrite bytes beyond what is needed to bring the partition to the target.
+            if (end - begin > debt + 1)
+                break;
+
+            sum_size += parts[end - 1].size;
+
+            if (max_total_size_to_merge && sum_size > max_total_size_to_merge)
+                break;
+
+            estimator.consider(
+                parts.begin() + begin,
+                parts.begin() + end,
+                sum_size,
+                debt,
+                settings);
+        }
+    }
+}
+
+}
+
+
+DebtAwareMergeSelector::PartsInPartition DebtAwareMergeSelector::select(
+    const Partitions & partitions,
+    const size_t max_total_size_to_merge)
+{
+    Estimator estimator;
+
+    for (const auto & partition : partitions)
+        selectWithinPartition(partition, max_total_size_to_merge, estimator, settings);
+
+    if (estimator.best_begin == estimator.best_end)
+    {
+        last_decision.clear();
+        return {};
+    }
+
+    size_t count = estimator.best_end - estimator.best_begin;
+
+    std::stringstream decision;
+    decision << "partition has " << (estimator.best_partition_debt + settings.parts_to_keep)
+        << " parts, " << estimator.best_partition_debt << " over target " << settings.parts_to_keep
+        << "; rewriting " << formatReadableSizeWithBinarySuffix(estimator.best_sum_size)
+        << " removes " << (count - 1) << " parts";
+    last_decision = decision.str();
+
+    return PartsInPartition(estimator.best_begin, estimator.best_end);
+}
+
+}
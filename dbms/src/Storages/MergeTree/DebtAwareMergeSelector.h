@@ -0,0 +1,53 @@
+#pragma once
+
+#include <Storages/MergeTree/MergeSelector.h>
+#include <Core/Types.h>
+
+
+namespace DB
+{
+
+/** Selects parts to merge by trading rewrite bytes against the number of parts explicitly,
+  *  instead of the size-ratio heuristic of SimpleMergeSelector.
+  *
+  * Each partition has a "debt": the number of active parts above parts_to_keep - the read
+  *  amplification we are willing to live with. Partitions without debt are not merged at all,
+  *  so no bytes are rewritten while every partition is under the target. Among partitions in debt,
+  *  the contiguous range with the lowest rewrite cost per part removed, weighted by the debt of
+  *  its partition, is selected: the cheapest way to repay the backlog goes first, and partitions
+  *  that fall further behind become proportionally more urgent.
+  *
+  * The I/O budget is the max_total_size_to_merge argument, which the caller derives from free
+  *  disk space and the load of the background pool; ranges over the budget are not considered.
+  */
+class DebtAwareMergeSelector : public IMergeSelector
+{
+public:
+    struct Settings
+    {
+        /// How many active parts a partition may have before its parts are considered for merging.
+        size_t parts_to_keep = 10;
+
+        /// Zero means unlimited.
+        size_t max_parts_to_merge_at_once = 100;
+
+        /// Add this to size before all calculations. It means: merging even very small parts has it's fixed cost.
+        size_t size_fixed_cost_to_add = 5 * 1024 * 1024;
+    };
+
+    explicit DebtAwareMergeSelector(const Settings & settings) : settings(settings) {}
+
+    PartsInPartition select(
+        const Partitions & partitions,
+        const size_t max_total_size_to_merge) override;
+
+    /// Human readable explanation of the last returned range (empty if nothing was selected).
+    /// Shown in the selection_decision column of system.merges.
+    const String & getLastDecision() const { return last_decision; }
+
+private:
+    const Settings settings;
+    String last_decision;
+};
+
+}
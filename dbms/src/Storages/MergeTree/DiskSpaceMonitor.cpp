@@ -3,7 +3,7 @@
 namespace DB
 {
 
-size_t DiskSpaceMonitor::reserved_bytes;
+std::map<std::string, size_t> DiskSpaceMonitor::reserved_bytes_for_path;
 size_t DiskSpaceMonitor::reservation_count;
 std::mutex DiskSpaceMonitor::mutex;
 
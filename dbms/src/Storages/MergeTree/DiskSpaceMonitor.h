@@ -1,8 +1,10 @@
 #pragma once
 
+#include <map>
 #include <mutex>
 #include <sys/statvfs.h>
 #include <memory>
+#include <string>
 #include <boost/noncopyable.hpp>
 #include <common/logger_useful.h>
 #include <Common/Exception.h>
@@ -28,8 +30,10 @@ namespace ErrorCodes
 
 /** Determines amount of free space in filesystem.
   * Could "reserve" space, for different operations to plan disk space usage.
-  * Reservations are not separated for different filesystems,
-  *  instead it is assumed, that all reservations are done within same filesystem.
+  * Reservations are accounted per path they were made for, so a table that stores
+  *  its parts on several disks (see the storage_policy setting) can plan the usage
+  *  of each disk independently. Different paths on the same filesystem are not
+  *  detected, for them the accounting is pessimistic.
   */
 class DiskSpaceMonitor
 {
@@ -42,14 +46,16 @@ public:
             try
             {
                 std::lock_guard<std::mutex> lock(DiskSpaceMonitor::mutex);
-                if (DiskSpaceMonitor::reserved_bytes < size)
+
+                auto & reserved_bytes = DiskSpaceMonitor::reserved_bytes_for_path[path];
+                if (reserved_bytes < size)
                 {
-                    DiskSpaceMonitor::reserved_bytes = 0;
+                    reserved_bytes = 0;
                     LOG_ERROR(&Logger::get("DiskSpaceMonitor"), "Unbalanced reservations size; it's a bug");
                 }
                 else
                 {
-                    DiskSpaceMonitor::reserved_bytes -= size;
+                    reserved_bytes -= size;
                 }
 
                 if (DiskSpaceMonitor::reservation_count == 0)
@@ -71,9 +77,9 @@ public:
         void update(size_t new_size)
         {
             std::lock_guard<std::mutex> lock(DiskSpaceMonitor::mutex);
-            DiskSpaceMonitor::reserved_bytes -= size;
+            DiskSpaceMonitor::reserved_bytes_for_path[path] -= size;
             size = new_size;
-            DiskSpaceMonitor::reserved_bytes += size;
+            DiskSpaceMonitor::reserved_bytes_for_path[path] += size;
         }
 
         size_t getSize() const
@@ -81,15 +87,22 @@ public:
             return size;
         }
 
-        Reservation(size_t size_)
-            : size(size_), metric_increment(CurrentMetrics::DiskSpaceReservedForMerge, size)
+        /// The path the reservation was made for. A new part for which the space was reserved must be written there.
+        const std::string & getPath() const
+        {
+            return path;
+        }
+
+        Reservation(const std::string & path_, size_t size_)
+            : path(path_), size(size_), metric_increment(CurrentMetrics::DiskSpaceReservedForMerge, size)
         {
             std::lock_guard<std::mutex> lock(DiskSpaceMonitor::mutex);
-            DiskSpaceMonitor::reserved_bytes += size;
+            DiskSpaceMonitor::reserved_bytes_for_path[path] += size;
             ++DiskSpaceMonitor::reservation_count;
         }
 
     private:
+        std::string path;
         size_t size;
         CurrentMetrics::Increment metric_increment;
     };
@@ -110,6 +123,9 @@ public:
 
         std::lock_guard<std::mutex> lock(mutex);
 
+        auto it = reserved_bytes_for_path.find(path);
+        size_t reserved_bytes = (it == reserved_bytes_for_path.end()) ? 0 : it->second;
+
         if (reserved_bytes > res)
             res = 0;
         else
@@ -118,10 +134,25 @@ public:
         return res;
     }
 
+    /// Total capacity of the filesystem the path belongs to.
+    static size_t getTotalSpace(const std::string & path)
+    {
+        struct statvfs fs;
+
+        if (statvfs(path.c_str(), &fs) != 0)
+            throwFromErrno("Could not calculate total disk space (statvfs)", ErrorCodes::CANNOT_STATVFS);
+
+        return fs.f_blocks * fs.f_frsize;
+    }
+
     static size_t getReservedSpace()
     {
         std::lock_guard<std::mutex> lock(mutex);
-        return reserved_bytes;
+
+        size_t res = 0;
+        for (const auto & path_and_bytes : reserved_bytes_for_path)
+            res += path_and_bytes.second;
+        return res;
     }
 
     static size_t getReservationCount()
@@ -137,11 +168,11 @@ public:
         if (free_bytes < size)
             throw Exception("Not enough free disk space to reserve: " + formatReadableSizeWithBinarySuffix(free_bytes) + " available, "
                 + formatReadableSizeWithBinarySuffix(size) + " requested", ErrorCodes::NOT_ENOUGH_SPACE);
-        return std::make_unique<Reservation>(size);
+        return std::make_unique<Reservation>(path, size);
     }
 
 private:
-    static size_t reserved_bytes;
+    static std::map<std::string, size_t> reserved_bytes_for_path;
     static size_t reservation_count;
     static std::mutex mutex;
 };
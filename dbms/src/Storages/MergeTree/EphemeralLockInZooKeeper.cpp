@@ -37,6 +37,35 @@ EphemeralLockInZooKeeper::EphemeralLockInZooKeeper(
         throw Exception("Logical error: name of the main node is shorter than prefix.", ErrorCodes::LOGICAL_ERROR);
 }
 
+EphemeralLockInZooKeeper EphemeralLockInZooKeeper::createWithExistingHolder(
+    const String & path_prefix, const String & existing_holder_path,
+    zkutil::ZooKeeper & zookeeper, Coordination::Requests * precheck_ops)
+{
+    EphemeralLockInZooKeeper lock;
+    lock.zookeeper = &zookeeper;
+    lock.path_prefix = path_prefix;
+    lock.holder_path = existing_holder_path;
+    lock.owns_holder = false;
+
+    /// Create the main node (referencing the holder) in the same transaction as the prechecks -
+    /// one round trip instead of two.
+    if (!precheck_ops || precheck_ops->empty())
+    {
+        lock.path = zookeeper.create(path_prefix, existing_holder_path, zkutil::CreateMode::EphemeralSequential);
+    }
+    else
+    {
+        precheck_ops->emplace_back(zkutil::makeCreateRequest(path_prefix, existing_holder_path, zkutil::CreateMode::EphemeralSequential));
+        Coordination::Responses op_results = zookeeper.multi(*precheck_ops);
+        lock.path = dynamic_cast<const Coordination::CreateResponse &>(*op_results.back()).path_created;
+    }
+
+    if (lock.path.size() <= path_prefix.size())
+        throw Exception("Logical error: name of the main node is shorter than prefix.", ErrorCodes::LOGICAL_ERROR);
+
+    return lock;
+}
+
 void EphemeralLockInZooKeeper::unlock()
 {
     Coordination::Requests ops;
@@ -49,7 +78,8 @@ void EphemeralLockInZooKeeper::getUnlockOps(Coordination::Requests & ops)
 {
     checkCreated();
     ops.emplace_back(zkutil::makeRemoveRequest(path, -1));
-    ops.emplace_back(zkutil::makeRemoveRequest(holder_path, -1));
+    if (owns_holder)
+        ops.emplace_back(zkutil::makeRemoveRequest(holder_path, -1));
 }
 
 EphemeralLockInZooKeeper::~EphemeralLockInZooKeeper()
@@ -23,6 +23,13 @@ public:
     EphemeralLockInZooKeeper(
         const String & path_prefix_, const String & temp_path, zkutil::ZooKeeper & zookeeper_, Coordination::Requests * precheck_ops = nullptr);
 
+    /// Creates a lock referencing an already existing holder node (e.g. one shared by all locks of
+    /// a ZooKeeper session). Only the main node is created, in a single ZK transaction together
+    /// with precheck_ops. The holder node is not removed on unlock.
+    static EphemeralLockInZooKeeper createWithExistingHolder(
+        const String & path_prefix, const String & existing_holder_path,
+        zkutil::ZooKeeper & zookeeper, Coordination::Requests * precheck_ops = nullptr);
+
     EphemeralLockInZooKeeper() = default;
 
     EphemeralLockInZooKeeper(EphemeralLockInZooKeeper && rhs) noexcept
@@ -37,6 +44,7 @@ public:
         path_prefix = std::move(rhs.path_prefix);
         path = std::move(rhs.path);
         holder_path = std::move(rhs.holder_path);
+        owns_holder = rhs.owns_holder;
         return *this;
     }
 
@@ -83,6 +91,8 @@ private:
     String path_prefix;
     String path;
     String holder_path;
+    /// false if the holder node is shared with other locks and must not be removed on unlock.
+    bool owns_holder = true;
 };
 
 
@@ -14,9 +14,9 @@ namespace DB
 {
 
 MergeListElement::MergeListElement(const std::string & database, const std::string & table, const std::string & result_part_name,
-    const MergeTreeData::DataPartsVector & source_parts)
+    const MergeTreeData::DataPartsVector & source_parts, const std::string & selection_decision)
         : database{database}, table{table}, result_part_name{result_part_name}, num_parts{source_parts.size()},
-        thread_number{Poco::ThreadNumber::get()}
+        thread_number{Poco::ThreadNumber::get()}, selection_decision{selection_decision}
 {
     for (const auto & source_part : source_parts)
         source_part_names.emplace_back(source_part->name);
@@ -53,6 +53,7 @@ MergeInfo MergeListElement::getInfo() const
     res.columns_written = columns_written.load(std::memory_order_relaxed);
     res.memory_usage = memory_tracker.get();
     res.thread_number = thread_number;
+    res.selection_decision = selection_decision;
 
     for (const auto & source_part_name : source_part_names)
         res.source_part_names.emplace_back(source_part_name);
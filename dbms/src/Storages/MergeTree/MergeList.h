@@ -42,6 +42,7 @@ struct MergeInfo
     UInt64 columns_written;
     UInt64 memory_usage;
     UInt64 thread_number;
+    std::string selection_decision;
 };
 
 
@@ -74,9 +75,13 @@ struct MergeListElement : boost::noncopyable
     /// Poco thread number used in logs
     UInt32 thread_number;
 
+    /// How the merge selector justified this merge (empty for merges assigned in another way,
+    ///  e.g. by OPTIMIZE or on another replica).
+    const std::string selection_decision;
+
 
     MergeListElement(const std::string & database, const std::string & table, const std::string & result_part_name,
-                     const MergeTreeData::DataPartsVector & source_parts);
+                     const MergeTreeData::DataPartsVector & source_parts, const std::string & selection_decision = "");
 
     MergeInfo getInfo() const;
 
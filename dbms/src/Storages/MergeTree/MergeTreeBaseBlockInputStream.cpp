@@ -22,27 +22,55 @@ namespace ErrorCodes
 MergeTreeBaseBlockInputStream::MergeTreeBaseBlockInputStream(
     const MergeTreeData & storage,
     const PrewhereInfoPtr & prewhere_info,
+    const PrewhereReadStepsPtr & prewhere_read_steps,
+    const PrewhereStepsStatsPtr & prewhere_steps_stats,
     UInt64 max_block_size_rows,
     UInt64 preferred_block_size_bytes,
     UInt64 preferred_max_column_in_block_size_bytes,
     UInt64 min_bytes_to_use_direct_io,
+    UInt64 min_bytes_to_use_mmap_io,
     UInt64 max_read_buffer_size,
     bool use_uncompressed_cache,
+    bool deferred_checksum_verification,
     bool save_marks_in_cache,
     const Names & virt_column_names)
 :
     storage(storage),
     prewhere_info(prewhere_info),
+    prewhere_read_steps(prewhere_read_steps),
+    prewhere_steps_stats(prewhere_steps_stats),
     max_block_size_rows(max_block_size_rows),
     preferred_block_size_bytes(preferred_block_size_bytes),
     preferred_max_column_in_block_size_bytes(preferred_max_column_in_block_size_bytes),
     min_bytes_to_use_direct_io(min_bytes_to_use_direct_io),
+    min_bytes_to_use_mmap_io(min_bytes_to_use_mmap_io),
     max_read_buffer_size(max_read_buffer_size),
     use_uncompressed_cache(use_uncompressed_cache),
+    deferred_checksum_verification(deferred_checksum_verification),
     save_marks_in_cache(save_marks_in_cache),
     virt_column_names(virt_column_names),
     max_block_size_marks(max_block_size_rows / storage.index_granularity)
 {
+    if (prewhere_read_steps)
+    {
+        prewhere_step_order.resize(prewhere_read_steps->size());
+        for (size_t i = 0; i < prewhere_step_order.size(); ++i)
+            prewhere_step_order[i] = i;
+    }
+}
+
+
+bool MergeTreeBaseBlockInputStream::updatePrewhereStepOrder()
+{
+    if (!prewhere_read_steps || !prewhere_steps_stats)
+        return false;
+
+    auto order = choosePrewhereStepOrder(*prewhere_read_steps, *prewhere_steps_stats);
+    if (order == prewhere_step_order)
+        return false;
+
+    prewhere_step_order = std::move(order);
+    return true;
 }
 
 
@@ -76,7 +104,7 @@ Block MergeTreeBaseBlockInputStream::readFromPart()
     const auto max_block_size_rows = this->max_block_size_rows;
     const auto preferred_block_size_bytes = this->preferred_block_size_bytes;
     const auto preferred_max_column_in_block_size_bytes = this->preferred_max_column_in_block_size_bytes;
-    const auto index_granularity = storage.index_granularity;
+    const auto index_granularity = task->data_part->index_granularity;
     const double min_filtration_ratio = 0.00001;
 
     auto estimateNumRows = [preferred_block_size_bytes, max_block_size_rows,
@@ -118,26 +146,64 @@ Block MergeTreeBaseBlockInputStream::readFromPart()
     {
         if (prewhere_info)
         {
-            if (reader->getColumns().empty())
+            bool has_post_columns = !reader->getColumns().empty();
+
+            task->pre_range_readers.clear();
+            task->pre_range_readers.reserve(pre_readers.size());
+            MergeTreeRangeReader * prev_reader = nullptr;
+
+            if (pre_readers.size() > 1)
+            {
+                /// Multi-step PREWHERE: a chain of range readers, each filtering rows for the next one.
+                /// The steps cannot have alias actions (see splitPrewhereIntoReadSteps).
+                /// The chain follows prewhere_step_order, which may differ from the static order of
+                /// the steps (see updatePrewhereStepOrder); pre_readers are built in the same order.
+                const auto & steps = *prewhere_read_steps;
+
+                for (size_t i = 0; i < pre_readers.size(); ++i)
+                {
+                    size_t step_index = prewhere_step_order[i];
+                    const auto & step = steps[step_index];
+                    bool is_last_reader = !has_post_columns && i + 1 == pre_readers.size();
+                    MergeTreeRangeReader step_reader(
+                        pre_readers[i].get(), index_granularity, prev_reader,
+                        nullptr, step.actions,
+                        &step.column_name, &task->ordered_names,
+                        task->should_reorder, step.remove_column, is_last_reader,
+                        prewhere_steps_stats ? &(*prewhere_steps_stats)[step_index] : nullptr);
+
+                    if (is_last_reader)
+                        task->range_reader = std::move(step_reader);
+                    else
+                    {
+                        task->pre_range_readers.push_back(std::move(step_reader));
+                        prev_reader = &task->pre_range_readers.back();
+                    }
+                }
+            }
+            else if (!has_post_columns)
             {
                 task->range_reader = MergeTreeRangeReader(
-                    pre_reader.get(), index_granularity, nullptr,
+                    pre_readers.front().get(), index_granularity, nullptr,
                     prewhere_info->alias_actions, prewhere_info->prewhere_actions,
                     &prewhere_info->prewhere_column_name, &task->ordered_names,
                     task->should_reorder, task->remove_prewhere_column, true);
             }
             else
             {
-                task->pre_range_reader = MergeTreeRangeReader(
-                    pre_reader.get(), index_granularity, nullptr,
+                task->pre_range_readers.push_back(MergeTreeRangeReader(
+                    pre_readers.front().get(), index_granularity, nullptr,
                     prewhere_info->alias_actions, prewhere_info->prewhere_actions,
                     &prewhere_info->prewhere_column_name, &task->ordered_names,
-                    task->should_reorder, task->remove_prewhere_column, false);
+                    task->should_reorder, task->remove_prewhere_column, false));
+
+                prev_reader = &task->pre_range_readers.back();
+            }
 
+            if (has_post_columns)
                 task->range_reader = MergeTreeRangeReader(
-                    reader.get(), index_granularity, &task->pre_range_reader, nullptr, nullptr,
+                    reader.get(), index_granularity, prev_reader, nullptr, nullptr,
                     nullptr, &task->ordered_names, true, false, true);
-            }
         }
         else
         {
@@ -175,6 +241,20 @@ Block MergeTreeBaseBlockInputStream::readFromPart()
         column.column = column.column->convertToFullColumnIfConst();
     }
 
+    if (read_result.block && pre_readers.size() > 1)
+    {
+        /// Filter columns of intermediate PREWHERE steps which were kept in the block are constants now;
+        /// convert them to full columns so that the block structure doesn't depend on the number of steps.
+        for (const auto & step : *prewhere_read_steps)
+        {
+            if (!step.remove_column && read_result.block.has(step.column_name))
+            {
+                auto & column = read_result.block.getByName(step.column_name);
+                column.column = column.column->convertToFullColumnIfConst();
+            }
+        }
+    }
+
     read_result.block.checkNumberOfRows();
 
     return read_result.block;
@@ -20,12 +20,16 @@ public:
     MergeTreeBaseBlockInputStream(
         const MergeTreeData & storage,
         const PrewhereInfoPtr & prewhere_info,
+        const PrewhereReadStepsPtr & prewhere_read_steps,
+        const PrewhereStepsStatsPtr & prewhere_steps_stats,
         UInt64 max_block_size_rows,
         UInt64 preferred_block_size_bytes,
         UInt64 preferred_max_column_in_block_size_bytes,
         UInt64 min_bytes_to_use_direct_io,
+        UInt64 min_bytes_to_use_mmap_io,
         UInt64 max_read_buffer_size,
         bool use_uncompressed_cache,
+        bool deferred_checksum_verification = false,
         bool save_marks_in_cache = true,
         const Names & virt_column_names = {});
 
@@ -34,7 +38,8 @@ public:
     static void executePrewhereActions(Block & block, const PrewhereInfoPtr & prewhere_info);
 
 protected:
-    Block readImpl() final;
+    /// Overridden by MergeTreeReverseBlockInputStream to return the blocks of a task in reverse order.
+    Block readImpl() override;
 
     /// Creates new this->task, and initilizes readers
     virtual bool getNewTask() = 0;
@@ -46,20 +51,37 @@ protected:
 
     void injectVirtualColumns(Block & block) const;
 
+    /// Re-evaluate the execution order of the PREWHERE steps from the statistics collected so far.
+    /// Returns true if the order has changed; the step readers must be rebuilt then.
+    bool updatePrewhereStepOrder();
+
 protected:
     const MergeTreeData & storage;
 
     PrewhereInfoPtr prewhere_info;
+    /// If not empty, PREWHERE is executed in several steps, each with its own reader (see PrewhereReadStep).
+    PrewhereReadStepsPtr prewhere_read_steps;
+    /// If not null, per-step selectivity and cost are collected there, shared by all streams of the
+    /// query, and the execution order of the steps is adapted to them (see choosePrewhereStepOrder).
+    PrewhereStepsStatsPtr prewhere_steps_stats;
+    /// The current execution order of the PREWHERE steps: position in the chain -> step index.
+    std::vector<size_t> prewhere_step_order;
 
     UInt64 max_block_size_rows;
     UInt64 preferred_block_size_bytes;
     UInt64 preferred_max_column_in_block_size_bytes;
 
     UInt64 min_bytes_to_use_direct_io;
+    UInt64 min_bytes_to_use_mmap_io;
     UInt64 max_read_buffer_size;
 
     bool use_uncompressed_cache;
+    /// See the 'deferred_checksum_verification' setting. Ignored when reading through the uncompressed cache.
+    bool deferred_checksum_verification;
     bool save_marks_in_cache;
+    /// If false, rows deleted by lightweight ALTER DELETE are not hidden from reading
+    /// (see the apply_deleted_mask setting). Set by derived classes.
+    bool apply_deleted_mask = true;
 
     Names virt_column_names;
 
@@ -70,7 +92,9 @@ protected:
 
     using MergeTreeReaderPtr = std::unique_ptr<MergeTreeReader>;
     MergeTreeReaderPtr reader;
-    MergeTreeReaderPtr pre_reader;
+    /// One reader per PREWHERE step. A single element if PREWHERE is executed at one step
+    /// (no suitable steps for the query or for the current part).
+    std::vector<MergeTreeReaderPtr> pre_readers;
 
     UInt64 max_block_size_marks;
 };
@@ -25,17 +25,23 @@ MergeTreeBlockInputStream::MergeTreeBlockInputStream(
     const MarkRanges & mark_ranges_,
     bool use_uncompressed_cache_,
     const PrewhereInfoPtr & prewhere_info,
+    const PrewhereReadStepsPtr & prewhere_read_steps,
+    const PrewhereStepsStatsPtr & prewhere_steps_stats,
     bool check_columns,
     size_t min_bytes_to_use_direct_io_,
+    size_t min_bytes_to_use_mmap_io_,
     size_t max_read_buffer_size_,
     bool save_marks_in_cache_,
     const Names & virt_column_names,
     size_t part_index_in_query_,
-    bool quiet)
+    bool quiet,
+    bool apply_deleted_mask_,
+    bool deferred_checksum_verification_)
     :
-    MergeTreeBaseBlockInputStream{storage_, prewhere_info, max_block_size_rows_,
+    MergeTreeBaseBlockInputStream{storage_, prewhere_info, prewhere_read_steps, prewhere_steps_stats, max_block_size_rows_,
         preferred_block_size_bytes_, preferred_max_column_in_block_size_bytes_, min_bytes_to_use_direct_io_,
-        max_read_buffer_size_, use_uncompressed_cache_, save_marks_in_cache_, virt_column_names},
+        min_bytes_to_use_mmap_io_, max_read_buffer_size_, use_uncompressed_cache_, deferred_checksum_verification_,
+        save_marks_in_cache_, virt_column_names},
     required_columns{column_names},
     data_part{owned_data_part_},
     part_columns_lock(data_part->columns_lock),
@@ -44,19 +50,21 @@ MergeTreeBlockInputStream::MergeTreeBlockInputStream(
     check_columns(check_columns),
     path(data_part->getFullPath())
 {
+    apply_deleted_mask = apply_deleted_mask_;
+
     /// Let's estimate total number of rows for progress bar.
     for (const auto & range : all_mark_ranges)
         total_marks_count += range.end - range.begin;
 
-    size_t total_rows = total_marks_count * storage.index_granularity;
+    size_t total_rows = total_marks_count * data_part->index_granularity;
 
     if (!quiet)
         LOG_TRACE(log, "Reading " << all_mark_ranges.size() << " ranges from part " << data_part->name
         << ", approx. " << total_rows
         << (all_mark_ranges.size() > 1
-        ? ", up to " + toString((all_mark_ranges.back().end - all_mark_ranges.front().begin) * storage.index_granularity)
+        ? ", up to " + toString((all_mark_ranges.back().end - all_mark_ranges.front().begin) * data_part->index_granularity)
         : "")
-        << " rows starting from " << all_mark_ranges.front().begin * storage.index_granularity);
+        << " rows starting from " << all_mark_ranges.front().begin * data_part->index_granularity);
 
     addTotalRowsApprox(total_rows);
 
@@ -176,13 +184,30 @@ try
         reader = std::make_unique<MergeTreeReader>(
             path, data_part, columns, owned_uncompressed_cache.get(),
             owned_mark_cache.get(), save_marks_in_cache, storage,
-            all_mark_ranges, min_bytes_to_use_direct_io, max_read_buffer_size);
+            all_mark_ranges, min_bytes_to_use_direct_io, min_bytes_to_use_mmap_io, max_read_buffer_size, deferred_checksum_verification,
+            MergeTreeReader::ValueSizeMap{}, ReadBufferFromFileBase::ProfileCallback{},
+            CLOCK_MONOTONIC_COARSE, apply_deleted_mask);
 
         if (prewhere_info)
-            pre_reader = std::make_unique<MergeTreeReader>(
-                path, data_part, pre_columns, owned_uncompressed_cache.get(),
-                owned_mark_cache.get(), save_marks_in_cache, storage,
-                all_mark_ranges, min_bytes_to_use_direct_io, max_read_buffer_size);
+        {
+            /// This stream reads a single part with a single task, so the PREWHERE step order is
+            /// chosen once here; parts read later still benefit from the statistics of this one.
+            updatePrewhereStepOrder();
+
+            std::vector<NamesAndTypesList> step_columns;
+            if (prewhere_read_steps)
+                step_columns = distributePrewhereReadColumns(data_part, pre_columns, *prewhere_read_steps, prewhere_step_order);
+            if (step_columns.empty())
+                step_columns.push_back(pre_columns);
+
+            for (const auto & columns_for_step : step_columns)
+                pre_readers.push_back(std::make_unique<MergeTreeReader>(
+                    path, data_part, columns_for_step, owned_uncompressed_cache.get(),
+                    owned_mark_cache.get(), save_marks_in_cache, storage,
+                    all_mark_ranges, min_bytes_to_use_direct_io, min_bytes_to_use_mmap_io, max_read_buffer_size, deferred_checksum_verification,
+                    MergeTreeReader::ValueSizeMap{}, ReadBufferFromFileBase::ProfileCallback{},
+                    CLOCK_MONOTONIC_COARSE, apply_deleted_mask));
+        }
     }
 
     return true;
@@ -203,7 +228,7 @@ void MergeTreeBlockInputStream::finish()
     * buffers don't waste memory.
     */
     reader.reset();
-    pre_reader.reset();
+    pre_readers.clear();
     part_columns_lock.unlock();
     data_part.reset();
 }
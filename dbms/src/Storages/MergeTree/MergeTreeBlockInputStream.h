@@ -26,13 +26,18 @@ public:
         const MarkRanges & mark_ranges,
         bool use_uncompressed_cache,
         const PrewhereInfoPtr & prewhere_info,
+        const PrewhereReadStepsPtr & prewhere_read_steps,
+        const PrewhereStepsStatsPtr & prewhere_steps_stats,
         bool check_columns,
         size_t min_bytes_to_use_direct_io,
+        size_t min_bytes_to_use_mmap_io,
         size_t max_read_buffer_size,
         bool save_marks_in_cache,
         const Names & virt_column_names = {},
         size_t part_index_in_query = 0,
-        bool quiet = false);
+        bool quiet = false,
+        bool apply_deleted_mask_ = true,
+        bool deferred_checksum_verification = false);
 
     ~MergeTreeBlockInputStream() override;
 
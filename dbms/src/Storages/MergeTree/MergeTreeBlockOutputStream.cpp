@@ -1,6 +1,8 @@
 #include <Storages/MergeTree/MergeTreeBlockOutputStream.h>
+#include <Storages/MergeTree/MergeTreeDeduplicationLog.h>
 #include <Storages/StorageMergeTree.h>
 #include <Interpreters/PartLog.h>
+#include <Common/SipHash.h>
 
 
 namespace DB
@@ -14,15 +16,55 @@ Block MergeTreeBlockOutputStream::getHeader() const
 
 void MergeTreeBlockOutputStream::write(const Block & block)
 {
-    storage.data.delayInsertOrThrowIfNeeded();
+    storage.data.delayInsertOrThrowIfNeeded(nullptr, parts_to_delay_insert_override, parts_to_throw_insert_override);
 
     auto part_blocks = storage.writer.splitBlockIntoParts(block);
     for (auto & current_block : part_blocks)
     {
         Stopwatch watch;
 
-        MergeTreeData::MutableDataPartPtr part = storage.writer.writeTempPart(current_block);
-        storage.data.renameTempPartAndAdd(part, &storage.increment);
+        MergeTreeData::MutableDataPartPtr part = storage.writer.writeTempPart(current_block, /* allow_in_memory = */ true);
+
+        String block_id;
+
+        if (deduplicate)
+        {
+            if (!deduplication_token.empty())
+            {
+                /// An explicit token replaces the hash of the data, so retries deduplicate
+                ///  even when the retried data is not byte-identical.
+                /// The chunk ordinal keeps block ids of a multi-part insert distinct.
+                block_id = part->info.partition_id + "_" + deduplication_token + "_" + toString(deduplicated_chunk_num);
+                ++deduplicated_chunk_num;
+            }
+            else
+            {
+                /// The hash is taken from the block rather than from the formed part
+                ///  (in-memory parts have no checksums), but the semantics are the same
+                ///  as in ReplicatedMergeTreeBlockOutputStream: the same data inserted
+                ///  into the same partition twice is written only once.
+                SipHash hash;
+                current_block.block.updateHash(hash);
+                union
+                {
+                    char bytes[16];
+                    UInt64 words[2];
+                } hash_value;
+                hash.get128(hash_value.bytes);
+
+                block_id = part->info.partition_id + "_" + toString(hash_value.words[0]) + "_" + toString(hash_value.words[1]);
+            }
+        }
+
+        /// The duplicate check, the commit of the part (including its write-ahead log record for
+        ///  an in-memory part) and the recording of the block id happen atomically inside, with
+        ///  the id recorded last: a crash turns into a duplicated insert, never into a lost one.
+        if (!storage.data.renameTempPartAndAdd(part, &storage.increment, nullptr,
+                deduplicate ? storage.deduplication_log.get() : nullptr, block_id))
+        {
+            LOG_INFO(storage.log, "Block with ID " << block_id << " already exists; ignoring it.");
+            continue;
+        }
 
         PartLog::addNewPart(storage.context, part, watch.elapsed());
 
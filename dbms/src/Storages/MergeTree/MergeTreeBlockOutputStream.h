@@ -13,14 +13,31 @@ class StorageMergeTree;
 class MergeTreeBlockOutputStream : public IBlockOutputStream
 {
 public:
-    MergeTreeBlockOutputStream(StorageMergeTree & storage_)
-        : storage(storage_) {}
+    MergeTreeBlockOutputStream(StorageMergeTree & storage_,
+        bool deduplicate_ = false, String deduplication_token_ = "",
+        UInt64 parts_to_delay_insert_override_ = 0, UInt64 parts_to_throw_insert_override_ = 0)
+        : storage(storage_)
+        , deduplicate(deduplicate_)
+        , deduplication_token(std::move(deduplication_token_))
+        , parts_to_delay_insert_override(parts_to_delay_insert_override_)
+        , parts_to_throw_insert_override(parts_to_throw_insert_override_) {}
 
     Block getHeader() const override;
     void write(const Block & block) override;
 
 private:
     StorageMergeTree & storage;
+
+    /// Check the block ids of inserted blocks against the table's deduplication log (see MergeTreeDeduplicationLog).
+    bool deduplicate = false;
+
+    /// If not empty, used for block ids instead of the hash of the data (see insert_deduplication_token).
+    String deduplication_token;
+    UInt64 deduplicated_chunk_num = 0;
+
+    /// Per-query overrides of the table settings with the same names (0 - use the table setting).
+    UInt64 parts_to_delay_insert_override = 0;
+    UInt64 parts_to_throw_insert_override = 0;
 };
 
 }
@@ -1,7 +1,12 @@
 #include <Storages/MergeTree/MergeTreeBlockReadUtils.h>
 #include <Storages/MergeTree/MergeTreeData.h>
+#include <Storages/SelectQueryInfo.h>
+#include <Interpreters/ExpressionActions.h>
 #include <Common/typeid_cast.h>
 #include <Columns/ColumnConst.h>
+#include <functional>
+#include <limits>
+#include <unordered_map>
 #include <unordered_set>
 
 
@@ -66,6 +71,263 @@ NameSet injectRequiredColumns(const MergeTreeData & storage, const MergeTreeData
 }
 
 
+PrewhereReadSteps splitPrewhereIntoReadSteps(const PrewhereInfo & prewhere_info, const Context & context)
+{
+    /// Aliases can refer to arbitrary source columns, so it is unclear which of them each condition needs.
+    if (prewhere_info.alias_actions)
+        return {};
+
+    const auto & actions = prewhere_info.prewhere_actions->getActions();
+
+    /// Only plain calculations may be distributed between the steps.
+    for (const auto & action : actions)
+        if (action.type != ExpressionAction::APPLY_FUNCTION && action.type != ExpressionAction::ADD_COLUMN
+            && action.type != ExpressionAction::COPY_COLUMN && action.type != ExpressionAction::REMOVE_COLUMN)
+            return {};
+
+    /// The action calculating the filter column must be a conjunction of at least two conditions.
+    const ExpressionAction * conjunction_action = nullptr;
+    for (const auto & action : actions)
+        if (action.type == ExpressionAction::APPLY_FUNCTION && action.result_name == prewhere_info.prewhere_column_name)
+            conjunction_action = &action;
+
+    if (!conjunction_action || !conjunction_action->function_builder
+        || conjunction_action->function_builder->getName() != "and"
+        || conjunction_action->argument_names.size() < 2)
+        return {};
+
+    /// For each calculated column remember the position of the action calculating it.
+    std::unordered_map<String, size_t> producers;
+    for (size_t i = 0; i < actions.size(); ++i)
+        if (actions[i].type != ExpressionAction::REMOVE_COLUMN
+            && !producers.emplace(actions[i].result_name, i).second)
+            return {};  /// The same column is calculated twice.
+
+    /// A column removed and then calculated again cannot be safely moved between the steps.
+    for (size_t i = 0; i < actions.size(); ++i)
+    {
+        if (actions[i].type != ExpressionAction::REMOVE_COLUMN)
+            continue;
+
+        const auto & name = actions[i].source_name.empty() ? actions[i].result_name : actions[i].source_name;
+        auto it = producers.find(name);
+        if (it != producers.end() && it->second > i)
+            return {};
+    }
+
+    /// Assign to each condition the not yet assigned part of the closure of actions calculating it.
+    /// Conditions which are bare source columns get an empty closure; they are checked at the last step
+    /// together with the conjunction itself, so that their values are not replaced by intermediate steps.
+    constexpr size_t unassigned = std::numeric_limits<size_t>::max();
+    std::vector<size_t> action_step(actions.size(), unassigned);
+    Names step_column_names;
+
+    std::function<void(const String &, size_t)> assign_closure = [&](const String & name, size_t step)
+    {
+        auto it = producers.find(name);
+        if (it == producers.end() || action_step[it->second] != unassigned)
+            return;
+
+        action_step[it->second] = step;
+        for (const auto & needed : actions[it->second].getNeededColumns())
+            assign_closure(needed, step);
+    };
+
+    for (const auto & condition : conjunction_action->argument_names)
+    {
+        auto it = producers.find(condition);
+        if (it == producers.end() || action_step[it->second] != unassigned)
+            continue;   /// A source column, or a condition already calculated by one of the previous steps.
+
+        assign_closure(condition, step_column_names.size());
+        step_column_names.push_back(condition);
+    }
+
+    if (step_column_names.empty())
+        return {};  /// All conditions are bare source columns; there is nothing to cascade.
+
+    /// The last step gets the conjunction itself and everything that is left (e.g. removals of temporary
+    /// columns), so that executing the steps in order reproduces the original list of actions.
+    size_t num_steps = step_column_names.size() + 1;
+    for (auto & step : action_step)
+        if (step == unassigned)
+            step = num_steps - 1;
+
+    /// Types of the columns available between the steps.
+    std::unordered_map<String, DataTypePtr> column_types;
+    for (const auto & column : prewhere_info.prewhere_actions->getRequiredColumnsWithTypes())
+        column_types[column.name] = column.type;
+
+    PrewhereReadSteps steps(num_steps);
+
+    for (size_t step = 0; step < num_steps; ++step)
+    {
+        /// Input columns: everything the step needs and does not calculate itself.
+        NamesAndTypesList inputs;
+        NameSet inputs_set;
+        NameSet calculated;
+        for (size_t i = 0; i < actions.size(); ++i)
+        {
+            if (action_step[i] != step)
+                continue;
+
+            for (const auto & name : actions[i].getNeededColumns())
+            {
+                if (calculated.count(name) || inputs_set.count(name))
+                    continue;
+
+                auto it = column_types.find(name);
+                if (it == column_types.end())
+                    return {};
+
+                inputs.emplace_back(name, it->second);
+                inputs_set.insert(name);
+            }
+
+            if (actions[i].type != ExpressionAction::REMOVE_COLUMN)
+                calculated.insert(actions[i].result_name);
+        }
+
+        auto & result_step = steps[step];
+
+        result_step.actions = std::make_shared<ExpressionActions>(inputs, context);
+        for (size_t i = 0; i < actions.size(); ++i)
+            if (action_step[i] == step)
+                result_step.actions->add(actions[i]);
+
+        /// Remember the types of calculated columns for the following steps.
+        for (size_t i = 0; i < actions.size(); ++i)
+            if (action_step[i] == step && actions[i].type != ExpressionAction::REMOVE_COLUMN)
+                column_types[actions[i].result_name]
+                    = result_step.actions->getSampleBlock().getByName(actions[i].result_name).type;
+
+        bool is_last_step = step + 1 == num_steps;
+        result_step.column_name = is_last_step ? prewhere_info.prewhere_column_name : step_column_names[step];
+        /// Filter columns of intermediate steps are needed by the final conjunction, so only the last one
+        /// may be removed.
+        result_step.remove_column = is_last_step && prewhere_info.remove_prewhere_column;
+    }
+
+    return steps;
+}
+
+
+/// For each column calculated by some step (a step filter column or a sub-expression shared with
+/// the following steps), the index of the step calculating it. All other columns are source ones.
+static std::unordered_map<String, size_t> mapProducedColumns(const PrewhereReadSteps & steps)
+{
+    std::unordered_map<String, size_t> produced_by;
+
+    for (size_t i = 0; i < steps.size(); ++i)
+    {
+        NameSet inputs;
+        for (const auto & name : steps[i].actions->getRequiredColumns())
+            inputs.insert(name);
+
+        for (const auto & column : steps[i].actions->getSampleBlock())
+            if (!inputs.count(column.name))
+                produced_by[column.name] = i;
+    }
+
+    return produced_by;
+}
+
+
+std::vector<size_t> choosePrewhereStepOrder(const PrewhereReadSteps & steps, const PrewhereStepsStats & stats)
+{
+    std::vector<size_t> order(steps.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+
+    /// The last step checks the conjunction itself and the bare-column conditions, so it always
+    /// stays last; with a single remaining step there is nothing to reorder.
+    if (steps.size() < 3)
+        return order;
+
+    size_t num_reorderable = steps.size() - 1;
+
+    /// Rank of a step is the time it spends per row it drops: the cheapest and most selective
+    /// steps get the smallest ranks and are executed first.
+    std::vector<double> rank(num_reorderable);
+    for (size_t i = 0; i < num_reorderable; ++i)
+    {
+        UInt64 rows = stats[i].rows_read.load(std::memory_order_relaxed);
+        if (rows < PrewhereStepStats::MIN_ROWS_TO_REORDER)
+            return order;
+
+        double cost_per_row = static_cast<double>(stats[i].elapsed_ns.load(std::memory_order_relaxed)) / rows;
+        double selectivity = static_cast<double>(stats[i].rows_passed.load(std::memory_order_relaxed)) / rows;
+        rank[i] = cost_per_row / std::max(1. - selectivity, 0.01);
+    }
+
+    /// A step may use a sub-expression calculated by another step; the producer must stay earlier.
+    auto produced_by = mapProducedColumns(steps);
+
+    std::vector<std::vector<size_t>> consumers(num_reorderable);
+    std::vector<size_t> num_pending(num_reorderable, 0);
+    for (size_t i = 0; i < num_reorderable; ++i)
+    {
+        for (const auto & name : steps[i].actions->getRequiredColumns())
+        {
+            auto it = produced_by.find(name);
+            if (it != produced_by.end() && it->second != i)
+            {
+                consumers[it->second].push_back(i);
+                ++num_pending[i];
+            }
+        }
+    }
+
+    /// Greedily take the ready step with the smallest rank. The dependency graph is acyclic
+    /// because a producer always precedes its consumers in the static order.
+    std::vector<char> taken(num_reorderable, false);
+    for (size_t position = 0; position < num_reorderable; ++position)
+    {
+        size_t best = num_reorderable;
+        for (size_t i = 0; i < num_reorderable; ++i)
+            if (!taken[i] && num_pending[i] == 0 && (best == num_reorderable || rank[i] < rank[best]))
+                best = i;
+
+        taken[best] = true;
+        order[position] = best;
+        for (auto consumer : consumers[best])
+            --num_pending[consumer];
+    }
+
+    return order;
+}
+
+
+std::vector<NamesAndTypesList> distributePrewhereReadColumns(
+    const MergeTreeData::DataPartPtr & part, const NamesAndTypesList & pre_columns,
+    const PrewhereReadSteps & steps, const std::vector<size_t> & order)
+{
+    auto produced_by = mapProducedColumns(steps);
+
+    /// A source column is read at the earliest execution position that needs it.
+    std::unordered_map<String, size_t> column_to_position;
+    for (size_t position = 0; position < order.size(); ++position)
+        for (const auto & name : steps[order[position]].actions->getRequiredColumns())
+            if (!produced_by.count(name) && !column_to_position.count(name))
+                column_to_position[name] = position;
+
+    std::vector<NamesAndTypesList> res(steps.size());
+    for (const auto & column : pre_columns)
+    {
+        auto it = column_to_position.find(column.name);
+        res[it == column_to_position.end() ? 0 : it->second].push_back(column);
+    }
+
+    /// The first step determines the number of rows to read, so it must read at least one column
+    /// physically existing in the part (see also injectRequiredColumns).
+    for (const auto & column : res.front())
+        if (part->hasColumnFiles(column.name))
+            return res;
+
+    return {};
+}
+
+
 MergeTreeReadTask::MergeTreeReadTask(
     const MergeTreeData::DataPartPtr & data_part, const MarkRanges & mark_ranges, const size_t part_index_in_query,
     const Names & ordered_names, const NameSet & column_name_set, const NamesAndTypesList & columns,
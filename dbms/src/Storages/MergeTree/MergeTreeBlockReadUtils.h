@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <optional>
 #include <Core/NamesAndTypes.h>
 #include <Storages/MergeTree/RangesInDataPart.h>
@@ -9,9 +10,11 @@
 namespace DB
 {
 
+class Context;
 class MergeTreeData;
 struct MergeTreeReadTask;
 struct MergeTreeBlockSizePredictor;
+struct PrewhereInfo;
 
 using MergeTreeReadTaskPtr = std::unique_ptr<MergeTreeReadTask>;
 using MergeTreeBlockSizePredictorPtr = std::unique_ptr<MergeTreeBlockSizePredictor>;
@@ -25,6 +28,77 @@ using MergeTreeBlockSizePredictorPtr = std::unique_ptr<MergeTreeBlockSizePredict
 NameSet injectRequiredColumns(const MergeTreeData & storage, const MergeTreeData::DataPartPtr & part, Names & columns);
 
 
+/// One step of a multi-step PREWHERE execution. The steps are executed in order, each one reads only
+/// the columns it needs, calculates its filter column and narrows the combined filter, so that the
+/// following steps read columns at already filtered positions.
+struct PrewhereReadStep
+{
+    ExpressionActionsPtr actions;
+    /// Name of the filter column calculated by `actions`.
+    String column_name;
+    /// Whether the filter column should be removed from the block after filtering.
+    bool remove_column = false;
+};
+
+using PrewhereReadSteps = std::vector<PrewhereReadStep>;
+using PrewhereReadStepsPtr = std::shared_ptr<const PrewhereReadSteps>;
+
+/// Execution statistics of one PREWHERE step, accumulated over all streams of a query and used to
+/// reorder the steps while the query runs (see choosePrewhereStepOrder). Updated from multiple
+/// threads with relaxed atomics: the values are a heuristic, not an exact account.
+struct PrewhereStepStats
+{
+    std::atomic<UInt64> rows_read {0};
+    std::atomic<UInt64> rows_passed {0};
+    std::atomic<UInt64> elapsed_ns {0};
+
+    /// Do not reorder by statistics of fewer rows: a few blocks tell little about selectivity.
+    static constexpr UInt64 MIN_ROWS_TO_REORDER = 65536;
+    /// Halve the counters once this many rows accumulate, so that the statistics track the data
+    /// currently being read rather than the whole history of the query.
+    static constexpr UInt64 DECAY_WINDOW_ROWS = 1ULL << 24;
+
+    void update(UInt64 rows, UInt64 passed, UInt64 ns)
+    {
+        rows_read.fetch_add(rows, std::memory_order_relaxed);
+        rows_passed.fetch_add(passed, std::memory_order_relaxed);
+        elapsed_ns.fetch_add(ns, std::memory_order_relaxed);
+
+        /// Racing with concurrent updates only makes the decay slightly inexact.
+        if (rows_read.load(std::memory_order_relaxed) >= DECAY_WINDOW_ROWS)
+        {
+            rows_read.store(rows_read.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+            rows_passed.store(rows_passed.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+            elapsed_ns.store(elapsed_ns.load(std::memory_order_relaxed) / 2, std::memory_order_relaxed);
+        }
+    }
+};
+
+using PrewhereStepsStats = std::vector<PrewhereStepStats>;
+using PrewhereStepsStatsPtr = std::shared_ptr<PrewhereStepsStats>;
+
+/// Try to split a PREWHERE expression of the form `cond1 AND cond2 AND ...` into several read steps.
+/// Returns an empty list if the expression cannot be split; then the whole PREWHERE is executed at
+/// a single step as before.
+PrewhereReadSteps splitPrewhereIntoReadSteps(const PrewhereInfo & prewhere_info, const Context & context);
+
+/// Choose the order in which to execute the PREWHERE steps: steps whose filters drop more rows per
+/// unit of calculation time are moved forward. A step calculating a sub-expression shared with a
+/// later condition always stays before its consumers, and the final conjunction step stays last.
+/// Returns the static order until every reorderable step has seen enough rows. The returned vector
+/// maps execution position to step index.
+std::vector<size_t> choosePrewhereStepOrder(const PrewhereReadSteps & steps, const PrewhereStepsStats & stats);
+
+/// Distribute PREWHERE columns of a part between the read steps executed in the given order: a
+/// column needed by several steps is read by the earliest of them. Columns not claimed by any step
+/// (e.g. injected for defaults calculation) are read at the first step. Returns an empty list if
+/// the first step would not read any physically existing column (then the number of rows to read
+/// cannot be determined and PREWHERE for this part is executed at a single step).
+std::vector<NamesAndTypesList> distributePrewhereReadColumns(
+    const MergeTreeData::DataPartPtr & part, const NamesAndTypesList & pre_columns,
+    const PrewhereReadSteps & steps, const std::vector<size_t> & order);
+
+
 /// A batch of work for MergeTreeThreadBlockInputStream
 struct MergeTreeReadTask
 {
@@ -51,7 +125,8 @@ struct MergeTreeReadTask
     MergeTreeBlockSizePredictorPtr size_predictor;
     /// Used to save current range processing status
     MergeTreeRangeReader range_reader;
-    MergeTreeRangeReader pre_range_reader;
+    /// Range readers of PREWHERE steps; each one is the prev_reader of the next (range_reader is the last in chain).
+    std::vector<MergeTreeRangeReader> pre_range_readers;
 
     bool isFinished() const { return mark_ranges.empty() && range_reader.isCurrentRangeFinished(); }
 
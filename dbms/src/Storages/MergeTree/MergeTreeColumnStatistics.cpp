@@ -0,0 +1,295 @@
+#include <Storages/MergeTree/MergeTreeColumnStatistics.h>
+
+#include <algorithm>
+
+#include <Poco/File.h>
+
+#include <AggregateFunctions/ReservoirSampler.h>
+#include <Columns/ColumnNullable.h>
+#include <Columns/ColumnVector.h>
+#include <Common/SipHash.h>
+#include <Common/typeid_cast.h>
+#include <Core/Block.h>
+#include <Core/NamesAndTypes.h>
+#include <IO/HashingWriteBuffer.h>
+#include <IO/ReadBufferFromFile.h>
+#include <IO/ReadHelpers.h>
+#include <IO/VarInt.h>
+#include <IO/WriteBufferFromFile.h>
+#include <IO/WriteHelpers.h>
+
+
+namespace DB
+{
+
+namespace
+{
+
+/** Approximate merge of two equi-height histograms. Each interval between adjacent bounds
+  * of a histogram holds an equal share of its rows, so every bound carries a known cumulative
+  * weight; the union of the bounds is re-bucketed by the combined cumulative weight.
+  */
+std::vector<Float64> mergeHistograms(
+    const std::vector<Float64> & left, Float64 left_weight,
+    const std::vector<Float64> & right, Float64 right_weight)
+{
+    struct Point
+    {
+        Float64 value;
+        Float64 weight;
+    };
+
+    std::vector<Point> points;
+    points.reserve(left.size() + right.size());
+
+    auto add = [&](const std::vector<Float64> & bounds, Float64 weight)
+    {
+        Float64 per_bound = weight / bounds.size();
+        for (const auto value : bounds)
+            points.push_back({value, per_bound});
+    };
+
+    add(left, left_weight);
+    add(right, right_weight);
+
+    std::sort(points.begin(), points.end(), [](const Point & a, const Point & b) { return a.value < b.value; });
+
+    size_t buckets = std::max(left.size(), right.size()) - 1;
+    Float64 total_weight = left_weight + right_weight;
+
+    std::vector<Float64> result;
+    result.reserve(buckets + 1);
+    result.push_back(points.front().value);
+
+    Float64 accumulated = 0;
+    size_t next_bound = 1;
+    for (const auto & point : points)
+    {
+        accumulated += point.weight;
+        while (next_bound < buckets && accumulated >= total_weight * next_bound / buckets)
+        {
+            result.push_back(point.value);
+            ++next_bound;
+        }
+    }
+
+    while (result.size() < buckets + 1)
+        result.push_back(points.back().value);
+
+    return result;
+}
+
+}
+
+
+void MergeTreeColumnStatistics::merge(const MergeTreeColumnStatistics & other)
+{
+    if (histogram.empty())
+        histogram = other.histogram;
+    else if (!other.histogram.empty())
+        histogram = mergeHistograms(histogram, rows - nulls, other.histogram, other.rows - other.nulls);
+
+    rows += other.rows;
+    nulls += other.nulls;
+    ndv.merge(other.ndv);
+}
+
+
+void MergeTreePartColumnStatistics::merge(const MergeTreePartColumnStatistics & other)
+{
+    for (const auto & elem : other.columns)
+        columns[elem.first].merge(elem.second);
+}
+
+
+void MergeTreePartColumnStatistics::store(const String & part_path, MergeTreeDataPartChecksums & checksums) const
+{
+    WriteBufferFromFile out(part_path + FILE_NAME, 4096);
+    HashingWriteBuffer out_hashing(out);
+
+    writeCString("statistics format version: 1\n", out_hashing);
+    writeText(columns.size(), out_hashing);
+    writeCString(" columns:\n", out_hashing);
+
+    for (const auto & elem : columns)
+    {
+        const MergeTreeColumnStatistics & stat = elem.second;
+
+        writeBackQuotedString(elem.first, out_hashing);
+        writeChar('\n', out_hashing);
+
+        writeVarUInt(stat.rows, out_hashing);
+        writeVarUInt(stat.nulls, out_hashing);
+        writeVarUInt(stat.histogram.size(), out_hashing);
+        for (const auto bound : stat.histogram)
+            writeBinary(bound, out_hashing);
+        stat.ndv.write(out_hashing);
+        writeChar('\n', out_hashing);
+    }
+
+    checksums.files[FILE_NAME].file_size = out_hashing.count();
+    checksums.files[FILE_NAME].file_hash = out_hashing.getHash();
+}
+
+
+bool MergeTreePartColumnStatistics::load(const String & part_path)
+{
+    String path = part_path + FILE_NAME;
+    if (!Poco::File(path).exists())
+        return false;
+
+    columns.clear();
+
+    ReadBufferFromFile in(path, 4096);
+    assertString("statistics format version: 1\n", in);
+
+    size_t count = 0;
+    readText(count, in);
+    assertString(" columns:\n", in);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        String name;
+        readBackQuotedString(name, in);
+        assertChar('\n', in);
+
+        MergeTreeColumnStatistics & stat = columns[name];
+
+        readVarUInt(stat.rows, in);
+        readVarUInt(stat.nulls, in);
+        size_t histogram_size = 0;
+        readVarUInt(histogram_size, in);
+        stat.histogram.resize(histogram_size);
+        for (auto & bound : stat.histogram)
+            readBinary(bound, in);
+        stat.ndv.read(in);
+        assertChar('\n', in);
+    }
+
+    assertEOF(in);
+    return true;
+}
+
+
+struct MergeTreeColumnStatisticsCollector::ColumnState
+{
+    String name;
+    MergeTreeColumnStatistics stats;
+
+    /// Set as soon as the column turns out to be a ColumnVector of some numeric type.
+    bool is_numeric = false;
+    ReservoirSampler<Float64, ReservoirSamplerOnEmpty::RETURN_NAN_OR_ZERO> sample{4096};
+};
+
+
+namespace
+{
+
+using Sampler = ReservoirSampler<Float64, ReservoirSamplerOnEmpty::RETURN_NAN_OR_ZERO>;
+
+template <typename T>
+bool sampleNumericImpl(const IColumn & column, const NullMap * null_map, Sampler & sample)
+{
+    const auto * concrete = typeid_cast<const ColumnVector<T> *>(&column);
+    if (!concrete)
+        return false;
+
+    const auto & data = concrete->getData();
+    for (size_t i = 0, size = data.size(); i < size; ++i)
+        if (!null_map || !(*null_map)[i])
+            sample.insert(static_cast<Float64>(data[i]));
+
+    return true;
+}
+
+/// IColumn has no generic way to extract a value as Float64, so dispatch over the concrete types.
+bool sampleNumeric(const IColumn & column, const NullMap * null_map, Sampler & sample)
+{
+    return sampleNumericImpl<UInt8>(column, null_map, sample)
+        || sampleNumericImpl<UInt16>(column, null_map, sample)
+        || sampleNumericImpl<UInt32>(column, null_map, sample)
+        || sampleNumericImpl<UInt64>(column, null_map, sample)
+        || sampleNumericImpl<Int8>(column, null_map, sample)
+        || sampleNumericImpl<Int16>(column, null_map, sample)
+        || sampleNumericImpl<Int32>(column, null_map, sample)
+        || sampleNumericImpl<Int64>(column, null_map, sample)
+        || sampleNumericImpl<Float32>(column, null_map, sample)
+        || sampleNumericImpl<Float64>(column, null_map, sample);
+}
+
+}
+
+
+MergeTreeColumnStatisticsCollector::MergeTreeColumnStatisticsCollector(const NamesAndTypesList & columns)
+{
+    for (const auto & column : columns)
+    {
+        auto state = std::make_unique<ColumnState>();
+        state->name = column.name;
+        states.push_back(std::move(state));
+    }
+}
+
+MergeTreeColumnStatisticsCollector::~MergeTreeColumnStatisticsCollector() = default;
+
+
+void MergeTreeColumnStatisticsCollector::update(const Block & block)
+{
+    for (auto & state : states)
+    {
+        if (!block.has(state->name))
+            continue;
+
+        const IColumn * column = block.getByName(state->name).column.get();
+
+        const NullMap * null_map = nullptr;
+        if (const auto * nullable = typeid_cast<const ColumnNullable *>(column))
+        {
+            null_map = &nullable->getNullMapData();
+            column = &nullable->getNestedColumn();
+        }
+
+        size_t num_rows = column->size();
+        state->stats.rows += num_rows;
+
+        for (size_t i = 0; i < num_rows; ++i)
+        {
+            if (null_map && (*null_map)[i])
+            {
+                ++state->stats.nulls;
+                continue;
+            }
+
+            SipHash hash;
+            column->updateHashWithValue(i, hash);
+            state->stats.ndv.insert(hash.get64());
+        }
+
+        if (sampleNumeric(*column, null_map, state->sample))
+            state->is_numeric = true;
+    }
+}
+
+
+MergeTreePartColumnStatistics MergeTreeColumnStatisticsCollector::finalize()
+{
+    MergeTreePartColumnStatistics res;
+
+    for (auto & state : states)
+    {
+        if (state->is_numeric && state->sample.size() > 0)
+        {
+            auto & histogram = state->stats.histogram;
+            histogram.resize(MergeTreePartColumnStatistics::HISTOGRAM_BUCKETS + 1);
+            for (size_t k = 0; k <= MergeTreePartColumnStatistics::HISTOGRAM_BUCKETS; ++k)
+                histogram[k] = state->sample.quantileInterpolated(
+                    static_cast<double>(k) / MergeTreePartColumnStatistics::HISTOGRAM_BUCKETS);
+        }
+
+        res.columns[state->name] = std::move(state->stats);
+    }
+
+    return res;
+}
+
+}
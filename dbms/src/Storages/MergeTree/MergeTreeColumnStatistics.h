@@ -0,0 +1,92 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include <Core/Types.h>
+#include <Common/HyperLogLogCounter.h>
+#include <Storages/MergeTree/MergeTreeDataPartChecksum.h>
+
+
+namespace DB
+{
+
+class Block;
+class NamesAndTypesList;
+
+
+/** Lightweight statistics of one column over the rows of one data part:
+  * the number of rows and NULLs, an approximate number of distinct values (HyperLogLog
+  * over SipHash of the values), and, for numeric columns, an equi-height histogram.
+  *
+  * The HyperLogLog counter is stored in its raw form, so statistics of several parts
+  * can be combined with merge() without losing NDV accuracy. Histograms are combined
+  * approximately, by re-bucketing the union of the bucket bounds.
+  */
+struct MergeTreeColumnStatistics
+{
+    UInt64 rows = 0;
+    UInt64 nulls = 0;
+
+    /// Distinct non-NULL values. NOTE HLL12 takes 2.5 KB per column - do not keep
+    /// statistics of all parts in memory, load them on demand (see MergeTreeDataPart).
+    HLL12 ndv;
+
+    /// Bounds of equi-height buckets: HISTOGRAM_BUCKETS + 1 ascending values,
+    /// each bucket holds approximately the same number of rows. Empty for
+    /// non-numeric columns and for columns with no non-NULL values.
+    std::vector<Float64> histogram;
+
+    UInt64 getNDV() const { return ndv.size(); }
+    Float64 getNullFraction() const { return rows ? static_cast<Float64>(nulls) / rows : 0.0; }
+
+    void merge(const MergeTreeColumnStatistics & other);
+};
+
+
+/** Statistics of all columns of one data part. Stored in the part directory
+  * in the `statistics.txt` file (despite the name, the HyperLogLog registers
+  * in it are binary), which participates in the checksums like count.txt and ttl.txt.
+  * Parts written by older server versions simply do not have the file.
+  */
+struct MergeTreePartColumnStatistics
+{
+    static constexpr auto FILE_NAME = "statistics.txt";
+    static constexpr size_t HISTOGRAM_BUCKETS = 16;
+
+    std::map<String, MergeTreeColumnStatistics> columns;
+
+    bool empty() const { return columns.empty(); }
+
+    /// Combine with statistics of another part (used for table-level aggregation).
+    void merge(const MergeTreePartColumnStatistics & other);
+
+    void store(const String & part_path, MergeTreeDataPartChecksums & checksums) const;
+
+    /// Returns false if the part has no statistics file.
+    bool load(const String & part_path);
+};
+
+
+/** Builds MergeTreePartColumnStatistics incrementally from the blocks passing through
+  * MergedBlockOutputStream. NDV and the null fraction are exact per part; the histogram
+  * is computed from a fixed-size reservoir sample of the rows, so it stays cheap
+  * for merges of arbitrary size.
+  */
+class MergeTreeColumnStatisticsCollector
+{
+public:
+    explicit MergeTreeColumnStatisticsCollector(const NamesAndTypesList & columns);
+    ~MergeTreeColumnStatisticsCollector();
+
+    void update(const Block & block);
+
+    /// Finishes the histograms. The collector must not be updated after that.
+    MergeTreePartColumnStatistics finalize();
+
+private:
+    struct ColumnState;
+    std::vector<std::unique_ptr<ColumnState>> states;
+};
+
+}
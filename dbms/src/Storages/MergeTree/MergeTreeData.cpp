@@ -3,7 +3,10 @@
 #include <Interpreters/ExpressionAnalyzer.h>
 #include <Storages/MergeTree/MergeTreeBlockInputStream.h>
 #include <Storages/MergeTree/MergedBlockOutputStream.h>
+#include <Storages/MergeTree/MergeTreeWriteAheadLog.h>
+#include <Storages/MergeTree/MergeTreeDeduplicationLog.h>
 #include <Storages/MergeTree/checkDataPart.h>
+#include <Storages/MarkCache.h>
 #include <Storages/StorageMergeTree.h>
 #include <Storages/StorageReplicatedMergeTree.h>
 #include <Storages/AlterCommands.h>
@@ -18,6 +21,7 @@
 #include <Formats/ValuesRowInputStream.h>
 #include <DataStreams/copyData.h>
 #include <IO/WriteBufferFromFile.h>
+#include <IO/ReadBufferFromFile.h>
 #include <IO/WriteBufferFromString.h>
 #include <IO/CompressedReadBuffer.h>
 #include <IO/ReadBufferFromMemory.h>
@@ -26,6 +30,7 @@
 #include <IO/Operators.h>
 #include <DataTypes/DataTypeDate.h>
 #include <DataTypes/DataTypeDateTime.h>
+#include <DataTypes/DataTypeString.h>
 #include <DataTypes/DataTypeEnum.h>
 #include <DataTypes/NestedUtils.h>
 #include <DataTypes/DataTypeArray.h>
@@ -34,16 +39,23 @@
 #include <Functions/IFunction.h>
 #include <Common/Increment.h>
 #include <Common/SimpleIncrement.h>
+#include <Common/Throttler.h>
 #include <Common/escapeForFileName.h>
 #include <Common/StringUtils/StringUtils.h>
 #include <Common/Stopwatch.h>
 #include <Common/typeid_cast.h>
+#include <Common/getNumberOfPhysicalCPUCores.h>
+#include <Common/ThreadPool.h>
 #include <Common/localBackup.h>
+#include <Common/MemoryTracker.h>
 #include <Interpreters/PartLog.h>
 
 #include <Poco/DirectoryIterator.h>
 
 #include <boost/range/adaptor/filtered.hpp>
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/trim.hpp>
 
 #include <algorithm>
 #include <iomanip>
@@ -82,6 +94,9 @@ namespace ErrorCodes
     extern const int CANNOT_ALLOCATE_MEMORY;
     extern const int CANNOT_MUNMAP;
     extern const int CANNOT_MREMAP;
+    extern const int NOT_IMPLEMENTED;
+    extern const int NOT_ENOUGH_SPACE;
+    extern const int CANNOT_READ_ALL_DATA;
 }
 
 
@@ -94,6 +109,7 @@ MergeTreeData::MergeTreeData(
     const String & date_column_name,
     const ASTPtr & partition_expr_ast_,
     const ASTPtr & sampling_expression_,
+    const ASTPtr & ttl_table_ast_,
     const MergingParams & merging_params_,
     const MergeTreeSettings & settings_,
     bool require_part_metadata_,
@@ -108,6 +124,7 @@ MergeTreeData::MergeTreeData(
     primary_expr_ast(primary_expr_ast_),
     secondary_sort_expr_ast(secondary_sort_expr_ast_),
     partition_expr_ast(partition_expr_ast_),
+    ttl_table_ast(ttl_table_ast_),
     require_part_metadata(require_part_metadata_),
     database_name(database_), table_name(table_),
     full_path(full_path_),
@@ -156,11 +173,33 @@ MergeTreeData::MergeTreeData(
         min_format_version = MERGE_TREE_DATA_MIN_FORMAT_VERSION_WITH_CUSTOM_PARTITIONING;
     }
 
+    initSkipIndices();
+
+    initProjection();
+
+    initTTL();
+
+    /// The table's own data directory is always the first (hottest) volume.
+    volumes.push_back(MergeTreeStoragePolicy::Volume{"default", {full_path}, 0, 0});
+
+    String storage_policy_name = settings.storage_policy;
+    if (!storage_policy_name.empty())
+    {
+        relative_data_path = "data/" + escapeForFileName(database_name) + "/" + escapeForFileName(table_name) + "/";
+        storage_policy = std::make_shared<MergeTreeStoragePolicy>(context.getConfigRef(), storage_policy_name, relative_data_path);
+
+        for (const auto & volume : storage_policy->getVolumes())
+            volumes.push_back(volume);
+    }
+
     auto path_exists = Poco::File(full_path).exists();
-    /// Creating directories, if not exist.
-    Poco::File(full_path).createDirectories();
 
-    Poco::File(full_path + "detached").createDirectory();
+    /// Creating directories, if not exist.
+    for (const String & path : getDataPaths())
+    {
+        Poco::File(path).createDirectories();
+        Poco::File(path + "detached").createDirectory();
+    }
 
     String version_file_path = full_path + "format_version.txt";
     auto version_file_exists = Poco::File(version_file_path).exists();
@@ -308,6 +347,152 @@ void MergeTreeData::initPartitionKey()
 }
 
 
+/// Parse a comma-separated list of column names from a setting value and check that the columns exist in the table.
+static NamesAndTypesList parseColumnsListFromSetting(
+    const String & value, const String & setting_name, const NamesAndTypesList & all_columns)
+{
+    NamesAndTypesList res;
+
+    Strings column_names;
+    boost::split(column_names, value, boost::algorithm::is_any_of(","));
+    for (String & name : column_names)
+    {
+        boost::trim(name);
+        if (name.empty())
+            continue;
+
+        auto it = std::find_if(all_columns.begin(), all_columns.end(),
+            [&name] (const NameAndTypePair & column) { return column.name == name; });
+        if (it == all_columns.end())
+            throw Exception("Column " + backQuoteIfNeed(name) + " listed in " + setting_name + " setting"
+                " doesn't exist in table", ErrorCodes::NO_SUCH_COLUMN_IN_TABLE);
+
+        res.push_back(*it);
+    }
+
+    return res;
+}
+
+
+void MergeTreeData::initSkipIndices()
+{
+    if (!settings.skip_index_minmax_columns.value.empty())
+    {
+        NamesAndTypesList index_columns_with_types = parseColumnsListFromSetting(
+            settings.skip_index_minmax_columns.value, "skip_index_minmax_columns", getColumns().getAllPhysical());
+
+        for (const NameAndTypePair & column : index_columns_with_types)
+        {
+            skip_minmax_idx_columns.emplace_back(column.name);
+            skip_minmax_idx_column_types.emplace_back(column.type);
+        }
+
+        if (!index_columns_with_types.empty())
+            skip_minmax_idx_expr = std::make_shared<ExpressionActions>(index_columns_with_types, context);
+    }
+
+    if (!settings.skip_index_ngrambf_columns.value.empty())
+    {
+        NamesAndTypesList index_columns_with_types = parseColumnsListFromSetting(
+            settings.skip_index_ngrambf_columns.value, "skip_index_ngrambf_columns", getColumns().getAllPhysical());
+
+        for (const NameAndTypePair & column : index_columns_with_types)
+        {
+            if (!typeid_cast<const DataTypeString *>(column.type.get()))
+                throw Exception("Column " + backQuoteIfNeed(column.name) + " listed in skip_index_ngrambf_columns"
+                    " setting must have type String, but has type " + column.type->getName(), ErrorCodes::BAD_TYPE_OF_FIELD);
+
+            skip_ngrambf_idx_columns.emplace_back(column.name);
+        }
+    }
+
+    if (!settings.delta_compression_columns.value.empty())
+    {
+        NamesAndTypesList delta_columns_with_types = parseColumnsListFromSetting(
+            settings.delta_compression_columns.value, "delta_compression_columns", getColumns().getAllPhysical());
+
+        for (const NameAndTypePair & column : delta_columns_with_types)
+            delta_compression_columns.emplace_back(column.name);
+    }
+
+    if (!settings.sparse_compression_columns.value.empty())
+    {
+        NamesAndTypesList sparse_columns_with_types = parseColumnsListFromSetting(
+            settings.sparse_compression_columns.value, "sparse_compression_columns", getColumns().getAllPhysical());
+
+        for (const NameAndTypePair & column : sparse_columns_with_types)
+            sparse_compression_columns.emplace_back(column.name);
+    }
+}
+
+
+void MergeTreeData::initProjection()
+{
+    if (settings.projection_sort_columns.value.empty())
+        return;
+
+    NamesAndTypesList sort_columns_with_types = parseColumnsListFromSetting(
+        settings.projection_sort_columns.value, "projection_sort_columns", getColumns().getAllPhysical());
+
+    for (const NameAndTypePair & column : sort_columns_with_types)
+    {
+        projection_sort_columns.emplace_back(column.name);
+        projection_sort_column_types.emplace_back(column.type);
+    }
+
+    if (!sort_columns_with_types.empty())
+        projection_sort_expr = std::make_shared<ExpressionActions>(sort_columns_with_types, context);
+}
+
+
+void MergeTreeData::initTTL()
+{
+    if (!ttl_table_ast)
+        return;
+
+    auto syntax_result = SyntaxAnalyzer(context, {}).analyze(ttl_table_ast, getColumns().getAllPhysical());
+    ttl_expression = ExpressionAnalyzer(ttl_table_ast, syntax_result, context).getActions(false);
+    ttl_result_column = ttl_table_ast->getColumnName();
+
+    const auto & result_type = ttl_expression->getSampleBlock().getByName(ttl_result_column).type;
+    if (!typeid_cast<const DataTypeDate *>(result_type.get())
+        && !typeid_cast<const DataTypeDateTime *>(result_type.get()))
+        throw Exception("TTL expression must result in Date or DateTime, but has type "
+            + result_type->getName(), ErrorCodes::BAD_TYPE_OF_FIELD);
+}
+
+
+CompressionSettings MergeTreeData::getCompressionSettingsForColumn(
+    const String & column_name, const IDataType & type, const CompressionSettings & default_settings) const
+{
+    if (sparse_compression_columns.end()
+        != std::find(sparse_compression_columns.begin(), sparse_compression_columns.end(), column_name))
+    {
+        /// Values that are not represented by a fixed-width number are treated as sequences of bytes.
+        size_t value_size = type.isValueRepresentedByNumber() && type.haveMaximumSizeOfValue()
+            ? type.getSizeOfValueInMemory()
+            : 1;
+
+        CompressionSettings res(CompressionMethod::Sparse);
+        res.sparse_width = (value_size == 2 || value_size == 4 || value_size == 8) ? value_size : 1;
+        res.sparse_min_default_ratio = settings.sparse_compression_min_default_ratio;
+        return res;
+    }
+
+    if (delta_compression_columns.end()
+        == std::find(delta_compression_columns.begin(), delta_compression_columns.end(), column_name))
+        return default_settings;
+
+    /// Values that are not represented by a fixed-width number are delta-encoded bytewise.
+    size_t value_size = type.isValueRepresentedByNumber() && type.haveMaximumSizeOfValue()
+        ? type.getSizeOfValueInMemory()
+        : 1;
+    UInt8 delta_width = (value_size == 2 || value_size == 4 || value_size == 8) ? value_size : 1;
+
+    return CompressionSettings(CompressionMethod::Delta, CompressionSettings::getDefaultLevel(CompressionMethod::Delta), delta_width);
+}
+
+
 void MergeTreeData::MergingParams::check(const NamesAndTypesList & columns) const
 {
     if (!sign_column.empty() && mode != MergingParams::Collapsing && mode != MergingParams::VersionedCollapsing)
@@ -443,15 +628,29 @@ void MergeTreeData::loadDataParts(bool skip_sanity_checks)
 {
     LOG_DEBUG(log, "Loading data parts");
 
-    Strings part_file_names;
+    struct PartNameWithPath
+    {
+        String name;
+        String path;    /// The data directory (volume) the part was found in.
+        MergeTreePartInfo info;
+    };
+
+    /// Parse part names up front: directories that are not parts are skipped,
+    /// and the analysis of broken parts below needs the full list of part infos anyway.
+    std::vector<PartNameWithPath> part_names_with_infos;
     Poco::DirectoryIterator end;
-    for (Poco::DirectoryIterator it(full_path); it != end; ++it)
+    for (const String & path : getDataPaths())
     {
-        /// Skip temporary directories.
-        if (startsWith(it.name(), "tmp"))
-            continue;
+        for (Poco::DirectoryIterator it(path); it != end; ++it)
+        {
+            /// Skip temporary directories.
+            if (startsWith(it.name(), "tmp"))
+                continue;
 
-        part_file_names.push_back(it.name());
+            MergeTreePartInfo part_info;
+            if (MergeTreePartInfo::tryParsePartName(it.name(), &part_info, format_version))
+                part_names_with_infos.push_back({it.name(), path, part_info});
+        }
     }
 
     DataPartsVector broken_parts_to_remove;
@@ -461,14 +660,17 @@ void MergeTreeData::loadDataParts(bool skip_sanity_checks)
     std::lock_guard<std::mutex> lock(data_parts_mutex);
     data_parts_indexes.clear();
 
-    for (const String & file_name : part_file_names)
-    {
-        MergeTreePartInfo part_info;
-        if (!MergeTreePartInfo::tryParsePartName(file_name, &part_info, format_version))
-            continue;
+    /// Loading a part is mostly reading and deserializing its checksums and indexes,
+    /// so with many parts it scales well with the number of threads.
+    std::vector<MutableDataPartPtr> loaded_parts;
+    std::vector<MutableDataPartPtr> broken_part_candidates;
+    std::mutex loading_mutex;
 
-        MutableDataPartPtr part = std::make_shared<DataPart>(*this, file_name, part_info);
-        part->relative_path = file_name;
+    auto load_part = [&](const PartNameWithPath & name_with_path)
+    {
+        MutableDataPartPtr part = std::make_shared<DataPart>(*this, name_with_path.name, name_with_path.info);
+        part->base_path = name_with_path.path;
+        part->relative_path = name_with_path.name;
         bool broken = false;
 
         try
@@ -495,63 +697,112 @@ void MergeTreeData::loadDataParts(bool skip_sanity_checks)
             tryLogCurrentException(__PRETTY_FUNCTION__);
         }
 
-        /// Ignore and possibly delete broken parts that can appear as a result of hard server restart.
-        if (broken)
-        {
-            if (part->info.level == 0)
-            {
-                /// It is impossible to restore level 0 parts.
-                LOG_ERROR(log, "Considering to remove broken part " << full_path + file_name << " because it's impossible to repair.");
-                broken_parts_to_remove.push_back(part);
-            }
-            else
-            {
-                /// Count the number of parts covered by the broken part. If it is at least two, assume that
-                /// the broken part was created as a result of merging them and we won't lose data if we
-                /// delete it.
-                int contained_parts = 0;
+        if (!broken)
+            part->modification_time = Poco::File(part->getFullPath()).getLastModified().epochTime();
 
-                LOG_ERROR(log, "Part " << full_path + file_name << " is broken. Looking for parts to replace it.");
+        std::lock_guard<std::mutex> loading_lock(loading_mutex);
+        (broken ? broken_part_candidates : loaded_parts).push_back(part);
+    };
 
-                for (const String & contained_name : part_file_names)
-                {
-                    if (contained_name == file_name)
-                        continue;
+    size_t num_threads = settings.max_part_loading_threads;
+    if (num_threads == 0)
+        num_threads = getNumberOfPhysicalCPUCores();
+    num_threads = std::min(num_threads, part_names_with_infos.size());
 
-                    MergeTreePartInfo contained_part_info;
-                    if (!MergeTreePartInfo::tryParsePartName(contained_name, &contained_part_info, format_version))
-                        continue;
+    if (num_threads > 1)
+    {
+        ThreadPool pool(num_threads);
+        for (size_t i = 0; i < part_names_with_infos.size(); ++i)
+            pool.schedule([&, i] { load_part(part_names_with_infos[i]); });
+        pool.wait();
+    }
+    else
+    {
+        for (const auto & name_with_path : part_names_with_infos)
+            load_part(name_with_path);
+    }
 
-                    if (part->info.contains(contained_part_info))
-                    {
-                        LOG_ERROR(log, "Found part " << full_path + contained_name);
-                        ++contained_parts;
-                    }
-                }
+    /// Ignore and possibly delete broken parts that can appear as a result of hard server restart.
+    for (const MutableDataPartPtr & part : broken_part_candidates)
+    {
+        if (part->info.level == 0)
+        {
+            /// It is impossible to restore level 0 parts.
+            LOG_ERROR(log, "Considering to remove broken part " << part->getFullPath() << " because it's impossible to repair.");
+            broken_parts_to_remove.push_back(part);
+        }
+        else
+        {
+            /// Count the number of parts covered by the broken part. If it is at least two, assume that
+            /// the broken part was created as a result of merging them and we won't lose data if we
+            /// delete it.
+            int contained_parts = 0;
 
-                if (contained_parts >= 2)
-                {
-                    LOG_ERROR(log, "Considering to remove broken part " << full_path + file_name << " because it covers at least 2 other parts");
-                    broken_parts_to_remove.push_back(part);
-                }
-                else
+            LOG_ERROR(log, "Part " << part->getFullPath() << " is broken. Looking for parts to replace it.");
+
+            for (const auto & name_with_path : part_names_with_infos)
+            {
+                if (name_with_path.name == part->name)
+                    continue;
+
+                if (part->info.contains(name_with_path.info))
                 {
-                    LOG_ERROR(log, "Detaching broken part " << full_path + file_name
-                        << " because it covers less than 2 parts. You need to resolve this manually");
-                    broken_parts_to_detach.push_back(part);
-                    ++suspicious_broken_parts;
+                    LOG_ERROR(log, "Found part " << name_with_path.path + name_with_path.name);
+                    ++contained_parts;
                 }
             }
 
-            continue;
+            if (contained_parts >= 2)
+            {
+                LOG_ERROR(log, "Considering to remove broken part " << part->getFullPath() << " because it covers at least 2 other parts");
+                broken_parts_to_remove.push_back(part);
+            }
+            else
+            {
+                LOG_ERROR(log, "Detaching broken part " << part->getFullPath()
+                    << " because it covers less than 2 parts. You need to resolve this manually");
+                broken_parts_to_detach.push_back(part);
+                ++suspicious_broken_parts;
+            }
         }
+    }
 
-        part->modification_time = Poco::File(full_path + file_name).getLastModified().epochTime();
+    for (const MutableDataPartPtr & part : loaded_parts)
+    {
         /// Assume that all parts are Committed, covered parts will be detected and marked as Outdated later
         part->state = DataPartState::Committed;
 
         if (!data_parts_indexes.insert(part).second)
+        {
+            auto existing = data_parts_by_info.find(part->info);
+            if (existing != data_parts_by_info.end() && (*existing)->base_path != part->base_path)
+            {
+                /// The same part on two volumes is a leftover of a background move that was not
+                /// cleaned up before restart. Both copies are complete, keep the one loaded first.
+                LOG_WARNING(log, "Part " << part->getFullPath() << " also exists in " << (*existing)->getFullPath()
+                    << ". Probably it is a leftover of a move to another volume. Detaching it.");
+                part->renameToDetached("moved_");
+                continue;
+            }
+
             throw Exception("Part " + part->name + " already exists", ErrorCodes::DUPLICATE_DATA_PART);
+        }
+    }
+
+    /// Restore in-memory parts from the write-ahead log, if there is one.
+    bool replayed_wal = false;
+    if (Poco::File(full_path + MergeTreeWriteAheadLog::WAL_FILE_NAME).exists())
+    {
+        replayed_wal = true;
+
+        for (MutableDataPartPtr & part : getWriteAheadLog()->restore())
+        {
+            part->state = DataPartState::Committed;
+
+            if (!data_parts_indexes.insert(part).second)
+                LOG_WARNING(log, "Part " << part->name << " restored from the write-ahead log"
+                    << " already exists on disk. Ignoring the in-memory copy.");
+        }
     }
 
     if (suspicious_broken_parts > settings.max_suspicious_broken_parts && !skip_sanity_checks)
@@ -611,6 +862,18 @@ void MergeTreeData::loadDataParts(bool skip_sanity_checks)
         }
     }
 
+    /// Drop entries of merged-away (now Outdated) in-memory parts from the write-ahead log,
+    ///  so that it does not grow indefinitely.
+    if (replayed_wal)
+    {
+        std::vector<MutableDataPartPtr> active_in_memory_parts;
+        for (const auto & part : getDataPartsStateRange(DataPartState::Committed))
+            if (part->is_in_memory)
+                active_in_memory_parts.push_back(std::const_pointer_cast<DataPart>(part));
+
+        getWriteAheadLog()->rewrite(active_in_memory_parts);
+    }
+
     calculateColumnSizesImpl();
 
     LOG_DEBUG(log, "Loaded data parts (" << data_parts_indexes.size() << " items)");
@@ -648,24 +911,56 @@ void MergeTreeData::clearOldTemporaryDirectories(ssize_t custom_directories_life
 
     /// Delete temporary directories older than a day.
     Poco::DirectoryIterator end;
-    for (Poco::DirectoryIterator it{full_path}; it != end; ++it)
+    for (const String & path : getDataPaths())
     {
-        if (startsWith(it.name(), "tmp"))
+        for (Poco::DirectoryIterator it{path}; it != end; ++it)
         {
-            Poco::File tmp_dir(full_path + it.name());
-
-            try
+            if (startsWith(it.name(), "tmp"))
             {
-                if (tmp_dir.isDirectory() && isOldPartDirectory(tmp_dir, deadline))
+                Poco::File tmp_dir(path + it.name());
+
+                try
+                {
+                    if (tmp_dir.isDirectory() && isOldPartDirectory(tmp_dir, deadline))
+                    {
+                        LOG_WARNING(log, "Removing temporary directory " << path << it.name());
+                        Poco::File(path + it.name()).remove(true);
+                    }
+                }
+                catch (const Poco::FileNotFoundException &)
                 {
-                    LOG_WARNING(log, "Removing temporary directory " << full_path << it.name());
-                    Poco::File(full_path + it.name()).remove(true);
+                    /// If the file is already deleted, do nothing.
                 }
             }
-            catch (const Poco::FileNotFoundException &)
+        }
+    }
+
+    /// Directories of parts that were moved to another volume are removed with the same delay,
+    /// because queries that were started before the move can still read from them.
+    {
+        std::lock_guard<std::mutex> lock(dirs_of_moved_parts_mutex);
+
+        for (auto it = dirs_of_moved_parts.begin(); it != dirs_of_moved_parts.end();)
+        {
+            if (static_cast<ssize_t>(it->second) >= deadline)
+            {
+                ++it;
+                continue;
+            }
+
+            try
+            {
+                LOG_INFO(log, "Removing directory " << it->first << " of a part moved to another volume");
+                Poco::File dir(it->first);
+                if (dir.exists())
+                    dir.remove(true);
+            }
+            catch (...)
             {
-                /// If the file is already deleted, do nothing.
+                tryLogCurrentException(log, __PRETTY_FUNCTION__);
             }
+
+            it = dirs_of_moved_parts.erase(it);
         }
     }
 }
@@ -782,8 +1077,158 @@ void MergeTreeData::clearOldPartsFromFilesystem()
     removePartsFinally(parts_to_remove);
 }
 
+void MergeTreeData::preloadMarks()
+{
+    if (!settings.preload_marks_on_startup || marks_preloaded.exchange(true))
+        return;
+
+    auto mark_cache = context.getMarkCache();
+    if (!mark_cache)
+        return;
+
+    /// Memory for marks must not be accounted as memory usage for query, because they are stored in shared cache.
+    auto temporarily_disable_memory_tracker = getCurrentMemoryTrackerActionLock();
+
+    Stopwatch watch;
+    size_t loaded_files = 0;
+
+    for (const auto & part : getDataPartsVector())
+    {
+        for (const auto & file : part->checksums.files)
+        {
+            const String & file_name = file.first;
+            if (!endsWith(file_name, ".mrk"))
+                continue;
+
+            String path = part->getFullPath() + file_name;
+            auto key = mark_cache->hash(path);
+
+            try
+            {
+                mark_cache->getOrSet(key, [&]() -> MarkCache::MappedPtr
+                {
+                    size_t file_size = Poco::File(path).getSize();
+                    auto marks = std::make_shared<MarksInCompressedFile>(file_size / sizeof(MarkInCompressedFile));
+
+                    ReadBufferFromFile buffer(path, file_size, -1, reinterpret_cast<char *>(marks->data()));
+
+                    if (buffer.eof() || buffer.buffer().size() != file_size)
+                        throw Exception("Cannot read all marks from file " + path, ErrorCodes::CANNOT_READ_ALL_DATA);
+
+                    return marks;
+                });
+
+                ++loaded_files;
+            }
+            catch (...)
+            {
+                /// A corrupted marks file will be reported when the part is actually read.
+                tryLogCurrentException(log, "while preloading marks from " + path);
+            }
+        }
+    }
+
+    LOG_DEBUG(log, "Preloaded " << loaded_files << " marks files into the mark cache in " << watch.elapsedSeconds() << " sec.");
+}
+
+bool MergeTreeData::scrubOneDataPart(
+    const std::function<bool()> & is_cancelled,
+    const std::function<void(const DataPartPtr &)> & on_corruption)
+{
+    if (!settings.scrub_max_bytes_per_second)
+        return false;
+
+    ThrottlerPtr throttler;
+    MergeTreePartInfo cursor;
+
+    {
+        std::lock_guard<std::mutex> lock(scrub_mutex);
+
+        if (!scrub_pass_in_progress)
+        {
+            if (time(nullptr) < scrub_status.last_pass_time + static_cast<time_t>(settings.scrub_period_seconds.totalSeconds()))
+                return false;
+
+            scrub_pass_in_progress = true;
+            scrub_cursor = MergeTreePartInfo();
+        }
+
+        if (!scrub_throttler)
+            scrub_throttler = std::make_shared<Throttler>(settings.scrub_max_bytes_per_second);
+
+        throttler = scrub_throttler;
+        cursor = scrub_cursor;
+    }
+
+    /// The first committed part after the cursor. Holding the DataPartPtr keeps the files on disk
+    /// even if the part is merged away while it is being read. Parts created behind the cursor
+    /// during the pass (e.g. by merges) are simply left to the next pass.
+    DataPartPtr part;
+    for (const auto & candidate : getDataPartsVector())
+    {
+        if (cursor < candidate->info)
+        {
+            part = candidate;
+            break;
+        }
+    }
+
+    if (!part)
+    {
+        std::lock_guard<std::mutex> lock(scrub_mutex);
+        scrub_pass_in_progress = false;
+        scrub_status.last_pass_time = time(nullptr);
+        LOG_DEBUG(log, "Finished scrub pass over all data parts"
+            << " (" << scrub_status.parts_scrubbed << " parts verified since server start).");
+        return false;
+    }
+
+    bool is_broken = false;
+    try
+    {
+        auto checksums = checkDataPart(
+            part->getFullPath(), part->index_granularity, false, primary_key_data_types, is_cancelled, throttler);
+
+        /// The check was cancelled (the table is shutting down) - do not advance the cursor.
+        if (checksums.files.empty())
+            return false;
+    }
+    catch (...)
+    {
+        is_broken = true;
+        tryLogCurrentException(log, "while scrubbing part " + part->name);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(scrub_mutex);
+        scrub_cursor = part->info;
+        scrub_status.last_scrubbed_part = part->name;
+        scrub_status.last_scrub_time = time(nullptr);
+        ++scrub_status.parts_scrubbed;
+        scrub_status.bytes_scrubbed += part->bytes_on_disk;
+        if (is_broken)
+            ++scrub_status.failed_parts;
+    }
+
+    if (is_broken)
+        on_corruption(part);
+
+    return true;
+}
+
+MergeTreeData::ScrubStatus MergeTreeData::getScrubStatus() const
+{
+    std::lock_guard<std::mutex> lock(scrub_mutex);
+    return scrub_status;
+}
+
 void MergeTreeData::setPath(const String & new_full_path)
 {
+    /// Renaming would have to move the table directories on all volumes consistently
+    /// and update the paths of the loaded parts. Not supported (yet).
+    if (storage_policy)
+        throw Exception("RENAME is not supported for tables with a storage policy", ErrorCodes::NOT_IMPLEMENTED);
+
     if (Poco::File{new_full_path}.exists())
         throw Exception{"Target path already exists: " + new_full_path, ErrorCodes::DIRECTORY_ALREADY_EXISTS};
 
@@ -791,6 +1236,7 @@ void MergeTreeData::setPath(const String & new_full_path)
 
     context.dropCaches();
     full_path = new_full_path;
+    volumes[0].paths = {full_path};
 }
 
 void MergeTreeData::dropAllData()
@@ -808,11 +1254,170 @@ void MergeTreeData::dropAllData()
 
     LOG_TRACE(log, "dropAllData: removing data from filesystem.");
 
-    Poco::File(full_path).remove(true);
+    for (const String & path : getDataPaths())
+        Poco::File(path).remove(true);
 
     LOG_TRACE(log, "dropAllData: done.");
 }
 
+Strings MergeTreeData::getDataPaths() const
+{
+    Strings res;
+    for (const auto & volume : volumes)
+        res.insert(res.end(), volume.paths.begin(), volume.paths.end());
+    return res;
+}
+
+DiskSpaceMonitor::ReservationPtr MergeTreeData::reserveSpaceForPart(size_t size) const
+{
+    for (const auto & volume : volumes)
+    {
+        if (volume.max_data_part_size_bytes && size > volume.max_data_part_size_bytes)
+            continue;
+
+        for (const String & path : volume.paths)
+            if (DiskSpaceMonitor::getUnreservedFreeSpace(path) >= size)
+                return DiskSpaceMonitor::reserve(path, size);
+    }
+
+    throw Exception("Not enough free disk space on any volume to reserve "
+        + formatReadableSizeWithBinarySuffix(size), ErrorCodes::NOT_ENOUGH_SPACE);
+}
+
+size_t MergeTreeData::getMaxUnreservedFreeSpace() const
+{
+    size_t res = 0;
+    for (const auto & volume : volumes)
+        for (const String & path : volume.paths)
+            res = std::max(res, DiskSpaceMonitor::getUnreservedFreeSpace(path));
+    return res;
+}
+
+/// Copies the part to another volume (with a temporary name first) and substitutes it in the
+/// working set for a copy of the DataPart object pointing to the new location. The old directory
+/// is not touched, because queries that were started before the move can still read from it;
+/// it is removed later by clearOldTemporaryDirectories.
+bool MergeTreeData::movePartToPath(const DataPartPtr & part, const String & dest_path)
+{
+    String tmp_relative_path = "tmp_move_" + part->name;
+    String tmp_path = dest_path + tmp_relative_path;
+
+    if (Poco::File(tmp_path).exists())
+    {
+        LOG_WARNING(log, "Directory " << tmp_path << " already exists. Probably it is a leftover of an unfinished move. Removing it.");
+        Poco::File(tmp_path).remove(true);
+    }
+
+    LOG_DEBUG(log, "Moving part " << part->name << " from " << part->getFullPath() << " to " << dest_path);
+
+    /// The part directory is flat (localBackup with max_level 0 keeps it so).
+    Poco::File(tmp_path).createDirectories();
+    Poco::DirectoryIterator end;
+    for (Poco::DirectoryIterator it(part->getFullPath()); it != end; ++it)
+        it->copyTo(tmp_path + "/" + it.name());
+
+    MutableDataPartPtr new_part = std::make_shared<DataPart>(*this, part->name, part->info);
+    new_part->base_path = dest_path;
+    new_part->relative_path = tmp_relative_path;
+    new_part->is_temp = true;   /// So that the copy is removed if the part cannot be substituted.
+    new_part->loadColumnsChecksumsIndexes(require_part_metadata, true);
+    new_part->modification_time = time(nullptr);
+
+    {
+        std::lock_guard<std::mutex> lock(data_parts_mutex);
+
+        auto it = data_parts_by_info.find(part->info);
+        if (it == data_parts_by_info.end() || *it != part || (*it)->state != DataPartState::Committed)
+        {
+            LOG_INFO(log, "Part " << part->name << " is no longer in the working set, cancelling the move");
+            return false;
+        }
+
+        new_part->renameTo(part->name);
+        new_part->is_temp = false;
+        new_part->state = DataPartState::Committed;
+
+        data_parts_by_info.erase(it);
+        data_parts_indexes.insert(new_part);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(dirs_of_moved_parts_mutex);
+        dirs_of_moved_parts.emplace_back(part->getFullPath(), time(nullptr));
+    }
+
+    LOG_INFO(log, "Moved part " << part->name << " to " << new_part->getFullPath());
+    return true;
+}
+
+bool MergeTreeData::moveSomePartToAnotherVolume()
+{
+    if (volumes.size() < 2)
+        return false;
+
+    time_t now = time(nullptr);
+    DataPartsVector parts = getDataPartsVector();
+
+    for (size_t i = 0; i + 1 < volumes.size(); ++i)
+    {
+        const auto & volume = volumes[i];
+
+        /// When the volume runs out of space, its biggest parts are moved out;
+        /// independently of that, parts that are old enough are moved out too.
+        size_t free_space = 0;
+        size_t total_space = 0;
+        for (const String & path : volume.paths)
+        {
+            free_space += DiskSpaceMonitor::getUnreservedFreeSpace(path);
+            total_space += DiskSpaceMonitor::getTotalSpace(path);
+        }
+        bool low_space = total_space && free_space < storage_policy->getMoveFactor() * total_space;
+
+        DataPartPtr candidate;
+        for (const auto & part : parts)
+        {
+            if (part->is_in_memory
+                || std::find(volume.paths.begin(), volume.paths.end(), part->base_path) == volume.paths.end())
+                continue;
+
+            bool old_enough = volume.move_older_than_seconds
+                && part->modification_time + static_cast<time_t>(volume.move_older_than_seconds) <= now;
+
+            if (!low_space && !old_enough)
+                continue;
+
+            if (!candidate
+                || (low_space ? part->bytes_on_disk > candidate->bytes_on_disk
+                              : part->modification_time < candidate->modification_time))
+                candidate = part;
+        }
+
+        if (!candidate)
+            continue;
+
+        /// Reserve space for the part on one of the colder volumes.
+        for (size_t j = i + 1; j < volumes.size(); ++j)
+        {
+            if (volumes[j].max_data_part_size_bytes && candidate->bytes_on_disk > volumes[j].max_data_part_size_bytes)
+                continue;
+
+            for (const String & path : volumes[j].paths)
+            {
+                if (DiskSpaceMonitor::getUnreservedFreeSpace(path) < candidate->bytes_on_disk)
+                    continue;
+
+                auto reservation = DiskSpaceMonitor::reserve(path, candidate->bytes_on_disk);
+                return movePartToPath(candidate, path);
+            }
+        }
+
+        LOG_WARNING(log, "Part " << candidate->name << " should be moved from volume " << volume.name
+            << " but no colder volume has enough free space for it");
+    }
+
+    return false;
+}
+
 namespace
 {
 
@@ -913,6 +1518,14 @@ void MergeTreeData::checkAlter(const AlterCommands & commands)
     if (!merging_params.sign_column.empty())
         columns_alter_forbidden.insert(merging_params.sign_column);
 
+    if (ttl_expression)
+    {
+        /// Forbid altering columns used by the table TTL expression: values of the expression are
+        /// stored per part and must stay consistent with the data.
+        for (const String & col : ttl_expression->getRequiredColumns())
+            columns_alter_forbidden.insert(col);
+    }
+
     std::map<String, const IDataType *> old_types;
     for (const auto & column : getColumns().getAllPhysical())
         old_types.emplace(column.name, column.type.get());
@@ -950,6 +1563,16 @@ void MergeTreeData::checkAlter(const AlterCommands & commands)
     createConvertExpression(nullptr, getColumns().getAllPhysical(), new_columns.getAllPhysical(), unused_expression, unused_map, unused_bool);
 }
 
+bool MergeTreeData::alterRequiresPartUpdates(const NamesAndTypesList & new_columns) const
+{
+    ExpressionActionsPtr expression;
+    NameToNameMap rename_map;
+    bool force_update_metadata;
+    createConvertExpression(nullptr, getColumns().getAllPhysical(), new_columns, expression, rename_map, force_update_metadata);
+
+    return expression != nullptr || !rename_map.empty() || force_update_metadata;
+}
+
 void MergeTreeData::createConvertExpression(const DataPartPtr & part, const NamesAndTypesList & old_columns, const NamesAndTypesList & new_columns,
     ExpressionActionsPtr & out_expression, NameToNameMap & out_rename_map, bool & out_force_update_metadata) const
 {
@@ -1186,7 +1809,7 @@ MergeTreeData::AlterDataPartTransactionPtr MergeTreeData::alterDataPart(
                 if (position_of_existing_column < prev_position_of_existing_column)
                     throw Exception("Permuting of columns of primary key is not supported", ErrorCodes::BAD_ARGUMENTS);
 
-                new_index[i] = part->index.at(position_of_existing_column);
+                new_index[i] = part->getIndex().at(position_of_existing_column);
                 prev_position_of_existing_column = position_of_existing_column;
             }
             else
@@ -1199,7 +1822,7 @@ MergeTreeData::AlterDataPartTransactionPtr MergeTreeData::alterDataPart(
         if (prev_position_of_existing_column == -1)
             throw Exception("No common columns while modifying primary key", ErrorCodes::BAD_ARGUMENTS);
 
-        String index_tmp_path = full_path + part->name + "/primary.idx.tmp";
+        String index_tmp_path = part->getFullPath() + "primary.idx.tmp";
         WriteBufferFromFile index_file(index_tmp_path);
         HashingWriteBuffer index_stream(index_file);
 
@@ -1220,13 +1843,23 @@ MergeTreeData::AlterDataPartTransactionPtr MergeTreeData::alterDataPart(
         return nullptr;
     }
 
+    /// In-memory parts have no files to convert; they will be rewritten by merges anyway.
+    if (part->is_in_memory)
+        throw Exception("ALTER of in-memory part " + part->name + " is not implemented."
+            " Wait until it is written to disk by a merge (or run OPTIMIZE TABLE) and retry.",
+            ErrorCodes::NOT_IMPLEMENTED);
+
     /// Apply the expression and write the result to temporary files.
     if (expression)
     {
         MarkRanges ranges{MarkRange(0, part->marks_count)};
+        /// Rows deleted by lightweight ALTER DELETE must not be hidden here: the converted columns
+        /// are written for all physical rows of the part, the same as the columns left untouched.
         BlockInputStreamPtr part_in = std::make_shared<MergeTreeBlockInputStream>(
             *this, part, DEFAULT_MERGE_BLOCK_SIZE, 0, 0, expression->getRequiredColumns(), ranges,
-            false, nullptr, false, 0, DBMS_DEFAULT_BUFFER_SIZE, false);
+            false, nullptr, nullptr, nullptr, false, 0, 0, DBMS_DEFAULT_BUFFER_SIZE, false,
+            /* virt_column_names = */ {}, /* part_index_in_query = */ 0, /* quiet = */ false,
+            /* apply_deleted_mask = */ false);
 
         auto compression_settings = this->context.chooseCompressionSettings(
             part->bytes_on_disk,
@@ -1242,7 +1875,8 @@ MergeTreeData::AlterDataPartTransactionPtr MergeTreeData::alterDataPart(
           */
         IMergedBlockOutputStream::WrittenOffsetColumns unused_written_offsets;
         MergedColumnOnlyOutputStream out(
-            *this, in.getHeader(), full_path + part->name + '/', true /* sync */, compression_settings, true /* skip_offsets */, unused_written_offsets);
+            *this, in.getHeader(), part->getFullPath(), true /* sync */, compression_settings, true /* skip_offsets */, unused_written_offsets,
+            part->index_granularity);
 
         in.readPrefix();
         out.writePrefix();
@@ -1274,7 +1908,7 @@ MergeTreeData::AlterDataPartTransactionPtr MergeTreeData::alterDataPart(
     if (!part->checksums.empty())
     {
         transaction->new_checksums = new_checksums;
-        WriteBufferFromFile checksums_file(full_path + part->name + "/checksums.txt.tmp", 4096);
+        WriteBufferFromFile checksums_file(part->getFullPath() + "checksums.txt.tmp", 4096);
         new_checksums.write(checksums_file);
         transaction->rename_map["checksums.txt.tmp"] = "checksums.txt";
     }
@@ -1282,7 +1916,7 @@ MergeTreeData::AlterDataPartTransactionPtr MergeTreeData::alterDataPart(
     /// Write the new column list to the temporary file.
     {
         transaction->new_columns = new_columns.filter(part->columns.getNames());
-        WriteBufferFromFile columns_file(full_path + part->name + "/columns.txt.tmp", 4096);
+        WriteBufferFromFile columns_file(part->getFullPath() + "columns.txt.tmp", 4096);
         transaction->new_columns.writeText(columns_file);
         transaction->rename_map["columns.txt.tmp"] = "columns.txt";
     }
@@ -1303,7 +1937,7 @@ void MergeTreeData::AlterDataPartTransaction::commit()
     {
         std::unique_lock<std::shared_mutex> lock(data_part->columns_lock);
 
-        String path = data_part->storage.full_path + data_part->name + "/";
+        String path = data_part->base_path + data_part->name + "/";
 
         /// NOTE: checking that a file exists before renaming or deleting it
         /// is justified by the fact that, when converting an ordinary column
@@ -1344,6 +1978,9 @@ void MergeTreeData::AlterDataPartTransaction::commit()
         /// TODO: we can skip resetting caches when the column is added.
         data_part->storage.context.dropCaches();
 
+        /// The data of the part has changed in place, query results computed from it are outdated.
+        data_part->storage.increasePartsSetVersion();
+
         clear();
     }
     catch (...)
@@ -1451,18 +2088,28 @@ MergeTreeData::DataPartsVector MergeTreeData::getActivePartsToReplace(
 }
 
 
-void MergeTreeData::renameTempPartAndAdd(MutableDataPartPtr & part, SimpleIncrement * increment, Transaction * out_transaction)
+bool MergeTreeData::renameTempPartAndAdd(MutableDataPartPtr & part, SimpleIncrement * increment, Transaction * out_transaction,
+    MergeTreeDeduplicationLog * deduplication_log, const String & block_id)
 {
-    auto removed = renameTempPartAndReplace(part, increment, out_transaction);
-    if (!removed.empty())
-        throw Exception("Added part " + part->name + " covers " + toString(removed.size())
-            + " existing part(s) (including " + removed[0]->name + ")", ErrorCodes::LOGICAL_ERROR);
+    DataPartsVector covered_parts;
+    {
+        auto lock = lockParts();
+        if (!renameTempPartAndReplace(part, increment, out_transaction, lock, &covered_parts, deduplication_log, block_id))
+            return false;
+    }
+
+    if (!covered_parts.empty())
+        throw Exception("Added part " + part->name + " covers " + toString(covered_parts.size())
+            + " existing part(s) (including " + covered_parts[0]->name + ")", ErrorCodes::LOGICAL_ERROR);
+
+    return true;
 }
 
 
-void MergeTreeData::renameTempPartAndReplace(
+bool MergeTreeData::renameTempPartAndReplace(
     MutableDataPartPtr & part, SimpleIncrement * increment, Transaction * out_transaction,
-    std::unique_lock<std::mutex> & lock, DataPartsVector * out_covered_parts)
+    std::unique_lock<std::mutex> & lock, DataPartsVector * out_covered_parts,
+    MergeTreeDeduplicationLog * deduplication_log, const String & block_id)
 {
     if (out_transaction && &out_transaction->data != this)
         throw Exception("MergeTreeData::Transaction for one table cannot be used with another. It is a bug.",
@@ -1470,6 +2117,11 @@ void MergeTreeData::renameTempPartAndReplace(
 
     part->assertState({DataPartState::Temporary});
 
+    /// The check is done under the parts lock taken by the caller: a concurrent insert of the same
+    ///  block either has already committed its part together with the id, or has not started yet.
+    if (deduplication_log && deduplication_log->containsBlockId(block_id))
+        return false;
+
     MergeTreePartInfo part_info = part->info;
     String part_name;
 
@@ -1512,7 +2164,7 @@ void MergeTreeData::renameTempPartAndReplace(
     if (covering_part)
     {
         LOG_WARNING(log, "Tried to add obsolete part " << part_name << " covered by " << covering_part->getNameWithState());
-        return;
+        return true;
     }
 
     /// All checks are passed. Now we can rename the part on disk.
@@ -1543,6 +2195,18 @@ void MergeTreeData::renameTempPartAndReplace(
 
         modifyPartState(part_it, DataPartState::Committed);
         addPartContributionToColumnSizes(part);
+
+        /// An in-memory part must be restorable from the write-ahead log before its block id
+        ///  is recorded below, for the same reason the id is recorded only after the commit.
+        if (part->is_in_memory)
+            getWriteAheadLog()->addPart(part->in_memory_block, part->name);
+
+        /// Record the block id only now, when the part is committed and durable. Recorded earlier,
+        ///  a crash in between would persist the id without the data, and the client's retry of
+        ///  the insert - the scenario deduplication exists for - would be swallowed as a duplicate.
+        ///  With this order a crash errs toward a duplicate insert instead of a lost one.
+        if (deduplication_log)
+            deduplication_log->addBlockId(block_id);
     }
 
     if (out_covered_parts)
@@ -1550,6 +2214,8 @@ void MergeTreeData::renameTempPartAndReplace(
         for (DataPartPtr & covered_part : covered_parts)
             out_covered_parts->emplace_back(std::move(covered_part));
     }
+
+    return true;
 }
 
 MergeTreeData::DataPartsVector MergeTreeData::renameTempPartAndReplace(
@@ -1807,6 +2473,13 @@ void MergeTreeData::tryRemovePartImmediately(DataPartPtr && part)
 }
 
 
+UInt64 MergeTreeData::allocatePartsSetVersion()
+{
+    static std::atomic<UInt64> counter {0};
+    return ++counter;
+}
+
+
 size_t MergeTreeData::getTotalActiveSizeInBytes() const
 {
     size_t res = 0;
@@ -1821,6 +2494,38 @@ size_t MergeTreeData::getTotalActiveSizeInBytes() const
 }
 
 
+size_t MergeTreeData::getTotalActiveRows() const
+{
+    size_t res = 0;
+    {
+        std::lock_guard<std::mutex> lock(data_parts_mutex);
+
+        for (auto & part : getDataPartsStateRange(DataPartState::Committed))
+            res += part->rows_count;
+    }
+
+    return res;
+}
+
+
+MergeTreePartColumnStatistics MergeTreeData::getAggregatedColumnStatistics() const
+{
+    MergeTreePartColumnStatistics res;
+
+    /// Do not hold data_parts_mutex while reading the files.
+    DataPartsVector parts = getDataPartsVector();
+
+    for (const auto & part : parts)
+    {
+        MergeTreePartColumnStatistics part_statistics;
+        if (part->loadColumnStatistics(part_statistics))
+            res.merge(part_statistics);
+    }
+
+    return res;
+}
+
+
 size_t MergeTreeData::getMaxPartsCountForPartition() const
 {
     std::lock_guard<std::mutex> lock(data_parts_mutex);
@@ -1863,20 +2568,25 @@ std::optional<Int64> MergeTreeData::getMinPartDataVersion() const
 }
 
 
-void MergeTreeData::delayInsertOrThrowIfNeeded(Poco::Event *until) const
+void MergeTreeData::delayInsertOrThrowIfNeeded(Poco::Event *until,
+    UInt64 parts_to_delay_insert_override, UInt64 parts_to_throw_insert_override) const
 {
+    const size_t parts_to_delay_insert = parts_to_delay_insert_override ? parts_to_delay_insert_override : settings.parts_to_delay_insert;
+    const size_t parts_to_throw_insert = parts_to_throw_insert_override ? parts_to_throw_insert_override : settings.parts_to_throw_insert;
+
     const size_t parts_count = getMaxPartsCountForPartition();
-    if (parts_count < settings.parts_to_delay_insert)
+    if (parts_count < parts_to_delay_insert)
         return;
 
-    if (parts_count >= settings.parts_to_throw_insert)
+    if (parts_count >= parts_to_throw_insert)
     {
         ProfileEvents::increment(ProfileEvents::RejectedInserts);
         throw Exception("Too many parts (" + toString(parts_count) + "). Merges are processing significantly slower than inserts.", ErrorCodes::TOO_MANY_PARTS);
     }
 
-    const size_t max_k = settings.parts_to_throw_insert - settings.parts_to_delay_insert; /// always > 0
-    const size_t k = 1 + parts_count - settings.parts_to_delay_insert; /// from 1 to max_k
+    /// Both differences are positive: parts_to_delay_insert <= parts_count < parts_to_throw_insert here.
+    const size_t max_k = parts_to_throw_insert - parts_to_delay_insert;
+    const size_t k = 1 + parts_count - parts_to_delay_insert; /// from 1 to max_k
     const double delay_milliseconds = ::pow(settings.max_delay_to_insert * 1000, static_cast<double>(k) / max_k);
 
     ProfileEvents::increment(ProfileEvents::DelayedInserts);
@@ -1893,11 +2603,13 @@ void MergeTreeData::delayInsertOrThrowIfNeeded(Poco::Event *until) const
         std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<size_t>(delay_milliseconds)));
 }
 
-void MergeTreeData::throwInsertIfNeeded() const
+void MergeTreeData::throwInsertIfNeeded(UInt64 parts_to_throw_insert_override) const
 {
+    const size_t parts_to_throw_insert = parts_to_throw_insert_override ? parts_to_throw_insert_override : settings.parts_to_throw_insert;
+
     const size_t parts_count = getMaxPartsCountForPartition();
 
-    if (parts_count >= settings.parts_to_throw_insert)
+    if (parts_count >= parts_to_throw_insert)
     {
         ProfileEvents::increment(ProfileEvents::RejectedInserts);
         throw Exception("Too many parts (" + toString(parts_count) + "). Merges are processing significantly slower than inserts.", ErrorCodes::TOO_MANY_PARTS);
@@ -1994,7 +2706,7 @@ MergeTreeData::MutableDataPartPtr MergeTreeData::loadPartAndFixMetadata(const St
     /// Check the data while we are at it.
     if (part->checksums.empty())
     {
-        part->checksums = checkDataPart(full_part_path, index_granularity, false, primary_key_data_types);
+        part->checksums = checkDataPart(full_part_path, part->index_granularity, false, primary_key_data_types);
 
         {
             WriteBufferFromFile out(full_part_path + "checksums.txt.tmp", 4096);
@@ -2099,19 +2811,22 @@ size_t MergeTreeData::getPartitionSize(const std::string & partition_id) const
 
     Poco::DirectoryIterator end;
 
-    for (Poco::DirectoryIterator it(full_path); it != end; ++it)
+    for (const String & path : getDataPaths())
     {
-        MergeTreePartInfo part_info;
-        if (!MergeTreePartInfo::tryParsePartName(it.name(), &part_info, format_version))
-            continue;
-        if (part_info.partition_id != partition_id)
-            continue;
-
-        const auto part_path = it.path().absolute().toString();
-        for (Poco::DirectoryIterator it2(part_path); it2 != end; ++it2)
+        for (Poco::DirectoryIterator it(path); it != end; ++it)
         {
-            const auto part_file_path = it2.path().absolute().toString();
-            size += Poco::File(part_file_path).getSize();
+            MergeTreePartInfo part_info;
+            if (!MergeTreePartInfo::tryParsePartName(it.name(), &part_info, format_version))
+                continue;
+            if (part_info.partition_id != partition_id)
+                continue;
+
+            const auto part_path = it.path().absolute().toString();
+            for (Poco::DirectoryIterator it2(part_path); it2 != end; ++it2)
+            {
+                const auto part_file_path = it2.path().absolute().toString();
+                size += Poco::File(part_file_path).getSize();
+            }
         }
     }
 
@@ -2413,7 +3128,8 @@ MergeTreeData::MutableDataPartPtr MergeTreeData::cloneAndLoadDataPart(const Merg
     String dst_part_name = src_part->getNewName(dst_part_info);
     String tmp_dst_part_name = tmp_part_prefix + dst_part_name;
 
-    Poco::Path dst_part_absolute_path = Poco::Path(full_path + tmp_dst_part_name).absolute();
+    /// The clone is hard-linked from the source part, so it must be on the same volume.
+    Poco::Path dst_part_absolute_path = Poco::Path(src_part->base_path + tmp_dst_part_name).absolute();
     Poco::Path src_part_absolute_path = Poco::Path(src_part->getFullPath()).absolute();
 
     if (Poco::File(dst_part_absolute_path).exists())
@@ -2423,6 +3139,7 @@ MergeTreeData::MutableDataPartPtr MergeTreeData::cloneAndLoadDataPart(const Merg
     localBackup(src_part_absolute_path, dst_part_absolute_path);
 
     MergeTreeData::MutableDataPartPtr dst_data_part = std::make_shared<MergeTreeData::DataPart>(*this, dst_part_name, dst_part_info);
+    dst_data_part->base_path = src_part->base_path;
     dst_data_part->relative_path = tmp_dst_part_name;
     dst_data_part->is_temp = true;
 
@@ -2431,16 +3148,25 @@ MergeTreeData::MutableDataPartPtr MergeTreeData::cloneAndLoadDataPart(const Merg
     return dst_data_part;
 }
 
+std::shared_ptr<MergeTreeWriteAheadLog> MergeTreeData::getWriteAheadLog()
+{
+    std::lock_guard<std::mutex> lock(write_ahead_log_mutex);
+
+    if (!write_ahead_log)
+        write_ahead_log = std::make_shared<MergeTreeWriteAheadLog>(*this);
+
+    return write_ahead_log;
+}
+
 void MergeTreeData::freezePartitionsByMatcher(MatcherFn matcher, const String & with_name, const Context & context)
 {
     String clickhouse_path = Poco::Path(context.getPath()).makeAbsolute().toString();
     String shadow_path = clickhouse_path + "shadow/";
     Poco::File(shadow_path).createDirectories();
-    String backup_path = shadow_path
-        + (!with_name.empty()
-            ? escapeForFileName(with_name)
-            : toString(Increment(shadow_path + "increment.txt").get(true)))
-        + "/";
+    String backup_name = (!with_name.empty()
+        ? escapeForFileName(with_name)
+        : toString(Increment(shadow_path + "increment.txt").get(true)));
+    String backup_path = shadow_path + backup_name + "/";
 
     LOG_DEBUG(log, "Snapshot will be placed at " + backup_path);
 
@@ -2456,11 +3182,23 @@ void MergeTreeData::freezePartitionsByMatcher(MatcherFn matcher, const String &
         LOG_DEBUG(log, "Freezing part " << part->name);
 
         String part_absolute_path = Poco::Path(part->getFullPath()).absolute().toString();
+
+        String part_root = clickhouse_path;
+        String part_backup_root = backup_path;
         if (!startsWith(part_absolute_path, clickhouse_path))
-            throw Exception("Part path " + part_absolute_path + " is not inside " + clickhouse_path, ErrorCodes::LOGICAL_ERROR);
+        {
+            /// The part is on another volume of the storage policy. Its backup is hard-linked,
+            /// so it goes into the shadow directory of the same disk.
+            String base_absolute_path = Poco::Path(part->base_path).absolute().toString();
+            if (relative_data_path.empty() || !endsWith(base_absolute_path, relative_data_path))
+                throw Exception("Part path " + part_absolute_path + " is not inside " + clickhouse_path, ErrorCodes::LOGICAL_ERROR);
+
+            part_root = base_absolute_path.substr(0, base_absolute_path.size() - relative_data_path.size());
+            part_backup_root = part_root + "shadow/" + backup_name + "/";
+        }
 
         String backup_part_absolute_path = part_absolute_path;
-        backup_part_absolute_path.replace(0, clickhouse_path.size(), backup_path);
+        backup_part_absolute_path.replace(0, part_root.size(), part_backup_root);
         localBackup(part_absolute_path, backup_part_absolute_path);
         ++parts_processed;
     }
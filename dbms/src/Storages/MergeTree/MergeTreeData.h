@@ -6,10 +6,14 @@
 #include <Storages/ITableDeclaration.h>
 #include <Storages/AlterCommands.h>
 #include <Storages/MergeTree/MergeTreePartInfo.h>
+#include <Storages/MergeTree/MergeTreeColumnStatistics.h>
 #include <Storages/MergeTree/MergeTreeSettings.h>
+#include <Storages/MergeTree/MergeTreeStoragePolicy.h>
+#include <Storages/MergeTree/DiskSpaceMonitor.h>
 #include <IO/ReadBufferFromString.h>
 #include <IO/WriteBufferFromFile.h>
 #include <IO/ReadBufferFromFile.h>
+#include <IO/CompressionSettings.h>
 #include <DataTypes/DataTypeString.h>
 #include <DataTypes/DataTypesNumber.h>
 #include <DataStreams/GraphiteRollupSortedBlockInputStream.h>
@@ -38,6 +42,10 @@ namespace ErrorCodes
 }
 
 
+class MergeTreeWriteAheadLog;
+class MergeTreeDeduplicationLog;
+
+
 /// Data structure for *MergeTree engines.
 /// Merge tree is used for incremental sorting of data.
 /// The table consists of several sorted parts.
@@ -298,6 +306,7 @@ public:
                   const String & date_column_name,
                   const ASTPtr & partition_expr_ast_,
                   const ASTPtr & sampling_expression_, /// nullptr, if sampling is not supported.
+                  const ASTPtr & ttl_table_ast_, /// nullptr, if the table has no TTL.
                   const MergingParams & merging_params_,
                   const MergeTreeSettings & settings_,
                   bool require_part_metadata_,
@@ -352,6 +361,22 @@ public:
 
     String getFullPath() const { return full_path; }
 
+    /// All directories where parts of the table can be stored: the table's own data directory first,
+    /// then the per-volume directories of the storage policy (if any).
+    Strings getDataPaths() const;
+
+    /// Reserves space for a new part on the first (hottest) volume that can accommodate it.
+    /// Without a storage policy reserves in the table's own data directory.
+    DiskSpaceMonitor::ReservationPtr reserveSpaceForPart(size_t size) const;
+
+    /// Maximum of the unreserved free space over all volumes of the table.
+    size_t getMaxUnreservedFreeSpace() const;
+
+    /// If some volume ran out of space or contains parts that are old enough, moves one part to the
+    /// next (colder) volume of the storage policy. Called from the background processing pool.
+    /// Returns true if a part was moved.
+    bool moveSomePartToAnotherVolume();
+
     String getLogName() const { return log_name; }
 
     /// Returns a copy of the list so that the caller shouldn't worry about locks.
@@ -382,6 +407,20 @@ public:
     /// Total size of active parts in bytes.
     size_t getTotalActiveSizeInBytes() const;
 
+    /// Total number of rows in active parts.
+    size_t getTotalActiveRows() const;
+
+    /// Per-column statistics combined over all committed parts (see MergeTreeColumnStatistics.h).
+    /// Reads statistics.txt of every part, so the result should not be requested per query
+    /// without caching. Parts without the file contribute nothing.
+    MergeTreePartColumnStatistics getAggregatedColumnStatistics() const;
+
+    /// Version of the set of data parts. It changes whenever parts are added, removed or altered.
+    /// Values are unique within the server process, so a version of a dropped and re-created table
+    /// can never be mistaken for a version of the old one.
+    /// Used by the query result cache to invalidate results computed from older data.
+    UInt64 getPartsSetVersion() const { return parts_set_version.load(std::memory_order_relaxed); }
+
     size_t getMaxPartsCountForPartition() const;
 
     /// Get min value of part->info.getDataVersion() for all active parts.
@@ -390,8 +429,10 @@ public:
 
     /// If the table contains too many active parts, sleep for a while to give them time to merge.
     /// If until is non-null, wake up from the sleep earlier if the event happened.
-    void delayInsertOrThrowIfNeeded(Poco::Event * until = nullptr) const;
-    void throwInsertIfNeeded() const;
+    /// The query may override the per-table thresholds through its SETTINGS clause (0 - use the table setting).
+    void delayInsertOrThrowIfNeeded(Poco::Event * until = nullptr,
+        UInt64 parts_to_delay_insert_override = 0, UInt64 parts_to_throw_insert_override = 0) const;
+    void throwInsertIfNeeded(UInt64 parts_to_throw_insert_override = 0) const;
 
     /// Renames temporary part to a permanent part and adds it to the parts set.
     /// It is assumed that the part does not intersect with existing parts.
@@ -399,7 +440,12 @@ public:
     /// If out_transaction != nullptr, adds the part in the PreCommitted state (the part will be added to the
     /// active set later with out_transaction->commit()).
     /// Else, commits the part immediately.
-    void renameTempPartAndAdd(MutableDataPartPtr & part, SimpleIncrement * increment = nullptr, Transaction * out_transaction = nullptr);
+    /// If deduplication_log != nullptr, the part is added only if `block_id` is not in the deduplication
+    /// window; returns false if the part was discarded as a duplicate. The duplicate check, the commit
+    /// of the part and the recording of the id are done under the same parts lock, with the id recorded
+    /// last, so after a crash the insert can be duplicated but is never lost.
+    bool renameTempPartAndAdd(MutableDataPartPtr & part, SimpleIncrement * increment = nullptr, Transaction * out_transaction = nullptr,
+        MergeTreeDeduplicationLog * deduplication_log = nullptr, const String & block_id = {});
 
     /// The same as renameTempPartAndAdd but the block range of the part can contain existing parts.
     /// Returns all parts covered by the added part (in ascending order).
@@ -408,9 +454,11 @@ public:
         MutableDataPartPtr & part, SimpleIncrement * increment = nullptr, Transaction * out_transaction = nullptr);
 
     /// Low-level version of previous one, doesn't lock mutex
-    void renameTempPartAndReplace(
+    /// Returns false only if the part was discarded as a duplicate by the deduplication log.
+    bool renameTempPartAndReplace(
             MutableDataPartPtr & part, SimpleIncrement * increment, Transaction * out_transaction, DataPartsLock & lock,
-            DataPartsVector * out_covered_parts = nullptr);
+            DataPartsVector * out_covered_parts = nullptr,
+            MergeTreeDeduplicationLog * deduplication_log = nullptr, const String & block_id = {});
 
     /// Removes parts from the working set parts.
     /// Parts in add must already be in data_parts with PreCommitted, Committed, or Outdated states.
@@ -450,6 +498,33 @@ public:
     /// Delete irrelevant parts from memory and disk.
     void clearOldPartsFromFilesystem();
 
+    /// Load the marks of all active parts into the mark cache, so that the first queries after
+    /// a restart do not stall on synchronous mark loading. Does nothing unless the
+    /// preload_marks_on_startup setting is enabled; meant to be run on the background pool.
+    void preloadMarks();
+
+    /// Progress of background checksum verification (see the scrub_max_bytes_per_second setting).
+    /// Counters are since server start; exposed through the system.scrub_status table.
+    struct ScrubStatus
+    {
+        String last_scrubbed_part;      /// Name of the most recently verified part.
+        UInt64 parts_scrubbed = 0;
+        UInt64 bytes_scrubbed = 0;
+        UInt64 failed_parts = 0;        /// Parts that failed verification.
+        time_t last_scrub_time = 0;     /// When a part was last verified.
+        time_t last_pass_time = 0;      /// When the last full pass over all parts finished.
+    };
+
+    /// Verifies checksums of the next part not yet covered by the current scrub pass, reading at most
+    /// scrub_max_bytes_per_second bytes per second. On corruption calls `on_corruption` (the storage
+    /// decides what to do: a Replicated table re-fetches the part from a healthy replica).
+    /// Returns false if there is nothing to scrub right now; meant to be run on the background pool.
+    bool scrubOneDataPart(
+        const std::function<bool()> & is_cancelled,
+        const std::function<void(const DataPartPtr &)> & on_corruption);
+
+    ScrubStatus getScrubStatus() const;
+
     /// Delete all directories which names begin with "tmp"
     /// Set non-negative parameter value to override MergeTreeSettings temporary_directories_lifetime
     void clearOldTemporaryDirectories(ssize_t custom_directories_lifetime_seconds = -1);
@@ -470,6 +545,13 @@ public:
     /// If something is wrong, throws an exception.
     void checkAlter(const AlterCommands & commands);
 
+    /// Returns true if switching the table to the new column set requires rewriting, renaming
+    /// or removing files of the existing parts (so alterDataPart must be called for each part).
+    /// If not, the ALTER is a pure metadata change: parts keep the columns they were created
+    /// with and readers fill in the missing columns with default values
+    /// (see MergeTreeReader::fillMissingColumns).
+    bool alterRequiresPartUpdates(const NamesAndTypesList & new_columns) const;
+
     /// Performs ALTER of the data part, writes the result to temporary files.
     /// Returns an object allowing to rename temporary files to permanent files.
     /// If the number of affected columns is suspiciously high and skip_sanity_checks is false, throws an exception.
@@ -540,6 +622,9 @@ public:
     MergeTreeData::MutableDataPartPtr cloneAndLoadDataPart(const MergeTreeData::DataPartPtr & src_part, const String & tmp_part_prefix,
                                                            const MergeTreePartInfo & dst_part_info);
 
+    /// Returns the write-ahead log for in-memory parts (see min_bytes_for_on_disk_part), creating it on first use.
+    std::shared_ptr<MergeTreeWriteAheadLog> getWriteAheadLog();
+
     MergeTreeDataFormatVersion format_version;
 
     Context & context;
@@ -560,11 +645,42 @@ public:
     ExpressionActionsPtr partition_expr;
     Block partition_key_sample;
 
+    /// TTL clause of the table definition: rows with `ttl_expression <= now()` are removed during
+    /// merges, and whole parts whose maximum TTL value has passed are dropped in the background.
+    ASTPtr ttl_table_ast;
+    ExpressionActionsPtr ttl_expression;
+    String ttl_result_column;
+
+    bool hasTableTTL() const { return ttl_table_ast != nullptr; }
+
     ExpressionActionsPtr minmax_idx_expr;
     Names minmax_idx_columns;
     DataTypes minmax_idx_column_types;
     Int64 minmax_idx_date_column_pos = -1; /// In a common case minmax index includes a date column.
 
+    /// Columns with per-granule min-max skip indices (the `skip_index_minmax_columns` setting).
+    ExpressionActionsPtr skip_minmax_idx_expr;
+    Names skip_minmax_idx_columns;
+    DataTypes skip_minmax_idx_column_types;
+
+    /// String columns with per-granule n-gram bloom filter indices (the `skip_index_ngrambf_columns` setting).
+    Names skip_ngrambf_idx_columns;
+
+    /// The sort key of the projection layout of the parts (the `projection_sort_columns` setting).
+    ExpressionActionsPtr projection_sort_expr;
+    Names projection_sort_columns;
+    DataTypes projection_sort_column_types;
+
+    /// Columns compressed with delta encoding (the `delta_compression_columns` setting).
+    Names delta_compression_columns;
+
+    /// Columns stored in the sparse format when defaults dominate (the `sparse_compression_columns` setting).
+    Names sparse_compression_columns;
+
+    /// Compression settings to use when writing the column, taking per-column methods into account.
+    CompressionSettings getCompressionSettingsForColumn(
+        const String & column_name, const IDataType & type, const CompressionSettings & default_settings) const;
+
     /// Limiting parallel sends per one table, used in DataPartsExchange
     std::atomic_uint current_table_sends {0};
 
@@ -593,9 +709,35 @@ private:
     String table_name;
     String full_path;
 
+    /// Non-null if the storage_policy setting is set. The volumes of the policy (without
+    /// the implicit first one, which is the table's own data directory) are in `volumes`.
+    MergeTreeStoragePolicyPtr storage_policy;
+
+    /// "data/<database>/<table>/" — the suffix that is appended to the root path of every disk
+    /// of the storage policy to get the data directory of the table on it. Empty without a policy.
+    String relative_data_path;
+
+    /// The ordered (hot to cold) volumes where the parts of the table can be stored.
+    /// The first volume is always the table's own data directory.
+    std::vector<MergeTreeStoragePolicy::Volume> volumes;
+
+    /// Copies the part to dest_path and substitutes it in the working set. Returns false
+    /// if the part is no longer in the working set (e.g. was merged away meanwhile).
+    bool movePartToPath(const DataPartPtr & part, const String & dest_path);
+
+    /// Data directories of parts that were moved to another volume. They are kept for a while
+    /// after the move (and removed by clearOldTemporaryDirectories), because queries that were
+    /// started before the move can still read from them.
+    std::vector<std::pair<String, time_t>> dirs_of_moved_parts;
+    std::mutex dirs_of_moved_parts_mutex;
+
     /// Current column sizes in compressed and uncompressed form.
     ColumnSizeByName column_sizes;
 
+    /// Write-ahead log for in-memory parts. Created lazily by getWriteAheadLog().
+    std::shared_ptr<MergeTreeWriteAheadLog> write_ahead_log;
+    std::mutex write_ahead_log_mutex;
+
     /// Engine-specific methods
     BrokenPartCallback broken_part_callback;
 
@@ -666,12 +808,16 @@ private:
     {
         if (!data_parts_by_state_and_info.modify(it, getStateModifier(state)))
             throw Exception("Can't modify " + (*it)->getNameWithState(), ErrorCodes::LOGICAL_ERROR);
+
+        increasePartsSetVersion();
     }
 
     void modifyPartState(DataPartIteratorByInfo it, DataPartState state)
     {
         if (!data_parts_by_state_and_info.modify(data_parts_indexes.project<TagByStateAndInfo>(it), getStateModifier(state)))
             throw Exception("Can't modify " + (*it)->getNameWithState(), ErrorCodes::LOGICAL_ERROR);
+
+        increasePartsSetVersion();
     }
 
     void modifyPartState(const DataPartPtr & part, DataPartState state)
@@ -682,6 +828,23 @@ private:
 
         if (!data_parts_by_state_and_info.modify(data_parts_indexes.project<TagByStateAndInfo>(it), getStateModifier(state)))
             throw Exception("Can't modify " + (*it)->getNameWithState(), ErrorCodes::LOGICAL_ERROR);
+
+        increasePartsSetVersion();
+    }
+
+    /// See getPartsSetVersion(). The version changes on any state transition of any part, which
+    /// over-approximates changes of the visible data - a spurious cache invalidation is harmless.
+    std::atomic<UInt64> parts_set_version { allocatePartsSetVersion() };
+
+    /// Whether preloadMarks() has already been executed (it is meaningful only once, after startup).
+    std::atomic<bool> marks_preloaded {false};
+
+    /// Returns process-wide unique monotonically increasing values.
+    static UInt64 allocatePartsSetVersion();
+
+    void increasePartsSetVersion()
+    {
+        parts_set_version.store(allocatePartsSetVersion(), std::memory_order_relaxed);
     }
 
 
@@ -690,10 +853,25 @@ private:
     /// The same for clearOldTemporaryDirectories.
     std::mutex clear_old_temporary_directories_mutex;
 
+    /// State of background checksum verification. The cursor is the info of the part verified last:
+    /// the next part to scrub is the first committed part greater than it, so the pass survives
+    /// parts appearing and disappearing around it. Protected by scrub_mutex.
+    mutable std::mutex scrub_mutex;
+    ScrubStatus scrub_status;
+    bool scrub_pass_in_progress = false;
+    MergeTreePartInfo scrub_cursor;
+    ThrottlerPtr scrub_throttler;
+
     void initPrimaryKey();
 
     void initPartitionKey();
 
+    void initSkipIndices();
+
+    void initProjection();
+
+    void initTTL();
+
     /// Expression for column type conversion.
     /// If no conversions are needed, out_expression=nullptr.
     /// out_rename_map maps column files for the out_expression onto new table files.
@@ -3,6 +3,7 @@
 #include <Storages/MergeTree/MergedBlockOutputStream.h>
 #include <Storages/MergeTree/DiskSpaceMonitor.h>
 #include <Storages/MergeTree/SimpleMergeSelector.h>
+#include <Storages/MergeTree/DebtAwareMergeSelector.h>
 #include <Storages/MergeTree/AllMergeSelector.h>
 #include <Storages/MergeTree/MergeList.h>
 #include <Storages/MergeTree/StorageFromMergeTreeDataPart.h>
@@ -19,9 +20,19 @@
 #include <DataStreams/MaterializingBlockInputStream.h>
 #include <DataStreams/ConcatBlockInputStream.h>
 #include <DataStreams/ColumnGathererStream.h>
+#include <DataStreams/TTLBlockInputStream.h>
 #include <Interpreters/MutationsInterpreter.h>
+#include <Parsers/ASTExpressionList.h>
+#include <Parsers/ASTFunction.h>
+#include <Parsers/ASTSelectQuery.h>
+#include <Columns/ColumnsCommon.h>
+#include <Columns/FilterDescription.h>
+#include <DataTypes/DataTypeArray.h>
+#include <DataTypes/NestedUtils.h>
+#include <Common/StringUtils/StringUtils.h>
 #include <IO/CompressedWriteBuffer.h>
 #include <IO/CompressedReadBufferFromFile.h>
+#include <IO/ReadBufferFromFile.h>
 #include <Common/SimpleIncrement.h>
 #include <Common/interpolate.h>
 #include <Common/typeid_cast.h>
@@ -31,6 +42,7 @@
 #include <Poco/File.h>
 #include <Poco/DirectoryIterator.h>
 
+#include <algorithm>
 #include <cmath>
 #include <numeric>
 #include <iomanip>
@@ -152,7 +164,7 @@ size_t MergeTreeDataMergerMutator::getMaxSourcePartsSize(size_t pool_size, size_
             data.settings.max_bytes_to_merge_at_max_space_in_pool,
             static_cast<double>(free_entries) / data.settings.number_of_free_entries_in_pool_to_lower_max_size_of_merge);
 
-    return std::min(max_size, static_cast<size_t>(DiskSpaceMonitor::getUnreservedFreeSpace(data.full_path) / DISK_USAGE_COEFFICIENT_TO_SELECT));
+    return std::min(max_size, static_cast<size_t>(data.getMaxUnreservedFreeSpace() / DISK_USAGE_COEFFICIENT_TO_SELECT));
 }
 
 
@@ -207,13 +219,32 @@ bool MergeTreeDataMergerMutator::selectPartsToMerge(
     }
 
     std::unique_ptr<IMergeSelector> merge_selector;
+    DebtAwareMergeSelector * debt_aware_selector = nullptr;
 
-    SimpleMergeSelector::Settings merge_settings;
-    if (aggressive)
-        merge_settings.base = 1;
+    /// OPTIMIZE queries must merge regardless of the part-count debt, so they keep the usual selector.
+    if (data.settings.use_debt_aware_merge_selector && !aggressive)
+    {
+        DebtAwareMergeSelector::Settings merge_settings;
+        merge_settings.parts_to_keep = data.settings.merge_selector_parts_to_keep;
 
-    /// NOTE Could allow selection of different merge strategy.
-    merge_selector = std::make_unique<SimpleMergeSelector>(merge_settings);
+        auto selector = std::make_unique<DebtAwareMergeSelector>(merge_settings);
+        debt_aware_selector = selector.get();
+        merge_selector = std::move(selector);
+    }
+    else
+    {
+        SimpleMergeSelector::Settings merge_settings;
+        if (aggressive)
+            merge_settings.base = 1;
+        /// A maintained summary should be folded soon after parts with fresh aggregation states
+        ///  arrive, so that reads see as few uncollapsed rows as possible - but not after every
+        ///  insert, which would rewrite the summary part over and over.
+        else if (data.merging_params.mode == MergeTreeData::MergingParams::Aggregating
+            && data.settings.maintain_aggregating_summary)
+            merge_settings.base = 2;
+
+        merge_selector = std::make_unique<SimpleMergeSelector>(merge_settings);
+    }
 
     IMergeSelector::PartsInPartition parts_to_merge = merge_selector->select(
         partitions,
@@ -221,6 +252,12 @@ bool MergeTreeDataMergerMutator::selectPartsToMerge(
 
     if (parts_to_merge.empty())
     {
+        /// Nothing to merge - a good moment to rewrite an old part with a heavier compression method.
+        /// OPTIMIZE queries should not be spent on recompression, so 'aggressive' skips it.
+        if (!aggressive && data.settings.recompress_parts_after_age_seconds.totalSeconds()
+            && selectPartToRecompress(future_part, data_parts, can_merge_callback, current_time))
+            return true;
+
         if (out_disable_reason)
             *out_disable_reason = "There are no need to merge parts according to merge selector algorithm";
         return false;
@@ -239,6 +276,88 @@ bool MergeTreeDataMergerMutator::selectPartsToMerge(
 
     LOG_DEBUG(log, "Selected " << parts.size() << " parts from " << parts.front()->name << " to " << parts.back()->name);
     future_part.assign(std::move(parts));
+
+    if (debt_aware_selector)
+        future_part.selection_decision = debt_aware_selector->getLastDecision();
+
+    return true;
+}
+
+
+std::optional<CompressionMethod> MergeTreeDataMergerMutator::detectPartCompressionMethod(const MergeTreeDataPart & part)
+{
+    /// Every .bin file starts with a compressed block: a checksum, then the method byte.
+    for (const auto & file : part.checksums.files)
+    {
+        if (!endsWith(file.first, ".bin") || file.second.file_size < COMPRESSED_BLOCK_CHECKSUM_SIZE + 1)
+            continue;
+
+        ReadBufferFromFile in(part.getFullPath() + file.first, COMPRESSED_BLOCK_CHECKSUM_SIZE + 1);
+        in.ignore(COMPRESSED_BLOCK_CHECKSUM_SIZE);
+        UInt8 method_byte = 0;
+        in.readStrict(reinterpret_cast<char *>(&method_byte), 1);
+
+        if (method_byte == static_cast<UInt8>(CompressionMethodByte::LZ4))
+            return CompressionMethod::LZ4;
+        if (method_byte == static_cast<UInt8>(CompressionMethodByte::ZSTD))
+            return CompressionMethod::ZSTD;
+        if (method_byte == static_cast<UInt8>(CompressionMethodByte::NONE))
+            return CompressionMethod::NONE;
+
+        /// Delta and Sparse are per-column encodings chosen by the data, not the part-level
+        ///  method from the config - look at the next column.
+    }
+
+    return {};
+}
+
+
+bool MergeTreeDataMergerMutator::selectPartToRecompress(
+    FuturePart & future_part,
+    const MergeTreeData::DataPartsVector & data_parts,
+    const AllowedMergingPredicate & can_merge,
+    time_t current_time)
+{
+    time_t min_age = data.settings.recompress_parts_after_age_seconds.totalSeconds();
+    size_t total_size = data.getTotalActiveSizeInBytes();
+
+    MergeTreeData::DataPartPtr best;
+    time_t best_age = 0;
+
+    for (const MergeTreeData::DataPartPtr & part : data_parts)
+    {
+        time_t age = current_time - part->modification_time;
+        if (age < min_age || age <= best_age)
+            continue;
+
+        /// For the single part, check that it can be merged "with itself" (as OPTIMIZE FINAL does).
+        if (!can_merge(part, part, nullptr))
+            continue;
+
+        auto desired = data.context.chooseCompressionSettings(
+            part->bytes_on_disk, static_cast<double>(part->bytes_on_disk) / total_size, age);
+
+        /// The method byte does not distinguish LZ4 from LZ4HC.
+        CompressionMethod desired_method = desired.method == CompressionMethod::LZ4HC
+            ? CompressionMethod::LZ4 : desired.method;
+
+        /// A part that is already compressed as desired is not rewritten: the result of a
+        ///  recompression gets a fresh modification_time, so without this check every part
+        ///  would be rewritten again as soon as it ages past the threshold.
+        /// (A change of the compression level alone is invisible here and does not trigger a rewrite.)
+        if (detectPartCompressionMethod(*part) == desired_method)
+            continue;
+
+        best = part;
+        best_age = age;
+    }
+
+    if (!best)
+        return false;
+
+    LOG_DEBUG(log, "Selected part " << best->name << " for recompression, age " << best_age << " sec.");
+    future_part.assign({best});
+    future_part.selection_decision = "recompressing aged part";
     return true;
 }
 
@@ -360,12 +479,41 @@ static void extractMergingAndGatheringColumns(const NamesAndTypesList & all_colu
     if (merging_params.mode == MergeTreeData::MergingParams::VersionedCollapsing)
         key_columns.emplace(merging_params.sign_column);
 
+    /// Force columns that SummingSortedBlockInputStream will modify, replicating its column selection:
+    /// explicitly listed columns (or all summable ones if the list is empty) and candidate nested Maps.
+    /// The remaining columns keep the value of the first row of a group and can be gathered.
+    if (merging_params.mode == MergeTreeData::MergingParams::Summing)
+    {
+        for (const auto & column : all_columns)
+        {
+            if (typeid_cast<const DataTypeArray *>(column.type.get()))
+            {
+                const auto map_name = Nested::extractTableName(column.name);
+                if (map_name != column.name && endsWith(map_name, "Map"))
+                    key_columns.emplace(column.name);
+            }
+            else if (column.type->isSummable() || WhichDataType(column.type).isAggregateFunction())
+            {
+                if (merging_params.columns_to_sum.empty()
+                    || merging_params.columns_to_sum.end() !=
+                        std::find(merging_params.columns_to_sum.begin(), merging_params.columns_to_sum.end(), column.name))
+                    key_columns.emplace(column.name);
+            }
+        }
+    }
+
+    /// Force columns with states of aggregate functions for Aggregating mode: they are merged, not gathered.
+    if (merging_params.mode == MergeTreeData::MergingParams::Aggregating)
+    {
+        for (const auto & column : all_columns)
+            if (WhichDataType(column.type).isAggregateFunction())
+                key_columns.emplace(column.name);
+    }
+
     /// Force to merge at least one column in case of empty key
     if (key_columns.empty())
         key_columns.emplace(all_columns.front().name);
 
-    /// TODO: also force "summing" and "aggregating" columns to make Horizontal merge only for such columns
-
     for (auto & column : all_columns)
     {
         auto it = std::find(key_columns.cbegin(), key_columns.cend(), column.name);
@@ -532,7 +680,13 @@ MergeTreeData::MutableDataPartPtr MergeTreeDataMergerMutator::mergePartsToTempor
               << parts.front()->name << " to " << parts.back()->name
               << " into " << TMP_PREFIX + future_part.name);
 
-    String new_part_tmp_path = data.getFullPath() + TMP_PREFIX + future_part.name + "/";
+    /// The merged part is written where the space for it was reserved: to the volume
+    /// of the storage policy that had enough free headroom (see reserveSpaceForPart).
+    String new_part_base_path = data.getFullPath();
+    if (disk_reservation && !disk_reservation->getPath().empty())
+        new_part_base_path = disk_reservation->getPath();
+
+    String new_part_tmp_path = new_part_base_path + TMP_PREFIX + future_part.name + "/";
     if (Poco::File(new_part_tmp_path).exists())
         throw Exception("Directory " + new_part_tmp_path + " already exists", ErrorCodes::DIRECTORY_ALREADY_EXISTS);
 
@@ -561,12 +715,23 @@ MergeTreeData::MutableDataPartPtr MergeTreeDataMergerMutator::mergePartsToTempor
     MergeTreeData::MutableDataPartPtr new_data_part = std::make_shared<MergeTreeData::DataPart>(
             data, future_part.name, future_part.part_info);
     new_data_part->partition.assign(future_part.getPartition());
+    new_data_part->base_path = new_part_base_path;
     new_data_part->relative_path = TMP_PREFIX + future_part.name;
     new_data_part->is_temp = true;
 
     size_t sum_input_rows_upper_bound = merge_entry->total_size_marks * data.index_granularity;
 
-    MergeAlgorithm merge_alg = chooseMergeAlgorithm(data, parts, sum_input_rows_upper_bound, gathering_columns, deduplicate);
+    /// Rows with the TTL expression value in the past are removed by filtering the merged stream.
+    /// Parts written before the TTL clause was added to the table do not store ttl.txt (ttl_min = 0)
+    /// and are filtered unconditionally.
+    bool need_remove_expired_values = false;
+    if (data.hasTableTTL())
+        for (const auto & part : parts)
+            if (part->ttl_min == 0 || part->ttl_min <= time_of_merge)
+                need_remove_expired_values = true;
+
+    MergeAlgorithm merge_alg = chooseMergeAlgorithm(
+        data, parts, sum_input_rows_upper_bound, gathering_columns, deduplicate, need_remove_expired_values);
 
     LOG_DEBUG(log, "Selected MergeAlgorithm: " << ((merge_alg == MergeAlgorithm::Vertical) ? "Vertical" : "Horizontal"));
 
@@ -575,9 +740,15 @@ MergeTreeData::MutableDataPartPtr MergeTreeDataMergerMutator::mergePartsToTempor
     /// (which is locked in shared mode when input streams are created) and when inserting new data
     /// the order is reverse. This annoys TSan even though one lock is locked in shared mode and thus
     /// deadlock is impossible.
+    /// The merged part is only as old as its freshest source part.
+    time_t part_min_age = std::numeric_limits<time_t>::max();
+    for (const auto & part : parts)
+        part_min_age = std::min(part_min_age, std::max<time_t>(0, time_of_merge - part->modification_time));
+
     auto compression_settings = data.context.chooseCompressionSettings(
         merge_entry->total_size_bytes_compressed,
-        static_cast<double> (merge_entry->total_size_bytes_compressed) / data.getTotalActiveSizeInBytes());
+        static_cast<double> (merge_entry->total_size_bytes_compressed) / data.getTotalActiveSizeInBytes(),
+        part_min_age);
 
     String rows_sources_file_path;
     std::unique_ptr<WriteBuffer> rows_sources_uncompressed_write_buf;
@@ -631,7 +802,7 @@ MergeTreeData::MutableDataPartPtr MergeTreeDataMergerMutator::mergePartsToTempor
     {
         auto input = std::make_unique<MergeTreeBlockInputStream>(
             data, part, DEFAULT_MERGE_BLOCK_SIZE, 0, 0, merging_column_names, MarkRanges(1, MarkRange(0, part->marks_count)),
-            false, nullptr, true, min_bytes_when_use_direct_io, DBMS_DEFAULT_BUFFER_SIZE, false);
+            false, nullptr, nullptr, nullptr, true, min_bytes_when_use_direct_io, 0, DBMS_DEFAULT_BUFFER_SIZE, false);
 
         input->setProgressCallback(MergeProgressCallback(
                 merge_entry, sum_input_rows_upper_bound, column_sizes, watch_prev_elapsed, merge_alg));
@@ -671,12 +842,12 @@ MergeTreeData::MutableDataPartPtr MergeTreeDataMergerMutator::mergePartsToTempor
 
         case MergeTreeData::MergingParams::Summing:
             merged_stream = std::make_unique<SummingSortedBlockInputStream>(
-                src_streams, sort_description, data.merging_params.columns_to_sum, DEFAULT_MERGE_BLOCK_SIZE);
+                src_streams, sort_description, data.merging_params.columns_to_sum, DEFAULT_MERGE_BLOCK_SIZE, rows_sources_write_buf.get());
             break;
 
         case MergeTreeData::MergingParams::Aggregating:
             merged_stream = std::make_unique<AggregatingSortedBlockInputStream>(
-                src_streams, sort_description, DEFAULT_MERGE_BLOCK_SIZE);
+                src_streams, sort_description, DEFAULT_MERGE_BLOCK_SIZE, rows_sources_write_buf.get());
             break;
 
         case MergeTreeData::MergingParams::Replacing:
@@ -702,6 +873,9 @@ MergeTreeData::MutableDataPartPtr MergeTreeDataMergerMutator::mergePartsToTempor
     if (deduplicate)
         merged_stream = std::make_shared<DistinctSortedBlockInputStream>(merged_stream, SizeLimits(), 0 /*limit_hint*/, Names());
 
+    if (need_remove_expired_values)
+        merged_stream = std::make_shared<TTLBlockInputStream>(merged_stream, data.ttl_expression, data.ttl_result_column, time_of_merge);
+
     MergedBlockOutputStream to{
         data, new_part_tmp_path, merging_columns, compression_settings, merged_column_to_size, min_bytes_when_use_direct_io};
 
@@ -755,6 +929,14 @@ MergeTreeData::MutableDataPartPtr MergeTreeDataMergerMutator::mergePartsToTempor
         rows_sources_uncompressed_write_buf->next();
 
         size_t rows_sources_count = rows_sources_write_buf->count();
+
+        /// Rows hidden by lightweight-delete masks are counted as read but are dropped before they
+        /// reach the merging stream, so they get no row source.
+        size_t input_rows_hidden_by_masks = 0;
+        for (const auto & part : parts)
+            input_rows_hidden_by_masks += part->deleted_rows_count;
+        sum_input_rows_exact -= input_rows_hidden_by_masks;
+
         /// In special case, when there is only one source part, and no rows were skipped, we may have
         /// skipped writing rows_sources file. Otherwise rows_sources_count must be equal to the total
         /// number of input rows.
@@ -778,7 +960,7 @@ MergeTreeData::MutableDataPartPtr MergeTreeDataMergerMutator::mergePartsToTempor
             {
                 auto column_part_stream = std::make_shared<MergeTreeBlockInputStream>(
                     data, parts[part_num], DEFAULT_MERGE_BLOCK_SIZE, 0, 0, column_names, MarkRanges{MarkRange(0, parts[part_num]->marks_count)},
-                    false, nullptr, true, min_bytes_when_use_direct_io, DBMS_DEFAULT_BUFFER_SIZE, false, Names{}, 0, true);
+                    false, nullptr, nullptr, nullptr, true, min_bytes_when_use_direct_io, 0, DBMS_DEFAULT_BUFFER_SIZE, false, Names{}, 0, true);
 
                 column_part_stream->setProgressCallback(MergeProgressCallbackVerticalStep(
                         merge_entry, sum_input_rows_exact, column_sizes, column_name, watch_prev_elapsed));
@@ -789,7 +971,8 @@ MergeTreeData::MutableDataPartPtr MergeTreeDataMergerMutator::mergePartsToTempor
             rows_sources_read_buf.seek(0, 0);
             ColumnGathererStream column_gathered_stream(column_name, column_part_streams, rows_sources_read_buf);
             MergedColumnOnlyOutputStream column_to(
-                data, column_gathered_stream.getHeader(), new_part_tmp_path, false, compression_settings, false, written_offset_columns);
+                data, column_gathered_stream.getHeader(), new_part_tmp_path, false, compression_settings, false, written_offset_columns,
+                to.getIndexGranularity());
             size_t column_elems_written = 0;
 
             column_to.writePrefix();
@@ -872,6 +1055,14 @@ MergeTreeData::MutableDataPartPtr MergeTreeDataMergerMutator::mutatePartToTempor
     context_for_reading.getSettingsRef().merge_tree_uniform_read_distribution = 0;
     context_for_reading.getSettingsRef().max_threads = 1;
 
+    /// If the mutation rewrites only some of the columns, they must be written for all physical rows
+    /// of the part, so that they stay aligned with the hard-linked columns and with the mask of rows
+    /// deleted by lightweight ALTER DELETEs (if any). Mutations that contain a DELETE rewrite the
+    /// whole part and read with the mask applied, which also compacts the masked rows away.
+    if (std::none_of(commands.begin(), commands.end(),
+            [](const MutationCommand & command) { return command.type == MutationCommand::DELETE; }))
+        context_for_reading.getSettingsRef().apply_deleted_mask = false;
+
     MutationsInterpreter mutations_interpreter(storage_from_source_part, commands, context_for_reading);
 
     if (!mutations_interpreter.isStorageTouchedByMutations())
@@ -882,8 +1073,17 @@ MergeTreeData::MutableDataPartPtr MergeTreeDataMergerMutator::mutatePartToTempor
     else
         LOG_TRACE(log, "Mutating part " << source_part->name << " to mutation version " << future_part.part_info.mutation);
 
+    /// A mutation consisting only of DELETEs can be applied by writing a mask of deleted rows instead
+    /// of rewriting the part (see the lightweight_deletes setting). In-memory parts have no files to
+    /// hard-link, for them the usual rewrite is cheap enough anyway.
+    if (data.settings.lightweight_deletes && !source_part->is_in_memory
+        && std::all_of(commands.begin(), commands.end(),
+            [](const MutationCommand & command) { return command.type == MutationCommand::DELETE; }))
+        return mutatePartByDeletedMask(future_part, commands, context_for_reading);
+
     MergeTreeData::MutableDataPartPtr new_data_part = std::make_shared<MergeTreeData::DataPart>(
         data, future_part.name, future_part.part_info);
+    new_data_part->base_path = source_part->base_path;     /// The mutated part stays on its volume.
     new_data_part->relative_path = "tmp_mut_" + future_part.name;
     new_data_part->is_temp = true;
 
@@ -896,7 +1096,8 @@ MergeTreeData::MutableDataPartPtr MergeTreeDataMergerMutator::mutatePartToTempor
     /// deadlock is impossible.
     auto compression_settings = context.chooseCompressionSettings(
         source_part->bytes_on_disk,
-        static_cast<double>(source_part->bytes_on_disk) / data.getTotalActiveSizeInBytes());
+        static_cast<double>(source_part->bytes_on_disk) / data.getTotalActiveSizeInBytes(),
+        std::max<time_t>(0, time(nullptr) - source_part->modification_time));
 
     Poco::File(new_part_tmp_path).createDirectories();
 
@@ -966,7 +1167,8 @@ MergeTreeData::MutableDataPartPtr MergeTreeDataMergerMutator::mutatePartToTempor
 
         IMergedBlockOutputStream::WrittenOffsetColumns unused_written_offsets;
         MergedColumnOnlyOutputStream out(
-            data, in_header, new_part_tmp_path, /* sync = */ false, compression_settings, /* skip_offsets = */ false, unused_written_offsets);
+            data, in_header, new_part_tmp_path, /* sync = */ false, compression_settings, /* skip_offsets = */ false, unused_written_offsets,
+            source_part->index_granularity);
 
         in->readPrefix();
         out.writePrefix();
@@ -1005,9 +1207,12 @@ MergeTreeData::MutableDataPartPtr MergeTreeDataMergerMutator::mutatePartToTempor
 
         new_data_part->rows_count = source_part->rows_count;
         new_data_part->marks_count = source_part->marks_count;
-        new_data_part->index = source_part->index;
+        new_data_part->index_granularity = source_part->index_granularity;
+        new_data_part->index = source_part->getIndex();
         new_data_part->partition.assign(source_part->partition);
         new_data_part->minmax_idx = source_part->minmax_idx;
+        new_data_part->ttl_min = source_part->ttl_min;
+        new_data_part->ttl_max = source_part->ttl_max;
         new_data_part->modification_time = time(nullptr);
         new_data_part->bytes_on_disk = MergeTreeData::DataPart::calculateTotalSizeOnDisk(new_data_part->getFullPath());
     }
@@ -1016,19 +1221,161 @@ MergeTreeData::MutableDataPartPtr MergeTreeDataMergerMutator::mutatePartToTempor
 }
 
 
+MergeTreeData::MutableDataPartPtr MergeTreeDataMergerMutator::mutatePartByDeletedMask(
+    const FuturePart & future_part,
+    const std::vector<MutationCommand> & commands,
+    const Context & context)
+{
+    const auto & source_part = future_part.parts[0];
+
+    /// Evaluate `predicate1 OR predicate2 OR ...` for every physical row of the part, in part order
+    /// (the mask must cover the rows that are already hidden by the old mask too).
+    auto context_copy = context;
+    context_copy.getSettingsRef().apply_deleted_mask = false;
+
+    ASTPtr predicate;
+    if (commands.size() == 1)
+        predicate = commands[0].predicate;
+    else
+    {
+        auto coalesced_predicates = std::make_shared<ASTFunction>();
+        coalesced_predicates->name = "or";
+        coalesced_predicates->arguments = std::make_shared<ASTExpressionList>();
+        coalesced_predicates->children.push_back(coalesced_predicates->arguments);
+
+        for (const MutationCommand & command : commands)
+            coalesced_predicates->arguments->children.push_back(command.predicate);
+
+        predicate = std::move(coalesced_predicates);
+    }
+
+    auto select = std::make_shared<ASTSelectQuery>();
+    select->select_expression_list = std::make_shared<ASTExpressionList>();
+    select->children.push_back(select->select_expression_list);
+    select->select_expression_list->children.push_back(predicate);
+
+    InterpreterSelectQuery interpreter_select(
+        select, context_copy, StorageFromMergeTreeDataPart::create(source_part), QueryProcessingStage::Complete);
+    BlockInputStreamPtr in = interpreter_select.execute().in;
+
+    IColumn::Filter deleted(source_part->rows_count);
+    size_t rows_read = 0;
+
+    Block block;
+    while ((block = in->read()))
+    {
+        if (actions_blocker.isCancelled())
+            throw Exception("Cancelled mutating parts", ErrorCodes::ABORTED);
+
+        size_t block_rows = block.rows();
+        if (rows_read + block_rows > deleted.size())
+            break;  /// More rows than in the part; the size check below will fail.
+
+        const ColumnPtr & column = block.getByName(predicate->getColumnName()).column;
+
+        ConstantFilterDescription constant_filter_description(*column);
+        if (constant_filter_description.always_true)
+            memset(&deleted[rows_read], 1, block_rows);
+        else if (constant_filter_description.always_false)
+            memset(&deleted[rows_read], 0, block_rows);
+        else
+        {
+            FilterDescription filter_description(*column);
+            for (size_t i = 0; i < block_rows; ++i)
+                deleted[rows_read + i] = (*filter_description.data)[i] ? 1 : 0;
+        }
+
+        rows_read += block_rows;
+    }
+
+    if (rows_read != source_part->rows_count)
+        throw Exception("While computing the deleted rows mask of part " + source_part->name + ": read "
+            + toString(rows_read) + " rows, but the part has " + toString(source_part->rows_count) + " rows."
+            " This is a bug.", ErrorCodes::LOGICAL_ERROR);
+
+    if (source_part->deleted_mask)
+    {
+        const IColumn::Filter & old_mask = *source_part->deleted_mask;
+        for (size_t i = 0; i < deleted.size(); ++i)
+            deleted[i] |= old_mask[i];
+    }
+
+    MergeTreeData::MutableDataPartPtr new_data_part = std::make_shared<MergeTreeData::DataPart>(
+        data, future_part.name, future_part.part_info);
+    new_data_part->base_path = source_part->base_path;     /// Hard links require the same volume.
+    new_data_part->relative_path = "tmp_mut_" + future_part.name;
+    new_data_part->is_temp = true;
+
+    String new_part_tmp_path = new_data_part->getFullPath();
+    Poco::File(new_part_tmp_path).createDirectories();
+
+    /// Hard-link all files of the source part except the ones that are rewritten.
+    NameSet files_to_skip = {"checksums.txt", MergeTreeData::DataPart::DELETED_MASK_FILE_NAME};
+
+    Poco::DirectoryIterator dir_end;
+    for (Poco::DirectoryIterator dir_it(source_part->getFullPath()); dir_it != dir_end; ++dir_it)
+    {
+        if (files_to_skip.count(dir_it.name()))
+            continue;
+
+        Poco::Path destination(new_part_tmp_path);
+        destination.append(dir_it.name());
+
+        createHardLink(dir_it.path().toString(), destination.toString());
+    }
+
+    new_data_part->checksums = source_part->checksums;
+    MergeTreeData::DataPart::storeDeletedMask(deleted, new_part_tmp_path, new_data_part->checksums);
+    {
+        /// Write file with checksums.
+        WriteBufferFromFile out(new_part_tmp_path + "checksums.txt", 4096);
+        new_data_part->checksums.write(out);
+    }
+
+    new_data_part->columns = source_part->columns;
+    new_data_part->rows_count = source_part->rows_count;
+    new_data_part->marks_count = source_part->marks_count;
+    new_data_part->index_granularity = source_part->index_granularity;
+    new_data_part->index = source_part->getIndex();
+    new_data_part->partition.assign(source_part->partition);
+    new_data_part->minmax_idx = source_part->minmax_idx;
+    new_data_part->ttl_min = source_part->ttl_min;
+    new_data_part->ttl_max = source_part->ttl_max;
+    new_data_part->modification_time = time(nullptr);
+    new_data_part->deleted_rows_count = countBytesInFilter(deleted);
+    new_data_part->deleted_mask = std::make_shared<const IColumn::Filter>(std::move(deleted));
+    new_data_part->bytes_on_disk = MergeTreeData::DataPart::calculateTotalSizeOnDisk(new_data_part->getFullPath());
+
+    LOG_TRACE(log, "Wrote deleted rows mask for part " << source_part->name << " ("
+        << new_data_part->deleted_rows_count << " of " << new_data_part->rows_count
+        << " rows are deleted) instead of rewriting it");
+
+    return new_data_part;
+}
+
+
 MergeTreeDataMergerMutator::MergeAlgorithm MergeTreeDataMergerMutator::chooseMergeAlgorithm(
     const MergeTreeData & data, const MergeTreeData::DataPartsVector & parts, size_t sum_rows_upper_bound,
-    const NamesAndTypesList & gathering_columns, bool deduplicate) const
+    const NamesAndTypesList & gathering_columns, bool deduplicate, bool need_remove_expired_values) const
 {
     if (deduplicate)
         return MergeAlgorithm::Horizontal;
+    /// Removal of expired rows filters the merged stream, so row sources written by the merging step
+    /// would not correspond to the written rows.
+    if (need_remove_expired_values)
+        return MergeAlgorithm::Horizontal;
     if (data.settings.enable_vertical_merge_algorithm == 0)
         return MergeAlgorithm::Horizontal;
 
+    /// Summing and Aggregating modes are supported because the columns they modify are forced
+    /// into the merging step (see extractMergingAndGatheringColumns); the rest of the columns
+    /// take the value of the first row of a group and can be gathered by row sources.
     bool is_supported_storage =
         data.merging_params.mode == MergeTreeData::MergingParams::Ordinary ||
         data.merging_params.mode == MergeTreeData::MergingParams::Collapsing ||
         data.merging_params.mode == MergeTreeData::MergingParams::Replacing ||
+        data.merging_params.mode == MergeTreeData::MergingParams::Summing ||
+        data.merging_params.mode == MergeTreeData::MergingParams::Aggregating ||
         data.merging_params.mode == MergeTreeData::MergingParams::VersionedCollapsing;
 
     bool enough_ordinary_cols = gathering_columns.size() >= data.settings.vertical_merge_algorithm_min_columns_to_activate;
@@ -3,8 +3,10 @@
 #include <Storages/MergeTree/MergeTreeData.h>
 #include <Storages/MergeTree/DiskSpaceMonitor.h>
 #include <Storages/MutationCommands.h>
+#include <IO/CompressedStream.h>
 #include <atomic>
 #include <functional>
+#include <optional>
 #include <Common/ActionBlocker.h>
 
 
@@ -28,6 +30,10 @@ public:
         MergeTreePartInfo part_info;
         MergeTreeData::DataPartsVector parts;
 
+        /// How the merge selector justified this merge; shown in system.merges.
+        /// Empty for selectors that do not explain their decisions.
+        String selection_decision;
+
         const MergeTreePartition & getPartition() const { return parts.front()->partition; }
 
         FuturePart() = default;
@@ -111,6 +117,20 @@ private:
       */
     MergeTreeData::DataPartsVector selectAllPartsFromPartition(const String & partition_id);
 
+    /** Find a single part older than recompress_parts_after_age_seconds whose on-disk compression
+      * method no longer matches what the age-aware <compression> config would choose for it,
+      * to rewrite it "with itself". Called when the merge selector found nothing to do.
+      */
+    bool selectPartToRecompress(
+        FuturePart & future_part,
+        const MergeTreeData::DataPartsVector & data_parts,
+        const AllowedMergingPredicate & can_merge,
+        time_t current_time);
+
+    /// The compression method the part was written with, read from the first block of a column file.
+    /// Empty if it cannot be determined (e.g. all column files start with a per-column encoding).
+    static std::optional<CompressionMethod> detectPartCompressionMethod(const MergeTreeDataPart & part);
+
 public:
     /** Is used to cancel all merges and mutations. On cancel() call all currently running actions will throw exception soon.
       * All new attempts to start a merge or mutation will throw an exception until all 'LockHolder' objects will be destroyed.
@@ -127,7 +147,15 @@ private:
 
     MergeAlgorithm chooseMergeAlgorithm(
             const MergeTreeData & data, const MergeTreeData::DataPartsVector & parts,
-            size_t rows_upper_bound, const NamesAndTypesList & gathering_columns, bool deduplicate) const;
+            size_t rows_upper_bound, const NamesAndTypesList & gathering_columns,
+            bool deduplicate, bool need_remove_expired_values) const;
+
+    /// Applies a mutation consisting only of DELETE commands by writing the mask of deleted rows
+    /// and hard-linking all other files from the source part (see the lightweight_deletes setting).
+    MergeTreeData::MutableDataPartPtr mutatePartByDeletedMask(
+        const FuturePart & future_part,
+        const std::vector<MutationCommand> & commands,
+        const Context & context);
 
 private:
     MergeTreeData & data;
@@ -8,13 +8,16 @@
 #include <IO/ReadBufferFromString.h>
 #include <IO/WriteBufferFromString.h>
 #include <IO/ReadBufferFromFile.h>
+#include <IO/WriteBufferFromFile.h>
 #include <IO/HashingWriteBuffer.h>
+#include <Columns/ColumnsCommon.h>
 #include <Core/Defines.h>
 #include <Common/SipHash.h>
 #include <Common/escapeForFileName.h>
 #include <Common/StringUtils/StringUtils.h>
 #include <Common/localBackup.h>
 #include <Storages/MergeTree/MergeTreeDataPart.h>
+#include <Storages/MergeTree/MergeTreeColumnStatistics.h>
 #include <Storages/MergeTree/MergeTreeData.h>
 
 #include <Poco/File.h>
@@ -37,6 +40,7 @@ namespace ErrorCodes
     extern const int CORRUPTED_DATA;
     extern const int NOT_FOUND_EXPECTED_DATA_PART;
     extern const int BAD_SIZE_OF_FILE_IN_DATA_PART;
+    extern const int UNKNOWN_FORMAT_VERSION;
 }
 
 
@@ -131,8 +135,17 @@ void MergeTreeDataPart::MinMaxIndex::merge(const MinMaxIndex & other)
 }
 
 
+MergeTreeDataPart::MergeTreeDataPart(const MergeTreeData & storage_, const String & name_, const MergeTreePartInfo & info_)
+    : storage(storage_), name(name_), info(info_)
+    , base_path(storage.full_path)
+    , index_granularity(storage.index_granularity)
+{
+}
+
 MergeTreeDataPart::MergeTreeDataPart(MergeTreeData & storage_, const String & name_)
     : storage(storage_), name(name_), info(MergeTreePartInfo::fromPartName(name_, storage.format_version))
+    , base_path(storage.full_path)
+    , index_granularity(storage.index_granularity)
 {
 }
 
@@ -218,7 +231,7 @@ String MergeTreeDataPart::getFullPath() const
     if (relative_path.empty())
         throw Exception("Part relative_path cannot be empty. This is bug.", ErrorCodes::LOGICAL_ERROR);
 
-    return storage.full_path + relative_path + "/";
+    return base_path + relative_path + "/";
 }
 
 String MergeTreeDataPart::getNameWithPrefix() const
@@ -295,6 +308,31 @@ MergeTreeDataPart::~MergeTreeDataPart()
     }
 }
 
+void MergeTreeDataPart::setInMemoryBlock(Block && block)
+{
+    is_in_memory = true;
+    in_memory_block = std::move(block);
+
+    rows_count = in_memory_block.rows();
+    index_granularity = storage.index_granularity;
+    marks_count = (rows_count + index_granularity - 1) / index_granularity;
+    bytes_on_disk = in_memory_block.bytes();    /// Approximation by the in-memory size, so that merge selection works for this part.
+    modification_time = time(nullptr);
+
+    /// Build the primary index the same way MergedBlockOutputStream does for an on-disk part.
+    Names sort_columns = storage.getPrimarySortColumns();
+    MutableColumns index_columns(sort_columns.size());
+    for (size_t i = 0; i < sort_columns.size(); ++i)
+        index_columns[i] = in_memory_block.getByName(sort_columns[i]).column->cloneEmpty();
+
+    for (size_t row = 0; row < rows_count; row += index_granularity)
+        for (size_t i = 0; i < sort_columns.size(); ++i)
+            index_columns[i]->insertFrom(*in_memory_block.getByName(sort_columns[i]).column, row);
+
+    index.assign(std::make_move_iterator(index_columns.begin()), std::make_move_iterator(index_columns.end()));
+}
+
+
 UInt64 MergeTreeDataPart::calculateTotalSizeOnDisk(const String & from)
 {
     Poco::File cur(from);
@@ -310,11 +348,16 @@ UInt64 MergeTreeDataPart::calculateTotalSizeOnDisk(const String & from)
 
 void MergeTreeDataPart::remove() const
 {
+    /// An in-memory part has no directory. It disappears from the write-ahead log when the log
+    /// is rewritten after the covering part is committed.
+    if (is_in_memory)
+        return;
+
     if (relative_path.empty())
         throw Exception("Part relative_path cannot be empty. This is bug.", ErrorCodes::LOGICAL_ERROR);
 
-    String from = storage.full_path + relative_path;
-    String to = storage.full_path + "tmp_delete_" + name;
+    String from = base_path + relative_path;
+    String to = base_path + "tmp_delete_" + name;
 
     Poco::File from_dir{from};
     Poco::File to_dir{to};
@@ -353,8 +396,15 @@ void MergeTreeDataPart::remove() const
 
 void MergeTreeDataPart::renameTo(const String & new_relative_path, bool remove_new_dir_if_exists) const
 {
+    /// There is nothing to rename on disk for an in-memory part.
+    if (is_in_memory)
+    {
+        relative_path = new_relative_path;
+        return;
+    }
+
     String from = getFullPath();
-    String to = storage.full_path + new_relative_path + "/";
+    String to = base_path + new_relative_path + "/";
 
     Poco::File from_file(from);
     if (!from_file.exists())
@@ -400,7 +450,7 @@ String MergeTreeDataPart::getRelativePathForDetachedPart(const String & prefix)
     {
         res = dst_name();
 
-        if (!Poco::File(storage.full_path + res).exists())
+        if (!Poco::File(base_path + res).exists())
             return res;
 
         LOG_WARNING(storage.log, "Directory " << dst_name() << " (to detach to) is already exist."
@@ -420,7 +470,7 @@ void MergeTreeDataPart::renameToDetached(const String & prefix) const
 void MergeTreeDataPart::makeCloneInDetached(const String & prefix) const
 {
     Poco::Path src(getFullPath());
-    Poco::Path dst(storage.full_path + getRelativePathForDetachedPart(prefix));
+    Poco::Path dst(base_path + getRelativePathForDetachedPart(prefix));
     /// Backup is not recursive (max_level is 0), so do not copy inner directories
     localBackup(src, dst, 0);
 }
@@ -429,15 +479,35 @@ void MergeTreeDataPart::loadColumnsChecksumsIndexes(bool require_columns_checksu
 {
     loadColumns(require_columns_checksums);
     loadChecksums(require_columns_checksums);
-    loadIndex();
-    loadRowsCount(); /// Must be called after loadIndex() as it uses the value of `marks_count`.
+    loadIndexGranularity();
+    loadMarksCount();
+    if (!storage.settings.primary_index_lazy_load)
+        loadIndex();
+    loadRowsCount(); /// Must be called after loadMarksCount() as it uses the value of `marks_count`.
+    loadDeletedMask();
+    loadTTLInfo();
     loadPartitionAndMinMaxIndex();
+    bytes_on_disk = calculateTotalSizeOnDisk(getFullPath());
     if (check_consistency)
         checkConsistency(require_columns_checksums);
 }
 
 
-void MergeTreeDataPart::loadIndex()
+void MergeTreeDataPart::loadIndexGranularity()
+{
+    String path = getFullPath() + "index_granularity.txt";
+    if (Poco::File(path).exists())
+    {
+        ReadBufferFromFile file = openForReading(path);
+        readIntText(index_granularity, file);
+        assertEOF(file);
+    }
+    else
+        index_granularity = storage.index_granularity;
+}
+
+
+void MergeTreeDataPart::loadMarksCount()
 {
     if (!marks_count)
     {
@@ -447,7 +517,22 @@ void MergeTreeDataPart::loadIndex()
         marks_count = Poco::File(getFullPath() + escapeForFileName(columns.front().name) + ".mrk")
             .getSize() / MERGE_TREE_MARK_SIZE;
     }
+}
+
 
+const MergeTreeDataPart::Index & MergeTreeDataPart::getIndex() const
+{
+    std::lock_guard<std::mutex> lock(index_mutex);
+
+    if (index.empty() && marks_count != 0 && !storage.primary_sort_columns.empty())
+        const_cast<MergeTreeDataPart *>(this)->loadIndex();
+
+    return index;
+}
+
+
+void MergeTreeDataPart::loadIndex()
+{
     size_t key_size = storage.primary_sort_columns.size();
 
     if (key_size)
@@ -479,8 +564,6 @@ void MergeTreeDataPart::loadIndex()
 
         index.assign(std::make_move_iterator(loaded_index.begin()), std::make_move_iterator(loaded_index.end()));
     }
-
-    bytes_on_disk = calculateTotalSizeOnDisk(getFullPath());
 }
 
 void MergeTreeDataPart::loadPartitionAndMinMaxIndex()
@@ -511,6 +594,182 @@ void MergeTreeDataPart::loadPartitionAndMinMaxIndex()
             ErrorCodes::CORRUPTED_DATA);
 }
 
+static constexpr UInt8 DELETED_MASK_FORMAT_VERSION = 1;
+
+void MergeTreeDataPart::loadDeletedMask()
+{
+    String path = getFullPath() + DELETED_MASK_FILE_NAME;
+    if (!Poco::File(path).exists())
+        return;
+
+    ReadBufferFromFile file = openForReading(path);
+    CompressedReadBuffer in(file);
+
+    UInt8 format_version;
+    readIntBinary(format_version, in);
+    if (format_version != DELETED_MASK_FORMAT_VERSION)
+        throw Exception("Unknown format version " + toString(format_version) + " of deleted rows mask " + path,
+            ErrorCodes::UNKNOWN_FORMAT_VERSION);
+
+    UInt64 rows;
+    readIntBinary(rows, in);
+    if (rows != rows_count)
+        throw Exception("Size of deleted rows mask " + path + " (" + toString(rows)
+            + ") differs from the number of rows in the part (" + toString(rows_count) + ")",
+            ErrorCodes::CORRUPTED_DATA);
+
+    auto mask = std::make_shared<IColumn::Filter>(rows);
+    in.readStrict(reinterpret_cast<char *>(mask->data()), rows);
+    assertEOF(in);
+
+    deleted_rows_count = countBytesInFilter(*mask);
+    deleted_mask = std::move(mask);
+}
+
+void MergeTreeDataPart::storeDeletedMask(const IColumn::Filter & mask, const String & part_path, Checksums & checksums)
+{
+    WriteBufferFromFile file(part_path + DELETED_MASK_FILE_NAME, 4096);
+    HashingWriteBuffer out_hashing(file);
+    {
+        CompressedWriteBuffer out(out_hashing);
+        writeIntBinary(DELETED_MASK_FORMAT_VERSION, out);
+        writeIntBinary(static_cast<UInt64>(mask.size()), out);
+        out.write(reinterpret_cast<const char *>(mask.data()), mask.size());
+    }
+    out_hashing.next();
+    checksums.files[DELETED_MASK_FILE_NAME].file_size = out_hashing.count();
+    checksums.files[DELETED_MASK_FILE_NAME].file_hash = out_hashing.getHash();
+}
+
+void MergeTreeDataPart::loadTTLInfo()
+{
+    String path = getFullPath() + TTL_FILE_NAME;
+    if (!Poco::File(path).exists())
+        return;
+
+    ReadBufferFromFile file = openForReading(path);
+    readIntText(ttl_min, file);
+    assertChar('\n', file);
+    readIntText(ttl_max, file);
+    assertChar('\n', file);
+    assertEOF(file);
+}
+
+void MergeTreeDataPart::storeTTLInfo(time_t ttl_min_, time_t ttl_max_, const String & part_path, Checksums & checksums)
+{
+    WriteBufferFromFile file(part_path + TTL_FILE_NAME, 4096);
+    HashingWriteBuffer out_hashing(file);
+    writeIntText(ttl_min_, out_hashing);
+    writeChar('\n', out_hashing);
+    writeIntText(ttl_max_, out_hashing);
+    writeChar('\n', out_hashing);
+    out_hashing.next();
+    checksums.files[TTL_FILE_NAME].file_size = out_hashing.count();
+    checksums.files[TTL_FILE_NAME].file_hash = out_hashing.getHash();
+}
+
+bool MergeTreeDataPart::loadColumnStatistics(MergeTreePartColumnStatistics & statistics) const
+{
+    return statistics.load(getFullPath());
+}
+
+std::shared_ptr<MergeTreeDataPart> MergeTreeDataPart::getProjectionPart() const
+{
+    String path = getFullPath() + PROJECTION_FILE_NAME;
+    if (storage.projection_sort_columns.empty() || !Poco::File(path).exists())
+        return nullptr;
+
+    Names sort_columns;
+    size_t projection_rows = 0;
+    size_t projection_marks = 0;
+    size_t projection_granularity = 0;
+    {
+        ReadBufferFromFile in = openForReading(path);
+        assertString("projection format version: 1\n", in);
+
+        while (true)
+        {
+            String column_name;
+            readBackQuotedString(column_name, in);
+            sort_columns.push_back(column_name);
+            if (checkChar(' ', in))
+                continue;
+            assertChar('\n', in);
+            break;
+        }
+
+        readIntText(projection_rows, in);
+        assertChar('\n', in);
+        readIntText(projection_marks, in);
+        assertChar('\n', in);
+        readIntText(projection_granularity, in);
+        assertChar('\n', in);
+        assertEOF(in);
+    }
+
+    /// The declaration may have changed since the part was written.
+    if (sort_columns != storage.projection_sort_columns || projection_rows != rows_count)
+        return nullptr;
+
+    auto res = std::make_shared<MergeTreeDataPart>(storage, name, info);
+    res->relative_path = relative_path + "/projection";
+
+    /// A part fetched from a replica carries only its checksummed files, which the layout
+    /// in the subdirectory is not.
+    if (!Poco::File(res->getFullPath() + "checksums.txt").exists())
+        return nullptr;
+
+    /// An ALTER rewrites only the main layout, so a projection whose set of columns
+    /// differs from the current columns of the part is stale.
+    {
+        NamesAndTypesList projection_columns;
+        ReadBufferFromFile columns_file = openForReading(res->getFullPath() + "columns.txt");
+        projection_columns.readText(columns_file);
+        if (projection_columns != columns)
+            return nullptr;
+    }
+
+    res->columns = columns;
+    res->rows_count = rows_count;
+    res->marks_count = projection_marks;
+    res->index_granularity = projection_granularity;
+    res->loadChecksums(true);
+
+    /// The index of the projection is over its own sort columns, so the common loadIndex
+    /// (which assumes the primary key of the table) cannot be used.
+    {
+        size_t key_size = sort_columns.size();
+        MutableColumns loaded_index(key_size);
+        DataTypes key_types = storage.projection_sort_column_types;
+
+        for (size_t i = 0; i < key_size; ++i)
+        {
+            loaded_index[i] = key_types[i]->createColumn();
+            loaded_index[i]->reserve(projection_marks);
+        }
+
+        String index_path = res->getFullPath() + "primary.idx";
+        ReadBufferFromFile index_file = openForReading(index_path);
+
+        for (size_t i = 0; i < projection_marks; ++i)
+            for (size_t j = 0; j < key_size; ++j)
+                key_types[j]->deserializeBinary(*loaded_index[j].get(), index_file);
+
+        for (size_t i = 0; i < key_size; ++i)
+            if (loaded_index[i]->size() != projection_marks)
+                throw Exception("Cannot read all data from index file " + index_path
+                    + "(expected size: " + toString(projection_marks) + ", read: " + toString(loaded_index[i]->size()) + ")",
+                    ErrorCodes::CANNOT_READ_ALL_DATA);
+
+        if (!index_file.eof())
+            throw Exception("Index file " + index_path + " is unexpectedly long", ErrorCodes::EXPECTED_END_OF_FILE);
+
+        res->index.assign(std::make_move_iterator(loaded_index.begin()), std::make_move_iterator(loaded_index.end()));
+    }
+
+    return res;
+}
+
 void MergeTreeDataPart::loadChecksums(bool require)
 {
     String path = getFullPath() + "checksums.txt";
@@ -544,7 +803,7 @@ void MergeTreeDataPart::loadRowsCount()
     }
     else
     {
-        size_t rows_approx = storage.index_granularity * marks_count;
+        size_t rows_approx = index_granularity * marks_count;
 
         for (const NameAndTypePair & column : columns)
         {
@@ -567,10 +826,10 @@ void MergeTreeDataPart::loadRowsCount()
                     ErrorCodes::LOGICAL_ERROR);
             }
 
-            if (!(rows_count <= rows_approx && rows_approx < rows_count + storage.index_granularity))
+            if (!(rows_count <= rows_approx && rows_approx < rows_count + index_granularity))
                 throw Exception(
                     "Unexpected size of column " + column.name + ": " + toString(rows_count) + " rows, expected "
-                    + toString(rows_approx) + "+-" + toString(storage.index_granularity) + " rows according to the index",
+                    + toString(rows_approx) + "+-" + toString(index_granularity) + " rows according to the index",
                     ErrorCodes::LOGICAL_ERROR);
 
             return;
@@ -636,6 +895,9 @@ void MergeTreeDataPart::checkConsistency(bool require_part_metadata)
 
         if (require_part_metadata)
         {
+            /// In a compact part the data of all columns is in the shared data.bin, so there are no per-stream data files.
+            bool is_compact = checksums.files.count("data.bin");
+
             for (const NameAndTypePair & name_type : columns)
             {
                 IDataType::SubstreamPath stream_path;
@@ -647,7 +909,7 @@ void MergeTreeDataPart::checkConsistency(bool require_part_metadata)
                     if (!checksums.files.count(mrk_file_name))
                         throw Exception("No " + mrk_file_name + " file checksum for column " + name_type.name + " in part " + path,
                             ErrorCodes::NO_FILE_IN_DATA_PART);
-                    if (!checksums.files.count(bin_file_name))
+                    if (!is_compact && !checksums.files.count(bin_file_name))
                         throw Exception("No " + bin_file_name + " file checksum for column " + name_type.name + " in part " + path,
                             ErrorCodes::NO_FILE_IN_DATA_PART);
                 }, stream_path);
@@ -730,14 +992,21 @@ void MergeTreeDataPart::checkConsistency(bool require_part_metadata)
 
 bool MergeTreeDataPart::hasColumnFiles(const String & column) const
 {
+    if (is_in_memory)
+        return in_memory_block.has(column);
+
     /// NOTE: For multi-streams columns we check that just first file exist.
     /// That's Ok under assumption that files exist either for all or for no streams.
 
     String prefix = getFullPath();
 
     String escaped_column = escapeForFileName(column);
+    if (!Poco::File(prefix + escaped_column + ".mrk").exists())
+        return false;
+
+    /// Compact parts store data of all columns in the single shared data.bin.
     return Poco::File(prefix + escaped_column + ".bin").exists()
-        && Poco::File(prefix + escaped_column + ".mrk").exists();
+        || Poco::File(prefix + "data.bin").exists();
 }
 
 
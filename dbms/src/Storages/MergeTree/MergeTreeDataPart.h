@@ -19,6 +19,7 @@ namespace DB
 {
 
 class MergeTreeData;
+struct MergeTreePartColumnStatistics;
 
 
 /// Description of the data part.
@@ -27,10 +28,7 @@ struct MergeTreeDataPart
     using Checksums = MergeTreeDataPartChecksums;
     using Checksum = MergeTreeDataPartChecksums::Checksum;
 
-    MergeTreeDataPart(const MergeTreeData & storage_, const String & name_, const MergeTreePartInfo & info_)
-        : storage(storage_), name(name_), info(info_)
-    {
-    }
+    MergeTreeDataPart(const MergeTreeData & storage_, const String & name_, const MergeTreePartInfo & info_);
 
     MergeTreeDataPart(MergeTreeData & storage_, const String & name_);
 
@@ -82,12 +80,19 @@ struct MergeTreeDataPart
     String name;
     MergeTreePartInfo info;
 
-    /// A directory path (relative to storage's path) where part data is actually stored
+    /// The data directory of the table on the disk (volume) where the part is stored, ending with '/'.
+    /// Equals storage.full_path unless the part was placed on another volume of the storage policy.
+    String base_path;
+
+    /// A directory path (relative to base_path) where part data is actually stored
     /// Examples: 'detached/tmp_fetch_<name>', 'tmp_<name>', '<name>'
     mutable String relative_path;
 
     size_t rows_count = 0;
     size_t marks_count = 0;
+    /// Rows per mark in this part. Parts written with adaptive granularity (index_granularity_bytes setting)
+    /// store the value chosen at write time in index_granularity.txt; for other parts it is the table-wide setting.
+    size_t index_granularity = 0;
     std::atomic<UInt64> bytes_on_disk {0};  /// 0 - if not counted;
                                             /// Is used from several threads without locks (it is changed with ALTER).
     time_t modification_time = 0;
@@ -100,6 +105,19 @@ struct MergeTreeDataPart
     /// If true it means that there are no ZooKeeper node for this part, so it should be deleted only from filesystem
     bool is_duplicate = false;
 
+    /// If true, the part exists only in RAM: its data is stored in `in_memory_block` and there is no
+    /// directory for it on disk. Such parts are created for small inserts (see the
+    /// min_bytes_for_on_disk_part setting), are made durable by the table's write-ahead log and reach
+    /// the disk only when a merge writes them into a bigger part.
+    bool is_in_memory = false;
+
+    /// Data of an in-memory part, sorted by the primary key expression.
+    Block in_memory_block;
+
+    /// Turns the part into an in-memory one: stores the block and fills the metadata
+    /// (rows_count, marks_count, index, ...) that would otherwise be computed while writing files.
+    void setInMemoryBlock(Block && block);
+
     /**
      * Part state is a stage of its lifetime. States are ordered and state of a part could be increased only.
      * Part state should be modified under data_parts mutex.
@@ -166,11 +184,16 @@ struct MergeTreeDataPart
     }
 
     /// Primary key (correspond to primary.idx file).
-    /// Always loaded in RAM. Contains each index_granularity-th value of primary key tuple.
+    /// Contains each index_granularity-th value of primary key tuple.
+    /// Loaded in RAM at startup, or on first use if the primary_index_lazy_load setting is enabled.
+    /// Readers must access it through getIndex(); direct access is for code that fills the index of a new part.
     /// Note that marks (also correspond to primary key) is not always in RAM, but cached. See MarkCache.h.
     using Index = Columns;
     Index index;
 
+    /// Returns the primary index, loading it from primary.idx first if it was not loaded at startup.
+    const Index & getIndex() const;
+
     MergeTreePartition partition;
 
     /// Index that for each part stores min and max values of a set of columns. This allows quickly excluding
@@ -204,6 +227,52 @@ struct MergeTreeDataPart
 
     Checksums checksums;
 
+    /// Name of the file with the mask of rows removed by a lightweight ALTER DELETE
+    /// (see the lightweight_deletes setting).
+    static constexpr auto DELETED_MASK_FILE_NAME = "deleted_mask.bin";
+
+    /// One byte per row of the part; non-zero means that the row is deleted and must be hidden from
+    /// reads (see MergeTreeRangeReader). nullptr if the part has no deleted rows.
+    std::shared_ptr<const IColumn::Filter> deleted_mask;
+
+    /// The number of non-zero bytes in deleted_mask.
+    size_t deleted_rows_count = 0;
+
+    bool hasDeletedMask() const { return deleted_mask != nullptr; }
+
+    /// Writes the mask file to part_path and adds its checksum to checksums.
+    static void storeDeletedMask(const IColumn::Filter & mask, const String & part_path, Checksums & checksums);
+
+    /// Name of the file with min and max values of the table TTL expression over the rows of the part.
+    static constexpr auto TTL_FILE_NAME = "ttl.txt";
+
+    /// Min and max values of the table TTL expression over the rows of the part, as Unix timestamps.
+    /// Zeros if the table has no TTL or the part was written before TTL was introduced.
+    /// If ttl_max has passed, the whole part is expired and can be dropped without merging.
+    time_t ttl_min = 0;
+    time_t ttl_max = 0;
+
+    /// Writes the TTL file to part_path and adds its checksum to checksums.
+    static void storeTTLInfo(time_t ttl_min_, time_t ttl_max_, const String & part_path, Checksums & checksums);
+
+    /// Name of the metadata file of the projection layout: an additional copy of the rows of
+    /// the part, sorted by the projection_sort_columns setting, stored with its own primary
+    /// index in the projection/ subdirectory of the part. The metadata file is checksummed
+    /// with the part; the layout itself carries its own checksums.txt.
+    static constexpr auto PROJECTION_FILE_NAME = "projection.txt";
+
+    /// Returns a part object representing the projection layout of this part, with the index
+    /// over the projection sort columns loaded, or nullptr if this part has no projection or
+    /// it is stale (the declared sort columns or the set of columns have changed since it was
+    /// written). The returned object is not registered anywhere and lives for one query.
+    std::shared_ptr<MergeTreeDataPart> getProjectionPart() const;
+
+    /// Reads per-column statistics of the part (see MergeTreeColumnStatistics.h).
+    /// They are not kept in memory - the HyperLogLog counters are too large for that
+    /// with many parts and columns. Returns false if the part has no statistics file
+    /// (it was written by an older server or with write_column_statistics disabled).
+    bool loadColumnStatistics(MergeTreePartColumnStatistics & statistics) const;
+
     /// Columns description.
     NamesAndTypesList columns;
 
@@ -224,6 +293,9 @@ struct MergeTreeDataPart
         */
     mutable std::mutex alter_mutex;
 
+    /// Protects lazy loading of the primary index (see getIndex()).
+    mutable std::mutex index_mutex;
+
     ~MergeTreeDataPart();
 
     /// Calculate the total size of the entire directory with all the files
@@ -265,15 +337,27 @@ private:
     /// If checksums.txt exists, reads files' checksums (and sizes) from it
     void loadChecksums(bool require);
 
-    /// Loads index file. Also calculates this->marks_count if marks_count = 0
+    /// Calculates this->marks_count from the size of a marks file, if marks_count = 0.
+    void loadMarksCount();
+
+    /// Loads index file. Requires marks_count to be set.
     void loadIndex();
 
+    /// Loads rows-per-mark of the part from index_granularity.txt, or takes the table-wide setting if there is no such file.
+    void loadIndexGranularity();
+
     /// Load rows count for this part from disk (for the newer storage format version).
     /// For the older format version calculates rows count from the size of a column with a fixed size.
     void loadRowsCount();
 
     void loadPartitionAndMinMaxIndex();
 
+    /// Loads the mask of deleted rows if the part has one. Requires rows_count to be set.
+    void loadDeletedMask();
+
+    /// Loads min and max values of the table TTL expression if the part has them.
+    void loadTTLInfo();
+
     void checkConsistency(bool require_part_metadata);
 
     ColumnSize getColumnSizeImpl(const String & name, const IDataType & type, std::unordered_set<String> * processed_substreams) const;
@@ -1,12 +1,16 @@
 #include <boost/rational.hpp>   /// For calculations related to sampling coefficients.
+#include <map>
 #include <optional>
 
 #include <Common/FieldVisitors.h>
 #include <Storages/MergeTree/MergeTreeDataSelectExecutor.h>
 #include <Storages/MergeTree/MergeTreeBlockInputStream.h>
+#include <Storages/MergeTree/MergeTreeReverseBlockInputStream.h>
 #include <Storages/MergeTree/MergeTreeReadPool.h>
 #include <Storages/MergeTree/MergeTreeThreadBlockInputStream.h>
 #include <Storages/MergeTree/KeyCondition.h>
+#include <Storages/MergeTree/MergeTreeMinMaxGranuleIndex.h>
+#include <Storages/MergeTree/MergeTreeNgramGranuleIndex.h>
 #include <Parsers/ASTIdentifier.h>
 #include <Parsers/ASTLiteral.h>
 #include <Parsers/ASTFunction.h>
@@ -37,6 +41,7 @@ namespace std
 #include <DataStreams/AddingConstColumnBlockInputStream.h>
 #include <DataStreams/CreatingSetsBlockInputStream.h>
 #include <DataStreams/NullBlockInputStream.h>
+#include <DataStreams/ReverseBlockInputStream.h>
 #include <DataStreams/SummingSortedBlockInputStream.h>
 #include <DataStreams/ReplacingSortedBlockInputStream.h>
 #include <DataStreams/AggregatingSortedBlockInputStream.h>
@@ -52,6 +57,14 @@ namespace ProfileEvents
     extern const Event SelectedParts;
     extern const Event SelectedRanges;
     extern const Event SelectedMarks;
+    extern const Event PartsPrunedByPartitionIndex;
+    extern const Event MarksSkippedByPrimaryKey;
+    extern const Event MarksSkippedByGranuleMinMaxIndex;
+    extern const Event MarksSkippedByGranuleNgramIndex;
+    extern const Event MarksSkippedByProjection;
+    extern const Event SamplingRequestedRows;
+    extern const Event SamplingSelectedRows;
+    extern const Event SamplingRowLevelFilterSkipped;
 }
 
 
@@ -97,7 +110,7 @@ size_t MergeTreeDataSelectExecutor::getApproximateTotalRowsToRead(
     for (size_t i = 0; i < parts.size(); ++i)
     {
         const MergeTreeData::DataPartPtr & part = parts[i];
-        MarkRanges ranges = markRangesFromPKRange(part->index, key_condition, settings);
+        MarkRanges ranges = markRangesFromPKRange(part->getIndex(), key_condition, data.primary_key_data_types, settings);
 
         /** In order to get a lower bound on the number of rows that match the condition on PK,
           *  consider only guaranteed full marks.
@@ -132,6 +145,46 @@ static RelativeSize convertAbsoluteSampleSizeToRelative(const ASTPtr & node, siz
 }
 
 
+/** Whether the primary index of the part proves that the sampling column of every row in the selected
+  *  granules is within the `[lower, upper)` half-interval cut off by SAMPLE. If so, the row-level
+  *  sampling filter would pass everything and can be dropped.
+  * Inside a granule the sampling column is bounded by the two adjacent index entries only while the
+  *  preceding primary key columns do not change, and the last granule of the part has no right index
+  *  entry at all, so the check is conservative.
+  */
+static bool sampleRangesAreExact(
+    const MergeTreeData::DataPart::Index & index,
+    const MarkRanges & ranges,
+    size_t marks_count,
+    size_t sample_column_pos,
+    bool has_lower_limit,
+    UInt64 lower_limit,
+    bool has_upper_limit,
+    UInt64 upper_limit)
+{
+    for (const auto & range : ranges)
+    {
+        for (size_t mark = range.begin; mark != range.end; ++mark)
+        {
+            if (mark + 1 >= marks_count)
+                return false;
+
+            for (size_t i = 0; i < sample_column_pos; ++i)
+                if (index[i]->compareAt(mark, mark + 1, *index[i], 1) != 0)
+                    return false;
+
+            if (has_lower_limit && index[sample_column_pos]->getUInt(mark) < lower_limit)
+                return false;
+
+            if (has_upper_limit && index[sample_column_pos]->getUInt(mark + 1) >= upper_limit)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+
 BlockInputStreams MergeTreeDataSelectExecutor::read(
     const Names & column_names_to_return,
     const SelectQueryInfo & query_info,
@@ -262,7 +315,10 @@ BlockInputStreams MergeTreeDataSelectExecutor::readFromParts(
 
             if (minmax_idx_condition && !minmax_idx_condition->mayBeTrueInParallelogram(
                     part->minmax_idx.parallelogram, data.minmax_idx_column_types))
+            {
+                ProfileEvents::increment(ProfileEvents::PartsPrunedByPartitionIndex);
                 continue;
+            }
 
             if (max_block_numbers_to_read)
             {
@@ -280,6 +336,14 @@ BlockInputStreams MergeTreeDataSelectExecutor::readFromParts(
     std::shared_ptr<ASTFunction> filter_function;
     ExpressionActionsPtr filter_expression;
 
+    /// The `[lower, upper)` cut-off of the sampling column and its position in the primary key,
+    ///  kept to check per part whether the row-level sampling filter is needed at all.
+    bool has_sample_lower_limit = false;
+    bool has_sample_upper_limit = false;
+    UInt64 sample_lower_limit = 0;
+    UInt64 sample_upper_limit = 0;
+    size_t sample_column_pos = 0;
+
     RelativeSize relative_sample_size = 0;
     RelativeSize relative_sample_offset = 0;
 
@@ -364,7 +428,17 @@ BlockInputStreams MergeTreeDataSelectExecutor::readFromParts(
       * It is also important that the entire universe can be covered using SAMPLE 0.1 OFFSET 0, ... OFFSET 0.9 and similar decimals.
       */
 
-    bool use_sampling = relative_sample_size > 0 || settings.parallel_replicas_count > 1;
+    bool use_sampling = relative_sample_size > 0 || (settings.parallel_replicas_count > 1 && data.supportsSampling());
+
+    /** The table has no sampling key, but the query is still processed by several replicas of the shard
+      * in parallel (see max_parallel_replicas). In this case split the data among the replicas by a hash
+      * of the primary key: each replica reads only the rows whose hash modulo the number of replicas
+      * equals its own number. Unlike splitting by the sampling key, this cannot cut off ranges of the
+      * index, so the whole table is read and filtered on every replica and only decompression and
+      * further computation are shared among the replicas.
+      */
+    bool split_by_primary_key_hash = settings.parallel_replicas_count > 1 && !data.supportsSampling();
+
     bool no_data = false;   /// There is nothing left after sampling.
 
     if (use_sampling)
@@ -487,6 +561,17 @@ BlockInputStreams MergeTreeDataSelectExecutor::readFromParts(
                 filter_function->children.push_back(filter_function->arguments);
             }
 
+            /// Remember the cut-off: after the index is analyzed, it tells for each part whether
+            ///  the selected granules already lie entirely within the sample.
+            has_sample_lower_limit = has_lower_limit;
+            has_sample_upper_limit = has_upper_limit;
+            sample_lower_limit = lower;
+            sample_upper_limit = upper;
+
+            Names primary_sort_columns = data.getPrimarySortColumns();
+            sample_column_pos = std::find(primary_sort_columns.begin(), primary_sort_columns.end(),
+                data.sampling_expression->getColumnName()) - primary_sort_columns.begin();
+
             ASTPtr query = filter_function;
             auto syntax_result = SyntaxAnalyzer(context, {}).analyze(query, available_real_columns);
             filter_expression = ExpressionAnalyzer(filter_function, syntax_result, context).getActions(false);
@@ -498,6 +583,48 @@ BlockInputStreams MergeTreeDataSelectExecutor::readFromParts(
             column_names_to_read.erase(std::unique(column_names_to_read.begin(), column_names_to_read.end()), column_names_to_read.end());
         }
     }
+    else if (split_by_primary_key_hash)
+    {
+        if (!data.hasPrimaryKey())
+            throw Exception(
+                "Parallel processing of a query by several replicas is not supported for tables"
+                " without a primary key and without a sampling key",
+                ErrorCodes::SAMPLING_NOT_SUPPORTED);
+
+        /// cityHash64(primary key) % parallel_replicas_count = parallel_replica_offset
+
+        auto hash_function = std::make_shared<ASTFunction>();
+        hash_function->name = "cityHash64";
+        hash_function->arguments = std::make_shared<ASTExpressionList>();
+        hash_function->arguments->children = data.primary_expr_ast->children;
+        hash_function->children.push_back(hash_function->arguments);
+
+        auto modulo_function = std::make_shared<ASTFunction>();
+        modulo_function->name = "modulo";
+        modulo_function->arguments = std::make_shared<ASTExpressionList>();
+        modulo_function->arguments->children.push_back(hash_function);
+        modulo_function->arguments->children.push_back(std::make_shared<ASTLiteral>(settings.parallel_replicas_count.value));
+        modulo_function->children.push_back(modulo_function->arguments);
+
+        auto equals_function = std::make_shared<ASTFunction>();
+        equals_function->name = "equals";
+        equals_function->arguments = std::make_shared<ASTExpressionList>();
+        equals_function->arguments->children.push_back(modulo_function);
+        equals_function->arguments->children.push_back(std::make_shared<ASTLiteral>(settings.parallel_replica_offset.value));
+        equals_function->children.push_back(equals_function->arguments);
+
+        filter_function = equals_function;
+
+        ASTPtr query = filter_function;
+        auto syntax_result = SyntaxAnalyzer(context, {}).analyze(query, available_real_columns);
+        filter_expression = ExpressionAnalyzer(filter_function, syntax_result, context).getActions(false);
+
+        /// Add columns needed to calculate the hash of the primary key to `column_names_to_read`.
+        std::vector<String> add_columns = filter_expression->getRequiredColumns();
+        column_names_to_read.insert(column_names_to_read.end(), add_columns.begin(), add_columns.end());
+        std::sort(column_names_to_read.begin(), column_names_to_read.end());
+        column_names_to_read.erase(std::unique(column_names_to_read.begin(), column_names_to_read.end()), column_names_to_read.end());
+    }
 
     if (no_data)
     {
@@ -516,25 +643,138 @@ BlockInputStreams MergeTreeDataSelectExecutor::readFromParts(
 
     RangesInDataParts parts_with_ranges;
 
+    /// Conditions on columns with per-granule min-max skip indices, to further filter the selected ranges.
+    std::vector<std::pair<size_t, KeyCondition>> skip_index_conditions;
+    for (size_t i = 0; i < data.skip_minmax_idx_columns.size(); ++i)
+    {
+        KeyCondition condition(query_info, context, {data.skip_minmax_idx_columns[i]}, data.skip_minmax_idx_expr);
+        if (!condition.alwaysUnknownOrTrue())
+        {
+            LOG_DEBUG(log, "MinMax skip index condition for column " << data.skip_minmax_idx_columns[i]
+                << ": " << condition.toString());
+            skip_index_conditions.emplace_back(i, std::move(condition));
+        }
+    }
+
+    /// Substrings the query requires to occur in columns with n-gram bloom filter indices.
+    std::vector<std::pair<String, std::vector<String>>> ngram_index_substrings;
+    for (const String & column_name : data.skip_ngrambf_idx_columns)
+    {
+        auto substrings = MergeTreeNgramGranuleIndex::extractRequiredSubstrings(query_info, column_name);
+        if (!substrings.empty())
+        {
+            LOG_DEBUG(log, "Ngram skip index for column " << column_name
+                << ": " << substrings.size() << " required substrings");
+            ngram_index_substrings.emplace_back(column_name, std::move(substrings));
+        }
+    }
+
+    /// If the condition cannot prune by the primary key but can by the projection sort key,
+    /// read the projection layout of the parts that have one (see MergeTreeDataPart).
+    /// The layouts contain the same rows, only ordered differently, so this changes only the
+    /// order of the result, which is undefined anyway without the optimizations excluded here.
+    std::optional<KeyCondition> projection_condition;
+    if (settings.optimize_use_projections && !data.projection_sort_columns.empty()
+        && !use_sampling && !select.final() && query_info.read_in_order_direction == 0
+        && key_condition.alwaysUnknownOrTrue())
+    {
+        KeyCondition candidate(query_info, context, data.projection_sort_columns, data.projection_sort_expr);
+        if (!candidate.alwaysUnknownOrTrue())
+        {
+            projection_condition.emplace(std::move(candidate));
+            LOG_DEBUG(log, "Projection condition: " << projection_condition->toString());
+        }
+    }
+
     /// Let's find what range to read from each part.
     size_t sum_marks = 0;
     size_t sum_ranges = 0;
+
+    /// To report the achieved sample fraction and to drop the row-level sampling filter
+    ///  when the index proves it redundant for every selected part.
+    bool sampling_filter_needed = false;
+    size_t rows_in_parts_before_sampling = 0;
+    size_t sampled_rows_estimate = 0;
+
+    auto count_marks = [](const MarkRanges & mark_ranges)
+    {
+        size_t res = 0;
+        for (const auto & range : mark_ranges)
+            res += range.end - range.begin;
+        return res;
+    };
+
     for (auto & part : parts)
     {
+        /// A deleted-rows mask indexes rows of the main layout and cannot be applied
+        /// to the projection order.
+        MergeTreeData::DataPartPtr projection_part;
+        if (projection_condition && !part->hasDeletedMask())
+            projection_part = part->getProjectionPart();
+
+        if (projection_part)
+        {
+            RangesInDataPart ranges(projection_part, part_index++);
+            ranges.ranges = markRangesFromPKRange(
+                projection_part->getIndex(), *projection_condition, data.projection_sort_column_types, settings);
+
+            size_t marks_after_projection = count_marks(ranges.ranges);
+            ProfileEvents::increment(ProfileEvents::MarksSkippedByProjection,
+                projection_part->marks_count - marks_after_projection);
+
+            /// Skip indices describe granules of the main layout and are not applicable here.
+            if (!ranges.ranges.empty())
+            {
+                parts_with_ranges.push_back(ranges);
+
+                sum_ranges += ranges.ranges.size();
+                sum_marks += marks_after_projection;
+            }
+            continue;
+        }
+
         RangesInDataPart ranges(part, part_index++);
 
         if (data.hasPrimaryKey())
-            ranges.ranges = markRangesFromPKRange(part->index, key_condition, settings);
+            ranges.ranges = markRangesFromPKRange(part->getIndex(), key_condition, data.primary_key_data_types, settings);
         else
             ranges.ranges = MarkRanges{MarkRange{0, part->marks_count}};
 
+        size_t marks_after_pk = count_marks(ranges.ranges);
+        ProfileEvents::increment(ProfileEvents::MarksSkippedByPrimaryKey, part->marks_count - marks_after_pk);
+
+        if (!ranges.ranges.empty() && !skip_index_conditions.empty())
+        {
+            ranges.ranges = filterMarkRangesBySkipIndices(part, ranges.ranges, skip_index_conditions);
+            ProfileEvents::increment(ProfileEvents::MarksSkippedByGranuleMinMaxIndex,
+                marks_after_pk - count_marks(ranges.ranges));
+        }
+
+        if (!ranges.ranges.empty() && !ngram_index_substrings.empty())
+        {
+            size_t marks_before = count_marks(ranges.ranges);
+            ranges.ranges = filterMarkRangesByNgramIndices(part, ranges.ranges, ngram_index_substrings);
+            ProfileEvents::increment(ProfileEvents::MarksSkippedByGranuleNgramIndex,
+                marks_before - count_marks(ranges.ranges));
+        }
+
+        if (use_sampling)
+        {
+            rows_in_parts_before_sampling += part->rows_count;
+            sampled_rows_estimate += std::min(count_marks(ranges.ranges) * data.index_granularity, part->rows_count);
+
+            if (!sampling_filter_needed && !ranges.ranges.empty()
+                && !sampleRangesAreExact(part->getIndex(), ranges.ranges, part->marks_count, sample_column_pos,
+                    has_sample_lower_limit, sample_lower_limit, has_sample_upper_limit, sample_upper_limit))
+                sampling_filter_needed = true;
+        }
+
         if (!ranges.ranges.empty())
         {
             parts_with_ranges.push_back(ranges);
 
             sum_ranges += ranges.ranges.size();
-            for (const auto & range : ranges.ranges)
-                sum_marks += range.end - range.begin;
+            sum_marks += count_marks(ranges.ranges);
         }
     }
 
@@ -548,8 +788,54 @@ BlockInputStreams MergeTreeDataSelectExecutor::readFromParts(
     ProfileEvents::increment(ProfileEvents::SelectedRanges, sum_ranges);
     ProfileEvents::increment(ProfileEvents::SelectedMarks, sum_marks);
 
+    if (use_sampling)
+    {
+        /// The achieved sample fraction is the ratio of these two counters. The selected estimate
+        ///  counts whole granules, so it slightly exceeds the request when cut-offs fall inside granules.
+        ProfileEvents::increment(ProfileEvents::SamplingRequestedRows,
+            static_cast<UInt64>(boost::rational_cast<ASTSampleRatio::BigNum>(
+                RelativeSize(rows_in_parts_before_sampling) * relative_sample_size)));
+        ProfileEvents::increment(ProfileEvents::SamplingSelectedRows, sampled_rows_estimate);
+
+        if (!sampling_filter_needed)
+        {
+            LOG_DEBUG(log, "Sampling filter is not needed: the index proves that all selected granules are entirely within the sample");
+            ProfileEvents::increment(ProfileEvents::SamplingRowLevelFilterSkipped);
+        }
+    }
+
     BlockInputStreams res;
 
+    /// Split PREWHERE of the form `cond1 AND cond2 AND ...` into steps, so that columns needed only
+    /// for the later conditions are read at positions already filtered by the earlier ones.
+    PrewhereReadStepsPtr prewhere_read_steps;
+    PrewhereStepsStatsPtr prewhere_steps_stats;
+    if (query_info.prewhere_info && settings.enable_multiple_prewhere_read_steps)
+    {
+        auto steps = splitPrewhereIntoReadSteps(*query_info.prewhere_info, context);
+        if (!steps.empty())
+        {
+            prewhere_read_steps = std::make_shared<const PrewhereReadSteps>(std::move(steps));
+
+            /// Per-step statistics shared by all streams of the query, to adapt the execution
+            /// order of the steps to the data (see choosePrewhereStepOrder). The last step is
+            /// pinned, so with fewer than two other steps there is nothing to adapt.
+            if (settings.adaptive_prewhere_reorder && prewhere_read_steps->size() > 2)
+                prewhere_steps_stats = std::make_shared<PrewhereStepsStats>(prewhere_read_steps->size());
+        }
+    }
+
+    /// The byte budget for block formation. With several queries running concurrently,
+    ///  shrink it so that the combined working set of all readers stays cache-friendly,
+    ///  but not below the size that still amortizes per-block overhead.
+    size_t preferred_block_size_bytes = settings.preferred_block_size_bytes;
+    if (settings.adapt_block_size_to_concurrency && preferred_block_size_bytes)
+    {
+        size_t running_queries = context.getProcessList().size();
+        if (running_queries > 1)
+            preferred_block_size_bytes = std::max<size_t>(65536, preferred_block_size_bytes / running_queries);
+    }
+
     if (select.final())
     {
         /// Add columns needed to calculate primary key and the sign.
@@ -568,11 +854,56 @@ BlockInputStreams MergeTreeDataSelectExecutor::readFromParts(
             std::move(parts_with_ranges),
             column_names_to_read,
             max_block_size,
+            preferred_block_size_bytes,
             settings.use_uncompressed_cache,
             query_info.prewhere_info,
+            prewhere_read_steps,
+            prewhere_steps_stats,
             virt_column_names,
             settings);
     }
+    else if (query_info.read_in_order_direction != 0)
+    {
+        res = spreadMarkRangesAmongStreamsInOrder(
+            std::move(parts_with_ranges),
+            column_names_to_read,
+            max_block_size,
+            preferred_block_size_bytes,
+            settings.use_uncompressed_cache,
+            query_info.prewhere_info,
+            prewhere_read_steps,
+            prewhere_steps_stats,
+            virt_column_names,
+            settings,
+            query_info.read_in_order_direction);
+    }
+    else if (query_info.aggregate_by_partitions)
+    {
+        /// Give every partition its own stream, so that the interpreter can aggregate each
+        ///  stream independently: the GROUP BY keys determine the partition, so the groups
+        ///  of different partitions are disjoint.
+        std::map<String, RangesInDataParts> partitions;
+        for (auto & part : parts_with_ranges)
+            partitions[part.data_part->info.partition_id].emplace_back(std::move(part));
+
+        for (auto & partition : partitions)
+        {
+            BlockInputStreams partition_streams = spreadMarkRangesAmongStreams(
+                std::move(partition.second),
+                1,
+                column_names_to_read,
+                max_block_size,
+                preferred_block_size_bytes,
+                settings.use_uncompressed_cache,
+                query_info.prewhere_info,
+                prewhere_read_steps,
+                prewhere_steps_stats,
+                virt_column_names,
+                settings);
+
+            res.insert(res.end(), partition_streams.begin(), partition_streams.end());
+        }
+    }
     else
     {
         res = spreadMarkRangesAmongStreams(
@@ -580,13 +911,16 @@ BlockInputStreams MergeTreeDataSelectExecutor::readFromParts(
             num_streams,
             column_names_to_read,
             max_block_size,
+            preferred_block_size_bytes,
             settings.use_uncompressed_cache,
             query_info.prewhere_info,
+            prewhere_read_steps,
+            prewhere_steps_stats,
             virt_column_names,
             settings);
     }
 
-    if (use_sampling)
+    if ((use_sampling && sampling_filter_needed) || split_by_primary_key_hash)
         for (auto & stream : res)
             stream = std::make_shared<FilterBlockInputStream>(stream, filter_expression, filter_function->getColumnName());
 
@@ -609,8 +943,11 @@ BlockInputStreams MergeTreeDataSelectExecutor::spreadMarkRangesAmongStreams(
     size_t num_streams,
     const Names & column_names,
     size_t max_block_size,
+    size_t preferred_block_size_bytes,
     bool use_uncompressed_cache,
     const PrewhereInfoPtr & prewhere_info,
+    const PrewhereReadStepsPtr & prewhere_read_steps,
+    const PrewhereStepsStatsPtr & prewhere_steps_stats,
     const Names & virt_columns,
     const Settings & settings) const
 {
@@ -646,7 +983,7 @@ BlockInputStreams MergeTreeDataSelectExecutor::spreadMarkRangesAmongStreams(
 
         MergeTreeReadPoolPtr pool = std::make_shared<MergeTreeReadPool>(
             num_streams, sum_marks, min_marks_for_concurrent_read, parts, data, prewhere_info, true,
-            column_names, MergeTreeReadPool::BackoffSettings(settings), settings.preferred_block_size_bytes, false);
+            column_names, MergeTreeReadPool::BackoffSettings(settings), preferred_block_size_bytes, false);
 
         /// Let's estimate total number of rows for progress bar.
         const size_t total_rows = data.index_granularity * sum_marks;
@@ -655,9 +992,9 @@ BlockInputStreams MergeTreeDataSelectExecutor::spreadMarkRangesAmongStreams(
         for (size_t i = 0; i < num_streams; ++i)
         {
             res.emplace_back(std::make_shared<MergeTreeThreadBlockInputStream>(
-                i, pool, min_marks_for_concurrent_read, max_block_size, settings.preferred_block_size_bytes,
+                i, pool, min_marks_for_concurrent_read, max_block_size, preferred_block_size_bytes,
                 settings.preferred_max_column_in_block_size_bytes, data, use_uncompressed_cache,
-                prewhere_info, settings, virt_columns));
+                prewhere_info, prewhere_read_steps, prewhere_steps_stats, settings, virt_columns));
 
             if (i == 0)
             {
@@ -731,10 +1068,11 @@ BlockInputStreams MergeTreeDataSelectExecutor::spreadMarkRangesAmongStreams(
                 }
 
                 BlockInputStreamPtr source_stream = std::make_shared<MergeTreeBlockInputStream>(
-                    data, part.data_part, max_block_size, settings.preferred_block_size_bytes,
+                    data, part.data_part, max_block_size, preferred_block_size_bytes,
                     settings.preferred_max_column_in_block_size_bytes, column_names, ranges_to_get_from_part,
-                    use_uncompressed_cache, prewhere_info, true, settings.min_bytes_to_use_direct_io,
-                    settings.max_read_buffer_size, true, virt_columns, part.part_index_in_query);
+                    use_uncompressed_cache, prewhere_info, prewhere_read_steps, prewhere_steps_stats, true, settings.min_bytes_to_use_direct_io,
+                    settings.min_bytes_to_use_mmap_io, settings.max_read_buffer_size, true, virt_columns, part.part_index_in_query,
+                    false, settings.apply_deleted_mask, settings.deferred_checksum_verification);
 
                 res.push_back(source_stream);
             }
@@ -747,12 +1085,80 @@ BlockInputStreams MergeTreeDataSelectExecutor::spreadMarkRangesAmongStreams(
     return res;
 }
 
+BlockInputStreams MergeTreeDataSelectExecutor::spreadMarkRangesAmongStreamsInOrder(
+    RangesInDataParts && parts,
+    const Names & column_names,
+    size_t max_block_size,
+    size_t preferred_block_size_bytes,
+    bool use_uncompressed_cache,
+    const PrewhereInfoPtr & prewhere_info,
+    const PrewhereReadStepsPtr & prewhere_read_steps,
+    const PrewhereStepsStatsPtr & prewhere_steps_stats,
+    const Names & virt_columns,
+    const Settings & settings,
+    int direction) const
+{
+    const size_t max_marks_to_use_cache =
+        (settings.merge_tree_max_rows_to_use_cache + data.index_granularity - 1) / data.index_granularity;
+
+    size_t sum_marks = 0;
+    for (const auto & part : parts)
+        for (const auto & range : part.ranges)
+            sum_marks += range.end - range.begin;
+
+    if (sum_marks > max_marks_to_use_cache)
+        use_uncompressed_cache = false;
+
+    BlockInputStreams res;
+
+    for (auto & part : parts)
+    {
+        if (direction > 0)
+        {
+            res.emplace_back(std::make_shared<MergeTreeBlockInputStream>(
+                data, part.data_part, max_block_size, preferred_block_size_bytes,
+                settings.preferred_max_column_in_block_size_bytes, column_names, part.ranges,
+                use_uncompressed_cache, prewhere_info, prewhere_read_steps, prewhere_steps_stats, true,
+                settings.min_bytes_to_use_direct_io, settings.min_bytes_to_use_mmap_io, settings.max_read_buffer_size, true,
+                virt_columns, part.part_index_in_query, false, settings.apply_deleted_mask,
+                settings.deferred_checksum_verification));
+        }
+        else
+        {
+            /// The reverse stream buffers all blocks of a range before returning them back to
+            /// front, so split the ranges to about one block each.
+            size_t granularity = part.data_part->index_granularity;
+            size_t marks_in_range = std::max<size_t>(1, max_block_size / granularity);
+
+            MarkRanges split_ranges;
+            for (const auto & range : part.ranges)
+                for (size_t begin = range.begin; begin < range.end; begin += marks_in_range)
+                    split_ranges.emplace_back(begin, std::min(range.end, begin + marks_in_range));
+
+            BlockInputStreamPtr source_stream = std::make_shared<MergeTreeReverseBlockInputStream>(
+                data, part.data_part, max_block_size, preferred_block_size_bytes,
+                settings.preferred_max_column_in_block_size_bytes, column_names, split_ranges,
+                use_uncompressed_cache, prewhere_info, prewhere_read_steps, prewhere_steps_stats, true,
+                settings.min_bytes_to_use_direct_io, settings.min_bytes_to_use_mmap_io, settings.max_read_buffer_size, true,
+                virt_columns, part.part_index_in_query, false, settings.apply_deleted_mask,
+                settings.deferred_checksum_verification);
+
+            res.emplace_back(std::make_shared<ReverseBlockInputStream>(source_stream));
+        }
+    }
+
+    return res;
+}
+
 BlockInputStreams MergeTreeDataSelectExecutor::spreadMarkRangesAmongStreamsFinal(
     RangesInDataParts && parts,
     const Names & column_names,
     size_t max_block_size,
+    size_t preferred_block_size_bytes,
     bool use_uncompressed_cache,
     const PrewhereInfoPtr & prewhere_info,
+    const PrewhereReadStepsPtr & prewhere_read_steps,
+    const PrewhereStepsStatsPtr & prewhere_steps_stats,
     const Names & virt_columns,
     const Settings & settings) const
 {
@@ -767,7 +1173,12 @@ BlockInputStreams MergeTreeDataSelectExecutor::spreadMarkRangesAmongStreamsFinal
     if (sum_marks > max_marks_to_use_cache)
         use_uncompressed_cache = false;
 
-    BlockInputStreams to_merge;
+    /// Streams to be merged, grouped by partition. Parts of different partitions never contain rows
+    /// that should be collapsed with each other (merges do not cross partition boundaries), so with
+    /// do_not_merge_across_partitions_select_final each partition is merged independently and the
+    /// returned streams are processed in parallel. Otherwise there is a single group with all parts.
+    std::vector<BlockInputStreams> to_merge_groups;
+    std::unordered_map<String, size_t> group_by_partition;
 
     /// NOTE `merge_tree_uniform_read_distribution` is not used for FINAL
 
@@ -776,12 +1187,25 @@ BlockInputStreams MergeTreeDataSelectExecutor::spreadMarkRangesAmongStreamsFinal
         RangesInDataPart & part = parts[part_index];
 
         BlockInputStreamPtr source_stream = std::make_shared<MergeTreeBlockInputStream>(
-            data, part.data_part, max_block_size, settings.preferred_block_size_bytes,
+            data, part.data_part, max_block_size, preferred_block_size_bytes,
             settings.preferred_max_column_in_block_size_bytes, column_names, part.ranges, use_uncompressed_cache,
-            prewhere_info, true, settings.min_bytes_to_use_direct_io, settings.max_read_buffer_size, true,
-            virt_columns, part.part_index_in_query);
+            prewhere_info, prewhere_read_steps, prewhere_steps_stats, true, settings.min_bytes_to_use_direct_io, settings.min_bytes_to_use_mmap_io,
+            settings.max_read_buffer_size, true,
+            virt_columns, part.part_index_in_query, false, settings.apply_deleted_mask,
+            settings.deferred_checksum_verification);
 
-        to_merge.emplace_back(std::make_shared<ExpressionBlockInputStream>(source_stream, data.getPrimaryExpression()));
+        size_t group_index = 0;
+        if (settings.do_not_merge_across_partitions_select_final)
+        {
+            auto emplaced = group_by_partition.emplace(part.data_part->info.partition_id, to_merge_groups.size());
+            if (emplaced.second)
+                to_merge_groups.emplace_back();
+            group_index = emplaced.first->second;
+        }
+        else if (to_merge_groups.empty())
+            to_merge_groups.emplace_back();
+
+        to_merge_groups[group_index].emplace_back(std::make_shared<ExpressionBlockInputStream>(source_stream, data.getPrimaryExpression()));
     }
 
     Names sort_columns = data.getSortColumns();
@@ -789,46 +1213,52 @@ BlockInputStreams MergeTreeDataSelectExecutor::spreadMarkRangesAmongStreamsFinal
     size_t sort_columns_size = sort_columns.size();
     sort_description.reserve(sort_columns_size);
 
-    Block header = to_merge.at(0)->getHeader();
+    Block header = to_merge_groups.at(0).at(0)->getHeader();
     for (size_t i = 0; i < sort_columns_size; ++i)
         sort_description.emplace_back(header.getPositionByName(sort_columns[i]), 1, 1);
 
-    BlockInputStreamPtr merged;
-    switch (data.merging_params.mode)
+    BlockInputStreams res;
+    for (auto & to_merge : to_merge_groups)
     {
-        case MergeTreeData::MergingParams::Ordinary:
-            merged = std::make_shared<MergingSortedBlockInputStream>(to_merge, sort_description, max_block_size);
-            break;
-
-        case MergeTreeData::MergingParams::Collapsing:
-            merged = std::make_shared<CollapsingFinalBlockInputStream>(
-                    to_merge, sort_description, data.merging_params.sign_column);
-            break;
-
-        case MergeTreeData::MergingParams::Summing:
-            merged = std::make_shared<SummingSortedBlockInputStream>(to_merge,
-                    sort_description, data.merging_params.columns_to_sum, max_block_size);
-            break;
-
-        case MergeTreeData::MergingParams::Aggregating:
-            merged = std::make_shared<AggregatingSortedBlockInputStream>(to_merge, sort_description, max_block_size);
-            break;
-
-        case MergeTreeData::MergingParams::Replacing:    /// TODO Make ReplacingFinalBlockInputStream
-            merged = std::make_shared<ReplacingSortedBlockInputStream>(to_merge,
-                    sort_description, data.merging_params.version_column, max_block_size);
-            break;
-
-        case MergeTreeData::MergingParams::VersionedCollapsing: /// TODO Make VersionedCollapsingFinalBlockInputStream
-            merged = std::make_shared<VersionedCollapsingSortedBlockInputStream>(
-                    to_merge, sort_description, data.merging_params.sign_column, max_block_size);
-            break;
+        BlockInputStreamPtr merged;
+        switch (data.merging_params.mode)
+        {
+            case MergeTreeData::MergingParams::Ordinary:
+                merged = std::make_shared<MergingSortedBlockInputStream>(to_merge, sort_description, max_block_size);
+                break;
+
+            case MergeTreeData::MergingParams::Collapsing:
+                merged = std::make_shared<CollapsingFinalBlockInputStream>(
+                        to_merge, sort_description, data.merging_params.sign_column);
+                break;
+
+            case MergeTreeData::MergingParams::Summing:
+                merged = std::make_shared<SummingSortedBlockInputStream>(to_merge,
+                        sort_description, data.merging_params.columns_to_sum, max_block_size);
+                break;
+
+            case MergeTreeData::MergingParams::Aggregating:
+                merged = std::make_shared<AggregatingSortedBlockInputStream>(to_merge, sort_description, max_block_size);
+                break;
+
+            case MergeTreeData::MergingParams::Replacing:    /// TODO Make ReplacingFinalBlockInputStream
+                merged = std::make_shared<ReplacingSortedBlockInputStream>(to_merge,
+                        sort_description, data.merging_params.version_column, max_block_size);
+                break;
+
+            case MergeTreeData::MergingParams::VersionedCollapsing: /// TODO Make VersionedCollapsingFinalBlockInputStream
+                merged = std::make_shared<VersionedCollapsingSortedBlockInputStream>(
+                        to_merge, sort_description, data.merging_params.sign_column, max_block_size);
+                break;
+
+            case MergeTreeData::MergingParams::Graphite:
+                throw Exception("GraphiteMergeTree doesn't support FINAL", ErrorCodes::LOGICAL_ERROR);
+        }
 
-        case MergeTreeData::MergingParams::Graphite:
-            throw Exception("GraphiteMergeTree doesn't support FINAL", ErrorCodes::LOGICAL_ERROR);
+        res.emplace_back(merged);
     }
 
-    return {merged};
+    return res;
 }
 
 
@@ -857,7 +1287,8 @@ void MergeTreeDataSelectExecutor::createPositiveSignCondition(
 /// Calculates a set of mark ranges, that could possibly contain keys, required by condition.
 /// In other words, it removes subranges from whole range, that definitely could not contain required keys.
 MarkRanges MergeTreeDataSelectExecutor::markRangesFromPKRange(
-    const MergeTreeData::DataPart::Index & index, const KeyCondition & key_condition, const Settings & settings) const
+    const MergeTreeData::DataPart::Index & index, const KeyCondition & key_condition,
+    const DataTypes & key_data_types, const Settings & settings) const
 {
     MarkRanges res;
 
@@ -900,7 +1331,7 @@ MarkRanges MergeTreeDataSelectExecutor::markRangesFromPKRange(
                 }
 
                 may_be_true = key_condition.mayBeTrueAfter(
-                    used_key_size, index_left.data(), data.primary_key_data_types);
+                    used_key_size, index_left.data(), key_data_types);
             }
             else
             {
@@ -911,7 +1342,7 @@ MarkRanges MergeTreeDataSelectExecutor::markRangesFromPKRange(
                 }
 
                 may_be_true = key_condition.mayBeTrueInRange(
-                    used_key_size, index_left.data(), index_right.data(), data.primary_key_data_types);
+                    used_key_size, index_left.data(), index_right.data(), key_data_types);
             }
 
             if (!may_be_true)
@@ -942,4 +1373,54 @@ MarkRanges MergeTreeDataSelectExecutor::markRangesFromPKRange(
     return res;
 }
 
+
+MarkRanges MergeTreeDataSelectExecutor::filterMarkRangesBySkipIndices(
+    const MergeTreeData::DataPartPtr & part,
+    const MarkRanges & ranges,
+    const std::vector<std::pair<size_t, KeyCondition>> & skip_index_conditions) const
+{
+    MarkRanges res = ranges;
+
+    for (const auto & index_pos_and_condition : skip_index_conditions)
+    {
+        size_t i = index_pos_and_condition.first;
+
+        MergeTreeMinMaxGranuleIndex index(data.skip_minmax_idx_columns[i], data.skip_minmax_idx_column_types[i]);
+
+        /// Parts written before the index was configured have no index file.
+        if (!index.load(part->getFullPath()))
+            continue;
+
+        res = index.filterRanges(res, index_pos_and_condition.second);
+        if (res.empty())
+            break;
+    }
+
+    return res;
+}
+
+
+MarkRanges MergeTreeDataSelectExecutor::filterMarkRangesByNgramIndices(
+    const MergeTreeData::DataPartPtr & part,
+    const MarkRanges & ranges,
+    const std::vector<std::pair<String, std::vector<String>>> & ngram_index_substrings) const
+{
+    MarkRanges res = ranges;
+
+    for (const auto & column_and_substrings : ngram_index_substrings)
+    {
+        MergeTreeNgramGranuleIndex index(column_and_substrings.first);
+
+        /// Parts written before the index was configured have no index file.
+        if (!index.load(part->getFullPath()))
+            continue;
+
+        res = index.filterRanges(res, column_and_substrings.second);
+        if (res.empty())
+            break;
+    }
+
+    return res;
+}
+
 }
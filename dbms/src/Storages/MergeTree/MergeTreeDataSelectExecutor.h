@@ -3,6 +3,7 @@
 #include <Core/QueryProcessingStage.h>
 #include <Storages/SelectQueryInfo.h>
 #include <Storages/MergeTree/MergeTreeData.h>
+#include <Storages/MergeTree/MergeTreeBlockReadUtils.h>
 #include <Storages/MergeTree/RangesInDataPart.h>
 
 
@@ -51,17 +52,38 @@ private:
         size_t num_streams,
         const Names & column_names,
         size_t max_block_size,
+        size_t preferred_block_size_bytes,
         bool use_uncompressed_cache,
         const PrewhereInfoPtr & prewhere_info,
+        const PrewhereReadStepsPtr & prewhere_read_steps,
+        const PrewhereStepsStatsPtr & prewhere_steps_stats,
         const Names & virt_columns,
         const Settings & settings) const;
 
+    /// One stream per part, reading its ranges in (reverse, if direction < 0) sorting key order.
+    /// Used when the ORDER BY of the query is a prefix of the sorting key (see read_in_order_direction).
+    BlockInputStreams spreadMarkRangesAmongStreamsInOrder(
+        RangesInDataParts && parts,
+        const Names & column_names,
+        size_t max_block_size,
+        size_t preferred_block_size_bytes,
+        bool use_uncompressed_cache,
+        const PrewhereInfoPtr & prewhere_info,
+        const PrewhereReadStepsPtr & prewhere_read_steps,
+        const PrewhereStepsStatsPtr & prewhere_steps_stats,
+        const Names & virt_columns,
+        const Settings & settings,
+        int direction) const;
+
     BlockInputStreams spreadMarkRangesAmongStreamsFinal(
         RangesInDataParts && parts,
         const Names & column_names,
         size_t max_block_size,
+        size_t preferred_block_size_bytes,
         bool use_uncompressed_cache,
         const PrewhereInfoPtr & prewhere_info,
+        const PrewhereReadStepsPtr & prewhere_read_steps,
+        const PrewhereStepsStatsPtr & prewhere_steps_stats,
         const Names & virt_columns,
         const Settings & settings) const;
 
@@ -77,10 +99,28 @@ private:
         String & out_column,
         const Context & context) const;
 
+    /// `key_data_types` are the types of the key the index and the condition are over:
+    /// the primary key of the table, or the projection sort key for projection layouts.
     MarkRanges markRangesFromPKRange(
         const MergeTreeData::DataPart::Index & index,
         const KeyCondition & key_condition,
+        const DataTypes & key_data_types,
         const Settings & settings) const;
+
+    /// Drop granules of `ranges` that cannot satisfy the conditions on columns with
+    /// per-granule min-max skip indices. Each pair is (position in data.skip_minmax_idx_columns, condition).
+    MarkRanges filterMarkRangesBySkipIndices(
+        const MergeTreeData::DataPartPtr & part,
+        const MarkRanges & ranges,
+        const std::vector<std::pair<size_t, KeyCondition>> & skip_index_conditions) const;
+
+    /// Drop granules of `ranges` whose n-gram bloom filter index proves that some substring
+    /// the query requires to occur in the column is absent. Each pair is
+    /// (column with an n-gram bloom filter index, required substrings).
+    MarkRanges filterMarkRangesByNgramIndices(
+        const MergeTreeData::DataPartPtr & part,
+        const MarkRanges & ranges,
+        const std::vector<std::pair<String, std::vector<String>>> & ngram_index_substrings) const;
 };
 
 }
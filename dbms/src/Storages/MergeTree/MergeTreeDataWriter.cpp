@@ -127,7 +127,7 @@ BlocksWithPartition MergeTreeDataWriter::splitBlockIntoParts(const Block & block
     return result;
 }
 
-MergeTreeData::MutableDataPartPtr MergeTreeDataWriter::writeTempPart(BlockWithPartition & block_with_partition)
+MergeTreeData::MutableDataPartPtr MergeTreeDataWriter::writeTempPart(BlockWithPartition & block_with_partition, bool allow_in_memory)
 {
     Block & block = block_with_partition.block;
 
@@ -167,18 +167,6 @@ MergeTreeData::MutableDataPartPtr MergeTreeDataWriter::writeTempPart(BlockWithPa
     new_data_part->relative_path = TMP_PREFIX + part_name;
     new_data_part->is_temp = true;
 
-    /// The name could be non-unique in case of stale files from previous runs.
-    String full_path = new_data_part->getFullPath();
-    Poco::File dir(full_path);
-
-    if (dir.exists())
-    {
-        LOG_WARNING(log, "Removing old temporary directory " + full_path);
-        dir.remove(true);
-    }
-
-    dir.createDirectories();
-
     /// If we need to calculate some columns to sort.
     if (data.hasPrimaryKey())
     {
@@ -212,12 +200,44 @@ MergeTreeData::MutableDataPartPtr MergeTreeDataWriter::writeTempPart(BlockWithPa
             ProfileEvents::increment(ProfileEvents::MergeTreeDataWriterBlocksAlreadySorted);
     }
 
+    NamesAndTypesList columns = data.getColumns().getAllPhysical().filter(block.getNames());
+
+    /// Small blocks may be kept in RAM instead of being written to disk (the caller then makes
+    /// them durable through the write-ahead log).
+    if (allow_in_memory && data.settings.min_bytes_for_on_disk_part
+        && block.bytes() < data.settings.min_bytes_for_on_disk_part)
+    {
+        if (perm_ptr)
+            for (size_t i = 0; i < block.columns(); ++i)
+                block.getByPosition(i).column = block.getByPosition(i).column->permute(perm, 0);
+
+        new_data_part->columns = columns;
+        new_data_part->setInMemoryBlock(std::move(block));
+
+        ProfileEvents::increment(ProfileEvents::MergeTreeDataWriterRows, new_data_part->rows_count);
+        ProfileEvents::increment(ProfileEvents::MergeTreeDataWriterUncompressedBytes, new_data_part->in_memory_block.bytes());
+
+        return new_data_part;
+    }
+
+    /// The name could be non-unique in case of stale files from previous runs.
+    String full_path = new_data_part->getFullPath();
+    Poco::File dir(full_path);
+
+    if (dir.exists())
+    {
+        LOG_WARNING(log, "Removing old temporary directory " + full_path);
+        dir.remove(true);
+    }
+
+    dir.createDirectories();
+
     /// This effectively chooses minimal compression method:
     ///  either default lz4 or compression method with zero thresholds on absolute and relative part size.
     auto compression_settings = data.context.chooseCompressionSettings(0, 0);
 
-    NamesAndTypesList columns = data.getColumns().getAllPhysical().filter(block.getNames());
-    MergedBlockOutputStream out(data, new_data_part->getFullPath(), columns, compression_settings);
+    /// Only inserts may produce compact parts (see min_bytes_for_wide_part): merges always write the wide format.
+    MergedBlockOutputStream out(data, new_data_part->getFullPath(), columns, compression_settings, true);
 
     out.writePrefix();
     out.writeWithPermutation(block, perm_ptr);
@@ -45,8 +45,11 @@ public:
 
     /** All rows must correspond to same partition.
       * Returns part with unique name starting with 'tmp_', yet not added to MergeTreeData.
+      * If `allow_in_memory` is set and the block is smaller than the min_bytes_for_on_disk_part
+      *  setting, the returned part is kept in RAM and nothing is written to disk (the caller is
+      *  responsible for logging it to the write-ahead log).
       */
-    MergeTreeData::MutableDataPartPtr writeTempPart(BlockWithPartition & block);
+    MergeTreeData::MutableDataPartPtr writeTempPart(BlockWithPartition & block, bool allow_in_memory = false);
 
 private:
     MergeTreeData & data;
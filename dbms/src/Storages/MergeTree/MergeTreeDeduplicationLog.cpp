@@ -0,0 +1,149 @@
+#include <Storages/MergeTree/MergeTreeDeduplicationLog.h>
+
+#include <IO/ReadBufferFromFile.h>
+#include <IO/ReadHelpers.h>
+#include <IO/WriteHelpers.h>
+
+#include <Poco/File.h>
+
+
+namespace DB
+{
+
+MergeTreeDeduplicationLog::MergeTreeDeduplicationLog(const String & storage_path, size_t deduplication_window_, const String & log_name)
+    : path(storage_path + DEDUPLICATION_LOG_FILE_NAME)
+    , deduplication_window(deduplication_window_)
+    , log(&Logger::get(log_name + " (DeduplicationLog)"))
+{
+    load();
+
+    out = std::make_unique<WriteBufferFromFile>(path, DBMS_DEFAULT_BUFFER_SIZE, O_WRONLY | O_APPEND | O_CREAT);
+}
+
+
+void MergeTreeDeduplicationLog::load()
+{
+    if (!Poco::File(path).exists())
+        return;
+
+    ReadBufferFromFile in(path);
+
+    while (!in.eof())
+    {
+        UInt64 operation = 0;
+        String block_id;
+
+        readIntText(operation, in);
+        assertChar('\t', in);
+        readString(block_id, in);
+        assertChar('\n', in);
+
+        ++records_written;
+
+        if (operation == ADD)
+        {
+            auto it = block_ids.find(block_id);
+            if (it != block_ids.end())
+                continue;
+
+            queue.push_back(block_id);
+            block_ids[block_id] = std::prev(queue.end());
+
+            if (queue.size() > deduplication_window)
+            {
+                block_ids.erase(queue.front());
+                queue.pop_front();
+            }
+        }
+        else
+        {
+            auto it = block_ids.find(block_id);
+            if (it != block_ids.end())
+            {
+                queue.erase(it->second);
+                block_ids.erase(it);
+            }
+        }
+    }
+
+    LOG_DEBUG(log, "Loaded " << queue.size() << " block ids of the deduplication window");
+}
+
+
+void MergeTreeDeduplicationLog::writeRecord(Operation operation, const String & block_id)
+{
+    writeIntText(static_cast<UInt64>(operation), *out);
+    writeChar('\t', *out);
+    writeString(block_id, *out);
+    writeChar('\n', *out);
+    out->next();
+
+    ++records_written;
+
+    if (records_written >= 2 * deduplication_window && records_written > queue.size())
+        rotate();
+}
+
+
+void MergeTreeDeduplicationLog::rotate()
+{
+    String tmp_path = path + ".tmp";
+
+    {
+        WriteBufferFromFile tmp_out(tmp_path);
+        for (const auto & block_id : queue)
+        {
+            writeIntText(static_cast<UInt64>(ADD), tmp_out);
+            writeChar('\t', tmp_out);
+            writeString(block_id, tmp_out);
+            writeChar('\n', tmp_out);
+        }
+        tmp_out.sync();
+    }
+
+    out.reset();
+    Poco::File(tmp_path).renameTo(path);
+    out = std::make_unique<WriteBufferFromFile>(path, DBMS_DEFAULT_BUFFER_SIZE, O_WRONLY | O_APPEND | O_CREAT);
+
+    records_written = queue.size();
+}
+
+
+bool MergeTreeDeduplicationLog::containsBlockId(const String & block_id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return block_ids.count(block_id);
+}
+
+
+bool MergeTreeDeduplicationLog::addBlockId(const String & block_id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (block_ids.count(block_id))
+        return false;
+
+    queue.push_back(block_id);
+    block_ids[block_id] = std::prev(queue.end());
+
+    if (queue.size() > deduplication_window)
+    {
+        block_ids.erase(queue.front());
+        queue.pop_front();
+    }
+
+    writeRecord(ADD, block_id);
+    return true;
+}
+
+
+void MergeTreeDeduplicationLog::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    queue.clear();
+    block_ids.clear();
+    rotate();
+}
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <Core/Types.h>
+#include <IO/WriteBufferFromFile.h>
+#include <common/logger_useful.h>
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+
+namespace DB
+{
+
+/** A bounded persistent log of block ids of recent inserts into a non-replicated MergeTree table.
+  * Gives plain MergeTree the same deduplication-window semantics that ReplicatedMergeTree gets
+  *  from the /blocks nodes in ZooKeeper, so client retries of an insert do not produce duplicates.
+  *
+  * The log is a text file ('deduplication_log.txt') in the table directory with one record per
+  *  line: an operation (1 - add, 2 - drop) and a block id. A record is appended and flushed to
+  *  the OS right after the part of the insert is committed (see renameTempPartAndReplace); when
+  *  the file accumulates twice the window of records, it is rewritten with only the ids still
+  *  inside the window.
+  */
+class MergeTreeDeduplicationLog
+{
+public:
+    static constexpr auto DEDUPLICATION_LOG_FILE_NAME = "deduplication_log.txt";
+
+    MergeTreeDeduplicationLog(const String & storage_path, size_t deduplication_window_, const String & log_name);
+
+    /// Whether the block id is in the window, i.e. the block is a duplicate of a recent insert.
+    bool containsBlockId(const String & block_id);
+
+    /// Remember a block id. Returns false if the id was already in the window.
+    /// The caller serializes the check and the add with the commit of the part (the parts lock in
+    ///  MergeTreeData::renameTempPartAndReplace) and records the id strictly after the commit, so
+    ///  that a crash in between errs toward a duplicate insert rather than a lost one.
+    bool addBlockId(const String & block_id);
+
+    /// Forget all block ids (used by TRUNCATE: removed data is expected to be insertable again).
+    void clear();
+
+private:
+    enum Operation : UInt8
+    {
+        ADD = 1,
+        DROP = 2,
+    };
+
+    /// Replays the log file into the in-memory window. Called once from the constructor.
+    void load();
+
+    /// Rewrites the log file with only the ids of the current window. Called with the mutex held.
+    void rotate();
+
+    void writeRecord(Operation operation, const String & block_id);
+
+    const String path;
+    const size_t deduplication_window;
+
+    std::mutex mutex;
+
+    /// Block ids of the window, oldest first, and their positions in the list.
+    std::list<String> queue;
+    std::unordered_map<String, std::list<String>::iterator> block_ids;
+
+    size_t records_written = 0;
+    std::unique_ptr<WriteBufferFromFile> out;
+
+    Logger * log;
+};
+
+}
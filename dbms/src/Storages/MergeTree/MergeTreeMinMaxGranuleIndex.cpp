@@ -0,0 +1,165 @@
+#include <Storages/MergeTree/MergeTreeMinMaxGranuleIndex.h>
+
+#include <Columns/IColumn.h>
+#include <Common/escapeForFileName.h>
+#include <IO/HashingWriteBuffer.h>
+#include <IO/ReadBufferFromFile.h>
+#include <IO/WriteBufferFromFile.h>
+#include <IO/VarInt.h>
+#include <Poco/File.h>
+
+#include <optional>
+
+
+namespace DB
+{
+
+String MergeTreeMinMaxGranuleIndex::getFileName(const String & column_name)
+{
+    return "skp_minmax_" + escapeForFileName(column_name) + ".idx";
+}
+
+
+void MergeTreeMinMaxGranuleIndex::update(const IColumn & column, size_t granularity)
+{
+    size_t rows = column.size();
+    size_t pos = 0;
+
+    while (pos < rows)
+    {
+        size_t limit = std::min(rows - pos, granularity - rows_in_current_granule);
+
+        Field min_value;
+        Field max_value;
+        column.cut(pos, limit)->getExtremes(min_value, max_value);
+
+        if (rows_in_current_granule == 0)
+        {
+            current_min = min_value;
+            current_max = max_value;
+        }
+        else
+        {
+            current_min = std::min(current_min, min_value);
+            current_max = std::max(current_max, max_value);
+        }
+
+        rows_in_current_granule += limit;
+        pos += limit;
+
+        if (rows_in_current_granule == granularity)
+            finishCurrentGranule();
+    }
+}
+
+
+void MergeTreeMinMaxGranuleIndex::finishCurrentGranule()
+{
+    granules.emplace_back(current_min, true, current_max, true);
+    rows_in_current_granule = 0;
+}
+
+
+void MergeTreeMinMaxGranuleIndex::store(const String & part_path, MergeTreeDataPartChecksums & checksums)
+{
+    if (rows_in_current_granule)
+        finishCurrentGranule();
+
+    String file_name = getFileName(column_name);
+
+    WriteBufferFromFile out(part_path + file_name);
+    HashingWriteBuffer out_hashing(out);
+
+    writeVarUInt(granules.size(), out_hashing);
+    for (const Range & granule : granules)
+    {
+        type->serializeBinary(granule.left, out_hashing);
+        type->serializeBinary(granule.right, out_hashing);
+    }
+
+    out_hashing.next();
+    checksums.files[file_name].file_size = out_hashing.count();
+    checksums.files[file_name].file_hash = out_hashing.getHash();
+}
+
+
+bool MergeTreeMinMaxGranuleIndex::load(const String & part_path)
+{
+    String file_path = part_path + getFileName(column_name);
+    if (!Poco::File(file_path).exists())
+        return false;
+
+    ReadBufferFromFile file(file_path,
+        std::min(static_cast<Poco::File::FileSize>(DBMS_DEFAULT_BUFFER_SIZE), Poco::File(file_path).getSize()));
+
+    size_t num_granules = 0;
+    readVarUInt(num_granules, file);
+    granules.reserve(num_granules);
+
+    for (size_t i = 0; i < num_granules; ++i)
+    {
+        Field min_value;
+        type->deserializeBinary(min_value, file);
+        Field max_value;
+        type->deserializeBinary(max_value, file);
+
+        granules.emplace_back(min_value, true, max_value, true);
+    }
+
+    return true;
+}
+
+
+bool MergeTreeMinMaxGranuleIndex::getTotalRange(Field & min_value, Field & max_value) const
+{
+    if (granules.empty())
+        return false;
+
+    min_value = granules.front().left;
+    max_value = granules.front().right;
+
+    for (const Range & granule : granules)
+    {
+        min_value = std::min(min_value, granule.left);
+        max_value = std::max(max_value, granule.right);
+    }
+
+    return true;
+}
+
+
+MarkRanges MergeTreeMinMaxGranuleIndex::filterRanges(const MarkRanges & ranges, const KeyCondition & condition) const
+{
+    MarkRanges res;
+    DataTypes types{type};
+
+    for (const MarkRange & range : ranges)
+    {
+        std::optional<size_t> current_begin;
+
+        for (size_t mark = range.begin; mark < range.end; ++mark)
+        {
+            /// If the index is shorter than the part for some reason, do not skip anything.
+            bool may_be_true = mark >= granules.size()
+                || condition.mayBeTrueInParallelogram({granules[mark]}, types);
+
+            if (may_be_true)
+            {
+                if (!current_begin)
+                    current_begin = mark;
+            }
+            else if (current_begin)
+            {
+                res.push_back(MarkRange(*current_begin, mark));
+                current_begin.reset();
+            }
+        }
+
+        if (current_begin)
+            res.push_back(MarkRange(*current_begin, range.end));
+    }
+
+    return res;
+}
+
+}
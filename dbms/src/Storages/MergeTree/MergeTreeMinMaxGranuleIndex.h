@@ -0,0 +1,66 @@
+#pragma once
+
+#include <Core/Field.h>
+#include <DataTypes/IDataType.h>
+#include <Storages/MergeTree/KeyCondition.h>
+#include <Storages/MergeTree/MarkRange.h>
+#include <Storages/MergeTree/MergeTreeDataPartChecksum.h>
+
+
+namespace DB
+{
+
+/** Per-granule min-max index for a single column.
+  * It is stored in the part directory as skp_minmax_<column>.idx alongside marks:
+  *  for every granule of `index_granularity` rows it keeps the minimum and maximum
+  *  value of the column. During range selection granules for which a condition on
+  *  the column cannot be satisfied are skipped before any column data is read.
+  *
+  * Which columns get such an index is controlled by the `skip_index_minmax_columns`
+  * MergeTree setting. Parts written before the setting was added simply have no
+  * index file and are read as usual.
+  */
+class MergeTreeMinMaxGranuleIndex
+{
+public:
+    MergeTreeMinMaxGranuleIndex(const String & column_name_, const DataTypePtr & type_)
+        : column_name(column_name_), type(type_) {}
+
+    static String getFileName(const String & column_name);
+
+    /// Accumulate min-max values for the next rows of the column being written.
+    /// Rows are accounted from the beginning of the part, so granule boundaries
+    /// here always coincide with marks.
+    void update(const IColumn & column, size_t granularity);
+
+    /// Finish the last (possibly incomplete) granule and write the index file.
+    void store(const String & part_path, MergeTreeDataPartChecksums & checksums);
+
+    /// Returns false if the part has no index file for this column (e.g. an old part).
+    bool load(const String & part_path);
+
+    /// Leave only the granules of `ranges` where `condition` may be true.
+    MarkRanges filterRanges(const MarkRanges & ranges, const KeyCondition & condition) const;
+
+    size_t size() const { return granules.size(); }
+
+    /// Min and max of the whole part: the fold of all granules.
+    /// Returns false if the index is empty.
+    bool getTotalRange(Field & min_value, Field & max_value) const;
+
+private:
+    String column_name;
+    DataTypePtr type;
+
+    /// Min-max range per granule, in granule order.
+    std::vector<Range> granules;
+
+    /// Writer state for the granule being accumulated.
+    size_t rows_in_current_granule = 0;
+    Field current_min;
+    Field current_max;
+
+    void finishCurrentGranule();
+};
+
+}
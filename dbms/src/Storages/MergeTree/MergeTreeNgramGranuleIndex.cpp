@@ -0,0 +1,321 @@
+#include <Storages/MergeTree/MergeTreeNgramGranuleIndex.h>
+
+#include <Columns/ColumnString.h>
+#include <Common/escapeForFileName.h>
+#include <Common/typeid_cast.h>
+#include <IO/HashingWriteBuffer.h>
+#include <IO/ReadBufferFromFile.h>
+#include <IO/WriteBufferFromFile.h>
+#include <IO/VarInt.h>
+#include <Parsers/ASTFunction.h>
+#include <Parsers/ASTIdentifier.h>
+#include <Parsers/ASTLiteral.h>
+#include <Parsers/ASTSelectQuery.h>
+#include <Storages/SelectQueryInfo.h>
+#include <Poco/File.h>
+#include <city.h>
+
+#include <optional>
+
+
+namespace DB
+{
+
+String MergeTreeNgramGranuleIndex::getFileName(const String & column_name)
+{
+    return "skp_ngrambf_" + escapeForFileName(column_name) + ".idx";
+}
+
+
+void MergeTreeNgramGranuleIndex::addNgrams(BloomFilter & filter, const char * data, size_t size)
+{
+    if (size < NGRAM_SIZE)
+        return;
+
+    for (size_t pos = 0; pos + NGRAM_SIZE <= size; ++pos)
+    {
+        UInt64 h1 = CityHash_v1_0_2::CityHash64WithSeed(data + pos, NGRAM_SIZE, 0);
+        UInt64 h2 = CityHash_v1_0_2::CityHash64WithSeed(data + pos, NGRAM_SIZE, 0x0B6A5D6E9F8C3A71ULL);
+
+        for (size_t i = 0; i < BLOOM_FILTER_HASHES; ++i)
+        {
+            size_t bit = (h1 + i * h2) % (BLOOM_FILTER_BYTES * 8);
+            filter[bit / 8] |= 1 << (bit % 8);
+        }
+    }
+}
+
+
+bool MergeTreeNgramGranuleIndex::mayContain(const BloomFilter & filter, const String & substring)
+{
+    if (substring.size() < NGRAM_SIZE)
+        return true;
+
+    for (size_t pos = 0; pos + NGRAM_SIZE <= substring.size(); ++pos)
+    {
+        UInt64 h1 = CityHash_v1_0_2::CityHash64WithSeed(substring.data() + pos, NGRAM_SIZE, 0);
+        UInt64 h2 = CityHash_v1_0_2::CityHash64WithSeed(substring.data() + pos, NGRAM_SIZE, 0x0B6A5D6E9F8C3A71ULL);
+
+        for (size_t i = 0; i < BLOOM_FILTER_HASHES; ++i)
+        {
+            size_t bit = (h1 + i * h2) % (BLOOM_FILTER_BYTES * 8);
+            if (!(filter[bit / 8] & (1 << (bit % 8))))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+
+void MergeTreeNgramGranuleIndex::update(const IColumn & column, size_t granularity)
+{
+    const ColumnString & column_string = typeid_cast<const ColumnString &>(column);
+
+    size_t rows = column_string.size();
+    size_t pos = 0;
+
+    while (pos < rows)
+    {
+        size_t limit = std::min(rows - pos, granularity - rows_in_current_granule);
+
+        for (size_t i = 0; i < limit; ++i)
+        {
+            StringRef value = column_string.getDataAt(pos + i);
+            addNgrams(current_filter, value.data, value.size);
+        }
+
+        rows_in_current_granule += limit;
+        pos += limit;
+
+        if (rows_in_current_granule == granularity)
+            finishCurrentGranule();
+    }
+}
+
+
+void MergeTreeNgramGranuleIndex::finishCurrentGranule()
+{
+    granules.push_back(std::move(current_filter));
+    current_filter.assign(BLOOM_FILTER_BYTES, 0);
+    rows_in_current_granule = 0;
+}
+
+
+void MergeTreeNgramGranuleIndex::store(const String & part_path, MergeTreeDataPartChecksums & checksums)
+{
+    if (rows_in_current_granule)
+        finishCurrentGranule();
+
+    String file_name = getFileName(column_name);
+
+    WriteBufferFromFile out(part_path + file_name);
+    HashingWriteBuffer out_hashing(out);
+
+    writeVarUInt(NGRAM_SIZE, out_hashing);
+    writeVarUInt(BLOOM_FILTER_BYTES, out_hashing);
+    writeVarUInt(BLOOM_FILTER_HASHES, out_hashing);
+    writeVarUInt(granules.size(), out_hashing);
+    for (const BloomFilter & granule : granules)
+        out_hashing.write(reinterpret_cast<const char *>(granule.data()), granule.size());
+
+    out_hashing.next();
+    checksums.files[file_name].file_size = out_hashing.count();
+    checksums.files[file_name].file_hash = out_hashing.getHash();
+}
+
+
+bool MergeTreeNgramGranuleIndex::load(const String & part_path)
+{
+    String file_path = part_path + getFileName(column_name);
+    if (!Poco::File(file_path).exists())
+        return false;
+
+    ReadBufferFromFile file(file_path);
+
+    size_t ngram_size = 0;
+    size_t filter_bytes = 0;
+    size_t filter_hashes = 0;
+    readVarUInt(ngram_size, file);
+    readVarUInt(filter_bytes, file);
+    readVarUInt(filter_hashes, file);
+
+    /// A file written with different filter parameters is unusable; read as if there is no index.
+    if (ngram_size != NGRAM_SIZE || filter_bytes != BLOOM_FILTER_BYTES || filter_hashes != BLOOM_FILTER_HASHES)
+        return false;
+
+    size_t num_granules = 0;
+    readVarUInt(num_granules, file);
+    granules.resize(num_granules);
+
+    for (auto & granule : granules)
+    {
+        granule.resize(BLOOM_FILTER_BYTES);
+        file.readStrict(reinterpret_cast<char *>(granule.data()), BLOOM_FILTER_BYTES);
+    }
+
+    return true;
+}
+
+
+MarkRanges MergeTreeNgramGranuleIndex::filterRanges(const MarkRanges & ranges, const std::vector<String> & required_substrings) const
+{
+    MarkRanges res;
+
+    for (const MarkRange & range : ranges)
+    {
+        std::optional<size_t> current_begin;
+
+        for (size_t mark = range.begin; mark < range.end; ++mark)
+        {
+            /// If the index is shorter than the part for some reason, do not skip anything.
+            bool may_be_true = mark >= granules.size();
+
+            if (!may_be_true)
+            {
+                may_be_true = true;
+                for (const String & substring : required_substrings)
+                {
+                    if (!mayContain(granules[mark], substring))
+                    {
+                        may_be_true = false;
+                        break;
+                    }
+                }
+            }
+
+            if (may_be_true)
+            {
+                if (!current_begin)
+                    current_begin = mark;
+            }
+            else if (current_begin)
+            {
+                res.push_back(MarkRange(*current_begin, mark));
+                current_begin.reset();
+            }
+        }
+
+        if (current_begin)
+            res.push_back(MarkRange(*current_begin, range.end));
+    }
+
+    return res;
+}
+
+
+static void appendLiteralsFromLikePattern(const String & pattern, std::vector<String> & out)
+{
+    String current;
+
+    for (size_t i = 0; i < pattern.size(); ++i)
+    {
+        char c = pattern[i];
+        if (c == '\\' && i + 1 < pattern.size())
+        {
+            current += pattern[++i];
+        }
+        else if (c == '%' || c == '_')
+        {
+            if (current.size() >= MergeTreeNgramGranuleIndex::NGRAM_SIZE)
+                out.push_back(current);
+            current.clear();
+        }
+        else
+            current += c;
+    }
+
+    if (current.size() >= MergeTreeNgramGranuleIndex::NGRAM_SIZE)
+        out.push_back(current);
+}
+
+
+/// For a two-argument function of the column and a string constant, returns the constant.
+static std::optional<String> getConstNeedle(const ASTFunction & func, const String & column_name)
+{
+    if (!func.arguments || func.arguments->children.size() != 2)
+        return {};
+
+    const ASTIdentifier * identifier = typeid_cast<const ASTIdentifier *>(func.arguments->children[0].get());
+    const ASTLiteral * literal = typeid_cast<const ASTLiteral *>(func.arguments->children[1].get());
+
+    /// Only equals is symmetric; for like and position the column must be the haystack.
+    if (!identifier && func.name == "equals")
+    {
+        identifier = typeid_cast<const ASTIdentifier *>(func.arguments->children[1].get());
+        literal = typeid_cast<const ASTLiteral *>(func.arguments->children[0].get());
+    }
+
+    if (!identifier || identifier->name != column_name
+        || !literal || literal->value.getType() != Field::Types::String)
+        return {};
+
+    return literal->value.get<String>();
+}
+
+
+static void collectConjuncts(const ASTPtr & node, std::vector<const ASTFunction *> & atoms)
+{
+    const ASTFunction * func = typeid_cast<const ASTFunction *>(node.get());
+    if (!func)
+        return;
+
+    if (func->name == "and")
+    {
+        for (const auto & child : func->arguments->children)
+            collectConjuncts(child, atoms);
+    }
+    else
+        atoms.push_back(func);
+}
+
+
+std::vector<String> MergeTreeNgramGranuleIndex::extractRequiredSubstrings(
+    const SelectQueryInfo & query_info, const String & column_name)
+{
+    std::vector<String> res;
+
+    const ASTSelectQuery & select = typeid_cast<const ASTSelectQuery &>(*query_info.query);
+
+    std::vector<const ASTFunction *> atoms;
+    if (select.where_expression)
+        collectConjuncts(select.where_expression, atoms);
+    if (select.prewhere_expression)
+        collectConjuncts(select.prewhere_expression, atoms);
+
+    for (const ASTFunction * atom : atoms)
+    {
+        if (atom->name == "like")
+        {
+            if (auto pattern = getConstNeedle(*atom, column_name))
+                appendLiteralsFromLikePattern(*pattern, res);
+        }
+        else if (atom->name == "equals" || atom->name == "position")
+        {
+            /// position(column, 'needle') as a conjunct means it is non-zero, i.e. "contains".
+            if (auto needle = getConstNeedle(*atom, column_name))
+                if (needle->size() >= NGRAM_SIZE)
+                    res.push_back(*needle);
+        }
+        else if (atom->name == "greater" || atom->name == "notEquals")
+        {
+            /// position(column, 'needle') > 0 and position(column, 'needle') != 0 also mean "contains".
+            const auto & args = atom->arguments->children;
+            if (args.size() != 2)
+                continue;
+
+            const ASTFunction * position = typeid_cast<const ASTFunction *>(args[0].get());
+            const ASTLiteral * zero = typeid_cast<const ASTLiteral *>(args[1].get());
+
+            if (position && position->name == "position"
+                && zero && zero->value.getType() == Field::Types::UInt64 && zero->value.get<UInt64>() == 0)
+                if (auto needle = getConstNeedle(*position, column_name))
+                    if (needle->size() >= NGRAM_SIZE)
+                        res.push_back(*needle);
+        }
+    }
+
+    return res;
+}
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <Core/Types.h>
+#include <Storages/MergeTree/MarkRange.h>
+#include <Storages/MergeTree/MergeTreeDataPartChecksum.h>
+
+#include <vector>
+
+
+namespace DB
+{
+
+class IColumn;
+struct SelectQueryInfo;
+
+/** Per-granule n-gram bloom filter index for a String column, for `LIKE '%needle%'`
+  * style text search. It is stored in the part directory as skp_ngrambf_<column>.idx:
+  *  for every granule of `index_granularity` rows it keeps a bloom filter over all
+  *  4-grams of the column values. A granule can be skipped when some substring that
+  *  must occur in the column has a 4-gram that is certainly absent from the filter.
+  *
+  * N-grams are used instead of whole tokens because a token at the edge of a LIKE
+  * pattern may continue in the data ('%foo bar%' matches 'xfoo bar'), so for the
+  * typical single-needle pattern a token index could require nothing at all.
+  *
+  * Which columns get such an index is controlled by the `skip_index_ngrambf_columns`
+  * MergeTree setting. Parts written before the setting was added simply have no
+  * index file and are read as usual.
+  */
+class MergeTreeNgramGranuleIndex
+{
+public:
+    static constexpr size_t NGRAM_SIZE = 4;
+
+    /// Text granules hold many distinct n-grams, so the filter is sized generously:
+    /// 4 bytes per row at the default granularity of 8192. Two hash functions keep
+    /// the false positive rate reasonable even for rather saturated filters.
+    static constexpr size_t BLOOM_FILTER_BYTES = 32768;
+    static constexpr size_t BLOOM_FILTER_HASHES = 2;
+
+    MergeTreeNgramGranuleIndex(const String & column_name_) : column_name(column_name_) {}
+
+    static String getFileName(const String & column_name);
+
+    /** Extract from WHERE and PREWHERE the substrings that must occur in the column for
+      * the query to match: literal runs of LIKE patterns, `equals` constants and
+      * `position` needles. Only top-level conjuncts are used; anything under OR or NOT
+      * is ignored. Substrings shorter than NGRAM_SIZE cannot be checked and are dropped.
+      */
+    static std::vector<String> extractRequiredSubstrings(const SelectQueryInfo & query_info, const String & column_name);
+
+    /// Accumulate n-grams of the next rows of the column being written.
+    /// Rows are accounted from the beginning of the part, so granule boundaries
+    /// here always coincide with marks.
+    void update(const IColumn & column, size_t granularity);
+
+    /// Finish the last (possibly incomplete) granule and write the index file.
+    void store(const String & part_path, MergeTreeDataPartChecksums & checksums);
+
+    /// Returns false if the part has no index file for this column (e.g. an old part)
+    /// or the file was written with different filter parameters.
+    bool load(const String & part_path);
+
+    /// Leave only the granules of `ranges` that may contain all of `required_substrings`.
+    MarkRanges filterRanges(const MarkRanges & ranges, const std::vector<String> & required_substrings) const;
+
+    size_t size() const { return granules.size(); }
+
+private:
+    using BloomFilter = std::vector<UInt8>;
+
+    String column_name;
+
+    /// Bloom filter per granule, in granule order.
+    std::vector<BloomFilter> granules;
+
+    /// Writer state for the granule being accumulated.
+    size_t rows_in_current_granule = 0;
+    BloomFilter current_filter = BloomFilter(BLOOM_FILTER_BYTES, 0);
+
+    void finishCurrentGranule();
+
+    static void addNgrams(BloomFilter & filter, const char * data, size_t size);
+    static bool mayContain(const BloomFilter & filter, const String & substring);
+};
+
+}
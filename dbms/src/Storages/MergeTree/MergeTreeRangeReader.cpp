@@ -1,6 +1,9 @@
 #include <Storages/MergeTree/MergeTreeReader.h>
+#include <Storages/MergeTree/MergeTreeBlockReadUtils.h>
+#include <Common/Stopwatch.h>
 #include <Columns/FilterDescription.h>
 #include <Columns/ColumnsCommon.h>
+#include <Columns/ColumnsNumber.h>
 #include <Columns/ColumnNothing.h>
 #include <ext/range.h>
 #include <DataTypes/DataTypeNothing.h>
@@ -210,6 +213,7 @@ void MergeTreeRangeReader::ReadResult::clear()
     /// Need to save information about the number of granules.
     num_rows_to_skip_in_last_granule += rows_per_granule.back();
     rows_per_granule.assign(rows_per_granule.size(), 0);
+    granule_head_skips.clear();
     total_rows_per_granule = 0;
     filter_holder = nullptr;
     filter = nullptr;
@@ -235,19 +239,23 @@ void MergeTreeRangeReader::ReadResult::optimize()
         return;
     }
 
+    NumRows zero_heads;
+    auto total_zero_rows_in_heads = countZeroHeads(filter->getData(), zero_heads, zero_tails);
+
     /// Just a guess. If only a few rows may be skipped, it's better not to skip at all.
-    if (2 * total_zero_rows_in_tails > filter->size())
+    if (2 * (total_zero_rows_in_tails + total_zero_rows_in_heads) > filter->size())
     {
 
-        auto new_filter = ColumnUInt8::create(filter->size() - total_zero_rows_in_tails);
+        auto new_filter = ColumnUInt8::create(filter->size() - total_zero_rows_in_tails - total_zero_rows_in_heads);
         IColumn::Filter & new_data = new_filter->getData();
 
         size_t rows_in_last_granule = rows_per_granule.back();
 
-        collapseZeroTails(filter->getData(), new_data, zero_tails);
+        collapseZeroHeadsAndTails(filter->getData(), new_data, zero_heads, zero_tails);
 
         total_rows_per_granule = new_filter->size();
-        num_rows_to_skip_in_last_granule += rows_in_last_granule - rows_per_granule.back();
+        /// Only the tail of the last granule was left unread; its head is skipped by the stream itself.
+        num_rows_to_skip_in_last_granule += rows_in_last_granule - rows_per_granule.back() - zero_heads.back();
 
         filter = new_filter.get();
         filter_holder = std::move(new_filter);
@@ -274,24 +282,52 @@ size_t MergeTreeRangeReader::ReadResult::countZeroTails(const IColumn::Filter &
     return total_zero_rows_in_tails;
 }
 
-void MergeTreeRangeReader::ReadResult::collapseZeroTails(const IColumn::Filter & filter, IColumn::Filter & new_filter,
-                                                         const NumRows & zero_tails)
+size_t MergeTreeRangeReader::ReadResult::countZeroHeads(const IColumn::Filter & filter, NumRows & zero_heads,
+                                                        const NumRows & zero_tails) const
+{
+    zero_heads.resize(0);
+    zero_heads.reserve(rows_per_granule.size());
+
+    auto filter_data = filter.data();
+
+    size_t total_zero_rows_in_heads = 0;
+
+    for (auto i : ext::range(0, rows_per_granule.size()))
+    {
+        /// Count the number of zeros at the beginning of filter for rows were read from current granule.
+        /// The tail is excluded so that a fully filtered granule is not counted twice.
+        zero_heads.push_back(numZerosInHead(filter_data, filter_data + rows_per_granule[i] - zero_tails[i]));
+        total_zero_rows_in_heads += zero_heads.back();
+        filter_data += rows_per_granule[i];
+    }
+
+    return total_zero_rows_in_heads;
+}
+
+void MergeTreeRangeReader::ReadResult::collapseZeroHeadsAndTails(const IColumn::Filter & filter, IColumn::Filter & new_filter,
+                                                                 const NumRows & zero_heads, const NumRows & zero_tails)
 {
     auto filter_data = filter.data();
     auto new_filter_data = new_filter.data();
 
+    /// Head skips accumulate over the chain: each reader seeks from the granule boundary.
+    if (granule_head_skips.empty())
+        granule_head_skips.assign(rows_per_granule.size(), 0);
+
     for (auto i : ext::range(0, rows_per_granule.size()))
     {
         auto & rows_to_read = rows_per_granule[i];
+        auto filtered_rows_num_at_granule_begin = zero_heads[i];
         auto filtered_rows_num_at_granule_end = zero_tails[i];
 
-        rows_to_read -= filtered_rows_num_at_granule_end;
+        auto rows_to_copy = rows_to_read - filtered_rows_num_at_granule_begin - filtered_rows_num_at_granule_end;
 
-        memcpySmallAllowReadWriteOverflow15(new_filter_data, filter_data, rows_to_read);
+        memcpySmallAllowReadWriteOverflow15(new_filter_data, filter_data + filtered_rows_num_at_granule_begin, rows_to_copy);
+        new_filter_data += rows_to_copy;
         filter_data += rows_to_read;
-        new_filter_data += rows_to_read;
 
-        filter_data += filtered_rows_num_at_granule_end;
+        rows_to_read = rows_to_copy;
+        granule_head_skips[i] += filtered_rows_num_at_granule_begin;
     }
 
     new_filter.resize(new_filter_data - new_filter.data());
@@ -337,6 +373,49 @@ size_t MergeTreeRangeReader::ReadResult::numZerosInTail(const UInt8 * begin, con
     return count;
 }
 
+size_t MergeTreeRangeReader::ReadResult::numZerosInHead(const UInt8 * begin, const UInt8 * end)
+{
+    size_t count = 0;
+
+#if __SSE2__ && __POPCNT__
+    const __m128i zero16 = _mm_setzero_si128();
+    while (end - begin >= 64)
+    {
+        auto pos = begin;
+        UInt64 val =
+                static_cast<UInt64>(_mm_movemask_epi8(_mm_cmpgt_epi8(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(pos)),
+                        zero16)))
+                | (static_cast<UInt64>(_mm_movemask_epi8(_mm_cmpgt_epi8(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(pos + 16)),
+                        zero16))) << 16)
+                | (static_cast<UInt64>(_mm_movemask_epi8(_mm_cmpgt_epi8(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(pos + 32)),
+                        zero16))) << 32)
+                | (static_cast<UInt64>(_mm_movemask_epi8(_mm_cmpgt_epi8(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i *>(pos + 48)),
+                        zero16))) << 48);
+        if (val == 0)
+        {
+            count += 64;
+            begin += 64;
+        }
+        else
+        {
+            count += __builtin_ctzll(val);
+            return count;
+        }
+    }
+#endif
+
+    while (begin < end && *begin == 0)
+    {
+        ++count;
+        ++begin;
+    }
+    return count;
+}
+
 void MergeTreeRangeReader::ReadResult::setFilter(const ColumnPtr & new_filter)
 {
     if (!new_filter && filter)
@@ -369,10 +448,12 @@ MergeTreeRangeReader::MergeTreeRangeReader(
         MergeTreeReader * merge_tree_reader, size_t index_granularity, MergeTreeRangeReader * prev_reader,
         ExpressionActionsPtr alias_actions, ExpressionActionsPtr prewhere_actions,
         const String * prewhere_column_name, const Names * ordered_names,
-        bool always_reorder, bool remove_prewhere_column, bool last_reader_in_chain)
+        bool always_reorder, bool remove_prewhere_column, bool last_reader_in_chain,
+        PrewhereStepStats * step_stats)
         : index_granularity(index_granularity), merge_tree_reader(merge_tree_reader)
         , prev_reader(prev_reader), prewhere_column_name(prewhere_column_name)
         , ordered_names(ordered_names), alias_actions(alias_actions), prewhere_actions(std::move(prewhere_actions))
+        , step_stats(step_stats)
         , always_reorder(always_reorder), remove_prewhere_column(remove_prewhere_column)
         , last_reader_in_chain(last_reader_in_chain), is_initialized(true)
 {
@@ -505,6 +586,10 @@ MergeTreeRangeReader::ReadResult MergeTreeRangeReader::startReadingChain(size_t
 {
     ReadResult result;
 
+    const IColumn::Filter * deleted_mask = merge_tree_reader->getDeletedMask();
+    /// Part row numbers the granules of result were read from. Only filled if there is a mask to apply.
+    std::vector<size_t> granule_start_rows;
+
     /// Stream is lazy. result.num_added_rows is the number of rows added to block which is not equal to
     /// result.num_rows_read until call to stream.finalize(). Also result.num_added_rows may be less than
     /// result.num_rows_read if the last granule in range also the last in part (so we have to adjust last granule).
@@ -520,6 +605,9 @@ MergeTreeRangeReader::ReadResult MergeTreeRangeReader::startReadingChain(size_t
                 ranges.pop_back();
             }
 
+            if (deleted_mask)
+                granule_start_rows.push_back(stream.currentPosition());
+
             auto rows_to_read = std::min(space_left, stream.numPendingRowsInCurrentGranule());
             bool last = rows_to_read == space_left;
             result.addRows(stream.read(result.block, rows_to_read, !last));
@@ -533,9 +621,51 @@ MergeTreeRangeReader::ReadResult MergeTreeRangeReader::startReadingChain(size_t
     /// Last granule may be incomplete.
     result.adjustLastGranule();
 
+    if (deleted_mask)
+        applyDeletedMask(*deleted_mask, granule_start_rows, result);
+
     return result;
 }
 
+void MergeTreeRangeReader::applyDeletedMask(const IColumn::Filter & deleted_mask,
+    const std::vector<size_t> & granule_start_rows, ReadResult & result)
+{
+    if (result.totalRowsPerGranule() == 0)
+        return;
+
+    auto keep_column = ColumnUInt8::create(result.totalRowsPerGranule());
+    IColumn::Filter & keep = keep_column->getData();
+
+    const auto & rows_per_granule = result.rowsPerGranule();
+    size_t pos = 0;
+    size_t num_kept_rows = 0;
+    for (auto i : ext::range(0, rows_per_granule.size()))
+    {
+        const UInt8 * deleted = deleted_mask.data() + granule_start_rows[i];
+        for (size_t row = 0; row < rows_per_granule[i]; ++row, ++pos)
+        {
+            keep[pos] = !deleted[row];
+            num_kept_rows += keep[pos];
+        }
+    }
+
+    /// No deleted rows in the read ranges.
+    if (num_kept_rows == keep.size())
+        return;
+
+    if (num_kept_rows == 0)
+    {
+        result.clear();
+        result.block.clear();
+        return;
+    }
+
+    /// The rest of the chain (prewhere steps, if any) will combine its filters with this one
+    /// the same way as with a filter of a previous prewhere step.
+    result.setFilter(ColumnPtr(std::move(keep_column)));
+    filterBlock(result.block, result.getFilter()->getData());
+}
+
 Block MergeTreeRangeReader::continueReadingChain(ReadResult & result)
 {
     Block block;
@@ -549,6 +679,7 @@ Block MergeTreeRangeReader::continueReadingChain(ReadResult & result)
     }
 
     auto & rows_per_granule = result.rowsPerGranule();
+    auto & granule_head_skips = result.granuleHeadSkips();
     auto & started_ranges = result.startedRanges();
 
     size_t added_rows = 0;
@@ -566,6 +697,10 @@ Block MergeTreeRangeReader::continueReadingChain(ReadResult & result)
             stream = Stream(range.begin, range.end, index_granularity, merge_tree_reader);
         }
 
+        /// Seek to the first interesting row of the granule (see ReadResult::optimize).
+        if (!granule_head_skips.empty() && granule_head_skips[i])
+            stream.skip(granule_head_skips[i]);
+
         bool last = i + 1 == size;
         added_rows += stream.read(block, rows_per_granule[i], !last);
     }
@@ -581,33 +716,85 @@ Block MergeTreeRangeReader::continueReadingChain(ReadResult & result)
     return block;
 }
 
+/// The second filter has the size equal to the number of '1' bytes in the first one.
+/// Scatters its values over the '1' positions of the first filter, so the result has the size of the
+/// first filter and contains '1' only at positions where both filters do.
+static ColumnPtr combineFilters(const IColumn::Filter & first, const IColumn::Filter & second)
+{
+    if (countBytesInFilter(first) != second.size())
+        throw Exception("Cannot combine filters because number of '1' bytes in the first filter ("
+                        + toString(countBytesInFilter(first)) + ") doesn't match the size of the second filter ("
+                        + toString(second.size()) + ").", ErrorCodes::LOGICAL_ERROR);
+
+    auto combined = ColumnUInt8::create(first.size());
+    auto & combined_data = combined->getData();
+
+    size_t position = 0;
+    for (size_t i = 0; i < first.size(); ++i)
+        combined_data[i] = first[i] ? second[position++] : 0;
+
+    return combined;
+}
+
 void MergeTreeRangeReader::executePrewhereActionsAndFilterColumns(ReadResult & result)
 {
     if (!prewhere_actions)
         return;
 
+    /// Columns that are constant throughout the part become ColumnConst for the time of expression
+    ///  execution: a condition on them folds into a constant filter for the whole block.
+    Names part_constant_columns = merge_tree_reader->replacePartConstantColumns(result.block);
+
     if (alias_actions)
         alias_actions->execute(result.block);
 
+    Stopwatch watch;
     prewhere_actions->execute(result.block);
     auto & prewhere_column = result.block.getByName(*prewhere_column_name);
     size_t prev_rows = result.block.rows();
     ColumnPtr filter = prewhere_column.column;
     prewhere_column.column = nullptr;
 
+    if (step_stats)
+    {
+        ConstantFilterDescription constant_description(*filter);
+        size_t passed_rows = prev_rows;
+        if (constant_description.always_false)
+            passed_rows = 0;
+        else if (!constant_description.always_true)
+            passed_rows = countBytesInFilter(*FilterDescription(*filter).data);
+
+        step_stats->update(prev_rows, passed_rows, watch.elapsed());
+    }
+
+    /// Whether the just calculated filter is true for all rows of the block (then the block is not filtered).
+    bool filter_always_true = false;
+
     if (result.getFilter())
     {
-        /// TODO: implement for prewhere chain.
-        /// In order to do it we need combine filter and result.filter, where filter filters only '1' in result.filter.
-        throw Exception("MergeTreeRangeReader chain with several prewhere actions in not implemented.",
-                        ErrorCodes::LOGICAL_ERROR);
+        /// The block rows correspond to the '1' positions of the filter from the previous steps of the chain,
+        /// so the new filter is shorter. Scatter its values over those positions to combine the two filters.
+        ConstantFilterDescription constant_filter_description(*filter);
+        if (constant_filter_description.always_false)
+            result.clear();
+        else if (constant_filter_description.always_true)
+            filter_always_true = true;  /// The combined filter is the previous one.
+        else
+        {
+            FilterDescription filter_description(*filter);
+            if (filter_description.data_holder)
+                filter = filter_description.data_holder;
+            result.setFilter(combineFilters(result.getFilter()->getData(), *filter_description.data));
+        }
     }
+    else
+        result.setFilter(filter);
 
-    result.setFilter(filter);
     if (!last_reader_in_chain)
         result.optimize();
 
-    bool filter_always_true = !result.getFilter() && result.totalRowsPerGranule() == filter->size();
+    if (!filter_always_true)
+        filter_always_true = !result.getFilter() && result.totalRowsPerGranule() == filter->size();
 
     if (result.totalRowsPerGranule() == 0)
         result.block.clear();
@@ -631,6 +818,16 @@ void MergeTreeRangeReader::executePrewhereActionsAndFilterColumns(ReadResult & r
     if (!result.block)
         return;
 
+    /// Restore the full columns: the rest of the pipeline expects ordinary columns from storage.
+    for (const auto & name : part_constant_columns)
+    {
+        if (result.block.has(name))
+        {
+            auto & column = result.block.getByName(name);
+            column.column = column.column->convertToFullColumnIfConst();
+        }
+    }
+
     auto getNumRows = [&]()
     {
         /// If block has single column, it's filter. We need to count bytes in it in order to get the number of rows.
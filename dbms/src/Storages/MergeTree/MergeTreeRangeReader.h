@@ -12,6 +12,7 @@ class ColumnVector;
 using ColumnUInt8 = ColumnVector<UInt8>;
 
 class MergeTreeReader;
+struct PrewhereStepStats;
 
 /// MergeTreeReader iterator which allows sequential reading for arbitrary number of rows between pairs of marks in the same part.
 /// Stores reading state, which can be inside granule. Can skip rows in current granule and start reading from next mark.
@@ -19,10 +20,13 @@ class MergeTreeReader;
 class MergeTreeRangeReader
 {
 public:
+    /// If step_stats is set, the selectivity and the cost of the PREWHERE filter are recorded there
+    /// (used to reorder the steps of a multi-step PREWHERE while the query runs).
     MergeTreeRangeReader(MergeTreeReader * merge_tree_reader, size_t index_granularity, MergeTreeRangeReader * prev_reader,
                          ExpressionActionsPtr alias_actions, ExpressionActionsPtr prewhere_actions,
                          const String * prewhere_column_name, const Names * ordered_names,
-                         bool always_reorder, bool remove_prewhere_column, bool last_reader_in_chain);
+                         bool always_reorder, bool remove_prewhere_column, bool last_reader_in_chain,
+                         PrewhereStepStats * step_stats = nullptr);
 
     MergeTreeRangeReader() = default;
 
@@ -77,6 +81,8 @@ public:
         bool isFinished() const { return current_mark >= last_mark; }
 
         size_t numReadRowsInCurrentGranule() const { return offset_after_current_mark; }
+        /// The number of the part row the next read will start from.
+        size_t currentPosition() const { return current_mark * index_granularity + offset_after_current_mark; }
         size_t numPendingRowsInCurrentGranule() const { return index_granularity - numReadRowsInCurrentGranule(); }
         size_t numRendingGranules() const { return last_mark - current_mark; }
         size_t numPendingRows() const { return numRendingGranules() * index_granularity - offset_after_current_mark; }
@@ -112,6 +118,8 @@ public:
 
         const RangesInfo & startedRanges() const { return started_ranges; }
         const NumRows & rowsPerGranule() const { return rows_per_granule; }
+        /// For each granule, the number of rows at its beginning to skip before reading. Empty if no rows to skip.
+        const NumRows & granuleHeadSkips() const { return granule_head_skips; }
 
         /// The number of rows were read at LAST iteration in chain. <= num_added_rows + num_filtered_rows.
         size_t totalRowsPerGranule() const { return total_rows_per_granule; }
@@ -130,7 +138,9 @@ public:
 
         /// Set filter or replace old one. Filter must have more zeroes than previous.
         void setFilter(const ColumnPtr & new_filter);
-        /// For each granule calculate the number of filtered rows at the end. Remove them and update filter.
+        /// For each granule calculate the number of filtered rows at its beginning and end.
+        /// Remove them and update filter, so that the next readers in the chain seek to the first
+        /// interesting row of the granule and stop after the last one.
         void optimize();
         /// Remove all rows from granules.
         void clear();
@@ -143,6 +153,8 @@ public:
         RangesInfo started_ranges;
         /// The number of rows read from each granule.
         NumRows rows_per_granule;
+        /// The number of rows to skip at the beginning of each granule (accumulated over the chain).
+        NumRows granule_head_skips;
         /// Sum(rows_per_granule)
         size_t total_rows_per_granule = 0;
         /// The number of rows was read at first step. May be zero if no read columns present in part.
@@ -155,9 +167,12 @@ public:
         ColumnPtr filter_holder;
         const ColumnUInt8 * filter = nullptr;
 
-        void collapseZeroTails(const IColumn::Filter & filter, IColumn::Filter & new_filter, const NumRows & zero_tails);
+        void collapseZeroHeadsAndTails(const IColumn::Filter & filter, IColumn::Filter & new_filter,
+                                       const NumRows & zero_heads, const NumRows & zero_tails);
         size_t countZeroTails(const IColumn::Filter & filter, NumRows & zero_tails) const;
+        size_t countZeroHeads(const IColumn::Filter & filter, NumRows & zero_heads, const NumRows & zero_tails) const;
         static size_t numZerosInTail(const UInt8 * begin, const UInt8 * end);
+        static size_t numZerosInHead(const UInt8 * begin, const UInt8 * end);
     };
 
     ReadResult read(size_t max_rows, MarkRanges & ranges);
@@ -166,6 +181,10 @@ private:
 
     ReadResult startReadingChain(size_t max_rows, MarkRanges & ranges);
     Block continueReadingChain(ReadResult & result);
+    /// Filter out the rows of the part deleted by lightweight ALTER DELETE, as if an always-true
+    /// prewhere step was executed. granule_start_rows are part row numbers the granules of result
+    /// were read from.
+    void applyDeletedMask(const IColumn::Filter & deleted_mask, const std::vector<size_t> & granule_start_rows, ReadResult & result);
     void executePrewhereActionsAndFilterColumns(ReadResult & result);
     void filterBlock(Block & block, const IColumn::Filter & filter) const;
 
@@ -177,6 +196,7 @@ private:
     const Names * ordered_names = nullptr;
     ExpressionActionsPtr alias_actions = nullptr; /// If not nullptr, calculate aliases.
     ExpressionActionsPtr prewhere_actions = nullptr; /// If not nullptr, calculate filter.
+    PrewhereStepStats * step_stats = nullptr; /// If not nullptr, record selectivity and cost of the filter.
 
     Stream stream;
 
@@ -1,12 +1,15 @@
 #include <Storages/MergeTree/MergeTreeReadPool.h>
 #include <ext/range.h>
 #include <Storages/MergeTree/MergeTreeBaseBlockInputStream.h>
+#include <numeric>
 
 
 namespace ProfileEvents
 {
     extern const Event SlowRead;
     extern const Event ReadBackoff;
+    extern const Event ReadTasksStolen;
+    extern const Event ReadTasksShrunk;
 }
 
 namespace ErrorCodes
@@ -26,7 +29,8 @@ MergeTreeReadPool::MergeTreeReadPool(
     const bool do_not_steal_tasks)
     : backoff_settings{backoff_settings}, backoff_state{threads}, data{data},
       column_names{column_names}, do_not_steal_tasks{do_not_steal_tasks},
-      predict_block_size_bytes{preferred_block_size_bytes > 0}, prewhere_info{prewhere_info}, parts_ranges{parts}
+      predict_block_size_bytes{preferred_block_size_bytes > 0}, prewhere_info{prewhere_info},
+      threads{threads}, sum_marks_remaining{sum_marks}, parts_ranges{parts}
 {
     /// reverse from right-to-left to left-to-right
     /// because 'reverse' was done in MergeTreeDataSelectExecutor
@@ -54,8 +58,26 @@ MergeTreeReadTaskPtr MergeTreeReadPool::getTask(const size_t min_marks_to_read,
     if (!tasks_remaining_for_this_thread && do_not_steal_tasks)
         return nullptr;
 
-    /// Steal task if nothing to do and it's not prohibited
-    const auto thread_idx = tasks_remaining_for_this_thread ? thread : *std::begin(remaining_thread_tasks);
+    /// Steal task if nothing to do and it's not prohibited.
+    /// Steal from the thread with the most marks left: it is the one lagging behind.
+    auto thread_idx = thread;
+    if (!tasks_remaining_for_this_thread)
+    {
+        ProfileEvents::increment(ProfileEvents::ReadTasksStolen);
+
+        thread_idx = *std::begin(remaining_thread_tasks);
+        size_t max_marks = 0;
+        for (const auto candidate : remaining_thread_tasks)
+        {
+            const auto & marks_in_parts = threads_tasks[candidate].sum_marks_in_parts;
+            size_t marks = std::accumulate(marks_in_parts.begin(), marks_in_parts.end(), static_cast<size_t>(0));
+            if (marks > max_marks)
+            {
+                max_marks = marks;
+                thread_idx = candidate;
+            }
+        }
+    }
     auto & thread_tasks = threads_tasks[thread_idx];
 
     auto & thread_task = thread_tasks.parts_and_ranges.back();
@@ -64,12 +86,26 @@ MergeTreeReadTaskPtr MergeTreeReadPool::getTask(const size_t min_marks_to_read,
     auto & part = parts[part_idx];
     auto & marks_in_part = thread_tasks.sum_marks_in_parts.back();
 
+    /** Towards the end of the scan, hand out smaller tasks, so that a thread hitting a dense or
+      *  uncached range does not grind a large final task while the other threads idle.
+      */
+    size_t marks_to_read = min_marks_to_read;
+    if (min_marks_to_read > 1 && sum_marks_remaining < 2 * threads * min_marks_to_read)
+    {
+        marks_to_read = std::max(
+            std::min(min_marks_to_read, sum_marks_remaining / (2 * threads)),
+            min_marks_to_read / 8 + 1);
+
+        if (marks_to_read < min_marks_to_read)
+            ProfileEvents::increment(ProfileEvents::ReadTasksShrunk);
+    }
+
     /// Get whole part to read if it is small enough.
-    auto need_marks = std::min(marks_in_part, min_marks_to_read);
+    auto need_marks = std::min(marks_in_part, marks_to_read);
 
     /// Do not leave too little rows in part for next time.
     if (marks_in_part > need_marks &&
-        marks_in_part - need_marks < min_marks_to_read)
+        marks_in_part - need_marks < marks_to_read)
         need_marks = marks_in_part;
 
     MarkRanges ranges_to_get_from_part;
@@ -85,6 +121,7 @@ MergeTreeReadTaskPtr MergeTreeReadPool::getTask(const size_t min_marks_to_read,
         ranges_to_get_from_part = thread_task.ranges;
 
         marks_in_part -= marks_to_get_from_range;
+        sum_marks_remaining -= std::min(sum_marks_remaining, marks_to_get_from_range);
 
         thread_tasks.parts_and_ranges.pop_back();
         thread_tasks.sum_marks_in_parts.pop_back();
@@ -112,6 +149,7 @@ MergeTreeReadTaskPtr MergeTreeReadPool::getTask(const size_t min_marks_to_read,
 
             marks_in_part -= marks_to_get_from_range;
             need_marks -= marks_to_get_from_range;
+            sum_marks_remaining -= std::min(sum_marks_remaining, marks_to_get_from_range);
         }
 
         /** Change order to right-to-left, for MergeTreeThreadBlockInputStream to get ranges with .pop_back()
@@ -130,6 +130,10 @@ private:
 
     std::set<size_t> remaining_thread_tasks;
 
+    /// For shrinking task sizes towards the end of the scan and for the steal heuristic (see getTask).
+    size_t threads = 0;
+    size_t sum_marks_remaining = 0;
+
     RangesInDataParts parts_ranges;
 
     mutable std::mutex mutex;
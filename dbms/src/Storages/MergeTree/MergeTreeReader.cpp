@@ -9,6 +9,8 @@
 #include <Storages/MergeTree/MergeTreeReader.h>
 #include <Common/typeid_cast.h>
 #include <Poco/File.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 
 namespace DB
@@ -19,6 +21,7 @@ namespace
     using OffsetColumns = std::map<std::string, ColumnPtr>;
 
     constexpr auto DATA_FILE_EXTENSION = ".bin";
+    constexpr auto MARKS_FILE_EXTENSION = ".mrk";
 }
 
 namespace ErrorCodes
@@ -37,20 +40,33 @@ MergeTreeReader::MergeTreeReader(const String & path,
     const MergeTreeData::DataPartPtr & data_part, const NamesAndTypesList & columns,
     UncompressedCache * uncompressed_cache, MarkCache * mark_cache, bool save_marks_in_cache,
     const MergeTreeData & storage, const MarkRanges & all_mark_ranges,
-    size_t aio_threshold, size_t max_read_buffer_size, const ValueSizeMap & avg_value_size_hints,
+    size_t aio_threshold, size_t mmap_threshold, size_t max_read_buffer_size, bool deferred_checksum_verification,
+    const ValueSizeMap & avg_value_size_hints,
     const ReadBufferFromFileBase::ProfileCallback & profile_callback,
-    clockid_t clock_type)
+    clockid_t clock_type,
+    bool apply_deleted_mask_)
     : avg_value_size_hints(avg_value_size_hints), path(path), data_part(data_part), columns(columns)
     , uncompressed_cache(uncompressed_cache), mark_cache(mark_cache), save_marks_in_cache(save_marks_in_cache), storage(storage)
-    , all_mark_ranges(all_mark_ranges), aio_threshold(aio_threshold), max_read_buffer_size(max_read_buffer_size), index_granularity(storage.index_granularity)
+    , all_mark_ranges(all_mark_ranges), aio_threshold(aio_threshold), mmap_threshold(mmap_threshold), max_read_buffer_size(max_read_buffer_size)
+    , deferred_checksum_verification(deferred_checksum_verification), index_granularity(data_part->index_granularity)
+    , apply_deleted_mask(apply_deleted_mask_)
 {
     try
     {
-        if (!Poco::File(path).exists())
-            throw Exception("Part " + path + " is missing", ErrorCodes::NOT_FOUND_EXPECTED_DATA_PART);
+        if (mmap_threshold)
+            mmap_cache = storage.context.getMMappedFileCache();
 
-        for (const NameAndTypePair & column : columns)
-            addStreams(column.name, *column.type, all_mark_ranges, profile_callback, clock_type);
+        compressed_block_cache = storage.context.getCompressedBlockCache();
+
+        /// In-memory parts are read directly from the block kept in RAM, no streams are needed.
+        if (!data_part->is_in_memory)
+        {
+            if (!Poco::File(path).exists())
+                throw Exception("Part " + path + " is missing", ErrorCodes::NOT_FOUND_EXPECTED_DATA_PART);
+
+            for (const NameAndTypePair & column : columns)
+                addStreams(column.name, *column.type, all_mark_ranges, profile_callback, clock_type);
+        }
     }
     catch (...)
     {
@@ -68,6 +84,9 @@ const MergeTreeReader::ValueSizeMap & MergeTreeReader::getAvgValueSizeHints() co
 
 size_t MergeTreeReader::readRows(size_t from_mark, bool continue_reading, size_t max_rows_to_read, Block & res)
 {
+    if (data_part->is_in_memory)
+        return readRowsFromInMemoryBlock(from_mark, continue_reading, max_rows_to_read, res);
+
     size_t read_rows = 0;
     try
     {
@@ -156,14 +175,52 @@ size_t MergeTreeReader::readRows(size_t from_mark, bool continue_reading, size_t
 }
 
 
+size_t MergeTreeReader::readRowsFromInMemoryBlock(size_t from_mark, bool continue_reading, size_t max_rows_to_read, Block & res)
+{
+    const Block & block = data_part->in_memory_block;
+
+    size_t start_row = continue_reading ? in_memory_position : from_mark * index_granularity;
+    if (start_row >= block.rows())
+        return 0;
+
+    size_t rows_to_read = std::min(max_rows_to_read, block.rows() - start_row);
+
+    for (const NameAndTypePair & it : columns)
+    {
+        /// Missing columns will be added by fillMissingColumns.
+        if (!block.has(it.name))
+            continue;
+
+        const ColumnPtr & source = block.getByName(it.name).column;
+
+        if (res.has(it.name))
+        {
+            /// The column is already present in the block so we will append the values to the end.
+            MutableColumnPtr column = res.getByName(it.name).column->assumeMutable();
+            column->insertRangeFrom(*source, start_row, rows_to_read);
+            res.getByName(it.name).column = std::move(column);
+        }
+        else
+            res.insert(ColumnWithTypeAndName(source->cut(start_row, rows_to_read), it.type, it.name));
+    }
+
+    in_memory_position = start_row + rows_to_read;
+    return rows_to_read;
+}
+
+
 MergeTreeReader::Stream::Stream(
-    const String & path_prefix_, const String & extension_, size_t marks_count_,
+    const String & path_prefix_, const String & data_file_path_, size_t marks_count_,
     const MarkRanges & all_mark_ranges,
     MarkCache * mark_cache_, bool save_marks_in_cache_,
     UncompressedCache * uncompressed_cache,
-    size_t aio_threshold, size_t max_read_buffer_size,
+    size_t aio_threshold, size_t mmap_threshold, MMappedFileCache * mmap_cache,
+    CompressedBlockCache * compressed_block_cache,
+    size_t max_read_buffer_size, bool read_ahead,
+    bool deferred_checksum_verification,
     const ReadBufferFromFileBase::ProfileCallback & profile_callback, clockid_t clock_type)
-    : path_prefix(path_prefix_), extension(extension_), marks_count(marks_count_)
+    : path_prefix(path_prefix_), data_file_path(data_file_path_)
+    , data_file_is_shared(data_file_path_ != path_prefix_ + DATA_FILE_EXTENSION), marks_count(marks_count_)
     , mark_cache(mark_cache_), save_marks_in_cache(save_marks_in_cache_)
 {
     /// Compute the size of the buffer.
@@ -209,7 +266,7 @@ MergeTreeReader::Stream::Stream(
 
     /// Estimate size of the data to be read.
     size_t estimated_size = 0;
-    if (aio_threshold > 0)
+    if (aio_threshold > 0 || mmap_threshold > 0)
     {
         for (const auto & mark_range : all_mark_ranges)
         {
@@ -219,18 +276,25 @@ MergeTreeReader::Stream::Stream(
 
             size_t offset_end = (mark_range.end < marks_count)
                 ? getMark(mark_range.end).offset_in_compressed_file
-                : Poco::File(path_prefix + extension).getSize();
+                : Poco::File(data_file_path).getSize();
 
             if (offset_end > offset_begin)
                 estimated_size += offset_end - offset_begin;
         }
     }
 
+    /// When the data will be read through the page cache, advise the kernel to read the requested
+    /// ranges ahead of time, overlapping cold reads of subsequent ranges with decompression and
+    /// filtering of the current one. Pointless for direct IO, which bypasses the page cache.
+    if (read_ahead && !(aio_threshold > 0 && estimated_size >= aio_threshold))
+        readAhead(all_mark_ranges);
+
     /// Initialize the objects that shall be used to perform read operations.
-    if (uncompressed_cache)
+    if (uncompressed_cache || compressed_block_cache)
     {
         auto buffer = std::make_unique<CachedCompressedReadBuffer>(
-            path_prefix + extension, uncompressed_cache, estimated_size, aio_threshold, buffer_size);
+            data_file_path, uncompressed_cache, estimated_size, aio_threshold, buffer_size, mmap_threshold, mmap_cache,
+            compressed_block_cache);
 
         if (profile_callback)
             buffer->setProfileCallback(profile_callback, clock_type);
@@ -241,7 +305,12 @@ MergeTreeReader::Stream::Stream(
     else
     {
         auto buffer = std::make_unique<CompressedReadBufferFromFile>(
-            path_prefix + extension, estimated_size, aio_threshold, buffer_size);
+            data_file_path, estimated_size, aio_threshold, buffer_size, mmap_threshold, mmap_cache);
+
+        /// Not applied to the cached buffer: a block whose checksum has not been verified yet
+        /// must not get into the cache of decompressed blocks.
+        if (deferred_checksum_verification)
+            buffer->deferChecksumming();
 
         if (profile_callback)
             buffer->setProfileCallback(profile_callback, clock_type);
@@ -252,6 +321,56 @@ MergeTreeReader::Stream::Stream(
 }
 
 
+void MergeTreeReader::Stream::readAhead(const MarkRanges & all_mark_ranges)
+{
+#if defined(POSIX_FADV_WILLNEED)
+    int fd = ::open(data_file_path.c_str(), O_RDONLY);
+
+    /// The advice is only a hint: if the file cannot be opened here, the error will be properly
+    /// reported on the actual read.
+    if (-1 == fd)
+        return;
+
+    for (const auto & mark_range : all_mark_ranges)
+    {
+        /// When the whole file is read, the usual kernel read-ahead works well without the advice.
+        if (mark_range.begin == 0 && mark_range.end >= marks_count)
+            continue;
+
+        size_t offset_begin = (mark_range.begin > 0)
+            ? getMark(mark_range.begin).offset_in_compressed_file
+            : 0;
+
+        /// If the end of range is inside the compressed block, we will need to read it too.
+        size_t right = mark_range.end;
+        if (right < marks_count && getMark(right).offset_in_decompressed_block > 0)
+        {
+            while (right < marks_count
+                   && getMark(right).offset_in_compressed_file == getMark(mark_range.end).offset_in_compressed_file)
+                ++right;
+        }
+
+        /// Zero length advises reading until the end of the file.
+        size_t length = 0;
+        if (right < marks_count)
+        {
+            size_t offset_end = getMark(right).offset_in_compressed_file;
+            if (offset_end <= offset_begin)
+                continue;
+            length = offset_end - offset_begin;
+        }
+
+        /// Initiates an asynchronous read into the page cache and returns without blocking.
+        ::posix_fadvise(fd, offset_begin, length, POSIX_FADV_WILLNEED);
+    }
+
+    ::close(fd);
+#else
+    (void) all_mark_ranges;
+#endif
+}
+
+
 const MarkInCompressedFile & MergeTreeReader::Stream::getMark(size_t index)
 {
     if (!marks)
@@ -336,6 +455,13 @@ void MergeTreeReader::Stream::seekToMark(size_t index)
 
 void MergeTreeReader::Stream::seekToStart()
 {
+    /// In the shared data file of a compact part, data of this stream begins at its first mark, not at offset 0.
+    if (data_file_is_shared)
+    {
+        seekToMark(0);
+        return;
+    }
+
     try
     {
         if (cached_buffer)
@@ -364,7 +490,19 @@ void MergeTreeReader::addStreams(const String & name, const IDataType & type, co
         if (streams.count(stream_name))
             return;
 
-        bool data_file_exists = Poco::File(path + stream_name + DATA_FILE_EXTENSION).exists();
+        String data_file_path = path + stream_name + DATA_FILE_EXTENSION;
+        bool data_file_exists = Poco::File(data_file_path).exists();
+
+        /// Compact parts store data of all streams in the single shared data.bin; mark files remain per-stream
+        /// and their offsets point inside the shared file. A mutation may leave some streams with their own
+        /// data file even in a compact part, so the per-stream file takes precedence.
+        if (!data_file_exists
+            && Poco::File(path + "data.bin").exists()
+            && Poco::File(path + stream_name + MARKS_FILE_EXTENSION).exists())
+        {
+            data_file_path = path + "data.bin";
+            data_file_exists = true;
+        }
 
         /** If data file is missing then we will not try to open it.
           * It is necessary since it allows to add new column to structure of the table without creating new files for old parts.
@@ -373,9 +511,11 @@ void MergeTreeReader::addStreams(const String & name, const IDataType & type, co
             return;
 
         streams.emplace(stream_name, std::make_unique<Stream>(
-            path + stream_name, DATA_FILE_EXTENSION, data_part->marks_count,
+            path + stream_name, data_file_path, data_part->marks_count,
             all_mark_ranges, mark_cache, save_marks_in_cache,
-            uncompressed_cache, aio_threshold, max_read_buffer_size, profile_callback, clock_type));
+            uncompressed_cache, aio_threshold, mmap_threshold, mmap_cache.get(), compressed_block_cache.get(), max_read_buffer_size,
+            storage.settings.read_ahead_mark_ranges, deferred_checksum_verification,
+            profile_callback, clock_type));
     };
 
     IDataType::SubstreamPath path;
@@ -577,4 +717,34 @@ void MergeTreeReader::evaluateMissingDefaults(Block & res)
     }
 }
 
+Names MergeTreeReader::replacePartConstantColumns(Block & block) const
+{
+    Names replaced;
+
+    const auto & minmax_idx = data_part->minmax_idx;
+    if (!minmax_idx.initialized)
+        return replaced;
+
+    size_t num_minmax_columns = std::min(storage.minmax_idx_columns.size(), minmax_idx.parallelogram.size());
+    for (size_t i = 0; i < num_minmax_columns; ++i)
+    {
+        const Range & range = minmax_idx.parallelogram[i];
+        if (!(range.left_bounded && range.right_bounded && range.left_included && range.right_included
+            && range.left == range.right))
+            continue;
+
+        if (!block.has(storage.minmax_idx_columns[i]))
+            continue;
+
+        auto & column = block.getByName(storage.minmax_idx_columns[i]);
+        if (column.column->isColumnConst())
+            continue;
+
+        column.column = column.type->createColumnConst(column.column->size(), range.left);
+        replaced.push_back(column.name);
+    }
+
+    return replaced;
+}
+
 }
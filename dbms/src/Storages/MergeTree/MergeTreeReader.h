@@ -14,6 +14,8 @@ namespace DB
 class IDataType;
 class CachedCompressedReadBuffer;
 class CompressedReadBufferFromFile;
+class MMappedFileCache;
+class CompressedBlockCache;
 
 
 /// Reads the data between pairs of marks in the same part. When reading consecutive ranges, avoids unnecessary seeks.
@@ -31,10 +33,12 @@ public:
         MarkCache * mark_cache,
         bool save_marks_in_cache,
         const MergeTreeData & storage, const MarkRanges & all_mark_ranges,
-        size_t aio_threshold, size_t max_read_buffer_size,
+        size_t aio_threshold, size_t mmap_threshold, size_t max_read_buffer_size,
+        bool deferred_checksum_verification = false,
         const ValueSizeMap & avg_value_size_hints = ValueSizeMap{},
         const ReadBufferFromFileBase::ProfileCallback & profile_callback = ReadBufferFromFileBase::ProfileCallback{},
-        clockid_t clock_type = CLOCK_MONOTONIC_COARSE);
+        clockid_t clock_type = CLOCK_MONOTONIC_COARSE,
+        bool apply_deleted_mask_ = true);
 
     ~MergeTreeReader();
 
@@ -51,18 +55,36 @@ public:
     /// Evaluate defaulted columns if necessary.
     void evaluateMissingDefaults(Block & res);
 
+    /// Replace columns that the part's minmax index proves to be constant throughout the part
+    ///  (partition key source columns whose min equals max) with ColumnConst.
+    /// Returns the names of the replaced columns, so that the caller can convert them
+    ///  back to full columns after executing expressions on the block.
+    Names replacePartConstantColumns(Block & block) const;
+
     const NamesAndTypesList & getColumns() const { return columns; }
 
+    /// Mask of rows of the part removed by lightweight ALTER DELETE, to be applied as an implicit
+    /// filter to everything that is read. nullptr if there is no mask or it must not be applied.
+    const IColumn::Filter * getDeletedMask() const
+    {
+        return apply_deleted_mask && data_part->deleted_mask ? data_part->deleted_mask.get() : nullptr;
+    }
+
 private:
     class Stream
     {
     public:
+        /// data_file_path: full path to the file with data of this stream. For ordinary (wide) parts
+        /// it is `path_prefix + extension`; for compact parts all streams share the single data.bin.
         Stream(
-            const String & path_prefix_, const String & extension_, size_t marks_count_,
+            const String & path_prefix_, const String & data_file_path_, size_t marks_count_,
             const MarkRanges & all_mark_ranges,
             MarkCache * mark_cache, bool save_marks_in_cache,
             UncompressedCache * uncompressed_cache,
-            size_t aio_threshold, size_t max_read_buffer_size,
+            size_t aio_threshold, size_t mmap_threshold, MMappedFileCache * mmap_cache,
+            CompressedBlockCache * compressed_block_cache,
+            size_t max_read_buffer_size, bool read_ahead,
+            bool deferred_checksum_verification,
             const ReadBufferFromFileBase::ProfileCallback & profile_callback, clockid_t clock_type);
 
         void seekToMark(size_t index);
@@ -78,8 +100,15 @@ private:
 
         void loadMarks();
 
+        /// Advise the kernel to read the compressed data of the given mark ranges into the page cache
+        /// in the background, so that subsequent reads of these ranges do not stall on cold storage.
+        void readAhead(const MarkRanges & all_mark_ranges);
+
         std::string path_prefix;
-        std::string extension;
+        std::string data_file_path;
+        /// True for streams of compact parts: data of this stream is located somewhere
+        /// in the middle of the shared data file, not necessarily at its beginning.
+        bool data_file_is_shared = false;
 
         size_t marks_count;
 
@@ -114,8 +143,18 @@ private:
     const MergeTreeData & storage;
     MarkRanges all_mark_ranges;
     size_t aio_threshold;
+    /// See the 'min_bytes_to_use_mmap_io' setting.
+    size_t mmap_threshold;
+    /// The cache of memory mapped files; set only if mmap_threshold is non-zero.
+    std::shared_ptr<MMappedFileCache> mmap_cache;
+    /// The cache of compressed blocks; set only if the server has it configured (compressed_block_cache_size).
+    std::shared_ptr<CompressedBlockCache> compressed_block_cache;
     size_t max_read_buffer_size;
+    /// See the 'deferred_checksum_verification' setting. Ignored when reading through the uncompressed cache.
+    bool deferred_checksum_verification;
     size_t index_granularity;
+    /// See getDeletedMask().
+    bool apply_deleted_mask = true;
 
     void addStreams(const String & name, const IDataType & type, const MarkRanges & all_mark_ranges,
         const ReadBufferFromFileBase::ProfileCallback & profile_callback, clockid_t clock_type);
@@ -129,6 +168,12 @@ private:
     /// If continue_reading is true, continue reading from last state, otherwise seek to from_mark
     size_t readRows(size_t from_mark, bool continue_reading, size_t max_rows_to_read, Block & res);
 
+    /// The same for a part that is stored in RAM (see MergeTreeDataPart::is_in_memory).
+    size_t readRowsFromInMemoryBlock(size_t from_mark, bool continue_reading, size_t max_rows_to_read, Block & res);
+
+    /// Reading position inside in_memory_block of an in-memory part (used when continue_reading is true).
+    size_t in_memory_position = 0;
+
     friend class MergeTreeRangeReader::DelayedStream;
 };
 
@@ -0,0 +1,272 @@
+#include <Storages/MergeTree/MergeTreeReverseBlockInputStream.h>
+#include <Storages/MergeTree/MergeTreeBaseBlockInputStream.h>
+#include <Storages/MergeTree/MergeTreeReader.h>
+#include <Core/Defines.h>
+
+
+namespace DB
+{
+
+namespace ErrorCodes
+{
+    extern const int MEMORY_LIMIT_EXCEEDED;
+}
+
+
+MergeTreeReverseBlockInputStream::MergeTreeReverseBlockInputStream(
+    const MergeTreeData & storage_,
+    const MergeTreeData::DataPartPtr & owned_data_part_,
+    size_t max_block_size_rows_,
+    size_t preferred_block_size_bytes_,
+    size_t preferred_max_column_in_block_size_bytes_,
+    Names column_names,
+    const MarkRanges & mark_ranges_,
+    bool use_uncompressed_cache_,
+    const PrewhereInfoPtr & prewhere_info,
+    const PrewhereReadStepsPtr & prewhere_read_steps,
+    const PrewhereStepsStatsPtr & prewhere_steps_stats,
+    bool check_columns,
+    size_t min_bytes_to_use_direct_io_,
+    size_t min_bytes_to_use_mmap_io_,
+    size_t max_read_buffer_size_,
+    bool save_marks_in_cache_,
+    const Names & virt_column_names,
+    size_t part_index_in_query_,
+    bool quiet,
+    bool apply_deleted_mask_,
+    bool deferred_checksum_verification_)
+    :
+    MergeTreeBaseBlockInputStream{storage_, prewhere_info, prewhere_read_steps, prewhere_steps_stats, max_block_size_rows_,
+        preferred_block_size_bytes_, preferred_max_column_in_block_size_bytes_, min_bytes_to_use_direct_io_,
+        min_bytes_to_use_mmap_io_, max_read_buffer_size_, use_uncompressed_cache_, deferred_checksum_verification_,
+        save_marks_in_cache_, virt_column_names},
+    required_columns{column_names},
+    data_part{owned_data_part_},
+    part_columns_lock(data_part->columns_lock),
+    all_mark_ranges(mark_ranges_),
+    part_index_in_query(part_index_in_query_),
+    check_columns(check_columns),
+    path(data_part->getFullPath())
+{
+    apply_deleted_mask = apply_deleted_mask_;
+
+    /// Let's estimate total number of rows for progress bar.
+    for (const auto & range : all_mark_ranges)
+        total_marks_count += range.end - range.begin;
+
+    size_t total_rows = total_marks_count * data_part->index_granularity;
+
+    if (!quiet)
+        LOG_TRACE(log, "Reading " << all_mark_ranges.size() << " ranges in reverse order from part " << data_part->name
+        << ", approx. " << total_rows << " rows starting from " << all_mark_ranges.front().begin * data_part->index_granularity);
+
+    addTotalRowsApprox(total_rows);
+
+    header = storage.getSampleBlockForColumns(required_columns);
+
+    /// Types may be different during ALTER (when this stream is used to perform an ALTER).
+    for (const auto & name_type : data_part->columns)
+    {
+        if (header.has(name_type.name))
+        {
+            auto & elem = header.getByName(name_type.name);
+            if (!elem.type->equals(*name_type.type))
+            {
+                elem.type = name_type.type;
+                elem.column = elem.type->createColumn();
+            }
+        }
+    }
+
+    executePrewhereActions(header, prewhere_info);
+    injectVirtualColumns(header);
+
+    ordered_names = getHeader().getNames();
+}
+
+
+Block MergeTreeReverseBlockInputStream::getHeader() const
+{
+    return header;
+}
+
+
+bool MergeTreeReverseBlockInputStream::getNewTask()
+try
+{
+    if (all_mark_ranges.empty())
+    {
+        finish();
+        return false;
+    }
+
+    if (is_first_task)
+    {
+        is_first_task = false;
+
+        Names pre_column_names;
+        Names column_names = required_columns;
+
+        /// inject columns required for defaults evaluation
+        should_reorder = !injectRequiredColumns(storage, data_part, column_names).empty();
+
+        if (prewhere_info)
+        {
+            if (prewhere_info->alias_actions)
+                pre_column_names = prewhere_info->alias_actions->getRequiredColumns();
+            else
+                pre_column_names = prewhere_info->prewhere_actions->getRequiredColumns();
+
+            if (pre_column_names.empty())
+                pre_column_names.push_back(column_names[0]);
+
+            const auto injected_pre_columns = injectRequiredColumns(storage, data_part, pre_column_names);
+            if (!injected_pre_columns.empty())
+                should_reorder = true;
+
+            const NameSet pre_name_set(pre_column_names.begin(), pre_column_names.end());
+
+            Names post_column_names;
+            for (const auto & name : column_names)
+                if (!pre_name_set.count(name))
+                    post_column_names.push_back(name);
+
+            column_names = post_column_names;
+        }
+
+        /// will be used to distinguish between PREWHERE and WHERE columns when applying filter
+        column_name_set = NameSet{column_names.begin(), column_names.end()};
+
+        if (check_columns)
+        {
+            /// Under owned_data_part->columns_lock we check that all requested columns are of the same type as in the table.
+            /// This may be not true in case of ALTER MODIFY.
+            if (!pre_column_names.empty())
+                storage.check(data_part->columns, pre_column_names);
+            if (!column_names.empty())
+                storage.check(data_part->columns, column_names);
+
+            const NamesAndTypesList & physical_columns = storage.getColumns().getAllPhysical();
+            pre_columns = physical_columns.addTypes(pre_column_names);
+            columns = physical_columns.addTypes(column_names);
+        }
+        else
+        {
+            pre_columns = data_part->columns.addTypes(pre_column_names);
+            columns = data_part->columns.addTypes(column_names);
+        }
+
+        if (use_uncompressed_cache)
+            owned_uncompressed_cache = storage.context.getUncompressedCache();
+
+        owned_mark_cache = storage.context.getMarkCache();
+
+        reader = std::make_unique<MergeTreeReader>(
+            path, data_part, columns, owned_uncompressed_cache.get(),
+            owned_mark_cache.get(), save_marks_in_cache, storage,
+            all_mark_ranges, min_bytes_to_use_direct_io, min_bytes_to_use_mmap_io, max_read_buffer_size, deferred_checksum_verification,
+            MergeTreeReader::ValueSizeMap{}, ReadBufferFromFileBase::ProfileCallback{},
+            CLOCK_MONOTONIC_COARSE, apply_deleted_mask);
+
+        if (prewhere_info)
+        {
+            /// The step readers for the whole part are created once, so the PREWHERE step order is
+            /// chosen once here; parts read later still benefit from the statistics of this one.
+            updatePrewhereStepOrder();
+
+            std::vector<NamesAndTypesList> step_columns;
+            if (prewhere_read_steps)
+                step_columns = distributePrewhereReadColumns(data_part, pre_columns, *prewhere_read_steps, prewhere_step_order);
+            if (step_columns.empty())
+                step_columns.push_back(pre_columns);
+
+            for (const auto & columns_for_step : step_columns)
+                pre_readers.push_back(std::make_unique<MergeTreeReader>(
+                    path, data_part, columns_for_step, owned_uncompressed_cache.get(),
+                    owned_mark_cache.get(), save_marks_in_cache, storage,
+                    all_mark_ranges, min_bytes_to_use_direct_io, min_bytes_to_use_mmap_io, max_read_buffer_size, deferred_checksum_verification,
+                    MergeTreeReader::ValueSizeMap{}, ReadBufferFromFileBase::ProfileCallback{},
+                    CLOCK_MONOTONIC_COARSE, apply_deleted_mask));
+        }
+    }
+
+    /// One range per task: the ranges are taken from the last to the first one, and the blocks of
+    /// a range are returned in reverse order by readImpl.
+    MarkRanges mark_ranges_for_task = { all_mark_ranges.back() };
+    all_mark_ranges.pop_back();
+
+    auto size_predictor = (preferred_block_size_bytes == 0)
+        ? nullptr
+        : std::make_unique<MergeTreeBlockSizePredictor>(data_part, ordered_names, data_part->storage.getSampleBlock());
+
+    task = std::make_unique<MergeTreeReadTask>(
+        data_part, mark_ranges_for_task, part_index_in_query, ordered_names, column_name_set, columns, pre_columns,
+        prewhere_info && prewhere_info->remove_prewhere_column, should_reorder, std::move(size_predictor));
+
+    return true;
+}
+catch (...)
+{
+    /// Suspicion of the broken part. A part is added to the queue for verification.
+    if (getCurrentExceptionCode() != ErrorCodes::MEMORY_LIMIT_EXCEEDED)
+        storage.reportBrokenPart(data_part->name);
+    throw;
+}
+
+
+Block MergeTreeReverseBlockInputStream::readImpl()
+{
+    Block res;
+
+    if (!blocks_of_current_task.empty())
+    {
+        res = std::move(blocks_of_current_task.back());
+        blocks_of_current_task.pop_back();
+        return res;
+    }
+
+    while (blocks_of_current_task.empty() && !isCancelled())
+    {
+        if (!task && !getNewTask())
+            break;
+
+        /// Read all blocks of the current range and return them from the last to the first one.
+        while (!task->isFinished() && !isCancelled())
+        {
+            Block block = readFromPart();
+            if (block)
+            {
+                injectVirtualColumns(block);
+                blocks_of_current_task.push_back(std::move(block));
+            }
+        }
+        task.reset();
+    }
+
+    if (!blocks_of_current_task.empty())
+    {
+        res = std::move(blocks_of_current_task.back());
+        blocks_of_current_task.pop_back();
+    }
+
+    return res;
+}
+
+
+void MergeTreeReverseBlockInputStream::finish()
+{
+    /** Close the files (before destroying the object).
+    * When many sources are created, but simultaneously reading only a few of them,
+    * buffers don't waste memory.
+    */
+    reader.reset();
+    pre_readers.clear();
+    part_columns_lock.unlock();
+    data_part.reset();
+}
+
+
+MergeTreeReverseBlockInputStream::~MergeTreeReverseBlockInputStream() = default;
+
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <DataStreams/IProfilingBlockInputStream.h>
+#include <Storages/MergeTree/MergeTreeBaseBlockInputStream.h>
+#include <Storages/MergeTree/MergeTreeData.h>
+#include <Storages/MergeTree/MarkRange.h>
+#include <Storages/MergeTree/MergeTreeBlockReadUtils.h>
+#include <Storages/SelectQueryInfo.h>
+
+namespace DB
+{
+
+
+/// Used to read data from single part in reverse key order: mark ranges are processed from the
+/// last to the first one and the blocks of each range are returned back to front. Rows inside a
+/// block stay in ascending order, reverse them with ReverseBlockInputStream on top.
+/// Ranges should be small enough (about one block each), because all blocks of a range are
+/// buffered before they can be returned.
+class MergeTreeReverseBlockInputStream : public MergeTreeBaseBlockInputStream
+{
+public:
+    MergeTreeReverseBlockInputStream(
+        const MergeTreeData & storage,
+        const MergeTreeData::DataPartPtr & owned_data_part,
+        size_t max_block_size_rows,
+        size_t preferred_block_size_bytes,
+        size_t preferred_max_column_in_block_size_bytes,
+        Names column_names,
+        const MarkRanges & mark_ranges,
+        bool use_uncompressed_cache,
+        const PrewhereInfoPtr & prewhere_info,
+        const PrewhereReadStepsPtr & prewhere_read_steps,
+        const PrewhereStepsStatsPtr & prewhere_steps_stats,
+        bool check_columns,
+        size_t min_bytes_to_use_direct_io,
+        size_t min_bytes_to_use_mmap_io,
+        size_t max_read_buffer_size,
+        bool save_marks_in_cache,
+        const Names & virt_column_names = {},
+        size_t part_index_in_query = 0,
+        bool quiet = false,
+        bool apply_deleted_mask_ = true,
+        bool deferred_checksum_verification = false);
+
+    ~MergeTreeReverseBlockInputStream() override;
+
+    String getName() const override { return "MergeTreeReverse"; }
+
+    Block getHeader() const override;
+
+    /// Closes readers and unlock part locks
+    void finish();
+
+protected:
+
+    Block readImpl() override;
+
+    bool getNewTask() override;
+
+private:
+    Block header;
+
+    /// Used by Task
+    Names required_columns;
+    /// Names from header. Used in order to order columns in read blocks.
+    Names ordered_names;
+    NameSet column_name_set;
+    NamesAndTypesList columns;
+    NamesAndTypesList pre_columns;
+    bool should_reorder = false;
+
+    /// Data part will not be removed if the pointer owns it
+    MergeTreeData::DataPartPtr data_part;
+    /// Forbids to change columns list of the part during reading
+    std::shared_lock<std::shared_mutex> part_columns_lock;
+
+    /// Mark ranges not processed yet (in ascending order); consumed from the back.
+    MarkRanges all_mark_ranges;
+    /// Total number of marks we should read
+    size_t total_marks_count = 0;
+    /// Value of _part_index virtual column (used only in SelectExecutor)
+    size_t part_index_in_query = 0;
+
+    /// Blocks of the current task that were read but not returned yet (returned from the back).
+    Blocks blocks_of_current_task;
+
+    bool check_columns;
+    String path;
+    bool is_first_task = true;
+
+    Logger * log = &Logger::get("MergeTreeReverseBlockInputStream");
+};
+
+}
@@ -21,7 +21,88 @@ struct MergeTreeSettings
     /** How many rows correspond to one primary key value. */                                                 \
     M(SettingUInt64, index_granularity, 8192)                                                                 \
                                                                                                               \
-    /** Merge settings. */                                                                                    \
+    /** If non-zero, the number of rows per mark is chosen for each new part so that a granule takes           \
+     *  approximately this many bytes (estimated from the first written block), instead of a fixed            \
+     *  index_granularity. The chosen value is constant within a part and is stored with it. */               \
+    M(SettingUInt64, index_granularity_bytes, 0)                                                              \
+                                                                                                              \
+    /** Comma-separated list of columns for which a per-granule min-max index is written with each part       \
+     *  and consulted during range selection to skip granules by conditions on non-key columns. */            \
+    M(SettingString, skip_index_minmax_columns, "")                                                           \
+                                                                                                              \
+    /** Comma-separated list of String columns for which a per-granule n-gram bloom filter index is           \
+     *  written with each part and consulted to skip granules by LIKE / position substring conditions. */     \
+    M(SettingString, skip_index_ngrambf_columns, "")                                                          \
+                                                                                                              \
+    /** Comma-separated list of columns to compress with delta encoding followed by LZ4 instead of            \
+     *  the table-wide compression method. Effective for timestamps and slowly changing gauges. */            \
+    M(SettingString, delta_compression_columns, "")                                                           \
+                                                                                                              \
+    /** Comma-separated list of columns to store in the sparse format: only the row numbers and values        \
+     *  of non-default (non-zero) values are kept, compressed with LZ4. For columns dominated by zeros. */    \
+    M(SettingString, sparse_compression_columns, "")                                                          \
+                                                                                                              \
+    /** The minimum fraction of default values in a compressed block for the sparse format to be used;        \
+     *  blocks below the threshold fall back to LZ4. */                                                       \
+    M(SettingFloat, sparse_compression_min_default_ratio, 0.9)                                                \
+                                                                                                              \
+    /** How many threads are used to load data parts at server startup.                                       \
+     *  0 - the number of physical CPU cores. */                                                              \
+    M(SettingUInt64, max_part_loading_threads, 0)                                                             \
+                                                                                                              \
+    /** Do not read primary.idx of parts at startup; it will be read on first use of the part by a query.     \
+     *  Speeds up server startup and saves memory for rarely queried old parts. */                            \
+    M(SettingBool, primary_index_lazy_load, false)                                                            \
+                                                                                                              \
+    /** For tables of the Aggregating family: treat the table as a maintained summary.                        \
+     *  Background merges fold parts with fresh aggregation states into the collapsed history more            \
+     *  eagerly, and queries whose GROUP BY covers a prefix of the sorting key read the summary in a           \
+     *  streaming fashion instead of re-hashing it (as if optimize_aggregation_in_order were set). */         \
+    M(SettingBool, maintain_aggregating_summary, false)                                                       \
+                                                                                                              \
+    /** Inserted blocks smaller than this number of uncompressed bytes are kept as in-memory parts            \
+     *  backed by a per-table write-ahead log, and reach the disk only when a merge writes them into          \
+     *  a bigger part. 0 - all parts are written to disk immediately.                                         \
+     *  Not supported for tables of the Replicated family.  */                                                \
+    M(SettingUInt64, min_bytes_for_on_disk_part, 0)                                                           \
+                                                                                                              \
+    /** Execute mutations that consist only of ALTER DELETE commands by writing a per-part mask of           \
+     *  deleted rows (deleted_mask.bin) instead of rewriting the whole part. The mask is applied as an        \
+     *  implicit filter during reads, and the deleted rows physically disappear when the part is next        \
+     *  written by a merge. All other files of the part are hard-linked from the old one.  */                 \
+    M(SettingBool, lightweight_deletes, false)                                                                \
+                                                                                                              \
+    /** Name of a storage policy from the <storage_configuration> section of the server config.               \
+     *  The table's own data directory stays the first (hottest) volume; the volumes of the policy            \
+     *  are appended after it in order, and parts are moved to colder volumes in the background               \
+     *  when a volume runs out of space (move_factor) or parts get old enough                                 \
+     *  (move_older_than_seconds). Empty - all parts are stored in the table's data directory. */             \
+    M(SettingString, storage_policy, "")                                                                      \
+                                                                                                              \
+    /** Advise the OS to read ahead (POSIX_FADV_WILLNEED) the data of all mark ranges assigned to a           \
+     *  reading stream when the stream is created, so that cold reads of subsequent ranges overlap with       \
+     *  decompression and filtering of the current block. Has no effect for direct IO and for reads of        \
+     *  whole files, where the usual kernel read-ahead is sufficient. */                                      \
+    M(SettingBool, read_ahead_mark_ranges, true)                                                              \
+                                                                                                              \
+    /** Comma-separated list of columns of an alternative sort order. Every new part additionally             \
+     *  stores a copy of its rows sorted by these columns, with its own primary index, in the                 \
+     *  projection/ subdirectory. Queries filtering by a prefix of this list instead of the primary           \
+     *  key read the projection layout and skip granules (see MergeTreeDataSelectExecutor).                   \
+     *  Empty - no projection is written. */                                                                  \
+    M(SettingString, projection_sort_columns, "")                                                             \
+                                                                                                              \
+    /** The maximum size of a part (uncompressed bytes of its rows) for which the projection layout           \
+     *  is written: the rows of the part are re-sorted in memory. Parts that come out bigger are              \
+     *  written without the projection, and queries over them fall back to the primary layout. */             \
+    M(SettingUInt64, projection_max_bytes, 1ULL * 1024 * 1024 * 1024)                                         \
+                                                                                                              \
+    /** Write per-column statistics (row and NULL counts, HyperLogLog NDV, equi-height histogram              \
+     *  for numeric columns) into statistics.txt of every newly written part. Aggregated per table            \
+     *  and exposed through the system.column_statistics table. */                                            \
+    M(SettingBool, write_column_statistics, true)                                                             \
+                                                                                                              \
+    /** Merge settings. */                                                                                   \
                                                                                                               \
     /** Maximum in total size of parts to merge, when there are maximum (minimum) free threads                \
      * in background pool (or entries in replication queue). */                                               \
@@ -36,6 +117,21 @@ struct MergeTreeSettings
      *  This is to allow small merges to process - not filling the pool with long running merges. */          \
     M(SettingUInt64, number_of_free_entries_in_pool_to_lower_max_size_of_merge, 8)                            \
                                                                                                               \
+    /** Select parts to merge by trading rewrite bytes against the number of parts explicitly,                \
+     *  instead of the size-ratio heuristic: merge only in partitions with more active parts than             \
+     *  merge_selector_parts_to_keep, preferring the range with the lowest rewrite cost per part              \
+     *  removed (see DebtAwareMergeSelector). OPTIMIZE queries keep the usual behaviour. */                   \
+    M(SettingBool, use_debt_aware_merge_selector, false)                                                      \
+                                                                                                              \
+    /** For the debt-aware selector: how many active parts a partition may have before its parts              \
+     *  become candidates for merging at all - the read amplification we are willing to live with. */         \
+    M(SettingUInt64, merge_selector_parts_to_keep, 10)                                                        \
+                                                                                                              \
+    /** When the merge selector has nothing to do, rewrite single parts older than this many seconds          \
+     *  "with themselves", so that the age-based <compression> cases of the server config (min_part_age)      \
+     *  are applied to data that was written while it was still hot. 0 - disabled. */                         \
+    M(SettingSeconds, recompress_parts_after_age_seconds, 0)                                                  \
+                                                                                                              \
     /** How many seconds to keep obsolete parts. */                                                           \
     M(SettingSeconds, old_parts_lifetime, 8 * 60)                                                             \
                                                                                                               \
@@ -53,6 +149,12 @@ struct MergeTreeSettings
     /** Max delay of inserting data into MergeTree table in seconds, if there are a lot of unmerged parts. */ \
     M(SettingUInt64, max_delay_to_insert, 1)                                                                  \
                                                                                                               \
+    /** If non-zero, inserted parts with data smaller than this many bytes (compressed) are written in        \
+     *  a compact form: data of all columns is stored in a single data.bin file to reduce the number of       \
+     *  files per part. Merges write the ordinary wide format, so a part stays compact only until it is       \
+     *  merged. 0 - always write the wide format. */                                                          \
+    M(SettingUInt64, min_bytes_for_wide_part, 0)                                                              \
+                                                                                                              \
     /** Replication settings. */                                                                              \
                                                                                                               \
     /** How many last blocks of hashes should be kept in ZooKeeper (old blocks will be deleted). */           \
@@ -63,6 +165,24 @@ struct MergeTreeSettings
      *  duplicating INSERTs during that period of time. */                                                    \
     M(SettingUInt64, replicated_deduplication_window_seconds, 7 * 24 * 60 * 60) /** one week */               \
                                                                                                               \
+    /** How many last blocks of hashes should be kept on disk for non-replicated MergeTree tables             \
+     *  (see MergeTreeDeduplicationLog). 0 - insert deduplication is disabled. */                             \
+    M(SettingUInt64, non_replicated_deduplication_window, 0)                                                  \
+                                                                                                              \
+    /** Load the marks of all parts into the mark cache on the background pool after the table is started,    \
+     *  so that the first queries after a restart do not stall on mark loading. */                            \
+    M(SettingBool, preload_marks_on_startup, false)                                                           \
+                                                                                                              \
+    /** Continuously verify checksums of data parts in the background (scrubbing), reading at most this       \
+     *  many bytes per second, so that silent disk corruption is found before a merge trips over it.          \
+     *  For Replicated tables a corrupted part is re-fetched from a healthy replica.                          \
+     *  0 - scrubbing is disabled. See also system.scrub_status. */                                           \
+    M(SettingUInt64, scrub_max_bytes_per_second, 0)                                                           \
+                                                                                                              \
+    /** After a scrub pass has verified every part of the table, wait at least this long                      \
+     *  before starting the next pass. */                                                                     \
+    M(SettingSeconds, scrub_period_seconds, 30 * 24 * 60 * 60) /** one month */                               \
+                                                                                                              \
     /** How many records may be in log, if there is inactive replica  */                                      \
     M(SettingUInt64, max_replicated_logs_to_keep, 10000)                                                      \
                                                                                                               \
@@ -99,6 +219,16 @@ struct MergeTreeSettings
     M(SettingUInt64, replicated_max_parallel_sends, 0)                                                        \
     M(SettingUInt64, replicated_max_parallel_sends_for_table, 0)                                              \
                                                                                                               \
+    /** When sending a part to a replica, do not re-read and re-hash its files to compute the                 \
+     *  transferred checksums, but take the hashes stored in the part's checksums. The fetching               \
+     *  replica verifies them against the received data anyway. Disable to restore detection of               \
+     *  local disk corruption on the sending side at the cost of hashing every sent byte. */                  \
+    M(SettingBool, replicated_sends_use_cached_checksums, true)                                               \
+                                                                                                              \
+    /** Minimal size of a file in a fetched part to write it with O_DIRECT on the fetching side,              \
+     *  to avoid flushing the page cache with data of large fetched parts (0 - disabled). */                  \
+    M(SettingUInt64, min_fetch_bytes_to_use_direct_io, 0)                                                     \
+                                                                                                              \
     /** If true, Replicated tables replicas on this node will try to acquire leadership. */                   \
     M(SettingBool, replicated_can_become_leader, true)                                                        \
                                                                                                               \
@@ -0,0 +1,91 @@
+#include <Storages/MergeTree/MergeTreeStoragePolicy.h>
+#include <Common/Exception.h>
+#include <Common/StringUtils/StringUtils.h>
+#include <Poco/Util/AbstractConfiguration.h>
+
+#include <map>
+
+
+namespace DB
+{
+
+namespace ErrorCodes
+{
+    extern const int BAD_ARGUMENTS;
+    extern const int NO_ELEMENTS_IN_CONFIG;
+    extern const int UNKNOWN_ELEMENT_IN_CONFIG;
+}
+
+MergeTreeStoragePolicy::MergeTreeStoragePolicy(
+    const Poco::Util::AbstractConfiguration & config,
+    const String & name_,
+    const String & relative_table_path)
+    : name(name_)
+{
+    /// Disk name -> its root path.
+    std::map<String, String> disks;
+
+    String disks_prefix = "storage_configuration.disks";
+    if (!config.has(disks_prefix))
+        throw Exception("There are no disks in the server config (" + disks_prefix + ")", ErrorCodes::NO_ELEMENTS_IN_CONFIG);
+
+    Poco::Util::AbstractConfiguration::Keys disk_names;
+    config.keys(disks_prefix, disk_names);
+    for (const String & disk_name : disk_names)
+    {
+        String path = config.getString(disks_prefix + "." + disk_name + ".path");
+        if (path.empty() || path.back() != '/')
+            throw Exception("Path of disk " + disk_name + " must be non-empty and end with '/'", ErrorCodes::BAD_ARGUMENTS);
+
+        disks.emplace(disk_name, path);
+    }
+
+    String policy_prefix = "storage_configuration.policies." + name;
+    if (!config.has(policy_prefix))
+        throw Exception("There is no storage policy " + name + " in the server config", ErrorCodes::NO_ELEMENTS_IN_CONFIG);
+
+    move_factor = config.getDouble(policy_prefix + ".move_factor", 0.1);
+    if (move_factor < 0.0 || move_factor > 1.0)
+        throw Exception("move_factor of storage policy " + name + " must be in [0, 1]", ErrorCodes::BAD_ARGUMENTS);
+
+    String volumes_prefix = policy_prefix + ".volumes";
+    Poco::Util::AbstractConfiguration::Keys volume_names;
+    config.keys(volumes_prefix, volume_names);
+    for (const String & volume_name : volume_names)
+    {
+        String volume_prefix = volumes_prefix + "." + volume_name;
+
+        Volume volume;
+        volume.name = volume_name;
+        volume.max_data_part_size_bytes = config.getUInt64(volume_prefix + ".max_data_part_size_bytes", 0);
+        volume.move_older_than_seconds = config.getUInt64(volume_prefix + ".move_older_than_seconds", 0);
+
+        /// Several disks are listed as <disk>, <disk>, ... which Poco presents as disk, disk[1], ...
+        Poco::Util::AbstractConfiguration::Keys volume_keys;
+        config.keys(volume_prefix, volume_keys);
+        for (const String & key : volume_keys)
+        {
+            if (!startsWith(key, "disk"))
+                continue;
+
+            String disk_name = config.getString(volume_prefix + "." + key);
+            auto it = disks.find(disk_name);
+            if (it == disks.end())
+                throw Exception("Volume " + volume_name + " of storage policy " + name + " references unknown disk " + disk_name,
+                    ErrorCodes::UNKNOWN_ELEMENT_IN_CONFIG);
+
+            volume.paths.push_back(it->second + relative_table_path);
+        }
+
+        if (volume.paths.empty())
+            throw Exception("Volume " + volume_name + " of storage policy " + name + " must contain at least one disk",
+                ErrorCodes::NO_ELEMENTS_IN_CONFIG);
+
+        volumes.push_back(std::move(volume));
+    }
+
+    if (volumes.empty())
+        throw Exception("Storage policy " + name + " must contain at least one volume", ErrorCodes::NO_ELEMENTS_IN_CONFIG);
+}
+
+}
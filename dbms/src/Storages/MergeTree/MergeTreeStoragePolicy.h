@@ -0,0 +1,79 @@
+#pragma once
+
+#include <Core/Types.h>
+#include <memory>
+#include <vector>
+
+namespace Poco { namespace Util { class AbstractConfiguration; } }
+
+namespace DB
+{
+
+/** An ordered list of volumes over which the parts of one table are spread ("tiered storage").
+  * A volume is one or more disks that are considered equivalent; the volumes are ordered from
+  * hot to cold. The table's own data directory (under the server's <path>) is always the first,
+  * hottest volume and is not listed in the policy; the volumes of the policy are appended after
+  * it in the order of declaration.
+  *
+  * Disks and policies are described in the server config:
+  *
+  * <storage_configuration>
+  *     <disks>
+  *         <big>
+  *             <path>/mnt/hdd/clickhouse/</path>
+  *         </big>
+  *     </disks>
+  *     <policies>
+  *         <tiered>
+  *             <volumes>
+  *                 <cold>
+  *                     <disk>big</disk>
+  *                 </cold>
+  *             </volumes>
+  *             <move_factor>0.1</move_factor>
+  *         </tiered>
+  *     </policies>
+  * </storage_configuration>
+  *
+  * A table subscribes to a policy with the storage_policy MergeTree setting.
+  */
+class MergeTreeStoragePolicy
+{
+public:
+    struct Volume
+    {
+        String name;
+
+        /// Directories for the data of the table on each disk of the volume, ending with '/'.
+        Strings paths;
+
+        /// Parts bigger than that are never put on this volume. 0 means no limit.
+        size_t max_data_part_size_bytes = 0;
+
+        /// If non-zero, parts whose data is older than this many seconds are moved
+        /// to the next volume in the background.
+        size_t move_older_than_seconds = 0;
+    };
+
+    MergeTreeStoragePolicy(
+        const Poco::Util::AbstractConfiguration & config,
+        const String & name_,
+        const String & relative_table_path);
+
+    const String & getName() const { return name; }
+
+    const std::vector<Volume> & getVolumes() const { return volumes; }
+
+    /// When the unreserved free space on a volume drops below this fraction of its capacity,
+    /// the biggest parts of the volume are moved to the next one in the background.
+    double getMoveFactor() const { return move_factor; }
+
+private:
+    String name;
+    std::vector<Volume> volumes;
+    double move_factor = 0.1;
+};
+
+using MergeTreeStoragePolicyPtr = std::shared_ptr<const MergeTreeStoragePolicy>;
+
+}
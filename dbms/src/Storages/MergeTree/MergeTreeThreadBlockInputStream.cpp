@@ -17,15 +17,20 @@ MergeTreeThreadBlockInputStream::MergeTreeThreadBlockInputStream(
     const MergeTreeData & storage,
     const bool use_uncompressed_cache,
     const PrewhereInfoPtr & prewhere_info,
+    const PrewhereReadStepsPtr & prewhere_read_steps,
+    const PrewhereStepsStatsPtr & prewhere_steps_stats,
     const Settings & settings,
     const Names & virt_column_names)
     :
-    MergeTreeBaseBlockInputStream{storage, prewhere_info, max_block_size_rows,
+    MergeTreeBaseBlockInputStream{storage, prewhere_info, prewhere_read_steps, prewhere_steps_stats, max_block_size_rows,
         preferred_block_size_bytes, preferred_max_column_in_block_size_bytes, settings.min_bytes_to_use_direct_io,
-        settings.max_read_buffer_size, use_uncompressed_cache, true, virt_column_names},
+        settings.min_bytes_to_use_mmap_io, settings.max_read_buffer_size, use_uncompressed_cache,
+        settings.deferred_checksum_verification, true, virt_column_names},
     thread{thread},
     pool{pool}
 {
+    apply_deleted_mask = settings.apply_deleted_mask;
+
     /// round min_marks_to_read up to nearest multiple of block_size expressed in marks
     if (max_block_size_rows)
     {
@@ -35,6 +40,8 @@ MergeTreeThreadBlockInputStream::MergeTreeThreadBlockInputStream(
     else
         min_marks_to_read = min_marks_to_read_;
 
+    reorder_interval_marks = settings.adaptive_prewhere_reorder_granules;
+
     ordered_names = getHeader().getNames();
 }
 
@@ -60,7 +67,7 @@ bool MergeTreeThreadBlockInputStream::getNewTask()
           * buffers don't waste memory.
           */
         reader.reset();
-        pre_reader.reset();
+        pre_readers.clear();
         return false;
     }
 
@@ -79,13 +86,23 @@ bool MergeTreeThreadBlockInputStream::getNewTask()
 
         reader = std::make_unique<MergeTreeReader>(
             path, task->data_part, task->columns, owned_uncompressed_cache.get(), owned_mark_cache.get(), save_marks_in_cache,
-            storage, rest_mark_ranges, min_bytes_to_use_direct_io, max_read_buffer_size, MergeTreeReader::ValueSizeMap{}, profile_callback);
+            storage, rest_mark_ranges, min_bytes_to_use_direct_io, min_bytes_to_use_mmap_io, max_read_buffer_size, deferred_checksum_verification,
+            MergeTreeReader::ValueSizeMap{}, profile_callback,
+            CLOCK_MONOTONIC_COARSE, apply_deleted_mask);
 
         if (prewhere_info)
-            pre_reader = std::make_unique<MergeTreeReader>(
-                path, task->data_part, task->pre_columns, owned_uncompressed_cache.get(), owned_mark_cache.get(), save_marks_in_cache,
-                storage, rest_mark_ranges, min_bytes_to_use_direct_io,
-                max_read_buffer_size, MergeTreeReader::ValueSizeMap{}, profile_callback);
+        {
+            updatePrewhereStepOrder();
+            marks_since_step_reorder = 0;
+
+            auto step_columns = getPrewhereStepColumns();
+            for (const auto & columns_for_step : step_columns)
+                pre_readers.push_back(std::make_unique<MergeTreeReader>(
+                    path, task->data_part, columns_for_step, owned_uncompressed_cache.get(), owned_mark_cache.get(), save_marks_in_cache,
+                    storage, rest_mark_ranges, min_bytes_to_use_direct_io, min_bytes_to_use_mmap_io,
+                    max_read_buffer_size, deferred_checksum_verification, MergeTreeReader::ValueSizeMap{}, profile_callback,
+                    CLOCK_MONOTONIC_COARSE, apply_deleted_mask));
+        }
     }
     else
     {
@@ -96,22 +113,67 @@ bool MergeTreeThreadBlockInputStream::getNewTask()
             /// retain avg_value_size_hints
             reader = std::make_unique<MergeTreeReader>(
                 path, task->data_part, task->columns, owned_uncompressed_cache.get(), owned_mark_cache.get(), save_marks_in_cache,
-                storage, rest_mark_ranges, min_bytes_to_use_direct_io, max_read_buffer_size,
-                reader->getAvgValueSizeHints(), profile_callback);
+                storage, rest_mark_ranges, min_bytes_to_use_direct_io, min_bytes_to_use_mmap_io, max_read_buffer_size, deferred_checksum_verification,
+                reader->getAvgValueSizeHints(), profile_callback,
+                CLOCK_MONOTONIC_COARSE, apply_deleted_mask);
 
             if (prewhere_info)
-                pre_reader = std::make_unique<MergeTreeReader>(
-                    path, task->data_part, task->pre_columns, owned_uncompressed_cache.get(), owned_mark_cache.get(), save_marks_in_cache,
-                    storage, rest_mark_ranges, min_bytes_to_use_direct_io,
-                    max_read_buffer_size, pre_reader->getAvgValueSizeHints(), profile_callback);
+            {
+                updatePrewhereStepOrder();
+                marks_since_step_reorder = 0;
+
+                auto step_columns = getPrewhereStepColumns();
+                std::vector<MergeTreeReaderPtr> new_pre_readers;
+                for (size_t i = 0; i < step_columns.size(); ++i)
+                    new_pre_readers.push_back(std::make_unique<MergeTreeReader>(
+                        path, task->data_part, step_columns[i], owned_uncompressed_cache.get(), owned_mark_cache.get(), save_marks_in_cache,
+                        storage, rest_mark_ranges, min_bytes_to_use_direct_io, min_bytes_to_use_mmap_io, max_read_buffer_size, deferred_checksum_verification,
+                        i < pre_readers.size() ? pre_readers[i]->getAvgValueSizeHints() : MergeTreeReader::ValueSizeMap{},
+                        profile_callback, CLOCK_MONOTONIC_COARSE, apply_deleted_mask));
+                pre_readers = std::move(new_pre_readers);
+            }
+        }
+        else if (prewhere_steps_stats && reorder_interval_marks && marks_since_step_reorder >= reorder_interval_marks)
+        {
+            /// Same part, but enough granules were read since the last re-evaluation: adapt the
+            /// PREWHERE step order to the selectivity and cost observed on the recent blocks.
+            /// Rebuilding the step readers is only worth it when the order actually changes.
+            marks_since_step_reorder = 0;
+            if (updatePrewhereStepOrder())
+            {
+                auto rest_mark_ranges = pool->getRestMarks(path, task->mark_ranges[0]);
+
+                auto step_columns = getPrewhereStepColumns();
+                pre_readers.clear();
+                for (const auto & columns_for_step : step_columns)
+                    pre_readers.push_back(std::make_unique<MergeTreeReader>(
+                        path, task->data_part, columns_for_step, owned_uncompressed_cache.get(), owned_mark_cache.get(), save_marks_in_cache,
+                        storage, rest_mark_ranges, min_bytes_to_use_direct_io, min_bytes_to_use_mmap_io,
+                        max_read_buffer_size, deferred_checksum_verification, MergeTreeReader::ValueSizeMap{}, profile_callback,
+                        CLOCK_MONOTONIC_COARSE, apply_deleted_mask));
+            }
         }
     }
     last_readed_part_path = path;
 
+    for (const auto & range : task->mark_ranges)
+        marks_since_step_reorder += range.end - range.begin;
+
     return true;
 }
 
 
+std::vector<NamesAndTypesList> MergeTreeThreadBlockInputStream::getPrewhereStepColumns() const
+{
+    std::vector<NamesAndTypesList> step_columns;
+    if (prewhere_read_steps)
+        step_columns = distributePrewhereReadColumns(task->data_part, task->pre_columns, *prewhere_read_steps, prewhere_step_order);
+    if (step_columns.empty())
+        step_columns.push_back(task->pre_columns);
+    return step_columns;
+}
+
+
 MergeTreeThreadBlockInputStream::~MergeTreeThreadBlockInputStream() = default;
 
 }
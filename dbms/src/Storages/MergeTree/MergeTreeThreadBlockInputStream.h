@@ -24,6 +24,8 @@ public:
         const MergeTreeData & storage,
         const bool use_uncompressed_cache,
         const PrewhereInfoPtr & prewhere_info,
+        const PrewhereReadStepsPtr & prewhere_read_steps,
+        const PrewhereStepsStatsPtr & prewhere_steps_stats,
         const Settings & settings,
         const Names & virt_column_names);
 
@@ -38,6 +40,10 @@ protected:
     bool getNewTask() override;
 
 private:
+    /// Columns to read at each PREWHERE step of the current task; a single element if PREWHERE
+    /// is executed at one step.
+    std::vector<NamesAndTypesList> getPrewhereStepColumns() const;
+
     /// "thread" index (there are N threads and each thread is assigned index in interval [0..N-1])
     size_t thread;
 
@@ -48,6 +54,12 @@ private:
     std::string last_readed_part_path;
     /// Names from header. Used in order to order columns in read blocks.
     Names ordered_names;
+
+    /// Marks read since the PREWHERE step order was last re-evaluated, and how many to read
+    /// between re-evaluations (the adaptive_prewhere_reorder_granules setting; 0 disables
+    /// re-evaluation between the parts).
+    size_t marks_since_step_reorder = 0;
+    size_t reorder_interval_marks = 0;
 };
 
 }
@@ -19,6 +19,7 @@
 #include <map>
 #include <limits>
 #include <cstddef>
+#include <algorithm>
 
 
 namespace DB
@@ -84,8 +85,9 @@ void MergeTreeWhereOptimizer::optimizeConjunction(ASTSelectQuery & select, ASTFu
     /// used as max possible size and indicator that appropriate condition has not been found
     const auto no_such_condition = std::numeric_limits<size_t>::max();
 
+    /// all "good" conditions found so far; { first: condition index, second: summary column size }
+    std::vector<std::pair<size_t, size_t>> good_conditions;
     /// { first: condition index, second: summary column size }
-    std::pair<size_t, size_t> lightest_good_condition{no_such_condition, no_such_condition};
     std::pair<size_t, size_t> lightest_viable_condition{no_such_condition, no_such_condition};
 
     auto & conditions = fun->arguments->children;
@@ -134,40 +136,80 @@ void MergeTreeWhereOptimizer::optimizeConjunction(ASTSelectQuery & select, ASTFu
             const auto cond_columns_size = getIdentifiersColumnSize(identifiers);
 
             /// place condition either in good or viable conditions set
-            auto & good_or_viable_condition = isConditionGood(condition) ? lightest_good_condition : lightest_viable_condition;
-            if (good_or_viable_condition.second > cond_columns_size)
+            if (isConditionGood(condition))
+                good_conditions.emplace_back(idx, cond_columns_size);
+            else if (lightest_viable_condition.second > cond_columns_size)
             {
-                good_or_viable_condition.first = idx;
-                good_or_viable_condition.second = cond_columns_size;
+                lightest_viable_condition.first = idx;
+                lightest_viable_condition.second = cond_columns_size;
             }
         }
     }
 
-    const auto move_condition_to_prewhere = [&] (const size_t idx)
+    /// move the conditions with the given indices to PREWHERE, combining them into a conjunction
+    /// in the given order if there are several of them
+    const auto move_conditions_to_prewhere = [&] (const std::vector<std::pair<size_t, size_t>> & moved)
     {
-        select.prewhere_expression = conditions[idx];
+        if (moved.size() == 1)
+            select.prewhere_expression = conditions[moved.front().first];
+        else
+        {
+            /// combine the moved conditions into a conjunction; with multi-step PREWHERE execution
+            /// it will be split back into steps in exactly this order
+            auto conjunction = std::make_shared<ASTFunction>();
+            conjunction->name = and_function_name;
+            conjunction->arguments = std::make_shared<ASTExpressionList>();
+            conjunction->children.push_back(conjunction->arguments);
+
+            for (const auto & condition : moved)
+                conjunction->arguments->children.push_back(conditions[condition.first]);
+
+            select.prewhere_expression = conjunction;
+        }
+
         select.children.push_back(select.prewhere_expression);
         LOG_DEBUG(log, "MergeTreeWhereOptimizer: condition `" << select.prewhere_expression << "` moved to PREWHERE");
 
-        /** Replace conjunction with the only remaining argument if only two conditions were present,
-            *  remove selected condition from conjunction otherwise. */
-        if (conditions.size() == 2)
+        /// remove the moved conditions from the conjunction, in descending index order so that
+        /// the indices of the conditions yet to be removed stay valid
+        std::vector<size_t> moved_indices;
+        moved_indices.reserve(moved.size());
+        for (const auto & condition : moved)
+            moved_indices.push_back(condition.first);
+        std::sort(moved_indices.rbegin(), moved_indices.rend());
+
+        for (const auto idx : moved_indices)
+            remove_condition_at_index(idx);
+
+        /// find old where_expression in children of select
+        const auto it = std::find(std::begin(select.children), std::end(select.children), select.where_expression);
+
+        if (conditions.empty())
         {
-            /// find old where_expression in children of select
-            const auto it = std::find(std::begin(select.children), std::end(select.children), select.where_expression);
-            /// replace where_expression with the remaining argument
-            select.where_expression = std::move(conditions[idx == 0 ? 1 : 0]);
+            /// the whole WHERE has been moved
+            select.children.erase(it);
+            select.where_expression.reset();
+        }
+        else if (conditions.size() == 1)
+        {
+            /// replace conjunction with the only remaining argument
+            select.where_expression = std::move(conditions.front());
             /// overwrite child entry with the new where_expression
             *it = select.where_expression;
         }
-        else
-            remove_condition_at_index(idx);
     };
 
-    /// if there is a "good" condition - move it to PREWHERE
-    if (lightest_good_condition.first != no_such_condition)
+    /// if there are "good" conditions - move all of them to PREWHERE
+    if (!good_conditions.empty())
     {
-        move_condition_to_prewhere(lightest_good_condition.first);
+        /** Order the moved conditions by the summary size of their columns, so that with multi-step
+            *  PREWHERE execution the cheapest columns are read and filtered first.
+            *  Per-part statistics that would allow estimating selectivity are not available at this
+            *  point, so column size is the only ranking criterion. */
+        std::sort(std::begin(good_conditions), std::end(good_conditions),
+            [] (const auto & lhs, const auto & rhs) { return lhs.second < rhs.second; });
+
+        move_conditions_to_prewhere(good_conditions);
     }
     else if (lightest_viable_condition.first != no_such_condition)
     {
@@ -183,7 +225,7 @@ void MergeTreeWhereOptimizer::optimizeConjunction(ASTSelectQuery & select, ASTFu
                 return;
         }
 
-        move_condition_to_prewhere(lightest_viable_condition.first);
+        move_conditions_to_prewhere({lightest_viable_condition});
     }
 }
 
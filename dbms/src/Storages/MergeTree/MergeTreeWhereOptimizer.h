@@ -24,8 +24,9 @@ using IdentifierNameSet = std::set<std::string>;
  *  sizes of columns used in particular expression and identifying "good" conditions of
  *  form "column_name = constant", where "constant" is outside some `threshold` specified in advance.
  *
- *  If there are "good" conditions present in WHERE, the one with minimal summary column size is
- *  transferred to PREWHERE.
+ *  If there are "good" conditions present in WHERE, all of them are transferred to PREWHERE, ordered
+ *  by the summary size of their columns: combined with multi-step PREWHERE execution this reads and
+ *  filters by the cheapest columns first.
  *  Otherwise any condition with minimal summary column size can be transferred to PREWHERE, if only
  *  its relative size (summary column size divided by query column size) is less than `max_columns_relative_size`.
  */
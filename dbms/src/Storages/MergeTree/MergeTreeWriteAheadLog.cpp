@@ -0,0 +1,131 @@
+#include <Storages/MergeTree/MergeTreeWriteAheadLog.h>
+#include <Storages/MergeTree/MergeTreePartInfo.h>
+#include <DataStreams/NativeBlockInputStream.h>
+#include <DataStreams/NativeBlockOutputStream.h>
+#include <IO/ReadBufferFromFile.h>
+#include <IO/ReadHelpers.h>
+#include <IO/WriteHelpers.h>
+#include <Poco/File.h>
+
+#include <fcntl.h>
+
+
+namespace DB
+{
+
+namespace ErrorCodes
+{
+    extern const int UNKNOWN_FORMAT_VERSION;
+}
+
+
+MergeTreeWriteAheadLog::MergeTreeWriteAheadLog(MergeTreeData & storage_)
+    : storage(storage_)
+    , path(storage.getFullPath() + WAL_FILE_NAME)
+    , out(std::make_unique<WriteBufferFromFile>(path, DBMS_DEFAULT_BUFFER_SIZE, O_WRONLY | O_APPEND | O_CREAT))
+    , log(&Logger::get(storage.getLogName() + " (WriteAheadLog)"))
+{
+}
+
+
+void MergeTreeWriteAheadLog::writeEntry(const Block & block, const String & part_name, WriteBuffer & out_buf)
+{
+    writeIntBinary(WAL_VERSION, out_buf);
+    writeStringBinary(part_name, out_buf);
+
+    NativeBlockOutputStream block_out(out_buf, 0, block.cloneEmpty());
+    block_out.write(block);
+}
+
+
+void MergeTreeWriteAheadLog::addPart(const Block & block, const String & part_name)
+{
+    std::lock_guard<std::mutex> lock(write_mutex);
+
+    writeEntry(block, part_name, *out);
+    out->next();
+}
+
+
+std::vector<MergeTreeData::MutableDataPartPtr> MergeTreeWriteAheadLog::restore()
+{
+    std::vector<MergeTreeData::MutableDataPartPtr> parts;
+
+    ReadBufferFromFile in(path);
+    size_t last_entry_end = 0;
+
+    while (!in.eof())
+    {
+        try
+        {
+            UInt8 version;
+            readIntBinary(version, in);
+            if (version != WAL_VERSION)
+                throw Exception("Unknown WAL format version: " + toString(UInt32(version)),
+                    ErrorCodes::UNKNOWN_FORMAT_VERSION);
+
+            String part_name;
+            readStringBinary(part_name, in);
+
+            NativeBlockInputStream block_in(in, 0);
+            Block block = block_in.read();
+
+            auto part_info = MergeTreePartInfo::fromPartName(part_name, storage.format_version);
+            MergeTreeData::MutableDataPartPtr part = std::make_shared<MergeTreeData::DataPart>(storage, part_name, part_info);
+            part->relative_path = part_name;
+
+            part->minmax_idx.update(block, storage.minmax_idx_columns);
+            if (storage.partition_expr)
+            {
+                /// All rows of the block belong to the same partition, so the key of the first row is enough.
+                Block block_copy = block;
+                storage.partition_expr->execute(block_copy);
+
+                Row partition(storage.partition_key_sample.columns());
+                for (size_t i = 0; i < partition.size(); ++i)
+                    partition[i] = (*block_copy.getByName(storage.partition_key_sample.getByPosition(i).name).column)[0];
+
+                part->partition = MergeTreePartition(std::move(partition));
+            }
+
+            part->columns = storage.getColumns().getAllPhysical().filter(block.getNames());
+            part->setInMemoryBlock(std::move(block));
+
+            parts.push_back(std::move(part));
+            last_entry_end = in.count();
+        }
+        catch (const Exception & e)
+        {
+            /// An incomplete entry at the end of the log is expected after a hard shutdown
+            ///  during an insert. Drop it and everything after it.
+            LOG_WARNING(log, "Write-ahead log " << path << " is broken at position "
+                << last_entry_end << " (" << e.message() << "). Truncating the broken tail.");
+
+            Poco::File(path).setSize(last_entry_end);
+            break;
+        }
+    }
+
+    return parts;
+}
+
+
+void MergeTreeWriteAheadLog::rewrite(const std::vector<MergeTreeData::MutableDataPartPtr> & parts)
+{
+    std::lock_guard<std::mutex> lock(write_mutex);
+
+    String tmp_path = path + ".tmp";
+
+    {
+        WriteBufferFromFile tmp_out(tmp_path, DBMS_DEFAULT_BUFFER_SIZE, O_WRONLY | O_TRUNC | O_CREAT);
+        for (const auto & part : parts)
+            writeEntry(part->in_memory_block, part->name, tmp_out);
+        tmp_out.sync();
+    }
+
+    out.reset();
+    Poco::File(tmp_path).renameTo(path);
+    out = std::make_unique<WriteBufferFromFile>(path, DBMS_DEFAULT_BUFFER_SIZE, O_WRONLY | O_APPEND | O_CREAT);
+}
+
+}
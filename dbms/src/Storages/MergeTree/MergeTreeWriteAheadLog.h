@@ -0,0 +1,58 @@
+#pragma once
+
+#include <Core/Block.h>
+#include <Storages/MergeTree/MergeTreeData.h>
+#include <IO/WriteBufferFromFile.h>
+#include <common/logger_useful.h>
+
+#include <mutex>
+
+
+namespace DB
+{
+
+/** A write-ahead log for in-memory parts (see the min_bytes_for_on_disk_part setting).
+  *
+  * Blocks of small inserts are appended to a single per-table log file ('wal.bin') in the Native
+  *  format instead of being written as separate part directories. On server startup the log is
+  *  replayed and the parts are restored into RAM. When a merge writes the data into an on-disk
+  *  part, the in-memory parts become obsolete, and at the next startup the log is rewritten with
+  *  only the still-active ones, so that it does not grow indefinitely.
+  *
+  * An incomplete entry at the end of the log (e.g. after a power loss during an insert) is
+  *  discarded by truncating the file; everything before it is restored as usual.
+  */
+class MergeTreeWriteAheadLog
+{
+public:
+    /// Entries of future incompatible formats will get a different version number.
+    static constexpr UInt8 WAL_VERSION = 0;
+    static constexpr auto WAL_FILE_NAME = "wal.bin";
+
+    MergeTreeWriteAheadLog(MergeTreeData & storage_);
+
+    /// Appends the block of an in-memory part to the log and flushes it to the OS,
+    ///  so that the insert can be acknowledged to the client.
+    void addPart(const Block & block, const String & part_name);
+
+    /// Reads the log and returns the restored in-memory parts. Truncates a corrupted tail, if any.
+    /// Called once on table load, before the log is opened for writing.
+    std::vector<MergeTreeData::MutableDataPartPtr> restore();
+
+    /// Replaces the log with one containing only the given parts.
+    /// Used after restore() to drop entries of parts that have already been merged to disk.
+    void rewrite(const std::vector<MergeTreeData::MutableDataPartPtr> & parts);
+
+private:
+    void writeEntry(const Block & block, const String & part_name, WriteBuffer & out);
+
+    MergeTreeData & storage;
+    String path;
+
+    std::mutex write_mutex;
+    std::unique_ptr<WriteBufferFromFile> out;
+
+    Logger * log;
+};
+
+}
@@ -1,10 +1,19 @@
 #include <Storages/MergeTree/MergedBlockOutputStream.h>
+#include <DataStreams/MarkInCompressedFile.h>
 #include <IO/createWriteBufferFromFileBase.h>
+#include <IO/ReadBufferFromFile.h>
+#include <IO/ReadHelpers.h>
+#include <IO/WriteHelpers.h>
+#include <IO/copyData.h>
 #include <Common/escapeForFileName.h>
 #include <DataTypes/NestedUtils.h>
 #include <Common/StringUtils/StringUtils.h>
 #include <Common/typeid_cast.h>
 #include <Common/MemoryTracker.h>
+#include <Columns/ColumnsNumber.h>
+#include <common/DateLUT.h>
+#include <common/logger_useful.h>
+#include <Interpreters/sortBlock.h>
 #include <Poco/File.h>
 
 
@@ -27,8 +36,10 @@ IMergedBlockOutputStream::IMergedBlockOutputStream(
     size_t min_compress_block_size_,
     size_t max_compress_block_size_,
     CompressionSettings compression_settings_,
-    size_t aio_threshold_)
+    size_t aio_threshold_,
+    size_t index_granularity_)
     : storage(storage_),
+    index_granularity(index_granularity_),
     min_compress_block_size(min_compress_block_size_),
     max_compress_block_size(max_compress_block_size_),
     aio_threshold(aio_threshold_),
@@ -44,6 +55,9 @@ void IMergedBlockOutputStream::addStreams(
     size_t estimated_size,
     bool skip_offsets)
 {
+    /// The column may have its own compression method (e.g. delta encoding), overriding the table-wide one.
+    CompressionSettings column_compression_settings = storage.getCompressionSettingsForColumn(name, type, compression_settings);
+
     IDataType::StreamCallback callback = [&] (const IDataType::SubstreamPath & substream_path)
     {
         if (skip_offsets && !substream_path.empty() && substream_path.back().type == IDataType::Substream::ArraySizes)
@@ -60,7 +74,7 @@ void IMergedBlockOutputStream::addStreams(
             path + stream_name, DATA_FILE_EXTENSION,
             path + stream_name, MARKS_FILE_EXTENSION,
             max_compress_block_size,
-            compression_settings,
+            column_compression_settings,
             estimated_size,
             aio_threshold);
     };
@@ -115,7 +129,7 @@ void IMergedBlockOutputStream::writeData(
             limit = index_offset;
         else
         {
-            limit = storage.index_granularity;
+            limit = index_granularity;
 
             /// Write marks.
             type.enumerateStreams([&] (const IDataType::SubstreamPath & substream_path)
@@ -230,12 +244,14 @@ MergedBlockOutputStream::MergedBlockOutputStream(
     MergeTreeData & storage_,
     String part_path_,
     const NamesAndTypesList & columns_list_,
-    CompressionSettings compression_settings)
+    CompressionSettings compression_settings,
+    bool allow_compact_part_)
     : IMergedBlockOutputStream(
         storage_, storage_.context.getSettings().min_compress_block_size,
         storage_.context.getSettings().max_compress_block_size, compression_settings,
-        storage_.context.getSettings().min_bytes_to_use_direct_io),
-    columns_list(columns_list_), part_path(part_path_)
+        storage_.context.getSettings().min_bytes_to_use_direct_io,
+        storage_.index_granularity),
+    columns_list(columns_list_), part_path(part_path_), allow_compact_part(allow_compact_part_)
 {
     init();
     for (const auto & it : columns_list)
@@ -252,7 +268,8 @@ MergedBlockOutputStream::MergedBlockOutputStream(
     : IMergedBlockOutputStream(
         storage_, storage_.context.getSettings().min_compress_block_size,
         storage_.context.getSettings().max_compress_block_size, compression_settings,
-        aio_threshold_),
+        aio_threshold_,
+        storage_.index_granularity),
     columns_list(columns_list_), part_path(part_path_)
 {
     init();
@@ -269,6 +286,25 @@ MergedBlockOutputStream::MergedBlockOutputStream(
     }
 }
 
+MergedBlockOutputStream::MergedBlockOutputStream(
+    MergeTreeData & storage_,
+    String part_path_,
+    const NamesAndTypesList & columns_list_,
+    CompressionSettings compression_settings,
+    const Names & sort_columns_override_)
+    : IMergedBlockOutputStream(
+        storage_, storage_.context.getSettings().min_compress_block_size,
+        storage_.context.getSettings().max_compress_block_size, compression_settings,
+        storage_.context.getSettings().min_bytes_to_use_direct_io,
+        storage_.index_granularity),
+    columns_list(columns_list_), part_path(part_path_),
+    sort_columns_override(sort_columns_override_), is_projection_writer(true)
+{
+    init();
+    for (const auto & it : columns_list)
+        addStreams(part_path, it.name, *it.type, 0, false);
+}
+
 std::string MergedBlockOutputStream::getPartPath() const
 {
     return part_path;
@@ -293,10 +329,7 @@ void MergedBlockOutputStream::writeSuffix()
     throw Exception("Method writeSuffix is not supported by MergedBlockOutputStream", ErrorCodes::NOT_IMPLEMENTED);
 }
 
-void MergedBlockOutputStream::writeSuffixAndFinalizePart(
-        MergeTreeData::MutableDataPartPtr & new_part,
-        const NamesAndTypesList * total_column_list,
-        MergeTreeData::DataPart::Checksums * additional_column_checksums)
+Names MergedBlockOutputStream::finishDataSerialization(MergeTreeData::DataPart::Checksums & checksums)
 {
     /// Finish columns serialization.
     if (!serialization_states.empty())
@@ -314,15 +347,6 @@ void MergedBlockOutputStream::writeSuffixAndFinalizePart(
         }
     }
 
-    if (!total_column_list)
-        total_column_list = &columns_list;
-
-    /// Finish write and get checksums.
-    MergeTreeData::DataPart::Checksums checksums;
-
-    if (additional_column_checksums)
-        checksums = std::move(*additional_column_checksums);
-
     if (index_stream)
     {
         index_stream->next();
@@ -331,13 +355,57 @@ void MergedBlockOutputStream::writeSuffixAndFinalizePart(
         index_stream = nullptr;
     }
 
+    Names stream_names;
     for (ColumnStreams::iterator it = column_streams.begin(); it != column_streams.end(); ++it)
     {
         it->second->finalize();
         it->second->addToChecksums(checksums);
+        stream_names.push_back(it->first);
     }
 
     column_streams.clear();
+    return stream_names;
+}
+
+void MergedBlockOutputStream::writeSuffixAndFinalizePart(
+        MergeTreeData::MutableDataPartPtr & new_part,
+        const NamesAndTypesList * total_column_list,
+        MergeTreeData::DataPart::Checksums * additional_column_checksums)
+{
+    if (!total_column_list)
+        total_column_list = &columns_list;
+
+    /// Finish write and get checksums.
+    MergeTreeData::DataPart::Checksums checksums;
+
+    if (additional_column_checksums)
+        checksums = std::move(*additional_column_checksums);
+
+    Names stream_names = finishDataSerialization(checksums);
+
+    if (allow_compact_part && rows_count)
+        convertToCompactIfNeeded(stream_names, checksums);
+
+    if (rows_count)
+    {
+        for (auto & name_and_index : skip_minmax_indices)
+            name_and_index.second->store(part_path, checksums);
+        for (auto & name_and_index : skip_ngrambf_indices)
+            name_and_index.second->store(part_path, checksums);
+    }
+    skip_minmax_indices.clear();
+    skip_ngrambf_indices.clear();
+
+    if (statistics_collector && rows_count)
+    {
+        MergeTreePartColumnStatistics statistics = statistics_collector->finalize();
+        statistics.store(part_path, checksums);
+    }
+    statistics_collector.reset();
+
+    if (!projection_blocks.empty() && rows_count)
+        writeProjection(checksums);
+    projection_blocks.clear();
 
     if (storage.format_version >= MERGE_TREE_DATA_MIN_FORMAT_VERSION_WITH_CUSTOM_PARTITIONING)
     {
@@ -354,6 +422,20 @@ void MergedBlockOutputStream::writeSuffixAndFinalizePart(
         count_out_hashing.next();
         checksums.files["count.txt"].file_size = count_out_hashing.count();
         checksums.files["count.txt"].file_hash = count_out_hashing.getHash();
+
+        if (storage.hasTableTTL() && rows_count)
+            MergeTreeData::DataPart::storeTTLInfo(ttl_min, ttl_max, part_path, checksums);
+    }
+
+    if (storage.settings.index_granularity_bytes != 0)
+    {
+        /// Parts with adaptive granularity remember their rows per mark.
+        WriteBufferFromFile granularity_out(part_path + "index_granularity.txt", 4096);
+        HashingWriteBuffer granularity_out_hashing(granularity_out);
+        writeIntText(index_granularity, granularity_out_hashing);
+        granularity_out_hashing.next();
+        checksums.files["index_granularity.txt"].file_size = granularity_out_hashing.count();
+        checksums.files["index_granularity.txt"].file_hash = granularity_out_hashing.getHash();
     }
 
     {
@@ -369,7 +451,10 @@ void MergedBlockOutputStream::writeSuffixAndFinalizePart(
     }
 
     new_part->rows_count = rows_count;
+    new_part->ttl_min = ttl_min;
+    new_part->ttl_max = ttl_max;
     new_part->marks_count = marks_count;
+    new_part->index_granularity = index_granularity;
     new_part->modification_time = time(nullptr);
     new_part->columns = *total_column_list;
     new_part->index.assign(std::make_move_iterator(index_columns.begin()), std::make_move_iterator(index_columns.end()));
@@ -377,28 +462,256 @@ void MergedBlockOutputStream::writeSuffixAndFinalizePart(
     new_part->bytes_on_disk = MergeTreeData::DataPart::calculateTotalSizeOnDisk(new_part->getFullPath());
 }
 
+void MergedBlockOutputStream::convertToCompactIfNeeded(const Names & stream_names, MergeTreeData::DataPart::Checksums & checksums)
+{
+    size_t min_bytes_for_wide_part = storage.settings.min_bytes_for_wide_part;
+    if (min_bytes_for_wide_part == 0)
+        return;
+
+    /// The older format infers the rows count of a part from the file size of one of its columns,
+    /// which a compact part does not have.
+    if (storage.format_version < MERGE_TREE_DATA_MIN_FORMAT_VERSION_WITH_CUSTOM_PARTITIONING)
+        return;
+
+    size_t total_data_bytes = 0;
+    for (const auto & name : stream_names)
+        total_data_bytes += checksums.files[name + DATA_FILE_EXTENSION].file_size;
+
+    if (total_data_bytes >= min_bytes_for_wide_part)
+        return;
+
+    WriteBufferFromFile data_file(part_path + "data.bin", DBMS_DEFAULT_BUFFER_SIZE, O_TRUNC | O_CREAT | O_WRONLY);
+    HashingWriteBuffer data_hashing(data_file);
+
+    for (const auto & name : stream_names)
+    {
+        size_t base_offset = data_hashing.count();
+
+        {
+            ReadBufferFromFile from(part_path + name + DATA_FILE_EXTENSION);
+            copyData(from, data_hashing);
+        }
+
+        /// Rebase marks of this stream: offsets in the compressed file become absolute positions in data.bin.
+        String marks_path = part_path + name + MARKS_FILE_EXTENSION;
+
+        std::vector<MarkInCompressedFile> marks;
+        {
+            ReadBufferFromFile marks_in(marks_path);
+            while (!marks_in.eof())
+            {
+                MarkInCompressedFile mark;
+                readIntBinary(mark.offset_in_compressed_file, marks_in);
+                readIntBinary(mark.offset_in_decompressed_block, marks_in);
+                mark.offset_in_compressed_file += base_offset;
+                marks.push_back(mark);
+            }
+        }
+
+        {
+            WriteBufferFromFile marks_out(marks_path, 4096, O_TRUNC | O_CREAT | O_WRONLY);
+            HashingWriteBuffer marks_hashing(marks_out);
+            for (const auto & mark : marks)
+            {
+                writeIntBinary(mark.offset_in_compressed_file, marks_hashing);
+                writeIntBinary(mark.offset_in_decompressed_block, marks_hashing);
+            }
+            marks_hashing.next();
+
+            checksums.files[name + MARKS_FILE_EXTENSION] = MergeTreeData::DataPart::Checksums::Checksum(
+                marks_hashing.count(), marks_hashing.getHash());
+        }
+
+        checksums.files.erase(name + DATA_FILE_EXTENSION);
+        Poco::File(part_path + name + DATA_FILE_EXTENSION).remove();
+    }
+
+    data_hashing.next();
+    checksums.files["data.bin"] = MergeTreeData::DataPart::Checksums::Checksum(data_hashing.count(), data_hashing.getHash());
+}
+
+void MergedBlockOutputStream::writeProjection(MergeTreeData::DataPart::Checksums & checksums)
+{
+    /// Concatenate the accumulated blocks into one and release them.
+    Block merged = projection_blocks.front().cloneEmpty();
+    {
+        MutableColumns merged_columns = merged.mutateColumns();
+        for (const auto & block : projection_blocks)
+        {
+            for (size_t i = 0; i < merged.columns(); ++i)
+            {
+                const auto & source = block.getByName(merged.getByPosition(i).name).column;
+                merged_columns[i]->insertRangeFrom(*source, 0, source->size());
+            }
+        }
+        merged.setColumns(std::move(merged_columns));
+    }
+    projection_blocks.clear();
+
+    SortDescription sort_description;
+    sort_description.reserve(storage.projection_sort_columns.size());
+    for (const auto & name : storage.projection_sort_columns)
+        sort_description.emplace_back(name, 1, 1);
+
+    IColumn::Permutation permutation;
+    stableGetPermutation(merged, sort_description, permutation);
+
+    MergedBlockOutputStream projection_out(
+        storage, part_path + "projection/", columns_list, compression_settings, storage.projection_sort_columns);
+    projection_out.writeWithPermutation(merged, &permutation);
+    projection_out.writeSuffixForProjection();
+
+    /// The metadata file at the root of the part, checksummed with it. The layout itself has
+    /// its own checksums.txt in the subdirectory and is verified when it is loaded for reading.
+    WriteBufferFromFile out(part_path + MergeTreeDataPart::PROJECTION_FILE_NAME, 4096);
+    HashingWriteBuffer out_hashing(out);
+    writeCString("projection format version: 1\n", out_hashing);
+    for (size_t i = 0; i < storage.projection_sort_columns.size(); ++i)
+    {
+        if (i != 0)
+            writeChar(' ', out_hashing);
+        writeBackQuotedString(storage.projection_sort_columns[i], out_hashing);
+    }
+    writeChar('\n', out_hashing);
+    writeIntText(rows_count, out_hashing);
+    writeChar('\n', out_hashing);
+    writeIntText(projection_out.marks_count, out_hashing);
+    writeChar('\n', out_hashing);
+    writeIntText(projection_out.index_granularity, out_hashing);
+    writeChar('\n', out_hashing);
+    out_hashing.next();
+    checksums.files[MergeTreeDataPart::PROJECTION_FILE_NAME].file_size = out_hashing.count();
+    checksums.files[MergeTreeDataPart::PROJECTION_FILE_NAME].file_hash = out_hashing.getHash();
+}
+
+void MergedBlockOutputStream::writeSuffixForProjection()
+{
+    MergeTreeData::DataPart::Checksums checksums;
+    finishDataSerialization(checksums);
+
+    {
+        /// Write a file with a description of columns.
+        WriteBufferFromFile out(part_path + "columns.txt", 4096);
+        columns_list.writeText(out);
+    }
+
+    {
+        /// Write file with checksums.
+        WriteBufferFromFile out(part_path + "checksums.txt", 4096);
+        checksums.write(out);
+    }
+}
+
 void MergedBlockOutputStream::init()
 {
     Poco::File(part_path).createDirectories();
 
-    if (storage.hasPrimaryKey())
+    if (storage.hasPrimaryKey() || !sort_columns_override.empty())
     {
         index_file_stream = std::make_unique<WriteBufferFromFile>(
             part_path + "primary.idx", DBMS_DEFAULT_BUFFER_SIZE, O_TRUNC | O_CREAT | O_WRONLY);
         index_stream = std::make_unique<HashingWriteBuffer>(*index_file_stream);
     }
+
+    /// The projection layout gets neither statistics nor skip indices of its own:
+    /// they describe the same rows as those of the main layout.
+    if (is_projection_writer)
+        return;
+
+    if (storage.settings.write_column_statistics)
+        statistics_collector = std::make_unique<MergeTreeColumnStatisticsCollector>(columns_list);
+
+    for (size_t i = 0; i < storage.skip_minmax_idx_columns.size(); ++i)
+    {
+        const String & column_name = storage.skip_minmax_idx_columns[i];
+
+        /// The indexed column may be absent from the written columns (e.g. a merge of a part created before ALTER).
+        if (columns_list.contains(column_name))
+            skip_minmax_indices[column_name] = std::make_unique<MergeTreeMinMaxGranuleIndex>(
+                column_name, storage.skip_minmax_idx_column_types[i]);
+    }
+
+    for (const String & column_name : storage.skip_ngrambf_idx_columns)
+        if (columns_list.contains(column_name))
+            skip_ngrambf_indices[column_name] = std::make_unique<MergeTreeNgramGranuleIndex>(column_name);
 }
 
 
+void MergedBlockOutputStream::updateTTL(const Block & block)
+{
+    Block block_copy = block;
+    storage.ttl_expression->execute(block_copy);
+
+    const ColumnWithTypeAndName & result = block_copy.getByName(storage.ttl_result_column);
+
+    auto update = [this](time_t t)
+    {
+        if (ttl_min == 0 || t < ttl_min)
+            ttl_min = t;
+        if (t > ttl_max)
+            ttl_max = t;
+    };
+
+    if (const ColumnUInt16 * column_date = typeid_cast<const ColumnUInt16 *>(result.column.get()))
+    {
+        const auto & date_lut = DateLUT::instance();
+        for (const auto & val : column_date->getData())
+            update(date_lut.fromDayNum(DayNum(val)));
+    }
+    else if (const ColumnUInt32 * column_date_time = typeid_cast<const ColumnUInt32 *>(result.column.get()))
+    {
+        for (const auto & val : column_date_time->getData())
+            update(val);
+    }
+    else
+        throw Exception("Unexpected type of result of TTL expression", ErrorCodes::LOGICAL_ERROR);
+}
+
 void MergedBlockOutputStream::writeImpl(const Block & block, const IColumn::Permutation * permutation)
 {
     block.checkNumberOfRows();
     size_t rows = block.rows();
 
+    if (storage.hasTableTTL() && rows)
+        updateTTL(block);
+
+    /// Statistics do not depend on the order of rows, so the unsorted block is fine.
+    if (statistics_collector && rows)
+        statistics_collector->update(block);
+
+    /// Keep the rows to re-sort them into the projection layout on finalize. The block only
+    /// shares the columns, but they would have been released otherwise, so cap the total size.
+    if (!is_projection_writer && !storage.projection_sort_columns.empty() && rows && !projection_skipped)
+    {
+        projection_blocks.push_back(block);
+        projection_accumulated_bytes += block.bytes();
+
+        if (projection_accumulated_bytes > storage.settings.projection_max_bytes)
+        {
+            projection_blocks.clear();
+            projection_skipped = true;
+            LOG_DEBUG(storage.log, "Will not write the projection for part " << part_path
+                << ": more than " << storage.settings.projection_max_bytes.toString() << " bytes of rows (projection_max_bytes)");
+        }
+    }
+
+    /// With adaptive granularity, choose rows per mark so that a granule takes approximately
+    /// index_granularity_bytes, judging by the first written block. The value is fixed for the whole part.
+    if (!index_granularity_decided)
+    {
+        size_t index_granularity_bytes = storage.settings.index_granularity_bytes;
+        if (index_granularity_bytes != 0 && rows != 0)
+        {
+            size_t average_row_size = std::max<size_t>(1, block.bytes() / rows);
+            index_granularity = std::min<size_t>(65536, std::max<size_t>(8, index_granularity_bytes / average_row_size));
+        }
+        index_granularity_decided = true;
+    }
+
     /// The set of written offset columns so that you do not write shared offsets of nested structures columns several times
     WrittenOffsetColumns offset_columns;
 
-    auto sort_columns = storage.getPrimarySortColumns();
+    auto sort_columns = is_projection_writer ? sort_columns_override : storage.getPrimarySortColumns();
 
     /// Here we will add the columns related to the Primary Key, then write the index.
     std::vector<ColumnWithTypeAndName> primary_columns(sort_columns.size());
@@ -445,6 +758,9 @@ void MergedBlockOutputStream::writeImpl(const Block & block, const IColumn::Perm
     {
         const ColumnWithTypeAndName & column = block.getByName(it->name);
 
+        auto skip_index_it = skip_minmax_indices.find(it->name);
+        auto ngram_index_it = skip_ngrambf_indices.find(it->name);
+
         if (permutation)
         {
             auto primary_column_it = primary_columns_name_to_position.find(it->name);
@@ -452,17 +768,32 @@ void MergedBlockOutputStream::writeImpl(const Block & block, const IColumn::Perm
             {
                 auto & primary_column = *primary_columns[primary_column_it->second].column;
                 writeData(column.name, *column.type, primary_column, offset_columns, false, serialization_states[i]);
+
+                if (skip_index_it != skip_minmax_indices.end())
+                    skip_index_it->second->update(primary_column, index_granularity);
+                if (ngram_index_it != skip_ngrambf_indices.end())
+                    ngram_index_it->second->update(primary_column, index_granularity);
             }
             else
             {
                 /// We rearrange the columns that are not included in the primary key here; Then the result is released - to save RAM.
                 ColumnPtr permuted_column = column.column->permute(*permutation, 0);
                 writeData(column.name, *column.type, *permuted_column, offset_columns, false, serialization_states[i]);
+
+                if (skip_index_it != skip_minmax_indices.end())
+                    skip_index_it->second->update(*permuted_column, index_granularity);
+                if (ngram_index_it != skip_ngrambf_indices.end())
+                    ngram_index_it->second->update(*permuted_column, index_granularity);
             }
         }
         else
         {
             writeData(column.name, *column.type, *column.column, offset_columns, false, serialization_states[i]);
+
+            if (skip_index_it != skip_minmax_indices.end())
+                skip_index_it->second->update(*column.column, index_granularity);
+            if (ngram_index_it != skip_ngrambf_indices.end())
+                ngram_index_it->second->update(*column.column, index_granularity);
         }
     }
 
@@ -478,9 +809,9 @@ void MergedBlockOutputStream::writeImpl(const Block & block, const IColumn::Perm
         auto temporarily_disable_memory_tracker = getCurrentMemoryTrackerActionLock();
 
         /// Write index. The index contains Primary Key value for each `index_granularity` row.
-        for (size_t i = index_offset; i < rows; i += storage.index_granularity)
+        for (size_t i = index_offset; i < rows; i += index_granularity)
         {
-            if (storage.hasPrimaryKey())
+            if (index_stream)
             {
                 for (size_t j = 0, size = primary_columns.size(); j < size; ++j)
                 {
@@ -494,8 +825,8 @@ void MergedBlockOutputStream::writeImpl(const Block & block, const IColumn::Perm
         }
     }
 
-    size_t written_for_last_mark = (storage.index_granularity - index_offset + rows) % storage.index_granularity;
-    index_offset = (storage.index_granularity - written_for_last_mark) % storage.index_granularity;
+    size_t written_for_last_mark = (index_granularity - index_offset + rows) % index_granularity;
+    index_offset = (index_granularity - written_for_last_mark) % index_granularity;
 }
 
 
@@ -504,11 +835,13 @@ void MergedBlockOutputStream::writeImpl(const Block & block, const IColumn::Perm
 MergedColumnOnlyOutputStream::MergedColumnOnlyOutputStream(
     MergeTreeData & storage_, const Block & header_, String part_path_, bool sync_,
     CompressionSettings compression_settings, bool skip_offsets_,
-    WrittenOffsetColumns & already_written_offset_columns)
+    WrittenOffsetColumns & already_written_offset_columns,
+    size_t index_granularity_)
     : IMergedBlockOutputStream(
         storage_, storage_.context.getSettings().min_compress_block_size,
         storage_.context.getSettings().max_compress_block_size, compression_settings,
-        storage_.context.getSettings().min_bytes_to_use_direct_io),
+        storage_.context.getSettings().min_bytes_to_use_direct_io,
+        index_granularity_),
     header(header_), part_path(part_path_), sync(sync_), skip_offsets(skip_offsets_),
     already_written_offset_columns(already_written_offset_columns)
 {
@@ -546,8 +879,8 @@ void MergedColumnOnlyOutputStream::write(const Block & block)
         writeData(column.name, *column.type, *column.column, offset_columns, skip_offsets, serialization_states[i]);
     }
 
-    size_t written_for_last_mark = (storage.index_granularity - index_offset + rows) % storage.index_granularity;
-    index_offset = (storage.index_granularity - written_for_last_mark) % storage.index_granularity;
+    size_t written_for_last_mark = (index_granularity - index_offset + rows) % index_granularity;
+    index_offset = (index_granularity - written_for_last_mark) % index_granularity;
 }
 
 void MergedColumnOnlyOutputStream::writeSuffix()
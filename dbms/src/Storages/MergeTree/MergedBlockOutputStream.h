@@ -3,7 +3,10 @@
 #include <IO/WriteBufferFromFile.h>
 #include <IO/CompressedWriteBuffer.h>
 #include <IO/HashingWriteBuffer.h>
+#include <Storages/MergeTree/MergeTreeColumnStatistics.h>
 #include <Storages/MergeTree/MergeTreeData.h>
+#include <Storages/MergeTree/MergeTreeMinMaxGranuleIndex.h>
+#include <Storages/MergeTree/MergeTreeNgramGranuleIndex.h>
 #include <DataStreams/IBlockOutputStream.h>
 
 #include <Columns/ColumnArray.h>
@@ -21,7 +24,11 @@ public:
         size_t min_compress_block_size_,
         size_t max_compress_block_size_,
         CompressionSettings compression_settings_,
-        size_t aio_threshold_);
+        size_t aio_threshold_,
+        size_t index_granularity_);
+
+    /// Rows per mark of the part being written.
+    size_t getIndexGranularity() const { return index_granularity; }
 
     using WrittenOffsetColumns = std::set<std::string>;
 
@@ -81,6 +88,10 @@ protected:
     /// The offset to the first row of the block for which you want to write the index.
     size_t index_offset = 0;
 
+    /// Rows per mark of the part being written. Either the table-wide setting, or (with adaptive
+    /// granularity) a value chosen from the byte size of the first written block.
+    size_t index_granularity = 0;
+
     size_t min_compress_block_size;
     size_t max_compress_block_size;
 
@@ -96,11 +107,15 @@ protected:
 class MergedBlockOutputStream final : public IMergedBlockOutputStream
 {
 public:
+    /// allow_compact_part: small parts may be converted to the compact form (single data.bin)
+    /// on finalize, if the min_bytes_for_wide_part setting is enabled. Pass true only for inserts:
+    /// merges must write the wide format so that parts do not stay compact forever.
     MergedBlockOutputStream(
         MergeTreeData & storage_,
         String part_path_,
         const NamesAndTypesList & columns_list_,
-        CompressionSettings compression_settings);
+        CompressionSettings compression_settings,
+        bool allow_compact_part_ = false);
 
     MergedBlockOutputStream(
         MergeTreeData & storage_,
@@ -110,6 +125,16 @@ public:
         const MergeTreeData::DataPart::ColumnToSize & merged_column_to_size_,
         size_t aio_threshold_);
 
+    /// A writer of the projection layout of a part: the primary index is built over
+    /// `sort_columns_override_` instead of the table's primary key, and no nested
+    /// projection, statistics or skip indices are produced.
+    MergedBlockOutputStream(
+        MergeTreeData & storage_,
+        String part_path_,
+        const NamesAndTypesList & columns_list_,
+        CompressionSettings compression_settings,
+        const Names & sort_columns_override_);
+
     std::string getPartPath() const;
 
     Block getHeader() const override { return storage.getSampleBlock(); }
@@ -137,17 +162,65 @@ private:
       */
     void writeImpl(const Block & block, const IColumn::Permutation * permutation);
 
+    /// Updates ttl_min/ttl_max with values of the table TTL expression over the rows of the block.
+    void updateTTL(const Block & block);
+
+    /// If the part came out smaller than min_bytes_for_wide_part, glue the per-column data files
+    /// into a single data.bin and rebase mark offsets onto positions in the shared file.
+    void convertToCompactIfNeeded(const Names & stream_names, MergeTreeData::DataPart::Checksums & checksums);
+
+    /// Finishes columns serialization and flushes the column streams and the index into `checksums`.
+    /// Returns the names of the finalized column streams.
+    Names finishDataSerialization(MergeTreeData::DataPart::Checksums & checksums);
+
+    /// Re-sorts the accumulated rows by projection_sort_columns, writes them into the projection/
+    /// subdirectory of the part and records projection.txt in `checksums` (see MergeTreeDataPart).
+    void writeProjection(MergeTreeData::DataPart::Checksums & checksums);
+
+    /// Finalize the projection layout itself (called on the nested writer).
+    void writeSuffixForProjection();
+
 private:
     NamesAndTypesList columns_list;
     SerializationStates serialization_states;
     String part_path;
 
+    bool allow_compact_part = false;
+
     size_t rows_count = 0;
     size_t marks_count = 0;
 
+    /// Min and max values of the table TTL expression over the written rows (see MergeTreeDataPart).
+    time_t ttl_min = 0;
+    time_t ttl_max = 0;
+
     std::unique_ptr<WriteBufferFromFile> index_file_stream;
     std::unique_ptr<HashingWriteBuffer> index_stream;
     MutableColumns index_columns;
+
+    /// Per-granule min-max skip indices being built for this part, by column name.
+    std::map<String, std::unique_ptr<MergeTreeMinMaxGranuleIndex>> skip_minmax_indices;
+
+    /// Per-granule n-gram bloom filter indices being built for this part, by column name.
+    std::map<String, std::unique_ptr<MergeTreeNgramGranuleIndex>> skip_ngrambf_indices;
+
+    /// Builds statistics.txt of the part (see MergeTreeColumnStatistics.h).
+    /// nullptr when the write_column_statistics setting is disabled.
+    std::unique_ptr<MergeTreeColumnStatisticsCollector> statistics_collector;
+
+    /// Non-empty when this stream writes the projection layout of a part: the index
+    /// is built over these columns instead of the table's primary key.
+    Names sort_columns_override;
+    bool is_projection_writer = false;
+
+    /// Written blocks accumulated to be re-sorted into the projection layout on finalize.
+    /// Cleared (and the projection skipped) when they exceed the projection_max_bytes setting.
+    Blocks projection_blocks;
+    size_t projection_accumulated_bytes = 0;
+    bool projection_skipped = false;
+
+    /// With adaptive granularity, rows per mark are chosen from the byte size of the first written block.
+    bool index_granularity_decided = false;
 };
 
 
@@ -161,7 +234,8 @@ public:
     MergedColumnOnlyOutputStream(
         MergeTreeData & storage_, const Block & header_, String part_path_, bool sync_,
         CompressionSettings compression_settings, bool skip_offsets_,
-        WrittenOffsetColumns & already_written_offset_columns);
+        WrittenOffsetColumns & already_written_offset_columns,
+        size_t index_granularity_);
 
     Block getHeader() const override { return header; }
     void write(const Block & block) override;
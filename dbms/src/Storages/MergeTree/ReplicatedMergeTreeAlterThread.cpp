@@ -59,6 +59,15 @@ void ReplicatedMergeTreeAlterThread::run()
 
         bool changed_version = (stat.version != storage.columns_version);
 
+        /// Purely metadata ALTERs (e.g. ADD COLUMN) do not require modifying any files of the
+        /// parts: parts keep the columns they were created with and readers fill in the missing
+        /// columns with default values. For such ALTERs don't iterate over the parts at all
+        /// (there may be a lot of them). After a restart or an error the table-level check is not
+        /// enough, because an interrupted ALTER may have left some parts unconverted, so recheck
+        /// all of them.
+        bool parts_need_update = force_recheck_parts
+            || storage.data.alterRequiresPartUpdates(columns_in_zk.getAllPhysical());
+
         {
             /// If you need to lock table structure, then suspend merges.
             ActionLock merge_blocker;
@@ -125,43 +134,46 @@ void ReplicatedMergeTreeAlterThread::run()
 
                 const auto columns_for_parts = storage.getColumns().getAllPhysical();
 
-                for (const MergeTreeData::DataPartPtr & part : parts)
+                if (parts_need_update)
                 {
-                    /// Update the part and write result to temporary files.
-                    /// TODO: You can skip checking for too large changes if ZooKeeper has, for example,
-                    /// node /flags/force_alter.
-                    auto transaction = storage.data.alterDataPart(
-                        part, columns_for_parts, storage.data.primary_expr_ast, false);
-
-                    if (!transaction)
-                        continue;
-
-                    ++changed_parts;
-
-                    /// Update part metadata in ZooKeeper.
-                    Coordination::Requests ops;
-                    ops.emplace_back(zkutil::makeSetRequest(
-                        storage.replica_path + "/parts/" + part->name + "/columns", transaction->getNewColumns().toString(), -1));
-                    ops.emplace_back(zkutil::makeSetRequest(
-                        storage.replica_path + "/parts/" + part->name + "/checksums",
-                        storage.getChecksumsForZooKeeper(transaction->getNewChecksums()),
-                        -1));
-
-                    try
+                    for (const MergeTreeData::DataPartPtr & part : parts)
                     {
-                        zookeeper->multi(ops);
+                        /// Update the part and write result to temporary files.
+                        /// TODO: You can skip checking for too large changes if ZooKeeper has, for example,
+                        /// node /flags/force_alter.
+                        auto transaction = storage.data.alterDataPart(
+                            part, columns_for_parts, storage.data.primary_expr_ast, false);
+
+                        if (!transaction)
+                            continue;
+
+                        ++changed_parts;
+
+                        /// Update part metadata in ZooKeeper.
+                        Coordination::Requests ops;
+                        ops.emplace_back(zkutil::makeSetRequest(
+                            storage.replica_path + "/parts/" + part->name + "/columns", transaction->getNewColumns().toString(), -1));
+                        ops.emplace_back(zkutil::makeSetRequest(
+                            storage.replica_path + "/parts/" + part->name + "/checksums",
+                            storage.getChecksumsForZooKeeper(transaction->getNewChecksums()),
+                            -1));
+
+                        try
+                        {
+                            zookeeper->multi(ops);
+                        }
+                        catch (const Coordination::Exception & e)
+                        {
+                            /// The part does not exist in ZK. We will add to queue for verification - maybe the part is superfluous, and it must be removed locally.
+                            if (e.code == Coordination::ZNONODE)
+                                storage.enqueuePartForCheck(part->name);
+
+                            throw;
+                        }
+
+                        /// Apply file changes.
+                        transaction->commit();
                     }
-                    catch (const Coordination::Exception & e)
-                    {
-                        /// The part does not exist in ZK. We will add to queue for verification - maybe the part is superfluous, and it must be removed locally.
-                        if (e.code == Coordination::ZNONODE)
-                            storage.enqueuePartForCheck(part->name);
-
-                        throw;
-                    }
-
-                    /// Apply file changes.
-                    transaction->commit();
                 }
 
                 /// Columns sizes could be quietly changed in case of MODIFY/ADD COLUMN
@@ -33,8 +33,12 @@ namespace ErrorCodes
 
 
 ReplicatedMergeTreeBlockOutputStream::ReplicatedMergeTreeBlockOutputStream(
-    StorageReplicatedMergeTree & storage_, size_t quorum_, size_t quorum_timeout_ms_, bool deduplicate_)
+    StorageReplicatedMergeTree & storage_, size_t quorum_, size_t quorum_timeout_ms_, bool deduplicate_, String deduplication_token_,
+    UInt64 parts_to_delay_insert_override_, UInt64 parts_to_throw_insert_override_)
     : storage(storage_), quorum(quorum_), quorum_timeout_ms(quorum_timeout_ms_), deduplicate(deduplicate_),
+    deduplication_token(std::move(deduplication_token_)),
+    parts_to_delay_insert_override(parts_to_delay_insert_override_),
+    parts_to_throw_insert_override(parts_to_throw_insert_override_),
     log(&Logger::get(storage.data.getLogName() + " (Replicated OutputStream)"))
 {
     /// The quorum value `1` has the same meaning as if it is disabled.
@@ -109,7 +113,8 @@ void ReplicatedMergeTreeBlockOutputStream::write(const Block & block)
     last_block_is_duplicate = false;
 
     /// TODO Is it possible to not lock the table structure here?
-    storage.data.delayInsertOrThrowIfNeeded(&storage.partial_shutdown_event);
+    storage.data.delayInsertOrThrowIfNeeded(&storage.partial_shutdown_event,
+        parts_to_delay_insert_override, parts_to_throw_insert_override);
 
     auto zookeeper = storage.getZooKeeper();
     assertSessionIsNotExpired(zookeeper);
@@ -136,18 +141,29 @@ void ReplicatedMergeTreeBlockOutputStream::write(const Block & block)
 
         if (deduplicate)
         {
-            SipHash hash;
-            part->checksums.computeTotalChecksumDataOnly(hash);
-            union
+            if (!deduplication_token.empty())
             {
-                char bytes[16];
-                UInt64 words[2];
-            } hash_value;
-            hash.get128(hash_value.bytes);
-
-            /// We add the hash from the data and partition identifier to deduplication ID.
-            /// That is, do not insert the same data to the same partition twice.
-            block_id = part->info.partition_id + "_" + toString(hash_value.words[0]) + "_" + toString(hash_value.words[1]);
+                /// An explicit token replaces the hash of the data, so retries deduplicate
+                ///  even when the retried data is not byte-identical.
+                /// The chunk ordinal keeps block ids of a multi-part insert distinct.
+                block_id = part->info.partition_id + "_" + deduplication_token + "_" + toString(deduplicated_chunk_num);
+                ++deduplicated_chunk_num;
+            }
+            else
+            {
+                SipHash hash;
+                part->checksums.computeTotalChecksumDataOnly(hash);
+                union
+                {
+                    char bytes[16];
+                    UInt64 words[2];
+                } hash_value;
+                hash.get128(hash_value.bytes);
+
+                /// We add the hash from the data and partition identifier to deduplication ID.
+                /// That is, do not insert the same data to the same partition twice.
+                block_id = part->info.partition_id + "_" + toString(hash_value.words[0]) + "_" + toString(hash_value.words[1]);
+            }
 
             LOG_DEBUG(log, "Wrote block with ID '" << block_id << "', " << block.rows() << " rows");
         }
@@ -414,7 +430,7 @@ void ReplicatedMergeTreeBlockOutputStream::commitPart(zkutil::ZooKeeperPtr & zoo
 
 void ReplicatedMergeTreeBlockOutputStream::writePrefix()
 {
-    storage.data.throwInsertIfNeeded();
+    storage.data.throwInsertIfNeeded(parts_to_throw_insert_override);
 }
 
 
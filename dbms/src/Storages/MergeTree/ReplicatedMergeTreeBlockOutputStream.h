@@ -23,7 +23,8 @@ class ReplicatedMergeTreeBlockOutputStream : public IBlockOutputStream
 {
 public:
     ReplicatedMergeTreeBlockOutputStream(StorageReplicatedMergeTree & storage_, size_t quorum_, size_t quorum_timeout_ms_,
-                                         bool deduplicate_);
+                                         bool deduplicate_, String deduplication_token_ = "",
+                                         UInt64 parts_to_delay_insert_override_ = 0, UInt64 parts_to_throw_insert_override_ = 0);
 
     Block getHeader() const override;
     void writePrefix() override;
@@ -58,8 +59,16 @@ private:
     size_t quorum_timeout_ms;
 
     bool deduplicate = true;
+    /// If not empty, used for block ids instead of the hash of the data (see insert_deduplication_token).
+    String deduplication_token;
+    /// Ordinal of the written part within this insert; makes block ids of a multi-part insert distinct under one token.
+    size_t deduplicated_chunk_num = 0;
     bool last_block_is_duplicate = false;
 
+    /// Per-query overrides of the table settings with the same names (0 - use the table setting).
+    UInt64 parts_to_delay_insert_override = 0;
+    UInt64 parts_to_throw_insert_override = 0;
+
     using Logger = Poco::Logger;
     Logger * log;
 };
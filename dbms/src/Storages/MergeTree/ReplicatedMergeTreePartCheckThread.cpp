@@ -222,7 +222,7 @@ void ReplicatedMergeTreePartCheckThread::checkPart(const String & part_name)
 
                 checkDataPart(
                     storage.data.getFullPath() + part_name,
-                    storage.data.index_granularity,
+                    part->index_granularity,
                     true,
                     storage.data.primary_key_data_types,
                     [this] { return need_stop.load(); });
@@ -754,16 +754,22 @@ size_t ReplicatedMergeTreeQueue::getConflictsCountForRange(
 {
     std::vector<std::pair<String, LogEntryPtr>> conflicts;
 
-    for (auto & future_part_elem : future_parts)
+    /// Parts of other partitions are always disjoint with the range.
+    auto bucket = future_parts_by_partition.find(range.partition_id);
+    if (bucket != future_parts_by_partition.end())
     {
-        /// Do not check itself log entry
-        if (future_part_elem.second->znode_name == entry.znode_name)
-            continue;
-
-        if (!range.isDisjoint(MergeTreePartInfo::fromPartName(future_part_elem.first, format_version)))
+        for (const auto & future_part_elem : bucket->second)
         {
-            conflicts.emplace_back(future_part_elem.first, future_part_elem.second);
-            continue;
+            if (range.isDisjoint(future_part_elem.second))
+                continue;
+
+            const LogEntryPtr & conflicting_entry = future_parts.at(future_part_elem.first);
+
+            /// Do not check itself log entry
+            if (conflicting_entry->znode_name == entry.znode_name)
+                continue;
+
+            conflicts.emplace_back(future_part_elem.first, conflicting_entry);
         }
     }
 
@@ -812,16 +818,20 @@ bool ReplicatedMergeTreeQueue::isNotCoveredByFuturePartsImpl(const String & new_
     /// NOTE The above is redundant, but left for a more convenient message in the log.
     auto result_part = MergeTreePartInfo::fromPartName(new_part_name, format_version);
 
-    /// It can slow down when the size of `future_parts` is large. But it can not be large, since `BackgroundProcessingPool` is limited.
-    for (const auto & future_part_elem : future_parts)
+    /// Only a part of the same partition can cover this one, so it is enough to check one bucket
+    /// of the partition index (the infos there are pre-parsed). This keeps queue selection cheap
+    /// on tables with long queues over many partitions.
+    auto bucket = future_parts_by_partition.find(result_part.partition_id);
+    if (bucket != future_parts_by_partition.end())
     {
-        auto future_part = MergeTreePartInfo::fromPartName(future_part_elem.first, format_version);
-
-        if (future_part.contains(result_part))
+        for (const auto & future_part_elem : bucket->second)
         {
-            out_reason = "Not executing log entry for part " + new_part_name + " because it is covered by part "
-                         + future_part_elem.first + " that is currently executing";
-            return false;
+            if (future_part_elem.second.contains(result_part))
+            {
+                out_reason = "Not executing log entry for part " + new_part_name + " because it is covered by part "
+                             + future_part_elem.first + " that is currently executing";
+                return false;
+            }
         }
     }
 
@@ -965,6 +975,9 @@ ReplicatedMergeTreeQueue::CurrentlyExecuting::CurrentlyExecuting(const Replicate
     {
         if (!queue.future_parts.emplace(new_part_name, entry).second)
             throw Exception("Tagging already tagged future part " + new_part_name + ". This is a bug.", ErrorCodes::LOGICAL_ERROR);
+
+        auto part_info = MergeTreePartInfo::fromPartName(new_part_name, queue.format_version);
+        queue.future_parts_by_partition[part_info.partition_id].emplace(new_part_name, part_info);
     }
 }
 
@@ -983,6 +996,9 @@ void ReplicatedMergeTreeQueue::CurrentlyExecuting::setActualPartName(ReplicatedM
 
     if (!queue.future_parts.emplace(entry.actual_new_part_name, entry.shared_from_this()).second)
         throw Exception("Attaching already existing future part " + entry.actual_new_part_name + ". This is a bug.", ErrorCodes::LOGICAL_ERROR);
+
+    auto part_info = MergeTreePartInfo::fromPartName(entry.actual_new_part_name, queue.format_version);
+    queue.future_parts_by_partition[part_info.partition_id].emplace(entry.actual_new_part_name, part_info);
 }
 
 
@@ -993,16 +1009,35 @@ ReplicatedMergeTreeQueue::CurrentlyExecuting::~CurrentlyExecuting()
     entry->currently_executing = false;
     entry->execution_complete.notify_all();
 
+    auto erase_from_partition_index = [this](const String & part_name)
+    {
+        auto part_info = MergeTreePartInfo::fromPartName(part_name, queue.format_version);
+        auto bucket = queue.future_parts_by_partition.find(part_info.partition_id);
+        if (bucket != queue.future_parts_by_partition.end())
+        {
+            bucket->second.erase(part_name);
+            if (bucket->second.empty())
+                queue.future_parts_by_partition.erase(bucket);
+        }
+    };
+
     for (const String & new_part_name : entry->getBlockingPartNames())
     {
         if (!queue.future_parts.erase(new_part_name))
             LOG_ERROR(queue.log, "Untagging already untagged future part " + new_part_name + ". This is a bug.");
+
+        erase_from_partition_index(new_part_name);
     }
 
     if (!entry->actual_new_part_name.empty())
     {
-        if (entry->actual_new_part_name != entry->new_part_name && !queue.future_parts.erase(entry->actual_new_part_name))
-            LOG_ERROR(queue.log, "Untagging already untagged future part " + entry->actual_new_part_name + ". This is a bug.");
+        if (entry->actual_new_part_name != entry->new_part_name)
+        {
+            if (!queue.future_parts.erase(entry->actual_new_part_name))
+                LOG_ERROR(queue.log, "Untagging already untagged future part " + entry->actual_new_part_name + ". This is a bug.");
+
+            erase_from_partition_index(entry->actual_new_part_name);
+        }
 
         entry->actual_new_part_name.clear();
     }
@@ -1015,6 +1050,17 @@ ReplicatedMergeTreeQueue::SelectedEntry ReplicatedMergeTreeQueue::selectEntryToP
 
     std::lock_guard<std::mutex> lock(state_mutex);
 
+    /// Priority of a fetch: prefer parts of lower level (they are small and recent, and after a long
+    /// replica lag they unblock consistency of SELECTs faster than big old merged parts) and, among
+    /// those, parts with more recent data. Entries other than fetches are executed in queue order.
+    auto fetch_priority = [this](const LogEntryPtr & candidate)
+    {
+        auto part_info = MergeTreePartInfo::fromPartName(candidate->new_part_name, format_version);
+        return std::make_pair(part_info.level, -part_info.max_block);
+    };
+
+    Queue::iterator selected = queue.end();
+
     for (auto it = queue.begin(); it != queue.end(); ++it)
     {
         if ((*it)->currently_executing)
@@ -1022,9 +1068,16 @@ ReplicatedMergeTreeQueue::SelectedEntry ReplicatedMergeTreeQueue::selectEntryToP
 
         if (shouldExecuteLogEntry(**it, (*it)->postpone_reason, merger_mutator, data, lock))
         {
-            entry = *it;
-            queue.splice(queue.end(), queue, it);
-            break;
+            if (selected == queue.end())
+            {
+                selected = it;
+                /// Only fetches are reordered: if the first executable entry is not a fetch,
+                /// take it right away as before.
+                if ((*it)->type != LogEntry::GET_PART)
+                    break;
+            }
+            else if ((*it)->type == LogEntry::GET_PART && fetch_priority(*it) < fetch_priority(*selected))
+                selected = it;
         }
         else
         {
@@ -1033,6 +1086,12 @@ ReplicatedMergeTreeQueue::SelectedEntry ReplicatedMergeTreeQueue::selectEntryToP
         }
     }
 
+    if (selected != queue.end())
+    {
+        entry = *selected;
+        queue.splice(queue.end(), queue, selected);
+    }
+
     if (entry)
         return { entry, std::unique_ptr<CurrentlyExecuting>{ new CurrentlyExecuting(entry, *this) } };
     else
@@ -82,6 +82,11 @@ private:
     using FuturePartsSet = std::map<String, LogEntryPtr>;
     FuturePartsSet future_parts;
 
+    /// The same parts grouped by partition with pre-parsed infos. Parts of different partitions
+    /// never intersect, so coverage and conflict checks consult only the bucket of one partition
+    /// instead of parsing every future part name on each queue selection.
+    std::unordered_map<String, std::map<String, MergeTreePartInfo>> future_parts_by_partition;
+
     /// Index of the first log entry that we didn't see yet.
     Int64 log_pointer = 0;
 
@@ -116,6 +116,14 @@ public:
                 + toString(mrk_hashing_buf.count()), ErrorCodes::CORRUPTED_DATA);
     }
 
+    /// Accounts the bytes read from disk since the previous call in the throttler (which sleeps if needed).
+    void throttle(const ThrottlerPtr & throttler)
+    {
+        size_t bytes_read = compressed_hashing_buf.count() + mrk_hashing_buf.count();
+        throttler->add(bytes_read - throttled_bytes);
+        throttled_bytes = bytes_read;
+    }
+
     void saveChecksums(MergeTreeData::DataPart::Checksums & checksums)
     {
         checksums.files[base_name + ".bin"] = MergeTreeData::DataPart::Checksums::Checksum(
@@ -125,6 +133,9 @@ public:
         checksums.files[base_name + ".mrk"] = MergeTreeData::DataPart::Checksums::Checksum(
             mrk_hashing_buf.count(), mrk_hashing_buf.getHash());
     }
+
+private:
+    size_t throttled_bytes = 0;
 };
 
 }
@@ -135,7 +146,8 @@ MergeTreeData::DataPart::Checksums checkDataPart(
     size_t index_granularity,
     bool require_checksums,
     const DataTypes & primary_key_data_types,
-    std::function<bool()> is_cancelled)
+    std::function<bool()> is_cancelled,
+    ThrottlerPtr throttler)
 {
     Logger * log = &Logger::get("checkDataPart");
 
@@ -205,6 +217,9 @@ MergeTreeData::DataPart::Checksums checkDataPart(
 
         size_t primary_idx_size = hashing_buf.count();
 
+        if (throttler)
+            throttler->add(primary_idx_size);
+
         checksums_data.files["primary.idx"] = MergeTreeData::DataPart::Checksums::Checksum(primary_idx_size, hashing_buf.getHash());
     }
 
@@ -215,11 +230,17 @@ MergeTreeData::DataPart::Checksums checkDataPart(
         const String & file_name = dir_it.name();
         if (file_name == "count.txt"
             || file_name == "partition.dat"
-            || (startsWith(file_name, "minmax_") && endsWith(file_name, ".idx")))
+            || file_name == "index_granularity.txt"
+            || file_name == "deleted_mask.bin"
+            || file_name == "ttl.txt"
+            || (startsWith(file_name, "minmax_") && endsWith(file_name, ".idx"))
+            || (startsWith(file_name, "skp_") && endsWith(file_name, ".idx")))
         {
             ReadBufferFromFile file_buf(dir_it->path());
             HashingReadBuffer hashing_buf(file_buf);
             hashing_buf.tryIgnore(std::numeric_limits<size_t>::max());
+            if (throttler)
+                throttler->add(hashing_buf.count());
             checksums_data.files[file_name] = MergeTreeData::DataPart::Checksums::Checksum(hashing_buf.count(), hashing_buf.getHash());
         }
     }
@@ -239,6 +260,49 @@ MergeTreeData::DataPart::Checksums checkDataPart(
         rows = count;
     }
 
+    /// Compact part: data of all columns lives in the single data.bin and mark offsets are absolute
+    /// positions in it, so per-mark validation done below is not applicable. Check file hashes only.
+    if (Poco::File(path + "data.bin").exists())
+    {
+        auto save_plain_file_checksum = [&](const String & file_name)
+        {
+            ReadBufferFromFile file_buf(path + file_name);
+            HashingReadBuffer hashing_buf(file_buf);
+            hashing_buf.tryIgnore(std::numeric_limits<size_t>::max());
+            if (throttler)
+                throttler->add(hashing_buf.count());
+            checksums_data.files[file_name] = MergeTreeData::DataPart::Checksums::Checksum(hashing_buf.count(), hashing_buf.getHash());
+        };
+
+        save_plain_file_checksum("data.bin");
+
+        for (const NameAndTypePair & name_type : columns)
+        {
+            name_type.type->enumerateStreams([&](const IDataType::SubstreamPath & substream_path)
+            {
+                String file_name = IDataType::getFileNameForStream(name_type.name, substream_path);
+
+                /// A mutation may leave some streams with their own data file even in a compact part.
+                if (Poco::File(path + file_name + ".bin").exists())
+                {
+                    Stream stream(path, file_name);
+                    stream.uncompressed_hashing_buf.tryIgnore(std::numeric_limits<size_t>::max());
+                    stream.mrk_hashing_buf.tryIgnore(std::numeric_limits<size_t>::max());
+                    if (throttler)
+                        stream.throttle(throttler);
+                    stream.saveChecksums(checksums_data);
+                }
+                else if (Poco::File(path + file_name + ".mrk").exists())
+                    save_plain_file_checksum(file_name + ".mrk");
+            }, {});
+        }
+
+        if (require_checksums || !checksums_txt.files.empty())
+            checksums_txt.checkEqual(checksums_data, true);
+
+        return checksums_data;
+    }
+
     /// Read all columns, calculate checksums and validate marks.
     for (const NameAndTypePair & name_type : columns)
     {
@@ -297,6 +361,10 @@ MergeTreeData::DataPart::Checksums checkDataPart(
             size_t read_size = tmp_column->size();
             column_size += read_size;
 
+            if (throttler)
+                for (auto & stream : streams)
+                    stream.second.throttle(throttler);
+
             if (read_size < index_granularity)
                 break;
             else if (marks_eof)
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Storages/MergeTree/MergeTreeData.h>
+#include <Common/Throttler.h>
 
 
 namespace DB
@@ -11,12 +12,14 @@ namespace DB
     * - For arrays and strings, checks the correspondence of the size and amount of data.
     * - Checks the correctness of marks.
     * Throws an exception if the part is corrupted or if the check fails (TODO: you can try to separate these cases).
+    * If `throttler` is set, reading from disk is limited to its speed (used by background scrubbing).
     */
 MergeTreeData::DataPart::Checksums checkDataPart(
     const String & path,
     size_t index_granularity,
     bool require_checksums,
     const DataTypes & primary_key_data_types,    /// Check the primary key. If it is not necessary, pass an empty array.
-    std::function<bool()> is_cancelled = []{ return false; });
+    std::function<bool()> is_cancelled = []{ return false; },
+    ThrottlerPtr throttler = nullptr);
 
 }
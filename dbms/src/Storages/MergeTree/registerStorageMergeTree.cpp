@@ -351,7 +351,8 @@ static StoragePtr create(const StorageFactory::Arguments & args)
         */
 
     bool is_extended_storage_def =
-        args.storage_def->partition_by || args.storage_def->order_by || args.storage_def->sample_by || args.storage_def->settings;
+        args.storage_def->partition_by || args.storage_def->order_by || args.storage_def->sample_by
+        || args.storage_def->ttl_table || args.storage_def->settings;
 
     String name_part = args.engine_name.substr(0, args.engine_name.size() - strlen("MergeTree"));
 
@@ -579,6 +580,7 @@ static StoragePtr create(const StorageFactory::Arguments & args)
     ASTPtr partition_expr_list;
     ASTPtr primary_expr_list;
     ASTPtr sampling_expression;
+    ASTPtr ttl_table_ast;
     MergeTreeSettings storage_settings = args.context.getMergeTreeSettings();
 
     if (is_extended_storage_def)
@@ -596,6 +598,16 @@ static StoragePtr create(const StorageFactory::Arguments & args)
         if (args.storage_def->sample_by)
             sampling_expression = args.storage_def->sample_by->ptr();
 
+        if (args.storage_def->ttl_table)
+        {
+            /// Replicas apply TTL during merges independently of each other and would produce
+            /// diverging parts (the expiry threshold is the merge time).
+            if (replicated)
+                throw Exception("TTL is not supported for Replicated tables", ErrorCodes::BAD_ARGUMENTS);
+
+            ttl_table_ast = args.storage_def->ttl_table->ptr();
+        }
+
         storage_settings.loadFromQuery(*args.storage_def);
     }
     else
@@ -638,7 +650,7 @@ static StoragePtr create(const StorageFactory::Arguments & args)
         return StorageMergeTree::create(
             args.data_path, args.database_name, args.table_name, args.columns, args.attach,
             args.context, primary_expr_list, secondary_sorting_expr_list, date_column_name, partition_expr_list,
-            sampling_expression, merging_params, storage_settings,
+            sampling_expression, ttl_table_ast, merging_params, storage_settings,
             args.has_force_restore_data_flag);
 }
 
@@ -52,6 +52,17 @@ struct SelectQueryInfo
 
     PrewhereInfoPtr prewhere_info;
 
+    /// If not 0, the ORDER BY of the query is a prefix of the table sorting key and the storage
+    /// should return one stream per data part, sorted in key order (1) or reverse key order (-1).
+    /// The interpreter merges such streams instead of sorting (see optimize_read_in_order).
+    int read_in_order_direction = 0;
+
+    /// The GROUP BY keys of the query determine the partition, so groups of different
+    /// partitions are disjoint. The storage should return streams that each carry whole
+    /// partitions; the interpreter aggregates every stream independently, with no merge
+    /// phase (see optimize_partition_wise_aggregation).
+    bool aggregate_by_partitions = false;
+
     /// Prepared sets are used for indices by storage engine.
     /// Example: x IN (1, 2, 3)
     PreparedSets sets;
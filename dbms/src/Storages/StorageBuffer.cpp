@@ -2,6 +2,8 @@
 #include <Interpreters/InterpreterInsertQuery.h>
 #include <Interpreters/InterpreterAlterQuery.h>
 #include <Interpreters/evaluateConstantExpression.h>
+#include <Interpreters/Aggregator.h>
+#include <DataTypes/DataTypeAggregateFunction.h>
 #include <DataStreams/IProfilingBlockInputStream.h>
 #include <Databases/IDatabase.h>
 #include <Storages/StorageBuffer.h>
@@ -46,21 +48,62 @@ namespace ErrorCodes
 {
     extern const int INFINITE_LOOP;
     extern const int NUMBER_OF_ARGUMENTS_DOESNT_MATCH;
+    extern const int BAD_ARGUMENTS;
 }
 
 
 StorageBuffer::StorageBuffer(const std::string & name_, const ColumnsDescription & columns_,
     Context & context_,
     size_t num_shards_, const Thresholds & min_thresholds_, const Thresholds & max_thresholds_,
-    const String & destination_database_, const String & destination_table_, bool allow_materialized_)
+    const String & destination_database_, const String & destination_table_, bool allow_materialized_,
+    bool aggregating_)
     : IStorage{columns_},
     name(name_), context(context_),
     num_shards(num_shards_), buffers(num_shards_),
     min_thresholds(min_thresholds_), max_thresholds(max_thresholds_),
     destination_database(destination_database_), destination_table(destination_table_),
     no_destination(destination_database.empty() && destination_table.empty()),
-    allow_materialized(allow_materialized_), log(&Logger::get("StorageBuffer (" + name + ")"))
+    allow_materialized(allow_materialized_), aggregating(aggregating_),
+    log(&Logger::get("StorageBuffer (" + name + ")"))
 {
+    if (aggregating)
+    {
+        /// Rearrange the (sorted) sample block into the layout the aggregator expects: keys first, then the states.
+        Block sample = getSampleBlock().sortColumns();
+
+        ColumnNumbers keys;
+        AggregateDescriptions aggregates;
+        ColumnsWithTypeAndName state_columns;
+
+        for (size_t i = 0, size = sample.columns(); i < size; ++i)
+        {
+            const auto & column = sample.getByPosition(i);
+
+            if (const auto * type = typeid_cast<const DataTypeAggregateFunction *>(column.type.get()))
+            {
+                AggregateDescription description;
+                description.function = type->getFunction();
+                description.column_name = column.name;
+                aggregates.push_back(std::move(description));
+                state_columns.push_back(column);
+            }
+            else
+            {
+                keys.push_back(aggregating_header.columns());
+                aggregating_header.insert(column);
+            }
+        }
+
+        if (aggregates.empty())
+            throw Exception("Storage AggregatingBuffer requires at least one column of AggregateFunction type",
+                ErrorCodes::BAD_ARGUMENTS);
+
+        for (const auto & column : state_columns)
+            aggregating_header.insert(column);
+
+        aggregator = std::make_unique<Aggregator>(
+            Aggregator::Params(aggregating_header, keys, aggregates, false, 1));
+    }
 }
 
 StorageBuffer::~StorageBuffer()
@@ -307,12 +350,12 @@ public:
             least_busy_buffer = &storage.buffers[start_shard_num];
             least_busy_lock = std::unique_lock<std::mutex>(least_busy_buffer->mutex);
         }
-        insertIntoBuffer(block, *least_busy_buffer);
+        insertIntoBuffer(block, *least_busy_buffer, least_busy_lock);
     }
 private:
     StorageBuffer & storage;
 
-    void insertIntoBuffer(const Block & block, StorageBuffer::Buffer & buffer)
+    void insertIntoBuffer(const Block & block, StorageBuffer::Buffer & buffer, std::unique_lock<std::mutex> & lock)
     {
         time_t current_time = time(nullptr);
 
@@ -330,13 +373,17 @@ private:
               *  an exception will be thrown, and new data will not be added to the buffer.
               */
 
-            storage.flushBuffer(buffer, true, true /* locked */);
+            storage.flushBuffer(buffer, true, &lock);
         }
 
         if (!buffer.first_write_time)
             buffer.first_write_time = current_time;
 
         appendBlock(sorted_block, buffer.data);
+
+        /// Keep the buffer collapsed: at most one row per key.
+        if (storage.aggregating)
+            storage.collapseBuffer(buffer);
     }
 };
 
@@ -460,6 +507,24 @@ bool StorageBuffer::checkThresholdsImpl(size_t rows, size_t bytes, time_t time_p
 }
 
 
+void StorageBuffer::collapseBuffer(Buffer & buffer)
+{
+    if (!buffer.data.rows())
+        return;
+
+    /// Rearrange the buffered block into the aggregator's layout, merge rows with equal keys,
+    ///  and put the result back with sorted columns, as `appendBlock` expects.
+    Block arranged = aggregating_header.cloneEmpty();
+    for (size_t i = 0, size = arranged.columns(); i < size; ++i)
+        arranged.getByPosition(i).column = buffer.data.getByName(arranged.getByPosition(i).name).column;
+
+    BlocksList blocks;
+    blocks.push_back(std::move(arranged));
+
+    buffer.data = aggregator->mergeBlocks(blocks, false).sortColumns();
+}
+
+
 void StorageBuffer::flushAllBuffers(const bool check_thresholds)
 {
     for (auto & buf : buffers)
@@ -467,7 +532,7 @@ void StorageBuffer::flushAllBuffers(const bool check_thresholds)
 }
 
 
-void StorageBuffer::flushBuffer(Buffer & buffer, bool check_thresholds, bool locked)
+void StorageBuffer::flushBuffer(Buffer & buffer, bool check_thresholds, std::unique_lock<std::mutex> * external_lock)
 {
     Block block_to_write;
     time_t current_time = time(nullptr);
@@ -476,8 +541,9 @@ void StorageBuffer::flushBuffer(Buffer & buffer, bool check_thresholds, bool loc
     size_t bytes = 0;
     time_t time_passed = 0;
 
-    std::unique_lock<std::mutex> lock(buffer.mutex, std::defer_lock);
-    if (!locked)
+    std::unique_lock<std::mutex> own_lock(buffer.mutex, std::defer_lock);
+    std::unique_lock<std::mutex> & lock = external_lock ? *external_lock : own_lock;
+    if (!external_lock)
         lock.lock();
 
     block_to_write = buffer.data.cloneEmpty();
@@ -511,12 +577,15 @@ void StorageBuffer::flushBuffer(Buffer & buffer, bool check_thresholds, bool loc
     if (no_destination)
         return;
 
-    /** For simplicity, buffer is locked during write.
-        * We could unlock buffer temporary, but it would lead to too many difficulties:
-        * - data, that is written, will not be visible for SELECTs;
-        * - new data could be appended to buffer, and in case of exception, we must merge it with old data, that has not been written;
-        * - this could lead to infinite memory growth.
-        */
+    /** The detached block is written without holding the lock, so that inserts into this shard
+      *  do not wait for the destination table and insert latency does not depend on its write speed.
+      * The price is that the data in flight is visible neither in the buffer nor in the destination
+      *  for concurrent SELECTs until the write completes. Unbounded memory growth is not a concern:
+      *  rows inserted meanwhile trigger the next flush by thresholds as usual, and if the write fails,
+      *  the detached block is merged back and the exception propagates to the next flush initiator.
+      */
+    lock.unlock();
+
     try
     {
         writeBlockToDestination(block_to_write, context.tryGetTable(destination_database, destination_table));
@@ -527,17 +596,30 @@ void StorageBuffer::flushBuffer(Buffer & buffer, bool check_thresholds, bool loc
 
         /// Return the block to its place in the buffer.
 
+        lock.lock();
+
         CurrentMetrics::add(CurrentMetrics::StorageBufferRows, block_to_write.rows());
         CurrentMetrics::add(CurrentMetrics::StorageBufferBytes, block_to_write.bytes());
 
+        if (buffer.data)
+        {
+            /// Rows were inserted while the buffer was unlocked; put the detached block in front of them.
+            CurrentMetrics::sub(CurrentMetrics::StorageBufferRows, buffer.data.rows());
+            CurrentMetrics::sub(CurrentMetrics::StorageBufferBytes, buffer.data.bytes());
+            appendBlock(buffer.data, block_to_write);
+        }
         buffer.data.swap(block_to_write);
 
-        if (!buffer.first_write_time)
+        if (!buffer.first_write_time || buffer.first_write_time > current_time)
             buffer.first_write_time = current_time;
 
         /// After a while, the next write attempt will happen.
         throw;
     }
+
+    /// The caller that passed its own lock expects to still hold it on return.
+    if (external_lock)
+        lock.lock();
 }
 
 
@@ -653,14 +735,17 @@ void registerStorageBuffer(StorageFactory & factory)
       * db, table - in which table to put data from buffer.
       * num_buckets - level of parallelism.
       * min_time, max_time, min_rows, max_rows, min_bytes, max_bytes - conditions for flushing the buffer.
+      *
+      * AggregatingBuffer takes the same parameters, but keeps the buffered data pre-aggregated
+      *  (the table must contain AggregateFunction columns; see the comment in StorageBuffer.h).
       */
 
-    factory.registerStorage("Buffer", [](const StorageFactory::Arguments & args)
+    auto create = [](const StorageFactory::Arguments & args, bool aggregating)
     {
         ASTs & engine_args = args.engine_args;
 
         if (engine_args.size() != 9)
-            throw Exception("Storage Buffer requires 9 parameters: "
+            throw Exception("Storage " + String(aggregating ? "AggregatingBuffer" : "Buffer") + " requires 9 parameters: "
                 " destination_database, destination_table, num_buckets, min_time, max_time, min_rows, max_rows, min_bytes, max_bytes.",
                 ErrorCodes::NUMBER_OF_ARGUMENTS_DOESNT_MATCH);
 
@@ -686,8 +771,12 @@ void registerStorageBuffer(StorageFactory & factory)
             StorageBuffer::Thresholds{min_time, min_rows, min_bytes},
             StorageBuffer::Thresholds{max_time, max_rows, max_bytes},
             destination_database, destination_table,
-            static_cast<bool>(args.local_context.getSettingsRef().insert_allow_materialized_columns));
-    });
+            static_cast<bool>(args.local_context.getSettingsRef().insert_allow_materialized_columns),
+            aggregating);
+    };
+
+    factory.registerStorage("Buffer", [create](const StorageFactory::Arguments & args) { return create(args, false); });
+    factory.registerStorage("AggregatingBuffer", [create](const StorageFactory::Arguments & args) { return create(args, true); });
 }
 
 }
@@ -16,6 +16,7 @@ namespace DB
 {
 
 class Context;
+class Aggregator;
 
 
 /** During insertion, buffers the data in the RAM until certain thresholds are exceeded.
@@ -35,6 +36,12 @@ class Context;
   *
   * When you destroy a Buffer table, all remaining data is flushed to the subordinate table.
   * The data in the buffer is not replicated, not logged to disk, not indexed. With a rough restart of the server, the data is lost.
+  *
+  * The AggregatingBuffer variant keeps the buffered data pre-aggregated. The table must contain columns of
+  *  AggregateFunction type (fed with -State data, as with AggregatingMergeTree); the remaining columns are the keys.
+  * After each insert the buffer is collapsed: rows with equal keys are merged into one, so the buffer holds
+  *  at most one row per key. Reads return the states as is - queries merge them (with -Merge combinators)
+  *  together with the states from the subordinate table; the flush also writes states.
   */
 class StorageBuffer : public ext::shared_ptr_helper<StorageBuffer>, public IStorage
 {
@@ -50,7 +57,7 @@ public:
         size_t bytes;   /// The number of (uncompressed) bytes in the block.
     };
 
-    std::string getName() const override { return "Buffer"; }
+    std::string getName() const override { return aggregating ? "AggregatingBuffer" : "Buffer"; }
     std::string getTableName() const override { return name; }
 
     QueryProcessingStage::Enum getQueryProcessingStage(const Context & context) const override;
@@ -106,6 +113,12 @@ private:
     bool no_destination;    /// If set, do not write data from the buffer, but simply empty the buffer.
     bool allow_materialized;
 
+    /// If set (the AggregatingBuffer engine), rows with equal keys are merged after each insert.
+    const bool aggregating;
+    /// The sample block rearranged into the layout the aggregator expects: keys first, then the states.
+    Block aggregating_header;
+    std::unique_ptr<Aggregator> aggregator;
+
     Poco::Logger * log;
 
     Poco::Event shutdown_event;
@@ -114,10 +127,16 @@ private:
 
     void flushAllBuffers(bool check_thresholds = true);
     /// Reset the buffer. If check_thresholds is set - resets only if thresholds are exceeded.
-    void flushBuffer(Buffer & buffer, bool check_thresholds, bool locked = false);
+    /// If the caller already holds buffer.mutex, it passes its lock in external_lock;
+    ///  the lock may be temporarily released during the write to the destination table.
+    void flushBuffer(Buffer & buffer, bool check_thresholds, std::unique_lock<std::mutex> * external_lock = nullptr);
     bool checkThresholds(const Buffer & buffer, time_t current_time, size_t additional_rows = 0, size_t additional_bytes = 0) const;
     bool checkThresholdsImpl(size_t rows, size_t bytes, time_t time_passed) const;
 
+    /// Merge rows of the buffer with equal keys into one (only for the AggregatingBuffer engine).
+    /// The caller must hold buffer.mutex.
+    void collapseBuffer(Buffer & buffer);
+
     /// `table` argument is passed, as it is sometimes evaluated beforehand. It must match the `destination`.
     void writeBlockToDestination(const Block & block, StoragePtr table);
 
@@ -130,7 +149,8 @@ protected:
     StorageBuffer(const std::string & name_, const ColumnsDescription & columns_,
         Context & context_,
         size_t num_shards_, const Thresholds & min_thresholds_, const Thresholds & max_thresholds_,
-        const String & destination_database_, const String & destination_table_, bool allow_materialized_);
+        const String & destination_database_, const String & destination_table_, bool allow_materialized_,
+        bool aggregating_ = false);
 
     ~StorageBuffer() override;
 };
@@ -14,6 +14,8 @@
 #include <Formats/FormatFactory.h>
 #include <DataStreams/IProfilingBlockInputStream.h>
 #include <DataStreams/IBlockOutputStream.h>
+#include <DataStreams/AddingConstColumnBlockInputStream.h>
+#include <DataTypes/DataTypeString.h>
 
 #include <Common/escapeForFileName.h>
 #include <Common/typeid_cast.h>
@@ -22,6 +24,7 @@
 
 #include <Poco/Path.h>
 #include <Poco/File.h>
+#include <Poco/Glob.h>
 
 namespace DB
 {
@@ -44,6 +47,12 @@ static std::string getTablePath(const std::string & db_dir_path, const std::stri
     return db_dir_path + escapeForFileName(table_name) + "/data." + escapeForFileName(format_name);
 }
 
+/// Characters interpreted by Poco::Glob: such path denotes a set of files, not a single file.
+static bool containsGlobs(const std::string & path)
+{
+    return path.find_first_of("*?[") != std::string::npos;
+}
+
 /// Both db_dir_path and table_path must be converted to absolute paths (in particular, path cannot contain '..').
 static void checkCreationIsAllowed(Context & context_global, const std::string & db_dir_path, const std::string & table_path, int table_fd)
 {
@@ -85,8 +94,29 @@ StorageFile::StorageFile(
                 poco_path = Poco::Path(db_dir_path, poco_path);
 
             path = poco_path.absolute().toString();
-            checkCreationIsAllowed(context_global, db_dir_path, path, table_fd);
             is_db_table = false;
+            path_with_globs = containsGlobs(path);
+
+            if (path_with_globs)
+            {
+                /// Each matched file is read by its own stream, see read().
+                std::set<std::string> matched_files;
+                Poco::Glob::glob(path, matched_files);
+
+                if (matched_files.empty())
+                    throw Exception("Path pattern " + path + " doesn't match any files", ErrorCodes::FILE_DOESNT_EXIST);
+
+                for (const auto & matched_path : matched_files)
+                {
+                    checkCreationIsAllowed(context_global, db_dir_path, matched_path, table_fd);
+                    paths.push_back(matched_path);
+                }
+            }
+            else
+            {
+                checkCreationIsAllowed(context_global, db_dir_path, path, table_fd);
+                paths.push_back(path);
+            }
         }
         else /// Is DB's file
         {
@@ -96,6 +126,7 @@ StorageFile::StorageFile(
             path = getTablePath(db_dir_path, table_name, format_name);
             is_db_table = true;
             Poco::File(Poco::Path(path).parent()).createDirectories();
+            paths.push_back(path);
         }
     }
     else /// Will use FD
@@ -115,7 +146,7 @@ StorageFile::StorageFile(
 class StorageFileBlockInputStream : public IProfilingBlockInputStream
 {
 public:
-    StorageFileBlockInputStream(StorageFile & storage_, const Context & context, size_t max_block_size)
+    StorageFileBlockInputStream(StorageFile & storage_, const Context & context, size_t max_block_size, const String & file_path)
         : storage(storage_)
     {
         if (storage.use_table_fd)
@@ -142,7 +173,7 @@ public:
         {
             storage.rwlock.lock_shared();
 
-            read_buf = std::make_unique<ReadBufferFromFile>(storage.path);
+            read_buf = std::make_unique<ReadBufferFromFile>(file_path);
         }
 
         reader = FormatFactory::instance().getInput(storage.format_name, *read_buf, storage.getSampleBlock(), context, max_block_size);
@@ -187,14 +218,58 @@ private:
 
 
 BlockInputStreams StorageFile::read(
-    const Names & /*column_names*/,
+    const Names & column_names,
     const SelectQueryInfo & /*query_info*/,
     const Context & context,
     QueryProcessingStage::Enum /*processed_stage*/,
     size_t max_block_size,
     unsigned /*num_streams*/)
 {
-    return BlockInputStreams(1, std::make_shared<StorageFileBlockInputStream>(*this, context, max_block_size));
+    bool need_path_column = false;
+    bool need_file_column = false;
+    for (const auto & column_name : column_names)
+    {
+        if (column_name == "_path")
+            need_path_column = true;
+        if (column_name == "_file")
+            need_file_column = true;
+    }
+
+    /// One stream per file: reading of several matched files is parallelized by the usual
+    /// union of streams up to max_threads.
+    BlockInputStreams res;
+    for (const auto & file_path : use_table_fd ? Strings{path} : paths)
+    {
+        BlockInputStreamPtr stream = std::make_shared<StorageFileBlockInputStream>(*this, context, max_block_size, file_path);
+
+        if (need_path_column)
+            stream = std::make_shared<AddingConstColumnBlockInputStream<String>>(
+                stream, std::make_shared<DataTypeString>(), file_path, "_path");
+        if (need_file_column)
+            stream = std::make_shared<AddingConstColumnBlockInputStream<String>>(
+                stream, std::make_shared<DataTypeString>(), Poco::Path(file_path).getFileName(), "_file");
+
+        res.push_back(stream);
+    }
+
+    return res;
+}
+
+
+NameAndTypePair StorageFile::getColumn(const String & column_name) const
+{
+    if (column_name == "_path" || column_name == "_file")
+        return { column_name, std::make_shared<DataTypeString>() };
+
+    return IStorage::getColumn(column_name);
+}
+
+bool StorageFile::hasColumn(const String & column_name) const
+{
+    if (column_name == "_path" || column_name == "_file")
+        return true;
+
+    return IStorage::hasColumn(column_name);
 }
 
 
@@ -254,6 +329,10 @@ BlockOutputStreamPtr StorageFile::write(
     const ASTPtr & /*query*/,
     const Settings & /*settings*/)
 {
+    if (path_with_globs)
+        throw Exception("Table '" + table_name + "' is readonly, because its path is a glob pattern matching several files",
+                        ErrorCodes::DATABASE_ACCESS_DENIED);
+
     return std::make_shared<StorageFileBlockOutputStream>(*this);
 }
 
@@ -276,6 +355,7 @@ void StorageFile::rename(const String & new_path_to_db, const String & /*new_dat
     Poco::File(path).renameTo(path_new);
 
     path = std::move(path_new);
+    paths = {path};
 }
 
 
@@ -43,6 +43,10 @@ public:
         const ASTPtr & query,
         const Settings & settings) override;
 
+    /// Virtual columns with the path and the name of the file a row was read from.
+    NameAndTypePair getColumn(const String & column_name) const override;
+    bool hasColumn(const String & column_name) const override;
+
     void drop() override;
 
     void rename(const String & new_path_to_db, const String & new_database_name, const String & new_table_name) override;
@@ -76,7 +80,12 @@ private:
     std::string path;
     int table_fd = -1;
 
+    /// Files to read. Usually contains only `path`, but a user's path may be a glob pattern
+    /// matching several files, each of which is read by its own stream.
+    Strings paths;
+
     bool is_db_table = true;                     /// Table is stored in real database, not user's file
+    bool path_with_globs = false;               /// Path is a glob pattern, the table is read only
     bool use_table_fd = false;                    /// Use table_fd insted of path
     std::atomic<bool> table_fd_was_used{false}; /// To detect repeating reads from stdin
     off_t table_fd_init_offset = -1;            /// Initial position of fd, used for repeating reads
@@ -1,12 +1,32 @@
 #include <Common/Exception.h>
 
+#include <Core/Defines.h>
+
 #include <DataStreams/IProfilingBlockInputStream.h>
+#include <DataStreams/NativeBlockInputStream.h>
+#include <DataStreams/NativeBlockOutputStream.h>
+#include <DataStreams/SquashingTransform.h>
 
 #include <Storages/StorageMemory.h>
 #include <Storages/StorageFactory.h>
 
+#include <Interpreters/Context.h>
+
+#include <IO/CompressedReadBuffer.h>
+#include <IO/CompressedWriteBuffer.h>
+#include <IO/ReadBufferFromFile.h>
+#include <IO/ReadBufferFromString.h>
+#include <IO/WriteBufferFromFile.h>
+#include <IO/WriteBufferFromString.h>
 #include <IO/WriteHelpers.h>
 
+#include <Parsers/ASTCreateQuery.h>
+#include <Parsers/ASTSetQuery.h>
+
+#include <Poco/File.h>
+
+#include <common/logger_useful.h>
+
 
 namespace DB
 {
@@ -14,14 +34,15 @@ namespace DB
 namespace ErrorCodes
 {
     extern const int NUMBER_OF_ARGUMENTS_DOESNT_MATCH;
+    extern const int BAD_ARGUMENTS;
 }
 
 
 class MemoryBlockInputStream : public IProfilingBlockInputStream
 {
 public:
-    MemoryBlockInputStream(const Names & column_names_, BlocksList::iterator begin_, BlocksList::iterator end_, const StorageMemory & storage_)
-        : column_names(column_names_), begin(begin_), end(end_), it(begin), storage(storage_) {}
+    MemoryBlockInputStream(const Names & column_names_, StorageMemory::SnapshotPtr snapshot_, size_t begin_, size_t end_, const StorageMemory & storage_)
+        : column_names(column_names_), snapshot(std::move(snapshot_)), position(begin_), end(end_), storage(storage_) {}
 
     String getName() const override { return "Memory"; }
 
@@ -30,29 +51,77 @@ public:
 protected:
     Block readImpl() override
     {
-        if (it == end)
-        {
+        if (position >= end)
             return Block();
+
+        const StorageMemory::Entry & entry = snapshot->entries[position];
+        ++position;
+
+        Block src;
+        if (entry.compressed)
+        {
+            ReadBufferFromString in(*entry.compressed);
+            CompressedReadBuffer decompressing_in(in);
+            NativeBlockInputStream block_in(decompressing_in, 0);
+            src = block_in.read();
         }
         else
-        {
-            Block src = *it;
-            Block res;
+            src = entry.block;
 
-            /// Add only required columns to `res`.
-            for (size_t i = 0, size = column_names.size(); i < size; ++i)
-                res.insert(src.getByName(column_names[i]));
+        Block res;
 
-            ++it;
-            return res;
-        }
+        /// Add only required columns to `res`.
+        for (size_t i = 0, size = column_names.size(); i < size; ++i)
+            res.insert(src.getByName(column_names[i]));
+
+        return res;
+    }
+private:
+    Names column_names;
+    /// Keeps the snapshot of the data alive, regardless of concurrent truncations.
+    StorageMemory::SnapshotPtr snapshot;
+    size_t position;
+    size_t end;
+    const StorageMemory & storage;
+};
+
+
+/// Reads back one file of blocks that were spilled to disk.
+class SpilledMemoryBlockInputStream : public IProfilingBlockInputStream
+{
+public:
+    SpilledMemoryBlockInputStream(const Names & column_names_, StorageMemory::SnapshotPtr snapshot_,
+            const StorageMemory::SpilledFilePtr & spilled_file, const StorageMemory & storage_)
+        : column_names(column_names_), snapshot(std::move(snapshot_)), storage(storage_)
+        , file_in(spilled_file->file.path()), compressed_in(file_in)
+        , block_in(std::make_shared<NativeBlockInputStream>(compressed_in, 0)) {}
+
+    String getName() const override { return "SpilledMemory"; }
+
+    Block getHeader() const override { return storage.getSampleBlockForColumns(column_names); }
+
+protected:
+    Block readImpl() override
+    {
+        Block src = block_in->read();
+        if (!src)
+            return Block();
+
+        Block res;
+        for (size_t i = 0, size = column_names.size(); i < size; ++i)
+            res.insert(src.getByName(column_names[i]));
+
+        return res;
     }
 private:
     Names column_names;
-    BlocksList::iterator begin;
-    BlocksList::iterator end;
-    BlocksList::iterator it;
+    /// Keeps the snapshot alive: the file is deleted together with the last version referencing it.
+    StorageMemory::SnapshotPtr snapshot;
     const StorageMemory & storage;
+
+    ReadBufferFromFile file_in;
+    CompressedReadBuffer compressed_in;
+    BlockInputStreamPtr block_in;
 };
 
 
@@ -66,17 +135,117 @@ public:
     void write(const Block & block) override
     {
         storage.check(block, true);
+
+        StorageMemory::Entry entry;
+        size_t entry_bytes = 0;
+        if (storage.compress)
+        {
+            auto compressed = std::make_shared<String>();
+            {
+                WriteBufferFromString out(*compressed);
+                CompressedWriteBuffer compressed_out(out);
+                NativeBlockOutputStream block_out(compressed_out, 0, block.cloneEmpty());
+                block_out.write(block);
+                block_out.flush();
+                compressed_out.next();
+            }
+            entry_bytes = compressed->size();
+            entry.compressed = std::move(compressed);
+        }
+        else
+        {
+            entry.block = block;
+            entry_bytes = block.allocatedBytes();
+        }
+
+        /// Publish a new version of the data. The existing entries are shared with the old version,
+        ///  so the copy is just a vector of block headers and pointers.
         std::lock_guard<std::mutex> lock(storage.mutex);
-        storage.data.push_back(block);
+        auto new_data = std::make_shared<StorageMemory::Snapshot>(*storage.data);
+        new_data->entries.push_back(std::move(entry));
+        new_data->entries_bytes += entry_bytes;
+
+        if (storage.max_bytes_in_memory && new_data->entries_bytes > storage.max_bytes_in_memory)
+            storage.spillToTemporaryFile(*new_data);
+
+        std::atomic_store(&storage.data, StorageMemory::SnapshotPtr(std::move(new_data)));
     }
 private:
     StorageMemory & storage;
 };
 
 
-StorageMemory::StorageMemory(String table_name_, ColumnsDescription columns_description_)
+StorageMemory::StorageMemory(String table_name_, ColumnsDescription columns_description_,
+        bool compress_, size_t max_bytes_in_memory_, String tmp_path_)
     : IStorage{std::move(columns_description_)}, table_name(std::move(table_name_))
+    , data(std::make_shared<const Snapshot>()), compress(compress_)
+    , max_bytes_in_memory(max_bytes_in_memory_), tmp_path(std::move(tmp_path_))
+    , log(&Logger::get("StorageMemory (" + table_name + ")"))
+{
+}
+
+
+/** Move all in-memory blocks of `snapshot` into a new compressed file in the temporary directory.
+  * Many small inserted blocks are merged into dense ones on the way, so the spilled data also
+  *  scans faster than it would have from RAM.
+  * Called under `mutex`. The entries being spilled may still be shared with older versions,
+  *  so their columns are not modified (IColumn::mutate copies a shared column).
+  */
+void StorageMemory::spillToTemporaryFile(Snapshot & snapshot)
 {
+    Poco::File(tmp_path).createDirectories();
+    auto spilled = std::make_shared<SpilledFile>(tmp_path);
+
+    Block header = getSampleBlock();
+
+    WriteBufferFromFile file_buf(spilled->file.path());
+    CompressedWriteBuffer compressed_buf(file_buf);
+    NativeBlockOutputStream block_out(compressed_buf, 0, header);
+    SquashingTransform squashing(DEFAULT_MERGE_BLOCK_SIZE, 0);
+
+    auto write_squashed = [&](MutableColumns && columns)
+    {
+        auto result = squashing.add(std::move(columns));
+        if (result.ready && !result.columns.empty())
+        {
+            block_out.write(header.cloneWithColumns(std::move(result.columns)));
+            ++spilled->num_blocks;
+        }
+    };
+
+    for (const auto & entry : snapshot.entries)
+    {
+        Block src;
+        if (entry.compressed)
+        {
+            ReadBufferFromString in(*entry.compressed);
+            CompressedReadBuffer decompressing_in(in);
+            NativeBlockInputStream block_in(decompressing_in, 0);
+            src = block_in.read();
+        }
+        else
+            src = entry.block;
+
+        /// Columns in the order of the table structure, regardless of the order in the inserted block.
+        MutableColumns columns(header.columns());
+        for (size_t i = 0, size = columns.size(); i < size; ++i)
+            columns[i] = (*std::move(src.getByName(header.getByPosition(i).name).column)).mutate();
+
+        write_squashed(std::move(columns));
+    }
+    write_squashed({});
+
+    block_out.flush();
+    compressed_buf.next();
+    file_buf.next();
+
+    LOG_DEBUG(log, "Spilled " << snapshot.entries.size() << " blocks (" << snapshot.entries_bytes
+        << " bytes in memory) as " << spilled->num_blocks << " blocks to temporary file " << spilled->file.path());
+
+    snapshot.spilled_blocks += spilled->num_blocks;
+    snapshot.spilled.push_back(std::move(spilled));
+    snapshot.entries.clear();
+    snapshot.entries_bytes = 0;
 }
 
 
@@ -90,24 +259,27 @@ BlockInputStreams StorageMemory::read(
 {
     check(column_names);
 
-    std::lock_guard<std::mutex> lock(mutex);
+    /// Blocks published after this point are not visible to the query.
+    SnapshotPtr snapshot = std::atomic_load(&data);
 
-    size_t size = data.size();
+    BlockInputStreams res;
 
-    if (num_streams > size)
-        num_streams = size;
+    /// A spilled file is read sequentially by a single stream.
+    for (const auto & spilled : snapshot->spilled)
+        res.push_back(std::make_shared<SpilledMemoryBlockInputStream>(column_names, snapshot, spilled, *this));
 
-    BlockInputStreams res;
+    size_t size = snapshot->entries.size();
+    size_t num_memory_streams = num_streams > res.size() ? num_streams - res.size() : 1;
 
-    for (size_t stream = 0; stream < num_streams; ++stream)
-    {
-        BlocksList::iterator begin = data.begin();
-        BlocksList::iterator end = data.begin();
+    if (num_memory_streams > size)
+        num_memory_streams = size;
 
-        std::advance(begin, stream * size / num_streams);
-        std::advance(end, (stream + 1) * size / num_streams);
+    for (size_t stream = 0; stream < num_memory_streams; ++stream)
+    {
+        size_t begin = stream * size / num_memory_streams;
+        size_t end = (stream + 1) * size / num_memory_streams;
 
-        res.push_back(std::make_shared<MemoryBlockInputStream>(column_names, begin, end, *this));
+        res.push_back(std::make_shared<MemoryBlockInputStream>(column_names, snapshot, begin, end, *this));
     }
 
     return res;
@@ -124,13 +296,13 @@ BlockOutputStreamPtr StorageMemory::write(
 void StorageMemory::drop()
 {
     std::lock_guard<std::mutex> lock(mutex);
-    data.clear();
+    std::atomic_store(&data, std::make_shared<const Snapshot>());
 }
 
 void StorageMemory::truncate(const ASTPtr &)
 {
     std::lock_guard<std::mutex> lock(mutex);
-    data.clear();
+    std::atomic_store(&data, std::make_shared<const Snapshot>());
 }
 
 
@@ -143,7 +315,31 @@ void registerStorageMemory(StorageFactory & factory)
                 "Engine " + args.engine_name + " doesn't support any arguments (" + toString(args.engine_args.size()) + " given)",
                 ErrorCodes::NUMBER_OF_ARGUMENTS_DOESNT_MATCH);
 
-        return StorageMemory::create(args.table_name, args.columns);
+        bool compress = false;
+        UInt64 max_bytes_in_memory = 0;
+
+        /// Session temporary tables are bounded by the corresponding setting,
+        ///  unless the budget is given explicitly in the engine settings.
+        if (args.query.temporary)
+            max_bytes_in_memory = args.local_context.getSettingsRef().temporary_table_max_bytes_in_memory;
+
+        if (args.storage_def->settings)
+        {
+            for (const ASTSetQuery::Change & setting : args.storage_def->settings->changes)
+            {
+                if (setting.name == "compress")
+                    compress = setting.value.safeGet<UInt64>();
+                else if (setting.name == "max_bytes_in_memory")
+                    max_bytes_in_memory = setting.value.safeGet<UInt64>();
+                else
+                    throw Exception(
+                        "Unknown setting " + setting.name + " for storage " + args.engine_name,
+                        ErrorCodes::BAD_ARGUMENTS);
+            }
+        }
+
+        return StorageMemory::create(args.table_name, args.columns, compress,
+            max_bytes_in_memory, args.context.getTemporaryPath());
     });
 }
 
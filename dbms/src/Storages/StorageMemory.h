@@ -8,6 +8,10 @@
 #include <Storages/IStorage.h>
 #include <DataStreams/IBlockOutputStream.h>
 
+#include <Poco/TemporaryFile.h>
+
+namespace Poco { class Logger; }
+
 
 namespace DB
 {
@@ -16,17 +20,65 @@ namespace DB
   * Suitable for temporary data.
   * It does not support keys.
   * Data is stored as a set of blocks and is not stored anywhere else.
+  *
+  * Readers take an atomic snapshot of the set of blocks and do not hold any locks while reading,
+  *  so they are never blocked by writers. Writers publish a new version of the set
+  *  (blocks themselves are immutable and shared between versions, so this is cheap).
+  * TRUNCATE and DROP publish a fresh empty version; readers that started earlier
+  *  keep the old one alive and finish undisturbed.
+  *
+  * If `max_bytes_in_memory` is set, the blocks are spilled to a compressed file in the temporary
+  *  directory when their total size exceeds it; small blocks are merged into dense ones on the way.
+  * Used with a limit taken from the `temporary_table_max_bytes_in_memory` setting for session
+  *  temporary tables, so that long analyst sessions do not grow the server memory without bound.
   */
 class StorageMemory : public ext::shared_ptr_helper<StorageMemory>, public IStorage
 {
 friend class MemoryBlockInputStream;
+friend class SpilledMemoryBlockInputStream;
 friend class MemoryBlockOutputStream;
 
 public:
+    /// One element of the stored data. A block is kept either as is or,
+    ///  if the `compress` setting is set, as its compressed Native format serialization.
+    struct Entry
+    {
+        Block block;
+        std::shared_ptr<const String> compressed;
+    };
+
+    using Entries = std::vector<Entry>;
+
+    /// Blocks evicted from the RAM into a file with compressed Native format serialization.
+    /// The file is deleted together with the last version of the data referencing it.
+    struct SpilledFile
+    {
+        Poco::TemporaryFile file;
+        size_t num_blocks = 0;
+
+        explicit SpilledFile(const String & tmp_path_) : file(tmp_path_) {}
+    };
+    using SpilledFilePtr = std::shared_ptr<const SpilledFile>;
+
+    /// A version of the stored data: the spilled files, oldest first, followed by the blocks in RAM.
+    struct Snapshot
+    {
+        std::vector<SpilledFilePtr> spilled;
+        size_t spilled_blocks = 0;
+
+        Entries entries;
+        size_t entries_bytes = 0;   /// Approximate RAM footprint of `entries`.
+    };
+    using SnapshotPtr = std::shared_ptr<const Snapshot>;
+
     std::string getName() const override { return "Memory"; }
     std::string getTableName() const override { return table_name; }
 
-    size_t getSize() const { return data.size(); }
+    size_t getSize() const
+    {
+        auto snapshot = std::atomic_load(&data);
+        return snapshot->spilled_blocks + snapshot->entries.size();
+    }
 
     BlockInputStreams read(
         const Names & column_names,
@@ -47,13 +99,29 @@ public:
 private:
     String table_name;
 
-    /// The data itself. `list` - so that when inserted to the end, the existing iterators are not invalidated.
-    BlocksList data;
+    /// The current version of the data. Replaced as a whole on every modification;
+    ///  read with std::atomic_load, written with std::atomic_store under `mutex`.
+    SnapshotPtr data;
 
+    /// Serializes writers only; readers do not take it.
     std::mutex mutex;
 
+    /// Store blocks compressed, trading CPU on insert and read for a smaller RAM footprint.
+    const bool compress;
+
+    /// When the in-memory blocks exceed this size, they are spilled to a file in `tmp_path`.
+    /// 0 means the data is kept in RAM regardless of its size.
+    const size_t max_bytes_in_memory;
+    const String tmp_path;
+
+    Poco::Logger * log;
+
+    /// Move all in-memory blocks of `snapshot` into a new compressed file. Called under `mutex`.
+    void spillToTemporaryFile(Snapshot & snapshot);
+
 protected:
-    StorageMemory(String table_name_, ColumnsDescription columns_description_);
+    StorageMemory(String table_name_, ColumnsDescription columns_description_,
+        bool compress_ = false, size_t max_bytes_in_memory_ = 0, String tmp_path_ = {});
 };
 
 }
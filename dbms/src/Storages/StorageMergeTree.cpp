@@ -13,6 +13,7 @@
 #include <Parsers/ASTFunction.h>
 #include <Parsers/ASTLiteral.h>
 #include <Storages/MergeTree/MergeTreeData.h>
+#include <Storages/MergeTree/MergeTreeDeduplicationLog.h>
 #include <Storages/MergeTree/ActiveDataPartSet.h>
 
 #include <Poco/DirectoryIterator.h>
@@ -51,6 +52,7 @@ StorageMergeTree::StorageMergeTree(
     const String & date_column_name,
     const ASTPtr & partition_expr_ast_,
     const ASTPtr & sampling_expression_, /// nullptr, if sampling is not supported.
+    const ASTPtr & ttl_table_ast_, /// nullptr, if the table has no TTL.
     const MergeTreeData::MergingParams & merging_params_,
     const MergeTreeSettings & settings_,
     bool has_force_restore_data_flag)
@@ -59,7 +61,7 @@ StorageMergeTree::StorageMergeTree(
     data(database_name, table_name,
          full_path, columns_,
          context_, primary_expr_ast_, secondary_sorting_expr_list_, date_column_name, partition_expr_ast_,
-         sampling_expression_, merging_params_,
+         sampling_expression_, ttl_table_ast_, merging_params_,
          settings_, false, attach),
     reader(data), writer(data), merger_mutator(data, context.getBackgroundPool()),
     log(&Logger::get(database_name_ + "." + table_name + " (StorageMergeTree)"))
@@ -75,6 +77,10 @@ StorageMergeTree::StorageMergeTree(
     increment.set(data.getMaxBlockNumber());
 
     loadMutations();
+
+    if (data.settings.non_replicated_deduplication_window)
+        deduplication_log = std::make_unique<MergeTreeDeduplicationLog>(
+            full_path, data.settings.non_replicated_deduplication_window, database_name + "." + table_name);
 }
 
 
@@ -82,6 +88,12 @@ void StorageMergeTree::startup()
 {
     background_task_handle = background_pool.addTask([this] { return backgroundTask(); });
 
+    if (data.settings.preload_marks_on_startup)
+        preload_marks_task_handle = background_pool.addTask([this] { data.preloadMarks(); return false; });
+
+    if (data.settings.scrub_max_bytes_per_second)
+        scrub_task_handle = background_pool.addTask([this] { return scrubTask(); }, BackgroundProcessingPool::TaskClass::Utility);
+
     data.clearOldPartsFromFilesystem();
 
     /// Temporary directories contain incomplete results of merges (after forced restart)
@@ -98,6 +110,10 @@ void StorageMergeTree::shutdown()
     merger_mutator.actions_blocker.cancelForever();
     if (background_task_handle)
         background_pool.removeTask(background_task_handle);
+    if (preload_marks_task_handle)
+        background_pool.removeTask(preload_marks_task_handle);
+    if (scrub_task_handle)
+        background_pool.removeTask(scrub_task_handle);
 }
 
 
@@ -117,9 +133,12 @@ BlockInputStreams StorageMergeTree::read(
     return reader.read(column_names, query_info, context, max_block_size, num_streams);
 }
 
-BlockOutputStreamPtr StorageMergeTree::write(const ASTPtr & /*query*/, const Settings & /*settings*/)
+BlockOutputStreamPtr StorageMergeTree::write(const ASTPtr & /*query*/, const Settings & settings)
 {
-    return std::make_shared<MergeTreeBlockOutputStream>(*this);
+    bool deduplicate = deduplication_log != nullptr && settings.insert_deduplicate;
+
+    return std::make_shared<MergeTreeBlockOutputStream>(*this, deduplicate, settings.insert_deduplication_token.value,
+        settings.parts_to_delay_insert, settings.parts_to_throw_insert);
 }
 
 void StorageMergeTree::checkTableCanBeDropped() const
@@ -165,6 +184,10 @@ void StorageMergeTree::truncate(const ASTPtr &)
         LOG_INFO(log, "Removed " << parts_to_remove.size() << " parts.");
     }
 
+    /// Data removed explicitly is expected to be insertable again.
+    if (deduplication_log)
+        deduplication_log->clear();
+
     data.clearOldPartsFromFilesystem();
 }
 
@@ -226,8 +249,22 @@ void StorageMergeTree::alter(
     if (primary_key_is_modified && supportsSampling())
         throw Exception("MODIFY PRIMARY KEY only supported for tables without sampling key", ErrorCodes::BAD_ARGUMENTS);
 
-    auto parts = data.getDataParts({MergeTreeDataPartState::PreCommitted, MergeTreeDataPartState::Committed, MergeTreeDataPartState::Outdated});
     auto columns_for_parts = new_columns.getAllPhysical();
+
+    /// ADD COLUMN and changes of column defaults do not require modifying any files of the parts:
+    /// parts keep the columns they were created with and the missing columns are filled with
+    /// default values when read. Commit such ALTERs as a pure metadata change, without iterating
+    /// over the parts (there may be a lot of them).
+    if (!primary_key_is_modified && !data.alterRequiresPartUpdates(columns_for_parts))
+    {
+        auto table_hard_lock = lockStructureForAlter(__PRETTY_FUNCTION__);
+
+        context.getDatabase(database_name)->alterTable(context, table_name, new_columns, {});
+        setColumns(std::move(new_columns));
+        return;
+    }
+
+    auto parts = data.getDataParts({MergeTreeDataPartState::PreCommitted, MergeTreeDataPartState::Committed, MergeTreeDataPartState::Outdated});
     for (const MergeTreeData::DataPartPtr & part : parts)
     {
         if (auto transaction = data.alterDataPart(part, columns_for_parts, new_primary_key_ast, false))
@@ -284,11 +321,17 @@ struct CurrentlyMergingPartsTagger
 
     CurrentlyMergingPartsTagger() = default;
 
-    CurrentlyMergingPartsTagger(const MergeTreeData::DataPartsVector & parts_, size_t total_size, StorageMergeTree & storage_)
+    CurrentlyMergingPartsTagger(const MergeTreeData::DataPartsVector & parts_, size_t total_size, StorageMergeTree & storage_, bool is_mutation)
         : parts(parts_), storage(&storage_)
     {
         /// Assume mutex is already locked, because this method is called from mergeTask.
-        reserved_space = DiskSpaceMonitor::reserve(storage->full_path, total_size); /// May throw.
+
+        /// A merged part can go to any volume of the storage policy that has enough space,
+        /// but a mutation writes the new part to the volume of the source part.
+        if (is_mutation)
+            reserved_space = DiskSpaceMonitor::reserve(parts_[0]->base_path, total_size); /// May throw.
+        else
+            reserved_space = storage->data.reserveSpaceForPart(total_size); /// May throw.
         for (const auto & part : parts)
         {
             if (storage->currently_merging.count(part))
@@ -426,17 +469,18 @@ bool StorageMergeTree::merge(
         }
         else
         {
-            size_t disk_space = DiskSpaceMonitor::getUnreservedFreeSpace(full_path);
+            size_t disk_space = data.getMaxUnreservedFreeSpace();
             selected = merger_mutator.selectAllPartsToMergeWithinPartition(future_part, disk_space, can_merge, partition_id, final, out_disable_reason);
         }
 
         if (!selected)
             return false;
 
-        merging_tagger.emplace(future_part.parts, MergeTreeDataMergerMutator::estimateNeededDiskSpace(future_part.parts), *this);
+        merging_tagger.emplace(future_part.parts, MergeTreeDataMergerMutator::estimateNeededDiskSpace(future_part.parts), *this, false);
     }
 
-    MergeList::EntryPtr merge_entry = context.getMergeList().insert(database_name, table_name, future_part.name, future_part.parts);
+    MergeList::EntryPtr merge_entry = context.getMergeList().insert(
+        database_name, table_name, future_part.name, future_part.parts, future_part.selection_decision);
 
     /// Logging
     Stopwatch stopwatch;
@@ -512,7 +556,7 @@ bool StorageMergeTree::tryMutatePart()
     /// You must call destructor with unlocked `currently_merging_mutex`.
     std::optional<CurrentlyMergingPartsTagger> tagger;
     {
-        auto disk_space = DiskSpaceMonitor::getUnreservedFreeSpace(full_path);
+        auto disk_space = data.getMaxUnreservedFreeSpace();
 
         std::lock_guard<std::mutex> lock(currently_merging_mutex);
 
@@ -543,7 +587,7 @@ bool StorageMergeTree::tryMutatePart()
             future_part.part_info = new_part_info;
             future_part.name = part->getNewName(new_part_info);
 
-            tagger.emplace({part}, estimated_needed_space, *this);
+            tagger.emplace({part}, estimated_needed_space, *this, true);
             break;
         }
     }
@@ -626,13 +670,17 @@ bool StorageMergeTree::backgroundTask()
             data.clearOldPartsFromFilesystem();
             data.clearOldTemporaryDirectories();
             clearOldMutations();
+            clearPartsWithExpiredTTL();
         }
 
         ///TODO: read deduplicate option from table config
         if (merge(false /*aggressive*/, {} /*partition_id*/, false /*final*/, false /*deduplicate*/))
             return true;
 
-        return tryMutatePart();
+        if (tryMutatePart())
+            return true;
+
+        return data.moveSomePartToAnotherVolume();
     }
     catch (Exception & e)
     {
@@ -646,6 +694,22 @@ bool StorageMergeTree::backgroundTask()
     }
 }
 
+bool StorageMergeTree::scrubTask()
+{
+    if (shutdown_called)
+        return false;
+
+    return data.scrubOneDataPart(
+        [this] { return shutdown_called.load(); },
+        [this] (const MergeTreeData::DataPartPtr & part)
+        {
+            /// There is no replica to re-fetch the part from: all we can do is draw attention to it
+            /// early, while backups that contain it may still exist.
+            LOG_ERROR(log, "Part " << part->name << " failed checksum verification during scrubbing."
+                << " The part should be restored from a backup.");
+        });
+}
+
 Int64 StorageMergeTree::getCurrentMutationVersion(
     const MergeTreeData::DataPartPtr & part,
     std::lock_guard<std::mutex> & /* currently_merging_mutex_lock */) const
@@ -657,6 +721,34 @@ Int64 StorageMergeTree::getCurrentMutationVersion(
     return it->first;
 }
 
+void StorageMergeTree::clearPartsWithExpiredTTL()
+{
+    if (!data.hasTableTTL())
+        return;
+
+    time_t current_time = time(nullptr);
+
+    MergeTreeData::DataPartsVector parts_to_remove;
+    {
+        std::lock_guard lock(currently_merging_mutex);
+
+        /// A part can be dropped as a whole when the maximum value of the TTL expression over its
+        /// rows has passed (parts written before the TTL clause was added do not store it and are
+        /// cleaned up by merges instead).
+        for (const auto & part : data.getDataPartsVector())
+            if (part->ttl_max != 0 && part->ttl_max <= current_time && !currently_merging.count(part))
+                parts_to_remove.push_back(part);
+
+        if (parts_to_remove.empty())
+            return;
+
+        data.removePartsFromWorkingSet(parts_to_remove, true);
+    }
+
+    for (const auto & part : parts_to_remove)
+        LOG_INFO(log, "Removed part " << part->name << " with expired TTL");
+}
+
 void StorageMergeTree::clearOldMutations()
 {
     if (!data.settings.finished_mutations_to_keep)
@@ -18,6 +18,8 @@
 namespace DB
 {
 
+class MergeTreeDeduplicationLog;
+
 /** See the description of the data structure in MergeTreeData.
   */
 class StorageMergeTree : public ext::shared_ptr_helper<StorageMergeTree>, public IStorage
@@ -113,6 +115,10 @@ private:
     MergeTreeDataWriter writer;
     MergeTreeDataMergerMutator merger_mutator;
 
+    /// Persistent log of recent insert block ids (see the non_replicated_deduplication_window setting).
+    /// nullptr if insert deduplication is disabled for this table.
+    std::unique_ptr<MergeTreeDeduplicationLog> deduplication_log;
+
     /// For block numbers.
     SimpleIncrement increment{0};
 
@@ -129,6 +135,12 @@ private:
 
     BackgroundProcessingPool::TaskHandle background_task_handle;
 
+    /// One-shot task that warms the mark cache (see the preload_marks_on_startup setting).
+    BackgroundProcessingPool::TaskHandle preload_marks_task_handle;
+
+    /// Background checksum verification (see the scrub_max_bytes_per_second setting).
+    BackgroundProcessingPool::TaskHandle scrub_task_handle;
+
     void loadMutations();
 
     /** Determines what parts should be merged and merges it.
@@ -143,12 +155,17 @@ private:
 
     bool backgroundTask();
 
+    bool scrubTask();
+
     Int64 getCurrentMutationVersion(
         const MergeTreeData::DataPartPtr & part,
         std::lock_guard<std::mutex> & /* currently_merging_mutex_lock */) const;
 
     void clearOldMutations();
 
+    /// Drops whole parts for which the maximum value of the table TTL expression has passed.
+    void clearPartsWithExpiredTTL();
+
     // Partition helpers
     void dropPartition(const ASTPtr & partition, bool detach, const Context & context);
     void clearColumnInPartition(const ASTPtr & partition, const Field & column_name, const Context & context);
@@ -180,6 +197,7 @@ protected:
         const String & date_column_name,
         const ASTPtr & partition_expr_ast_,
         const ASTPtr & sampling_expression_, /// nullptr, if sampling is not supported.
+        const ASTPtr & ttl_table_ast_, /// nullptr, if the table has no TTL.
         const MergeTreeData::MergingParams & merging_params_,
         const MergeTreeSettings & settings_,
         bool has_force_restore_data_flag);
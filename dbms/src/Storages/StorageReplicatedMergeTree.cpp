@@ -41,7 +41,7 @@
 
 #include <Poco/DirectoryIterator.h>
 
-#include <common/ThreadPool.h>
+#include <Common/ThreadPool.h>
 
 #include <ext/range.h>
 #include <ext/scope_guard.h>
@@ -214,7 +214,7 @@ StorageReplicatedMergeTree::StorageReplicatedMergeTree(
     data(database_name, table_name,
         full_path, columns_,
         context_, primary_expr_ast_, secondary_sorting_expr_list_, date_column_name, partition_expr_ast_,
-        sampling_expression_, merging_params_,
+        sampling_expression_, nullptr /* ttl_table_ast */, merging_params_,
         settings_, true, attach,
         [this] (const std::string & name) { enqueuePartForCheck(name); }),
     reader(data), writer(data), merger_mutator(data, context.getBackgroundPool()), queue(*this),
@@ -820,13 +820,25 @@ void StorageReplicatedMergeTree::checkPartChecksumsAndAddCommitOps(const zkutil:
     String expected_columns_str = part->columns.toString();
     bool has_been_alredy_added = false;
 
+    /// Request the columns and checksums of all replicas at once instead of two round trips
+    /// per replica (usually only the first live replica is actually examined).
+    std::vector<std::future<Coordination::GetResponse>> columns_futures;
+    std::vector<std::future<Coordination::GetResponse>> checksums_futures;
     for (const String & replica : replicas)
     {
-        Coordination::Stat stat_before, stat_after;
+        String current_part_path = zookeeper_path + "/replicas/" + replica + "/parts/" + part_name;
+        columns_futures.push_back(zookeeper->asyncTryGet(current_part_path + "/columns"));
+        checksums_futures.push_back(zookeeper->asyncTryGet(current_part_path + "/checksums"));
+    }
+
+    for (size_t i = 0; i < replicas.size(); ++i)
+    {
+        const String & replica = replicas[i];
+        Coordination::Stat stat_after;
         String current_part_path = zookeeper_path + "/replicas/" + replica + "/parts/" + part_name;
 
-        String columns_str;
-        if (!zookeeper->tryGet(current_part_path + "/columns", columns_str, &stat_before))
+        Coordination::GetResponse columns_resp = columns_futures[i].get();
+        if (columns_resp.error)
         {
             if (absent_replicas_paths)
                 absent_replicas_paths->emplace(current_part_path);
@@ -834,26 +846,26 @@ void StorageReplicatedMergeTree::checkPartChecksumsAndAddCommitOps(const zkutil:
             continue;
         }
 
-        if (columns_str != expected_columns_str)
+        if (columns_resp.data != expected_columns_str)
         {
             LOG_INFO(log, "Not checking checksums of part " << part_name << " with replica " << replica
                 << " because columns are different");
             continue;
         }
 
-        String checksums_str;
+        Coordination::GetResponse checksums_resp = checksums_futures[i].get();
         /// Let's check that the node's version with the columns did not change while we were reading the checksums.
         /// This ensures that the columns and the checksum refer to the same data.
-        if (!zookeeper->tryGet(current_part_path + "/checksums", checksums_str) ||
+        if (checksums_resp.error ||
             !zookeeper->exists(current_part_path + "/columns", &stat_after) ||
-            stat_before.version != stat_after.version)
+            columns_resp.stat.version != stat_after.version)
         {
             LOG_INFO(log, "Not checking checksums of part " << part_name << " with replica " << replica
                 << " because part changed while we were reading its checksums");
             continue;
         }
 
-        auto zk_checksums = MinimalisticDataPartChecksums::deserializeFrom(checksums_str);
+        auto zk_checksums = MinimalisticDataPartChecksums::deserializeFrom(checksums_resp.data);
         zk_checksums.checkEqual(part->checksums, true);
 
         if (replica == replica_name)
@@ -1144,7 +1156,7 @@ bool StorageReplicatedMergeTree::tryExecuteMerge(const LogEntry & entry)
     size_t estimated_space_for_merge = MergeTreeDataMergerMutator::estimateNeededDiskSpace(parts);
 
     /// Can throw an exception.
-    DiskSpaceMonitor::ReservationPtr reserved_space = DiskSpaceMonitor::reserve(full_path, estimated_space_for_merge);
+    DiskSpaceMonitor::ReservationPtr reserved_space = data.reserveSpaceForPart(estimated_space_for_merge);
 
     auto table_lock = lockStructure(false, __PRETTY_FUNCTION__);
 
@@ -1273,8 +1285,8 @@ bool StorageReplicatedMergeTree::tryExecutePartMutation(const StorageReplicatedM
         entry.new_part_name, data.format_version);
     MutationCommands commands = queue.getMutationCommands(source_part, new_part_info.mutation);
 
-    /// Can throw an exception.
-    DiskSpaceMonitor::ReservationPtr reserved_space = DiskSpaceMonitor::reserve(full_path, estimated_space_for_result);
+    /// Can throw an exception. The mutated part is written to the volume of the source part.
+    DiskSpaceMonitor::ReservationPtr reserved_space = DiskSpaceMonitor::reserve(source_part->base_path, estimated_space_for_result);
 
     auto table_lock = lockStructure(false, __PRETTY_FUNCTION__);
 
@@ -2236,6 +2248,22 @@ bool StorageReplicatedMergeTree::queueTask()
 }
 
 
+bool StorageReplicatedMergeTree::scrubTask()
+{
+    if (partial_shutdown_called)
+        return false;
+
+    return data.scrubOneDataPart(
+        [this] { return partial_shutdown_called.load(); },
+        [this] (const MergeTreeData::DataPartPtr & part)
+        {
+            /// The part check thread will re-verify the part, move it to `detached`
+            /// and fetch a healthy copy from another replica.
+            part_check_thread.enqueuePart(part->name);
+        });
+}
+
+
 void StorageReplicatedMergeTree::mergeSelectingTask()
 {
     if (!is_leader)
@@ -2909,6 +2937,13 @@ void StorageReplicatedMergeTree::startup()
 
     queue_task_handle = context.getBackgroundPool().addTask([this] { return queueTask(); });
 
+    if (data.settings.preload_marks_on_startup)
+        preload_marks_task_handle = context.getBackgroundPool().addTask([this] { data.preloadMarks(); return false; });
+
+    if (data.settings.scrub_max_bytes_per_second)
+        scrub_task_handle = context.getBackgroundPool().addTask(
+            [this] { return scrubTask(); }, BackgroundProcessingPool::TaskClass::Utility);
+
     /// In this thread replica will be activated.
     restarting_thread.start();
 
@@ -2929,6 +2964,14 @@ void StorageReplicatedMergeTree::shutdown()
         context.getBackgroundPool().removeTask(queue_task_handle);
     queue_task_handle.reset();
 
+    if (preload_marks_task_handle)
+        context.getBackgroundPool().removeTask(preload_marks_task_handle);
+    preload_marks_task_handle.reset();
+
+    if (scrub_task_handle)
+        context.getBackgroundPool().removeTask(scrub_task_handle);
+    scrub_task_handle.reset();
+
     if (data_parts_exchange_endpoint_holder)
     {
         data_parts_exchange_endpoint_holder->getBlocker().cancelForever();
@@ -2974,30 +3017,32 @@ BlockInputStreams StorageReplicatedMergeTree::read(
             max_added_blocks[data_part->info.partition_id] = std::max(max_added_blocks[data_part->info.partition_id], data_part->info.max_block);
         }
 
-        auto zookeeper = getZooKeeper();
-
-        const String quorum_status_path = zookeeper_path + "/quorum/status";
-
-        String value;
-        Coordination::Stat stat;
+        /// The quorum nodes rarely change, so they are read from a watch-maintained local cache
+        ///  instead of making two ZooKeeper round trips on every such SELECT.
+        std::optional<String> quorum_status;
+        std::optional<String> added_parts_str;
+        {
+            std::lock_guard lock(quorum_nodes_cache_mutex);
+            quorum_status = quorum_nodes_cache.get(zookeeper_path + "/quorum/status");
+            added_parts_str = quorum_nodes_cache.get(zookeeper_path + "/quorum/last_part");
+        }
 
-        if (zookeeper->tryGet(quorum_status_path, value, &stat))
+        if (quorum_status)
         {
             ReplicatedMergeTreeQuorumEntry quorum_entry;
-            quorum_entry.fromString(value);
+            quorum_entry.fromString(*quorum_status);
 
             auto part_info = MergeTreePartInfo::fromPartName(quorum_entry.part_name, data.format_version);
 
             max_added_blocks[part_info.partition_id] = part_info.max_block - 1;
         }
 
-        String added_parts_str;
-        if (zookeeper->tryGet(zookeeper_path + "/quorum/last_part", added_parts_str))
+        if (added_parts_str)
         {
-            if (!added_parts_str.empty())
+            if (!added_parts_str->empty())
             {
                 ReplicatedMergeTreeQuorumAddedParts part_with_quorum(data.format_version);
-                part_with_quorum.fromString(added_parts_str);
+                part_with_quorum.fromString(*added_parts_str);
 
                 auto added_parts = part_with_quorum.added_parts;
 
@@ -3032,7 +3077,9 @@ BlockOutputStreamPtr StorageReplicatedMergeTree::write(const ASTPtr & /*query*/,
     bool deduplicate = data.settings.replicated_deduplication_window != 0 && settings.insert_deduplicate;
 
     return std::make_shared<ReplicatedMergeTreeBlockOutputStream>(*this,
-        settings.insert_quorum, settings.insert_quorum_timeout.totalMilliseconds(), deduplicate);
+        settings.insert_quorum, settings.insert_quorum_timeout.totalMilliseconds(), deduplicate,
+        settings.insert_deduplication_token.value,
+        settings.parts_to_delay_insert, settings.parts_to_throw_insert);
 }
 
 
@@ -3052,7 +3099,7 @@ bool StorageReplicatedMergeTree::optimize(const ASTPtr & query, const ASTPtr & p
         /// (merge_selecting_thread or OPTIMIZE queries) could assign new merges.
         std::lock_guard<std::mutex> merge_selecting_lock(merge_selecting_mutex);
 
-        size_t disk_space = DiskSpaceMonitor::getUnreservedFreeSpace(full_path);
+        size_t disk_space = data.getMaxUnreservedFreeSpace();
         auto zookeeper = getZooKeeper();
         ReplicatedMergeTreeMergePredicate can_merge = queue.getMergePredicate(zookeeper);
 
@@ -3642,6 +3689,23 @@ bool StorageReplicatedMergeTree::existsNodeCached(const std::string & path)
 }
 
 
+String StorageReplicatedMergeTree::getBlockNumberLockHolder(const zkutil::ZooKeeperPtr & zookeeper)
+{
+    std::lock_guard<std::mutex> lock(block_number_holder_mutex);
+
+    /// The holder node is ephemeral, so it is valid only within the session that created it.
+    if (block_number_holder_zookeeper.lock() != zookeeper)
+    {
+        /// The /abandonable_lock- name is for backward compatibility.
+        block_number_holder_path = zookeeper->create(
+            zookeeper_path + "/temp/abandonable_lock-", "", zkutil::CreateMode::EphemeralSequential);
+        block_number_holder_zookeeper = zookeeper;
+    }
+
+    return block_number_holder_path;
+}
+
+
 std::optional<EphemeralLockInZooKeeper>
 StorageReplicatedMergeTree::allocateBlockNumber(
     const String & partition_id, zkutil::ZooKeeperPtr & zookeeper, const String & zookeeper_block_id_path)
@@ -3673,11 +3737,12 @@ StorageReplicatedMergeTree::allocateBlockNumber(
     }
 
     EphemeralLockInZooKeeper lock;
-    /// 2 RTT
+    /// 1 RTT: the deduplication check and the creation of the block number node go in one transaction,
+    /// and the holder node is shared by all locks of the session (see getBlockNumberLockHolder).
     try
     {
-        lock = EphemeralLockInZooKeeper(
-            partition_path + "/block-", zookeeper_path + "/temp", *zookeeper, &deduplication_check_ops);
+        lock = EphemeralLockInZooKeeper::createWithExistingHolder(
+            partition_path + "/block-", getBlockNumberLockHolder(zookeeper), *zookeeper, &deduplication_check_ops);
     }
     catch (const zkutil::KeeperMultiException & e)
     {
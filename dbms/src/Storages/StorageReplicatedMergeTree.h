@@ -22,6 +22,7 @@
 #include <Interpreters/PartLog.h>
 #include <Common/randomSeed.h>
 #include <Common/ZooKeeper/ZooKeeper.h>
+#include <Common/ZooKeeper/ZooKeeperNodeCache.h>
 #include <Common/ZooKeeper/LeaderElection.h>
 #include <Core/BackgroundSchedulePool.h>
 
@@ -291,6 +292,12 @@ private:
     /// A task that performs actions from the queue.
     BackgroundProcessingPool::TaskHandle queue_task_handle;
 
+    /// One-shot task that warms the mark cache (see the preload_marks_on_startup setting).
+    BackgroundProcessingPool::TaskHandle preload_marks_task_handle;
+
+    /// Background checksum verification (see the scrub_max_bytes_per_second setting).
+    BackgroundProcessingPool::TaskHandle scrub_task_handle;
+
     /// A task that selects parts to merge.
     BackgroundSchedulePool::TaskHolder merge_selecting_task;
     /// It is acquired for each iteration of the selection of parts to merge or each OPTIMIZE query.
@@ -418,6 +425,10 @@ private:
       */
     bool queueTask();
 
+    /// Verifies checksums of the next part of the current scrub pass. Corrupted parts are handed
+    /// to the part check thread, which moves them away and fetches them from a healthy replica.
+    bool scrubTask();
+
     /// Postcondition:
     /// either leader_election is fully initialized (node in ZK is created and the watching thread is launched)
     /// or an exception is thrown and leader_election is destroyed.
@@ -505,6 +516,20 @@ private:
     std::mutex existing_nodes_cache_mutex;
     bool existsNodeCached(const std::string & path);
 
+    /// Watch-maintained cache of the quorum nodes consulted by SELECTs with select_sequential_consistency:
+    /// while the quorum state does not change, the check is a local memory read and does not occupy
+    /// the ZooKeeper session thread shared with the replication queue.
+    zkutil::ZooKeeperNodeCache quorum_nodes_cache {[this] { return getZooKeeper(); }};
+    std::mutex quorum_nodes_cache_mutex;
+
+    /// An ephemeral node in `temp` shared as the holder by all block number locks of the current
+    /// ZooKeeper session. Creating it once per session (instead of once per lock) makes block number
+    /// allocation a single ZK round trip.
+    String block_number_holder_path;
+    std::weak_ptr<zkutil::ZooKeeper> block_number_holder_zookeeper;
+    std::mutex block_number_holder_mutex;
+    String getBlockNumberLockHolder(const zkutil::ZooKeeperPtr & zookeeper);
+
     /// Remove block IDs from `blocks/` in ZooKeeper for the given partition ID in the given block number range.
     void clearBlocksInPartition(
         zkutil::ZooKeeper & zookeeper, const String & partition_id, Int64 min_block_num, Int64 max_block_num);
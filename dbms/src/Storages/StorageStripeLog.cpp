@@ -51,11 +51,11 @@ namespace ErrorCodes
 class StripeLogBlockInputStream final : public IProfilingBlockInputStream
 {
 public:
-    StripeLogBlockInputStream(StorageStripeLog & storage_, size_t max_read_buffer_size_,
+    StripeLogBlockInputStream(StorageStripeLog & storage_, size_t max_read_buffer_size_, size_t decompress_ahead_blocks_,
         std::shared_ptr<const IndexForNativeFormat> & index_,
         IndexForNativeFormat::Blocks::const_iterator index_begin_,
         IndexForNativeFormat::Blocks::const_iterator index_end_)
-        : storage(storage_), max_read_buffer_size(max_read_buffer_size_),
+        : storage(storage_), max_read_buffer_size(max_read_buffer_size_), decompress_ahead_blocks(decompress_ahead_blocks_),
         index(index_), index_begin(index_begin_), index_end(index_end_)
     {
         if (index_begin != index_end)
@@ -100,6 +100,7 @@ protected:
 private:
     StorageStripeLog & storage;
     size_t max_read_buffer_size;
+    size_t decompress_ahead_blocks;
 
     std::shared_ptr<const IndexForNativeFormat> index;
     IndexForNativeFormat::Blocks::const_iterator index_begin;
@@ -124,6 +125,9 @@ private:
                 storage.full_path() + "data.bin", 0, 0,
                 std::min(static_cast<Poco::File::FileSize>(max_read_buffer_size), Poco::File(storage.full_path() + "data.bin").getSize()));
 
+            /// The data is read sequentially, so decompression of the next blocks can be overlapped with consumption.
+            data_in->setDecompressAhead(decompress_ahead_blocks);
+
             block_in.emplace(*data_in, 0, index_begin, index_end);
         }
     }
@@ -266,7 +270,8 @@ BlockInputStreams StorageStripeLog::read(
         std::advance(end, (stream + 1) * size / num_streams);
 
         res.emplace_back(std::make_shared<StripeLogBlockInputStream>(
-            *this, context.getSettingsRef().max_read_buffer_size, index, begin, end));
+            *this, context.getSettingsRef().max_read_buffer_size, context.getSettingsRef().decompress_ahead_blocks,
+            index, begin, end));
     }
 
     /// We do not keep read lock directly at the time of reading, because we read ranges of data that do not change.
@@ -5,6 +5,7 @@
 #include <Interpreters/evaluateConstantExpression.h>
 #include <Parsers/ASTLiteral.h>
 
+#include <IO/ParallelRangedReadBufferFromHTTP.h>
 #include <IO/ReadWriteBufferFromHTTP.h>
 #include <IO/WriteBufferFromHTTP.h>
 
@@ -48,7 +49,14 @@ namespace
             const ConnectionTimeouts & timeouts)
             : name(name_)
         {
-            read_buf = std::make_unique<ReadWriteBufferFromHTTP>(uri, method, callback, timeouts);
+            /// A plain GET of a server with byte range support may be downloaded by several threads.
+            const Settings & settings = context.getSettingsRef();
+            if (method == Poco::Net::HTTPRequest::HTTP_GET && !callback && settings.max_download_threads > 1)
+                read_buf = ParallelRangedReadBufferFromHTTP::tryCreate(
+                    uri, timeouts, settings.max_download_threads, settings.max_download_buffer_size);
+
+            if (!read_buf)
+                read_buf = std::make_unique<ReadWriteBufferFromHTTP>(uri, method, callback, timeouts);
 
             reader = FormatFactory::instance().getInput(format, *read_buf, sample_block, context, max_block_size);
         }
@@ -80,7 +88,7 @@ namespace
 
     private:
         String name;
-        std::unique_ptr<ReadWriteBufferFromHTTP> read_buf;
+        std::unique_ptr<ReadBuffer> read_buf;
         BlockInputStreamPtr reader;
     };
 
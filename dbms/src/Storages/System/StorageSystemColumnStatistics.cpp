@@ -0,0 +1,119 @@
+#include <Storages/System/StorageSystemColumnStatistics.h>
+#include <DataTypes/DataTypeString.h>
+#include <DataTypes/DataTypesNumber.h>
+#include <DataTypes/DataTypeArray.h>
+#include <Storages/StorageMergeTree.h>
+#include <Storages/StorageReplicatedMergeTree.h>
+#include <Storages/MergeTree/MergeTreeColumnStatistics.h>
+#include <Storages/VirtualColumnUtils.h>
+#include <Databases/IDatabase.h>
+
+
+namespace DB
+{
+
+
+NamesAndTypesList StorageSystemColumnStatistics::getNamesAndTypes()
+{
+    return {
+        { "database",      std::make_shared<DataTypeString>() },
+        { "table",         std::make_shared<DataTypeString>() },
+        { "column",        std::make_shared<DataTypeString>() },
+        { "rows",          std::make_shared<DataTypeUInt64>() },
+        { "nulls",         std::make_shared<DataTypeUInt64>() },
+        { "null_fraction", std::make_shared<DataTypeFloat64>() },
+        { "ndv",           std::make_shared<DataTypeUInt64>() },
+        { "histogram",     std::make_shared<DataTypeArray>(std::make_shared<DataTypeFloat64>()) },
+    };
+}
+
+
+void StorageSystemColumnStatistics::fillData(MutableColumns & res_columns, const Context & context, const SelectQueryInfo & query_info) const
+{
+    /// Collect a set of *MergeTree tables.
+    std::map<String, std::map<String, StoragePtr>> merge_tree_tables;
+    for (const auto & db : context.getDatabases())
+    {
+        if (context.hasDatabaseAccessRights(db.first))
+        {
+            for (auto iterator = db.second->getIterator(context); iterator->isValid(); iterator->next())
+            {
+                if (dynamic_cast<const StorageMergeTree *>(iterator->table().get())
+                    || dynamic_cast<const StorageReplicatedMergeTree *>(iterator->table().get()))
+                {
+                    merge_tree_tables[db.first][iterator->name()] = iterator->table();
+                }
+            }
+        }
+    }
+
+    MutableColumnPtr col_database_mut = ColumnString::create();
+    MutableColumnPtr col_table_mut = ColumnString::create();
+
+    for (auto & db : merge_tree_tables)
+    {
+        for (auto & table : db.second)
+        {
+            col_database_mut->insert(db.first);
+            col_table_mut->insert(table.first);
+        }
+    }
+
+    ColumnPtr col_database = std::move(col_database_mut);
+    ColumnPtr col_table = std::move(col_table_mut);
+
+    /// Determine what tables are needed by the conditions in the query,
+    /// to avoid reading statistics files of the other ones.
+    {
+        Block filtered_block
+        {
+            { col_database, std::make_shared<DataTypeString>(), "database" },
+            { col_table, std::make_shared<DataTypeString>(), "table" },
+        };
+
+        VirtualColumnUtils::filterBlockWithQuery(query_info.query, filtered_block, context);
+
+        if (!filtered_block.rows())
+            return;
+
+        col_database = filtered_block.getByName("database").column;
+        col_table = filtered_block.getByName("table").column;
+    }
+
+    for (size_t i_storage = 0; i_storage < col_database->size(); ++i_storage)
+    {
+        auto database = (*col_database)[i_storage].safeGet<String>();
+        auto table = (*col_table)[i_storage].safeGet<String>();
+
+        MergeTreePartColumnStatistics statistics;
+        {
+            const IStorage * storage = merge_tree_tables[database][table].get();
+            if (const auto * merge_tree = dynamic_cast<const StorageMergeTree *>(storage))
+                statistics = merge_tree->getData().getAggregatedColumnStatistics();
+            else if (const auto * replicated = dynamic_cast<const StorageReplicatedMergeTree *>(storage))
+                statistics = replicated->getData().getAggregatedColumnStatistics();
+        }
+
+        for (const auto & elem : statistics.columns)
+        {
+            const MergeTreeColumnStatistics & stat = elem.second;
+
+            Array histogram;
+            histogram.reserve(stat.histogram.size());
+            for (const auto bound : stat.histogram)
+                histogram.emplace_back(bound);
+
+            size_t col_num = 0;
+            res_columns[col_num++]->insert(database);
+            res_columns[col_num++]->insert(table);
+            res_columns[col_num++]->insert(elem.first);
+            res_columns[col_num++]->insert(stat.rows);
+            res_columns[col_num++]->insert(stat.nulls);
+            res_columns[col_num++]->insert(stat.getNullFraction());
+            res_columns[col_num++]->insert(stat.getNDV());
+            res_columns[col_num++]->insert(histogram);
+        }
+    }
+}
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <ext/shared_ptr_helper.h>
+#include <Storages/System/IStorageSystemOneBlock.h>
+
+
+namespace DB
+{
+
+class Context;
+
+
+/// Implements the `column_statistics` system table, which exposes the per-column statistics
+/// (rows, NULL fraction, approximate number of distinct values, histogram) of MergeTree tables,
+/// aggregated over all active parts. See MergeTreeColumnStatistics.h.
+class StorageSystemColumnStatistics : public ext::shared_ptr_helper<StorageSystemColumnStatistics>, public IStorageSystemOneBlock<StorageSystemColumnStatistics>
+{
+public:
+    String getName() const override { return "SystemColumnStatistics"; }
+
+    static NamesAndTypesList getNamesAndTypes();
+
+protected:
+    using IStorageSystemOneBlock::IStorageSystemOneBlock;
+
+    void fillData(MutableColumns & res_columns, const Context & context, const SelectQueryInfo & query_info) const override;
+};
+
+}
@@ -17,9 +17,12 @@ NamesAndTypesList StorageSystemEvents::getNamesAndTypes()
 
 void StorageSystemEvents::fillData(MutableColumns & res_columns, const Context &, const SelectQueryInfo &) const
 {
+    /// A snapshot also includes increments that threads have not propagated to the global counters yet.
+    auto counters = ProfileEvents::global_counters.getPartiallyAtomicSnapshot();
+
     for (size_t i = 0, end = ProfileEvents::end(); i < end; ++i)
     {
-        UInt64 value = ProfileEvents::global_counters[i];
+        UInt64 value = counters[i];
 
         if (0 != value)
         {
@@ -26,6 +26,7 @@ NamesAndTypesList StorageSystemMerges::getNamesAndTypes()
         {"columns_written", std::make_shared<DataTypeUInt64>()},
         {"memory_usage", std::make_shared<DataTypeUInt64>()},
         {"thread_number", std::make_shared<DataTypeUInt64>()},
+        {"selection_decision", std::make_shared<DataTypeString>()},
     };
 }
 
@@ -54,6 +55,7 @@ void StorageSystemMerges::fillData(MutableColumns & res_columns, const Context &
             res_columns[i++]->insert(merge.columns_written);
             res_columns[i++]->insert(merge.memory_usage);
             res_columns[i++]->insert(merge.thread_number);
+            res_columns[i++]->insert(merge.selection_decision);
         }
     }
 }
@@ -1,4 +1,5 @@
 #include <Common/escapeForFileName.h>
+#include <Common/FieldVisitors.h>
 #include <Columns/ColumnString.h>
 #include <DataTypes/DataTypeString.h>
 #include <DataTypes/DataTypesNumber.h>
@@ -6,6 +7,7 @@
 #include <DataTypes/DataTypeDate.h>
 #include <DataStreams/OneBlockInputStream.h>
 #include <Storages/System/StorageSystemPartsColumns.h>
+#include <Storages/MergeTree/MergeTreeMinMaxGranuleIndex.h>
 #include <Storages/StorageReplicatedMergeTree.h>
 #include <Storages/VirtualColumnUtils.h>
 #include <Databases/IDatabase.h>
@@ -53,6 +55,9 @@ StorageSystemPartsColumns::StorageSystemPartsColumns(const std::string & name)
         {"column_data_compressed_bytes",               std::make_shared<DataTypeUInt64>() },
         {"column_data_uncompressed_bytes",             std::make_shared<DataTypeUInt64>() },
         {"column_marks_bytes",                         std::make_shared<DataTypeUInt64>() },
+        {"column_has_minmax",                          std::make_shared<DataTypeUInt8>() },
+        {"column_min",                                 std::make_shared<DataTypeString>() },
+        {"column_max",                                 std::make_shared<DataTypeString>() },
     }
     )
 {
@@ -101,6 +106,29 @@ void StorageSystemPartsColumns::processNextStorage(MutableColumns & columns, con
 
         using State = MergeTreeDataPart::State;
 
+        /// Part-level min and max values of columns: from the partition min-max index and,
+        /// for columns with a per-granule skip index, from folding that index.
+        /// Only the index files are read, never the column data.
+        std::unordered_map<String, std::pair<Field, Field>> minmax_by_column;
+
+        if (part->minmax_idx.initialized)
+            for (size_t i = 0; i < info.data->minmax_idx_columns.size(); ++i)
+                minmax_by_column[info.data->minmax_idx_columns[i]] = std::make_pair(
+                    part->minmax_idx.parallelogram[i].left, part->minmax_idx.parallelogram[i].right);
+
+        for (size_t i = 0; i < info.data->skip_minmax_idx_columns.size(); ++i)
+        {
+            const String & column_name = info.data->skip_minmax_idx_columns[i];
+            if (minmax_by_column.count(column_name))
+                continue;
+
+            MergeTreeMinMaxGranuleIndex index(column_name, info.data->skip_minmax_idx_column_types[i]);
+            Field min_value;
+            Field max_value;
+            if (index.load(part->getFullPath()) && index.getTotalRange(min_value, max_value))
+                minmax_by_column[column_name] = std::make_pair(min_value, max_value);
+        }
+
         for (const auto & column : part->columns)
         {
             size_t j = 0;
@@ -158,6 +186,20 @@ void StorageSystemPartsColumns::processNextStorage(MutableColumns & columns, con
             columns[j++]->insert(column_size.data_uncompressed);
             columns[j++]->insert(column_size.marks);
 
+            auto minmax_it = minmax_by_column.find(column.name);
+            if (minmax_it != minmax_by_column.end())
+            {
+                columns[j++]->insert(UInt64(1));
+                columns[j++]->insert(applyVisitor(FieldVisitorToString(), minmax_it->second.first));
+                columns[j++]->insert(applyVisitor(FieldVisitorToString(), minmax_it->second.second));
+            }
+            else
+            {
+                columns[j++]->insertDefault();
+                columns[j++]->insertDefault();
+                columns[j++]->insertDefault();
+            }
+
             if (has_state_column)
                 columns[j++]->insert(part->stateString());
         }
@@ -53,6 +53,7 @@ NamesAndTypesList StorageSystemProcesses::getNamesAndTypes()
         {"written_bytes", std::make_shared<DataTypeUInt64>()},
         {"memory_usage", std::make_shared<DataTypeInt64>()},
         {"peak_memory_usage", std::make_shared<DataTypeInt64>()},
+        {"allotted_threads", std::make_shared<DataTypeUInt64>()},
         {"query", std::make_shared<DataTypeString>()},
 
         { "thread_numbers", std::make_shared<DataTypeArray>(std::make_shared<DataTypeUInt32>()) },
@@ -100,6 +101,7 @@ void StorageSystemProcesses::fillData(MutableColumns & res_columns, const Contex
         res_columns[i++]->insert(process.written_bytes);
         res_columns[i++]->insert(process.memory_usage);
         res_columns[i++]->insert(process.peak_memory_usage);
+        res_columns[i++]->insert(process.allotted_threads);
         res_columns[i++]->insert(process.query);
 
         {
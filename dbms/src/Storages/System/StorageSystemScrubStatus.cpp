@@ -0,0 +1,107 @@
+#include <Storages/System/StorageSystemScrubStatus.h>
+#include <DataTypes/DataTypeString.h>
+#include <DataTypes/DataTypesNumber.h>
+#include <DataTypes/DataTypeDateTime.h>
+#include <Storages/StorageMergeTree.h>
+#include <Storages/StorageReplicatedMergeTree.h>
+#include <Storages/VirtualColumnUtils.h>
+#include <Databases/IDatabase.h>
+
+
+namespace DB
+{
+
+
+NamesAndTypesList StorageSystemScrubStatus::getNamesAndTypes()
+{
+    return {
+        { "database",           std::make_shared<DataTypeString>() },
+        { "table",              std::make_shared<DataTypeString>() },
+        { "last_scrubbed_part", std::make_shared<DataTypeString>() },
+        { "parts_scrubbed",     std::make_shared<DataTypeUInt64>() },
+        { "bytes_scrubbed",     std::make_shared<DataTypeUInt64>() },
+        { "failed_parts",       std::make_shared<DataTypeUInt64>() },
+        { "last_scrub_time",    std::make_shared<DataTypeDateTime>() },
+        { "last_pass_time",     std::make_shared<DataTypeDateTime>() },
+    };
+}
+
+
+void StorageSystemScrubStatus::fillData(MutableColumns & res_columns, const Context & context, const SelectQueryInfo & query_info) const
+{
+    /// Collect a set of *MergeTree tables.
+    std::map<String, std::map<String, StoragePtr>> merge_tree_tables;
+    for (const auto & db : context.getDatabases())
+    {
+        if (context.hasDatabaseAccessRights(db.first))
+        {
+            for (auto iterator = db.second->getIterator(context); iterator->isValid(); iterator->next())
+            {
+                if (dynamic_cast<const StorageMergeTree *>(iterator->table().get())
+                    || dynamic_cast<const StorageReplicatedMergeTree *>(iterator->table().get()))
+                {
+                    merge_tree_tables[db.first][iterator->name()] = iterator->table();
+                }
+            }
+        }
+    }
+
+    MutableColumnPtr col_database_mut = ColumnString::create();
+    MutableColumnPtr col_table_mut = ColumnString::create();
+
+    for (auto & db : merge_tree_tables)
+    {
+        for (auto & table : db.second)
+        {
+            col_database_mut->insert(db.first);
+            col_table_mut->insert(table.first);
+        }
+    }
+
+    ColumnPtr col_database = std::move(col_database_mut);
+    ColumnPtr col_table = std::move(col_table_mut);
+
+    /// Determine what tables are needed by the conditions in the query.
+    {
+        Block filtered_block
+        {
+            { col_database, std::make_shared<DataTypeString>(), "database" },
+            { col_table, std::make_shared<DataTypeString>(), "table" },
+        };
+
+        VirtualColumnUtils::filterBlockWithQuery(query_info.query, filtered_block, context);
+
+        if (!filtered_block.rows())
+            return;
+
+        col_database = filtered_block.getByName("database").column;
+        col_table = filtered_block.getByName("table").column;
+    }
+
+    for (size_t i_storage = 0; i_storage < col_database->size(); ++i_storage)
+    {
+        auto database = (*col_database)[i_storage].safeGet<String>();
+        auto table = (*col_table)[i_storage].safeGet<String>();
+
+        MergeTreeData::ScrubStatus status;
+        {
+            const IStorage * storage = merge_tree_tables[database][table].get();
+            if (const auto * merge_tree = dynamic_cast<const StorageMergeTree *>(storage))
+                status = merge_tree->getData().getScrubStatus();
+            else if (const auto * replicated = dynamic_cast<const StorageReplicatedMergeTree *>(storage))
+                status = replicated->getData().getScrubStatus();
+        }
+
+        size_t col_num = 0;
+        res_columns[col_num++]->insert(database);
+        res_columns[col_num++]->insert(table);
+        res_columns[col_num++]->insert(status.last_scrubbed_part);
+        res_columns[col_num++]->insert(status.parts_scrubbed);
+        res_columns[col_num++]->insert(status.bytes_scrubbed);
+        res_columns[col_num++]->insert(status.failed_parts);
+        res_columns[col_num++]->insert(UInt64(status.last_scrub_time));
+        res_columns[col_num++]->insert(UInt64(status.last_pass_time));
+    }
+}
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <ext/shared_ptr_helper.h>
+#include <Storages/System/IStorageSystemOneBlock.h>
+
+
+namespace DB
+{
+
+class Context;
+
+
+/// Implements the `scrub_status` system table, which provides information about the progress
+/// of background checksum verification (see the scrub_max_bytes_per_second MergeTree setting).
+class StorageSystemScrubStatus : public ext::shared_ptr_helper<StorageSystemScrubStatus>, public IStorageSystemOneBlock<StorageSystemScrubStatus>
+{
+public:
+    String getName() const override { return "SystemScrubStatus"; }
+
+    static NamesAndTypesList getNamesAndTypes();
+
+protected:
+    using IStorageSystemOneBlock::IStorageSystemOneBlock;
+
+    void fillData(MutableColumns & res_columns, const Context & context, const SelectQueryInfo & query_info) const override;
+};
+
+}
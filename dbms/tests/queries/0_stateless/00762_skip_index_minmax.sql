@@ -0,0 +1,17 @@
+DROP TABLE IF EXISTS test.skip_idx;
+CREATE TABLE test.skip_idx (d Date, k UInt64, v UInt64) ENGINE = MergeTree PARTITION BY toYYYYMM(d) ORDER BY k SETTINGS index_granularity = 8, skip_index_minmax_columns = 'v';
+
+INSERT INTO test.skip_idx SELECT toDate('2018-01-01'), number, number * 2 FROM numbers(100);
+INSERT INTO test.skip_idx SELECT toDate('2018-02-01'), number, number * 2 FROM numbers(100, 100);
+
+SELECT count() FROM test.skip_idx WHERE v = 64;
+SELECT count() FROM test.skip_idx WHERE v = 63;
+SELECT k, v FROM test.skip_idx WHERE v >= 390 ORDER BY k;
+SELECT count() FROM test.skip_idx WHERE v BETWEEN 100 AND 110;
+
+OPTIMIZE TABLE test.skip_idx;
+
+SELECT count() FROM test.skip_idx WHERE v = 64;
+SELECT k, v FROM test.skip_idx WHERE v >= 390 ORDER BY k;
+
+DROP TABLE test.skip_idx;
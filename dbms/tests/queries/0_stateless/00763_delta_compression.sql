@@ -0,0 +1,13 @@
+DROP TABLE IF EXISTS test.delta_codec;
+CREATE TABLE test.delta_codec (t DateTime, k UInt64, v Float64, s String) ENGINE = MergeTree ORDER BY (k, t) SETTINGS index_granularity = 32, delta_compression_columns = 't,k,v';
+
+INSERT INTO test.delta_codec SELECT toDateTime('2018-01-01 00:00:00') + number, number, number / 7, toString(number) FROM numbers(1000);
+
+SELECT count(), sum(k), min(t), max(t), round(sum(v), 3) FROM test.delta_codec;
+SELECT k, v, s FROM test.delta_codec WHERE k IN (0, 1, 999) ORDER BY k;
+
+OPTIMIZE TABLE test.delta_codec;
+
+SELECT count(), sum(k), min(t), max(t), round(sum(v), 3) FROM test.delta_codec;
+
+DROP TABLE test.delta_codec;
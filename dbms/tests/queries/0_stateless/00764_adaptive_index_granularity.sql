@@ -0,0 +1,15 @@
+DROP TABLE IF EXISTS test.adaptive_granularity;
+CREATE TABLE test.adaptive_granularity (k UInt64, s String) ENGINE = MergeTree ORDER BY k SETTINGS index_granularity = 8192, index_granularity_bytes = 4096;
+
+INSERT INTO test.adaptive_granularity SELECT number, concat('payload_', toString(number), repeat('x', 100)) FROM numbers(1000);
+INSERT INTO test.adaptive_granularity SELECT number, concat('payload_', toString(number), repeat('x', 100)) FROM numbers(1000, 1000);
+
+SELECT count(), uniqExact(k), min(k), max(k) FROM test.adaptive_granularity;
+SELECT k, substring(s, 1, 12) FROM test.adaptive_granularity WHERE k IN (0, 999, 1000, 1999) ORDER BY k;
+
+OPTIMIZE TABLE test.adaptive_granularity;
+
+SELECT count(), uniqExact(k), min(k), max(k) FROM test.adaptive_granularity;
+SELECT count() FROM test.adaptive_granularity WHERE k >= 500 AND k < 1500;
+
+DROP TABLE test.adaptive_granularity;
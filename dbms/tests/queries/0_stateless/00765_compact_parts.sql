@@ -0,0 +1,18 @@
+DROP TABLE IF EXISTS test.compact_parts;
+CREATE TABLE test.compact_parts (k UInt64, v String) ENGINE = MergeTree ORDER BY k SETTINGS min_bytes_for_wide_part = 10485760;
+
+INSERT INTO test.compact_parts SELECT number, toString(number) FROM numbers(100);
+INSERT INTO test.compact_parts SELECT number, toString(number) FROM numbers(100, 100);
+
+SELECT count(), min(k), max(k) FROM test.compact_parts;
+SELECT k, v FROM test.compact_parts WHERE k IN (0, 99, 100, 199) ORDER BY k;
+
+ALTER TABLE test.compact_parts ADD COLUMN m UInt64 DEFAULT k * 2;
+SELECT sum(m) FROM test.compact_parts;
+
+OPTIMIZE TABLE test.compact_parts;
+
+SELECT count(), min(k), max(k) FROM test.compact_parts;
+SELECT sum(m) FROM test.compact_parts;
+
+DROP TABLE test.compact_parts;
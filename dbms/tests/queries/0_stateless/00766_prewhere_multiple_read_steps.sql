@@ -0,0 +1,17 @@
+DROP TABLE IF EXISTS test.prewhere_multiple_read_steps;
+
+CREATE TABLE test.prewhere_multiple_read_steps (k UInt64, a UInt64, b UInt64, s String) ENGINE = MergeTree ORDER BY k;
+
+INSERT INTO test.prewhere_multiple_read_steps SELECT number, number % 10, number % 7, toString(number) FROM system.numbers LIMIT 1000;
+
+SELECT count() FROM test.prewhere_multiple_read_steps PREWHERE a < 5 AND b < 3;
+SELECT count() FROM test.prewhere_multiple_read_steps PREWHERE a < 5 AND b < 3 AND length(s) > 0;
+SELECT sum(k) FROM test.prewhere_multiple_read_steps PREWHERE a = 1 AND b = 1 WHERE k < 500;
+SELECT k, a < 5 AND b < 3 FROM test.prewhere_multiple_read_steps PREWHERE a < 5 AND b < 3 WHERE k < 20 ORDER BY k;
+
+INSERT INTO test.prewhere_multiple_read_steps SELECT number + 1000, (number + 1000) % 10, (number + 1000) % 7, toString(number + 1000) FROM system.numbers LIMIT 1000;
+
+SELECT count() FROM test.prewhere_multiple_read_steps PREWHERE a < 5 AND b < 3;
+SELECT count() FROM test.prewhere_multiple_read_steps PREWHERE a < 5 AND b < 3 SETTINGS enable_multiple_prewhere_read_steps = 0;
+
+DROP TABLE test.prewhere_multiple_read_steps;
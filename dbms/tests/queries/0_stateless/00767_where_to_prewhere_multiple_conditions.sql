@@ -0,0 +1,14 @@
+DROP TABLE IF EXISTS test.where_to_prewhere_multiple_conditions;
+
+CREATE TABLE test.where_to_prewhere_multiple_conditions (k UInt64, a UInt64, b UInt64, s String) ENGINE = MergeTree ORDER BY k;
+
+INSERT INTO test.where_to_prewhere_multiple_conditions SELECT number, number % 100, number % 77, toString(number) FROM system.numbers LIMIT 10000;
+
+SELECT k FROM test.where_to_prewhere_multiple_conditions WHERE a = 50 AND b = 33 ORDER BY k;
+SELECT k FROM test.where_to_prewhere_multiple_conditions WHERE a = 50 AND b = 33 ORDER BY k SETTINGS optimize_move_to_prewhere = 0;
+SELECT sum(k) FROM test.where_to_prewhere_multiple_conditions WHERE a = 50 AND b = 33 AND length(s) >= 2;
+SELECT sum(k) FROM test.where_to_prewhere_multiple_conditions WHERE a = 50 AND b = 33 AND length(s) >= 2 SETTINGS optimize_move_to_prewhere = 0;
+SELECT count() FROM test.where_to_prewhere_multiple_conditions WHERE a = 50 AND k < 5000;
+SELECT count() FROM test.where_to_prewhere_multiple_conditions WHERE a = 50 AND k < 5000 SETTINGS optimize_move_to_prewhere = 0;
+
+DROP TABLE test.where_to_prewhere_multiple_conditions;
@@ -0,0 +1,12 @@
+DROP TABLE IF EXISTS test.partition_parallel_final;
+
+CREATE TABLE test.partition_parallel_final (p UInt32, k UInt64, v UInt64) ENGINE = ReplacingMergeTree(v) PARTITION BY p ORDER BY k;
+
+INSERT INTO test.partition_parallel_final SELECT number % 4, number, 1 FROM system.numbers LIMIT 100;
+INSERT INTO test.partition_parallel_final SELECT number % 4, number, 2 FROM system.numbers LIMIT 50;
+
+SELECT count(), sum(v) FROM test.partition_parallel_final FINAL;
+SELECT count(), sum(v) FROM test.partition_parallel_final FINAL SETTINGS do_not_merge_across_partitions_select_final = 1;
+SELECT p, count(), sum(v) FROM test.partition_parallel_final FINAL GROUP BY p ORDER BY p SETTINGS do_not_merge_across_partitions_select_final = 1;
+
+DROP TABLE test.partition_parallel_final;
@@ -0,0 +1,17 @@
+DROP TABLE IF EXISTS test.in_memory_parts;
+
+CREATE TABLE test.in_memory_parts (k UInt64, s String) ENGINE = MergeTree ORDER BY k SETTINGS min_bytes_for_on_disk_part = 1048576;
+
+INSERT INTO test.in_memory_parts SELECT number, toString(number) FROM system.numbers LIMIT 100;
+INSERT INTO test.in_memory_parts SELECT number + 100, toString(number + 100) FROM system.numbers LIMIT 100;
+
+SELECT count(), sum(k) FROM test.in_memory_parts;
+SELECT k, s FROM test.in_memory_parts WHERE k = 150;
+SELECT count() FROM test.in_memory_parts WHERE k >= 100;
+
+OPTIMIZE TABLE test.in_memory_parts FINAL;
+
+SELECT count(), sum(k) FROM test.in_memory_parts;
+SELECT count() FROM system.parts WHERE database = 'test' AND table = 'in_memory_parts' AND active;
+
+DROP TABLE test.in_memory_parts;
@@ -0,0 +1,29 @@
+DROP TABLE IF EXISTS test.vertical_merge_summing;
+DROP TABLE IF EXISTS test.vertical_merge_aggregating;
+
+CREATE TABLE test.vertical_merge_summing (k UInt64, v Int64, s String) ENGINE = SummingMergeTree(v) ORDER BY k
+    SETTINGS enable_vertical_merge_algorithm = 1, vertical_merge_algorithm_min_rows_to_activate = 1, vertical_merge_algorithm_min_columns_to_activate = 1;
+
+INSERT INTO test.vertical_merge_summing SELECT number + 1, 1, 'a' FROM system.numbers LIMIT 10;
+INSERT INTO test.vertical_merge_summing SELECT number + 1, 2, 'a' FROM system.numbers LIMIT 10;
+-- these two rows sum to zero and the group must disappear after the merge
+INSERT INTO test.vertical_merge_summing VALUES (11, 5, 'b');
+INSERT INTO test.vertical_merge_summing VALUES (11, -5, 'b');
+
+OPTIMIZE TABLE test.vertical_merge_summing FINAL;
+
+SELECT count(), sum(v) FROM test.vertical_merge_summing;
+SELECT k, v, s FROM test.vertical_merge_summing WHERE k <= 3 ORDER BY k;
+
+CREATE TABLE test.vertical_merge_aggregating (k UInt64, st AggregateFunction(sum, UInt64), s String) ENGINE = AggregatingMergeTree ORDER BY k
+    SETTINGS enable_vertical_merge_algorithm = 1, vertical_merge_algorithm_min_rows_to_activate = 1, vertical_merge_algorithm_min_columns_to_activate = 1;
+
+INSERT INTO test.vertical_merge_aggregating SELECT number % 5 AS k, sumState(number), 'x' FROM (SELECT number FROM system.numbers LIMIT 100) GROUP BY k;
+INSERT INTO test.vertical_merge_aggregating SELECT number % 5 AS k, sumState(number), 'x' FROM (SELECT number FROM system.numbers LIMIT 100, 100) GROUP BY k;
+
+OPTIMIZE TABLE test.vertical_merge_aggregating FINAL;
+
+SELECT k, sumMerge(st), max(s) FROM test.vertical_merge_aggregating GROUP BY k ORDER BY k;
+
+DROP TABLE test.vertical_merge_summing;
+DROP TABLE test.vertical_merge_aggregating;
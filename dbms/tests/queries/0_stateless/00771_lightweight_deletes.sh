@@ -0,0 +1,40 @@
+#!/usr/bin/env bash
+
+CURDIR=$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)
+. $CURDIR/../shell_config.sh
+
+. $CURDIR/mergetree_mutations.lib
+
+${CLICKHOUSE_CLIENT} --query="DROP TABLE IF EXISTS test.lightweight_deletes"
+
+${CLICKHOUSE_CLIENT} --query="CREATE TABLE test.lightweight_deletes(k UInt64, v String) \
+    ENGINE = MergeTree ORDER BY k SETTINGS lightweight_deletes = 1"
+
+${CLICKHOUSE_CLIENT} --query="INSERT INTO test.lightweight_deletes SELECT number + 1, toString(number + 1) FROM system.numbers LIMIT 100"
+
+${CLICKHOUSE_CLIENT} --query="ALTER TABLE test.lightweight_deletes DELETE WHERE k % 10 = 0"
+
+wait_for_mutation "lightweight_deletes" "mutation_2.txt"
+
+# The deleted rows are hidden from queries...
+${CLICKHOUSE_CLIENT} --query="SELECT count(), sum(k) FROM test.lightweight_deletes"
+${CLICKHOUSE_CLIENT} --query="SELECT k FROM test.lightweight_deletes WHERE k IN (9, 10, 11) ORDER BY k"
+
+# ...but are still physically present in the part and can be inspected with the mask disabled.
+${CLICKHOUSE_CLIENT} --query="SELECT sum(rows) FROM system.parts WHERE database = 'test' AND table = 'lightweight_deletes' AND active"
+${CLICKHOUSE_CLIENT} --query="SELECT count() FROM test.lightweight_deletes SETTINGS apply_deleted_mask = 0"
+
+# A second lightweight delete merges its mask with the existing one.
+${CLICKHOUSE_CLIENT} --query="ALTER TABLE test.lightweight_deletes DELETE WHERE v = '55'"
+
+wait_for_mutation "lightweight_deletes" "mutation_3.txt"
+
+${CLICKHOUSE_CLIENT} --query="SELECT count(), sum(k) FROM test.lightweight_deletes"
+
+# A merge physically removes the masked rows.
+${CLICKHOUSE_CLIENT} --query="OPTIMIZE TABLE test.lightweight_deletes FINAL"
+
+${CLICKHOUSE_CLIENT} --query="SELECT sum(rows) FROM system.parts WHERE database = 'test' AND table = 'lightweight_deletes' AND active"
+${CLICKHOUSE_CLIENT} --query="SELECT count() FROM test.lightweight_deletes SETTINGS apply_deleted_mask = 0"
+
+${CLICKHOUSE_CLIENT} --query="DROP TABLE test.lightweight_deletes"
@@ -0,0 +1,12 @@
+DROP TABLE IF EXISTS test.ttl;
+
+CREATE TABLE test.ttl (d DateTime, a Int) ENGINE = MergeTree ORDER BY tuple() TTL d + toIntervalDay(1);
+
+INSERT INTO test.ttl VALUES (now() - toIntervalDay(2), 1), (now() + toIntervalDay(1), 2);
+INSERT INTO test.ttl VALUES (now() - toIntervalDay(3), 3), (now() + toIntervalDay(1), 4);
+
+OPTIMIZE TABLE test.ttl FINAL;
+
+SELECT a FROM test.ttl ORDER BY a;
+
+DROP TABLE test.ttl;
@@ -0,0 +1,18 @@
+DROP TABLE IF EXISTS test.order_inside;
+
+CREATE TABLE test.order_inside (d Date, a Int32, b Int32) ENGINE = MergeTree PARTITION BY d ORDER BY (a, b);
+
+INSERT INTO test.order_inside VALUES ('2018-01-01', 1, 2), ('2018-01-01', 1, 5), ('2018-01-01', 2, 3), ('2018-01-01', 3, 1);
+INSERT INTO test.order_inside VALUES ('2018-02-01', 2, 1), ('2018-02-01', 4, 2);
+
+SELECT a, b FROM test.order_inside ORDER BY a, b;
+SELECT '---';
+SELECT a, b FROM test.order_inside ORDER BY a DESC, b DESC;
+SELECT '---';
+SELECT a, b FROM test.order_inside ORDER BY a, b DESC;
+SELECT '---';
+SELECT a, b FROM test.order_inside ORDER BY a, b LIMIT 3;
+SELECT '---';
+SELECT a, b FROM test.order_inside ORDER BY a, b SETTINGS optimize_read_in_order = 0;
+
+DROP TABLE test.order_inside;
@@ -0,0 +1,16 @@
+DROP TABLE IF EXISTS test.result_cache;
+
+CREATE TABLE test.result_cache (x UInt32) ENGINE = MergeTree ORDER BY x;
+
+INSERT INTO test.result_cache VALUES (1), (2), (3);
+
+SELECT sum(x) FROM test.result_cache SETTINGS use_query_result_cache = 1;
+-- The second run may be served from the cache and must return the same result.
+SELECT sum(x) FROM test.result_cache SETTINGS use_query_result_cache = 1;
+
+INSERT INTO test.result_cache VALUES (4);
+
+-- The insert has invalidated the cached result, the new data must be visible.
+SELECT sum(x) FROM test.result_cache SETTINGS use_query_result_cache = 1;
+
+DROP TABLE test.result_cache;
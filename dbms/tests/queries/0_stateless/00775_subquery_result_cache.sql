@@ -0,0 +1,24 @@
+DROP TABLE IF EXISTS test.subquery_cache_data;
+DROP TABLE IF EXISTS test.subquery_cache_filter;
+
+CREATE TABLE test.subquery_cache_data (x UInt32) ENGINE = MergeTree ORDER BY x;
+CREATE TABLE test.subquery_cache_filter (x UInt32) ENGINE = MergeTree ORDER BY x;
+
+INSERT INTO test.subquery_cache_data VALUES (1), (2), (3), (4), (5);
+INSERT INTO test.subquery_cache_filter VALUES (2), (4);
+
+SELECT count() FROM test.subquery_cache_data WHERE x IN (SELECT x FROM test.subquery_cache_filter) SETTINGS use_subquery_result_cache = 1;
+-- The second run may reuse the cached set and must return the same result.
+SELECT count() FROM test.subquery_cache_data WHERE x IN (SELECT x FROM test.subquery_cache_filter) SETTINGS use_subquery_result_cache = 1;
+
+SELECT (SELECT max(x) FROM test.subquery_cache_filter) SETTINGS use_subquery_result_cache = 1;
+SELECT (SELECT max(x) FROM test.subquery_cache_filter) SETTINGS use_subquery_result_cache = 1;
+
+INSERT INTO test.subquery_cache_filter VALUES (5);
+
+-- The insert has invalidated the cached set and the cached scalar, the new data must be visible.
+SELECT count() FROM test.subquery_cache_data WHERE x IN (SELECT x FROM test.subquery_cache_filter) SETTINGS use_subquery_result_cache = 1;
+SELECT (SELECT max(x) FROM test.subquery_cache_filter) SETTINGS use_subquery_result_cache = 1;
+
+DROP TABLE test.subquery_cache_data;
+DROP TABLE test.subquery_cache_filter;
@@ -0,0 +1,10 @@
+-- Strings around the inline storage boundary of the aggregation key (23 bytes), including the empty string,
+-- a string that is a prefix of a longer one, and long strings differing only in the tail.
+SELECT s, count() AS c
+FROM (SELECT arrayJoin(['', 'a', 'a', 'ab', 'abcdefghijklmnopqrstuvw', 'abcdefghijklmnopqrstuvw', 'abcdefghijklmnopqrstuvwx', 'abcdefghijklmnopqrstuvwxyz_longer_than_inline', 'abcdefghijklmnopqrstuvwxyz_longer_than_inline', 'abcdefghijklmnopqrstuvwxyz_longer_than_other']) AS s)
+GROUP BY s
+ORDER BY s;
+
+-- Enough keys to convert the hash table to two-level.
+SELECT count(), sum(c)
+FROM (SELECT s, count() AS c FROM (SELECT toString(number % 200000) AS s FROM system.numbers LIMIT 1000000) GROUP BY s);
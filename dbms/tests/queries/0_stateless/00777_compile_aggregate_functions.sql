@@ -0,0 +1,17 @@
+SET compile_aggregate_functions = 1;
+
+-- Compilable functions over several argument types, with keys.
+SELECT k, count(), sum(n), min(n), max(f), avg(n)
+FROM (SELECT number % 3 AS k, number AS n, number / 4 AS f FROM system.numbers LIMIT 100)
+GROUP BY k
+ORDER BY k;
+
+-- The same without keys, including signed values.
+SELECT count(), sum(n), min(i), max(i), avg(f)
+FROM (SELECT number AS n, toInt32(number) - 50 AS i, number / 2 AS f FROM system.numbers LIMIT 101);
+
+-- A mix of compiled and interpreted functions over the same keys.
+SELECT k, sum(n), uniqExact(n % 10), max(n)
+FROM (SELECT number % 2 AS k, number AS n FROM system.numbers LIMIT 100)
+GROUP BY k
+ORDER BY k;
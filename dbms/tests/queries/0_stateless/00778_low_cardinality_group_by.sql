@@ -0,0 +1,15 @@
+set allow_experimental_low_cardinality_type = 1;
+
+drop table if exists test.lc_group_by;
+create table test.lc_group_by (dim LowCardinality(String), dim_null LowCardinality(Nullable(String)), id UInt64, raw String) engine = MergeTree order by tuple();
+insert into test.lc_group_by select toString(number % 3), if(number % 5 = 0, NULL, toString(number % 3)), number % 2, toString(number % 3) from system.numbers limit 30;
+
+-- single LowCardinality key: aggregated by dictionary positions.
+select dim, count() from test.lc_group_by group by dim order by dim;
+-- LowCardinality key together with a fixed-size key: packed keys.
+select dim, id, count() from test.lc_group_by group by dim, id order by dim, id;
+-- LowCardinality key together with a variable-size key: serialized keys, no materialization.
+select dim, raw, count() from test.lc_group_by group by dim, raw order by dim, raw;
+-- nullable LowCardinality key: serialized keys.
+select dim_null, count() from test.lc_group_by group by dim_null order by dim_null;
+drop table if exists test.lc_group_by;
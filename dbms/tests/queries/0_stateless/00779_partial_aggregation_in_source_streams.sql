@@ -0,0 +1,17 @@
+drop table if exists test.partial_agg;
+create table test.partial_agg (k UInt64, v UInt64) engine = MergeTree order by tuple();
+
+-- Several parts, so that the read pipeline has several streams.
+insert into test.partial_agg select number % 10, number from system.numbers limit 10000;
+insert into test.partial_agg select number % 10, number + 10000 from system.numbers limit 10000;
+insert into test.partial_agg select number % 10, number + 20000 from system.numbers limit 10000;
+
+set max_threads = 4;
+set partial_aggregation_in_source_streams = 1;
+set partial_aggregation_flush_threshold_bytes = 1; -- flush after every block, so that merging of partial results is exercised
+
+select k, count(), sum(v) from test.partial_agg group by k order by k;
+select count() from test.partial_agg;
+select count() from test.partial_agg where v = 424242;
+
+drop table if exists test.partial_agg;
@@ -0,0 +1,12 @@
+SET join_algorithm = 'partitioned_hash';
+SET max_threads = 4;
+
+SELECT k, v FROM (SELECT number AS k FROM system.numbers LIMIT 10) ANY LEFT JOIN (SELECT number * 2 AS k, toString(number) AS v FROM system.numbers LIMIT 10) USING k ORDER BY k;
+
+SELECT k, v FROM (SELECT number AS k FROM system.numbers LIMIT 3) ALL INNER JOIN (SELECT number % 3 AS k, toString(number) AS v FROM system.numbers LIMIT 6) USING k ORDER BY k, v;
+
+SELECT k, v FROM (SELECT toString(number) AS k FROM system.numbers LIMIT 5) ANY INNER JOIN (SELECT toString(number * 2) AS k, toString(number) AS v FROM system.numbers LIMIT 5) USING k ORDER BY k;
+
+SELECT k, v FROM (SELECT number AS k, toString(number) AS v1 FROM system.numbers LIMIT 5) ALL FULL JOIN (SELECT number + 3 AS k, number AS v FROM system.numbers LIMIT 5) USING k ORDER BY k, v;
+
+SELECT k1, k2, v FROM (SELECT number AS k1, number % 2 AS k2 FROM system.numbers LIMIT 6) ANY LEFT JOIN (SELECT number AS k1, number % 2 AS k2, number * 10 AS v FROM system.numbers LIMIT 3) USING k1, k2 ORDER BY k1, k2;
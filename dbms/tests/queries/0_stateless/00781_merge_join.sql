@@ -0,0 +1,16 @@
+SET join_algorithm = 'merge';
+
+SELECT k, v FROM (SELECT number AS k FROM system.numbers LIMIT 10) ANY LEFT JOIN (SELECT number * 2 AS k, toString(number) AS v FROM system.numbers LIMIT 10) USING k ORDER BY k;
+
+SELECT k, v FROM (SELECT number AS k FROM system.numbers LIMIT 3) ALL INNER JOIN (SELECT number % 3 AS k, toString(number) AS v FROM system.numbers LIMIT 6) USING k ORDER BY k, v;
+
+SELECT k, v FROM (SELECT number AS k FROM system.numbers LIMIT 5) ALL LEFT JOIN (SELECT number % 3 AS k, toString(number) AS v FROM system.numbers LIMIT 6) USING k ORDER BY k, v;
+
+SELECT k, v FROM (SELECT toString(number) AS k FROM system.numbers LIMIT 5) ANY INNER JOIN (SELECT toString(number * 2) AS k, toString(number) AS v FROM system.numbers LIMIT 5) USING k ORDER BY k;
+
+SELECT k, v FROM (SELECT nullIf(number, 2) AS k FROM system.numbers LIMIT 4) ANY LEFT JOIN (SELECT nullIf(number, 1) AS k, toString(number) AS v FROM system.numbers LIMIT 4) USING k ORDER BY k;
+
+SET join_algorithm = 'auto';
+SET max_rows_in_join = 3;
+SELECT count() FROM (SELECT number AS k FROM system.numbers LIMIT 10000) ALL INNER JOIN (SELECT intDiv(number, 2) AS k FROM system.numbers LIMIT 10000) USING k;
+SET max_rows_in_join = 0;
@@ -0,0 +1,11 @@
+SET join_runtime_filter = 1;
+
+SELECT k, v FROM (SELECT number AS k FROM system.numbers LIMIT 10) ANY INNER JOIN (SELECT number * 2 AS k, toString(number) AS v FROM system.numbers LIMIT 5) USING k ORDER BY k;
+
+SELECT k, v FROM (SELECT number AS k FROM system.numbers LIMIT 5) ALL RIGHT JOIN (SELECT number + 3 AS k, number AS v FROM system.numbers LIMIT 5) USING k ORDER BY k, v;
+
+SELECT k, v FROM (SELECT nullIf(number, 2) AS k FROM system.numbers LIMIT 4) ANY INNER JOIN (SELECT nullIf(number, 1) AS k, toString(number) AS v FROM system.numbers LIMIT 4) USING k ORDER BY k;
+
+SET join_algorithm = 'partitioned_hash';
+SET max_threads = 4;
+SELECT count() FROM (SELECT number AS k FROM system.numbers LIMIT 10000) ALL INNER JOIN (SELECT intDiv(number, 2) AS k FROM system.numbers LIMIT 10000) USING k;
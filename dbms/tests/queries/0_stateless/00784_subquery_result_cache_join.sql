@@ -0,0 +1,22 @@
+DROP TABLE IF EXISTS test.join_cache_data;
+DROP TABLE IF EXISTS test.join_cache_dim;
+
+CREATE TABLE test.join_cache_data (k UInt32) ENGINE = MergeTree ORDER BY k;
+CREATE TABLE test.join_cache_dim (k UInt32, v String, w UInt32) ENGINE = MergeTree ORDER BY k;
+
+INSERT INTO test.join_cache_data VALUES (1), (2), (3), (4);
+INSERT INTO test.join_cache_dim VALUES (1, 'a', 10), (2, 'b', 20), (4, 'd', 40);
+
+SELECT k, v FROM test.join_cache_data ANY LEFT JOIN test.join_cache_dim USING k ORDER BY k SETTINGS use_subquery_result_cache = 1;
+-- The second run may reuse the cached join and must return the same result.
+SELECT k, v FROM test.join_cache_data ANY LEFT JOIN test.join_cache_dim USING k ORDER BY k SETTINGS use_subquery_result_cache = 1;
+-- A different set of columns read from the joined table is a different cache entry.
+SELECT k, w FROM test.join_cache_data ANY LEFT JOIN test.join_cache_dim USING k ORDER BY k SETTINGS use_subquery_result_cache = 1;
+
+INSERT INTO test.join_cache_dim VALUES (3, 'c', 30);
+
+-- The insert has invalidated the cached join, the new data must be visible.
+SELECT k, v FROM test.join_cache_data ANY LEFT JOIN test.join_cache_dim USING k ORDER BY k SETTINGS use_subquery_result_cache = 1;
+
+DROP TABLE test.join_cache_data;
+DROP TABLE test.join_cache_dim;
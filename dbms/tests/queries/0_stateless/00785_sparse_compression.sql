@@ -0,0 +1,21 @@
+DROP TABLE IF EXISTS test.sparse_codec;
+CREATE TABLE test.sparse_codec (k UInt64, hits UInt64, errors UInt32, ratio Float64) ENGINE = MergeTree ORDER BY k SETTINGS index_granularity = 32, sparse_compression_columns = 'hits,errors,ratio';
+
+-- Columns are >99% zeros: only every 500th row carries a value.
+INSERT INTO test.sparse_codec SELECT number, number % 500 = 0 ? number : 0, number % 500 = 0 ? toUInt32(number % 7) : 0, number % 500 = 0 ? number / 3 : 0 FROM numbers(10000);
+
+SELECT count(), sum(hits), sum(errors), round(sum(ratio), 3), countIf(hits != 0) FROM test.sparse_codec;
+SELECT k, hits, errors, round(ratio, 3) FROM test.sparse_codec WHERE hits != 0 ORDER BY k LIMIT 3;
+
+OPTIMIZE TABLE test.sparse_codec;
+
+SELECT count(), sum(hits), sum(errors), round(sum(ratio), 3), countIf(hits != 0) FROM test.sparse_codec;
+
+-- A dense column through the same path falls back to LZ4 per block and must round-trip as well.
+DROP TABLE IF EXISTS test.sparse_codec_dense;
+CREATE TABLE test.sparse_codec_dense (k UInt64, v UInt64) ENGINE = MergeTree ORDER BY k SETTINGS sparse_compression_columns = 'v';
+INSERT INTO test.sparse_codec_dense SELECT number, number + 1 FROM numbers(1000);
+SELECT count(), sum(v) FROM test.sparse_codec_dense;
+
+DROP TABLE test.sparse_codec;
+DROP TABLE test.sparse_codec_dense;
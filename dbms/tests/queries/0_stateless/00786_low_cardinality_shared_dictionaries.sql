@@ -0,0 +1,17 @@
+set allow_experimental_low_cardinality_type = 1;
+set low_cardinality_share_dictionaries = 1;
+
+drop table if exists test.lc_shared_dict;
+create table test.lc_shared_dict (k UInt64, s LowCardinality(String), n LowCardinality(Nullable(String))) engine = MergeTree order by k settings index_granularity = 16;
+
+insert into test.lc_shared_dict select number, toString(number % 5), number % 7 = 0 ? Null : toString(number % 3) from system.numbers limit 1000;
+
+select s, count(), uniqExact(k) from test.lc_shared_dict group by s order by s;
+select n, count() from test.lc_shared_dict group by n order by n;
+select count() from test.lc_shared_dict where s = '3';
+
+-- The same queries with sharing disabled must give the same result.
+set low_cardinality_share_dictionaries = 0;
+select s, count(), uniqExact(k) from test.lc_shared_dict group by s order by s;
+
+drop table test.lc_shared_dict;
@@ -0,0 +1,30 @@
+#!/usr/bin/env bash
+
+CURDIR=$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)
+. $CURDIR/../shell_config.sh
+
+SETTINGS="--input_format_parallel_parsing=1 --min_chunk_bytes_for_parallel_parsing=128 --max_threads=4"
+
+$CLICKHOUSE_CLIENT --query="DROP TABLE IF EXISTS test.parallel_parsing"
+$CLICKHOUSE_CLIENT --query="CREATE TABLE test.parallel_parsing (k UInt64, s String) ENGINE = Memory"
+
+# TabSeparated with escape sequences in values.
+seq 1 1000 | awk '{ print $1 "\tvalue\\nwith\\tescapes" $1 }' | $CLICKHOUSE_CLIENT $SETTINGS --query="INSERT INTO test.parallel_parsing FORMAT TabSeparated"
+$CLICKHOUSE_CLIENT --query="SELECT count(), sum(k), uniqExact(s), sum(length(s)) FROM test.parallel_parsing"
+
+# CSV with a real newline inside a quoted field - must not be taken for a row boundary.
+$CLICKHOUSE_CLIENT --query="TRUNCATE TABLE test.parallel_parsing"
+seq 1 1000 | awk '{ print $1 ",\"line1\nline2-" $1 "\"" }' | $CLICKHOUSE_CLIENT $SETTINGS --query="INSERT INTO test.parallel_parsing FORMAT CSV"
+$CLICKHOUSE_CLIENT --query="SELECT count(), sum(k), uniqExact(s), sum(length(s)) FROM test.parallel_parsing"
+
+# JSONEachRow.
+$CLICKHOUSE_CLIENT --query="TRUNCATE TABLE test.parallel_parsing"
+seq 1 1000 | awk '{ print "{\"k\": " $1 ", \"s\": \"json-" $1 "\"}" }' | $CLICKHOUSE_CLIENT $SETTINGS --query="INSERT INTO test.parallel_parsing FORMAT JSONEachRow"
+$CLICKHOUSE_CLIENT --query="SELECT count(), sum(k), uniqExact(s), sum(length(s)) FROM test.parallel_parsing"
+
+# The same data parsed in one thread must give the same result.
+$CLICKHOUSE_CLIENT --query="TRUNCATE TABLE test.parallel_parsing"
+seq 1 1000 | awk '{ print $1 "\tvalue\\nwith\\tescapes" $1 }' | $CLICKHOUSE_CLIENT --input_format_parallel_parsing=0 --query="INSERT INTO test.parallel_parsing FORMAT TabSeparated"
+$CLICKHOUSE_CLIENT --query="SELECT count(), sum(k), uniqExact(s), sum(length(s)) FROM test.parallel_parsing"
+
+$CLICKHOUSE_CLIENT --query="DROP TABLE test.parallel_parsing"
@@ -0,0 +1,12 @@
+DROP TABLE IF EXISTS test.stripe_decode_ahead;
+CREATE TABLE test.stripe_decode_ahead (x UInt64, s String) ENGINE = StripeLog;
+
+INSERT INTO test.stripe_decode_ahead SELECT number, toString(number) FROM system.numbers LIMIT 100000;
+INSERT INTO test.stripe_decode_ahead SELECT number, toString(number) FROM system.numbers LIMIT 100000;
+
+SET decompress_ahead_blocks = 4;
+SELECT count(), sum(x), sum(length(s)) FROM test.stripe_decode_ahead;
+SET decompress_ahead_blocks = 0;
+SELECT count(), sum(x), sum(length(s)) FROM test.stripe_decode_ahead;
+
+DROP TABLE test.stripe_decode_ahead;
@@ -0,0 +1,17 @@
+DROP TABLE IF EXISTS test.deferred_checksum;
+CREATE TABLE test.deferred_checksum (d Date, x UInt64, s String) ENGINE = MergeTree(d, x, 8192);
+
+INSERT INTO test.deferred_checksum SELECT toDate('2018-01-01'), number, toString(number) FROM system.numbers LIMIT 100000;
+INSERT INTO test.deferred_checksum SELECT toDate('2018-01-02'), number, toString(number) FROM system.numbers LIMIT 100000;
+
+SET max_threads = 1;
+SET deferred_checksum_verification = 1;
+SELECT count(), sum(x), sum(length(s)) FROM test.deferred_checksum;
+
+SET max_threads = 4;
+SELECT count(), sum(x), sum(length(s)) FROM test.deferred_checksum;
+
+SET deferred_checksum_verification = 0;
+SELECT count(), sum(x), sum(length(s)) FROM test.deferred_checksum;
+
+DROP TABLE test.deferred_checksum;
@@ -0,0 +1,15 @@
+DROP TABLE IF EXISTS test.mmap_io;
+CREATE TABLE test.mmap_io (d Date, x UInt64, s String) ENGINE = MergeTree(d, x, 8192);
+
+INSERT INTO test.mmap_io SELECT toDate('2018-01-01'), number, toString(number) FROM system.numbers LIMIT 100000;
+
+SET min_bytes_to_use_mmap_io = 1;
+SELECT count(), sum(x), sum(length(s)) FROM test.mmap_io;
+
+SET use_uncompressed_cache = 1;
+SELECT count(), sum(x), sum(length(s)) FROM test.mmap_io;
+
+SET min_bytes_to_use_mmap_io = 0, use_uncompressed_cache = 0;
+SELECT count(), sum(x), sum(length(s)) FROM test.mmap_io;
+
+DROP TABLE test.mmap_io;
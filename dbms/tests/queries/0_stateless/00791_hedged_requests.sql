@@ -0,0 +1,16 @@
+DROP TABLE IF EXISTS test.hedged;
+CREATE TABLE test.hedged (x UInt64) ENGINE = Memory;
+
+INSERT INTO test.hedged SELECT number FROM system.numbers LIMIT 10;
+
+-- The result must not depend on which replica wins the race.
+SET hedged_request_delay_ms = 1;
+SELECT sum(x) FROM remote('127.0.0.1|127.0.0.2', test.hedged);
+
+SET hedged_request_delay_ms = 1000;
+SELECT sum(x) FROM remote('127.0.0.1|127.0.0.2', test.hedged);
+
+SET hedged_request_delay_ms = 0;
+SELECT sum(x) FROM remote('127.0.0.1|127.0.0.2', test.hedged);
+
+DROP TABLE test.hedged;
@@ -0,0 +1,13 @@
+DROP TABLE IF EXISTS test.parallel_replicas;
+CREATE TABLE test.parallel_replicas (d Date, x UInt64) ENGINE = MergeTree(d, x, 8192);
+
+INSERT INTO test.parallel_replicas SELECT toDate('2018-01-01'), number FROM system.numbers LIMIT 100000;
+
+-- The table has no sampling key: the data is split among the replicas by a hash of the primary key.
+SET max_parallel_replicas = 2;
+SELECT count(), sum(x) FROM remote('127.0.0.1|127.0.0.2', test.parallel_replicas);
+
+SET max_parallel_replicas = 1;
+SELECT count(), sum(x) FROM remote('127.0.0.1|127.0.0.2', test.parallel_replicas);
+
+DROP TABLE test.parallel_replicas;
@@ -0,0 +1,24 @@
+SELECT multiSearchAny('hello world', ['world', 'xyz']);
+SELECT multiSearchAny('hello world', ['xyz', 'abc']);
+SELECT multiSearchAny('hello world', []);
+SELECT multiSearchFirstPosition('hello world', ['world', 'llo']);
+SELECT multiSearchFirstPosition('hello world', ['xyz']);
+SELECT multiSearchFirstIndex('hello world', ['world', 'llo']);
+SELECT multiSearchFirstIndex('hello world', ['xyz', 'world']);
+SELECT multiSearchFirstIndex('hello world', ['xyz', 'abc']);
+
+-- Needles shorter than a bigram and longer rows go through the fallback path.
+SELECT multiSearchAny('abc', ['b']);
+SELECT multiSearchFirstPosition('abc', ['c', 'b']);
+
+SELECT
+    multiSearchAny(s, ['error', 'warning', 'fatal']) AS a,
+    multiSearchFirstPosition(s, ['error', 'warning', 'fatal']) AS p,
+    multiSearchFirstIndex(s, ['error', 'warning', 'fatal']) AS i
+FROM
+(
+    SELECT arrayJoin(['2018 fatal error in module', 'all is fine', 'just a warning: error ahead', '']) AS s
+);
+
+-- The same needle set over many generated rows: hash table is built once per block.
+SELECT sum(multiSearchAny(concat('prefix_', toString(number)), ['_7', '_8', 'prefix_1'])) FROM numbers(100);
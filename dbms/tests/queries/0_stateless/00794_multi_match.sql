@@ -0,0 +1,15 @@
+SELECT multiMatchAny('hello world', ['wor.d', '^xyz']);
+SELECT multiMatchAny('hello world', ['^xyz', 'abc$']);
+SELECT multiMatchAnyIndex('hello world', ['^xyz', 'wor.d']);
+SELECT multiMatchAnyIndex('hello world', ['^xyz', 'abc$']);
+
+SELECT
+    multiMatchAny(s, ['^2018', 'err[o0]r', 'warn(ing)?']) AS a,
+    multiMatchAnyIndex(s, ['^2018', 'err[o0]r', 'warn(ing)?']) AS i
+FROM
+(
+    SELECT arrayJoin(['2018 fatal error in module', 'all is fine', 'just a warning: err0r ahead', '']) AS s
+);
+
+-- The same pattern set over many rows: the automaton is compiled once and cached.
+SELECT sum(multiMatchAny(concat('prefix_', toString(number)), ['_7$', '_8$', '^prefix_1'])) FROM numbers(100);
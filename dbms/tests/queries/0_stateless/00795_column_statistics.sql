@@ -0,0 +1,12 @@
+DROP TABLE IF EXISTS test.column_stats;
+CREATE TABLE test.column_stats (x UInt64, s String, n Nullable(UInt32)) ENGINE = MergeTree ORDER BY x;
+
+INSERT INTO test.column_stats SELECT number, toString(number % 10), if(number % 4 = 0, NULL, toUInt32(number % 100)) FROM system.numbers LIMIT 1000;
+
+SELECT column, rows, nulls, length(histogram) FROM system.column_statistics WHERE database = 'test' AND table = 'column_stats' ORDER BY column;
+
+-- NDV is approximate (HyperLogLog), so only check that it is in the right ballpark.
+-- Exact values: x - 1000, s - 10, n - 75.
+SELECT column, multiIf(column = 'x', ndv BETWEEN 950 AND 1050, column = 's', ndv BETWEEN 9 AND 11, ndv BETWEEN 70 AND 80) FROM system.column_statistics WHERE database = 'test' AND table = 'column_stats' ORDER BY column;
+
+DROP TABLE test.column_stats;
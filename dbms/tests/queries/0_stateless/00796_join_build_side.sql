@@ -0,0 +1,18 @@
+DROP TABLE IF EXISTS test.join_small;
+DROP TABLE IF EXISTS test.join_big;
+CREATE TABLE test.join_small (k UInt64, s String) ENGINE = MergeTree ORDER BY k;
+CREATE TABLE test.join_big (k UInt64, v UInt64) ENGINE = MergeTree ORDER BY k;
+
+INSERT INTO test.join_small SELECT number, toString(number) FROM system.numbers LIMIT 10;
+INSERT INTO test.join_big SELECT number % 10, number FROM system.numbers LIMIT 10000;
+
+-- The result of an ALL INNER JOIN must not depend on which side is hashed.
+SET optimize_join_build_side = 0;
+SELECT count(), sum(v) FROM test.join_small ALL INNER JOIN test.join_big USING k;
+
+SET optimize_join_build_side = 1;
+SELECT count(), sum(v) FROM test.join_small ALL INNER JOIN test.join_big USING k;
+SELECT count(), sum(v) FROM test.join_big ALL INNER JOIN test.join_small USING k;
+
+DROP TABLE test.join_small;
+DROP TABLE test.join_big;
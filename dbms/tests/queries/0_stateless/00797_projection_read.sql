@@ -0,0 +1,18 @@
+DROP TABLE IF EXISTS test.projection;
+CREATE TABLE test.projection (t UInt32, u UInt64, v UInt64) ENGINE = MergeTree ORDER BY t SETTINGS projection_sort_columns = 'u';
+
+INSERT INTO test.projection SELECT number, number % 97, number * 2 FROM system.numbers LIMIT 10000;
+
+-- The projection layout contains the same rows, so the results must not depend on it.
+SET optimize_use_projections = 0;
+SELECT count(), sum(v) FROM test.projection WHERE u = 13;
+SELECT t, v FROM test.projection WHERE u = 42 ORDER BY t LIMIT 5;
+
+SET optimize_use_projections = 1;
+SELECT count(), sum(v) FROM test.projection WHERE u = 13;
+SELECT t, v FROM test.projection WHERE u = 42 ORDER BY t LIMIT 5;
+
+-- The primary key can prune here, so the main layout is read even with the setting on.
+SELECT count() FROM test.projection WHERE t < 100;
+
+DROP TABLE test.projection;
@@ -0,0 +1,24 @@
+DROP TABLE IF EXISTS test.prepared;
+CREATE TABLE test.prepared (k UInt64, v String) ENGINE = MergeTree ORDER BY k;
+INSERT INTO test.prepared SELECT number, toString(number) FROM system.numbers LIMIT 100;
+
+PREPARE p1 AS SELECT v FROM test.prepared WHERE k = param(1);
+EXECUTE p1(42);
+EXECUTE p1(7);
+
+PREPARE p2 AS SELECT count(), sum(k) FROM test.prepared WHERE k < param(1) AND v != param(2);
+EXECUTE p2(10, '3');
+
+-- Re-preparing a name replaces the statement.
+PREPARE p1 AS SELECT param(1) + param(2);
+EXECUTE p1(1, 2);
+
+-- An alias on a parameter slot survives the substitution; references to it keep working.
+PREPARE p3 AS SELECT param(1) AS x, x + 1 ORDER BY x;
+EXECUTE p3(41);
+
+DEALLOCATE PREPARE p1;
+DEALLOCATE p2;
+DEALLOCATE p3;
+
+DROP TABLE test.prepared;
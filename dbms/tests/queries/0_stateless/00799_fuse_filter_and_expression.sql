@@ -0,0 +1,11 @@
+SET fuse_filter_and_expression = 1;
+
+SELECT number * 2 AS x, toString(number) AS s FROM (SELECT number FROM system.numbers LIMIT 100) WHERE number % 3 = 1 LIMIT 5;
+SELECT number < 3 AS f, number * 10 AS y FROM (SELECT number FROM system.numbers LIMIT 10) WHERE f;
+SELECT count(), sum(number * number) FROM (SELECT number FROM system.numbers LIMIT 1000) WHERE number % 7 = 0;
+
+SET fuse_filter_and_expression = 0;
+
+SELECT number * 2 AS x, toString(number) AS s FROM (SELECT number FROM system.numbers LIMIT 100) WHERE number % 3 = 1 LIMIT 5;
+SELECT number < 3 AS f, number * 10 AS y FROM (SELECT number FROM system.numbers LIMIT 10) WHERE f;
+SELECT count(), sum(number * number) FROM (SELECT number FROM system.numbers LIMIT 1000) WHERE number % 7 = 0;
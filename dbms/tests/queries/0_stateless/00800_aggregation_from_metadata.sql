@@ -0,0 +1,25 @@
+DROP TABLE IF EXISTS test.meta_agg;
+CREATE TABLE test.meta_agg (p UInt8, d Date, k UInt64) ENGINE = MergeTree PARTITION BY p ORDER BY (k, d);
+INSERT INTO test.meta_agg SELECT number % 3, toDate('2018-01-01') + number % 10, number + 5 FROM system.numbers LIMIT 1000;
+
+SET optimize_aggregation_from_metadata = 1;
+
+SELECT count() FROM test.meta_agg;
+SELECT count(), min(k) FROM test.meta_agg;
+SELECT count() FROM test.meta_agg WHERE p = 1;
+SELECT count() FROM test.meta_agg WHERE p < 2;
+SELECT count(), min(k) FROM test.meta_agg WHERE p = 2;
+SELECT min(p), max(p) FROM test.meta_agg;
+SELECT min(d), max(d) FROM test.meta_agg; -- not metadata-answerable, must fall back to reading
+
+SET optimize_aggregation_from_metadata = 0;
+
+SELECT count() FROM test.meta_agg;
+SELECT count(), min(k) FROM test.meta_agg;
+SELECT count() FROM test.meta_agg WHERE p = 1;
+SELECT count() FROM test.meta_agg WHERE p < 2;
+SELECT count(), min(k) FROM test.meta_agg WHERE p = 2;
+SELECT min(p), max(p) FROM test.meta_agg;
+SELECT min(d), max(d) FROM test.meta_agg;
+
+DROP TABLE test.meta_agg;
@@ -0,0 +1,14 @@
+SET enable_debug_queries = 1;
+SET optimize_query_plan = 1;
+
+PLAN SELECT 1;
+PLAN SELECT x FROM (SELECT dummy AS x FROM system.one ORDER BY x) ORDER BY x;
+PLAN SELECT x FROM (SELECT 1 AS x UNION ALL SELECT 2 AS x) LIMIT 1;
+
+-- The rewrites must not change query results.
+SELECT x FROM (SELECT number AS x FROM (SELECT number FROM system.numbers LIMIT 100) ORDER BY number DESC) ORDER BY x LIMIT 5;
+SELECT sum(x) FROM (SELECT 3 AS x UNION ALL SELECT 4 AS x);
+SELECT count() FROM (SELECT number FROM system.numbers LIMIT 7 UNION ALL SELECT number FROM system.numbers LIMIT 9);
+
+SET optimize_query_plan = 0;
+SELECT x FROM (SELECT number AS x FROM (SELECT number FROM system.numbers LIMIT 100) ORDER BY number DESC) ORDER BY x LIMIT 5;
@@ -0,0 +1,7 @@
+-- A tiny byte budget forces the aggregation output to be split into many blocks;
+-- the results must not change.
+SET aggregation_preferred_block_size_bytes = 1;
+SELECT number % 10 AS k, count(), sum(number) FROM (SELECT number FROM system.numbers LIMIT 1000) GROUP BY k ORDER BY k;
+
+SET aggregation_preferred_block_size_bytes = 0;
+SELECT number % 10 AS k, count(), sum(number) FROM (SELECT number FROM system.numbers LIMIT 1000) GROUP BY k ORDER BY k;
@@ -0,0 +1,25 @@
+-- Streaming aggregation when the GROUP BY keys cover a prefix of the sorting key.
+-- The results must be identical to those of hash aggregation.
+
+DROP TABLE IF EXISTS test.agg_in_order;
+CREATE TABLE test.agg_in_order (d Date, k UInt64, v UInt64) ENGINE = MergeTree PARTITION BY toYYYYMM(d) ORDER BY (d, k);
+INSERT INTO test.agg_in_order SELECT toDate('2018-01-01') + intDiv(number, 100), number % 10, number FROM system.numbers LIMIT 1000;
+INSERT INTO test.agg_in_order SELECT toDate('2018-01-01') + intDiv(number, 100), number % 10, number + 1000 FROM system.numbers LIMIT 1000;
+
+SET optimize_aggregation_in_order = 1;
+
+SELECT d, count(), sum(v) FROM test.agg_in_order GROUP BY d ORDER BY d;
+SELECT d, k, count() FROM test.agg_in_order GROUP BY d, k ORDER BY d, k LIMIT 5;
+SELECT k, d, sum(v) FROM test.agg_in_order GROUP BY k, d ORDER BY d, k LIMIT 5;
+SELECT count() FROM (SELECT d, k FROM test.agg_in_order GROUP BY d, k);
+SELECT d, count() FROM test.agg_in_order WHERE k < 5 GROUP BY d ORDER BY d LIMIT 3;
+
+SET optimize_aggregation_in_order = 0;
+
+SELECT d, count(), sum(v) FROM test.agg_in_order GROUP BY d ORDER BY d;
+SELECT d, k, count() FROM test.agg_in_order GROUP BY d, k ORDER BY d, k LIMIT 5;
+SELECT k, d, sum(v) FROM test.agg_in_order GROUP BY k, d ORDER BY d, k LIMIT 5;
+SELECT count() FROM (SELECT d, k FROM test.agg_in_order GROUP BY d, k);
+SELECT d, count() FROM test.agg_in_order WHERE k < 5 GROUP BY d ORDER BY d LIMIT 3;
+
+DROP TABLE test.agg_in_order;
@@ -0,0 +1,26 @@
+-- Independent per-partition aggregation when the GROUP BY keys determine the partition.
+-- The results must be identical to those of shared hash aggregation.
+
+DROP TABLE IF EXISTS test.part_wise_agg;
+CREATE TABLE test.part_wise_agg (d Date, k UInt64, v UInt64) ENGINE = MergeTree PARTITION BY toYYYYMM(d) ORDER BY k;
+INSERT INTO test.part_wise_agg SELECT toDate('2018-01-15') + number % 90, number % 7, number FROM system.numbers LIMIT 1000;
+
+SET optimize_partition_wise_aggregation = 1;
+
+-- The keys include the source column of the partition expression.
+SELECT d, count(), sum(v) FROM test.part_wise_agg GROUP BY d ORDER BY d LIMIT 5;
+SELECT d, k, sum(v) FROM test.part_wise_agg GROUP BY d, k ORDER BY d, k LIMIT 5;
+-- The keys include the value of the partition expression itself.
+SELECT toYYYYMM(d), count() FROM test.part_wise_agg GROUP BY toYYYYMM(d) ORDER BY toYYYYMM(d);
+SELECT count() FROM (SELECT d FROM test.part_wise_agg GROUP BY d);
+SELECT d, count() FROM test.part_wise_agg WHERE k < 3 GROUP BY d ORDER BY d LIMIT 3;
+
+SET optimize_partition_wise_aggregation = 0;
+
+SELECT d, count(), sum(v) FROM test.part_wise_agg GROUP BY d ORDER BY d LIMIT 5;
+SELECT d, k, sum(v) FROM test.part_wise_agg GROUP BY d, k ORDER BY d, k LIMIT 5;
+SELECT toYYYYMM(d), count() FROM test.part_wise_agg GROUP BY toYYYYMM(d) ORDER BY toYYYYMM(d);
+SELECT count() FROM (SELECT d FROM test.part_wise_agg GROUP BY d);
+SELECT d, count() FROM test.part_wise_agg WHERE k < 3 GROUP BY d ORDER BY d LIMIT 3;
+
+DROP TABLE test.part_wise_agg;
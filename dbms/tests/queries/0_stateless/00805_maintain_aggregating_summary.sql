@@ -0,0 +1,30 @@
+-- A maintained summary: an Aggregating table that is folded eagerly by background merges
+-- and read in a streaming fashion without re-hashing (maintain_aggregating_summary).
+
+DROP TABLE IF EXISTS test.summary_agg;
+CREATE TABLE test.summary_agg
+(
+    d Date,
+    k UInt64,
+    cnt AggregateFunction(count),
+    s AggregateFunction(sum, UInt64)
+) ENGINE = AggregatingMergeTree PARTITION BY toYYYYMM(d) ORDER BY (d, k)
+SETTINGS maintain_aggregating_summary = 1;
+
+INSERT INTO test.summary_agg
+    SELECT toDate('2018-01-01') + number % 5 AS d, number % 3 AS k, countState(), sumState(number)
+    FROM (SELECT number FROM system.numbers LIMIT 1000) GROUP BY d, k;
+
+INSERT INTO test.summary_agg
+    SELECT toDate('2018-01-01') + number % 5 AS d, number % 3 AS k, countState(), sumState(number + 1000)
+    FROM (SELECT number FROM system.numbers LIMIT 500) GROUP BY d, k;
+
+-- Read in streaming fashion (implied by the table setting).
+SELECT d, k, countMerge(cnt), sumMerge(s) FROM test.summary_agg GROUP BY d, k ORDER BY d, k;
+SELECT d, countMerge(cnt) FROM test.summary_agg GROUP BY d ORDER BY d;
+
+-- The same through hash aggregation must give the same result.
+SET optimize_aggregation_in_order = 0;
+SELECT d, k, countMerge(cnt), sumMerge(s) FROM test.summary_agg GROUP BY k, d ORDER BY d, k;
+
+DROP TABLE test.summary_agg;
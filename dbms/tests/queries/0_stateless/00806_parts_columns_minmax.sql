@@ -0,0 +1,14 @@
+DROP TABLE IF EXISTS test.parts_columns_minmax;
+
+CREATE TABLE test.parts_columns_minmax (d Date, k UInt64, v UInt64)
+    ENGINE = MergeTree PARTITION BY toYYYYMM(d) ORDER BY k
+    SETTINGS skip_index_minmax_columns = 'v';
+
+INSERT INTO test.parts_columns_minmax SELECT toDate('2018-01-01') + number % 10, number, number * 2 FROM system.numbers LIMIT 100;
+
+SELECT column, column_has_minmax, column_min, column_max
+    FROM system.parts_columns
+    WHERE database = 'test' AND table = 'parts_columns_minmax' AND active
+    ORDER BY column;
+
+DROP TABLE test.parts_columns_minmax;
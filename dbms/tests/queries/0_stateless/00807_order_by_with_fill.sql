@@ -0,0 +1,4 @@
+SELECT number AS n, 'original' AS s FROM (SELECT number FROM system.numbers LIMIT 10) WHERE number % 3 = 1 ORDER BY n WITH FILL;
+SELECT number AS n FROM (SELECT number FROM system.numbers LIMIT 10) WHERE number % 3 = 1 ORDER BY n DESC WITH FILL;
+SELECT toFloat64(number) AS n FROM (SELECT number FROM system.numbers LIMIT 10) WHERE number % 3 = 1 ORDER BY n WITH FILL FROM 0 TO 12 STEP 0.5;
+SELECT k, n FROM (SELECT 1 AS k, 2 AS n UNION ALL SELECT 2 AS k, 1 AS n) ORDER BY k WITH FILL FROM 0 TO 4, n WITH FILL FROM 0 TO 3;
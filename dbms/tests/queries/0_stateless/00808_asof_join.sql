@@ -0,0 +1,37 @@
+DROP TABLE IF EXISTS test.trades;
+DROP TABLE IF EXISTS test.quotes;
+
+CREATE TABLE test.trades (instrument String, trade_time UInt32, price Float64) ENGINE = Memory;
+CREATE TABLE test.quotes (instrument String, quote_time UInt32, bid Float64) ENGINE = Memory;
+
+INSERT INTO test.trades VALUES ('A', 10, 100), ('A', 25, 101), ('B', 15, 200), ('B', 16, 201), ('C', 5, 300);
+INSERT INTO test.quotes VALUES ('A', 8, 99.5), ('A', 20, 100.5), ('A', 30, 101.5), ('B', 15, 199.5), ('C', 6, 299.5);
+
+-- Every trade gets the last quote of the same instrument with quote_time <= trade_time.
+SELECT instrument, trade_time, price, quote_time, bid
+FROM test.trades AS t ASOF INNER JOIN test.quotes AS q
+ON t.instrument = q.instrument AND t.trade_time >= q.quote_time
+ORDER BY instrument, trade_time;
+
+SELECT '-';
+
+-- LEFT keeps the trades with no preceding quote.
+SELECT instrument, trade_time, price, quote_time, bid
+FROM test.trades AS t ASOF LEFT JOIN test.quotes AS q
+ON t.instrument = q.instrument AND t.trade_time >= q.quote_time
+ORDER BY instrument, trade_time;
+
+SELECT '-';
+
+-- The inequality may be written from either side; the partitioned build gives the same result.
+SET join_algorithm = 'partitioned_hash';
+
+SELECT instrument, trade_time, price, quote_time, bid
+FROM test.trades AS t ASOF INNER JOIN test.quotes AS q
+ON t.instrument = q.instrument AND q.quote_time <= t.trade_time
+ORDER BY instrument, trade_time;
+
+SET join_algorithm = 'hash';
+
+DROP TABLE test.trades;
+DROP TABLE test.quotes;
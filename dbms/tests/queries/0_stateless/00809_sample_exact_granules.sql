@@ -0,0 +1,15 @@
+DROP TABLE IF EXISTS test.sample_exact;
+
+CREATE TABLE test.sample_exact (d Date DEFAULT '2000-01-01', x UInt8) ENGINE = MergeTree(d, x, x, 8);
+INSERT INTO test.sample_exact (x) SELECT toUInt8(number) AS x FROM system.numbers LIMIT 256;
+
+-- Cut-offs on granule boundaries: the index alone proves the sample exact.
+SELECT count(), min(x), max(x), sum(x) FROM test.sample_exact SAMPLE 1/4;
+SELECT count(), min(x), max(x), sum(x) FROM test.sample_exact SAMPLE 1/4 OFFSET 1/2;
+SELECT count(), min(x), max(x), sum(x) FROM test.sample_exact SAMPLE 1/2 OFFSET 1/4;
+
+-- A cut-off inside a granule still requires the row-level filter.
+SELECT count(), min(x), max(x), sum(x) FROM test.sample_exact SAMPLE 100/256;
+SELECT count(), min(x), max(x), sum(x) FROM test.sample_exact SAMPLE 100/256 OFFSET 100/256;
+
+DROP TABLE test.sample_exact;
@@ -0,0 +1,15 @@
+DROP TABLE IF EXISTS test.insert_settings;
+
+CREATE TABLE test.insert_settings (x UInt8) ENGINE = MergeTree ORDER BY x;
+
+INSERT INTO test.insert_settings VALUES (1);
+
+-- The query-level override is stricter than the table defaults and rejects the insert.
+INSERT INTO test.insert_settings SETTINGS parts_to_delay_insert = 1, parts_to_throw_insert = 1 VALUES (2); -- { serverError 252 }
+
+-- The override applies only to its own query.
+INSERT INTO test.insert_settings VALUES (3);
+
+SELECT sum(x) FROM test.insert_settings;
+
+DROP TABLE test.insert_settings;
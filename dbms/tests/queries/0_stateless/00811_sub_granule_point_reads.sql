@@ -0,0 +1,15 @@
+DROP TABLE IF EXISTS test.point_read;
+
+CREATE TABLE test.point_read (k UInt32, v1 String, v2 UInt64) ENGINE = MergeTree ORDER BY k SETTINGS index_granularity = 16;
+INSERT INTO test.point_read SELECT number, concat('s', toString(number)), number * 2 FROM system.numbers LIMIT 1000;
+
+-- Single row in the middle of a granule.
+SELECT * FROM test.point_read PREWHERE k = 500;
+
+-- Rows spanning a granule boundary.
+SELECT * FROM test.point_read PREWHERE k IN (15, 16, 17) ORDER BY k;
+
+-- A short contiguous range inside a granule.
+SELECT * FROM test.point_read PREWHERE k >= 37 AND k <= 41 ORDER BY k;
+
+DROP TABLE test.point_read;
@@ -0,0 +1,13 @@
+-- The sketch guarantees a relative error of 1%, check the bound instead of exact values.
+SELECT abs(quantileDDSketch(0.5)(number + 1) / 501 - 1) < 0.01 FROM numbers(1001);
+SELECT abs(quantileDDSketch(0.99)(number + 1) / 991 - 1) < 0.01 FROM numbers(1001);
+SELECT arrayAll(x -> x < 0.01, arrayMap((q, e) -> abs(q / e - 1), quantilesDDSketch(0.5, 0.9, 0.99)(number + 1), [501., 901., 991.])) FROM numbers(1001);
+
+-- Zeros and negative values.
+SELECT quantileDDSketch(0.5)(toInt64(number) - 500) FROM numbers(1001);
+SELECT abs(quantileDDSketch(0.01)(toInt64(number) - 500) / -490 - 1) < 0.01 FROM numbers(1001);
+
+SELECT abs(quantileDDSketchWeighted(0.5)(number + 1, 2) / 501 - 1) < 0.01 FROM numbers(1001);
+
+-- States are mergeable.
+SELECT abs(quantileDDSketchMerge(0.5)(s) / 501 - 1) < 0.01 FROM (SELECT quantileDDSketchState(0.5)(number + 1) AS s FROM numbers(1001) GROUP BY number % 10);
@@ -0,0 +1,14 @@
+DROP TABLE IF EXISTS test.uniq_states;
+
+-- Inserting into an AggregateFunction column and reading it back round-trips
+-- the serialized state, covering the small, sparse and dense representations.
+CREATE TABLE test.uniq_states (k UInt8, h AggregateFunction(uniqHLL12, UInt64), c AggregateFunction(uniqCombined, UInt64)) ENGINE = Memory;
+
+INSERT INTO test.uniq_states SELECT 1, uniqHLL12State(number), uniqCombinedState(number) FROM numbers(10);
+INSERT INTO test.uniq_states SELECT 2, uniqHLL12State(number), uniqCombinedState(number) FROM numbers(500);
+INSERT INTO test.uniq_states SELECT 3, uniqHLL12State(number), uniqCombinedState(number) FROM numbers(100000);
+
+SELECT k, abs(uniqHLL12Merge(h) / transform(k, [1, 2, 3], [10., 500., 100000.], 0.) - 1) < 0.05, abs(uniqCombinedMerge(c) / transform(k, [1, 2, 3], [10., 500., 100000.], 0.) - 1) < 0.05 FROM test.uniq_states GROUP BY k ORDER BY k;
+SELECT abs(uniqHLL12Merge(h) / 100000 - 1) < 0.05, abs(uniqCombinedMerge(c) / 100000 - 1) < 0.05 FROM test.uniq_states;
+
+DROP TABLE test.uniq_states;
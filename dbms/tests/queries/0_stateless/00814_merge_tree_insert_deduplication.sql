@@ -0,0 +1,21 @@
+DROP TABLE IF EXISTS test.dedup;
+
+CREATE TABLE test.dedup (d Date, x UInt32) ENGINE = MergeTree PARTITION BY d ORDER BY x SETTINGS non_replicated_deduplication_window = 100;
+
+INSERT INTO test.dedup VALUES ('2018-01-01', 1);
+INSERT INTO test.dedup VALUES ('2018-01-01', 1);
+INSERT INTO test.dedup VALUES ('2018-01-01', 2);
+SELECT count() FROM test.dedup;
+
+INSERT INTO test.dedup SETTINGS insert_deduplicate = 0 VALUES ('2018-01-01', 1);
+SELECT count() FROM test.dedup;
+
+INSERT INTO test.dedup SETTINGS insert_deduplication_token = 'tok1' VALUES ('2018-01-02', 10);
+INSERT INTO test.dedup SETTINGS insert_deduplication_token = 'tok1' VALUES ('2018-01-02', 11);
+SELECT count() FROM test.dedup WHERE d = '2018-01-02';
+
+TRUNCATE TABLE test.dedup;
+INSERT INTO test.dedup VALUES ('2018-01-01', 1);
+SELECT count() FROM test.dedup;
+
+DROP TABLE test.dedup;
@@ -0,0 +1,6 @@
+SELECT arrayExists(x -> x > 5, [1, 2, 3]), arrayExists(x -> x > 2, [1, 2, 3]), arrayExists(x -> x, emptyArrayUInt8());
+SELECT arrayAll(x -> x < 4, [1, 2, 3]), arrayAll(x -> x < 3, [1, 2, 3]), arrayAll(x -> x, emptyArrayUInt8());
+SELECT arrayCount(x -> x % 2 = 0, [1, 2, 3, 4]), arrayCount(x -> x, emptyArrayUInt8());
+
+-- Arrays longer than 64 elements, to cover the vectorized part of the range scans.
+SELECT arrayExists(x -> x = 99, range(number)), arrayAll(x -> x < 99, range(number)), arrayCount(x -> x % 3 = 0, range(number)) FROM system.numbers LIMIT 130, 1;
@@ -0,0 +1,20 @@
+DROP TABLE IF EXISTS test.agg_buf;
+DROP TABLE IF EXISTS test.agg_dst;
+
+CREATE TABLE test.agg_dst (k UInt64, v AggregateFunction(sum, UInt64)) ENGINE = AggregatingMergeTree ORDER BY k;
+CREATE TABLE test.agg_buf AS test.agg_dst ENGINE = AggregatingBuffer(test, agg_dst, 1, 600, 600, 1000000, 1000000, 100000000, 1000000000);
+
+INSERT INTO test.agg_buf SELECT number % 2 AS k, sumState(number) AS v FROM (SELECT * FROM system.numbers LIMIT 10) GROUP BY k;
+INSERT INTO test.agg_buf SELECT number % 2 AS k, sumState(number) AS v FROM (SELECT * FROM system.numbers LIMIT 10) GROUP BY k;
+
+-- The buffer is collapsed on insert: at most one row per key.
+SELECT count() FROM test.agg_buf;
+SELECT k, sumMerge(v) FROM test.agg_buf GROUP BY k ORDER BY k;
+
+-- The flush writes states to the destination table.
+OPTIMIZE TABLE test.agg_buf;
+SELECT count() FROM test.agg_dst;
+SELECT k, sumMerge(v) FROM test.agg_dst GROUP BY k ORDER BY k;
+
+DROP TABLE test.agg_buf;
+DROP TABLE test.agg_dst;
@@ -0,0 +1,12 @@
+#!/usr/bin/env bash
+
+CURDIR=$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)
+. $CURDIR/../shell_config.sh
+
+# A query nested deeper than max_parser_depth is rejected instead of exhausting the stack.
+{ printf 'SELECT '; for _ in $(seq 1 500); do printf '('; done; printf '1'; for _ in $(seq 1 500); do printf ')'; done; } \
+    | ${CLICKHOUSE_CURL} -sS "${CLICKHOUSE_URL}?max_parser_depth=100" --data-binary @- | grep -c 'Maximum parse depth'
+
+# The same query parses fine within the limit.
+{ printf 'SELECT '; for _ in $(seq 1 500); do printf '('; done; printf '1'; for _ in $(seq 1 500); do printf ')'; done; } \
+    | ${CLICKHOUSE_CURL} -sS "${CLICKHOUSE_URL}?max_parser_depth=5000" --data-binary @-
@@ -0,0 +1,8 @@
+-- Contiguous list: pure range check.
+SELECT count() FROM (SELECT toUInt32(number) AS x FROM system.numbers LIMIT 1000) WHERE x IN (100, 101, 102, 103);
+-- Sparse list within a narrow range: bitmap.
+SELECT count() FROM (SELECT toUInt32(number) AS x FROM system.numbers LIMIT 1000) WHERE x IN (5, 100, 900);
+-- Signed values around zero.
+SELECT count() FROM (SELECT toInt64(number) - 500 AS x FROM system.numbers LIMIT 1000) WHERE x IN (-3, -2, 0, 7);
+SELECT count() FROM (SELECT toInt64(number) - 500 AS x FROM system.numbers LIMIT 1000) WHERE x NOT IN (-3, -2, 0, 7);
+SELECT 5 IN (1, 2, 3), 2 IN (1, 2, 3), -1 IN (-1, -5), 10 NOT IN (9, 11);
@@ -0,0 +1,18 @@
+DROP TABLE IF EXISTS test.ngram_idx;
+CREATE TABLE test.ngram_idx (k UInt64, message String) ENGINE = MergeTree ORDER BY k SETTINGS index_granularity = 8, skip_index_ngrambf_columns = 'message';
+
+INSERT INTO test.ngram_idx SELECT number, concat('payload line ', toString(number)) FROM numbers(100);
+INSERT INTO test.ngram_idx SELECT number, concat('payload line ', toString(number), if(number = 177, ' needle', '')) FROM numbers(100, 100);
+
+SELECT count() FROM test.ngram_idx WHERE message LIKE '%needle%';
+SELECT k FROM test.ngram_idx WHERE message LIKE '%needle%';
+SELECT count() FROM test.ngram_idx WHERE message LIKE '%missing_token%';
+SELECT count() FROM test.ngram_idx WHERE position(message, 'needle') > 0;
+SELECT count() FROM test.ngram_idx WHERE message = 'payload line 42';
+SELECT count() FROM test.ngram_idx WHERE message LIKE '%line 19%' AND message LIKE '%payload%';
+
+OPTIMIZE TABLE test.ngram_idx;
+
+SELECT k FROM test.ngram_idx WHERE message LIKE '%needle%';
+
+DROP TABLE test.ngram_idx;
@@ -0,0 +1,6 @@
+SET max_threads = 4;
+
+SELECT uniqExact(number) FROM (SELECT number FROM system.numbers_mt LIMIT 500000);
+SELECT uniqExact(toString(number)) FROM (SELECT number FROM system.numbers_mt LIMIT 200000);
+SELECT uniqExact(number % 10) FROM (SELECT number FROM system.numbers_mt LIMIT 100000);
+SELECT uniqExact(number, number % 3) FROM (SELECT number FROM system.numbers_mt LIMIT 200000);
@@ -0,0 +1,29 @@
+DROP TABLE IF EXISTS test.insert_select_src;
+DROP TABLE IF EXISTS test.insert_select_dst;
+DROP TABLE IF EXISTS test.insert_select_dist_src;
+DROP TABLE IF EXISTS test.insert_select_dist_dst;
+
+CREATE TABLE test.insert_select_src (k UInt64, v String) ENGINE = MergeTree ORDER BY k;
+CREATE TABLE test.insert_select_dst (k UInt64, v String) ENGINE = MergeTree ORDER BY k;
+CREATE TABLE test.insert_select_dist_src (k UInt64, v String) ENGINE = Distributed(test_shard_localhost, 'test', 'insert_select_src', k);
+CREATE TABLE test.insert_select_dist_dst (k UInt64, v String) ENGINE = Distributed(test_shard_localhost, 'test', 'insert_select_dst', k);
+
+INSERT INTO test.insert_select_src SELECT number, toString(number) FROM system.numbers LIMIT 100;
+
+SET distributed_insert_select_shard_local = 1;
+SET insert_distributed_sync = 1;
+
+INSERT INTO test.insert_select_dist_dst SELECT * FROM test.insert_select_dist_src;
+
+SELECT count(), sum(k) FROM test.insert_select_dst;
+SELECT count(), sum(k) FROM test.insert_select_dist_dst;
+
+-- Expressions in the select list and a WHERE clause are executed per shard as well.
+INSERT INTO test.insert_select_dist_dst SELECT k + 1000, v FROM test.insert_select_dist_src WHERE k < 10;
+
+SELECT count(), sum(k) FROM test.insert_select_dst;
+
+DROP TABLE test.insert_select_src;
+DROP TABLE test.insert_select_dst;
+DROP TABLE test.insert_select_dist_src;
+DROP TABLE test.insert_select_dist_dst;
@@ -0,0 +1,17 @@
+DROP TABLE IF EXISTS test.adaptive_prewhere_reorder;
+
+CREATE TABLE test.adaptive_prewhere_reorder (k UInt64, a UInt64, b UInt64, s String) ENGINE = MergeTree ORDER BY k;
+
+INSERT INTO test.adaptive_prewhere_reorder SELECT number, number % 2, number % 1000, toString(number) FROM system.numbers LIMIT 1000000;
+
+-- The first condition keeps half of the rows while the last one is by far the most selective,
+-- so the observed statistics move the steps around. The result must not depend on the order.
+SELECT count(), sum(k) FROM test.adaptive_prewhere_reorder PREWHERE a = 0 AND length(s) > 1 AND b = 10;
+SELECT count(), sum(k) FROM test.adaptive_prewhere_reorder PREWHERE a = 0 AND length(s) > 1 AND b = 10 SETTINGS adaptive_prewhere_reorder = 0;
+
+-- A sub-expression shared between two conditions is calculated by the earlier of them;
+-- reordering must keep the producing step before the consuming one.
+SELECT count() FROM test.adaptive_prewhere_reorder PREWHERE intDiv(b, 10) = 1 AND intDiv(b, 10) + a < 2 AND b != 12;
+SELECT count() FROM test.adaptive_prewhere_reorder PREWHERE intDiv(b, 10) = 1 AND intDiv(b, 10) + a < 2 AND b != 12 SETTINGS adaptive_prewhere_reorder = 0;
+
+DROP TABLE test.adaptive_prewhere_reorder;
@@ -0,0 +1,26 @@
+SET temporary_table_max_bytes_in_memory = 100000;
+
+CREATE TEMPORARY TABLE spill_test (n UInt64, s String);
+
+INSERT INTO spill_test SELECT number, toString(number) FROM system.numbers LIMIT 100000;
+INSERT INTO spill_test SELECT number, toString(number) FROM system.numbers LIMIT 100000, 100000;
+
+SELECT count(), sum(n) FROM spill_test;
+
+-- Data inserted after a spill is appended and read back together with the spilled part.
+INSERT INTO spill_test VALUES (200000, 'x');
+SELECT count(), sum(n) FROM spill_test;
+
+DROP TABLE spill_test;
+
+-- The budget can also be given explicitly for an ordinary Memory table.
+DROP TABLE IF EXISTS test.memory_spill;
+CREATE TABLE test.memory_spill (n UInt64) ENGINE = Memory SETTINGS max_bytes_in_memory = 65536;
+
+INSERT INTO test.memory_spill SELECT number FROM system.numbers LIMIT 1000000;
+SELECT count(), sum(n) FROM test.memory_spill;
+
+TRUNCATE TABLE test.memory_spill;
+SELECT count() FROM test.memory_spill;
+
+DROP TABLE test.memory_spill;
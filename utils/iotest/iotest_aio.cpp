@@ -11,7 +11,7 @@ int main(int argc, char ** argv) { return 0; }
 #include <vector>
 #include <Poco/Exception.h>
 #include <Common/Exception.h>
-#include <common/ThreadPool.h>
+#include <Common/ThreadPool.h>
 #include <Common/Stopwatch.h>
 #include <IO/BufferWithOwnMemory.h>
 #include <IO/ReadHelpers.h>